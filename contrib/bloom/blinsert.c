@@ -14,18 +14,101 @@
 
 #include "access/genam.h"
 #include "access/generic_xlog.h"
+#include "access/parallel.h"
+#include "access/table.h"
 #include "access/tableam.h"
+#include "access/xact.h"
 #include "bloom.h"
 #include "catalog/index.h"
+#include "executor/instrument.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "storage/bufmgr.h"
 #include "storage/indexfsm.h"
+#include "storage/proc.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
 
 PG_MODULE_MAGIC;
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_BLOOM_SHARED		UINT64CONST(0xD000000000000001)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xD000000000000002)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xD000000000000003)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xD000000000000004)
+
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment.
+ *
+ * Bloom index tuples need no ordering, so each participant simply writes the
+ * pages it fills to the index itself; nothing is passed back to the leader
+ * but the tuple counts.
+ */
+typedef struct BloomShared
+{
+	/*
+	 * These fields are not modified during the build.  They primarily exist
+	 * for the benefit of worker processes that need to create state
+	 * corresponding to that used by the leader.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+
+	/*
+	 * mutex protects the counters below, which are maintained by the
+	 * participants and read by the leader once all of them are done.
+	 *
+	 * reltuples is the total number of input heap tuples.
+	 *
+	 * indtuples is the total number of tuples inserted into the index.
+	 */
+	slock_t		mutex;
+	double		reltuples;
+	double		indtuples;
+
+	/*
+	 * ParallelTableScanDescData data follows. Can't directly embed here, as
+	 * implementations of the parallel table scan desc interface might need
+	 * stronger alignment.
+	 */
+} BloomShared;
+
+/*
+ * Return pointer to a BloomShared's parallel table scan.
+ *
+ * c.f. shm_toc_allocate as to why BUFFERALIGN is used, rather than just
+ * MAXALIGN.
+ */
+#define ParallelTableScanFromBloomShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(BloomShared)))
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct BloomLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).
+	 *
+	 * blshared is the shared state for entire build.  snapshot is the
+	 * snapshot used by the scan iff an MVCC snapshot is required.
+	 */
+	BloomShared *blshared;
+	Snapshot	snapshot;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+} BloomLeader;
+
 /*
  * State of bloom index build.  We accumulate one page data here before
  * flushing it to buffer manager.
@@ -40,6 +123,15 @@ typedef struct
 	int			count;			/* number of tuples in cached page */
 } BloomBuildState;
 
+/* parallel index builds */
+static BloomLeader *_bloom_begin_parallel(Relation heap, Relation index,
+										  bool isconcurrent, int request);
+static void _bloom_end_parallel(BloomLeader *blleader);
+static Size _bloom_parallel_estimate_shared(Relation heap, Snapshot snapshot);
+static void _bloom_parallel_scan_and_build(BloomShared *blshared,
+										   Relation heap, Relation index,
+										   bool progress);
+
 /*
  * Flush page cached in BloomBuildState.
  */
@@ -122,7 +214,8 @@ blbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 {
 	IndexBuildResult *result;
 	double		reltuples;
-	BloomBuildState buildstate;
+	double		indtuples;
+	BloomLeader *blleader = NULL;
 
 	if (RelationGetNumberOfBlocks(index) != 0)
 		elog(ERROR, "index \"%s\" already contains data",
@@ -131,7 +224,273 @@ blbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	/* Initialize the meta page */
 	BloomInitMetapage(index);
 
-	/* Initialize the bloom build state */
+	/*
+	 * Attempt to launch parallel worker scan when required
+	 */
+	if (indexInfo->ii_ParallelWorkers > 0)
+		blleader = _bloom_begin_parallel(heap, index, indexInfo->ii_Concurrent,
+										 indexInfo->ii_ParallelWorkers);
+
+	if (blleader)
+	{
+		BloomShared *blshared = blleader->blshared;
+
+		/* Join heap scan ourselves, then wait for the workers */
+		_bloom_parallel_scan_and_build(blshared, heap, index, true);
+		_bloom_end_parallel(blleader);
+
+		reltuples = blshared->reltuples;
+		indtuples = blshared->indtuples;
+	}
+	else
+	{
+		BloomBuildState buildstate;
+
+		/* Initialize the bloom build state */
+		memset(&buildstate, 0, sizeof(buildstate));
+		initBloomState(&buildstate.blstate, index);
+		buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+												  "Bloom build temporary context",
+												  ALLOCSET_DEFAULT_SIZES);
+		initCachedPage(&buildstate);
+
+		/* Do the heap scan */
+		reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
+										   bloomBuildCallback, (void *) &buildstate,
+										   NULL);
+
+		/* Flush last page if needed (it will be, unless heap was empty) */
+		if (buildstate.count > 0)
+			flushCachedPage(index, &buildstate);
+
+		MemoryContextDelete(buildstate.tmpCtx);
+
+		indtuples = buildstate.indtuples;
+	}
+
+	result = (IndexBuildResult *) palloc(sizeof(IndexBuildResult));
+	result->heap_tuples = reltuples;
+	result->index_tuples = indtuples;
+
+	return result;
+}
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * isconcurrent indicates if operation is CREATE INDEX CONCURRENTLY.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Returns the BloomLeader, which caller must use to shut down parallel mode
+ * by passing it to _bloom_end_parallel() once it has done its own share of
+ * the build.  If not even a single worker process can be launched, returns
+ * NULL, and caller should proceed with a serial index build.
+ */
+static BloomLeader *
+_bloom_begin_parallel(Relation heap, Relation index, bool isconcurrent,
+					  int request)
+{
+	ParallelContext *pcxt;
+	Snapshot	snapshot;
+	Size		estblshared;
+	BloomShared *blshared;
+	BloomLeader *blleader = (BloomLeader *) palloc0(sizeof(BloomLeader));
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	int			querylen;
+
+	/*
+	 * Enter parallel mode, and create context for parallel build of bloom
+	 * index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("bloom", "_bloom_parallel_build_main",
+								 request);
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time
+	 * qual checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/* Estimate size for our own PARALLEL_KEY_BLOOM_SHARED workspace */
+	estblshared = _bloom_parallel_estimate_shared(heap, snapshot);
+	shm_toc_estimate_chunk(&pcxt->estimator, estblshared);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/*
+	 * Estimate space for WalUsage and BufferUsage -- PARALLEL_KEY_WAL_USAGE
+	 * and PARALLEL_KEY_BUFFER_USAGE.
+	 *
+	 * If there are no extensions loaded that care, we could skip this.  We
+	 * have no way of knowing whether anyone's looking at pgWalUsage or
+	 * pgBufferUsage, so do it unconditionally.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		if (IsMVCCSnapshot(snapshot))
+			UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		pfree(blleader);
+		return NULL;
+	}
+
+	/* Store shared build state, for which we reserved space */
+	blshared = (BloomShared *) shm_toc_allocate(pcxt->toc, estblshared);
+	/* Initialize immutable state */
+	blshared->heaprelid = RelationGetRelid(heap);
+	blshared->indexrelid = RelationGetRelid(index);
+	blshared->isconcurrent = isconcurrent;
+	SpinLockInit(&blshared->mutex);
+	/* Initialize mutable state */
+	blshared->reltuples = 0.0;
+	blshared->indtuples = 0.0;
+	table_parallelscan_initialize(heap,
+								  ParallelTableScanFromBloomShared(blshared),
+								  snapshot);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BLOOM_SHARED, blshared);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/*
+	 * Allocate space for each worker's WalUsage and BufferUsage; no need to
+	 * initialize.
+	 */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	blleader->pcxt = pcxt;
+	blleader->blshared = blshared;
+	blleader->snapshot = snapshot;
+	blleader->walusage = walusage;
+	blleader->bufferusage = bufferusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_bloom_end_parallel(blleader);
+		pfree(blleader);
+		return NULL;
+	}
+
+	/*
+	 * Caller needs to wait for all launched workers when we return.  Make
+	 * sure that the failure-to-start case will not hang forever.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+
+	return blleader;
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ *
+ * The shared state, whose counters are final once the workers are done, is
+ * copied to local memory before the segment goes away.
+ */
+static void
+_bloom_end_parallel(BloomLeader *blleader)
+{
+	BloomShared *blshared;
+	int			i;
+
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(blleader->pcxt);
+
+	/*
+	 * Next, accumulate WAL usage.  (This must wait for the workers to finish,
+	 * or we might get incomplete data.)
+	 */
+	for (i = 0; i < blleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&blleader->bufferusage[i], &blleader->walusage[i]);
+
+	/* Keep the final counts, the shared memory is going away */
+	blshared = (BloomShared *) palloc(sizeof(BloomShared));
+	memcpy(blshared, blleader->blshared, sizeof(BloomShared));
+	blleader->blshared = blshared;
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(blleader->snapshot))
+		UnregisterSnapshot(blleader->snapshot);
+	DestroyParallelContext(blleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Returns size of shared memory required to store state for a parallel
+ * bloom index build based on the snapshot its parallel scan will use.
+ */
+static Size
+_bloom_parallel_estimate_shared(Relation heap, Snapshot snapshot)
+{
+	/* c.f. shm_toc_allocate as to why BUFFERALIGN is used */
+	return add_size(BUFFERALIGN(sizeof(BloomShared)),
+					table_parallelscan_estimate(heap, snapshot));
+}
+
+/*
+ * Perform a participant's portion of a parallel build.
+ *
+ * This scans the share of the table handed out to us by the parallel scan,
+ * exactly like a serial build scans the whole table: the tuples are packed
+ * into a private page, which is appended to the index whenever it is full.
+ * Each participant leaves at most one page partially filled.
+ */
+static void
+_bloom_parallel_scan_and_build(BloomShared *blshared, Relation heap,
+							   Relation index, bool progress)
+{
+	BloomBuildState buildstate;
+	TableScanDesc scan;
+	double		reltuples;
+	IndexInfo  *indexInfo;
+
+	/* Initialize our own build state, as blbuild() does */
 	memset(&buildstate, 0, sizeof(buildstate));
 	initBloomState(&buildstate.blstate, index);
 	buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
@@ -139,22 +498,91 @@ blbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 											  ALLOCSET_DEFAULT_SIZES);
 	initCachedPage(&buildstate);
 
-	/* Do the heap scan */
-	reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
-									   bloomBuildCallback, (void *) &buildstate,
-									   NULL);
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = blshared->isconcurrent;
+
+	scan = table_beginscan_parallel(heap,
+									ParallelTableScanFromBloomShared(blshared));
 
-	/* Flush last page if needed (it will be, unless heap was empty) */
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, progress,
+									   bloomBuildCallback, &buildstate, scan);
+
+	/* Flush last page if needed */
 	if (buildstate.count > 0)
 		flushCachedPage(index, &buildstate);
 
 	MemoryContextDelete(buildstate.tmpCtx);
 
-	result = (IndexBuildResult *) palloc(sizeof(IndexBuildResult));
-	result->heap_tuples = reltuples;
-	result->index_tuples = buildstate.indtuples;
+	/* Done.  Record ambuild statistics. */
+	SpinLockAcquire(&blshared->mutex);
+	blshared->reltuples += reltuples;
+	blshared->indtuples += buildstate.indtuples;
+	SpinLockRelease(&blshared->mutex);
+}
 
-	return result;
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_bloom_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	BloomShared *blshared;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+
+	/*
+	 * The only possible status flag that can be set to the parallel worker is
+	 * PROC_IN_SAFE_IC.
+	 */
+	Assert((MyProc->statusFlags == 0) ||
+		   (MyProc->statusFlags == PROC_IN_SAFE_IC));
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up bloom shared state */
+	blshared = shm_toc_lookup(toc, PARALLEL_KEY_BLOOM_SHARED, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!blshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = table_open(blshared->heaprelid, heapLockmode);
+	indexRel = index_open(blshared->indexrelid, indexLockmode);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	/* Perform our share of the build */
+	_bloom_parallel_scan_and_build(blshared, heapRel, indexRel, false);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
 }
 
 /*
@@ -166,7 +594,7 @@ blbuildempty(Relation index)
 	Page		metapage;
 
 	/* Construct metapage. */
-	metapage = (Page) palloc(BLCKSZ);
+	metapage = (Page) palloc_aligned(BLCKSZ, PG_IO_ALIGN_SIZE, 0);
 	BloomFillMetapage(index, metapage);
 
 	/*
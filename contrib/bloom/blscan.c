@@ -84,6 +84,8 @@ blgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 	BlockNumber blkno = BLOOM_HEAD_BLKNO,
 				npages;
 	int			i;
+	int		   *signWords;
+	int			nSignWords = 0;
 	BufferAccessStrategy bas;
 	BloomScanOpaque so = (BloomScanOpaque) scan->opaque;
 
@@ -115,6 +117,18 @@ blgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 		}
 	}
 
+	/*
+	 * Only the words of the scan signature that have some bit set can reject
+	 * an index tuple.  With a few bits per key there are usually just a
+	 * handful of them, so remember where they are and check only those.
+	 */
+	signWords = palloc(sizeof(int) * so->state.opts.bloomLength);
+	for (i = 0; i < so->state.opts.bloomLength; i++)
+	{
+		if (so->sign[i] != 0)
+			signWords[nSignWords++] = i;
+	}
+
 	/*
 	 * We're going to read the whole index. This is why we use appropriate
 	 * buffer access strategy.
@@ -145,9 +159,11 @@ blgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 				bool		res = true;
 
 				/* Check index signature with scan signature */
-				for (i = 0; i < so->state.opts.bloomLength; i++)
+				for (i = 0; i < nSignWords; i++)
 				{
-					if ((itup->sign[i] & so->sign[i]) != so->sign[i])
+					int			w = signWords[i];
+
+					if ((itup->sign[w] & so->sign[w]) != so->sign[w])
 					{
 						res = false;
 						break;
@@ -167,6 +183,7 @@ blgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 		CHECK_FOR_INTERRUPTS();
 	}
 	FreeAccessStrategy(bas);
+	pfree(signWords);
 
 	return ntids;
 }
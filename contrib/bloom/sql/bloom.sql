@@ -77,6 +77,31 @@ RESET enable_seqscan;
 RESET enable_bitmapscan;
 RESET enable_indexscan;
 
+-- Parallel build
+CREATE TABLE tstp (
+	i	int4,
+	t	text
+) WITH (fillfactor = 10);
+
+INSERT INTO tstp SELECT i%10, substr(md5(i::text), 1, 1) FROM generate_series(1,2000) i;
+ALTER TABLE tstp SET (parallel_workers = 2);
+SET max_parallel_maintenance_workers = 2;
+CREATE INDEX bloomidxp ON tstp USING bloom (i, t) WITH (col1 = 3);
+RESET max_parallel_maintenance_workers;
+
+SET enable_seqscan=off;
+SET enable_bitmapscan=on;
+SET enable_indexscan=on;
+
+SELECT count(*) FROM tstp WHERE i = 7;
+SELECT count(*) FROM tstp WHERE t = '5';
+SELECT count(*) FROM tstp WHERE i = 7 AND t = '5';
+
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+RESET enable_indexscan;
+DROP TABLE tstp;
+
 -- Run amvalidator function on our opclasses
 SELECT opcname, amvalidate(opc.oid)
 FROM pg_opclass opc JOIN pg_am am ON am.oid = opcmethod
@@ -0,0 +1,277 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar.h
+ *	  Definitions for the columnar table access method
+ *
+ * A columnar table is a sequence of stripes, each holding rows inserted by
+ * one (sub)transaction and command.  Within a stripe, the rows are divided
+ * into chunks, and each column of each chunk is stored and compressed
+ * separately, together with the minimum and maximum value of the column in
+ * the chunk.  That lets a scan read only the columns it needs, and skip the
+ * chunks whose values cannot satisfy the scan's quals.
+ *
+ * Block 0 of the relation is a metapage.  Each stripe occupies a contiguous
+ * range of blocks after that, and is treated as a byte stream spread over
+ * the pages of the range, starting with a StripeHeader in the first page.
+ * The first page is written last, so a stripe whose writer crashed leaves
+ * only continuation pages behind, which readers step over one at a time.
+ *
+ * Rows are identified by 64-bit row numbers, reserved from the metapage and
+ * mapped onto TIDs.  The rows of a chunk have consecutive row numbers, but
+ * chunks are reserved as the rows arrive, so that a small insert uses up
+ * few row numbers.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include "access/relscan.h"
+#include "access/stratnum.h"
+#include "access/tableam.h"
+#include "fmgr.h"
+#include "storage/bufpage.h"
+#include "utils/rel.h"
+
+#define COLUMNAR_METAPAGE_BLKNO		0
+#define COLUMNAR_MAGIC				0x434F4C31	/* "COL1" */
+#define COLUMNAR_STRIPE_MAGIC		0x53545231	/* "STR1" */
+#define COLUMNAR_VERSION			1
+
+/* Special space of every page */
+typedef struct ColumnarPageOpaqueData
+{
+	uint16		flags;
+	uint16		page_id;		/* for identification */
+} ColumnarPageOpaqueData;
+
+typedef ColumnarPageOpaqueData *ColumnarPageOpaque;
+
+#define COLUMNAR_PAGE_META			0x0001
+#define COLUMNAR_PAGE_STRIPE_START	0x0002
+#define COLUMNAR_PAGE_STRIPE_CONT	0x0004
+
+#define COLUMNAR_PAGE_ID			0xFF86
+
+#define ColumnarPageGetOpaque(page) \
+	((ColumnarPageOpaque) PageGetSpecialPointer(page))
+
+/* Bytes of stripe data stored on each page */
+#define COLUMNAR_PAGE_PAYLOAD \
+	(BLCKSZ - MAXALIGN(SizeOfPageHeaderData) - \
+	 MAXALIGN(sizeof(ColumnarPageOpaqueData)))
+
+/* Row numbers are mapped to TIDs with this many offsets per block */
+#define COLUMNAR_ROWS_PER_BLOCK		MaxHeapTuplesPerPage
+#define COLUMNAR_MAX_ROWNUM \
+	((uint64) MaxBlockNumber * COLUMNAR_ROWS_PER_BLOCK)
+
+/* Min/max values longer than this are not stored */
+#define COLUMNAR_MAX_MINMAX_LEN		256
+
+/* Compression methods; the values are stored on disk */
+typedef enum ColumnarCompression
+{
+	COLUMNAR_COMPRESSION_NONE = 0,
+	COLUMNAR_COMPRESSION_PGLZ,
+	COLUMNAR_COMPRESSION_LZ4,
+	COLUMNAR_COMPRESSION_ZSTD
+} ColumnarCompression;
+
+typedef struct ColumnarMetapage
+{
+	uint32		magic;
+	uint32		version;
+	uint64		next_rownum;	/* first row number not yet reserved */
+} ColumnarMetapage;
+
+/* StripeHeader flags, set by VACUUM once the outcome is known to everyone */
+#define STRIPE_FROZEN				0x0001
+#define STRIPE_DEAD					0x0002
+
+typedef struct StripeHeader
+{
+	uint32		magic;
+	uint16		flags;
+	uint16		natts;			/* number of columns stored */
+	TransactionId xmin;			/* inserting (sub)transaction */
+	CommandId	cid;			/* inserting command */
+	uint32		nblocks;		/* number of blocks in the stripe */
+	uint32		length;			/* length of the stripe's byte stream */
+	uint32		nrows;
+	uint32		nchunks;
+} StripeHeader;
+
+/* The stripe header is followed by one of these for each chunk ... */
+typedef struct ChunkHeader
+{
+	uint64		first_rownum;
+	uint32		nrows;
+	uint32		pad;
+} ChunkHeader;
+
+/*
+ * ... and then by nchunks * natts of these, in chunk-major order.  Offsets
+ * are relative to the start of the stripe.
+ */
+typedef struct ChunkColumnInfo
+{
+	uint64		data_offset;
+	uint32		data_len;		/* stored length */
+	uint32		raw_len;		/* length after decompression */
+	uint32		nnulls;
+	uint8		compression;	/* a ColumnarCompression */
+	bool		has_minmax;
+	uint16		min_len;
+	uint16		max_len;
+	uint64		min_offset;
+	uint64		max_offset;
+} ChunkColumnInfo;
+
+#define StripeChunksOffset() \
+	MAXALIGN(sizeof(StripeHeader))
+#define StripeInfosOffset(nchunks) \
+	(StripeChunksOffset() + (Size) (nchunks) * sizeof(ChunkHeader))
+
+/* A stripe, as seen by a reader */
+typedef struct StripeDesc
+{
+	BlockNumber start;
+	StripeHeader hdr;
+	ChunkHeader *chunks;
+	ChunkColumnInfo *infos;		/* nchunks * natts */
+} StripeDesc;
+
+#define StripeChunkColumn(stripe, chunk, attno) \
+	(&(stripe)->infos[(chunk) * (stripe)->hdr.natts + (attno) - 1])
+
+/* A predicate on a column that can be checked against min/max values */
+typedef struct ChunkPredicate
+{
+	AttrNumber	attno;
+	bool		is_nulltest;
+	bool		isnull;			/* nulltest: IS NULL rather than IS NOT NULL */
+	StrategyNumber strategy;	/* "column <strategy> value" */
+	Datum		value;
+	Oid			collation;
+	FmgrInfo   *cmp;
+} ChunkPredicate;
+
+/* The decoded values of one column of the current chunk */
+typedef struct ChunkColumn
+{
+	Datum	   *values;
+	bool	   *nulls;
+} ChunkColumn;
+
+typedef struct ColumnarParallelScanDescData
+{
+	ParallelTableScanDescData base;
+	BlockNumber nblocks;		/* relation size when the scan started */
+	pg_atomic_uint32 next_block;	/* next block to look for a stripe at */
+} ColumnarParallelScanDescData;
+
+typedef struct ColumnarParallelScanDescData *ColumnarParallelScanDesc;
+
+typedef struct ColumnarScanDescData
+{
+	TableScanDescData base;
+
+	MemoryContext scan_cxt;		/* holds the projection and predicates */
+	MemoryContext stripe_cxt;	/* holds the current stripe; reset per stripe */
+	MemoryContext chunk_cxt;	/* holds decoded data; reset per chunk */
+	BufferAccessStrategy strategy;
+	BlockNumber nblocks;
+	BlockNumber next_block;		/* for non-parallel scans */
+
+	/* columns to return (NULL means all), and predicates for skipping */
+	bool	   *needed;
+	List	   *predicates;
+
+	/* current stripe and chunk */
+	bool		have_stripe;
+	StripeDesc	stripe;
+	int			cur_chunk;
+	uint32		cur_row;		/* next row within the chunk */
+	ChunkColumn *columns;
+
+	/* rows of the current stripe still to be returned by ANALYZE */
+	uint32		analyze_row;
+	uint32		analyze_end;
+	bool		analyze_live;
+} ColumnarScanDescData;
+
+typedef struct ColumnarScanDescData *ColumnarScanDesc;
+
+/* columnar_handler.c */
+extern int	columnar_stripe_row_limit;
+extern int	columnar_chunk_row_limit;
+extern int	columnar_compression;
+
+/* columnar_storage.c */
+extern uint64 columnar_reserve_rownums(Relation rel, uint64 nrows);
+extern uint64 columnar_get_next_rownum(Relation rel);
+extern BlockNumber columnar_write_stripe(Relation rel, char *data,
+										 uint32 len);
+extern void columnar_read_stream(Relation rel, BlockNumber start,
+								 uint64 offset, char *dest, Size len,
+								 BufferAccessStrategy strategy);
+extern bool columnar_read_stripe_header(Relation rel, BlockNumber blkno,
+										BlockNumber nblocks,
+										StripeHeader *hdr,
+										BlockNumber *next,
+										BufferAccessStrategy strategy);
+extern void columnar_load_stripe(Relation rel, BlockNumber start,
+								 StripeHeader *hdr, StripeDesc *stripe,
+								 BufferAccessStrategy strategy);
+extern void columnar_set_stripe_flags(Relation rel, BlockNumber blkno,
+									  uint16 flags);
+extern bool columnar_stripe_visible(StripeHeader *hdr, Snapshot snapshot);
+extern char *columnar_compress(char *src, uint32 len, uint32 *outlen,
+							   uint8 *method);
+extern void columnar_decompress(uint8 method, char *src, uint32 len,
+								char *dest, uint32 rawlen);
+
+/* columnar_writer.c */
+extern void columnar_insert_row(Relation rel, TupleTableSlot *slot,
+								CommandId cid);
+extern void columnar_flush_pending(Relation rel);
+extern bool columnar_fetch_pending(Relation rel, ItemPointer tid,
+								   Snapshot snapshot, TupleTableSlot *slot);
+extern void columnar_writer_init(void);
+
+/* columnar_reader.c */
+extern List *columnar_build_predicates(TupleDesc tupdesc, List *quals);
+extern bool columnar_chunk_refuted(Relation rel, StripeDesc *stripe,
+								   int chunk, List *predicates,
+								   BufferAccessStrategy strategy);
+extern void columnar_load_chunk(Relation rel, StripeDesc *stripe, int chunk,
+								bool *needed, ChunkColumn *columns,
+								BufferAccessStrategy strategy);
+extern void columnar_fill_slot(Relation rel, StripeDesc *stripe,
+							   ChunkColumn *columns, bool *needed,
+							   uint32 row, TupleTableSlot *slot);
+extern bool columnar_fetch_row(Relation rel, ItemPointer tid,
+							   Snapshot snapshot, TupleTableSlot *slot);
+
+/* converting between row numbers and TIDs */
+static inline void
+columnar_rownum_to_tid(uint64 rownum, ItemPointer tid)
+{
+	ItemPointerSet(tid, (BlockNumber) (rownum / COLUMNAR_ROWS_PER_BLOCK),
+				   (OffsetNumber) (rownum % COLUMNAR_ROWS_PER_BLOCK + 1));
+}
+
+static inline uint64
+columnar_tid_to_rownum(ItemPointer tid)
+{
+	return (uint64) ItemPointerGetBlockNumber(tid) * COLUMNAR_ROWS_PER_BLOCK +
+		ItemPointerGetOffsetNumber(tid) - 1;
+}
+
+#endif							/* COLUMNAR_H */
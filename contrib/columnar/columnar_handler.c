@@ -0,0 +1,1062 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_handler.c
+ *	  Table access method routines for columnar tables
+ *
+ * Columnar tables are append-only: rows can be inserted and read, but not
+ * updated, deleted or locked, and indexes aren't supported.  VACUUM doesn't
+ * reclaim space, but marks the stripes of finished transactions, so that
+ * their visibility needn't be checked anymore; VACUUM FULL copies the live
+ * stripes to new storage.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar_handler.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/heapam.h"
+#include "access/multixact.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "catalog/index.h"
+#include "catalog/storage.h"
+#include "catalog/storage_xlog.h"
+#include "columnar.h"
+#include "commands/vacuum.h"
+#include "executor/tuptable.h"
+#include "miscadmin.h"
+#include "nodes/execnodes.h"
+#include "pgstat.h"
+#include "storage/bufmgr.h"
+#include "storage/procarray.h"
+#include "storage/smgr.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/snapmgr.h"
+
+PG_MODULE_MAGIC;
+
+int			columnar_stripe_row_limit = 150000;
+int			columnar_chunk_row_limit = 10000;
+int			columnar_compression = COLUMNAR_COMPRESSION_PGLZ;
+
+static const struct config_enum_entry columnar_compression_options[] = {
+	{"none", COLUMNAR_COMPRESSION_NONE, false},
+	{"pglz", COLUMNAR_COMPRESSION_PGLZ, false},
+#ifdef USE_LZ4
+	{"lz4", COLUMNAR_COMPRESSION_LZ4, false},
+#endif
+#ifdef USE_ZSTD
+	{"zstd", COLUMNAR_COMPRESSION_ZSTD, false},
+#endif
+	{NULL, 0, false}
+};
+
+static const TableAmRoutine columnar_methods;
+
+static bool columnar_scan_next_stripe(ColumnarScanDesc scan);
+static bool columnar_scan_next_chunk(ColumnarScanDesc scan);
+static void columnar_scan_reset(ColumnarScanDesc scan);
+static void columnar_not_supported(const char *what) pg_attribute_noreturn();
+
+PG_FUNCTION_INFO_V1(columnar_handler);
+
+
+void
+_PG_init(void)
+{
+	DefineCustomIntVariable("columnar.stripe_row_limit",
+							"Maximum number of rows per stripe of a columnar table.",
+							NULL,
+							&columnar_stripe_row_limit,
+							150000,
+							1000,
+							10000000,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("columnar.chunk_row_limit",
+							"Maximum number of rows per chunk of a columnar table.",
+							"Each chunk of a column has its own minimum and maximum value, "
+							"which scans use to skip chunks.",
+							&columnar_chunk_row_limit,
+							10000,
+							1000,
+							100000,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomEnumVariable("columnar.compression",
+							 "Compression method for new stripes of columnar tables.",
+							 NULL,
+							 &columnar_compression,
+							 COLUMNAR_COMPRESSION_PGLZ,
+							 columnar_compression_options,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	MarkGUCPrefixReserved("columnar");
+
+	columnar_writer_init();
+}
+
+static void
+columnar_not_supported(const char *what)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("%s is not supported on columnar tables", what)));
+}
+
+
+/* ------------------------------------------------------------------------
+ * Slot related callbacks
+ * ------------------------------------------------------------------------
+ */
+
+static const TupleTableSlotOps *
+columnar_slot_callbacks(Relation relation)
+{
+	return &TTSOpsVirtual;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Sequential scans
+ * ------------------------------------------------------------------------
+ */
+
+static TableScanDesc
+columnar_beginscan(Relation relation, Snapshot snapshot,
+				   int nkeys, ScanKey key,
+				   ParallelTableScanDesc parallel_scan,
+				   uint32 flags)
+{
+	ColumnarScanDesc scan;
+
+	/* the scan must see the rows inserted by earlier commands */
+	columnar_flush_pending(relation);
+
+	scan = (ColumnarScanDesc) palloc0(sizeof(ColumnarScanDescData));
+	scan->base.rs_rd = relation;
+	scan->base.rs_snapshot = snapshot;
+	scan->base.rs_nkeys = 0;
+	scan->base.rs_flags = flags;
+	scan->base.rs_parallel = parallel_scan;
+
+	scan->scan_cxt = AllocSetContextCreate(CurrentMemoryContext,
+										   "columnar scan",
+										   ALLOCSET_DEFAULT_SIZES);
+	scan->stripe_cxt = AllocSetContextCreate(scan->scan_cxt,
+											 "columnar scan stripe",
+											 ALLOCSET_DEFAULT_SIZES);
+	scan->chunk_cxt = AllocSetContextCreate(scan->scan_cxt,
+											"columnar scan chunk",
+											ALLOCSET_DEFAULT_SIZES);
+	scan->columns = MemoryContextAllocZero(scan->scan_cxt,
+										   RelationGetDescr(relation)->natts *
+										   sizeof(ChunkColumn));
+
+	columnar_scan_reset(scan);
+
+	return (TableScanDesc) scan;
+}
+
+/*
+ * (Re)start the scan from the beginning.
+ */
+static void
+columnar_scan_reset(ColumnarScanDesc scan)
+{
+	Relation	rel = scan->base.rs_rd;
+
+	if (scan->base.rs_parallel != NULL)
+		scan->nblocks = ((ColumnarParallelScanDesc) scan->base.rs_parallel)->nblocks;
+	else
+		scan->nblocks = RelationGetNumberOfBlocks(rel);
+	scan->next_block = COLUMNAR_METAPAGE_BLKNO + 1;
+
+	/* as in heapam's initscan, use a ring buffer for large scans */
+	if ((scan->base.rs_flags & SO_ALLOW_STRAT) &&
+		!RelationUsesLocalBuffers(rel) &&
+		scan->nblocks > NBuffers / 4)
+	{
+		if (scan->strategy == NULL)
+			scan->strategy = GetAccessStrategy(BAS_BULKREAD);
+	}
+	else if (scan->strategy != NULL)
+	{
+		FreeAccessStrategy(scan->strategy);
+		scan->strategy = NULL;
+	}
+
+	MemoryContextReset(scan->stripe_cxt);
+	MemoryContextReset(scan->chunk_cxt);
+	scan->have_stripe = false;
+	scan->cur_chunk = -1;
+	scan->cur_row = 0;
+	scan->analyze_row = scan->analyze_end = 0;
+}
+
+static void
+columnar_endscan(TableScanDesc sscan)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	if (scan->strategy != NULL)
+		FreeAccessStrategy(scan->strategy);
+	if (scan->base.rs_flags & SO_TEMP_SNAPSHOT)
+		UnregisterSnapshot(scan->base.rs_snapshot);
+
+	MemoryContextDelete(scan->scan_cxt);
+	pfree(scan);
+}
+
+static void
+columnar_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
+				bool allow_strat, bool allow_sync, bool allow_pagemode)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	if (set_params)
+	{
+		if (allow_strat)
+			scan->base.rs_flags |= SO_ALLOW_STRAT;
+		else
+			scan->base.rs_flags &= ~SO_ALLOW_STRAT;
+	}
+
+	columnar_scan_reset(scan);
+}
+
+static void
+columnar_set_projection(TableScanDesc sscan, Bitmapset *attrs, List *quals)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	TupleDesc	tupdesc = RelationGetDescr(scan->base.rs_rd);
+	MemoryContext oldcxt;
+	int			i = -1;
+
+	oldcxt = MemoryContextSwitchTo(scan->scan_cxt);
+
+	scan->needed = palloc0(tupdesc->natts * sizeof(bool));
+	while ((i = bms_next_member(attrs, i)) >= 0)
+	{
+		if (i >= 1 && i <= tupdesc->natts)
+			scan->needed[i - 1] = true;
+	}
+	scan->predicates = columnar_build_predicates(tupdesc, quals);
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * Advance to the next stripe visible to the scan.  In a parallel scan, the
+ * participants claim stripes by moving the shared block counter past them.
+ */
+static bool
+columnar_scan_next_stripe(ColumnarScanDesc scan)
+{
+	Relation	rel = scan->base.rs_rd;
+
+	MemoryContextReset(scan->stripe_cxt);
+	scan->have_stripe = false;
+
+	for (;;)
+	{
+		StripeHeader hdr;
+		BlockNumber blkno;
+		BlockNumber next;
+		bool		found;
+		MemoryContext oldcxt;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (scan->base.rs_parallel != NULL)
+		{
+			ColumnarParallelScanDesc cpscan =
+				(ColumnarParallelScanDesc) scan->base.rs_parallel;
+
+			blkno = pg_atomic_read_u32(&cpscan->next_block);
+			if (blkno >= scan->nblocks)
+				return false;
+			found = columnar_read_stripe_header(rel, blkno, scan->nblocks,
+												&hdr, &next, scan->strategy);
+			if (!pg_atomic_compare_exchange_u32(&cpscan->next_block,
+												&blkno, next))
+				continue;
+		}
+		else
+		{
+			blkno = scan->next_block;
+			if (blkno >= scan->nblocks)
+				return false;
+			found = columnar_read_stripe_header(rel, blkno, scan->nblocks,
+												&hdr, &next, scan->strategy);
+			scan->next_block = next;
+		}
+
+		if (!found || !columnar_stripe_visible(&hdr, scan->base.rs_snapshot))
+			continue;
+
+		oldcxt = MemoryContextSwitchTo(scan->stripe_cxt);
+		columnar_load_stripe(rel, blkno, &hdr, &scan->stripe, scan->strategy);
+		MemoryContextSwitchTo(oldcxt);
+
+		scan->have_stripe = true;
+		scan->cur_chunk = -1;
+		scan->cur_row = 0;
+		return true;
+	}
+}
+
+/*
+ * Advance to the next chunk that the scan's predicates don't rule out, and
+ * decode the columns it needs.
+ */
+static bool
+columnar_scan_next_chunk(ColumnarScanDesc scan)
+{
+	Relation	rel = scan->base.rs_rd;
+
+	while (scan->have_stripe || columnar_scan_next_stripe(scan))
+	{
+		while (++scan->cur_chunk < (int) scan->stripe.hdr.nchunks)
+		{
+			MemoryContext oldcxt;
+
+			MemoryContextReset(scan->chunk_cxt);
+			oldcxt = MemoryContextSwitchTo(scan->chunk_cxt);
+
+			if (scan->predicates != NIL &&
+				columnar_chunk_refuted(rel, &scan->stripe, scan->cur_chunk,
+									   scan->predicates, scan->strategy))
+			{
+				MemoryContextSwitchTo(oldcxt);
+				continue;
+			}
+
+			columnar_load_chunk(rel, &scan->stripe, scan->cur_chunk,
+								scan->needed, scan->columns, scan->strategy);
+			MemoryContextSwitchTo(oldcxt);
+
+			scan->cur_row = 0;
+			return true;
+		}
+		scan->have_stripe = false;
+	}
+
+	return false;
+}
+
+static bool
+columnar_getnextslot(TableScanDesc sscan, ScanDirection direction,
+					 TupleTableSlot *slot)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	Relation	rel = scan->base.rs_rd;
+
+	if (ScanDirectionIsBackward(direction))
+		columnar_not_supported("backward scan");
+
+	for (;;)
+	{
+		if (scan->have_stripe && scan->cur_chunk >= 0 &&
+			scan->cur_row < scan->stripe.chunks[scan->cur_chunk].nrows)
+		{
+			ChunkHeader *chunk = &scan->stripe.chunks[scan->cur_chunk];
+
+			columnar_fill_slot(rel, &scan->stripe, scan->columns,
+							   scan->needed, scan->cur_row, slot);
+			columnar_rownum_to_tid(chunk->first_rownum + scan->cur_row,
+								   &slot->tts_tid);
+			slot->tts_tableOid = RelationGetRelid(rel);
+			scan->cur_row++;
+
+			pgstat_count_heap_getnext(rel);
+			return true;
+		}
+
+		if (!columnar_scan_next_chunk(scan))
+		{
+			ExecClearTuple(slot);
+			return false;
+		}
+	}
+}
+
+
+/* ------------------------------------------------------------------------
+ * Parallel sequential scans
+ * ------------------------------------------------------------------------
+ */
+
+static Size
+columnar_parallelscan_estimate(Relation rel)
+{
+	return sizeof(ColumnarParallelScanDescData);
+}
+
+static Size
+columnar_parallelscan_initialize(Relation rel, ParallelTableScanDesc pscan)
+{
+	ColumnarParallelScanDesc cpscan = (ColumnarParallelScanDesc) pscan;
+
+	/* the workers can't see our pending rows, so write them out now */
+	columnar_flush_pending(rel);
+
+	cpscan->base.phs_relid = RelationGetRelid(rel);
+	cpscan->base.phs_syncscan = false;
+	cpscan->nblocks = RelationGetNumberOfBlocks(rel);
+	pg_atomic_init_u32(&cpscan->next_block, COLUMNAR_METAPAGE_BLKNO + 1);
+
+	return sizeof(ColumnarParallelScanDescData);
+}
+
+static void
+columnar_parallelscan_reinitialize(Relation rel, ParallelTableScanDesc pscan)
+{
+	ColumnarParallelScanDesc cpscan = (ColumnarParallelScanDesc) pscan;
+
+	pg_atomic_write_u32(&cpscan->next_block, COLUMNAR_METAPAGE_BLKNO + 1);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Index scans and other unsupported operations
+ * ------------------------------------------------------------------------
+ */
+
+static IndexFetchTableData *
+columnar_index_fetch_begin(Relation rel)
+{
+	columnar_not_supported("index scan");
+}
+
+static void
+columnar_index_fetch_reset(IndexFetchTableData *scan)
+{
+}
+
+static void
+columnar_index_fetch_end(IndexFetchTableData *scan)
+{
+}
+
+static bool
+columnar_index_fetch_tuple(struct IndexFetchTableData *scan,
+						   ItemPointer tid,
+						   Snapshot snapshot,
+						   TupleTableSlot *slot,
+						   bool *call_again, bool *all_dead)
+{
+	columnar_not_supported("index scan");
+}
+
+static TransactionId
+columnar_index_delete_tuples(Relation rel, TM_IndexDeleteOp *delstate)
+{
+	columnar_not_supported("index tuple deletion");
+}
+
+static void
+columnar_tuple_insert_speculative(Relation relation, TupleTableSlot *slot,
+								  CommandId cid, int options,
+								  BulkInsertState bistate, uint32 specToken)
+{
+	columnar_not_supported("INSERT ... ON CONFLICT");
+}
+
+static void
+columnar_tuple_complete_speculative(Relation relation, TupleTableSlot *slot,
+									uint32 specToken, bool succeeded)
+{
+	columnar_not_supported("INSERT ... ON CONFLICT");
+}
+
+static TM_Result
+columnar_tuple_delete(Relation relation, ItemPointer tid, CommandId cid,
+					  Snapshot snapshot, Snapshot crosscheck, bool wait,
+					  TM_FailureData *tmfd, bool changingPart)
+{
+	columnar_not_supported("DELETE");
+}
+
+static TM_Result
+columnar_tuple_update(Relation relation, ItemPointer otid,
+					  TupleTableSlot *slot, CommandId cid, Snapshot snapshot,
+					  Snapshot crosscheck, bool wait, TM_FailureData *tmfd,
+					  LockTupleMode *lockmode, bool *update_indexes)
+{
+	columnar_not_supported("UPDATE");
+}
+
+static TM_Result
+columnar_tuple_lock(Relation relation, ItemPointer tid, Snapshot snapshot,
+					TupleTableSlot *slot, CommandId cid, LockTupleMode mode,
+					LockWaitPolicy wait_policy, uint8 flags,
+					TM_FailureData *tmfd)
+{
+	columnar_not_supported("row locking");
+}
+
+static double
+columnar_index_build_range_scan(Relation tableRelation,
+								Relation indexRelation,
+								IndexInfo *indexInfo,
+								bool allow_sync,
+								bool anyvisible,
+								bool progress,
+								BlockNumber start_blockno,
+								BlockNumber numblocks,
+								IndexBuildCallback callback,
+								void *callback_state,
+								TableScanDesc scan)
+{
+	columnar_not_supported("CREATE INDEX");
+}
+
+static void
+columnar_index_validate_scan(Relation tableRelation,
+							 Relation indexRelation,
+							 IndexInfo *indexInfo,
+							 Snapshot snapshot,
+							 ValidateIndexState *state)
+{
+	columnar_not_supported("CREATE INDEX");
+}
+
+static bool
+columnar_scan_sample_next_block(TableScanDesc scan,
+								SampleScanState *scanstate)
+{
+	columnar_not_supported("TABLESAMPLE");
+}
+
+static bool
+columnar_scan_sample_next_tuple(TableScanDesc scan,
+								SampleScanState *scanstate,
+								TupleTableSlot *slot)
+{
+	columnar_not_supported("TABLESAMPLE");
+}
+
+
+/* ------------------------------------------------------------------------
+ * Non-modifying operations on individual tuples
+ * ------------------------------------------------------------------------
+ */
+
+static bool
+columnar_fetch_row_version(Relation relation, ItemPointer tid,
+						   Snapshot snapshot, TupleTableSlot *slot)
+{
+	if (columnar_fetch_pending(relation, tid, snapshot, slot))
+		return true;
+	return columnar_fetch_row(relation, tid, snapshot, slot);
+}
+
+static bool
+columnar_tuple_tid_valid(TableScanDesc scan, ItemPointer tid)
+{
+	return ItemPointerIsValid(tid) &&
+		ItemPointerGetOffsetNumber(tid) <= COLUMNAR_ROWS_PER_BLOCK;
+}
+
+static void
+columnar_get_latest_tid(TableScanDesc sscan, ItemPointer tid)
+{
+	/* rows are never updated, so every version is the latest */
+}
+
+static bool
+columnar_tuple_satisfies_snapshot(Relation rel, TupleTableSlot *slot,
+								  Snapshot snapshot)
+{
+	TupleTableSlot *tmpslot;
+	bool		result;
+
+	tmpslot = MakeSingleTupleTableSlot(RelationGetDescr(rel), &TTSOpsVirtual);
+	result = columnar_fetch_row_version(rel, &slot->tts_tid, snapshot,
+										tmpslot);
+	ExecDropSingleTupleTableSlot(tmpslot);
+
+	return result;
+}
+
+
+/* ----------------------------------------------------------------------------
+ *  Functions for manipulations of physical tuples
+ * ----------------------------------------------------------------------------
+ */
+
+static void
+columnar_tuple_insert(Relation relation, TupleTableSlot *slot, CommandId cid,
+					  int options, BulkInsertState bistate)
+{
+	columnar_insert_row(relation, slot, cid);
+	pgstat_count_heap_insert(relation, 1);
+}
+
+static void
+columnar_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
+					  CommandId cid, int options, BulkInsertState bistate)
+{
+	for (int i = 0; i < ntuples; i++)
+		columnar_insert_row(relation, slots[i], cid);
+	pgstat_count_heap_insert(relation, ntuples);
+}
+
+static void
+columnar_finish_bulk_insert(Relation relation, int options)
+{
+	/*
+	 * The relation may be about to be swapped with another or read directly,
+	 * e.g. in ALTER TABLE or REFRESH MATERIALIZED VIEW.
+	 */
+	columnar_flush_pending(relation);
+}
+
+
+/* ------------------------------------------------------------------------
+ * DDL related callbacks
+ * ------------------------------------------------------------------------
+ */
+
+static void
+columnar_relation_set_new_filelocator(Relation rel,
+									  const RelFileLocator *newrlocator,
+									  char persistence,
+									  TransactionId *freezeXid,
+									  MultiXactId *minmulti)
+{
+	SMgrRelation srel;
+
+	/*
+	 * Pending rows belong in the old storage, which is still used if we
+	 * roll back.
+	 */
+	columnar_flush_pending(rel);
+
+	*freezeXid = RecentXmin;
+	*minmulti = GetOldestMultiXactId();
+
+	srel = RelationCreateStorage(*newrlocator, persistence, true);
+
+	/* see heapam_relation_set_new_filelocator */
+	if (persistence == RELPERSISTENCE_UNLOGGED)
+	{
+		Assert(rel->rd_rel->relkind == RELKIND_RELATION ||
+			   rel->rd_rel->relkind == RELKIND_MATVIEW);
+		smgrcreate(srel, INIT_FORKNUM, false);
+		log_smgrcreate(newrlocator, INIT_FORKNUM);
+		smgrimmedsync(srel, INIT_FORKNUM);
+	}
+
+	smgrclose(srel);
+}
+
+static void
+columnar_relation_nontransactional_truncate(Relation rel)
+{
+	columnar_flush_pending(rel);
+	RelationTruncate(rel, 0);
+}
+
+static void
+columnar_relation_copy_data(Relation rel, const RelFileLocator *newrlocator)
+{
+	SMgrRelation dstrel;
+
+	columnar_flush_pending(rel);
+
+	/* see heapam_relation_copy_data */
+	dstrel = smgropen(*newrlocator, rel->rd_backend);
+	FlushRelationBuffers(rel);
+	RelationCreateStorage(*newrlocator, rel->rd_rel->relpersistence, true);
+	RelationCopyStorage(RelationGetSmgr(rel), dstrel, MAIN_FORKNUM,
+						rel->rd_rel->relpersistence);
+
+	for (ForkNumber forkNum = MAIN_FORKNUM + 1;
+		 forkNum <= MAX_FORKNUM; forkNum++)
+	{
+		if (smgrexists(RelationGetSmgr(rel), forkNum))
+		{
+			smgrcreate(dstrel, forkNum, false);
+			if (RelationIsPermanent(rel) ||
+				(rel->rd_rel->relpersistence == RELPERSISTENCE_UNLOGGED &&
+				 forkNum == INIT_FORKNUM))
+				log_smgrcreate(newrlocator, forkNum);
+			RelationCopyStorage(RelationGetSmgr(rel), dstrel, forkNum,
+								rel->rd_rel->relpersistence);
+		}
+	}
+
+	RelationDropStorage(rel);
+	smgrclose(dstrel);
+}
+
+/*
+ * For VACUUM FULL, copy the byte streams of the stripes that aren't dead to
+ * the new relation as they are.  Row numbers, and so TIDs, are preserved.
+ */
+static void
+columnar_relation_copy_for_cluster(Relation OldTable, Relation NewTable,
+								   Relation OldIndex, bool use_sort,
+								   TransactionId OldestXmin,
+								   TransactionId *xid_cutoff,
+								   MultiXactId *multi_cutoff,
+								   double *num_tuples,
+								   double *tups_vacuumed,
+								   double *tups_recently_dead)
+{
+	BlockNumber nblocks;
+	BlockNumber blkno = COLUMNAR_METAPAGE_BLKNO + 1;
+
+	if (OldIndex != NULL || use_sort)
+		columnar_not_supported("CLUSTER");
+
+	columnar_flush_pending(OldTable);
+
+	nblocks = RelationGetNumberOfBlocks(OldTable);
+	if (nblocks == 0)
+		return;
+	(void) columnar_reserve_rownums(NewTable,
+									columnar_get_next_rownum(OldTable));
+
+	while (blkno < nblocks)
+	{
+		BlockNumber start = blkno;
+		StripeHeader hdr;
+		bool		dead;
+		char	   *stream;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (!columnar_read_stripe_header(OldTable, start, nblocks, &hdr,
+										 &blkno, NULL))
+			continue;
+
+		if (hdr.flags & STRIPE_DEAD)
+			dead = true;
+		else if (hdr.flags & STRIPE_FROZEN)
+			dead = false;
+		else if (TransactionIdIsCurrentTransactionId(hdr.xmin) ||
+				 TransactionIdIsInProgress(hdr.xmin))
+			dead = false;
+		else if (TransactionIdDidCommit(hdr.xmin))
+		{
+			dead = false;
+			if (TransactionIdPrecedes(hdr.xmin, OldestXmin))
+				hdr.flags |= STRIPE_FROZEN;
+		}
+		else
+			dead = true;
+
+		if (dead)
+		{
+			*tups_vacuumed += hdr.nrows;
+			continue;
+		}
+		*num_tuples += hdr.nrows;
+
+		stream = MemoryContextAllocHuge(CurrentMemoryContext, hdr.length);
+		columnar_read_stream(OldTable, start, 0, stream, hdr.length, NULL);
+		((StripeHeader *) stream)->flags = hdr.flags;
+		columnar_write_stripe(NewTable, stream, hdr.length);
+		pfree(stream);
+	}
+}
+
+/*
+ * VACUUM marks each stripe whose inserting transaction is known to have
+ * committed before all running transactions started as frozen, and each
+ * stripe of an aborted transaction as dead, so that their XIDs needn't be
+ * looked up anymore and relfrozenxid can advance.
+ */
+static void
+columnar_vacuum_rel(Relation rel, VacuumParams *params,
+					BufferAccessStrategy bstrategy)
+{
+	struct VacuumCutoffs cutoffs;
+	BlockNumber nblocks;
+	BlockNumber blkno = COLUMNAR_METAPAGE_BLKNO + 1;
+	double		live = 0;
+	double		dead = 0;
+
+	(void) vacuum_get_cutoffs(rel, params, &cutoffs);
+
+	nblocks = RelationGetNumberOfBlocks(rel);
+	while (blkno < nblocks)
+	{
+		BlockNumber start = blkno;
+		StripeHeader hdr;
+
+		vacuum_delay_point();
+
+		if (!columnar_read_stripe_header(rel, start, nblocks, &hdr, &blkno,
+										 bstrategy))
+			continue;
+
+		if (hdr.flags & STRIPE_DEAD)
+			dead += hdr.nrows;
+		else if (hdr.flags & STRIPE_FROZEN)
+			live += hdr.nrows;
+		else if (TransactionIdIsInProgress(hdr.xmin))
+			continue;
+		else if (TransactionIdDidCommit(hdr.xmin))
+		{
+			live += hdr.nrows;
+			if (TransactionIdPrecedes(hdr.xmin, cutoffs.OldestXmin))
+				columnar_set_stripe_flags(rel, start, STRIPE_FROZEN);
+		}
+		else
+		{
+			dead += hdr.nrows;
+			columnar_set_stripe_flags(rel, start, STRIPE_DEAD);
+		}
+	}
+
+	vac_update_relstats(rel, nblocks, live, 0, false,
+						cutoffs.OldestXmin, cutoffs.OldestMxact,
+						NULL, NULL, false);
+	pgstat_report_vacuum(RelationGetRelid(rel), rel->rd_rel->relisshared,
+						 (PgStat_Counter) live, (PgStat_Counter) dead);
+}
+
+/*
+ * ANALYZE samples blocks, so we hand out a share of the rows of the stripe a
+ * block belongs to, in proportion to the stripe's size.
+ */
+static bool
+columnar_scan_analyze_next_block(TableScanDesc sscan, BlockNumber blockno,
+								 BufferAccessStrategy bstrategy)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	Relation	rel = scan->base.rs_rd;
+	StripeHeader *hdr = &scan->stripe.hdr;
+	uint32		part;
+
+	scan->analyze_row = scan->analyze_end = 0;
+
+	/* blocks come in increasing order; find the stripe containing this one */
+	if (!scan->have_stripe || blockno >= scan->stripe.start + hdr->nblocks)
+	{
+		MemoryContextReset(scan->stripe_cxt);
+		MemoryContextReset(scan->chunk_cxt);
+		scan->have_stripe = false;
+		scan->cur_chunk = -1;
+
+		while (scan->next_block <= blockno && scan->next_block < scan->nblocks)
+		{
+			BlockNumber start = scan->next_block;
+			StripeHeader next_hdr;
+
+			if (columnar_read_stripe_header(rel, start, scan->nblocks,
+											&next_hdr, &scan->next_block,
+											bstrategy) &&
+				blockno < scan->next_block)
+			{
+				MemoryContext oldcxt = MemoryContextSwitchTo(scan->stripe_cxt);
+
+				columnar_load_stripe(rel, start, &next_hdr, &scan->stripe,
+									 bstrategy);
+				MemoryContextSwitchTo(oldcxt);
+				scan->have_stripe = true;
+			}
+		}
+
+		if (!scan->have_stripe)
+			return false;
+
+		if (hdr->flags & STRIPE_DEAD)
+			scan->analyze_live = false;
+		else if ((hdr->flags & STRIPE_FROZEN) ||
+				 TransactionIdIsCurrentTransactionId(hdr->xmin))
+			scan->analyze_live = true;
+		else if (TransactionIdIsInProgress(hdr->xmin))
+		{
+			/* like heapam, don't count rows inserted by others meanwhile */
+			return false;
+		}
+		else
+			scan->analyze_live = TransactionIdDidCommit(hdr->xmin);
+	}
+
+	part = blockno - scan->stripe.start;
+	scan->analyze_row = (uint64) hdr->nrows * part / hdr->nblocks;
+	scan->analyze_end = (uint64) hdr->nrows * (part + 1) / hdr->nblocks;
+
+	return true;
+}
+
+static bool
+columnar_scan_analyze_next_tuple(TableScanDesc sscan, TransactionId OldestXmin,
+								 double *liverows, double *deadrows,
+								 TupleTableSlot *slot)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	Relation	rel = scan->base.rs_rd;
+	uint32		row;
+	uint32		first = 0;
+	int			chunk;
+
+	if (scan->analyze_row >= scan->analyze_end)
+		return false;
+
+	if (!scan->analyze_live)
+	{
+		*deadrows += scan->analyze_end - scan->analyze_row;
+		scan->analyze_row = scan->analyze_end;
+		return false;
+	}
+
+	row = scan->analyze_row++;
+	for (chunk = 0; chunk < (int) scan->stripe.hdr.nchunks; chunk++)
+	{
+		if (row < first + scan->stripe.chunks[chunk].nrows)
+			break;
+		first += scan->stripe.chunks[chunk].nrows;
+	}
+	Assert(chunk < (int) scan->stripe.hdr.nchunks);
+
+	if (chunk != scan->cur_chunk)
+	{
+		MemoryContext oldcxt;
+
+		MemoryContextReset(scan->chunk_cxt);
+		oldcxt = MemoryContextSwitchTo(scan->chunk_cxt);
+		columnar_load_chunk(rel, &scan->stripe, chunk, NULL, scan->columns,
+							scan->strategy);
+		MemoryContextSwitchTo(oldcxt);
+		scan->cur_chunk = chunk;
+	}
+
+	columnar_fill_slot(rel, &scan->stripe, scan->columns, NULL, row - first,
+					   slot);
+	columnar_rownum_to_tid(scan->stripe.chunks[chunk].first_rownum +
+						   row - first, &slot->tts_tid);
+	slot->tts_tableOid = RelationGetRelid(rel);
+	*liverows += 1;
+
+	return true;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Miscellaneous callbacks
+ * ------------------------------------------------------------------------
+ */
+
+static bool
+columnar_relation_needs_toast_table(Relation rel)
+{
+	/* values are stored in the stripes, however large */
+	return false;
+}
+
+/*
+ * Without statistics, use the number of row numbers handed out, which is
+ * an overestimate if transactions have aborted.
+ */
+static void
+columnar_estimate_rel_size(Relation rel, int32 *attr_widths,
+						   BlockNumber *pages, double *tuples,
+						   double *allvisfrac)
+{
+	BlockNumber curpages = RelationGetNumberOfBlocks(rel);
+	BlockNumber relpages = rel->rd_rel->relpages;
+	double		reltuples = rel->rd_rel->reltuples;
+
+	*pages = curpages;
+	*allvisfrac = 0;
+
+	if (curpages == 0)
+		*tuples = 0;
+	else if (reltuples >= 0 && relpages > 0)
+		*tuples = rint(reltuples / relpages * curpages);
+	else
+		*tuples = (double) columnar_get_next_rownum(rel);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Definition of the columnar table access method.
+ * ------------------------------------------------------------------------
+ */
+
+static const TableAmRoutine columnar_methods = {
+	.type = T_TableAmRoutine,
+
+	.slot_callbacks = columnar_slot_callbacks,
+
+	.scan_begin = columnar_beginscan,
+	.scan_end = columnar_endscan,
+	.scan_rescan = columnar_rescan,
+	.scan_getnextslot = columnar_getnextslot,
+	.scan_set_projection = columnar_set_projection,
+
+	.parallelscan_estimate = columnar_parallelscan_estimate,
+	.parallelscan_initialize = columnar_parallelscan_initialize,
+	.parallelscan_reinitialize = columnar_parallelscan_reinitialize,
+
+	.index_fetch_begin = columnar_index_fetch_begin,
+	.index_fetch_reset = columnar_index_fetch_reset,
+	.index_fetch_end = columnar_index_fetch_end,
+	.index_fetch_tuple = columnar_index_fetch_tuple,
+
+	.tuple_insert = columnar_tuple_insert,
+	.tuple_insert_speculative = columnar_tuple_insert_speculative,
+	.tuple_complete_speculative = columnar_tuple_complete_speculative,
+	.multi_insert = columnar_multi_insert,
+	.tuple_delete = columnar_tuple_delete,
+	.tuple_update = columnar_tuple_update,
+	.tuple_lock = columnar_tuple_lock,
+	.finish_bulk_insert = columnar_finish_bulk_insert,
+
+	.tuple_fetch_row_version = columnar_fetch_row_version,
+	.tuple_get_latest_tid = columnar_get_latest_tid,
+	.tuple_tid_valid = columnar_tuple_tid_valid,
+	.tuple_satisfies_snapshot = columnar_tuple_satisfies_snapshot,
+	.index_delete_tuples = columnar_index_delete_tuples,
+
+	.relation_set_new_filelocator = columnar_relation_set_new_filelocator,
+	.relation_nontransactional_truncate = columnar_relation_nontransactional_truncate,
+	.relation_copy_data = columnar_relation_copy_data,
+	.relation_copy_for_cluster = columnar_relation_copy_for_cluster,
+	.relation_vacuum = columnar_vacuum_rel,
+	.scan_analyze_next_block = columnar_scan_analyze_next_block,
+	.scan_analyze_next_tuple = columnar_scan_analyze_next_tuple,
+	.index_build_range_scan = columnar_index_build_range_scan,
+	.index_validate_scan = columnar_index_validate_scan,
+
+	.relation_size = table_block_relation_size,
+	.relation_needs_toast_table = columnar_relation_needs_toast_table,
+
+	.relation_estimate_size = columnar_estimate_rel_size,
+
+	.scan_sample_next_block = columnar_scan_sample_next_block,
+	.scan_sample_next_tuple = columnar_scan_sample_next_tuple
+};
+
+Datum
+columnar_handler(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_POINTER(&columnar_methods);
+}
@@ -0,0 +1,426 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_reader.c
+ *	  Decoding of stripes, and skipping chunks by their min/max values
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar_reader.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/nbtree.h"
+#include "columnar.h"
+#include "executor/tuptable.h"
+#include "nodes/primnodes.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/typcache.h"
+
+static Datum columnar_read_datum(Relation rel, StripeDesc *stripe,
+								 Form_pg_attribute att, uint64 offset,
+								 uint32 len, BufferAccessStrategy strategy);
+static void columnar_decode_column(Relation rel, StripeDesc *stripe,
+								   Form_pg_attribute att,
+								   ChunkColumnInfo *info, uint32 nrows,
+								   ChunkColumn *col,
+								   BufferAccessStrategy strategy);
+
+
+/*
+ * Pick out the quals that can be checked against the min/max values of a
+ * chunk: "column op constant" for btree operators of the column type's
+ * default opfamily and the column's collation, and NullTests on columns.
+ */
+List *
+columnar_build_predicates(TupleDesc tupdesc, List *quals)
+{
+	List	   *predicates = NIL;
+	ListCell   *lc;
+
+	foreach(lc, quals)
+	{
+		Node	   *qual = (Node *) lfirst(lc);
+		ChunkPredicate *pred;
+		Var		   *var;
+
+		if (IsA(qual, OpExpr))
+		{
+			OpExpr	   *op = (OpExpr *) qual;
+			Node	   *left;
+			Node	   *right;
+			Const	   *cnst;
+			bool		commuted = false;
+			Form_pg_attribute att;
+			TypeCacheEntry *typentry;
+			int			strategy;
+			Oid			lefttype;
+			Oid			righttype;
+
+			if (list_length(op->args) != 2)
+				continue;
+			left = (Node *) linitial(op->args);
+			right = (Node *) lsecond(op->args);
+			if (IsA(left, Var) && IsA(right, Const))
+			{
+				var = (Var *) left;
+				cnst = (Const *) right;
+			}
+			else if (IsA(left, Const) && IsA(right, Var))
+			{
+				var = (Var *) right;
+				cnst = (Const *) left;
+				commuted = true;
+			}
+			else
+				continue;
+
+			if (var->varlevelsup != 0 || var->varattno <= 0 ||
+				var->varattno > tupdesc->natts || cnst->constisnull)
+				continue;
+			att = TupleDescAttr(tupdesc, var->varattno - 1);
+
+			typentry = lookup_type_cache(att->atttypid,
+										 TYPECACHE_BTREE_OPFAMILY |
+										 TYPECACHE_CMP_PROC_FINFO);
+			if (!OidIsValid(typentry->btree_opf) ||
+				!OidIsValid(typentry->cmp_proc_finfo.fn_oid) ||
+				!op_in_opfamily(op->opno, typentry->btree_opf))
+				continue;
+			get_op_opfamily_properties(op->opno, typentry->btree_opf, false,
+									   &strategy, &lefttype, &righttype);
+			if (lefttype != typentry->btree_opintype ||
+				righttype != typentry->btree_opintype ||
+				op->inputcollid != att->attcollation)
+				continue;
+
+			pred = palloc0(sizeof(ChunkPredicate));
+			pred->attno = var->varattno;
+			pred->strategy = commuted ? BTCommuteStrategyNumber(strategy) :
+				strategy;
+			pred->value = cnst->constvalue;
+			pred->collation = att->attcollation;
+			pred->cmp = &typentry->cmp_proc_finfo;
+			predicates = lappend(predicates, pred);
+		}
+		else if (IsA(qual, NullTest))
+		{
+			NullTest   *nt = (NullTest *) qual;
+
+			if (nt->argisrow || !IsA(nt->arg, Var))
+				continue;
+			var = (Var *) nt->arg;
+			if (var->varlevelsup != 0 || var->varattno <= 0 ||
+				var->varattno > tupdesc->natts)
+				continue;
+
+			pred = palloc0(sizeof(ChunkPredicate));
+			pred->attno = var->varattno;
+			pred->is_nulltest = true;
+			pred->isnull = (nt->nulltesttype == IS_NULL);
+			predicates = lappend(predicates, pred);
+		}
+	}
+
+	return predicates;
+}
+
+/*
+ * Can we tell from the column metadata that no row of the given chunk
+ * satisfies all of 'predicates'?
+ */
+bool
+columnar_chunk_refuted(Relation rel, StripeDesc *stripe, int chunk,
+					   List *predicates, BufferAccessStrategy strategy)
+{
+	uint32		nrows = stripe->chunks[chunk].nrows;
+	ListCell   *lc;
+
+	foreach(lc, predicates)
+	{
+		ChunkPredicate *pred = (ChunkPredicate *) lfirst(lc);
+		Form_pg_attribute att = TupleDescAttr(RelationGetDescr(rel),
+											  pred->attno - 1);
+		ChunkColumnInfo *info;
+		Datum		min;
+		Datum		max;
+		bool		refuted = false;
+
+		/* columns added after the stripe was written have no metadata */
+		if (pred->attno > stripe->hdr.natts)
+			continue;
+		info = StripeChunkColumn(stripe, chunk, pred->attno);
+
+		if (pred->is_nulltest)
+		{
+			if (pred->isnull ? info->nnulls == 0 : info->nnulls == nrows)
+				return true;
+			continue;
+		}
+
+		/* btree operators are strict */
+		if (info->nnulls == nrows)
+			return true;
+		if (!info->has_minmax)
+			continue;
+
+		min = columnar_read_datum(rel, stripe, att, info->min_offset,
+								  info->min_len, strategy);
+		max = columnar_read_datum(rel, stripe, att, info->max_offset,
+								  info->max_len, strategy);
+
+#define CMP(a, b) \
+		DatumGetInt32(FunctionCall2Coll(pred->cmp, pred->collation, (a), (b)))
+
+		switch (pred->strategy)
+		{
+			case BTLessStrategyNumber:
+				refuted = CMP(min, pred->value) >= 0;
+				break;
+			case BTLessEqualStrategyNumber:
+				refuted = CMP(min, pred->value) > 0;
+				break;
+			case BTEqualStrategyNumber:
+				refuted = CMP(min, pred->value) > 0 ||
+					CMP(max, pred->value) < 0;
+				break;
+			case BTGreaterEqualStrategyNumber:
+				refuted = CMP(max, pred->value) < 0;
+				break;
+			case BTGreaterStrategyNumber:
+				refuted = CMP(max, pred->value) <= 0;
+				break;
+		}
+
+#undef CMP
+
+		if (refuted)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Read a min/max value stored in a stripe.
+ */
+static Datum
+columnar_read_datum(Relation rel, StripeDesc *stripe, Form_pg_attribute att,
+					uint64 offset, uint32 len, BufferAccessStrategy strategy)
+{
+	char	   *buf;
+
+	if (offset + len > stripe->hdr.length)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid chunk metadata in stripe at block %u of relation \"%s\"",
+						stripe->start, RelationGetRelationName(rel))));
+
+	buf = palloc(Max(len, sizeof(Datum)));
+	columnar_read_stream(rel, stripe->start, offset, buf, len, strategy);
+
+	return fetch_att(buf, att->attbyval, att->attlen);
+}
+
+/*
+ * Decode the columns of the given chunk that 'needed' asks for (all of them
+ * if it's NULL) into 'columns', one per attribute of the relation.  Columns
+ * that aren't decoded get NULL values arrays.
+ */
+void
+columnar_load_chunk(Relation rel, StripeDesc *stripe, int chunk,
+					bool *needed, ChunkColumn *columns,
+					BufferAccessStrategy strategy)
+{
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	uint32		nrows = stripe->chunks[chunk].nrows;
+
+	for (int i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+
+		columns[i].values = NULL;
+		columns[i].nulls = NULL;
+
+		if ((needed != NULL && !needed[i]) || i >= stripe->hdr.natts ||
+			att->attisdropped)
+			continue;
+
+		columnar_decode_column(rel, stripe, att,
+							   StripeChunkColumn(stripe, chunk, i + 1),
+							   nrows, &columns[i], strategy);
+	}
+}
+
+static void
+columnar_decode_column(Relation rel, StripeDesc *stripe,
+					   Form_pg_attribute att, ChunkColumnInfo *info,
+					   uint32 nrows, ChunkColumn *col,
+					   BufferAccessStrategy strategy)
+{
+	char	   *stored;
+	char	   *raw;
+	char	   *bitmap = NULL;
+	Size		off = 0;
+
+	if (info->data_offset + info->data_len > stripe->hdr.length)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid chunk metadata in stripe at block %u of relation \"%s\"",
+						stripe->start, RelationGetRelationName(rel))));
+
+	stored = MemoryContextAllocHuge(CurrentMemoryContext, info->data_len);
+	columnar_read_stream(rel, stripe->start, info->data_offset, stored,
+						 info->data_len, strategy);
+	if (info->compression == COLUMNAR_COMPRESSION_NONE &&
+		info->data_len == info->raw_len)
+		raw = stored;
+	else
+	{
+		raw = MemoryContextAllocHuge(CurrentMemoryContext, info->raw_len);
+		columnar_decompress(info->compression, stored, info->data_len,
+							raw, info->raw_len);
+		pfree(stored);
+	}
+
+	col->values = palloc(nrows * sizeof(Datum));
+	col->nulls = palloc(nrows * sizeof(bool));
+
+	if (info->nnulls > 0)
+	{
+		bitmap = raw;
+		off = MAXALIGN((nrows + 7) / 8);
+	}
+
+	for (uint32 r = 0; r < nrows; r++)
+	{
+		char	   *ptr;
+
+		if (bitmap != NULL && (bitmap[r / 8] & (1 << (r % 8))))
+		{
+			col->values[r] = (Datum) 0;
+			col->nulls[r] = true;
+			continue;
+		}
+
+		off = att_align_nominal(off, att->attalign);
+		ptr = raw + off;
+		if (off >= info->raw_len ||
+			(att->attlen > 0 && off + att->attlen > info->raw_len) ||
+			(att->attlen == -1 && off + VARSIZE(ptr) > info->raw_len))
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("invalid column data in stripe at block %u of relation \"%s\"",
+							stripe->start, RelationGetRelationName(rel))));
+
+		col->values[r] = fetch_att(ptr, att->attbyval, att->attlen);
+		col->nulls[r] = false;
+		off = att_addlength_pointer(off, att->attlen, ptr);
+	}
+}
+
+/*
+ * Store row 'row' of the loaded chunk in 'slot', as a virtual tuple pointing
+ * into the decoded data.  Columns that weren't loaded are NULL, except for
+ * those added to the table after the stripe was written, which get their
+ * "missing" default.
+ */
+void
+columnar_fill_slot(Relation rel, StripeDesc *stripe, ChunkColumn *columns,
+				   bool *needed, uint32 row, TupleTableSlot *slot)
+{
+	TupleDesc	tupdesc = slot->tts_tupleDescriptor;
+
+	ExecClearTuple(slot);
+
+	for (int i = 0; i < tupdesc->natts; i++)
+	{
+		if (columns[i].values != NULL)
+		{
+			slot->tts_values[i] = columns[i].values[row];
+			slot->tts_isnull[i] = columns[i].nulls[row];
+		}
+		else if (i >= stripe->hdr.natts && (needed == NULL || needed[i]))
+			slot->tts_values[i] = getmissingattr(tupdesc, i + 1,
+												 &slot->tts_isnull[i]);
+		else
+		{
+			slot->tts_values[i] = (Datum) 0;
+			slot->tts_isnull[i] = true;
+		}
+	}
+
+	ExecStoreVirtualTuple(slot);
+}
+
+/*
+ * Look for the row with 'tid' in the stripes of 'rel', and store it in 'slot'
+ * if it is visible to 'snapshot'.
+ *
+ * Stripes aren't ordered by row number, so this has to look at the headers
+ * of all of them, which is slow for large tables.
+ */
+bool
+columnar_fetch_row(Relation rel, ItemPointer tid, Snapshot snapshot,
+				   TupleTableSlot *slot)
+{
+	uint64		rownum = columnar_tid_to_rownum(tid);
+	BlockNumber nblocks = RelationGetNumberOfBlocks(rel);
+	BlockNumber blkno = COLUMNAR_METAPAGE_BLKNO + 1;
+	bool		found = false;
+	bool		visible = false;
+	MemoryContext cxt;
+	MemoryContext oldcxt;
+
+	cxt = AllocSetContextCreate(CurrentMemoryContext,
+								"columnar fetch",
+								ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(cxt);
+
+	while (blkno < nblocks && !found)
+	{
+		StripeHeader hdr;
+		StripeDesc	stripe;
+		BlockNumber start = blkno;
+
+		if (!columnar_read_stripe_header(rel, start, nblocks, &hdr, &blkno,
+										 NULL))
+			continue;
+
+		columnar_load_stripe(rel, start, &hdr, &stripe, NULL);
+		for (uint32 c = 0; c < hdr.nchunks; c++)
+		{
+			ChunkHeader *chunk = &stripe.chunks[c];
+			ChunkColumn *columns;
+
+			if (rownum < chunk->first_rownum ||
+				rownum >= chunk->first_rownum + chunk->nrows)
+				continue;
+
+			found = true;
+			if (columnar_stripe_visible(&hdr, snapshot))
+			{
+				columns = palloc(RelationGetDescr(rel)->natts *
+								 sizeof(ChunkColumn));
+				columnar_load_chunk(rel, &stripe, c, NULL, columns, NULL);
+				columnar_fill_slot(rel, &stripe, columns, NULL,
+								   rownum - chunk->first_rownum, slot);
+				ExecMaterializeSlot(slot);
+				slot->tts_tid = *tid;
+				slot->tts_tableOid = RelationGetRelid(rel);
+				visible = true;
+			}
+			break;
+		}
+		MemoryContextReset(cxt);
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(cxt);
+
+	return visible;
+}
@@ -0,0 +1,511 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_storage.c
+ *	  Page-level storage of columnar tables
+ *
+ * All changes to the pages are WAL-logged with generic WAL records, so that
+ * no resource manager is needed.  Stripes are only ever appended, under the
+ * relation extension lock so that their blocks are contiguous, and are never
+ * changed afterwards except for the flags in their header.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar_storage.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "access/generic_xlog.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "columnar.h"
+#include "common/pg_lzcompress.h"
+#include "storage/bufmgr.h"
+#include "storage/lmgr.h"
+#include "storage/procarray.h"
+#include "utils/snapmgr.h"
+
+static void columnar_init_page(Page page, uint16 flags);
+static void columnar_fill_page(Page page, uint16 flags, char *data,
+							   uint32 len, uint32 pageno);
+static void columnar_init_metapage(Relation rel);
+static ColumnarMetapage *columnar_get_metapage(Relation rel, Page page);
+
+
+/*
+ * Initialize a page of any kind.
+ */
+static void
+columnar_init_page(Page page, uint16 flags)
+{
+	ColumnarPageOpaque opaque;
+
+	PageInit(page, BLCKSZ, sizeof(ColumnarPageOpaqueData));
+	opaque = ColumnarPageGetOpaque(page);
+	opaque->flags = flags;
+	opaque->page_id = COLUMNAR_PAGE_ID;
+}
+
+/*
+ * Initialize a page of a stripe, and copy its part of the stripe's byte
+ * stream into it.
+ */
+static void
+columnar_fill_page(Page page, uint16 flags, char *data, uint32 len,
+				   uint32 pageno)
+{
+	uint32		offset = pageno * COLUMNAR_PAGE_PAYLOAD;
+	uint32		n = Min(COLUMNAR_PAGE_PAYLOAD, len - offset);
+
+	columnar_init_page(page, flags);
+	memcpy(PageGetContents(page), data + offset, n);
+	((PageHeader) page)->pd_lower = (PageGetContents(page) - (char *) page) + n;
+}
+
+/*
+ * Create the metapage, if nobody has done so yet.
+ */
+static void
+columnar_init_metapage(Relation rel)
+{
+	LockRelationForExtension(rel, ExclusiveLock);
+
+	if (RelationGetNumberOfBlocks(rel) == 0)
+	{
+		Buffer		buf;
+		GenericXLogState *state;
+		Page		page;
+		ColumnarMetapage *meta;
+
+		buf = ReadBuffer(rel, P_NEW);
+		Assert(BufferGetBlockNumber(buf) == COLUMNAR_METAPAGE_BLKNO);
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+
+		state = GenericXLogStart(rel);
+		page = GenericXLogRegisterBuffer(state, buf, GENERIC_XLOG_FULL_IMAGE);
+		columnar_init_page(page, COLUMNAR_PAGE_META);
+		meta = (ColumnarMetapage *) PageGetContents(page);
+		meta->magic = COLUMNAR_MAGIC;
+		meta->version = COLUMNAR_VERSION;
+		meta->next_rownum = 0;
+		((PageHeader) page)->pd_lower =
+			((char *) meta + sizeof(ColumnarMetapage)) - (char *) page;
+		GenericXLogFinish(state);
+
+		UnlockReleaseBuffer(buf);
+	}
+
+	UnlockRelationForExtension(rel, ExclusiveLock);
+}
+
+static ColumnarMetapage *
+columnar_get_metapage(Relation rel, Page page)
+{
+	ColumnarMetapage *meta = (ColumnarMetapage *) PageGetContents(page);
+
+	if (PageIsNew(page) ||
+		!(ColumnarPageGetOpaque(page)->flags & COLUMNAR_PAGE_META) ||
+		meta->magic != COLUMNAR_MAGIC)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("\"%s\" is not a columnar table",
+						RelationGetRelationName(rel))));
+	if (meta->version != COLUMNAR_VERSION)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("columnar table \"%s\" has wrong version: %u, expected %u",
+						RelationGetRelationName(rel),
+						meta->version, COLUMNAR_VERSION)));
+
+	return meta;
+}
+
+/*
+ * Reserve 'nrows' consecutive row numbers, and return the first one.
+ */
+uint64
+columnar_reserve_rownums(Relation rel, uint64 nrows)
+{
+	Buffer		buf;
+	GenericXLogState *state;
+	ColumnarMetapage *meta;
+	uint64		first;
+
+	if (RelationGetNumberOfBlocks(rel) == 0)
+		columnar_init_metapage(rel);
+
+	buf = ReadBuffer(rel, COLUMNAR_METAPAGE_BLKNO);
+	LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+
+	state = GenericXLogStart(rel);
+	meta = columnar_get_metapage(rel, GenericXLogRegisterBuffer(state, buf, 0));
+	first = meta->next_rownum;
+	if (nrows > COLUMNAR_MAX_ROWNUM - first)
+	{
+		GenericXLogAbort(state);
+		UnlockReleaseBuffer(buf);
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("cannot add more rows to columnar table \"%s\"",
+						RelationGetRelationName(rel))));
+	}
+	meta->next_rownum = first + nrows;
+	GenericXLogFinish(state);
+
+	UnlockReleaseBuffer(buf);
+
+	return first;
+}
+
+/*
+ * Return the first row number not reserved yet.
+ */
+uint64
+columnar_get_next_rownum(Relation rel)
+{
+	Buffer		buf;
+	uint64		next;
+
+	if (RelationGetNumberOfBlocks(rel) == 0)
+		return 0;
+
+	buf = ReadBuffer(rel, COLUMNAR_METAPAGE_BLKNO);
+	LockBuffer(buf, BUFFER_LOCK_SHARE);
+	next = columnar_get_metapage(rel, BufferGetPage(buf))->next_rownum;
+	UnlockReleaseBuffer(buf);
+
+	return next;
+}
+
+/*
+ * Append a stripe, given as its byte stream, to the relation.  The stream
+ * starts with the StripeHeader, whose nblocks we fill in.  Returns the first
+ * block of the stripe.
+ */
+BlockNumber
+columnar_write_stripe(Relation rel, char *data, uint32 len)
+{
+	uint32		nblocks = (len + COLUMNAR_PAGE_PAYLOAD - 1) / COLUMNAR_PAGE_PAYLOAD;
+	Buffer		first;
+	BlockNumber start;
+	GenericXLogState *state;
+
+	Assert(len >= sizeof(StripeHeader));
+	((StripeHeader *) data)->nblocks = nblocks;
+
+	LockRelationForExtension(rel, ExclusiveLock);
+
+	/*
+	 * Allocate the first block, but only fill it in after all the others, so
+	 * that the stripe doesn't become visible to readers half-written.
+	 */
+	first = ReadBuffer(rel, P_NEW);
+	start = BufferGetBlockNumber(first);
+	Assert(start != COLUMNAR_METAPAGE_BLKNO);
+	LockBuffer(first, BUFFER_LOCK_EXCLUSIVE);
+
+	for (uint32 i = 1; i < nblocks; i += MAX_GENERIC_XLOG_PAGES)
+	{
+		Buffer		bufs[MAX_GENERIC_XLOG_PAGES];
+		int			n = Min(MAX_GENERIC_XLOG_PAGES, nblocks - i);
+
+		state = GenericXLogStart(rel);
+		for (int j = 0; j < n; j++)
+		{
+			bufs[j] = ReadBuffer(rel, P_NEW);
+			LockBuffer(bufs[j], BUFFER_LOCK_EXCLUSIVE);
+			columnar_fill_page(GenericXLogRegisterBuffer(state, bufs[j],
+														 GENERIC_XLOG_FULL_IMAGE),
+							   COLUMNAR_PAGE_STRIPE_CONT, data, len, i + j);
+		}
+		GenericXLogFinish(state);
+
+		for (int j = 0; j < n; j++)
+			UnlockReleaseBuffer(bufs[j]);
+	}
+
+	state = GenericXLogStart(rel);
+	columnar_fill_page(GenericXLogRegisterBuffer(state, first,
+												 GENERIC_XLOG_FULL_IMAGE),
+					   COLUMNAR_PAGE_STRIPE_START, data, len, 0);
+	GenericXLogFinish(state);
+	UnlockReleaseBuffer(first);
+
+	UnlockRelationForExtension(rel, ExclusiveLock);
+
+	return start;
+}
+
+/*
+ * Read 'len' bytes at 'offset' of the byte stream of the stripe starting at
+ * block 'start'.
+ */
+void
+columnar_read_stream(Relation rel, BlockNumber start, uint64 offset,
+					 char *dest, Size len, BufferAccessStrategy strategy)
+{
+	while (len > 0)
+	{
+		BlockNumber blkno = start + offset / COLUMNAR_PAGE_PAYLOAD;
+		uint32		pageoff = offset % COLUMNAR_PAGE_PAYLOAD;
+		Size		n = Min(len, COLUMNAR_PAGE_PAYLOAD - pageoff);
+		Buffer		buf;
+
+		buf = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+								 strategy);
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		memcpy(dest, PageGetContents(BufferGetPage(buf)) + pageoff, n);
+		UnlockReleaseBuffer(buf);
+
+		dest += n;
+		offset += n;
+		len -= n;
+	}
+}
+
+/*
+ * Read the header of the stripe starting at 'blkno', if one does.  Only
+ * stripes that lie entirely below 'nblocks' are considered.
+ *
+ * *next is set to the block to look at next; anything that isn't the start
+ * of a complete stripe is skipped one block at a time.
+ */
+bool
+columnar_read_stripe_header(Relation rel, BlockNumber blkno,
+							BlockNumber nblocks, StripeHeader *hdr,
+							BlockNumber *next, BufferAccessStrategy strategy)
+{
+	Buffer		buf;
+	Page		page;
+	bool		found = false;
+
+	Assert(blkno < nblocks);
+
+	buf = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL, strategy);
+	LockBuffer(buf, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(buf);
+
+	*next = blkno + 1;
+	if (!PageIsNew(page) &&
+		(ColumnarPageGetOpaque(page)->flags & COLUMNAR_PAGE_STRIPE_START))
+	{
+		memcpy(hdr, PageGetContents(page), sizeof(StripeHeader));
+		if (hdr->magic != COLUMNAR_STRIPE_MAGIC || hdr->nblocks == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("invalid stripe header in block %u of relation \"%s\"",
+							blkno, RelationGetRelationName(rel))));
+		if (hdr->nblocks <= nblocks - blkno)
+		{
+			found = true;
+			*next = blkno + hdr->nblocks;
+		}
+	}
+
+	UnlockReleaseBuffer(buf);
+
+	return found;
+}
+
+/*
+ * Fill in 'stripe' for the stripe starting at block 'start', with the given
+ * header.  The chunk and column metadata is read into CurrentMemoryContext.
+ */
+void
+columnar_load_stripe(Relation rel, BlockNumber start, StripeHeader *hdr,
+					 StripeDesc *stripe, BufferAccessStrategy strategy)
+{
+	Size		chunks_len = (Size) hdr->nchunks * sizeof(ChunkHeader);
+	Size		infos_len = (Size) hdr->nchunks * hdr->natts * sizeof(ChunkColumnInfo);
+	char	   *buf;
+
+	if (StripeInfosOffset(hdr->nchunks) + infos_len > hdr->length)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid stripe header in block %u of relation \"%s\"",
+						start, RelationGetRelationName(rel))));
+
+	buf = palloc(chunks_len + infos_len);
+	columnar_read_stream(rel, start, StripeChunksOffset(), buf,
+						 chunks_len + infos_len, strategy);
+
+	stripe->start = start;
+	stripe->hdr = *hdr;
+	stripe->chunks = (ChunkHeader *) buf;
+	stripe->infos = (ChunkColumnInfo *) (buf + chunks_len);
+}
+
+/*
+ * Add 'flags' to the header of the stripe starting at 'blkno'.
+ */
+void
+columnar_set_stripe_flags(Relation rel, BlockNumber blkno, uint16 flags)
+{
+	Buffer		buf;
+	GenericXLogState *state;
+	StripeHeader *hdr;
+
+	buf = ReadBuffer(rel, blkno);
+	LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+
+	state = GenericXLogStart(rel);
+	hdr = (StripeHeader *) PageGetContents(GenericXLogRegisterBuffer(state, buf, 0));
+	Assert(hdr->magic == COLUMNAR_STRIPE_MAGIC);
+	hdr->flags |= flags;
+	GenericXLogFinish(state);
+
+	UnlockReleaseBuffer(buf);
+}
+
+/*
+ * Are the rows of a stripe visible to 'snapshot'?
+ *
+ * All rows of a stripe were inserted by the same (sub)transaction and
+ * command, and are never updated or deleted, so this is much simpler than
+ * HeapTupleSatisfiesVisibility.
+ */
+bool
+columnar_stripe_visible(StripeHeader *hdr, Snapshot snapshot)
+{
+	if (hdr->flags & STRIPE_DEAD)
+		return false;
+	if (snapshot->snapshot_type == SNAPSHOT_ANY ||
+		(hdr->flags & STRIPE_FROZEN))
+		return true;
+
+	if (TransactionIdIsCurrentTransactionId(hdr->xmin))
+	{
+		if (snapshot->snapshot_type == SNAPSHOT_MVCC)
+			return hdr->cid < snapshot->curcid;
+		return true;
+	}
+
+	if (snapshot->snapshot_type == SNAPSHOT_MVCC)
+	{
+		if (XidInMVCCSnapshot(hdr->xmin, snapshot))
+			return false;
+	}
+	else if (TransactionIdIsInProgress(hdr->xmin))
+		return false;
+
+	return TransactionIdDidCommit(hdr->xmin);
+}
+
+/*
+ * Compress 'len' bytes at 'src' with the method selected by
+ * columnar.compression.  If that doesn't make the data smaller, 'src' itself
+ * is returned, with *method set to COLUMNAR_COMPRESSION_NONE.
+ */
+char *
+columnar_compress(char *src, uint32 len, uint32 *outlen, uint8 *method)
+{
+	char	   *dest = NULL;
+	int32		n = -1;
+
+	switch ((ColumnarCompression) columnar_compression)
+	{
+		case COLUMNAR_COMPRESSION_NONE:
+			break;
+		case COLUMNAR_COMPRESSION_PGLZ:
+			dest = palloc(PGLZ_MAX_OUTPUT(len));
+			n = pglz_compress(src, len, dest, PGLZ_strategy_default);
+			break;
+		case COLUMNAR_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			{
+				int			bound = LZ4_compressBound(len);
+
+				dest = palloc(bound);
+				n = LZ4_compress_default(src, dest, len, bound);
+				if (n <= 0)
+					n = -1;
+			}
+#endif
+			break;
+		case COLUMNAR_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		bound = ZSTD_compressBound(len);
+				size_t		r;
+
+				dest = palloc(bound);
+				r = ZSTD_compress(dest, bound, src, len, ZSTD_CLEVEL_DEFAULT);
+				n = ZSTD_isError(r) ? -1 : (int32) r;
+			}
+#endif
+			break;
+	}
+
+	if (n < 0 || (uint32) n >= len)
+	{
+		if (dest)
+			pfree(dest);
+		*outlen = len;
+		*method = COLUMNAR_COMPRESSION_NONE;
+		return src;
+	}
+
+	*outlen = n;
+	*method = columnar_compression;
+	return dest;
+}
+
+/*
+ * Decompress 'len' bytes at 'src' into the 'rawlen' bytes at 'dest'.
+ */
+void
+columnar_decompress(uint8 method, char *src, uint32 len, char *dest,
+					uint32 rawlen)
+{
+	bool		ok = false;
+
+	switch ((ColumnarCompression) method)
+	{
+		case COLUMNAR_COMPRESSION_NONE:
+			ok = (len == rawlen);
+			if (ok)
+				memcpy(dest, src, len);
+			break;
+		case COLUMNAR_COMPRESSION_PGLZ:
+			ok = (pglz_decompress(src, len, dest, rawlen, true) == rawlen);
+			break;
+		case COLUMNAR_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			ok = (LZ4_decompress_safe(src, dest, len, rawlen) == rawlen);
+#else
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("compression method lz4 not supported"),
+					 errdetail("This functionality requires the server to be built with lz4 support.")));
+#endif
+			break;
+		case COLUMNAR_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		r = ZSTD_decompress(dest, rawlen, src, len);
+
+				ok = (!ZSTD_isError(r) && r == rawlen);
+			}
+#else
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("compression method zstd not supported"),
+					 errdetail("This functionality requires the server to be built with zstd support.")));
+#endif
+			break;
+	}
+
+	if (!ok)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed columnar data is corrupt")));
+}
@@ -0,0 +1,628 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_writer.c
+ *	  Buffering of inserted rows, and writing them out as stripes
+ *
+ * Inserted rows are collected in memory, per relation, until a stripe's
+ * worth has accumulated or something needs to see them on disk: the end of
+ * the (sub)transaction or command that inserted them, a scan of the
+ * relation, or an operation that works on its storage directly.  Only the
+ * rows of one (sub)transaction and command are ever kept for a relation,
+ * since a stripe is either visible or invisible as a whole.
+ *
+ * Row numbers, and so TIDs, are handed out as the rows arrive, so that the
+ * executor can use them right away, e.g. to queue AFTER triggers.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar_writer.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/detoast.h"
+#include "access/htup_details.h"
+#include "access/xact.h"
+#include "columnar.h"
+#include "executor/tuptable.h"
+#include "lib/stringinfo.h"
+#include "utils/datum.h"
+#include "utils/memutils.h"
+#include "utils/typcache.h"
+
+/* Write out the pending rows once they take up this much memory */
+#define COLUMNAR_MAX_PENDING_BYTES	(64 * 1024 * 1024)
+
+/* Row numbers are reserved at least this many at a time */
+#define COLUMNAR_MIN_CHUNK_ROWS		16
+
+typedef struct PendingRows
+{
+	Oid			relid;
+	SubTransactionId subid;
+	TransactionId xid;
+	CommandId	cid;
+	MemoryContext cxt;			/* holds this struct and the rows */
+	TupleDesc	tupdesc;
+
+	uint32		nrows;
+	uint32		maxrows;
+	Size		nbytes;			/* memory used by the rows' values */
+	Datum	   *values;			/* nrows * natts */
+	bool	   *nulls;
+
+	ChunkHeader *chunks;
+	uint32		nchunks;
+	uint32		maxchunks;
+	uint32		chunk_reserved; /* row numbers reserved for the last chunk */
+} PendingRows;
+
+/* All PendingRows of the current transaction, in pending_cxt */
+static List *pending_list = NIL;
+static MemoryContext pending_cxt = NULL;
+
+static PendingRows *columnar_find_pending(Oid relid);
+static PendingRows *columnar_get_pending(Relation rel, CommandId cid);
+static void columnar_flush_entry(PendingRows *pending);
+static void columnar_discard_entry(PendingRows *pending);
+static void columnar_write_rows(Relation rel, PendingRows *pending);
+static void columnar_encode_column(PendingRows *pending, int attidx,
+								   uint32 first, uint32 nrows,
+								   ChunkColumnInfo *info, StringInfo minmax,
+								   StringInfo data);
+static Size columnar_append_value(StringInfo buf, Form_pg_attribute att,
+								  Datum value);
+static void columnar_xact_callback(XactEvent event, void *arg);
+static void columnar_subxact_callback(SubXactEvent event,
+									  SubTransactionId mySubid,
+									  SubTransactionId parentSubid,
+									  void *arg);
+
+
+static PendingRows *
+columnar_find_pending(Oid relid)
+{
+	ListCell   *lc;
+
+	foreach(lc, pending_list)
+	{
+		PendingRows *pending = (PendingRows *) lfirst(lc);
+
+		if (pending->relid == relid)
+			return pending;
+	}
+
+	return NULL;
+}
+
+/*
+ * Return the PendingRows that rows inserted into 'rel' by command 'cid' of
+ * the current subtransaction go into, writing out any other rows pending
+ * for 'rel' first.
+ */
+static PendingRows *
+columnar_get_pending(Relation rel, CommandId cid)
+{
+	SubTransactionId subid = GetCurrentSubTransactionId();
+	PendingRows *pending = columnar_find_pending(RelationGetRelid(rel));
+	MemoryContext cxt;
+	MemoryContext oldcxt;
+
+	if (pending != NULL &&
+		(pending->subid != subid || pending->cid != cid ||
+		 pending->nrows >= columnar_stripe_row_limit ||
+		 pending->nbytes >= COLUMNAR_MAX_PENDING_BYTES))
+	{
+		columnar_flush_entry(pending);
+		pending = NULL;
+	}
+
+	if (pending != NULL)
+		return pending;
+
+	if (pending_cxt == NULL)
+		pending_cxt = AllocSetContextCreate(TopTransactionContext,
+											"columnar pending rows",
+											ALLOCSET_DEFAULT_SIZES);
+
+	cxt = AllocSetContextCreate(pending_cxt, "columnar pending stripe",
+								ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(cxt);
+
+	pending = palloc0(sizeof(PendingRows));
+	pending->relid = RelationGetRelid(rel);
+	pending->subid = subid;
+	pending->xid = GetCurrentTransactionId();
+	pending->cid = cid;
+	pending->cxt = cxt;
+	pending->tupdesc = CreateTupleDescCopy(RelationGetDescr(rel));
+	pending->maxrows = 64;
+	pending->values = palloc(pending->maxrows * pending->tupdesc->natts *
+							 sizeof(Datum));
+	pending->nulls = palloc(pending->maxrows * pending->tupdesc->natts *
+							sizeof(bool));
+	pending->maxchunks = 8;
+	pending->chunks = palloc(pending->maxchunks * sizeof(ChunkHeader));
+
+	MemoryContextSwitchTo(pending_cxt);
+	pending_list = lappend(pending_list, pending);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return pending;
+}
+
+/*
+ * Add the row in 'slot' to the rows pending for 'rel', and set its TID.
+ */
+void
+columnar_insert_row(Relation rel, TupleTableSlot *slot, CommandId cid)
+{
+	PendingRows *pending = columnar_get_pending(rel, cid);
+	int			natts = pending->tupdesc->natts;
+	ChunkHeader *chunk;
+	Datum	   *values;
+	bool	   *nulls;
+	MemoryContext oldcxt;
+
+	slot_getallattrs(slot);
+
+	oldcxt = MemoryContextSwitchTo(pending->cxt);
+
+	if (pending->nrows == pending->maxrows)
+	{
+		pending->maxrows *= 2;
+		pending->values = repalloc_huge(pending->values,
+										(Size) pending->maxrows * natts *
+										sizeof(Datum));
+		pending->nulls = repalloc_huge(pending->nulls,
+									   (Size) pending->maxrows * natts *
+									   sizeof(bool));
+	}
+
+	/*
+	 * Start a new chunk once the last one has used up its row numbers.  We
+	 * reserve more of them the more rows have come in, so that single-row
+	 * inserts don't waste many.
+	 */
+	chunk = pending->nchunks > 0 ? &pending->chunks[pending->nchunks - 1] : NULL;
+	if (chunk == NULL || chunk->nrows == pending->chunk_reserved)
+	{
+		uint32		reserve;
+
+		if (pending->nchunks == pending->maxchunks)
+		{
+			pending->maxchunks *= 2;
+			pending->chunks = repalloc(pending->chunks,
+									   pending->maxchunks * sizeof(ChunkHeader));
+		}
+
+		reserve = Max(pending->nrows, COLUMNAR_MIN_CHUNK_ROWS);
+		reserve = Min(reserve, columnar_chunk_row_limit);
+		reserve = Min(reserve, columnar_stripe_row_limit - pending->nrows);
+
+		chunk = &pending->chunks[pending->nchunks++];
+		chunk->first_rownum = columnar_reserve_rownums(rel, reserve);
+		chunk->nrows = 0;
+		chunk->pad = 0;
+		pending->chunk_reserved = reserve;
+	}
+
+	/* Store a flat, uncompressed copy of each value */
+	values = &pending->values[(Size) pending->nrows * natts];
+	nulls = &pending->nulls[(Size) pending->nrows * natts];
+	for (int i = 0; i < natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(pending->tupdesc, i);
+		Datum		value = slot->tts_values[i];
+
+		nulls[i] = slot->tts_isnull[i];
+		if (nulls[i])
+		{
+			values[i] = (Datum) 0;
+			continue;
+		}
+
+		if (att->attlen == -1 && VARATT_IS_EXTENDED(DatumGetPointer(value)))
+			value = PointerGetDatum(detoast_attr((struct varlena *)
+												 DatumGetPointer(value)));
+		else
+			value = datumCopy(value, att->attbyval, att->attlen);
+		values[i] = value;
+
+		if (!att->attbyval)
+			pending->nbytes += datumGetSize(value, false, att->attlen);
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	columnar_rownum_to_tid(chunk->first_rownum + chunk->nrows, &slot->tts_tid);
+	slot->tts_tableOid = RelationGetRelid(rel);
+
+	chunk->nrows++;
+	pending->nrows++;
+}
+
+/*
+ * Write out the rows pending for 'rel', if any.
+ */
+void
+columnar_flush_pending(Relation rel)
+{
+	PendingRows *pending = columnar_find_pending(RelationGetRelid(rel));
+
+	if (pending != NULL)
+		columnar_flush_entry(pending);
+}
+
+/*
+ * Look for the row with 'tid' among the rows pending for 'rel', and store it
+ * in 'slot' if it is visible to 'snapshot'.
+ */
+bool
+columnar_fetch_pending(Relation rel, ItemPointer tid, Snapshot snapshot,
+					   TupleTableSlot *slot)
+{
+	PendingRows *pending = columnar_find_pending(RelationGetRelid(rel));
+	uint64		rownum = columnar_tid_to_rownum(tid);
+	uint32		row = 0;
+
+	if (pending == NULL ||
+		(snapshot->snapshot_type == SNAPSHOT_MVCC &&
+		 pending->cid >= snapshot->curcid))
+		return false;
+
+	for (uint32 c = 0; c < pending->nchunks; c++)
+	{
+		ChunkHeader *chunk = &pending->chunks[c];
+
+		if (rownum >= chunk->first_rownum &&
+			rownum < chunk->first_rownum + chunk->nrows)
+		{
+			TupleDesc	tupdesc = slot->tts_tupleDescriptor;
+			int			natts = pending->tupdesc->natts;
+			Size		base;
+
+			row += rownum - chunk->first_rownum;
+			base = (Size) row * natts;
+
+			ExecClearTuple(slot);
+			for (int i = 0; i < tupdesc->natts; i++)
+			{
+				if (i < natts)
+				{
+					slot->tts_values[i] = pending->values[base + i];
+					slot->tts_isnull[i] = pending->nulls[base + i];
+				}
+				else
+					slot->tts_values[i] = getmissingattr(tupdesc, i + 1,
+														 &slot->tts_isnull[i]);
+			}
+			ExecStoreVirtualTuple(slot);
+			ExecMaterializeSlot(slot);
+			slot->tts_tid = *tid;
+			slot->tts_tableOid = RelationGetRelid(rel);
+			return true;
+		}
+		row += chunk->nrows;
+	}
+
+	return false;
+}
+
+/*
+ * Write a PendingRows out as a stripe, and get rid of it.
+ */
+static void
+columnar_flush_entry(PendingRows *pending)
+{
+	pending_list = list_delete_ptr(pending_list, pending);
+
+	if (pending->nrows > 0)
+	{
+		Relation	rel = RelationIdGetRelation(pending->relid);
+
+		/* nothing to do if the relation has been dropped meanwhile */
+		if (RelationIsValid(rel))
+		{
+			columnar_write_rows(rel, pending);
+			RelationClose(rel);
+		}
+	}
+
+	MemoryContextDelete(pending->cxt);
+}
+
+static void
+columnar_discard_entry(PendingRows *pending)
+{
+	pending_list = list_delete_ptr(pending_list, pending);
+	MemoryContextDelete(pending->cxt);
+}
+
+/*
+ * Build the byte stream of a stripe holding the pending rows, and append it
+ * to 'rel'.
+ */
+static void
+columnar_write_rows(Relation rel, PendingRows *pending)
+{
+	int			natts = pending->tupdesc->natts;
+	uint32		nchunks = pending->nchunks;
+	Size		infos_len = (Size) nchunks * natts * sizeof(ChunkColumnInfo);
+	ChunkColumnInfo *infos;
+	StringInfoData minmax;
+	StringInfoData data;
+	StripeHeader *hdr;
+	Size		minmax_base;
+	Size		data_base;
+	Size		len;
+	char	   *stream;
+	uint32		row = 0;
+	MemoryContext tmpcxt;
+	MemoryContext oldcxt;
+
+	tmpcxt = AllocSetContextCreate(CurrentMemoryContext,
+								   "columnar stripe",
+								   ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(tmpcxt);
+
+	infos = palloc0(infos_len);
+	initStringInfo(&minmax);
+	initStringInfo(&data);
+
+	for (uint32 c = 0; c < nchunks; c++)
+	{
+		for (int i = 0; i < natts; i++)
+			columnar_encode_column(pending, i, row, pending->chunks[c].nrows,
+								   &infos[c * natts + i], &minmax, &data);
+		row += pending->chunks[c].nrows;
+	}
+	Assert(row == pending->nrows);
+
+	minmax_base = StripeInfosOffset(nchunks) + infos_len;
+	data_base = minmax_base + minmax.len;
+	len = data_base + data.len;
+	if (len > PG_UINT32_MAX)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("stripe of columnar table \"%s\" is too large",
+						RelationGetRelationName(rel))));
+
+	for (Size i = 0; i < (Size) nchunks * natts; i++)
+	{
+		infos[i].data_offset += data_base;
+		if (infos[i].has_minmax)
+		{
+			infos[i].min_offset += minmax_base;
+			infos[i].max_offset += minmax_base;
+		}
+	}
+
+	stream = MemoryContextAllocHuge(tmpcxt, len);
+	hdr = (StripeHeader *) stream;
+	memset(stream, 0, StripeChunksOffset());
+	hdr->magic = COLUMNAR_STRIPE_MAGIC;
+	hdr->flags = 0;
+	hdr->natts = natts;
+	hdr->xmin = pending->xid;
+	hdr->cid = pending->cid;
+	hdr->nblocks = 0;			/* filled in by columnar_write_stripe */
+	hdr->length = len;
+	hdr->nrows = pending->nrows;
+	hdr->nchunks = nchunks;
+	memcpy(stream + StripeChunksOffset(), pending->chunks,
+		   nchunks * sizeof(ChunkHeader));
+	memcpy(stream + StripeInfosOffset(nchunks), infos, infos_len);
+	memcpy(stream + minmax_base, minmax.data, minmax.len);
+	memcpy(stream + data_base, data.data, data.len);
+
+	columnar_write_stripe(rel, stream, len);
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(tmpcxt);
+}
+
+/*
+ * Encode one column of the 'nrows' pending rows starting at 'first', and
+ * append the result to 'data', and its min/max values to 'minmax'.  The
+ * offsets in *info are relative to those buffers.
+ *
+ * The uncompressed data consists of a null bitmap, if there are any nulls,
+ * followed by the non-null values laid out as in a tuple.
+ */
+static void
+columnar_encode_column(PendingRows *pending, int attidx, uint32 first,
+					   uint32 nrows, ChunkColumnInfo *info, StringInfo minmax,
+					   StringInfo data)
+{
+	Form_pg_attribute att = TupleDescAttr(pending->tupdesc, attidx);
+	int			natts = pending->tupdesc->natts;
+	TypeCacheEntry *typentry = NULL;
+	StringInfoData raw;
+	Datum		min = (Datum) 0;
+	Datum		max = (Datum) 0;
+	bool		have_minmax = false;
+	uint32		nnulls = 0;
+	char	   *compressed;
+	uint32		complen;
+	uint8		method;
+
+	for (uint32 r = 0; r < nrows; r++)
+	{
+		if (pending->nulls[(Size) (first + r) * natts + attidx])
+			nnulls++;
+	}
+
+	initStringInfo(&raw);
+	if (nnulls > 0)
+	{
+		int			bitmaplen = (nrows + 7) / 8;
+
+		enlargeStringInfo(&raw, bitmaplen);
+		memset(raw.data, 0, bitmaplen);
+		raw.len = bitmaplen;
+		for (uint32 r = 0; r < nrows; r++)
+		{
+			if (pending->nulls[(Size) (first + r) * natts + attidx])
+				raw.data[r / 8] |= 1 << (r % 8);
+		}
+		while (raw.len < MAXALIGN(bitmaplen))
+			appendStringInfoChar(&raw, '\0');
+	}
+
+	if (nnulls < nrows && !att->attisdropped)
+	{
+		typentry = lookup_type_cache(att->atttypid, TYPECACHE_CMP_PROC_FINFO);
+		if (!OidIsValid(typentry->cmp_proc_finfo.fn_oid))
+			typentry = NULL;
+	}
+
+	for (uint32 r = 0; r < nrows; r++)
+	{
+		Size		idx = (Size) (first + r) * natts + attidx;
+		Datum		value = pending->values[idx];
+
+		if (pending->nulls[idx])
+			continue;
+
+		columnar_append_value(&raw, att, value);
+
+		if (typentry == NULL)
+			continue;
+		if (!have_minmax)
+		{
+			min = max = value;
+			have_minmax = true;
+		}
+		else if (DatumGetInt32(FunctionCall2Coll(&typentry->cmp_proc_finfo,
+												 att->attcollation,
+												 value, min)) < 0)
+			min = value;
+		else if (DatumGetInt32(FunctionCall2Coll(&typentry->cmp_proc_finfo,
+												 att->attcollation,
+												 value, max)) > 0)
+			max = value;
+	}
+
+	compressed = columnar_compress(raw.data, raw.len, &complen, &method);
+
+	info->data_offset = data->len;
+	info->data_len = complen;
+	info->raw_len = raw.len;
+	info->nnulls = nnulls;
+	info->compression = method;
+	appendBinaryStringInfo(data, compressed, complen);
+
+	if (have_minmax &&
+		datumGetSize(min, att->attbyval, att->attlen) <= COLUMNAR_MAX_MINMAX_LEN &&
+		datumGetSize(max, att->attbyval, att->attlen) <= COLUMNAR_MAX_MINMAX_LEN)
+	{
+		info->has_minmax = true;
+		info->min_len = datumGetSize(min, att->attbyval, att->attlen);
+		info->min_offset = columnar_append_value(minmax, att, min);
+		info->max_len = datumGetSize(max, att->attbyval, att->attlen);
+		info->max_offset = columnar_append_value(minmax, att, max);
+	}
+
+	if (compressed != raw.data)
+		pfree(compressed);
+	pfree(raw.data);
+}
+
+/*
+ * Append 'value' to 'buf', aligned as it would be in a tuple, and return the
+ * offset it was stored at.
+ */
+static Size
+columnar_append_value(StringInfo buf, Form_pg_attribute att, Datum value)
+{
+	Size		len = datumGetSize(value, att->attbyval, att->attlen);
+	Size		offset = att_align_nominal(buf->len, att->attalign);
+
+	while (buf->len < offset)
+		appendStringInfoChar(buf, '\0');
+
+	enlargeStringInfo(buf, len);
+	if (att->attbyval)
+		store_att_byval(buf->data + buf->len, value, att->attlen);
+	else
+		memcpy(buf->data + buf->len, DatumGetPointer(value), len);
+	buf->len += len;
+	buf->data[buf->len] = '\0';
+
+	return offset;
+}
+
+/*
+ * Write out all pending rows at commit, and forget about them at the end of
+ * the transaction.  Their memory goes away with TopTransactionContext.
+ */
+static void
+columnar_xact_callback(XactEvent event, void *arg)
+{
+	switch (event)
+	{
+		case XACT_EVENT_PRE_COMMIT:
+		case XACT_EVENT_PARALLEL_PRE_COMMIT:
+		case XACT_EVENT_PRE_PREPARE:
+			while (pending_list != NIL)
+				columnar_flush_entry((PendingRows *) linitial(pending_list));
+			break;
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_PARALLEL_COMMIT:
+		case XACT_EVENT_ABORT:
+		case XACT_EVENT_PARALLEL_ABORT:
+		case XACT_EVENT_PREPARE:
+			pending_list = NIL;
+			pending_cxt = NULL;
+			break;
+	}
+}
+
+/*
+ * Write out the rows pending from a subtransaction when it commits, since
+ * they belong to its XID, and throw them away if it aborts.
+ */
+static void
+columnar_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+						  SubTransactionId parentSubid, void *arg)
+{
+	if (event != SUBXACT_EVENT_PRE_COMMIT_SUB &&
+		event != SUBXACT_EVENT_ABORT_SUB)
+		return;
+
+	for (;;)
+	{
+		PendingRows *found = NULL;
+		ListCell   *lc;
+
+		foreach(lc, pending_list)
+		{
+			PendingRows *pending = (PendingRows *) lfirst(lc);
+
+			if (pending->subid == mySubid)
+			{
+				found = pending;
+				break;
+			}
+		}
+
+		if (found == NULL)
+			break;
+
+		if (event == SUBXACT_EVENT_PRE_COMMIT_SUB)
+			columnar_flush_entry(found);
+		else
+			columnar_discard_entry(found);
+	}
+}
+
+void
+columnar_writer_init(void)
+{
+	RegisterXactCallback(columnar_xact_callback, NULL);
+	RegisterSubXactCallback(columnar_subxact_callback, NULL);
+}
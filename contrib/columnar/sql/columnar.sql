@@ -0,0 +1,38 @@
+CREATE EXTENSION columnar;
+
+CREATE TABLE col (a int, b text, c float8) USING columnar;
+INSERT INTO col SELECT i, 'row ' || i, i / 2.0 FROM generate_series(1, 25000) i;
+
+SELECT count(*), sum(a), min(b), max(c) FROM col;
+SELECT * FROM col WHERE a = 12345;
+SELECT count(*) FROM col WHERE a < 100;
+
+-- rows of aborted (sub)transactions are not visible
+BEGIN;
+INSERT INTO col VALUES (100000, 'gone', 0);
+ROLLBACK;
+BEGIN;
+INSERT INTO col VALUES (100001, 'kept', 0);
+SAVEPOINT s;
+INSERT INTO col VALUES (100002, 'gone', 0);
+ROLLBACK TO s;
+COMMIT;
+SELECT * FROM col WHERE a > 25000 ORDER BY a;
+
+-- columns added later
+ALTER TABLE col ADD COLUMN d int DEFAULT 7;
+INSERT INTO col VALUES (100003, NULL, 1, 8);
+SELECT * FROM col WHERE a > 25000 ORDER BY a;
+SELECT count(*) FROM col WHERE b IS NULL;
+
+-- unsupported operations
+UPDATE col SET b = 'x' WHERE a = 1;
+DELETE FROM col WHERE a = 1;
+CREATE INDEX ON col (a);
+
+VACUUM col;
+SELECT count(*) FROM col;
+TRUNCATE col;
+SELECT count(*) FROM col;
+
+DROP TABLE col;
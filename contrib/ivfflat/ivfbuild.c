@@ -0,0 +1,590 @@
+/*-------------------------------------------------------------------------
+ *
+ * ivfbuild.c
+ *		ivfflat index build functions.
+ *
+ * An index build makes two passes over the table.  The first takes a random
+ * sample of the vectors, and the lists' centroids are found by running
+ * k-means clustering on the sample.  The second assigns each vector to the
+ * list of its nearest centroid, and sorts the vectors by list so that each
+ * list can be written out as a chain of full pages.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/ivfflat/ivfbuild.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/generic_xlog.h"
+#include "access/tableam.h"
+#include "access/xloginsert.h"
+#include "catalog/index.h"
+#include "catalog/pg_operator.h"
+#include "catalog/pg_type.h"
+#include "executor/tuptable.h"
+#include "ivfflat.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "storage/smgr.h"
+#include "utils/float.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/sampling.h"
+#include "utils/tuplesort.h"
+
+/* Number of sampled vectors per list, and number of k-means iterations */
+#define IVF_SAMPLES_PER_LIST	50
+#define IVF_KMEANS_ITERATIONS	10
+
+/*
+ * State of ivfflat index build.
+ */
+typedef struct
+{
+	IvfState	state;			/* dimensions are set by the first vector */
+	int			lists;			/* number of lists asked for */
+	MemoryContext tmpCtx;		/* temporary memory context reset after each
+								 * tuple */
+
+	/* First pass: reservoir sample of the vectors */
+	float4	   *samples;
+	int			targsamples;
+	int			nsamples;
+	double		samplerows;		/* vectors seen so far */
+	double		rowstoskip;
+	ReservoirStateData rstate;
+
+	/* Result of clustering the sample: state.nlists vectors */
+	float4	   *centroids;
+
+	/* Second pass: vectors tagged with their list, sorted by list */
+	Tuplesortstate *sortstate;
+	TupleTableSlot *slot;
+	double		indtuples;		/* total number of tuples indexed */
+} IvfBuildState;
+
+/*
+ * Scale a vector to unit length, unless it is zero.
+ */
+static void
+normalizeVector(float4 *vec, int dim)
+{
+	float8		norm;
+
+	norm = sqrt(vector_inner_product_internal(vec, vec, dim));
+	if (norm > 0)
+	{
+		for (int i = 0; i < dim; i++)
+			vec[i] /= norm;
+	}
+}
+
+/*
+ * Per-tuple callback of the first pass: add the vector to the sample.
+ */
+static void
+ivfSampleCallback(Relation index, ItemPointer tid, Datum *values,
+				  bool *isnull, bool tupleIsAlive, void *state)
+{
+	IvfBuildState *buildstate = (IvfBuildState *) state;
+	MemoryContext oldCtx;
+	float4	   *vec;
+	int			dim;
+	int			k;
+
+	/* Vectors that are null are not indexed */
+	if (isnull[0])
+		return;
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	vec = IvfGetVector(&buildstate->state, values[0], &dim);
+
+	/*
+	 * The first vector fixes the number of dimensions, and with it how many
+	 * vectors fit in maintenance_work_mem.
+	 */
+	if (buildstate->state.dimensions == 0)
+	{
+		Size		maxsamples;
+
+		buildstate->state.dimensions = dim;
+		maxsamples = Min((Size) maintenance_work_mem * 1024,
+						 MaxAllocHugeSize) / (sizeof(float4) * dim);
+		buildstate->targsamples = (int) Min((Size) buildstate->lists * IVF_SAMPLES_PER_LIST,
+											maxsamples);
+		buildstate->targsamples = Max(buildstate->targsamples,
+									  buildstate->lists);
+		buildstate->samples =
+			MemoryContextAllocHuge(oldCtx,
+								   sizeof(float4) * dim * buildstate->targsamples);
+		reservoir_init_selection_state(&buildstate->rstate,
+									   buildstate->targsamples);
+		buildstate->rowstoskip = -1;
+	}
+
+	/* Algorithm Z, as in acquire_sample_rows() */
+	if (buildstate->nsamples < buildstate->targsamples)
+		k = buildstate->nsamples++;
+	else
+	{
+		if (buildstate->rowstoskip < 0)
+			buildstate->rowstoskip = reservoir_get_next_S(&buildstate->rstate,
+														  buildstate->samplerows,
+														  buildstate->targsamples);
+		if (buildstate->rowstoskip <= 0)
+			k = (int) (buildstate->targsamples *
+					   sampler_random_fract(&buildstate->rstate.randstate));
+		else
+			k = -1;
+		buildstate->rowstoskip -= 1;
+	}
+	buildstate->samplerows += 1;
+
+	if (k >= 0)
+	{
+		float4	   *sample = buildstate->samples + (Size) k * dim;
+
+		memcpy(sample, vec, sizeof(float4) * dim);
+
+		/* Cluster by direction only, for cosine distance */
+		if (buildstate->state.kind == IVF_DISTANCE_COSINE)
+			normalizeVector(sample, dim);
+	}
+
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextReset(buildstate->tmpCtx);
+}
+
+/*
+ * Find the centroids of the lists by k-means clustering of the sample, using
+ * Euclidean distance.  The initial centroids are spread evenly over the
+ * sample, which is in random order already.
+ */
+static void
+ivfKmeans(IvfBuildState *buildstate)
+{
+	int			dim = buildstate->state.dimensions;
+	int			nsamples = buildstate->nsamples;
+	int			nlists = Min(buildstate->lists, nsamples);
+	float4	   *centroids;
+	float4	   *sums;
+	int		   *counts;
+	int		   *assignments;
+
+	centroids = MemoryContextAllocHuge(CurrentMemoryContext,
+									   sizeof(float4) * dim * nlists);
+	sums = MemoryContextAllocHuge(CurrentMemoryContext,
+								  sizeof(float4) * dim * nlists);
+	counts = palloc(sizeof(int) * nlists);
+	assignments = MemoryContextAllocHuge(CurrentMemoryContext,
+										 sizeof(int) * nsamples);
+
+	for (int j = 0; j < nlists; j++)
+		memcpy(centroids + (Size) j * dim,
+			   buildstate->samples + (Size) ((int64) j * nsamples / nlists) * dim,
+			   sizeof(float4) * dim);
+	memset(assignments, -1, sizeof(int) * nsamples);
+
+	for (int iter = 0; iter < IVF_KMEANS_ITERATIONS; iter++)
+	{
+		int			changed = 0;
+
+		/* Assign each sampled vector to its nearest centroid */
+		for (int i = 0; i < nsamples; i++)
+		{
+			float4	   *sample = buildstate->samples + (Size) i * dim;
+			float8		best = get_float8_infinity();
+			int			bestlist = 0;
+
+			CHECK_FOR_INTERRUPTS();
+
+			for (int j = 0; j < nlists; j++)
+			{
+				float8		distance;
+
+				distance = vector_l2_squared_distance(sample,
+													  centroids + (Size) j * dim,
+													  dim);
+				if (distance < best)
+				{
+					best = distance;
+					bestlist = j;
+				}
+			}
+
+			if (assignments[i] != bestlist)
+			{
+				assignments[i] = bestlist;
+				changed++;
+			}
+		}
+
+		if (changed == 0)
+			break;
+
+		/* Move each centroid to the mean of its vectors */
+		memset(sums, 0, sizeof(float4) * dim * nlists);
+		memset(counts, 0, sizeof(int) * nlists);
+		for (int i = 0; i < nsamples; i++)
+		{
+			float4	   *sample = buildstate->samples + (Size) i * dim;
+			float4	   *sum = sums + (Size) assignments[i] * dim;
+
+			for (int d = 0; d < dim; d++)
+				sum[d] += sample[d];
+			counts[assignments[i]]++;
+		}
+		for (int j = 0; j < nlists; j++)
+		{
+			float4	   *centroid = centroids + (Size) j * dim;
+			float4	   *sum = sums + (Size) j * dim;
+
+			/* A list that lost all its vectors keeps its centroid */
+			if (counts[j] == 0)
+				continue;
+
+			for (int d = 0; d < dim; d++)
+				centroid[d] = sum[d] / counts[j];
+			if (buildstate->state.kind == IVF_DISTANCE_COSINE)
+				normalizeVector(centroid, dim);
+		}
+	}
+
+	buildstate->centroids = centroids;
+	buildstate->state.nlists = nlists;
+
+	pfree(sums);
+	pfree(counts);
+	pfree(assignments);
+}
+
+/*
+ * Return the list whose centroid is nearest to the vector.
+ */
+static int
+ivfNearestList(IvfBuildState *buildstate, const float4 *vec)
+{
+	int			dim = buildstate->state.dimensions;
+	float8		best = get_float8_infinity();
+	int			bestlist = 0;
+
+	for (int j = 0; j < buildstate->state.nlists; j++)
+	{
+		float8		distance;
+
+		distance = IvfDistance(&buildstate->state, vec,
+							   buildstate->centroids + (Size) j * dim);
+		if (distance < best)
+		{
+			best = distance;
+			bestlist = j;
+		}
+	}
+
+	return bestlist;
+}
+
+/*
+ * Per-tuple callback of the second pass: tag the vector with its list, and
+ * feed it to the sort.
+ */
+static void
+ivfAssignCallback(Relation index, ItemPointer tid, Datum *values,
+				  bool *isnull, bool tupleIsAlive, void *state)
+{
+	IvfBuildState *buildstate = (IvfBuildState *) state;
+	TupleTableSlot *slot = buildstate->slot;
+	MemoryContext oldCtx;
+	ArrayType  *array;
+	float4	   *vec;
+	int			dim;
+
+	if (isnull[0])
+		return;
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	/* Sort the detoasted vector, so that it's read back only once */
+	array = DatumGetArrayTypeP(values[0]);
+	vec = IvfGetVector(&buildstate->state, PointerGetDatum(array), &dim);
+
+	ExecClearTuple(slot);
+	slot->tts_values[0] = Int32GetDatum(ivfNearestList(buildstate, vec));
+	slot->tts_isnull[0] = false;
+	slot->tts_values[1] = ItemPointerGetDatum(tid);
+	slot->tts_isnull[1] = false;
+	slot->tts_values[2] = PointerGetDatum(array);
+	slot->tts_isnull[2] = false;
+	ExecStoreVirtualTuple(slot);
+
+	tuplesort_puttupleslot(buildstate->sortstate, slot);
+
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextReset(buildstate->tmpCtx);
+}
+
+/*
+ * WAL-log the whole contents of a page built in local memory, and release
+ * its buffer.
+ */
+static void
+ivfWritePage(Relation index, Buffer buffer, Page page)
+{
+	GenericXLogState *state;
+	Page		bufpage;
+
+	state = GenericXLogStart(index);
+	bufpage = GenericXLogRegisterBuffer(state, buffer, GENERIC_XLOG_FULL_IMAGE);
+	memcpy(bufpage, page, BLCKSZ);
+	GenericXLogFinish(state);
+	UnlockReleaseBuffer(buffer);
+}
+
+/*
+ * Write out the sorted vectors, as one chain of data pages per list, and
+ * then the list pages and the metapage.
+ */
+static void
+ivfWriteLists(Relation index, IvfBuildState *buildstate)
+{
+	IvfState   *state = &buildstate->state;
+	TupleTableSlot *slot;
+	PGAlignedBlock data;
+	Page		page = (Page) data.data;
+	Buffer		metaBuffer;
+	Buffer		buffer;
+	BlockNumber firstListBlkno;
+	int			listsPerPage;
+	int			nlistpages;
+	BlockNumber *startPages;
+	BlockNumber *insertPages;
+	IvfTuple	itup;
+	bool		havetuple;
+
+	state->sizeOfList = IVF_LIST_SIZE(state->dimensions);
+	state->sizeOfTuple = IVF_TUPLE_SIZE(state->dimensions);
+
+	/* Reserve the metapage and the list pages, which come first */
+	listsPerPage = (BLCKSZ - MAXALIGN(SizeOfPageHeaderData)
+					- MAXALIGN(sizeof(IvfPageOpaqueData))) / state->sizeOfList;
+	nlistpages = (state->nlists + listsPerPage - 1) / listsPerPage;
+
+	metaBuffer = IvfNewBuffer(index);
+	Assert(BufferGetBlockNumber(metaBuffer) == IVF_METAPAGE_BLKNO);
+
+	firstListBlkno = IVF_METAPAGE_BLKNO + 1;
+	for (int i = 0; i < nlistpages; i++)
+	{
+		buffer = IvfNewBuffer(index);
+		Assert(BufferGetBlockNumber(buffer) == firstListBlkno + i);
+		IvfInitPage(page, IVF_LIST);
+		ivfWritePage(index, buffer, page);
+	}
+
+	/* Write the data pages of each list, even if it has no vectors */
+	startPages = palloc(sizeof(BlockNumber) * state->nlists);
+	insertPages = palloc(sizeof(BlockNumber) * state->nlists);
+	itup = palloc0(state->sizeOfTuple);
+
+	slot = MakeSingleTupleTableSlot(buildstate->slot->tts_tupleDescriptor,
+									&TTSOpsMinimalTuple);
+	havetuple = tuplesort_gettupleslot(buildstate->sortstate, true, false,
+									   slot, NULL);
+
+	for (int list = 0; list < state->nlists; list++)
+	{
+		buffer = IvfNewBuffer(index);
+		startPages[list] = BufferGetBlockNumber(buffer);
+		IvfInitPage(page, IVF_DATA);
+
+		while (havetuple)
+		{
+			bool		isnull;
+			float4	   *vec;
+			int			dim;
+
+			if (DatumGetInt32(slot_getattr(slot, 1, &isnull)) != list)
+				break;
+
+			itup->heapPtr = *DatumGetItemPointer(slot_getattr(slot, 2, &isnull));
+			vec = vector_get_data(DatumGetArrayTypeP(slot_getattr(slot, 3, &isnull)),
+								  &dim);
+			memcpy(itup->vec, vec, sizeof(float4) * dim);
+
+			if (!IvfPageAddItem(page, state->sizeOfTuple, itup))
+			{
+				/* Page is full: chain a new one and flush this one */
+				Buffer		newBuffer = IvfNewBuffer(index);
+
+				IvfPageGetOpaque(page)->nextblkno = BufferGetBlockNumber(newBuffer);
+				ivfWritePage(index, buffer, page);
+
+				buffer = newBuffer;
+				IvfInitPage(page, IVF_DATA);
+				if (!IvfPageAddItem(page, state->sizeOfTuple, itup))
+					elog(ERROR, "could not add new ivfflat tuple to empty page");
+			}
+			buildstate->indtuples += 1;
+
+			CHECK_FOR_INTERRUPTS();
+			havetuple = tuplesort_gettupleslot(buildstate->sortstate, true,
+											   false, slot, NULL);
+		}
+
+		insertPages[list] = BufferGetBlockNumber(buffer);
+		ivfWritePage(index, buffer, page);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+
+	/* Fill the list pages reserved above */
+	for (int i = 0; i < nlistpages; i++)
+	{
+		IvfList		list = palloc0(state->sizeOfList);
+
+		IvfInitPage(page, IVF_LIST);
+		if (i < nlistpages - 1)
+			IvfPageGetOpaque(page)->nextblkno = firstListBlkno + i + 1;
+
+		for (int j = i * listsPerPage;
+			 j < Min((i + 1) * listsPerPage, state->nlists); j++)
+		{
+			list->startPage = startPages[j];
+			list->insertPage = insertPages[j];
+			memcpy(list->centroid,
+				   buildstate->centroids + (Size) j * state->dimensions,
+				   sizeof(float4) * state->dimensions);
+			if (!IvfPageAddItem(page, state->sizeOfList, list))
+				elog(ERROR, "could not add ivfflat list to list page");
+		}
+
+		buffer = ReadBuffer(index, firstListBlkno + i);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		ivfWritePage(index, buffer, page);
+		pfree(list);
+	}
+
+	IvfFillMetapage(page, state->dimensions, state->nlists, firstListBlkno);
+	ivfWritePage(index, metaBuffer, page);
+}
+
+/*
+ * Build a new ivfflat index.
+ */
+IndexBuildResult *
+ivfbuild(Relation heap, Relation index, IndexInfo *indexInfo)
+{
+	IndexBuildResult *result;
+	double		reltuples;
+	IvfBuildState buildstate;
+
+	if (RelationGetNumberOfBlocks(index) != 0)
+		elog(ERROR, "index \"%s\" already contains data",
+			 RelationGetRelationName(index));
+
+	memset(&buildstate, 0, sizeof(buildstate));
+	buildstate.state.kind = IvfGetDistanceKind(index);
+	buildstate.lists = IvfGetLists(index);
+	buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+											  "ivfflat build temporary context",
+											  ALLOCSET_DEFAULT_SIZES);
+
+	/* Sample the table, and cluster the sample */
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
+									   ivfSampleCallback, (void *) &buildstate,
+									   NULL);
+
+	if (buildstate.nsamples == 0)
+	{
+		Buffer		metaBuffer;
+		PGAlignedBlock data;
+
+		/*
+		 * Nothing to cluster.  Leave the index without lists; the first
+		 * insertion will create one.
+		 */
+		metaBuffer = IvfNewBuffer(index);
+		IvfFillMetapage((Page) data.data, 0, 0, InvalidBlockNumber);
+		ivfWritePage(index, metaBuffer, (Page) data.data);
+	}
+	else
+	{
+		TupleDesc	tupdesc;
+		AttrNumber	attNum = 1;
+		Oid			sortOperator = Int4LessOperator;
+		Oid			sortCollation = InvalidOid;
+		bool		nullsFirst = false;
+
+		ivfKmeans(&buildstate);
+		pfree(buildstate.samples);
+
+		/* Assign the vectors to lists */
+		tupdesc = CreateTemplateTupleDesc(3);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "list", INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "tid", TIDOID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 3, "vector", FLOAT4ARRAYOID,
+						   -1, 0);
+
+		buildstate.slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsVirtual);
+		buildstate.sortstate = tuplesort_begin_heap(tupdesc, 1, &attNum,
+													&sortOperator,
+													&sortCollation,
+													&nullsFirst,
+													maintenance_work_mem,
+													NULL, TUPLESORT_NONE);
+
+		reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
+										   ivfAssignCallback,
+										   (void *) &buildstate, NULL);
+
+		tuplesort_performsort(buildstate.sortstate);
+		ivfWriteLists(index, &buildstate);
+
+		tuplesort_end(buildstate.sortstate);
+		ExecDropSingleTupleTableSlot(buildstate.slot);
+	}
+
+	MemoryContextDelete(buildstate.tmpCtx);
+
+	result = (IndexBuildResult *) palloc(sizeof(IndexBuildResult));
+	result->heap_tuples = reltuples;
+	result->index_tuples = buildstate.indtuples;
+
+	return result;
+}
+
+/*
+ * Build an empty ivfflat index in the initialization fork.
+ */
+void
+ivfbuildempty(Relation index)
+{
+	Page		metapage;
+
+	/* Construct metapage. */
+	metapage = (Page) palloc_aligned(BLCKSZ, PG_IO_ALIGN_SIZE, 0);
+	IvfFillMetapage(metapage, 0, 0, InvalidBlockNumber);
+
+	/*
+	 * Write the page and log it.  Recovery itself might remove the file
+	 * while replaying, so we need the WAL record even when
+	 * wal_level=minimal.
+	 */
+	PageSetChecksumInplace(metapage, IVF_METAPAGE_BLKNO);
+	smgrwrite(RelationGetSmgr(index), INIT_FORKNUM, IVF_METAPAGE_BLKNO,
+			  metapage, true);
+	log_newpage(&(RelationGetSmgr(index))->smgr_rlocator.locator, INIT_FORKNUM,
+				IVF_METAPAGE_BLKNO, metapage, true);
+
+	/*
+	 * The write did not go through shared_buffers, so a concurrent checkpoint
+	 * may have moved the redo pointer past our xlog record.  Sync now.
+	 */
+	smgrimmedsync(RelationGetSmgr(index), INIT_FORKNUM);
+}
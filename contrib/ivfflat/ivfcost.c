@@ -0,0 +1,61 @@
+/*-------------------------------------------------------------------------
+ *
+ * ivfcost.c
+ *		Cost estimate function for ivfflat indexes.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/ivfflat/ivfcost.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "ivfflat.h"
+#include "optimizer/cost.h"
+#include "utils/selfuncs.h"
+
+/*
+ * Estimate cost of ivfflat index scan.
+ */
+void
+ivfcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
+				Cost *indexStartupCost, Cost *indexTotalCost,
+				Selectivity *indexSelectivity, double *indexCorrelation,
+				double *indexPages)
+{
+	IndexOptInfo *index = path->indexinfo;
+	GenericCosts costs = {0};
+	Relation	indexRel;
+	int			lists;
+
+	/* The index can only return vectors by distance */
+	if (path->indexorderbys == NIL)
+	{
+		*indexStartupCost = disable_cost;
+		*indexTotalCost = disable_cost;
+		*indexSelectivity = 0;
+		*indexCorrelation = 0;
+		*indexPages = 0;
+		return;
+	}
+
+	indexRel = index_open(index->indexoid, NoLock);
+	lists = IvfGetLists(indexRel);
+	index_close(indexRel, NoLock);
+
+	/* We visit the tuples of the probed lists */
+	costs.numIndexTuples = index->tuples * Min(ivf_probes, lists) / lists;
+
+	/* Use generic estimate */
+	genericcostestimate(root, path, loop_count, &costs);
+
+	/* All of them are visited before the first one is returned */
+	*indexStartupCost = costs.indexTotalCost;
+	*indexTotalCost = costs.indexTotalCost;
+	*indexSelectivity = costs.indexSelectivity;
+	*indexCorrelation = costs.indexCorrelation;
+	*indexPages = costs.numIndexPages;
+}
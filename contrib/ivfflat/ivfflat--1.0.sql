@@ -0,0 +1,74 @@
+/* contrib/ivfflat/ivfflat--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION ivfflat" to load this file. \quit
+
+-- Distance functions
+
+CREATE FUNCTION l2_distance(real[], real[])
+RETURNS float8
+AS 'MODULE_PATHNAME'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION inner_product(real[], real[])
+RETURNS float8
+AS 'MODULE_PATHNAME'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION negative_inner_product(real[], real[])
+RETURNS float8
+AS 'MODULE_PATHNAME'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION cosine_distance(real[], real[])
+RETURNS float8
+AS 'MODULE_PATHNAME'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OPERATOR <-> (
+	LEFTARG = real[],
+	RIGHTARG = real[],
+	PROCEDURE = l2_distance,
+	COMMUTATOR = '<->'
+);
+
+CREATE OPERATOR <#> (
+	LEFTARG = real[],
+	RIGHTARG = real[],
+	PROCEDURE = negative_inner_product,
+	COMMUTATOR = '<#>'
+);
+
+CREATE OPERATOR <=> (
+	LEFTARG = real[],
+	RIGHTARG = real[],
+	PROCEDURE = cosine_distance,
+	COMMUTATOR = '<=>'
+);
+
+-- Access method
+
+CREATE FUNCTION ivfhandler(internal)
+RETURNS index_am_handler
+AS 'MODULE_PATHNAME'
+LANGUAGE C;
+
+CREATE ACCESS METHOD ivfflat TYPE INDEX HANDLER ivfhandler;
+COMMENT ON ACCESS METHOD ivfflat IS 'ivfflat index access method';
+
+-- Opclasses
+
+CREATE OPERATOR CLASS vector_l2_ops
+DEFAULT FOR TYPE real[] USING ivfflat AS
+	OPERATOR	1	<-> (real[], real[]) FOR ORDER BY float_ops,
+	FUNCTION	1	l2_distance(real[], real[]);
+
+CREATE OPERATOR CLASS vector_ip_ops
+FOR TYPE real[] USING ivfflat AS
+	OPERATOR	1	<#> (real[], real[]) FOR ORDER BY float_ops,
+	FUNCTION	1	negative_inner_product(real[], real[]);
+
+CREATE OPERATOR CLASS vector_cosine_ops
+FOR TYPE real[] USING ivfflat AS
+	OPERATOR	1	<=> (real[], real[]) FOR ORDER BY float_ops,
+	FUNCTION	1	cosine_distance(real[], real[]);
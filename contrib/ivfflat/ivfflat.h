@@ -0,0 +1,234 @@
+/*-------------------------------------------------------------------------
+ *
+ * ivfflat.h
+ *	  Header for ivfflat index.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/ivfflat/ivfflat.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _IVFFLAT_H_
+#define _IVFFLAT_H_
+
+#include "access/amapi.h"
+#include "access/generic_xlog.h"
+#include "fmgr.h"
+#include "nodes/pathnodes.h"
+#include "storage/bufpage.h"
+#include "storage/itemptr.h"
+#include "utils/array.h"
+
+/* Support procedures numbers */
+#define IVF_DISTANCE_PROC		1
+#define IVF_NPROC				1
+
+/* Ordering strategies */
+#define IVF_DISTANCE_STRATEGY	1
+#define IVF_NSTRATEGIES			1
+
+/*
+ * Opaque for ivfflat pages.  Both list pages and data pages form singly
+ * linked chains through nextblkno.
+ */
+typedef struct IvfPageOpaqueData
+{
+	BlockNumber nextblkno;		/* next page of the chain, or
+								 * InvalidBlockNumber */
+	OffsetNumber maxoff;		/* number of items on page */
+	uint16		flags;			/* see bit definitions below */
+	uint16		unused[3];		/* placeholder to place ivf_page_id exactly
+								 * at the end of page */
+	uint16		ivf_page_id;	/* for identification of ivfflat indexes */
+} IvfPageOpaqueData;
+
+typedef IvfPageOpaqueData *IvfPageOpaque;
+
+/* ivfflat page flags */
+#define IVF_META		(1<<0)
+#define IVF_LIST		(1<<1)
+#define IVF_DATA		(1<<2)
+
+/*
+ * The page ID is for the convenience of pg_filedump and similar utilities,
+ * which otherwise would have a hard time telling pages of different index
+ * types apart.  It should be the last 2 bytes on the page.
+ *
+ * See comments above GinPageOpaqueData.
+ */
+#define IVF_PAGE_ID			0xFF84
+
+/* Preserved page numbers */
+#define IVF_METAPAGE_BLKNO	(0)
+
+/* Metadata of ivfflat index */
+typedef struct IvfMetaPageData
+{
+	uint32		magickNumber;
+	int32		dimensions;		/* dimensions of all indexed vectors, or 0 if
+								 * no list has been created yet */
+	int32		nlists;			/* number of lists */
+	BlockNumber listHead;		/* first list page, or InvalidBlockNumber */
+} IvfMetaPageData;
+
+/* Magic number to distinguish ivfflat pages among others */
+#define IVF_MAGICK_NUMBER (0x1F5AF1A7)
+
+/*
+ * Entry of a list page: the centroid of one list, and where its vectors are.
+ */
+typedef struct IvfListData
+{
+	BlockNumber startPage;		/* first data page of the list */
+	BlockNumber insertPage;		/* last data page of the list */
+	float4		centroid[FLEXIBLE_ARRAY_MEMBER];
+} IvfListData;
+
+typedef IvfListData *IvfList;
+
+/*
+ * Entry of a data page: one indexed vector.
+ */
+typedef struct IvfTupleData
+{
+	ItemPointerData heapPtr;
+	float4		vec[FLEXIBLE_ARRAY_MEMBER];
+} IvfTupleData;
+
+typedef IvfTupleData *IvfTuple;
+
+#define IVF_LIST_SIZE(dim)	(offsetof(IvfListData, centroid) + sizeof(float4) * (dim))
+#define IVF_TUPLE_SIZE(dim)	(offsetof(IvfTupleData, vec) + sizeof(float4) * (dim))
+
+/* Macros for accessing ivfflat page structures */
+#define IvfPageGetOpaque(page) ((IvfPageOpaque) PageGetSpecialPointer(page))
+#define IvfPageGetMaxOffset(page) (IvfPageGetOpaque(page)->maxoff)
+#define IvfPageIsMeta(page) \
+	((IvfPageGetOpaque(page)->flags & IVF_META) != 0)
+#define IvfPageIsData(page) \
+	((IvfPageGetOpaque(page)->flags & IVF_DATA) != 0)
+#define IvfPageGetMeta(page)	((IvfMetaPageData *) PageGetContents(page))
+#define IvfPageGetItem(page, itemsize, offset) \
+	((Pointer) PageGetContents(page) + (itemsize) * ((offset) - 1))
+#define IvfPageGetFreeSpace(page, itemsize) \
+	(BLCKSZ - MAXALIGN(SizeOfPageHeaderData) \
+		- IvfPageGetMaxOffset(page) * (itemsize) \
+		- MAXALIGN(sizeof(IvfPageOpaqueData)))
+
+/*
+ * Maximum number of dimensions: a list entry, whose header is the same size
+ * as a tuple's, must fit on a page.
+ */
+#define IVF_MAX_DIMENSIONS \
+	((int) ((BLCKSZ - MAXALIGN(SizeOfPageHeaderData) \
+			 - MAXALIGN(sizeof(IvfPageOpaqueData)) \
+			 - offsetof(IvfListData, centroid)) / sizeof(float4)))
+
+/* Default and maximum number of lists */
+#define DEFAULT_IVF_LISTS		100
+#define MAX_IVF_LISTS			32768
+
+/* ivfflat index options */
+typedef struct IvfOptions
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	int			lists;			/* number of lists built */
+} IvfOptions;
+
+/* Distance functions the index knows how to compute */
+typedef enum IvfDistanceKind
+{
+	IVF_DISTANCE_L2,
+	IVF_DISTANCE_NEGATIVE_IP,
+	IVF_DISTANCE_COSINE
+} IvfDistanceKind;
+
+typedef struct IvfState
+{
+	IvfDistanceKind kind;		/* distance of the opclass */
+	int			dimensions;		/* copy of dimensions on metapage */
+	int			nlists;			/* copy of nlists on metapage */
+	BlockNumber listHead;		/* copy of listHead on metapage */
+	Size		sizeOfList;		/* IVF_LIST_SIZE(dimensions) */
+	Size		sizeOfTuple;	/* IVF_TUPLE_SIZE(dimensions) */
+} IvfState;
+
+/* Opaque data structure for ivfflat index scan */
+typedef struct IvfScanItem
+{
+	ItemPointerData heapPtr;
+	float8		distance;
+} IvfScanItem;
+
+typedef struct IvfScanOpaqueData
+{
+	IvfState	state;
+	MemoryContext scanCtx;		/* context holding the items, reset on
+								 * rescan */
+	bool		started;		/* have we collected the items yet? */
+	IvfScanItem *items;			/* items of the probed lists, by distance */
+	int			nitems;
+	int			curitem;		/* next item to return */
+} IvfScanOpaqueData;
+
+typedef IvfScanOpaqueData *IvfScanOpaque;
+
+/* GUC parameter */
+extern PGDLLIMPORT int ivf_probes;
+
+/* vector.c */
+extern float8 vector_l2_squared_distance(const float4 *a, const float4 *b,
+										 int dim);
+extern float8 vector_inner_product_internal(const float4 *a, const float4 *b,
+											int dim);
+extern float8 vector_cosine_distance_internal(const float4 *a, const float4 *b,
+											  int dim);
+extern float4 *vector_get_data(ArrayType *array, int *dim);
+extern PGDLLEXPORT Datum l2_distance(PG_FUNCTION_ARGS);
+extern PGDLLEXPORT Datum negative_inner_product(PG_FUNCTION_ARGS);
+extern PGDLLEXPORT Datum cosine_distance(PG_FUNCTION_ARGS);
+
+/* ivfutils.c */
+extern IvfDistanceKind IvfGetDistanceKind(Relation index);
+extern void initIvfState(IvfState *state, Relation index);
+extern float8 IvfDistance(IvfState *state, const float4 *a, const float4 *b);
+extern float4 *IvfGetVector(IvfState *state, Datum value, int *dim);
+extern void IvfInitPage(Page page, uint16 flags);
+extern Buffer IvfNewBuffer(Relation index);
+extern bool IvfPageAddItem(Page page, Size itemsize, const void *item);
+extern void IvfFillMetapage(Page metaPage, int dimensions, int nlists,
+							BlockNumber listHead);
+extern int	IvfGetLists(Relation index);
+extern bytea *ivfoptions(Datum reloptions, bool validate);
+
+/* ivfvalidate.c */
+extern bool ivfvalidate(Oid opclassoid);
+
+/* index access method interface functions */
+extern bool ivfinsert(Relation index, Datum *values, bool *isnull,
+					  ItemPointer ht_ctid, Relation heapRel,
+					  IndexUniqueCheck checkUnique,
+					  bool indexUnchanged,
+					  struct IndexInfo *indexInfo);
+extern IndexScanDesc ivfbeginscan(Relation r, int nkeys, int norderbys);
+extern bool ivfgettuple(IndexScanDesc scan, ScanDirection dir);
+extern void ivfrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
+					  ScanKey orderbys, int norderbys);
+extern void ivfendscan(IndexScanDesc scan);
+extern IndexBuildResult *ivfbuild(Relation heap, Relation index,
+								  struct IndexInfo *indexInfo);
+extern void ivfbuildempty(Relation index);
+extern IndexBulkDeleteResult *ivfbulkdelete(IndexVacuumInfo *info,
+											IndexBulkDeleteResult *stats,
+											IndexBulkDeleteCallback callback,
+											void *callback_state);
+extern IndexBulkDeleteResult *ivfvacuumcleanup(IndexVacuumInfo *info,
+											   IndexBulkDeleteResult *stats);
+extern void ivfcostestimate(PlannerInfo *root, IndexPath *path,
+							double loop_count, Cost *indexStartupCost,
+							Cost *indexTotalCost, Selectivity *indexSelectivity,
+							double *indexCorrelation, double *indexPages);
+
+#endif
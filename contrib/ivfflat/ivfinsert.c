@@ -0,0 +1,270 @@
+/*-------------------------------------------------------------------------
+ *
+ * ivfinsert.c
+ *		ivfflat index insert functions.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/ivfflat/ivfinsert.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/generic_xlog.h"
+#include "catalog/index.h"
+#include "ivfflat.h"
+#include "storage/bufmgr.h"
+#include "utils/float.h"
+#include "utils/memutils.h"
+
+/*
+ * Create the first list of an index that has none, because it was built on
+ * a table without vectors.  Its centroid is the vector being inserted.
+ */
+static void
+ivfCreateFirstList(Relation index, const float4 *vec, int dim)
+{
+	Buffer		metaBuffer,
+				listBuffer,
+				dataBuffer;
+	Page		metaPage,
+				listPage,
+				dataPage;
+	IvfMetaPageData *metaData;
+	IvfList		list;
+	GenericXLogState *state;
+
+	metaBuffer = ReadBuffer(index, IVF_METAPAGE_BLKNO);
+	LockBuffer(metaBuffer, BUFFER_LOCK_EXCLUSIVE);
+
+	state = GenericXLogStart(index);
+	metaPage = GenericXLogRegisterBuffer(state, metaBuffer, 0);
+	metaData = IvfPageGetMeta(metaPage);
+
+	/* Somebody else might have created it while we didn't have lock */
+	if (metaData->nlists > 0)
+	{
+		GenericXLogAbort(state);
+		UnlockReleaseBuffer(metaBuffer);
+		return;
+	}
+
+	listBuffer = IvfNewBuffer(index);
+	dataBuffer = IvfNewBuffer(index);
+	listPage = GenericXLogRegisterBuffer(state, listBuffer,
+										 GENERIC_XLOG_FULL_IMAGE);
+	dataPage = GenericXLogRegisterBuffer(state, dataBuffer,
+										 GENERIC_XLOG_FULL_IMAGE);
+	IvfInitPage(listPage, IVF_LIST);
+	IvfInitPage(dataPage, IVF_DATA);
+
+	list = palloc(IVF_LIST_SIZE(dim));
+	list->startPage = BufferGetBlockNumber(dataBuffer);
+	list->insertPage = BufferGetBlockNumber(dataBuffer);
+	memcpy(list->centroid, vec, sizeof(float4) * dim);
+	if (!IvfPageAddItem(listPage, IVF_LIST_SIZE(dim), list))
+		elog(ERROR, "could not add ivfflat list to empty page");
+
+	metaData->dimensions = dim;
+	metaData->nlists = 1;
+	metaData->listHead = BufferGetBlockNumber(listBuffer);
+
+	GenericXLogFinish(state);
+
+	UnlockReleaseBuffer(dataBuffer);
+	UnlockReleaseBuffer(listBuffer);
+	UnlockReleaseBuffer(metaBuffer);
+}
+
+/*
+ * Find the list whose centroid is nearest to the vector, and return the
+ * block and offset of its list entry.
+ */
+static void
+ivfFindNearestList(Relation index, IvfState *state, const float4 *vec,
+				   BlockNumber *listBlkno, OffsetNumber *listOffset)
+{
+	BlockNumber blkno = state->listHead;
+	float8		best = get_float8_infinity();
+
+	/* Distances may be NaN, so start out with the first list */
+	*listBlkno = state->listHead;
+	*listOffset = FirstOffsetNumber;
+
+	while (BlockNumberIsValid(blkno))
+	{
+		Buffer		buffer;
+		Page		page;
+		OffsetNumber maxoff;
+
+		buffer = ReadBuffer(index, blkno);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buffer);
+
+		maxoff = IvfPageGetMaxOffset(page);
+		for (OffsetNumber off = FirstOffsetNumber; off <= maxoff; off++)
+		{
+			IvfList		list;
+			float8		distance;
+
+			list = (IvfList) IvfPageGetItem(page, state->sizeOfList, off);
+			distance = IvfDistance(state, vec, list->centroid);
+			if (distance < best)
+			{
+				best = distance;
+				*listBlkno = blkno;
+				*listOffset = off;
+			}
+		}
+
+		blkno = IvfPageGetOpaque(page)->nextblkno;
+		UnlockReleaseBuffer(buffer);
+	}
+}
+
+/*
+ * Insert new tuple to the ivfflat index.
+ *
+ * The tuple goes to the last data page of the list of the nearest centroid.
+ * Only when that page is full do we lock the list entry, to chain a new page
+ * and make it the list's insert page.
+ */
+bool
+ivfinsert(Relation index, Datum *values, bool *isnull,
+		  ItemPointer ht_ctid, Relation heapRel,
+		  IndexUniqueCheck checkUnique,
+		  bool indexUnchanged,
+		  IndexInfo *indexInfo)
+{
+	IvfState	ivfstate;
+	MemoryContext oldCtx;
+	MemoryContext insertCtx;
+	float4	   *vec;
+	int			dim;
+	IvfTuple	itup;
+	BlockNumber listBlkno;
+	OffsetNumber listOffset;
+
+	/* Vectors that are null are not indexed */
+	if (isnull[0])
+		return false;
+
+	insertCtx = AllocSetContextCreate(CurrentMemoryContext,
+									  "ivfflat insert temporary context",
+									  ALLOCSET_DEFAULT_SIZES);
+
+	oldCtx = MemoryContextSwitchTo(insertCtx);
+
+	initIvfState(&ivfstate, index);
+	vec = IvfGetVector(&ivfstate, values[0], &dim);
+
+	if (ivfstate.nlists == 0)
+	{
+		ivfCreateFirstList(index, vec, dim);
+
+		/* Recheck the dimensions, in case somebody else created the list */
+		initIvfState(&ivfstate, index);
+		vec = IvfGetVector(&ivfstate, values[0], &dim);
+	}
+
+	itup = palloc(ivfstate.sizeOfTuple);
+	itup->heapPtr = *ht_ctid;
+	memcpy(itup->vec, vec, sizeof(float4) * dim);
+
+	ivfFindNearestList(index, &ivfstate, vec, &listBlkno, &listOffset);
+
+	for (;;)
+	{
+		Buffer		listBuffer,
+					buffer,
+					newBuffer;
+		Page		listPage,
+					page,
+					newPage;
+		IvfList		list;
+		BlockNumber insertBlkno;
+		GenericXLogState *state;
+
+		listBuffer = ReadBuffer(index, listBlkno);
+		LockBuffer(listBuffer, BUFFER_LOCK_SHARE);
+		list = (IvfList) IvfPageGetItem(BufferGetPage(listBuffer),
+										ivfstate.sizeOfList, listOffset);
+		insertBlkno = list->insertPage;
+		LockBuffer(listBuffer, BUFFER_LOCK_UNLOCK);
+
+		/* At first, try to insert the tuple into the list's last page */
+		buffer = ReadBuffer(index, insertBlkno);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+		state = GenericXLogStart(index);
+		page = GenericXLogRegisterBuffer(state, buffer, 0);
+
+		if (IvfPageAddItem(page, ivfstate.sizeOfTuple, itup))
+		{
+			GenericXLogFinish(state);
+			UnlockReleaseBuffer(buffer);
+			ReleaseBuffer(listBuffer);
+			break;
+		}
+
+		GenericXLogAbort(state);
+		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+
+		/*
+		 * The page is full.  Lock the list entry, then the page again, and
+		 * chain a new page, unless somebody else has done so meanwhile.
+		 */
+		LockBuffer(listBuffer, BUFFER_LOCK_EXCLUSIVE);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+		state = GenericXLogStart(index);
+		listPage = GenericXLogRegisterBuffer(state, listBuffer, 0);
+		list = (IvfList) IvfPageGetItem(listPage, ivfstate.sizeOfList,
+										listOffset);
+
+		if (list->insertPage != insertBlkno)
+		{
+			/* Start over with the new insert page */
+			GenericXLogAbort(state);
+			UnlockReleaseBuffer(buffer);
+			UnlockReleaseBuffer(listBuffer);
+			continue;
+		}
+
+		page = GenericXLogRegisterBuffer(state, buffer, 0);
+
+		/* VACUUM might have made room on the page meanwhile */
+		if (!IvfPageAddItem(page, ivfstate.sizeOfTuple, itup))
+		{
+			newBuffer = IvfNewBuffer(index);
+			newPage = GenericXLogRegisterBuffer(state, newBuffer,
+												GENERIC_XLOG_FULL_IMAGE);
+			IvfInitPage(newPage, IVF_DATA);
+
+			if (!IvfPageAddItem(newPage, ivfstate.sizeOfTuple, itup))
+			{
+				/* We shouldn't be here since we're inserting to an empty page */
+				elog(ERROR, "could not add new ivfflat tuple to empty page");
+			}
+
+			IvfPageGetOpaque(page)->nextblkno = BufferGetBlockNumber(newBuffer);
+			list->insertPage = BufferGetBlockNumber(newBuffer);
+
+			GenericXLogFinish(state);
+			UnlockReleaseBuffer(newBuffer);
+		}
+		else
+			GenericXLogFinish(state);
+
+		UnlockReleaseBuffer(buffer);
+		UnlockReleaseBuffer(listBuffer);
+		break;
+	}
+
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextDelete(insertCtx);
+
+	return false;
+}
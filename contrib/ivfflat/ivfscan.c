@@ -0,0 +1,258 @@
+/*-------------------------------------------------------------------------
+ *
+ * ivfscan.c
+ *		ivfflat index scan functions.
+ *
+ * A scan finds the ivfflat.probes lists whose centroids are nearest to the
+ * ORDER BY argument, computes the distance of every vector in those lists,
+ * and returns them by distance.  Vectors in other lists are never returned,
+ * which is what makes the search approximate.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/ivfflat/ivfscan.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/relscan.h"
+#include "ivfflat.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/bufmgr.h"
+#include "utils/float.h"
+#include "utils/memutils.h"
+
+/* A list to probe, and the distance of its centroid */
+typedef struct IvfProbe
+{
+	BlockNumber startPage;
+	float8		distance;
+} IvfProbe;
+
+/*
+ * qsort comparator for IvfProbe, by distance.
+ */
+static int
+compareProbes(const void *a, const void *b)
+{
+	return float8_cmp_internal(((const IvfProbe *) a)->distance,
+							   ((const IvfProbe *) b)->distance);
+}
+
+/*
+ * qsort comparator for IvfScanItem, by distance and then by TID, so that the
+ * order of equidistant vectors is stable.
+ */
+static int
+compareItems(const void *a, const void *b)
+{
+	const IvfScanItem *ia = (const IvfScanItem *) a;
+	const IvfScanItem *ib = (const IvfScanItem *) b;
+	int			cmp;
+
+	cmp = float8_cmp_internal(ia->distance, ib->distance);
+	if (cmp != 0)
+		return cmp;
+	return ItemPointerCompare((ItemPointer) &ia->heapPtr,
+							  (ItemPointer) &ib->heapPtr);
+}
+
+/*
+ * Begin scan of ivfflat index.
+ */
+IndexScanDesc
+ivfbeginscan(Relation r, int nkeys, int norderbys)
+{
+	IndexScanDesc scan;
+	IvfScanOpaque so;
+
+	scan = RelationGetIndexScan(r, nkeys, norderbys);
+
+	so = (IvfScanOpaque) palloc0(sizeof(IvfScanOpaqueData));
+	so->scanCtx = AllocSetContextCreate(CurrentMemoryContext,
+										"ivfflat scan context",
+										ALLOCSET_DEFAULT_SIZES);
+
+	scan->opaque = so;
+
+	return scan;
+}
+
+/*
+ * Rescan an ivfflat index.
+ */
+void
+ivfrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
+		  ScanKey orderbys, int norderbys)
+{
+	IvfScanOpaque so = (IvfScanOpaque) scan->opaque;
+
+	MemoryContextReset(so->scanCtx);
+	so->started = false;
+	so->items = NULL;
+	so->nitems = 0;
+	so->curitem = 0;
+
+	if (orderbys && scan->numberOfOrderBys > 0)
+	{
+		memmove(scan->orderByData, orderbys,
+				scan->numberOfOrderBys * sizeof(ScanKeyData));
+	}
+}
+
+/*
+ * End scan of ivfflat index.
+ */
+void
+ivfendscan(IndexScanDesc scan)
+{
+	IvfScanOpaque so = (IvfScanOpaque) scan->opaque;
+
+	MemoryContextDelete(so->scanCtx);
+	pfree(so);
+}
+
+/*
+ * Compute the distances of the vectors of the nearest lists, and sort them.
+ */
+static void
+ivfCollectItems(IndexScanDesc scan)
+{
+	IvfScanOpaque so = (IvfScanOpaque) scan->opaque;
+	IvfState   *state = &so->state;
+	Relation	index = scan->indexRelation;
+	ScanKey		key = &scan->orderByData[0];
+	MemoryContext oldCtx;
+	float4	   *query;
+	int			dim;
+	IvfProbe   *probes;
+	int			nprobes = 0;
+	int			maxitems;
+	BlockNumber blkno;
+
+	oldCtx = MemoryContextSwitchTo(so->scanCtx);
+
+	initIvfState(state, index);
+
+	/* Nothing is near a null vector, and an empty index has no lists */
+	if (scan->numberOfOrderBys == 0 || (key->sk_flags & SK_ISNULL) ||
+		state->nlists == 0)
+	{
+		MemoryContextSwitchTo(oldCtx);
+		return;
+	}
+
+	query = IvfGetVector(state, key->sk_argument, &dim);
+
+	/* Rank the lists by the distance of their centroids */
+	probes = palloc(sizeof(IvfProbe) * state->nlists);
+	blkno = state->listHead;
+	while (BlockNumberIsValid(blkno))
+	{
+		Buffer		buffer;
+		Page		page;
+		OffsetNumber maxoff;
+
+		buffer = ReadBuffer(index, blkno);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buffer);
+
+		maxoff = IvfPageGetMaxOffset(page);
+		for (OffsetNumber off = FirstOffsetNumber; off <= maxoff; off++)
+		{
+			IvfList		list;
+
+			list = (IvfList) IvfPageGetItem(page, state->sizeOfList, off);
+			probes[nprobes].startPage = list->startPage;
+			probes[nprobes].distance = IvfDistance(state, query,
+												   list->centroid);
+			nprobes++;
+		}
+
+		blkno = IvfPageGetOpaque(page)->nextblkno;
+		UnlockReleaseBuffer(buffer);
+	}
+
+	qsort(probes, nprobes, sizeof(IvfProbe), compareProbes);
+	nprobes = Min(nprobes, ivf_probes);
+
+	/* Compute the distance of each vector of the nearest lists */
+	maxitems = 1024;
+	so->items = palloc(sizeof(IvfScanItem) * maxitems);
+
+	for (int i = 0; i < nprobes; i++)
+	{
+		blkno = probes[i].startPage;
+		while (BlockNumberIsValid(blkno))
+		{
+			Buffer		buffer;
+			Page		page;
+			OffsetNumber maxoff;
+
+			CHECK_FOR_INTERRUPTS();
+
+			buffer = ReadBuffer(index, blkno);
+			LockBuffer(buffer, BUFFER_LOCK_SHARE);
+			page = BufferGetPage(buffer);
+
+			maxoff = IvfPageGetMaxOffset(page);
+			if (so->nitems + maxoff > maxitems)
+			{
+				maxitems = Max(maxitems * 2, so->nitems + maxoff);
+				so->items = repalloc_huge(so->items,
+										  sizeof(IvfScanItem) * maxitems);
+			}
+
+			for (OffsetNumber off = FirstOffsetNumber; off <= maxoff; off++)
+			{
+				IvfTuple	itup;
+				IvfScanItem *item = &so->items[so->nitems++];
+
+				itup = (IvfTuple) IvfPageGetItem(page, state->sizeOfTuple, off);
+				item->heapPtr = itup->heapPtr;
+				item->distance = IvfDistance(state, query, itup->vec);
+			}
+
+			blkno = IvfPageGetOpaque(page)->nextblkno;
+			UnlockReleaseBuffer(buffer);
+		}
+	}
+
+	qsort(so->items, so->nitems, sizeof(IvfScanItem), compareItems);
+
+	MemoryContextSwitchTo(oldCtx);
+}
+
+/*
+ * Return the next nearest vector.
+ */
+bool
+ivfgettuple(IndexScanDesc scan, ScanDirection dir)
+{
+	IvfScanOpaque so = (IvfScanOpaque) scan->opaque;
+	IvfScanItem *item;
+
+	if (!so->started)
+	{
+		pgstat_count_index_scan(scan->indexRelation);
+		ivfCollectItems(scan);
+		so->started = true;
+	}
+
+	if (so->curitem >= so->nitems)
+		return false;
+
+	item = &so->items[so->curitem++];
+	scan->xs_heaptid = item->heapPtr;
+	scan->xs_recheck = false;
+
+	/* The distances are exact, only the set of vectors is approximate */
+	scan->xs_recheckorderby = false;
+	scan->xs_orderbyvals[0] = Float8GetDatum(item->distance);
+	scan->xs_orderbynulls[0] = false;
+
+	return true;
+}
@@ -0,0 +1,358 @@
+/*-------------------------------------------------------------------------
+ *
+ * ivfutils.c
+ *		ivfflat index utilities.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/ivfflat/ivfutils.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/amapi.h"
+#include "access/genam.h"
+#include "access/generic_xlog.h"
+#include "access/reloptions.h"
+#include "commands/vacuum.h"
+#include "ivfflat.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "storage/lmgr.h"
+#include "utils/guc.h"
+#include "utils/regproc.h"
+#include "utils/rel.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(ivfhandler);
+
+/* GUC parameter */
+int			ivf_probes = 1;
+
+/* Kind of relation options for ivfflat index */
+static relopt_kind ivf_relopt_kind;
+
+/* parse table for fillRelOptions */
+static relopt_parse_elt ivf_relopt_tab[1];
+
+/*
+ * Module initialize function: initialize info about ivfflat relation options
+ * and define the GUC parameter.
+ */
+void
+_PG_init(void)
+{
+	ivf_relopt_kind = add_reloption_kind();
+
+	add_int_reloption(ivf_relopt_kind, "lists",
+					  "Number of lists the vectors are divided into",
+					  DEFAULT_IVF_LISTS, 1, MAX_IVF_LISTS,
+					  AccessExclusiveLock);
+	ivf_relopt_tab[0].optname = "lists";
+	ivf_relopt_tab[0].opttype = RELOPT_TYPE_INT;
+	ivf_relopt_tab[0].offset = offsetof(IvfOptions, lists);
+
+	DefineCustomIntVariable("ivfflat.probes",
+							"Sets the number of lists probed by an ivfflat index scan.",
+							"Probing more lists makes the results more accurate, "
+							"at the cost of speed.",
+							&ivf_probes,
+							1,
+							1, MAX_IVF_LISTS,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	MarkGUCPrefixReserved("ivfflat");
+}
+
+/*
+ * ivfflat handler function: return IndexAmRoutine with access method
+ * parameters and callbacks.
+ */
+Datum
+ivfhandler(PG_FUNCTION_ARGS)
+{
+	IndexAmRoutine *amroutine = makeNode(IndexAmRoutine);
+
+	amroutine->amstrategies = IVF_NSTRATEGIES;
+	amroutine->amsupport = IVF_NPROC;
+	amroutine->amoptsprocnum = 0;
+	amroutine->amcanorder = false;
+	amroutine->amcanorderbyop = true;
+	amroutine->amcanbackward = false;
+	amroutine->amcanunique = false;
+	amroutine->amcanmulticol = false;
+	amroutine->amoptionalkey = true;
+	amroutine->amsearcharray = false;
+	amroutine->amsearchnulls = false;
+	amroutine->amstorage = false;
+	amroutine->amclusterable = false;
+	amroutine->ampredlocks = false;
+	amroutine->amcanparallel = false;
+	amroutine->amcanbuildparallel = false;
+	amroutine->amcaninclude = false;
+	amroutine->amusemaintenanceworkmem = true;
+	amroutine->amsummarizing = false;
+	amroutine->amparallelvacuumoptions =
+		VACUUM_OPTION_PARALLEL_BULKDEL | VACUUM_OPTION_PARALLEL_CLEANUP;
+	amroutine->amkeytype = InvalidOid;
+
+	amroutine->ambuild = ivfbuild;
+	amroutine->ambuildempty = ivfbuildempty;
+	amroutine->aminsert = ivfinsert;
+	amroutine->aminsertbatch = NULL;
+	amroutine->ambulkdelete = ivfbulkdelete;
+	amroutine->amvacuumcleanup = ivfvacuumcleanup;
+	amroutine->amcanreturn = NULL;
+	amroutine->amcostestimate = ivfcostestimate;
+	amroutine->amoptions = ivfoptions;
+	amroutine->amproperty = NULL;
+	amroutine->ambuildphasename = NULL;
+	amroutine->amvalidate = ivfvalidate;
+	amroutine->amadjustmembers = NULL;
+	amroutine->ambeginscan = ivfbeginscan;
+	amroutine->amrescan = ivfrescan;
+	amroutine->amgettuple = ivfgettuple;
+	amroutine->amgetbitmap = NULL;
+	amroutine->amendscan = ivfendscan;
+	amroutine->ammarkpos = NULL;
+	amroutine->amrestrpos = NULL;
+	amroutine->amestimateparallelscan = NULL;
+	amroutine->aminitparallelscan = NULL;
+	amroutine->amparallelrescan = NULL;
+
+	PG_RETURN_POINTER(amroutine);
+}
+
+/*
+ * Identify the distance computed by the opclass of the index.
+ *
+ * The index computes distances with the kernels of vector.c directly, rather
+ * than through the support function, so the support function must be one of
+ * ours.
+ */
+IvfDistanceKind
+IvfGetDistanceKind(Relation index)
+{
+	FmgrInfo   *procinfo;
+
+	procinfo = index_getprocinfo(index, 1, IVF_DISTANCE_PROC);
+
+	if (procinfo->fn_addr == l2_distance)
+		return IVF_DISTANCE_L2;
+	if (procinfo->fn_addr == negative_inner_product)
+		return IVF_DISTANCE_NEGATIVE_IP;
+	if (procinfo->fn_addr == cosine_distance)
+		return IVF_DISTANCE_COSINE;
+
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("ivfflat index \"%s\" uses unsupported distance function %s",
+					RelationGetRelationName(index),
+					format_procedure(procinfo->fn_oid))));
+	return IVF_DISTANCE_L2;		/* keep compiler quiet */
+}
+
+/*
+ * Fill IvfState structure for particular index, from its metapage.
+ */
+void
+initIvfState(IvfState *state, Relation index)
+{
+	Buffer		buffer;
+	Page		page;
+	IvfMetaPageData *meta;
+
+	state->kind = IvfGetDistanceKind(index);
+
+	buffer = ReadBuffer(index, IVF_METAPAGE_BLKNO);
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+
+	page = BufferGetPage(buffer);
+
+	if (!IvfPageIsMeta(page))
+		elog(ERROR, "Relation is not an ivfflat index");
+	meta = IvfPageGetMeta(page);
+
+	if (meta->magickNumber != IVF_MAGICK_NUMBER)
+		elog(ERROR, "Relation is not an ivfflat index");
+
+	state->dimensions = meta->dimensions;
+	state->nlists = meta->nlists;
+	state->listHead = meta->listHead;
+
+	UnlockReleaseBuffer(buffer);
+
+	state->sizeOfList = IVF_LIST_SIZE(state->dimensions);
+	state->sizeOfTuple = IVF_TUPLE_SIZE(state->dimensions);
+}
+
+/*
+ * Compute the distance of the opclass between two vectors.
+ */
+float8
+IvfDistance(IvfState *state, const float4 *a, const float4 *b)
+{
+	switch (state->kind)
+	{
+		case IVF_DISTANCE_L2:
+			return sqrt(vector_l2_squared_distance(a, b, state->dimensions));
+		case IVF_DISTANCE_NEGATIVE_IP:
+			return -vector_inner_product_internal(a, b, state->dimensions);
+		case IVF_DISTANCE_COSINE:
+			return vector_cosine_distance_internal(a, b, state->dimensions);
+	}
+
+	return 0;					/* keep compiler quiet */
+}
+
+/*
+ * Extract the elements of an indexed or searched vector, and set *dim to its
+ * number of dimensions.  If the index already has vectors, the number of
+ * dimensions must match theirs.
+ */
+float4 *
+IvfGetVector(IvfState *state, Datum value, int *dim)
+{
+	float4	   *data;
+
+	data = vector_get_data(DatumGetArrayTypeP(value), dim);
+
+	if (*dim > IVF_MAX_DIMENSIONS)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("vector of %d dimensions exceeds the maximum of %d for an ivfflat index",
+						*dim, IVF_MAX_DIMENSIONS)));
+	if (state->dimensions != 0 && *dim != state->dimensions)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_EXCEPTION),
+				 errmsg("expected %d dimensions, not %d",
+						state->dimensions, *dim)));
+
+	return data;
+}
+
+/*
+ * Add an item of itemsize bytes to a list or data page.  Returns true if the
+ * item was successfully added to the page.  Returns false if it doesn't fit
+ * on the page.
+ */
+bool
+IvfPageAddItem(Page page, Size itemsize, const void *item)
+{
+	IvfPageOpaque opaque;
+	Pointer		ptr;
+
+	/* Does new item fit on the page? */
+	if (IvfPageGetFreeSpace(page, itemsize) < itemsize)
+		return false;
+
+	/* Copy new item to the end of page */
+	opaque = IvfPageGetOpaque(page);
+	ptr = IvfPageGetItem(page, itemsize, opaque->maxoff + 1);
+	memcpy(ptr, item, itemsize);
+
+	/* Adjust maxoff and pd_lower */
+	opaque->maxoff++;
+	((PageHeader) page)->pd_lower = ptr + itemsize - page;
+
+	/* Assert we didn't overrun available space */
+	Assert(((PageHeader) page)->pd_lower <= ((PageHeader) page)->pd_upper);
+
+	return true;
+}
+
+/*
+ * Allocate a new page by extending the index file.  Pages are never freed,
+ * since vacuum leaves emptied data pages in their lists' chains.
+ *
+ * The returned buffer is already pinned and exclusive-locked.  Caller is
+ * responsible for initializing the page by calling IvfInitPage.
+ */
+Buffer
+IvfNewBuffer(Relation index)
+{
+	Buffer		buffer;
+	bool		needLock;
+
+	needLock = !RELATION_IS_LOCAL(index);
+	if (needLock)
+		LockRelationForExtension(index, ExclusiveLock);
+
+	buffer = ReadBuffer(index, P_NEW);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+	if (needLock)
+		UnlockRelationForExtension(index, ExclusiveLock);
+
+	return buffer;
+}
+
+/*
+ * Initialize any page of an ivfflat index.
+ */
+void
+IvfInitPage(Page page, uint16 flags)
+{
+	IvfPageOpaque opaque;
+
+	PageInit(page, BLCKSZ, sizeof(IvfPageOpaqueData));
+
+	opaque = IvfPageGetOpaque(page);
+	opaque->nextblkno = InvalidBlockNumber;
+	opaque->flags = flags;
+	opaque->ivf_page_id = IVF_PAGE_ID;
+}
+
+/*
+ * Fill in metapage for ivfflat index.
+ */
+void
+IvfFillMetapage(Page metaPage, int dimensions, int nlists,
+				BlockNumber listHead)
+{
+	IvfMetaPageData *metadata;
+
+	IvfInitPage(metaPage, IVF_META);
+	metadata = IvfPageGetMeta(metaPage);
+	memset(metadata, 0, sizeof(IvfMetaPageData));
+	metadata->magickNumber = IVF_MAGICK_NUMBER;
+	metadata->dimensions = dimensions;
+	metadata->nlists = nlists;
+	metadata->listHead = listHead;
+	((PageHeader) metaPage)->pd_lower += sizeof(IvfMetaPageData);
+}
+
+/*
+ * Return the number of lists an index build should divide the vectors into.
+ */
+int
+IvfGetLists(Relation index)
+{
+	IvfOptions *opts = (IvfOptions *) index->rd_options;
+
+	if (opts)
+		return opts->lists;
+	return DEFAULT_IVF_LISTS;
+}
+
+/*
+ * Parse reloptions for ivfflat index, producing an IvfOptions struct.
+ */
+bytea *
+ivfoptions(Datum reloptions, bool validate)
+{
+	return (bytea *) build_reloptions(reloptions, validate,
+									  ivf_relopt_kind,
+									  sizeof(IvfOptions),
+									  ivf_relopt_tab,
+									  lengthof(ivf_relopt_tab));
+}
@@ -0,0 +1,167 @@
+/*-------------------------------------------------------------------------
+ *
+ * ivfvacuum.c
+ *		ivfflat VACUUM functions.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/ivfflat/ivfvacuum.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/generic_xlog.h"
+#include "commands/vacuum.h"
+#include "ivfflat.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+
+/*
+ * Bulk deletion of all index entries pointing to a set of heap tuples.
+ * The set of target tuples is specified via a callback routine that tells
+ * whether any given heap tuple (identified by ItemPointer) is being deleted.
+ *
+ * Emptied data pages are left in their lists' chains.  Only the last page of
+ * each list takes new tuples, so space freed on other pages is not reused
+ * until the index is rebuilt.
+ *
+ * Result: a palloc'd struct containing statistical info for VACUUM displays.
+ */
+IndexBulkDeleteResult *
+ivfbulkdelete(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
+			  IndexBulkDeleteCallback callback, void *callback_state)
+{
+	Relation	index = info->index;
+	BlockNumber blkno,
+				npages;
+	IvfState	state;
+	GenericXLogState *gxlogState;
+
+	if (stats == NULL)
+		stats = (IndexBulkDeleteResult *) palloc0(sizeof(IndexBulkDeleteResult));
+
+	initIvfState(&state, index);
+
+	/*
+	 * Iterate over the pages. We don't care about concurrently added pages,
+	 * they can't contain tuples to delete.
+	 */
+	npages = RelationGetNumberOfBlocks(index);
+	for (blkno = IVF_METAPAGE_BLKNO + 1; blkno < npages; blkno++)
+	{
+		Buffer		buffer;
+		Page		page;
+		Pointer		itup,
+					itupPtr,
+					itupEnd;
+
+		vacuum_delay_point();
+
+		buffer = ReadBufferExtended(index, MAIN_FORKNUM, blkno,
+									RBM_NORMAL, info->strategy);
+
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		gxlogState = GenericXLogStart(index);
+		page = GenericXLogRegisterBuffer(gxlogState, buffer, 0);
+
+		/* Only data pages have tuples */
+		if (PageIsNew(page) || !IvfPageIsData(page))
+		{
+			GenericXLogAbort(gxlogState);
+			UnlockReleaseBuffer(buffer);
+			continue;
+		}
+
+		/*
+		 * Iterate over the tuples.  itup points to current tuple being
+		 * scanned, itupPtr points to where to save next non-deleted tuple.
+		 */
+		itup = itupPtr = IvfPageGetItem(page, state.sizeOfTuple,
+										FirstOffsetNumber);
+		itupEnd = IvfPageGetItem(page, state.sizeOfTuple,
+								 OffsetNumberNext(IvfPageGetMaxOffset(page)));
+		while (itup < itupEnd)
+		{
+			/* Do we have to delete this tuple? */
+			if (callback(&((IvfTuple) itup)->heapPtr, callback_state))
+			{
+				/* Yes; adjust count of tuples that will be left on page */
+				IvfPageGetOpaque(page)->maxoff--;
+				stats->tuples_removed += 1;
+			}
+			else
+			{
+				/* No; copy it to itupPtr, but skip copy if not needed */
+				if (itupPtr != itup)
+					memmove(itupPtr, itup, state.sizeOfTuple);
+				itupPtr += state.sizeOfTuple;
+			}
+
+			itup += state.sizeOfTuple;
+		}
+
+		/* Did we delete something? */
+		if (itupPtr != itup)
+		{
+			/* Adjust pd_lower */
+			((PageHeader) page)->pd_lower = itupPtr - page;
+			/* Finish WAL-logging */
+			GenericXLogFinish(gxlogState);
+		}
+		else
+		{
+			/* Didn't change anything: abort WAL-logging */
+			GenericXLogAbort(gxlogState);
+		}
+		UnlockReleaseBuffer(buffer);
+	}
+
+	return stats;
+}
+
+/*
+ * Post-VACUUM cleanup.
+ *
+ * Result: a palloc'd struct containing statistical info for VACUUM displays.
+ */
+IndexBulkDeleteResult *
+ivfvacuumcleanup(IndexVacuumInfo *info, IndexBulkDeleteResult *stats)
+{
+	Relation	index = info->index;
+	BlockNumber npages,
+				blkno;
+
+	if (info->analyze_only)
+		return stats;
+
+	if (stats == NULL)
+		stats = (IndexBulkDeleteResult *) palloc0(sizeof(IndexBulkDeleteResult));
+
+	/* Iterate over the pages to collect statistics */
+	npages = RelationGetNumberOfBlocks(index);
+	stats->num_pages = npages;
+	stats->pages_free = 0;
+	stats->num_index_tuples = 0;
+	for (blkno = IVF_METAPAGE_BLKNO + 1; blkno < npages; blkno++)
+	{
+		Buffer		buffer;
+		Page		page;
+
+		vacuum_delay_point();
+
+		buffer = ReadBufferExtended(index, MAIN_FORKNUM, blkno,
+									RBM_NORMAL, info->strategy);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		page = (Page) BufferGetPage(buffer);
+
+		if (!PageIsNew(page) && IvfPageIsData(page))
+			stats->num_index_tuples += IvfPageGetMaxOffset(page);
+
+		UnlockReleaseBuffer(buffer);
+	}
+
+	return stats;
+}
@@ -0,0 +1,55 @@
+CREATE EXTENSION ivfflat;
+
+-- Distance functions
+SELECT l2_distance('{0,0}', '{3,4}');
+SELECT '{0,0}'::real[] <-> '{3,4}';
+SELECT inner_product('{1,2,3}', '{4,5,6}');
+SELECT '{1,2,3}'::real[] <#> '{4,5,6}';
+SELECT cosine_distance('{1,1}', '{2,2}'), '{1,0}'::real[] <=> '{0,1}';
+SELECT '{1,2}'::real[] <-> '{1,2,3}';
+SELECT '{{1,2},{3,4}}'::real[] <-> '{1,2}';
+SELECT '{1,NULL}'::real[] <-> '{1,2}';
+
+-- Vectors on a 10x10 grid, v = (id % 10, id / 10)
+CREATE TABLE ivftest (id int, v real[]);
+INSERT INTO ivftest SELECT i, ARRAY[i % 10, i / 10]::real[]
+  FROM generate_series(0, 99) i;
+CREATE INDEX ivftest_v_idx ON ivftest USING ivfflat (v) WITH (lists = 4);
+
+SET enable_seqscan = off;
+
+-- Probing all lists gives the exact answer
+SET ivfflat.probes = 4;
+EXPLAIN (COSTS OFF)
+SELECT id FROM ivftest ORDER BY v <-> '{3.2,4.3}' LIMIT 5;
+SELECT id FROM ivftest ORDER BY v <-> '{3.2,4.3}' LIMIT 5;
+SELECT count(*) FROM (SELECT id FROM ivftest ORDER BY v <-> '{3.2,4.3}') s;
+
+-- Probing one list skips the vectors of the others
+SET ivfflat.probes = 1;
+SELECT count(*) < 100 FROM (SELECT id FROM ivftest ORDER BY v <-> '{3.2,4.3}') s;
+SET ivfflat.probes = 4;
+
+-- Insertions, deletions and vacuum
+INSERT INTO ivftest VALUES (1000, '{3.2,4.3}');
+SELECT id FROM ivftest ORDER BY v <-> '{3.2,4.3}' LIMIT 3;
+INSERT INTO ivftest VALUES (2000, '{1,2,3}');
+DELETE FROM ivftest WHERE id IN (43, 1000);
+VACUUM ivftest;
+SELECT id FROM ivftest ORDER BY v <-> '{3.2,4.3}' LIMIT 3;
+
+-- Inner product and cosine distance
+CREATE INDEX ON ivftest USING ivfflat (v vector_ip_ops) WITH (lists = 1);
+SELECT id, v <#> '{1,1}' AS distance FROM ivftest ORDER BY v <#> '{1,1}' LIMIT 1;
+CREATE INDEX ON ivftest USING ivfflat (v vector_cosine_ops) WITH (lists = 2);
+SET ivfflat.probes = 2;
+SELECT id FROM ivftest ORDER BY v <=> '{1,0}' LIMIT 3;
+
+-- An index built without vectors gets its first list on insertion
+CREATE TABLE ivfempty (v real[]);
+CREATE INDEX ON ivfempty USING ivfflat (v);
+INSERT INTO ivfempty VALUES ('{1,2,3}'), ('{4,5,6}');
+SELECT v FROM ivfempty ORDER BY v <-> '{4,5,5}' LIMIT 1;
+
+RESET enable_seqscan;
+RESET ivfflat.probes;
@@ -0,0 +1,232 @@
+/*-------------------------------------------------------------------------
+ *
+ * vector.c
+ *		Distance functions for vectors stored as real[].
+ *
+ * The kernels accumulate into VECTOR_LANES independent partial sums, so that
+ * the compiler can keep them in one SIMD register without having to
+ * reassociate floating-point additions.  This file is compiled with
+ * CFLAGS_VECTORIZE, like src/backend/storage/page/checksum.c.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/ivfflat/vector.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "catalog/pg_type.h"
+#include "ivfflat.h"
+#include "utils/float.h"
+
+#define VECTOR_LANES	8
+
+PG_FUNCTION_INFO_V1(l2_distance);
+PG_FUNCTION_INFO_V1(inner_product);
+PG_FUNCTION_INFO_V1(negative_inner_product);
+PG_FUNCTION_INFO_V1(cosine_distance);
+
+/*
+ * Squared Euclidean distance between two vectors of dim dimensions.
+ */
+float8
+vector_l2_squared_distance(const float4 *a, const float4 *b, int dim)
+{
+	float4		sum[VECTOR_LANES] = {0};
+	float4		result = 0;
+	int			i = 0;
+
+	for (; i + VECTOR_LANES <= dim; i += VECTOR_LANES)
+	{
+		for (int j = 0; j < VECTOR_LANES; j++)
+		{
+			float4		diff = a[i + j] - b[i + j];
+
+			sum[j] += diff * diff;
+		}
+	}
+	for (; i < dim; i++)
+	{
+		float4		diff = a[i] - b[i];
+
+		result += diff * diff;
+	}
+	for (int j = 0; j < VECTOR_LANES; j++)
+		result += sum[j];
+
+	return (float8) result;
+}
+
+/*
+ * Inner product of two vectors of dim dimensions.
+ */
+float8
+vector_inner_product_internal(const float4 *a, const float4 *b, int dim)
+{
+	float4		sum[VECTOR_LANES] = {0};
+	float4		result = 0;
+	int			i = 0;
+
+	for (; i + VECTOR_LANES <= dim; i += VECTOR_LANES)
+	{
+		for (int j = 0; j < VECTOR_LANES; j++)
+			sum[j] += a[i + j] * b[i + j];
+	}
+	for (; i < dim; i++)
+		result += a[i] * b[i];
+	for (int j = 0; j < VECTOR_LANES; j++)
+		result += sum[j];
+
+	return (float8) result;
+}
+
+/*
+ * Cosine distance, that is one minus the cosine of the angle between two
+ * vectors of dim dimensions.  NaN if either vector is zero.
+ */
+float8
+vector_cosine_distance_internal(const float4 *a, const float4 *b, int dim)
+{
+	float4		dot[VECTOR_LANES] = {0};
+	float4		norma[VECTOR_LANES] = {0};
+	float4		normb[VECTOR_LANES] = {0};
+	float8		sumdot = 0;
+	float8		sumnorma = 0;
+	float8		sumnormb = 0;
+	float8		similarity;
+	int			i = 0;
+
+	for (; i + VECTOR_LANES <= dim; i += VECTOR_LANES)
+	{
+		for (int j = 0; j < VECTOR_LANES; j++)
+		{
+			dot[j] += a[i + j] * b[i + j];
+			norma[j] += a[i + j] * a[i + j];
+			normb[j] += b[i + j] * b[i + j];
+		}
+	}
+	for (; i < dim; i++)
+	{
+		sumdot += a[i] * b[i];
+		sumnorma += a[i] * a[i];
+		sumnormb += b[i] * b[i];
+	}
+	for (int j = 0; j < VECTOR_LANES; j++)
+	{
+		sumdot += dot[j];
+		sumnorma += norma[j];
+		sumnormb += normb[j];
+	}
+
+	if (sumnorma == 0 || sumnormb == 0)
+		return get_float8_nan();
+
+	/* Keep rounding errors from taking the result out of range */
+	similarity = sumdot / sqrt(sumnorma * sumnormb);
+	if (similarity > 1)
+		similarity = 1;
+	else if (similarity < -1)
+		similarity = -1;
+
+	return 1 - similarity;
+}
+
+/*
+ * Return the elements of a real[] used as a vector, and set *dim to its
+ * number of dimensions.  The array must be one-dimensional and non-empty,
+ * and contain no nulls.
+ */
+float4 *
+vector_get_data(ArrayType *array, int *dim)
+{
+	Assert(ARR_ELEMTYPE(array) == FLOAT4OID);
+
+	if (ARR_NDIM(array) != 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+				 errmsg("vector must be a one-dimensional array")));
+	if (ARR_HASNULL(array) && array_contains_nulls(array))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("vector must not contain nulls")));
+
+	*dim = ARR_DIMS(array)[0];
+	return (float4 *) ARR_DATA_PTR(array);
+}
+
+/*
+ * Fetch the elements of two vectors of the same number of dimensions.
+ */
+static int
+vector_get_pair(FunctionCallInfo fcinfo, float4 **a, float4 **b)
+{
+	int			dima;
+	int			dimb;
+
+	*a = vector_get_data(PG_GETARG_ARRAYTYPE_P(0), &dima);
+	*b = vector_get_data(PG_GETARG_ARRAYTYPE_P(1), &dimb);
+
+	if (dima != dimb)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_EXCEPTION),
+				 errmsg("different vector dimensions %d and %d", dima, dimb)));
+
+	return dima;
+}
+
+/*
+ * Euclidean distance, the <-> operator.
+ */
+Datum
+l2_distance(PG_FUNCTION_ARGS)
+{
+	float4	   *a;
+	float4	   *b;
+	int			dim = vector_get_pair(fcinfo, &a, &b);
+
+	PG_RETURN_FLOAT8(sqrt(vector_l2_squared_distance(a, b, dim)));
+}
+
+/*
+ * Inner product.
+ */
+Datum
+inner_product(PG_FUNCTION_ARGS)
+{
+	float4	   *a;
+	float4	   *b;
+	int			dim = vector_get_pair(fcinfo, &a, &b);
+
+	PG_RETURN_FLOAT8(vector_inner_product_internal(a, b, dim));
+}
+
+/*
+ * Negative inner product, the <#> operator, so that the closest vectors by
+ * inner product sort first.
+ */
+Datum
+negative_inner_product(PG_FUNCTION_ARGS)
+{
+	float4	   *a;
+	float4	   *b;
+	int			dim = vector_get_pair(fcinfo, &a, &b);
+
+	PG_RETURN_FLOAT8(-vector_inner_product_internal(a, b, dim));
+}
+
+/*
+ * Cosine distance, the <=> operator.
+ */
+Datum
+cosine_distance(PG_FUNCTION_ARGS)
+{
+	float4	   *a;
+	float4	   *b;
+	int			dim = vector_get_pair(fcinfo, &a, &b);
+
+	PG_RETURN_FLOAT8(vector_cosine_distance_internal(a, b, dim));
+}
@@ -47,6 +47,7 @@ PG_FUNCTION_INFO_V1(bt_page_items_bytea);
 PG_FUNCTION_INFO_V1(bt_page_stats_1_9);
 PG_FUNCTION_INFO_V1(bt_page_stats);
 PG_FUNCTION_INFO_V1(bt_multi_page_stats);
+PG_FUNCTION_INFO_V1(bt_page_prefix_stats);
 
 #define IS_INDEX(r) ((r)->rd_rel->relkind == RELKIND_INDEX)
 #define IS_BTREE(r) ((r)->rd_rel->relam == BTREE_AM_OID)
@@ -333,6 +334,147 @@ bt_page_stats(PG_FUNCTION_ARGS)
 }
 
 
+/* -----------------------------------------------
+ * bt_page_prefix_stats()
+ *
+ * Usage: SELECT * FROM bt_page_prefix_stats('t1_pkey', 1);
+ *
+ * Reports the length of the longest byte prefix that the first key column
+ * of all non-pivot tuples on a leaf page has in common, and an estimate of
+ * how many bytes storing that prefix only once per page would save.  This
+ * is only meaningful for variable-length key types; for others, and for
+ * internal pages, the prefix length is always zero.
+ * -----------------------------------------------
+ */
+Datum
+bt_page_prefix_stats(PG_FUNCTION_ARGS)
+{
+	text	   *relname = PG_GETARG_TEXT_PP(0);
+	int64		blkno = PG_GETARG_INT64(1);
+	Buffer		buffer;
+	Relation	rel;
+	RangeVar   *relrv;
+	Page		page;
+	BTPageOpaque opaque;
+	TupleDesc	itupdesc;
+	TupleDesc	tupleDesc;
+	OffsetNumber offnum;
+	OffsetNumber maxoff;
+	char	   *prefix = NULL;
+	int32		prefixlen = 0;
+	int32		nitems = 0;
+	int64		saved = 0;
+	bool		varlena;
+	Datum		values[3];
+	bool		nulls[3] = {0};
+
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to use pageinspect functions")));
+
+	relrv = makeRangeVarFromNameList(textToQualifiedNameList(relname));
+	rel = relation_openrv(relrv, AccessShareLock);
+
+	bt_index_block_validate(rel, blkno);
+
+	itupdesc = RelationGetDescr(rel);
+	varlena = TupleDescAttr(itupdesc, 0)->attlen == -1;
+
+	buffer = ReadBuffer(rel, blkno);
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+
+	page = BufferGetPage(buffer);
+	opaque = BTPageGetOpaque(page);
+	maxoff = PageGetMaxOffsetNumber(page);
+
+	if (P_ISLEAF(opaque) && !P_IGNORE(opaque))
+	{
+		/* First pass: find the common prefix */
+		for (offnum = P_FIRSTDATAKEY(opaque);
+			 offnum <= maxoff;
+			 offnum = OffsetNumberNext(offnum))
+		{
+			IndexTuple	itup;
+			Datum		datum;
+			bool		isnull;
+			struct varlena *val;
+			int32		len;
+			int32		i;
+
+			itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+			nitems++;
+
+			if (!varlena)
+				continue;
+
+			datum = index_getattr(itup, 1, itupdesc, &isnull);
+			if (isnull)
+				continue;
+
+			val = (struct varlena *) DatumGetPointer(datum);
+			if (VARATT_IS_EXTENDED(val) && !VARATT_IS_SHORT(val))
+			{
+				/* compressed values can't share a prefix */
+				varlena = false;
+				prefixlen = 0;
+				continue;
+			}
+
+			len = VARSIZE_ANY_EXHDR(val);
+			if (prefix == NULL)
+			{
+				prefix = VARDATA_ANY(val);
+				prefixlen = len;
+				continue;
+			}
+
+			for (i = 0; i < Min(len, prefixlen); i++)
+			{
+				if (prefix[i] != VARDATA_ANY(val)[i])
+					break;
+			}
+			prefixlen = i;
+		}
+
+		/* Second pass: estimate the space saved by storing it once */
+		if (varlena && prefixlen > 0)
+		{
+			for (offnum = P_FIRSTDATAKEY(opaque);
+				 offnum <= maxoff;
+				 offnum = OffsetNumberNext(offnum))
+			{
+				IndexTuple	itup;
+				bool		isnull;
+				Size		sz;
+
+				itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+				(void) index_getattr(itup, 1, itupdesc, &isnull);
+				if (isnull)
+					continue;
+
+				sz = IndexTupleSize(itup);
+				saved += MAXALIGN(sz) - MAXALIGN(sz - prefixlen);
+			}
+			saved -= prefixlen;
+		}
+	}
+
+	UnlockReleaseBuffer(buffer);
+	relation_close(rel, AccessShareLock);
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupleDesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	values[0] = Int32GetDatum(prefixlen);
+	values[1] = Int32GetDatum(nitems);
+	values[2] = Int64GetDatum(Max(saved, 0));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupleDesc, values, nulls)));
+}
+
+
 /* -----------------------------------------------
  * bt_multi_page_stats()
  *
@@ -0,0 +1,14 @@
+/* contrib/pageinspect/pageinspect--1.12--1.13.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION pageinspect UPDATE TO '1.13'" to load this file. \quit
+
+--
+-- bt_page_prefix_stats()
+--
+CREATE FUNCTION bt_page_prefix_stats(IN relname text, IN blkno int8,
+    OUT common_prefix_len int4,
+    OUT items int4,
+    OUT saved_bytes int8)
+AS 'MODULE_PATHNAME', 'bt_page_prefix_stats'
+LANGUAGE C STRICT PARALLEL RESTRICTED;
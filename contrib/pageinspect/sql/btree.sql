@@ -22,6 +22,14 @@ SELECT * FROM bt_multi_page_stats('test2_col1_idx', 3, 2);
 SELECT * FROM bt_multi_page_stats('test2_col1_idx', 7, 2);
 DROP TABLE test2;
 
+-- bt_page_prefix_stats() reports the common key prefix of a leaf page.
+SELECT * FROM bt_page_prefix_stats('test1_a_idx', 1);
+CREATE TABLE test3 AS
+  SELECT 'https://example.com/page/' || i AS url FROM generate_series(1, 10) i;
+CREATE INDEX test3_url_idx ON test3 (url);
+SELECT * FROM bt_page_prefix_stats('test3_url_idx', 1);
+DROP TABLE test3;
+
 SELECT * FROM bt_page_items('test1_a_idx', -1);
 SELECT * FROM bt_page_items('test1_a_idx', 0);
 SELECT * FROM bt_page_items('test1_a_idx', 1);
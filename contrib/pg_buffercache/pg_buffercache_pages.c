@@ -8,16 +8,23 @@
  */
 #include "postgres.h"
 
+#include <math.h>
+
 #include "access/htup_details.h"
 #include "catalog/pg_type.h"
+#include "common/pg_prng.h"
 #include "funcapi.h"
+#include "port/pg_numa.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "utils/hsearch.h"
 
 
 #define NUM_BUFFERCACHE_PAGES_MIN_ELEM	8
-#define NUM_BUFFERCACHE_PAGES_ELEM	9
+#define NUM_BUFFERCACHE_PAGES_ELEM	10
 #define NUM_BUFFERCACHE_SUMMARY_ELEM 5
+#define NUM_BUFFERCACHE_USAGE_COUNTS_ELEM 4
+#define NUM_BUFFERCACHE_RELATIONS_ELEM 8
 
 PG_MODULE_MAGIC;
 
@@ -42,9 +49,26 @@ typedef struct
 	 * because of bufmgr.c's PrivateRefCount infrastructure.
 	 */
 	int32		pinning_backends;
+
+	/* NUMA node of the buffer's memory, or -1 if not known */
+	int32		numa_node;
 } BufferCachePagesRec;
 
 
+/*
+ * Entry of the hash table used by pg_buffercache_relations() to count the
+ * buffers of each relation fork.
+ */
+typedef struct
+{
+	BufferTag	key;			/* hash key, blockNum is always 0 */
+	int64		buffers;
+	int64		buffers_dirty;
+	int64		buffers_pinned;
+	int64		usagecount_total;
+} BufferCacheRelationsEntry;
+
+
 /*
  * Function context for data persisting over repeated calls.
  */
@@ -61,6 +85,49 @@ typedef struct
  */
 PG_FUNCTION_INFO_V1(pg_buffercache_pages);
 PG_FUNCTION_INFO_V1(pg_buffercache_summary);
+PG_FUNCTION_INFO_V1(pg_buffercache_usage_counts);
+PG_FUNCTION_INFO_V1(pg_buffercache_relations);
+
+/*
+ * Look up the NUMA node of each buffer, that is of the first memory page of
+ * the buffer, and store it in the records.  Nodes stay unknown if NUMA is not
+ * supported.
+ */
+static void
+get_buffer_numa_nodes(BufferCachePagesRec *record)
+{
+#define NUMA_QUERY_BATCH 1024
+	void	   *pages[NUMA_QUERY_BATCH];
+	int			status[NUMA_QUERY_BATCH];
+
+	if (pg_numa_init() != 0)
+		return;
+
+	for (int start = 0; start < NBuffers; start += NUMA_QUERY_BATCH)
+	{
+		int			n = Min(NUMA_QUERY_BATCH, NBuffers - start);
+
+		for (int i = 0; i < n; i++)
+		{
+			pages[i] = BufferGetBlock(start + i + 1);
+
+			/*
+			 * The kernel only reports the node of pages that are mapped into
+			 * our address space, so touch the page first.
+			 */
+			(void) *(volatile char *) pages[i];
+		}
+
+		if (pg_numa_query_pages(0, n, pages, status) != 0)
+			ereport(ERROR,
+					(errmsg("could not query NUMA node of shared buffers: %m")));
+
+		for (int i = 0; i < n; i++)
+			record[start + i].numa_node = status[i];
+
+		CHECK_FOR_INTERRUPTS();
+	}
+}
 
 Datum
 pg_buffercache_pages(PG_FUNCTION_ARGS)
@@ -86,9 +153,9 @@ pg_buffercache_pages(PG_FUNCTION_ARGS)
 		fctx = (BufferCachePagesContext *) palloc(sizeof(BufferCachePagesContext));
 
 		/*
-		 * To smoothly support upgrades from version 1.0 of this extension
+		 * To smoothly support upgrades from older versions of this extension
 		 * transparently handle the (non-)existence of the pinning_backends
-		 * column. We unfortunately have to get the result type for that... -
+		 * and numa_node columns. We unfortunately have to get the result type for that... -
 		 * we can't use the result type determined by the function definition
 		 * without potentially crashing when somebody uses the old (or even
 		 * wrong) function definition though.
@@ -119,9 +186,12 @@ pg_buffercache_pages(PG_FUNCTION_ARGS)
 		TupleDescInitEntry(tupledesc, (AttrNumber) 8, "usage_count",
 						   INT2OID, -1, 0);
 
-		if (expected_tupledesc->natts == NUM_BUFFERCACHE_PAGES_ELEM)
+		if (expected_tupledesc->natts >= 9)
 			TupleDescInitEntry(tupledesc, (AttrNumber) 9, "pinning_backends",
 							   INT4OID, -1, 0);
+		if (expected_tupledesc->natts >= 10)
+			TupleDescInitEntry(tupledesc, (AttrNumber) 10, "numa_node",
+							   INT4OID, -1, 0);
 
 		fctx->tupdesc = BlessTupleDesc(tupledesc);
 
@@ -175,7 +245,12 @@ pg_buffercache_pages(PG_FUNCTION_ARGS)
 				fctx->record[i].isvalid = false;
 
 			UnlockBufHdr(bufHdr, buf_state);
+
+			fctx->record[i].numa_node = -1;
 		}
+
+		if (expected_tupledesc->natts >= 10)
+			get_buffer_numa_nodes(fctx->record);
 	}
 
 	funcctx = SRF_PERCALL_SETUP();
@@ -230,6 +305,10 @@ pg_buffercache_pages(PG_FUNCTION_ARGS)
 			nulls[8] = false;
 		}
 
+		/* unused for pre-v1.5 callers, but the array is always long enough */
+		values[9] = Int32GetDatum(fctx->record[i].numa_node);
+		nulls[9] = (fctx->record[i].numa_node < 0);
+
 		/* Build and return the tuple. */
 		tuple = heap_form_tuple(fctx->tupdesc, values, nulls);
 		result = HeapTupleGetDatum(tuple);
@@ -304,3 +383,152 @@ pg_buffercache_summary(PG_FUNCTION_ARGS)
 
 	PG_RETURN_DATUM(result);
 }
+
+/*
+ * Return the number of buffers, dirty buffers and pinned buffers for each
+ * usage count.  Like pg_buffercache_summary(), this only reads the state of
+ * each buffer header, without locking it.
+ */
+Datum
+pg_buffercache_usage_counts(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	int			usage_counts[BM_MAX_USAGE_COUNT + 1] = {0};
+	int			dirty[BM_MAX_USAGE_COUNT + 1] = {0};
+	int			pinned[BM_MAX_USAGE_COUNT + 1] = {0};
+	Datum		values[NUM_BUFFERCACHE_USAGE_COUNTS_ELEM];
+	bool		nulls[NUM_BUFFERCACHE_USAGE_COUNTS_ELEM] = {0};
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	for (int i = 0; i < NBuffers; i++)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(i);
+		uint32		buf_state = pg_atomic_read_u32(&bufHdr->state);
+		int			usage_count;
+
+		usage_count = BUF_STATE_GET_USAGECOUNT(buf_state);
+		usage_counts[usage_count]++;
+
+		if (buf_state & BM_DIRTY)
+			dirty[usage_count]++;
+
+		if (BUF_STATE_GET_REFCOUNT(buf_state) > 0)
+			pinned[usage_count]++;
+	}
+
+	for (int i = 0; i < BM_MAX_USAGE_COUNT + 1; i++)
+	{
+		values[0] = Int32GetDatum(i);
+		values[1] = Int32GetDatum(usage_counts[i]);
+		values[2] = Int32GetDatum(dirty[i]);
+		values[3] = Int32GetDatum(pinned[i]);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	return (Datum) 0;
+}
+
+/*
+ * Return the number of buffers, dirty buffers and pinned buffers of each
+ * relation fork present in the buffer cache, in a single pass over the
+ * buffer headers.
+ *
+ * The buffer headers are not locked.  The tag of a buffer is only read if
+ * its header was not locked before and after reading it, so a buffer that
+ * is being replaced is skipped rather than attributed to a relation it does
+ * not belong to; the result is therefore only approximate.  If
+ * sample_fraction is less than 1, only that fraction of the buffers, chosen
+ * at random, is examined, and the counts are scaled up accordingly.
+ */
+Datum
+pg_buffercache_relations(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	double		sample_fraction = PG_GETARG_FLOAT8(0);
+	HASHCTL		hash_ctl;
+	HTAB	   *relations;
+	HASH_SEQ_STATUS hash_seq;
+	BufferCacheRelationsEntry *entry;
+	Datum		values[NUM_BUFFERCACHE_RELATIONS_ELEM];
+	bool		nulls[NUM_BUFFERCACHE_RELATIONS_ELEM] = {0};
+
+	if (!(sample_fraction > 0 && sample_fraction <= 1))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("sample fraction must be greater than 0 and at most 1")));
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	hash_ctl.keysize = sizeof(BufferTag);
+	hash_ctl.entrysize = sizeof(BufferCacheRelationsEntry);
+	hash_ctl.hcxt = CurrentMemoryContext;
+	relations = hash_create("pg_buffercache relations", 1024, &hash_ctl,
+							HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	for (int i = 0; i < NBuffers; i++)
+	{
+		BufferDesc *bufHdr;
+		uint32		buf_state;
+		BufferTag	tag;
+		bool		found;
+
+		if (sample_fraction < 1 &&
+			pg_prng_double(&pg_global_prng_state) >= sample_fraction)
+			continue;
+
+		if ((i & 1023) == 0)
+			CHECK_FOR_INTERRUPTS();
+
+		bufHdr = GetBufferDescriptor(i);
+		buf_state = pg_atomic_read_u32(&bufHdr->state);
+		if (!(buf_state & BM_VALID) || (buf_state & BM_LOCKED))
+			continue;
+
+		pg_read_barrier();
+		tag = bufHdr->tag;
+		pg_read_barrier();
+
+		if (pg_atomic_read_u32(&bufHdr->state) & BM_LOCKED)
+			continue;
+
+		tag.blockNum = 0;
+		entry = (BufferCacheRelationsEntry *) hash_search(relations, &tag,
+														  HASH_ENTER, &found);
+		if (!found)
+		{
+			entry->buffers = 0;
+			entry->buffers_dirty = 0;
+			entry->buffers_pinned = 0;
+			entry->usagecount_total = 0;
+		}
+
+		entry->buffers++;
+		entry->usagecount_total += BUF_STATE_GET_USAGECOUNT(buf_state);
+		if (buf_state & BM_DIRTY)
+			entry->buffers_dirty++;
+		if (BUF_STATE_GET_REFCOUNT(buf_state) > 0)
+			entry->buffers_pinned++;
+	}
+
+	hash_seq_init(&hash_seq, relations);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		values[0] = ObjectIdGetDatum(BufTagGetRelNumber(&entry->key));
+		values[1] = ObjectIdGetDatum(entry->key.spcOid);
+		values[2] = ObjectIdGetDatum(entry->key.dbOid);
+		values[3] = Int16GetDatum(BufTagGetForkNum(&entry->key));
+		values[4] = Int64GetDatum((int64) rint(entry->buffers / sample_fraction));
+		values[5] = Int64GetDatum((int64) rint(entry->buffers_dirty / sample_fraction));
+		values[6] = Int64GetDatum((int64) rint(entry->buffers_pinned / sample_fraction));
+		values[7] = Float8GetDatum((double) entry->usagecount_total /
+								   entry->buffers);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	hash_destroy(relations);
+
+	return (Datum) 0;
+}
@@ -5,20 +5,44 @@ select count(*) = (select setting::bigint
                    where name = 'shared_buffers')
 from pg_buffercache;
 
+-- the node is null if unknown, never negative
+select count(*) = 0 from pg_buffercache where numa_node < 0;
+
 select buffers_used + buffers_unused > 0,
         buffers_dirty <= buffers_used,
         buffers_pinned <= buffers_used
 from pg_buffercache_summary();
 
+SELECT count(*) > 0 FROM pg_buffercache_usage_counts() WHERE buffers >= 0;
+
+SELECT sum(buffers) = (SELECT setting::bigint
+                       FROM pg_settings
+                       WHERE name = 'shared_buffers')
+FROM pg_buffercache_usage_counts();
+
+SELECT count(*) > 0,
+       bool_and(buffers_dirty <= buffers),
+       bool_and(buffers_pinned <= buffers)
+FROM pg_buffercache_relations();
+
+SELECT count(*) > 0 FROM pg_buffercache_relations(0.5) WHERE buffers > 0;
+
+SELECT * FROM pg_buffercache_relations(0);
+SELECT * FROM pg_buffercache_relations(1.5);
+
 -- Check that the functions / views can't be accessed by default. To avoid
 -- having to create a dedicated user, use the pg_database_owner pseudo-role.
 SET ROLE pg_database_owner;
 SELECT * FROM pg_buffercache;
 SELECT * FROM pg_buffercache_pages() AS p (wrong int);
 SELECT * FROM pg_buffercache_summary();
+SELECT * FROM pg_buffercache_usage_counts();
+SELECT * FROM pg_buffercache_relations();
 RESET role;
 
 -- Check that pg_monitor is allowed to query view / function
 SET ROLE pg_monitor;
 SELECT count(*) > 0 FROM pg_buffercache;
 SELECT buffers_used + buffers_unused > 0 FROM pg_buffercache_summary();
+SELECT count(*) > 0 FROM pg_buffercache_usage_counts();
+SELECT count(*) > 0 FROM pg_buffercache_relations();
@@ -0,0 +1,69 @@
+/* contrib/pg_cost_calibration/pg_cost_calibration--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION pg_cost_calibration" to load this file. \quit
+
+CREATE FUNCTION pg_cost_calibration(
+    OUT spcoid oid,
+    OUT spcname name,
+    OUT seq_blks_read int8,
+    OUT seq_read_time float8,
+    OUT random_blks_read int8,
+    OUT random_read_time float8,
+    OUT tuples float8,
+    OUT cpu_time float8,
+    OUT estimated_cost float8,
+    OUT actual_time float8,
+    OUT seq_page_cost float8,
+    OUT random_page_cost float8,
+    OUT cpu_tuple_cost float8
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE PARALLEL SAFE;
+
+CREATE FUNCTION pg_cost_calibration_reset()
+RETURNS void
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT PARALLEL SAFE;
+
+-- Set the recommended page costs as tablespace options
+CREATE FUNCTION pg_cost_calibration_apply(
+    OUT spcname name,
+    OUT seq_page_cost float8,
+    OUT random_page_cost float8
+)
+RETURNS SETOF record
+AS $$
+DECLARE
+    r record;
+    opts text[];
+BEGIN
+    FOR r IN SELECT c.spcname, c.seq_page_cost, c.random_page_cost
+             FROM @extschema@.pg_cost_calibration() c
+             WHERE c.spcname IS NOT NULL AND
+                   (c.seq_page_cost IS NOT NULL OR c.random_page_cost IS NOT NULL)
+    LOOP
+        opts := '{}';
+        spcname := r.spcname;
+        seq_page_cost := round(r.seq_page_cost::numeric, 4);
+        random_page_cost := round(r.random_page_cost::numeric, 4);
+        IF seq_page_cost IS NOT NULL THEN
+            opts := opts || format('seq_page_cost = %s', seq_page_cost);
+        END IF;
+        IF random_page_cost IS NOT NULL THEN
+            opts := opts || format('random_page_cost = %s', random_page_cost);
+        END IF;
+        EXECUTE format('ALTER TABLESPACE %I SET (%s)',
+                       spcname, array_to_string(opts, ', '));
+        RETURN NEXT;
+    END LOOP;
+END
+$$ LANGUAGE plpgsql VOLATILE;
+
+-- Don't want these to be available to non-superusers.
+REVOKE ALL ON FUNCTION pg_cost_calibration_reset() FROM PUBLIC;
+REVOKE ALL ON FUNCTION pg_cost_calibration_apply() FROM PUBLIC;
+
+GRANT EXECUTE ON FUNCTION pg_cost_calibration() TO pg_read_all_stats;
+REVOKE ALL ON FUNCTION pg_cost_calibration() FROM PUBLIC;
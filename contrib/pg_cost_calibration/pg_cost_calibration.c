@@ -0,0 +1,625 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_cost_calibration.c
+ *		Derive planner cost parameters from observed execution statistics.
+ *
+ * For a sample of statements, we turn on per-node timing and buffer
+ * instrumentation, and when the statement finishes, walk its plan state tree
+ * collecting, for each scan node, the blocks it read and the time spent
+ * reading them, the tuples it processed and the remaining (CPU) time, and its
+ * estimated cost.  The numbers are totaled per tablespace of the scanned
+ * relation, in a small shared hashtable.
+ *
+ * Sequential scans count as sequential I/O; index and bitmap scans count as
+ * random I/O.  From the average time per block read, relative to the average
+ * over sequential reads in all tablespaces (which is taken to be worth the
+ * current seq_page_cost), we derive recommended values for the per-tablespace
+ * seq_page_cost and random_page_cost options, and for cpu_tuple_cost.  Read
+ * times are only available with track_io_timing enabled.
+ *
+ * Note about locking: the hashtable and all counters in it are protected by
+ * a single LWLock, which is taken once per sampled statement.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/pg_cost_calibration/pg_cost_calibration.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/parallel.h"
+#include "catalog/pg_tablespace.h"
+#include "commands/tablespace.h"
+#include "common/pg_prng.h"
+#include "executor/executor.h"
+#include "executor/instrument.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/rel.h"
+
+PG_MODULE_MAGIC;
+
+/* Maximum number of tablespaces we keep statistics for */
+#define CC_MAX_TABLESPACES	64
+
+#define PG_COST_CALIBRATION_COLS	13
+
+/*
+ * Statistics collected for the scans of relations in one tablespace
+ */
+typedef struct ccCounters
+{
+	int64		seq_blks_read;	/* blocks read by sequential scans */
+	double		seq_read_time;	/* time spent reading them, in msec */
+	int64		random_blks_read;	/* blocks read by index and bitmap scans */
+	double		random_read_time;	/* time spent reading them, in msec */
+	double		tuples;			/* tuples processed by scans */
+	double		cpu_time;		/* scan time not spent reading, in msec */
+	double		estimated_cost; /* estimated total cost of scans */
+	double		actual_time;	/* actual total time of scans, in msec */
+} ccCounters;
+
+/*
+ * Hashtable entry, keyed by tablespace OID
+ */
+typedef struct ccEntry
+{
+	Oid			spcoid;			/* hash key of entry - MUST BE FIRST */
+	ccCounters	counters;
+} ccEntry;
+
+/*
+ * Global shared state
+ */
+typedef struct ccSharedState
+{
+	LWLock	   *lock;			/* protects hashtable and counters */
+} ccSharedState;
+
+/* Current nesting depth of ExecutorRun+ExecutorFinish calls */
+static int	nesting_level = 0;
+
+/* Is the current top-level statement being sampled? */
+static bool current_query_sampled = false;
+
+/* Saved hook values in case of unload */
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+static ExecutorStart_hook_type prev_ExecutorStart = NULL;
+static ExecutorRun_hook_type prev_ExecutorRun = NULL;
+static ExecutorFinish_hook_type prev_ExecutorFinish = NULL;
+static ExecutorEnd_hook_type prev_ExecutorEnd = NULL;
+
+/* Links to shared memory state */
+static ccSharedState *cc = NULL;
+static HTAB *cc_hash = NULL;
+
+/* GUC variables */
+static double cc_sample_rate = 0.01;	/* fraction of statements to sample */
+static int	cc_min_blocks = 1000;	/* blocks read needed to recommend */
+
+#define cc_enabled() \
+	(cc_sample_rate > 0 && nesting_level == 0 && current_query_sampled)
+
+PG_FUNCTION_INFO_V1(pg_cost_calibration);
+PG_FUNCTION_INFO_V1(pg_cost_calibration_reset);
+
+static void cc_shmem_request(void);
+static void cc_shmem_startup(void);
+static void cc_ExecutorStart(QueryDesc *queryDesc, int eflags);
+static void cc_ExecutorRun(QueryDesc *queryDesc,
+						   ScanDirection direction,
+						   uint64 count, bool execute_once);
+static void cc_ExecutorFinish(QueryDesc *queryDesc);
+static void cc_ExecutorEnd(QueryDesc *queryDesc);
+static bool cc_collect_walker(PlanState *planstate, void *context);
+static ccCounters *cc_local_counters(HTAB *local, Relation rel);
+static Size cc_memsize(void);
+
+
+/*
+ * Module load callback
+ */
+void
+_PG_init(void)
+{
+	/*
+	 * We need to be loaded via shared_preload_libraries, to get our shared
+	 * memory.
+	 */
+	if (!process_shared_preload_libraries_in_progress)
+		return;
+
+	/* Define custom GUC variables. */
+	DefineCustomRealVariable("pg_cost_calibration.sample_rate",
+							 "Fraction of statements whose execution statistics are collected.",
+							 "Collected statements run with per-node timing, which has some overhead.",
+							 &cc_sample_rate,
+							 0.01,
+							 0.0,
+							 1.0,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("pg_cost_calibration.min_blocks",
+							"Sets the minimum number of blocks read before recommending a page cost.",
+							NULL,
+							&cc_min_blocks,
+							1000,
+							1,
+							INT_MAX,
+							PGC_SUSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	MarkGUCPrefixReserved("pg_cost_calibration");
+
+	/*
+	 * Install hooks.
+	 */
+	prev_shmem_request_hook = shmem_request_hook;
+	shmem_request_hook = cc_shmem_request;
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = cc_shmem_startup;
+	prev_ExecutorStart = ExecutorStart_hook;
+	ExecutorStart_hook = cc_ExecutorStart;
+	prev_ExecutorRun = ExecutorRun_hook;
+	ExecutorRun_hook = cc_ExecutorRun;
+	prev_ExecutorFinish = ExecutorFinish_hook;
+	ExecutorFinish_hook = cc_ExecutorFinish;
+	prev_ExecutorEnd = ExecutorEnd_hook;
+	ExecutorEnd_hook = cc_ExecutorEnd;
+}
+
+/*
+ * shmem_request hook: request additional shared resources.  We'll allocate or
+ * attach to the shared resources in cc_shmem_startup().
+ */
+static void
+cc_shmem_request(void)
+{
+	if (prev_shmem_request_hook)
+		prev_shmem_request_hook();
+
+	RequestAddinShmemSpace(cc_memsize());
+	RequestNamedLWLockTranche("pg_cost_calibration", 1);
+}
+
+/*
+ * shmem_startup hook: allocate or attach to shared memory
+ */
+static void
+cc_shmem_startup(void)
+{
+	bool		found;
+	HASHCTL		info;
+
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
+
+	/* reset in case this is a restart within the postmaster */
+	cc = NULL;
+	cc_hash = NULL;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	cc = ShmemInitStruct("pg_cost_calibration",
+						 sizeof(ccSharedState),
+						 &found);
+	if (!found)
+		cc->lock = &(GetNamedLWLockTranche("pg_cost_calibration"))->lock;
+
+	info.keysize = sizeof(Oid);
+	info.entrysize = sizeof(ccEntry);
+	cc_hash = ShmemInitHash("pg_cost_calibration hash",
+							CC_MAX_TABLESPACES, CC_MAX_TABLESPACES,
+							&info,
+							HASH_ELEM | HASH_BLOBS);
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+/*
+ * ExecutorStart hook: enable instrumentation for sampled statements
+ */
+static void
+cc_ExecutorStart(QueryDesc *queryDesc, int eflags)
+{
+	/*
+	 * At the beginning of each top-level statement, decide whether we'll
+	 * sample it.  In a parallel worker, the leader has made that decision
+	 * for us, and collects the workers' instrumentation itself.
+	 */
+	if (nesting_level == 0)
+	{
+		if (cc_sample_rate > 0 && !IsParallelWorker())
+			current_query_sampled = (pg_prng_double(&pg_global_prng_state) < cc_sample_rate);
+		else
+			current_query_sampled = false;
+	}
+
+	if (cc_enabled() && (eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0)
+		queryDesc->instrument_options |= INSTRUMENT_TIMER | INSTRUMENT_BUFFERS;
+
+	if (prev_ExecutorStart)
+		prev_ExecutorStart(queryDesc, eflags);
+	else
+		standard_ExecutorStart(queryDesc, eflags);
+}
+
+/*
+ * ExecutorRun hook: all we need do is track nesting depth
+ */
+static void
+cc_ExecutorRun(QueryDesc *queryDesc, ScanDirection direction,
+			   uint64 count, bool execute_once)
+{
+	nesting_level++;
+	PG_TRY();
+	{
+		if (prev_ExecutorRun)
+			prev_ExecutorRun(queryDesc, direction, count, execute_once);
+		else
+			standard_ExecutorRun(queryDesc, direction, count, execute_once);
+	}
+	PG_FINALLY();
+	{
+		nesting_level--;
+	}
+	PG_END_TRY();
+}
+
+/*
+ * ExecutorFinish hook: all we need do is track nesting depth
+ */
+static void
+cc_ExecutorFinish(QueryDesc *queryDesc)
+{
+	nesting_level++;
+	PG_TRY();
+	{
+		if (prev_ExecutorFinish)
+			prev_ExecutorFinish(queryDesc);
+		else
+			standard_ExecutorFinish(queryDesc);
+	}
+	PG_FINALLY();
+	{
+		nesting_level--;
+	}
+	PG_END_TRY();
+}
+
+/*
+ * ExecutorEnd hook: add the statement's scan statistics to the shared totals
+ */
+static void
+cc_ExecutorEnd(QueryDesc *queryDesc)
+{
+	PlanState  *planstate = queryDesc->planstate;
+
+	if (cc && cc_enabled() && planstate != NULL &&
+		planstate->instrument != NULL && planstate->instrument->need_timer &&
+		planstate->instrument->need_bufusage)
+	{
+		MemoryContext oldcxt;
+		HASHCTL		info;
+		HTAB	   *local;
+		HASH_SEQ_STATUS hash_seq;
+		ccEntry    *lentry;
+
+		/*
+		 * Make sure we operate in the per-query context, so any cruft will be
+		 * discarded later during ExecutorEnd.
+		 */
+		oldcxt = MemoryContextSwitchTo(queryDesc->estate->es_query_cxt);
+
+		/* Total up the statement by tablespace first, to lock only once */
+		info.keysize = sizeof(Oid);
+		info.entrysize = sizeof(ccEntry);
+		info.hcxt = CurrentMemoryContext;
+		local = hash_create("pg_cost_calibration local hash", 8, &info,
+							HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+		cc_collect_walker(planstate, local);
+
+		LWLockAcquire(cc->lock, LW_EXCLUSIVE);
+		hash_seq_init(&hash_seq, local);
+		while ((lentry = hash_seq_search(&hash_seq)) != NULL)
+		{
+			ccEntry    *entry;
+			bool		found;
+
+			/* If the table is full, statistics for new tablespaces are lost */
+			entry = hash_search(cc_hash, &lentry->spcoid, HASH_ENTER_NULL,
+								&found);
+			if (entry == NULL)
+				continue;
+			if (!found)
+				memset(&entry->counters, 0, sizeof(ccCounters));
+
+			entry->counters.seq_blks_read += lentry->counters.seq_blks_read;
+			entry->counters.seq_read_time += lentry->counters.seq_read_time;
+			entry->counters.random_blks_read += lentry->counters.random_blks_read;
+			entry->counters.random_read_time += lentry->counters.random_read_time;
+			entry->counters.tuples += lentry->counters.tuples;
+			entry->counters.cpu_time += lentry->counters.cpu_time;
+			entry->counters.estimated_cost += lentry->counters.estimated_cost;
+			entry->counters.actual_time += lentry->counters.actual_time;
+		}
+		LWLockRelease(cc->lock);
+
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	if (prev_ExecutorEnd)
+		prev_ExecutorEnd(queryDesc);
+	else
+		standard_ExecutorEnd(queryDesc);
+}
+
+/*
+ * Collect the statistics of one plan node, if it's a scan we know about, and
+ * recurse to its children.
+ */
+static bool
+cc_collect_walker(PlanState *planstate, void *context)
+{
+	HTAB	   *local = (HTAB *) context;
+	Instrumentation *instr = planstate->instrument;
+	Relation	rel = NULL;
+	bool		sequential = false;
+	bool		count_tuples = true;
+	Instrumentation *child = NULL;
+
+	if (instr == NULL)
+		return false;
+
+	switch (nodeTag(planstate))
+	{
+		case T_SeqScanState:
+			rel = ((ScanState *) planstate)->ss_currentRelation;
+			sequential = true;
+			break;
+		case T_IndexScanState:
+			rel = ((ScanState *) planstate)->ss_currentRelation;
+			break;
+		case T_IndexOnlyScanState:
+			rel = ((IndexOnlyScanState *) planstate)->ioss_RelationDesc;
+			break;
+		case T_BitmapIndexScanState:
+			/* The heap scan above us counts the tuples */
+			rel = ((BitmapIndexScanState *) planstate)->biss_RelationDesc;
+			count_tuples = false;
+			break;
+		case T_BitmapHeapScanState:
+			/* Our totals include the bitmap index scans below us */
+			rel = ((ScanState *) planstate)->ss_currentRelation;
+			child = outerPlanState(planstate)->instrument;
+			break;
+		default:
+			break;
+	}
+
+	if (rel != NULL)
+	{
+		ccCounters *counters = cc_local_counters(local, rel);
+		BufferUsage bufusage;
+		double		total;
+		double		read_time;
+
+		/* Make sure stats accumulation is done */
+		InstrEndLoop(instr);
+		total = instr->total * 1000.0;
+		bufusage = instr->bufusage;
+
+		if (child != NULL)
+		{
+			InstrEndLoop(child);
+			total -= child->total * 1000.0;
+			bufusage.shared_blks_read -= child->bufusage.shared_blks_read;
+			INSTR_TIME_SUBTRACT(bufusage.blk_read_time,
+								child->bufusage.blk_read_time);
+		}
+
+		read_time = INSTR_TIME_GET_MILLISEC(bufusage.blk_read_time);
+		if (sequential)
+		{
+			counters->seq_blks_read += bufusage.shared_blks_read;
+			counters->seq_read_time += read_time;
+		}
+		else
+		{
+			counters->random_blks_read += bufusage.shared_blks_read;
+			counters->random_read_time += read_time;
+		}
+
+		if (count_tuples)
+		{
+			counters->tuples += instr->ntuples + instr->nfiltered1;
+			counters->cpu_time += Max(total - read_time, 0.0);
+			counters->estimated_cost += planstate->plan->total_cost * instr->nloops;
+			counters->actual_time += total;
+		}
+	}
+
+	return planstate_tree_walker(planstate, cc_collect_walker, context);
+}
+
+/*
+ * Find or create the statement-local counters for rel's tablespace
+ */
+static ccCounters *
+cc_local_counters(HTAB *local, Relation rel)
+{
+	Oid			spcoid = rel->rd_rel->reltablespace;
+	ccEntry    *entry;
+	bool		found;
+
+	if (!OidIsValid(spcoid))
+		spcoid = MyDatabaseTableSpace;
+
+	entry = hash_search(local, &spcoid, HASH_ENTER, &found);
+	if (!found)
+		memset(&entry->counters, 0, sizeof(ccCounters));
+
+	return &entry->counters;
+}
+
+/*
+ * Reset all statistics.
+ */
+Datum
+pg_cost_calibration_reset(PG_FUNCTION_ARGS)
+{
+	HASH_SEQ_STATUS hash_seq;
+	ccEntry    *entry;
+
+	if (!cc || !cc_hash)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("pg_cost_calibration must be loaded via shared_preload_libraries")));
+
+	LWLockAcquire(cc->lock, LW_EXCLUSIVE);
+	hash_seq_init(&hash_seq, cc_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		hash_search(cc_hash, &entry->spcoid, HASH_REMOVE, NULL);
+	LWLockRelease(cc->lock);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Return the collected statistics and recommended cost parameters, one row
+ * per tablespace.
+ */
+Datum
+pg_cost_calibration(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	HASH_SEQ_STATUS hash_seq;
+	ccEntry    *entry;
+	ccEntry    *entries;
+	int			nentries = 0;
+	int64		all_seq_blks_read = 0;
+	double		all_seq_read_time = 0;
+	double		seq_msec_per_blk = 0;
+	int			i;
+
+	if (!cc || !cc_hash)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("pg_cost_calibration must be loaded via shared_preload_libraries")));
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	/* Copy the entries, so as not to hold the lock while looking up names */
+	entries = palloc(sizeof(ccEntry) * CC_MAX_TABLESPACES);
+	LWLockAcquire(cc->lock, LW_SHARED);
+	hash_seq_init(&hash_seq, cc_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		if (nentries < CC_MAX_TABLESPACES)
+			entries[nentries++] = *entry;
+	}
+	LWLockRelease(cc->lock);
+
+	/*
+	 * The average time of a sequential block read over all tablespaces is
+	 * what we take the current seq_page_cost to stand for.
+	 */
+	for (i = 0; i < nentries; i++)
+	{
+		all_seq_blks_read += entries[i].counters.seq_blks_read;
+		all_seq_read_time += entries[i].counters.seq_read_time;
+	}
+	if (all_seq_blks_read >= cc_min_blocks && all_seq_read_time > 0)
+		seq_msec_per_blk = all_seq_read_time / all_seq_blks_read;
+
+	for (i = 0; i < nentries; i++)
+	{
+		ccCounters *counters = &entries[i].counters;
+		Datum		values[PG_COST_CALIBRATION_COLS];
+		bool		nulls[PG_COST_CALIBRATION_COLS];
+		char	   *spcname;
+		int			j = 0;
+
+		memset(values, 0, sizeof(values));
+		memset(nulls, 0, sizeof(nulls));
+
+		values[j++] = ObjectIdGetDatum(entries[i].spcoid);
+		spcname = get_tablespace_name(entries[i].spcoid);
+		if (spcname)
+			values[j++] = DirectFunctionCall1(namein, CStringGetDatum(spcname));
+		else
+			nulls[j++] = true;
+		values[j++] = Int64GetDatumFast(counters->seq_blks_read);
+		values[j++] = Float8GetDatumFast(counters->seq_read_time);
+		values[j++] = Int64GetDatumFast(counters->random_blks_read);
+		values[j++] = Float8GetDatumFast(counters->random_read_time);
+		values[j++] = Float8GetDatumFast(counters->tuples);
+		values[j++] = Float8GetDatumFast(counters->cpu_time);
+		values[j++] = Float8GetDatumFast(counters->estimated_cost);
+		values[j++] = Float8GetDatumFast(counters->actual_time);
+
+		/* Recommended seq_page_cost */
+		if (seq_msec_per_blk > 0 && counters->seq_blks_read >= cc_min_blocks &&
+			counters->seq_read_time > 0)
+			values[j++] = Float8GetDatum(seq_page_cost *
+										 (counters->seq_read_time / counters->seq_blks_read) /
+										 seq_msec_per_blk);
+		else
+			nulls[j++] = true;
+
+		/* Recommended random_page_cost */
+		if (seq_msec_per_blk > 0 && counters->random_blks_read >= cc_min_blocks &&
+			counters->random_read_time > 0)
+			values[j++] = Float8GetDatum(seq_page_cost *
+										 (counters->random_read_time / counters->random_blks_read) /
+										 seq_msec_per_blk);
+		else
+			nulls[j++] = true;
+
+		/* Recommended cpu_tuple_cost */
+		if (seq_msec_per_blk > 0 && counters->tuples > 0)
+			values[j++] = Float8GetDatum(seq_page_cost *
+										 (counters->cpu_time / counters->tuples) /
+										 seq_msec_per_blk);
+		else
+			nulls[j++] = true;
+
+		Assert(j == PG_COST_CALIBRATION_COLS);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	return (Datum) 0;
+}
+
+/*
+ * Estimate shared memory space needed.
+ */
+static Size
+cc_memsize(void)
+{
+	Size		size;
+
+	size = MAXALIGN(sizeof(ccSharedState));
+	size = add_size(size, hash_estimate_size(CC_MAX_TABLESPACES, sizeof(ccEntry)));
+
+	return size;
+}
@@ -0,0 +1,28 @@
+CREATE EXTENSION pg_cost_calibration;
+
+SELECT pg_cost_calibration_reset();
+
+CREATE TABLE cc_tbl AS SELECT g AS a FROM generate_series(1, 10000) g;
+CREATE INDEX cc_tbl_a ON cc_tbl (a);
+VACUUM ANALYZE cc_tbl;
+
+-- a sequential scan that filters out half the rows
+SET enable_indexscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*) FROM cc_tbl WHERE a % 2 = 0;
+RESET enable_indexscan;
+RESET enable_bitmapscan;
+
+SELECT spcname, seq_blks_read >= 0 AS seq_blks_ok, tuples,
+       estimated_cost > 0 AS estimated_cost_ok, actual_time >= cpu_time AS times_ok,
+       seq_page_cost, random_page_cost
+FROM pg_cost_calibration() WHERE spcname = 'pg_default';
+
+-- nothing is recommended from so few blocks
+SELECT * FROM pg_cost_calibration_apply();
+
+SELECT pg_cost_calibration_reset();
+SELECT count(*) FROM pg_cost_calibration();
+
+DROP TABLE cc_tbl;
+DROP EXTENSION pg_cost_calibration;
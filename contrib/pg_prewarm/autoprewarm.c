@@ -10,11 +10,19 @@
  *		and we need to lock the relations so that we don't try to prewarm
  *		pages from a relation that is in the process of being dropped.
  *
- *		While prewarming, autoprewarm will use two workers.  There's a
- *		leader worker that reads and sorts the list of blocks to be
- *		prewarmed and then launches a per-database worker for each
- *		relevant database in turn.  The former keeps running after the
- *		initial prewarm is complete to update the dump file periodically.
+ *		While prewarming, autoprewarm will use at least two workers.
+ *		There's a leader worker that reads and sorts the list of blocks to
+ *		be prewarmed and then launches pg_prewarm.autoprewarm_workers
+ *		per-database workers for each relevant database in turn.  The
+ *		former keeps running after the initial prewarm is complete to
+ *		update the dump file periodically.
+ *
+ *		The usage count of each buffer is recorded in the dump file, and
+ *		the blocks of a database are loaded in order of decreasing usage
+ *		count, so that the hottest blocks are back in shared buffers first.
+ *		The per-database workers of a database claim runs of consecutive
+ *		blocks of a relation in that order, and prefetch the blocks of the
+ *		run ahead of reading them.
  *
  *	Copyright (c) 2016-2023, PostgreSQL Global Development Group
  *
@@ -36,7 +44,9 @@
 #include "pgstat.h"
 #include "postmaster/bgworker.h"
 #include "postmaster/interrupt.h"
+#include "postmaster/postmaster.h"
 #include "storage/buf_internals.h"
+#include "storage/bufmgr.h"
 #include "storage/dsm.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
@@ -57,6 +67,9 @@
 
 #define AUTOPREWARM_FILE "autoprewarm.blocks"
 
+/* Maximum number of blocks a per-database worker claims at once. */
+#define AUTOPREWARM_CLAIM_BLOCKS	1024
+
 /* Metadata for each block we dump. */
 typedef struct BlockInfoRecord
 {
@@ -65,6 +78,7 @@ typedef struct BlockInfoRecord
 	RelFileNumber filenumber;
 	ForkNumber	forknum;
 	BlockNumber blocknum;
+	uint32		usagecount;
 } BlockInfoRecord;
 
 /* Shared state information for autoprewarm bgworker. */
@@ -79,7 +93,8 @@ typedef struct AutoPrewarmSharedState
 	Oid			database;
 	int			prewarm_start_idx;
 	int			prewarm_stop_idx;
-	int			prewarmed_blocks;
+	int			prewarm_next_idx;	/* next block to claim, protected by lock */
+	int			prewarmed_blocks;	/* protected by lock */
 } AutoPrewarmSharedState;
 
 PGDLLEXPORT void autoprewarm_main(Datum main_arg);
@@ -91,7 +106,11 @@ PG_FUNCTION_INFO_V1(autoprewarm_dump_now);
 static void apw_load_buffers(void);
 static int	apw_dump_now(bool is_bgworker, bool dump_unlogged);
 static void apw_start_leader_worker(void);
-static void apw_start_database_worker(void);
+static BackgroundWorkerHandle *apw_start_database_worker(bool missing_ok);
+static bool apw_claim_blocks(BlockInfoRecord *block_info, int *start_idx,
+							 int *stop_idx);
+static int	apw_prewarm_blocks(BlockInfoRecord *block_info, int start_idx,
+							   int stop_idx);
 static bool apw_init_shmem(void);
 static void apw_detach_shmem(int code, Datum arg);
 static int	apw_compare_blockinfo(const void *p, const void *q);
@@ -104,6 +123,7 @@ static AutoPrewarmSharedState *apw_state = NULL;
 /* GUC variables. */
 static bool autoprewarm = true; /* start worker? */
 static int	autoprewarm_interval = 300; /* dump interval */
+static int	autoprewarm_workers = 1;	/* per-database workers */
 
 /*
  * Module load callback.
@@ -123,6 +143,18 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable("pg_prewarm.autoprewarm_workers",
+							"Sets the number of workers prewarming the blocks of each database",
+							NULL,
+							&autoprewarm_workers,
+							1,
+							1, MAX_BACKENDS,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
 	if (!process_shared_preload_libraries_in_progress)
 		return;
 
@@ -280,8 +312,8 @@ autoprewarm_main(Datum main_arg)
 }
 
 /*
- * Read the dump file and launch per-database workers one at a time to
- * prewarm the buffers found there.
+ * Read the dump file and launch per-database workers, one database at a
+ * time, to prewarm the buffers found there.
  */
 static void
 apw_load_buffers(void)
@@ -340,14 +372,25 @@ apw_load_buffers(void)
 	seg = dsm_create(sizeof(BlockInfoRecord) * num_elements, 0);
 	blkinfo = (BlockInfoRecord *) dsm_segment_address(seg);
 
-	/* Read records, one per line. */
+	/*
+	 * Read records, one per line.  Files written by older versions have no
+	 * usage count; treat their blocks as equally hot.
+	 */
 	for (i = 0; i < num_elements; i++)
 	{
+		char		line[128];
 		unsigned	forknum;
-
-		if (fscanf(file, "%u,%u,%u,%u,%u\n", &blkinfo[i].database,
-				   &blkinfo[i].tablespace, &blkinfo[i].filenumber,
-				   &forknum, &blkinfo[i].blocknum) != 5)
+		int			nfields;
+
+		blkinfo[i].usagecount = 0;
+		if (fgets(line, sizeof(line), file) != NULL)
+			nfields = sscanf(line, "%u,%u,%u,%u,%u,%u", &blkinfo[i].database,
+							 &blkinfo[i].tablespace, &blkinfo[i].filenumber,
+							 &forknum, &blkinfo[i].blocknum,
+							 &blkinfo[i].usagecount);
+		else
+			nfields = 0;
+		if (nfields != 5 && nfields != 6)
 			ereport(ERROR,
 					(errmsg("autoprewarm block dump file is corrupted at line %d",
 							i + 1)));
@@ -400,8 +443,9 @@ apw_load_buffers(void)
 		if (current_db == InvalidOid)
 			break;
 
-		/* Configure stop point and database for next per-database worker. */
+		/* Configure stop point and database for next per-database workers. */
 		apw_state->prewarm_stop_idx = j;
+		apw_state->prewarm_next_idx = apw_state->prewarm_start_idx;
 		apw_state->database = current_db;
 		Assert(apw_state->prewarm_start_idx < apw_state->prewarm_stop_idx);
 
@@ -417,10 +461,33 @@ apw_load_buffers(void)
 			break;
 
 		/*
-		 * Start a per-database worker to load blocks for this database; this
-		 * function will return once the per-database worker exits.
+		 * Start the per-database workers to load blocks for this database,
+		 * and wait for them to exit.  Only the first one is required; if
+		 * there are not enough background worker slots for the others, the
+		 * ones that could be started do all the work.
 		 */
-		apw_start_database_worker();
+		{
+			BackgroundWorkerHandle **handles;
+			int			nhandles = 0;
+
+			handles = palloc(autoprewarm_workers *
+							 sizeof(BackgroundWorkerHandle *));
+			for (i = 0; i < autoprewarm_workers; i++)
+			{
+				handles[nhandles] = apw_start_database_worker(i > 0);
+				if (handles[nhandles] == NULL)
+					break;
+				nhandles++;
+			}
+
+			/*
+			 * Ignore return value; if it fails, postmaster has died, but we
+			 * have checks for that elsewhere.
+			 */
+			for (i = 0; i < nhandles; i++)
+				WaitForBackgroundWorkerShutdown(handles[i]);
+			pfree(handles);
+		}
 
 		/* Prepare for next database. */
 		apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx;
@@ -441,18 +508,18 @@ apw_load_buffers(void)
 }
 
 /*
- * Prewarm all blocks for one database (and possibly also global objects, if
- * those got grouped with this database).
+ * Prewarm blocks for one database (and possibly also global objects, if
+ * those got grouped with this database).  The blocks are shared with the
+ * other per-database workers of the same database.
  */
 void
 autoprewarm_database_main(Datum main_arg)
 {
-	int			pos;
 	BlockInfoRecord *block_info;
-	Relation	rel = NULL;
-	BlockNumber nblocks = 0;
-	BlockInfoRecord *old_blk = NULL;
 	dsm_segment *seg;
+	int			start_idx;
+	int			stop_idx;
+	int			prewarmed_blocks = 0;
 
 	/* Establish signal handlers; once that's done, unblock signals. */
 	pqsignal(SIGTERM, die);
@@ -467,108 +534,140 @@ autoprewarm_database_main(Datum main_arg)
 				 errmsg("could not map dynamic shared memory segment")));
 	BackgroundWorkerInitializeConnectionByOid(apw_state->database, InvalidOid, 0);
 	block_info = (BlockInfoRecord *) dsm_segment_address(seg);
-	pos = apw_state->prewarm_start_idx;
 
 	/*
 	 * Loop until we run out of blocks to prewarm or until we run out of free
 	 * buffers.
 	 */
-	while (pos < apw_state->prewarm_stop_idx && have_free_buffer())
+	while (have_free_buffer() &&
+		   apw_claim_blocks(block_info, &start_idx, &stop_idx))
+		prewarmed_blocks += apw_prewarm_blocks(block_info, start_idx, stop_idx);
+
+	dsm_detach(seg);
+
+	LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
+	apw_state->prewarmed_blocks += prewarmed_blocks;
+	LWLockRelease(&apw_state->lock);
+}
+
+/*
+ * Claim the next blocks of the current database to prewarm: a run of
+ * consecutive records of the same relation, at most AUTOPREWARM_CLAIM_BLOCKS
+ * long.  Returns false if there are none left.
+ */
+static bool
+apw_claim_blocks(BlockInfoRecord *block_info, int *start_idx, int *stop_idx)
+{
+	int			start;
+	int			stop;
+
+	LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
+	start = apw_state->prewarm_next_idx;
+	if (start >= apw_state->prewarm_stop_idx)
 	{
-		BlockInfoRecord *blk = &block_info[pos++];
-		Buffer		buf;
+		LWLockRelease(&apw_state->lock);
+		return false;
+	}
 
-		CHECK_FOR_INTERRUPTS();
+	stop = start + 1;
+	while (stop < apw_state->prewarm_stop_idx &&
+		   stop - start < AUTOPREWARM_CLAIM_BLOCKS &&
+		   block_info[stop].database == block_info[start].database &&
+		   block_info[stop].tablespace == block_info[start].tablespace &&
+		   block_info[stop].filenumber == block_info[start].filenumber)
+		stop++;
 
-		/*
-		 * Quit if we've reached records for another database. If previous
-		 * blocks are of some global objects, then continue pre-warming.
-		 */
-		if (old_blk != NULL && old_blk->database != blk->database &&
-			old_blk->database != 0)
-			break;
+	apw_state->prewarm_next_idx = stop;
+	LWLockRelease(&apw_state->lock);
 
-		/*
-		 * As soon as we encounter a block of a new relation, close the old
-		 * relation. Note that rel will be NULL if try_relation_open failed
-		 * previously; in that case, there is nothing to close.
-		 */
-		if (old_blk != NULL && old_blk->filenumber != blk->filenumber &&
-			rel != NULL)
-		{
-			relation_close(rel, AccessShareLock);
-			rel = NULL;
-			CommitTransactionCommand();
-		}
+	*start_idx = start;
+	*stop_idx = stop;
+	return true;
+}
 
-		/*
-		 * Try to open each new relation, but only once, when we first
-		 * encounter it. If it's been dropped, skip the associated blocks.
-		 */
-		if (old_blk == NULL || old_blk->filenumber != blk->filenumber)
-		{
-			Oid			reloid;
+/*
+ * Prewarm the blocks between start_idx and stop_idx, which all belong to the
+ * same relation.  The blocks are prefetched up to maintenance_io_concurrency
+ * blocks ahead of the one being read.  Returns the number of blocks
+ * prewarmed.
+ */
+static int
+apw_prewarm_blocks(BlockInfoRecord *block_info, int start_idx, int stop_idx)
+{
+	BlockInfoRecord *first = &block_info[start_idx];
+	Relation	rel = NULL;
+	Oid			reloid;
+	BlockNumber nblocks[MAX_FORKNUM + 1];
+	ForkNumber	forknum;
+	int			prefetch_idx = start_idx;
+	int			prewarmed_blocks = 0;
+	int			pos;
 
-			Assert(rel == NULL);
-			StartTransactionCommand();
-			reloid = RelidByRelfilenumber(blk->tablespace, blk->filenumber);
-			if (OidIsValid(reloid))
-				rel = try_relation_open(reloid, AccessShareLock);
+	/*
+	 * Open the relation.  If it's been dropped, skip the associated blocks.
+	 */
+	StartTransactionCommand();
+	reloid = RelidByRelfilenumber(first->tablespace, first->filenumber);
+	if (OidIsValid(reloid))
+		rel = try_relation_open(reloid, AccessShareLock);
+	if (!rel)
+	{
+		CommitTransactionCommand();
+		return 0;
+	}
 
-			if (!rel)
-				CommitTransactionCommand();
-		}
-		if (!rel)
-		{
-			old_blk = blk;
-			continue;
-		}
+	/* Check for the existence and size of each fork. */
+	for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+	{
+		if (smgrexists(RelationGetSmgr(rel), forknum))
+			nblocks[forknum] = RelationGetNumberOfBlocksInFork(rel, forknum);
+		else
+			nblocks[forknum] = 0;
+	}
+
+/* a block is worth reading if its fork is valid and it is within the fork */
+#define apw_block_is_valid(blk) \
+	((blk)->forknum > InvalidForkNumber && (blk)->forknum <= MAX_FORKNUM && \
+	 (blk)->blocknum < nblocks[(blk)->forknum])
+
+	for (pos = start_idx; pos < stop_idx && have_free_buffer(); pos++)
+	{
+		BlockInfoRecord *blk = &block_info[pos];
+		Buffer		buf;
+
+		CHECK_FOR_INTERRUPTS();
 
-		/* Once per fork, check for fork existence and size. */
-		if (old_blk == NULL ||
-			old_blk->filenumber != blk->filenumber ||
-			old_blk->forknum != blk->forknum)
+		/* Issue the prefetch requests of the next blocks. */
+		if (prefetch_idx <= pos)
+			prefetch_idx = pos + 1;
+		while (prefetch_idx < stop_idx &&
+			   prefetch_idx <= pos + maintenance_io_concurrency)
 		{
-			/*
-			 * smgrexists is not safe for illegal forknum, hence check whether
-			 * the passed forknum is valid before using it in smgrexists.
-			 */
-			if (blk->forknum > InvalidForkNumber &&
-				blk->forknum <= MAX_FORKNUM &&
-				smgrexists(RelationGetSmgr(rel), blk->forknum))
-				nblocks = RelationGetNumberOfBlocksInFork(rel, blk->forknum);
-			else
-				nblocks = 0;
+			BlockInfoRecord *pblk = &block_info[prefetch_idx++];
+
+			if (apw_block_is_valid(pblk))
+				(void) PrefetchBuffer(rel, pblk->forknum, pblk->blocknum);
 		}
 
-		/* Check whether blocknum is valid and within fork file size. */
-		if (blk->blocknum >= nblocks)
-		{
-			/* Move to next forknum. */
-			old_blk = blk;
+		if (!apw_block_is_valid(blk))
 			continue;
-		}
 
 		/* Prewarm buffer. */
 		buf = ReadBufferExtended(rel, blk->forknum, blk->blocknum, RBM_NORMAL,
 								 NULL);
 		if (BufferIsValid(buf))
 		{
-			apw_state->prewarmed_blocks++;
+			prewarmed_blocks++;
 			ReleaseBuffer(buf);
 		}
-
-		old_blk = blk;
 	}
 
-	dsm_detach(seg);
+#undef apw_block_is_valid
 
-	/* Release lock on previous relation. */
-	if (rel)
-	{
-		relation_close(rel, AccessShareLock);
-		CommitTransactionCommand();
-	}
+	relation_close(rel, AccessShareLock);
+	CommitTransactionCommand();
+
+	return prewarmed_blocks;
 }
 
 /*
@@ -637,6 +736,8 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 			block_info_array[num_blocks].forknum =
 				BufTagGetForkNum(&bufHdr->tag);
 			block_info_array[num_blocks].blocknum = bufHdr->tag.blockNum;
+			block_info_array[num_blocks].usagecount =
+				BUF_STATE_GET_USAGECOUNT(buf_state);
 			++num_blocks;
 		}
 
@@ -669,12 +770,13 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 	{
 		CHECK_FOR_INTERRUPTS();
 
-		ret = fprintf(file, "%u,%u,%u,%u,%u\n",
+		ret = fprintf(file, "%u,%u,%u,%u,%u,%u\n",
 					  block_info_array[i].database,
 					  block_info_array[i].tablespace,
 					  block_info_array[i].filenumber,
 					  (uint32) block_info_array[i].forknum,
-					  block_info_array[i].blocknum);
+					  block_info_array[i].blocknum,
+					  block_info_array[i].usagecount);
 		if (ret < 0)
 		{
 			int			save_errno = errno;
@@ -852,10 +954,12 @@ apw_start_leader_worker(void)
 }
 
 /*
- * Start autoprewarm per-database worker process.
+ * Start autoprewarm per-database worker process, and return its handle.  If
+ * missing_ok is true, return NULL instead of failing when no background
+ * worker slot is free.
  */
-static void
-apw_start_database_worker(void)
+static BackgroundWorkerHandle *
+apw_start_database_worker(bool missing_ok)
 {
 	BackgroundWorker worker;
 	BackgroundWorkerHandle *handle;
@@ -874,16 +978,16 @@ apw_start_database_worker(void)
 	worker.bgw_notify_pid = MyProcPid;
 
 	if (!RegisterDynamicBackgroundWorker(&worker, &handle))
+	{
+		if (missing_ok)
+			return NULL;
 		ereport(ERROR,
 				(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
 				 errmsg("registering dynamic bgworker autoprewarm failed"),
 				 errhint("Consider increasing configuration parameter \"max_worker_processes\".")));
+	}
 
-	/*
-	 * Ignore return value; if it fails, postmaster has died, but we have
-	 * checks for that elsewhere.
-	 */
-	WaitForBackgroundWorkerShutdown(handle);
+	return handle;
 }
 
 /* Compare member elements to check whether they are not equal. */
@@ -899,10 +1003,12 @@ do { \
  * apw_compare_blockinfo
  *
  * We depend on all records for a particular database being consecutive
- * in the dump file; each per-database worker will preload blocks until
- * it sees a block for some other database.  Sorting by tablespace,
- * filenumber, forknum, and blocknum isn't critical for correctness, but
- * helps us get a sequential I/O pattern.
+ * in the dump file; the per-database workers of a database preload blocks
+ * up to the first block of some other database.  Within a database, the
+ * blocks with the highest usage count come first, so that they are
+ * prewarmed first.  Sorting by tablespace, filenumber, forknum, and
+ * blocknum next isn't critical for correctness, but helps us get a
+ * sequential I/O pattern and claim long runs of blocks of a relation.
  */
 static int
 apw_compare_blockinfo(const void *p, const void *q)
@@ -911,6 +1017,10 @@ apw_compare_blockinfo(const void *p, const void *q)
 	const BlockInfoRecord *b = (const BlockInfoRecord *) q;
 
 	cmp_member_elem(database);
+	if (a->usagecount > b->usagecount)
+		return -1;
+	else if (a->usagecount < b->usagecount)
+		return 1;
 	cmp_member_elem(tablespace);
 	cmp_member_elem(filenumber);
 	cmp_member_elem(forknum);
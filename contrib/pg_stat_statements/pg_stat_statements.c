@@ -33,6 +33,13 @@
  * requires holding pgss->lock exclusively; this allows individual entries
  * in the file to be read or written while holding only shared lock.
  *
+ * If pg_stat_statements.flush_interval is set, a backend adds the counters
+ * of statements whose entry it has already updated since its last flush to
+ * a backend-local hashtable instead, and adds those to the shared entries
+ * only once the interval has elapsed, much like the cumulative statistics
+ * system does with its pending statistics.  This avoids taking pgss->lock
+ * and the entry spinlocks for most executions of frequent statements.
+ *
  *
  * Copyright (c) 2008-2023, PostgreSQL Global Development Group
  *
@@ -57,6 +64,7 @@
 #include "miscadmin.h"
 #include "nodes/queryjumble.h"
 #include "optimizer/planner.h"
+#include "port/pg_bitutils.h"
 #include "parser/analyze.h"
 #include "parser/parsetree.h"
 #include "parser/scanner.h"
@@ -69,7 +77,9 @@
 #include "storage/spin.h"
 #include "tcop/utility.h"
 #include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/float.h"
 #include "utils/memutils.h"
 #include "utils/timestamp.h"
 
@@ -84,7 +94,7 @@ PG_MODULE_MAGIC;
 #define PGSS_TEXT_FILE	PG_STAT_TMP_DIR "/pgss_query_texts.stat"
 
 /* Magic number identifying the stats file format */
-static const uint32 PGSS_FILE_HEADER = 0x20220408;
+static const uint32 PGSS_FILE_HEADER = 0x20230315;
 
 /* PostgreSQL major version number, changes in which invalidate all entries */
 static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
@@ -202,6 +212,47 @@ typedef struct Counters
 	double		jit_emission_time;	/* total time to emit jit code */
 } Counters;
 
+/*
+ * Latency histogram of planning or execution times.
+ *
+ * The buckets are log-linear in microseconds: below 4us each bucket covers
+ * one microsecond, and above that each power of two is divided into four
+ * buckets of equal width, so the width of a bucket is at most a quarter of
+ * its lower bound.  The last bucket also counts everything above its lower
+ * bound of about an hour.
+ */
+#define PGSS_HIST_SUB_BITS		2
+#define PGSS_HIST_SUB_BUCKETS	(1 << PGSS_HIST_SUB_BITS)
+#define PGSS_HIST_MAX_EXP		31
+#define PGSS_HIST_BUCKETS \
+	(PGSS_HIST_SUB_BUCKETS * (PGSS_HIST_MAX_EXP - PGSS_HIST_SUB_BITS + 2))
+
+typedef struct pgssHistogram
+{
+	int64		buckets[PGSS_HIST_BUCKETS];
+} pgssHistogram;
+
+/*
+ * If pg_stat_statements.track_histograms is on, the entries of pgss_hash and
+ * pgss_pending are followed by one histogram for each pgssStoreKind.
+ */
+#define PGSS_HIST_SIZE \
+	(pgss_track_histograms ? PGSS_NUMKIND * sizeof(pgssHistogram) : 0)
+#define PGSS_ENTRY_HIST(entry) \
+	((pgssHistogram *) ((char *) (entry) + MAXALIGN(sizeof(pgssEntry))))
+#define PGSS_PENDING_HIST(pending) \
+	((pgssHistogram *) ((char *) (pending) + MAXALIGN(sizeof(pgssPendingEntry))))
+
+/*
+ * Counters of a statement not yet added to its shared entry, kept in the
+ * backend-local pgss_pending hashtable.
+ */
+typedef struct pgssPendingEntry
+{
+	pgssHashKey key;			/* hash key of entry - MUST BE FIRST */
+	Counters	counters;		/* the statistics not yet flushed */
+} pgssPendingEntry;
+
 /*
  * Global statistics for pg_stat_statements
  */
@@ -266,6 +317,13 @@ static ProcessUtility_hook_type prev_ProcessUtility = NULL;
 static pgssSharedState *pgss = NULL;
 static HTAB *pgss_hash = NULL;
 
+/* Statistics of this backend not yet added to shared memory */
+static HTAB *pgss_pending = NULL;
+static TimestampTz pgss_last_flush = 0;
+
+/* Flush pending statistics once this many statements have some */
+#define PGSS_PENDING_MAX		1000
+
 /*---- GUC variables ----*/
 
 typedef enum
@@ -289,6 +347,9 @@ static bool pgss_track_utility = true;	/* whether to track utility commands */
 static bool pgss_track_planning = false;	/* whether to track planning
 											 * duration */
 static bool pgss_save = true;	/* whether to save stats across shutdown */
+static int	pgss_flush_interval = 0;	/* max delay of counter updates, in ms */
+static bool pgss_track_histograms = false;	/* whether to keep latency
+											 * histograms */
 
 
 #define pgss_enabled(level) \
@@ -315,6 +376,10 @@ PG_FUNCTION_INFO_V1(pg_stat_statements_1_9);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_10);
 PG_FUNCTION_INFO_V1(pg_stat_statements);
 PG_FUNCTION_INFO_V1(pg_stat_statements_info);
+PG_FUNCTION_INFO_V1(pg_stat_statements_histograms);
+PG_FUNCTION_INFO_V1(pg_stat_statements_histogram_buckets);
+PG_FUNCTION_INFO_V1(pg_stat_statements_histogram_percentile);
+PG_FUNCTION_INFO_V1(pg_stat_statements_histogram_diff);
 
 static void pgss_shmem_request(void);
 static void pgss_shmem_startup(void);
@@ -344,6 +409,18 @@ static void pgss_store(const char *query, uint64 queryId,
 					   const WalUsage *walusage,
 					   const struct JitInstrumentation *jitusage,
 					   JumbleState *jstate);
+static void pgss_count(Counters *c, pgssHistogram *hist, pgssStoreKind kind,
+					   double total_time, uint64 rows,
+					   const BufferUsage *bufusage,
+					   const WalUsage *walusage,
+					   const struct JitInstrumentation *jitusage);
+static void pgss_add_counters(Counters *dst, const Counters *src);
+static void pgss_add_histograms(pgssHistogram *dst, const pgssHistogram *src);
+static int	hist_bucket(double time);
+static double hist_bucket_lower(int bucket);
+static double hist_bucket_upper(int bucket);
+static void pgss_flush_pending(void);
+static void pgss_flush_pending_at_exit(int code, Datum arg);
 static void pg_stat_statements_internal(FunctionCallInfo fcinfo,
 										pgssVersion api_version,
 										bool showtext);
@@ -450,6 +527,30 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable("pg_stat_statements.track_histograms",
+							 "Selects whether latency histograms are kept by pg_stat_statements.",
+							 NULL,
+							 &pgss_track_histograms,
+							 false,
+							 PGC_POSTMASTER,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("pg_stat_statements.flush_interval",
+							"Sets the maximum time a backend keeps statistics before adding them to pg_stat_statements.",
+							"0 adds the statistics of every statement immediately.",
+							&pgss_flush_interval,
+							0,
+							0,
+							INT_MAX,
+							PGC_SUSET,
+							GUC_UNIT_MS,
+							NULL,
+							NULL,
+							NULL);
+
 	MarkGUCPrefixReserved("pg_stat_statements");
 
 	/*
@@ -505,6 +606,7 @@ pgss_shmem_startup(void)
 	uint32		header;
 	int32		num;
 	int32		pgver;
+	uint32		hist_size;
 	int32		i;
 	int			buffer_size;
 	char	   *buffer = NULL;
@@ -540,7 +642,7 @@ pgss_shmem_startup(void)
 	}
 
 	info.keysize = sizeof(pgssHashKey);
-	info.entrysize = sizeof(pgssEntry);
+	info.entrysize = MAXALIGN(sizeof(pgssEntry)) + PGSS_HIST_SIZE;
 	pgss_hash = ShmemInitHash("pg_stat_statements hash",
 							  pgss_max, pgss_max,
 							  &info,
@@ -603,21 +705,26 @@ pgss_shmem_startup(void)
 
 	if (fread(&header, sizeof(uint32), 1, file) != 1 ||
 		fread(&pgver, sizeof(uint32), 1, file) != 1 ||
-		fread(&num, sizeof(int32), 1, file) != 1)
+		fread(&num, sizeof(int32), 1, file) != 1 ||
+		fread(&hist_size, sizeof(uint32), 1, file) != 1)
 		goto read_error;
 
 	if (header != PGSS_FILE_HEADER ||
-		pgver != PGSS_PG_MAJOR_VERSION)
+		pgver != PGSS_PG_MAJOR_VERSION ||
+		(hist_size != 0 && hist_size != PGSS_NUMKIND * sizeof(pgssHistogram)))
 		goto data_error;
 
 	for (i = 0; i < num; i++)
 	{
 		pgssEntry	temp;
+		pgssHistogram temp_hist[PGSS_NUMKIND];
 		pgssEntry  *entry;
 		Size		query_offset;
 
 		if (fread(&temp, sizeof(pgssEntry), 1, file) != 1)
 			goto read_error;
+		if (hist_size > 0 && fread(temp_hist, hist_size, 1, file) != 1)
+			goto read_error;
 
 		/* Encoding is the only field we can easily sanity-check */
 		if (!PG_VALID_BE_ENCODING(temp.encoding))
@@ -653,6 +760,8 @@ pgss_shmem_startup(void)
 
 		/* copy in the actual stats */
 		entry->counters = temp.counters;
+		if (pgss_track_histograms && hist_size > 0)
+			memcpy(PGSS_ENTRY_HIST(entry), temp_hist, hist_size);
 	}
 
 	/* Read global statistics for pg_stat_statements */
@@ -727,6 +836,7 @@ pgss_shmem_shutdown(int code, Datum arg)
 	Size		qbuffer_size = 0;
 	HASH_SEQ_STATUS hash_seq;
 	int32		num_entries;
+	uint32		hist_size;
 	pgssEntry  *entry;
 
 	/* Don't try to dump during a crash. */
@@ -752,6 +862,9 @@ pgss_shmem_shutdown(int code, Datum arg)
 	num_entries = hash_get_num_entries(pgss_hash);
 	if (fwrite(&num_entries, sizeof(int32), 1, file) != 1)
 		goto error;
+	hist_size = PGSS_HIST_SIZE;
+	if (fwrite(&hist_size, sizeof(uint32), 1, file) != 1)
+		goto error;
 
 	qbuffer = qtext_load_file(&qbuffer_size);
 	if (qbuffer == NULL)
@@ -772,6 +885,8 @@ pgss_shmem_shutdown(int code, Datum arg)
 			continue;			/* Ignore any entries with bogus texts */
 
 		if (fwrite(entry, sizeof(pgssEntry), 1, file) != 1 ||
+			(hist_size > 0 &&
+			 fwrite(PGSS_ENTRY_HIST(entry), hist_size, 1, file) != 1) ||
 			fwrite(qstr, 1, len + 1, file) != len + 1)
 		{
 			/* note: we assume hash_seq_term won't change errno */
@@ -1232,6 +1347,7 @@ pgss_store(const char *query, uint64 queryId,
 	pgssEntry  *entry;
 	char	   *norm_query = NULL;
 	int			encoding = GetDatabaseEncoding();
+	bool		add_pending = false;
 
 	Assert(query != NULL);
 
@@ -1263,6 +1379,41 @@ pgss_store(const char *query, uint64 queryId,
 	key.queryid = queryId;
 	key.toplevel = (exec_nested_level == 0);
 
+	/*
+	 * If we are to buffer the counters, and have already updated the shared
+	 * entry since the last flush, just add them to the pending ones.
+	 */
+	if (!jstate && pgss_flush_interval > 0)
+	{
+		pgssPendingEntry *pending = NULL;
+
+		if (pgss_pending)
+			pending = (pgssPendingEntry *) hash_search(pgss_pending, &key,
+													   HASH_FIND, NULL);
+		if (pending)
+		{
+			Assert(kind == PGSS_PLAN || kind == PGSS_EXEC);
+
+			pgss_count(&pending->counters,
+					   pgss_track_histograms ? PGSS_PENDING_HIST(pending) + kind : NULL,
+					   kind, total_time, rows, bufusage, walusage, jitusage);
+
+			if (hash_get_num_entries(pgss_pending) >= PGSS_PENDING_MAX ||
+				TimestampDifferenceExceeds(pgss_last_flush,
+										   GetCurrentTimestamp(),
+										   pgss_flush_interval))
+				pgss_flush_pending();
+			return;
+		}
+
+		/*
+		 * Otherwise update the shared entry, creating it if needed, and
+		 * remember to buffer the following executions.  Doing the first one
+		 * directly keeps a new entry from looking sticky until the flush.
+		 */
+		add_pending = true;
+	}
+
 	/* Lookup the hash table entry with shared lock. */
 	LWLockAcquire(pgss->lock, LW_SHARED);
 
@@ -1348,80 +1499,276 @@ pgss_store(const char *query, uint64 queryId,
 		if (IS_STICKY(e->counters))
 			e->counters.usage = USAGE_INIT;
 
-		e->counters.calls[kind] += 1;
-		e->counters.total_time[kind] += total_time;
+		pgss_count((Counters *) &e->counters,
+				   pgss_track_histograms ? PGSS_ENTRY_HIST(entry) + kind : NULL,
+				   kind, total_time, rows, bufusage, walusage, jitusage);
+
+		SpinLockRelease(&e->mutex);
+	}
+
+done:
+	LWLockRelease(pgss->lock);
+
+	/* We postpone this clean-up until we're out of the lock */
+	if (norm_query)
+		pfree(norm_query);
 
-		if (e->counters.calls[kind] == 1)
+	/* Buffer the following executions of the statement, if wanted */
+	if (add_pending && entry)
+	{
+		pgssPendingEntry *pending;
+
+		if (!pgss_pending)
 		{
-			e->counters.min_time[kind] = total_time;
-			e->counters.max_time[kind] = total_time;
-			e->counters.mean_time[kind] = total_time;
+			HASHCTL		info;
+
+			info.keysize = sizeof(pgssHashKey);
+			info.entrysize = MAXALIGN(sizeof(pgssPendingEntry)) + PGSS_HIST_SIZE;
+			pgss_pending = hash_create("pg_stat_statements pending entries",
+									   64, &info, HASH_ELEM | HASH_BLOBS);
+			before_shmem_exit(pgss_flush_pending_at_exit, 0);
 		}
-		else
+
+		if (hash_get_num_entries(pgss_pending) == 0)
+			pgss_last_flush = GetCurrentTimestamp();
+
+		pending = (pgssPendingEntry *) hash_search(pgss_pending, &key,
+												   HASH_ENTER, NULL);
+		memset(&pending->counters, 0, sizeof(Counters));
+		if (pgss_track_histograms)
+			memset(PGSS_PENDING_HIST(pending), 0, PGSS_HIST_SIZE);
+	}
+}
+
+/*
+ * Add the statistics of one planning or execution of a statement to the
+ * counters 'c', and its duration to the histogram 'hist' unless it's NULL.
+ */
+static void
+pgss_count(Counters *c, pgssHistogram *hist, pgssStoreKind kind,
+		   double total_time, uint64 rows,
+		   const BufferUsage *bufusage,
+		   const WalUsage *walusage,
+		   const struct JitInstrumentation *jitusage)
+{
+	c->calls[kind] += 1;
+	c->total_time[kind] += total_time;
+
+	if (c->calls[kind] == 1)
+	{
+		c->min_time[kind] = total_time;
+		c->max_time[kind] = total_time;
+		c->mean_time[kind] = total_time;
+	}
+	else
+	{
+		/*
+		 * Welford's method for accurately computing variance. See
+		 * <http://www.johndcook.com/blog/standard_deviation/>
+		 */
+		double		old_mean = c->mean_time[kind];
+
+		c->mean_time[kind] +=
+			(total_time - old_mean) / c->calls[kind];
+		c->sum_var_time[kind] +=
+			(total_time - old_mean) * (total_time - c->mean_time[kind]);
+
+		/* calculate min and max time */
+		if (c->min_time[kind] > total_time)
+			c->min_time[kind] = total_time;
+		if (c->max_time[kind] < total_time)
+			c->max_time[kind] = total_time;
+	}
+	c->rows += rows;
+	c->shared_blks_hit += bufusage->shared_blks_hit;
+	c->shared_blks_read += bufusage->shared_blks_read;
+	c->shared_blks_dirtied += bufusage->shared_blks_dirtied;
+	c->shared_blks_written += bufusage->shared_blks_written;
+	c->local_blks_hit += bufusage->local_blks_hit;
+	c->local_blks_read += bufusage->local_blks_read;
+	c->local_blks_dirtied += bufusage->local_blks_dirtied;
+	c->local_blks_written += bufusage->local_blks_written;
+	c->temp_blks_read += bufusage->temp_blks_read;
+	c->temp_blks_written += bufusage->temp_blks_written;
+	c->blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_read_time);
+	c->blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_write_time);
+	c->temp_blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->temp_blk_read_time);
+	c->temp_blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->temp_blk_write_time);
+	c->usage += USAGE_EXEC(total_time);
+	c->wal_records += walusage->wal_records;
+	c->wal_fpi += walusage->wal_fpi;
+	c->wal_bytes += walusage->wal_bytes;
+	if (jitusage)
+	{
+		c->jit_functions += jitusage->created_functions;
+		c->jit_generation_time += INSTR_TIME_GET_MILLISEC(jitusage->generation_counter);
+
+		if (INSTR_TIME_GET_MILLISEC(jitusage->inlining_counter))
+			c->jit_inlining_count++;
+		c->jit_inlining_time += INSTR_TIME_GET_MILLISEC(jitusage->inlining_counter);
+
+		if (INSTR_TIME_GET_MILLISEC(jitusage->optimization_counter))
+			c->jit_optimization_count++;
+		c->jit_optimization_time += INSTR_TIME_GET_MILLISEC(jitusage->optimization_counter);
+
+		if (INSTR_TIME_GET_MILLISEC(jitusage->emission_counter))
+			c->jit_emission_count++;
+		c->jit_emission_time += INSTR_TIME_GET_MILLISEC(jitusage->emission_counter);
+	}
+
+	if (hist)
+		hist->buckets[hist_bucket(total_time)]++;
+}
+
+/*
+ * Add the counters 'src' to 'dst'.
+ *
+ * The means and sums of variances are combined with the parallel variant of
+ * Welford's method, see
+ * <https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Parallel_algorithm>
+ */
+static void
+pgss_add_counters(Counters *dst, const Counters *src)
+{
+	int			kind;
+
+	for (kind = 0; kind < PGSS_NUMKIND; kind++)
+	{
+		int64		n1 = dst->calls[kind];
+		int64		n2 = src->calls[kind];
+
+		if (n2 == 0)
+			continue;
+
+		if (n1 == 0)
 		{
-			/*
-			 * Welford's method for accurately computing variance. See
-			 * <http://www.johndcook.com/blog/standard_deviation/>
-			 */
-			double		old_mean = e->counters.mean_time[kind];
-
-			e->counters.mean_time[kind] +=
-				(total_time - old_mean) / e->counters.calls[kind];
-			e->counters.sum_var_time[kind] +=
-				(total_time - old_mean) * (total_time - e->counters.mean_time[kind]);
-
-			/* calculate min and max time */
-			if (e->counters.min_time[kind] > total_time)
-				e->counters.min_time[kind] = total_time;
-			if (e->counters.max_time[kind] < total_time)
-				e->counters.max_time[kind] = total_time;
+			dst->min_time[kind] = src->min_time[kind];
+			dst->max_time[kind] = src->max_time[kind];
+			dst->mean_time[kind] = src->mean_time[kind];
+			dst->sum_var_time[kind] = src->sum_var_time[kind];
 		}
-		e->counters.rows += rows;
-		e->counters.shared_blks_hit += bufusage->shared_blks_hit;
-		e->counters.shared_blks_read += bufusage->shared_blks_read;
-		e->counters.shared_blks_dirtied += bufusage->shared_blks_dirtied;
-		e->counters.shared_blks_written += bufusage->shared_blks_written;
-		e->counters.local_blks_hit += bufusage->local_blks_hit;
-		e->counters.local_blks_read += bufusage->local_blks_read;
-		e->counters.local_blks_dirtied += bufusage->local_blks_dirtied;
-		e->counters.local_blks_written += bufusage->local_blks_written;
-		e->counters.temp_blks_read += bufusage->temp_blks_read;
-		e->counters.temp_blks_written += bufusage->temp_blks_written;
-		e->counters.blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_read_time);
-		e->counters.blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_write_time);
-		e->counters.temp_blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->temp_blk_read_time);
-		e->counters.temp_blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->temp_blk_write_time);
-		e->counters.usage += USAGE_EXEC(total_time);
-		e->counters.wal_records += walusage->wal_records;
-		e->counters.wal_fpi += walusage->wal_fpi;
-		e->counters.wal_bytes += walusage->wal_bytes;
-		if (jitusage)
+		else
 		{
-			e->counters.jit_functions += jitusage->created_functions;
-			e->counters.jit_generation_time += INSTR_TIME_GET_MILLISEC(jitusage->generation_counter);
+			double		delta = src->mean_time[kind] - dst->mean_time[kind];
+			double		n = (double) (n1 + n2);
+
+			dst->mean_time[kind] += delta * n2 / n;
+			dst->sum_var_time[kind] += src->sum_var_time[kind] +
+				delta * delta * n1 * n2 / n;
+			if (dst->min_time[kind] > src->min_time[kind])
+				dst->min_time[kind] = src->min_time[kind];
+			if (dst->max_time[kind] < src->max_time[kind])
+				dst->max_time[kind] = src->max_time[kind];
+		}
+		dst->calls[kind] += n2;
+		dst->total_time[kind] += src->total_time[kind];
+	}
 
-			if (INSTR_TIME_GET_MILLISEC(jitusage->inlining_counter))
-				e->counters.jit_inlining_count++;
-			e->counters.jit_inlining_time += INSTR_TIME_GET_MILLISEC(jitusage->inlining_counter);
+	dst->rows += src->rows;
+	dst->shared_blks_hit += src->shared_blks_hit;
+	dst->shared_blks_read += src->shared_blks_read;
+	dst->shared_blks_dirtied += src->shared_blks_dirtied;
+	dst->shared_blks_written += src->shared_blks_written;
+	dst->local_blks_hit += src->local_blks_hit;
+	dst->local_blks_read += src->local_blks_read;
+	dst->local_blks_dirtied += src->local_blks_dirtied;
+	dst->local_blks_written += src->local_blks_written;
+	dst->temp_blks_read += src->temp_blks_read;
+	dst->temp_blks_written += src->temp_blks_written;
+	dst->blk_read_time += src->blk_read_time;
+	dst->blk_write_time += src->blk_write_time;
+	dst->temp_blk_read_time += src->temp_blk_read_time;
+	dst->temp_blk_write_time += src->temp_blk_write_time;
+	dst->usage += src->usage;
+	dst->wal_records += src->wal_records;
+	dst->wal_fpi += src->wal_fpi;
+	dst->wal_bytes += src->wal_bytes;
+	dst->jit_functions += src->jit_functions;
+	dst->jit_generation_time += src->jit_generation_time;
+	dst->jit_inlining_count += src->jit_inlining_count;
+	dst->jit_inlining_time += src->jit_inlining_time;
+	dst->jit_optimization_count += src->jit_optimization_count;
+	dst->jit_optimization_time += src->jit_optimization_time;
+	dst->jit_emission_count += src->jit_emission_count;
+	dst->jit_emission_time += src->jit_emission_time;
+}
 
-			if (INSTR_TIME_GET_MILLISEC(jitusage->optimization_counter))
-				e->counters.jit_optimization_count++;
-			e->counters.jit_optimization_time += INSTR_TIME_GET_MILLISEC(jitusage->optimization_counter);
+/*
+ * Add the histograms 'src' to 'dst', one for each pgssStoreKind.
+ */
+static void
+pgss_add_histograms(pgssHistogram *dst, const pgssHistogram *src)
+{
+	int			kind;
+	int			i;
 
-			if (INSTR_TIME_GET_MILLISEC(jitusage->emission_counter))
-				e->counters.jit_emission_count++;
-			e->counters.jit_emission_time += INSTR_TIME_GET_MILLISEC(jitusage->emission_counter);
-		}
+	for (kind = 0; kind < PGSS_NUMKIND; kind++)
+		for (i = 0; i < PGSS_HIST_BUCKETS; i++)
+			dst[kind].buckets[i] += src[kind].buckets[i];
+}
 
-		SpinLockRelease(&e->mutex);
+/*
+ * Add the pending statistics of this backend to the shared entries.
+ *
+ * The statistics of entries that have been deallocated or reset since this
+ * backend last updated them are discarded.
+ */
+static void
+pgss_flush_pending(void)
+{
+	HASH_SEQ_STATUS hash_seq;
+	pgssPendingEntry *pending;
+
+	if (!pgss_pending || hash_get_num_entries(pgss_pending) == 0)
+		return;
+
+	/*
+	 * Look up the shared entries first, and remove the pending ones later,
+	 * so that an error does not lose the statistics of the others.
+	 */
+	LWLockAcquire(pgss->lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, pgss_pending);
+	while ((pending = hash_seq_search(&hash_seq)) != NULL)
+	{
+		pgssEntry  *entry;
+
+		if (pending->counters.calls[PGSS_PLAN] +
+			pending->counters.calls[PGSS_EXEC] == 0)
+			continue;
+
+		entry = (pgssEntry *) hash_search(pgss_hash, &pending->key,
+										  HASH_FIND, NULL);
+		if (entry)
+		{
+			volatile pgssEntry *e = (volatile pgssEntry *) entry;
+
+			SpinLockAcquire(&e->mutex);
+			if (IS_STICKY(e->counters))
+				e->counters.usage = USAGE_INIT;
+			pgss_add_counters((Counters *) &e->counters, &pending->counters);
+			if (pgss_track_histograms)
+				pgss_add_histograms(PGSS_ENTRY_HIST(entry),
+									PGSS_PENDING_HIST(pending));
+			SpinLockRelease(&e->mutex);
+		}
 	}
 
-done:
 	LWLockRelease(pgss->lock);
 
-	/* We postpone this clean-up until we're out of the lock */
-	if (norm_query)
-		pfree(norm_query);
+	hash_seq_init(&hash_seq, pgss_pending);
+	while ((pending = hash_seq_search(&hash_seq)) != NULL)
+		(void) hash_search(pgss_pending, &pending->key, HASH_REMOVE, NULL);
+}
+
+/*
+ * before_shmem_exit callback: don't lose the pending statistics at exit.
+ */
+static void
+pgss_flush_pending_at_exit(int code, Datum arg)
+{
+	if (pgss)
+		pgss_flush_pending();
 }
 
 /*
@@ -1565,6 +1912,9 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("pg_stat_statements must be loaded via shared_preload_libraries")));
 
+	/* Make our own statistics visible */
+	pgss_flush_pending();
+
 	InitMaterializedSRF(fcinfo, 0);
 
 	/*
@@ -1892,6 +2242,260 @@ pg_stat_statements_info(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
 }
 
+/*
+ * Return the histogram bucket counting a duration of 'time' milliseconds.
+ */
+static int
+hist_bucket(double time)
+{
+	uint64		usecs;
+	int			exp;
+
+	if (!(time > 0))
+		return 0;
+	if (time >= (double) (UINT64CONST(1) << (PGSS_HIST_MAX_EXP + 1)) / 1000.0)
+		return PGSS_HIST_BUCKETS - 1;
+
+	usecs = (uint64) (time * 1000.0);
+	if (usecs < PGSS_HIST_SUB_BUCKETS)
+		return (int) usecs;
+
+	exp = pg_leftmost_one_pos64(usecs);
+	return PGSS_HIST_SUB_BUCKETS * (exp - PGSS_HIST_SUB_BITS + 1) +
+		(int) ((usecs >> (exp - PGSS_HIST_SUB_BITS)) & (PGSS_HIST_SUB_BUCKETS - 1));
+}
+
+/*
+ * Return the lower bound of a histogram bucket, in milliseconds.
+ */
+static double
+hist_bucket_lower(int bucket)
+{
+	int			exp;
+	int			sub;
+
+	if (bucket < PGSS_HIST_SUB_BUCKETS)
+		return bucket / 1000.0;
+
+	exp = bucket / PGSS_HIST_SUB_BUCKETS + PGSS_HIST_SUB_BITS - 1;
+	sub = bucket % PGSS_HIST_SUB_BUCKETS;
+	return (double) ((uint64) (PGSS_HIST_SUB_BUCKETS + sub) <<
+					 (exp - PGSS_HIST_SUB_BITS)) / 1000.0;
+}
+
+/*
+ * Return the upper bound of a histogram bucket, in milliseconds.  The last
+ * bucket has none.
+ */
+static double
+hist_bucket_upper(int bucket)
+{
+	if (bucket == PGSS_HIST_BUCKETS - 1)
+		return get_float8_infinity();
+
+	return hist_bucket_lower(bucket + 1);
+}
+
+/* Number of output arguments (columns) for pg_stat_statements_histograms */
+#define PG_STAT_STATEMENTS_HISTOGRAMS_COLS	6
+
+/*
+ * Return the latency histograms of all statements, as arrays of bucket
+ * counts.
+ */
+Datum
+pg_stat_statements_histograms(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	HASH_SEQ_STATUS hash_seq;
+	pgssEntry  *entry;
+	pgssHistogram hist[PGSS_NUMKIND];
+	Datum		counts[PGSS_HIST_BUCKETS];
+
+	if (!pgss || !pgss_hash)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("pg_stat_statements must be loaded via shared_preload_libraries")));
+	if (!pgss_track_histograms)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("pg_stat_statements.track_histograms is not enabled")));
+
+	/* Make our own statistics visible */
+	pgss_flush_pending();
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	LWLockAcquire(pgss->lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, pgss_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		Datum		values[PG_STAT_STATEMENTS_HISTOGRAMS_COLS];
+		bool		nulls[PG_STAT_STATEMENTS_HISTOGRAMS_COLS] = {0};
+		int			kind;
+		int			i;
+
+		/* copy histograms while holding the spinlock */
+		{
+			volatile pgssEntry *e = (volatile pgssEntry *) entry;
+
+			SpinLockAcquire(&e->mutex);
+			memcpy(hist, PGSS_ENTRY_HIST(entry), sizeof(hist));
+			SpinLockRelease(&e->mutex);
+		}
+
+		values[0] = ObjectIdGetDatum(entry->key.userid);
+		values[1] = ObjectIdGetDatum(entry->key.dbid);
+		values[2] = BoolGetDatum(entry->key.toplevel);
+		values[3] = Int64GetDatumFast((int64) entry->key.queryid);
+		for (kind = 0; kind < PGSS_NUMKIND; kind++)
+		{
+			for (i = 0; i < PGSS_HIST_BUCKETS; i++)
+				counts[i] = Int64GetDatum(hist[kind].buckets[i]);
+			values[4 + kind] = PointerGetDatum(construct_array_builtin(counts,
+																	   PGSS_HIST_BUCKETS,
+																	   INT8OID));
+		}
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	LWLockRelease(pgss->lock);
+
+	return (Datum) 0;
+}
+
+/*
+ * Return the bounds of the histogram buckets, in milliseconds.
+ */
+Datum
+pg_stat_statements_histogram_buckets(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	int			i;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	for (i = 0; i < PGSS_HIST_BUCKETS; i++)
+	{
+		Datum		values[3];
+		bool		nulls[3] = {0};
+
+		values[0] = Int32GetDatum(i + 1);
+		values[1] = Float8GetDatum(hist_bucket_lower(i));
+		values[2] = Float8GetDatum(hist_bucket_upper(i));
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	return (Datum) 0;
+}
+
+/*
+ * Return the bucket counts of a histogram array, checking its shape.
+ */
+static int64 *
+hist_array_counts(ArrayType *array)
+{
+	Datum	   *elems;
+	bool	   *nulls;
+	int			nelems;
+	int64	   *counts;
+	int			i;
+
+	deconstruct_array_builtin(array, INT8OID, &elems, &nulls, &nelems);
+	if (ARR_NDIM(array) != 1 || nelems != PGSS_HIST_BUCKETS)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("histogram must be a one-dimensional array of %d elements",
+						PGSS_HIST_BUCKETS)));
+
+	counts = (int64 *) palloc(nelems * sizeof(int64));
+	for (i = 0; i < nelems; i++)
+	{
+		if (nulls[i] || DatumGetInt64(elems[i]) < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("histogram must not contain null or negative counts")));
+		counts[i] = DatumGetInt64(elems[i]);
+	}
+
+	return counts;
+}
+
+/*
+ * Estimate a percentile of the durations counted by a histogram, in
+ * milliseconds, interpolating linearly within the bucket it falls into.
+ * Returns NULL for an empty histogram.
+ */
+Datum
+pg_stat_statements_histogram_percentile(PG_FUNCTION_ARGS)
+{
+	int64	   *counts = hist_array_counts(PG_GETARG_ARRAYTYPE_P(0));
+	float8		fraction = PG_GETARG_FLOAT8(1);
+	double		total = 0;
+	double		rank;
+	double		cumulative = 0;
+	int			i;
+
+	if (fraction < 0 || fraction > 1 || isnan(fraction))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("percentile value %g is not between 0 and 1",
+						fraction)));
+
+	for (i = 0; i < PGSS_HIST_BUCKETS; i++)
+		total += counts[i];
+	if (total == 0)
+		PG_RETURN_NULL();
+
+	rank = fraction * total;
+	for (i = 0; i < PGSS_HIST_BUCKETS; i++)
+	{
+		if (counts[i] > 0 && cumulative + counts[i] >= rank)
+			break;
+		cumulative += counts[i];
+	}
+	Assert(i < PGSS_HIST_BUCKETS);
+
+	/* Nothing to interpolate towards in the last bucket */
+	if (i == PGSS_HIST_BUCKETS - 1)
+		PG_RETURN_FLOAT8(hist_bucket_lower(i));
+
+	PG_RETURN_FLOAT8(hist_bucket_lower(i) +
+					 (hist_bucket_upper(i) - hist_bucket_lower(i)) *
+					 (rank - cumulative) / counts[i]);
+}
+
+/*
+ * Subtract an older snapshot of a histogram from a newer one, giving the
+ * histogram of the durations counted in between.  If some bucket of the
+ * older one is larger, the entry has been reset or deallocated in the
+ * meantime, and the newer histogram is returned as is.
+ */
+Datum
+pg_stat_statements_histogram_diff(PG_FUNCTION_ARGS)
+{
+	int64	   *newer = hist_array_counts(PG_GETARG_ARRAYTYPE_P(0));
+	int64	   *older = hist_array_counts(PG_GETARG_ARRAYTYPE_P(1));
+	Datum		counts[PGSS_HIST_BUCKETS];
+	bool		reset = false;
+	int			i;
+
+	for (i = 0; i < PGSS_HIST_BUCKETS; i++)
+	{
+		if (older[i] > newer[i])
+			reset = true;
+	}
+
+	for (i = 0; i < PGSS_HIST_BUCKETS; i++)
+		counts[i] = Int64GetDatum(reset ? newer[i] : newer[i] - older[i]);
+
+	PG_RETURN_ARRAYTYPE_P(construct_array_builtin(counts, PGSS_HIST_BUCKETS,
+												  INT8OID));
+}
+
 /*
  * Estimate shared memory space needed.
  */
@@ -1901,7 +2505,9 @@ pgss_memsize(void)
 	Size		size;
 
 	size = MAXALIGN(sizeof(pgssSharedState));
-	size = add_size(size, hash_estimate_size(pgss_max, sizeof(pgssEntry)));
+	size = add_size(size, hash_estimate_size(pgss_max,
+											 MAXALIGN(sizeof(pgssEntry)) +
+											 PGSS_HIST_SIZE));
 
 	return size;
 }
@@ -1943,6 +2549,8 @@ entry_alloc(pgssHashKey *key, Size query_offset, int query_len, int encoding,
 
 		/* reset the statistics */
 		memset(&entry->counters, 0, sizeof(Counters));
+		if (pgss_track_histograms)
+			memset(PGSS_ENTRY_HIST(entry), 0, PGSS_HIST_SIZE);
 		/* set the appropriate initial usage count */
 		entry->counters.usage = sticky ? pgss->cur_median_usage : USAGE_INIT;
 		/* re-initialize the mutex each time ... we assume no one using it */
@@ -2533,6 +3141,9 @@ entry_reset(Oid userid, Oid dbid, uint64 queryid)
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("pg_stat_statements must be loaded via shared_preload_libraries")));
 
+	/* Don't let our pending statistics survive the reset */
+	pgss_flush_pending();
+
 	LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
 	num_entries = hash_get_num_entries(pgss_hash);
 
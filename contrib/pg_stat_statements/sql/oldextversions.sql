@@ -48,4 +48,8 @@ AlTER EXTENSION pg_stat_statements UPDATE TO '1.10';
 \d pg_stat_statements
 SELECT count(*) > 0 AS has_data FROM pg_stat_statements;
 
+-- New functions for latency histograms in 1.11
+AlTER EXTENSION pg_stat_statements UPDATE TO '1.11';
+SELECT count(*) FROM pg_stat_statements_histogram_buckets();
+
 DROP EXTENSION pg_stat_statements;
@@ -147,3 +147,37 @@ SELECT (
 
 SELECT COUNT(*) FROM pg_stat_statements WHERE query LIKE '%SELECT GROUPING%';
 SELECT pg_stat_statements_reset();
+
+-- Statistics buffered by the backend are added when the view is read
+SET pg_stat_statements.flush_interval = '1h';
+SELECT 1 AS "flush";
+SELECT 2 AS "flush";
+SELECT 3 AS "flush";
+SELECT calls, rows, query FROM pg_stat_statements
+  WHERE query LIKE '%AS "flush"%' ORDER BY query COLLATE "C";
+RESET pg_stat_statements.flush_interval;
+SELECT pg_stat_statements_reset();
+
+-- Latency histograms
+SELECT 1 AS "hist";
+SELECT 2 AS "hist";
+SELECT s.calls, (SELECT sum(c) FROM unnest(h.exec_histogram) c) AS counted
+  FROM pg_stat_statements s JOIN pg_stat_statements_histograms() h
+    USING (userid, dbid, toplevel, queryid)
+  WHERE s.query LIKE '%AS "hist"%';
+SELECT bucket, lower_bound, upper_bound FROM pg_stat_statements_histogram_buckets()
+  WHERE bucket IN (1, 5, 10, 124);
+CREATE TEMP TABLE pgss_hist AS
+  SELECT array_agg(CASE WHEN i = 10 THEN 4 ELSE 0 END ORDER BY i)::int8[] AS h1,
+         array_agg(CASE WHEN i = 10 THEN 6 WHEN i = 20 THEN 4 ELSE 0 END ORDER BY i)::int8[] AS h2
+  FROM generate_series(1, 124) i;
+SELECT pg_stat_statements_histogram_percentile(h1, 0.5)::numeric(10,4) AS p50,
+       pg_stat_statements_histogram_percentile(h2, 0.95)::numeric(10,4) AS p95
+  FROM pgss_hist;
+SELECT (SELECT sum(c) FROM unnest(pg_stat_statements_histogram_diff(h2, h1)) c) AS diff,
+       pg_stat_statements_histogram_diff(h1, h2) = h1 AS after_reset
+  FROM pgss_hist;
+SELECT pg_stat_statements_histogram_percentile(h1, 1.5) FROM pgss_hist;
+SELECT pg_stat_statements_histogram_percentile('{1,2}', 0.5);
+DROP TABLE pgss_hist;
+SELECT pg_stat_statements_reset();
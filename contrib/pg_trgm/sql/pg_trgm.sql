@@ -19,6 +19,10 @@ select show_trgm(' a b c ');
 select show_trgm('aA bB cC');
 select show_trgm(' aA bB cC ');
 select show_trgm('a b C0*%^');
+-- many trigrams, sorted and deduplicated with a radix sort
+select t = array(select distinct u from unnest(t) u order by u collate "C")
+from (select show_trgm(string_agg(md5(i::text), ' ')) as t
+      from generate_series(1, 50) i) s;
 
 select similarity('wow','WOWa ');
 select similarity('wow',' WOW ');
@@ -7,6 +7,7 @@
 
 #include "catalog/pg_type.h"
 #include "lib/qunique.h"
+#include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "trgm.h"
 #include "tsearch/ts_locale.h"
@@ -57,6 +58,12 @@ typedef uint8 TrgmBound;
 #define WORD_SIMILARITY_STRICT		0x02	/* force bounds of extent to match
 											 * word bounds */
 
+/*
+ * Arrays of at least this many trigrams are sorted with a radix sort rather
+ * than qsort() before removing duplicates.
+ */
+#define TRGM_RADIX_SORT_THRESHOLD	64
+
 /*
  * Module load callback
  */
@@ -167,13 +174,32 @@ comp_trgm(const void *a, const void *b)
 
 /*
  * Finds first word in string, returns pointer to the word,
- * endword points to the character after word
+ * endword points to the character after word.
+ *
+ * If ascii_only is true, the caller has checked that the string is pure
+ * ASCII, so that every character is a single byte.
  */
 static char *
-find_word(char *str, int lenstr, char **endword, int *charlen)
+find_word(char *str, int lenstr, char **endword, int *charlen, bool ascii_only)
 {
 	char	   *beginword = str;
 
+	if (ascii_only)
+	{
+		while (beginword - str < lenstr && !ISWORDCHR(beginword))
+			beginword++;
+
+		if (beginword - str >= lenstr)
+			return NULL;
+
+		*endword = beginword;
+		while (*endword - str < lenstr && ISWORDCHR(*endword))
+			(*endword)++;
+		*charlen = *endword - beginword;
+
+		return beginword;
+	}
+
 	while (beginword - str < lenstr && !ISWORDCHR(beginword))
 		beginword += pg_mblen(beginword);
 
@@ -191,6 +217,26 @@ find_word(char *str, int lenstr, char **endword, int *charlen)
 	return beginword;
 }
 
+/*
+ * Is the string pure ASCII?  The bulk of it is checked a vector at a time.
+ */
+static bool
+trgm_is_ascii(const char *str, int len)
+{
+	int			i = len - len % sizeof(Vector8);
+
+	if (i > 0 && !is_valid_ascii((const unsigned char *) str, i))
+		return false;
+
+	for (; i < len; i++)
+	{
+		if (IS_HIGHBIT_SET(str[i]) || str[i] == '\0')
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * Reduce a trigram (three possibly multi-byte characters) to a trgm,
  * which is always exactly three bytes.  If we have three single-byte
@@ -282,11 +328,13 @@ generate_trgm_only(trgm *trg, char *str, int slen, TrgmBound *bounds)
 				bytelen;
 	char	   *bword,
 			   *eword;
+	bool		ascii_only;
 
 	if (slen + LPADDING + RPADDING < 3 || slen == 0)
 		return 0;
 
 	tptr = trg;
+	ascii_only = trgm_is_ascii(str, slen);
 
 	/* Allocate a buffer for case-folded, blank-padded words */
 	buf = (char *) palloc(slen * pg_database_encoding_max_length() + 4);
@@ -299,7 +347,8 @@ generate_trgm_only(trgm *trg, char *str, int slen, TrgmBound *bounds)
 	}
 
 	eword = str;
-	while ((bword = find_word(eword, slen - (eword - str), &eword, &charlen)) != NULL)
+	while ((bword = find_word(eword, slen - (eword - str), &eword, &charlen,
+							  ascii_only)) != NULL)
 	{
 #ifdef IGNORECASE
 		bword = lowerstr_with_len(bword, eword - bword);
@@ -347,6 +396,68 @@ protect_out_of_mem(int slen)
 				 errmsg("out of memory")));
 }
 
+/*
+ * Sort an array of trigrams in CMPTRGM() order and remove duplicates.
+ *
+ * Small arrays go through qsort().  Larger ones, as produced from long
+ * strings, are sorted with a least-significant-byte-first radix sort, one
+ * counting pass per byte of the trigram, which is much cheaper than
+ * O(n log n) comparisons of three-byte keys.
+ *
+ * Returns the number of unique trigrams.
+ */
+static int
+trgm_sort_unique(trgm *trg, int len)
+{
+	/* CMPTRGM() compares plain chars, which may be signed */
+	const uint8 flip = (CHAR_MIN < 0) ? 0x80 : 0;
+	trgm	   *tmp;
+	trgm	   *src;
+	trgm	   *dst;
+	int			i;
+
+	if (len <= 1)
+		return len;
+
+	if (len < TRGM_RADIX_SORT_THRESHOLD)
+	{
+		qsort(trg, len, sizeof(trgm), comp_trgm);
+		return qunique(trg, len, sizeof(trgm), comp_trgm);
+	}
+
+	tmp = (trgm *) palloc(sizeof(trgm) * len);
+	src = trg;
+	dst = tmp;
+
+	for (int byte = 2; byte >= 0; byte--)
+	{
+		int			count[256 + 1] = {0};
+		trgm	   *swap;
+
+		for (i = 0; i < len; i++)
+			count[(((uint8) src[i][byte]) ^ flip) + 1]++;
+		for (i = 1; i <= 256; i++)
+			count[i] += count[i - 1];
+		for (i = 0; i < len; i++)
+		{
+			int			pos = count[((uint8) src[i][byte]) ^ flip]++;
+
+			CPTRGM(dst[pos], src[i]);
+		}
+
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	/* After an odd number of passes, the sorted result is in tmp */
+	Assert(src == tmp);
+	memcpy(trg, tmp, sizeof(trgm) * len);
+	pfree(tmp);
+
+	return qunique(trg, len, sizeof(trgm), comp_trgm);
+}
+
 /*
  * Make array of trigrams with sorting and removing duplicate items.
  *
@@ -374,11 +485,7 @@ generate_trgm(char *str, int slen)
 	/*
 	 * Make trigrams unique.
 	 */
-	if (len > 1)
-	{
-		qsort(GETARR(trg), len, sizeof(trgm), comp_trgm);
-		len = qunique(GETARR(trg), len, sizeof(trgm), comp_trgm);
-	}
+	len = trgm_sort_unique(GETARR(trg), len);
 
 	SET_VARSIZE(trg, CALCGTSIZE(ARRKEY, len));
 
@@ -927,11 +1034,7 @@ generate_wildcard_trgm(const char *str, int slen)
 	/*
 	 * Make trigrams unique.
 	 */
-	if (len > 1)
-	{
-		qsort(GETARR(trg), len, sizeof(trgm), comp_trgm);
-		len = qunique(GETARR(trg), len, sizeof(trgm), comp_trgm);
-	}
+	len = trgm_sort_unique(GETARR(trg), len);
 
 	SET_VARSIZE(trg, CALCGTSIZE(ARRKEY, len));
 
@@ -214,6 +214,9 @@ GetConnection(UserMapping *user, bool will_prep_stmt, PgFdwConnState **state)
 		/* Process a pending asynchronous request if any. */
 		if (entry->state.pendingAreq)
 			process_pending_request(entry->state.pendingAreq);
+		/* Likewise for a FETCH sent ahead by a scan. */
+		if (entry->state.fetchAheadNode)
+			process_fetch_ahead(entry->state.fetchAheadNode);
 		/* Start a new transaction or subtransaction if needed. */
 		begin_remote_xact(entry);
 	}
@@ -744,6 +747,9 @@ pgfdw_exec_query(PGconn *conn, const char *query, PgFdwConnState *state)
 	/* First, process a pending asynchronous request, if any. */
 	if (state && state->pendingAreq)
 		process_pending_request(state->pendingAreq);
+	/* Likewise for a FETCH sent ahead by a scan. */
+	if (state && state->fetchAheadNode)
+		process_fetch_ahead(state->fetchAheadNode);
 
 	/*
 	 * Submit a query.  Since we don't use non-blocking mode, this also can
@@ -1064,6 +1070,13 @@ pgfdw_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
 			 */
 			pgfdw_reject_incomplete_xact_state_change(entry);
 
+			/*
+			 * A scan of an outer level may have sent a FETCH ahead; collect
+			 * it before we use the connection.
+			 */
+			if (entry->state.fetchAheadNode)
+				process_fetch_ahead(entry->state.fetchAheadNode);
+
 			/* Commit all remote subtransactions during pre-commit */
 			snprintf(sql, sizeof(sql), "RELEASE SAVEPOINT s%d", curlevel);
 			entry->changing_xact_state = true;
@@ -1501,8 +1514,9 @@ pgfdw_abort_cleanup(ConnCacheEntry *entry, bool toplevel)
 	 * an asynchronous fetch begun by fetch_more_data_begin() was not done
 	 * successfully and thus the per-connection state was not reset in
 	 * fetch_more_data(); in that case reset the per-connection state here.
+	 * The same applies to a FETCH sent ahead by fetch_ahead_begin().
 	 */
-	if (entry->state.pendingAreq)
+	if (entry->state.pendingAreq || entry->state.fetchAheadNode)
 		memset(&entry->state, 0, sizeof(entry->state));
 
 	/* Disarm changing_xact_state if it all worked */
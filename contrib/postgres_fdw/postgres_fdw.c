@@ -77,6 +77,8 @@ enum FdwScanPrivateIndex
 	FdwScanPrivateRetrievedAttrs,
 	/* Integer representing the desired fetch_size */
 	FdwScanPrivateFetchSize,
+	/* Boolean flag showing whether to fetch the next batch ahead */
+	FdwScanPrivateFetchAhead,
 
 	/*
 	 * String describing join i.e. names of relations being joined and types
@@ -167,6 +169,7 @@ typedef struct PgFdwScanState
 
 	/* for asynchronous execution */
 	bool		async_capable;	/* engage asynchronous-capable logic? */
+	bool		fetch_ahead;	/* send the next FETCH before it's needed? */
 
 	/* working memory contexts */
 	MemoryContext batch_cxt;	/* context holding current batch of tuples */
@@ -449,6 +452,7 @@ static bool ec_member_matches_foreign(PlannerInfo *root, RelOptInfo *rel,
 									  void *arg);
 static void create_cursor(ForeignScanState *node);
 static void fetch_more_data(ForeignScanState *node);
+static void fetch_ahead_begin(ForeignScanState *node);
 static void close_cursor(PGconn *conn, unsigned int cursor_number,
 						 PgFdwConnState *conn_state);
 static PgFdwModifyState *create_foreign_modify(EState *estate,
@@ -642,8 +646,8 @@ postgresGetForeignRelSize(PlannerInfo *root,
 
 	/*
 	 * Extract user-settable option values.  Note that per-table settings of
-	 * use_remote_estimate, fetch_size and async_capable override per-server
-	 * settings of them, respectively.
+	 * use_remote_estimate, fetch_size, async_capable and fetch_ahead override
+	 * per-server settings of them, respectively.
 	 */
 	fpinfo->use_remote_estimate = false;
 	fpinfo->fdw_startup_cost = DEFAULT_FDW_STARTUP_COST;
@@ -651,6 +655,7 @@ postgresGetForeignRelSize(PlannerInfo *root,
 	fpinfo->shippable_extensions = NIL;
 	fpinfo->fetch_size = 100;
 	fpinfo->async_capable = false;
+	fpinfo->fetch_ahead = false;
 
 	apply_server_options(fpinfo);
 	apply_table_options(fpinfo);
@@ -1405,9 +1410,10 @@ postgresGetForeignPlan(PlannerInfo *root,
 	 * Build the fdw_private list that will be available to the executor.
 	 * Items in the list must match order in enum FdwScanPrivateIndex.
 	 */
-	fdw_private = list_make3(makeString(sql.data),
+	fdw_private = list_make4(makeString(sql.data),
 							 retrieved_attrs,
-							 makeInteger(fpinfo->fetch_size));
+							 makeInteger(fpinfo->fetch_size),
+							 makeBoolean(fpinfo->fetch_ahead));
 	if (IS_JOIN_REL(foreignrel) || IS_UPPER_REL(foreignrel))
 		fdw_private = lappend(fdw_private,
 							  makeString(fpinfo->relation_name));
@@ -1541,6 +1547,8 @@ postgresBeginForeignScan(ForeignScanState *node, int eflags)
 												 FdwScanPrivateRetrievedAttrs);
 	fsstate->fetch_size = intVal(list_nth(fsplan->fdw_private,
 										  FdwScanPrivateFetchSize));
+	fsstate->fetch_ahead = boolVal(list_nth(fsplan->fdw_private,
+											FdwScanPrivateFetchAhead));
 
 	/* Create contexts for batches of tuples and per-tuple temp workspace. */
 	fsstate->batch_cxt = AllocSetContextCreate(estate->es_query_cxt,
@@ -1582,6 +1590,13 @@ postgresBeginForeignScan(ForeignScanState *node, int eflags)
 
 	/* Set the async-capable flag */
 	fsstate->async_capable = node->ss.ps.async_capable;
+
+	/*
+	 * An async-capable scan already overlaps its fetches with other work, so
+	 * don't fetch ahead for it.
+	 */
+	if (fsstate->async_capable)
+		fsstate->fetch_ahead = false;
 }
 
 /*
@@ -1618,6 +1633,16 @@ postgresIterateForeignScan(ForeignScanState *node)
 		/* If we didn't get any tuples, must be end of data. */
 		if (fsstate->next_tuple >= fsstate->num_tuples)
 			return ExecClearTuple(slot);
+
+		/*
+		 * If requested, have the remote server produce the next batch while
+		 * we process this one.  We can only do that if the connection isn't
+		 * busy with another request.
+		 */
+		if (fsstate->fetch_ahead && !fsstate->eof_reached &&
+			!fsstate->conn_state->pendingAreq &&
+			!fsstate->conn_state->fetchAheadNode)
+			fetch_ahead_begin(node);
 	}
 
 	/*
@@ -1657,6 +1682,10 @@ postgresReScanForeignScan(ForeignScanState *node)
 		fsstate->conn_state->pendingAreq->requestee == (PlanState *) node)
 		fetch_more_data(node);
 
+	/* Likewise, collect the result of a FETCH we have sent ahead, if any. */
+	if (fsstate->conn_state->fetchAheadNode == node)
+		fetch_more_data(node);
+
 	/*
 	 * If any internal parameters affecting this node have changed, we'd
 	 * better destroy and recreate the cursor.  Otherwise, rewinding it should
@@ -3716,6 +3745,9 @@ create_cursor(ForeignScanState *node)
 	/* First, process a pending asynchronous request, if any. */
 	if (fsstate->conn_state->pendingAreq)
 		process_pending_request(fsstate->conn_state->pendingAreq);
+	/* Likewise for a FETCH sent ahead by another scan. */
+	if (fsstate->conn_state->fetchAheadNode)
+		process_fetch_ahead(fsstate->conn_state->fetchAheadNode);
 
 	/*
 	 * Construct array of query parameter values in text format.  We do the
@@ -3784,13 +3816,21 @@ fetch_more_data(ForeignScanState *node)
 	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
 	PGresult   *volatile res = NULL;
 	MemoryContext oldcontext;
+	int			nkeep;
 
 	/*
 	 * We'll store the tuples in the batch_cxt.  First, flush the previous
-	 * batch.
+	 * batch, unless we are collecting a FETCH sent ahead before the scan has
+	 * consumed it; in that case the remaining tuples are kept in front of
+	 * the new ones.
 	 */
-	fsstate->tuples = NULL;
-	MemoryContextReset(fsstate->batch_cxt);
+	nkeep = fsstate->tuples ? fsstate->num_tuples - fsstate->next_tuple : 0;
+	if (nkeep <= 0)
+	{
+		nkeep = 0;
+		fsstate->tuples = NULL;
+		MemoryContextReset(fsstate->batch_cxt);
+	}
 	oldcontext = MemoryContextSwitchTo(fsstate->batch_cxt);
 
 	/* PGresult must be released before leaving this function. */
@@ -3816,6 +3856,16 @@ fetch_more_data(ForeignScanState *node)
 			/* Reset per-connection state */
 			fsstate->conn_state->pendingAreq = NULL;
 		}
+		else if (fsstate->conn_state->fetchAheadNode == node)
+		{
+			/* The FETCH was already sent by fetch_ahead_begin. */
+			res = pgfdw_get_result(conn, fsstate->query);
+			/* On error, report the original query, not the FETCH. */
+			if (PQresultStatus(res) != PGRES_TUPLES_OK)
+				pgfdw_report_error(ERROR, res, conn, false, fsstate->query);
+
+			fsstate->conn_state->fetchAheadNode = NULL;
+		}
 		else
 		{
 			char		sql[64];
@@ -3832,15 +3882,26 @@ fetch_more_data(ForeignScanState *node)
 
 		/* Convert the data into HeapTuples */
 		numrows = PQntuples(res);
-		fsstate->tuples = (HeapTuple *) palloc0(numrows * sizeof(HeapTuple));
-		fsstate->num_tuples = numrows;
+		if (nkeep > 0)
+		{
+			HeapTuple  *oldtuples = fsstate->tuples;
+
+			fsstate->tuples = (HeapTuple *)
+				palloc0((nkeep + numrows) * sizeof(HeapTuple));
+			memcpy(fsstate->tuples, oldtuples + fsstate->next_tuple,
+				   nkeep * sizeof(HeapTuple));
+			pfree(oldtuples);
+		}
+		else
+			fsstate->tuples = (HeapTuple *) palloc0(numrows * sizeof(HeapTuple));
+		fsstate->num_tuples = nkeep + numrows;
 		fsstate->next_tuple = 0;
 
 		for (i = 0; i < numrows; i++)
 		{
 			Assert(IsA(node->ss.ps.plan, ForeignScan));
 
-			fsstate->tuples[i] =
+			fsstate->tuples[nkeep + i] =
 				make_tuple_from_result_row(res, i,
 										   fsstate->rel,
 										   fsstate->attinmeta,
@@ -4093,6 +4154,9 @@ execute_foreign_modify(EState *estate,
 	/* First, process a pending asynchronous request, if any. */
 	if (fmstate->conn_state->pendingAreq)
 		process_pending_request(fmstate->conn_state->pendingAreq);
+	/* Likewise for a FETCH sent ahead by a scan. */
+	if (fmstate->conn_state->fetchAheadNode)
+		process_fetch_ahead(fmstate->conn_state->fetchAheadNode);
 
 	/*
 	 * If the existing query was deparsed and prepared for a different number
@@ -4542,6 +4606,9 @@ execute_dml_stmt(ForeignScanState *node)
 	/* First, process a pending asynchronous request, if any. */
 	if (dmstate->conn_state->pendingAreq)
 		process_pending_request(dmstate->conn_state->pendingAreq);
+	/* Likewise for a FETCH sent ahead by a scan. */
+	if (dmstate->conn_state->fetchAheadNode)
+		process_fetch_ahead(dmstate->conn_state->fetchAheadNode);
 
 	/*
 	 * Construct array of query parameter values in text format.
@@ -6130,6 +6197,8 @@ apply_server_options(PgFdwRelationInfo *fpinfo)
 			(void) parse_int(defGetString(def), &fpinfo->fetch_size, 0, NULL);
 		else if (strcmp(def->defname, "async_capable") == 0)
 			fpinfo->async_capable = defGetBoolean(def);
+		else if (strcmp(def->defname, "fetch_ahead") == 0)
+			fpinfo->fetch_ahead = defGetBoolean(def);
 	}
 }
 
@@ -6153,6 +6222,8 @@ apply_table_options(PgFdwRelationInfo *fpinfo)
 			(void) parse_int(defGetString(def), &fpinfo->fetch_size, 0, NULL);
 		else if (strcmp(def->defname, "async_capable") == 0)
 			fpinfo->async_capable = defGetBoolean(def);
+		else if (strcmp(def->defname, "fetch_ahead") == 0)
+			fpinfo->fetch_ahead = defGetBoolean(def);
 	}
 }
 
@@ -6188,6 +6259,7 @@ merge_fdw_options(PgFdwRelationInfo *fpinfo,
 	fpinfo->use_remote_estimate = fpinfo_o->use_remote_estimate;
 	fpinfo->fetch_size = fpinfo_o->fetch_size;
 	fpinfo->async_capable = fpinfo_o->async_capable;
+	fpinfo->fetch_ahead = fpinfo_o->fetch_ahead;
 
 	/* Merge the table level options from either side of the join. */
 	if (fpinfo_i)
@@ -6219,6 +6291,10 @@ merge_fdw_options(PgFdwRelationInfo *fpinfo,
 		 */
 		fpinfo->async_capable = fpinfo_o->async_capable ||
 			fpinfo_i->async_capable;
+
+		/* Likewise, fetch ahead if either side of the join asks for it. */
+		fpinfo->fetch_ahead = fpinfo_o->fetch_ahead ||
+			fpinfo_i->fetch_ahead;
 	}
 }
 
@@ -7140,8 +7216,26 @@ postgresForeignAsyncConfigureWait(AsyncRequest *areq)
 	ForeignScanState *node = (ForeignScanState *) areq->requestee;
 	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
 	AsyncRequest *pendingAreq = fsstate->conn_state->pendingAreq;
-	AppendState *requestor = (AppendState *) areq->requestor;
-	WaitEventSet *set = requestor->as_eventset;
+	WaitEventSet *set;
+	Bitmapset  *needrequest;
+
+	/* The requestor is either an Append or a MergeAppend */
+	if (IsA(areq->requestor, AppendState))
+	{
+		AppendState *requestor = (AppendState *) areq->requestor;
+
+		set = requestor->as_eventset;
+		needrequest = requestor->as_needrequest;
+	}
+	else
+	{
+		MergeAppendState *requestor = castNode(MergeAppendState,
+											   areq->requestor);
+
+		/* A MergeAppend always waits for the one request it needs */
+		set = requestor->ms_eventset;
+		needrequest = NULL;
+	}
 
 	/* This should not be called unless callback_pending */
 	Assert(areq->callback_pending);
@@ -7181,7 +7275,7 @@ postgresForeignAsyncConfigureWait(AsyncRequest *areq)
 		 * to configure the event below, because we might otherwise end up
 		 * with no configured events other than the postmaster death event.
 		 */
-		if (!bms_is_empty(requestor->as_needrequest))
+		if (!bms_is_empty(needrequest))
 			return;
 		if (GetNumRegisteredWaitEvents(set) > 1)
 			return;
@@ -7327,6 +7421,10 @@ fetch_more_data_begin(AsyncRequest *areq)
 
 	Assert(!fsstate->conn_state->pendingAreq);
 
+	/* Collect a FETCH sent ahead by another scan, if any. */
+	if (fsstate->conn_state->fetchAheadNode)
+		process_fetch_ahead(fsstate->conn_state->fetchAheadNode);
+
 	/* Create the cursor synchronously. */
 	if (!fsstate->cursor_exists)
 		create_cursor(node);
@@ -7375,6 +7473,49 @@ process_pending_request(AsyncRequest *areq)
 	}
 }
 
+/*
+ * Send the FETCH for the next batch of a synchronous scan, without waiting
+ * for the response, so that the remote server produces it while we process
+ * the current batch.
+ *
+ * The connection is then busy until the result is collected by
+ * fetch_more_data, either when the scan needs the rows or, through
+ * process_fetch_ahead, when someone else needs the connection.
+ */
+static void
+fetch_ahead_begin(ForeignScanState *node)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+	char		sql[64];
+
+	Assert(fsstate->cursor_exists);
+	Assert(!fsstate->conn_state->pendingAreq);
+	Assert(!fsstate->conn_state->fetchAheadNode);
+
+	snprintf(sql, sizeof(sql), "FETCH %d FROM c%u",
+			 fsstate->fetch_size, fsstate->cursor_number);
+
+	if (!PQsendQuery(fsstate->conn, sql))
+		pgfdw_report_error(ERROR, NULL, fsstate->conn, false, fsstate->query);
+
+	fsstate->conn_state->fetchAheadNode = node;
+}
+
+/*
+ * Collect the result of a FETCH sent ahead by fetch_ahead_begin, so that the
+ * connection can be used for something else.  The rows are added to those
+ * the scan has not returned yet.
+ */
+void
+process_fetch_ahead(ForeignScanState *node)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+
+	Assert(fsstate->conn_state->fetchAheadNode == node);
+
+	fetch_more_data(node);
+}
+
 /*
  * Complete a pending asynchronous request.
  */
@@ -80,6 +80,7 @@ typedef struct PgFdwRelationInfo
 	Cost		fdw_tuple_cost;
 	List	   *shippable_extensions;	/* OIDs of shippable extensions */
 	bool		async_capable;
+	bool		fetch_ahead;
 
 	/* Cached catalog information. */
 	ForeignTable *table;
@@ -132,6 +133,8 @@ typedef struct PgFdwRelationInfo
 typedef struct PgFdwConnState
 {
 	AsyncRequest *pendingAreq;	/* pending async request */
+	ForeignScanState *fetchAheadNode;	/* scan whose next FETCH is in
+										 * flight, if any */
 } PgFdwConnState;
 
 /*
@@ -150,6 +153,7 @@ typedef enum PgFdwSamplingMethod
 extern int	set_transmission_modes(void);
 extern void reset_transmission_modes(int nestlevel);
 extern void process_pending_request(AsyncRequest *areq);
+extern void process_fetch_ahead(ForeignScanState *node);
 
 /* in connection.c */
 extern PGconn *GetConnection(UserMapping *user, bool will_prep_stmt,
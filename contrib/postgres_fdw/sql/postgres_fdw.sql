@@ -2872,6 +2872,14 @@ AND ftoptions @> array['fetch_size=60000'];
 
 ROLLBACK;
 
+-- Test fetching the next batch ahead, while the connection is also used
+-- by a subplan for every row
+BEGIN;
+ALTER FOREIGN TABLE ft1 OPTIONS (ADD fetch_size '10', ADD fetch_ahead 'true');
+SELECT count(*), sum(c1) FROM ft1 t1
+WHERE c1 <= 100 AND c2 = (SELECT c2 FROM ft2 t2 WHERE t2.c1 = t1.c1);
+ROLLBACK;
+
 -- ===================================================================
 -- test partitionwise joins
 -- ===================================================================
@@ -3634,6 +3642,13 @@ SELECT * FROM async_pt WHERE a < 3000;
 EXPLAIN (VERBOSE, COSTS OFF)
 SELECT * FROM async_pt WHERE a < 2000;
 
+-- Test async execution of MergeAppend
+SET enable_sort TO off;
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT * FROM async_pt WHERE a < 3000 ORDER BY b, a;
+SELECT * FROM async_pt WHERE a < 3000 ORDER BY b, a LIMIT 4;
+RESET enable_sort;
+
 -- Test interaction of async execution with run-time partition pruning
 SET plan_cache_mode TO force_generic_plan;
 
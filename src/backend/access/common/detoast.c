@@ -22,6 +22,9 @@
 #include "utils/expandeddatum.h"
 #include "utils/rel.h"
 
+/* least amount of data that detoast_iterate() detoasts at a time */
+#define DETOAST_ITERATE_MIN_LENGTH	4096
+
 static struct varlena *toast_fetch_datum(struct varlena *attr);
 static struct varlena *toast_fetch_datum_slice(struct varlena *attr,
 											   int32 sliceoffset,
@@ -246,8 +249,8 @@ detoast_attr_slice(struct varlena *attr,
 			 * Determine maximum amount of compressed data needed for a prefix
 			 * of a given length (after decompression).
 			 *
-			 * At least for now, if it's LZ4 data, we'll have to fetch the
-			 * whole thing, because there doesn't seem to be an API call to
+			 * At least for now, if it's LZ4 or zstd data, we'll have to fetch
+			 * the whole thing, because there doesn't seem to be an API call to
 			 * determine how much compressed data we need to be sure of being
 			 * able to decompress the required slice.
 			 */
@@ -332,6 +335,106 @@ detoast_attr_slice(struct varlena *attr,
 	return result;
 }
 
+/* ----------
+ * detoast_iterate_init -
+ *
+ *	Prepare to detoast a value incrementally, from the front.
+ *
+ * This is for callers that may only need to look at the front of a big
+ * value, but don't know in advance how much of it, like looking up a key in
+ * a jsonb object.  detoast_iterate() then fetches and decompresses more of
+ * the value when asked for data beyond what's already been detoasted,
+ * doubling the detoasted prefix each time, so that a value that turns out to
+ * be needed in whole isn't detoasted much more than twice.
+ * ----------
+ */
+void
+detoast_iterate_init(DetoastIterator *iter, struct varlena *attr)
+{
+	iter->attr = attr;
+	iter->buf = NULL;
+	iter->rawsize = toast_raw_datum_size(PointerGetDatum(attr)) - VARHDRSZ;
+	iter->append = false;
+	iter->done = false;
+
+	if (VARATT_IS_EXTERNAL_ONDISK(attr))
+	{
+		struct varatt_external toast_pointer;
+
+		VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+		if (!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
+			iter->append = true;
+		else if (VARATT_EXTERNAL_GET_COMPRESS_METHOD(toast_pointer) !=
+				 TOAST_PGLZ_COMPRESSION_ID)
+		{
+			/*
+			 * Any slice of LZ4 or zstd data needs all of the compressed data,
+			 * see detoast_attr_slice(), so fetch that only once.
+			 */
+			iter->attr = toast_fetch_datum(attr);
+		}
+	}
+	else if (!VARATT_IS_COMPRESSED(attr))
+	{
+		/* nothing to gain from doing it piecemeal */
+		iter->buf = detoast_attr(attr);
+		iter->done = true;
+	}
+}
+
+/* ----------
+ * detoast_iterate -
+ *
+ *	Return a pointer to the detoasted data of the value being iterated on,
+ *	of which at least the first 'length' bytes are valid.
+ *
+ * The result is only valid until the next call, as the data may be moved to
+ * make room for a longer prefix.
+ * ----------
+ */
+char *
+detoast_iterate(DetoastIterator *iter, Size length)
+{
+	int32		have;
+	int32		want;
+
+	if (length > iter->rawsize)
+		elog(ERROR, "requested %zu bytes of a toasted value of %d bytes",
+			 length, iter->rawsize);
+
+	have = iter->buf ? VARSIZE(iter->buf) - VARHDRSZ : 0;
+	if (iter->done || (iter->buf != NULL && length <= have))
+		return VARDATA(iter->buf);
+
+	want = Max((int32) length, Max(have, DETOAST_ITERATE_MIN_LENGTH / 2) * 2);
+	want = Min(want, iter->rawsize);
+
+	if (iter->append && iter->buf != NULL)
+	{
+		/* fetch just the missing part, and add it to what we have */
+		struct varlena *slice;
+
+		slice = toast_fetch_datum_slice(iter->attr, have, want - have);
+		iter->buf = repalloc(iter->buf, want + VARHDRSZ);
+		memcpy(VARDATA(iter->buf) + have, VARDATA(slice), want - have);
+		SET_VARSIZE(iter->buf, want + VARHDRSZ);
+		pfree(slice);
+	}
+	else
+	{
+		/* compressed data can only be decompressed from the start */
+		if (iter->buf != NULL)
+			pfree(iter->buf);
+		iter->buf = detoast_attr_slice(iter->attr, 0, want);
+	}
+
+	if (want == iter->rawsize)
+		iter->done = true;
+
+	return VARDATA(iter->buf);
+}
+
 /* ----------
  * toast_fetch_datum -
  *
@@ -485,6 +588,8 @@ toast_decompress_datum(struct varlena *attr)
 			return pglz_decompress_datum(attr);
 		case TOAST_LZ4_COMPRESSION_ID:
 			return lz4_decompress_datum(attr);
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return zstd_decompress_datum(attr);
 		default:
 			elog(ERROR, "invalid compression method id %d", cmid);
 			return NULL;		/* keep compiler quiet */
@@ -528,6 +633,8 @@ toast_decompress_datum_slice(struct varlena *attr, int32 slicelength)
 			return pglz_decompress_datum_slice(attr, slicelength);
 		case TOAST_LZ4_COMPRESSION_ID:
 			return lz4_decompress_datum_slice(attr, slicelength);
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return zstd_decompress_datum_slice(attr, slicelength);
 		default:
 			elog(ERROR, "invalid compression method id %d", cmid);
 			return NULL;		/* keep compiler quiet */
@@ -19,6 +19,8 @@
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
 #include "tcop/pquery.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memdebug.h"
 #include "utils/memutils.h"
@@ -40,14 +42,34 @@ static void printtup_destroy(DestReceiver *self);
  *
  * NOTE: finfo is the lookup info for either typoutput or typsend, whichever
  * we are using for this column.
+ *
+ * For the most common fixed-width types, whose output functions do nothing
+ * but convert the value, we format the value directly into the message
+ * instead of calling the function, which saves a palloc'd result per value.
+ * "direct" says which of these we can use for the column, if any.
  * ----------------
  */
+typedef enum
+{
+	PRINTTUP_DIRECT_NONE = 0,	/* call the output function */
+	PRINTTUP_DIRECT_INT2_TEXT,
+	PRINTTUP_DIRECT_INT4_TEXT,
+	PRINTTUP_DIRECT_INT8_TEXT,
+	PRINTTUP_DIRECT_BOOL_BINARY,
+	PRINTTUP_DIRECT_INT2_BINARY,
+	PRINTTUP_DIRECT_INT4_BINARY,
+	PRINTTUP_DIRECT_INT8_BINARY,
+	PRINTTUP_DIRECT_FLOAT4_BINARY,
+	PRINTTUP_DIRECT_FLOAT8_BINARY
+} PrinttupDirect;
+
 typedef struct
 {								/* Per-attribute information */
 	Oid			typoutput;		/* Oid for the type's text output fn */
 	Oid			typsend;		/* Oid for the type's binary output fn */
 	bool		typisvarlena;	/* is it varlena (ie possibly toastable)? */
 	int16		format;			/* format code for this column */
+	PrinttupDirect direct;		/* output without calling finfo? */
 	FmgrInfo	finfo;			/* Precomputed call info for output fn */
 } PrinttupAttrInfo;
 
@@ -278,6 +300,22 @@ printtup_prepare_info(DR_printtup *myState, TupleDesc typeinfo, int numAttrs)
 							  &thisState->typoutput,
 							  &thisState->typisvarlena);
 			fmgr_info(thisState->typoutput, &thisState->finfo);
+
+			switch (thisState->typoutput)
+			{
+				case F_INT2OUT:
+					thisState->direct = PRINTTUP_DIRECT_INT2_TEXT;
+					break;
+				case F_INT4OUT:
+					thisState->direct = PRINTTUP_DIRECT_INT4_TEXT;
+					break;
+				case F_INT8OUT:
+					thisState->direct = PRINTTUP_DIRECT_INT8_TEXT;
+					break;
+				default:
+					thisState->direct = PRINTTUP_DIRECT_NONE;
+					break;
+			}
 		}
 		else if (format == 1)
 		{
@@ -285,6 +323,35 @@ printtup_prepare_info(DR_printtup *myState, TupleDesc typeinfo, int numAttrs)
 									&thisState->typsend,
 									&thisState->typisvarlena);
 			fmgr_info(thisState->typsend, &thisState->finfo);
+
+			switch (thisState->typsend)
+			{
+				case F_BOOLSEND:
+					thisState->direct = PRINTTUP_DIRECT_BOOL_BINARY;
+					break;
+				case F_INT2SEND:
+					thisState->direct = PRINTTUP_DIRECT_INT2_BINARY;
+					break;
+				case F_INT4SEND:
+				case F_OIDSEND:
+				case F_DATE_SEND:
+					thisState->direct = PRINTTUP_DIRECT_INT4_BINARY;
+					break;
+				case F_INT8SEND:
+				case F_TIMESTAMP_SEND:
+				case F_TIMESTAMPTZ_SEND:
+					thisState->direct = PRINTTUP_DIRECT_INT8_BINARY;
+					break;
+				case F_FLOAT4SEND:
+					thisState->direct = PRINTTUP_DIRECT_FLOAT4_BINARY;
+					break;
+				case F_FLOAT8SEND:
+					thisState->direct = PRINTTUP_DIRECT_FLOAT8_BINARY;
+					break;
+				default:
+					thisState->direct = PRINTTUP_DIRECT_NONE;
+					break;
+			}
 		}
 		else
 			ereport(ERROR,
@@ -349,7 +416,56 @@ printtup(TupleTableSlot *slot, DestReceiver *self)
 			VALGRIND_CHECK_MEM_IS_DEFINED(DatumGetPointer(attr),
 										  VARSIZE_ANY(attr));
 
-		if (thisState->format == 0)
+		if (thisState->direct != PRINTTUP_DIRECT_NONE)
+		{
+			/* Output formatted without calling the output function */
+			char		str[MAXINT8LEN + 1];
+			int			len;
+
+			switch (thisState->direct)
+			{
+				case PRINTTUP_DIRECT_INT2_TEXT:
+					len = pg_ltoa(DatumGetInt16(attr), str);
+					pq_sendcountedtext(buf, str, len, false);
+					break;
+				case PRINTTUP_DIRECT_INT4_TEXT:
+					len = pg_ltoa(DatumGetInt32(attr), str);
+					pq_sendcountedtext(buf, str, len, false);
+					break;
+				case PRINTTUP_DIRECT_INT8_TEXT:
+					len = pg_lltoa(DatumGetInt64(attr), str);
+					pq_sendcountedtext(buf, str, len, false);
+					break;
+				case PRINTTUP_DIRECT_BOOL_BINARY:
+					pq_sendint32(buf, 1);
+					pq_sendbyte(buf, DatumGetBool(attr) ? 1 : 0);
+					break;
+				case PRINTTUP_DIRECT_INT2_BINARY:
+					pq_sendint32(buf, 2);
+					pq_sendint16(buf, DatumGetInt16(attr));
+					break;
+				case PRINTTUP_DIRECT_INT4_BINARY:
+					pq_sendint32(buf, 4);
+					pq_sendint32(buf, DatumGetInt32(attr));
+					break;
+				case PRINTTUP_DIRECT_INT8_BINARY:
+					pq_sendint32(buf, 8);
+					pq_sendint64(buf, DatumGetInt64(attr));
+					break;
+				case PRINTTUP_DIRECT_FLOAT4_BINARY:
+					pq_sendint32(buf, 4);
+					pq_sendfloat4(buf, DatumGetFloat4(attr));
+					break;
+				case PRINTTUP_DIRECT_FLOAT8_BINARY:
+					pq_sendint32(buf, 8);
+					pq_sendfloat8(buf, DatumGetFloat8(attr));
+					break;
+				case PRINTTUP_DIRECT_NONE:
+					Assert(false);
+					break;
+			}
+		}
+		else if (thisState->format == 0)
 		{
 			/* Text output */
 			char	   *outputstr;
@@ -104,6 +104,15 @@ static relopt_bool boolRelOpts[] =
 		},
 		false
 	},
+	{
+		{
+			"background_cleanup",
+			"Enables cleanup of the pending list by autovacuum instead of inserting backends",
+			RELOPT_KIND_GIN,
+			AccessExclusiveLock
+		},
+		false
+	},
 	{
 		{
 			"autovacuum_enabled",
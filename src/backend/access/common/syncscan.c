@@ -19,11 +19,20 @@
  * participating in the common scan.
  *
  * To accomplish that, we keep track of the scan position of each table, and
- * start new scans close to where the previous scan(s) are.  We don't try to
- * do any extra synchronization to keep the scans together afterwards; some
- * scans might progress much more slowly than others, for example if the
- * results need to be transferred to the client over a slow network, and we
- * don't want such queries to slow down others.
+ * start new scans close to where the previous scan(s) are.  By default, we
+ * don't try to do any extra synchronization to keep the scans together
+ * afterwards; some scans might progress much more slowly than others, for
+ * example if the results need to be transferred to the client over a slow
+ * network, and we don't want such queries to slow down others.
+ *
+ * When synchronize_seqscans_window is set, though, the scans form a group
+ * that is kept together: each scan also records its own position, and a
+ * scan that gets more than that many blocks ahead of another scan of the
+ * same table waits for it to catch up, so that the pages it reads are still
+ * in the buffer cache when the slower scan gets to them.  A scan that has
+ * not reported progress for SYNC_SCAN_STALL_TIMEOUT is not waited for, so a
+ * scan held up by its client, or by waiting for yet another scan, doesn't
+ * hold up the group for long.
  *
  * There can realistically only be a few large sequential scans on different
  * tables in progress at any time.  Therefore we just keep the scan positions
@@ -34,6 +43,8 @@
  * INTERFACE ROUTINES
  *		ss_get_location		- return current scan location of a relation
  *		ss_report_location	- update current scan location
+ *		ss_join_group		- take part in keeping scans of a relation together
+ *		ss_leave_group		- stop doing so, at the end of a scan
  *
  *
  * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
@@ -48,12 +59,17 @@
 
 #include "access/syncscan.h"
 #include "miscadmin.h"
+#include "storage/latch.h"
 #include "storage/lwlock.h"
+#include "storage/proc.h"
 #include "storage/shmem.h"
 #include "utils/rel.h"
+#include "utils/timestamp.h"
+#include "utils/wait_event.h"
 
 
 /* GUC variables */
+int			synchronize_seqscans_window = 0;
 #ifdef TRACE_SYNCSCAN
 bool		trace_syncscan = false;
 #endif
@@ -82,6 +98,12 @@ bool		trace_syncscan = false;
  */
 #define SYNC_SCAN_REPORT_INTERVAL (128 * 1024 / BLCKSZ)
 
+/*
+ * Time after which a scan that hasn't reported its location is no longer
+ * waited for by the scans ahead of it, in milliseconds.
+ */
+#define SYNC_SCAN_STALL_TIMEOUT 100
+
 
 /*
  * The scan locations structure is essentially a doubly-linked LRU with head
@@ -114,9 +136,28 @@ typedef struct ss_scan_locations_t
 /* Pointer to struct in shared memory */
 static ss_scan_locations_t *scan_locations;
 
+/*
+ * The position of the scan of a backend taking part in a group, with one
+ * entry per backend, indexed by pgprocno.  Protected by SyncScanLock.
+ */
+typedef struct ss_group_member_t
+{
+	RelFileLocator relfilelocator;	/* relation scanned, or invalid */
+	BlockNumber nblocks;		/* size of the relation when scan started */
+	BlockNumber location;		/* last-reported location */
+	TimestampTz report_time;	/* when it was reported */
+} ss_group_member_t;
+
+/* Pointer to array in shared memory */
+static ss_group_member_t *group_members;
+
+/* This backend's entry, if it is taking part in a group */
+static ss_group_member_t *MyGroupMember = NULL;
+
 /* prototypes for internal functions */
 static BlockNumber ss_search(RelFileLocator relfilelocator,
 							 BlockNumber location, bool set);
+static void ss_wait_for_group(Relation rel, BlockNumber location);
 
 
 /*
@@ -125,7 +166,8 @@ static BlockNumber ss_search(RelFileLocator relfilelocator,
 Size
 SyncScanShmemSize(void)
 {
-	return SizeOfScanLocations(SYNC_SCAN_NELEM);
+	return add_size(SizeOfScanLocations(SYNC_SCAN_NELEM),
+					mul_size(MaxBackends, sizeof(ss_group_member_t)));
 }
 
 /*
@@ -172,6 +214,30 @@ SyncScanShmemInit(void)
 	}
 	else
 		Assert(found);
+
+	group_members = (ss_group_member_t *)
+		ShmemInitStruct("Sync Scan Group Members",
+						mul_size(MaxBackends, sizeof(ss_group_member_t)),
+						&found);
+
+	if (!IsUnderPostmaster)
+	{
+		Assert(!found);
+
+		for (i = 0; i < MaxBackends; i++)
+		{
+			ss_group_member_t *member = &group_members[i];
+
+			member->relfilelocator.spcOid = InvalidOid;
+			member->relfilelocator.dbOid = InvalidOid;
+			member->relfilelocator.relNumber = InvalidRelFileNumber;
+			member->nblocks = 0;
+			member->location = InvalidBlockNumber;
+			member->report_time = 0;
+		}
+	}
+	else
+		Assert(found);
 }
 
 /*
@@ -308,9 +374,20 @@ ss_report_location(Relation rel, BlockNumber location)
 	 */
 	if ((location % SYNC_SCAN_REPORT_INTERVAL) == 0)
 	{
+		bool		ingroup;
+
+		ingroup = MyGroupMember != NULL &&
+			RelFileLocatorEquals(MyGroupMember->relfilelocator,
+								 rel->rd_locator);
+
 		if (LWLockConditionalAcquire(SyncScanLock, LW_EXCLUSIVE))
 		{
 			(void) ss_search(rel->rd_locator, location, true);
+			if (ingroup)
+			{
+				MyGroupMember->location = location;
+				MyGroupMember->report_time = GetCurrentTimestamp();
+			}
 			LWLockRelease(SyncScanLock);
 		}
 #ifdef TRACE_SYNCSCAN
@@ -319,5 +396,118 @@ ss_report_location(Relation rel, BlockNumber location)
 				 "SYNC_SCAN: missed update for \"%s\" at %u",
 				 RelationGetRelationName(rel), location);
 #endif
+
+		if (ingroup && synchronize_seqscans_window > 0)
+			ss_wait_for_group(rel, location);
+	}
+}
+
+/*
+ * ss_join_group --- take part in keeping the scans of a relation together
+ *
+ * Called at the start of a non-parallel scan that will report its location,
+ * with the number of blocks it will scan and its starting location.  Only
+ * one scan per backend takes part; a later call replaces an earlier one.
+ */
+void
+ss_join_group(Relation rel, BlockNumber relnblocks, BlockNumber startloc)
+{
+	if (synchronize_seqscans_window <= 0 || relnblocks == 0 ||
+		MyProc == NULL || MyProc->pgprocno >= MaxBackends)
+		return;
+
+	MyGroupMember = &group_members[MyProc->pgprocno];
+
+	LWLockAcquire(SyncScanLock, LW_EXCLUSIVE);
+	MyGroupMember->relfilelocator = rel->rd_locator;
+	MyGroupMember->nblocks = relnblocks;
+	MyGroupMember->location = startloc;
+	MyGroupMember->report_time = GetCurrentTimestamp();
+	LWLockRelease(SyncScanLock);
+}
+
+/*
+ * ss_leave_group --- stop taking part in keeping scans together
+ *
+ * Called at the end of a scan of rel, so that the scans ahead of it stop
+ * waiting for it at once.  Does nothing unless this backend takes part in
+ * a group for rel.
+ */
+void
+ss_leave_group(Relation rel)
+{
+	if (MyGroupMember == NULL ||
+		!RelFileLocatorEquals(MyGroupMember->relfilelocator, rel->rd_locator))
+		return;
+
+	LWLockAcquire(SyncScanLock, LW_EXCLUSIVE);
+	MyGroupMember->relfilelocator.spcOid = InvalidOid;
+	MyGroupMember->relfilelocator.dbOid = InvalidOid;
+	MyGroupMember->relfilelocator.relNumber = InvalidRelFileNumber;
+	MyGroupMember->location = InvalidBlockNumber;
+	LWLockRelease(SyncScanLock);
+
+	MyGroupMember = NULL;
+}
+
+/*
+ * ss_wait_for_group --- wait until no scan of rel lags too far behind us
+ *
+ * The lag of another scan is measured circularly, in the direction of the
+ * scan.  A scan that seems to be more than half the relation behind is
+ * rather taken to be ahead of us, and isn't waited for.
+ */
+static void
+ss_wait_for_group(Relation rel, BlockNumber location)
+{
+	BlockNumber nblocks = MyGroupMember->nblocks;
+
+	if (location >= nblocks)
+		return;
+
+	for (;;)
+	{
+		TimestampTz now = GetCurrentTimestamp();
+		bool		lagging = false;
+
+		LWLockAcquire(SyncScanLock, LW_SHARED);
+		for (int i = 0; i < MaxBackends; i++)
+		{
+			ss_group_member_t *member = &group_members[i];
+			BlockNumber lag;
+
+			if (member == MyGroupMember ||
+				!RelFileLocatorEquals(member->relfilelocator,
+									  rel->rd_locator) ||
+				member->location >= nblocks ||
+				TimestampDifferenceExceeds(member->report_time, now,
+										   SYNC_SCAN_STALL_TIMEOUT))
+				continue;
+
+			lag = (location + nblocks - member->location) % nblocks;
+			if (lag > synchronize_seqscans_window && lag <= nblocks / 2)
+			{
+				lagging = true;
+				break;
+			}
+		}
+		LWLockRelease(SyncScanLock);
+
+		if (!lagging)
+			break;
+
+#ifdef TRACE_SYNCSCAN
+		if (trace_syncscan)
+			elog(LOG,
+				 "SYNC_SCAN: waiting for group of \"%s\" at %u",
+				 RelationGetRelationName(rel), location);
+#endif
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 1, WAIT_EVENT_SYNC_SCAN_GROUP);
+		ResetLatch(MyLatch);
+
+		CHECK_FOR_INTERRUPTS();
 	}
 }
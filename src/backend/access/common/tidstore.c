@@ -0,0 +1,597 @@
+/*-------------------------------------------------------------------------
+ *
+ * tidstore.c
+ *	  Compact storage for a set of TIDs, for use by VACUUM.
+ *
+ * A TidStore holds the TIDs of dead heap tuples that VACUUM has collected, so
+ * that index vacuuming can test each index tuple's heap TID for membership.
+ * Instead of an array of ItemPointerData, the TIDs are stored per heap block:
+ * each block that has any TIDs gets an entry holding its block number, and a
+ * bitmap with one bit per offset number, just long enough to cover the
+ * highest offset number stored for the block.  Since VACUUM usually finds
+ * several dead tuples on each page it touches, this takes much less memory
+ * than six bytes per TID.
+ *
+ * Blocks must be added in ascending block number order, each of them only
+ * once, which is the order in which VACUUM scans the heap.  That keeps the
+ * block entries sorted without any extra work.  To find a block quickly, a
+ * directory with one slot per TIDSTORE_SLOT_BLOCKS consecutive block numbers
+ * records where the slot's block entries and bitmap words begin, so a lookup
+ * only needs to binary search the few entries of one slot.
+ *
+ * The store can live in backend-local memory, or in a DSA area so that
+ * parallel workers can use it.  In the shared case, only the backend that
+ * created the store may add TIDs, and only while no other backend is
+ * attached; other backends only read it.  That is how parallel VACUUM uses
+ * it: the leader collects TIDs during the heap scan, and the workers attach
+ * to the store for index vacuuming once that's done.  Hence no locking is
+ * needed.
+ *
+ * Several backends can also divide an iteration through the store between
+ * them, as parallel VACUUM does for its second pass over the heap: each
+ * participant uses a TidStoreBeginSharedIterate() iterator, and each block is
+ * returned to only one of them.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/common/tidstore.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/tidstore.h"
+#include "port/atomics.h"
+#include "port/pg_bitutils.h"
+#include "storage/off.h"
+#include "utils/memutils.h"
+
+/* number of consecutive block numbers covered by one directory slot */
+#define TIDSTORE_SLOT_SHIFT		12
+#define TIDSTORE_SLOT_BLOCKS	(1 << TIDSTORE_SLOT_SHIFT)
+
+#define TIDSTORE_WORD_BITS		64
+#define TIDSTORE_WORDNUM(off)	((off) / TIDSTORE_WORD_BITS)
+#define TIDSTORE_BITNUM(off)	((off) % TIDSTORE_WORD_BITS)
+
+/* A block that has TIDs in the store */
+typedef struct TidStoreBlock
+{
+	BlockNumber blkno;
+	uint32		wordno;			/* first bitmap word, relative to the slot's
+								 * firstword */
+} TidStoreBlock;
+
+/* A directory slot */
+typedef struct TidStoreSlot
+{
+	int64		firstblock;		/* index of the slot's first block entry */
+	int64		firstword;		/* index of that block's first bitmap word */
+} TidStoreSlot;
+
+/*
+ * The control object.  In the shared case it is allocated in the DSA area,
+ * and the arrays are referenced through the dsa_pointers.
+ */
+typedef struct TidStoreControl
+{
+	size_t		max_bytes;		/* memory budget given by the creator */
+	int64		num_tids;		/* number of TIDs stored */
+
+	int64		num_blocks;		/* used and allocated block entries */
+	int64		max_blocks;
+	int64		num_words;		/* used and allocated bitmap words */
+	int64		max_words;
+	int64		num_slots;		/* used and allocated directory slots */
+	int64		max_slots;
+
+	/* next block entry to hand out to a shared iteration */
+	pg_atomic_uint64 shared_iter_next;
+
+	/* only used in the shared case */
+	dsa_pointer handle;			/* points to this object */
+	dsa_pointer blocks_dp;
+	dsa_pointer words_dp;
+	dsa_pointer slots_dp;
+} TidStoreControl;
+
+/* Per-backend state */
+struct TidStore
+{
+	TidStoreControl *control;
+	dsa_area   *area;			/* NULL for a backend-local store */
+	MemoryContext context;		/* holds everything in the local case */
+
+	/* the arrays, as addresses valid in this backend */
+	TidStoreBlock *blocks;
+	uint64	   *words;
+	TidStoreSlot *slots;
+};
+
+struct TidStoreIter
+{
+	TidStore   *ts;
+	bool		shared;			/* claim blocks from shared_iter_next? */
+	int64		next_block;		/* next block entry to return */
+	TidStoreIterResult result;
+	OffsetNumber offsets[MaxOffsetNumber];
+};
+
+static void tidstore_refresh_pointers(TidStore *ts);
+static void *tidstore_grow(TidStore *ts, void *array, dsa_pointer *dp,
+						   int64 *maxelems, int64 needed, Size elemsize);
+static int64 tidstore_block_firstword(TidStore *ts, int64 blockidx);
+static int64 tidstore_block_endword(TidStore *ts, int64 blockidx);
+
+
+/*
+ * Create a TidStore.  'max_bytes' is the amount of memory that the caller
+ * means to let the store use; the store avoids allocating much more than
+ * that, but it's up to the caller to stop adding TIDs once
+ * TidStoreMemoryUsage() exceeds it.
+ *
+ * If 'area' is not NULL, the store is allocated in that DSA area, and other
+ * backends can attach to it with TidStoreAttach(), given the handle returned
+ * by TidStoreGetHandle().
+ */
+TidStore *
+TidStoreCreate(size_t max_bytes, dsa_area *area)
+{
+	TidStore   *ts;
+	TidStoreControl *control;
+
+	ts = (TidStore *) palloc0(sizeof(TidStore));
+	ts->area = area;
+
+	if (area != NULL)
+	{
+		dsa_pointer dp;
+
+		dp = dsa_allocate0(area, sizeof(TidStoreControl));
+		control = (TidStoreControl *) dsa_get_address(area, dp);
+		control->handle = dp;
+		control->blocks_dp = InvalidDsaPointer;
+		control->words_dp = InvalidDsaPointer;
+		control->slots_dp = InvalidDsaPointer;
+	}
+	else
+	{
+		ts->context = AllocSetContextCreate(CurrentMemoryContext,
+											"TID store",
+											ALLOCSET_DEFAULT_SIZES);
+		control = (TidStoreControl *)
+			MemoryContextAllocZero(ts->context, sizeof(TidStoreControl));
+		control->handle = InvalidDsaPointer;
+	}
+
+	control->max_bytes = max_bytes;
+	pg_atomic_init_u64(&control->shared_iter_next, 0);
+	ts->control = control;
+
+	return ts;
+}
+
+/*
+ * Attach to a shared TidStore, for reading.
+ */
+TidStore *
+TidStoreAttach(dsa_area *area, dsa_pointer handle)
+{
+	TidStore   *ts;
+
+	Assert(area != NULL);
+	Assert(DsaPointerIsValid(handle));
+
+	ts = (TidStore *) palloc0(sizeof(TidStore));
+	ts->area = area;
+	ts->control = (TidStoreControl *) dsa_get_address(area, handle);
+	tidstore_refresh_pointers(ts);
+
+	return ts;
+}
+
+/*
+ * Detach from a shared TidStore.  The store itself is left alone.
+ */
+void
+TidStoreDetach(TidStore *ts)
+{
+	Assert(ts->area != NULL);
+
+	pfree(ts);
+}
+
+/*
+ * Free a TidStore and all the memory it uses.  In the shared case, this must
+ * be done by the creator, after all other backends have detached.
+ */
+void
+TidStoreDestroy(TidStore *ts)
+{
+	if (ts->area != NULL)
+	{
+		TidStoreReset(ts);
+		dsa_free(ts->area, ts->control->handle);
+	}
+	else
+		MemoryContextDelete(ts->context);
+
+	pfree(ts);
+}
+
+/*
+ * Forget all the TIDs, and release the memory used to store them.
+ */
+void
+TidStoreReset(TidStore *ts)
+{
+	TidStoreControl *control = ts->control;
+
+	if (ts->area != NULL)
+	{
+		if (DsaPointerIsValid(control->blocks_dp))
+			dsa_free(ts->area, control->blocks_dp);
+		if (DsaPointerIsValid(control->words_dp))
+			dsa_free(ts->area, control->words_dp);
+		if (DsaPointerIsValid(control->slots_dp))
+			dsa_free(ts->area, control->slots_dp);
+		control->blocks_dp = InvalidDsaPointer;
+		control->words_dp = InvalidDsaPointer;
+		control->slots_dp = InvalidDsaPointer;
+	}
+	else
+	{
+		if (ts->blocks)
+			pfree(ts->blocks);
+		if (ts->words)
+			pfree(ts->words);
+		if (ts->slots)
+			pfree(ts->slots);
+	}
+
+	ts->blocks = NULL;
+	ts->words = NULL;
+	ts->slots = NULL;
+
+	control->num_tids = 0;
+	control->num_blocks = control->max_blocks = 0;
+	control->num_words = control->max_words = 0;
+	control->num_slots = control->max_slots = 0;
+}
+
+/*
+ * Add the TIDs of one heap block to the store.  'offsets' must be sorted in
+ * ascending order, and 'blkno' must be higher than that of any block added
+ * since the store was created or last reset.
+ */
+void
+TidStoreSetBlockOffsets(TidStore *ts, BlockNumber blkno,
+						OffsetNumber *offsets, int num_offsets)
+{
+	TidStoreControl *control = ts->control;
+	int64		slotno = blkno >> TIDSTORE_SLOT_SHIFT;
+	int			nwords;
+	uint64	   *words;
+	TidStoreBlock *block;
+
+	Assert(num_offsets > 0);
+	Assert(control->num_blocks == 0 ||
+		   ts->blocks[control->num_blocks - 1].blkno < blkno);
+
+	nwords = TIDSTORE_WORDNUM(offsets[num_offsets - 1]) + 1;
+
+	/* Make room for the new block entry, its words, and any new slots */
+	if (control->num_slots <= slotno)
+		ts->slots = tidstore_grow(ts, ts->slots, &control->slots_dp,
+								  &control->max_slots, slotno + 1,
+								  sizeof(TidStoreSlot));
+	ts->blocks = tidstore_grow(ts, ts->blocks, &control->blocks_dp,
+							   &control->max_blocks, control->num_blocks + 1,
+							   sizeof(TidStoreBlock));
+	ts->words = tidstore_grow(ts, ts->words, &control->words_dp,
+							  &control->max_words, control->num_words + nwords,
+							  sizeof(uint64));
+
+	/* Any slots we skip over are empty; they begin where this block does */
+	while (control->num_slots <= slotno)
+	{
+		TidStoreSlot *slot = &ts->slots[control->num_slots++];
+
+		slot->firstblock = control->num_blocks;
+		slot->firstword = control->num_words;
+	}
+
+	block = &ts->blocks[control->num_blocks];
+	block->blkno = blkno;
+	block->wordno = control->num_words - ts->slots[slotno].firstword;
+
+	words = &ts->words[control->num_words];
+	memset(words, 0, nwords * sizeof(uint64));
+	for (int i = 0; i < num_offsets; i++)
+	{
+		OffsetNumber off = offsets[i];
+
+		Assert(OffsetNumberIsValid(off));
+		Assert(i == 0 || offsets[i - 1] < off);
+		words[TIDSTORE_WORDNUM(off)] |= UINT64CONST(1) << TIDSTORE_BITNUM(off);
+	}
+
+	control->num_blocks++;
+	control->num_words += nwords;
+	control->num_tids += num_offsets;
+}
+
+/*
+ * Is 'tid' in the store?
+ *
+ * This is called for every index tuple during index vacuuming, so it pays to
+ * be fast.
+ */
+bool
+TidStoreIsMember(TidStore *ts, ItemPointer tid)
+{
+	TidStoreControl *control = ts->control;
+	BlockNumber blkno = ItemPointerGetBlockNumber(tid);
+	OffsetNumber off = ItemPointerGetOffsetNumber(tid);
+	int64		slotno = blkno >> TIDSTORE_SLOT_SHIFT;
+	int64		low,
+				high;
+
+	if (slotno >= control->num_slots)
+		return false;
+
+	/* Binary search the block entries of the slot */
+	low = ts->slots[slotno].firstblock;
+	high = (slotno + 1 < control->num_slots) ?
+		ts->slots[slotno + 1].firstblock : control->num_blocks;
+
+	while (low < high)
+	{
+		int64		mid = low + (high - low) / 2;
+		BlockNumber midblk = ts->blocks[mid].blkno;
+
+		if (midblk < blkno)
+			low = mid + 1;
+		else if (midblk > blkno)
+			high = mid;
+		else
+		{
+			int64		wordno = tidstore_block_firstword(ts, mid) +
+				TIDSTORE_WORDNUM(off);
+
+			if (wordno >= tidstore_block_endword(ts, mid))
+				return false;
+			return (ts->words[wordno] &
+					(UINT64CONST(1) << TIDSTORE_BITNUM(off))) != 0;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Prepare to iterate through the store, in ascending block number order.
+ * The store must not be modified during the iteration.
+ */
+TidStoreIter *
+TidStoreBeginIterate(TidStore *ts)
+{
+	TidStoreIter *iter;
+
+	iter = (TidStoreIter *) palloc0(sizeof(TidStoreIter));
+	iter->ts = ts;
+	iter->next_block = 0;
+	iter->result.offsets = iter->offsets;
+
+	return iter;
+}
+
+/*
+ * Prepare for a shared iteration.  This must be called before any backend
+ * calls TidStoreBeginSharedIterate(), while nobody else is using the store.
+ */
+void
+TidStorePrepareSharedIterate(TidStore *ts)
+{
+	pg_atomic_write_u64(&ts->control->shared_iter_next, 0);
+}
+
+/*
+ * Prepare to take part in a shared iteration.  The blocks are returned in
+ * ascending order, but the other participants get some of them.
+ */
+TidStoreIter *
+TidStoreBeginSharedIterate(TidStore *ts)
+{
+	TidStoreIter *iter = TidStoreBeginIterate(ts);
+
+	iter->shared = true;
+
+	return iter;
+}
+
+/*
+ * Return the TIDs of the next block, or NULL at the end of the store.  The
+ * result is only valid until the next call.
+ */
+TidStoreIterResult *
+TidStoreIterateNext(TidStoreIter *iter)
+{
+	TidStore   *ts = iter->ts;
+	int64		blockidx;
+	int64		endword;
+	int			num_offsets = 0;
+
+	if (iter->shared)
+		blockidx = (int64)
+			pg_atomic_fetch_add_u64(&ts->control->shared_iter_next, 1);
+	else
+		blockidx = iter->next_block;
+
+	if (blockidx >= ts->control->num_blocks)
+		return NULL;
+
+	endword = tidstore_block_endword(ts, blockidx);
+	for (int64 wordno = tidstore_block_firstword(ts, blockidx),
+		 base = 0;
+		 wordno < endword;
+		 wordno++, base += TIDSTORE_WORD_BITS)
+	{
+		uint64		word = ts->words[wordno];
+
+		while (word != 0)
+		{
+			int			bit = pg_rightmost_one_pos64(word);
+
+			Assert(num_offsets < MaxOffsetNumber);
+			iter->offsets[num_offsets++] = (OffsetNumber) (base + bit);
+			word &= word - 1;
+		}
+	}
+
+	iter->result.blkno = ts->blocks[blockidx].blkno;
+	iter->result.num_offsets = num_offsets;
+	iter->next_block = blockidx + 1;
+
+	return &iter->result;
+}
+
+void
+TidStoreEndIterate(TidStoreIter *iter)
+{
+	pfree(iter);
+}
+
+/*
+ * Return the number of TIDs in the store.
+ */
+int64
+TidStoreNumTids(TidStore *ts)
+{
+	return ts->control->num_tids;
+}
+
+/*
+ * Return the number of blocks that have TIDs in the store.
+ */
+int64
+TidStoreNumBlocks(TidStore *ts)
+{
+	return ts->control->num_blocks;
+}
+
+/*
+ * Return the amount of memory the store has allocated, in bytes.
+ */
+size_t
+TidStoreMemoryUsage(TidStore *ts)
+{
+	TidStoreControl *control = ts->control;
+
+	return sizeof(TidStoreControl) +
+		control->max_blocks * sizeof(TidStoreBlock) +
+		control->max_words * sizeof(uint64) +
+		control->max_slots * sizeof(TidStoreSlot);
+}
+
+/*
+ * Return the handle that other backends can pass to TidStoreAttach().
+ */
+dsa_pointer
+TidStoreGetHandle(TidStore *ts)
+{
+	Assert(ts->area != NULL);
+
+	return ts->control->handle;
+}
+
+/*
+ * Set the backend-local addresses of the arrays of a shared store.
+ */
+static void
+tidstore_refresh_pointers(TidStore *ts)
+{
+	TidStoreControl *control = ts->control;
+
+	ts->blocks = DsaPointerIsValid(control->blocks_dp) ?
+		dsa_get_address(ts->area, control->blocks_dp) : NULL;
+	ts->words = DsaPointerIsValid(control->words_dp) ?
+		dsa_get_address(ts->area, control->words_dp) : NULL;
+	ts->slots = DsaPointerIsValid(control->slots_dp) ?
+		dsa_get_address(ts->area, control->slots_dp) : NULL;
+}
+
+/*
+ * Make sure that 'array' has room for at least 'needed' elements, enlarging
+ * it if necessary, and return its (possibly new) address.
+ *
+ * We normally double the allocation, but not beyond what fits into the
+ * store's memory budget, as long as the needed elements do fit.
+ */
+static void *
+tidstore_grow(TidStore *ts, void *array, dsa_pointer *dp, int64 *maxelems,
+			  int64 needed, Size elemsize)
+{
+	TidStoreControl *control = ts->control;
+	size_t		used = TidStoreMemoryUsage(ts) - *maxelems * elemsize;
+	int64		newmax;
+	void	   *newarray;
+
+	if (needed <= *maxelems)
+		return array;
+
+	newmax = Max(Max(*maxelems * 2, needed), 64);
+	if (used + newmax * elemsize > control->max_bytes &&
+		used + needed * elemsize <= control->max_bytes)
+		newmax = (control->max_bytes - used) / elemsize;
+
+	if (ts->area != NULL)
+	{
+		dsa_pointer newdp;
+
+		newdp = dsa_allocate_extended(ts->area, newmax * elemsize,
+									  DSA_ALLOC_HUGE);
+		newarray = dsa_get_address(ts->area, newdp);
+		if (array != NULL)
+		{
+			memcpy(newarray, array, *maxelems * elemsize);
+			dsa_free(ts->area, *dp);
+		}
+		*dp = newdp;
+	}
+	else if (array != NULL)
+		newarray = repalloc_huge(array, newmax * elemsize);
+	else
+		newarray = MemoryContextAllocHuge(ts->context, newmax * elemsize);
+
+	*maxelems = newmax;
+
+	return newarray;
+}
+
+/*
+ * Return the index of the first bitmap word of the given block entry.
+ */
+static inline int64
+tidstore_block_firstword(TidStore *ts, int64 blockidx)
+{
+	TidStoreBlock *block = &ts->blocks[blockidx];
+
+	return ts->slots[block->blkno >> TIDSTORE_SLOT_SHIFT].firstword +
+		block->wordno;
+}
+
+/*
+ * Return the index just past the last bitmap word of the given block entry;
+ * that's where the next block's words begin.
+ */
+static inline int64
+tidstore_block_endword(TidStore *ts, int64 blockidx)
+{
+	if (blockidx + 1 < ts->control->num_blocks)
+		return tidstore_block_firstword(ts, blockidx + 1);
+	return ts->control->num_words;
+}
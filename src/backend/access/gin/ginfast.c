@@ -457,12 +457,32 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 
 	END_CRIT_SECTION();
 
+	if (!needCleanup)
+		return;
+
+	/*
+	 * If the index asks for it, leave the cleanup to an autovacuum worker, so
+	 * that this insertion doesn't have to pay for it.  If autovacuum isn't
+	 * running or the request can't be queued, do it ourselves after all.
+	 */
+	if (GinGetBackgroundCleanup(index) && AutoVacuumingActive())
+	{
+		if (AutoVacuumRequestWork(AVW_GINCleanupPendingList,
+								  RelationGetRelid(index),
+								  InvalidBlockNumber))
+			return;
+
+		ereport(LOG,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("request for GIN pending list cleanup for index \"%s\" was not recorded",
+						RelationGetRelationName(index))));
+	}
+
 	/*
 	 * Since it could contend with concurrent cleanup process we cleanup
 	 * pending list not forcibly.
 	 */
-	if (needCleanup)
-		ginInsertCleanup(ginstate, false, true, false, NULL);
+	ginInsertCleanup(ginstate, false, true, false, NULL);
 }
 
 /*
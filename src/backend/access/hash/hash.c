@@ -73,8 +73,10 @@ hashhandler(PG_FUNCTION_ARGS)
 	amroutine->amclusterable = false;
 	amroutine->ampredlocks = true;
 	amroutine->amcanparallel = false;
+	amroutine->amcanbuildparallel = true;
 	amroutine->amcaninclude = false;
 	amroutine->amusemaintenanceworkmem = false;
+	amroutine->amsummarizing = false;
 	amroutine->amparallelvacuumoptions =
 		VACUUM_OPTION_PARALLEL_BULKDEL;
 	amroutine->amkeytype = INT4OID;
@@ -82,6 +84,7 @@ hashhandler(PG_FUNCTION_ARGS)
 	amroutine->ambuild = hashbuild;
 	amroutine->ambuildempty = hashbuildempty;
 	amroutine->aminsert = hashinsert;
+	amroutine->aminsertbatch = NULL;
 	amroutine->ambulkdelete = hashbulkdelete;
 	amroutine->amvacuumcleanup = hashvacuumcleanup;
 	amroutine->amcanreturn = NULL;
@@ -133,6 +136,21 @@ hashbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	/* Initialize the hash index metadata page and initial buckets */
 	num_buckets = _hash_init(index, reltuples, MAIN_FORKNUM);
 
+	/*
+	 * A parallel build always sorts: each participant sorts the tuples from
+	 * its share of the table, and we insert the merged result.  If no
+	 * workers can be launched, fall back to a serial build.
+	 */
+	if (indexInfo->ii_ParallelWorkers > 0 &&
+		_h_build_parallel(heap, index, indexInfo, num_buckets,
+						  &reltuples, &buildstate.indtuples))
+	{
+		result = (IndexBuildResult *) palloc(sizeof(IndexBuildResult));
+		result->heap_tuples = reltuples;
+		result->index_tuples = buildstate.indtuples;
+		return result;
+	}
+
 	/*
 	 * If we just insert the tuples into the index in scan order, then
 	 * (assuming their hash codes are pretty random) there will be no locality
@@ -26,6 +26,14 @@
 
 static void _hash_vacuum_one_page(Relation rel, Relation hrel,
 								  Buffer metabuf, Buffer buf);
+static Buffer _hash_lock_insert_bucket(Relation rel, uint32 hashkey,
+									   Buffer *metabufp,
+									   HashMetaPage *usedmetap);
+static Buffer _hash_find_insert_page(Relation rel, Relation heapRel,
+									 Buffer metabuf, Buffer bucket_buf,
+									 Buffer buf, Size itemsz);
+static bool _hash_insert_onpage(Relation rel, Buffer metabuf, Buffer buf,
+								IndexTuple itup, Size itemsz, bool sorted);
 
 /*
  *	_hash_doinsert() -- Handle insertion of a single index tuple.
@@ -39,19 +47,13 @@ static void _hash_vacuum_one_page(Relation rel, Relation hrel,
 void
 _hash_doinsert(Relation rel, IndexTuple itup, Relation heapRel, bool sorted)
 {
-	Buffer		buf = InvalidBuffer;
+	Buffer		buf;
 	Buffer		bucket_buf;
 	Buffer		metabuf;
-	HashMetaPage metap;
 	HashMetaPage usedmetap = NULL;
-	Page		metapage;
-	Page		page;
-	HashPageOpaque pageopaque;
 	Size		itemsz;
 	bool		do_expand;
 	uint32		hashkey;
-	Bucket		bucket;
-	OffsetNumber itup_off;
 
 	/*
 	 * Get the hash key for the item (it's stored in the index tuple itself).
@@ -63,6 +65,119 @@ _hash_doinsert(Relation rel, IndexTuple itup, Relation heapRel, bool sorted)
 	itemsz = MAXALIGN(itemsz);	/* be safe, PageAddItem will do this but we
 								 * need to be consistent */
 
+	/* Lock the primary bucket page for the target bucket. */
+	bucket_buf = _hash_lock_insert_bucket(rel, hashkey, &metabuf, &usedmetap);
+
+	/* Find a page in the bucket chain with room for the item */
+	buf = _hash_find_insert_page(rel, heapRel, metabuf, bucket_buf,
+								 bucket_buf, itemsz);
+
+	/* Do the insertion */
+	do_expand = _hash_insert_onpage(rel, metabuf, buf, itup, itemsz, sorted);
+
+	/*
+	 * Release the modified page and ensure to release the pin on primary
+	 * page.
+	 */
+	_hash_relbuf(rel, buf);
+	if (buf != bucket_buf)
+		_hash_dropbuf(rel, bucket_buf);
+
+	/* Attempt to split if a split is needed */
+	if (do_expand)
+		_hash_expandtable(rel, metabuf);
+
+	/* Finally drop our pin on the metapage */
+	_hash_dropbuf(rel, metabuf);
+}
+
+/*
+ *	_hash_doinsert_multi() -- Handle insertion of several index tuples.
+ *
+ *		Consecutive tuples that belong to the same bucket are inserted while
+ *		we hold the lock on the bucket, instead of locating and locking the
+ *		primary bucket page again for each of them, and the search for free
+ *		space resumes on the page where the previous tuple went.  Callers get
+ *		the most out of this by grouping the tuples by bucket, as the sorted
+ *		index build does.
+ *
+ * 'sorted' has the same meaning as for _hash_doinsert().
+ */
+void
+_hash_doinsert_multi(Relation rel, IndexTuple *itups, int nitups,
+					 Relation heapRel, bool sorted)
+{
+	int			i = 0;
+
+	while (i < nitups)
+	{
+		Buffer		buf;
+		Buffer		bucket_buf;
+		Buffer		metabuf;
+		HashMetaPage usedmetap = NULL;
+		Bucket		bucket;
+		bool		do_expand = false;
+
+		/* Lock the primary bucket page for the next tuple's bucket. */
+		bucket_buf = _hash_lock_insert_bucket(rel,
+											  _hash_get_indextuple_hashkey(itups[i]),
+											  &metabuf, &usedmetap);
+		bucket = HashPageGetOpaque(BufferGetPage(bucket_buf))->hasho_bucket;
+		buf = bucket_buf;
+
+		/*
+		 * Insert this tuple, and all the following ones that belong to the
+		 * same bucket.  The cached metapage that led us to this bucket is
+		 * good enough to tell which tuples belong to it, as long as we hold
+		 * the pin on the primary bucket page: the bucket can't be split
+		 * meanwhile.  Stop early if the index needs to be expanded, though.
+		 */
+		do
+		{
+			IndexTuple	itup = itups[i];
+			Size		itemsz;
+
+			itemsz = IndexTupleSize(itup);
+			itemsz = MAXALIGN(itemsz);
+
+			buf = _hash_find_insert_page(rel, heapRel, metabuf, bucket_buf,
+										 buf, itemsz);
+			do_expand = _hash_insert_onpage(rel, metabuf, buf, itup, itemsz,
+											sorted);
+			i++;
+		} while (i < nitups && !do_expand &&
+				 _hash_hashkey2bucket(_hash_get_indextuple_hashkey(itups[i]),
+									  usedmetap->hashm_maxbucket,
+									  usedmetap->hashm_highmask,
+									  usedmetap->hashm_lowmask) == bucket);
+
+		_hash_relbuf(rel, buf);
+		if (buf != bucket_buf)
+			_hash_dropbuf(rel, bucket_buf);
+
+		if (do_expand)
+			_hash_expandtable(rel, metabuf);
+
+		_hash_dropbuf(rel, metabuf);
+	}
+}
+
+/*
+ *	_hash_lock_insert_bucket() -- Pin and write-lock the primary bucket page
+ *		into which a tuple with the given hash key must be inserted.
+ *
+ * Also pins the metapage, without locking it, and returns it in *metabufp.
+ * *usedmetap is set to the cached metapage used to find the bucket.  If the
+ * bucket is being split, we first try to finish the split.
+ */
+static Buffer
+_hash_lock_insert_bucket(Relation rel, uint32 hashkey, Buffer *metabufp,
+						 HashMetaPage *usedmetap)
+{
+	Buffer		buf;
+	Buffer		metabuf;
+	HashPageOpaque pageopaque;
+
 restart_insert:
 
 	/*
@@ -71,35 +186,15 @@ restart_insert:
 	 * without a lock.
 	 */
 	metabuf = _hash_getbuf(rel, HASH_METAPAGE, HASH_NOLOCK, LH_META_PAGE);
-	metapage = BufferGetPage(metabuf);
-
-	/*
-	 * Check whether the item can fit on a hash page at all. (Eventually, we
-	 * ought to try to apply TOAST methods if not.)  Note that at this point,
-	 * itemsz doesn't include the ItemId.
-	 *
-	 * XXX this is useless code if we are only storing hash keys.
-	 */
-	if (itemsz > HashMaxItemSize(metapage))
-		ereport(ERROR,
-				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
-				 errmsg("index row size %zu exceeds hash maximum %zu",
-						itemsz, HashMaxItemSize(metapage)),
-				 errhint("Values larger than a buffer page cannot be indexed.")));
 
 	/* Lock the primary bucket page for the target bucket. */
 	buf = _hash_getbucketbuf_from_hashkey(rel, hashkey, HASH_WRITE,
-										  &usedmetap);
-	Assert(usedmetap != NULL);
+										  usedmetap);
+	Assert(*usedmetap != NULL);
 
 	CheckForSerializableConflictIn(rel, NULL, BufferGetBlockNumber(buf));
 
-	/* remember the primary bucket buffer to release the pin on it at end. */
-	bucket_buf = buf;
-
-	page = BufferGetPage(buf);
-	pageopaque = HashPageGetOpaque(page);
-	bucket = pageopaque->hasho_bucket;
+	pageopaque = HashPageGetOpaque(BufferGetPage(buf));
 
 	/*
 	 * If this bucket is in the process of being split, try to finish the
@@ -115,10 +210,10 @@ restart_insert:
 		/* release the lock on bucket buffer, before completing the split. */
 		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
 
-		_hash_finish_split(rel, metabuf, buf, bucket,
-						   usedmetap->hashm_maxbucket,
-						   usedmetap->hashm_highmask,
-						   usedmetap->hashm_lowmask);
+		_hash_finish_split(rel, metabuf, buf, pageopaque->hasho_bucket,
+						   (*usedmetap)->hashm_maxbucket,
+						   (*usedmetap)->hashm_highmask,
+						   (*usedmetap)->hashm_lowmask);
 
 		/* release the pin on old and meta buffer.  retry for insert. */
 		_hash_dropbuf(rel, buf);
@@ -126,7 +221,41 @@ restart_insert:
 		goto restart_insert;
 	}
 
-	/* Do the insertion */
+	*metabufp = metabuf;
+	return buf;
+}
+
+/*
+ *	_hash_find_insert_page() -- Find a page with room for an item of size
+ *		itemsz in the bucket chain of bucket_buf.
+ *
+ * The search starts at buf, which must be bucket_buf or one of its overflow
+ * pages, and be write-locked.  Returns the write-locked page to insert into;
+ * buf is released on the way if we move past it, except that the pin on the
+ * primary bucket page is always retained.
+ */
+static Buffer
+_hash_find_insert_page(Relation rel, Relation heapRel, Buffer metabuf,
+					   Buffer bucket_buf, Buffer buf, Size itemsz)
+{
+	Page		page = BufferGetPage(buf);
+	HashPageOpaque pageopaque = HashPageGetOpaque(page);
+	PG_USED_FOR_ASSERTS_ONLY Bucket bucket = pageopaque->hasho_bucket;
+
+	/*
+	 * Check whether the item can fit on a hash page at all. (Eventually, we
+	 * ought to try to apply TOAST methods if not.)  Note that at this point,
+	 * itemsz doesn't include the ItemId.
+	 *
+	 * XXX this is useless code if we are only storing hash keys.
+	 */
+	if (itemsz > HashMaxItemSize(BufferGetPage(metabuf)))
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("index row size %zu exceeds hash maximum %zu",
+						itemsz, HashMaxItemSize(BufferGetPage(metabuf))),
+				 errhint("Values larger than a buffer page cannot be indexed.")));
+
 	while (PageGetFreeSpace(page) < itemsz)
 	{
 		BlockNumber nextblkno;
@@ -191,6 +320,23 @@ restart_insert:
 		Assert(pageopaque->hasho_bucket == bucket);
 	}
 
+	return buf;
+}
+
+/*
+ *	_hash_insert_onpage() -- Add an item to a write-locked page that has
+ *		room for it, and count it in the metapage.
+ *
+ * Returns true if the index should now be expanded.
+ */
+static bool
+_hash_insert_onpage(Relation rel, Buffer metabuf, Buffer buf,
+					IndexTuple itup, Size itemsz, bool sorted)
+{
+	HashMetaPage metap;
+	OffsetNumber itup_off;
+	bool		do_expand;
+
 	/*
 	 * Write-lock the metapage so we can increment the tuple count. After
 	 * incrementing it, check to see if it's time for a split.
@@ -205,7 +351,7 @@ restart_insert:
 	MarkBufferDirty(buf);
 
 	/* metapage operations */
-	metap = HashPageGetMeta(metapage);
+	metap = HashPageGetMeta(BufferGetPage(metabuf));
 	metap->hashm_ntuples += 1;
 
 	/* Make sure this stays in sync with _hash_expandtable() */
@@ -241,20 +387,7 @@ restart_insert:
 	/* drop lock on metapage, but keep pin */
 	LockBuffer(metabuf, BUFFER_LOCK_UNLOCK);
 
-	/*
-	 * Release the modified page and ensure to release the pin on primary
-	 * page.
-	 */
-	_hash_relbuf(rel, buf);
-	if (buf != bucket_buf)
-		_hash_dropbuf(rel, bucket_buf);
-
-	/* Attempt to split if a split is needed */
-	if (do_expand)
-		_hash_expandtable(rel, metabuf);
-
-	/* Finally drop our pin on the metapage */
-	_hash_dropbuf(rel, metabuf);
+	return do_expand;
 }
 
 /*
@@ -13,6 +13,16 @@
  * hash code value.  That's no big problem though, since we'll still have
  * plenty of locality of access.
  *
+ * The sorted tuples are inserted a bucket at a time, so that each bucket is
+ * located and locked only once per batch of tuples rather than once per
+ * tuple.
+ *
+ * Parallel builds spool and sort the tuples in each participant, through a
+ * coordinated tuplesort, and the leader inserts the merged stream into the
+ * index.  Insertion itself is not parallelized: every insertion updates the
+ * tuple count in the metapage, and may trigger a split, so the participants
+ * would mostly be waiting for each other.
+ *
  *
  * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -26,12 +36,36 @@
 #include "postgres.h"
 
 #include "access/hash.h"
+#include "access/parallel.h"
+#include "access/relscan.h"
+#include "access/table.h"
+#include "access/tableam.h"
+#include "access/xact.h"
+#include "catalog/index.h"
 #include "commands/progress.h"
+#include "executor/instrument.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "port/pg_bitutils.h"
+#include "storage/condition_variable.h"
+#include "storage/proc.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
 #include "utils/tuplesort.h"
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_HASH_SHARED		UINT64CONST(0xE000000000000001)
+#define PARALLEL_KEY_TUPLESORT			UINT64CONST(0xE000000000000002)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xE000000000000003)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xE000000000000004)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xE000000000000005)
+
+/* Maximum number of sorted tuples passed to _hash_doinsert_multi() at once */
+#define HASH_INSERT_BATCH_SIZE	1024
+
 
 /*
  * Status record for spooling/sorting phase.
@@ -52,12 +86,141 @@ struct HSpool
 	uint32		max_buckets;
 };
 
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment.
+ */
+typedef struct HashShared
+{
+	/*
+	 * These fields are not modified during the build.  They primarily exist
+	 * for the benefit of worker processes that need to create state
+	 * corresponding to that used by the leader.  All participants must sort
+	 * with the same bucket masks, so num_buckets is passed along too.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	int			scantuplesortstates;
+	uint32		num_buckets;
+
+	/*
+	 * workersdonecv is used to monitor the progress of workers.  All parallel
+	 * participants must indicate that they are done before leader can use
+	 * results built by the workers (and before leader can write the data into
+	 * the index).
+	 */
+	ConditionVariable workersdonecv;
+
+	/*
+	 * mutex protects all fields before heapdesc.
+	 *
+	 * nparticipantsdone is number of worker processes finished.
+	 *
+	 * reltuples is the total number of input heap tuples.
+	 *
+	 * indtuples is the total number of tuples spooled for the index.
+	 */
+	slock_t		mutex;
+	int			nparticipantsdone;
+	double		reltuples;
+	double		indtuples;
+
+	/*
+	 * ParallelTableScanDescData data follows. Can't directly embed here, as
+	 * implementations of the parallel table scan desc interface might need
+	 * stronger alignment.
+	 */
+} HashShared;
+
+/*
+ * Return pointer to a HashShared's parallel table scan.
+ *
+ * c.f. shm_toc_allocate as to why BUFFERALIGN is used, rather than just
+ * MAXALIGN.
+ */
+#define ParallelTableScanFromHashShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(HashShared)))
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct HashLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * nparticipanttuplesorts is the exact number of worker processes
+	 * successfully launched, plus one leader process, which always
+	 * participates as a worker.
+	 */
+	int			nparticipanttuplesorts;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).
+	 *
+	 * hashshared is the shared state for entire build.  sharedsort is the
+	 * shared, tuplesort-managed state passed to each process tuplesort.
+	 * snapshot is the snapshot used by the scan iff an MVCC snapshot is
+	 * required.
+	 */
+	HashShared *hashshared;
+	Sharedsort *sharedsort;
+	Snapshot	snapshot;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+} HashLeader;
+
+/* Working state of a participant in a parallel build */
+typedef struct HashParallelBuildState
+{
+	HSpool	   *spool;
+	double		indtuples;
+} HashParallelBuildState;
+
+static HSpool *_h_spoolinit_internal(Relation heap, Relation index,
+									 uint32 num_buckets, int sortmem,
+									 SortCoordinate coordinate);
+static HashLeader *_h_begin_parallel(Relation heap, Relation index,
+									 bool isconcurrent, int request,
+									 uint32 num_buckets);
+static void _h_end_parallel(HashLeader *hashleader);
+static Size _h_parallel_estimate_shared(Relation heap, Snapshot snapshot);
+static double _h_parallel_heapscan(HashLeader *hashleader,
+								   double *indtuples);
+static void _h_parallel_scan_and_sort(HashShared *hashshared,
+									  Sharedsort *sharedsort,
+									  Relation heap, Relation index,
+									  int sortmem, bool progress);
+static void _h_parallel_build_callback(Relation index, ItemPointer tid,
+									   Datum *values, bool *isnull,
+									   bool tupleIsAlive, void *state);
+
 
 /*
  * create and initialize a spool structure
  */
 HSpool *
 _h_spoolinit(Relation heap, Relation index, uint32 num_buckets)
+{
+	/*
+	 * We size the sort area as maintenance_work_mem rather than work_mem to
+	 * speed index creation.  This should be OK since a single backend can't
+	 * run multiple index creations in parallel.
+	 */
+	return _h_spoolinit_internal(heap, index, num_buckets,
+								 maintenance_work_mem, NULL);
+}
+
+/*
+ * create and initialize a spool structure, using sortmem kilobytes of memory
+ * and, in a parallel build, the given tuplesort coordination state
+ */
+static HSpool *
+_h_spoolinit_internal(Relation heap, Relation index, uint32 num_buckets,
+					  int sortmem, SortCoordinate coordinate)
 {
 	HSpool	   *hspool = (HSpool *) palloc0(sizeof(HSpool));
 
@@ -75,18 +238,13 @@ _h_spoolinit(Relation heap, Relation index, uint32 num_buckets)
 	hspool->low_mask = (hspool->high_mask >> 1);
 	hspool->max_buckets = num_buckets - 1;
 
-	/*
-	 * We size the sort area as maintenance_work_mem rather than work_mem to
-	 * speed index creation.  This should be OK since a single backend can't
-	 * run multiple index creations in parallel.
-	 */
 	hspool->sortstate = tuplesort_begin_index_hash(heap,
 												   index,
 												   hspool->high_mask,
 												   hspool->low_mask,
 												   hspool->max_buckets,
-												   maintenance_work_mem,
-												   NULL,
+												   sortmem,
+												   coordinate,
 												   TUPLESORT_NONE);
 
 	return hspool;
@@ -120,15 +278,32 @@ void
 _h_indexbuild(HSpool *hspool, Relation heapRel)
 {
 	IndexTuple	itup;
+	IndexTuple	itups[HASH_INSERT_BATCH_SIZE];
+	int			nitups = 0;
+	Bucket		batchbucket = 0;
+	MemoryContext batchcxt;
+	MemoryContext oldcxt;
 	int64		tups_done = 0;
-#ifdef USE_ASSERT_CHECKING
-	uint32		hashkey = 0;
-#endif
 
 	tuplesort_performsort(hspool->sortstate);
 
+	batchcxt = AllocSetContextCreate(CurrentMemoryContext,
+									 "Hash build batch context",
+									 ALLOCSET_DEFAULT_SIZES);
+
+	/*
+	 * Collect the tuples of each bucket, and insert them together.  The
+	 * tuples are copied out of the tuplesort, as they are only valid until
+	 * the next fetch.
+	 */
 	while ((itup = tuplesort_getindextuple(hspool->sortstate, true)) != NULL)
 	{
+		Bucket		bucket;
+
+		bucket = _hash_hashkey2bucket(_hash_get_indextuple_hashkey(itup),
+									  hspool->max_buckets, hspool->high_mask,
+									  hspool->low_mask);
+
 		/*
 		 * Technically, it isn't critical that hash keys be found in sorted
 		 * order, since this sorting is only used to increase locality of
@@ -136,19 +311,508 @@ _h_indexbuild(HSpool *hspool, Relation heapRel)
 		 * idea to test tuplesort.c's handling of hash index tuple sorts
 		 * through an assertion, though.
 		 */
-#ifdef USE_ASSERT_CHECKING
-		uint32		lasthashkey = hashkey;
+		Assert(nitups == 0 || bucket >= batchbucket);
 
-		hashkey = _hash_hashkey2bucket(_hash_get_indextuple_hashkey(itup),
-									   hspool->max_buckets, hspool->high_mask,
-									   hspool->low_mask);
-		Assert(hashkey >= lasthashkey);
-#endif
+		if (nitups > 0 &&
+			(bucket != batchbucket || nitups == HASH_INSERT_BATCH_SIZE))
+		{
+			/* the tuples are sorted by hashkey, so pass 'sorted' as true */
+			_hash_doinsert_multi(hspool->index, itups, nitups, heapRel, true);
+			MemoryContextReset(batchcxt);
 
-		/* the tuples are sorted by hashkey, so pass 'sorted' as true */
-		_hash_doinsert(hspool->index, itup, heapRel, true);
+			tups_done += nitups;
+			pgstat_progress_update_param(PROGRESS_CREATEIDX_TUPLES_DONE,
+										 tups_done);
+			nitups = 0;
+		}
 
+		oldcxt = MemoryContextSwitchTo(batchcxt);
+		itups[nitups++] = CopyIndexTuple(itup);
+		MemoryContextSwitchTo(oldcxt);
+		batchbucket = bucket;
+	}
+
+	if (nitups > 0)
+	{
+		_hash_doinsert_multi(hspool->index, itups, nitups, heapRel, true);
+		tups_done += nitups;
 		pgstat_progress_update_param(PROGRESS_CREATEIDX_TUPLES_DONE,
-									 ++tups_done);
+									 tups_done);
 	}
+
+	MemoryContextDelete(batchcxt);
+}
+
+/*
+ * Build the hash index with parallel workers.
+ *
+ * Each participant, leader included, scans its share of the table and sorts
+ * the tuples it extracts; the leader then inserts the merged stream into
+ * the index, like the serial sorted build does.
+ *
+ * Returns false, without doing anything, if no workers could be launched,
+ * in which case the caller should do a serial build.  Otherwise sets
+ * *reltuples and *indtuples to the number of heap tuples scanned and the
+ * number of tuples inserted into the index, and returns true.
+ */
+bool
+_h_build_parallel(Relation heap, Relation index, IndexInfo *indexInfo,
+				  uint32 num_buckets, double *reltuples, double *indtuples)
+{
+	HashLeader *hashleader;
+	SortCoordinate coordinate;
+	HSpool	   *hspool;
+
+	Assert(indexInfo->ii_ParallelWorkers > 0);
+
+	hashleader = _h_begin_parallel(heap, index, indexInfo->ii_Concurrent,
+								   indexInfo->ii_ParallelWorkers,
+								   num_buckets);
+	if (hashleader == NULL)
+		return false;
+
+	/*
+	 * Set up the leader's tuplesort, to read the tuples sorted by all the
+	 * participants in bucket order.
+	 */
+	coordinate = (SortCoordinate) palloc0(sizeof(SortCoordinateData));
+	coordinate->isWorker = false;
+	coordinate->nParticipants = hashleader->nparticipanttuplesorts;
+	coordinate->sharedsort = hashleader->sharedsort;
+
+	hspool = _h_spoolinit_internal(heap, index, num_buckets,
+								   maintenance_work_mem, coordinate);
+
+	/* wait for workers to scan the table and sort their tuples */
+	*reltuples = _h_parallel_heapscan(hashleader, indtuples);
+	pgstat_progress_update_param(PROGRESS_CREATEIDX_TUPLES_TOTAL,
+								 *indtuples);
+
+	/* merge the sorted runs and insert the tuples into the index */
+	_h_indexbuild(hspool, heap);
+	_h_spooldestroy(hspool);
+
+	_h_end_parallel(hashleader);
+
+	return true;
+}
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Returns the HashLeader, which the caller must pass to _h_end_parallel() at
+ * the very end of its index build, after the leader has done its share of
+ * the scan.  If not even a single worker process can be launched, returns
+ * NULL, and the caller should proceed with a serial index build.
+ */
+static HashLeader *
+_h_begin_parallel(Relation heap, Relation index, bool isconcurrent,
+				  int request, uint32 num_buckets)
+{
+	ParallelContext *pcxt;
+	int			scantuplesortstates;
+	Snapshot	snapshot;
+	Size		esthashshared;
+	Size		estsort;
+	HashShared *hashshared;
+	Sharedsort *sharedsort;
+	HashLeader *hashleader = (HashLeader *) palloc0(sizeof(HashLeader));
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	int			querylen;
+
+	/*
+	 * Enter parallel mode, and create context for parallel build of hash
+	 * index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_hash_parallel_build_main",
+								 request);
+
+	/* The leader always participates as a worker */
+	scantuplesortstates = request + 1;
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time
+	 * qual checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_HASH_SHARED workspace, and
+	 * PARALLEL_KEY_TUPLESORT tuplesort workspace
+	 */
+	esthashshared = _h_parallel_estimate_shared(heap, snapshot);
+	shm_toc_estimate_chunk(&pcxt->estimator, esthashshared);
+	estsort = tuplesort_estimate_shared(scantuplesortstates);
+	shm_toc_estimate_chunk(&pcxt->estimator, estsort);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/*
+	 * Estimate space for WalUsage and BufferUsage -- PARALLEL_KEY_WAL_USAGE
+	 * and PARALLEL_KEY_BUFFER_USAGE.
+	 *
+	 * If there are no extensions loaded that care, we could skip this.  We
+	 * have no way of knowing whether anyone's looking at pgWalUsage or
+	 * pgBufferUsage, so do it unconditionally.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		if (IsMVCCSnapshot(snapshot))
+			UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return NULL;
+	}
+
+	/* Store shared build state, for which we reserved space */
+	hashshared = (HashShared *) shm_toc_allocate(pcxt->toc, esthashshared);
+	/* Initialize immutable state */
+	hashshared->heaprelid = RelationGetRelid(heap);
+	hashshared->indexrelid = RelationGetRelid(index);
+	hashshared->isconcurrent = isconcurrent;
+	hashshared->scantuplesortstates = scantuplesortstates;
+	hashshared->num_buckets = num_buckets;
+	ConditionVariableInit(&hashshared->workersdonecv);
+	SpinLockInit(&hashshared->mutex);
+	/* Initialize mutable state */
+	hashshared->nparticipantsdone = 0;
+	hashshared->reltuples = 0.0;
+	hashshared->indtuples = 0.0;
+	table_parallelscan_initialize(heap,
+								  ParallelTableScanFromHashShared(hashshared),
+								  snapshot);
+
+	/*
+	 * Store shared tuplesort-private state, for which we reserved space.
+	 * Then, initialize opaque state using tuplesort routine.
+	 */
+	sharedsort = (Sharedsort *) shm_toc_allocate(pcxt->toc, estsort);
+	tuplesort_initialize_shared(sharedsort, scantuplesortstates,
+								pcxt->seg);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_HASH_SHARED, hashshared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT, sharedsort);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/*
+	 * Allocate space for each worker's WalUsage and BufferUsage; no need to
+	 * initialize.
+	 */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	hashleader->pcxt = pcxt;
+	hashleader->nparticipanttuplesorts = pcxt->nworkers_launched + 1;
+	hashleader->hashshared = hashshared;
+	hashleader->sharedsort = sharedsort;
+	hashleader->snapshot = snapshot;
+	hashleader->walusage = walusage;
+	hashleader->bufferusage = bufferusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_h_end_parallel(hashleader);
+		return NULL;
+	}
+
+	/*
+	 * Caller needs to wait for all launched workers when we return.  Make
+	 * sure that the failure-to-start case will not hang forever.  This must
+	 * happen before we know the number of participants for sure, and the
+	 * workers wait for that before sharing their sorted runs, so do it
+	 * before participating as a worker ourselves.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+	tuplesort_set_participants(sharedsort, hashleader->nparticipanttuplesorts);
+
+	/*
+	 * Join heap scan ourselves.  Might as well use reliable figure when
+	 * doling out maintenance_work_mem (when requested number of workers were
+	 * not launched, this will be somewhat higher than it is for other
+	 * workers).
+	 */
+	_h_parallel_scan_and_sort(hashshared, sharedsort, heap, index,
+							  maintenance_work_mem / hashleader->nparticipanttuplesorts,
+							  true);
+
+	return hashleader;
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ */
+static void
+_h_end_parallel(HashLeader *hashleader)
+{
+	int			i;
+
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(hashleader->pcxt);
+
+	/*
+	 * Next, accumulate WAL usage.  (This must wait for the workers to finish,
+	 * or we might get incomplete data.)
+	 */
+	for (i = 0; i < hashleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&hashleader->bufferusage[i], &hashleader->walusage[i]);
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(hashleader->snapshot))
+		UnregisterSnapshot(hashleader->snapshot);
+	DestroyParallelContext(hashleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Returns size of shared memory required to store state for a parallel
+ * hash index build based on the snapshot its parallel scan will use.
+ */
+static Size
+_h_parallel_estimate_shared(Relation heap, Snapshot snapshot)
+{
+	/* c.f. shm_toc_allocate as to why BUFFERALIGN is used */
+	return add_size(BUFFERALIGN(sizeof(HashShared)),
+					table_parallelscan_estimate(heap, snapshot));
+}
+
+/*
+ * Within leader, wait for end of heap scan.
+ *
+ * When called, parallel heap scan started by _h_begin_parallel() will
+ * already be underway within worker processes (the leader has already
+ * done its own share, as a participant).
+ *
+ * Fills in the number of tuples spooled for the index, and returns the
+ * total number of heap tuples scanned.
+ */
+static double
+_h_parallel_heapscan(HashLeader *hashleader, double *indtuples)
+{
+	HashShared *hashshared = hashleader->hashshared;
+	double		reltuples;
+
+	for (;;)
+	{
+		SpinLockAcquire(&hashshared->mutex);
+		if (hashshared->nparticipantsdone == hashleader->nparticipanttuplesorts)
+		{
+			*indtuples = hashshared->indtuples;
+			reltuples = hashshared->reltuples;
+			SpinLockRelease(&hashshared->mutex);
+			break;
+		}
+		SpinLockRelease(&hashshared->mutex);
+
+		ConditionVariableSleep(&hashshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	return reltuples;
+}
+
+/*
+ * Perform a worker's portion of a parallel build.
+ *
+ * This scans the share of the table handed out to us by the parallel scan,
+ * and sorts the tuples extracted from it, for the leader to merge.
+ *
+ * sortmem is the amount of working memory to use within each worker,
+ * expressed in KBs.
+ *
+ * When this returns, workers are done, and need only release resources.
+ */
+static void
+_h_parallel_scan_and_sort(HashShared *hashshared, Sharedsort *sharedsort,
+						  Relation heap, Relation index,
+						  int sortmem, bool progress)
+{
+	HashParallelBuildState buildstate;
+	SortCoordinate coordinate;
+	TableScanDesc scan;
+	double		reltuples;
+	IndexInfo  *indexInfo;
+
+	/* Initialize local tuplesort coordination state */
+	coordinate = palloc0(sizeof(SortCoordinateData));
+	coordinate->isWorker = true;
+	coordinate->nParticipants = -1;
+	coordinate->sharedsort = sharedsort;
+
+	/* Begin "partial" tuplesort */
+	buildstate.spool = _h_spoolinit_internal(heap, index,
+											 hashshared->num_buckets,
+											 sortmem, coordinate);
+	buildstate.indtuples = 0;
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = hashshared->isconcurrent;
+
+	scan = table_beginscan_parallel(heap,
+									ParallelTableScanFromHashShared(hashshared));
+
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, progress,
+									   _h_parallel_build_callback,
+									   (void *) &buildstate, scan);
+
+	/* sort the tuples spooled by this participant */
+	tuplesort_performsort(buildstate.spool->sortstate);
+
+	/*
+	 * Done.  Record ambuild statistics.
+	 */
+	SpinLockAcquire(&hashshared->mutex);
+	hashshared->nparticipantsdone++;
+	hashshared->reltuples += reltuples;
+	hashshared->indtuples += buildstate.indtuples;
+	SpinLockRelease(&hashshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&hashshared->workersdonecv);
+
+	_h_spooldestroy(buildstate.spool);
+}
+
+/*
+ * Per-tuple callback for table_index_build_scan, in a parallel build
+ */
+static void
+_h_parallel_build_callback(Relation index, ItemPointer tid, Datum *values,
+						   bool *isnull, bool tupleIsAlive, void *state)
+{
+	HashParallelBuildState *buildstate = (HashParallelBuildState *) state;
+	Datum		index_values[1];
+	bool		index_isnull[1];
+
+	/* convert data to a hash key; on failure, do not insert anything */
+	if (!_hash_convert_tuple(index,
+							 values, isnull,
+							 index_values, index_isnull))
+		return;
+
+	_h_spool(buildstate->spool, tid, index_values, index_isnull);
+
+	buildstate->indtuples += 1;
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_hash_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	HashShared *hashshared;
+	Sharedsort *sharedsort;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	int			sortmem;
+
+	/*
+	 * The only possible status flag that can be set to the parallel worker is
+	 * PROC_IN_SAFE_IC.
+	 */
+	Assert((MyProc->statusFlags == 0) ||
+		   (MyProc->statusFlags == PROC_IN_SAFE_IC));
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up hash shared state */
+	hashshared = shm_toc_lookup(toc, PARALLEL_KEY_HASH_SHARED, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!hashshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = table_open(hashshared->heaprelid, heapLockmode);
+	indexRel = index_open(hashshared->indexrelid, indexLockmode);
+
+	/* Look up shared state private to tuplesort.c */
+	sharedsort = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT, false);
+	tuplesort_attach_shared(sharedsort, seg);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	/* Perform our share of the build */
+	sortmem = maintenance_work_mem / hashshared->scantuplesortstates;
+
+	_h_parallel_scan_and_sort(hashshared, sharedsort, heapRel, indexRel,
+							  sortmem, false);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
 }
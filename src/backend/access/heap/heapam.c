@@ -313,6 +313,8 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 	{
 		scan->rs_base.rs_flags |= SO_ALLOW_SYNC;
 		scan->rs_startblock = ss_get_location(scan->rs_base.rs_rd, scan->rs_nblocks);
+		ss_join_group(scan->rs_base.rs_rd, scan->rs_nblocks,
+					  scan->rs_startblock);
 	}
 	else
 	{
@@ -322,6 +324,7 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 
 	scan->rs_numblocks = InvalidBlockNumber;
 	scan->rs_inited = false;
+	scan->rs_prefetch_ahead = 0;
 	scan->rs_ctup.t_data = NULL;
 	ItemPointerSetInvalid(&scan->rs_ctup.t_self);
 	scan->rs_cbuf = InvalidBuffer;
@@ -705,6 +708,56 @@ heapgettup_advance_block(HeapScanDesc scan, BlockNumber block, ScanDirection dir
 	}
 }
 
+/*
+ * heapgettup_prefetch - issue read-ahead for the blocks following 'block'
+ *
+ * Forward scans read blocks in a predictable order: consecutively (with
+ * wraparound) for serial scans, and consecutively within the current chunk
+ * for parallel scans.  Rather than relying on the kernel's readahead
+ * heuristics, keep up to seqscan_prefetch_depth of the upcoming blocks
+ * prefetched, so that their I/O is in flight by the time we get to them.
+ * We never look past the end of the current parallel chunk, since the next
+ * chunk may be handed to a different worker.
+ */
+static inline void
+heapgettup_prefetch(HeapScanDesc scan, BlockNumber block, ScanDirection dir)
+{
+#ifdef USE_PREFETCH
+	BlockNumber remaining;
+	int			target;
+
+	if (seqscan_prefetch_depth <= 0 || !ScanDirectionIsForward(dir))
+	{
+		scan->rs_prefetch_ahead = 0;
+		return;
+	}
+
+	/* determine how many blocks of the scan are known to follow this one */
+	if (scan->rs_base.rs_parallel != NULL)
+		remaining = scan->rs_parallelworkerdata->phsw_chunk_remaining;
+	else if (scan->rs_numblocks != InvalidBlockNumber)
+		remaining = scan->rs_numblocks - 1;
+	else
+		remaining = (scan->rs_startblock + scan->rs_nblocks - block - 1) %
+			scan->rs_nblocks;
+
+	/* the block we're about to read is no longer ahead of us */
+	if (scan->rs_prefetch_ahead > 0)
+		scan->rs_prefetch_ahead--;
+
+	target = (int) Min((BlockNumber) seqscan_prefetch_depth, remaining);
+	if (scan->rs_prefetch_ahead > target)
+		scan->rs_prefetch_ahead = target;
+
+	while (scan->rs_prefetch_ahead < target)
+	{
+		scan->rs_prefetch_ahead++;
+		PrefetchBuffer(scan->rs_base.rs_rd, MAIN_FORKNUM,
+					   (block + scan->rs_prefetch_ahead) % scan->rs_nblocks);
+	}
+#endif							/* USE_PREFETCH */
+}
+
 /* ----------------
  *		heapgettup - fetch next heap tuple
  *
@@ -760,6 +813,7 @@ heapgettup(HeapScanDesc scan,
 	 */
 	while (block != InvalidBlockNumber)
 	{
+		heapgettup_prefetch(scan, block, dir);
 		heapgetpage((TableScanDesc) scan, block);
 		LockBuffer(scan->rs_cbuf, BUFFER_LOCK_SHARE);
 		page = heapgettup_start_page(scan, dir, &linesleft, &lineoff);
@@ -882,6 +936,7 @@ heapgettup_pagemode(HeapScanDesc scan,
 	 */
 	while (block != InvalidBlockNumber)
 	{
+		heapgettup_prefetch(scan, block, dir);
 		heapgetpage((TableScanDesc) scan, block);
 		page = BufferGetPage(scan->rs_cbuf);
 		TestForOldSnapshot(scan->rs_base.rs_snapshot, scan->rs_base.rs_rd, page);
@@ -1069,6 +1124,11 @@ heap_endscan(TableScanDesc sscan)
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
 
+	/* let the scans of a synchronized group go on without us */
+	if ((scan->rs_base.rs_flags & SO_ALLOW_SYNC) &&
+		scan->rs_base.rs_parallel == NULL)
+		ss_leave_group(scan->rs_base.rs_rd);
+
 	/*
 	 * decrement relation reference count and free scan descriptor storage
 	 */
@@ -2016,8 +2076,10 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 	 * performed in workers. We have the infrastructure to allow parallel
 	 * inserts in general except for the cases where inserts generate a new
 	 * CommandId (eg. inserts into a table having a foreign key column).
+	 * Callers that have checked that, such as parallel COPY FROM, say so
+	 * with HEAP_INSERT_PARALLEL.
 	 */
-	if (IsParallelWorker())
+	if (IsParallelWorker() && (options & HEAP_INSERT_PARALLEL) == 0)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
 				 errmsg("cannot insert tuples in a parallel worker")));
@@ -2924,11 +2986,13 @@ simple_heap_delete(Relation relation, ItemPointer tid)
 TM_Result
 heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 			CommandId cid, Snapshot crosscheck, bool wait,
-			TM_FailureData *tmfd, LockTupleMode *lockmode)
+			TM_FailureData *tmfd, LockTupleMode *lockmode,
+			TU_UpdateIndexes *update_indexes)
 {
 	TM_Result	result;
 	TransactionId xid = GetCurrentTransactionId();
 	Bitmapset  *hot_attrs;
+	Bitmapset  *sum_attrs;
 	Bitmapset  *key_attrs;
 	Bitmapset  *id_attrs;
 	Bitmapset  *interesting_attrs;
@@ -2951,6 +3015,7 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	bool		have_tuple_lock = false;
 	bool		iscombo;
 	bool		use_hot_update = false;
+	bool		summarized_update = false;
 	bool		key_intact;
 	bool		all_visible_cleared = false;
 	bool		all_visible_cleared_new = false;
@@ -2990,18 +3055,27 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	 * deadlock if we try to fetch the list later.  In any case, the relcache
 	 * caches the data so this is usually pretty cheap.
 	 *
+	 * Columns referenced only by summarizing indexes (such as BRIN) don't
+	 * block HOT, since those indexes don't point at individual tuples.  We
+	 * track them separately so that the caller knows whether the summarizing
+	 * indexes still need to hear about the new tuple.
+	 *
 	 * We also need columns used by the replica identity and columns that are
 	 * considered the "key" of rows in the table.
 	 *
 	 * Note that we get copies of each bitmap, so we need not worry about
 	 * relcache flush happening midway through.
 	 */
-	hot_attrs = RelationGetIndexAttrBitmap(relation, INDEX_ATTR_BITMAP_ALL);
+	hot_attrs = RelationGetIndexAttrBitmap(relation,
+										   INDEX_ATTR_BITMAP_HOT_BLOCKING);
+	sum_attrs = RelationGetIndexAttrBitmap(relation,
+										   INDEX_ATTR_BITMAP_SUMMARIZED);
 	key_attrs = RelationGetIndexAttrBitmap(relation, INDEX_ATTR_BITMAP_KEY);
 	id_attrs = RelationGetIndexAttrBitmap(relation,
 										  INDEX_ATTR_BITMAP_IDENTITY_KEY);
 	interesting_attrs = NULL;
 	interesting_attrs = bms_add_members(interesting_attrs, hot_attrs);
+	interesting_attrs = bms_add_members(interesting_attrs, sum_attrs);
 	interesting_attrs = bms_add_members(interesting_attrs, key_attrs);
 	interesting_attrs = bms_add_members(interesting_attrs, id_attrs);
 
@@ -3311,7 +3385,10 @@ l2:
 			UnlockTupleTuplock(relation, &(oldtup.t_self), *lockmode);
 		if (vmbuffer != InvalidBuffer)
 			ReleaseBuffer(vmbuffer);
+		*update_indexes = TU_None;
+
 		bms_free(hot_attrs);
+		bms_free(sum_attrs);
 		bms_free(key_attrs);
 		bms_free(id_attrs);
 		bms_free(modified_attrs);
@@ -3633,7 +3710,19 @@ l2:
 		 * changed.
 		 */
 		if (!bms_overlap(modified_attrs, hot_attrs))
+		{
 			use_hot_update = true;
+
+			/*
+			 * If none of the columns that are used in hot-blocking indexes
+			 * were updated, we can apply HOT, but we do still need to check
+			 * if we need to update the summarizing indexes, and update those
+			 * indexes if the columns were updated, or we may fail to detect
+			 * e.g. value bound changes in BRIN minmax indexes.
+			 */
+			if (bms_overlap(modified_attrs, sum_attrs))
+				summarized_update = true;
+		}
 	}
 	else
 	{
@@ -3793,10 +3882,27 @@ l2:
 		heap_freetuple(heaptup);
 	}
 
+	/*
+	 * If it is a HOT update, the update may still need to update summarized
+	 * indexes, lest we fail to update those summaries and get incorrect
+	 * results (for example, minmax bounds of the block may change with this
+	 * update).
+	 */
+	if (use_hot_update)
+	{
+		if (summarized_update)
+			*update_indexes = TU_Summarizing;
+		else
+			*update_indexes = TU_None;
+	}
+	else
+		*update_indexes = TU_All;
+
 	if (old_key_tuple != NULL && old_key_copied)
 		heap_freetuple(old_key_tuple);
 
 	bms_free(hot_attrs);
+	bms_free(sum_attrs);
 	bms_free(key_attrs);
 	bms_free(id_attrs);
 	bms_free(modified_attrs);
@@ -3956,11 +4062,17 @@ simple_heap_update(Relation relation, ItemPointer otid, HeapTuple tup)
 	TM_Result	result;
 	TM_FailureData tmfd;
 	LockTupleMode lockmode;
+	TU_UpdateIndexes update_indexes;
 
+	/*
+	 * System catalogs have no summarizing indexes, so whether the update was
+	 * HOT (as reported by the new tuple's header) is all that
+	 * CatalogIndexInsert() needs to know; update_indexes is not passed back.
+	 */
 	result = heap_update(relation, otid, tup,
 						 GetCurrentCommandId(true), InvalidSnapshot,
 						 true /* wait for commit */ ,
-						 &tmfd, &lockmode);
+						 &tmfd, &lockmode, &update_indexes);
 	switch (result)
 	{
 		case TM_SelfModified:
@@ -8272,6 +8384,8 @@ log_heap_update(Relation reln, Buffer oldbuf,
 	uint16		prefix_suffix[2];
 	uint16		prefixlen = 0,
 				suffixlen = 0;
+	uint16		deltas[1 + 2 * XLH_UPDATE_MAX_DELTAS];
+	int			ndeltas = 0;
 	XLogRecPtr	recptr;
 	Page		page = BufferGetPage(newbuf);
 	bool		need_tuple_data = RelationIsLogicallyLogged(reln);
@@ -8338,6 +8452,70 @@ log_heap_update(Relation reln, Buffer oldbuf,
 		}
 		if (suffixlen < 3)
 			suffixlen = 0;
+
+		/*
+		 * Prefix and suffix compression leaves everything between the first
+		 * and last changed byte in the record.  When an update changes
+		 * several fixed-width columns that are apart from each other (say, a
+		 * counter and a timestamp in a wide row), logging just the changed
+		 * ranges is a lot smaller.  We only try this when the tuple data
+		 * length is unchanged, so that the ranges can be applied in place on
+		 * top of the old tuple data.  Unchanged gaps too short to pay for
+		 * another range header are folded into the surrounding range.
+		 */
+		if (oldlen == newlen)
+		{
+			int			deltacost = sizeof(uint16);
+			int			pscost;
+			int			i = 0;
+
+			while (i < newlen)
+			{
+				int			start;
+				int			end;
+
+				if (newp[i] == oldp[i])
+				{
+					i++;
+					continue;
+				}
+
+				if (ndeltas == XLH_UPDATE_MAX_DELTAS)
+				{
+					ndeltas = 0;
+					break;
+				}
+
+				start = i;
+				end = i + 1;
+				for (i = end; i < newlen; i++)
+				{
+					if (newp[i] != oldp[i])
+						end = i + 1;
+					else if (i - end >= 2 * (int) sizeof(uint16))
+						break;
+				}
+
+				deltas[1 + 2 * ndeltas] = start;
+				deltas[2 + 2 * ndeltas] = end - start;
+				ndeltas++;
+				deltacost += 2 * sizeof(uint16) + (end - start);
+			}
+
+			pscost = newlen - prefixlen - suffixlen;
+			if (prefixlen > 0)
+				pscost += sizeof(uint16);
+			if (suffixlen > 0)
+				pscost += sizeof(uint16);
+
+			if (ndeltas > 0 && deltacost < pscost)
+			{
+				deltas[0] = ndeltas;
+				prefixlen = suffixlen = 0;
+			}
+			else
+				ndeltas = 0;
+		}
 	}
 
 	/* Prepare main WAL data chain */
@@ -8350,6 +8528,8 @@ log_heap_update(Relation reln, Buffer oldbuf,
 		xlrec.flags |= XLH_UPDATE_PREFIX_FROM_OLD;
 	if (suffixlen > 0)
 		xlrec.flags |= XLH_UPDATE_SUFFIX_FROM_OLD;
+	if (ndeltas > 0)
+		xlrec.flags |= XLH_UPDATE_DELTA_FROM_OLD;
 	if (need_tuple_data)
 	{
 		xlrec.flags |= XLH_UPDATE_CONTAINS_NEW_TUPLE;
@@ -8414,6 +8594,9 @@ log_heap_update(Relation reln, Buffer oldbuf,
 			XLogRegisterBufData(0, (char *) &suffixlen, sizeof(uint16));
 		}
 	}
+	else if (ndeltas > 0)
+		XLogRegisterBufData(0, (char *) deltas,
+							sizeof(uint16) * (1 + 2 * ndeltas));
 
 	xlhdr.t_infomask2 = newtup->t_data->t_infomask2;
 	xlhdr.t_infomask = newtup->t_data->t_infomask;
@@ -8423,10 +8606,29 @@ log_heap_update(Relation reln, Buffer oldbuf,
 	/*
 	 * PG73FORMAT: write bitmap [+ padding] [+ oid] + data
 	 *
-	 * The 'data' doesn't include the common prefix or suffix.
+	 * The 'data' doesn't include the common prefix or suffix, or only the
+	 * changed ranges of it in the delta case.
 	 */
 	XLogRegisterBufData(0, (char *) &xlhdr, SizeOfHeapHeader);
-	if (prefixlen == 0)
+	if (ndeltas > 0)
+	{
+		char	   *newdata = (char *) newtup->t_data + newtup->t_data->t_hoff;
+		int			i;
+
+		/* bitmap [+ padding] [+ oid] */
+		if (newtup->t_data->t_hoff - SizeofHeapTupleHeader > 0)
+		{
+			XLogRegisterBufData(0,
+								((char *) newtup->t_data) + SizeofHeapTupleHeader,
+								newtup->t_data->t_hoff - SizeofHeapTupleHeader);
+		}
+
+		/* changed ranges */
+		for (i = 0; i < ndeltas; i++)
+			XLogRegisterBufData(0, newdata + deltas[1 + 2 * i],
+								deltas[2 + 2 * i]);
+	}
+	else if (prefixlen == 0)
 	{
 		XLogRegisterBufData(0,
 							((char *) newtup->t_data) + SizeofHeapTupleHeader,
@@ -8670,11 +8872,13 @@ heap_xlog_prune(XLogReaderState *record)
 
 	/*
 	 * We're about to remove tuples. In Hot Standby mode, ensure that there's
-	 * no queries running for which the removed tuples are still visible.
+	 * no queries running for which the removed tuples are still visible, or
+	 * that such queries will notice if they come back to this relation.
+	 * That's only safe because we take a cleanup lock on the page below.
 	 */
 	if (InHotStandby)
-		ResolveRecoveryConflictWithSnapshot(xlrec->snapshotConflictHorizon,
-											rlocator);
+		ResolveRecoveryConflictWithSnapshotDeferred(xlrec->snapshotConflictHorizon,
+													rlocator);
 
 	/*
 	 * If we have a full-page image, restore it (using a cleanup lock) and
@@ -9392,6 +9596,8 @@ heap_xlog_update(XLogReaderState *record, bool hot_update)
 	HeapTupleHeader htup;
 	uint16		prefixlen = 0,
 				suffixlen = 0;
+	uint16		ndeltas = 0;
+	uint16		deltas[2 * XLH_UPDATE_MAX_DELTAS];
 	char	   *newp;
 	union
 	{
@@ -9547,6 +9753,16 @@ heap_xlog_update(XLogReaderState *record, bool hot_update)
 			memcpy(&suffixlen, recdata, sizeof(uint16));
 			recdata += sizeof(uint16);
 		}
+		if (xlrec->flags & XLH_UPDATE_DELTA_FROM_OLD)
+		{
+			Assert(newblk == oldblk);
+			memcpy(&ndeltas, recdata, sizeof(uint16));
+			recdata += sizeof(uint16);
+			if (ndeltas == 0 || ndeltas > XLH_UPDATE_MAX_DELTAS)
+				elog(PANIC, "invalid number of update deltas: %u", ndeltas);
+			memcpy(deltas, recdata, sizeof(uint16) * 2 * ndeltas);
+			recdata += sizeof(uint16) * 2 * ndeltas;
+		}
 
 		memcpy((char *) &xlhdr, recdata, SizeOfHeapHeader);
 		recdata += SizeOfHeapHeader;
@@ -9562,7 +9778,41 @@ heap_xlog_update(XLogReaderState *record, bool hot_update)
 		 * old tuple, and the data stored in the WAL record.
 		 */
 		newp = (char *) htup + SizeofHeapTupleHeader;
-		if (prefixlen > 0)
+		if (ndeltas > 0)
+		{
+			char	   *newdata;
+			int			olddatalen;
+			int			len;
+			int			i;
+
+			/* copy bitmap [+ padding] [+ oid] from WAL record */
+			len = xlhdr.t_hoff - SizeofHeapTupleHeader;
+			memcpy(newp, recdata, len);
+			recdata += len;
+			newp += len;
+
+			/* start from the old tuple data, then overwrite changed ranges */
+			olddatalen = oldtup.t_len - oldtup.t_data->t_hoff;
+			newdata = newp;
+			memcpy(newdata, (char *) oldtup.t_data + oldtup.t_data->t_hoff,
+				   olddatalen);
+			newp += olddatalen;
+
+			for (i = 0; i < ndeltas; i++)
+			{
+				uint16		off = deltas[2 * i];
+				uint16		dlen = deltas[2 * i + 1];
+
+				if (off + dlen > olddatalen)
+					elog(PANIC, "invalid update delta");
+				memcpy(newdata + off, recdata, dlen);
+				recdata += dlen;
+			}
+
+			/* account for the data taken from the old tuple */
+			tuplen = newp - ((char *) htup + SizeofHeapTupleHeader);
+		}
+		else if (prefixlen > 0)
 		{
 			int			len;
 
@@ -47,7 +47,8 @@
 
 static void reform_and_rewrite_tuple(HeapTuple tuple,
 									 Relation OldHeap, Relation NewHeap,
-									 Datum *values, bool *isnull, RewriteState rwstate);
+									 Datum *values, bool *isnull,
+									 bool has_dropped, RewriteState rwstate);
 
 static bool SampleHeapTupleVisible(TableScanDesc scan, Buffer buffer,
 								   HeapTuple tuple,
@@ -314,7 +315,7 @@ static TM_Result
 heapam_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
 					CommandId cid, Snapshot snapshot, Snapshot crosscheck,
 					bool wait, TM_FailureData *tmfd,
-					LockTupleMode *lockmode, bool *update_indexes)
+					LockTupleMode *lockmode, TU_UpdateIndexes *update_indexes)
 {
 	bool		shouldFree = true;
 	HeapTuple	tuple = ExecFetchSlotHeapTuple(slot, true, &shouldFree);
@@ -325,7 +326,7 @@ heapam_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
 	tuple->t_tableOid = slot->tts_tableOid;
 
 	result = heap_update(relation, otid, tuple, cid, crosscheck, wait,
-						 tmfd, lockmode);
+						 tmfd, lockmode, update_indexes);
 	ItemPointerCopy(&tuple->t_self, &slot->tts_tid);
 
 	/*
@@ -334,9 +335,20 @@ heapam_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
 	 * Note: heap_update returns the tid (location) of the new tuple in the
 	 * t_self field.
 	 *
-	 * If it's a HOT update, we mustn't insert new index entries.
+	 * If the update is not HOT, we must update all indexes. If the update is
+	 * HOT, it could be that we updated summarized columns, so we either
+	 * update only summarized indexes, or none at all.
 	 */
-	*update_indexes = result == TM_Ok && !HeapTupleIsHeapOnly(tuple);
+	if (result != TM_Ok)
+	{
+		Assert(*update_indexes == TU_None);
+		*update_indexes = TU_None;
+	}
+	else if (!HeapTupleIsHeapOnly(tuple))
+		Assert(*update_indexes == TU_All);
+	else
+		Assert((*update_indexes == TU_Summarizing) ||
+			   (*update_indexes == TU_None));
 
 	if (shouldFree)
 		pfree(tuple);
@@ -700,6 +712,7 @@ heapam_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 	bool	   *isnull;
 	BufferHeapTupleTableSlot *hslot;
 	BlockNumber prev_cblock = InvalidBlockNumber;
+	bool		has_dropped = false;
 
 	/* Remember if it's a system catalog */
 	is_system_catalog = IsSystemRelation(OldHeap);
@@ -715,6 +728,16 @@ heapam_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 	values = (Datum *) palloc(natts * sizeof(Datum));
 	isnull = (bool *) palloc(natts * sizeof(bool));
 
+	/* Dropped columns force every tuple to be reformed, see below */
+	for (int i = 0; i < natts; i++)
+	{
+		if (TupleDescAttr(newTupDesc, i)->attisdropped)
+		{
+			has_dropped = true;
+			break;
+		}
+	}
+
 	/* Initialize the rewrite operation */
 	rwstate = begin_heap_rewrite(OldHeap, NewHeap, OldestXmin, *xid_cutoff,
 								 *multi_cutoff);
@@ -919,7 +942,7 @@ heapam_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 			int64		ct_val[2];
 
 			reform_and_rewrite_tuple(tuple, OldHeap, NewHeap,
-									 values, isnull, rwstate);
+									 values, isnull, has_dropped, rwstate);
 
 			/*
 			 * In indexscan mode and also VACUUM FULL, report increase in
@@ -970,7 +993,7 @@ heapam_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 			reform_and_rewrite_tuple(tuple,
 									 OldHeap, NewHeap,
 									 values, isnull,
-									 rwstate);
+									 has_dropped, rwstate);
 			/* Report n_tuples */
 			pgstat_progress_update_param(PROGRESS_CLUSTER_HEAP_TUPLES_WRITTEN,
 										 n_tuples);
@@ -1750,6 +1773,7 @@ heapam_index_validate_scan(Relation heapRelation,
 	OffsetNumber root_offsets[MaxHeapTuplesPerPage];
 	bool		in_index[MaxHeapTuplesPerPage];
 	BlockNumber previous_blkno = InvalidBlockNumber;
+	BlockNumber skip_blkno = InvalidBlockNumber;
 
 	/* state variables for the merge */
 	ItemPointer indexcursor = NULL;
@@ -1828,14 +1852,34 @@ heapam_index_validate_scan(Relation heapRelation,
 		 * already-passed-over tuplesort output TIDs of the current page. We
 		 * clear that array here, when advancing onto a new heap page.
 		 */
+		if (hscan->rs_cblock == skip_blkno)
+			continue;
+
 		if (hscan->rs_cblock != root_blkno)
 		{
 			Page		page = BufferGetPage(hscan->rs_cbuf);
+			bool		unchanged;
 
+			/*
+			 * A page that hasn't been modified since the index build began
+			 * can't hold any tuples missing from the index (see
+			 * validate_index()), so don't bother merging it.  Any index TIDs
+			 * pointing into it are passed over when we advance the tuplesort
+			 * on a later page.
+			 */
 			LockBuffer(hscan->rs_cbuf, BUFFER_LOCK_SHARE);
-			heap_get_root_tuples(page, root_offsets);
+			unchanged = !XLogRecPtrIsInvalid(state->startlsn) &&
+				BufferGetLSNAtomic(hscan->rs_cbuf) < state->startlsn;
+			if (!unchanged)
+				heap_get_root_tuples(page, root_offsets);
 			LockBuffer(hscan->rs_cbuf, BUFFER_LOCK_UNLOCK);
 
+			if (unchanged)
+			{
+				skip_blkno = hscan->rs_cblock;
+				continue;
+			}
+
 			memset(in_index, 0, sizeof(in_index));
 
 			root_blkno = hscan->rs_cblock;
@@ -2447,18 +2491,37 @@ heapam_scan_sample_next_tuple(TableScanDesc scan, SampleScanState *scanstate,
  * currently only known to happen as an after-effect of ALTER TABLE
  * SET WITHOUT OIDS.
  *
- * So, we must reconstruct the tuple from component Datums.
+ * 3. Attributes added after the tuple was stored may be missing from its
+ * end, and their values must be filled in because the caller clears the
+ * "missing" values from the catalogs once the rewrite is done.
+ *
+ * So, we must reconstruct the tuple from component Datums.  But when none
+ * of those apply, which is the common case for VACUUM FULL and CLUSTER of
+ * large tables, a plain copy is equivalent and much cheaper than deforming
+ * and forming every tuple.  has_dropped tells whether the relation has any
+ * dropped columns; the other two conditions are checked per tuple.
  */
 static void
 reform_and_rewrite_tuple(HeapTuple tuple,
 						 Relation OldHeap, Relation NewHeap,
-						 Datum *values, bool *isnull, RewriteState rwstate)
+						 Datum *values, bool *isnull,
+						 bool has_dropped, RewriteState rwstate)
 {
 	TupleDesc	oldTupDesc = RelationGetDescr(OldHeap);
 	TupleDesc	newTupDesc = RelationGetDescr(NewHeap);
 	HeapTuple	copiedTuple;
 	int			i;
 
+	if (!has_dropped &&
+		HeapTupleHeaderGetNatts(tuple->t_data) == newTupDesc->natts &&
+		(tuple->t_data->t_infomask & HEAP_HASOID_OLD) == 0)
+	{
+		copiedTuple = heap_copytuple(tuple);
+		rewrite_heap_tuple(rwstate, tuple, copiedTuple);
+		heap_freetuple(copiedTuple);
+		return;
+	}
+
 	heap_deform_tuple(tuple, oldTupDesc, values, isnull);
 
 	/* Be sure to null out any dropped columns */
@@ -3,18 +3,18 @@
  * vacuumlazy.c
  *	  Concurrent ("lazy") vacuuming.
  *
- * The major space usage for vacuuming is storage for the array of dead TIDs
- * that are to be removed from indexes.  We want to ensure we can vacuum even
- * the very largest relations with finite memory space usage.  To do that, we
- * set upper bounds on the number of TIDs we can keep track of at once.
+ * The major space usage for vacuuming is storage for the dead TIDs that are
+ * to be removed from indexes.  We want to ensure we can vacuum even the very
+ * largest relations with finite memory space usage.  To do that, we set an
+ * upper bound on the memory used to keep track of them at once.
  *
  * We are willing to use at most maintenance_work_mem (or perhaps
- * autovacuum_work_mem) memory space to keep track of dead TIDs.  We initially
- * allocate an array of TIDs of that size, with an upper limit that depends on
- * table size (this limit ensures we don't allocate a huge area uselessly for
- * vacuuming small tables).  If the array threatens to overflow, we must call
- * lazy_vacuum to vacuum indexes (and to vacuum the pages that we've pruned).
- * This frees up the memory space dedicated to storing dead TIDs.
+ * autovacuum_work_mem) memory space to keep track of dead TIDs.  They are
+ * kept in a TidStore, which grows as TIDs are added (so we don't allocate a
+ * huge area uselessly for vacuuming small tables).  If the store's memory
+ * usage exceeds the limit, we must call lazy_vacuum to vacuum indexes (and to
+ * vacuum the pages that we've pruned).  This frees up the memory space
+ * dedicated to storing dead TIDs.
  *
  * In practice VACUUM will often complete its initial pass over the target
  * heap relation without ever running out of space to store TIDs.  This means
@@ -63,6 +63,7 @@
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
+#include "utils/spccache.h"
 #include "utils/timestamp.h"
 
 
@@ -93,6 +94,12 @@
  */
 #define BYPASS_THRESHOLD_PAGES	0.02	/* i.e. 2% of rel_pages */
 
+/*
+ * Limit on the pages that a VACUUM freezes eagerly, just because they
+ * haven't been modified for a while (see lazy_scan_prune)
+ */
+#define EAGER_FREEZE_PAGES	0.10	/* i.e. 10% of rel_pages */
+
 /*
  * Perform a failsafe check each time we scan another 4GB of pages.
  * (Note that this is deliberately kept to a power-of-two, usually 2^19.)
@@ -148,6 +155,8 @@ typedef struct LVRelState
 	/* Buffer access strategy and parallel vacuum state */
 	BufferAccessStrategy bstrategy;
 	ParallelVacuumState *pvs;
+	/* How many heap blocks to prefetch ahead (maintenance_io_concurrency) */
+	int			prefetch_distance;
 
 	/* Aggressive VACUUM? (must set relfrozenxid >= FreezeLimit) */
 	bool		aggressive;
@@ -170,6 +179,9 @@ typedef struct LVRelState
 	TransactionId NewRelfrozenXid;
 	MultiXactId NewRelminMxid;
 	bool		skippedallvis;
+	/* Eagerly freeze pages last modified before this LSN, within budget */
+	XLogRecPtr	eager_freeze_lsn;
+	BlockNumber eager_freeze_budget;
 
 	/* Error reporting state */
 	char	   *dbname;
@@ -188,7 +200,8 @@ typedef struct LVRelState
 	 * lazy_vacuum_heap_rel, which marks the same LP_DEAD line pointers as
 	 * LP_UNUSED during second heap pass.
 	 */
-	VacDeadItems *dead_items;	/* TIDs whose index tuples we'll delete */
+	TidStore   *dead_items;		/* TIDs whose index tuples we'll delete */
+	size_t		dead_items_max_bytes;	/* memory limit for dead_items */
 	BlockNumber rel_pages;		/* total number of pages */
 	BlockNumber scanned_pages;	/* # pages examined (not skipped via VM) */
 	BlockNumber removed_pages;	/* # pages removed by relation truncation */
@@ -230,6 +243,14 @@ typedef struct LVPagePruneState
 	bool		all_visible;	/* Every item visible to all? */
 	bool		all_frozen;		/* provided all_visible is also true */
 	TransactionId visibility_cutoff_xid;	/* For recovery conflicts */
+
+	/*
+	 * The page's LP_DEAD items.  These are only remembered here when using
+	 * the one-pass strategy, since they are vacuumed right away; otherwise
+	 * they go into dead_items.
+	 */
+	int			lpdead_items;
+	OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
 } LVPagePruneState;
 
 /* Struct for saving and restoring vacuum error information. */
@@ -243,6 +264,10 @@ typedef struct LVSavedErrInfo
 
 /* non-export function prototypes */
 static void lazy_scan_heap(LVRelState *vacrel);
+static void lazy_scan_prefetch(LVRelState *vacrel, BlockNumber blkno,
+							   BlockNumber next_unskippable_block,
+							   bool skipping_current_range,
+							   BlockNumber *prefetch_blkno);
 static BlockNumber lazy_scan_skip(LVRelState *vacrel, Buffer *vmbuffer,
 								  BlockNumber next_block,
 								  bool *next_unskippable_allvis,
@@ -259,8 +284,13 @@ static bool lazy_scan_noprune(LVRelState *vacrel, Buffer buf,
 static void lazy_vacuum(LVRelState *vacrel);
 static bool lazy_vacuum_all_indexes(LVRelState *vacrel);
 static void lazy_vacuum_heap_rel(LVRelState *vacrel);
-static int	lazy_vacuum_heap_page(LVRelState *vacrel, BlockNumber blkno,
-								  Buffer buffer, int index, Buffer vmbuffer);
+static void lazy_vacuum_heap_pages(LVRelState *vacrel, TidStoreIter *iter,
+								   TidStoreIter *prefetch_iter,
+								   BlockNumber *vacuumed_pages,
+								   int64 *vacuumed_items);
+static void lazy_vacuum_heap_page(LVRelState *vacrel, BlockNumber blkno,
+								  Buffer buffer, OffsetNumber *deadoffsets,
+								  int num_offsets, Buffer vmbuffer);
 static bool lazy_check_wraparound_failsafe(LVRelState *vacrel);
 static void lazy_cleanup_all_indexes(LVRelState *vacrel);
 static IndexBulkDeleteResult *lazy_vacuum_one_index(Relation indrel,
@@ -277,6 +307,9 @@ static void lazy_truncate_heap(LVRelState *vacrel);
 static BlockNumber count_nondeletable_pages(LVRelState *vacrel,
 											bool *lock_waiter_detected);
 static void dead_items_alloc(LVRelState *vacrel, int nworkers);
+static void dead_items_add(LVRelState *vacrel, BlockNumber blkno,
+						   OffsetNumber *offsets, int num_offsets);
+static void dead_items_reset(LVRelState *vacrel);
 static void dead_items_cleanup(LVRelState *vacrel);
 static bool heap_page_is_all_visible(LVRelState *vacrel, Buffer buf,
 									 TransactionId *visibility_cutoff_xid, bool *all_frozen);
@@ -371,6 +404,8 @@ heap_vacuum_rel(Relation rel, VacuumParams *params,
 	vac_open_indexes(vacrel->rel, RowExclusiveLock, &vacrel->nindexes,
 					 &vacrel->indrels);
 	vacrel->bstrategy = bstrategy;
+	vacrel->prefetch_distance =
+		get_tablespace_maintenance_io_concurrency(rel->rd_rel->reltablespace);
 	if (instrument && vacrel->nindexes > 0)
 	{
 		/* Copy index names used by instrumentation (not error reporting) */
@@ -459,6 +494,8 @@ heap_vacuum_rel(Relation rel, VacuumParams *params,
 	vacrel->NewRelfrozenXid = vacrel->cutoffs.OldestXmin;
 	vacrel->NewRelminMxid = vacrel->cutoffs.OldestMxact;
 	vacrel->skippedallvis = false;
+	vacrel->eager_freeze_lsn = GetRedoRecPtr();
+	vacrel->eager_freeze_budget = orig_rel_pages * EAGER_FREEZE_PAGES;
 	skipwithvm = true;
 	if (params->options & VACOPT_DISABLE_PAGE_SKIPPING)
 	{
@@ -824,22 +861,23 @@ lazy_scan_heap(LVRelState *vacrel)
 	BlockNumber rel_pages = vacrel->rel_pages,
 				blkno,
 				next_unskippable_block,
-				next_fsm_block_to_vacuum = 0;
-	VacDeadItems *dead_items = vacrel->dead_items;
+				next_fsm_block_to_vacuum = 0,
+				prefetch_blkno = 0;
+	TidStore   *dead_items = vacrel->dead_items;
 	Buffer		vmbuffer = InvalidBuffer;
 	bool		next_unskippable_allvis,
 				skipping_current_range;
 	const int	initprog_index[] = {
 		PROGRESS_VACUUM_PHASE,
 		PROGRESS_VACUUM_TOTAL_HEAP_BLKS,
-		PROGRESS_VACUUM_MAX_DEAD_TUPLES
+		PROGRESS_VACUUM_MAX_DEAD_TUPLE_BYTES
 	};
 	int64		initprog_val[3];
 
 	/* Report that we're scanning the heap, advertising total # of blocks */
 	initprog_val[0] = PROGRESS_VACUUM_PHASE_SCAN_HEAP;
 	initprog_val[1] = rel_pages;
-	initprog_val[2] = dead_items->max_items;
+	initprog_val[2] = vacrel->dead_items_max_bytes;
 	pgstat_progress_update_multi_param(3, initprog_index, initprog_val);
 
 	/* Set up an initial range of skippable blocks using the visibility map */
@@ -881,6 +919,10 @@ lazy_scan_heap(LVRelState *vacrel)
 
 		vacrel->scanned_pages++;
 
+		/* Start reading the blocks that we will scan next */
+		lazy_scan_prefetch(vacrel, blkno, next_unskippable_block,
+						   skipping_current_range, &prefetch_blkno);
+
 		/* Report as block scanned, update error traceback information */
 		pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
 		update_vacuum_error_info(vacrel, NULL, VACUUM_ERRCB_PHASE_SCAN_HEAP,
@@ -901,13 +943,11 @@ lazy_scan_heap(LVRelState *vacrel)
 			lazy_check_wraparound_failsafe(vacrel);
 
 		/*
-		 * Consider if we definitely have enough space to process TIDs on page
-		 * already.  If we are close to overrunning the available space for
-		 * dead_items TIDs, pause and do a cycle of vacuuming before we tackle
-		 * this page.
+		 * Consider if we have used up the memory available for dead_items
+		 * TIDs already.  If so, pause and do a cycle of vacuuming before we
+		 * tackle this page.
 		 */
-		Assert(dead_items->max_items >= MaxHeapTuplesPerPage);
-		if (dead_items->max_items - dead_items->num_items < MaxHeapTuplesPerPage)
+		if (TidStoreMemoryUsage(dead_items) > vacrel->dead_items_max_bytes)
 		{
 			/*
 			 * Before beginning index vacuuming, we release any pin we may
@@ -969,7 +1009,7 @@ lazy_scan_heap(LVRelState *vacrel)
 				continue;
 			}
 
-			/* Collect LP_DEAD items in dead_items array, count tuples */
+			/* Collect LP_DEAD items in dead_items, count tuples */
 			if (lazy_scan_noprune(vacrel, buf, blkno, page, &hastup,
 								  &recordfreespace))
 			{
@@ -1011,7 +1051,8 @@ lazy_scan_heap(LVRelState *vacrel)
 		 * Prune, freeze, and count tuples.
 		 *
 		 * Accumulates details of remaining LP_DEAD line pointers on page in
-		 * dead_items array.  This includes LP_DEAD line pointers that we
+		 * dead_items (or in prunestate, for the one-pass strategy).  This
+		 * includes LP_DEAD line pointers that we
 		 * pruned ourselves, as well as existing LP_DEAD line pointers that
 		 * were pruned some time earlier.  Also considers freezing XIDs in the
 		 * tuple headers of remaining items with storage.
@@ -1038,10 +1079,9 @@ lazy_scan_heap(LVRelState *vacrel)
 			{
 				Size		freespace;
 
-				lazy_vacuum_heap_page(vacrel, blkno, buf, 0, vmbuffer);
-
-				/* Forget the LP_DEAD items that we just vacuumed */
-				dead_items->num_items = 0;
+				lazy_vacuum_heap_page(vacrel, blkno, buf,
+									  prunestate.deadoffsets,
+									  prunestate.lpdead_items, vmbuffer);
 
 				/*
 				 * Periodically perform FSM vacuuming to make newly-freed
@@ -1078,7 +1118,7 @@ lazy_scan_heap(LVRelState *vacrel)
 			 * with prunestate-driven visibility map and FSM steps (just like
 			 * the two-pass strategy).
 			 */
-			Assert(dead_items->num_items == 0);
+			Assert(TidStoreNumTids(dead_items) == 0);
 		}
 
 		/*
@@ -1249,7 +1289,7 @@ lazy_scan_heap(LVRelState *vacrel)
 	 * Do index vacuuming (call each index's ambulkdelete routine), then do
 	 * related heap vacuuming
 	 */
-	if (dead_items->num_items > 0)
+	if (TidStoreNumTids(dead_items) > 0)
 		lazy_vacuum(vacrel);
 
 	/*
@@ -1267,6 +1307,46 @@ lazy_scan_heap(LVRelState *vacrel)
 		lazy_cleanup_all_indexes(vacrel);
 }
 
+/*
+ *	lazy_scan_prefetch() -- prefetch the blocks lazy_scan_heap will scan next.
+ *
+ * lazy_scan_heap() calls here for each block it scans.  We issue prefetch
+ * requests for the blocks that follow it, up to vacrel->prefetch_distance
+ * blocks ahead, so that the reads can be in progress while we process the
+ * current block.  *prefetch_blkno is the next block not yet prefetched; it
+ * is kept across calls.
+ *
+ * Only blocks in the range set up by the last lazy_scan_skip() call are
+ * considered, because we don't know yet whether later blocks are going to
+ * be skipped.  When the current range is being skipped, only its end
+ * (next_unskippable_block) will be read.
+ */
+static void
+lazy_scan_prefetch(LVRelState *vacrel, BlockNumber blkno,
+				   BlockNumber next_unskippable_block,
+				   bool skipping_current_range, BlockNumber *prefetch_blkno)
+{
+#ifdef USE_PREFETCH
+	BlockNumber limit;
+
+	if (vacrel->prefetch_distance <= 0)
+		return;
+
+	/* Prefetch up to and including limit */
+	limit = Min(next_unskippable_block, vacrel->rel_pages - 1);
+	if ((uint64) blkno + vacrel->prefetch_distance < limit)
+		limit = blkno + vacrel->prefetch_distance;
+
+	if (*prefetch_blkno <= blkno)
+		*prefetch_blkno = blkno + 1;
+	if (skipping_current_range && *prefetch_blkno < next_unskippable_block)
+		*prefetch_blkno = next_unskippable_block;
+
+	for (; *prefetch_blkno <= limit; (*prefetch_blkno)++)
+		PrefetchBuffer(vacrel->rel, MAIN_FORKNUM, *prefetch_blkno);
+#endif							/* USE_PREFETCH */
+}
+
 /*
  *	lazy_scan_skip() -- set up range of skippable blocks using visibility map.
  *
@@ -1549,6 +1629,8 @@ lazy_scan_prune(LVRelState *vacrel,
 	int			nnewlpdead;
 	HeapPageFreeze pagefrz;
 	int64		fpi_before = pgWalUsage.wal_fpi;
+	XLogRecPtr	page_lsn = PageGetLSN(page);
+	bool		do_freeze;
 	OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
 	HeapTupleFreeze frozen[MaxHeapTuplesPerPage];
 
@@ -1594,6 +1676,7 @@ retry:
 	 */
 	prunestate->hastup = false;
 	prunestate->has_lpdead_items = false;
+	prunestate->lpdead_items = 0;
 	prunestate->all_visible = true;
 	prunestate->all_frozen = true;
 	prunestate->visibility_cutoff_xid = InvalidTransactionId;
@@ -1795,10 +1878,30 @@ retry:
 	 * one XID/MXID from before FreezeLimit/MultiXactCutoff is present.  Also
 	 * freeze when pruning generated an FPI, if doing so means that we set the
 	 * page all-frozen afterwards (might not happen until final heap pass).
+	 *
+	 * Finally, freeze a page that would become all-frozen if it wasn't
+	 * modified since before the latest checkpoint (as of when we started),
+	 * even if that costs an FPI.  A page that has been left alone that long
+	 * is unlikely to be modified again soon, so freezing it now spreads out
+	 * work that an aggressive VACUUM would otherwise have to do all at once.
+	 * Limit the number of such pages, to bound the extra WAL this VACUUM
+	 * can write.
 	 */
 	if (pagefrz.freeze_required || tuples_frozen == 0 ||
 		(prunestate->all_visible && prunestate->all_frozen &&
 		 fpi_before != pgWalUsage.wal_fpi))
+		do_freeze = true;
+	else if (prunestate->all_visible && prunestate->all_frozen &&
+			 vacrel->eager_freeze_budget > 0 &&
+			 page_lsn < vacrel->eager_freeze_lsn)
+	{
+		vacrel->eager_freeze_budget--;
+		do_freeze = true;
+	}
+	else
+		do_freeze = false;
+
+	if (do_freeze)
 	{
 		/*
 		 * We're freezing the page.  Our final NewRelfrozenXid doesn't need to
@@ -1893,23 +1996,18 @@ retry:
 	 */
 	if (lpdead_items > 0)
 	{
-		VacDeadItems *dead_items = vacrel->dead_items;
-		ItemPointerData tmp;
-
 		vacrel->lpdead_item_pages++;
 		prunestate->has_lpdead_items = true;
 
-		ItemPointerSetBlockNumber(&tmp, blkno);
-
-		for (int i = 0; i < lpdead_items; i++)
+		if (vacrel->nindexes == 0)
 		{
-			ItemPointerSetOffsetNumber(&tmp, deadoffsets[i]);
-			dead_items->items[dead_items->num_items++] = tmp;
+			/* One-pass strategy: caller vacuums the page right away */
+			prunestate->lpdead_items = lpdead_items;
+			memcpy(prunestate->deadoffsets, deadoffsets,
+				   lpdead_items * sizeof(OffsetNumber));
 		}
-
-		Assert(dead_items->num_items <= dead_items->max_items);
-		pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
-									 dead_items->num_items);
+		else
+			dead_items_add(vacrel, blkno, deadoffsets, lpdead_items);
 
 		/*
 		 * It was convenient to ignore LP_DEAD items in all_visible earlier on
@@ -2099,7 +2197,7 @@ lazy_scan_noprune(LVRelState *vacrel,
 	vacrel->NewRelfrozenXid = NoFreezePageRelfrozenXid;
 	vacrel->NewRelminMxid = NoFreezePageRelminMxid;
 
-	/* Save any LP_DEAD items found on the page in dead_items array */
+	/* Save any LP_DEAD items found on the page in dead_items */
 	if (vacrel->nindexes == 0)
 	{
 		/* Using one-pass strategy (since table has no indexes) */
@@ -2129,9 +2227,6 @@ lazy_scan_noprune(LVRelState *vacrel,
 	}
 	else
 	{
-		VacDeadItems *dead_items = vacrel->dead_items;
-		ItemPointerData tmp;
-
 		/*
 		 * Page has LP_DEAD items, and so any references/TIDs that remain in
 		 * indexes will be deleted during index vacuuming (and then marked
@@ -2139,17 +2234,7 @@ lazy_scan_noprune(LVRelState *vacrel,
 		 */
 		vacrel->lpdead_item_pages++;
 
-		ItemPointerSetBlockNumber(&tmp, blkno);
-
-		for (int i = 0; i < lpdead_items; i++)
-		{
-			ItemPointerSetOffsetNumber(&tmp, deadoffsets[i]);
-			dead_items->items[dead_items->num_items++] = tmp;
-		}
-
-		Assert(dead_items->num_items <= dead_items->max_items);
-		pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
-									 dead_items->num_items);
+		dead_items_add(vacrel, blkno, deadoffsets, lpdead_items);
 
 		vacrel->lpdead_items += lpdead_items;
 
@@ -2198,7 +2283,7 @@ lazy_vacuum(LVRelState *vacrel)
 	if (!vacrel->do_index_vacuuming)
 	{
 		Assert(!vacrel->do_index_cleanup);
-		vacrel->dead_items->num_items = 0;
+		dead_items_reset(vacrel);
 		return;
 	}
 
@@ -2227,7 +2312,7 @@ lazy_vacuum(LVRelState *vacrel)
 		BlockNumber threshold;
 
 		Assert(vacrel->num_index_scans == 0);
-		Assert(vacrel->lpdead_items == vacrel->dead_items->num_items);
+		Assert(vacrel->lpdead_items == TidStoreNumTids(vacrel->dead_items));
 		Assert(vacrel->do_index_vacuuming);
 		Assert(vacrel->do_index_cleanup);
 
@@ -2255,7 +2340,7 @@ lazy_vacuum(LVRelState *vacrel)
 		 */
 		threshold = (double) vacrel->rel_pages * BYPASS_THRESHOLD_PAGES;
 		bypass = (vacrel->lpdead_item_pages < threshold &&
-				  vacrel->lpdead_items < MAXDEADITEMS(32L * 1024L * 1024L));
+				  TidStoreMemoryUsage(vacrel->dead_items) < 32L * 1024L * 1024L);
 	}
 
 	if (bypass)
@@ -2300,7 +2385,7 @@ lazy_vacuum(LVRelState *vacrel)
 	 * Forget the LP_DEAD items that we just vacuumed (or just decided to not
 	 * vacuum)
 	 */
-	vacrel->dead_items->num_items = 0;
+	dead_items_reset(vacrel);
 }
 
 /*
@@ -2373,7 +2458,7 @@ lazy_vacuum_all_indexes(LVRelState *vacrel)
 	 * place).
 	 */
 	Assert(vacrel->num_index_scans > 0 ||
-		   vacrel->dead_items->num_items == vacrel->lpdead_items);
+		   TidStoreNumTids(vacrel->dead_items) == vacrel->lpdead_items);
 	Assert(allindexes || vacrel->failsafe_active);
 
 	/*
@@ -2392,7 +2477,7 @@ lazy_vacuum_all_indexes(LVRelState *vacrel)
 /*
  *	lazy_vacuum_heap_rel() -- second pass over the heap for two pass strategy
  *
- * This routine marks LP_DEAD items in vacrel->dead_items array as LP_UNUSED.
+ * This routine marks LP_DEAD items in vacrel->dead_items as LP_UNUSED.
  * Pages that never had lazy_scan_prune record LP_DEAD items are not visited
  * at all.
  *
@@ -2410,10 +2495,12 @@ lazy_vacuum_all_indexes(LVRelState *vacrel)
 static void
 lazy_vacuum_heap_rel(LVRelState *vacrel)
 {
-	int			index = 0;
+	int64		vacuumed_items = 0;
 	BlockNumber vacuumed_pages = 0;
-	Buffer		vmbuffer = InvalidBuffer;
 	LVSavedErrInfo saved_err_info;
+	TidStoreIter *iter;
+	TidStoreIter *prefetch_iter = NULL;
+	bool		parallel = false;
 
 	Assert(vacrel->do_index_vacuuming);
 	Assert(vacrel->do_index_cleanup);
@@ -2428,7 +2515,78 @@ lazy_vacuum_heap_rel(LVRelState *vacrel)
 							 VACUUM_ERRCB_PHASE_VACUUM_HEAP,
 							 InvalidBlockNumber, InvalidOffsetNumber);
 
-	while (index < vacrel->dead_items->num_items)
+	/*
+	 * If there are enough pages to vacuum, have parallel workers help.  Each
+	 * process claims pages from dead_items until there are none left.
+	 *
+	 * Otherwise, we know which pages we'll visit, and in what order, so a
+	 * second iterator running ahead of the main one can prefetch them.
+	 */
+	if (ParallelVacuumIsActive(vacrel) &&
+		parallel_vacuum_begin_heap_pass(vacrel->pvs,
+										vacrel->cutoffs.OldestXmin))
+	{
+		parallel = true;
+		iter = TidStoreBeginSharedIterate(vacrel->dead_items);
+	}
+	else
+	{
+		iter = TidStoreBeginIterate(vacrel->dead_items);
+#ifdef USE_PREFETCH
+		if (vacrel->prefetch_distance > 0)
+			prefetch_iter = TidStoreBeginIterate(vacrel->dead_items);
+#endif
+	}
+
+	lazy_vacuum_heap_pages(vacrel, iter, prefetch_iter, &vacuumed_pages,
+						   &vacuumed_items);
+	TidStoreEndIterate(iter);
+	if (prefetch_iter)
+		TidStoreEndIterate(prefetch_iter);
+
+	if (parallel)
+		parallel_vacuum_end_heap_pass(vacrel->pvs, &vacuumed_pages,
+									  &vacuumed_items);
+
+	/*
+	 * We set all LP_DEAD items from the first heap pass to LP_UNUSED during
+	 * the second heap pass.  No more, no less.
+	 */
+	Assert(vacuumed_items > 0);
+	Assert(vacrel->num_index_scans > 1 ||
+		   (vacuumed_items == vacrel->lpdead_items &&
+			vacuumed_pages == vacrel->lpdead_item_pages));
+
+	ereport(DEBUG2,
+			(errmsg("table \"%s\": removed %lld dead item identifiers in %u pages",
+					vacrel->relname, (long long) vacuumed_items,
+					vacuumed_pages)));
+
+	/* Revert to the previous phase information for error traceback */
+	restore_vacuum_error_info(vacrel, &saved_err_info);
+}
+
+/*
+ *	lazy_vacuum_heap_pages() -- vacuum the heap pages returned by iter
+ *
+ * This is the main loop of the second heap pass, shared by the leader and
+ * any parallel workers.  The numbers of pages and items vacuumed are added to
+ * *vacuumed_pages and *vacuumed_items.
+ *
+ * If prefetch_iter is not NULL, it is a separate iterator over the same
+ * pages, which we keep up to vacrel->prefetch_distance pages ahead of iter to
+ * issue prefetch requests.
+ */
+static void
+lazy_vacuum_heap_pages(LVRelState *vacrel, TidStoreIter *iter,
+					   TidStoreIter *prefetch_iter,
+					   BlockNumber *vacuumed_pages, int64 *vacuumed_items)
+{
+	Buffer		vmbuffer = InvalidBuffer;
+	TidStoreIterResult *iter_result;
+	int			prefetched_ahead = 0;
+
+	while ((iter_result = TidStoreIterateNext(iter)) != NULL)
 	{
 		BlockNumber blkno;
 		Buffer		buf;
@@ -2437,7 +2595,26 @@ lazy_vacuum_heap_rel(LVRelState *vacrel)
 
 		vacuum_delay_point();
 
-		blkno = ItemPointerGetBlockNumber(&vacrel->dead_items->items[index]);
+		if (prefetch_iter)
+		{
+			TidStoreIterResult *prefetch_result;
+
+			/* The current page has been prefetched already, unless first */
+			if (prefetched_ahead > 0)
+				prefetched_ahead--;
+			else
+				(void) TidStoreIterateNext(prefetch_iter);
+
+			while (prefetched_ahead < vacrel->prefetch_distance &&
+				   (prefetch_result = TidStoreIterateNext(prefetch_iter)) != NULL)
+			{
+				PrefetchBuffer(vacrel->rel, MAIN_FORKNUM,
+							   prefetch_result->blkno);
+				prefetched_ahead++;
+			}
+		}
+
+		blkno = iter_result->blkno;
 		vacrel->blkno = blkno;
 
 		/*
@@ -2451,7 +2628,8 @@ lazy_vacuum_heap_rel(LVRelState *vacrel)
 		buf = ReadBufferExtended(vacrel->rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
 								 vacrel->bstrategy);
 		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
-		index = lazy_vacuum_heap_page(vacrel, blkno, buf, index, vmbuffer);
+		lazy_vacuum_heap_page(vacrel, blkno, buf, iter_result->offsets,
+							  iter_result->num_offsets, vmbuffer);
 
 		/* Now that we've vacuumed the page, record its available space */
 		page = BufferGetPage(buf);
@@ -2459,47 +2637,82 @@ lazy_vacuum_heap_rel(LVRelState *vacrel)
 
 		UnlockReleaseBuffer(buf);
 		RecordPageWithFreeSpace(vacrel->rel, blkno, freespace);
-		vacuumed_pages++;
+		*vacuumed_items += iter_result->num_offsets;
+		(*vacuumed_pages)++;
 	}
 
 	vacrel->blkno = InvalidBlockNumber;
 	if (BufferIsValid(vmbuffer))
 		ReleaseBuffer(vmbuffer);
+}
 
-	/*
-	 * We set all LP_DEAD items from the first heap pass to LP_UNUSED during
-	 * the second heap pass.  No more, no less.
-	 */
-	Assert(index > 0);
-	Assert(vacrel->num_index_scans > 1 ||
-		   (index == vacrel->lpdead_items &&
-			vacuumed_pages == vacrel->lpdead_item_pages));
+/*
+ *	heap_vacuum_dead_items_worker() -- take part in a parallel second heap pass
+ *
+ * This is called by parallel vacuum workers that were launched by
+ * parallel_vacuum_begin_heap_pass().  We vacuum heap pages from dead_items
+ * until there are none left, setting up just enough state to share the
+ * leader's code for that.
+ */
+void
+heap_vacuum_dead_items_worker(Relation rel, TidStore *dead_items,
+							  TransactionId OldestXmin,
+							  BufferAccessStrategy bstrategy,
+							  BlockNumber *vacuumed_pages,
+							  int64 *vacuumed_items)
+{
+	LVRelState *vacrel;
+	ErrorContextCallback errcallback;
+	TidStoreIter *iter;
 
-	ereport(DEBUG2,
-			(errmsg("table \"%s\": removed %lld dead item identifiers in %u pages",
-					vacrel->relname, (long long) index, vacuumed_pages)));
+	Assert(IsParallelWorker());
 
-	/* Revert to the previous phase information for error traceback */
-	restore_vacuum_error_info(vacrel, &saved_err_info);
+	vacrel = (LVRelState *) palloc0(sizeof(LVRelState));
+	vacrel->rel = rel;
+	vacrel->bstrategy = bstrategy;
+	vacrel->do_index_vacuuming = true;
+	vacrel->cutoffs.OldestXmin = OldestXmin;
+	vacrel->dead_items = dead_items;
+	vacrel->relnamespace = get_namespace_name(RelationGetNamespace(rel));
+	vacrel->relname = pstrdup(RelationGetRelationName(rel));
+	vacrel->indname = NULL;
+	vacrel->phase = VACUUM_ERRCB_PHASE_VACUUM_HEAP;
+	vacrel->blkno = InvalidBlockNumber;
+	vacrel->offnum = InvalidOffsetNumber;
+
+	/* Setup error traceback support for ereport() */
+	errcallback.callback = vacuum_error_callback;
+	errcallback.arg = vacrel;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	iter = TidStoreBeginSharedIterate(dead_items);
+	lazy_vacuum_heap_pages(vacrel, iter, NULL, vacuumed_pages, vacuumed_items);
+	TidStoreEndIterate(iter);
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+
+	pfree(vacrel->relname);
+	pfree(vacrel);
 }
 
 /*
- *	lazy_vacuum_heap_page() -- free page's LP_DEAD items listed in the
- *						  vacrel->dead_items array.
+ *	lazy_vacuum_heap_page() -- free page's LP_DEAD items.
  *
  * Caller must have an exclusive buffer lock on the buffer (though a full
  * cleanup lock is also acceptable).  vmbuffer must be valid and already have
  * a pin on blkno's visibility map page.
  *
- * index is an offset into the vacrel->dead_items array for the first listed
- * LP_DEAD item on the page.  The return value is the first index immediately
- * after all LP_DEAD items for the same page in the array.
+ * deadoffsets lists the offsets of the page's LP_DEAD items, which are taken
+ * from vacrel->dead_items (or from lazy_scan_prune's state, for the one-pass
+ * strategy).
  */
-static int
+static void
 lazy_vacuum_heap_page(LVRelState *vacrel, BlockNumber blkno, Buffer buffer,
-					  int index, Buffer vmbuffer)
+					  OffsetNumber *deadoffsets, int num_offsets,
+					  Buffer vmbuffer)
 {
-	VacDeadItems *dead_items = vacrel->dead_items;
 	Page		page = BufferGetPage(buffer);
 	OffsetNumber unused[MaxHeapTuplesPerPage];
 	int			nunused = 0;
@@ -2518,16 +2731,11 @@ lazy_vacuum_heap_page(LVRelState *vacrel, BlockNumber blkno, Buffer buffer,
 
 	START_CRIT_SECTION();
 
-	for (; index < dead_items->num_items; index++)
+	for (int i = 0; i < num_offsets; i++)
 	{
-		BlockNumber tblk;
-		OffsetNumber toff;
+		OffsetNumber toff = deadoffsets[i];
 		ItemId		itemid;
 
-		tblk = ItemPointerGetBlockNumber(&dead_items->items[index]);
-		if (tblk != blkno)
-			break;				/* past end of tuples for this block */
-		toff = ItemPointerGetOffsetNumber(&dead_items->items[index]);
 		itemid = PageGetItemId(page, toff);
 
 		Assert(ItemIdIsDead(itemid) && !ItemIdHasStorage(itemid));
@@ -2597,7 +2805,6 @@ lazy_vacuum_heap_page(LVRelState *vacrel, BlockNumber blkno, Buffer buffer,
 
 	/* Revert to the previous phase information for error traceback */
 	restore_vacuum_error_info(vacrel, &saved_err_info);
-	return index;
 }
 
 /*
@@ -2687,7 +2894,7 @@ lazy_cleanup_all_indexes(LVRelState *vacrel)
  *	lazy_vacuum_one_index() -- vacuum index relation.
  *
  *		Delete all the index tuples containing a TID collected in
- *		vacrel->dead_items array.  Also update running statistics.
+ *		vacrel->dead_items.  Also update running statistics.
  *		Exact details depend on index AM's ambulkdelete routine.
  *
  *		reltuples is the number of heap tuples to be passed to the
@@ -2724,7 +2931,7 @@ lazy_vacuum_one_index(Relation indrel, IndexBulkDeleteResult *istat,
 							 InvalidBlockNumber, InvalidOffsetNumber);
 
 	/* Do bulk deletion */
-	istat = vac_bulkdel_one_index(&ivinfo, istat, (void *) vacrel->dead_items);
+	istat = vac_bulkdel_one_index(&ivinfo, istat, vacrel->dead_items);
 
 	/* Revert to the previous phase information for error traceback */
 	restore_vacuum_error_info(vacrel, &saved_err_info);
@@ -3094,47 +3301,7 @@ count_nondeletable_pages(LVRelState *vacrel, bool *lock_waiter_detected)
 }
 
 /*
- * Returns the number of dead TIDs that VACUUM should allocate space to
- * store, given a heap rel of size vacrel->rel_pages, and given current
- * maintenance_work_mem setting (or current autovacuum_work_mem setting,
- * when applicable).
- *
- * See the comments at the head of this file for rationale.
- */
-static int
-dead_items_max_items(LVRelState *vacrel)
-{
-	int64		max_items;
-	int			vac_work_mem = IsAutoVacuumWorkerProcess() &&
-	autovacuum_work_mem != -1 ?
-	autovacuum_work_mem : maintenance_work_mem;
-
-	if (vacrel->nindexes > 0)
-	{
-		BlockNumber rel_pages = vacrel->rel_pages;
-
-		max_items = MAXDEADITEMS(vac_work_mem * 1024L);
-		max_items = Min(max_items, INT_MAX);
-		max_items = Min(max_items, MAXDEADITEMS(MaxAllocSize));
-
-		/* curious coding here to ensure the multiplication can't overflow */
-		if ((BlockNumber) (max_items / MaxHeapTuplesPerPage) > rel_pages)
-			max_items = rel_pages * MaxHeapTuplesPerPage;
-
-		/* stay sane if small maintenance_work_mem */
-		max_items = Max(max_items, MaxHeapTuplesPerPage);
-	}
-	else
-	{
-		/* One-pass case only stores a single heap page's TIDs at a time */
-		max_items = MaxHeapTuplesPerPage;
-	}
-
-	return (int) max_items;
-}
-
-/*
- * Allocate dead_items (either using palloc, or in dynamic shared memory).
+ * Allocate dead_items (either in local memory, or in dynamic shared memory).
  * Sets dead_items in vacrel for caller.
  *
  * Also handles parallel initialization as part of allocating dead_items in
@@ -3143,11 +3310,17 @@ dead_items_max_items(LVRelState *vacrel)
 static void
 dead_items_alloc(LVRelState *vacrel, int nworkers)
 {
-	VacDeadItems *dead_items;
-	int			max_items;
+	int			vac_work_mem = IsAutoVacuumWorkerProcess() &&
+	autovacuum_work_mem != -1 ?
+	autovacuum_work_mem : maintenance_work_mem;
 
-	max_items = dead_items_max_items(vacrel);
-	Assert(max_items >= MaxHeapTuplesPerPage);
+	/*
+	 * The one-pass strategy doesn't use dead_items at all, but it's simpler
+	 * to create an empty store anyway.  Unlike an array of TIDs, the store
+	 * only takes as much memory as its contents need, so we don't need to
+	 * limit our request by the size of the table.
+	 */
+	vacrel->dead_items_max_bytes = (size_t) vac_work_mem * 1024;
 
 	/*
 	 * Initialize state for a parallel vacuum.  As of now, only one worker can
@@ -3174,7 +3347,7 @@ dead_items_alloc(LVRelState *vacrel, int nworkers)
 		else
 			vacrel->pvs = parallel_vacuum_init(vacrel->rel, vacrel->indrels,
 											   vacrel->nindexes, nworkers,
-											   max_items,
+											   vac_work_mem,
 											   vacrel->verbose ? INFO : DEBUG2,
 											   vacrel->bstrategy);
 
@@ -3187,11 +3360,49 @@ dead_items_alloc(LVRelState *vacrel, int nworkers)
 	}
 
 	/* Serial VACUUM case */
-	dead_items = (VacDeadItems *) palloc(vac_max_items_to_alloc_size(max_items));
-	dead_items->max_items = max_items;
-	dead_items->num_items = 0;
+	vacrel->dead_items = TidStoreCreate(vacrel->dead_items_max_bytes, NULL);
+}
 
-	vacrel->dead_items = dead_items;
+/*
+ * Add the given LP_DEAD items of a heap page to dead_items, and report the
+ * new totals.
+ */
+static void
+dead_items_add(LVRelState *vacrel, BlockNumber blkno, OffsetNumber *offsets,
+			   int num_offsets)
+{
+	TidStore   *dead_items = vacrel->dead_items;
+	const int	prog_index[2] = {
+		PROGRESS_VACUUM_NUM_DEAD_ITEM_IDS,
+		PROGRESS_VACUUM_DEAD_TUPLE_BYTES
+	};
+	int64		prog_val[2];
+
+	TidStoreSetBlockOffsets(dead_items, blkno, offsets, num_offsets);
+
+	prog_val[0] = TidStoreNumTids(dead_items);
+	prog_val[1] = TidStoreMemoryUsage(dead_items);
+	pgstat_progress_update_multi_param(2, prog_index, prog_val);
+}
+
+/*
+ * Forget all the TIDs in dead_items, and report that.
+ */
+static void
+dead_items_reset(LVRelState *vacrel)
+{
+	TidStore   *dead_items = vacrel->dead_items;
+	const int	prog_index[2] = {
+		PROGRESS_VACUUM_NUM_DEAD_ITEM_IDS,
+		PROGRESS_VACUUM_DEAD_TUPLE_BYTES
+	};
+	int64		prog_val[2];
+
+	TidStoreReset(dead_items);
+
+	prog_val[0] = 0;
+	prog_val[1] = TidStoreMemoryUsage(dead_items);
+	pgstat_progress_update_multi_param(2, prog_index, prog_val);
 }
 
 /*
@@ -389,10 +389,27 @@ visibilitymap_count(Relation rel, BlockNumber *all_visible, BlockNumber *all_fro
 	BlockNumber mapBlock;
 	BlockNumber nvisible = 0;
 	BlockNumber nfrozen = 0;
+	SMgrRelation reln;
 
 	/* all_visible must be specified */
 	Assert(all_visible);
 
+	/*
+	 * Start reading the whole map before counting it.  The map is small
+	 * relative to the heap, but VACUUM and ANALYZE call this for every
+	 * relation they process, and on large partitioned tables waiting for
+	 * each map page in turn adds up.  The map size we see here may be stale;
+	 * that only affects how much we prefetch, not the result.
+	 */
+	reln = RelationGetSmgr(rel);
+	if (reln->smgr_cached_nblocks[VISIBILITYMAP_FORKNUM] != InvalidBlockNumber)
+	{
+		BlockNumber nmapblocks = reln->smgr_cached_nblocks[VISIBILITYMAP_FORKNUM];
+
+		for (mapBlock = 1; mapBlock < nmapblocks; mapBlock++)
+			PrefetchBuffer(rel, VISIBILITYMAP_FORKNUM, mapBlock);
+	}
+
 	for (mapBlock = 0;; mapBlock++)
 	{
 		Buffer		mapBuffer;
@@ -623,7 +640,7 @@ static void
 vm_extend(Relation rel, BlockNumber vm_nblocks)
 {
 	BlockNumber vm_nblocks_now;
-	PGAlignedBlock pg;
+	PGIOAlignedBlock pg;
 	SMgrRelation reln;
 
 	PageInit((Page) pg.data, BLCKSZ, 0);
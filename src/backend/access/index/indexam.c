@@ -18,12 +18,14 @@
  *		index_rescan	- restart a scan of an index
  *		index_endscan	- end a scan
  *		index_insert	- insert an index tuple into a relation
+ *		index_insert_batch - insert a batch of index tuples
  *		index_markpos	- mark a scan position
  *		index_restrpos	- restore a scan position
  *		index_parallelscan_estimate - estimate shared memory for parallel scan
  *		index_parallelscan_initialize - initialize parallel scan
  *		index_parallelrescan  - (re)start a parallel scan of an index
  *		index_beginscan_parallel - join parallel index scan
+ *		index_enable_prefetch - prefetch heap blocks ahead of the scan
  *		index_getnext_tid	- get the next TID from a scan
  *		index_fetch_heap		- get the scan's next heap tuple
  *		index_getnext_slot	- get the next tuple from a scan
@@ -49,6 +51,7 @@
 #include "access/relscan.h"
 #include "access/tableam.h"
 #include "access/transam.h"
+#include "access/visibilitymap.h"
 #include "access/xlog.h"
 #include "catalog/index.h"
 #include "catalog/pg_amproc.h"
@@ -59,11 +62,52 @@
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
+#include "utils/memutils.h"
 #include "utils/ruleutils.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
 
+/*
+ * State for prefetching heap blocks ahead of an amgettuple-based scan.
+ *
+ * The index entries returned by the AM are read ahead into a queue, and the
+ * heap blocks they point to are prefetched as they're added to it; the
+ * caller then gets the entries from the head of the queue, in the order the
+ * AM returned them.  We start with no lookahead at all, and grow it by one
+ * entry for each entry returned, so that scans that stop after a few tuples
+ * don't read the index further than they'd otherwise have done.
+ *
+ * Once the AM has moved past an entry, it can no longer be told that the
+ * entry's tuple is dead (see kill_prior_tuple).  When the caller reports a
+ * dead tuple that we can't pass on, we drop the lookahead for a while, so
+ * that scans of an index with many dead entries still get them killed.
+ */
+typedef struct IndexPrefetchEntry
+{
+	ItemPointerData tid;		/* xs_heaptid returned by the AM */
+	bool		recheck;		/* xs_recheck returned by the AM */
+	IndexTuple	itup;			/* copy of xs_itup, if xs_want_itup */
+	HeapTuple	htup;			/* copy of xs_hitup, if xs_want_itup */
+} IndexPrefetchEntry;
+
+typedef struct IndexPrefetchData
+{
+	MemoryContext cxt;			/* context holding the copied tuples */
+	int			target;			/* maximum lookahead distance */
+	int			distance;		/* current lookahead distance */
+	int			cooldown;		/* entries to return before growing again */
+	bool		skip_all_visible;	/* don't prefetch all-visible blocks */
+	bool		done;			/* has the AM returned its last entry? */
+	Buffer		vmbuffer;		/* for VM_ALL_VISIBLE() checks */
+	BlockNumber last_block;		/* block most recently prefetched */
+	IndexPrefetchEntry current; /* entry last returned to the caller */
+	int			head;			/* array index of the oldest queued entry */
+	int			count;			/* number of queued entries */
+	IndexPrefetchEntry queue[FLEXIBLE_ARRAY_MEMBER];	/* target + 1 */
+} IndexPrefetchData;
+
+
 /* ----------------------------------------------------------------
  *					macros used in index_ routines
  *
@@ -104,6 +148,9 @@ do { \
 			 CppAsString(pname), RelationGetRelationName(scan->indexRelation)); \
 } while(0)
 
+static void index_prefetch_reset(IndexPrefetchData *prefetch);
+static ItemPointer index_prefetch_getnext_tid(IndexScanDesc scan,
+											  ScanDirection direction);
 static IndexScanDesc index_beginscan_internal(Relation indexRelation,
 											  int nkeys, int norderbys, Snapshot snapshot,
 											  ParallelIndexScanDesc pscan, bool temp_snap);
@@ -196,6 +243,36 @@ index_insert(Relation indexRelation,
 											 indexInfo);
 }
 
+/* ----------------
+ *		index_insert_batch - insert a batch of index tuples into a relation
+ *
+ * values and isnull hold the column values of each of the ntuples tuples in
+ * turn.  The tuples are inserted as by index_insert with UNIQUE_CHECK_NO.
+ * Only callable if the AM provides aminsertbatch.
+ * ----------------
+ */
+void
+index_insert_batch(Relation indexRelation,
+				   Datum *values,
+				   bool *isnull,
+				   ItemPointer heap_tids,
+				   int ntuples,
+				   Relation heapRelation,
+				   IndexInfo *indexInfo)
+{
+	RELATION_CHECKS;
+	CHECK_REL_PROCEDURE(aminsertbatch);
+
+	if (!(indexRelation->rd_indam->ampredlocks))
+		CheckForSerializableConflictIn(indexRelation,
+									   (ItemPointer) NULL,
+									   InvalidBlockNumber);
+
+	indexRelation->rd_indam->aminsertbatch(indexRelation, values, isnull,
+										   heap_tids, ntuples, heapRelation,
+										   indexInfo);
+}
+
 /*
  * index_beginscan - start a scan of an index with amgettuple
  *
@@ -315,6 +392,9 @@ index_rescan(IndexScanDesc scan,
 	scan->kill_prior_tuple = false; /* for safety */
 	scan->xs_heap_continue = false;
 
+	if (scan->xs_prefetch)
+		index_prefetch_reset(scan->xs_prefetch);
+
 	scan->indexRelation->rd_indam->amrescan(scan, keys, nkeys,
 											orderbys, norderbys);
 }
@@ -336,6 +416,15 @@ index_endscan(IndexScanDesc scan)
 		scan->xs_heapfetch = NULL;
 	}
 
+	if (scan->xs_prefetch)
+	{
+		if (BufferIsValid(scan->xs_prefetch->vmbuffer))
+			ReleaseBuffer(scan->xs_prefetch->vmbuffer);
+		MemoryContextDelete(scan->xs_prefetch->cxt);
+		pfree(scan->xs_prefetch);
+		scan->xs_prefetch = NULL;
+	}
+
 	/* End the AM's scan */
 	scan->indexRelation->rd_indam->amendscan(scan);
 
@@ -359,6 +448,9 @@ index_markpos(IndexScanDesc scan)
 	SCAN_CHECKS;
 	CHECK_SCAN_PROCEDURE(ammarkpos);
 
+	/* the AM's position isn't the caller's while there's a lookahead */
+	Assert(scan->xs_prefetch == NULL);
+
 	scan->indexRelation->rd_indam->ammarkpos(scan);
 }
 
@@ -384,6 +476,7 @@ index_restrpos(IndexScanDesc scan)
 
 	SCAN_CHECKS;
 	CHECK_SCAN_PROCEDURE(amrestrpos);
+	Assert(scan->xs_prefetch == NULL);
 
 	/* release resources (like buffer pins) from table accesses */
 	if (scan->xs_heapfetch)
@@ -514,6 +607,62 @@ index_beginscan_parallel(Relation heaprel, Relation indexrel, int nkeys,
 	return scan;
 }
 
+/* ----------------
+ * index_enable_prefetch - prefetch heap blocks ahead of the scan
+ *
+ * After this, index_getnext_tid() reads up to 'target' entries ahead of the
+ * one it returns, and prefetches the heap blocks they point to.  If
+ * 'skip_all_visible' is true, blocks that are all-visible according to the
+ * visibility map aren't prefetched, as an index-only scan won't visit them.
+ *
+ * The caller must always fetch in the same direction, and must not use
+ * index_markpos() or index_restrpos() on the scan.  Scans with ordering
+ * operators aren't supported either.  This must be called before the scan
+ * is started with index_rescan().
+ * ----------------
+ */
+void
+index_enable_prefetch(IndexScanDesc scan, int target, bool skip_all_visible)
+{
+	IndexPrefetchData *prefetch;
+
+	Assert(scan->xs_prefetch == NULL);
+	Assert(scan->numberOfOrderBys == 0);
+	Assert(scan->heapRelation != NULL);
+
+	if (target <= 0)
+		return;
+
+	prefetch = palloc(offsetof(IndexPrefetchData, queue) +
+					  sizeof(IndexPrefetchEntry) * (target + 1));
+	prefetch->cxt = AllocSetContextCreate(CurrentMemoryContext,
+										  "index prefetch tuples",
+										  ALLOCSET_SMALL_SIZES);
+	prefetch->target = target;
+	prefetch->skip_all_visible = skip_all_visible;
+	prefetch->vmbuffer = InvalidBuffer;
+	index_prefetch_reset(prefetch);
+
+	scan->xs_prefetch = prefetch;
+}
+
+/*
+ * index_prefetch_reset - forget the queued entries, for a rescan
+ */
+static void
+index_prefetch_reset(IndexPrefetchData *prefetch)
+{
+	MemoryContextReset(prefetch->cxt);
+	prefetch->distance = 0;
+	prefetch->cooldown = 0;
+	prefetch->done = false;
+	prefetch->last_block = InvalidBlockNumber;
+	prefetch->current.itup = NULL;
+	prefetch->current.htup = NULL;
+	prefetch->head = 0;
+	prefetch->count = 0;
+}
+
 /* ----------------
  * index_getnext_tid - get the next TID from a scan
  *
@@ -532,6 +681,9 @@ index_getnext_tid(IndexScanDesc scan, ScanDirection direction)
 	/* XXX: we should assert that a snapshot is pushed or registered */
 	Assert(TransactionIdIsValid(RecentXmin));
 
+	if (scan->xs_prefetch)
+		return index_prefetch_getnext_tid(scan, direction);
+
 	/*
 	 * The AM's amgettuple proc finds the next index entry matching the scan
 	 * keys, and puts the TID into scan->xs_heaptid.  It should also set
@@ -561,6 +713,121 @@ index_getnext_tid(IndexScanDesc scan, ScanDirection direction)
 	return &scan->xs_heaptid;
 }
 
+/*
+ * index_prefetch_getnext_tid - index_getnext_tid() with a lookahead
+ */
+static ItemPointer
+index_prefetch_getnext_tid(IndexScanDesc scan, ScanDirection direction)
+{
+	IndexPrefetchData *prefetch = scan->xs_prefetch;
+	int			capacity = prefetch->target + 1;
+	IndexPrefetchEntry *entry;
+
+	/* Free the copies of the previously returned entry's tuples */
+	if (prefetch->current.itup)
+		pfree(prefetch->current.itup);
+	if (prefetch->current.htup)
+		pfree(prefetch->current.htup);
+	prefetch->current.itup = NULL;
+	prefetch->current.htup = NULL;
+
+	/*
+	 * If the AM has already returned entries after the one the caller says
+	 * is dead, it's too late to tell the AM.  Stop reading ahead for a while
+	 * instead, so that any further dead entries do get killed.
+	 */
+	if (scan->kill_prior_tuple && prefetch->count > 0)
+	{
+		scan->kill_prior_tuple = false;
+		prefetch->distance = 0;
+		prefetch->cooldown = prefetch->target * 2;
+	}
+
+	/* Top up the queue */
+	while (!prefetch->done && prefetch->count <= prefetch->distance)
+	{
+		bool		found;
+		BlockNumber block;
+
+		found = scan->indexRelation->rd_indam->amgettuple(scan, direction);
+
+		/* Reset kill flag immediately for safety */
+		scan->kill_prior_tuple = false;
+
+		if (!found)
+		{
+			prefetch->done = true;
+			break;
+		}
+		Assert(ItemPointerIsValid(&scan->xs_heaptid));
+
+		pgstat_count_index_tuples(scan->indexRelation, 1);
+
+		entry = &prefetch->queue[(prefetch->head + prefetch->count) % capacity];
+		entry->tid = scan->xs_heaptid;
+		entry->recheck = scan->xs_recheck;
+		entry->itup = NULL;
+		entry->htup = NULL;
+		if (scan->xs_want_itup)
+		{
+			MemoryContext oldcxt = MemoryContextSwitchTo(prefetch->cxt);
+
+			if (scan->xs_itup)
+				entry->itup = CopyIndexTuple(scan->xs_itup);
+			if (scan->xs_hitup)
+				entry->htup = heap_copytuple(scan->xs_hitup);
+			MemoryContextSwitchTo(oldcxt);
+		}
+		prefetch->count++;
+
+		/*
+		 * Prefetch the entry's heap block, unless it's about to be read
+		 * anyway, or we just did so for an earlier entry.
+		 */
+		block = ItemPointerGetBlockNumber(&entry->tid);
+		if (prefetch->count > 1 && block != prefetch->last_block &&
+			!(prefetch->skip_all_visible &&
+			  VM_ALL_VISIBLE(scan->heapRelation, block, &prefetch->vmbuffer)))
+		{
+			PrefetchBuffer(scan->heapRelation, MAIN_FORKNUM, block);
+			prefetch->last_block = block;
+		}
+	}
+
+	scan->xs_heap_continue = false;
+
+	/* If we're out of index entries, we're done */
+	if (prefetch->count == 0)
+	{
+		/* release resources (like buffer pins) from table accesses */
+		if (scan->xs_heapfetch)
+			table_index_fetch_reset(scan->xs_heapfetch);
+
+		return NULL;
+	}
+
+	/* Return the oldest queued entry, as if the AM had just returned it */
+	entry = &prefetch->queue[prefetch->head];
+	prefetch->head = (prefetch->head + 1) % capacity;
+	prefetch->count--;
+	prefetch->current = *entry;
+
+	scan->xs_heaptid = entry->tid;
+	scan->xs_recheck = entry->recheck;
+	if (scan->xs_want_itup)
+	{
+		scan->xs_itup = entry->itup;
+		scan->xs_hitup = entry->htup;
+	}
+
+	if (prefetch->cooldown > 0)
+		prefetch->cooldown--;
+	else if (prefetch->distance < prefetch->target)
+		prefetch->distance++;
+
+	return &scan->xs_heaptid;
+}
+
 /* ----------------
  *		index_fetch_heap - get the scan's next heap tuple
  *
@@ -42,6 +42,8 @@ static OffsetNumber _bt_findinsertloc(Relation rel,
 									  BTStack stack,
 									  Relation heapRel);
 static void _bt_stepright(Relation rel, BTInsertState insertstate, BTStack stack);
+static int	_bt_insert_batch_onpg(Relation rel, BTScanInsert itup_key,
+								  Buffer buf, IndexTuple *itups, int ntuples);
 static void _bt_insertonpg(Relation rel, BTScanInsert itup_key,
 						   Buffer buf,
 						   Buffer cbuf,
@@ -273,6 +275,216 @@ search:
 	return is_unique;
 }
 
+/*
+ *	_bt_doinsert_batch() -- Handle insertion of a batch of index tuples.
+ *
+ *		This routine is called by btinsertbatch, with tuples that are sorted
+ *		in index order and need no uniqueness check.  The leaf page of the
+ *		first tuple not yet inserted is found by searching from the root, and
+ *		as many of the tuples as go on that page and fit on it are added
+ *		together by _bt_insert_batch_onpg.  A tuple that needs a page split
+ *		or a posting list split is inserted by _bt_doinsert instead.
+ */
+void
+_bt_doinsert_batch(Relation rel, IndexTuple *itups, int ntuples,
+				   Relation heapRel)
+{
+	int			i = 0;
+
+	while (i < ntuples)
+	{
+		BTInsertStateData insertstate;
+		BTScanInsert itup_key;
+		BTStack		stack;
+		int			nadded;
+
+		itup_key = _bt_mkscankey(rel, itups[i]);
+
+		/*
+		 * Without heap TID keys, the place of a tuple among its duplicates is
+		 * not determined by its TID, so leave pg_upgrade'd indexes to the
+		 * retail path.
+		 */
+		if (!itup_key->heapkeyspace)
+		{
+			pfree(itup_key);
+			for (; i < ntuples; i++)
+				_bt_doinsert(rel, itups[i], UNIQUE_CHECK_NO, false, heapRel);
+			break;
+		}
+
+		insertstate.itup = itups[i];
+		insertstate.itemsz = MAXALIGN(IndexTupleSize(itups[i]));
+		insertstate.itup_key = itup_key;
+		insertstate.bounds_valid = false;
+		insertstate.buf = InvalidBuffer;
+		insertstate.postingoff = 0;
+
+		stack = _bt_search_insert(rel, &insertstate);
+
+		CheckForSerializableConflictIn(rel, NULL, BufferGetBlockNumber(insertstate.buf));
+
+		nadded = _bt_insert_batch_onpg(rel, itup_key, insertstate.buf,
+									   itups + i, ntuples - i);
+		if (stack)
+			_bt_freestack(stack);
+		pfree(itup_key);
+
+		if (nadded == 0)
+		{
+			_bt_doinsert(rel, itups[i], UNIQUE_CHECK_NO, false, heapRel);
+			nadded = 1;
+		}
+		i += nadded;
+	}
+}
+
+/*
+ *	_bt_insert_batch_onpg() -- Add a run of tuples to a leaf page.
+ *
+ * On entry, buf is the write-locked leaf page that itups[0] belongs on, and
+ * itup_key is the insertion scan key of itups[0].  The longest prefix of the
+ * sorted itups that belongs on the page and fits in its free space, without
+ * a posting list split, is added in one critical section with one WAL
+ * record.  Returns the number of tuples added, which is zero if even the
+ * first one needs more than that.  buf is released in all cases.
+ *
+ * Since the tuples are sorted, each tuple goes in at the offset the binary
+ * search finds on the unmodified page, plus the number of tuples of the run
+ * before it.
+ */
+static int
+_bt_insert_batch_onpg(Relation rel, BTScanInsert itup_key, Buffer buf,
+					  IndexTuple *itups, int ntuples)
+{
+	Page		page = BufferGetPage(buf);
+	BTPageOpaque opaque = BTPageGetOpaque(page);
+	bool		isrightmost = P_RIGHTMOST(opaque);
+	bool		isroot = P_ISROOT(opaque);
+	OffsetNumber *offsets;
+	Size		freespace;
+	Size		datalen = 0;
+	BlockNumber blockcache;
+	int			nadded;
+
+	Assert(P_ISLEAF(opaque) && !P_INCOMPLETE_SPLIT(opaque));
+
+	offsets = palloc(sizeof(OffsetNumber) * ntuples);
+	freespace = PageGetExactFreeSpace(page);
+
+	for (nadded = 0; nadded < ntuples; nadded++)
+	{
+		IndexTuple	itup = itups[nadded];
+		BTInsertStateData insertstate;
+		OffsetNumber newitemoff;
+
+		insertstate.itup = itup;
+		insertstate.itemsz = MAXALIGN(IndexTupleSize(itup));
+		insertstate.itup_key = itup_key;
+		insertstate.bounds_valid = false;
+		insertstate.buf = buf;
+		insertstate.postingoff = 0;
+
+		if (nadded > 0)
+		{
+			/* Stop at the first tuple that belongs to the right of the page */
+			insertstate.itup_key = _bt_mkscankey(rel, itup);
+			if (!isrightmost &&
+				_bt_compare(rel, insertstate.itup_key, page, P_HIKEY) > 0)
+			{
+				pfree(insertstate.itup_key);
+				break;
+			}
+		}
+
+		newitemoff = InvalidOffsetNumber;
+		if (insertstate.itemsz + sizeof(ItemIdData) <= freespace &&
+			insertstate.itemsz <= BTMaxItemSize(page))
+			newitemoff = _bt_binsrch_insert(rel, &insertstate);
+
+		if (nadded > 0)
+			pfree(insertstate.itup_key);
+
+		if (newitemoff == InvalidOffsetNumber || insertstate.postingoff != 0)
+			break;
+
+		offsets[nadded] = newitemoff + nadded;
+		freespace -= insertstate.itemsz + sizeof(ItemIdData);
+		datalen += insertstate.itemsz;
+	}
+
+	if (nadded > 0)
+	{
+		char	   *data = NULL;
+
+		if (RelationNeedsWAL(rel))
+		{
+			char	   *pos;
+
+			pos = data = palloc(datalen);
+			for (int i = 0; i < nadded; i++)
+			{
+				Size		itemsz = MAXALIGN(IndexTupleSize(itups[i]));
+
+				memcpy(pos, itups[i], itemsz);
+				pos += itemsz;
+			}
+		}
+
+		/* Do the update.  No ereport(ERROR) until changes are logged */
+		START_CRIT_SECTION();
+
+		for (int i = 0; i < nadded; i++)
+		{
+			if (PageAddItem(page, (Item) itups[i],
+							MAXALIGN(IndexTupleSize(itups[i])), offsets[i],
+							false, false) == InvalidOffsetNumber)
+				elog(PANIC, "failed to add new item to block %u in index \"%s\"",
+					 BufferGetBlockNumber(buf), RelationGetRelationName(rel));
+		}
+
+		MarkBufferDirty(buf);
+
+		/* XLOG stuff */
+		if (RelationNeedsWAL(rel))
+		{
+			xl_btree_insert_multi xlrec;
+			XLogRecPtr	recptr;
+
+			xlrec.ntuples = nadded;
+
+			XLogBeginInsert();
+			XLogRegisterData((char *) &xlrec, SizeOfBtreeInsertMulti);
+			XLogRegisterData((char *) offsets, nadded * sizeof(OffsetNumber));
+			XLogRegisterBuffer(0, buf, REGBUF_STANDARD);
+			XLogRegisterBufData(0, data, datalen);
+
+			recptr = XLogInsert(RM_BTREE_ID, XLOG_BTREE_INSERT_MULTI);
+
+			PageSetLSN(page, recptr);
+		}
+
+		END_CRIT_SECTION();
+
+		if (data)
+			pfree(data);
+	}
+	pfree(offsets);
+
+	/* Maintain the rightmost leaf page cache, as _bt_insertonpg does */
+	blockcache = InvalidBlockNumber;
+	if (nadded > 0 && isrightmost && !isroot)
+		blockcache = BufferGetBlockNumber(buf);
+
+	_bt_relbuf(rel, buf);
+
+	if (BlockNumberIsValid(blockcache) &&
+		_bt_getrootheight(rel) >= BTREE_FASTPATH_MIN_LEVEL)
+		RelationSetTargetBlock(rel, blockcache);
+
+	return nadded;
+}
+
 /*
  *	_bt_search_insert() -- _bt_search() wrapper for inserts
  *
@@ -37,6 +37,8 @@
 #include "utils/builtins.h"
 #include "utils/index_selfuncs.h"
 #include "utils/memutils.h"
+#include "utils/spccache.h"
+#include "utils/tuplesort.h"
 
 
 /*
@@ -112,8 +114,10 @@ bthandler(PG_FUNCTION_ARGS)
 	amroutine->amclusterable = true;
 	amroutine->ampredlocks = true;
 	amroutine->amcanparallel = true;
+	amroutine->amcanbuildparallel = true;
 	amroutine->amcaninclude = true;
 	amroutine->amusemaintenanceworkmem = false;
+	amroutine->amsummarizing = false;
 	amroutine->amparallelvacuumoptions =
 		VACUUM_OPTION_PARALLEL_BULKDEL | VACUUM_OPTION_PARALLEL_COND_CLEANUP;
 	amroutine->amkeytype = InvalidOid;
@@ -121,6 +125,7 @@ bthandler(PG_FUNCTION_ARGS)
 	amroutine->ambuild = btbuild;
 	amroutine->ambuildempty = btbuildempty;
 	amroutine->aminsert = btinsert;
+	amroutine->aminsertbatch = btinsertbatch;
 	amroutine->ambulkdelete = btbulkdelete;
 	amroutine->amvacuumcleanup = btvacuumcleanup;
 	amroutine->amcanreturn = btcanreturn;
@@ -153,7 +158,7 @@ btbuildempty(Relation index)
 	Page		metapage;
 
 	/* Construct metapage. */
-	metapage = (Page) palloc(BLCKSZ);
+	metapage = (Page) palloc_aligned(BLCKSZ, PG_IO_ALIGN_SIZE, 0);
 	_bt_initmetapage(metapage, P_NONE, 0, _bt_allequalimage(index, false));
 
 	/*
@@ -204,6 +209,43 @@ btinsert(Relation rel, Datum *values, bool *isnull,
 	return result;
 }
 
+/*
+ *	btinsertbatch() -- insert a batch of index tuples into a btree.
+ *
+ *		The tuples are sorted first, so that _bt_doinsert_batch can add each
+ *		run of them that goes on the same leaf page with a single descent.
+ */
+void
+btinsertbatch(Relation rel, Datum *values, bool *isnull,
+			  ItemPointer ht_ctids, int ntuples, Relation heapRel,
+			  IndexInfo *indexInfo)
+{
+	int			natts = IndexRelationGetNumberOfAttributes(rel);
+	Tuplesortstate *sortstate;
+	IndexTuple *itups;
+	IndexTuple	itup;
+	int			i;
+
+	sortstate = tuplesort_begin_index_btree(heapRel, rel, false, false,
+											work_mem, NULL, TUPLESORT_NONE);
+	for (i = 0; i < ntuples; i++)
+		tuplesort_putindextuplevalues(sortstate, rel, &ht_ctids[i],
+									  values + i * natts, isnull + i * natts);
+	tuplesort_performsort(sortstate);
+
+	itups = palloc(sizeof(IndexTuple) * ntuples);
+	for (i = 0; (itup = tuplesort_getindextuple(sortstate, true)) != NULL; i++)
+		itups[i] = CopyIndexTuple(itup);
+	Assert(i == ntuples);
+	tuplesort_end(sortstate);
+
+	_bt_doinsert_batch(rel, itups, ntuples, heapRel);
+
+	for (i = 0; i < ntuples; i++)
+		pfree(itups[i]);
+	pfree(itups);
+}
+
 /*
  *	btgettuple() -- Get the next tuple in the scan.
  */
@@ -230,6 +272,13 @@ btgettuple(IndexScanDesc scan, ScanDirection dir)
 		_bt_start_array_keys(scan, dir);
 	}
 
+	/* Likewise, find the first prefix of a skip scan */
+	if (so->skipKeyData && !BTScanPosIsValid(so->currPos))
+	{
+		if (!_bt_start_skip_scan(scan, dir))
+			return false;
+	}
+
 	/* This loop handles advancing to the next array elements, if any */
 	do
 	{
@@ -272,8 +321,9 @@ btgettuple(IndexScanDesc scan, ScanDirection dir)
 		/* If we have a tuple, return it ... */
 		if (res)
 			break;
-		/* ... otherwise see if we have more array keys to deal with */
-	} while (so->numArrayKeys && _bt_advance_array_keys(scan, dir));
+		/* ... otherwise see if we have more array keys or prefixes */
+	} while ((so->numArrayKeys && _bt_advance_array_keys(scan, dir)) ||
+			 (so->skipKeyData && _bt_advance_skip_scan(scan, dir)));
 
 	return res;
 }
@@ -300,6 +350,13 @@ btgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 		_bt_start_array_keys(scan, ForwardScanDirection);
 	}
 
+	/* Likewise, find the first prefix of a skip scan */
+	if (so->skipKeyData)
+	{
+		if (!_bt_start_skip_scan(scan, ForwardScanDirection))
+			return ntids;
+	}
+
 	/* This loop handles advancing to the next array elements, if any */
 	do
 	{
@@ -330,8 +387,11 @@ btgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 				ntids++;
 			}
 		}
-		/* Now see if we have more array keys to deal with */
-	} while (so->numArrayKeys && _bt_advance_array_keys(scan, ForwardScanDirection));
+		/* Now see if we have more array keys or prefixes to deal with */
+	} while ((so->numArrayKeys &&
+			  _bt_advance_array_keys(scan, ForwardScanDirection)) ||
+			 (so->skipKeyData &&
+			  _bt_advance_skip_scan(scan, ForwardScanDirection)));
 
 	return ntids;
 }
@@ -355,8 +415,9 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 	so = (BTScanOpaque) palloc(sizeof(BTScanOpaqueData));
 	BTScanPosInvalidate(so->currPos);
 	BTScanPosInvalidate(so->markPos);
+	/* leave room for a skip scan's prefix key */
 	if (scan->numberOfKeys > 0)
-		so->keyData = (ScanKey) palloc(scan->numberOfKeys * sizeof(ScanKeyData));
+		so->keyData = (ScanKey) palloc((scan->numberOfKeys + 1) * sizeof(ScanKeyData));
 	else
 		so->keyData = NULL;
 
@@ -365,6 +426,11 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 	so->arrayKeys = NULL;
 	so->arrayContext = NULL;
 
+	so->skipKeyData = NULL;		/* assume no skip scan for now */
+	so->skipHavePrefix = false;
+	so->markSkipHavePrefix = false;
+	so->skipContext = NULL;
+
 	so->killedItems = NULL;		/* until needed */
 	so->numKilled = 0;
 
@@ -439,6 +505,9 @@ btrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
 
 	/* If any keys are SK_SEARCHARRAY type, set up array-key info */
 	_bt_preprocess_array_keys(scan);
+
+	/* If there are keys only on later columns, consider a skip scan */
+	_bt_preprocess_skip_scan(scan);
 }
 
 /*
@@ -469,6 +538,9 @@ btendscan(IndexScanDesc scan)
 	/* so->arrayKeyData and so->arrayKeys are in arrayContext */
 	if (so->arrayContext != NULL)
 		MemoryContextDelete(so->arrayContext);
+	/* likewise for the skip scan workspace */
+	if (so->skipContext != NULL)
+		MemoryContextDelete(so->skipContext);
 	if (so->killedItems != NULL)
 		pfree(so->killedItems);
 	if (so->currTuples != NULL)
@@ -505,6 +577,10 @@ btmarkpos(IndexScanDesc scan)
 	/* Also record the current positions of any array keys */
 	if (so->numArrayKeys)
 		_bt_mark_array_keys(scan);
+
+	/* ... and the current prefix of a skip scan */
+	if (so->skipKeyData)
+		_bt_mark_skip_scan(scan);
 }
 
 /*
@@ -519,6 +595,10 @@ btrestrpos(IndexScanDesc scan)
 	if (so->numArrayKeys)
 		_bt_restore_array_keys(scan);
 
+	/* ... or the marked prefix of a skip scan */
+	if (so->skipKeyData)
+		_bt_restore_skip_scan(scan);
+
 	if (so->markItemIndex >= 0)
 	{
 		/*
@@ -908,6 +988,8 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 	BTVacState	vstate;
 	BlockNumber num_pages;
 	BlockNumber scanblkno;
+	BlockNumber prefetch_blkno;
+	int			prefetch_distance;
 	bool		needLock;
 
 	/*
@@ -974,7 +1056,15 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 	 */
 	needLock = !RELATION_IS_LOCAL(rel);
 
+	/*
+	 * We read the index in physical order, so we can prefetch the blocks
+	 * ahead of the one we're processing.
+	 */
+	prefetch_distance =
+		get_tablespace_maintenance_io_concurrency(rel->rd_rel->reltablespace);
+
 	scanblkno = BTREE_METAPAGE + 1;
+	prefetch_blkno = scanblkno;
 	for (;;)
 	{
 		/* Get the current relation length */
@@ -994,6 +1084,13 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 		/* Iterate over pages, then loop back to recheck length */
 		for (; scanblkno < num_pages; scanblkno++)
 		{
+			for (; prefetch_blkno < num_pages &&
+				 prefetch_blkno <= (uint64) scanblkno + prefetch_distance;
+				 prefetch_blkno++)
+			{
+				if (prefetch_blkno != scanblkno)
+					PrefetchBuffer(rel, MAIN_FORKNUM, prefetch_blkno);
+			}
 			btvacuumpage(&vstate, scanblkno);
 			if (info->report_progress)
 				pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_DONE,
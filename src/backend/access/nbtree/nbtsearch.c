@@ -20,14 +20,18 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/predicate.h"
+#include "utils/datum.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
+#include "utils/uuid.h"
 
 
 static void _bt_drop_lock_and_maybe_pin(IndexScanDesc scan, BTScanPos sp);
 static OffsetNumber _bt_binsrch(Relation rel, BTScanInsert key, Buffer buf);
 static int	_bt_binsrch_posting(BTScanInsert key, Page page,
 								OffsetNumber offnum);
+static inline int32 _bt_call_comparator(ScanKey scankey, Datum datum);
 static bool _bt_readpage(IndexScanDesc scan, ScanDirection dir,
 						 OffsetNumber offnum);
 static void _bt_saveitem(BTScanOpaque so, int itemIndex,
@@ -625,6 +629,54 @@ _bt_binsrch_posting(BTScanInsert key, Page page, OffsetNumber offnum)
 	return low;
 }
 
+/*
+ * _bt_call_comparator() -- Call scankey's support function 1 on datum.
+ *
+ * Binary searches spend most of their time here, so the comparison functions
+ * of the most common fixed-width key types are inlined rather than called
+ * through fmgr.  The result must be the same as that of the support function
+ * itself.
+ */
+static inline int32
+_bt_call_comparator(ScanKey scankey, Datum datum)
+{
+	switch (scankey->sk_func.fn_oid)
+	{
+		case F_BTINT4CMP:
+			{
+				int32		a = DatumGetInt32(datum);
+				int32		b = DatumGetInt32(scankey->sk_argument);
+
+				return (a > b) - (a < b);
+			}
+		case F_BTINT8CMP:
+			{
+				int64		a = DatumGetInt64(datum);
+				int64		b = DatumGetInt64(scankey->sk_argument);
+
+				return (a > b) - (a < b);
+			}
+		case F_BTOIDCMP:
+			{
+				Oid			a = DatumGetObjectId(datum);
+				Oid			b = DatumGetObjectId(scankey->sk_argument);
+
+				return (a > b) - (a < b);
+			}
+		case F_UUID_CMP:
+			return memcmp(DatumGetUUIDP(datum)->data,
+						  DatumGetUUIDP(scankey->sk_argument)->data,
+						  UUID_LEN);
+		default:
+			break;
+	}
+
+	return DatumGetInt32(FunctionCall2Coll(&scankey->sk_func,
+										   scankey->sk_collation,
+										   datum,
+										   scankey->sk_argument));
+}
+
 /*----------
  *	_bt_compare() -- Compare insertion-type scankey to tuple on a page.
  *
@@ -730,10 +782,7 @@ _bt_compare(Relation rel,
 			 * to flip the sign of the comparison result.  (Unless it's a DESC
 			 * column, in which case we *don't* flip the sign.)
 			 */
-			result = DatumGetInt32(FunctionCall2Coll(&scankey->sk_func,
-													 scankey->sk_collation,
-													 datum,
-													 scankey->sk_argument));
+			result = _bt_call_comparator(scankey, datum);
 
 			if (!(scankey->sk_flags & SK_BT_DESC))
 				INVERT_COMPARE_RESULT(result);
@@ -2473,6 +2522,151 @@ _bt_endpoint(IndexScanDesc scan, ScanDirection dir)
 	return true;
 }
 
+/*
+ *	_bt_skip_find_prefix() -- Find the next value of the first index column
+ *		for a skip scan.
+ *
+ * If the skip scan has no prefix yet, this finds the first (for a backward
+ * scan, the last) value in the index; otherwise the first value after (resp.
+ * before) so->skipPrefix.  Any index tuple will do, whether it is live or
+ * not and whether or not it matches the scan keys: the caller merely uses
+ * the value to set up the next primitive index scan.
+ *
+ * Returns false if there are no more values.  Otherwise the value, copied
+ * into so->skipContext, is returned in *prefix and *isnull, and the leaf page
+ * it was found on in *blkno.
+ */
+bool
+_bt_skip_find_prefix(IndexScanDesc scan, ScanDirection dir,
+					 Datum *prefix, bool *isnull, BlockNumber *blkno)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	TupleDesc	itupdesc = RelationGetDescr(rel);
+	Form_pg_attribute attr = TupleDescAttr(itupdesc, 0);
+	Buffer		buf;
+	Page		page;
+	BTPageOpaque opaque;
+	OffsetNumber offnum;
+	IndexTuple	itup;
+	Datum		datum;
+	MemoryContext oldcxt;
+
+	if (!so->skipHavePrefix)
+	{
+		buf = _bt_get_endpoint(rel, 0, ScanDirectionIsBackward(dir),
+							   scan->xs_snapshot);
+		if (!BufferIsValid(buf))
+		{
+			/* Empty index; see _bt_endpoint() */
+			PredicateLockRelation(rel, scan->xs_snapshot);
+			return false;
+		}
+		page = BufferGetPage(buf);
+		opaque = BTPageGetOpaque(page);
+		if (ScanDirectionIsForward(dir))
+			offnum = P_FIRSTDATAKEY(opaque);
+		else
+			offnum = PageGetMaxOffsetNumber(page);
+	}
+	else
+	{
+		BTScanInsertData inskey;
+		BTStack		stack;
+		int			flags;
+
+		/*
+		 * Build an insertion scankey on the first column.  For a forward scan
+		 * we want the first item > prefix (nextkey = true); for a backward
+		 * scan the last item < prefix, so we locate the first item >= prefix
+		 * and step back one.
+		 */
+		_bt_metaversion(rel, &inskey.heapkeyspace, &inskey.allequalimage);
+		inskey.anynullkeys = so->skipPrefixIsNull;
+		inskey.nextkey = ScanDirectionIsForward(dir);
+		inskey.pivotsearch = false;
+		inskey.scantid = NULL;
+		inskey.keysz = 1;
+
+		flags = rel->rd_indoption[0] << SK_BT_INDOPTION_SHIFT;
+		if (so->skipPrefixIsNull)
+			flags |= SK_ISNULL;
+		ScanKeyEntryInitializeWithInfo(&inskey.scankeys[0],
+									   flags,
+									   1,
+									   InvalidStrategy,
+									   InvalidOid,
+									   rel->rd_indcollation[0],
+									   index_getprocinfo(rel, 1, BTORDER_PROC),
+									   so->skipPrefix);
+
+		stack = _bt_search(rel, &inskey, &buf, BT_READ, scan->xs_snapshot);
+		_bt_freestack(stack);
+		if (!BufferIsValid(buf))
+		{
+			PredicateLockRelation(rel, scan->xs_snapshot);
+			return false;
+		}
+
+		offnum = _bt_binsrch(rel, &inskey, buf);
+		if (ScanDirectionIsBackward(dir))
+			offnum = OffsetNumberPrev(offnum);
+	}
+
+	/*
+	 * If the located item is past either end of the page, or the page is
+	 * dead, step to the neighbouring page in the scan direction until we find
+	 * an item.  This is the same as what _bt_steppage() would do.  Lock each
+	 * page we look at, since no new index tuple may appear between the
+	 * current prefix and the one we return without our noticing.
+	 */
+	for (;;)
+	{
+		page = BufferGetPage(buf);
+		TestForOldSnapshot(scan->xs_snapshot, rel, page);
+		opaque = BTPageGetOpaque(page);
+
+		if (!P_IGNORE(opaque))
+		{
+			PredicateLockPage(rel, BufferGetBlockNumber(buf), scan->xs_snapshot);
+			if (offnum >= P_FIRSTDATAKEY(opaque) &&
+				offnum <= PageGetMaxOffsetNumber(page))
+				break;
+		}
+
+		if (ScanDirectionIsForward(dir))
+		{
+			if (P_RIGHTMOST(opaque))
+			{
+				_bt_relbuf(rel, buf);
+				return false;
+			}
+			buf = _bt_relandgetbuf(rel, buf, opaque->btpo_next, BT_READ);
+			offnum = P_FIRSTDATAKEY(BTPageGetOpaque(BufferGetPage(buf)));
+		}
+		else
+		{
+			buf = _bt_walk_left(rel, buf, scan->xs_snapshot);
+			if (!BufferIsValid(buf))
+				return false;
+			offnum = PageGetMaxOffsetNumber(BufferGetPage(buf));
+		}
+	}
+
+	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+	datum = index_getattr(itup, 1, itupdesc, isnull);
+
+	oldcxt = MemoryContextSwitchTo(so->skipContext);
+	*prefix = *isnull ? (Datum) 0 :
+		datumCopy(datum, attr->attbyval, attr->attlen);
+	MemoryContextSwitchTo(oldcxt);
+
+	*blkno = BufferGetBlockNumber(buf);
+	_bt_relbuf(rel, buf);
+
+	return true;
+}
+
 /*
  * _bt_initialize_more_data() -- initialize moreLeft/moreRight appropriately
  * for scan direction
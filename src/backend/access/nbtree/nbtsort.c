@@ -53,6 +53,7 @@
 #include "access/xlog.h"
 #include "access/xloginsert.h"
 #include "catalog/index.h"
+#include "catalog/pg_control.h"
 #include "commands/progress.h"
 #include "executor/instrument.h"
 #include "miscadmin.h"
@@ -256,6 +257,9 @@ typedef struct BTWriteState
 	BlockNumber btws_pages_alloced; /* # pages allocated */
 	BlockNumber btws_pages_written; /* # pages written out */
 	Page		btws_zeropage;	/* workspace for filling zeroes */
+	int			btws_npending;	/* # completed pages not yet written out */
+	Page		btws_pending[XLR_MAX_BATCH_RECORDS];
+	BlockNumber btws_pending_blkno[XLR_MAX_BATCH_RECORDS];
 } BTWriteState;
 
 
@@ -268,6 +272,7 @@ static void _bt_leafbuild(BTSpool *btspool, BTSpool *btspool2);
 static void _bt_build_callback(Relation index, ItemPointer tid, Datum *values,
 							   bool *isnull, bool tupleIsAlive, void *state);
 static Page _bt_blnewpage(uint32 level);
+static void _bt_blflush(BTWriteState *wstate);
 static BTPageState *_bt_pagestate(BTWriteState *wstate, uint32 level);
 static void _bt_slideleft(Page rightmostpage);
 static void _bt_sortaddtup(Page page, Size itemsize,
@@ -575,6 +580,7 @@ _bt_leafbuild(BTSpool *btspool, BTSpool *btspool2)
 	wstate.btws_pages_alloced = BTREE_METAPAGE + 1;
 	wstate.btws_pages_written = 0;
 	wstate.btws_zeropage = NULL;	/* until needed */
+	wstate.btws_npending = 0;
 
 	pgstat_progress_update_param(PROGRESS_CREATEIDX_SUBPHASE,
 								 PROGRESS_BTREE_PHASE_LEAF_LOAD);
@@ -619,7 +625,7 @@ _bt_blnewpage(uint32 level)
 	Page		page;
 	BTPageOpaque opaque;
 
-	page = (Page) palloc(BLCKSZ);
+	page = (Page) palloc_aligned(BLCKSZ, PG_IO_ALIGN_SIZE, 0);
 
 	/* Zero the page and set up standard page header info */
 	_bt_pageinit(page, BLCKSZ);
@@ -639,56 +645,109 @@ _bt_blnewpage(uint32 level)
 
 /*
  * emit a completed btree page, and release the working storage.
+ *
+ * Pages are queued up and written out in batches by _bt_blflush(), so that
+ * their WAL records can be inserted together.
  */
 static void
 _bt_blwritepage(BTWriteState *wstate, Page page, BlockNumber blkno)
 {
+	wstate->btws_pending[wstate->btws_npending] = page;
+	wstate->btws_pending_blkno[wstate->btws_npending] = blkno;
+	wstate->btws_npending++;
+
+	if (wstate->btws_npending == XLR_MAX_BATCH_RECORDS)
+		_bt_blflush(wstate);
+}
+
+/*
+ * write out the pages queued by _bt_blwritepage().
+ */
+static void
+_bt_blflush(BTWriteState *wstate)
+{
+	XLogRecPtr	lsns[XLR_MAX_BATCH_RECORDS];
+	int			i;
+
+	if (wstate->btws_npending == 0)
+		return;
+
 	/* XLOG stuff */
 	if (wstate->btws_use_wal)
 	{
-		/* We use the XLOG_FPI record type for this */
-		log_newpage(&wstate->index->rd_locator, MAIN_FORKNUM, blkno, page, true);
+		/*
+		 * We use the XLOG_FPI record type for this, like log_newpage().  The
+		 * records always carry a full-page image, so they can all be inserted
+		 * in one go.
+		 */
+		XLogBeginBatch();
+		for (i = 0; i < wstate->btws_npending; i++)
+		{
+			XLogBeginInsert();
+			XLogRegisterBlock(0, &wstate->index->rd_locator, MAIN_FORKNUM,
+							  wstate->btws_pending_blkno[i],
+							  wstate->btws_pending[i],
+							  REGBUF_FORCE_IMAGE | REGBUF_STANDARD);
+			XLogBatchAdd(RM_XLOG_ID, XLOG_FPI);
+		}
+		XLogEndBatch(lsns);
+
+		for (i = 0; i < wstate->btws_npending; i++)
+		{
+			if (!PageIsNew(wstate->btws_pending[i]))
+				PageSetLSN(wstate->btws_pending[i], lsns[i]);
+		}
 	}
 
-	/*
-	 * If we have to write pages nonsequentially, fill in the space with
-	 * zeroes until we come back and overwrite.  This is not logically
-	 * necessary on standard Unix filesystems (unwritten space will read as
-	 * zeroes anyway), but it should help to avoid fragmentation. The dummy
-	 * pages aren't WAL-logged though.
-	 */
-	while (blkno > wstate->btws_pages_written)
+	for (i = 0; i < wstate->btws_npending; i++)
 	{
-		if (!wstate->btws_zeropage)
-			wstate->btws_zeropage = (Page) palloc0(BLCKSZ);
-		/* don't set checksum for all-zero page */
-		smgrextend(RelationGetSmgr(wstate->index), MAIN_FORKNUM,
-				   wstate->btws_pages_written++,
-				   wstate->btws_zeropage,
-				   true);
-	}
+		Page		page = wstate->btws_pending[i];
+		BlockNumber blkno = wstate->btws_pending_blkno[i];
 
-	PageSetChecksumInplace(page, blkno);
+		/*
+		 * If we have to write pages nonsequentially, fill in the space with
+		 * zeroes until we come back and overwrite.  This is not logically
+		 * necessary on standard Unix filesystems (unwritten space will read
+		 * as zeroes anyway), but it should help to avoid fragmentation. The
+		 * dummy pages aren't WAL-logged though.
+		 */
+		while (blkno > wstate->btws_pages_written)
+		{
+			if (!wstate->btws_zeropage)
+				wstate->btws_zeropage = (Page) palloc_aligned(BLCKSZ,
+															  PG_IO_ALIGN_SIZE,
+															  MCXT_ALLOC_ZERO);
+			/* don't set checksum for all-zero page */
+			smgrextend(RelationGetSmgr(wstate->index), MAIN_FORKNUM,
+					   wstate->btws_pages_written++,
+					   wstate->btws_zeropage,
+					   true);
+		}
 
-	/*
-	 * Now write the page.  There's no need for smgr to schedule an fsync for
-	 * this write; we'll do it ourselves before ending the build.
-	 */
-	if (blkno == wstate->btws_pages_written)
-	{
-		/* extending the file... */
-		smgrextend(RelationGetSmgr(wstate->index), MAIN_FORKNUM, blkno,
-				   page, true);
-		wstate->btws_pages_written++;
-	}
-	else
-	{
-		/* overwriting a block we zero-filled before */
-		smgrwrite(RelationGetSmgr(wstate->index), MAIN_FORKNUM, blkno,
-				  page, true);
+		PageSetChecksumInplace(page, blkno);
+
+		/*
+		 * Now write the page.  There's no need for smgr to schedule an fsync
+		 * for this write; we'll do it ourselves before ending the build.
+		 */
+		if (blkno == wstate->btws_pages_written)
+		{
+			/* extending the file... */
+			smgrextend(RelationGetSmgr(wstate->index), MAIN_FORKNUM, blkno,
+					   page, true);
+			wstate->btws_pages_written++;
+		}
+		else
+		{
+			/* overwriting a block we zero-filled before */
+			smgrwrite(RelationGetSmgr(wstate->index), MAIN_FORKNUM, blkno,
+					  page, true);
+		}
+
+		pfree(page);
 	}
 
-	pfree(page);
+	wstate->btws_npending = 0;
 }
 
 /*
@@ -1170,10 +1229,11 @@ _bt_uppershutdown(BTWriteState *wstate, BTPageState *state)
 	 * set to point to "P_NONE").  This changes the index to the "valid" state
 	 * by filling in a valid magic number in the metapage.
 	 */
-	metapage = (Page) palloc(BLCKSZ);
+	metapage = (Page) palloc_aligned(BLCKSZ, PG_IO_ALIGN_SIZE, 0);
 	_bt_initmetapage(metapage, rootblkno, rootlevel,
 					 wstate->inskey->allequalimage);
 	_bt_blwritepage(wstate, metapage, BTREE_METAPAGE);
+	_bt_blflush(wstate);
 }
 
 /*
@@ -1582,6 +1642,7 @@ _bt_begin_parallel(BTBuildState *buildstate, bool isconcurrent, int request)
 	sharedsort = (Sharedsort *) shm_toc_allocate(pcxt->toc, estsort);
 	tuplesort_initialize_shared(sharedsort, scantuplesortstates,
 								pcxt->seg);
+	tuplesort_use_partitioned_merge(sharedsort);
 
 	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BTREE_SHARED, btshared);
 	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT, sharedsort);
@@ -1599,6 +1660,7 @@ _bt_begin_parallel(BTBuildState *buildstate, bool isconcurrent, int request)
 		sharedsort2 = (Sharedsort *) shm_toc_allocate(pcxt->toc, estsort);
 		tuplesort_initialize_shared(sharedsort2, scantuplesortstates,
 									pcxt->seg);
+		tuplesort_use_partitioned_merge(sharedsort2);
 
 		shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT_SPOOL2, sharedsort2);
 	}
@@ -1647,15 +1709,22 @@ _bt_begin_parallel(BTBuildState *buildstate, bool isconcurrent, int request)
 	/* Save leader state now that it's clear build will be parallel */
 	buildstate->btleader = btleader;
 
-	/* Join heap scan ourselves */
-	if (leaderparticipates)
-		_bt_leader_participate_as_worker(buildstate);
-
 	/*
 	 * Caller needs to wait for all launched workers when we return.  Make
-	 * sure that the failure-to-start case will not hang forever.
+	 * sure that the failure-to-start case will not hang forever.  This must
+	 * happen before we know the number of participants for sure, and the
+	 * workers wait for that before sharing the final merge of their runs,
+	 * so do it before participating as a worker ourselves.
 	 */
 	WaitForParallelWorkersToAttach(pcxt);
+	tuplesort_set_participants(sharedsort, btleader->nparticipanttuplesorts);
+	if (sharedsort2)
+		tuplesort_set_participants(sharedsort2,
+								   btleader->nparticipanttuplesorts);
+
+	/* Join heap scan ourselves */
+	if (leaderparticipates)
+		_bt_leader_participate_as_worker(buildstate);
 }
 
 /*
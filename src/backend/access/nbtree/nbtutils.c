@@ -45,6 +45,8 @@ static int	_bt_sort_array_elements(IndexScanDesc scan, ScanKey skey,
 									bool reverse,
 									Datum *elems, int nelems);
 static int	_bt_compare_array_elements(const void *a, const void *b, void *arg);
+static void _bt_skip_set_prefix_key(IndexScanDesc scan);
+static void _bt_skip_free_prefix(IndexScanDesc scan);
 static bool _bt_compare_scankey_args(IndexScanDesc scan, ScanKey op,
 									 ScanKey leftarg, ScanKey rightarg,
 									 bool *result);
@@ -660,14 +662,348 @@ _bt_restore_array_keys(IndexScanDesc scan)
 	}
 }
 
+/*
+ *	_bt_preprocess_skip_scan() -- Set up a skip scan, if possible
+ *
+ * When there are no scan keys on the first index column, but there are some
+ * on the second, a plain scan has to read the whole index.  Instead, we can
+ * perform one primitive index scan per distinct value ("prefix") of the
+ * first column, as if the scan keys included "col1 = prefix": then the keys
+ * on the second column become required, and each primitive scan only visits
+ * the part of the index that can contain matches.  _bt_skip_find_prefix()
+ * finds the next prefix with a fresh descent of the tree.  This pays off when
+ * the first column has few distinct values.
+ *
+ * Here we decide whether the scan qualifies, and if so prepare
+ * so->skipKeyData, which holds the prefix key followed by a copy of
+ * scan->keyData.  We don't bother with array keys, row comparisons or
+ * parallel scans; those scans just run as before.
+ */
+void
+_bt_preprocess_skip_scan(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	int			numberOfKeys = scan->numberOfKeys;
+	static const StrategyNumber strategies[] = {
+		BTEqualStrategyNumber,
+		BTGreaterEqualStrategyNumber,
+		BTLessEqualStrategyNumber
+	};
+	Oid			oprs[lengthof(strategies)];
+	MemoryContext oldContext;
+	int			i;
+
+	so->skipKeyData = NULL;
+	so->skipHavePrefix = false;
+	so->markSkipHavePrefix = false;
+
+	if (so->numArrayKeys != 0 || scan->parallel_scan != NULL ||
+		numberOfKeys < 1 || IndexRelationGetNumberOfKeyAttributes(rel) < 2)
+		return;
+
+	/* Keys are ordered by attribute, so this means none are on column 1 */
+	if (scan->keyData[0].sk_attno != 2)
+		return;
+
+	for (i = 0; i < numberOfKeys; i++)
+	{
+		if (scan->keyData[i].sk_flags & SK_ROW_HEADER)
+			return;
+	}
+
+	for (i = 0; i < lengthof(strategies); i++)
+	{
+		oprs[i] = get_opfamily_member(rel->rd_opfamily[0],
+									  rel->rd_opcintype[0],
+									  rel->rd_opcintype[0],
+									  strategies[i]);
+		if (!OidIsValid(oprs[i]))
+			return;
+	}
+
+	if (so->skipContext == NULL)
+		so->skipContext = AllocSetContextCreate(CurrentMemoryContext,
+												"BTree skip scan context",
+												ALLOCSET_SMALL_SIZES);
+	else
+		MemoryContextReset(so->skipContext);
+
+	oldContext = MemoryContextSwitchTo(so->skipContext);
+
+	so->skipKeyData = (ScanKey) palloc((numberOfKeys + 1) * sizeof(ScanKeyData));
+	memcpy(so->skipKeyData + 1,
+		   scan->keyData,
+		   numberOfKeys * sizeof(ScanKeyData));
+
+	so->skipProcs = (FmgrInfo *) palloc(lengthof(strategies) * sizeof(FmgrInfo));
+	for (i = 0; i < lengthof(strategies); i++)
+		fmgr_info_cxt(get_opcode(oprs[i]), &so->skipProcs[i], so->skipContext);
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+/*
+ * _bt_skip_set_prefix_key() -- Fill in the prefix key of a skip scan
+ *
+ * Normally this is "col1 = prefix", or "col1 IS NULL".  Once the scan has
+ * given up on skipping, it is ">=" (or "<=") instead, so that everything from
+ * the prefix on is covered in the scan direction.
+ */
+static void
+_bt_skip_set_prefix_key(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	ScanKey		skey = &so->skipKeyData[0];
+	MemoryContext oldContext;
+
+	oldContext = MemoryContextSwitchTo(so->skipContext);
+
+	if (so->skipPrefixIsNull)
+	{
+		Assert(so->skipRangeDir == NoMovementScanDirection);
+		ScanKeyEntryInitializeWithInfo(skey,
+									   SK_ISNULL | SK_SEARCHNULL,
+									   1,
+									   InvalidStrategy,
+									   InvalidOid,
+									   InvalidOid,
+									   &so->skipProcs[0],
+									   (Datum) 0);
+	}
+	else
+	{
+		StrategyNumber strategy;
+		FmgrInfo   *proc;
+
+		if (so->skipRangeDir == NoMovementScanDirection)
+		{
+			strategy = BTEqualStrategyNumber;
+			proc = &so->skipProcs[0];
+		}
+		else if (ScanDirectionIsForward(so->skipRangeDir) ==
+				 !(rel->rd_indoption[0] & INDOPTION_DESC))
+		{
+			strategy = BTGreaterEqualStrategyNumber;
+			proc = &so->skipProcs[1];
+		}
+		else
+		{
+			strategy = BTLessEqualStrategyNumber;
+			proc = &so->skipProcs[2];
+		}
+
+		ScanKeyEntryInitializeWithInfo(skey,
+									   0,
+									   1,
+									   strategy,
+									   InvalidOid,
+									   rel->rd_indcollation[0],
+									   proc,
+									   so->skipPrefix);
+	}
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+/*
+ * _bt_skip_free_prefix() -- Release the current prefix value, if any
+ */
+static void
+_bt_skip_free_prefix(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(scan->indexRelation), 0);
+
+	if (so->skipHavePrefix && !so->skipPrefixIsNull && !attr->attbyval)
+		pfree(DatumGetPointer(so->skipPrefix));
+	so->skipHavePrefix = false;
+}
+
+/*
+ * _bt_start_skip_scan() -- Find the first prefix of a skip scan
+ *
+ * Returns false if the index is empty.
+ */
+bool
+_bt_start_skip_scan(IndexScanDesc scan, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+
+	_bt_skip_free_prefix(scan);
+	so->skipRangeDir = NoMovementScanDirection;
+	so->skipPrefixBlock = InvalidBlockNumber;
+	so->skipUseful = 0;
+	so->skipUseless = 0;
+
+	return _bt_advance_skip_scan(scan, dir);
+}
+
+/*
+ * _bt_advance_skip_scan() -- Advance to the next prefix of a skip scan
+ *
+ * Returns true if there is another prefix to consider, false if not.  On
+ * true result, the prefix key is set up for the next primitive index scan.
+ */
+bool
+_bt_advance_skip_scan(IndexScanDesc scan, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	bool		nullsfirst = (scan->indexRelation->rd_indoption[0] & INDOPTION_NULLS_FIRST) != 0;
+	Datum		prefix;
+	bool		isnull;
+	BlockNumber blkno;
+
+	if (so->skipRangeDir == dir)
+	{
+		/*
+		 * The range scan has covered all non-null values from the prefix on.
+		 * A ">=" key doesn't match NULLs though, so if they come later in
+		 * the scan direction, we still have to visit them.
+		 */
+		if (ScanDirectionIsForward(dir) == nullsfirst)
+			return false;
+
+		_bt_skip_free_prefix(scan);
+		so->skipRangeDir = NoMovementScanDirection;
+		so->skipHavePrefix = true;
+		so->skipPrefix = (Datum) 0;
+		so->skipPrefixIsNull = true;
+		_bt_skip_set_prefix_key(scan);
+		return true;
+	}
+
+	/*
+	 * If a range scan has reached its start again because the scan changed
+	 * direction, resume skipping from there.
+	 */
+	so->skipRangeDir = NoMovementScanDirection;
+
+	if (!_bt_skip_find_prefix(scan, dir, &prefix, &isnull, &blkno))
+		return false;
+
+	if (so->skipHavePrefix)
+	{
+		if (blkno == so->skipPrefixBlock)
+			so->skipUseless++;
+		else
+			so->skipUseful++;
+	}
+
+	_bt_skip_free_prefix(scan);
+	so->skipHavePrefix = true;
+	so->skipPrefix = prefix;
+	so->skipPrefixIsNull = isnull;
+	so->skipPrefixBlock = blkno;
+
+	/*
+	 * If most prefixes are found on the same leaf page as the previous one,
+	 * the groups of tuples sharing a prefix are too small for skipping to
+	 * save any page reads, and the extra descents are pure overhead.  In that
+	 * case, give up and scan everything from this prefix on in one go.  (We
+	 * consider NULLs separately; see above.)
+	 */
+	if (!isnull && so->skipUseless >= BT_SKIP_MIN_USELESS &&
+		so->skipUseless > so->skipUseful)
+		so->skipRangeDir = dir;
+
+	_bt_skip_set_prefix_key(scan);
+
+	return true;
+}
+
+/*
+ * _bt_mark_skip_scan() -- Handle a skip scan during btmarkpos
+ *
+ * Save the current prefix key as the "mark" position.
+ */
+void
+_bt_mark_skip_scan(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(scan->indexRelation), 0);
+	ScanKey		mkey = &so->markSkipKey;
+
+	if (so->markSkipHavePrefix && !(mkey->sk_flags & SK_ISNULL) &&
+		!attr->attbyval)
+		pfree(DatumGetPointer(mkey->sk_argument));
+
+	so->markSkipHavePrefix = so->skipHavePrefix;
+	so->markSkipRangeDir = so->skipRangeDir;
+	if (!so->skipHavePrefix)
+		return;
+
+	memcpy(mkey, &so->skipKeyData[0], sizeof(ScanKeyData));
+	if (!so->skipPrefixIsNull)
+	{
+		MemoryContext oldContext = MemoryContextSwitchTo(so->skipContext);
+
+		mkey->sk_argument = datumCopy(so->skipPrefix, attr->attbyval,
+									  attr->attlen);
+		MemoryContextSwitchTo(oldContext);
+	}
+}
+
+/*
+ * _bt_restore_skip_scan() -- Handle a skip scan during btrestrpos
+ *
+ * Restore the prefix key to what it was when the mark was set.
+ */
+void
+_bt_restore_skip_scan(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(scan->indexRelation), 0);
+	ScanKey		mkey = &so->markSkipKey;
+	bool		markisnull;
+	MemoryContext oldContext;
+
+	/*
+	 * If the mark was set before the scan started, so is the restored
+	 * position, and btgettuple will start the skip scan over.
+	 */
+	if (!so->markSkipHavePrefix)
+	{
+		_bt_skip_free_prefix(scan);
+		return;
+	}
+
+	markisnull = (mkey->sk_flags & SK_ISNULL) != 0;
+	if (so->skipHavePrefix && so->skipRangeDir == so->markSkipRangeDir &&
+		so->skipPrefixIsNull == markisnull &&
+		(markisnull ||
+		 datumIsEqual(so->skipPrefix, mkey->sk_argument,
+					  attr->attbyval, attr->attlen)))
+		return;
+
+	_bt_skip_free_prefix(scan);
+	oldContext = MemoryContextSwitchTo(so->skipContext);
+	so->skipHavePrefix = true;
+	so->skipRangeDir = so->markSkipRangeDir;
+	so->skipPrefixIsNull = markisnull;
+	so->skipPrefix = markisnull ? (Datum) 0 :
+		datumCopy(mkey->sk_argument, attr->attbyval, attr->attlen);
+	so->skipPrefixBlock = InvalidBlockNumber;
+	MemoryContextSwitchTo(oldContext);
+
+	memcpy(&so->skipKeyData[0], mkey, sizeof(ScanKeyData));
+	so->skipKeyData[0].sk_argument = so->skipPrefix;
+
+	/* As in _bt_restore_array_keys, redo the preprocessing */
+	_bt_preprocess_keys(scan);
+	Assert(so->qual_ok);
+}
+
 
 /*
  *	_bt_preprocess_keys() -- Preprocess scan keys
  *
- * The given search-type keys (in scan->keyData[] or so->arrayKeyData[])
- * are copied to so->keyData[] with possible transformation.
- * scan->numberOfKeys is the number of input keys, so->numberOfKeys gets
- * the number of output keys (possibly less, never greater).
+ * The given search-type keys (in scan->keyData[], so->arrayKeyData[] or
+ * so->skipKeyData[]) are copied to so->keyData[] with possible
+ * transformation.  scan->numberOfKeys is the number of input keys (plus one
+ * for a skip scan's prefix key), so->numberOfKeys gets the number of output
+ * keys (possibly less, never greater).
  *
  * The output keys are marked with additional sk_flags bits beyond the
  * system-standard bits supplied by the caller.  The DESC and NULLS_FIRST
@@ -770,10 +1106,17 @@ _bt_preprocess_keys(IndexScanDesc scan)
 		return;					/* done if qual-less scan */
 
 	/*
-	 * Read so->arrayKeyData if array keys are present, else scan->keyData
+	 * Read so->arrayKeyData if array keys are present, or so->skipKeyData
+	 * (which has an extra key in front) for a skip scan, else scan->keyData
 	 */
 	if (so->arrayKeyData != NULL)
 		inkeys = so->arrayKeyData;
+	else if (so->skipKeyData != NULL)
+	{
+		Assert(so->skipHavePrefix);
+		inkeys = so->skipKeyData;
+		numberOfKeys++;
+	}
 	else
 		inkeys = scan->keyData;
 
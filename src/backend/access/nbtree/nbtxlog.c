@@ -249,6 +249,39 @@ btree_xlog_insert(bool isleaf, bool ismeta, bool posting,
 		_bt_restore_meta(record, 2);
 }
 
+static void
+btree_xlog_insert_multi(XLogReaderState *record)
+{
+	XLogRecPtr	lsn = record->EndRecPtr;
+	xl_btree_insert_multi *xlrec = (xl_btree_insert_multi *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	if (XLogReadBufferForRedo(record, 0, &buffer) == BLK_NEEDS_REDO)
+	{
+		OffsetNumber *offsets;
+		char	   *datapos = XLogRecGetBlockData(record, 0, NULL);
+
+		offsets = (OffsetNumber *) ((char *) xlrec + SizeOfBtreeInsertMulti);
+		page = BufferGetPage(buffer);
+
+		for (int i = 0; i < xlrec->ntuples; i++)
+		{
+			Size		itemsz = MAXALIGN(IndexTupleSize((IndexTuple) datapos));
+
+			if (PageAddItem(page, (Item) datapos, itemsz, offsets[i],
+							false, false) == InvalidOffsetNumber)
+				elog(PANIC, "failed to add new item");
+			datapos += itemsz;
+		}
+
+		PageSetLSN(page, lsn);
+		MarkBufferDirty(buffer);
+	}
+	if (BufferIsValid(buffer))
+		UnlockReleaseBuffer(buffer);
+}
+
 static void
 btree_xlog_split(bool newitemonleft, XLogReaderState *record)
 {
@@ -1037,6 +1070,9 @@ btree_redo(XLogReaderState *record)
 		case XLOG_BTREE_INSERT_POST:
 			btree_xlog_insert(true, false, true, record);
 			break;
+		case XLOG_BTREE_INSERT_MULTI:
+			btree_xlog_insert_multi(record);
+			break;
 		case XLOG_BTREE_DEDUP:
 			btree_xlog_dedup(record);
 			break;
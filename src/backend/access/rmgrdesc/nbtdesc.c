@@ -34,6 +34,13 @@ btree_desc(StringInfo buf, XLogReaderState *record)
 				appendStringInfo(buf, "off %u", xlrec->offnum);
 				break;
 			}
+		case XLOG_BTREE_INSERT_MULTI:
+			{
+				xl_btree_insert_multi *xlrec = (xl_btree_insert_multi *) rec;
+
+				appendStringInfo(buf, "ntuples %u", xlrec->ntuples);
+				break;
+			}
 		case XLOG_BTREE_SPLIT_L:
 		case XLOG_BTREE_SPLIT_R:
 			{
@@ -146,6 +153,9 @@ btree_identify(uint8 info)
 		case XLOG_BTREE_INSERT_POST:
 			id = "INSERT_POST";
 			break;
+		case XLOG_BTREE_INSERT_MULTI:
+			id = "INSERT_MULTI";
+			break;
 		case XLOG_BTREE_DEDUP:
 			id = "DEDUP";
 			break;
@@ -148,6 +148,13 @@ xlog_desc(StringInfo buf, XLogReaderState *record)
 						 LSN_FORMAT_ARGS(xlrec.overwritten_lsn),
 						 timestamptz_to_str(xlrec.overwrite_time));
 	}
+	else if (info == XLOG_CHECKSUMS)
+	{
+		xl_checksum_state xlrec;
+
+		memcpy(&xlrec, rec, sizeof(xl_checksum_state));
+		appendStringInfo(buf, "version %u", xlrec.new_checksumtype);
+	}
 }
 
 const char *
@@ -190,6 +197,9 @@ xlog_identify(uint8 info)
 		case XLOG_OVERWRITE_CONTRECORD:
 			id = "OVERWRITE_CONTRECORD";
 			break;
+		case XLOG_CHECKSUMS:
+			id = "CHECKSUMS";
+			break;
 		case XLOG_FPI:
 			id = "FPI";
 			break;
@@ -47,6 +47,7 @@
 /* GUC variables */
 char	   *default_table_access_method = DEFAULT_TABLE_ACCESS_METHOD;
 bool		synchronize_seqscans = true;
+int			seqscan_prefetch_depth = 0;
 
 
 /* ----------------------------------------------------------------------------
@@ -345,7 +346,7 @@ void
 simple_table_tuple_update(Relation rel, ItemPointer otid,
 						  TupleTableSlot *slot,
 						  Snapshot snapshot,
-						  bool *update_indexes)
+						  TU_UpdateIndexes *update_indexes)
 {
 	TM_Result	result;
 	TM_FailureData tmfd;
@@ -562,6 +563,8 @@ table_block_parallelscan_nextpage(Relation rel,
 	}
 	else
 	{
+		uint64		shared_nallocated;
+
 		/*
 		 * When we've only got PARALLEL_SEQSCAN_RAMPDOWN_CHUNKS chunks
 		 * remaining in the scan, we half the chunk size.  Since we reduce the
@@ -569,10 +572,19 @@ table_block_parallelscan_nextpage(Relation rel,
 		 * PARALLEL_SEQSCAN_RAMPDOWN_CHUNKS at the new size.  After a few
 		 * iterations of this, we'll end up doing the last few blocks with the
 		 * chunk size set to 1.
+		 *
+		 * We judge the remaining work by the shared counter rather than by
+		 * where our own previous chunk was, and keep halving until the chunk
+		 * size fits it.  A worker that spent a long time on its previous
+		 * chunk (say, because its rows were expensive to process) may find
+		 * that the other workers have since consumed most of the relation,
+		 * and it mustn't then grab a large share of what's left, leaving the
+		 * others idle while it alone finishes the scan.
 		 */
-		if (pbscanwork->phsw_chunk_size > 1 &&
-			pbscanwork->phsw_nallocated > pbscan->phs_nblocks -
-			(pbscanwork->phsw_chunk_size * PARALLEL_SEQSCAN_RAMPDOWN_CHUNKS))
+		shared_nallocated = pg_atomic_read_u64(&pbscan->phs_nallocated);
+		while (pbscanwork->phsw_chunk_size > 1 &&
+			   shared_nallocated > pbscan->phs_nblocks -
+			   (pbscanwork->phsw_chunk_size * PARALLEL_SEQSCAN_RAMPDOWN_CHUNKS))
 			pbscanwork->phsw_chunk_size >>= 1;
 
 		nallocated = pbscanwork->phsw_nallocated =
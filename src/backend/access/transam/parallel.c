@@ -14,6 +14,10 @@
 
 #include "postgres.h"
 
+#include "access/brin.h"
+#include "access/gin.h"
+#include "access/gist_private.h"
+#include "access/hash.h"
 #include "access/nbtree.h"
 #include "access/parallel.h"
 #include "access/session.h"
@@ -24,6 +28,7 @@
 #include "catalog/pg_enum.h"
 #include "catalog/storage.h"
 #include "commands/async.h"
+#include "commands/copy.h"
 #include "commands/vacuum.h"
 #include "executor/execParallel.h"
 #include "libpq/libpq.h"
@@ -144,8 +149,26 @@ static const struct
 	{
 		"_bt_parallel_build_main", _bt_parallel_build_main
 	},
+	{
+		"_brin_parallel_build_main", _brin_parallel_build_main
+	},
+	{
+		"_gin_parallel_build_main", _gin_parallel_build_main
+	},
+	{
+		"_hash_parallel_build_main", _hash_parallel_build_main
+	},
+	{
+		"_gist_parallel_build_main", _gist_parallel_build_main
+	},
 	{
 		"parallel_vacuum_main", parallel_vacuum_main
+	},
+	{
+		"ParallelCopyMain", ParallelCopyMain
+	},
+	{
+		"ParallelCopyToMain", ParallelCopyToMain
 	}
 };
 
@@ -551,8 +574,9 @@ LaunchParallelWorkers(ParallelContext *pcxt)
 {
 	MemoryContext oldcontext;
 	BackgroundWorker worker;
+	BackgroundWorker *workers;
+	BackgroundWorkerHandle **handles;
 	int			i;
-	bool		any_registrations_failed = false;
 
 	/* Skip this if we have no workers. */
 	if (pcxt->nworkers == 0 || pcxt->nworkers_to_launch == 0)
@@ -582,43 +606,51 @@ LaunchParallelWorkers(ParallelContext *pcxt)
 	worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(pcxt->seg));
 	worker.bgw_notify_pid = MyProcPid;
 
+	/* Each worker differs only in its worker number. */
+	workers = palloc(sizeof(BackgroundWorker) * pcxt->nworkers_to_launch);
+	handles = palloc(sizeof(BackgroundWorkerHandle *) * pcxt->nworkers_to_launch);
+	for (i = 0; i < pcxt->nworkers_to_launch; ++i)
+	{
+		workers[i] = worker;
+		memcpy(workers[i].bgw_extra, &i, sizeof(int));
+	}
+
 	/*
-	 * Start workers.
+	 * Start workers.  Registering them all at once lets the postmaster launch
+	 * them together, rather than being woken up once per worker.
 	 *
 	 * The caller must be able to tolerate ending up with fewer workers than
 	 * expected, so there is no need to throw an error here if registration
 	 * fails.  It wouldn't help much anyway, because registering the worker in
 	 * no way guarantees that it will start up and initialize successfully.
 	 */
+	pcxt->nworkers_launched =
+		RegisterDynamicBackgroundWorkers(workers, pcxt->nworkers_to_launch,
+										 handles);
+
 	for (i = 0; i < pcxt->nworkers_to_launch; ++i)
 	{
-		memcpy(worker.bgw_extra, &i, sizeof(int));
-		if (!any_registrations_failed &&
-			RegisterDynamicBackgroundWorker(&worker,
-											&pcxt->worker[i].bgwhandle))
-		{
+		pcxt->worker[i].bgwhandle = handles[i];
+		if (i < pcxt->nworkers_launched)
 			shm_mq_set_handle(pcxt->worker[i].error_mqh,
 							  pcxt->worker[i].bgwhandle);
-			pcxt->nworkers_launched++;
-		}
 		else
 		{
 			/*
 			 * If we weren't able to register the worker, then we've bumped up
-			 * against the max_worker_processes limit, and future
-			 * registrations will probably fail too, so arrange to skip them.
-			 * But we still have to execute this code for the remaining slots
-			 * to make sure that we forget about the error queues we budgeted
-			 * for those workers.  Otherwise, we'll wait for them to start,
-			 * but they never will.
+			 * against the max_worker_processes limit.  We still have to
+			 * forget about the error queues we budgeted for the remaining
+			 * workers.  Otherwise, we'll wait for them to start, but they
+			 * never will.
 			 */
-			any_registrations_failed = true;
-			pcxt->worker[i].bgwhandle = NULL;
 			shm_mq_detach(pcxt->worker[i].error_mqh);
 			pcxt->worker[i].error_mqh = NULL;
 		}
 	}
 
+	pfree(workers);
+	pfree(handles);
+
 	/*
 	 * Now that nworkers_launched has taken its final value, we can initialize
 	 * known_attached_workers.
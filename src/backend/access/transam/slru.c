@@ -7,11 +7,17 @@
  * buffers.  Under ordinary circumstances we expect that write
  * traffic will occur mostly to the latest page (and to the just-prior
  * page, soon after a page transition).  Read traffic will probably touch
- * a larger span of pages, but in any case a fairly small number of page
- * buffers should be sufficient.  So, we just search the buffers using plain
- * linear search; there's no need for a hashtable or anything fancy.
- * The management algorithm is straight LRU except that we will never swap
- * out the latest page (since we know it's going to be hit again eventually).
+ * a larger span of pages, but workloads with long-running transactions or
+ * many subtransactions or multixacts can need a lot more buffers than usual,
+ * so the size of each SLRU is configurable.
+ *
+ * To keep lookups cheap however large the pool is, the buffers are divided
+ * into banks of SLRU_BANK_SIZE slots, and a given page can only ever be
+ * stored in the bank selected by its page number.  Within a bank, we just
+ * search the buffers using plain linear search; there's no need for a
+ * hashtable or anything fancy.  The management algorithm is LRU within the
+ * bank, except that we will never swap out the latest page (since we know
+ * it's going to be hit again eventually).
  *
  * We use a control LWLock to protect the shared data structures, plus
  * per-buffer LWLocks that synchronize I/O for each buffer.  The control lock
@@ -59,6 +65,7 @@
 #include "pgstat.h"
 #include "storage/fd.h"
 #include "storage/shmem.h"
+#include "utils/guc.h"
 
 #define SlruFileName(ctl, path, seg) \
 	snprintf(path, MAXPGPATH, "%s/%04X", (ctl)->Dir, seg)
@@ -144,6 +151,16 @@ static bool SlruPhysicalWritePage(SlruCtl ctl, int pageno, int slotno,
 static void SlruReportIOError(SlruCtl ctl, int pageno, TransactionId xid);
 static int	SlruSelectLRUPage(SlruCtl ctl, int pageno);
 
+/*
+ * Range of slots [*start, *end) of the bank that page 'pageno' belongs to.
+ */
+#define SlruBankRange(shared, pageno, start, end) \
+	do { \
+		int		_bank_size = (shared)->num_slots / (shared)->num_banks; \
+		*(start) = ((pageno) % (shared)->num_banks) * _bank_size; \
+		*(end) = *(start) + _bank_size; \
+	} while (0)
+
 static bool SlruScanDirCbDeleteCutoff(SlruCtl ctl, char *filename,
 									  int segpage, void *data);
 static void SlruInternalDeleteSegment(SlruCtl ctl, int segno);
@@ -152,6 +169,39 @@ static void SlruInternalDeleteSegment(SlruCtl ctl, int segno);
  * Initialization of shared memory
  */
 
+/*
+ * Helper function for the GUC check hooks of SLRU buffer settings.
+ *
+ * The number of buffers must be a multiple of SLRU_BANK_SIZE, so that all
+ * banks are of the same size.
+ */
+bool
+check_slru_buffers(const char *name, int *newval)
+{
+	/* Valid values are multiples of SLRU_BANK_SIZE */
+	if (*newval % SLRU_BANK_SIZE == 0)
+		return true;
+
+	GUC_check_errdetail("\"%s\" must be a multiple of %d.", name,
+						SLRU_BANK_SIZE);
+	return false;
+}
+
+/*
+ * Pick the number of buffers for an SLRU whose size is auto-tuned: 1/divisor
+ * of shared_buffers, rounded down to a multiple of SLRU_BANK_SIZE, but at
+ * least one bank and not more than 'max'.
+ */
+int
+SimpleLruAutotuneBuffers(int divisor, int max)
+{
+	int			nbuffers = NBuffers / divisor;
+
+	nbuffers -= nbuffers % SLRU_BANK_SIZE;
+
+	return Min(max - (max % SLRU_BANK_SIZE), Max(SLRU_BANK_SIZE, nbuffers));
+}
+
 Size
 SimpleLruShmemSize(int nslots, int nlsns)
 {
@@ -212,6 +262,15 @@ SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 		shared->num_slots = nslots;
 		shared->lsn_groups_per_page = nlsns;
 
+		/*
+		 * The callers' settings are multiples of SLRU_BANK_SIZE, but cope
+		 * with anything else by using a single bank.
+		 */
+		if (nslots % SLRU_BANK_SIZE == 0)
+			shared->num_banks = nslots / SLRU_BANK_SIZE;
+		else
+			shared->num_banks = 1;
+
 		shared->cur_lru_count = 0;
 
 		/* shared->latest_page_number will be set later */
@@ -497,12 +556,16 @@ SimpleLruReadPage_ReadOnly(SlruCtl ctl, int pageno, TransactionId xid)
 {
 	SlruShared	shared = ctl->shared;
 	int			slotno;
+	int			bankstart;
+	int			bankend;
+
+	SlruBankRange(shared, pageno, &bankstart, &bankend);
 
 	/* Try to find the page while holding only shared lock */
 	LWLockAcquire(shared->ControlLock, LW_SHARED);
 
 	/* See if page is already in a buffer */
-	for (slotno = 0; slotno < shared->num_slots; slotno++)
+	for (slotno = bankstart; slotno < bankend; slotno++)
 	{
 		if (shared->page_number[slotno] == pageno &&
 			shared->page_status[slotno] != SLRU_PAGE_EMPTY &&
@@ -1017,6 +1080,11 @@ static int
 SlruSelectLRUPage(SlruCtl ctl, int pageno)
 {
 	SlruShared	shared = ctl->shared;
+	int			bankstart;
+	int			bankend;
+
+	/* The page can only live in its own bank, so only look there */
+	SlruBankRange(shared, pageno, &bankstart, &bankend);
 
 	/* Outer loop handles restart after I/O */
 	for (;;)
@@ -1031,7 +1099,7 @@ SlruSelectLRUPage(SlruCtl ctl, int pageno)
 		int			best_invalid_page_number = 0;	/* keep compiler quiet */
 
 		/* See if page already has a buffer assigned */
-		for (slotno = 0; slotno < shared->num_slots; slotno++)
+		for (slotno = bankstart; slotno < bankend; slotno++)
 		{
 			if (shared->page_number[slotno] == pageno &&
 				shared->page_status[slotno] != SLRU_PAGE_EMPTY)
@@ -1066,7 +1134,7 @@ SlruSelectLRUPage(SlruCtl ctl, int pageno)
 		 * multiple pages with the same lru_count.
 		 */
 		cur_count = (shared->cur_lru_count)++;
-		for (slotno = 0; slotno < shared->num_slots; slotno++)
+		for (slotno = bankstart; slotno < bankend; slotno++)
 		{
 			int			this_delta;
 			int			this_page_number;
@@ -31,7 +31,10 @@
 #include "access/slru.h"
 #include "access/subtrans.h"
 #include "access/transam.h"
+#include "access/xlog.h"
+#include "miscadmin.h"
 #include "pg_trace.h"
+#include "utils/guc_hooks.h"
 #include "utils/snapmgr.h"
 
 
@@ -54,6 +57,34 @@
 #define TransactionIdToPage(xid) ((xid) / (TransactionId) SUBTRANS_XACTS_PER_PAGE)
 #define TransactionIdToEntry(xid) ((xid) % (TransactionId) SUBTRANS_XACTS_PER_PAGE)
 
+/*
+ * Backend-local cache of the results of SubTransGetTopmostTransaction().
+ *
+ * Once a snapshot has overflowed, every visibility check on an XID that is
+ * not older than the snapshot's xmin has to look up the topmost parent in
+ * pg_subtrans, and a scan typically asks about the same few XIDs over and
+ * over again.  This small direct-mapped cache avoids most of those trips to
+ * the SLRU and its lock.
+ *
+ * The parent of an XID never changes once it has been set, but the answer
+ * also depends on TransactionXmin, so the cache is only valid for the
+ * TransactionXmin it was filled for.  That also protects us from XID
+ * wraparound, since nothing newer than TransactionXmin can be recycled while
+ * we hold it.  During recovery, the parent of a subtransaction is only set
+ * when its assignment record is replayed, possibly after the XID was first
+ * looked up, so we don't use the cache then.
+ */
+#define SUBTRANS_CACHE_SIZE 512
+
+typedef struct SubTransCacheEntry
+{
+	TransactionId xid;
+	TransactionId topxid;
+} SubTransCacheEntry;
+
+static SubTransCacheEntry SubTransCache[SUBTRANS_CACHE_SIZE];
+static TransactionId SubTransCacheXmin = InvalidTransactionId;
+
 
 /*
  * Link to shared-memory data structures for SUBTRANS control
@@ -151,10 +182,24 @@ SubTransGetTopmostTransaction(TransactionId xid)
 {
 	TransactionId parentXid = xid,
 				previousXid = xid;
+	SubTransCacheEntry *entry = NULL;
 
 	/* Can't ask about stuff that might not be around anymore */
 	Assert(TransactionIdFollowsOrEquals(xid, TransactionXmin));
 
+	if (!RecoveryInProgress())
+	{
+		if (!TransactionIdEquals(SubTransCacheXmin, TransactionXmin))
+		{
+			memset(SubTransCache, 0, sizeof(SubTransCache));
+			SubTransCacheXmin = TransactionXmin;
+		}
+
+		entry = &SubTransCache[xid % SUBTRANS_CACHE_SIZE];
+		if (TransactionIdEquals(entry->xid, xid))
+			return entry->topxid;
+	}
+
 	while (TransactionIdIsValid(parentXid))
 	{
 		previousXid = parentXid;
@@ -174,29 +219,79 @@ SubTransGetTopmostTransaction(TransactionId xid)
 
 	Assert(TransactionIdIsValid(previousXid));
 
+	if (entry != NULL)
+	{
+		entry->xid = xid;
+		entry->topxid = previousXid;
+	}
+
 	return previousXid;
 }
 
 
+/*
+ * Number of shared SUBTRANS buffers.
+ *
+ * If subtransaction_buffers is 0, the same logic as for CLOG is used; see
+ * CLOGShmemBuffers.
+ */
+static int
+SUBTRANSShmemBuffers(void)
+{
+	if (subtransaction_buffers == 0)
+		return SimpleLruAutotuneBuffers(512, 1024);
+	return subtransaction_buffers;
+}
+
 /*
  * Initialization of shared memory for SUBTRANS
  */
 Size
 SUBTRANSShmemSize(void)
 {
-	return SimpleLruShmemSize(NUM_SUBTRANS_BUFFERS, 0);
+	return SimpleLruShmemSize(SUBTRANSShmemBuffers(), 0);
 }
 
 void
 SUBTRANSShmemInit(void)
 {
+	/* If auto-tuning is requested, now is the time to do it */
+	if (subtransaction_buffers == 0)
+	{
+		char		buf[32];
+
+		snprintf(buf, sizeof(buf), "%d", SUBTRANSShmemBuffers());
+		SetConfigOption("subtransaction_buffers", buf, PGC_POSTMASTER,
+						PGC_S_DYNAMIC_DEFAULT);
+
+		/*
+		 * We prefer to report this value's source as PGC_S_DYNAMIC_DEFAULT.
+		 * However, if the DBA explicitly set subtransaction_buffers = 0 in the config
+		 * file, then PGC_S_DYNAMIC_DEFAULT will fail to override that and we
+		 * must force the matter with PGC_S_OVERRIDE.
+		 */
+		if (subtransaction_buffers == 0)	/* failed to apply it? */
+			SetConfigOption("subtransaction_buffers", buf, PGC_POSTMASTER,
+							PGC_S_OVERRIDE);
+	}
+	Assert(subtransaction_buffers != 0);
+
 	SubTransCtl->PagePrecedes = SubTransPagePrecedes;
-	SimpleLruInit(SubTransCtl, "Subtrans", NUM_SUBTRANS_BUFFERS, 0,
+	SimpleLruInit(SubTransCtl, "Subtrans", SUBTRANSShmemBuffers(), 0,
 				  SubtransSLRULock, "pg_subtrans",
 				  LWTRANCHE_SUBTRANS_BUFFER, SYNC_HANDLER_NONE);
 	SlruPagePrecedesUnitTests(SubTransCtl, SUBTRANS_XACTS_PER_PAGE);
 }
 
+/*
+ * GUC check_hook for subtransaction_buffers
+ */
+bool
+check_subtrans_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("subtransaction_buffers", newval);
+}
+
 /*
  * This func must be called ONCE on system install.  It creates
  * the initial SUBTRANS segment.  (The SUBTRANS directory is assumed to
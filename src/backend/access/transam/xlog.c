@@ -93,6 +93,7 @@
 #include "storage/predicate.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
+#include "storage/procsignal.h"
 #include "storage/reinit.h"
 #include "storage/smgr.h"
 #include "storage/spin.h"
@@ -146,11 +147,13 @@ bool		XLOG_DEBUG = false;
 int			wal_segment_size = DEFAULT_XLOG_SEG_SIZE;
 
 /*
- * Number of WAL insertion locks to use. A higher value allows more insertions
- * to happen concurrently, but adds some CPU overhead to flushing the WAL,
- * which needs to iterate all the locks.
+ * Number of WAL insertion locks to use (the wal_insert_locks GUC). A higher
+ * value allows more insertions to happen concurrently, but adds some CPU
+ * overhead to flushing the WAL, which needs to iterate all the locks, and to
+ * operations that need to hold all of them.  The maximum is limited by the
+ * number of LWLocks that a process can hold at once.
  */
-#define NUM_XLOGINSERT_LOCKS  8
+int			NumXLogInsertLocks = 8;
 
 /*
  * Max distance from last checkpoint, before triggering a new xlog-based
@@ -495,13 +498,22 @@ typedef struct XLogCtlData
 	 */
 	XLogRecPtr	InitializedUpTo;
 
+	/*
+	 * All WAL insertions before this point are known to have finished.  This
+	 * is advanced by WaitXLogInsertionsToFinish(), so that a later call for an
+	 * older position can return without scanning the insertion locks.  It
+	 * may lag behind; it's only a hint.
+	 */
+	pg_atomic_uint64 insertFinishedUpto;
+
 	/*
 	 * These values do not change after startup, although the pointed-to pages
-	 * and xlblocks values certainly do.  xlblocks values are protected by
-	 * WALBufMappingLock.
+	 * and xlblocks values certainly do.  xlblocks values are changed while
+	 * holding WALBufMappingLock, but can be read without it; see
+	 * XLogReadFromBuffers().
 	 */
 	char	   *pages;			/* buffers for unwritten XLOG pages */
-	XLogRecPtr *xlblocks;		/* 1st byte ptr-s + XLOG_BLCKSZ */
+	pg_atomic_uint64 *xlblocks; /* 1st byte ptr-s + XLOG_BLCKSZ */
 	int			XLogCacheBlck;	/* highest allocated xlog buffer index */
 
 	/*
@@ -569,6 +581,16 @@ static WALInsertLockPadded *WALInsertLocks = NULL;
  */
 static ControlFileData *ControlFile = NULL;
 
+/*
+ * This process's view of ControlFile->data_checksum_version.  The shared
+ * value can change while the server is running, see SetDataChecksumVersion().
+ * Every process uses its local copy when deciding whether to compute or
+ * verify page checksums, and updates it only when it absorbs the
+ * PROCSIGNAL_BARRIER_CHECKSUM barrier, so that its decisions stay consistent
+ * between two CHECK_FOR_INTERRUPTS() calls.
+ */
+static uint32 LocalDataChecksumVersion = 0;
+
 /*
  * Calculate the amount of space left on the page after 'endptr'. Beware
  * multiple evaluation!
@@ -687,6 +709,8 @@ static void ReserveXLogInsertLocation(int size, XLogRecPtr *StartPos,
 									  XLogRecPtr *EndPos, XLogRecPtr *PrevPtr);
 static bool ReserveXLogSwitch(XLogRecPtr *StartPos, XLogRecPtr *EndPos,
 							  XLogRecPtr *PrevPtr);
+static uint64 ReserveXLogInsertBatch(uint64 size, uint64 lastoff,
+									 XLogRecPtr *PrevPtr);
 static XLogRecPtr WaitXLogInsertionsToFinish(XLogRecPtr upto);
 static char *GetXLogBuffer(XLogRecPtr ptr, TimeLineID tli);
 static XLogRecPtr XLogBytePosToRecPtr(uint64 bytepos);
@@ -777,7 +801,7 @@ XLogInsertRecord(XLogRecData *rdata,
 	 * inserter acquires an insertion lock. In addition to just indicating that
 	 * an insertion is in progress, the lock tells others how far the inserter
 	 * has progressed. There is a small fixed number of insertion locks,
-	 * determined by NUM_XLOGINSERT_LOCKS. When an inserter crosses a page
+	 * determined by wal_insert_locks. When an inserter crosses a page
 	 * boundary, it updates the value stored in the lock to the how far it has
 	 * inserted, to allow the previous buffer to be flushed.
 	 *
@@ -1026,6 +1050,157 @@ XLogInsertRecord(XLogRecData *rdata,
 	return EndPos;
 }
 
+/*
+ * Insert a batch of XLOG records, using a single WAL insertion lock
+ * acquisition and a single reservation of WAL space for all of them.
+ *
+ * 'records' is an array of 'nrecords' complete records, each one in a single
+ * contiguous MAXALIGNed chunk of memory.  As with XLogInsertRecord, the
+ * record headers must be filled in, except for xl_prev and the header part
+ * of xl_crc.  'flags' gives the XLogSetRecordFlags() flags of each record.
+ *
+ * Unlike XLogInsertRecord, the records are not rechecked against RedoRecPtr
+ * and doPageWrites, and are always inserted.  The caller must only batch
+ * records whose contents cannot depend on those, ie. records where every
+ * registered page either was included as a full-page image or was excluded
+ * from backup explicitly (see XLogBatchAdd()).  XLOG_SWITCH records cannot
+ * be batched.
+ *
+ * 'num_fpi' and 'topxid_included' are the totals over the whole batch.
+ * The end position of each record is returned in EndPtrs[].
+ */
+void
+XLogInsertRecordBatch(int nrecords, XLogRecord **records, const uint8 *flags,
+					  int num_fpi, bool topxid_included, XLogRecPtr *EndPtrs)
+{
+	XLogCtlInsert *Insert = &XLogCtl->Insert;
+	uint64		offsets[XLR_MAX_BATCH_RECORDS];
+	uint64		size = 0;
+	uint64		startbytepos;
+	uint64		total_len = 0;
+	XLogRecPtr	PrevPtr;
+	XLogRecPtr	FirstPos = InvalidXLogRecPtr;
+	XLogRecPtr	StartPos = InvalidXLogRecPtr;
+	XLogRecPtr	EndPos = InvalidXLogRecPtr;
+	XLogRecPtr	lastImportant = InvalidXLogRecPtr;
+	TimeLineID	insertTLI;
+	int			i;
+
+	Assert(nrecords > 0 && nrecords <= XLR_MAX_BATCH_RECORDS);
+
+	/* cross-check on whether we should be here or not */
+	if (!XLogInsertAllowed())
+		elog(ERROR, "cannot make new WAL entries during recovery");
+
+	insertTLI = XLogCtl->InsertTimeLineID;
+
+	/*
+	 * Compute the offset of each record from the start of the reserved
+	 * space, in "usable" bytes.  This matches the per-record calculation in
+	 * ReserveXLogInsertLocation.
+	 */
+	for (i = 0; i < nrecords; i++)
+	{
+		XLogRecord *rechdr = records[i];
+
+		Assert(rechdr->xl_tot_len > SizeOfXLogRecord);
+		Assert(!(rechdr->xl_rmid == RM_XLOG_ID &&
+				 (rechdr->xl_info & ~XLR_INFO_MASK) == XLOG_SWITCH));
+
+		offsets[i] = size;
+		size += MAXALIGN(rechdr->xl_tot_len);
+		total_len += rechdr->xl_tot_len;
+	}
+
+	START_CRIT_SECTION();
+	WALInsertLockAcquire();
+
+	/*
+	 * Keep our local copies of RedoRecPtr and doPageWrites up to date.  The
+	 * records don't depend on them, so there's no need to recompute anything
+	 * if they changed.
+	 */
+	if (RedoRecPtr != Insert->RedoRecPtr)
+	{
+		Assert(RedoRecPtr < Insert->RedoRecPtr);
+		RedoRecPtr = Insert->RedoRecPtr;
+	}
+	doPageWrites = (Insert->fullPageWrites || Insert->runningBackups > 0);
+
+	startbytepos = ReserveXLogInsertBatch(size, offsets[nrecords - 1],
+										  &PrevPtr);
+
+	for (i = 0; i < nrecords; i++)
+	{
+		XLogRecord *rechdr = records[i];
+		XLogRecData rdata;
+		pg_crc32c	rdata_crc;
+
+		StartPos = XLogBytePosToRecPtr(startbytepos + offsets[i]);
+		EndPos = XLogBytePosToEndRecPtr(startbytepos + offsets[i] +
+										MAXALIGN(rechdr->xl_tot_len));
+		if (i == 0)
+			FirstPos = StartPos;
+
+		/* Chain the records together, and finish the CRC */
+		rechdr->xl_prev = PrevPtr;
+		rdata_crc = rechdr->xl_crc;
+		COMP_CRC32C(rdata_crc, rechdr, offsetof(XLogRecord, xl_crc));
+		FIN_CRC32C(rdata_crc);
+		rechdr->xl_crc = rdata_crc;
+
+		rdata.next = NULL;
+		rdata.data = (char *) rechdr;
+		rdata.len = rechdr->xl_tot_len;
+		CopyXLogRecordToWAL(rechdr->xl_tot_len, false, &rdata,
+							StartPos, EndPos, insertTLI);
+
+		if ((flags[i] & XLOG_MARK_UNIMPORTANT) == 0)
+			lastImportant = StartPos;
+
+		EndPtrs[i] = EndPos;
+		PrevPtr = StartPos;
+	}
+
+	if (lastImportant != InvalidXLogRecPtr)
+	{
+		int			lockno = holdingAllLocks ? 0 : MyLockNo;
+
+		WALInsertLocks[lockno].l.lastImportantAt = lastImportant;
+	}
+
+	WALInsertLockRelease();
+
+	END_CRIT_SECTION();
+
+	MarkCurrentTransactionIdLoggedIfAny();
+	if (topxid_included)
+		MarkSubxactTopXidLogged();
+
+	/*
+	 * Update shared LogwrtRqst.Write, if we crossed page boundary.
+	 */
+	if (FirstPos / XLOG_BLCKSZ != EndPos / XLOG_BLCKSZ)
+	{
+		SpinLockAcquire(&XLogCtl->info_lck);
+		if (XLogCtl->LogwrtRqst.Write < EndPos)
+			XLogCtl->LogwrtRqst.Write = EndPos;
+		LogwrtResult = XLogCtl->LogwrtResult;
+		SpinLockRelease(&XLogCtl->info_lck);
+	}
+
+	/*
+	 * Update our global variables, as XLogInsertRecord does for the last
+	 * record.
+	 */
+	ProcLastRecPtr = StartPos;
+	XactLastRecEnd = EndPos;
+
+	pgWalUsage.wal_bytes += total_len;
+	pgWalUsage.wal_records += nrecords;
+	pgWalUsage.wal_fpi += num_fpi;
+}
+
 /*
  * Reserves the right amount of space for a record of given size from the WAL.
  * *StartPos is set to the beginning of the reserved section, *EndPos to
@@ -1087,6 +1262,40 @@ ReserveXLogInsertLocation(int size, XLogRecPtr *StartPos, XLogRecPtr *EndPos,
 	Assert(XLogRecPtrToBytePos(*PrevPtr) == prevbytepos);
 }
 
+/*
+ * Like ReserveXLogInsertLocation(), but reserves space for a batch of
+ * records taking 'size' usable bytes in total (each record already
+ * MAXALIGNed).  'lastoff' is the offset of the last record in the batch,
+ * which becomes the previous record of the next insertion.
+ *
+ * Returns the usable byte position of the start of the reserved space.
+ * *PrevPtr is set to the beginning of the record preceding the batch.
+ */
+static uint64
+ReserveXLogInsertBatch(uint64 size, uint64 lastoff, XLogRecPtr *PrevPtr)
+{
+	XLogCtlInsert *Insert = &XLogCtl->Insert;
+	uint64		startbytepos;
+	uint64		prevbytepos;
+
+	Assert(lastoff < size);
+
+	SpinLockAcquire(&Insert->insertpos_lck);
+
+	startbytepos = Insert->CurrBytePos;
+	prevbytepos = Insert->PrevBytePos;
+	Insert->CurrBytePos = startbytepos + size;
+	Insert->PrevBytePos = startbytepos + lastoff;
+
+	SpinLockRelease(&Insert->insertpos_lck);
+
+	*PrevPtr = XLogBytePosToRecPtr(prevbytepos);
+
+	Assert(XLogRecPtrToBytePos(*PrevPtr) == prevbytepos);
+
+	return startbytepos;
+}
+
 /*
  * Like ReserveXLogInsertLocation(), but for an xlog-switch record.
  *
@@ -1320,7 +1529,7 @@ WALInsertLockAcquire(void)
 	static int	lockToTry = -1;
 
 	if (lockToTry == -1)
-		lockToTry = MyProc->pgprocno % NUM_XLOGINSERT_LOCKS;
+		lockToTry = MyProc->pgprocno % NumXLogInsertLocks;
 	MyLockNo = lockToTry;
 
 	/*
@@ -1338,7 +1547,7 @@ WALInsertLockAcquire(void)
 		 * than locks, it still helps to distribute the inserters evenly
 		 * across the locks.
 		 */
-		lockToTry = (lockToTry + 1) % NUM_XLOGINSERT_LOCKS;
+		lockToTry = (lockToTry + 1) % NumXLogInsertLocks;
 	}
 }
 
@@ -1356,7 +1565,7 @@ WALInsertLockAcquireExclusive(void)
 	 * indicator is set to 0xFFFFFFFFFFFFFFFF, which is higher than any real
 	 * XLogRecPtr value, to make sure that no-one blocks waiting on those.
 	 */
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS - 1; i++)
+	for (i = 0; i < NumXLogInsertLocks - 1; i++)
 	{
 		LWLockAcquire(&WALInsertLocks[i].l.lock, LW_EXCLUSIVE);
 		LWLockUpdateVar(&WALInsertLocks[i].l.lock,
@@ -1382,7 +1591,7 @@ WALInsertLockRelease(void)
 	{
 		int			i;
 
-		for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+		for (i = 0; i < NumXLogInsertLocks; i++)
 			LWLockReleaseClearVar(&WALInsertLocks[i].l.lock,
 								  &WALInsertLocks[i].l.insertingAt,
 								  0);
@@ -1410,8 +1619,8 @@ WALInsertLockUpdateInsertingAt(XLogRecPtr insertingAt)
 		 * We use the last lock to mark our actual position, see comments in
 		 * WALInsertLockAcquireExclusive.
 		 */
-		LWLockUpdateVar(&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.lock,
-						&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.insertingAt,
+		LWLockUpdateVar(&WALInsertLocks[NumXLogInsertLocks - 1].l.lock,
+						&WALInsertLocks[NumXLogInsertLocks - 1].l.insertingAt,
 						insertingAt);
 	}
 	else
@@ -1446,6 +1655,15 @@ WaitXLogInsertionsToFinish(XLogRecPtr upto)
 	if (MyProc == NULL)
 		elog(PANIC, "cannot wait without a PGPROC structure");
 
+	/*
+	 * Quick exit if a previous call already saw all insertions up to 'upto'
+	 * finished.  This is common when many backends flush at the same time,
+	 * as they all wait for roughly the same position.
+	 */
+	finishedUpto = pg_atomic_read_u64(&XLogCtl->insertFinishedUpto);
+	if (upto <= finishedUpto)
+		return finishedUpto;
+
 	/* Read the current insert position */
 	SpinLockAcquire(&Insert->insertpos_lck);
 	bytepos = Insert->CurrBytePos;
@@ -1478,7 +1696,7 @@ WaitXLogInsertionsToFinish(XLogRecPtr upto)
 	 * out for any insertion that's still in progress.
 	 */
 	finishedUpto = reservedUpto;
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < NumXLogInsertLocks; i++)
 	{
 		XLogRecPtr	insertingat = InvalidXLogRecPtr;
 
@@ -1514,6 +1732,19 @@ WaitXLogInsertionsToFinish(XLogRecPtr upto)
 		if (insertingat != InvalidXLogRecPtr && insertingat < finishedUpto)
 			finishedUpto = insertingat;
 	}
+
+	/* Advance the shared hint, unless someone else moved it further */
+	{
+		uint64		oldval = pg_atomic_read_u64(&XLogCtl->insertFinishedUpto);
+
+		while (oldval < finishedUpto)
+		{
+			if (pg_atomic_compare_exchange_u64(&XLogCtl->insertFinishedUpto,
+											   &oldval, finishedUpto))
+				break;
+		}
+	}
+
 	return finishedUpto;
 }
 
@@ -1567,20 +1798,17 @@ GetXLogBuffer(XLogRecPtr ptr, TimeLineID tli)
 	 * out to disk and evicted, and the caller is responsible for making sure
 	 * that doesn't happen.
 	 *
-	 * However, we don't hold a lock while we read the value. If someone has
-	 * just initialized the page, it's possible that we get a "torn read" of
-	 * the XLogRecPtr if 64-bit fetches are not atomic on this platform. In
-	 * that case we will see a bogus value. That's ok, we'll grab the mapping
-	 * lock (in AdvanceXLInsertBuffer) and retry if we see anything else than
-	 * the page we're looking for. But it means that when we do this unlocked
-	 * read, we might see a value that appears to be ahead of the page we're
-	 * looking for. Don't PANIC on that, until we've verified the value while
-	 * holding the lock.
+	 * However, we don't hold a lock while we read the value. If someone is
+	 * just initializing the page, we might see an invalid value, or one that
+	 * appears to be ahead of the page we're looking for.  That's ok, we'll
+	 * grab the mapping lock (in AdvanceXLInsertBuffer) and retry if we see
+	 * anything else than the page we're looking for.  Don't PANIC on that,
+	 * until we've verified the value while holding the lock.
 	 */
 	expectedEndPtr = ptr;
 	expectedEndPtr += XLOG_BLCKSZ - ptr % XLOG_BLCKSZ;
 
-	endptr = XLogCtl->xlblocks[idx];
+	endptr = pg_atomic_read_u64(&XLogCtl->xlblocks[idx]);
 	if (expectedEndPtr != endptr)
 	{
 		XLogRecPtr	initializedUpto;
@@ -1611,7 +1839,7 @@ GetXLogBuffer(XLogRecPtr ptr, TimeLineID tli)
 		WALInsertLockUpdateInsertingAt(initializedUpto);
 
 		AdvanceXLInsertBuffer(ptr, tli, false);
-		endptr = XLogCtl->xlblocks[idx];
+		endptr = pg_atomic_read_u64(&XLogCtl->xlblocks[idx]);
 
 		if (expectedEndPtr != endptr)
 			elog(PANIC, "could not find WAL buffer for %X/%X",
@@ -1639,6 +1867,68 @@ GetXLogBuffer(XLogRecPtr ptr, TimeLineID tli)
 	return cachedPos + ptr % XLOG_BLCKSZ;
 }
 
+/*
+ * Read WAL from the WAL buffers, if it's still there.
+ *
+ * Copies up to 'count' bytes of WAL starting at 'startptr' on timeline 'tli'
+ * into 'buf', and returns the number of bytes copied.  That can be less than
+ * 'count', or zero, if some of the requested pages have already been replaced
+ * in the buffers; the caller must read the rest from the WAL files.  The
+ * requested WAL must have been written out already, so that nobody is still
+ * inserting into it.
+ *
+ * This doesn't take any locks.  A page's xlblocks entry is set to
+ * InvalidXLogRecPtr before the buffer is reused, so we check it both before
+ * and after copying the page, and stop if it didn't hold the page we wanted
+ * throughout.
+ */
+Size
+XLogReadFromBuffers(char *buf, XLogRecPtr startptr, Size count,
+					TimeLineID tli)
+{
+	XLogRecPtr	ptr = startptr;
+	Size		nbytes = count;
+	char	   *dst = buf;
+
+	if (RecoveryInProgress() || tli != GetWALInsertionTimeLine())
+		return 0;
+
+	Assert(!XLogRecPtrIsInvalid(startptr));
+
+	while (nbytes > 0)
+	{
+		int			idx = XLogRecPtrToBufIdx(ptr);
+		XLogRecPtr	expectedEndPtr;
+		XLogRecPtr	endptr;
+		Size		offset = ptr % XLOG_BLCKSZ;
+		Size		npagebytes = Min(nbytes, XLOG_BLCKSZ - offset);
+
+		expectedEndPtr = ptr + (XLOG_BLCKSZ - offset);
+
+		endptr = pg_atomic_read_u64(&XLogCtl->xlblocks[idx]);
+		if (endptr != expectedEndPtr)
+			break;
+
+		/* Don't read the page before we've checked that it's the right one */
+		pg_read_barrier();
+
+		memcpy(dst, XLogCtl->pages + idx * (Size) XLOG_BLCKSZ + offset,
+			   npagebytes);
+
+		/* Check that the page wasn't replaced while we were copying it */
+		pg_read_barrier();
+		endptr = pg_atomic_read_u64(&XLogCtl->xlblocks[idx]);
+		if (endptr != expectedEndPtr)
+			break;
+
+		ptr += npagebytes;
+		dst += npagebytes;
+		nbytes -= npagebytes;
+	}
+
+	return count - nbytes;
+}
+
 /*
  * Converts a "usable byte position" to XLogRecPtr. A usable byte position
  * is the position starting from the beginning of WAL, excluding all WAL
@@ -1798,7 +2088,7 @@ AdvanceXLInsertBuffer(XLogRecPtr upto, TimeLineID tli, bool opportunistic)
 		 * be zero if the buffer hasn't been used yet).  Fall through if it's
 		 * already written out.
 		 */
-		OldPageRqstPtr = XLogCtl->xlblocks[nextidx];
+		OldPageRqstPtr = pg_atomic_read_u64(&XLogCtl->xlblocks[nextidx]);
 		if (LogwrtResult.Write < OldPageRqstPtr)
 		{
 			/*
@@ -1867,6 +2157,14 @@ AdvanceXLInsertBuffer(XLogRecPtr upto, TimeLineID tli, bool opportunistic)
 
 		NewPage = (XLogPageHeader) (XLogCtl->pages + nextidx * (Size) XLOG_BLCKSZ);
 
+		/*
+		 * Mark the buffer as not holding any page while we reinitialize it,
+		 * so that XLogReadFromBuffers() doesn't mistake its contents for the
+		 * old page.
+		 */
+		pg_atomic_write_u64(&XLogCtl->xlblocks[nextidx], InvalidXLogRecPtr);
+		pg_write_barrier();
+
 		/*
 		 * Be sure to re-zero the buffer so that bytes beyond what we've
 		 * written will look like zeroes and not valid XLOG records...
@@ -1920,7 +2218,7 @@ AdvanceXLInsertBuffer(XLogRecPtr upto, TimeLineID tli, bool opportunistic)
 		 */
 		pg_write_barrier();
 
-		*((volatile XLogRecPtr *) &XLogCtl->xlblocks[nextidx]) = NewPageEndPtr;
+		pg_atomic_write_u64(&XLogCtl->xlblocks[nextidx], NewPageEndPtr);
 
 		XLogCtl->InitializedUpTo = NewPageEndPtr;
 
@@ -2108,7 +2406,7 @@ XLogWrite(XLogwrtRqst WriteRqst, TimeLineID tli, bool flexible)
 		 * if we're passed a bogus WriteRqst.Write that is past the end of the
 		 * last page that's been initialized by AdvanceXLInsertBuffer.
 		 */
-		XLogRecPtr	EndPtr = XLogCtl->xlblocks[curridx];
+		XLogRecPtr	EndPtr = pg_atomic_read_u64(&XLogCtl->xlblocks[curridx]);
 
 		if (LogwrtResult.Write >= EndPtr)
 			elog(PANIC, "xlog write request %X/%X is past end of log %X/%X",
@@ -2572,7 +2870,11 @@ XLogFlush(XLogRecPtr record)
 
 		/* done already? */
 		if (record <= LogwrtResult.Flush)
+		{
+			/* someone else flushed it for us */
+			PendingWalStats.wal_sync_grouped++;
 			break;
+		}
 
 		/*
 		 * Before actually performing the write, wait for all in-flight
@@ -2602,6 +2904,7 @@ XLogFlush(XLogRecPtr record)
 		if (record <= LogwrtResult.Flush)
 		{
 			LWLockRelease(WALWriteLock);
+			PendingWalStats.wal_sync_grouped++;
 			break;
 		}
 
@@ -2926,6 +3229,7 @@ XLogFileInitInternal(XLogSegNo logsegno, TimeLineID logtli,
 	XLogSegNo	installed_segno;
 	XLogSegNo	max_segno;
 	int			fd;
+	int			flags;
 	int			save_errno;
 
 	Assert(logtli != 0);
@@ -2961,7 +3265,10 @@ XLogFileInitInternal(XLogSegNo logsegno, TimeLineID logtli,
 	unlink(tmppath);
 
 	/* do not use get_sync_bit() here --- want to fsync only at end of fill */
-	fd = BasicOpenFile(tmppath, O_RDWR | O_CREAT | O_EXCL | PG_BINARY);
+	flags = O_RDWR | O_CREAT | O_EXCL | PG_BINARY;
+	if (io_direct_flags & IO_DIRECT_WAL_INIT)
+		flags |= PG_O_DIRECT;
+	fd = BasicOpenFile(tmppath, flags);
 	if (fd < 0)
 		ereport(ERROR,
 				(errcode_for_file_access(),
@@ -2991,10 +3298,17 @@ XLogFileInitInternal(XLogSegNo logsegno, TimeLineID logtli,
 	{
 		/*
 		 * Otherwise, seeking to the end and writing a solitary byte is
-		 * enough.
+		 * enough.  Direct I/O can't write a single byte, so write the whole
+		 * last page instead.
 		 */
 		errno = 0;
-		if (pg_pwrite(fd, "\0", 1, wal_segment_size - 1) != 1)
+		if (io_direct_flags & IO_DIRECT_WAL_INIT)
+		{
+			if (pg_pwrite_zeros(fd, XLOG_BLCKSZ,
+								wal_segment_size - XLOG_BLCKSZ) < 0)
+				save_errno = errno ? errno : ENOSPC;
+		}
+		else if (pg_pwrite(fd, "\0", 1, wal_segment_size - 1) != 1)
 		{
 			/* if write didn't set errno, assume no disk space */
 			save_errno = errno ? errno : ENOSPC;
@@ -3352,10 +3666,11 @@ XLogFileClose(void)
 	 * WAL segment files will not be re-read in normal operation, so we advise
 	 * the OS to release any cached pages.  But do not do so if WAL archiving
 	 * or streaming is active, because archiver and walsender process could
-	 * use the cache to read the WAL segment.
+	 * use the cache to read the WAL segment.  With direct I/O, there's
+	 * nothing cached to release.
 	 */
 #if defined(USE_POSIX_FADVISE) && defined(POSIX_FADV_DONTNEED)
-	if (!XLogIsNeeded())
+	if (!XLogIsNeeded() && (io_direct_flags & IO_DIRECT_WAL) == 0)
 		(void) posix_fadvise(openLogFile, 0, 0, POSIX_FADV_DONTNEED);
 #endif
 
@@ -4156,7 +4471,8 @@ ReadControlFile(void)
 	CalculateCheckpointSegments();
 
 	/* Make the initdb settings visible as GUC variables, too */
-	SetConfigOption("data_checksums", DataChecksumsEnabled() ? "yes" : "no",
+	SetConfigOption("data_checksums",
+					ControlFile->data_checksum_version > 0 ? "yes" : "no",
 					PGC_INTERNAL, PGC_S_DYNAMIC_DEFAULT);
 }
 
@@ -4192,12 +4508,123 @@ GetMockAuthenticationNonce(void)
 
 /*
  * Are checksums enabled for data pages?
+ *
+ * This is true both when checksums are fully enabled, and while they are
+ * being enabled or disabled online: in both cases every page written out
+ * must carry a valid checksum.
  */
 bool
 DataChecksumsEnabled(void)
 {
-	Assert(ControlFile != NULL);
-	return (ControlFile->data_checksum_version > 0);
+	return (LocalDataChecksumVersion > 0);
+}
+
+/*
+ * Should the checksums of data pages be verified when they are read?
+ *
+ * Unlike DataChecksumsEnabled(), this is false while checksums are being
+ * enabled or disabled online, since pages without a valid checksum may
+ * still exist.
+ */
+bool
+DataChecksumsNeedVerify(void)
+{
+	return (LocalDataChecksumVersion == PG_DATA_CHECKSUM_VERSION);
+}
+
+/*
+ * Returns the current cluster-wide data checksum version, which may be
+ * newer than the view of this process.
+ */
+uint32
+GetDataChecksumVersion(void)
+{
+	uint32		version;
+
+	LWLockAcquire(ControlFileLock, LW_SHARED);
+	version = ControlFile->data_checksum_version;
+	LWLockRelease(ControlFileLock);
+
+	return version;
+}
+
+/*
+ * Initialize this process's view of the data checksum version.
+ *
+ * This must be called after the process has joined the ProcSignal array,
+ * so that any later change of the shared value is signaled to us.
+ */
+void
+InitLocalDataChecksumVersion(void)
+{
+	LocalDataChecksumVersion = GetDataChecksumVersion();
+}
+
+/*
+ * Absorb a PROCSIGNAL_BARRIER_CHECKSUM barrier.
+ */
+bool
+ProcessBarrierChecksumState(void)
+{
+	InitLocalDataChecksumVersion();
+	return true;
+}
+
+/*
+ * Change the data checksum version of a running cluster.
+ *
+ * The change is WAL-logged, so that standbys and crash recovery follow it,
+ * and written to the control file.  The PROCSIGNAL_BARRIER_CHECKSUM barrier
+ * is then used to wait until every process has switched to the new version.
+ *
+ * Going directly between "off" and "on" is not safe, since processes
+ * switch at slightly different times: callers must always go through
+ * PG_DATA_CHECKSUM_INPROGRESS_VERSION, in which checksums are written
+ * but not verified.
+ */
+void
+SetDataChecksumVersion(uint32 version)
+{
+	xl_checksum_state xlrec;
+	XLogRecPtr	recptr;
+
+	Assert(!RecoveryInProgress());
+
+	xlrec.new_checksumtype = version;
+
+	/*
+	 * Prevent a checkpoint from starting between the insertion of the WAL
+	 * record and the update of the control file.  Otherwise a crash right
+	 * afterwards could leave neither the record to replay nor the new value.
+	 */
+	START_CRIT_SECTION();
+	MyProc->delayChkptFlags |= DELAY_CHKPT_START;
+
+	XLogBeginInsert();
+	XLogRegisterData((char *) &xlrec, sizeof(xl_checksum_state));
+	recptr = XLogInsert(RM_XLOG_ID, XLOG_CHECKSUMS);
+	XLogFlush(recptr);
+
+	LWLockAcquire(ControlFileLock, LW_EXCLUSIVE);
+	ControlFile->data_checksum_version = version;
+	UpdateControlFile();
+	LWLockRelease(ControlFileLock);
+
+	MyProc->delayChkptFlags &= ~DELAY_CHKPT_START;
+	END_CRIT_SECTION();
+
+	WaitForProcSignalBarrier(EmitProcSignalBarrier(PROCSIGNAL_BARRIER_CHECKSUM));
+}
+
+/*
+ * GUC show_hook for data_checksums
+ */
+const char *
+show_data_checksums(void)
+{
+	if (LocalDataChecksumVersion == PG_DATA_CHECKSUM_INPROGRESS_VERSION)
+		return "inprogress";
+	return DataChecksumsEnabled() ? "on" : "off";
 }
 
 /*
@@ -4503,9 +4930,9 @@ XLOGShmemSize(void)
 	size = sizeof(XLogCtlData);
 
 	/* WAL insertion locks, plus alignment */
-	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), NUM_XLOGINSERT_LOCKS + 1));
+	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), NumXLogInsertLocks + 1));
 	/* xlblocks array */
-	size = add_size(size, mul_size(sizeof(XLogRecPtr), XLOGbuffers));
+	size = add_size(size, mul_size(sizeof(pg_atomic_uint64), XLOGbuffers));
 	/* extra alignment padding for XLOG I/O buffers */
 	size = add_size(size, XLOG_BLCKSZ);
 	/* and the buffers themselves */
@@ -4583,9 +5010,10 @@ XLOGShmemInit(void)
 	 * needed here.
 	 */
 	allocptr = ((char *) XLogCtl) + sizeof(XLogCtlData);
-	XLogCtl->xlblocks = (XLogRecPtr *) allocptr;
-	memset(XLogCtl->xlblocks, 0, sizeof(XLogRecPtr) * XLOGbuffers);
-	allocptr += sizeof(XLogRecPtr) * XLOGbuffers;
+	XLogCtl->xlblocks = (pg_atomic_uint64 *) allocptr;
+	for (i = 0; i < XLOGbuffers; i++)
+		pg_atomic_init_u64(&XLogCtl->xlblocks[i], InvalidXLogRecPtr);
+	allocptr += sizeof(pg_atomic_uint64) * XLOGbuffers;
 
 
 	/* WAL insertion locks. Ensure they're aligned to the full padded size */
@@ -4593,9 +5021,9 @@ XLOGShmemInit(void)
 		((uintptr_t) allocptr) % sizeof(WALInsertLockPadded);
 	WALInsertLocks = XLogCtl->Insert.WALInsertLocks =
 		(WALInsertLockPadded *) allocptr;
-	allocptr += sizeof(WALInsertLockPadded) * NUM_XLOGINSERT_LOCKS;
+	allocptr += sizeof(WALInsertLockPadded) * NumXLogInsertLocks;
 
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < NumXLogInsertLocks; i++)
 	{
 		LWLockInitialize(&WALInsertLocks[i].l.lock, LWTRANCHE_WAL_INSERT);
 		WALInsertLocks[i].l.insertingAt = InvalidXLogRecPtr;
@@ -4622,6 +5050,7 @@ XLOGShmemInit(void)
 
 	SpinLockInit(&XLogCtl->Insert.insertpos_lck);
 	SpinLockInit(&XLogCtl->info_lck);
+	pg_atomic_init_u64(&XLogCtl->insertFinishedUpto, InvalidXLogRecPtr);
 	SpinLockInit(&XLogCtl->ulsn_lck);
 }
 
@@ -5623,7 +6052,8 @@ StartupXLOG(void)
 		memcpy(page, endOfRecoveryInfo->lastPage, len);
 		memset(page + len, 0, XLOG_BLCKSZ - len);
 
-		XLogCtl->xlblocks[firstIdx] = endOfRecoveryInfo->lastPageBeginPtr + XLOG_BLCKSZ;
+		pg_atomic_write_u64(&XLogCtl->xlblocks[firstIdx],
+							endOfRecoveryInfo->lastPageBeginPtr + XLOG_BLCKSZ);
 		XLogCtl->InitializedUpTo = endOfRecoveryInfo->lastPageBeginPtr + XLOG_BLCKSZ;
 	}
 	else
@@ -6115,7 +6545,7 @@ GetLastImportantRecPtr(void)
 	XLogRecPtr	res = InvalidXLogRecPtr;
 	int			i;
 
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < NumXLogInsertLocks; i++)
 	{
 		XLogRecPtr	last_important;
 
@@ -6241,7 +6671,8 @@ LogCheckpointEnd(bool restartpoint)
 				sync_msecs,
 				total_msecs,
 				longest_msecs,
-				average_msecs;
+				average_msecs,
+				early_sync_msecs;
 	uint64		average_sync_time;
 
 	CheckpointStats.ckpt_end_t = GetCurrentTimestamp();
@@ -6277,6 +6708,7 @@ LogCheckpointEnd(bool restartpoint)
 		average_sync_time = CheckpointStats.ckpt_agg_sync_time /
 			CheckpointStats.ckpt_sync_rels;
 	average_msecs = (long) ((average_sync_time + 999) / 1000);
+	early_sync_msecs = (long) ((CheckpointStats.ckpt_agg_early_sync_time + 999) / 1000);
 
 	/*
 	 * ControlFileLock is not required to see ControlFile->checkPoint and
@@ -6289,6 +6721,7 @@ LogCheckpointEnd(bool restartpoint)
 						"%d WAL file(s) added, %d removed, %d recycled; "
 						"write=%ld.%03d s, sync=%ld.%03d s, total=%ld.%03d s; "
 						"sync files=%d, longest=%ld.%03d s, average=%ld.%03d s; "
+						"early sync files=%d, early sync=%ld.%03d s; "
 						"distance=%d kB, estimate=%d kB; "
 						"lsn=%X/%X, redo lsn=%X/%X",
 						CheckpointStats.ckpt_bufs_written,
@@ -6302,6 +6735,8 @@ LogCheckpointEnd(bool restartpoint)
 						CheckpointStats.ckpt_sync_rels,
 						longest_msecs / 1000, (int) (longest_msecs % 1000),
 						average_msecs / 1000, (int) (average_msecs % 1000),
+						CheckpointStats.ckpt_early_sync_rels,
+						early_sync_msecs / 1000, (int) (early_sync_msecs % 1000),
 						(int) (PrevCheckPointDistance / 1024.0),
 						(int) (CheckPointDistanceEstimate / 1024.0),
 						LSN_FORMAT_ARGS(ControlFile->checkPoint),
@@ -6312,6 +6747,7 @@ LogCheckpointEnd(bool restartpoint)
 						"%d WAL file(s) added, %d removed, %d recycled; "
 						"write=%ld.%03d s, sync=%ld.%03d s, total=%ld.%03d s; "
 						"sync files=%d, longest=%ld.%03d s, average=%ld.%03d s; "
+						"early sync files=%d, early sync=%ld.%03d s; "
 						"distance=%d kB, estimate=%d kB; "
 						"lsn=%X/%X, redo lsn=%X/%X",
 						CheckpointStats.ckpt_bufs_written,
@@ -6325,6 +6761,8 @@ LogCheckpointEnd(bool restartpoint)
 						CheckpointStats.ckpt_sync_rels,
 						longest_msecs / 1000, (int) (longest_msecs % 1000),
 						average_msecs / 1000, (int) (average_msecs % 1000),
+						CheckpointStats.ckpt_early_sync_rels,
+						early_sync_msecs / 1000, (int) (early_sync_msecs % 1000),
 						(int) (PrevCheckPointDistance / 1024.0),
 						(int) (CheckPointDistanceEstimate / 1024.0),
 						LSN_FORMAT_ARGS(ControlFile->checkPoint),
@@ -8027,38 +8465,46 @@ xlog_redo(XLogReaderState *record)
 		/* Keep track of full_page_writes */
 		lastFullPageWrites = fpw;
 	}
+	else if (info == XLOG_CHECKSUMS)
+	{
+		xl_checksum_state state;
+
+		memcpy(&state, XLogRecGetData(record), sizeof(xl_checksum_state));
+
+		LWLockAcquire(ControlFileLock, LW_EXCLUSIVE);
+		ControlFile->data_checksum_version = state.new_checksumtype;
+		UpdateControlFile();
+		LWLockRelease(ControlFileLock);
+
+		/* Make hot standby backends follow the change, as on the primary */
+		WaitForProcSignalBarrier(EmitProcSignalBarrier(PROCSIGNAL_BARRIER_CHECKSUM));
+	}
 }
 
 /*
  * Return the (possible) sync flag used for opening a file, depending on the
- * value of the GUC wal_sync_method.
+ * values of the GUCs wal_sync_method and io_direct.
  */
 static int
 get_sync_bit(int method)
 {
 	int			o_direct_flag = 0;
 
-	/* If fsync is disabled, never open in sync mode */
-	if (!enableFsync)
-		return 0;
-
 	/*
-	 * Optimize writes by bypassing kernel cache with O_DIRECT when using
-	 * O_SYNC and O_DSYNC.  But only if archiving and streaming are disabled,
-	 * otherwise the archive command or walsender process will read the WAL
-	 * soon after writing it, which is guaranteed to cause a physical read if
-	 * we bypassed the kernel cache. We also skip the
-	 * posix_fadvise(POSIX_FADV_DONTNEED) call in XLogFileClose() for the same
-	 * reason.
+	 * Bypass the kernel cache with O_DIRECT if requested by io_direct.
 	 *
-	 * Never use O_DIRECT in walreceiver process for similar reasons; the WAL
-	 * written by walreceiver is normally read by the startup process soon
-	 * after it's written. Also, walreceiver performs unaligned writes, which
-	 * don't work with O_DIRECT, so it is required for correctness too.
+	 * Never use O_DIRECT in walreceiver process, though; the WAL written by
+	 * walreceiver is normally read by the startup process soon after it's
+	 * written. Also, walreceiver performs unaligned writes, which don't work
+	 * with O_DIRECT, so it is required for correctness too.
 	 */
-	if (!XLogIsNeeded() && !AmWalReceiverProcess())
+	if ((io_direct_flags & IO_DIRECT_WAL) && !AmWalReceiverProcess())
 		o_direct_flag = PG_O_DIRECT;
 
+	/* If fsync is disabled, never open in sync mode */
+	if (!enableFsync)
+		return o_direct_flag;
+
 	switch (method)
 	{
 			/*
@@ -8070,7 +8516,7 @@ get_sync_bit(int method)
 		case SYNC_METHOD_FSYNC:
 		case SYNC_METHOD_FSYNC_WRITETHROUGH:
 		case SYNC_METHOD_FDATASYNC:
-			return 0;
+			return o_direct_flag;
 #ifdef O_SYNC
 		case SYNC_METHOD_OPEN:
 			return O_SYNC | o_direct_flag;
@@ -8299,10 +8745,6 @@ do_pg_backup_start(const char *backupidstr, bool fast, List **tablespaces,
 	PG_ENSURE_ERROR_CLEANUP(do_pg_abort_backup, DatumGetBool(true));
 	{
 		bool		gotUniqueStartpoint = false;
-		DIR		   *tblspcdir;
-		struct dirent *de;
-		tablespaceinfo *ti;
-		int			datadirpathlen;
 
 		/*
 		 * Force an XLOG file switch before the checkpoint, to ensure that the
@@ -8422,98 +8864,116 @@ do_pg_backup_start(const char *backupidstr, bool fast, List **tablespaces,
 		/*
 		 * Construct tablespace_map file.
 		 */
-		datadirpathlen = strlen(DataDir);
+		get_backup_tablespaces(tablespaces, tblspcmapfile);
 
-		/* Collect information about all tablespaces */
-		tblspcdir = AllocateDir("pg_tblspc");
-		while ((de = ReadDir(tblspcdir, "pg_tblspc")) != NULL)
-		{
-			char		fullpath[MAXPGPATH + 10];
-			char		linkpath[MAXPGPATH];
-			char	   *relpath = NULL;
-			int			rllen;
-			StringInfoData escapedpath;
-			char	   *s;
-
-			/* Skip anything that doesn't look like a tablespace */
-			if (strspn(de->d_name, "0123456789") != strlen(de->d_name))
-				continue;
+		state->starttime = (pg_time_t) time(NULL);
+	}
+	PG_END_ENSURE_ERROR_CLEANUP(do_pg_abort_backup, DatumGetBool(true));
 
-			snprintf(fullpath, sizeof(fullpath), "pg_tblspc/%s", de->d_name);
+	state->started_in_recovery = backup_started_in_recovery;
 
-			/*
-			 * Skip anything that isn't a symlink/junction.  For testing only,
-			 * we sometimes use allow_in_place_tablespaces to create
-			 * directories directly under pg_tblspc, which would fail below.
-			 */
-			if (get_dirent_type(fullpath, de, false, ERROR) != PGFILETYPE_LNK)
-				continue;
+	/*
+	 * Mark that the start phase has correctly finished for the backup.
+	 */
+	sessionBackupState = SESSION_BACKUP_RUNNING;
+}
 
-			rllen = readlink(fullpath, linkpath, sizeof(linkpath));
-			if (rllen < 0)
-			{
-				ereport(WARNING,
-						(errmsg("could not read symbolic link \"%s\": %m",
-								fullpath)));
-				continue;
-			}
-			else if (rllen >= sizeof(linkpath))
-			{
-				ereport(WARNING,
-						(errmsg("symbolic link \"%s\" target is too long",
-								fullpath)));
-				continue;
-			}
-			linkpath[rllen] = '\0';
+/*
+ * Collect information about all tablespaces, for a base backup.
+ *
+ * A tablespaceinfo is appended to *tablespaces for each tablespace, if
+ * tablespaces isn't NULL, and a line to the tablespace_map file's contents
+ * in tblspcmapfile, if it isn't NULL.
+ */
+void
+get_backup_tablespaces(List **tablespaces, StringInfo tblspcmapfile)
+{
+	DIR		   *tblspcdir;
+	struct dirent *de;
+	tablespaceinfo *ti;
+	int			datadirpathlen;
 
-			/*
-			 * Build a backslash-escaped version of the link path to include
-			 * in the tablespace map file.
-			 */
-			initStringInfo(&escapedpath);
-			for (s = linkpath; *s; s++)
-			{
-				if (*s == '\n' || *s == '\r' || *s == '\\')
-					appendStringInfoChar(&escapedpath, '\\');
-				appendStringInfoChar(&escapedpath, *s);
-			}
+	datadirpathlen = strlen(DataDir);
 
-			/*
-			 * Relpath holds the relative path of the tablespace directory
-			 * when it's located within PGDATA, or NULL if it's located
-			 * elsewhere.
-			 */
-			if (rllen > datadirpathlen &&
-				strncmp(linkpath, DataDir, datadirpathlen) == 0 &&
-				IS_DIR_SEP(linkpath[datadirpathlen]))
-				relpath = linkpath + datadirpathlen + 1;
+	tblspcdir = AllocateDir("pg_tblspc");
+	while ((de = ReadDir(tblspcdir, "pg_tblspc")) != NULL)
+	{
+		char		fullpath[MAXPGPATH + 10];
+		char		linkpath[MAXPGPATH];
+		char	   *relpath = NULL;
+		int			rllen;
+		StringInfoData escapedpath;
+		char	   *s;
 
-			ti = palloc(sizeof(tablespaceinfo));
-			ti->oid = pstrdup(de->d_name);
-			ti->path = pstrdup(linkpath);
-			ti->rpath = relpath ? pstrdup(relpath) : NULL;
-			ti->size = -1;
+		/* Skip anything that doesn't look like a tablespace */
+		if (strspn(de->d_name, "0123456789") != strlen(de->d_name))
+			continue;
 
-			if (tablespaces)
-				*tablespaces = lappend(*tablespaces, ti);
+		snprintf(fullpath, sizeof(fullpath), "pg_tblspc/%s", de->d_name);
 
-			appendStringInfo(tblspcmapfile, "%s %s\n",
-							 ti->oid, escapedpath.data);
+		/*
+		 * Skip anything that isn't a symlink/junction.  For testing only,
+		 * we sometimes use allow_in_place_tablespaces to create
+		 * directories directly under pg_tblspc, which would fail below.
+		 */
+		if (get_dirent_type(fullpath, de, false, ERROR) != PGFILETYPE_LNK)
+			continue;
 
-			pfree(escapedpath.data);
+		rllen = readlink(fullpath, linkpath, sizeof(linkpath));
+		if (rllen < 0)
+		{
+			ereport(WARNING,
+					(errmsg("could not read symbolic link \"%s\": %m",
+							fullpath)));
+			continue;
 		}
-		FreeDir(tblspcdir);
+		else if (rllen >= sizeof(linkpath))
+		{
+			ereport(WARNING,
+					(errmsg("symbolic link \"%s\" target is too long",
+							fullpath)));
+			continue;
+		}
+		linkpath[rllen] = '\0';
 
-		state->starttime = (pg_time_t) time(NULL);
-	}
-	PG_END_ENSURE_ERROR_CLEANUP(do_pg_abort_backup, DatumGetBool(true));
+		/*
+		 * Build a backslash-escaped version of the link path to include
+		 * in the tablespace map file.
+		 */
+		initStringInfo(&escapedpath);
+		for (s = linkpath; *s; s++)
+		{
+			if (*s == '\n' || *s == '\r' || *s == '\\')
+				appendStringInfoChar(&escapedpath, '\\');
+			appendStringInfoChar(&escapedpath, *s);
+		}
 
-	state->started_in_recovery = backup_started_in_recovery;
+		/*
+		 * Relpath holds the relative path of the tablespace directory
+		 * when it's located within PGDATA, or NULL if it's located
+		 * elsewhere.
+		 */
+		if (rllen > datadirpathlen &&
+			strncmp(linkpath, DataDir, datadirpathlen) == 0 &&
+			IS_DIR_SEP(linkpath[datadirpathlen]))
+			relpath = linkpath + datadirpathlen + 1;
 
-	/*
-	 * Mark that the start phase has correctly finished for the backup.
-	 */
-	sessionBackupState = SESSION_BACKUP_RUNNING;
+		ti = palloc(sizeof(tablespaceinfo));
+		ti->oid = pstrdup(de->d_name);
+		ti->path = pstrdup(linkpath);
+		ti->rpath = relpath ? pstrdup(relpath) : NULL;
+		ti->size = -1;
+
+		if (tablespaces)
+			*tablespaces = lappend(*tablespaces, ti);
+
+		if (tblspcmapfile)
+			appendStringInfo(tblspcmapfile, "%s %s\n",
+							 ti->oid, escapedpath.data);
+
+		pfree(escapedpath.data);
+	}
+	FreeDir(tblspcdir);
 }
 
 /*
@@ -65,6 +65,14 @@ build_backup_content(BackupState *state, bool ishistoryfile)
 	appendStringInfo(result, "LABEL: %s\n", state->name);
 	appendStringInfo(result, "START TIMELINE: %u\n", state->starttli);
 
+	if (!XLogRecPtrIsInvalid(state->incremental_lsn))
+	{
+		appendStringInfo(result, "INCREMENTAL FROM LSN: %X/%X\n",
+						 LSN_FORMAT_ARGS(state->incremental_lsn));
+		appendStringInfo(result, "INCREMENTAL FROM TLI: %u\n",
+						 state->incremental_tli);
+	}
+
 	if (ishistoryfile)
 	{
 		char		stopstrfbuf[128];
@@ -132,6 +132,32 @@ static int	max_rdatas;			/* allocated size */
 
 static bool begininsert_called = false;
 
+#ifdef USE_ZSTD
+/*
+ * zstd context used to compress full-page images.  ZSTD_compress() would set
+ * up, and free, a new context with its whole work area for every block, which
+ * costs more than compressing an 8kB page, so keep one around instead.
+ */
+static ZSTD_CCtx *zstd_cctx = NULL;
+#endif
+
+/*
+ * State of a batch of records being collected with XLogBatchAdd().  Records
+ * that have been added but not yet inserted are copied to batch_buf.
+ */
+#define XLOG_BATCH_BUFSIZE	(XLR_MAX_BATCH_RECORDS * BLCKSZ)
+
+static bool batch_active = false;
+static int	batch_nrecords;		/* records added since XLogBeginBatch() */
+static int	batch_first_pending;	/* index of first not-yet-inserted one */
+static XLogRecPtr batch_endptrs[XLR_MAX_BATCH_RECORDS];
+static XLogRecord *batch_records[XLR_MAX_BATCH_RECORDS];
+static uint8 batch_flags[XLR_MAX_BATCH_RECORDS];
+static int	batch_num_fpi;
+static bool batch_topxid_included;
+static char *batch_buf = NULL;
+static Size batch_buf_used;
+
 /* Memory context to hold the registered buffer and data references. */
 static MemoryContext xloginsert_cxt;
 
@@ -141,6 +167,8 @@ static XLogRecData *XLogRecordAssemble(RmgrId rmid, uint8 info,
 									   bool *topxid_included);
 static bool XLogCompressBackupBlock(char *page, uint16 hole_offset,
 									uint16 hole_length, char *dest, uint16 *dlen);
+static bool XLogRecordIsBatchable(bool doPageWrites, XLogRecPtr fpw_lsn);
+static void XLogBatchFlush(void);
 
 /*
  * Begin constructing a WAL record. This must be called before the
@@ -506,6 +534,203 @@ XLogInsert(RmgrId rmid, uint8 info)
 	return EndPos;
 }
 
+/*
+ * Begin collecting a batch of WAL records.
+ *
+ * Between XLogBeginBatch() and XLogEndBatch(), records are constructed as
+ * usual with XLogBeginInsert() and the XLogRegister* functions, but finished
+ * with XLogBatchAdd() instead of XLogInsert().  The records are then inserted
+ * together with XLogInsertRecordBatch(), which acquires a WAL insertion lock
+ * and reserves WAL space only once for the whole batch.  This is meant for
+ * callers that emit many small records in a row.
+ *
+ * The end positions of the records are not known until XLogEndBatch(), so
+ * the caller must not release, or let anyone else see, any page modified by
+ * a batched record before that, and must set the page LSNs afterwards.
+ */
+void
+XLogBeginBatch(void)
+{
+	if (batch_buf == NULL)
+		batch_buf = MemoryContextAlloc(xloginsert_cxt, XLOG_BATCH_BUFSIZE);
+
+	/* forget any batch abandoned by an error */
+	batch_active = true;
+	batch_nrecords = 0;
+	batch_first_pending = 0;
+	batch_num_fpi = 0;
+	batch_topxid_included = false;
+	batch_buf_used = 0;
+}
+
+/*
+ * Add the record constructed since XLogBeginInsert() to the current batch.
+ *
+ * Records whose contents are only valid for the current RedoRecPtr and
+ * doPageWrites values, because a registered page might still need a
+ * full-page image, can't wait to be inserted later.  Those are inserted
+ * immediately with XLogInsert(), after the records already in the batch.
+ * Records are always inserted in the order they were added.
+ */
+void
+XLogBatchAdd(RmgrId rmid, uint8 info)
+{
+	XLogRecPtr	RedoRecPtr;
+	bool		doPageWrites;
+	bool		topxid_included = false;
+	XLogRecPtr	fpw_lsn;
+	XLogRecData *rdt;
+	XLogRecord *rechdr;
+	int			num_fpi = 0;
+	uint32		len;
+	char	   *dest;
+
+	if (!batch_active)
+		elog(ERROR, "XLogBeginBatch was not called");
+	if (!begininsert_called)
+		elog(ERROR, "XLogBeginInsert was not called");
+	if (batch_nrecords >= XLR_MAX_BATCH_RECORDS)
+		elog(ERROR, "too many records in WAL batch");
+
+	if ((info & ~(XLR_RMGR_INFO_MASK |
+				  XLR_SPECIAL_REL_UPDATE |
+				  XLR_CHECK_CONSISTENCY)) != 0)
+		elog(PANIC, "invalid xlog info mask %02X", info);
+
+	if (IsBootstrapProcessingMode() && rmid != RM_XLOG_ID)
+	{
+		XLogResetInsertion();
+		batch_endptrs[batch_nrecords++] = SizeOfXLogLongPHD;
+		batch_first_pending = batch_nrecords;
+		return;
+	}
+
+	GetFullPageWriteInfo(&RedoRecPtr, &doPageWrites);
+
+	rdt = XLogRecordAssemble(rmid, info, RedoRecPtr, doPageWrites,
+							 &fpw_lsn, &num_fpi, &topxid_included);
+	rechdr = (XLogRecord *) rdt->data;
+	len = rechdr->xl_tot_len;
+
+	if (!XLogRecordIsBatchable(doPageWrites, fpw_lsn) ||
+		(rmid == RM_XLOG_ID && (info & XLR_RMGR_INFO_MASK) == XLOG_SWITCH) ||
+		len > XLOG_BATCH_BUFSIZE)
+	{
+		/*
+		 * Insert it the normal way, which re-assembles it if needed.  The
+		 * registered data is still intact.
+		 */
+		XLogBatchFlush();
+		batch_endptrs[batch_nrecords++] = XLogInsert(rmid, info);
+		batch_first_pending = batch_nrecords;
+		return;
+	}
+
+	/* Make room in the batch buffer if needed */
+	if (batch_buf_used + len > XLOG_BATCH_BUFSIZE)
+		XLogBatchFlush();
+
+	TRACE_POSTGRESQL_WAL_INSERT(rmid, info);
+
+	/* Copy the record, it's no longer needed in the working area */
+	dest = batch_buf + batch_buf_used;
+	batch_records[batch_nrecords] = (XLogRecord *) dest;
+	for (; rdt != NULL; rdt = rdt->next)
+	{
+		memcpy(dest, rdt->data, rdt->len);
+		dest += rdt->len;
+	}
+	Assert(dest - (char *) batch_records[batch_nrecords] == len);
+	batch_buf_used = MAXALIGN(batch_buf_used + len);
+
+	batch_flags[batch_nrecords] = curinsert_flags;
+	batch_num_fpi += num_fpi;
+	batch_topxid_included |= topxid_included;
+	batch_nrecords++;
+
+	XLogResetInsertion();
+}
+
+/*
+ * Insert all records added to the current batch that haven't been inserted
+ * yet, and end the batch.
+ *
+ * If 'endptrs' is not NULL, the end position of each record added since
+ * XLogBeginBatch() is stored in it, in the order the records were added.
+ * Returns the end position of the last record.
+ */
+XLogRecPtr
+XLogEndBatch(XLogRecPtr *endptrs)
+{
+	if (!batch_active)
+		elog(ERROR, "XLogBeginBatch was not called");
+
+	XLogBatchFlush();
+	batch_active = false;
+
+	if (batch_nrecords == 0)
+		return InvalidXLogRecPtr;
+
+	if (endptrs)
+		memcpy(endptrs, batch_endptrs, sizeof(XLogRecPtr) * batch_nrecords);
+
+	return batch_endptrs[batch_nrecords - 1];
+}
+
+/*
+ * Insert the pending records of the current batch.
+ */
+static void
+XLogBatchFlush(void)
+{
+	int			npending = batch_nrecords - batch_first_pending;
+
+	if (npending == 0)
+		return;
+
+	XLogInsertRecordBatch(npending,
+						  &batch_records[batch_first_pending],
+						  &batch_flags[batch_first_pending],
+						  batch_num_fpi, batch_topxid_included,
+						  &batch_endptrs[batch_first_pending]);
+
+	batch_first_pending = batch_nrecords;
+	batch_num_fpi = 0;
+	batch_topxid_included = false;
+	batch_buf_used = 0;
+}
+
+/*
+ * Can the record just assembled be inserted later, without being
+ * rechecked against RedoRecPtr and doPageWrites?
+ *
+ * That is the case if no registered page was left out of the record because
+ * its LSN is newer than the redo pointer (fpw_lsn is invalid), and there are
+ * no pages at all whose backup was skipped only because full-page writes
+ * were disabled.
+ */
+static bool
+XLogRecordIsBatchable(bool doPageWrites, XLogRecPtr fpw_lsn)
+{
+	int			block_id;
+
+	if (fpw_lsn != InvalidXLogRecPtr)
+		return false;
+	if (doPageWrites)
+		return true;
+
+	for (block_id = 0; block_id < max_registered_block_id; block_id++)
+	{
+		registered_buffer *regbuf = &registered_buffers[block_id];
+
+		if (regbuf->in_use &&
+			(regbuf->flags & (REGBUF_FORCE_IMAGE | REGBUF_NO_IMAGE)) == 0)
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * Assemble a WAL record from the registered data and buffers into an
  * XLogRecData chain, ready for insertion with XLogInsertRecord().
@@ -941,8 +1166,15 @@ XLogCompressBackupBlock(char *page, uint16 hole_offset, uint16 hole_length,
 
 		case WAL_COMPRESSION_ZSTD:
 #ifdef USE_ZSTD
-			len = ZSTD_compress(dest, COMPRESS_BUFSIZE, source, orig_len,
-								ZSTD_CLEVEL_DEFAULT);
+			if (zstd_cctx == NULL)
+				zstd_cctx = ZSTD_createCCtx();
+			if (zstd_cctx == NULL)
+			{
+				len = -1;		/* out of memory; store the image as is */
+				break;
+			}
+			len = ZSTD_compressCCtx(zstd_cctx, dest, COMPRESS_BUFSIZE,
+									source, orig_len, ZSTD_CLEVEL_DEFAULT);
 			if (ZSTD_isError(len))
 				len = -1;		/* failure */
 #else
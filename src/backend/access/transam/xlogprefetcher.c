@@ -181,6 +181,9 @@ typedef struct XLogPrefetchStats
 	pg_atomic_uint64 skip_new;	/* New/missing blocks filtered. */
 	pg_atomic_uint64 skip_fpw;	/* FPWs skipped. */
 	pg_atomic_uint64 skip_rep;	/* Repeat accesses skipped. */
+	pg_atomic_uint64 records_no_block;	/* Records with no block refs. */
+	pg_atomic_uint64 records_single_block;	/* Records with one block ref. */
+	pg_atomic_uint64 records_multi_block;	/* Records with several. */
 
 	/* Dynamic values */
 	int			wal_distance;	/* Number of WAL bytes ahead. */
@@ -313,6 +316,9 @@ XLogPrefetchResetStats(void)
 	pg_atomic_write_u64(&SharedStats->skip_new, 0);
 	pg_atomic_write_u64(&SharedStats->skip_fpw, 0);
 	pg_atomic_write_u64(&SharedStats->skip_rep, 0);
+	pg_atomic_write_u64(&SharedStats->records_no_block, 0);
+	pg_atomic_write_u64(&SharedStats->records_single_block, 0);
+	pg_atomic_write_u64(&SharedStats->records_multi_block, 0);
 }
 
 void
@@ -334,6 +340,9 @@ XLogPrefetchShmemInit(void)
 		pg_atomic_init_u64(&SharedStats->skip_new, 0);
 		pg_atomic_init_u64(&SharedStats->skip_fpw, 0);
 		pg_atomic_init_u64(&SharedStats->skip_rep, 0);
+	pg_atomic_init_u64(&SharedStats->records_no_block, 0);
+	pg_atomic_init_u64(&SharedStats->records_single_block, 0);
+	pg_atomic_init_u64(&SharedStats->records_multi_block, 0);
 	}
 }
 
@@ -522,6 +531,30 @@ XLogPrefetcherNextBlock(uintptr_t pgsr_private, XLogRecPtr *lsn)
 			/* We have a new record to process. */
 			prefetcher->record = record;
 			prefetcher->next_block_id = 0;
+
+			/*
+			 * Classify the record by the number of blocks it references.
+			 * Records that reference a single block only depend on earlier
+			 * records for the same block, while the others have to be
+			 * replayed in order with respect to more of the WAL stream, so
+			 * this shows how much of the WAL could be replayed independently.
+			 */
+			{
+				int			nblocks = 0;
+
+				for (int block_id = 0; block_id <= record->max_block_id; block_id++)
+				{
+					if (record->blocks[block_id].in_use)
+						nblocks++;
+				}
+
+				if (nblocks == 0)
+					XLogPrefetchIncrement(&SharedStats->records_no_block);
+				else if (nblocks == 1)
+					XLogPrefetchIncrement(&SharedStats->records_single_block);
+				else
+					XLogPrefetchIncrement(&SharedStats->records_multi_block);
+			}
 		}
 		else
 		{
@@ -829,7 +862,7 @@ XLogPrefetcherNextBlock(uintptr_t pgsr_private, XLogRecPtr *lsn)
 Datum
 pg_stat_get_recovery_prefetch(PG_FUNCTION_ARGS)
 {
-#define PG_STAT_GET_RECOVERY_PREFETCH_COLS 10
+#define PG_STAT_GET_RECOVERY_PREFETCH_COLS 13
 	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
 	Datum		values[PG_STAT_GET_RECOVERY_PREFETCH_COLS];
 	bool		nulls[PG_STAT_GET_RECOVERY_PREFETCH_COLS];
@@ -846,9 +879,12 @@ pg_stat_get_recovery_prefetch(PG_FUNCTION_ARGS)
 	values[4] = Int64GetDatum(pg_atomic_read_u64(&SharedStats->skip_new));
 	values[5] = Int64GetDatum(pg_atomic_read_u64(&SharedStats->skip_fpw));
 	values[6] = Int64GetDatum(pg_atomic_read_u64(&SharedStats->skip_rep));
-	values[7] = Int32GetDatum(SharedStats->wal_distance);
-	values[8] = Int32GetDatum(SharedStats->block_distance);
-	values[9] = Int32GetDatum(SharedStats->io_depth);
+	values[7] = Int64GetDatum(pg_atomic_read_u64(&SharedStats->records_no_block));
+	values[8] = Int64GetDatum(pg_atomic_read_u64(&SharedStats->records_single_block));
+	values[9] = Int64GetDatum(pg_atomic_read_u64(&SharedStats->records_multi_block));
+	values[10] = Int32GetDatum(SharedStats->wal_distance);
+	values[11] = Int32GetDatum(SharedStats->block_distance);
+	values[12] = Int32GetDatum(SharedStats->io_depth);
 	tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
 
 	return (Datum) 0;
@@ -59,6 +59,11 @@ static void WALOpenSegmentInit(WALOpenSegment *seg, WALSegmentContext *segcxt,
 /* size of the buffer allocated for error message. */
 #define MAX_ERRORMSG_LEN 1000
 
+#ifdef USE_ZSTD
+/* zstd context for decompressing full-page images, see RestoreBlockImage() */
+static ZSTD_DCtx *zstd_dctx = NULL;
+#endif
+
 /*
  * Default size; large enough that typical users of XLogReader won't often need
  * to use the 'oversized' memory allocation code path.
@@ -2097,9 +2102,22 @@ RestoreBlockImage(XLogReaderState *record, uint8 block_id, char *page)
 		else if ((bkpb->bimg_info & BKPIMAGE_COMPRESS_ZSTD) != 0)
 		{
 #ifdef USE_ZSTD
-			size_t		decomp_result = ZSTD_decompress(tmp.data,
-														BLCKSZ - bkpb->hole_length,
-														ptr, bkpb->bimg_len);
+			size_t		decomp_result;
+
+			/*
+			 * Reuse a decompression context across blocks, rather than let
+			 * ZSTD_decompress() create one for each block.
+			 */
+			if (zstd_dctx == NULL)
+				zstd_dctx = ZSTD_createDCtx();
+			if (zstd_dctx != NULL)
+				decomp_result = ZSTD_decompressDCtx(zstd_dctx, tmp.data,
+													BLCKSZ - bkpb->hole_length,
+													ptr, bkpb->bimg_len);
+			else
+				decomp_result = ZSTD_decompress(tmp.data,
+												BLCKSZ - bkpb->hole_length,
+												ptr, bkpb->bimg_len);
 
 			if (ZSTD_isError(decomp_result))
 				decomp_success = false;
@@ -94,3 +94,34 @@ XLogRecStoreStats(XLogStats *stats, XLogReaderState *record)
 	stats->record_stats[rmid][recid].rec_len += rec_len;
 	stats->record_stats[rmid][recid].fpi_len += fpi_len;
 }
+
+/*
+ * Add the per-rmgr and per-record statistics of src to dst, for callers that
+ * compute statistics of separate ranges of WAL.  The range of dst, if any,
+ * is for the caller to maintain.
+ */
+void
+XLogStatsMerge(XLogStats *dst, const XLogStats *src)
+{
+	int			rmid;
+	int			recid;
+
+	dst->count += src->count;
+
+	for (rmid = 0; rmid <= RM_MAX_ID; rmid++)
+	{
+		dst->rmgr_stats[rmid].count += src->rmgr_stats[rmid].count;
+		dst->rmgr_stats[rmid].rec_len += src->rmgr_stats[rmid].rec_len;
+		dst->rmgr_stats[rmid].fpi_len += src->rmgr_stats[rmid].fpi_len;
+
+		for (recid = 0; recid < MAX_XLINFO_TYPES; recid++)
+		{
+			dst->record_stats[rmid][recid].count +=
+				src->record_stats[rmid][recid].count;
+			dst->record_stats[rmid][recid].rec_len +=
+				src->record_stats[rmid][recid].rec_len;
+			dst->record_stats[rmid][recid].fpi_len +=
+				src->record_stats[rmid][recid].fpi_len;
+		}
+	}
+}
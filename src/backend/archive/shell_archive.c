@@ -27,13 +27,20 @@ static bool shell_archive_configured(ArchiveModuleState *state);
 static bool shell_archive_file(ArchiveModuleState *state,
 							   const char *file,
 							   const char *path);
+static void shell_archive_files(ArchiveModuleState *state, int nfiles,
+								const char *const *files,
+								const char *const *paths, bool *archived);
 static void shell_archive_shutdown(ArchiveModuleState *state);
+static char *shell_archive_command(const char *file, const char *path);
+static bool shell_archive_result(int rc, char *xlogarchcmd,
+								 const char *file);
 
 static const ArchiveModuleCallbacks shell_archive_callbacks = {
 	.startup_cb = NULL,
 	.check_configured_cb = shell_archive_configured,
 	.archive_file_cb = shell_archive_file,
-	.shutdown_cb = shell_archive_shutdown
+	.shutdown_cb = shell_archive_shutdown,
+	.archive_files_cb = shell_archive_files
 };
 
 const ArchiveModuleCallbacks *
@@ -53,9 +60,84 @@ shell_archive_file(ArchiveModuleState *state, const char *file,
 				   const char *path)
 {
 	char	   *xlogarchcmd;
-	char	   *nativePath = NULL;
 	int			rc;
 
+	xlogarchcmd = shell_archive_command(file, path);
+
+	ereport(DEBUG3,
+			(errmsg_internal("executing archive command \"%s\"",
+							 xlogarchcmd)));
+
+	fflush(NULL);
+	pgstat_report_wait_start(WAIT_EVENT_ARCHIVE_COMMAND);
+	rc = system(xlogarchcmd);
+	pgstat_report_wait_end();
+
+	return shell_archive_result(rc, xlogarchcmd, file);
+}
+
+/*
+ * Archive several files by running archive_command for all of them
+ * concurrently.
+ *
+ * The commands are started with popen() rather than system(), which doesn't
+ * wait for them to finish; we don't use the pipe.  We collect all exit
+ * statuses before reporting any failure, since a command that died on a
+ * signal makes us exit.
+ */
+static void
+shell_archive_files(ArchiveModuleState *state, int nfiles,
+					const char *const *files, const char *const *paths,
+					bool *archived)
+{
+	char	   *xlogarchcmds[MAX_ARCHIVE_BATCH_SIZE];
+	FILE	   *pipes[MAX_ARCHIVE_BATCH_SIZE];
+	int			rcs[MAX_ARCHIVE_BATCH_SIZE];
+	int			i;
+
+	Assert(nfiles <= MAX_ARCHIVE_BATCH_SIZE);
+
+	fflush(NULL);
+	for (i = 0; i < nfiles; i++)
+	{
+		xlogarchcmds[i] = shell_archive_command(files[i], paths[i]);
+
+		ereport(DEBUG3,
+				(errmsg_internal("executing archive command \"%s\"",
+								 xlogarchcmds[i])));
+
+		pipes[i] = popen(xlogarchcmds[i], "w");
+		if (pipes[i] == NULL)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not execute archive command \"%s\": %m",
+							xlogarchcmds[i])));
+	}
+
+	pgstat_report_wait_start(WAIT_EVENT_ARCHIVE_COMMAND);
+	for (i = 0; i < nfiles; i++)
+		rcs[i] = pipes[i] != NULL ? pclose(pipes[i]) : -1;
+	pgstat_report_wait_end();
+
+	for (i = 0; i < nfiles; i++)
+	{
+		if (pipes[i] == NULL)
+			archived[i] = false;
+		else
+			archived[i] = shell_archive_result(rcs[i], xlogarchcmds[i],
+											   files[i]);
+	}
+}
+
+/*
+ * Build the archive_command to run for one file
+ */
+static char *
+shell_archive_command(const char *file, const char *path)
+{
+	char	   *xlogarchcmd;
+	char	   *nativePath = NULL;
+
 	if (path)
 	{
 		nativePath = pstrdup(path);
@@ -69,15 +151,17 @@ shell_archive_file(ArchiveModuleState *state, const char *file,
 	if (nativePath)
 		pfree(nativePath);
 
-	ereport(DEBUG3,
-			(errmsg_internal("executing archive command \"%s\"",
-							 xlogarchcmd)));
-
-	fflush(NULL);
-	pgstat_report_wait_start(WAIT_EVENT_ARCHIVE_COMMAND);
-	rc = system(xlogarchcmd);
-	pgstat_report_wait_end();
+	return xlogarchcmd;
+}
 
+/*
+ * Check the exit status of an archive command, and report it if it failed
+ *
+ * Returns true if the file was archived.
+ */
+static bool
+shell_archive_result(int rc, char *xlogarchcmd, const char *file)
+{
 	if (rc != 0)
 	{
 		/*
@@ -16,15 +16,19 @@
 #include <unistd.h>
 #include <time.h>
 
+#include "access/timeline.h"
 #include "access/xlog_internal.h"
 #include "access/xlogbackup.h"
 #include "backup/backup_manifest.h"
 #include "backup/basebackup.h"
+#include "backup/basebackup_incremental.h"
+#include "backup/basebackup_parallel.h"
 #include "backup/basebackup_sink.h"
 #include "backup/basebackup_target.h"
 #include "commands/defrem.h"
 #include "common/compression.h"
 #include "common/file_perm.h"
+#include "common/hashfn.h"
 #include "lib/stringinfo.h"
 #include "miscadmin.h"
 #include "nodes/pg_list.h"
@@ -42,6 +46,7 @@
 #include "storage/reinit.h"
 #include "utils/builtins.h"
 #include "utils/guc.h"
+#include "utils/pg_lsn.h"
 #include "utils/ps_status.h"
 #include "utils/relcache.h"
 #include "utils/resowner.h"
@@ -73,6 +78,11 @@ typedef struct
 	pg_compress_algorithm compression;
 	pg_compress_specification compression_specification;
 	pg_checksum_type manifest_checksum_type;
+	XLogRecPtr	incremental_lsn;
+	TimeLineID	incremental_tli;
+	int			parallel;
+	int			parallel_part;
+	int			parallel_leader;
 } basebackup_options;
 
 static int64 sendTablespace(bbsink *sink, char *path, char *spcoid, bool sizeonly,
@@ -83,6 +93,12 @@ static int64 sendDir(bbsink *sink, const char *path, int basepathlen, bool sizeo
 static bool sendFile(bbsink *sink, const char *readfilename, const char *tarfilename,
 					 struct stat *statbuf, bool missing_ok, Oid dboid,
 					 backup_manifest_info *manifest, const char *spcoid);
+static bool sendIncrementalFile(bbsink *sink, const char *readfilename,
+								const char *tarfilename, struct stat *statbuf,
+								Oid dboid, backup_manifest_info *manifest,
+								const char *spcoid);
+static void sendIncrementalData(bbsink *sink, const char *data, size_t len,
+								pg_checksum_context *checksum_ctx);
 static void sendFileWithContent(bbsink *sink, const char *filename,
 								const char *content,
 								backup_manifest_info *manifest);
@@ -92,6 +108,8 @@ static int64 _tarWriteHeader(bbsink *sink, const char *filename,
 static void _tarWritePadding(bbsink *sink, int len);
 static void convert_link_to_directory(const char *pathbuf, struct stat *statbuf);
 static void perform_base_backup(basebackup_options *opt, bbsink *sink);
+static void basebackup_abort(int code, Datum arg);
+static bool file_in_this_part(const char *path);
 static void parse_basebackup_options(List *options, basebackup_options *opt);
 static int	compareWalFileNames(const ListCell *a, const ListCell *b);
 static bool is_checksummed_file(const char *fullpath, const char *filename);
@@ -107,6 +125,19 @@ static long long int total_checksum_failures;
 /* Do not verify checksums. */
 static bool noverify_checksums = false;
 
+/*
+ * Start WAL location of the backup this one is incremental to, or invalid
+ * for a full backup.  Blocks whose LSN is older than this are not sent.
+ */
+static XLogRecPtr incremental_lsn = InvalidXLogRecPtr;
+
+/*
+ * Number of streams of a parallel backup, and the one this process sends.
+ * Each regular file is sent by exactly one of them, see file_in_this_part().
+ */
+static int	parallel_nparts = 1;
+static int	parallel_part = 0;
+
 /*
  * Definition of one element part of an exclusion list, used for paths part
  * of checksum validation or base backups.  "name" is the name of the file
@@ -220,6 +251,32 @@ static const struct exclude_list_item noChecksumFiles[] = {
 	{NULL, false}
 };
 
+/*
+ * Error cleanup callback of perform_base_backup().
+ */
+static void
+basebackup_abort(int code, Datum arg)
+{
+	ParallelBackupAbort();
+	do_pg_abort_backup(code, BoolGetDatum(false));
+}
+
+/*
+ * Does the regular file at this path belong to the share of the files this
+ * stream of a parallel backup sends?  The streams of the backup distribute
+ * the files among themselves by hashing their paths, so they don't need to
+ * coordinate while sending them.
+ */
+static bool
+file_in_this_part(const char *path)
+{
+	if (parallel_nparts <= 1)
+		return true;
+
+	return hash_bytes((const unsigned char *) path, strlen(path)) %
+		parallel_nparts == parallel_part;
+}
+
 /*
  * Actually do a base backup for the specified tablespaces.
  *
@@ -248,6 +305,9 @@ perform_base_backup(basebackup_options *opt, bbsink *sink)
 	CurrentResourceOwner = ResourceOwnerCreate(NULL, "base backup");
 
 	backup_started_in_recovery = RecoveryInProgress();
+	incremental_lsn = opt->incremental_lsn;
+	parallel_nparts = Max(opt->parallel, 1);
+	parallel_part = opt->parallel_part;
 
 	InitializeBackupManifest(&manifest, opt->manifest,
 							 opt->manifest_checksum_type);
@@ -258,25 +318,82 @@ perform_base_backup(basebackup_options *opt, bbsink *sink)
 	backup_state = (BackupState *) palloc0(sizeof(BackupState));
 	tablespace_map = makeStringInfo();
 
-	basebackup_progress_wait_checkpoint();
-	do_pg_backup_start(opt->label, opt->fastcheckpoint, &state.tablespaces,
-					   backup_state, tablespace_map);
+	if (opt->parallel_leader != 0)
+	{
+		/*
+		 * A part of a parallel backup doesn't start a backup of its own, it
+		 * just sends some of the files of the backup its leader started.
+		 */
+		ParallelBackupAttach(opt->parallel_leader, opt->parallel_part,
+							 opt->parallel, &state.startptr, &state.starttli);
+	}
+	else
+	{
+		basebackup_progress_wait_checkpoint();
+		do_pg_backup_start(opt->label, opt->fastcheckpoint, &state.tablespaces,
+						   backup_state, tablespace_map);
 
-	state.startptr = backup_state->startpoint;
-	state.starttli = backup_state->starttli;
+		state.startptr = backup_state->startpoint;
+		state.starttli = backup_state->starttli;
+	}
 
 	/*
 	 * Once do_pg_backup_start has been called, ensure that any failure causes
 	 * us to abort the backup so we don't "leak" a backup counter. For this
 	 * reason, *all* functionality between do_pg_backup_start() and the end of
-	 * do_pg_backup_stop() should be inside the error cleanup block!
+	 * do_pg_backup_stop() should be inside the error cleanup block!  The
+	 * cleanup also tells the other streams of a parallel backup about the
+	 * failure.
 	 */
 
-	PG_ENSURE_ERROR_CLEANUP(do_pg_abort_backup, BoolGetDatum(false));
+	PG_ENSURE_ERROR_CLEANUP(basebackup_abort, (Datum) 0);
 	{
 		ListCell   *lc;
 		tablespaceinfo *newti;
 
+		if (opt->parallel_leader != 0)
+			get_backup_tablespaces(&state.tablespaces, NULL);
+		else if (opt->parallel > 1)
+			ParallelBackupBegin(opt->parallel, state.startptr, state.starttli);
+
+		/*
+		 * Check that the earlier backup of an incremental backup can serve as
+		 * its base: it must have started before this one, on this timeline
+		 * or on one of its ancestors before the server switched away from
+		 * it.  Otherwise the blocks we skip might not be the ones in the
+		 * earlier backup.
+		 */
+		if (!XLogRecPtrIsInvalid(opt->incremental_lsn))
+		{
+			if (opt->incremental_lsn > state.startptr)
+				ereport(ERROR,
+						(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+						 errmsg("incremental backup from WAL location %X/%X is not possible",
+								LSN_FORMAT_ARGS(opt->incremental_lsn)),
+						 errdetail("This backup starts at WAL location %X/%X.",
+								   LSN_FORMAT_ARGS(state.startptr))));
+
+			if (opt->incremental_tli != 0 &&
+				opt->incremental_tli != state.starttli)
+			{
+				List	   *history = readTimeLineHistory(state.starttli);
+
+				if (!tliInHistory(opt->incremental_tli, history) ||
+					opt->incremental_lsn >
+					tliSwitchPoint(opt->incremental_tli, history, NULL))
+					ereport(ERROR,
+							(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+							 errmsg("incremental backup from WAL location %X/%X on timeline %u is not possible",
+									LSN_FORMAT_ARGS(opt->incremental_lsn),
+									opt->incremental_tli),
+							 errdetail("That location is not in the history of timeline %u.",
+									   state.starttli)));
+			}
+
+			backup_state->incremental_lsn = opt->incremental_lsn;
+			backup_state->incremental_tli = opt->incremental_tli;
+		}
+
 		/* Add a node for the base directory at the end */
 		newti = palloc0(sizeof(tablespaceinfo));
 		newti->size = -1;
@@ -313,7 +430,14 @@ perform_base_backup(basebackup_options *opt, bbsink *sink)
 		{
 			tablespaceinfo *ti = (tablespaceinfo *) lfirst(lc);
 
-			if (ti->path == NULL)
+			if (ti->path == NULL && opt->parallel_leader != 0)
+			{
+				/* A part of a parallel backup sends only its share of files */
+				bbsink_begin_archive(sink, "base.tar");
+				sendDir(sink, ".", 1, false, state.tablespaces,
+						false, &manifest, NULL);
+			}
+			else if (ti->path == NULL)
 			{
 				struct stat statbuf;
 				bool		sendtblspclinks = true;
@@ -339,6 +463,13 @@ perform_base_backup(basebackup_options *opt, bbsink *sink)
 				sendDir(sink, ".", 1, false, state.tablespaces,
 						sendtblspclinks, &manifest, NULL);
 
+				/*
+				 * In a parallel backup, the other streams must be done with
+				 * their files before pg_control is copied.
+				 */
+				if (opt->parallel > 1)
+					ParallelBackupWaitForParts();
+
 				/* ... and pg_control after everything else. */
 				if (lstat(XLOG_CONTROL_FILE, &statbuf) != 0)
 					ereport(ERROR,
@@ -380,18 +511,32 @@ perform_base_backup(basebackup_options *opt, bbsink *sink)
 			}
 		}
 
-		basebackup_progress_wait_wal_archive(&state);
-		do_pg_backup_stop(backup_state, !opt->nowait);
+		if (opt->parallel_leader != 0)
+		{
+			ParallelBackupPartDone();
+
+			/* the leader reports the end of the backup */
+			endptr = state.startptr;
+			endtli = state.starttli;
+		}
+		else
+		{
+			basebackup_progress_wait_wal_archive(&state);
+			do_pg_backup_stop(backup_state, !opt->nowait);
+
+			endptr = backup_state->stoppoint;
+			endtli = backup_state->stoptli;
 
-		endptr = backup_state->stoppoint;
-		endtli = backup_state->stoptli;
+			if (opt->parallel > 1)
+				ParallelBackupEnd();
+		}
 
 		/* Deallocate backup-related variables. */
 		pfree(tablespace_map->data);
 		pfree(tablespace_map);
 		pfree(backup_state);
 	}
-	PG_END_ENSURE_ERROR_CLEANUP(do_pg_abort_backup, BoolGetDatum(false));
+	PG_END_ENSURE_ERROR_CLEANUP(basebackup_abort, (Datum) 0);
 
 
 	if (opt->includewal)
@@ -703,6 +848,11 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 	bool		o_compression = false;
 	bool		o_compression_detail = false;
 	char	   *compression_detail_str = NULL;
+	bool		o_incremental = false;
+	bool		o_incremental_tli = false;
+	bool		o_parallel = false;
+	bool		o_parallel_part = false;
+	bool		o_parallel_leader = false;
 
 	MemSet(opt, 0, sizeof(*opt));
 	opt->manifest = MANIFEST_OPTION_NO;
@@ -891,6 +1041,75 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 			compression_detail_str = defGetString(defel);
 			o_compression_detail = true;
 		}
+		else if (strcmp(defel->defname, "incremental") == 0)
+		{
+			if (o_incremental)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->incremental_lsn =
+				DatumGetLSN(DirectFunctionCall1(pg_lsn_in,
+												CStringGetDatum(defGetString(defel))));
+			if (XLogRecPtrIsInvalid(opt->incremental_lsn))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("invalid WAL location for incremental backup: \"%s\"",
+								defGetString(defel))));
+			o_incremental = true;
+		}
+		else if (strcmp(defel->defname, "incremental_tli") == 0)
+		{
+			int64		tli;
+
+			if (o_incremental_tli)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			tli = defGetInt64(defel);
+			if (tli < 1 || tli > PG_UINT32_MAX)
+				ereport(ERROR,
+						(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+						 errmsg("invalid timeline %lld for incremental backup",
+								(long long) tli)));
+			opt->incremental_tli = (TimeLineID) tli;
+			o_incremental_tli = true;
+		}
+		else if (strcmp(defel->defname, "parallel") == 0)
+		{
+			int64		nparts;
+
+			if (o_parallel)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			nparts = defGetInt64(defel);
+			if (nparts < 1 || nparts > Min(64, max_wal_senders))
+				ereport(ERROR,
+						(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+						 errmsg("%lld is outside the valid range for parameter \"%s\" (%d .. %d)",
+								(long long) nparts, "parallel",
+								1, Min(64, max_wal_senders))));
+			opt->parallel = (int) nparts;
+			o_parallel = true;
+		}
+		else if (strcmp(defel->defname, "parallel_part") == 0)
+		{
+			if (o_parallel_part)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->parallel_part = defGetInt32(defel);
+			o_parallel_part = true;
+		}
+		else if (strcmp(defel->defname, "parallel_leader") == 0)
+		{
+			if (o_parallel_leader)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->parallel_leader = defGetInt32(defel);
+			o_parallel_leader = true;
+		}
 		else
 			ereport(ERROR,
 					(errcode(ERRCODE_SYNTAX_ERROR),
@@ -931,6 +1150,39 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 		opt->target_handle =
 			BaseBackupGetTargetHandle(target_str, target_detail_str);
 
+	if (o_parallel_part != o_parallel_leader || (o_parallel_part && !o_parallel))
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("options \"%s\", \"%s\" and \"%s\" must be specified together",
+						"parallel", "parallel_part", "parallel_leader")));
+	if (o_parallel_part &&
+		(opt->parallel_part < 1 || opt->parallel_part >= opt->parallel))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("%d is outside the valid range for parameter \"%s\" (%d .. %d)",
+						opt->parallel_part, "parallel_part",
+						1, opt->parallel - 1)));
+	if (opt->parallel > 1)
+	{
+		if (opt->manifest != MANIFEST_OPTION_NO)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("backup manifests are not supported by parallel base backups")));
+		if (!opt->send_to_client)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("parallel base backups can only be sent to the client")));
+		if (o_parallel_part && opt->includewal)
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("WAL can only be included by the first stream of a parallel base backup")));
+	}
+
+	if (o_incremental_tli && !o_incremental)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("incremental timeline cannot be specified without an incremental backup location")));
+
 	if (o_compression_detail && !o_compression)
 		ereport(ERROR,
 				(errcode(ERRCODE_SYNTAX_ERROR),
@@ -1191,6 +1443,7 @@ sendDir(bbsink *sink, const char *path, int basepathlen, bool sizeonly,
 		ForkNumber	relForkNum; /* Type of fork if file is a relation */
 		int			relnumchars;	/* Chars in filename that are the
 									 * relnumber */
+		bool		isMainFork = false; /* Is file a relation's main fork? */
 
 		/* Skip special stuff */
 		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
@@ -1243,6 +1496,8 @@ sendDir(bbsink *sink, const char *path, int basepathlen, bool sizeonly,
 			parse_filename_for_nontemp_relation(de->d_name, &relnumchars,
 												&relForkNum))
 		{
+			isMainFork = (relForkNum == MAIN_FORKNUM);
+
 			/* Never exclude init forks */
 			if (relForkNum != INIT_FORKNUM)
 			{
@@ -1408,7 +1663,24 @@ sendDir(bbsink *sink, const char *path, int basepathlen, bool sizeonly,
 		{
 			bool		sent = false;
 
-			if (!sizeonly)
+			/* In a parallel backup, another stream might send this file */
+			if (!file_in_this_part(pathbuf))
+				continue;
+
+			/*
+			 * In an incremental backup, only the modified blocks of the main
+			 * fork of relations are sent.  The other forks are small, and
+			 * the free space map and visibility map are not always
+			 * WAL-logged when they change, so they are sent in full.
+			 */
+			if (sizeonly)
+				sent = false;
+			else if (isMainFork && !XLogRecPtrIsInvalid(incremental_lsn))
+				sent = sendIncrementalFile(sink, pathbuf,
+										   pathbuf + basepathlen + 1, &statbuf,
+										   atooid(lastDir + 1), manifest,
+										   spcoid);
+			else
 				sent = sendFile(sink, pathbuf, pathbuf + basepathlen + 1, &statbuf,
 								true, isDbDir ? atooid(lastDir + 1) : InvalidOid,
 								manifest, spcoid);
@@ -1514,7 +1786,7 @@ sendFile(bbsink *sink, const char *readfilename, const char *tarfilename,
 
 	_tarWriteHeader(sink, tarfilename, NULL, statbuf, false);
 
-	if (!noverify_checksums && DataChecksumsEnabled())
+	if (!noverify_checksums && DataChecksumsNeedVerify())
 	{
 		char	   *filename;
 
@@ -1734,6 +2006,185 @@ sendFile(bbsink *sink, const char *readfilename, const char *tarfilename,
 	return true;
 }
 
+/*
+ * Send a relation file in an incremental backup.
+ *
+ * The file is read once to find the blocks whose LSN is not older than the
+ * start of the earlier backup, as well as new pages, which might be stale
+ * in it.  Unless that's most of the file, only those blocks are sent, as an
+ * incremental file described in basebackup_incremental.h.  As for any other
+ * file, blocks that change while we're sending them are fixed by WAL replay.
+ *
+ * Checksums are not verified for the blocks of incremental files.
+ *
+ * Returns true if the file was successfully sent, false if the file did not
+ * exist.
+ */
+static bool
+sendIncrementalFile(bbsink *sink, const char *readfilename,
+					const char *tarfilename, struct stat *statbuf,
+					Oid dboid, backup_manifest_info *manifest,
+					const char *spcoid)
+{
+	int			fd;
+	BlockNumber nblocks;
+	BlockNumber blkno;
+	BlockNumber *blocks;
+	BlockNumber nincluded = 0;
+	IncrementalFileHeader header;
+	char		incrementalname[MAXPGPATH];
+	const char *lastsep;
+	struct stat incrementalstat;
+	pgoff_t		len = 0;
+	int			i;
+	pg_checksum_context checksum_ctx;
+
+	/* Files that aren't made of whole blocks are sent as is. */
+	nblocks = statbuf->st_size / BLCKSZ;
+	if (nblocks == 0 || statbuf->st_size % BLCKSZ != 0 ||
+		statbuf->st_size > (off_t) RELSEG_SIZE * BLCKSZ)
+		return sendFile(sink, readfilename, tarfilename, statbuf, true, dboid,
+						manifest, spcoid);
+
+	fd = OpenTransientFile(readfilename, O_RDONLY | PG_BINARY);
+	if (fd < 0)
+	{
+		if (errno == ENOENT)
+			return false;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", readfilename)));
+	}
+
+	/* Find the blocks to send. */
+	blocks = palloc(sizeof(BlockNumber) * nblocks);
+	for (blkno = 0; blkno < nblocks;)
+	{
+		size_t		remaining = (size_t) (nblocks - blkno) * BLCKSZ;
+		off_t		cnt;
+
+		cnt = basebackup_read_file(fd, sink->bbs_buffer,
+								   Min(sink->bbs_buffer_length, remaining),
+								   (off_t) blkno * BLCKSZ, readfilename, true);
+
+		/*
+		 * If the file was truncated concurrently, send the missing blocks
+		 * anyway, as zeroes.  WAL replay will truncate the file again.
+		 */
+		if (cnt < BLCKSZ)
+		{
+			while (blkno < nblocks)
+				blocks[nincluded++] = blkno++;
+			break;
+		}
+
+		for (i = 0; i < cnt / BLCKSZ; i++)
+		{
+			char	   *page = sink->bbs_buffer + BLCKSZ * i;
+
+			if (PageIsNew(page) || PageGetLSN(page) >= incremental_lsn)
+				blocks[nincluded++] = blkno;
+			blkno++;
+		}
+	}
+
+	/* If almost every block changed, it's simpler to send the whole file. */
+	if (nincluded > nblocks - nblocks / 10)
+	{
+		pfree(blocks);
+		CloseTransientFile(fd);
+		return sendFile(sink, readfilename, tarfilename, statbuf, true, dboid,
+						manifest, spcoid);
+	}
+
+	if (pg_checksum_init(&checksum_ctx, manifest->checksum_type) < 0)
+		elog(ERROR, "could not initialize checksum of file \"%s\"",
+			 readfilename);
+
+	/* Name the file INCREMENTAL.<name>, in the same directory. */
+	lastsep = last_dir_separator(tarfilename);
+	Assert(lastsep != NULL);
+	snprintf(incrementalname, sizeof(incrementalname), "%.*s/%s%s",
+			 (int) (lastsep - tarfilename), tarfilename,
+			 INCREMENTAL_PREFIX, lastsep + 1);
+
+	memcpy(&incrementalstat, statbuf, sizeof(struct stat));
+	incrementalstat.st_size = sizeof(IncrementalFileHeader) +
+		sizeof(BlockNumber) * nincluded + (off_t) BLCKSZ * nincluded;
+
+	_tarWriteHeader(sink, incrementalname, NULL, &incrementalstat, false);
+
+	header.magic = INCREMENTAL_MAGIC;
+	header.num_blocks = nincluded;
+	header.truncation_block_length = nblocks;
+	sendIncrementalData(sink, (char *) &header, sizeof(header), &checksum_ctx);
+	sendIncrementalData(sink, (char *) blocks,
+						sizeof(BlockNumber) * nincluded, &checksum_ctx);
+	len = sizeof(header) + sizeof(BlockNumber) * nincluded;
+
+	/* Send the blocks, reading runs of consecutive blocks at once. */
+	for (i = 0; i < nincluded;)
+	{
+		int			nrun = 1;
+		off_t		cnt;
+
+		while (i + nrun < nincluded &&
+			   blocks[i + nrun] == blocks[i] + nrun &&
+			   (size_t) (nrun + 1) * BLCKSZ <= sink->bbs_buffer_length)
+			nrun++;
+
+		cnt = basebackup_read_file(fd, sink->bbs_buffer, (size_t) nrun * BLCKSZ,
+								   (off_t) blocks[i] * BLCKSZ, readfilename,
+								   true);
+
+		/* As above, zero-fill the blocks of a concurrently truncated file. */
+		if (cnt < (off_t) nrun * BLCKSZ)
+			MemSet(sink->bbs_buffer + cnt, 0, (size_t) nrun * BLCKSZ - cnt);
+
+		bbsink_archive_contents(sink, (size_t) nrun * BLCKSZ);
+		if (pg_checksum_update(&checksum_ctx, (uint8 *) sink->bbs_buffer,
+							   (size_t) nrun * BLCKSZ) < 0)
+			elog(ERROR, "could not update checksum of base backup");
+
+		len += (pgoff_t) nrun * BLCKSZ;
+		i += nrun;
+	}
+
+	Assert(len == incrementalstat.st_size);
+	_tarWritePadding(sink, len);
+
+	CloseTransientFile(fd);
+	pfree(blocks);
+
+	AddFileToBackupManifest(manifest, spcoid, incrementalname,
+							incrementalstat.st_size,
+							(pg_time_t) statbuf->st_mtime, &checksum_ctx);
+
+	return true;
+}
+
+/*
+ * Send the given data as part of the current file, updating its checksum.
+ */
+static void
+sendIncrementalData(bbsink *sink, const char *data, size_t len,
+					pg_checksum_context *checksum_ctx)
+{
+	while (len > 0)
+	{
+		size_t		nbytes = Min(sink->bbs_buffer_length, len);
+
+		memcpy(sink->bbs_buffer, data, nbytes);
+		bbsink_archive_contents(sink, nbytes);
+		if (pg_checksum_update(checksum_ctx, (uint8 *) sink->bbs_buffer,
+							   nbytes) < 0)
+			elog(ERROR, "could not update checksum of base backup");
+
+		data += nbytes;
+		len -= nbytes;
+	}
+}
+
 static int64
 _tarWriteHeader(bbsink *sink, const char *filename, const char *linktarget,
 				struct stat *statbuf, bool sizeonly)
@@ -0,0 +1,286 @@
+/*-------------------------------------------------------------------------
+ *
+ * basebackup_parallel.c
+ *	  Coordination of the streams of a parallel base backup.
+ *
+ * A parallel base backup is made of one leader and some parts, each of
+ * them running a BASE_BACKUP command in its own walsender.  The leader
+ * starts and stops the backup like any other base backup.  After starting
+ * it, it advertises the backup in a slot in shared memory, which the parts
+ * attach to using the leader's PID.  Each of them sends its share of the
+ * files, and the leader waits for all of them to be done before it stops the
+ * backup, so that the WAL needed to make the files consistent covers the
+ * whole time they were copied.
+ *
+ * Portions Copyright (c) 2010-2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/backup/basebackup_parallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "backup/basebackup_parallel.h"
+#include "libpq/libpq.h"
+#include "miscadmin.h"
+#include "replication/walsender.h"
+#include "storage/condition_variable.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/wait_event.h"
+
+/* One parallel base backup in progress */
+typedef struct ParallelBackupSlot
+{
+	int			leader_pid;		/* leader's PID, or 0 if the slot is free */
+	int			nparts;			/* number of streams, including the leader */
+	uint64		attached;		/* bitmap of the parts that have attached */
+	int			ndone;			/* number of parts that are done */
+	bool		failed;			/* did a part or the leader fail? */
+	XLogRecPtr	startptr;		/* start of the backup */
+	TimeLineID	starttli;
+} ParallelBackupSlot;
+
+typedef struct ParallelBackupShmemStruct
+{
+	slock_t		mutex;			/* protects all the slots */
+	ConditionVariable cv;		/* signaled when a part is done or fails */
+	ParallelBackupSlot slots[FLEXIBLE_ARRAY_MEMBER];
+} ParallelBackupShmemStruct;
+
+static ParallelBackupShmemStruct *ParallelBackupShmem = NULL;
+
+/*
+ * The slot this process uses, and whether it's as the leader.  A part also
+ * remembers the leader's PID, since the leader might release the slot, and
+ * another leader reuse it, if it fails while the part is still running.
+ */
+static ParallelBackupSlot *MySlot = NULL;
+static bool MySlotIsLeader = false;
+static int	MyLeaderPid = 0;
+
+
+/*
+ * Report shared memory space needed by BaseBackupParallelShmemInit
+ */
+Size
+BaseBackupParallelShmemSize(void)
+{
+	Size		size;
+
+	size = offsetof(ParallelBackupShmemStruct, slots);
+	size = add_size(size, mul_size(max_wal_senders,
+								   sizeof(ParallelBackupSlot)));
+	return size;
+}
+
+/*
+ * Allocate and initialize the slots of parallel base backups
+ */
+void
+BaseBackupParallelShmemInit(void)
+{
+	bool		found;
+
+	ParallelBackupShmem = (ParallelBackupShmemStruct *)
+		ShmemInitStruct("Parallel Base Backups",
+						BaseBackupParallelShmemSize(), &found);
+
+	if (!found)
+	{
+		memset(ParallelBackupShmem, 0, BaseBackupParallelShmemSize());
+		SpinLockInit(&ParallelBackupShmem->mutex);
+		ConditionVariableInit(&ParallelBackupShmem->cv);
+	}
+}
+
+/*
+ * ParallelBackupBegin
+ *		Advertise the backup this process just started, which will be sent
+ *		in nparts streams, this process sending the first one.
+ */
+void
+ParallelBackupBegin(int nparts, XLogRecPtr startptr, TimeLineID starttli)
+{
+	int			i;
+
+	Assert(MySlot == NULL);
+	Assert(nparts >= 2 && nparts <= 64);
+
+	SpinLockAcquire(&ParallelBackupShmem->mutex);
+	for (i = 0; i < max_wal_senders; i++)
+	{
+		ParallelBackupSlot *slot = &ParallelBackupShmem->slots[i];
+
+		if (slot->leader_pid == 0)
+		{
+			slot->leader_pid = MyProcPid;
+			slot->nparts = nparts;
+			slot->attached = 1;
+			slot->ndone = 0;
+			slot->failed = false;
+			slot->startptr = startptr;
+			slot->starttli = starttli;
+			MySlot = slot;
+			MySlotIsLeader = true;
+			break;
+		}
+	}
+	SpinLockRelease(&ParallelBackupShmem->mutex);
+
+	/* can't happen, since each backup needs a walsender */
+	if (MySlot == NULL)
+		elog(ERROR, "no free slot for parallel base backup");
+}
+
+/*
+ * ParallelBackupWaitForParts
+ *		Wait for all the other parts of the leader's backup to be sent.
+ *
+ * The parts are run by other connections of the same client, so we also
+ * give up if our own connection goes away while waiting.
+ */
+void
+ParallelBackupWaitForParts(void)
+{
+	Assert(MySlot != NULL && MySlotIsLeader);
+
+	for (;;)
+	{
+		int			ndone;
+		bool		failed;
+
+		SpinLockAcquire(&ParallelBackupShmem->mutex);
+		ndone = MySlot->ndone;
+		failed = MySlot->failed;
+		SpinLockRelease(&ParallelBackupShmem->mutex);
+
+		if (failed)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("another stream of the parallel base backup failed")));
+		if (ndone == MySlot->nparts - 1)
+			break;
+
+		if (ConditionVariableTimedSleep(&ParallelBackupShmem->cv, 1000L,
+										WAIT_EVENT_BACKUP_WAIT_PARTS) &&
+			!pq_check_connection())
+			ereport(ERROR,
+					(errcode(ERRCODE_CONNECTION_FAILURE),
+					 errmsg("connection lost while waiting for the other streams of the parallel base backup")));
+	}
+	ConditionVariableCancelSleep();
+}
+
+/*
+ * ParallelBackupEnd
+ *		Release the leader's slot, once the backup is stopped.
+ */
+void
+ParallelBackupEnd(void)
+{
+	Assert(MySlot != NULL && MySlotIsLeader);
+
+	SpinLockAcquire(&ParallelBackupShmem->mutex);
+	MySlot->leader_pid = 0;
+	SpinLockRelease(&ParallelBackupShmem->mutex);
+
+	MySlot = NULL;
+}
+
+/*
+ * ParallelBackupAttach
+ *		Attach to the backup of the given leader, to send the given part of
+ *		it, and return where the backup started.
+ */
+void
+ParallelBackupAttach(int leader_pid, int part, int nparts,
+					 XLogRecPtr *startptr, TimeLineID *starttli)
+{
+	int			i;
+	bool		found = false;
+	bool		mismatch = false;
+
+	Assert(MySlot == NULL);
+
+	SpinLockAcquire(&ParallelBackupShmem->mutex);
+	for (i = 0; i < max_wal_senders; i++)
+	{
+		ParallelBackupSlot *slot = &ParallelBackupShmem->slots[i];
+
+		if (slot->leader_pid != leader_pid || leader_pid == 0)
+			continue;
+
+		found = true;
+		if (slot->nparts != nparts || part < 1 || part >= nparts ||
+			(slot->attached & (UINT64CONST(1) << part)) != 0 || slot->failed)
+		{
+			mismatch = true;
+			break;
+		}
+
+		slot->attached |= UINT64CONST(1) << part;
+		*startptr = slot->startptr;
+		*starttli = slot->starttli;
+		MySlot = slot;
+		MySlotIsLeader = false;
+		MyLeaderPid = leader_pid;
+		break;
+	}
+	SpinLockRelease(&ParallelBackupShmem->mutex);
+
+	if (!found)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("no parallel base backup is in progress for leader process %d",
+						leader_pid)));
+	if (mismatch)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("part %d of %d of the parallel base backup of leader process %d cannot be sent",
+						part, nparts, leader_pid)));
+}
+
+/*
+ * ParallelBackupPartDone
+ *		Report that this process has sent its part of the backup.
+ */
+void
+ParallelBackupPartDone(void)
+{
+	Assert(MySlot != NULL && !MySlotIsLeader);
+
+	SpinLockAcquire(&ParallelBackupShmem->mutex);
+	if (MySlot->leader_pid == MyLeaderPid)
+		MySlot->ndone++;
+	SpinLockRelease(&ParallelBackupShmem->mutex);
+
+	MySlot = NULL;
+	ConditionVariableBroadcast(&ParallelBackupShmem->cv);
+}
+
+/*
+ * ParallelBackupAbort
+ *		Give up on the parallel base backup this process takes part in, if
+ *		any.  Called on error.
+ *
+ * If we're the leader, the slot is released, which makes the parts that
+ * haven't attached yet fail.  Otherwise the leader is told to fail.
+ */
+void
+ParallelBackupAbort(void)
+{
+	if (MySlot == NULL)
+		return;
+
+	SpinLockAcquire(&ParallelBackupShmem->mutex);
+	if (MySlotIsLeader)
+		MySlot->leader_pid = 0;
+	else if (MySlot->leader_pid == MyLeaderPid)
+		MySlot->failed = true;
+	SpinLockRelease(&ParallelBackupShmem->mutex);
+
+	MySlot = NULL;
+	ConditionVariableBroadcast(&ParallelBackupShmem->cv);
+}
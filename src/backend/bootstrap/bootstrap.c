@@ -322,6 +322,7 @@ BootstrapModeMain(int argc, char *argv[], bool check_only)
 	IgnoreSystemIndexes = true;
 
 	InitializeMaxBackends();
+	InitializeFastPathLocks();
 
 	CreateSharedMemoryAndSemaphores();
 
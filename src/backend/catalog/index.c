@@ -2976,12 +2976,12 @@ index_build(Relation heapRelation,
 
 	/*
 	 * Determine worker process details for parallel CREATE INDEX.  Currently,
-	 * only btree has support for parallel builds.
+	 * only btree, GIN, GiST, hash and BRIN have support for parallel builds.
 	 *
 	 * Note that planner considers parallel safety for us.
 	 */
 	if (parallel && IsNormalProcessingMode() &&
-		indexRelation->rd_rel->relam == BTREE_AM_OID)
+		indexRelation->rd_indam->amcanbuildparallel)
 		indexInfo->ii_ParallelWorkers =
 			plan_create_index_workers(RelationGetRelid(heapRelation),
 									  RelationGetRelid(indexRelation));
@@ -3300,10 +3300,16 @@ IndexCheckExclusion(Relation heapRelation,
  * Doing two full table scans is a brute-force strategy.  We could try to be
  * cleverer, eg storing new tuples in a special area of the table (perhaps
  * making the table append-only by setting use_fsm).  However that would
- * add yet more locking issues.
+ * add yet more locking issues.  What we do instead is let the caller pass
+ * 'startlsn', the WAL insert position read before the first wait above.
+ * Every transaction that modified the table after that point saw the index
+ * in its list of indexes, and every earlier one has been waited out before
+ * the build snapshot was taken, so a WAL-logged heap page whose LSN is older
+ * than 'startlsn' holds no tuples missing from the index.  The table AM may
+ * skip merging such pages.  Pass InvalidXLogRecPtr to examine every page.
  */
 void
-validate_index(Oid heapId, Oid indexId, Snapshot snapshot)
+validate_index(Oid heapId, Oid indexId, Snapshot snapshot, XLogRecPtr startlsn)
 {
 	Relation	heapRelation,
 				indexRelation;
@@ -3378,6 +3384,9 @@ validate_index(Oid heapId, Oid indexId, Snapshot snapshot)
 											NULL, TUPLESORT_NONE);
 	state.htups = state.itups = state.tups_inserted = 0;
 
+	/* Page LSNs mean nothing for a relation that isn't WAL-logged */
+	state.startlsn = RelationNeedsWAL(heapRelation) ? startlsn : InvalidXLogRecPtr;
+
 	/* ambulkdelete updates progress metrics */
 	(void) index_bulk_delete(&ivinfo, NULL,
 							 validate_index_callback, (void *) &state);
@@ -399,6 +399,21 @@ CREATE OR REPLACE FUNCTION
   RETURNS boolean STRICT VOLATILE LANGUAGE INTERNAL AS 'pg_promote'
   PARALLEL SAFE;
 
+CREATE OR REPLACE FUNCTION
+  pg_enable_data_checksums(cost_delay integer DEFAULT 0,
+                           cost_limit integer DEFAULT 100)
+  RETURNS void STRICT VOLATILE LANGUAGE INTERNAL AS 'enable_data_checksums'
+  PARALLEL RESTRICTED;
+
+CREATE OR REPLACE FUNCTION pg_get_process_memory_contexts (
+        pid integer, timeout float8 DEFAULT 5,
+        OUT name text, OUT ident text, OUT parent text, OUT level integer,
+        OUT type text, OUT total_bytes int8, OUT total_nblocks int8,
+        OUT free_bytes int8, OUT free_chunks int8, OUT used_bytes int8)
+  RETURNS SETOF record STRICT VOLATILE LANGUAGE internal
+  AS 'pg_get_process_memory_contexts'
+  PARALLEL RESTRICTED ROWS 100;
+
 CREATE OR REPLACE FUNCTION
   pg_terminate_backend(pid integer, timeout int8 DEFAULT 0)
   RETURNS boolean STRICT VOLATILE LANGUAGE INTERNAL AS 'pg_terminate_backend'
@@ -658,6 +673,10 @@ REVOKE EXECUTE ON FUNCTION pg_current_logfile(text) FROM public;
 
 REVOKE EXECUTE ON FUNCTION pg_promote(boolean, integer) FROM public;
 
+REVOKE EXECUTE ON FUNCTION pg_enable_data_checksums(integer, integer) FROM public;
+
+REVOKE EXECUTE ON FUNCTION pg_disable_data_checksums() FROM public;
+
 REVOKE EXECUTE ON FUNCTION pg_stat_reset() FROM public;
 
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_shared(text) FROM public;
@@ -674,6 +693,8 @@ REVOKE EXECUTE ON FUNCTION pg_stat_have_stats(text, oid, oid) FROM public;
 
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_subscription_stats(oid) FROM public;
 
+REVOKE EXECUTE ON FUNCTION pg_stat_reset_query_samples() FROM public;
+
 REVOKE EXECUTE ON FUNCTION lo_import(text) FROM public;
 
 REVOKE EXECUTE ON FUNCTION lo_import(text, oid) FROM public;
@@ -740,6 +761,9 @@ REVOKE EXECUTE ON FUNCTION pg_ls_dir(text,boolean,boolean) FROM public;
 
 REVOKE EXECUTE ON FUNCTION pg_log_backend_memory_contexts(integer) FROM PUBLIC;
 
+REVOKE EXECUTE ON FUNCTION pg_get_process_memory_contexts(integer, float8) FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION pg_get_process_memory_contexts(integer, float8) TO pg_read_all_stats;
+
 REVOKE EXECUTE ON FUNCTION pg_ls_logicalsnapdir() FROM PUBLIC;
 
 REVOKE EXECUTE ON FUNCTION pg_ls_logicalmapdir() FROM PUBLIC;
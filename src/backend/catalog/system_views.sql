@@ -909,6 +909,29 @@ CREATE VIEW pg_stat_slru AS
             s.stats_reset
     FROM pg_stat_get_slru() s;
 
+CREATE VIEW pg_stat_lwlock AS
+    SELECT
+            s.name,
+            s.acquires,
+            s.contended,
+            s.spin_acquires,
+            s.waits,
+            s.wait_time,
+            s.max_wait_time,
+            s.stats_reset
+    FROM pg_stat_get_lwlock() s;
+
+CREATE VIEW pg_stat_query_samples AS
+    SELECT
+            s.dbid,
+            s.queryid,
+            s.plan_node_id,
+            s.node_type,
+            s.wait_event_type,
+            s.wait_event,
+            s.samples
+    FROM pg_stat_get_query_samples() s;
+
 CREATE VIEW pg_stat_wal_receiver AS
     SELECT
             s.pid,
@@ -938,6 +961,9 @@ CREATE VIEW pg_stat_recovery_prefetch AS
             s.skip_new,
             s.skip_fpw,
             s.skip_rep,
+            s.records_no_block,
+            s.records_single_block,
+            s.records_multi_block,
             s.wal_distance,
             s.block_distance,
             s.io_depth
@@ -1050,6 +1076,7 @@ CREATE VIEW pg_stat_database AS
             pg_stat_get_db_sessions_abandoned(D.oid) AS sessions_abandoned,
             pg_stat_get_db_sessions_fatal(D.oid) AS sessions_fatal,
             pg_stat_get_db_sessions_killed(D.oid) AS sessions_killed,
+            pg_stat_get_db_cache_resets(D.oid) AS cache_resets,
             pg_stat_get_db_stat_reset_time(D.oid) AS stats_reset
     FROM (
         SELECT 0 AS oid, NULL::name AS datname
@@ -1065,7 +1092,8 @@ CREATE VIEW pg_stat_database_conflicts AS
             pg_stat_get_db_conflict_lock(D.oid) AS confl_lock,
             pg_stat_get_db_conflict_snapshot(D.oid) AS confl_snapshot,
             pg_stat_get_db_conflict_bufferpin(D.oid) AS confl_bufferpin,
-            pg_stat_get_db_conflict_startup_deadlock(D.oid) AS confl_deadlock
+            pg_stat_get_db_conflict_startup_deadlock(D.oid) AS confl_deadlock,
+            pg_stat_get_db_conflict_snapshot_deferred(D.oid) AS confl_snapshot_deferred
     FROM pg_database D;
 
 CREATE VIEW pg_stat_user_functions AS
@@ -1140,6 +1168,7 @@ CREATE VIEW pg_stat_wal AS
         w.wal_buffers_full,
         w.wal_write,
         w.wal_sync,
+        w.wal_sync_grouped,
         w.wal_write_time,
         w.wal_sync_time,
         w.stats_reset
@@ -1180,7 +1209,8 @@ CREATE VIEW pg_stat_progress_vacuum AS
                       END AS phase,
         S.param2 AS heap_blks_total, S.param3 AS heap_blks_scanned,
         S.param4 AS heap_blks_vacuumed, S.param5 AS index_vacuum_count,
-        S.param6 AS max_dead_tuples, S.param7 AS num_dead_tuples
+        S.param6 AS max_dead_tuple_bytes, S.param7 AS dead_tuple_bytes,
+        S.param8 AS num_dead_item_ids
     FROM pg_stat_get_progress_info('VACUUM') AS S
         LEFT JOIN pg_database D ON S.datid = D.oid;
 
@@ -194,6 +194,37 @@ analyze_rel(Oid relid, RangeVar *relation,
 		return;
 	}
 
+	/*
+	 * With SKIP_UNCHANGED, skip tables that have been analyzed before and not
+	 * modified since, according to the cumulative statistics.  Tables with
+	 * inheritance children are always processed, since the children might
+	 * have changed, and so are explicit column lists, which might name
+	 * columns that have not been analyzed.
+	 */
+	if ((params->options & VACOPT_SKIP_UNCHANGED) &&
+		va_cols == NIL &&
+		(onerel->rd_rel->relkind == RELKIND_RELATION ||
+		 onerel->rd_rel->relkind == RELKIND_MATVIEW) &&
+		!onerel->rd_rel->relhassubclass)
+	{
+		PgStat_StatTabEntry *tabentry;
+
+		tabentry = pgstat_fetch_stat_tabentry_ext(onerel->rd_rel->relisshared,
+												  RelationGetRelid(onerel));
+		if (tabentry != NULL &&
+			tabentry->mod_since_analyze == 0 &&
+			(tabentry->last_analyze_time != 0 ||
+			 tabentry->last_autoanalyze_time != 0))
+		{
+			ereport(elevel,
+					(errmsg("skipping \"%s.%s\" --- not modified since it was last analyzed",
+							get_namespace_name(RelationGetNamespace(onerel)),
+							RelationGetRelationName(onerel))));
+			relation_close(onerel, ShareUpdateExclusiveLock);
+			return;
+		}
+	}
+
 	/*
 	 * Check that it's of an analyzable relkind, and set up appropriately.
 	 */
@@ -72,10 +72,11 @@
  *	  Then we signal any backends that may be interested in our messages
  *	  (including our own backend, if listening).  This is done by
  *	  SignalBackends(), which scans the list of listening backends and sends a
- *	  PROCSIG_NOTIFY_INTERRUPT signal to every listening backend (we don't
- *	  know which backend is listening on which channel so we must signal them
- *	  all).  We can exclude backends that are already up to date, though, and
- *	  we can also exclude backends that are in other databases (unless they
+ *	  PROCSIG_NOTIFY_INTERRUPT signal to listening backends.  Each listener
+ *	  advertises a bitmask of hashed channel names in shared memory, so we
+ *	  only need to signal those whose mask overlaps the channels we notified
+ *	  on.  We can also exclude backends that are already up to date, and
+ *	  backends that are in other databases or not interested (unless they
  *	  are way behind and should be kicked to make them advance their
  *	  pointers).
  *
@@ -117,7 +118,7 @@
  * frontend during startup.)  The above design guarantees that notifies from
  * other backends will never be missed by ignoring self-notifies.
  *
- * The amount of shared memory used for notify management (NUM_NOTIFY_BUFFERS)
+ * The amount of shared memory used for notify management (notify_buffers)
  * can be varied without affecting anything but performance.  The maximum
  * amount of notification data that can be queued at one time is determined
  * by slru.c's wraparound limit; see QUEUE_MAX_PAGE below.
@@ -149,6 +150,7 @@
 #include "storage/sinval.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
+#include "utils/guc_hooks.h"
 #include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/snapmgr.h"
@@ -235,7 +237,7 @@ typedef struct QueuePosition
  *
  * Resist the temptation to make this really large.  While that would save
  * work in some places, it would add cost in others.  In particular, this
- * should likely be less than NUM_NOTIFY_BUFFERS, to ensure that backends
+ * should likely be less than notify_buffers, to ensure that backends
  * catch up before the pages they'll need to read fall out of SLRU cache.
  */
 #define QUEUE_CLEANUP_DELAY 4
@@ -249,8 +251,21 @@ typedef struct QueueBackendStatus
 	Oid			dboid;			/* backend's database OID, or InvalidOid */
 	BackendId	nextListener;	/* id of next listener, or InvalidBackendId */
 	QueuePosition pos;			/* backend has read queue up to here */
+	uint64		channels;		/* CHANNEL_BIT()s of channels listened on */
 } QueueBackendStatus;
 
+/*
+ * Each listener advertises the channels it listens on as a 64-bit mask of
+ * hashed channel names, so that a notifying backend can skip waking up
+ * listeners that certainly aren't interested in its notifications.  The mask
+ * may have extra bits set (hash collisions, or channels that were just
+ * unlistened), which only costs a needless wakeup; it must never lack the bit
+ * of a channel being listened on.
+ */
+#define CHANNEL_BIT(channel) \
+	(UINT64CONST(1) << (hash_bytes((const unsigned char *) (channel), \
+								   strlen(channel)) % 64))
+
 /*
  * Shared memory state for LISTEN/NOTIFY (excluding its SLRU stuff)
  *
@@ -304,6 +319,7 @@ static AsyncQueueControl *asyncQueueControl;
 #define QUEUE_BACKEND_DBOID(i)		(asyncQueueControl->backend[i].dboid)
 #define QUEUE_NEXT_LISTENER(i)		(asyncQueueControl->backend[i].nextListener)
 #define QUEUE_BACKEND_POS(i)		(asyncQueueControl->backend[i].pos)
+#define QUEUE_BACKEND_CHANNELS(i)	(asyncQueueControl->backend[i].channels)
 
 /*
  * The SLRU buffer area through which we access the notification queue
@@ -521,7 +537,7 @@ AsyncShmemSize(void)
 	size = mul_size(MaxBackends + 1, sizeof(QueueBackendStatus));
 	size = add_size(size, offsetof(AsyncQueueControl, backend));
 
-	size = add_size(size, SimpleLruShmemSize(NUM_NOTIFY_BUFFERS, 0));
+	size = add_size(size, SimpleLruShmemSize(notify_buffers, 0));
 
 	return size;
 }
@@ -562,6 +578,7 @@ AsyncShmemInit(void)
 			QUEUE_BACKEND_DBOID(i) = InvalidOid;
 			QUEUE_NEXT_LISTENER(i) = InvalidBackendId;
 			SET_QUEUE_POS(QUEUE_BACKEND_POS(i), 0, 0);
+			QUEUE_BACKEND_CHANNELS(i) = 0;
 		}
 	}
 
@@ -569,7 +586,7 @@ AsyncShmemInit(void)
 	 * Set up SLRU management of the pg_notify data.
 	 */
 	NotifyCtl->PagePrecedes = asyncQueuePagePrecedes;
-	SimpleLruInit(NotifyCtl, "Notify", NUM_NOTIFY_BUFFERS, 0,
+	SimpleLruInit(NotifyCtl, "Notify", notify_buffers, 0,
 				  NotifySLRULock, "pg_notify", LWTRANCHE_NOTIFY_BUFFER,
 				  SYNC_HANDLER_NONE);
 
@@ -582,6 +599,15 @@ AsyncShmemInit(void)
 	}
 }
 
+/*
+ * GUC check_hook for notify_buffers
+ */
+bool
+check_notify_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("notify_buffers", newval);
+}
+
 
 /*
  * pg_notify -
@@ -813,6 +839,17 @@ Async_UnlistenAll(void)
 	queue_listen(LISTEN_UNLISTEN_ALL, "");
 }
 
+/*
+ * HaveListenChannels
+ *
+ *		Is this backend listening on any channel?
+ */
+bool
+HaveListenChannels(void)
+{
+	return listenChannels != NIL;
+}
+
 /*
  * SQL function: return a set of the channel names this backend is actively
  * listening to.
@@ -905,6 +942,8 @@ PreCommit_Notify(void)
 	/* Preflight for any pending listen/unlisten actions */
 	if (pendingActions != NULL)
 	{
+		uint64		newchannels = 0;
+
 		foreach(p, pendingActions->actions)
 		{
 			ListenAction *actrec = (ListenAction *) lfirst(p);
@@ -913,6 +952,7 @@ PreCommit_Notify(void)
 			{
 				case LISTEN_LISTEN:
 					Exec_ListenPreCommit();
+					newchannels |= CHANNEL_BIT(actrec->channel);
 					break;
 				case LISTEN_UNLISTEN:
 					/* there is no Exec_UnlistenPreCommit() */
@@ -922,6 +962,18 @@ PreCommit_Notify(void)
 					break;
 			}
 		}
+
+		/*
+		 * Advertise the new channels before we commit, so that nobody who
+		 * commits a notification after us fails to wake us up for it.
+		 * Channels are only removed from the mask after commit.
+		 */
+		if (newchannels != 0)
+		{
+			LWLockAcquire(NotifyQueueLock, LW_EXCLUSIVE);
+			QUEUE_BACKEND_CHANNELS(MyBackendId) |= newchannels;
+			LWLockRelease(NotifyQueueLock);
+		}
 	}
 
 	/* Queue any pending notifies (must happen after the above) */
@@ -1038,6 +1090,18 @@ AtCommit_Notify(void)
 	/* If no longer listening to anything, get out of listener array */
 	if (amRegisteredListener && listenChannels == NIL)
 		asyncQueueUnregister();
+	else if (amRegisteredListener && pendingActions != NULL)
+	{
+		/* Drop bits of any channels we stopped listening on */
+		uint64		channels = 0;
+
+		foreach(p, listenChannels)
+			channels |= CHANNEL_BIT((char *) lfirst(p));
+
+		LWLockAcquire(NotifyQueueLock, LW_EXCLUSIVE);
+		QUEUE_BACKEND_CHANNELS(MyBackendId) = channels;
+		LWLockRelease(NotifyQueueLock);
+	}
 
 	/*
 	 * Send signals to listening backends.  We need do this only if there are
@@ -1276,6 +1340,7 @@ asyncQueueUnregister(void)
 	/* Mark our entry as invalid */
 	QUEUE_BACKEND_PID(MyBackendId) = InvalidPid;
 	QUEUE_BACKEND_DBOID(MyBackendId) = InvalidOid;
+	QUEUE_BACKEND_CHANNELS(MyBackendId) = 0;
 	/* and remove it from the list */
 	if (QUEUE_FIRST_LISTENER == MyBackendId)
 		QUEUE_FIRST_LISTENER = QUEUE_NEXT_LISTENER(MyBackendId);
@@ -1632,6 +1697,16 @@ SignalBackends(void)
 	int32	   *pids;
 	BackendId  *ids;
 	int			count;
+	uint64		channels = 0;
+	ListCell   *p;
+
+	/* Compute the mask of channels we've sent notifications on */
+	foreach(p, pendingNotifies->events)
+	{
+		Notification *n = (Notification *) lfirst(p);
+
+		channels |= CHANNEL_BIT(n->data);
+	}
 
 	/*
 	 * Identify backends that we need to signal.  We don't want to send
@@ -1653,11 +1728,13 @@ SignalBackends(void)
 
 		Assert(pid != InvalidPid);
 		pos = QUEUE_BACKEND_POS(i);
-		if (QUEUE_BACKEND_DBOID(i) == MyDatabaseId)
+		if (QUEUE_BACKEND_DBOID(i) == MyDatabaseId &&
+			(QUEUE_BACKEND_CHANNELS(i) & channels) != 0)
 		{
 			/*
-			 * Always signal listeners in our own database, unless they're
-			 * already caught up (unlikely, but possible).
+			 * Always signal listeners in our own database that may listen on
+			 * one of our channels, unless they're already caught up
+			 * (unlikely, but possible).
 			 */
 			if (QUEUE_POS_EQUAL(pos, QUEUE_HEAD))
 				continue;
@@ -1665,8 +1742,9 @@ SignalBackends(void)
 		else
 		{
 			/*
-			 * Listeners in other databases should be signaled only if they
-			 * are far behind.
+			 * Listeners in other databases, or not listening on any of our
+			 * channels, should be signaled only if they are far behind, so
+			 * that they advance their position and let the queue tail move.
 			 */
 			if (asyncQueuePageDiff(QUEUE_POS_PAGE(QUEUE_HEAD),
 								   QUEUE_POS_PAGE(pos)) < QUEUE_CLEANUP_DELAY)
@@ -398,6 +398,7 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 		int			ti_options = miinfo->ti_options;
 		bool		line_buf_valid = cstate->line_buf_valid;
 		uint64		save_cur_lineno = cstate->cur_lineno;
+		bool	   *batchedIndexes = NULL;
 		MemoryContext oldcontext;
 
 		Assert(buffer->bistate != NULL);
@@ -421,11 +422,24 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 						   buffer->bistate);
 		MemoryContextSwitchTo(oldcontext);
 
+		/*
+		 * Insert the tuples into the indexes that can take the whole batch at
+		 * once.  An error here can't be attributed to a single line.
+		 */
+		if (resultRelInfo->ri_NumIndices > 0)
+		{
+			cstate->relname_only = true;
+			batchedIndexes = ExecInsertIndexTuplesBatch(resultRelInfo,
+														buffer->slots, nused,
+														estate);
+			cstate->relname_only = false;
+		}
+
 		for (i = 0; i < nused; i++)
 		{
 			/*
-			 * If there are any indexes, update them for all the inserted
-			 * tuples, and run AFTER ROW INSERT triggers.
+			 * If there are any indexes, update the rest of them for all the
+			 * inserted tuples, and run AFTER ROW INSERT triggers.
 			 */
 			if (resultRelInfo->ri_NumIndices > 0)
 			{
@@ -433,9 +447,9 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 
 				cstate->cur_lineno = buffer->linenos[i];
 				recheckIndexes =
-					ExecInsertIndexTuples(resultRelInfo,
-										  buffer->slots[i], estate, false,
-										  false, NULL, NIL);
+					ExecInsertUnbatchedIndexTuples(resultRelInfo,
+												   buffer->slots[i], estate,
+												   batchedIndexes);
 				ExecARInsertTriggers(estate, resultRelInfo,
 									 slots[i], recheckIndexes,
 									 cstate->transition_capture);
@@ -459,6 +473,9 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 			ExecClearTuple(slots[i]);
 		}
 
+		if (batchedIndexes)
+			pfree(batchedIndexes);
+
 		/* Update the row counter and progress of the COPY command */
 		*processed += nused;
 		pgstat_progress_update_param(PROGRESS_COPY_TUPLES_PROCESSED,
@@ -656,6 +673,17 @@ CopyFrom(CopyFromState cstate)
 	Assert(cstate->rel);
 	Assert(list_length(cstate->range_table) == 1);
 
+	/*
+	 * Hand the work over to parallel workers, if requested and possible.
+	 * The workers run this function too, reading lines from the leader.
+	 */
+	if (cstate->opts.parallel_workers > 0 && cstate->pcopy_mqh == NULL &&
+		ParallelCopyFromIsSafe(cstate))
+	{
+		FreeExecutorState(estate);
+		return ParallelCopyFrom(cstate);
+	}
+
 	/*
 	 * The target must be a plain, foreign, or partitioned relation, or have
 	 * an INSTEAD OF INSERT row trigger.  (Currently, such triggers are only
@@ -700,6 +728,10 @@ CopyFrom(CopyFromState cstate)
 		 cstate->rel->rd_firstRelfilelocatorSubid != InvalidSubTransactionId))
 		ti_options |= TABLE_INSERT_SKIP_FSM;
 
+	/* In a parallel COPY worker, ParallelCopyFromIsSafe() vetted the target */
+	if (cstate->pcopy_mqh != NULL)
+		ti_options |= TABLE_INSERT_PARALLEL;
+
 	/*
 	 * Optimize if new relation storage was created in this subxact or one of
 	 * its committed children and we won't see those rows later as part of an
@@ -1248,7 +1280,8 @@ CopyFrom(CopyFromState cstate)
 																   false,
 																   false,
 																   NULL,
-																   NIL);
+																   NIL,
+																   false);
 					}
 
 					/* AFTER ROW INSERT Triggers */
@@ -1485,6 +1518,8 @@ BeginCopyFrom(ParseState *pstate,
 	cstate->copy_src = COPY_FILE;	/* default */
 
 	cstate->whereClause = whereClause;
+	cstate->attnamelist = attnamelist;
+	cstate->options = options;
 
 	/* Initialize state variables */
 	cstate->eol_type = EOL_UNKNOWN;
@@ -0,0 +1,552 @@
+/*-------------------------------------------------------------------------
+ *
+ * copyfromparallel.c
+ *		Parallel COPY FROM support.
+ *
+ * With the PARALLEL option, COPY FROM can hand the work of converting input
+ * lines to tuples and inserting them to a number of parallel workers.  The
+ * leader reads the input, performs encoding conversion, splits the input
+ * into lines and checks the header line, exactly like a serial COPY FROM
+ * does.  The lines are then passed to the workers in chunks through one
+ * shm_mq per worker, round-robin.  Each worker runs a regular CopyFrom(),
+ * except that NextCopyFromLine() receives the lines from its queue rather
+ * than reading them from the input.  Parsing the fields, calling the input
+ * functions, evaluating defaults, constraints and the WHERE clause, and
+ * inserting into the table and its indexes all happen in the workers.
+ *
+ * The workers insert into the table using the leader's transaction and
+ * command ID, so the rows they insert become visible together with
+ * anything the leader does.  Since each worker inserts the lines it is
+ * given independently, the rows are not necessarily stored in input order.
+ *
+ * A parallel COPY FROM is only attempted when everything the workers need to
+ * do is known to be parallel safe.  Otherwise, or if no workers could be
+ * launched, we silently fall back to a serial COPY FROM.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/commands/copyfromparallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/parallel.h"
+#include "access/table.h"
+#include "access/xact.h"
+#include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
+#include "commands/copy.h"
+#include "commands/copyfrom_internal.h"
+#include "commands/progress.h"
+#include "executor/instrument.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "optimizer/clauses.h"
+#include "parser/parse_node.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "tcop/tcopprot.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+
+/* Magic numbers for parallel COPY state sharing */
+#define PARALLEL_COPY_KEY_SHARED		UINT64CONST(0xC000000000000001)
+#define PARALLEL_COPY_KEY_STATE			UINT64CONST(0xC000000000000002)
+#define PARALLEL_COPY_KEY_QUEUES		UINT64CONST(0xC000000000000003)
+#define PARALLEL_COPY_KEY_QUERY_TEXT	UINT64CONST(0xC000000000000004)
+#define PARALLEL_COPY_KEY_WAL_USAGE		UINT64CONST(0xC000000000000005)
+#define PARALLEL_COPY_KEY_BUFFER_USAGE	UINT64CONST(0xC000000000000006)
+
+/* Size of each worker's input queue */
+#define PARALLEL_COPY_QUEUE_SIZE		(256 * 1024)
+
+/* Lines are sent to the workers in chunks of about this size */
+#define PARALLEL_COPY_CHUNK_SIZE		(64 * 1024)
+
+/*
+ * Status shared between the leader and the workers.
+ */
+typedef struct ParallelCopyShared
+{
+	Oid			relid;			/* target relation */
+	pg_atomic_uint64 processed; /* # of tuples inserted by all workers */
+} ParallelCopyShared;
+
+/*
+ * A chunk consists of a number of lines, each one preceded by this header.
+ * The line itself does not include the end-of-line marker.
+ */
+typedef struct ParallelCopyLine
+{
+	uint64		lineno;			/* line number, for error messages */
+	uint32		len;			/* length of the line that follows */
+} ParallelCopyLine;
+
+static bool ParallelCopyExprIsSafe(Node *node);
+static int	ParallelCopyNoData(void *outbuf, int minread, int maxread);
+static void ParallelCopySendChunk(ParallelContext *pcxt,
+								  shm_mq_handle *mqh, StringInfo chunk);
+
+
+/*
+ * Is the expression safe to be evaluated in a parallel worker?
+ */
+static bool
+ParallelCopyExprIsSafe(Node *node)
+{
+	return max_parallel_hazard_expr(node) == PROPARALLEL_SAFE;
+}
+
+/*
+ * Can the COPY FROM described by cstate be performed by parallel workers?
+ */
+bool
+ParallelCopyFromIsSafe(CopyFromState cstate)
+{
+	Relation	rel = cstate->rel;
+	TupleDesc	tupDesc = RelationGetDescr(rel);
+	TupleConstr *constr = tupDesc->constr;
+	List	   *indexoidlist;
+	ListCell   *lc;
+	bool		safe = true;
+
+	/* We can't start a parallel operation from within one */
+	if (IsInParallelMode())
+		return false;
+
+	/*
+	 * Only plain relations without triggers are supported.  Triggers might
+	 * do anything, and foreign keys and deferred uniqueness checks rely on
+	 * queueing trigger events, which workers cannot do.  Workers cannot
+	 * access the leader's local buffers, either.
+	 */
+	if (rel->rd_rel->relkind != RELKIND_RELATION ||
+		RelationUsesLocalBuffers(rel) ||
+		rel->trigdesc != NULL)
+		return false;
+
+	/*
+	 * The optimizations for a relation created or truncated in the current
+	 * (sub)transaction rely on everything being done by a single backend.
+	 */
+	if (rel->rd_createSubid != InvalidSubTransactionId ||
+		rel->rd_firstRelfilelocatorSubid != InvalidSubTransactionId)
+		return false;
+
+	if (cstate->opts.freeze || IsolationIsSerializable())
+		return false;
+
+	/* The input functions of the columns read from the input */
+	foreach(lc, cstate->attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+		Form_pg_attribute att = TupleDescAttr(tupDesc, attnum - 1);
+
+		/* Domain constraints might call anything */
+		if (get_typtype(att->atttypid) == TYPTYPE_DOMAIN ||
+			func_parallel(cstate->in_functions[attnum - 1].fn_oid) != PROPARALLEL_SAFE)
+			return false;
+	}
+
+	/* Default expressions of the columns not read from the input */
+	for (int i = 0; i < cstate->num_defaults; i++)
+	{
+		if (!ParallelCopyExprIsSafe((Node *) cstate->defexprs[i]->expr))
+			return false;
+	}
+
+	/* Generated columns and check constraints */
+	if (constr != NULL)
+	{
+		for (int i = 0; i < constr->num_defval; i++)
+		{
+			Form_pg_attribute att = TupleDescAttr(tupDesc,
+												  constr->defval[i].adnum - 1);
+
+			if (att->attgenerated &&
+				!ParallelCopyExprIsSafe(stringToNode(constr->defval[i].adbin)))
+				return false;
+		}
+
+		for (int i = 0; i < constr->num_check; i++)
+		{
+			if (!ParallelCopyExprIsSafe(stringToNode(constr->check[i].ccbin)))
+				return false;
+		}
+	}
+
+	if (cstate->whereClause && !ParallelCopyExprIsSafe(cstate->whereClause))
+		return false;
+
+	/* Index expressions and predicates */
+	indexoidlist = RelationGetIndexList(rel);
+	foreach(lc, indexoidlist)
+	{
+		Relation	indexRel = index_open(lfirst_oid(lc), RowExclusiveLock);
+
+		if (!ParallelCopyExprIsSafe((Node *) RelationGetIndexExpressions(indexRel)) ||
+			!ParallelCopyExprIsSafe((Node *) RelationGetIndexPredicate(indexRel)))
+			safe = false;
+
+		index_close(indexRel, NoLock);
+
+		if (!safe)
+			break;
+	}
+	list_free(indexoidlist);
+
+	return safe;
+}
+
+/*
+ * Perform a COPY FROM using parallel workers.
+ *
+ * Returns the number of tuples inserted, like CopyFrom().  If no workers can
+ * be launched, the COPY is performed serially.
+ */
+uint64
+ParallelCopyFrom(CopyFromState cstate)
+{
+	ParallelContext *pcxt;
+	ParallelCopyShared *shared;
+	List	   *workeroptions = NIL;
+	char	   *state;
+	char	   *sharedstate;
+	char	   *sharedquery = NULL;
+	char	   *queues;
+	shm_mq_handle **mqh;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	ErrorContextCallback errcallback;
+	StringInfoData chunk;
+	ParallelCopyLine hdr;
+	int			nworkers = cstate->opts.parallel_workers;
+	int			nlaunched;
+	int			next = 0;
+	int			querylen = 0;
+	uint64		processed;
+	ListCell   *lc;
+
+	/*
+	 * The workers get the same options as the leader, except that they don't
+	 * see the header line and don't start parallel COPYs of their own.
+	 */
+	foreach(lc, cstate->options)
+	{
+		DefElem    *defel = lfirst_node(DefElem, lc);
+
+		if (strcmp(defel->defname, "header") != 0 &&
+			strcmp(defel->defname, "parallel") != 0)
+			workeroptions = lappend(workeroptions, defel);
+	}
+	state = nodeToString(list_make5(workeroptions, cstate->attnamelist,
+									cstate->whereClause, cstate->range_table,
+									cstate->rteperminfos));
+
+	/*
+	 * Workers can't assign a transaction ID or mark the command ID as used,
+	 * so do that now.
+	 */
+	(void) GetCurrentTransactionId();
+	(void) GetCurrentCommandId(true);
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "ParallelCopyMain", nworkers);
+
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelCopyShared));
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(state) + 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_COPY_QUEUE_SIZE, nworkers));
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), nworkers));
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 5);
+
+	/* Finally, estimate PARALLEL_COPY_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial COPY) */
+	if (pcxt->seg == NULL)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		cstate->opts.parallel_workers = 0;
+		return CopyFrom(cstate);
+	}
+
+	shared = shm_toc_allocate(pcxt->toc, sizeof(ParallelCopyShared));
+	shared->relid = RelationGetRelid(cstate->rel);
+	pg_atomic_init_u64(&shared->processed, 0);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_SHARED, shared);
+
+	sharedstate = shm_toc_allocate(pcxt->toc, strlen(state) + 1);
+	strcpy(sharedstate, state);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_STATE, sharedstate);
+
+	queues = shm_toc_allocate(pcxt->toc,
+							  mul_size(PARALLEL_COPY_QUEUE_SIZE, nworkers));
+	for (int i = 0; i < nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(queues + i * PARALLEL_COPY_QUEUE_SIZE,
+						   (Size) PARALLEL_COPY_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_QUEUES, queues);
+
+	if (debug_query_string)
+	{
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/*
+	 * Allocate space for each worker's WalUsage and BufferUsage; no need to
+	 * initialize.
+	 */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_BUFFER_USAGE, bufferusage);
+
+	LaunchParallelWorkers(pcxt);
+	nlaunched = pcxt->nworkers_launched;
+
+	/* If no workers were successfully launched, back out (do serial COPY) */
+	if (nlaunched == 0)
+	{
+		WaitForParallelWorkersToFinish(pcxt);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		cstate->opts.parallel_workers = 0;
+		return CopyFrom(cstate);
+	}
+
+	mqh = palloc(sizeof(shm_mq_handle *) * nlaunched);
+	for (int i = 0; i < nlaunched; i++)
+	{
+		shm_mq	   *mq = (shm_mq *) (queues + i * PARALLEL_COPY_QUEUE_SIZE);
+
+		mqh[i] = shm_mq_attach(mq, pcxt->seg, pcxt->worker[i].bgwhandle);
+	}
+
+	/* Split the input into lines, and distribute them to the workers */
+	errcallback.callback = CopyFromErrorCallback;
+	errcallback.arg = (void *) cstate;
+
+	initStringInfo(&chunk);
+	for (;;)
+	{
+		bool		found;
+
+		CHECK_FOR_INTERRUPTS();
+
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
+		found = NextCopyFromLine(cstate);
+		error_context_stack = errcallback.previous;
+
+		if (!found)
+			break;
+
+		hdr.lineno = cstate->cur_lineno;
+		hdr.len = cstate->line_buf.len;
+		appendBinaryStringInfo(&chunk, (char *) &hdr, sizeof(hdr));
+		appendBinaryStringInfo(&chunk, cstate->line_buf.data,
+							   cstate->line_buf.len);
+
+		if (chunk.len >= PARALLEL_COPY_CHUNK_SIZE)
+		{
+			ParallelCopySendChunk(pcxt, mqh[next], &chunk);
+			next = (next + 1) % nlaunched;
+		}
+	}
+	if (chunk.len > 0)
+		ParallelCopySendChunk(pcxt, mqh[next], &chunk);
+	pfree(chunk.data);
+
+	/* Detaching tells the workers that there are no more lines */
+	for (int i = 0; i < nlaunched; i++)
+		shm_mq_detach(mqh[i]);
+	pfree(mqh);
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/*
+	 * Next, accumulate WAL and buffer usage.  (This must wait for the
+	 * workers to finish, or we might get incomplete data.)
+	 */
+	for (int i = 0; i < nlaunched; i++)
+		InstrAccumParallelQuery(&bufferusage[i], &walusage[i]);
+
+	processed = pg_atomic_read_u64(&shared->processed);
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	pgstat_progress_update_param(PROGRESS_COPY_TUPLES_PROCESSED, processed);
+
+	return processed;
+}
+
+/*
+ * Send one chunk of lines to a worker, and reset the chunk buffer.
+ */
+static void
+ParallelCopySendChunk(ParallelContext *pcxt, shm_mq_handle *mqh,
+					  StringInfo chunk)
+{
+	shm_mq_result res;
+
+	res = shm_mq_send(mqh, chunk->len, chunk->data, false, true);
+	if (res != SHM_MQ_SUCCESS)
+	{
+		/*
+		 * The worker went away.  If it reported an error, this will rethrow
+		 * it.
+		 */
+		WaitForParallelWorkersToFinish(pcxt);
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not send data to parallel COPY worker")));
+	}
+
+	resetStringInfo(chunk);
+}
+
+/*
+ * Read the next line sent by the leader into line_buf, in a parallel COPY
+ * worker.
+ *
+ * Returns false if there are no more lines.
+ */
+bool
+ParallelCopyReadLine(CopyFromState cstate)
+{
+	ParallelCopyLine hdr;
+
+	if (cstate->pcopy_chunk_len == 0)
+	{
+		shm_mq_result res;
+		Size		nbytes;
+		void	   *data;
+
+		res = shm_mq_receive(cstate->pcopy_mqh, &nbytes, &data, false);
+		if (res == SHM_MQ_DETACHED)
+			return false;
+		Assert(res == SHM_MQ_SUCCESS);
+		cstate->pcopy_chunk = data;
+		cstate->pcopy_chunk_len = nbytes;
+	}
+
+	Assert(cstate->pcopy_chunk_len >= sizeof(hdr));
+	memcpy(&hdr, cstate->pcopy_chunk, sizeof(hdr));
+	cstate->pcopy_chunk += sizeof(hdr);
+	cstate->pcopy_chunk_len -= sizeof(hdr);
+
+	Assert(cstate->pcopy_chunk_len >= hdr.len);
+	resetStringInfo(&cstate->line_buf);
+	appendBinaryStringInfo(&cstate->line_buf, cstate->pcopy_chunk, hdr.len);
+	cstate->pcopy_chunk += hdr.len;
+	cstate->pcopy_chunk_len -= hdr.len;
+
+	cstate->cur_lineno = hdr.lineno;
+	cstate->line_buf_valid = true;
+
+	return true;
+}
+
+/*
+ * Data source callback for the CopyFromState of a parallel COPY worker.
+ *
+ * The input lines are received through the worker's queue instead, so this
+ * is never called.
+ */
+static int
+ParallelCopyNoData(void *outbuf, int minread, int maxread)
+{
+	elog(ERROR, "unexpected read of COPY input in parallel worker");
+	return 0;					/* keep compiler quiet */
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+ParallelCopyMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelCopyShared *shared;
+	char	   *sharedquery;
+	char	   *queues;
+	shm_mq	   *mq;
+	List	   *state;
+	Relation	rel;
+	ParseState *pstate;
+	CopyFromState cstate;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	uint64		processed;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_COPY_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	shared = shm_toc_lookup(toc, PARALLEL_COPY_KEY_SHARED, false);
+	state = (List *) stringToNode(shm_toc_lookup(toc, PARALLEL_COPY_KEY_STATE,
+												 false));
+
+	queues = shm_toc_lookup(toc, PARALLEL_COPY_KEY_QUEUES, false);
+	mq = (shm_mq *) (queues + ParallelWorkerNumber * PARALLEL_COPY_QUEUE_SIZE);
+	shm_mq_set_receiver(mq, MyProc);
+
+	/* Open the relation using the lock mode the leader holds */
+	rel = table_open(shared->relid, RowExclusiveLock);
+
+	pstate = make_parsestate(NULL);
+	pstate->p_rtable = (List *) list_nth(state, 3);
+	pstate->p_rteperminfos = (List *) list_nth(state, 4);
+
+	cstate = BeginCopyFrom(pstate, rel, (Node *) list_nth(state, 2),
+						   NULL, false, ParallelCopyNoData,
+						   (List *) list_nth(state, 1),
+						   (List *) list_nth(state, 0));
+	cstate->pcopy_mqh = shm_mq_attach(mq, seg, NULL);
+
+	/* Prepare to track buffer usage during the COPY */
+	InstrStartParallelQuery();
+
+	processed = CopyFrom(cstate);
+	pg_atomic_fetch_add_u64(&shared->processed, processed);
+
+	/* Report WAL/buffer usage during the COPY */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_COPY_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_COPY_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	EndCopyFrom(cstate);
+	free_parsestate(pstate);
+	table_close(rel, RowExclusiveLock);
+}
@@ -71,7 +71,9 @@
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/pg_bitutils.h"
 #include "port/pg_bswap.h"
+#include "port/simd.h"
 #include "utils/builtins.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
@@ -740,24 +742,20 @@ CopyReadBinaryData(CopyFromState cstate, char *dest, int nbytes)
 }
 
 /*
- * Read raw fields in the next line for COPY FROM in text or csv mode.
- * Return false if no more lines.
+ * Read the next input line into line_buf, checking or skipping the header
+ * line first if needed.
  *
- * An internal temporary buffer is returned via 'fields'. It is valid until
- * the next call of the function. Since the function returns all raw fields
- * in the input file, 'nfields' could be different from the number of columns
- * in the relation.
- *
- * NOTE: force_not_null option are not applied to the returned fields.
+ * Returns false if there are no more lines.  In a parallel COPY worker, the
+ * lines come from the leader, which has already dealt with the header.
  */
 bool
-NextCopyFromRawFields(CopyFromState cstate, char ***fields, int *nfields)
+NextCopyFromLine(CopyFromState cstate)
 {
 	int			fldct;
 	bool		done;
 
-	/* only available for text or csv input */
-	Assert(!cstate->opts.binary);
+	if (cstate->pcopy_mqh != NULL)
+		return ParallelCopyReadLine(cstate);
 
 	/* on input check that the header line is correct if needed */
 	if (cstate->cur_lineno == 0 && cstate->opts.header_line)
@@ -828,6 +826,32 @@ NextCopyFromRawFields(CopyFromState cstate, char ***fields, int *nfields)
 	if (done && cstate->line_buf.len == 0)
 		return false;
 
+	return true;
+}
+
+/*
+ * Read raw fields in the next line for COPY FROM in text or csv mode.
+ * Return false if no more lines.
+ *
+ * An internal temporary buffer is returned via 'fields'. It is valid until
+ * the next call of the function. Since the function returns all raw fields
+ * in the input file, 'nfields' could be different from the number of columns
+ * in the relation.
+ *
+ * NOTE: force_not_null option are not applied to the returned fields.
+ */
+bool
+NextCopyFromRawFields(CopyFromState cstate, char ***fields, int *nfields)
+{
+	int			fldct;
+
+	/* only available for text or csv input */
+	Assert(!cstate->opts.binary);
+
+	/* Read the next line into line_buf, return false at EOF */
+	if (!NextCopyFromLine(cstate))
+		return false;
+
 	/* Parse the line into de-escaped field values */
 	if (cstate->opts.csv_mode)
 		fldct = CopyReadAttributesCSV(cstate);
@@ -1106,6 +1130,47 @@ CopyReadLine(CopyFromState cstate)
 	return result;
 }
 
+/*
+ * CopySkipPlain - count the leading bytes of s[0 .. len-1] that are none of
+ * the characters c1 .. c4
+ *
+ * The scan is done a vector at a time, and stops at the last complete vector;
+ * any shorter tail is left for the caller to examine byte by byte.  Callers
+ * looking for fewer than four characters can repeat one of them.  Without
+ * SIMD support this always returns 0.
+ */
+static inline int
+CopySkipPlain(const char *s, int len, char c1, char c2, char c3, char c4)
+{
+	int			i = 0;
+
+#ifndef USE_NO_SIMD
+	if (len >= (int) sizeof(Vector8))
+	{
+		const Vector8 v1 = vector8_broadcast((uint8) c1);
+		const Vector8 v2 = vector8_broadcast((uint8) c2);
+		const Vector8 v3 = vector8_broadcast((uint8) c3);
+		const Vector8 v4 = vector8_broadcast((uint8) c4);
+
+		for (; i <= len - (int) sizeof(Vector8); i += sizeof(Vector8))
+		{
+			Vector8		chunk;
+			uint32		mask;
+
+			vector8_load(&chunk, (const uint8 *) &s[i]);
+			mask = vector8_highbit_mask(vector8_or(vector8_or(vector8_eq(chunk, v1),
+															  vector8_eq(chunk, v2)),
+												   vector8_or(vector8_eq(chunk, v3),
+															  vector8_eq(chunk, v4))));
+			if (mask != 0)
+				return i + pg_rightmost_one_pos32(mask);
+		}
+	}
+#endif
+
+	return i;
+}
+
 /*
  * CopyReadLineText - inner loop of CopyReadLine for text mode
  */
@@ -1202,6 +1267,32 @@ CopyReadLineText(CopyFromState cstate)
 			need_data = false;
 		}
 
+		/*
+		 * Skip over any run of characters that need no processing here.  In
+		 * CSV mode, the escape character only matters inside quotes, and we
+		 * must look at the first character of each line for \. ourselves.
+		 */
+		if (!cstate->opts.csv_mode)
+			input_buf_ptr += CopySkipPlain(copy_input_buf + input_buf_ptr,
+										   copy_buf_len - input_buf_ptr,
+										   '\n', '\r', '\\', '\\');
+		else if (!first_char_in_line)
+		{
+			int			nplain;
+
+			nplain = CopySkipPlain(copy_input_buf + input_buf_ptr,
+								   copy_buf_len - input_buf_ptr,
+								   '\n', '\r', quotec,
+								   (in_quote && escapec != '\0') ? escapec : quotec);
+			if (nplain > 0)
+			{
+				input_buf_ptr += nplain;
+				last_was_esc = false;
+			}
+		}
+		if (input_buf_ptr >= copy_buf_len)
+			continue;
+
 		/* OK to fetch a character */
 		prev_raw_ptr = input_buf_ptr;
 		c = copy_input_buf[input_buf_ptr++];
@@ -1549,6 +1640,17 @@ CopyReadAttributesText(CopyFromState cstate)
 		for (;;)
 		{
 			char		c;
+			int			nplain;
+
+			/* Copy any run of ordinary characters in one go */
+			nplain = CopySkipPlain(cur_ptr, line_end_ptr - cur_ptr,
+								   delimc, '\\', delimc, '\\');
+			if (nplain > 0)
+			{
+				memcpy(output_ptr, cur_ptr, nplain);
+				output_ptr += nplain;
+				cur_ptr += nplain;
+			}
 
 			end_ptr = cur_ptr;
 			if (cur_ptr >= line_end_ptr)
@@ -1775,10 +1877,20 @@ CopyReadAttributesCSV(CopyFromState cstate)
 		for (;;)
 		{
 			char		c;
+			int			nplain;
 
 			/* Not in quote */
 			for (;;)
 			{
+				nplain = CopySkipPlain(cur_ptr, line_end_ptr - cur_ptr,
+									   delimc, quotec, delimc, quotec);
+				if (nplain > 0)
+				{
+					memcpy(output_ptr, cur_ptr, nplain);
+					output_ptr += nplain;
+					cur_ptr += nplain;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					goto endfield;
@@ -1802,6 +1914,15 @@ CopyReadAttributesCSV(CopyFromState cstate)
 			/* In quote */
 			for (;;)
 			{
+				nplain = CopySkipPlain(cur_ptr, line_end_ptr - cur_ptr,
+									   escapec, quotec, escapec, quotec);
+				if (nplain > 0)
+				{
+					memcpy(output_ptr, cur_ptr, nplain);
+					output_ptr += nplain;
+					cur_ptr += nplain;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					ereport(ERROR,
@@ -20,22 +20,30 @@
 
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/parallel.h"
+#include "access/table.h"
 #include "access/tableam.h"
 #include "access/xact.h"
 #include "access/xlog.h"
+#include "catalog/pg_proc.h"
 #include "commands/copy.h"
 #include "commands/progress.h"
 #include "executor/execdesc.h"
 #include "executor/executor.h"
+#include "executor/instrument.h"
 #include "executor/tuptable.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "optimizer/optimizer.h"
+#include "parser/parse_node.h"
 #include "pgstat.h"
 #include "rewrite/rewriteHandler.h"
+#include "storage/bufmgr.h"
 #include "storage/fd.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
 #include "tcop/tcopprot.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
@@ -51,7 +59,8 @@ typedef enum CopyDest
 {
 	COPY_FILE,					/* to file (or a piped program) */
 	COPY_FRONTEND,				/* to frontend */
-	COPY_CALLBACK				/* to callback function */
+	COPY_CALLBACK,				/* to callback function */
+	COPY_PARALLEL				/* to the leader of a parallel COPY */
 } CopyDest;
 
 /*
@@ -88,6 +97,9 @@ typedef struct CopyToStateData
 	bool		is_program;		/* is 'filename' a program to popen? */
 	copy_data_dest_cb data_dest_cb; /* function for writing data */
 
+	List	   *attnamelist;	/* column names as given, or NIL */
+	List	   *options;		/* List of DefElem nodes as given */
+
 	CopyFormatOptions opts;
 	Node	   *whereClause;	/* WHERE condition (or NULL) */
 
@@ -99,6 +111,14 @@ typedef struct CopyToStateData
 	FmgrInfo   *out_functions;	/* lookup info for output functions */
 	MemoryContext rowcontext;	/* per-row evaluation context */
 	uint64		bytes_processed;	/* number of bytes processed so far */
+
+	/*
+	 * In a parallel COPY worker, copy_dest is COPY_PARALLEL and the rows are
+	 * collected in pcopy_chunk, to be sent to the leader through pcopy_mqh.
+	 */
+	struct ParallelCopyToShared *pcopy_shared;
+	shm_mq_handle *pcopy_mqh;
+	StringInfoData pcopy_chunk;
 } CopyToStateData;
 
 /* DestReceiver for COPY (query) TO */
@@ -112,10 +132,44 @@ typedef struct
 /* NOTE: there's a copy of this in copyfromparse.c */
 static const char BinarySignature[11] = "PGCOPY\n\377\r\n\0";
 
+/* Magic numbers for parallel COPY TO state sharing */
+#define PARALLEL_COPY_TO_KEY_SHARED			UINT64CONST(0xC000000000000011)
+#define PARALLEL_COPY_TO_KEY_STATE			UINT64CONST(0xC000000000000012)
+#define PARALLEL_COPY_TO_KEY_QUEUES			UINT64CONST(0xC000000000000013)
+#define PARALLEL_COPY_TO_KEY_QUERY_TEXT		UINT64CONST(0xC000000000000014)
+#define PARALLEL_COPY_TO_KEY_WAL_USAGE		UINT64CONST(0xC000000000000015)
+#define PARALLEL_COPY_TO_KEY_BUFFER_USAGE	UINT64CONST(0xC000000000000016)
+
+/* Size of each worker's output queue */
+#define PARALLEL_COPY_TO_QUEUE_SIZE		(256 * 1024)
+
+/* Rows are sent to the leader in chunks of about this size */
+#define PARALLEL_COPY_TO_CHUNK_SIZE		(64 * 1024)
+
+/* The table is divided into ranges of this many blocks */
+#define PARALLEL_COPY_TO_RANGE_BLOCKS	128
+
+/*
+ * Status shared between the leader and the workers of a parallel COPY TO.
+ *
+ * Range i of the table is formatted by worker (i % nworkers).  Ranges
+ * belonging to workers that could not be launched are formatted by the
+ * leader itself.
+ */
+typedef struct ParallelCopyToShared
+{
+	Oid			relid;			/* relation to copy */
+	BlockNumber nblocks;		/* number of blocks to copy */
+	int			nworkers;		/* number of workers planned */
+	CopyDest	leader_dest;	/* copy_dest of the leader */
+} ParallelCopyToShared;
+
 
 /* non-export function prototypes */
 static void EndCopy(CopyToState cstate);
 static void ClosePipeToProgram(CopyToState cstate);
+static uint64 CopyRelationTo(CopyToState cstate, BlockNumber startblk,
+							 BlockNumber numblks, uint64 processed);
 static void CopyOneRowTo(CopyToState cstate, TupleTableSlot *slot);
 static void CopyAttributeOutText(CopyToState cstate, const char *string);
 static void CopyAttributeOutCSV(CopyToState cstate, const char *string,
@@ -128,9 +182,17 @@ static void CopySendData(CopyToState cstate, const void *databuf, int datasize);
 static void CopySendString(CopyToState cstate, const char *str);
 static void CopySendChar(CopyToState cstate, char c);
 static void CopySendEndOfRow(CopyToState cstate);
+static void CopySendRowData(CopyToState cstate, const char *data, int len);
 static void CopySendInt32(CopyToState cstate, int32 val);
 static void CopySendInt16(CopyToState cstate, int16 val);
 
+/* Parallel COPY TO */
+static bool ParallelCopyToIsSafe(CopyToState cstate);
+static uint64 ParallelCopyTo(CopyToState cstate);
+static uint64 ParallelCopyToRanges(CopyToState cstate);
+static void ParallelCopyToFlush(CopyToState cstate);
+static void ParallelCopyToNoDest(void *data, int len);
+
 
 /*
  * Send copy start/stop messages for frontend copies.  These have changed
@@ -194,8 +256,13 @@ static void
 CopySendEndOfRow(CopyToState cstate)
 {
 	StringInfo	fe_msgbuf = cstate->fe_msgbuf;
+	CopyDest	dest = cstate->copy_dest;
 
-	switch (cstate->copy_dest)
+	/* A parallel COPY worker terminates rows the way its leader would */
+	if (dest == COPY_PARALLEL)
+		dest = cstate->pcopy_shared->leader_dest;
+
+	switch (dest)
 	{
 		case COPY_FILE:
 			if (!cstate->opts.binary)
@@ -207,9 +274,37 @@ CopySendEndOfRow(CopyToState cstate)
 				CopySendString(cstate, "\r\n");
 #endif
 			}
+			break;
+		case COPY_FRONTEND:
+			/* The FE/BE protocol uses \n as newline for all platforms */
+			if (!cstate->opts.binary)
+				CopySendChar(cstate, '\n');
+			break;
+		case COPY_CALLBACK:
+		case COPY_PARALLEL:		/* can't happen, see above */
+			break;
+	}
+
+	CopySendRowData(cstate, fe_msgbuf->data, fe_msgbuf->len);
+
+	resetStringInfo(fe_msgbuf);
+}
 
-			if (fwrite(fe_msgbuf->data, fe_msgbuf->len, 1,
-					   cstate->copy_file) != 1 ||
+/*
+ * CopySendRowData writes one complete row, including its line termination,
+ * to the destination.
+ *
+ * This is used by CopySendEndOfRow, and directly by the leader of a parallel
+ * COPY to write the rows formatted by the workers without copying them into
+ * fe_msgbuf first.
+ */
+static void
+CopySendRowData(CopyToState cstate, const char *data, int len)
+{
+	switch (cstate->copy_dest)
+	{
+		case COPY_FILE:
+			if (fwrite(data, len, 1, cstate->copy_file) != 1 ||
 				ferror(cstate->copy_file))
 			{
 				if (cstate->is_program)
@@ -242,23 +337,31 @@ CopySendEndOfRow(CopyToState cstate)
 			}
 			break;
 		case COPY_FRONTEND:
-			/* The FE/BE protocol uses \n as newline for all platforms */
-			if (!cstate->opts.binary)
-				CopySendChar(cstate, '\n');
-
-			/* Dump the accumulated row as one CopyData message */
-			(void) pq_putmessage('d', fe_msgbuf->data, fe_msgbuf->len);
+			/* Dump the row as one CopyData message */
+			(void) pq_putmessage('d', data, len);
 			break;
 		case COPY_CALLBACK:
-			cstate->data_dest_cb(fe_msgbuf->data, fe_msgbuf->len);
+			cstate->data_dest_cb((void *) data, len);
 			break;
+		case COPY_PARALLEL:
+			{
+				uint32		rowlen = len;
+
+				/* Add the row to the chunk for the leader, with its length */
+				appendBinaryStringInfo(&cstate->pcopy_chunk,
+									   (char *) &rowlen, sizeof(rowlen));
+				appendBinaryStringInfo(&cstate->pcopy_chunk, data, len);
+				if (cstate->pcopy_chunk.len >= PARALLEL_COPY_TO_CHUNK_SIZE)
+					ParallelCopyToFlush(cstate);
+
+				/* The leader reports the progress */
+				return;
+			}
 	}
 
 	/* Update the progress */
-	cstate->bytes_processed += fe_msgbuf->len;
+	cstate->bytes_processed += len;
 	pgstat_progress_update_param(PROGRESS_COPY_BYTES_PROCESSED, cstate->bytes_processed);
-
-	resetStringInfo(fe_msgbuf);
 }
 
 /*
@@ -575,6 +678,8 @@ BeginCopyTo(ParseState *pstate,
 
 	/* Generate or convert list of attributes to process */
 	cstate->attnumlist = CopyGetAttnums(tupDesc, cstate->rel, attnamelist);
+	cstate->attnamelist = attnamelist;
+	cstate->options = options;
 
 	num_phys_attrs = tupDesc->natts;
 
@@ -800,17 +905,23 @@ DoCopyTo(CopyToState cstate)
 
 	if (cstate->opts.binary)
 	{
-		/* Generate header for a binary copy */
-		int32		tmp;
-
-		/* Signature */
-		CopySendData(cstate, BinarySignature, 11);
-		/* Flags field */
-		tmp = 0;
-		CopySendInt32(cstate, tmp);
-		/* No header extension */
-		tmp = 0;
-		CopySendInt32(cstate, tmp);
+		/*
+		 * Generate header for a binary copy.  In a parallel COPY, the leader
+		 * takes care of the header and trailer.
+		 */
+		if (cstate->copy_dest != COPY_PARALLEL)
+		{
+			int32		tmp;
+
+			/* Signature */
+			CopySendData(cstate, BinarySignature, 11);
+			/* Flags field */
+			tmp = 0;
+			CopySendInt32(cstate, tmp);
+			/* No header extension */
+			tmp = 0;
+			CopySendInt32(cstate, tmp);
+		}
 	}
 	else
 	{
@@ -850,35 +961,18 @@ DoCopyTo(CopyToState cstate)
 		}
 	}
 
-	if (cstate->rel)
+	if (cstate->copy_dest == COPY_PARALLEL)
 	{
-		TupleTableSlot *slot;
-		TableScanDesc scandesc;
-
-		scandesc = table_beginscan(cstate->rel, GetActiveSnapshot(), 0, NULL);
-		slot = table_slot_create(cstate->rel, NULL);
-
-		processed = 0;
-		while (table_scan_getnextslot(scandesc, ForwardScanDirection, slot))
-		{
-			CHECK_FOR_INTERRUPTS();
-
-			/* Deconstruct the tuple ... */
-			slot_getallattrs(slot);
-
-			/* Format and send the data */
-			CopyOneRowTo(cstate, slot);
-
-			/*
-			 * Increment the number of processed tuples, and report the
-			 * progress.
-			 */
-			pgstat_progress_update_param(PROGRESS_COPY_TUPLES_PROCESSED,
-										 ++processed);
-		}
-
-		ExecDropSingleTupleTableSlot(slot);
-		table_endscan(scandesc);
+		/* In a parallel COPY worker, format our share of the table */
+		processed = ParallelCopyToRanges(cstate);
+	}
+	else if (cstate->rel)
+	{
+		if (cstate->opts.parallel_workers > 0 &&
+			ParallelCopyToIsSafe(cstate))
+			processed = ParallelCopyTo(cstate);
+		else
+			processed = CopyRelationTo(cstate, 0, InvalidBlockNumber, 0);
 	}
 	else
 	{
@@ -887,7 +981,7 @@ DoCopyTo(CopyToState cstate)
 		processed = ((DR_copy *) cstate->queryDesc->dest)->processed;
 	}
 
-	if (cstate->opts.binary)
+	if (cstate->opts.binary && cstate->copy_dest != COPY_PARALLEL)
 	{
 		/* Generate trailer for a binary copy */
 		CopySendInt16(cstate, -1);
@@ -903,6 +997,54 @@ DoCopyTo(CopyToState cstate)
 	return processed;
 }
 
+/*
+ * Emit the rows of a range of blocks of the relation, during DoCopyTo().
+ *
+ * numblks can be InvalidBlockNumber to scan the whole relation.  'processed'
+ * is the number of rows emitted so far, for progress reporting; the new
+ * count is returned.
+ */
+static uint64
+CopyRelationTo(CopyToState cstate, BlockNumber startblk, BlockNumber numblks,
+			   uint64 processed)
+{
+	TupleTableSlot *slot;
+	TableScanDesc scandesc;
+
+	if (numblks == InvalidBlockNumber)
+		scandesc = table_beginscan(cstate->rel, GetActiveSnapshot(), 0, NULL);
+	else
+	{
+		/* Synchronized scans would not start at startblk */
+		scandesc = table_beginscan_strat(cstate->rel, GetActiveSnapshot(),
+										 0, NULL, true, false);
+		heap_setscanlimits(scandesc, startblk, numblks);
+	}
+	slot = table_slot_create(cstate->rel, NULL);
+
+	while (table_scan_getnextslot(scandesc, ForwardScanDirection, slot))
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		/* Deconstruct the tuple ... */
+		slot_getallattrs(slot);
+
+		/* Format and send the data */
+		CopyOneRowTo(cstate, slot);
+
+		/*
+		 * Increment the number of processed tuples, and report the progress.
+		 */
+		pgstat_progress_update_param(PROGRESS_COPY_TUPLES_PROCESSED,
+									 ++processed);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	table_endscan(scandesc);
+
+	return processed;
+}
+
 /*
  * Emit one row during DoCopyTo().
  */
@@ -1287,3 +1429,399 @@ CreateCopyDestReceiver(void)
 
 	return (DestReceiver *) self;
 }
+
+/*
+ * Parallel COPY TO
+ *
+ * With the PARALLEL option, COPY <table> TO can hand the work of formatting
+ * the rows to a number of parallel workers.  The table is divided into
+ * ranges of PARALLEL_COPY_TO_RANGE_BLOCKS blocks, which are assigned to the
+ * workers round-robin.  Each worker scans its ranges with the leader's
+ * snapshot, formats the rows exactly like a serial COPY TO would, including
+ * encoding conversion and line termination, and sends them to the leader in
+ * chunks through its own shm_mq.  The end of a range is marked with an empty
+ * message.  The leader writes the header and trailer, and streams the rows
+ * range by range, so they come out in the same order as a serial COPY
+ * without synchronized scans would produce them.  The rows are written to
+ * the destination directly from the queue.
+ *
+ * A parallel COPY TO is only attempted when the output functions of all the
+ * columns are parallel safe.  Otherwise, or if no workers could be launched,
+ * we silently fall back to a serial COPY TO.
+ */
+
+/*
+ * Can the COPY TO described by cstate be performed by parallel workers?
+ */
+static bool
+ParallelCopyToIsSafe(CopyToState cstate)
+{
+	Relation	rel = cstate->rel;
+	ListCell   *lc;
+
+	/* We can't start a parallel operation from within one */
+	if (IsInParallelMode())
+		return false;
+
+	/*
+	 * The ranges are scanned with heap_setscanlimits().  Workers cannot
+	 * access the leader's local buffers, either.
+	 */
+	if (rel->rd_tableam != GetHeapamTableAmRoutine() ||
+		RelationUsesLocalBuffers(rel))
+		return false;
+
+	/* The output functions of the columns */
+	foreach(lc, cstate->attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+
+		if (func_parallel(cstate->out_functions[attnum - 1].fn_oid) != PROPARALLEL_SAFE)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Perform the scan of a COPY TO using parallel workers.
+ *
+ * Returns the number of rows processed.  If no workers can be launched, the
+ * rows are formatted by the leader alone.
+ */
+static uint64
+ParallelCopyTo(CopyToState cstate)
+{
+	ParallelContext *pcxt;
+	ParallelCopyToShared *shared;
+	List	   *workeroptions = NIL;
+	char	   *state;
+	char	   *sharedstate;
+	char	   *sharedquery = NULL;
+	char	   *queues;
+	shm_mq_handle **mqh;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	BlockNumber nblocks;
+	BlockNumber nranges;
+	int			nworkers;
+	int			nlaunched;
+	int			querylen = 0;
+	uint64		processed = 0;
+	ListCell   *lc;
+
+	nblocks = RelationGetNumberOfBlocks(cstate->rel);
+	nranges = nblocks / PARALLEL_COPY_TO_RANGE_BLOCKS +
+		(nblocks % PARALLEL_COPY_TO_RANGE_BLOCKS != 0);
+	nworkers = (int) Min((BlockNumber) cstate->opts.parallel_workers, nranges);
+
+	/* Don't bother with an empty table */
+	if (nworkers == 0)
+		return CopyRelationTo(cstate, 0, InvalidBlockNumber, 0);
+
+	/*
+	 * The workers get the same options as the leader, except that they don't
+	 * send the header line and don't start parallel COPYs of their own.
+	 */
+	foreach(lc, cstate->options)
+	{
+		DefElem    *defel = lfirst_node(DefElem, lc);
+
+		if (strcmp(defel->defname, "header") != 0 &&
+			strcmp(defel->defname, "parallel") != 0)
+			workeroptions = lappend(workeroptions, defel);
+	}
+	state = nodeToString(list_make2(workeroptions, cstate->attnamelist));
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "ParallelCopyToMain", nworkers);
+
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelCopyToShared));
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(state) + 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_COPY_TO_QUEUE_SIZE, nworkers));
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), nworkers));
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 5);
+
+	/* Finally, estimate PARALLEL_COPY_TO_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial COPY) */
+	if (pcxt->seg == NULL)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return CopyRelationTo(cstate, 0, InvalidBlockNumber, 0);
+	}
+
+	shared = shm_toc_allocate(pcxt->toc, sizeof(ParallelCopyToShared));
+	shared->relid = RelationGetRelid(cstate->rel);
+	shared->nblocks = nblocks;
+	shared->nworkers = nworkers;
+	shared->leader_dest = cstate->copy_dest;
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_SHARED, shared);
+
+	sharedstate = shm_toc_allocate(pcxt->toc, strlen(state) + 1);
+	strcpy(sharedstate, state);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_STATE, sharedstate);
+
+	queues = shm_toc_allocate(pcxt->toc,
+							  mul_size(PARALLEL_COPY_TO_QUEUE_SIZE, nworkers));
+	for (int i = 0; i < nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(queues + i * PARALLEL_COPY_TO_QUEUE_SIZE,
+						   (Size) PARALLEL_COPY_TO_QUEUE_SIZE);
+		shm_mq_set_receiver(mq, MyProc);
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_QUEUES, queues);
+
+	if (debug_query_string)
+	{
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/*
+	 * Allocate space for each worker's WalUsage and BufferUsage; no need to
+	 * initialize.
+	 */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_BUFFER_USAGE, bufferusage);
+
+	LaunchParallelWorkers(pcxt);
+	nlaunched = pcxt->nworkers_launched;
+
+	mqh = palloc(sizeof(shm_mq_handle *) * nworkers);
+	for (int i = 0; i < nlaunched; i++)
+	{
+		shm_mq	   *mq = (shm_mq *) (queues + i * PARALLEL_COPY_TO_QUEUE_SIZE);
+
+		mqh[i] = shm_mq_attach(mq, pcxt->seg, pcxt->worker[i].bgwhandle);
+	}
+
+	/*
+	 * Stream the rows, range by range.  The ranges assigned to workers that
+	 * could not be launched are formatted by the leader.
+	 */
+	for (BlockNumber range = 0; range < nranges; range++)
+	{
+		int			worker = range % nworkers;
+		BlockNumber startblk = range * PARALLEL_COPY_TO_RANGE_BLOCKS;
+
+		if (worker >= nlaunched)
+		{
+			processed = CopyRelationTo(cstate, startblk,
+									   Min(PARALLEL_COPY_TO_RANGE_BLOCKS,
+										   nblocks - startblk),
+									   processed);
+			continue;
+		}
+
+		for (;;)
+		{
+			shm_mq_result res;
+			Size		nbytes;
+			char	   *data;
+
+			CHECK_FOR_INTERRUPTS();
+
+			res = shm_mq_receive(mqh[worker], &nbytes, (void **) &data, false);
+			if (res != SHM_MQ_SUCCESS)
+			{
+				/*
+				 * The worker went away.  If it reported an error, this will
+				 * rethrow it.
+				 */
+				WaitForParallelWorkersToFinish(pcxt);
+				ereport(ERROR,
+						(errcode(ERRCODE_INTERNAL_ERROR),
+						 errmsg("lost connection to parallel COPY worker")));
+			}
+
+			/* An empty message ends the range */
+			if (nbytes == 0)
+				break;
+
+			while (nbytes > 0)
+			{
+				uint32		rowlen;
+
+				Assert(nbytes >= sizeof(rowlen));
+				memcpy(&rowlen, data, sizeof(rowlen));
+				data += sizeof(rowlen);
+				nbytes -= sizeof(rowlen);
+
+				Assert(nbytes >= rowlen);
+				CopySendRowData(cstate, data, rowlen);
+				data += rowlen;
+				nbytes -= rowlen;
+
+				pgstat_progress_update_param(PROGRESS_COPY_TUPLES_PROCESSED,
+											 ++processed);
+			}
+		}
+	}
+
+	for (int i = 0; i < nlaunched; i++)
+		shm_mq_detach(mqh[i]);
+	pfree(mqh);
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/*
+	 * Next, accumulate WAL and buffer usage.  (This must wait for the
+	 * workers to finish, or we might get incomplete data.)
+	 */
+	for (int i = 0; i < nlaunched; i++)
+		InstrAccumParallelQuery(&bufferusage[i], &walusage[i]);
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	return processed;
+}
+
+/*
+ * Format the rows of the ranges assigned to this parallel COPY worker, and
+ * send them to the leader.
+ *
+ * Returns the number of rows processed.
+ */
+static uint64
+ParallelCopyToRanges(CopyToState cstate)
+{
+	ParallelCopyToShared *shared = cstate->pcopy_shared;
+	BlockNumber nranges;
+	uint64		processed = 0;
+
+	nranges = shared->nblocks / PARALLEL_COPY_TO_RANGE_BLOCKS +
+		(shared->nblocks % PARALLEL_COPY_TO_RANGE_BLOCKS != 0);
+
+	for (BlockNumber range = ParallelWorkerNumber; range < nranges;
+		 range += shared->nworkers)
+	{
+		BlockNumber startblk = range * PARALLEL_COPY_TO_RANGE_BLOCKS;
+
+		processed = CopyRelationTo(cstate, startblk,
+								   Min(PARALLEL_COPY_TO_RANGE_BLOCKS,
+									   shared->nblocks - startblk),
+								   processed);
+
+		/* Send the rest of the range, followed by an empty message */
+		if (cstate->pcopy_chunk.len > 0)
+			ParallelCopyToFlush(cstate);
+		ParallelCopyToFlush(cstate);
+	}
+
+	return processed;
+}
+
+/*
+ * Send the rows collected in pcopy_chunk to the leader, and reset the chunk.
+ */
+static void
+ParallelCopyToFlush(CopyToState cstate)
+{
+	shm_mq_result res;
+
+	res = shm_mq_send(cstate->pcopy_mqh, cstate->pcopy_chunk.len,
+					  cstate->pcopy_chunk.data, false, true);
+	if (res != SHM_MQ_SUCCESS)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not send data to parallel COPY leader")));
+
+	resetStringInfo(&cstate->pcopy_chunk);
+}
+
+/*
+ * Data destination callback for the CopyToState of a parallel COPY worker.
+ *
+ * The rows are sent to the leader through the worker's queue instead, so
+ * this is never called.
+ */
+static void
+ParallelCopyToNoDest(void *data, int len)
+{
+	elog(ERROR, "unexpected write of COPY output in parallel worker");
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+ParallelCopyToMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelCopyToShared *shared;
+	char	   *sharedquery;
+	char	   *queues;
+	shm_mq	   *mq;
+	List	   *state;
+	Relation	rel;
+	ParseState *pstate;
+	CopyToState cstate;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	shared = shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_SHARED, false);
+	state = (List *) stringToNode(shm_toc_lookup(toc,
+												 PARALLEL_COPY_TO_KEY_STATE,
+												 false));
+
+	queues = shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_QUEUES, false);
+	mq = (shm_mq *) (queues + ParallelWorkerNumber * PARALLEL_COPY_TO_QUEUE_SIZE);
+	shm_mq_set_sender(mq, MyProc);
+
+	/* Open the relation using the lock mode the leader holds */
+	rel = table_open(shared->relid, AccessShareLock);
+
+	pstate = make_parsestate(NULL);
+
+	cstate = BeginCopyTo(pstate, rel, NULL, InvalidOid, NULL, false,
+						 ParallelCopyToNoDest,
+						 (List *) lsecond(state),
+						 (List *) linitial(state));
+	cstate->copy_dest = COPY_PARALLEL;
+	cstate->pcopy_shared = shared;
+	cstate->pcopy_mqh = shm_mq_attach(mq, seg, NULL);
+	initStringInfo(&cstate->pcopy_chunk);
+
+	/* Prepare to track buffer usage during the COPY */
+	InstrStartParallelQuery();
+
+	(void) DoCopyTo(cstate);
+
+	/* Report WAL/buffer usage during the COPY */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	EndCopyTo(cstate);
+	free_parsestate(pstate);
+	table_close(rel, AccessShareLock);
+}
@@ -61,8 +61,18 @@ typedef struct
 	CommandId	output_cid;		/* cmin to insert in output tuples */
 	int			ti_options;		/* table_tuple_insert performance options */
 	BulkInsertState bistate;	/* bulk insert state */
+	TupleTableSlot **slots;		/* tuples buffered for table_multi_insert */
+	int			nbuffered;		/* # of tuples in slots */
+	Size		bufferedBytes;	/* estimated size of the buffered tuples */
 } DR_intorel;
 
+/*
+ * Tuples are collected and inserted with table_multi_insert, in batches
+ * limited to this many tuples or bytes, as in COPY FROM.
+ */
+#define MAX_BUFFERED_TUPLES		1000
+#define MAX_BUFFERED_BYTES		65535
+
 /* utility functions for CTAS definition creation */
 static ObjectAddress create_ctas_internal(List *attrList, IntoClause *into);
 static ObjectAddress create_ctas_nodata(List *tlist, IntoClause *into);
@@ -72,6 +82,7 @@ static void intorel_startup(DestReceiver *self, int operation, TupleDesc typeinf
 static bool intorel_receive(TupleTableSlot *slot, DestReceiver *self);
 static void intorel_shutdown(DestReceiver *self);
 static void intorel_destroy(DestReceiver *self);
+static void intorel_flush(DR_intorel *myState);
 
 
 /*
@@ -565,9 +576,17 @@ intorel_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
 	 * bulk inserts as there are no tuples to insert.
 	 */
 	if (!into->skipData)
+	{
 		myState->bistate = GetBulkInsertState();
+		myState->slots = palloc0(sizeof(TupleTableSlot *) * MAX_BUFFERED_TUPLES);
+	}
 	else
+	{
 		myState->bistate = NULL;
+		myState->slots = NULL;
+	}
+	myState->nbuffered = 0;
+	myState->bufferedBytes = 0;
 
 	/*
 	 * Valid smgr_targblock implies something already wrote to the relation.
@@ -587,19 +606,29 @@ intorel_receive(TupleTableSlot *slot, DestReceiver *self)
 	/* Nothing to insert if WITH NO DATA is specified. */
 	if (!myState->into->skipData)
 	{
+		TupleTableSlot *batchslot;
+
 		/*
-		 * Note that the input slot might not be of the type of the target
-		 * relation. That's supported by table_tuple_insert(), but slightly
-		 * less efficient than inserting with the right slot - but the
-		 * alternative would be to copy into a slot of the right type, which
-		 * would not be cheap either. This also doesn't allow accessing per-AM
-		 * data (say a tuple's xmin), but since we don't do that here...
+		 * Buffer the tuple for insertion with table_multi_insert, which
+		 * needs slots of the type of the target relation.  Copying into one
+		 * costs about as much as table_tuple_insert() would spend converting
+		 * a slot of another type, and inserting in batches saves a lot more
+		 * than that, especially in WAL volume.
 		 */
-		table_tuple_insert(myState->rel,
-						   slot,
-						   myState->output_cid,
-						   myState->ti_options,
-						   myState->bistate);
+		if (myState->slots[myState->nbuffered] == NULL)
+			myState->slots[myState->nbuffered] =
+				table_slot_create(myState->rel, NULL);
+		batchslot = myState->slots[myState->nbuffered];
+
+		slot_getallattrs(slot);
+		myState->bufferedBytes +=
+			heap_compute_data_size(slot->tts_tupleDescriptor,
+								   slot->tts_values, slot->tts_isnull);
+		ExecCopySlot(batchslot, slot);
+
+		if (++myState->nbuffered >= MAX_BUFFERED_TUPLES ||
+			myState->bufferedBytes >= MAX_BUFFERED_BYTES)
+			intorel_flush(myState);
 	}
 
 	/* We know this is a newly created relation, so there are no indexes */
@@ -618,6 +647,12 @@ intorel_shutdown(DestReceiver *self)
 
 	if (!into->skipData)
 	{
+		intorel_flush(myState);
+		for (int i = 0; i < MAX_BUFFERED_TUPLES && myState->slots[i] != NULL; i++)
+			ExecDropSingleTupleTableSlot(myState->slots[i]);
+		pfree(myState->slots);
+		myState->slots = NULL;
+
 		FreeBulkInsertState(myState->bistate);
 		table_finish_bulk_insert(myState->rel, myState->ti_options);
 	}
@@ -627,6 +662,29 @@ intorel_shutdown(DestReceiver *self)
 	myState->rel = NULL;
 }
 
+/*
+ * intorel_flush --- insert the buffered tuples
+ */
+static void
+intorel_flush(DR_intorel *myState)
+{
+	if (myState->nbuffered == 0)
+		return;
+
+	table_multi_insert(myState->rel,
+					   myState->slots,
+					   myState->nbuffered,
+					   myState->output_cid,
+					   myState->ti_options,
+					   myState->bistate);
+
+	for (int i = 0; i < myState->nbuffered; i++)
+		ExecClearTuple(myState->slots[i]);
+
+	myState->nbuffered = 0;
+	myState->bufferedBytes = 0;
+}
+
 /*
  * intorel_destroy --- release DestReceiver object
  */
@@ -1481,6 +1481,7 @@ createdb_failure_callback(int code, Datum arg)
 	if (fparms->strategy == CREATEDB_WAL_LOG)
 	{
 		DropDatabaseBuffers(fparms->dest_dboid);
+		smgrforgetdatabase(fparms->dest_dboid);
 		ForgetDatabaseSyncRequests(fparms->dest_dboid);
 
 		/* Release lock on the target database. */
@@ -1660,9 +1661,11 @@ dropdb(const char *dbname, bool missing_ok, bool force)
 	/*
 	 * Drop pages for this database that are in the shared buffer cache. This
 	 * is important to ensure that no remaining backend tries to write out a
-	 * dirty buffer to the dead database later...
+	 * dirty buffer to the dead database later...  Likewise forget the sizes
+	 * of its relations.
 	 */
 	DropDatabaseBuffers(db_id);
+	smgrforgetdatabase(db_id);
 
 	/*
 	 * Tell the cumulative stats system to forget it immediately, too.
@@ -1948,8 +1951,10 @@ movedb(const char *dbname, const char *tblspcname)
 	 *
 	 * Note: it'd be sufficient to get rid of buffers matching db_id and
 	 * src_tblspcoid, but bufmgr.c presently provides no API for that.
+	 * Cached relation sizes need to go for the same reason.
 	 */
 	DropDatabaseBuffers(db_id);
+	smgrforgetdatabase(db_id);
 
 	/*
 	 * Check for existence of files in the target directory, i.e., objects of
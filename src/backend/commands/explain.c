@@ -24,6 +24,7 @@
 #include "nodes/extensible.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
 #include "parser/analyze.h"
 #include "parser/parsetree.h"
 #include "rewrite/rewriteHandler.h"
@@ -33,6 +34,7 @@
 #include "utils/guc_tables.h"
 #include "utils/json.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/ruleutils.h"
 #include "utils/snapmgr.h"
@@ -111,6 +113,8 @@ static void show_incremental_sort_info(IncrementalSortState *incrsortstate,
 static void show_hash_info(HashState *hashstate, ExplainState *es);
 static void show_memoize_info(MemoizeState *mstate, List *ancestors,
 							  ExplainState *es);
+static void show_memoize_shared_info(MemoizeInstrumentation *stats,
+									 ExplainState *es);
 static void show_hashagg_info(AggState *aggstate, ExplainState *es);
 static void show_tidbitmap_info(BitmapHeapScanState *planstate,
 								ExplainState *es);
@@ -119,9 +123,12 @@ static void show_instrumentation_count(const char *qlabel, int which,
 static void show_foreignscan_info(ForeignScanState *fsstate, ExplainState *es);
 static void show_eval_params(Bitmapset *bms_params, ExplainState *es);
 static const char *explain_get_index_name(Oid indexId);
-static void show_buffer_usage(ExplainState *es, const BufferUsage *usage,
-							  bool planning);
+static bool peek_buffer_usage(ExplainState *es, const BufferUsage *usage);
+static void show_buffer_usage(ExplainState *es, const BufferUsage *usage);
+static void show_planner_usage(ExplainState *es, const PlannerUsage *usage,
+							   const MemoryContextCounters *mem_counters);
 static void show_wal_usage(ExplainState *es, const WalUsage *usage);
+static void show_wait_usage(ExplainState *es, const WaitUsage *usage);
 static void ExplainIndexScanDetails(Oid indexid, ScanDirection indexorderdir,
 									ExplainState *es);
 static void ExplainScanTarget(Scan *plan, ExplainState *es);
@@ -188,8 +195,12 @@ ExplainQuery(ParseState *pstate, ExplainStmt *stmt,
 			es->buffers = defGetBoolean(opt);
 		else if (strcmp(opt->defname, "wal") == 0)
 			es->wal = defGetBoolean(opt);
+		else if (strcmp(opt->defname, "waits") == 0)
+			es->waits = defGetBoolean(opt);
 		else if (strcmp(opt->defname, "settings") == 0)
 			es->settings = defGetBoolean(opt);
+		else if (strcmp(opt->defname, "planning") == 0)
+			es->planning = defGetBoolean(opt);
 		else if (strcmp(opt->defname, "timing") == 0)
 		{
 			timing_set = true;
@@ -232,6 +243,11 @@ ExplainQuery(ParseState *pstate, ExplainStmt *stmt,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("EXPLAIN option WAL requires ANALYZE")));
 
+	if (es->waits && !es->analyze)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("EXPLAIN option WAITS requires ANALYZE")));
+
 	/* if the timing was not set explicitly, set default value */
 	es->timing = (timing_set) ? es->timing : es->analyze;
 
@@ -388,6 +404,25 @@ ExplainOneQuery(Query *query, int cursorOptions,
 					planduration;
 		BufferUsage bufusage_start,
 					bufusage;
+		PlannerUsage planusage_start,
+					planusage;
+		MemoryContextCounters mem_counters;
+		MemoryContext planner_ctx = NULL;
+		MemoryContext saved_ctx = NULL;
+
+		if (es->planning)
+		{
+			/*
+			 * Plan in a memory context of our own, so that we can tell how
+			 * much memory the planner used.  The plan ends up there too, so
+			 * the context has to live as long as the caller's.
+			 */
+			planner_ctx = AllocSetContextCreate(CurrentMemoryContext,
+												"explain planner context",
+												ALLOCSET_DEFAULT_SIZES);
+			saved_ctx = MemoryContextSwitchTo(planner_ctx);
+			planusage_start = pgPlannerUsage;
+		}
 
 		if (es->buffers)
 			bufusage_start = pgBufferUsage;
@@ -406,9 +441,22 @@ ExplainOneQuery(Query *query, int cursorOptions,
 			BufferUsageAccumDiff(&bufusage, &pgBufferUsage, &bufusage_start);
 		}
 
+		/* likewise for the planner's counters, and collect its memory use */
+		if (es->planning)
+		{
+			MemoryContextSwitchTo(saved_ctx);
+			memset(&planusage, 0, sizeof(PlannerUsage));
+			PlannerUsageAccumDiff(&planusage, &pgPlannerUsage,
+								  &planusage_start);
+			memset(&mem_counters, 0, sizeof(MemoryContextCounters));
+			MemoryContextMemConsumed(planner_ctx, &mem_counters);
+		}
+
 		/* run it (if needed) and produce output */
 		ExplainOnePlan(plan, into, es, queryString, params, queryEnv,
-					   &planduration, (es->buffers ? &bufusage : NULL));
+					   &planduration, (es->buffers ? &bufusage : NULL),
+					   (es->planning ? &planusage : NULL),
+					   (es->planning ? &mem_counters : NULL));
 	}
 }
 
@@ -518,7 +566,8 @@ void
 ExplainOnePlan(PlannedStmt *plannedstmt, IntoClause *into, ExplainState *es,
 			   const char *queryString, ParamListInfo params,
 			   QueryEnvironment *queryEnv, const instr_time *planduration,
-			   const BufferUsage *bufusage)
+			   const BufferUsage *bufusage, const PlannerUsage *planusage,
+			   const MemoryContextCounters *mem_counters)
 {
 	DestReceiver *dest;
 	QueryDesc  *queryDesc;
@@ -538,6 +587,8 @@ ExplainOnePlan(PlannedStmt *plannedstmt, IntoClause *into, ExplainState *es,
 		instrument_option |= INSTRUMENT_BUFFERS;
 	if (es->wal)
 		instrument_option |= INSTRUMENT_WAL;
+	if (es->waits)
+		instrument_option |= INSTRUMENT_WAITS;
 
 	/*
 	 * We always collect timing for the entire statement, even when node-level
@@ -604,11 +655,31 @@ ExplainOnePlan(PlannedStmt *plannedstmt, IntoClause *into, ExplainState *es,
 	/* Create textual dump of plan tree */
 	ExplainPrintPlan(es, queryDesc);
 
-	/* Show buffer usage in planning */
-	if (bufusage)
+	/* Show buffer usage and the planner's own statistics in planning */
+	if (bufusage || planusage)
 	{
+		bool		show_planning;
+
+		show_planning = (planusage != NULL ||
+						 peek_buffer_usage(es, bufusage));
+
 		ExplainOpenGroup("Planning", "Planning", true, es);
-		show_buffer_usage(es, bufusage, true);
+
+		if (show_planning && es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			ExplainIndentText(es);
+			appendStringInfoString(es->str, "Planning:\n");
+			es->indent++;
+		}
+
+		if (bufusage)
+			show_buffer_usage(es, bufusage);
+		if (planusage)
+			show_planner_usage(es, planusage, mem_counters);
+
+		if (show_planning && es->format == EXPLAIN_FORMAT_TEXT)
+			es->indent--;
+
 		ExplainCloseGroup("Planning", "Planning", true, es);
 	}
 
@@ -1822,6 +1893,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (IsA(planstate, SeqScanState) &&
+				((SeqScanState *) planstate)->runtime_filters != NIL)
+				show_instrumentation_count("Rows Removed by Runtime Filter", 2,
+										   planstate, es);
 			break;
 		case T_Gather:
 			{
@@ -2082,14 +2157,17 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		}
 	}
 
-	/* Show buffer/WAL usage */
+	/* Show buffer/WAL/wait usage */
 	if (es->buffers && planstate->instrument)
-		show_buffer_usage(es, &planstate->instrument->bufusage, false);
+		show_buffer_usage(es, &planstate->instrument->bufusage);
 	if (es->wal && planstate->instrument)
 		show_wal_usage(es, &planstate->instrument->walusage);
+	if (es->waits && planstate->instrument)
+		show_wait_usage(es, &planstate->instrument->waitusage);
 
-	/* Prepare per-worker buffer/WAL usage */
-	if (es->workers_state && (es->buffers || es->wal) && es->verbose)
+	/* Prepare per-worker buffer/WAL/wait usage */
+	if (es->workers_state && (es->buffers || es->wal || es->waits) &&
+		es->verbose)
 	{
 		WorkerInstrumentation *w = planstate->worker_instrument;
 
@@ -2103,9 +2181,11 @@ ExplainNode(PlanState *planstate, List *ancestors,
 
 			ExplainOpenWorker(n, es);
 			if (es->buffers)
-				show_buffer_usage(es, &instrument->bufusage, false);
+				show_buffer_usage(es, &instrument->bufusage);
 			if (es->wal)
 				show_wal_usage(es, &instrument->walusage);
+			if (es->waits)
+				show_wait_usage(es, &instrument->waitusage);
 			ExplainCloseWorker(n, es);
 		}
 	}
@@ -3181,7 +3261,7 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 	if (!es->analyze)
 		return;
 
-	if (mstate->stats.cache_misses > 0)
+	if (mstate->stats.cache_misses > 0 || mstate->stats.shared_hits > 0)
 	{
 		/*
 		 * mem_peak is only set when we freed memory, so we must use mem_used
@@ -3211,6 +3291,7 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 							 mstate->stats.cache_overflows,
 							 memPeakKb);
 		}
+		show_memoize_shared_info(&mstate->stats, es);
 	}
 
 	if (mstate->shared_info == NULL)
@@ -3225,9 +3306,10 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 
 		/*
 		 * Skip workers that didn't do any work.  We needn't bother checking
-		 * for cache hits as a miss will always occur before a cache hit.
+		 * for other cache hits as a miss will always occur before a cache
+		 * hit, unless the first one is found in the shared cache.
 		 */
-		if (si->cache_misses == 0)
+		if (si->cache_misses == 0 && si->shared_hits == 0)
 			continue;
 
 		if (es->workers_state)
@@ -3263,12 +3345,39 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 			ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb,
 								   es);
 		}
+		show_memoize_shared_info(si, es);
 
 		if (es->workers_state)
 			ExplainCloseWorker(n, es);
 	}
 }
 
+/*
+ * Show the use a Memoize node has made of the cache shared by the processes
+ * of a parallel query, if any.
+ */
+static void
+show_memoize_shared_info(MemoizeInstrumentation *stats, ExplainState *es)
+{
+	if (stats->shared_hits == 0 && stats->shared_evictions == 0)
+		return;
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyInteger("Shared Cache Hits", NULL,
+							   stats->shared_hits, es);
+		ExplainPropertyInteger("Shared Cache Evictions", NULL,
+							   stats->shared_evictions, es);
+	}
+	else
+	{
+		ExplainIndentText(es);
+		appendStringInfo(es->str,
+						 "Shared Hits: " UINT64_FORMAT "  Shared Evictions: " UINT64_FORMAT "\n",
+						 stats->shared_hits, stats->shared_evictions);
+	}
+}
+
 /*
  * Show information on hash aggregate memory usage and batches.
  */
@@ -3522,11 +3631,38 @@ explain_get_index_name(Oid indexId)
 	return result;
 }
 
+/*
+ * Return whether show_buffer_usage would have anything to print, if given
+ * the same 'usage' data.  Note that when the format is anything other than
+ * text, we print even if the counters are all zeroes.
+ */
+static bool
+peek_buffer_usage(ExplainState *es, const BufferUsage *usage)
+{
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+		return true;
+
+	return (usage->shared_blks_hit > 0 ||
+			usage->shared_blks_read > 0 ||
+			usage->shared_blks_dirtied > 0 ||
+			usage->shared_blks_written > 0 ||
+			usage->local_blks_hit > 0 ||
+			usage->local_blks_read > 0 ||
+			usage->local_blks_dirtied > 0 ||
+			usage->local_blks_written > 0 ||
+			usage->temp_blks_read > 0 ||
+			usage->temp_blks_written > 0 ||
+			!INSTR_TIME_IS_ZERO(usage->blk_read_time) ||
+			!INSTR_TIME_IS_ZERO(usage->blk_write_time) ||
+			!INSTR_TIME_IS_ZERO(usage->temp_blk_read_time) ||
+			!INSTR_TIME_IS_ZERO(usage->temp_blk_write_time));
+}
+
 /*
  * Show buffer usage details.
  */
 static void
-show_buffer_usage(ExplainState *es, const BufferUsage *usage, bool planning)
+show_buffer_usage(ExplainState *es, const BufferUsage *usage)
 {
 	if (es->format == EXPLAIN_FORMAT_TEXT)
 	{
@@ -3544,16 +3680,6 @@ show_buffer_usage(ExplainState *es, const BufferUsage *usage, bool planning)
 								  !INSTR_TIME_IS_ZERO(usage->blk_write_time));
 		bool		has_temp_timing = (!INSTR_TIME_IS_ZERO(usage->temp_blk_read_time) ||
 									   !INSTR_TIME_IS_ZERO(usage->temp_blk_write_time));
-		bool		show_planning = (planning && (has_shared ||
-												  has_local || has_temp || has_timing ||
-												  has_temp_timing));
-
-		if (show_planning)
-		{
-			ExplainIndentText(es);
-			appendStringInfoString(es->str, "Planning:\n");
-			es->indent++;
-		}
 
 		/* Show only positive counter values. */
 		if (has_shared || has_local || has_temp)
@@ -3640,9 +3766,6 @@ show_buffer_usage(ExplainState *es, const BufferUsage *usage, bool planning)
 			}
 			appendStringInfoChar(es->str, '\n');
 		}
-
-		if (show_planning)
-			es->indent--;
 	}
 	else
 	{
@@ -3684,6 +3807,61 @@ show_buffer_usage(ExplainState *es, const BufferUsage *usage, bool planning)
 	}
 }
 
+/*
+ * Show the planner's memory consumption and work counters.
+ */
+static void
+show_planner_usage(ExplainState *es, const PlannerUsage *usage,
+				   const MemoryContextCounters *mem_counters)
+{
+	int64		memUsedKb = (mem_counters->totalspace -
+							 mem_counters->freespace + 1023) / 1024;
+	int64		memAllocatedKb = (mem_counters->totalspace + 1023) / 1024;
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainIndentText(es);
+		appendStringInfo(es->str,
+						 "Memory: used=" INT64_FORMAT "kB  allocated=" INT64_FORMAT "kB\n",
+						 memUsedKb, memAllocatedKb);
+		ExplainIndentText(es);
+		appendStringInfo(es->str,
+						 "Paths: rels=" INT64_FORMAT "  added=" INT64_FORMAT "  discarded=" INT64_FORMAT "\n",
+						 usage->rels_built, usage->paths_added,
+						 usage->paths_discarded);
+		ExplainIndentText(es);
+		appendStringInfo(es->str,
+						 "Phase Timings: subquery_planner=%0.3f make_one_rel=%0.3f create_plan=%0.3f setrefs=%0.3f\n",
+						 INSTR_TIME_GET_MILLISEC(usage->subquery_planner_time),
+						 INSTR_TIME_GET_MILLISEC(usage->make_one_rel_time),
+						 INSTR_TIME_GET_MILLISEC(usage->create_plan_time),
+						 INSTR_TIME_GET_MILLISEC(usage->setrefs_time));
+	}
+	else
+	{
+		ExplainPropertyInteger("Memory Used", "kB", memUsedKb, es);
+		ExplainPropertyInteger("Memory Allocated", "kB", memAllocatedKb, es);
+		ExplainPropertyInteger("Relations Built", NULL,
+							   usage->rels_built, es);
+		ExplainPropertyInteger("Paths Added", NULL,
+							   usage->paths_added, es);
+		ExplainPropertyInteger("Paths Discarded", NULL,
+							   usage->paths_discarded, es);
+		ExplainPropertyFloat("Subquery Planner Time", "ms",
+							 INSTR_TIME_GET_MILLISEC(usage->subquery_planner_time),
+							 3, es);
+		ExplainPropertyFloat("Make One Rel Time", "ms",
+							 INSTR_TIME_GET_MILLISEC(usage->make_one_rel_time),
+							 3, es);
+		ExplainPropertyFloat("Create Plan Time", "ms",
+							 INSTR_TIME_GET_MILLISEC(usage->create_plan_time),
+							 3, es);
+		ExplainPropertyFloat("Set References Time", "ms",
+							 INSTR_TIME_GET_MILLISEC(usage->setrefs_time),
+							 3, es);
+	}
+}
+
 /*
  * Show WAL usage details.
  */
@@ -3722,6 +3900,53 @@ show_wal_usage(ExplainState *es, const WalUsage *usage)
 	}
 }
 
+/*
+ * Show the time spent in wait events, by wait event class.
+ */
+static void
+show_wait_usage(ExplainState *es, const WaitUsage *usage)
+{
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		bool		has_waits = false;
+
+		/* Show only the classes with positive times. */
+		for (int i = 0; i < WAIT_USAGE_NUM_CLASSES; i++)
+		{
+			if (INSTR_TIME_IS_ZERO(usage->wait_time[i]))
+				continue;
+
+			if (!has_waits)
+			{
+				ExplainIndentText(es);
+				appendStringInfoString(es->str, "Wait Time:");
+				has_waits = true;
+			}
+			appendStringInfo(es->str, " %s=%0.3f",
+							 pgstat_get_wait_event_type((uint32) i << 24),
+							 INSTR_TIME_GET_MILLISEC(usage->wait_time[i]));
+		}
+		if (has_waits)
+			appendStringInfoChar(es->str, '\n');
+	}
+	else
+	{
+		ExplainOpenGroup("Wait Time", "Wait Time", true, es);
+		for (int i = 0; i < WAIT_USAGE_NUM_CLASSES; i++)
+		{
+			const char *type = pgstat_get_wait_event_type((uint32) i << 24);
+
+			/* skip the unused class IDs */
+			if (type == NULL || strcmp(type, "???") == 0)
+				continue;
+			ExplainPropertyFloat(type, "ms",
+								 INSTR_TIME_GET_MILLISEC(usage->wait_time[i]),
+								 3, es);
+		}
+		ExplainCloseGroup("Wait Time", "Wait Time", true, es);
+	}
+}
+
 /*
  * Add some additional details about an IndexScan or IndexOnlyScan
  */
@@ -22,6 +22,7 @@
 #include "access/sysattr.h"
 #include "access/tableam.h"
 #include "access/xact.h"
+#include "access/xlog.h"
 #include "catalog/catalog.h"
 #include "catalog/index.h"
 #include "catalog/indexing.h"
@@ -561,6 +562,7 @@ DefineIndex(Oid relationId,
 	int			numberOfAttributes;
 	int			numberOfKeyAttributes;
 	TransactionId limitXmin;
+	XLogRecPtr	startlsn;
 	ObjectAddress address;
 	LockRelId	heaprelid;
 	LOCKTAG		heaplocktag;
@@ -1559,7 +1561,12 @@ DefineIndex(Oid relationId,
 	 * one of the transactions in question is blocked trying to acquire an
 	 * exclusive lock on our table.  The lock code will detect deadlock and
 	 * error out properly.
+	 *
+	 * Remember the WAL insert position first: heap pages not modified since
+	 * then can't hold tuples that the build below misses, so validate_index()
+	 * can pass over them.
 	 */
+	startlsn = GetXLogInsertRecPtr();
 	WaitForLockers(heaplocktag, ShareLock, true);
 
 	/*
@@ -1630,7 +1637,7 @@ DefineIndex(Oid relationId,
 	/*
 	 * Scan the index and the heap, insert any missing index entries.
 	 */
-	validate_index(relationId, indexRelationId, snapshot);
+	validate_index(relationId, indexRelationId, snapshot, startlsn);
 
 	/*
 	 * Drop the reference snapshot.  We must do this before waiting out other
@@ -3359,6 +3366,7 @@ ReindexRelationConcurrently(Oid relationOid, ReindexParams *params)
 			   *lc2;
 	MemoryContext private_context;
 	MemoryContext oldcontext;
+	XLogRecPtr	startlsn;
 	char		relkind;
 	char	   *relationName = NULL;
 	char	   *relationNamespace = NULL;
@@ -3840,6 +3848,7 @@ ReindexRelationConcurrently(Oid relationOid, ReindexParams *params)
 
 	pgstat_progress_update_param(PROGRESS_CREATEIDX_PHASE,
 								 PROGRESS_CREATEIDX_PHASE_WAIT_1);
+	startlsn = GetXLogInsertRecPtr();
 	WaitForLockersMultiple(lockTags, ShareLock, true);
 	CommitTransactionCommand();
 
@@ -3940,7 +3949,7 @@ ReindexRelationConcurrently(Oid relationOid, ReindexParams *params)
 		progress_vals[3] = newidx->amId;
 		pgstat_progress_update_multi_param(4, progress_index, progress_vals);
 
-		validate_index(newidx->tableId, newidx->indexId, snapshot);
+		validate_index(newidx->tableId, newidx->indexId, snapshot, startlsn);
 
 		/*
 		 * We can now do away with our active snapshot, we still need to save
@@ -56,14 +56,22 @@ typedef struct
 	CommandId	output_cid;		/* cmin to insert in output tuples */
 	int			ti_options;		/* table_tuple_insert performance options */
 	BulkInsertState bistate;	/* bulk insert state */
+	TupleTableSlot **slots;		/* tuples buffered for table_multi_insert */
+	int			nbuffered;		/* # of tuples in slots */
+	Size		bufferedBytes;	/* estimated size of the buffered tuples */
 } DR_transientrel;
 
+/* Limits on the tuples buffered for table_multi_insert, as in createas.c */
+#define MAX_BUFFERED_TUPLES		1000
+#define MAX_BUFFERED_BYTES		65535
+
 static int	matview_maintenance_depth = 0;
 
 static void transientrel_startup(DestReceiver *self, int operation, TupleDesc typeinfo);
 static bool transientrel_receive(TupleTableSlot *slot, DestReceiver *self);
 static void transientrel_shutdown(DestReceiver *self);
 static void transientrel_destroy(DestReceiver *self);
+static void transientrel_flush(DR_transientrel *myState);
 static uint64 refresh_matview_datafill(DestReceiver *dest, Query *query,
 									   const char *queryString);
 static char *make_temptable_name_n(char *tempname, int n);
@@ -465,6 +473,9 @@ transientrel_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
 	myState->output_cid = GetCurrentCommandId(true);
 	myState->ti_options = TABLE_INSERT_SKIP_FSM | TABLE_INSERT_FROZEN;
 	myState->bistate = GetBulkInsertState();
+	myState->slots = palloc0(sizeof(TupleTableSlot *) * MAX_BUFFERED_TUPLES);
+	myState->nbuffered = 0;
+	myState->bufferedBytes = 0;
 
 	/*
 	 * Valid smgr_targblock implies something already wrote to the relation.
@@ -480,21 +491,26 @@ static bool
 transientrel_receive(TupleTableSlot *slot, DestReceiver *self)
 {
 	DR_transientrel *myState = (DR_transientrel *) self;
+	TupleTableSlot *batchslot;
 
 	/*
-	 * Note that the input slot might not be of the type of the target
-	 * relation. That's supported by table_tuple_insert(), but slightly less
-	 * efficient than inserting with the right slot - but the alternative
-	 * would be to copy into a slot of the right type, which would not be
-	 * cheap either. This also doesn't allow accessing per-AM data (say a
-	 * tuple's xmin), but since we don't do that here...
+	 * Buffer the tuple for insertion with table_multi_insert, copying it
+	 * into a slot of the type of the target relation; see intorel_receive.
 	 */
+	if (myState->slots[myState->nbuffered] == NULL)
+		myState->slots[myState->nbuffered] =
+			table_slot_create(myState->transientrel, NULL);
+	batchslot = myState->slots[myState->nbuffered];
 
-	table_tuple_insert(myState->transientrel,
-					   slot,
-					   myState->output_cid,
-					   myState->ti_options,
-					   myState->bistate);
+	slot_getallattrs(slot);
+	myState->bufferedBytes +=
+		heap_compute_data_size(slot->tts_tupleDescriptor,
+							   slot->tts_values, slot->tts_isnull);
+	ExecCopySlot(batchslot, slot);
+
+	if (++myState->nbuffered >= MAX_BUFFERED_TUPLES ||
+		myState->bufferedBytes >= MAX_BUFFERED_BYTES)
+		transientrel_flush(myState);
 
 	/* We know this is a newly created relation, so there are no indexes */
 
@@ -509,6 +525,12 @@ transientrel_shutdown(DestReceiver *self)
 {
 	DR_transientrel *myState = (DR_transientrel *) self;
 
+	transientrel_flush(myState);
+	for (int i = 0; i < MAX_BUFFERED_TUPLES && myState->slots[i] != NULL; i++)
+		ExecDropSingleTupleTableSlot(myState->slots[i]);
+	pfree(myState->slots);
+	myState->slots = NULL;
+
 	FreeBulkInsertState(myState->bistate);
 
 	table_finish_bulk_insert(myState->transientrel, myState->ti_options);
@@ -518,6 +540,29 @@ transientrel_shutdown(DestReceiver *self)
 	myState->transientrel = NULL;
 }
 
+/*
+ * transientrel_flush --- insert the buffered tuples
+ */
+static void
+transientrel_flush(DR_transientrel *myState)
+{
+	if (myState->nbuffered == 0)
+		return;
+
+	table_multi_insert(myState->transientrel,
+					   myState->slots,
+					   myState->nbuffered,
+					   myState->output_cid,
+					   myState->ti_options,
+					   myState->bistate);
+
+	for (int i = 0; i < myState->nbuffered; i++)
+		ExecClearTuple(myState->slots[i]);
+
+	myState->nbuffered = 0;
+	myState->bufferedBytes = 0;
+}
+
 /*
  * transientrel_destroy --- release DestReceiver object
  */
@@ -597,6 +642,7 @@ refresh_by_match_merge(Oid matviewOid, Oid tempOid, Oid relowner,
 	ListCell   *indexoidscan;
 	int16		relnatts;
 	Oid		   *opUsedForQual;
+	uint64		ndiff;
 
 	initStringInfo(&querybuf);
 	matviewRel = table_open(matviewOid, NoLock);
@@ -795,6 +841,7 @@ refresh_by_match_merge(Oid matviewOid, Oid tempOid, Oid relowner,
 	/* Create the temporary "diff" table. */
 	if (SPI_exec(querybuf.data, 0) != SPI_OK_UTILITY)
 		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+	ndiff = SPI_processed;
 
 	SetUserIdAndSecContext(relowner,
 						   save_sec_context | SECURITY_RESTRICTED_OPERATION);
@@ -804,36 +851,45 @@ refresh_by_match_merge(Oid matviewOid, Oid tempOid, Oid relowner,
 	 * must keep it around because its type is referenced from the diff table.
 	 */
 
-	/* Analyze the diff table. */
-	resetStringInfo(&querybuf);
-	appendStringInfo(&querybuf, "ANALYZE %s", diffname);
-	if (SPI_exec(querybuf.data, 0) != SPI_OK_UTILITY)
-		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
-
-	OpenMatViewIncrementalMaintenance();
-
-	/* Deletes must come before inserts; do them first. */
-	resetStringInfo(&querybuf);
-	appendStringInfo(&querybuf,
-					 "DELETE FROM %s mv WHERE ctid OPERATOR(pg_catalog.=) ANY "
-					 "(SELECT diff.tid FROM %s diff "
-					 "WHERE diff.tid IS NOT NULL "
-					 "AND diff.newdata IS NULL)",
-					 matviewname, diffname);
-	if (SPI_exec(querybuf.data, 0) != SPI_OK_DELETE)
-		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
-
-	/* Inserts go last. */
-	resetStringInfo(&querybuf);
-	appendStringInfo(&querybuf,
-					 "INSERT INTO %s SELECT (diff.newdata).* "
-					 "FROM %s diff WHERE tid IS NULL",
-					 matviewname, diffname);
-	if (SPI_exec(querybuf.data, 0) != SPI_OK_INSERT)
-		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
-
-	/* We're done maintaining the materialized view. */
-	CloseMatViewIncrementalMaintenance();
+	/*
+	 * If nothing changed, there's nothing to apply.  This is common when a
+	 * view is refreshed frequently, and saves analyzing the diff table as
+	 * well as the DELETE and INSERT, each of which would otherwise have to
+	 * be planned and would look at the materialized view again.
+	 */
+	if (ndiff > 0)
+	{
+		/* Analyze the diff table. */
+		resetStringInfo(&querybuf);
+		appendStringInfo(&querybuf, "ANALYZE %s", diffname);
+		if (SPI_exec(querybuf.data, 0) != SPI_OK_UTILITY)
+			elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+		OpenMatViewIncrementalMaintenance();
+
+		/* Deletes must come before inserts; do them first. */
+		resetStringInfo(&querybuf);
+		appendStringInfo(&querybuf,
+						 "DELETE FROM %s mv WHERE ctid OPERATOR(pg_catalog.=) ANY "
+						 "(SELECT diff.tid FROM %s diff "
+						 "WHERE diff.tid IS NOT NULL "
+						 "AND diff.newdata IS NULL)",
+						 matviewname, diffname);
+		if (SPI_exec(querybuf.data, 0) != SPI_OK_DELETE)
+			elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+		/* Inserts go last. */
+		resetStringInfo(&querybuf);
+		appendStringInfo(&querybuf,
+						 "INSERT INTO %s SELECT (diff.newdata).* "
+						 "FROM %s diff WHERE tid IS NULL",
+						 matviewname, diffname);
+		if (SPI_exec(querybuf.data, 0) != SPI_OK_INSERT)
+			elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+		/* We're done maintaining the materialized view. */
+		CloseMatViewIncrementalMaintenance();
+	}
 	table_close(tempRel, NoLock);
 	table_close(matviewRel, NoLock);
 
@@ -295,9 +295,13 @@ PortalCleanup(Portal portal)
 			if (portal->resowner)
 				CurrentResourceOwner = portal->resowner;
 
-			ExecutorFinish(queryDesc);
-			ExecutorEnd(queryDesc);
-			FreeQueryDesc(queryDesc);
+			/* A query kept for reuse is only suspended */
+			if (!SuspendReusableQuery(queryDesc))
+			{
+				ExecutorFinish(queryDesc);
+				ExecutorEnd(queryDesc);
+				FreeQueryDesc(queryDesc);
+			}
 
 			CurrentResourceOwner = saveResourceOwner;
 		}
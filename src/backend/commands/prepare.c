@@ -25,6 +25,7 @@
 #include "funcapi.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
 #include "parser/analyze.h"
 #include "parser/parse_coerce.h"
 #include "parser/parse_collate.h"
@@ -34,6 +35,7 @@
 #include "tcop/pquery.h"
 #include "tcop/utility.h"
 #include "utils/builtins.h"
+#include "utils/memutils.h"
 #include "utils/snapmgr.h"
 #include "utils/timestamp.h"
 
@@ -558,6 +560,16 @@ DropAllPreparedStatements(void)
 	}
 }
 
+/*
+ * Are there any prepared statements?
+ */
+bool
+HavePreparedStatements(void)
+{
+	return prepared_queries != NULL &&
+		hash_get_num_entries(prepared_queries) > 0;
+}
+
 /*
  * Implements the 'EXPLAIN EXECUTE' utility statement.
  *
@@ -583,6 +595,21 @@ ExplainExecuteQuery(ExecuteStmt *execstmt, IntoClause *into, ExplainState *es,
 	instr_time	planduration;
 	BufferUsage bufusage_start,
 				bufusage;
+	PlannerUsage planusage_start,
+				planusage;
+	MemoryContextCounters mem_counters;
+	MemoryContext planner_ctx = NULL;
+	MemoryContext saved_ctx = NULL;
+
+	if (es->planning)
+	{
+		/* See ExplainOneQuery about this */
+		planner_ctx = AllocSetContextCreate(CurrentMemoryContext,
+											"explain planner context",
+											ALLOCSET_DEFAULT_SIZES);
+		saved_ctx = MemoryContextSwitchTo(planner_ctx);
+		planusage_start = pgPlannerUsage;
+	}
 
 	if (es->buffers)
 		bufusage_start = pgBufferUsage;
@@ -631,6 +658,15 @@ ExplainExecuteQuery(ExecuteStmt *execstmt, IntoClause *into, ExplainState *es,
 		BufferUsageAccumDiff(&bufusage, &pgBufferUsage, &bufusage_start);
 	}
 
+	if (es->planning)
+	{
+		MemoryContextSwitchTo(saved_ctx);
+		memset(&planusage, 0, sizeof(PlannerUsage));
+		PlannerUsageAccumDiff(&planusage, &pgPlannerUsage, &planusage_start);
+		memset(&mem_counters, 0, sizeof(MemoryContextCounters));
+		MemoryContextMemConsumed(planner_ctx, &mem_counters);
+	}
+
 	plan_list = cplan->stmt_list;
 
 	/* Explain each query */
@@ -640,7 +676,9 @@ ExplainExecuteQuery(ExecuteStmt *execstmt, IntoClause *into, ExplainState *es,
 
 		if (pstmt->commandType != CMD_UTILITY)
 			ExplainOnePlan(pstmt, into, es, query_string, paramLI, queryEnv,
-						   &planduration, (es->buffers ? &bufusage : NULL));
+						   &planduration, (es->buffers ? &bufusage : NULL),
+						   (es->planning ? &planusage : NULL),
+						   (es->planning ? &mem_counters : NULL));
 		else
 			ExplainOneUtility(pstmt->utilityStmt, into, es, query_string,
 							  paramLI, queryEnv);
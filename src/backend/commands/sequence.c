@@ -34,13 +34,17 @@
 #include "commands/defrem.h"
 #include "commands/sequence.h"
 #include "commands/tablecmds.h"
+#include "common/hashfn.h"
 #include "funcapi.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "parser/parse_type.h"
+#include "port/atomics.h"
 #include "storage/lmgr.h"
 #include "storage/proc.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
@@ -95,6 +99,47 @@ static HTAB *seqhashtab = NULL; /* hash table for SeqTable items */
  */
 static SeqTableData *last_used_seq = NULL;
 
+/*
+ * Shared sequence cache.
+ *
+ * If shared_sequence_cache_entries is set, values that nextval() fetches
+ * from a permanent or unlogged sequence beyond the one it returns are
+ * published in shared memory rather than being cached by the backend, and
+ * any backend can hand them out without locking the sequence's buffer.
+ * Ranges are reserved exactly the way backend-local caches are: the values
+ * have already been consumed on the sequence page, so handing them out later
+ * is safe no matter what happens to the sequence in the meantime, except
+ * that setval() moves the sequence backwards in place; it clears the entry.
+ * Values that are never handed out are lost, as they are with backend-local
+ * caches.
+ *
+ * Entries are keyed by the sequence's RelFileLocator, so ALTER SEQUENCE and
+ * TRUNCATE ... RESTART IDENTITY, which create new storage, implicitly
+ * invalidate them.  Entries for storage that is newly created are cleared,
+ * in case a relfilenumber gets reused.  The cache is direct-mapped; a
+ * sequence whose entry is taken by another one simply refills it.
+ *
+ * Handing out a value is lock-free: a backend atomically increments "used"
+ * and computes the value from the range.  Refilling an entry is serialized
+ * by its spinlock and bumps "generation" before and after changing the
+ * range, so that readers can detect that the range they read may not be the
+ * one their increment applied to, and retry the slow way.
+ */
+typedef struct SeqSharedCacheEntry
+{
+	slock_t		mutex;			/* serializes changes to the entry */
+	pg_atomic_uint32 generation;	/* odd while the entry is being changed */
+	RelFileLocator locator;		/* storage of the sequence */
+	int64		first;			/* first value of the range */
+	int64		increment;		/* copy of sequence's increment field */
+	uint64		count;			/* number of values in the range */
+	pg_atomic_uint64 used;		/* number of values handed out */
+} SeqSharedCacheEntry;
+
+int			shared_sequence_cache_entries = 0;
+
+static SeqSharedCacheEntry *SeqSharedCache = NULL;
+
 static void fill_seq_with_data(Relation rel, HeapTuple tuple);
 static void fill_seq_fork_with_data(Relation rel, HeapTuple tuple, ForkNumber forkNum);
 static Relation lock_and_open_sequence(SeqTable seq);
@@ -110,6 +155,14 @@ static void init_params(ParseState *pstate, List *options, bool for_identity,
 						List **owned_by);
 static void do_setval(Oid relid, int64 next, bool iscalled);
 static void process_owned_by(Relation seqrel, List *owned_by, bool for_identity);
+static inline bool seq_uses_shared_cache(Relation seqrel);
+static SeqSharedCacheEntry *seq_shared_cache_entry(const RelFileLocator *locator);
+static bool seq_shared_cache_fetch(const RelFileLocator *locator,
+								   int64 *result, int64 *increment);
+static bool seq_shared_cache_publish(const RelFileLocator *locator,
+									 int64 first, int64 increment,
+									 uint64 count);
+static void seq_shared_cache_invalidate(const RelFileLocator *locator);
 
 
 /*
@@ -349,6 +402,10 @@ ResetSequence(Oid seq_relid)
 static void
 fill_seq_with_data(Relation rel, HeapTuple tuple)
 {
+	/* forget values a previous user of this relfilenumber left behind */
+	if (seq_uses_shared_cache(rel))
+		seq_shared_cache_invalidate(&rel->rd_locator);
+
 	fill_seq_fork_with_data(rel, tuple, MAIN_FORKNUM);
 
 	if (rel->rd_rel->relpersistence == RELPERSISTENCE_UNLOGGED)
@@ -648,6 +705,8 @@ nextval_internal(Oid relid, bool check_permissions)
 				rescnt = 0;
 	bool		cycle;
 	bool		logit = false;
+	bool		shared;
+	XLogRecPtr	flushptr = InvalidXLogRecPtr;
 
 	/* open and lock sequence */
 	init_sequence(relid, &elm, &seqrel);
@@ -681,6 +740,18 @@ nextval_internal(Oid relid, bool check_permissions)
 		return elm->last;
 	}
 
+	/* try to get a value cached by any backend */
+	shared = seq_uses_shared_cache(seqrel);
+	if (shared &&
+		seq_shared_cache_fetch(&seqrel->rd_locator, &result, &elm->increment))
+	{
+		elm->last = elm->cached = result;
+		elm->last_valid = true;
+		relation_close(seqrel, NoLock);
+		last_used_seq = elm;
+		return result;
+	}
+
 	pgstuple = SearchSysCache1(SEQRELID, ObjectIdGetDatum(relid));
 	if (!HeapTupleIsValid(pgstuple))
 		elog(ERROR, "cache lookup failed for sequence %u", relid);
@@ -696,6 +767,31 @@ nextval_internal(Oid relid, bool check_permissions)
 	seq = read_seq_tuple(seqrel, &buf, &seqdatatuple);
 	page = BufferGetPage(buf);
 
+	if (shared)
+	{
+		/*
+		 * Somebody may have refilled the shared cache while we waited for
+		 * the lock; if so, use that rather than reserving another range.
+		 */
+		if (seq_shared_cache_fetch(&seqrel->rd_locator, &result,
+								   &elm->increment))
+		{
+			UnlockReleaseBuffer(buf);
+			elm->last = elm->cached = result;
+			elm->last_valid = true;
+			relation_close(seqrel, NoLock);
+			last_used_seq = elm;
+			return result;
+		}
+
+		/*
+		 * A shared range is pointless if it's too small to be used by more
+		 * than one backend, so reserve at least as many values as we'd log
+		 * anyway.
+		 */
+		cache = Max(cache, SEQ_LOG_VALS);
+	}
+
 	elm->increment = incby;
 	last = next = result = seq->last_value;
 	fetch = cache;
@@ -861,8 +957,28 @@ nextval_internal(Oid relid, bool check_permissions)
 
 	END_CRIT_SECTION();
 
+	if (shared && RelationNeedsWAL(seqrel))
+		flushptr = PageGetLSN(page);
+
 	UnlockReleaseBuffer(buf);
 
+	/*
+	 * Offer the rest of what we fetched to other backends.  The values we
+	 * fetched never wrap around, so they're always an arithmetic series.
+	 * Other backends may use them in transactions that commit before ours,
+	 * so first make sure the WAL record covering them is flushed; otherwise a
+	 * crash could hand them out again.  If the entry is still busy with an
+	 * earlier range, keep the values for ourselves instead.
+	 */
+	if (shared && rescnt > 1)
+	{
+		if (!XLogRecPtrIsInvalid(flushptr))
+			XLogFlush(flushptr);
+		if (seq_shared_cache_publish(&seqrel->rd_locator, result + incby,
+									 incby, rescnt - 1))
+			elm->cached = result;
+	}
+
 	relation_close(seqrel, NoLock);
 
 	return result;
@@ -1007,6 +1123,8 @@ do_setval(Oid relid, int64 next, bool iscalled)
 
 	/* In any case, forget any future cached numbers */
 	elm->cached = elm->last;
+	if (seq_uses_shared_cache(seqrel))
+		seq_shared_cache_invalidate(&seqrel->rd_locator);
 
 	/* check the comment above nextval_internal()'s equivalent call. */
 	if (RelationNeedsWAL(seqrel))
@@ -1891,6 +2009,173 @@ ResetSequenceCaches(void)
 	last_used_seq = NULL;
 }
 
+/*
+ * Report shared memory space needed by the shared sequence cache
+ */
+Size
+SequenceShmemSize(void)
+{
+	return mul_size(shared_sequence_cache_entries,
+					sizeof(SeqSharedCacheEntry));
+}
+
+/*
+ * Initialize the shared sequence cache during startup
+ */
+void
+SequenceShmemInit(void)
+{
+	bool		found;
+
+	if (shared_sequence_cache_entries <= 0)
+		return;
+
+	SeqSharedCache = (SeqSharedCacheEntry *)
+		ShmemInitStruct("Shared Sequence Cache", SequenceShmemSize(), &found);
+
+	if (!found)
+	{
+		for (int i = 0; i < shared_sequence_cache_entries; i++)
+		{
+			SeqSharedCacheEntry *entry = &SeqSharedCache[i];
+
+			SpinLockInit(&entry->mutex);
+			pg_atomic_init_u32(&entry->generation, 0);
+			memset(&entry->locator, 0, sizeof(RelFileLocator));
+			entry->first = 0;
+			entry->increment = 0;
+			entry->count = 0;
+			pg_atomic_init_u64(&entry->used, 0);
+		}
+	}
+}
+
+/*
+ * Does the sequence hand out values through the shared sequence cache?
+ *
+ * Temporary sequences can only be used by one backend anyway.
+ */
+static inline bool
+seq_uses_shared_cache(Relation seqrel)
+{
+	return SeqSharedCache != NULL &&
+		seqrel->rd_rel->relpersistence != RELPERSISTENCE_TEMP;
+}
+
+static SeqSharedCacheEntry *
+seq_shared_cache_entry(const RelFileLocator *locator)
+{
+	uint32		hash;
+
+	hash = hash_bytes((const unsigned char *) locator, sizeof(RelFileLocator));
+
+	return &SeqSharedCache[hash % shared_sequence_cache_entries];
+}
+
+/*
+ * Try to take the next value of a sequence from the shared cache.
+ *
+ * Returns true and sets *result and *increment if successful.  This doesn't
+ * take any locks, so it may fail spuriously if the entry is being refilled
+ * concurrently; the value we might have consumed is then lost.
+ */
+static bool
+seq_shared_cache_fetch(const RelFileLocator *locator, int64 *result,
+					   int64 *increment)
+{
+	SeqSharedCacheEntry *entry = seq_shared_cache_entry(locator);
+	uint32		generation;
+	int64		first;
+	int64		incby;
+	uint64		count;
+	uint64		n;
+
+	generation = pg_atomic_read_u32(&entry->generation);
+	if (generation & 1)
+		return false;
+	pg_read_barrier();
+
+	if (!RelFileLocatorEquals(entry->locator, *locator))
+		return false;
+	first = entry->first;
+	incby = entry->increment;
+	count = entry->count;
+
+	/* don't keep incrementing the counter of an exhausted entry */
+	if (pg_atomic_read_u64(&entry->used) >= count)
+		return false;
+
+	/* this acts as a full barrier */
+	n = pg_atomic_fetch_add_u64(&entry->used, 1);
+
+	/* if the entry changed, n might belong to a different range */
+	if (pg_atomic_read_u32(&entry->generation) != generation)
+		return false;
+	if (n >= count)
+		return false;
+
+	*result = first + (int64) n * incby;
+	*increment = incby;
+	return true;
+}
+
+/*
+ * Publish a range of values of a sequence in the shared cache.
+ *
+ * Returns false, leaving the entry alone, if it still holds values of the
+ * same sequence.
+ */
+static bool
+seq_shared_cache_publish(const RelFileLocator *locator, int64 first,
+						 int64 increment, uint64 count)
+{
+	SeqSharedCacheEntry *entry = seq_shared_cache_entry(locator);
+
+	SpinLockAcquire(&entry->mutex);
+
+	if (RelFileLocatorEquals(entry->locator, *locator) &&
+		pg_atomic_read_u64(&entry->used) < entry->count)
+	{
+		SpinLockRelease(&entry->mutex);
+		return false;
+	}
+
+	pg_atomic_fetch_add_u32(&entry->generation, 1);
+	entry->locator = *locator;
+	entry->first = first;
+	entry->increment = increment;
+	entry->count = count;
+	pg_atomic_write_u64(&entry->used, 0);
+	pg_write_barrier();
+	pg_atomic_fetch_add_u32(&entry->generation, 1);
+
+	SpinLockRelease(&entry->mutex);
+
+	return true;
+}
+
+/*
+ * Discard any values of a sequence in the shared cache.
+ */
+static void
+seq_shared_cache_invalidate(const RelFileLocator *locator)
+{
+	SeqSharedCacheEntry *entry = seq_shared_cache_entry(locator);
+
+	SpinLockAcquire(&entry->mutex);
+
+	if (RelFileLocatorEquals(entry->locator, *locator))
+	{
+		pg_atomic_fetch_add_u32(&entry->generation, 1);
+		entry->count = 0;
+		pg_atomic_write_u64(&entry->used, 0);
+		pg_write_barrier();
+		pg_atomic_fetch_add_u32(&entry->generation, 1);
+	}
+
+	SpinLockRelease(&entry->mutex);
+}
+
 /*
  * Mask a Sequence page before performing consistency checks on it.
  */
@@ -89,6 +89,7 @@
 #include "storage/lock.h"
 #include "storage/predicate.h"
 #include "storage/smgr.h"
+#include "tcop/pquery.h"
 #include "tcop/utility.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
@@ -4036,6 +4037,9 @@ CheckTableNotInUse(Relation rel, const char *stmt)
 {
 	int			expected_refcnt;
 
+	/* Queries kept for reuse by prepared statements hold relations open */
+	DropReusableQueries();
+
 	expected_refcnt = rel->rd_isnailed ? 2 : 1;
 	if (rel->rd_refcnt != expected_refcnt)
 		ereport(ERROR,
@@ -27,6 +27,7 @@
 #include "postgres.h"
 
 #include "access/amapi.h"
+#include "access/heapam.h"
 #include "access/table.h"
 #include "access/xact.h"
 #include "catalog/index.h"
@@ -34,6 +35,7 @@
 #include "optimizer/paths.h"
 #include "pgstat.h"
 #include "storage/bufmgr.h"
+#include "storage/lwlock.h"
 #include "tcop/tcopprot.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
@@ -44,11 +46,10 @@
  * use small integers.
  */
 #define PARALLEL_VACUUM_KEY_SHARED			1
-#define PARALLEL_VACUUM_KEY_DEAD_ITEMS		2
-#define PARALLEL_VACUUM_KEY_QUERY_TEXT		3
-#define PARALLEL_VACUUM_KEY_BUFFER_USAGE	4
-#define PARALLEL_VACUUM_KEY_WAL_USAGE		5
-#define PARALLEL_VACUUM_KEY_INDEX_STATS		6
+#define PARALLEL_VACUUM_KEY_QUERY_TEXT		2
+#define PARALLEL_VACUUM_KEY_BUFFER_USAGE	3
+#define PARALLEL_VACUUM_KEY_WAL_USAGE		4
+#define PARALLEL_VACUUM_KEY_INDEX_STATS		5
 
 /*
  * Shared information among parallel workers.  So this is allocated in the DSM
@@ -87,6 +88,26 @@ typedef struct PVShared
 	 */
 	int			maintenance_work_mem_worker;
 
+	/*
+	 * The dead items are kept in a TidStore in a DSA area, since the store
+	 * grows as the leader scans the heap.  Workers attach to it for index
+	 * vacuuming, which only happens once the leader has stopped adding to it.
+	 */
+	dsa_handle	dead_items_dsa_handle;
+	dsa_pointer dead_items_handle;
+
+	/*
+	 * Fields for the second pass over the heap, in which workers help the
+	 * leader to mark the dead items LP_UNUSED.  heap_pass is true when the
+	 * workers are launched for that rather than for index processing.  The
+	 * workers claim heap pages from the dead_items store's shared iteration,
+	 * and add up the pages and items they vacuumed in the counters.
+	 */
+	bool		heap_pass;
+	TransactionId heap_pass_oldest_xmin;
+	pg_atomic_uint64 heap_pass_pages;
+	pg_atomic_uint64 heap_pass_items;
+
 	/*
 	 * Shared vacuum cost balance.  During parallel vacuum,
 	 * VacuumSharedCostBalance points to this value and it accumulates the
@@ -165,8 +186,9 @@ struct ParallelVacuumState
 	 */
 	PVIndStats *indstats;
 
-	/* Shared dead items space among parallel vacuum workers */
-	VacDeadItems *dead_items;
+	/* Shared dead items store among parallel vacuum workers */
+	dsa_area   *dead_items_area;
+	TidStore   *dead_items;
 
 	/* Points to buffer usage area in DSM */
 	BufferUsage *buffer_usage;
@@ -192,6 +214,9 @@ struct ParallelVacuumState
 	/* Buffer access strategy used by leader process */
 	BufferAccessStrategy bstrategy;
 
+	/* Have workers been launched before (so DSM must be reinitialized)? */
+	bool		workers_launched;
+
 	/*
 	 * Error reporting state.  The error callback is set only for workers
 	 * processes during parallel index vacuum.
@@ -222,20 +247,18 @@ static void parallel_vacuum_error_callback(void *arg);
  */
 ParallelVacuumState *
 parallel_vacuum_init(Relation rel, Relation *indrels, int nindexes,
-					 int nrequested_workers, int max_items,
+					 int nrequested_workers, int vac_work_mem,
 					 int elevel, BufferAccessStrategy bstrategy)
 {
 	ParallelVacuumState *pvs;
 	ParallelContext *pcxt;
 	PVShared   *shared;
-	VacDeadItems *dead_items;
 	PVIndStats *indstats;
 	BufferUsage *buffer_usage;
 	WalUsage   *wal_usage;
 	bool	   *will_parallel_vacuum;
 	Size		est_indstats_len;
 	Size		est_shared_len;
-	Size		est_dead_items_len;
 	int			nindexes_mwm = 0;
 	int			parallel_workers = 0;
 	int			querylen;
@@ -283,11 +306,6 @@ parallel_vacuum_init(Relation rel, Relation *indrels, int nindexes,
 	shm_toc_estimate_chunk(&pcxt->estimator, est_shared_len);
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 
-	/* Estimate size for dead_items -- PARALLEL_VACUUM_KEY_DEAD_ITEMS */
-	est_dead_items_len = vac_max_items_to_alloc_size(max_items);
-	shm_toc_estimate_chunk(&pcxt->estimator, est_dead_items_len);
-	shm_toc_estimate_keys(&pcxt->estimator, 1);
-
 	/*
 	 * Estimate space for BufferUsage and WalUsage --
 	 * PARALLEL_VACUUM_KEY_BUFFER_USAGE and PARALLEL_VACUUM_KEY_WAL_USAGE.
@@ -364,18 +382,18 @@ parallel_vacuum_init(Relation rel, Relation *indrels, int nindexes,
 	pg_atomic_init_u32(&(shared->cost_balance), 0);
 	pg_atomic_init_u32(&(shared->active_nworkers), 0);
 	pg_atomic_init_u32(&(shared->idx), 0);
+	pg_atomic_init_u64(&(shared->heap_pass_pages), 0);
+	pg_atomic_init_u64(&(shared->heap_pass_items), 0);
 
 	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_SHARED, shared);
 	pvs->shared = shared;
 
-	/* Prepare the dead_items space */
-	dead_items = (VacDeadItems *) shm_toc_allocate(pcxt->toc,
-												   est_dead_items_len);
-	dead_items->max_items = max_items;
-	dead_items->num_items = 0;
-	MemSet(dead_items->items, 0, sizeof(ItemPointerData) * max_items);
-	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_DEAD_ITEMS, dead_items);
-	pvs->dead_items = dead_items;
+	/* Prepare the dead_items store */
+	pvs->dead_items_area = dsa_create(LWTRANCHE_PARALLEL_VACUUM_DSA);
+	pvs->dead_items = TidStoreCreate((size_t) vac_work_mem * 1024,
+									 pvs->dead_items_area);
+	shared->dead_items_dsa_handle = dsa_get_handle(pvs->dead_items_area);
+	shared->dead_items_handle = TidStoreGetHandle(pvs->dead_items);
 
 	/*
 	 * Allocate space for each worker's BufferUsage and WalUsage; no need to
@@ -434,6 +452,9 @@ parallel_vacuum_end(ParallelVacuumState *pvs, IndexBulkDeleteResult **istats)
 			istats[i] = NULL;
 	}
 
+	TidStoreDestroy(pvs->dead_items);
+	dsa_detach(pvs->dead_items_area);
+
 	DestroyParallelContext(pvs->pcxt);
 	ExitParallelMode();
 
@@ -441,8 +462,8 @@ parallel_vacuum_end(ParallelVacuumState *pvs, IndexBulkDeleteResult **istats)
 	pfree(pvs);
 }
 
-/* Returns the dead items space */
-VacDeadItems *
+/* Returns the dead items store */
+TidStore *
 parallel_vacuum_get_dead_items(ParallelVacuumState *pvs)
 {
 	return pvs->dead_items;
@@ -487,6 +508,106 @@ parallel_vacuum_cleanup_all_indexes(ParallelVacuumState *pvs, long num_table_tup
 	parallel_vacuum_process_all_indexes(pvs, num_index_scans, false);
 }
 
+/*
+ * Launch parallel workers to help with the second pass over the heap, in
+ * which the LP_DEAD items collected in dead_items are marked LP_UNUSED.
+ * oldest_xmin is the cutoff for deciding whether a vacuumed page has become
+ * all-visible.
+ *
+ * Returns false, without launching anything, if there are too few heap pages
+ * to vacuum to make that worthwhile.  Otherwise the leader must take part, by
+ * vacuuming the pages it gets from a TidStoreBeginSharedIterate() iterator
+ * until there are none left, and then call parallel_vacuum_end_heap_pass().
+ */
+bool
+parallel_vacuum_begin_heap_pass(ParallelVacuumState *pvs,
+								TransactionId oldest_xmin)
+{
+	int			nworkers = pvs->pcxt->nworkers;
+
+	Assert(!IsParallelWorker());
+	Assert(!pvs->shared->heap_pass);
+
+	if (TidStoreNumBlocks(pvs->dead_items) < min_parallel_table_scan_size)
+		return false;
+
+	pvs->shared->heap_pass = true;
+	pvs->shared->heap_pass_oldest_xmin = oldest_xmin;
+	pg_atomic_write_u64(&(pvs->shared->heap_pass_pages), 0);
+	pg_atomic_write_u64(&(pvs->shared->heap_pass_items), 0);
+	TidStorePrepareSharedIterate(pvs->dead_items);
+
+	/* Reinitialize parallel context to relaunch parallel workers */
+	if (pvs->workers_launched)
+		ReinitializeParallelDSM(pvs->pcxt);
+	pvs->workers_launched = true;
+
+	/* Set up the shared cost-based vacuum delay, as for index vacuuming */
+	pg_atomic_write_u32(&(pvs->shared->cost_balance), VacuumCostBalance);
+	pg_atomic_write_u32(&(pvs->shared->active_nworkers), 0);
+
+	ReinitializeParallelWorkers(pvs->pcxt, nworkers);
+	LaunchParallelWorkers(pvs->pcxt);
+
+	if (pvs->pcxt->nworkers_launched > 0)
+	{
+		VacuumCostBalance = 0;
+		VacuumCostBalanceLocal = 0;
+		VacuumSharedCostBalance = &(pvs->shared->cost_balance);
+		VacuumActiveNWorkers = &(pvs->shared->active_nworkers);
+
+		/* The leader counts as an active worker until the pass ends */
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+	}
+
+	ereport(pvs->shared->elevel,
+			(errmsg(ngettext("launched %d parallel vacuum worker for heap vacuuming (planned: %d)",
+							 "launched %d parallel vacuum workers for heap vacuuming (planned: %d)",
+							 pvs->pcxt->nworkers_launched),
+					pvs->pcxt->nworkers_launched, nworkers)));
+
+	return true;
+}
+
+/*
+ * Wait for the workers launched by parallel_vacuum_begin_heap_pass() to
+ * finish, and add the numbers of heap pages and items they vacuumed to
+ * *vacuumed_pages and *vacuumed_items.
+ */
+void
+parallel_vacuum_end_heap_pass(ParallelVacuumState *pvs,
+							  BlockNumber *vacuumed_pages,
+							  int64 *vacuumed_items)
+{
+	Assert(!IsParallelWorker());
+	Assert(pvs->shared->heap_pass);
+
+	if (VacuumActiveNWorkers)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+
+	WaitForParallelWorkersToFinish(pvs->pcxt);
+
+	for (int i = 0; i < pvs->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&pvs->buffer_usage[i], &pvs->wal_usage[i]);
+
+	*vacuumed_pages += (BlockNumber)
+		pg_atomic_read_u64(&(pvs->shared->heap_pass_pages));
+	*vacuumed_items += (int64)
+		pg_atomic_read_u64(&(pvs->shared->heap_pass_items));
+
+	pvs->shared->heap_pass = false;
+
+	/*
+	 * Carry the shared balance value to heap scan and disable shared costing
+	 */
+	if (VacuumSharedCostBalance)
+	{
+		VacuumCostBalance = pg_atomic_read_u32(VacuumSharedCostBalance);
+		VacuumSharedCostBalance = NULL;
+		VacuumActiveNWorkers = NULL;
+	}
+}
+
 /*
  * Compute the number of parallel worker processes to request.  Both index
  * vacuum and index cleanup can be executed with parallel workers.
@@ -625,8 +746,9 @@ parallel_vacuum_process_all_indexes(ParallelVacuumState *pvs, int num_index_scan
 	if (nworkers > 0)
 	{
 		/* Reinitialize parallel context to relaunch parallel workers */
-		if (num_index_scans > 0)
+		if (pvs->workers_launched)
 			ReinitializeParallelDSM(pvs->pcxt);
+		pvs->workers_launched = true;
 
 		/*
 		 * Set up shared cost balance and the number of active workers for
@@ -929,8 +1051,8 @@ parallel_vacuum_index_is_parallel_safe(Relation indrel, int num_index_scans,
 /*
  * Perform work within a launched parallel process.
  *
- * Since parallel vacuum workers perform only index vacuum or index cleanup,
- * we don't need to report progress information.
+ * Since parallel vacuum workers perform only index vacuum, index cleanup, or
+ * part of the second heap pass, we don't need to report progress information.
  */
 void
 parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
@@ -940,7 +1062,8 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	Relation   *indrels;
 	PVIndStats *indstats;
 	PVShared   *shared;
-	VacDeadItems *dead_items;
+	dsa_area   *dead_items_area;
+	TidStore   *dead_items;
 	BufferUsage *buffer_usage;
 	WalUsage   *wal_usage;
 	int			nindexes;
@@ -984,10 +1107,9 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 											 PARALLEL_VACUUM_KEY_INDEX_STATS,
 											 false);
 
-	/* Set dead_items space */
-	dead_items = (VacDeadItems *) shm_toc_lookup(toc,
-												 PARALLEL_VACUUM_KEY_DEAD_ITEMS,
-												 false);
+	/* Attach to the dead_items store */
+	dead_items_area = dsa_attach(shared->dead_items_dsa_handle);
+	dead_items = TidStoreAttach(dead_items_area, shared->dead_items_handle);
 
 	/* Set cost-based vacuum delay */
 	VacuumCostActive = (VacuumCostDelay > 0);
@@ -1024,8 +1146,31 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	/* Prepare to track buffer usage during parallel execution */
 	InstrStartParallelQuery();
 
-	/* Process indexes to perform vacuum/cleanup */
-	parallel_vacuum_process_safe_indexes(&pvs);
+	if (shared->heap_pass)
+	{
+		BlockNumber vacuumed_pages = 0;
+		int64		vacuumed_items = 0;
+
+		/* Help with the second heap pass */
+		if (VacuumActiveNWorkers)
+			pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+		heap_vacuum_dead_items_worker(rel, dead_items,
+									  shared->heap_pass_oldest_xmin,
+									  pvs.bstrategy,
+									  &vacuumed_pages, &vacuumed_items);
+
+		if (VacuumActiveNWorkers)
+			pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+
+		pg_atomic_add_fetch_u64(&(shared->heap_pass_pages), vacuumed_pages);
+		pg_atomic_add_fetch_u64(&(shared->heap_pass_items), vacuumed_items);
+	}
+	else
+	{
+		/* Process indexes to perform vacuum/cleanup */
+		parallel_vacuum_process_safe_indexes(&pvs);
+	}
 
 	/* Report buffer/WAL usage during parallel execution */
 	buffer_usage = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_BUFFER_USAGE, false);
@@ -1036,6 +1181,9 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	/* Pop the error context stack */
 	error_context_stack = errcallback.previous;
 
+	TidStoreDetach(dead_items);
+	dsa_detach(dead_items_area);
+
 	vac_close_indexes(nindexes, indrels, RowExclusiveLock);
 	table_close(rel, ShareUpdateExclusiveLock);
 	FreeAccessStrategy(pvs.bstrategy);
@@ -0,0 +1,235 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.c
+ *	  Routines for exchanging columnar batches of tuples between executor
+ *	  nodes.
+ *
+ * Besides returning one tuple per ExecProcNode() call, a node may support
+ * returning a whole TupleBatch per ExecProcNodeBatch() call.  Nodes that do
+ * set PlanState->ExecProcNodeBatch; for all other nodes, ExecProcNodeBatch()
+ * fills the batch by calling ExecProcNode() repeatedly, so that consumers
+ * don't need to care whether their input supports batches.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execBatch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "executor/executor.h"
+#include "executor/instrument.h"
+#include "executor/tuplebatch.h"
+#include "miscadmin.h"
+#include "utils/datum.h"
+#include "utils/memutils.h"
+
+
+/*
+ * MakeTupleBatch
+ *		Create an empty batch for up to maxrows tuples of the given
+ *		descriptor, in the current memory context.
+ */
+TupleBatch *
+MakeTupleBatch(TupleDesc tupdesc, int maxrows)
+{
+	TupleBatch *batch;
+	int			natts = tupdesc->natts;
+
+	Assert(maxrows > 0);
+
+	batch = (TupleBatch *) palloc(sizeof(TupleBatch));
+	batch->tupdesc = tupdesc;
+	batch->natts = natts;
+	batch->maxrows = maxrows;
+	batch->nrows = 0;
+	batch->values = (Datum **) palloc(natts * sizeof(Datum *));
+	batch->isnull = (bool **) palloc(natts * sizeof(bool *));
+	for (int i = 0; i < natts; i++)
+	{
+		batch->values[i] = (Datum *) palloc(maxrows * sizeof(Datum));
+		batch->isnull[i] = (bool *) palloc(maxrows * sizeof(bool));
+	}
+	batch->batch_cxt = AllocSetContextCreate(CurrentMemoryContext,
+											 "TupleBatch",
+											 ALLOCSET_DEFAULT_SIZES);
+
+	return batch;
+}
+
+/*
+ * TupleBatchReset
+ *		Remove all rows from the batch, and free their memory.
+ */
+void
+TupleBatchReset(TupleBatch *batch)
+{
+	batch->nrows = 0;
+	MemoryContextReset(batch->batch_cxt);
+}
+
+/*
+ * TupleBatchAddSlot
+ *		Append the tuple stored in the slot to the batch.
+ *
+ * The slot must have the batch's descriptor, and the batch must not be full.
+ */
+void
+TupleBatchAddSlot(TupleBatch *batch, TupleTableSlot *slot)
+{
+	int			row = batch->nrows;
+	MemoryContext oldcontext = NULL;
+
+	Assert(!TupleBatchIsFull(batch));
+	Assert(slot->tts_tupleDescriptor->natts == batch->natts);
+
+	slot_getallattrs(slot);
+
+	for (int i = 0; i < batch->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(batch->tupdesc, i);
+		Datum		value = slot->tts_values[i];
+		bool		isnull = slot->tts_isnull[i];
+
+		if (!isnull && !att->attbyval)
+		{
+			if (oldcontext == NULL)
+				oldcontext = MemoryContextSwitchTo(batch->batch_cxt);
+			value = datumCopy(value, false, att->attlen);
+		}
+
+		batch->values[i][row] = value;
+		batch->isnull[i][row] = isnull;
+	}
+
+	if (oldcontext != NULL)
+		MemoryContextSwitchTo(oldcontext);
+
+	batch->nrows++;
+}
+
+/*
+ * ExecStoreBatchRow
+ *		Store one row of the batch into a virtual slot.
+ *
+ * The slot's values point into the batch, so they are only valid until the
+ * batch is reset.
+ */
+TupleTableSlot *
+ExecStoreBatchRow(TupleBatch *batch, int row, TupleTableSlot *slot)
+{
+	Assert(row >= 0 && row < batch->nrows);
+	Assert(TTS_IS_VIRTUAL(slot));
+	Assert(slot->tts_tupleDescriptor->natts == batch->natts);
+
+	ExecClearTuple(slot);
+
+	for (int i = 0; i < batch->natts; i++)
+	{
+		slot->tts_values[i] = batch->values[i][row];
+		slot->tts_isnull[i] = batch->isnull[i][row];
+	}
+
+	return ExecStoreVirtualTuple(slot);
+}
+
+/*
+ * TupleBatchKeepRows
+ *		Of the rows from 'start' on, keep only the nsel rows listed in the
+ *		ascending array sel, moving them down to close the gaps.
+ */
+void
+TupleBatchKeepRows(TupleBatch *batch, int start, const int *sel, int nsel)
+{
+	Assert(nsel <= batch->nrows - start);
+
+	/* Nothing to do if all rows are kept */
+	if (nsel == batch->nrows - start)
+		return;
+
+	for (int i = 0; i < batch->natts; i++)
+	{
+		Datum	   *values = batch->values[i];
+		bool	   *isnull = batch->isnull[i];
+
+		for (int k = 0; k < nsel; k++)
+		{
+			values[start + k] = values[sel[k]];
+			isnull[start + k] = isnull[sel[k]];
+		}
+	}
+
+	batch->nrows = start + nsel;
+}
+
+/*
+ * FreeTupleBatch
+ *		Release all memory used by the batch.
+ */
+void
+FreeTupleBatch(TupleBatch *batch)
+{
+	MemoryContextDelete(batch->batch_cxt);
+	for (int i = 0; i < batch->natts; i++)
+	{
+		pfree(batch->values[i]);
+		pfree(batch->isnull[i]);
+	}
+	pfree(batch->values);
+	pfree(batch->isnull);
+	pfree(batch);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecProcNodeBatch
+ *
+ *		Execute the given node to fill the batch with the next tuples it
+ *		returns.  Returns the number of tuples in the batch; zero means
+ *		that no more tuples are available.
+ *
+ *		The batch must have been created with the node's result type.
+ * ----------------------------------------------------------------
+ */
+int
+ExecProcNodeBatch(PlanState *node, TupleBatch *batch)
+{
+	if (node->chgParam != NULL) /* something changed? */
+		ExecReScan(node);		/* let ReScan handle this */
+
+	TupleBatchReset(batch);
+
+	if (node->ExecProcNodeBatch == NULL)
+	{
+		/* Node doesn't support batches, so assemble one tuple at a time */
+		while (!TupleBatchIsFull(batch))
+		{
+			TupleTableSlot *slot = ExecProcNode(node);
+
+			if (TupIsNull(slot))
+				break;
+			TupleBatchAddSlot(batch, slot);
+		}
+		return batch->nrows;
+	}
+
+	/*
+	 * Unlike ExecProcNode(), we don't bother to install wrappers here; the
+	 * per-call overhead of these checks is amortized over the whole batch.
+	 */
+	check_stack_depth();
+
+	if (node->instrument)
+	{
+		InstrStartNode(node->instrument);
+		node->ExecProcNodeBatch(node, batch);
+		InstrStopNode(node->instrument, batch->nrows);
+	}
+	else
+		node->ExecProcNodeBatch(node, batch);
+
+	return batch->nrows;
+}
@@ -0,0 +1,662 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatchExpr.c
+ *	  Vectorized evaluation of simple quals over a TupleBatch.
+ *
+ * ExecInterpExpr() evaluates an expression for one row at a time, paying
+ * for the opcode dispatch and for a function call through fmgr for every
+ * operator of every row.  For the common case of a WHERE clause consisting
+ * of comparisons and arithmetic on int4, int8 and float8 columns and
+ * constants, we can do much better when the rows come in a TupleBatch:
+ * such a qual is compiled into a short program of batch opcodes, each of
+ * which processes one column for all the rows of the batch that are still
+ * selected, with the operator inlined.  The loops are written to be free of
+ * branches where possible, so that the compiler can vectorize them.
+ *
+ * Each opcode works on "registers", arrays holding one value and null flag
+ * per row of the batch.  The qual is evaluated against a selection vector,
+ * the ascending list of row numbers that have passed all conjuncts so far.
+ * A comparison opcode narrows the selection to the rows for which the
+ * comparison is true, so null results and false results alike remove the
+ * row.  Later conjuncts only evaluate the rows that are still selected, so
+ * exactly the same rows are evaluated as with per-row evaluation, and e.g.
+ * an overflow error in an arithmetic operator is raised only if per-row
+ * evaluation would raise it, too.
+ *
+ * Only a qual that can be compiled completely is vectorized; otherwise
+ * ExecInitBatchQual() returns NULL and the caller must evaluate the qual
+ * row by row with ExecQual().
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execBatchExpr.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/pg_type.h"
+#include "common/int.h"
+#include "executor/tuplebatch.h"
+#include "nodes/nodeFuncs.h"
+#include "utils/float.h"
+#include "utils/fmgroids.h"
+
+/*
+ * Batch opcodes.
+ */
+typedef enum BatchExprOp
+{
+	/* register := column of the batch */
+	BEEOP_SCAN_VAR,
+
+	/* register := constant */
+	BEEOP_CONST,
+
+	/* register := arithmetic on two registers */
+	BEEOP_INT4_PL,
+	BEEOP_INT4_MI,
+	BEEOP_INT4_MUL,
+	BEEOP_INT8_PL,
+	BEEOP_INT8_MI,
+	BEEOP_INT8_MUL,
+	BEEOP_FLOAT8_PL,
+	BEEOP_FLOAT8_MI,
+	BEEOP_FLOAT8_MUL,
+
+	/* narrow the selection by comparing two registers */
+	BEEOP_QUAL_INT4,
+	BEEOP_QUAL_INT8,
+	BEEOP_QUAL_FLOAT8
+} BatchExprOp;
+
+typedef enum BatchCmpType
+{
+	BATCH_CMP_EQ,
+	BATCH_CMP_NE,
+	BATCH_CMP_LT,
+	BATCH_CMP_LE,
+	BATCH_CMP_GT,
+	BATCH_CMP_GE
+} BatchCmpType;
+
+typedef struct BatchExprStep
+{
+	BatchExprOp opcode;
+	int			resreg;			/* result register, if any */
+	int			arg1;			/* argument registers, if any */
+	int			arg2;
+	BatchCmpType cmp;			/* for BEEOP_QUAL_* */
+	int			attno;			/* zero-based column, for BEEOP_SCAN_VAR */
+	Datum		constval;		/* for BEEOP_CONST */
+} BatchExprStep;
+
+typedef struct BatchExprReg
+{
+	Datum	   *values;			/* current values */
+	bool	   *isnull;			/* current null flags */
+	Datum	   *buf_values;		/* storage for computed registers */
+	bool	   *buf_isnull;
+} BatchExprReg;
+
+struct BatchQualState
+{
+	int			nsteps;
+	int			steps_alloc;
+	BatchExprStep *steps;
+
+	int			nregs;
+	BatchExprReg *regs;
+
+	int			maxrows;		/* size of the per-row arrays */
+	int		   *sel;			/* selection vector */
+};
+
+static bool batch_qual_compile_qual(BatchQualState *state, Expr *qual,
+									TupleDesc desc);
+static int	batch_qual_compile_expr(BatchQualState *state, Expr *expr,
+									TupleDesc desc, Oid *restype);
+static void batch_qual_push_step(BatchQualState *state, BatchExprStep *step);
+static void batch_qual_ensure_rows(BatchQualState *state, int maxrows);
+
+
+/*
+ * Is the type one we know how to evaluate vectorized?
+ */
+static bool
+batch_qual_type_ok(Oid typid)
+{
+	switch (typid)
+	{
+		case INT4OID:
+			return true;
+		case INT8OID:
+		case FLOAT8OID:
+			/* results of arithmetic must be representable as plain Datums */
+			return FLOAT8PASSBYVAL;
+		default:
+			return false;
+	}
+}
+
+/*
+ * ExecInitBatchQual
+ *		Compile an implicitly-ANDed qual list for vectorized evaluation over
+ *		batches of tuples of the given descriptor.
+ *
+ * The qual may only contain Vars of the scan tuple.  Returns NULL if the
+ * qual cannot be vectorized.
+ */
+BatchQualState *
+ExecInitBatchQual(List *qual, TupleDesc desc)
+{
+	BatchQualState *state;
+	ListCell   *lc;
+
+	if (qual == NIL)
+		return NULL;
+
+	state = (BatchQualState *) palloc0(sizeof(BatchQualState));
+	state->steps_alloc = 16;
+	state->steps = (BatchExprStep *) palloc(state->steps_alloc *
+											sizeof(BatchExprStep));
+
+	foreach(lc, qual)
+	{
+		if (!batch_qual_compile_qual(state, (Expr *) lfirst(lc), desc))
+		{
+			pfree(state->steps);
+			pfree(state);
+			return NULL;
+		}
+	}
+
+	state->regs = (BatchExprReg *) palloc0(Max(state->nregs, 1) *
+										   sizeof(BatchExprReg));
+
+	return state;
+}
+
+/*
+ * Compile one conjunct of the qual, which must end with a step narrowing
+ * the selection.
+ */
+static bool
+batch_qual_compile_qual(BatchQualState *state, Expr *qual, TupleDesc desc)
+{
+	BatchExprStep step = {0};
+	OpExpr	   *op;
+	Oid			type1;
+	Oid			type2;
+
+	/* Nested ANDs just add more conjuncts */
+	if (is_andclause(qual))
+	{
+		ListCell   *lc;
+
+		foreach(lc, ((BoolExpr *) qual)->args)
+		{
+			if (!batch_qual_compile_qual(state, (Expr *) lfirst(lc), desc))
+				return false;
+		}
+		return true;
+	}
+
+	if (!IsA(qual, OpExpr) || list_length(((OpExpr *) qual)->args) != 2)
+		return false;
+	op = (OpExpr *) qual;
+	set_opfuncid(op);
+
+	switch (op->opfuncid)
+	{
+		case F_INT4EQ:
+		case F_INT8EQ:
+		case F_FLOAT8EQ:
+			step.cmp = BATCH_CMP_EQ;
+			break;
+		case F_INT4NE:
+		case F_INT8NE:
+		case F_FLOAT8NE:
+			step.cmp = BATCH_CMP_NE;
+			break;
+		case F_INT4LT:
+		case F_INT8LT:
+		case F_FLOAT8LT:
+			step.cmp = BATCH_CMP_LT;
+			break;
+		case F_INT4LE:
+		case F_INT8LE:
+		case F_FLOAT8LE:
+			step.cmp = BATCH_CMP_LE;
+			break;
+		case F_INT4GT:
+		case F_INT8GT:
+		case F_FLOAT8GT:
+			step.cmp = BATCH_CMP_GT;
+			break;
+		case F_INT4GE:
+		case F_INT8GE:
+		case F_FLOAT8GE:
+			step.cmp = BATCH_CMP_GE;
+			break;
+		default:
+			return false;
+	}
+
+	step.arg1 = batch_qual_compile_expr(state, linitial(op->args), desc,
+										&type1);
+	if (step.arg1 < 0)
+		return false;
+	step.arg2 = batch_qual_compile_expr(state, lsecond(op->args), desc,
+										&type2);
+	if (step.arg2 < 0 || type1 != type2)
+		return false;
+
+	switch (type1)
+	{
+		case INT4OID:
+			step.opcode = BEEOP_QUAL_INT4;
+			break;
+		case INT8OID:
+			step.opcode = BEEOP_QUAL_INT8;
+			break;
+		case FLOAT8OID:
+			step.opcode = BEEOP_QUAL_FLOAT8;
+			break;
+		default:
+			return false;
+	}
+	step.resreg = -1;
+	batch_qual_push_step(state, &step);
+
+	return true;
+}
+
+/*
+ * Compile an expression computing a value, returning its result register,
+ * or -1 if it can't be vectorized.  The result type is stored in *restype.
+ */
+static int
+batch_qual_compile_expr(BatchQualState *state, Expr *expr, TupleDesc desc,
+						Oid *restype)
+{
+	BatchExprStep step = {0};
+
+	if (IsA(expr, Var))
+	{
+		Var		   *var = (Var *) expr;
+		Form_pg_attribute att;
+
+		/* Only user columns of the scan tuple */
+		if (IS_SPECIAL_VARNO(var->varno) || var->varlevelsup != 0 ||
+			var->varattno <= 0 || var->varattno > desc->natts)
+			return -1;
+		att = TupleDescAttr(desc, var->varattno - 1);
+		if (att->attisdropped || att->atttypid != var->vartype ||
+			!batch_qual_type_ok(var->vartype))
+			return -1;
+
+		step.opcode = BEEOP_SCAN_VAR;
+		step.attno = var->varattno - 1;
+		*restype = var->vartype;
+	}
+	else if (IsA(expr, Const))
+	{
+		Const	   *con = (Const *) expr;
+
+		if (con->constisnull || !batch_qual_type_ok(con->consttype))
+			return -1;
+
+		step.opcode = BEEOP_CONST;
+		step.constval = con->constvalue;
+		*restype = con->consttype;
+	}
+	else if (IsA(expr, OpExpr) && list_length(((OpExpr *) expr)->args) == 2)
+	{
+		OpExpr	   *op = (OpExpr *) expr;
+		Oid			type1;
+		Oid			type2;
+
+		set_opfuncid(op);
+		switch (op->opfuncid)
+		{
+			case F_INT4PL:
+				step.opcode = BEEOP_INT4_PL;
+				break;
+			case F_INT4MI:
+				step.opcode = BEEOP_INT4_MI;
+				break;
+			case F_INT4MUL:
+				step.opcode = BEEOP_INT4_MUL;
+				break;
+			case F_INT8PL:
+				step.opcode = BEEOP_INT8_PL;
+				break;
+			case F_INT8MI:
+				step.opcode = BEEOP_INT8_MI;
+				break;
+			case F_INT8MUL:
+				step.opcode = BEEOP_INT8_MUL;
+				break;
+			case F_FLOAT8PL:
+				step.opcode = BEEOP_FLOAT8_PL;
+				break;
+			case F_FLOAT8MI:
+				step.opcode = BEEOP_FLOAT8_MI;
+				break;
+			case F_FLOAT8MUL:
+				step.opcode = BEEOP_FLOAT8_MUL;
+				break;
+			default:
+				return -1;
+		}
+
+		step.arg1 = batch_qual_compile_expr(state, linitial(op->args), desc,
+											&type1);
+		if (step.arg1 < 0)
+			return -1;
+		step.arg2 = batch_qual_compile_expr(state, lsecond(op->args), desc,
+											&type2);
+		if (step.arg2 < 0 || type1 != type2 || type1 != op->opresulttype)
+			return -1;
+		*restype = op->opresulttype;
+	}
+	else
+		return -1;
+
+	step.resreg = state->nregs++;
+	batch_qual_push_step(state, &step);
+
+	return step.resreg;
+}
+
+static void
+batch_qual_push_step(BatchQualState *state, BatchExprStep *step)
+{
+	if (state->nsteps >= state->steps_alloc)
+	{
+		state->steps_alloc *= 2;
+		state->steps = (BatchExprStep *)
+			repalloc(state->steps, state->steps_alloc * sizeof(BatchExprStep));
+	}
+	state->steps[state->nsteps++] = *step;
+}
+
+/*
+ * Make sure the per-row arrays can hold maxrows rows.
+ */
+static void
+batch_qual_ensure_rows(BatchQualState *state, int maxrows)
+{
+	if (maxrows <= state->maxrows)
+		return;
+
+	if (state->sel)
+		pfree(state->sel);
+	state->sel = (int *) palloc(maxrows * sizeof(int));
+
+	for (int i = 0; i < state->nsteps; i++)
+	{
+		BatchExprStep *step = &state->steps[i];
+		BatchExprReg *reg;
+
+		if (step->opcode == BEEOP_SCAN_VAR || step->resreg < 0)
+			continue;
+
+		reg = &state->regs[step->resreg];
+		if (reg->buf_values)
+		{
+			pfree(reg->buf_values);
+			pfree(reg->buf_isnull);
+		}
+		reg->buf_values = (Datum *) palloc(maxrows * sizeof(Datum));
+		reg->buf_isnull = (bool *) palloc(maxrows * sizeof(bool));
+		reg->values = reg->buf_values;
+		reg->isnull = reg->buf_isnull;
+
+		/* constants are broadcast to all rows once and for all */
+		if (step->opcode == BEEOP_CONST)
+		{
+			for (int row = 0; row < maxrows; row++)
+			{
+				reg->buf_values[row] = step->constval;
+				reg->buf_isnull[row] = false;
+			}
+		}
+	}
+
+	state->maxrows = maxrows;
+}
+
+/*
+ * Arithmetic on the selected rows.  The result is null if either input is,
+ * and is only computed for non-null inputs, so that e.g. overflow can only
+ * be reported where per-row evaluation would report it.
+ */
+#define BATCH_ARITH(GET, MAKE, OPFN) \
+	for (int k = 0; k < nsel; k++) \
+	{ \
+		int			i = sel[k]; \
+		bool		n = a1->isnull[i] | a2->isnull[i]; \
+		\
+		res->isnull[i] = n; \
+		if (!n) \
+			res->values[i] = MAKE(OPFN(GET(a1->values[i]), \
+									   GET(a2->values[i]))); \
+	}
+
+/*
+ * Narrow the selection to the rows for which the comparison is true.
+ */
+#define BATCH_QUAL_LOOP(GET, CMPFN) \
+	for (int k = 0; k < nsel; k++) \
+	{ \
+		int			i = sel[k]; \
+		\
+		sel[nkeep] = i; \
+		nkeep += !(a1->isnull[i] | a2->isnull[i]) & \
+			CMPFN(GET(a1->values[i]), GET(a2->values[i])); \
+	}
+
+#define BATCH_QUAL(GET, EQFN, NEFN, LTFN, LEFN, GTFN, GEFN) \
+	switch (step->cmp) \
+	{ \
+		case BATCH_CMP_EQ: \
+			BATCH_QUAL_LOOP(GET, EQFN); \
+			break; \
+		case BATCH_CMP_NE: \
+			BATCH_QUAL_LOOP(GET, NEFN); \
+			break; \
+		case BATCH_CMP_LT: \
+			BATCH_QUAL_LOOP(GET, LTFN); \
+			break; \
+		case BATCH_CMP_LE: \
+			BATCH_QUAL_LOOP(GET, LEFN); \
+			break; \
+		case BATCH_CMP_GT: \
+			BATCH_QUAL_LOOP(GET, GTFN); \
+			break; \
+		case BATCH_CMP_GE: \
+			BATCH_QUAL_LOOP(GET, GEFN); \
+			break; \
+	}
+
+#define INT_EQ(a, b) ((a) == (b))
+#define INT_NE(a, b) ((a) != (b))
+#define INT_LT(a, b) ((a) < (b))
+#define INT_LE(a, b) ((a) <= (b))
+#define INT_GT(a, b) ((a) > (b))
+#define INT_GE(a, b) ((a) >= (b))
+
+static inline int32
+batch_int4_pl(int32 a, int32 b)
+{
+	int32		result;
+
+	if (unlikely(pg_add_s32_overflow(a, b, &result)))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("integer out of range")));
+	return result;
+}
+
+static inline int32
+batch_int4_mi(int32 a, int32 b)
+{
+	int32		result;
+
+	if (unlikely(pg_sub_s32_overflow(a, b, &result)))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("integer out of range")));
+	return result;
+}
+
+static inline int32
+batch_int4_mul(int32 a, int32 b)
+{
+	int32		result;
+
+	if (unlikely(pg_mul_s32_overflow(a, b, &result)))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("integer out of range")));
+	return result;
+}
+
+static inline int64
+batch_int8_pl(int64 a, int64 b)
+{
+	int64		result;
+
+	if (unlikely(pg_add_s64_overflow(a, b, &result)))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("bigint out of range")));
+	return result;
+}
+
+static inline int64
+batch_int8_mi(int64 a, int64 b)
+{
+	int64		result;
+
+	if (unlikely(pg_sub_s64_overflow(a, b, &result)))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("bigint out of range")));
+	return result;
+}
+
+static inline int64
+batch_int8_mul(int64 a, int64 b)
+{
+	int64		result;
+
+	if (unlikely(pg_mul_s64_overflow(a, b, &result)))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("bigint out of range")));
+	return result;
+}
+
+/*
+ * ExecBatchQual
+ *		Evaluate the qual for rows start .. nrows - 1 of the batch.
+ *
+ * Returns the number of rows that pass the qual, and sets *selp to the
+ * ascending array of their row numbers.  The array is owned by the
+ * BatchQualState and is overwritten by the next call.
+ */
+int
+ExecBatchQual(BatchQualState *state, TupleBatch *batch, int start,
+			  int **selp)
+{
+	int		   *sel;
+	int			nsel = 0;
+
+	batch_qual_ensure_rows(state, batch->maxrows);
+	sel = state->sel;
+
+	for (int row = start; row < batch->nrows; row++)
+		sel[nsel++] = row;
+
+	for (int stepno = 0; stepno < state->nsteps && nsel > 0; stepno++)
+	{
+		BatchExprStep *step = &state->steps[stepno];
+		BatchExprReg *res = step->resreg >= 0 ? &state->regs[step->resreg] : NULL;
+		BatchExprReg *a1 = NULL;
+		BatchExprReg *a2 = NULL;
+		int			nkeep = 0;
+
+		if (step->opcode != BEEOP_SCAN_VAR && step->opcode != BEEOP_CONST)
+		{
+			a1 = &state->regs[step->arg1];
+			a2 = &state->regs[step->arg2];
+		}
+
+		switch (step->opcode)
+		{
+			case BEEOP_SCAN_VAR:
+				res->values = batch->values[step->attno];
+				res->isnull = batch->isnull[step->attno];
+				break;
+
+			case BEEOP_CONST:
+				/* already filled in by batch_qual_ensure_rows() */
+				break;
+
+			case BEEOP_INT4_PL:
+				BATCH_ARITH(DatumGetInt32, Int32GetDatum, batch_int4_pl);
+				break;
+			case BEEOP_INT4_MI:
+				BATCH_ARITH(DatumGetInt32, Int32GetDatum, batch_int4_mi);
+				break;
+			case BEEOP_INT4_MUL:
+				BATCH_ARITH(DatumGetInt32, Int32GetDatum, batch_int4_mul);
+				break;
+			case BEEOP_INT8_PL:
+				BATCH_ARITH(DatumGetInt64, Int64GetDatum, batch_int8_pl);
+				break;
+			case BEEOP_INT8_MI:
+				BATCH_ARITH(DatumGetInt64, Int64GetDatum, batch_int8_mi);
+				break;
+			case BEEOP_INT8_MUL:
+				BATCH_ARITH(DatumGetInt64, Int64GetDatum, batch_int8_mul);
+				break;
+			case BEEOP_FLOAT8_PL:
+				BATCH_ARITH(DatumGetFloat8, Float8GetDatum, float8_pl);
+				break;
+			case BEEOP_FLOAT8_MI:
+				BATCH_ARITH(DatumGetFloat8, Float8GetDatum, float8_mi);
+				break;
+			case BEEOP_FLOAT8_MUL:
+				BATCH_ARITH(DatumGetFloat8, Float8GetDatum, float8_mul);
+				break;
+
+			case BEEOP_QUAL_INT4:
+				BATCH_QUAL(DatumGetInt32,
+						   INT_EQ, INT_NE, INT_LT, INT_LE, INT_GT, INT_GE);
+				nsel = nkeep;
+				break;
+			case BEEOP_QUAL_INT8:
+				BATCH_QUAL(DatumGetInt64,
+						   INT_EQ, INT_NE, INT_LT, INT_LE, INT_GT, INT_GE);
+				nsel = nkeep;
+				break;
+			case BEEOP_QUAL_FLOAT8:
+				/* float8_eq() etc. implement the NaN-aware semantics */
+				BATCH_QUAL(DatumGetFloat8,
+						   float8_eq, float8_ne, float8_lt, float8_le,
+						   float8_gt, float8_ge);
+				nsel = nkeep;
+				break;
+		}
+	}
+
+	*selp = sel;
+	return nsel;
+}
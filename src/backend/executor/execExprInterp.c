@@ -208,6 +208,9 @@ typedef struct ScalarArrayOpExprHashTable
 {
 	saophash_hash *hashtab;		/* underlying hash table */
 	struct ExprEvalStep *op;
+	/* for a non-Const array, its current value and the memory holding it */
+	ArrayType  *array;
+	MemoryContext tabcxt;
 	FmgrInfo	hash_finfo;		/* function's lookup data */
 	FunctionCallInfoBaseData hash_fcinfo_data;	/* arguments etc */
 } ScalarArrayOpExprHashTable;
@@ -3454,8 +3457,15 @@ ExecEvalHashedScalarArrayOp(ExprState *state, ExprEvalStep *op, ExprContext *eco
 	bool		resultnull;
 	bool		hashfound;
 
-	/* We don't setup a hashed scalar array op if the array const is null. */
-	Assert(!*op->resnull);
+	/*
+	 * We don't setup a hashed scalar array op if the array const is null, but
+	 * a Param may still yield a NULL array, in which case the result is NULL.
+	 */
+	if (*op->resnull)
+	{
+		Assert(!op->d.hashedscalararrayop.array_const);
+		return;
+	}
 
 	/*
 	 * If the scalar is NULL, and the function is strict, return NULL; no
@@ -3467,31 +3477,14 @@ ExecEvalHashedScalarArrayOp(ExprState *state, ExprEvalStep *op, ExprContext *eco
 		return;
 	}
 
-	/* Build the hash table on first evaluation */
+	/* Set up the hash table state on first evaluation */
 	if (elements_tab == NULL)
 	{
 		ScalarArrayOpExpr *saop;
-		int16		typlen;
-		bool		typbyval;
-		char		typalign;
-		int			nitems;
-		bool		has_nulls = false;
-		char	   *s;
-		bits8	   *bitmap;
-		int			bitmask;
 		MemoryContext oldcontext;
-		ArrayType  *arr;
 
 		saop = op->d.hashedscalararrayop.saop;
 
-		arr = DatumGetArrayTypeP(*op->resvalue);
-		nitems = ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr));
-
-		get_typlenbyvalalign(ARR_ELEMTYPE(arr),
-							 &typlen,
-							 &typbyval,
-							 &typalign);
-
 		oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_query_memory);
 
 		elements_tab = (ScalarArrayOpExprHashTable *)
@@ -3510,6 +3503,68 @@ ExecEvalHashedScalarArrayOp(ExprState *state, ExprEvalStep *op, ExprContext *eco
 								 NULL,
 								 NULL);
 
+		/*
+		 * The array of a Const lives as long as the plan, so its table can
+		 * go in the per-query context.  Otherwise, keep the table and a copy
+		 * of the array it was built from in a context of its own, so they
+		 * can be thrown away when the array changes.
+		 */
+		if (op->d.hashedscalararrayop.array_const)
+			elements_tab->tabcxt = econtext->ecxt_per_query_memory;
+		else
+			elements_tab->tabcxt = AllocSetContextCreate(econtext->ecxt_per_query_memory,
+														 "hashed ScalarArrayOpExpr",
+														 ALLOCSET_DEFAULT_SIZES);
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+	else if (!op->d.hashedscalararrayop.array_const)
+	{
+		ArrayType  *arr = DatumGetArrayTypeP(*op->resvalue);
+
+		/* Rebuild the hash table if the array is not the one we hashed */
+		if (VARSIZE(arr) != VARSIZE(elements_tab->array) ||
+			memcmp(arr, elements_tab->array, VARSIZE(arr)) != 0)
+		{
+			MemoryContextReset(elements_tab->tabcxt);
+			elements_tab->hashtab = NULL;
+		}
+	}
+
+	/* Build the hash table, if we don't have one for this array */
+	if (elements_tab->hashtab == NULL)
+	{
+		int16		typlen;
+		bool		typbyval;
+		char		typalign;
+		int			nitems;
+		bool		has_nulls = false;
+		char	   *s;
+		bits8	   *bitmap;
+		int			bitmask;
+		MemoryContext oldcontext;
+		ArrayType  *arr;
+
+		oldcontext = MemoryContextSwitchTo(elements_tab->tabcxt);
+
+		/*
+		 * The hash table points into the array, so a non-Const array must be
+		 * copied to keep it around for as long as the table.
+		 */
+		if (op->d.hashedscalararrayop.array_const)
+			arr = DatumGetArrayTypeP(*op->resvalue);
+		else
+		{
+			arr = DatumGetArrayTypePCopy(*op->resvalue);
+			elements_tab->array = arr;
+		}
+		nitems = ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr));
+
+		get_typlenbyvalalign(ARR_ELEMTYPE(arr),
+							 &typlen,
+							 &typbyval,
+							 &typalign);
+
 		/*
 		 * Create the hash table sizing it according to the number of elements
 		 * in the array.  This does assume that the array has no duplicates.
@@ -18,10 +18,12 @@
 #include "common/hashfn.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 
-static int	TupleHashTableMatch(struct tuplehash_hash *tb, const MinimalTuple tuple1, const MinimalTuple tuple2);
+static int	TupleHashTableMatch(struct tuplehash_hash *tb, TupleHashEntry entry, const MinimalTuple tuple2);
+static bool equality_is_image_equality(Oid eqfuncoid);
 static inline uint32 TupleHashTableHash_internal(struct tuplehash_hash *tb,
 												 const MinimalTuple tuple);
 static inline TupleHashEntry LookupTupleHashEntry_internal(TupleHashTable hashtable,
@@ -38,13 +40,21 @@ static inline TupleHashEntry LookupTupleHashEntry_internal(TupleHashTable hashta
 #define SH_KEY_TYPE MinimalTuple
 #define SH_KEY firstTuple
 #define SH_HASH_KEY(tb, key) TupleHashTableHash_internal(tb, key)
-#define SH_EQUAL(tb, a, b) TupleHashTableMatch(tb, a, b) == 0
+/*
+ * simplehash.h only ever compares the key of a table entry, which it passes as
+ * "entry->firstTuple", with the key being looked up; taking the address of the
+ * former gives us the entry, so that we can use the key kept inline in it.
+ */
+#define SH_EQUAL(tb, a, b) TupleHashTableMatch(tb, (TupleHashEntry) &(a), b) == 0
 #define SH_SCOPE extern
 #define SH_STORE_HASH
 #define SH_GET_HASH(tb, a) a->hash
 #define SH_DEFINE
 #include "lib/simplehash.h"
 
+StaticAssertDecl(offsetof(TupleHashEntryData, firstTuple) == 0,
+				 "firstTuple must be the first field of TupleHashEntryData");
+
 
 /*****************************************************************************
  *		Utility routines for grouping tuples together
@@ -205,6 +215,21 @@ BuildTupleHashTableExt(PlanState *parent,
 	else
 		hashtable->hash_iv = 0;
 
+	/*
+	 * With a single by-value key whose equality is just the equality of its
+	 * Datums, keep the key inline in the entries, so that probing the table
+	 * doesn't have to look at the first tuple of each group it passes, nor
+	 * run the comparator.  Nulls are told apart by their hash value: as
+	 * murmurhash32 is a bijection, only a key whose hash function returns 0
+	 * hashes the same as a null key, and those are compared in full.
+	 */
+	hashtable->inline_key = numCols == 1 &&
+		TupleDescAttr(inputDesc, keyColIdx[0] - 1)->attbyval &&
+		equality_is_image_equality(eqfuncoids[0]);
+	hashtable->null_key_hash =
+		murmurhash32(pg_rotate_left32(hashtable->hash_iv, 1));
+	hashtable->cur_inline_key = false;
+
 	hashtable->hashtab = tuplehash_create(metacxt, nbuckets, hashtable);
 
 	/*
@@ -317,6 +342,7 @@ LookupTupleHashEntry(TupleHashTable hashtable, TupleTableSlot *slot,
 	hashtable->inputslot = slot;
 	hashtable->in_hash_funcs = hashtable->tab_hash_funcs;
 	hashtable->cur_eq_func = hashtable->tab_eq_func;
+	hashtable->cur_inline_key = hashtable->inline_key;
 
 	local_hash = TupleHashTableHash_internal(hashtable->hashtab, NULL);
 	entry = LookupTupleHashEntry_internal(hashtable, slot, isnew, local_hash);
@@ -371,6 +397,7 @@ LookupTupleHashEntryHash(TupleHashTable hashtable, TupleTableSlot *slot,
 	hashtable->inputslot = slot;
 	hashtable->in_hash_funcs = hashtable->tab_hash_funcs;
 	hashtable->cur_eq_func = hashtable->tab_eq_func;
+	hashtable->cur_inline_key = hashtable->inline_key;
 
 	entry = LookupTupleHashEntry_internal(hashtable, slot, isnew, hash);
 	Assert(entry == NULL || entry->hash == hash);
@@ -405,6 +432,16 @@ FindTupleHashEntry(TupleHashTable hashtable, TupleTableSlot *slot,
 	hashtable->inputslot = slot;
 	hashtable->in_hash_funcs = hashfunctions;
 	hashtable->cur_eq_func = eqcomp;
+	/* inline keys can only be compared with keys of the same type */
+	hashtable->cur_inline_key = hashtable->inline_key &&
+		eqcomp == hashtable->tab_eq_func;
+	if (hashtable->cur_inline_key)
+	{
+		bool		isnull;
+
+		hashtable->in_key = slot_getattr(slot, hashtable->keyColIdx[0],
+										 &isnull);
+	}
 
 	/* Search the hash table */
 	key = NULL;					/* flag to reference inputslot */
@@ -502,6 +539,14 @@ LookupTupleHashEntry_internal(TupleHashTable hashtable, TupleTableSlot *slot,
 
 	key = NULL;					/* flag to reference inputslot */
 
+	if (hashtable->cur_inline_key)
+	{
+		bool		isnull;
+
+		hashtable->in_key = slot_getattr(slot, hashtable->keyColIdx[0],
+										 &isnull);
+	}
+
 	if (isnew)
 	{
 		entry = tuplehash_insert_hash(hashtable->hashtab, key, hash, &found);
@@ -517,6 +562,9 @@ LookupTupleHashEntry_internal(TupleHashTable hashtable, TupleTableSlot *slot,
 			*isnew = true;
 			/* zero caller data */
 			entry->additional = NULL;
+			/* meaningless for a null key, see TupleHashTableMatch */
+			if (hashtable->inline_key)
+				entry->key = hashtable->in_key;
 			MemoryContextSwitchTo(hashtable->tablecxt);
 			/* Copy the first tuple into the table context */
 			entry->firstTuple = ExecCopySlotMinimalTuple(slot);
@@ -531,25 +579,56 @@ LookupTupleHashEntry_internal(TupleHashTable hashtable, TupleTableSlot *slot,
 }
 
 /*
- * See whether two tuples (presumably of the same hash value) match
+ * Does the equality function of a by-value type just compare the Datums?
+ */
+static bool
+equality_is_image_equality(Oid eqfuncoid)
+{
+	switch (eqfuncoid)
+	{
+		case F_BOOLEQ:
+		case F_CHAREQ:
+		case F_INT2EQ:
+		case F_INT4EQ:
+		case F_INT8EQ:
+		case F_OIDEQ:
+		case F_DATE_EQ:
+		case F_TIME_EQ:
+		case F_TIMESTAMP_EQ:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * See whether a table entry matches the input tuple; simplehash.h has
+ * already checked that their hash values are the same
  */
 static int
-TupleHashTableMatch(struct tuplehash_hash *tb, const MinimalTuple tuple1, const MinimalTuple tuple2)
+TupleHashTableMatch(struct tuplehash_hash *tb, TupleHashEntry entry, const MinimalTuple tuple2)
 {
 	TupleTableSlot *slot1;
 	TupleTableSlot *slot2;
 	TupleHashTable hashtable = (TupleHashTable) tb->private_data;
 	ExprContext *econtext = hashtable->exprcontext;
 
+	/*
+	 * Unless they have the hash value of a null key, neither key is null, and
+	 * comparing the inline keys is enough.
+	 */
+	if (hashtable->cur_inline_key && entry->hash != hashtable->null_key_hash)
+		return entry->key != hashtable->in_key;
+
 	/*
 	 * We assume that simplehash.h will only ever call us with the first
 	 * argument being an actual table entry, and the second argument being
 	 * LookupTupleHashEntry's dummy TupleHashEntryData.  The other direction
 	 * could be supported too, but is not currently required.
 	 */
-	Assert(tuple1 != NULL);
+	Assert(entry->firstTuple != NULL);
 	slot1 = hashtable->tableslot;
-	ExecStoreMinimalTuple(tuple1, slot1, false);
+	ExecStoreMinimalTuple(entry->firstTuple, slot1, false);
 	Assert(tuple2 == NULL);
 	slot2 = hashtable->inputslot;
 
@@ -106,6 +106,7 @@
  */
 #include "postgres.h"
 
+#include "access/amapi.h"
 #include "access/genam.h"
 #include "access/relscan.h"
 #include "access/tableam.h"
@@ -124,6 +125,15 @@ typedef enum
 	CEOUC_LIVELOCK_PREVENTING_WAIT
 } CEOUC_WAIT_MODE;
 
+static List *insert_index_tuples(ResultRelInfo *resultRelInfo,
+								 TupleTableSlot *slot,
+								 EState *estate,
+								 bool update,
+								 bool noDupErr,
+								 bool *specConflict,
+								 List *arbiterIndexes,
+								 bool onlySummarizing,
+								 bool *skipIndexes);
 static bool check_exclusion_or_unique_constraint(Relation heap, Relation index,
 												 IndexInfo *indexInfo,
 												 ItemPointer tupleid,
@@ -262,7 +272,7 @@ ExecCloseIndices(ResultRelInfo *resultRelInfo)
  *		When 'update' is true, executor is performing an UPDATE
  *		that could not use an optimization like heapam's HOT (in
  *		more general terms a call to table_tuple_update() took
- *		place and set 'update_indexes' to true).  Receiving this
+ *		place and set 'update_indexes' to TU_All).  Receiving this
  *		hint makes us consider if we should pass down the
  *		'indexUnchanged' hint in turn.  That's something that we
  *		figure out for each index_insert() call iff 'update' is
@@ -278,6 +288,10 @@ ExecCloseIndices(ResultRelInfo *resultRelInfo)
  *
  *		If 'arbiterIndexes' is nonempty, noDupErr applies only to
  *		those indexes.  NIL means noDupErr applies to all indexes.
+ *
+ *		If 'onlySummarizing' is true, the UPDATE was HOT but changed
+ *		columns covered by summarizing indexes (such as BRIN), so only
+ *		those indexes receive the new tuple.
  * ----------------------------------------------------------------
  */
 List *
@@ -287,7 +301,150 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 					  bool update,
 					  bool noDupErr,
 					  bool *specConflict,
-					  List *arbiterIndexes)
+					  List *arbiterIndexes,
+					  bool onlySummarizing)
+{
+	return insert_index_tuples(resultRelInfo, slot, estate, update, noDupErr,
+							   specConflict, arbiterIndexes, onlySummarizing,
+							   NULL);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInsertIndexTuplesBatch
+ *
+ *		Inserts index tuples for a batch of newly inserted heap tuples,
+ *		such as those of a multi-insert in COPY FROM, into the indexes
+ *		that can take them all at once: those whose AM provides
+ *		aminsertbatch, and that have no unique or exclusion constraint
+ *		to check.  Returns an array, with an entry for each index of the
+ *		result relation, telling which indexes were done.  The caller
+ *		then passes each tuple to ExecInsertUnbatchedIndexTuples.
+ * ----------------------------------------------------------------
+ */
+bool *
+ExecInsertIndexTuplesBatch(ResultRelInfo *resultRelInfo,
+						   TupleTableSlot **slots,
+						   int nslots,
+						   EState *estate)
+{
+	int			numIndices = resultRelInfo->ri_NumIndices;
+	RelationPtr relationDescs = resultRelInfo->ri_IndexRelationDescs;
+	IndexInfo **indexInfoArray = resultRelInfo->ri_IndexRelationInfo;
+	Relation	heapRelation = resultRelInfo->ri_RelationDesc;
+	ExprContext *econtext;
+	bool	   *batchedIndexes;
+	ItemPointer tids;
+
+	batchedIndexes = palloc0(sizeof(bool) * numIndices);
+	tids = palloc(sizeof(ItemPointerData) * nslots);
+
+	econtext = GetPerTupleExprContext(estate);
+
+	for (int i = 0; i < numIndices; i++)
+	{
+		Relation	indexRelation = relationDescs[i];
+		IndexInfo  *indexInfo;
+		int			natts;
+		Datum	   *values;
+		bool	   *isnull;
+		int			ntuples = 0;
+
+		if (indexRelation == NULL)
+			continue;
+
+		indexInfo = indexInfoArray[i];
+
+		if (!indexInfo->ii_ReadyForInserts ||
+			indexRelation->rd_indam->aminsertbatch == NULL ||
+			indexRelation->rd_index->indisunique ||
+			indexInfo->ii_ExclusionOps != NULL)
+			continue;
+
+		natts = indexInfo->ii_NumIndexAttrs;
+		values = palloc(sizeof(Datum) * natts * nslots);
+		isnull = palloc(sizeof(bool) * natts * nslots);
+
+		for (int j = 0; j < nslots; j++)
+		{
+			TupleTableSlot *slot = slots[j];
+
+			Assert(ItemPointerIsValid(&slot->tts_tid));
+
+			econtext->ecxt_scantuple = slot;
+
+			/* Check for partial index */
+			if (indexInfo->ii_Predicate != NIL)
+			{
+				ExprState  *predicate;
+
+				predicate = indexInfo->ii_PredicateState;
+				if (predicate == NULL)
+				{
+					predicate = ExecPrepareQual(indexInfo->ii_Predicate, estate);
+					indexInfo->ii_PredicateState = predicate;
+				}
+
+				if (!ExecQual(predicate, econtext))
+					continue;
+			}
+
+			FormIndexDatum(indexInfo,
+						   slot,
+						   estate,
+						   values + ntuples * natts,
+						   isnull + ntuples * natts);
+			tids[ntuples++] = slot->tts_tid;
+		}
+
+		if (ntuples > 0)
+			index_insert_batch(indexRelation, values, isnull, tids, ntuples,
+							   heapRelation, indexInfo);
+
+		pfree(values);
+		pfree(isnull);
+		batchedIndexes[i] = true;
+	}
+
+	pfree(tids);
+
+	return batchedIndexes;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInsertUnbatchedIndexTuples
+ *
+ *		Like ExecInsertIndexTuples for a plain insertion, but skips the
+ *		indexes that ExecInsertIndexTuplesBatch has already taken care of,
+ *		as given by its result.
+ * ----------------------------------------------------------------
+ */
+List *
+ExecInsertUnbatchedIndexTuples(ResultRelInfo *resultRelInfo,
+							   TupleTableSlot *slot,
+							   EState *estate,
+							   bool *batchedIndexes)
+{
+	return insert_index_tuples(resultRelInfo, slot, estate, false, false,
+							   NULL, NIL, false, batchedIndexes);
+}
+
+/*
+ * insert_index_tuples
+ *
+ * Workhorse for ExecInsertIndexTuples and ExecInsertUnbatchedIndexTuples.
+ * Indexes whose entry in skipIndexes is true, if that is given, are left
+ * alone.
+ */
+static List *
+insert_index_tuples(ResultRelInfo *resultRelInfo,
+					TupleTableSlot *slot,
+					EState *estate,
+					bool update,
+					bool noDupErr,
+					bool *specConflict,
+					List *arbiterIndexes,
+					bool onlySummarizing,
+					bool *skipIndexes)
 {
 	ItemPointer tupleid = &slot->tts_tid;
 	List	   *result = NIL;
@@ -337,12 +494,23 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 		if (indexRelation == NULL)
 			continue;
 
+		/* Skip indexes that the caller has already inserted into */
+		if (skipIndexes != NULL && skipIndexes[i])
+			continue;
+
 		indexInfo = indexInfoArray[i];
 
 		/* If the index is marked as read-only, ignore it */
 		if (!indexInfo->ii_ReadyForInserts)
 			continue;
 
+		/*
+		 * Skip processing of non-summarizing indexes if we only update
+		 * summarizing indexes
+		 */
+		if (onlySummarizing && !indexRelation->rd_indam->amsummarizing)
+			continue;
+
 		/* Check for partial index */
 		if (indexInfo->ii_Predicate != NIL)
 		{
@@ -48,7 +48,10 @@
 #include "catalog/pg_publication.h"
 #include "commands/matview.h"
 #include "commands/trigger.h"
+#include "executor/execSampling.h"
 #include "executor/execdebug.h"
+#include "executor/nodeIndexonlyscan.h"
+#include "executor/nodeIndexscan.h"
 #include "executor/nodeSubplan.h"
 #include "foreign/fdwapi.h"
 #include "jit/jit.h"
@@ -253,6 +256,15 @@ standard_ExecutorStart(QueryDesc *queryDesc, int eflags)
 	estate->es_instrument = queryDesc->instrument_options;
 	estate->es_jit_flags = queryDesc->plannedstmt->jitFlags;
 
+	/*
+	 * Sample the execution of the plan nodes if requested.  Samples are
+	 * aggregated by query identifier, so don't bother without one.
+	 */
+	if (query_sample_interval > 0 &&
+		queryDesc->plannedstmt->queryId != UINT64CONST(0) &&
+		!(eflags & EXEC_FLAG_EXPLAIN_ONLY))
+		ExecSampleStart(estate);
+
 	/*
 	 * Set up an AFTER-trigger statement context, unless told not to, or
 	 * unless it's EXPLAIN-only mode (when ExecutorFinish won't be called).
@@ -488,6 +500,9 @@ standard_ExecutorEnd(QueryDesc *queryDesc)
 	Assert(estate->es_finished ||
 		   (estate->es_top_eflags & EXEC_FLAG_EXPLAIN_ONLY));
 
+	/* Stop sampling, if this query started it */
+	ExecSampleEnd(estate);
+
 	/*
 	 * Switch into per-query memory context to run ExecEndPlan
 	 */
@@ -517,6 +532,140 @@ standard_ExecutorEnd(QueryDesc *queryDesc)
 	queryDesc->totaltime = NULL;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecPlanIsReusable
+ *
+ *		Is the plan simple enough for its executor state to be kept and run
+ *		again with new parameters, via ExecutorSuspend and ExecutorResume?
+ *
+ *		We only support a lone index scan or index-only scan, which is what
+ *		a prepared lookup of a row by its key turns into.  For those, setting
+ *		up and shutting down the executor costs as much as the lookup itself.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecPlanIsReusable(PlannedStmt *plannedstmt)
+{
+	Plan	   *plan = plannedstmt->planTree;
+
+	/* plugins hooking executor startup or shutdown must see each run */
+	if (ExecutorStart_hook || ExecutorFinish_hook || ExecutorEnd_hook)
+		return false;
+
+	/* the sampling timer is armed from ExecutorStart to ExecutorEnd */
+	if (query_sample_interval > 0)
+		return false;
+
+	if (plannedstmt->commandType != CMD_SELECT ||
+		plannedstmt->hasModifyingCTE ||
+		plannedstmt->rowMarks != NIL ||
+		plannedstmt->subplans != NIL ||
+		plannedstmt->paramExecTypes != NIL ||
+		plannedstmt->parallelModeNeeded ||
+		plannedstmt->jitFlags != PGJIT_NONE)
+		return false;
+
+	if (plan->initPlan != NIL)
+		return false;
+
+	switch (nodeTag(plan))
+	{
+		case T_IndexScan:
+			return ((IndexScan *) plan)->indexorderby == NIL;
+		case T_IndexOnlyScan:
+			return ((IndexOnlyScan *) plan)->indexorderby == NIL;
+		default:
+			return false;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecutorSuspend
+ *
+ *		Release the buffer pins and snapshots held by a query that has been
+ *		run, so that it can be kept after the end of the portal that ran it.
+ *		The query must have passed ExecPlanIsReusable.  It can then be run
+ *		again after ExecutorResume, or shut down with ExecutorFinish and
+ *		ExecutorEnd as usual.
+ *
+ *		The pins and snapshots are released from CurrentResourceOwner, which
+ *		must be the one the query ran under.
+ * ----------------------------------------------------------------
+ */
+void
+ExecutorSuspend(QueryDesc *queryDesc)
+{
+	EState	   *estate = queryDesc->estate;
+	PlanState  *planstate = queryDesc->planstate;
+	ListCell   *lc;
+
+	switch (nodeTag(planstate))
+	{
+		case T_IndexScanState:
+			ExecIndexScanReleaseScan((IndexScanState *) planstate);
+			break;
+		case T_IndexOnlyScanState:
+			ExecIndexOnlyScanReleaseScan((IndexOnlyScanState *) planstate);
+			break;
+		default:
+			elog(ERROR, "unrecognized node type: %d",
+				 (int) nodeTag(planstate));
+			break;
+	}
+
+	/* slots can hold pins, too */
+	foreach(lc, estate->es_tupleTable)
+		ExecClearTuple((TupleTableSlot *) lfirst(lc));
+
+	UnregisterSnapshot(estate->es_snapshot);
+	estate->es_snapshot = InvalidSnapshot;
+	UnregisterSnapshot(queryDesc->snapshot);
+	queryDesc->snapshot = InvalidSnapshot;
+
+	/* the parameters belong to the portal */
+	queryDesc->params = NULL;
+	estate->es_param_list_info = NULL;
+	foreach(lc, estate->es_exprcontexts)
+		((ExprContext *) lfirst(lc))->ecxt_param_list_info = NULL;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecutorResume
+ *
+ *		Prepare a query suspended by ExecutorSuspend to be run again, with
+ *		the given parameters and snapshot.  The snapshot is registered with
+ *		CurrentResourceOwner.
+ * ----------------------------------------------------------------
+ */
+void
+ExecutorResume(QueryDesc *queryDesc, ParamListInfo params, Snapshot snapshot)
+{
+	EState	   *estate = queryDesc->estate;
+	ListCell   *lc;
+
+	Assert(estate->es_snapshot == InvalidSnapshot);
+
+	pgstat_report_query_id(queryDesc->plannedstmt->queryId, false);
+
+	/* the user may have changed since ExecutorStart checked */
+	ExecCheckPermissions(queryDesc->plannedstmt->rtable,
+						 queryDesc->plannedstmt->permInfos, true);
+
+	queryDesc->snapshot = RegisterSnapshot(snapshot);
+	estate->es_snapshot = RegisterSnapshot(snapshot);
+
+	/*
+	 * Expressions look up external parameters through their ExprContext at
+	 * run time, so installing the new ones there is enough.
+	 */
+	queryDesc->params = params;
+	estate->es_param_list_info = params;
+	foreach(lc, estate->es_exprcontexts)
+		((ExprContext *) lfirst(lc))->ecxt_param_list_info = params;
+
+	queryDesc->already_executed = false;
+}
+
 /* ----------------------------------------------------------------
  *		ExecutorRewind
  *
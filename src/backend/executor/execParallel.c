@@ -28,6 +28,7 @@
 #include "executor/nodeAgg.h"
 #include "executor/nodeAppend.h"
 #include "executor/nodeBitmapHeapscan.h"
+#include "executor/nodeCtescan.h"
 #include "executor/nodeCustom.h"
 #include "executor/nodeForeignscan.h"
 #include "executor/nodeHash.h"
@@ -264,6 +265,11 @@ ExecParallelEstimate(PlanState *planstate, ExecParallelEstimateContext *e)
 				ExecAppendEstimate((AppendState *) planstate,
 								   e->pcxt);
 			break;
+		case T_CteScanState:
+			if (planstate->plan->parallel_aware)
+				ExecCteScanEstimate((CteScanState *) planstate,
+									e->pcxt);
+			break;
 		case T_CustomScanState:
 			if (planstate->plan->parallel_aware)
 				ExecCustomScanEstimate((CustomScanState *) planstate,
@@ -488,6 +494,11 @@ ExecParallelInitializeDSM(PlanState *planstate,
 				ExecAppendInitializeDSM((AppendState *) planstate,
 										d->pcxt);
 			break;
+		case T_CteScanState:
+			if (planstate->plan->parallel_aware)
+				ExecCteScanInitializeDSM((CteScanState *) planstate,
+										 d->pcxt);
+			break;
 		case T_CustomScanState:
 			if (planstate->plan->parallel_aware)
 				ExecCustomScanInitializeDSM((CustomScanState *) planstate,
@@ -981,6 +992,10 @@ ExecParallelReInitializeDSM(PlanState *planstate,
 			if (planstate->plan->parallel_aware)
 				ExecAppendReInitializeDSM((AppendState *) planstate, pcxt);
 			break;
+		case T_CteScanState:
+			if (planstate->plan->parallel_aware)
+				ExecCteScanReInitializeDSM((CteScanState *) planstate, pcxt);
+			break;
 		case T_CustomScanState:
 			if (planstate->plan->parallel_aware)
 				ExecCustomScanReInitializeDSM((CustomScanState *) planstate,
@@ -996,10 +1011,16 @@ ExecParallelReInitializeDSM(PlanState *planstate,
 				ExecHashJoinReInitializeDSM((HashJoinState *) planstate,
 											pcxt);
 			break;
+		case T_AggState:
+			if (planstate->plan->parallel_aware)
+				ExecAggReInitializeDSM((AggState *) planstate, pcxt);
+			break;
+		case T_MemoizeState:
+			ExecMemoizeReInitializeDSM((MemoizeState *) planstate, pcxt);
+			break;
 		case T_HashState:
 		case T_SortState:
 		case T_IncrementalSortState:
-		case T_MemoizeState:
 			/* these nodes have DSM state, but no reinitialization is required */
 			break;
 
@@ -1332,6 +1353,10 @@ ExecParallelInitializeWorker(PlanState *planstate, ParallelWorkerContext *pwcxt)
 			if (planstate->plan->parallel_aware)
 				ExecAppendInitializeWorker((AppendState *) planstate, pwcxt);
 			break;
+		case T_CteScanState:
+			if (planstate->plan->parallel_aware)
+				ExecCteScanInitializeWorker((CteScanState *) planstate, pwcxt);
+			break;
 		case T_CustomScanState:
 			if (planstate->plan->parallel_aware)
 				ExecCustomScanInitializeWorker((CustomScanState *) planstate,
@@ -1527,6 +1527,35 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 
 						if (cmpval > 0)
 							return boundinfo->indexes[last_datum_offset + 1];
+
+						/*
+						 * The value is at or above the upper bound.  When
+						 * loading time-ordered data, the values move on from
+						 * one range to the next, so check whether the value
+						 * belongs to the next partition before doing a binary
+						 * search, and if so make that the cached partition
+						 * without starting to count again.
+						 */
+						if (last_datum_offset + 2 < boundinfo->ndatums &&
+							boundinfo->indexes[last_datum_offset + 2] >= 0)
+						{
+							lastDatums = boundinfo->datums[last_datum_offset + 2];
+							kind = boundinfo->kind[last_datum_offset + 2];
+							cmpval = partition_rbound_datum_cmp(key->partsupfunc,
+																key->partcollation,
+																lastDatums,
+																kind,
+																values,
+																key->partnatts);
+
+							if (cmpval > 0)
+							{
+								partdesc->last_found_datum_index = last_datum_offset + 1;
+								partdesc->last_found_part_index =
+									boundinfo->indexes[last_datum_offset + 2];
+								return partdesc->last_found_part_index;
+							}
+						}
 					}
 					/* fall-through and do a manual lookup */
 				}
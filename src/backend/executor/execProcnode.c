@@ -72,6 +72,7 @@
  */
 #include "postgres.h"
 
+#include "executor/execSampling.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
 #include "executor/nodeAppend.h"
@@ -121,6 +122,7 @@
 
 static TupleTableSlot *ExecProcNodeFirst(PlanState *node);
 static TupleTableSlot *ExecProcNodeInstr(PlanState *node);
+static TupleTableSlot *ExecProcNodeSample(PlanState *node);
 static bool ExecShutdownNode_walker(PlanState *node, void *context);
 
 
@@ -452,11 +454,16 @@ ExecProcNodeFirst(PlanState *node)
 	check_stack_depth();
 
 	/*
-	 * If instrumentation is required, change the wrapper to one that just
-	 * does instrumentation.  Otherwise we can dispense with all wrappers and
-	 * have ExecProcNode() directly call the relevant function from now on.
+	 * If the query is being sampled, change the wrapper to one that makes
+	 * the node visible to the sampling timer (and does instrumentation, if
+	 * required).  If only instrumentation is required, change the wrapper to
+	 * one that just does instrumentation.  Otherwise we can dispense with all
+	 * wrappers and have ExecProcNode() directly call the relevant function
+	 * from now on.
 	 */
-	if (node->instrument)
+	if (node->state->es_sampling)
+		node->ExecProcNode = ExecProcNodeSample;
+	else if (node->instrument)
 		node->ExecProcNode = ExecProcNodeInstr;
 	else
 		node->ExecProcNode = node->ExecProcNodeReal;
@@ -485,6 +492,33 @@ ExecProcNodeInstr(PlanState *node)
 }
 
 
+/*
+ * ExecProcNode wrapper that records the node as the one currently executing,
+ * for the sampling timer of execSampling.c.  The previous node is restored
+ * afterwards, so that the samples taken after returning are attributed to
+ * the parent node again.
+ */
+static TupleTableSlot *
+ExecProcNodeSample(PlanState *node)
+{
+	ExecSampleNode save = CurrentSampleNode;
+	TupleTableSlot *result;
+
+	CurrentSampleNode.queryId = node->state->es_plannedstmt->queryId;
+	CurrentSampleNode.plan_node_id = node->plan->plan_node_id;
+	CurrentSampleNode.node_tag = nodeTag(node->plan);
+
+	if (node->instrument)
+		result = ExecProcNodeInstr(node);
+	else
+		result = node->ExecProcNodeReal(node);
+
+	CurrentSampleNode = save;
+
+	return result;
+}
+
+
 /* ----------------------------------------------------------------
  *		MultiExecProcNode
  *
@@ -502,6 +536,7 @@ Node *
 MultiExecProcNode(PlanState *node)
 {
 	Node	   *result;
+	ExecSampleNode save_sample_node;
 
 	check_stack_depth();
 
@@ -510,6 +545,15 @@ MultiExecProcNode(PlanState *node)
 	if (node->chgParam != NULL) /* something changed */
 		ExecReScan(node);		/* let ReScan handle this */
 
+	/* make the node visible to the sampling timer, as ExecProcNodeSample */
+	if (node->state->es_sampling)
+	{
+		save_sample_node = CurrentSampleNode;
+		CurrentSampleNode.queryId = node->state->es_plannedstmt->queryId;
+		CurrentSampleNode.plan_node_id = node->plan->plan_node_id;
+		CurrentSampleNode.node_tag = nodeTag(node->plan);
+	}
+
 	switch (nodeTag(node))
 	{
 			/*
@@ -538,6 +582,9 @@ MultiExecProcNode(PlanState *node)
 			break;
 	}
 
+	if (node->state->es_sampling)
+		CurrentSampleNode = save_sample_node;
+
 	return result;
 }
 
@@ -818,6 +865,12 @@ ExecShutdownNode_walker(PlanState *node, void *context)
 		case T_HashJoinState:
 			ExecShutdownHashJoin((HashJoinState *) node);
 			break;
+		case T_MemoizeState:
+			ExecShutdownMemoize((MemoizeState *) node);
+			break;
+		case T_CteScanState:
+			ExecShutdownCteScan((CteScanState *) node);
+			break;
 		default:
 			break;
 	}
@@ -445,7 +445,7 @@ ExecSimpleRelationInsert(ResultRelInfo *resultRelInfo,
 		if (resultRelInfo->ri_NumIndices > 0)
 			recheckIndexes = ExecInsertIndexTuples(resultRelInfo,
 												   slot, estate, false, false,
-												   NULL, NIL);
+												   NULL, NIL, false);
 
 		/* AFTER ROW INSERT Triggers */
 		ExecARInsertTriggers(estate, resultRelInfo, slot,
@@ -461,6 +461,75 @@ ExecSimpleRelationInsert(ResultRelInfo *resultRelInfo,
 	}
 }
 
+/*
+ * Insert the tuples represented in the slots to the relation, like
+ * ExecSimpleRelationInsert() does for one tuple, but with a single
+ * table_multi_insert() call and batched index insertion.
+ *
+ * BEFORE ROW INSERT triggers are not supported, since they could skip or
+ * modify the tuples.  Caller is responsible for opening the indexes.
+ */
+void
+ExecSimpleRelationMultiInsert(ResultRelInfo *resultRelInfo,
+							  EState *estate, TupleTableSlot **slots,
+							  int nslots)
+{
+	Relation	rel = resultRelInfo->ri_RelationDesc;
+	bool	   *batchedIndexes = NULL;
+	MemoryContext oldcontext;
+
+	/* For now we support only tables. */
+	Assert(rel->rd_rel->relkind == RELKIND_RELATION);
+	Assert(resultRelInfo->ri_TrigDesc == NULL ||
+		   !resultRelInfo->ri_TrigDesc->trig_insert_before_row);
+
+	CheckCmdReplicaIdentity(rel, CMD_INSERT);
+
+	for (int i = 0; i < nslots; i++)
+	{
+		/* Compute stored generated columns */
+		if (rel->rd_att->constr &&
+			rel->rd_att->constr->has_generated_stored)
+			ExecComputeStoredGenerated(resultRelInfo, estate, slots[i],
+									   CMD_INSERT);
+
+		/* Check the constraints of the tuple */
+		if (rel->rd_att->constr)
+			ExecConstraints(resultRelInfo, slots[i], estate);
+		if (rel->rd_rel->relispartition)
+			ExecPartitionCheck(resultRelInfo, slots[i], estate, true);
+	}
+
+	/*
+	 * OK, store the tuples.  table_multi_insert may leak memory, so switch to
+	 * short-lived memory context before calling it.
+	 */
+	oldcontext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+	table_multi_insert(rel, slots, nslots, estate->es_output_cid, 0, NULL);
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Create index entries, in one go for the indexes that allow it */
+	if (resultRelInfo->ri_NumIndices > 0)
+		batchedIndexes = ExecInsertIndexTuplesBatch(resultRelInfo,
+													slots, nslots, estate);
+
+	for (int i = 0; i < nslots; i++)
+	{
+		List	   *recheckIndexes = NIL;
+
+		if (resultRelInfo->ri_NumIndices > 0)
+			recheckIndexes = ExecInsertUnbatchedIndexTuples(resultRelInfo,
+															slots[i], estate,
+															batchedIndexes);
+
+		/* AFTER ROW INSERT Triggers */
+		ExecARInsertTriggers(estate, resultRelInfo, slots[i],
+							 recheckIndexes, NULL);
+
+		list_free(recheckIndexes);
+	}
+}
+
 /*
  * Find the searchslot tuple and update it with data in the slot,
  * update the indexes, and execute any constraints and per-row triggers.
@@ -493,7 +562,7 @@ ExecSimpleRelationUpdate(ResultRelInfo *resultRelInfo,
 	if (!skip_tuple)
 	{
 		List	   *recheckIndexes = NIL;
-		bool		update_indexes;
+		TU_UpdateIndexes update_indexes;
 
 		/* Compute stored generated columns */
 		if (rel->rd_att->constr &&
@@ -510,10 +579,11 @@ ExecSimpleRelationUpdate(ResultRelInfo *resultRelInfo,
 		simple_table_tuple_update(rel, tid, slot, estate->es_snapshot,
 								  &update_indexes);
 
-		if (resultRelInfo->ri_NumIndices > 0 && update_indexes)
+		if (resultRelInfo->ri_NumIndices > 0 && (update_indexes != TU_None))
 			recheckIndexes = ExecInsertIndexTuples(resultRelInfo,
 												   slot, estate, true, false,
-												   NULL, NIL);
+												   NULL, NIL,
+												   (update_indexes == TU_Summarizing));
 
 		/* AFTER ROW UPDATE Triggers */
 		ExecARUpdateTriggers(estate, resultRelInfo,
@@ -0,0 +1,575 @@
+/*-------------------------------------------------------------------------
+ *
+ * execRuntimeFilter.c
+ *	  Support for Bloom filters that hash joins push down into scans.
+ *
+ * When the inner side of a hash join is selective, most of the tuples
+ * coming from the outer side find no join partner, and are discarded only
+ * after they have been produced by the scan at the bottom of the outer plan
+ * and passed up through everything in between.  To avoid that, the hash join
+ * can push a "runtime filter" down to that scan: a Bloom filter containing
+ * the hash values of all inner tuples, built while the hash table is built.
+ * The scan computes the hash value of the join keys of each of its tuples,
+ * exactly like the join will, and drops tuples whose hash value the filter
+ * lacks.  False positives are harmless, since the join still checks the
+ * join clauses.
+ *
+ * A filter can be pushed down through the outer side of inner joins and
+ * semijoins, as long as the join keys are plain columns passed up by those
+ * nodes, and through a Gather into its workers, in which case the leader
+ * copies the filter into the DSM segment.  For that to work, the hash table
+ * must be built before the Gather launches its workers, so the hash join
+ * doesn't try to fetch the first outer tuple early if it has pushed down a
+ * filter.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execRuntimeFilter.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "executor/execRuntimeFilter.h"
+#include "executor/executor.h"
+#include "executor/nodeSeqscan.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
+#include "port/pg_bitutils.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+
+/* GUC parameter */
+bool		enable_runtime_filter = false;
+
+/*
+ * After checking this many tuples, a scan stops checking a filter that has
+ * removed less than RUNTIME_FILTER_MIN_REMOVED of them, as the filter then
+ * costs more than it saves.
+ */
+#define RUNTIME_FILTER_SAMPLE_TUPLES	4096
+#define RUNTIME_FILTER_MIN_REMOVED		0.1
+
+/*
+ * Key under which the leader stores the i'th filter of a scan that it sends
+ * to the workers.
+ */
+#define PARALLEL_KEY_RUNTIME_FILTER(plan_node_id, i) \
+	(UINT64CONST(0xC000000000000000) | ((uint64) (plan_node_id) << 16) | (i))
+
+/*
+ * A filter in the DSM segment.  It's followed by the join operators and
+ * collations, the nodeToString() representation of the keys, and the Bloom
+ * filter.
+ */
+typedef struct SharedRuntimeFilter
+{
+	bool		ready;			/* does the copy of the Bloom filter hold a
+								 * complete filter? */
+	int			nkeys;
+	Size		keys_offset;	/* offset of the keys' string */
+	Size		bloom_offset;	/* offset of the Bloom filter */
+	Size		bloom_size;
+	Oid			oids[FLEXIBLE_ARRAY_MEMBER];	/* operators, then collations */
+} SharedRuntimeFilter;
+
+typedef struct translate_keys_context
+{
+	List	   *targetlist;		/* targetlist of the node passed through */
+	bool		failed;
+} translate_keys_context;
+
+static Node *translate_keys_mutator(Node *node,
+									translate_keys_context *context);
+static RuntimeFilter *make_runtime_filter(PlanState *scanstate,
+										  List *keyexprs,
+										  Oid *hashoperators,
+										  Oid *collations);
+static bool runtime_filter_check(RuntimeFilter *rf, TupleTableSlot *slot);
+static Size shared_runtime_filter_size(RuntimeFilter *rf, char *keys_string);
+
+
+/*
+ * ExecPushDownRuntimeFilter
+ *		Try to find a scan in the outer plan of a hash join that can apply
+ *		a runtime filter for the join, and attach a filter to it.
+ *
+ * hashkeys are the join's outer hash keys, as expressions over the result
+ * tuples of outerstate.  The caller is responsible for checking that the
+ * join type allows discarding outer tuples without join partners.
+ *
+ * Returns the filter, to be built by the join's Hash node, or NULL if the
+ * filter couldn't be pushed down.
+ */
+RuntimeFilter *
+ExecPushDownRuntimeFilter(PlanState *outerstate, List *hashkeys,
+						  List *hashoperators, List *hashcollations)
+{
+	PlanState  *ps = outerstate;
+	List	   *keys = hashkeys;
+	bool		from_leader = false;
+	RuntimeFilter *rf;
+	Oid		   *ops;
+	Oid		   *colls;
+	ListCell   *lc;
+	int			i;
+
+	if (contain_volatile_functions((Node *) keys))
+		return NULL;
+
+	while (!IsA(ps, SeqScanState))
+	{
+		translate_keys_context context;
+
+		switch (nodeTag(ps))
+		{
+			case T_GatherState:
+				from_leader = true;
+				break;
+			case T_HashJoinState:
+			case T_MergeJoinState:
+			case T_NestLoopState:
+				{
+					JoinType	jointype = ((JoinState *) ps)->jointype;
+
+					/* these pass up each outer tuple at most once, unchanged */
+					if (jointype != JOIN_INNER && jointype != JOIN_SEMI)
+						return NULL;
+				}
+				break;
+			default:
+				return NULL;
+		}
+
+		/* Express the keys in terms of the node's outer input */
+		context.targetlist = ps->plan->targetlist;
+		context.failed = false;
+		keys = (List *) translate_keys_mutator((Node *) keys, &context);
+		if (context.failed)
+			return NULL;
+
+		ps = outerPlanState(ps);
+	}
+
+	/* Filters are sent to the workers as part of setting up a parallel scan */
+	if (from_leader && !ps->plan->parallel_aware)
+		return NULL;
+
+	ops = (Oid *) palloc(list_length(keys) * sizeof(Oid));
+	colls = (Oid *) palloc(list_length(keys) * sizeof(Oid));
+	i = 0;
+	foreach(lc, hashoperators)
+		ops[i++] = lfirst_oid(lc);
+	i = 0;
+	foreach(lc, hashcollations)
+		colls[i++] = lfirst_oid(lc);
+
+	rf = make_runtime_filter(ps, keys, ops, colls);
+	rf->from_leader = from_leader;
+	ExecSeqScanAddRuntimeFilter((SeqScanState *) ps, rf);
+
+	return rf;
+}
+
+/*
+ * Replace references to the outer input's tuple found in the targetlist of
+ * a join or Gather node with the corresponding references to the node's own
+ * outer input.  That only works for targetlist entries that are plain outer
+ * Vars; everything else fails the translation.
+ */
+static Node *
+translate_keys_mutator(Node *node, translate_keys_context *context)
+{
+	if (node == NULL)
+		return NULL;
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) node;
+		TargetEntry *tle;
+
+		if (var->varno != OUTER_VAR || var->varattno <= 0 ||
+			var->varattno > list_length(context->targetlist))
+		{
+			context->failed = true;
+			return node;
+		}
+
+		tle = list_nth_node(TargetEntry, context->targetlist,
+							var->varattno - 1);
+		if (!IsA(tle->expr, Var) || ((Var *) tle->expr)->varno != OUTER_VAR)
+		{
+			context->failed = true;
+			return node;
+		}
+		return (Node *) copyObject(tle->expr);
+	}
+	if (IsA(node, Param) || IsA(node, SubPlan))
+	{
+		/* the scan might see different values than the join */
+		context->failed = true;
+		return node;
+	}
+	return expression_tree_mutator(node, translate_keys_mutator,
+								   (void *) context);
+}
+
+/*
+ * Set up a runtime filter to be applied by scanstate, not yet built.
+ */
+static RuntimeFilter *
+make_runtime_filter(PlanState *scanstate, List *keyexprs,
+					Oid *hashoperators, Oid *collations)
+{
+	RuntimeFilter *rf = (RuntimeFilter *) palloc0(sizeof(RuntimeFilter));
+	int			nkeys = list_length(keyexprs);
+
+	rf->scanstate = scanstate;
+	rf->nkeys = nkeys;
+	rf->keyexprs = keyexprs;
+	rf->keystates = ExecInitExprList(keyexprs, scanstate);
+	rf->hashoperators = hashoperators;
+	rf->collations = collations;
+	rf->hashfunctions = (FmgrInfo *) palloc(nkeys * sizeof(FmgrInfo));
+	rf->hashStrict = (bool *) palloc(nkeys * sizeof(bool));
+
+	/* Look up the hash functions the join uses for its outer tuples */
+	for (int i = 0; i < nkeys; i++)
+	{
+		Oid			left_hashfn;
+		Oid			right_hashfn;
+
+		if (!get_op_hash_functions(hashoperators[i], &left_hashfn,
+								   &right_hashfn))
+			elog(ERROR, "could not find hash function for hash operator %u",
+				 hashoperators[i]);
+		fmgr_info(left_hashfn, &rf->hashfunctions[i]);
+		rf->hashStrict[i] = op_strict(hashoperators[i]);
+	}
+
+	rf->econtext = CreateExprContext(scanstate->state);
+
+	return rf;
+}
+
+/*
+ * ExecRuntimeFilterBegin
+ *		Start building a new filter, for about ntuples inner tuples.
+ */
+void
+ExecRuntimeFilterBegin(RuntimeFilter *rf, double ntuples)
+{
+	MemoryContext oldcontext;
+
+	ExecRuntimeFilterReset(rf);
+
+	oldcontext = MemoryContextSwitchTo(rf->scanstate->state->es_query_cxt);
+	rf->bloom = bloom_create((int64) Max(ntuples, 1.0), work_mem, 0);
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * ExecRuntimeFilterAdd
+ *		Add the hash value of an inner tuple to the filter being built.
+ */
+void
+ExecRuntimeFilterAdd(RuntimeFilter *rf, uint32 hashvalue)
+{
+	bloom_add_element(rf->bloom, (unsigned char *) &hashvalue,
+					  sizeof(hashvalue));
+}
+
+/*
+ * ExecRuntimeFilterFinish
+ *		Let the scan start applying the filter.
+ */
+void
+ExecRuntimeFilterFinish(RuntimeFilter *rf)
+{
+	Assert(rf->bloom != NULL);
+	rf->ready = true;
+}
+
+/*
+ * ExecRuntimeFilterReset
+ *		Forget the filter, because the join is going to rebuild its hash
+ *		table.
+ */
+void
+ExecRuntimeFilterReset(RuntimeFilter *rf)
+{
+	if (rf->bloom != NULL && !rf->bloom_shared)
+		bloom_free(rf->bloom);
+	rf->bloom = NULL;
+	rf->bloom_shared = false;
+	rf->ready = false;
+	rf->nchecked = 0;
+	rf->nremoved = 0;
+	rf->disabled = false;
+}
+
+/*
+ * ExecRuntimeFiltersPass
+ *		Check whether a tuple returned by a scan might have join partners
+ *		according to all of the scan's runtime filters.
+ */
+bool
+ExecRuntimeFiltersPass(PlanState *scanstate, List *filters,
+					   TupleTableSlot *slot)
+{
+	ListCell   *lc;
+
+	foreach(lc, filters)
+	{
+		RuntimeFilter *rf = (RuntimeFilter *) lfirst(lc);
+
+		if (!rf->ready || rf->disabled)
+			continue;
+
+		if (!runtime_filter_check(rf, slot))
+		{
+			InstrCountFiltered2(scanstate, 1);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Check one filter.  This computes the hash value the same way as
+ * ExecHashGetHashValue() does for the join's outer tuples.
+ */
+static bool
+runtime_filter_check(RuntimeFilter *rf, TupleTableSlot *slot)
+{
+	ExprContext *econtext = rf->econtext;
+	MemoryContext oldcontext;
+	uint32		hashkey = 0;
+	bool		result = true;
+	ListCell   *lc;
+	int			i = 0;
+
+	ResetExprContext(econtext);
+	econtext->ecxt_outertuple = slot;
+
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	foreach(lc, rf->keystates)
+	{
+		ExprState  *keyexpr = (ExprState *) lfirst(lc);
+		Datum		keyval;
+		bool		isNull;
+
+		hashkey = pg_rotate_left32(hashkey, 1);
+
+		keyval = ExecEvalExpr(keyexpr, econtext, &isNull);
+
+		if (isNull)
+		{
+			/* the join will reject this tuple right away */
+			if (rf->hashStrict[i])
+			{
+				result = false;
+				break;
+			}
+		}
+		else
+			hashkey ^= DatumGetUInt32(FunctionCall1Coll(&rf->hashfunctions[i],
+														rf->collations[i],
+														keyval));
+		i++;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (result)
+		result = !bloom_lacks_element(rf->bloom, (unsigned char *) &hashkey,
+									  sizeof(hashkey));
+
+	/* Stop checking the filter if it doesn't remove enough tuples */
+	rf->nchecked++;
+	if (!result)
+		rf->nremoved++;
+	if (rf->nchecked == RUNTIME_FILTER_SAMPLE_TUPLES &&
+		rf->nremoved < rf->nchecked * RUNTIME_FILTER_MIN_REMOVED)
+		rf->disabled = true;
+
+	return result;
+}
+
+/* ----------------------------------------------------------------
+ *						Parallel Query Support
+ *
+ * Filters built by the leader, above a Gather, are copied into the DSM
+ * segment when the scan sets up its parallel scan descriptor; filters
+ * built below the Gather are built by each worker on its own.
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Size of the DSM copy of a filter, given its keys' string representation.
+ */
+static Size
+shared_runtime_filter_size(RuntimeFilter *rf, char *keys_string)
+{
+	Size		size;
+
+	size = MAXALIGN(offsetof(SharedRuntimeFilter, oids) +
+					2 * rf->nkeys * sizeof(Oid));
+	size = add_size(size, MAXALIGN(strlen(keys_string) + 1));
+	size = add_size(size, bloom_size(rf->bloom));
+
+	return size;
+}
+
+/*
+ * ExecRuntimeFiltersEstimate
+ *		Estimate the DSM space needed to send a scan's filters to the
+ *		workers.
+ */
+void
+ExecRuntimeFiltersEstimate(List *filters, ParallelContext *pcxt)
+{
+	ListCell   *lc;
+
+	foreach(lc, filters)
+	{
+		RuntimeFilter *rf = (RuntimeFilter *) lfirst(lc);
+
+		if (!rf->from_leader || !rf->ready)
+			continue;
+
+		shm_toc_estimate_chunk(&pcxt->estimator,
+							   shared_runtime_filter_size(rf,
+														  nodeToString(rf->keyexprs)));
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+}
+
+/*
+ * ExecRuntimeFiltersInitializeDSM
+ *		Copy the filters that the leader has built into the DSM segment.
+ */
+void
+ExecRuntimeFiltersInitializeDSM(List *filters, int plan_node_id,
+								ParallelContext *pcxt)
+{
+	ListCell   *lc;
+	int			i = 0;
+
+	foreach(lc, filters)
+	{
+		RuntimeFilter *rf = (RuntimeFilter *) lfirst(lc);
+		SharedRuntimeFilter *shared;
+		char	   *keys_string;
+		Size		keys_len;
+
+		if (!rf->from_leader || !rf->ready)
+			continue;
+
+		keys_string = nodeToString(rf->keyexprs);
+		keys_len = strlen(keys_string) + 1;
+
+		shared = shm_toc_allocate(pcxt->toc,
+								  shared_runtime_filter_size(rf, keys_string));
+		shared->ready = true;
+		shared->nkeys = rf->nkeys;
+		memcpy(shared->oids, rf->hashoperators, rf->nkeys * sizeof(Oid));
+		memcpy(shared->oids + rf->nkeys, rf->collations,
+			   rf->nkeys * sizeof(Oid));
+		shared->keys_offset = MAXALIGN(offsetof(SharedRuntimeFilter, oids) +
+									   2 * rf->nkeys * sizeof(Oid));
+		memcpy((char *) shared + shared->keys_offset, keys_string, keys_len);
+		shared->bloom_offset = shared->keys_offset + MAXALIGN(keys_len);
+		shared->bloom_size = bloom_size(rf->bloom);
+		memcpy((char *) shared + shared->bloom_offset, rf->bloom,
+			   shared->bloom_size);
+
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_RUNTIME_FILTER(plan_node_id, i),
+					   shared);
+		rf->shared = shared;
+		i++;
+	}
+}
+
+/*
+ * ExecRuntimeFiltersReInitializeDSM
+ *		Refresh the DSM copies of the filters before a rescan.
+ *
+ * The join has rebuilt its hash table by now, if it had to.  A filter that
+ * had not been built when the DSM segment was set up cannot be sent now.
+ */
+void
+ExecRuntimeFiltersReInitializeDSM(List *filters)
+{
+	ListCell   *lc;
+
+	foreach(lc, filters)
+	{
+		RuntimeFilter *rf = (RuntimeFilter *) lfirst(lc);
+		SharedRuntimeFilter *shared = rf->shared;
+
+		if (shared == NULL)
+			continue;
+
+		shared->ready = rf->ready &&
+			bloom_size(rf->bloom) == shared->bloom_size;
+		if (shared->ready)
+			memcpy((char *) shared + shared->bloom_offset, rf->bloom,
+				   shared->bloom_size);
+	}
+}
+
+/*
+ * ExecRuntimeFiltersInitializeWorker
+ *		Attach to the filters that the leader has built for the scan.
+ *
+ * Returns filters, with the leader's filters added.
+ */
+List *
+ExecRuntimeFiltersInitializeWorker(PlanState *scanstate, List *filters,
+								   ParallelWorkerContext *pwcxt)
+{
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(scanstate->state->es_query_cxt);
+
+	for (int i = 0;; i++)
+	{
+		SharedRuntimeFilter *shared;
+		RuntimeFilter *rf;
+		Oid		   *ops;
+		Oid		   *colls;
+		List	   *keys;
+
+		shared = shm_toc_lookup(pwcxt->toc,
+								PARALLEL_KEY_RUNTIME_FILTER(scanstate->plan->plan_node_id,
+															i),
+								true);
+		if (shared == NULL)
+			break;
+		if (!shared->ready)
+			continue;
+
+		ops = (Oid *) palloc(shared->nkeys * sizeof(Oid));
+		colls = (Oid *) palloc(shared->nkeys * sizeof(Oid));
+		memcpy(ops, shared->oids, shared->nkeys * sizeof(Oid));
+		memcpy(colls, shared->oids + shared->nkeys,
+			   shared->nkeys * sizeof(Oid));
+		keys = (List *) stringToNode((char *) shared + shared->keys_offset);
+
+		rf = make_runtime_filter(scanstate, keys, ops, colls);
+		rf->bloom = (bloom_filter *) ((char *) shared + shared->bloom_offset);
+		rf->bloom_shared = true;
+		rf->ready = true;
+		filters = lappend(filters, rf);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return filters;
+}
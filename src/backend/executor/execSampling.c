@@ -0,0 +1,407 @@
+/*-------------------------------------------------------------------------
+ *
+ * execSampling.c
+ *	  Sampling of the plan nodes executed by running queries
+ *
+ * When query_sample_interval is set, every query that has a query
+ * identifier arms a periodic timer while it runs.  Its plan nodes are
+ * executed through a wrapper (see ExecProcNodeSample() in execProcnode.c)
+ * that keeps CurrentSampleNode pointing at the innermost node being
+ * executed.  Each time the timer fires, the signal handler counts one
+ * sample for the current node and the wait event the process is currently
+ * reporting, in a small table local to the process.  Since it runs in a
+ * signal handler it must not allocate memory or take locks, so the table
+ * has a fixed size, and samples for which no slot is left are lost.
+ *
+ * When the query that armed the timer ends, the local counts are added to
+ * a hash table in shared memory, keyed by database, query identifier, plan
+ * node and wait event, which is shown by the pg_stat_query_samples view.
+ * When the shared table is full, samples of new combinations are lost
+ * until pg_stat_reset_query_samples() is called.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execSampling.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "common/hashfn.h"
+#include "executor/execSampling.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/timeout.h"
+#include "utils/timestamp.h"
+#include "utils/wait_event.h"
+
+/* maximum number of entries in the shared hash table */
+#define QUERY_SAMPLE_MAX_ENTRIES	4096
+
+/* number of slots in the table of samples local to a process */
+#define LOCAL_SAMPLE_SLOTS			256
+
+typedef struct QuerySampleKey
+{
+	uint64		queryid;
+	Oid			dbid;
+	int32		plan_node_id;
+	NodeTag		node_tag;
+	uint32		wait_event_info;
+} QuerySampleKey;
+
+typedef struct QuerySampleEntry
+{
+	QuerySampleKey key;			/* hash key of entry - MUST BE FIRST */
+	int64		samples;
+} QuerySampleEntry;
+
+/* GUC variable */
+int			query_sample_interval = 0;
+
+/* the plan node currently executing, maintained by ExecProcNodeSample() */
+ExecSampleNode CurrentSampleNode;
+
+/*
+ * Samples taken by this process, not yet added to the shared table.  A slot
+ * is in use when its sample count is not zero.
+ */
+static QuerySampleEntry LocalSamples[LOCAL_SAMPLE_SLOTS];
+static int	LocalSamplesUsed = 0;
+
+static HTAB *QuerySampleHash = NULL;
+
+static void QuerySampleFlush(void);
+static const char *QuerySampleNodeName(NodeTag tag);
+
+
+/*
+ * Report shared memory space needed by QuerySampleShmemInit
+ */
+Size
+QuerySampleShmemSize(void)
+{
+	return hash_estimate_size(QUERY_SAMPLE_MAX_ENTRIES,
+							  sizeof(QuerySampleEntry));
+}
+
+/*
+ * Allocate and initialize the shared hash table of samples
+ */
+void
+QuerySampleShmemInit(void)
+{
+	HASHCTL		info;
+
+	info.keysize = sizeof(QuerySampleKey);
+	info.entrysize = sizeof(QuerySampleEntry);
+	QuerySampleHash = ShmemInitHash("Query Samples",
+									QUERY_SAMPLE_MAX_ENTRIES,
+									QUERY_SAMPLE_MAX_ENTRIES,
+									&info,
+									HASH_ELEM | HASH_BLOBS);
+}
+
+/*
+ * ExecSampleStart
+ *		Enable sampling for a query that is about to be started.
+ *
+ * The first sampled query of a nest of queries arms the timer and becomes
+ * responsible for disarming it again in ExecSampleEnd().
+ */
+void
+ExecSampleStart(EState *estate)
+{
+	estate->es_sampling = true;
+
+	if (!get_timeout_active(QUERY_SAMPLE_TIMEOUT))
+	{
+		TimestampTz fin_time;
+
+		fin_time = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+											   query_sample_interval);
+		enable_timeout_every(QUERY_SAMPLE_TIMEOUT, fin_time,
+							 query_sample_interval);
+		estate->es_sample_timer = true;
+	}
+}
+
+/*
+ * ExecSampleEnd
+ *		Disarm the timer if this query armed it, and publish the samples.
+ */
+void
+ExecSampleEnd(EState *estate)
+{
+	if (!estate->es_sample_timer)
+		return;
+
+	disable_timeout(QUERY_SAMPLE_TIMEOUT, false);
+	estate->es_sample_timer = false;
+
+	/* forget a node left behind by an error in a nested query */
+	memset(&CurrentSampleNode, 0, sizeof(ExecSampleNode));
+
+	QuerySampleFlush();
+}
+
+/*
+ * Timeout handler of QUERY_SAMPLE_TIMEOUT, called from the SIGALRM handler.
+ */
+void
+QuerySampleTimeoutHandler(void)
+{
+	volatile ExecSampleNode *current = &CurrentSampleNode;
+	QuerySampleKey key;
+	uint32		h;
+	int			i;
+
+	if (current->queryId == UINT64CONST(0))
+		return;
+
+	key.queryid = current->queryId;
+	key.dbid = MyDatabaseId;
+	key.plan_node_id = current->plan_node_id;
+	key.node_tag = current->node_tag;
+	key.wait_event_info = *my_wait_event_info;
+
+	h = murmurhash32((uint32) key.queryid ^ (uint32) (key.queryid >> 32) ^
+					 (uint32) key.plan_node_id ^ key.wait_event_info);
+
+	/* find the slot of this key by linear probing, or a free one */
+	for (i = 0; i < LOCAL_SAMPLE_SLOTS; i++)
+	{
+		QuerySampleEntry *slot = &LocalSamples[(h + i) % LOCAL_SAMPLE_SLOTS];
+
+		if (slot->samples == 0)
+		{
+			slot->key = key;
+			slot->samples = 1;
+			LocalSamplesUsed++;
+			return;
+		}
+		if (memcmp(&slot->key, &key, sizeof(QuerySampleKey)) == 0)
+		{
+			slot->samples++;
+			return;
+		}
+	}
+
+	/* no slot left, the sample is lost */
+}
+
+/*
+ * Add the local samples to the shared hash table.  The timer must not be
+ * active.
+ */
+static void
+QuerySampleFlush(void)
+{
+	int			i;
+
+	if (LocalSamplesUsed == 0)
+		return;
+
+	LWLockAcquire(QuerySampleLock, LW_EXCLUSIVE);
+
+	for (i = 0; i < LOCAL_SAMPLE_SLOTS; i++)
+	{
+		QuerySampleEntry *slot = &LocalSamples[i];
+		QuerySampleEntry *entry;
+		bool		found;
+
+		if (slot->samples == 0)
+			continue;
+
+		entry = (QuerySampleEntry *) hash_search(QuerySampleHash,
+												 &slot->key,
+												 HASH_ENTER_NULL, &found);
+		if (entry != NULL)
+		{
+			if (!found)
+				entry->samples = 0;
+			entry->samples += slot->samples;
+		}
+
+		slot->samples = 0;
+	}
+
+	LWLockRelease(QuerySampleLock);
+
+	LocalSamplesUsed = 0;
+}
+
+/*
+ * Return the name EXPLAIN uses for a plan node type.
+ */
+static const char *
+QuerySampleNodeName(NodeTag tag)
+{
+	switch (tag)
+	{
+		case T_Result:
+			return "Result";
+		case T_ProjectSet:
+			return "ProjectSet";
+		case T_ModifyTable:
+			return "ModifyTable";
+		case T_Append:
+			return "Append";
+		case T_MergeAppend:
+			return "Merge Append";
+		case T_RecursiveUnion:
+			return "Recursive Union";
+		case T_BitmapAnd:
+			return "BitmapAnd";
+		case T_BitmapOr:
+			return "BitmapOr";
+		case T_NestLoop:
+			return "Nested Loop";
+		case T_MergeJoin:
+			return "Merge Join";
+		case T_HashJoin:
+			return "Hash Join";
+		case T_SeqScan:
+			return "Seq Scan";
+		case T_SampleScan:
+			return "Sample Scan";
+		case T_Gather:
+			return "Gather";
+		case T_GatherMerge:
+			return "Gather Merge";
+		case T_IndexScan:
+			return "Index Scan";
+		case T_IndexOnlyScan:
+			return "Index Only Scan";
+		case T_BitmapIndexScan:
+			return "Bitmap Index Scan";
+		case T_BitmapHeapScan:
+			return "Bitmap Heap Scan";
+		case T_TidScan:
+			return "Tid Scan";
+		case T_TidRangeScan:
+			return "Tid Range Scan";
+		case T_SubqueryScan:
+			return "Subquery Scan";
+		case T_FunctionScan:
+			return "Function Scan";
+		case T_TableFuncScan:
+			return "Table Function Scan";
+		case T_ValuesScan:
+			return "Values Scan";
+		case T_CteScan:
+			return "CTE Scan";
+		case T_NamedTuplestoreScan:
+			return "Named Tuplestore Scan";
+		case T_WorkTableScan:
+			return "WorkTable Scan";
+		case T_ForeignScan:
+			return "Foreign Scan";
+		case T_CustomScan:
+			return "Custom Scan";
+		case T_Material:
+			return "Materialize";
+		case T_Memoize:
+			return "Memoize";
+		case T_Sort:
+			return "Sort";
+		case T_IncrementalSort:
+			return "Incremental Sort";
+		case T_Group:
+			return "Group";
+		case T_Agg:
+			return "Aggregate";
+		case T_WindowAgg:
+			return "WindowAgg";
+		case T_Unique:
+			return "Unique";
+		case T_SetOp:
+			return "SetOp";
+		case T_LockRows:
+			return "LockRows";
+		case T_Limit:
+			return "Limit";
+		case T_Hash:
+			return "Hash";
+		default:
+			return "???";
+	}
+}
+
+/*
+ * pg_stat_get_query_samples
+ *		Return the samples collected in the shared hash table.
+ */
+Datum
+pg_stat_get_query_samples(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_QUERY_SAMPLES_COLS	7
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	HASH_SEQ_STATUS hash_seq;
+	QuerySampleEntry *entry;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	LWLockAcquire(QuerySampleLock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, QuerySampleHash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		Datum		values[PG_STAT_GET_QUERY_SAMPLES_COLS] = {0};
+		bool		nulls[PG_STAT_GET_QUERY_SAMPLES_COLS] = {0};
+		const char *wait_event_type;
+		const char *wait_event;
+
+		values[0] = ObjectIdGetDatum(entry->key.dbid);
+		values[1] = Int64GetDatum((int64) entry->key.queryid);
+		values[2] = Int32GetDatum(entry->key.plan_node_id);
+		values[3] = CStringGetTextDatum(QuerySampleNodeName(entry->key.node_tag));
+
+		wait_event_type = pgstat_get_wait_event_type(entry->key.wait_event_info);
+		wait_event = pgstat_get_wait_event(entry->key.wait_event_info);
+		if (wait_event_type)
+			values[4] = CStringGetTextDatum(wait_event_type);
+		else
+			nulls[4] = true;
+		if (wait_event)
+			values[5] = CStringGetTextDatum(wait_event);
+		else
+			nulls[5] = true;
+
+		values[6] = Int64GetDatum(entry->samples);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	LWLockRelease(QuerySampleLock);
+
+	return (Datum) 0;
+}
+
+/*
+ * pg_stat_reset_query_samples
+ *		Remove all entries from the shared hash table.
+ */
+Datum
+pg_stat_reset_query_samples(PG_FUNCTION_ARGS)
+{
+	HASH_SEQ_STATUS hash_seq;
+	QuerySampleEntry *entry;
+
+	LWLockAcquire(QuerySampleLock, LW_EXCLUSIVE);
+
+	hash_seq_init(&hash_seq, QuerySampleHash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		hash_search(QuerySampleHash, &entry->key, HASH_REMOVE, NULL);
+
+	LWLockRelease(QuerySampleLock);
+
+	PG_RETURN_VOID();
+}
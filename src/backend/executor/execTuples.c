@@ -907,6 +907,191 @@ tts_buffer_heap_store_tuple(TupleTableSlot *slot, HeapTuple tuple,
 	}
 }
 
+/*
+ * A deform program describes, for each attribute of a tuple descriptor, how
+ * to extract it from a heap tuple: how to fetch the value, which alignment
+ * it requires, and at which offset it is found if all preceding attributes
+ * are non-null and of fixed length.  It is built once per slot and
+ * descriptor, to avoid having to re-derive all of that from the
+ * descriptor's attributes for every tuple.
+ */
+typedef enum DeformKind
+{
+	DEFORM_BYVAL_1,				/* pass-by-value, 1 byte */
+	DEFORM_BYVAL_2,				/* pass-by-value, 2 bytes */
+	DEFORM_BYVAL_4,				/* pass-by-value, 4 bytes */
+	DEFORM_BYVAL_8,				/* pass-by-value, 8 bytes */
+	DEFORM_BYREF,				/* pass-by-reference, fixed length */
+	DEFORM_VARLENA,				/* varlena */
+	DEFORM_CSTRING				/* null-terminated C string */
+} DeformKind;
+
+typedef struct TupleDeformStep
+{
+	uint8		kind;			/* a DeformKind */
+	uint8		alignto;		/* required alignment, in bytes */
+	int16		attlen;			/* attribute length, as in pg_attribute */
+	int32		fixedoff;		/* offset if known in advance, else -1 */
+} TupleDeformStep;
+
+typedef struct TupleDeformProgram
+{
+	TupleDesc	tupdesc;		/* descriptor this was built for */
+	int			natts;			/* number of steps */
+	int			nfixed;			/* # of leading fixed-length attributes
+								 * with known offsets */
+	TupleDeformStep steps[FLEXIBLE_ARRAY_MEMBER];
+} TupleDeformProgram;
+
+/*
+ * Build the deform program for the slot's current descriptor, in the slot's
+ * memory context.
+ *
+ * The known offsets are the same ones that heap_deform_tuple() and
+ * nocachegetattr() store in attcacheoff; we set those too while at it.
+ */
+static TupleDeformProgram *
+slot_build_deform_program(TupleTableSlot *slot)
+{
+	TupleDesc	tupleDesc = slot->tts_tupleDescriptor;
+	TupleDeformProgram *prog;
+	int			natts = tupleDesc->natts;
+	int32		off = 0;
+	bool		known = true;
+
+	prog = MemoryContextAlloc(slot->tts_mcxt,
+							  offsetof(TupleDeformProgram, steps) +
+							  natts * sizeof(TupleDeformStep));
+	prog->tupdesc = tupleDesc;
+	prog->natts = natts;
+	prog->nfixed = 0;
+
+	for (int attnum = 0; attnum < natts; attnum++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupleDesc, attnum);
+		TupleDeformStep *step = &prog->steps[attnum];
+
+		step->attlen = att->attlen;
+
+		switch (att->attalign)
+		{
+			case TYPALIGN_INT:
+				step->alignto = ALIGNOF_INT;
+				break;
+			case TYPALIGN_CHAR:
+				step->alignto = 1;
+				break;
+			case TYPALIGN_DOUBLE:
+				step->alignto = ALIGNOF_DOUBLE;
+				break;
+			case TYPALIGN_SHORT:
+				step->alignto = ALIGNOF_SHORT;
+				break;
+			default:
+				elog(ERROR, "unsupported alignment %c", att->attalign);
+		}
+
+		if (att->attlen == -1)
+			step->kind = DEFORM_VARLENA;
+		else if (att->attlen == -2)
+			step->kind = DEFORM_CSTRING;
+		else if (!att->attbyval)
+			step->kind = DEFORM_BYREF;
+		else
+		{
+			switch (att->attlen)
+			{
+				case sizeof(char):
+					step->kind = DEFORM_BYVAL_1;
+					break;
+				case sizeof(int16):
+					step->kind = DEFORM_BYVAL_2;
+					break;
+				case sizeof(int32):
+					step->kind = DEFORM_BYVAL_4;
+					break;
+#if SIZEOF_DATUM == 8
+				case sizeof(Datum):
+					step->kind = DEFORM_BYVAL_8;
+					break;
+#endif
+				default:
+					elog(ERROR, "unsupported byval length: %d",
+						 (int) att->attlen);
+			}
+		}
+
+		/*
+		 * Compute the offset if all preceding attributes are present and
+		 * have a fixed length.  We can only know the offset of a varlena
+		 * attribute if it is already suitably aligned, so that there would
+		 * be no pad bytes in any case: then the offset will be valid for
+		 * either an aligned or unaligned value.
+		 */
+		step->fixedoff = -1;
+		if (known)
+		{
+			if (att->attlen == -1 && off != TYPEALIGN(step->alignto, off))
+				known = false;
+			else
+			{
+				off = TYPEALIGN(step->alignto, off);
+				step->fixedoff = off;
+				att->attcacheoff = off;
+				if (att->attlen > 0)
+				{
+					off += att->attlen;
+					if (prog->nfixed == attnum)
+						prog->nfixed++;
+				}
+				else
+					known = false;
+			}
+		}
+	}
+
+	return prog;
+}
+
+/*
+ * Fetch the value of the attribute described by step, stored at tp + off,
+ * and return the offset just past it.
+ */
+static pg_attribute_always_inline uint32
+slot_deform_fetch(const TupleDeformStep *step, char *tp, uint32 off,
+				  Datum *value)
+{
+	char	   *attptr = tp + off;
+
+	switch ((DeformKind) step->kind)
+	{
+		case DEFORM_BYVAL_1:
+			*value = CharGetDatum(*((char *) attptr));
+			return off + 1;
+		case DEFORM_BYVAL_2:
+			*value = Int16GetDatum(*((int16 *) attptr));
+			return off + 2;
+		case DEFORM_BYVAL_4:
+			*value = Int32GetDatum(*((int32 *) attptr));
+			return off + 4;
+		case DEFORM_BYVAL_8:
+			*value = *((Datum *) attptr);
+			return off + 8;
+		case DEFORM_BYREF:
+			*value = PointerGetDatum(attptr);
+			return off + step->attlen;
+		case DEFORM_VARLENA:
+			*value = PointerGetDatum(attptr);
+			return off + VARSIZE_ANY(attptr);
+		case DEFORM_CSTRING:
+			*value = PointerGetDatum(attptr);
+			return off + strlen(attptr) + 1;
+	}
+
+	pg_unreachable();
+	return off;
+}
+
 /*
  * slot_deform_heap_tuple
  *		Given a TupleTableSlot, extract data from the slot's physical tuple
@@ -918,6 +1103,9 @@ tts_buffer_heap_store_tuple(TupleTableSlot *slot, HeapTuple tuple,
  *		re-computing information about previously extracted attributes.
  *		slot->tts_nvalid is the number of attributes already extracted.
  *
+ *		The work is driven by the slot's deform program, which is built on
+ *		first use.
+ *
  * This is marked as always inline, so the different offp for different types
  * of slots gets optimized away.
  */
@@ -925,16 +1113,23 @@ static pg_attribute_always_inline void
 slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 					   int natts)
 {
-	TupleDesc	tupleDesc = slot->tts_tupleDescriptor;
 	Datum	   *values = slot->tts_values;
 	bool	   *isnull = slot->tts_isnull;
 	HeapTupleHeader tup = tuple->t_data;
 	bool		hasnulls = HeapTupleHasNulls(tuple);
+	TupleDeformProgram *prog = slot->tts_deform;
 	int			attnum;
 	char	   *tp;				/* ptr to tuple data */
 	uint32		off;			/* offset in tuple data */
 	bits8	   *bp = tup->t_bits;	/* ptr to null bitmap in tuple */
-	bool		slow;			/* can we use/set attcacheoff? */
+	bool		slow;			/* can we use the known offsets? */
+
+	if (unlikely(prog == NULL))
+	{
+		prog = slot_build_deform_program(slot);
+		slot->tts_deform = prog;
+	}
+	Assert(prog->tupdesc == slot->tts_tupleDescriptor);
 
 	/* We can only fetch as many attributes as the tuple has. */
 	natts = Min(HeapTupleHeaderGetNatts(tuple->t_data), natts);
@@ -959,55 +1154,54 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 
 	tp = (char *) tup + tup->t_hoff;
 
+	/*
+	 * Without nulls, the leading fixed-length attributes are at known
+	 * offsets, and can be fetched without any further computation.
+	 */
+	if (!hasnulls && !slow && attnum < prog->nfixed)
+	{
+		int			lastfixed = Min(natts, prog->nfixed);
+
+		for (; attnum < lastfixed; attnum++)
+		{
+			const TupleDeformStep *step = &prog->steps[attnum];
+
+			isnull[attnum] = false;
+			off = slot_deform_fetch(step, tp, step->fixedoff,
+									&values[attnum]);
+		}
+	}
+
 	for (; attnum < natts; attnum++)
 	{
-		Form_pg_attribute thisatt = TupleDescAttr(tupleDesc, attnum);
+		const TupleDeformStep *step = &prog->steps[attnum];
 
 		if (hasnulls && att_isnull(attnum, bp))
 		{
 			values[attnum] = (Datum) 0;
 			isnull[attnum] = true;
-			slow = true;		/* can't use attcacheoff anymore */
+			slow = true;		/* can't use known offsets anymore */
 			continue;
 		}
 
 		isnull[attnum] = false;
 
-		if (!slow && thisatt->attcacheoff >= 0)
-			off = thisatt->attcacheoff;
-		else if (thisatt->attlen == -1)
+		if (!slow && step->fixedoff >= 0)
+			off = step->fixedoff;
+		else if (step->kind == DEFORM_VARLENA)
 		{
-			/*
-			 * We can only cache the offset for a varlena attribute if the
-			 * offset is already suitably aligned, so that there would be no
-			 * pad bytes in any case: then the offset will be valid for either
-			 * an aligned or unaligned value.
-			 */
-			if (!slow &&
-				off == att_align_nominal(off, thisatt->attalign))
-				thisatt->attcacheoff = off;
-			else
-			{
-				off = att_align_pointer(off, thisatt->attalign, -1,
-										tp + off);
-				slow = true;
-			}
+			/* as in att_align_pointer() */
+			if (!VARATT_NOT_PAD_BYTE(tp + off))
+				off = TYPEALIGN(step->alignto, off);
+			slow = true;
 		}
 		else
-		{
-			/* not varlena, so safe to use att_align_nominal */
-			off = att_align_nominal(off, thisatt->attalign);
-
-			if (!slow)
-				thisatt->attcacheoff = off;
-		}
-
-		values[attnum] = fetchatt(thisatt, tp + off);
+			off = TYPEALIGN(step->alignto, off);
 
-		off = att_addlength_pointer(off, thisatt->attlen, tp + off);
+		off = slot_deform_fetch(step, tp, off, &values[attnum]);
 
-		if (thisatt->attlen <= 0)
-			slow = true;		/* can't use attcacheoff anymore */
+		if (step->attlen <= 0)
+			slow = true;		/* can't use known offsets anymore */
 	}
 
 	/*
@@ -1209,6 +1403,8 @@ ExecResetTupleTable(List *tupleTable,	/* tuple table */
 		/* If shouldFree, release memory occupied by the slot itself */
 		if (shouldFree)
 		{
+			if (slot->tts_deform)
+				pfree(slot->tts_deform);
 			if (!TTS_FIXED(slot))
 			{
 				if (slot->tts_values)
@@ -1259,6 +1455,8 @@ ExecDropSingleTupleTableSlot(TupleTableSlot *slot)
 	slot->tts_ops->release(slot);
 	if (slot->tts_tupleDescriptor)
 		ReleaseTupleDesc(slot->tts_tupleDescriptor);
+	if (slot->tts_deform)
+		pfree(slot->tts_deform);
 	if (!TTS_FIXED(slot))
 	{
 		if (slot->tts_values)
@@ -1305,6 +1503,11 @@ ExecSetSlotDescriptor(TupleTableSlot *slot, /* slot to change */
 		pfree(slot->tts_values);
 	if (slot->tts_isnull)
 		pfree(slot->tts_isnull);
+	if (slot->tts_deform)
+	{
+		pfree(slot->tts_deform);
+		slot->tts_deform = NULL;
+	}
 
 	/*
 	 * Install the new descriptor; if it's refcounted, bump its refcount.
@@ -21,9 +21,11 @@ BufferUsage pgBufferUsage;
 static BufferUsage save_pgBufferUsage;
 WalUsage	pgWalUsage;
 static WalUsage save_pgWalUsage;
+WaitUsage	pgWaitUsage;
 
 static void BufferUsageAdd(BufferUsage *dst, const BufferUsage *add);
 static void WalUsageAdd(WalUsage *dst, WalUsage *add);
+static void WaitUsageAdd(WaitUsage *dst, const WaitUsage *add);
 
 
 /* Allocate new instrumentation structure(s) */
@@ -34,10 +36,12 @@ InstrAlloc(int n, int instrument_options, bool async_mode)
 
 	/* initialize all fields to zeroes, then modify as needed */
 	instr = palloc0(n * sizeof(Instrumentation));
-	if (instrument_options & (INSTRUMENT_BUFFERS | INSTRUMENT_TIMER | INSTRUMENT_WAL))
+	if (instrument_options & (INSTRUMENT_BUFFERS | INSTRUMENT_TIMER |
+							  INSTRUMENT_WAL | INSTRUMENT_WAITS))
 	{
 		bool		need_buffers = (instrument_options & INSTRUMENT_BUFFERS) != 0;
 		bool		need_wal = (instrument_options & INSTRUMENT_WAL) != 0;
+		bool		need_waits = (instrument_options & INSTRUMENT_WAITS) != 0;
 		bool		need_timer = (instrument_options & INSTRUMENT_TIMER) != 0;
 		int			i;
 
@@ -45,6 +49,7 @@ InstrAlloc(int n, int instrument_options, bool async_mode)
 		{
 			instr[i].need_bufusage = need_buffers;
 			instr[i].need_walusage = need_wal;
+			instr[i].need_waitusage = need_waits;
 			instr[i].need_timer = need_timer;
 			instr[i].async_mode = async_mode;
 		}
@@ -60,6 +65,7 @@ InstrInit(Instrumentation *instr, int instrument_options)
 	memset(instr, 0, sizeof(Instrumentation));
 	instr->need_bufusage = (instrument_options & INSTRUMENT_BUFFERS) != 0;
 	instr->need_walusage = (instrument_options & INSTRUMENT_WAL) != 0;
+	instr->need_waitusage = (instrument_options & INSTRUMENT_WAITS) != 0;
 	instr->need_timer = (instrument_options & INSTRUMENT_TIMER) != 0;
 }
 
@@ -77,6 +83,9 @@ InstrStartNode(Instrumentation *instr)
 
 	if (instr->need_walusage)
 		instr->walusage_start = pgWalUsage;
+
+	if (instr->need_waitusage)
+		instr->waitusage_start = pgWaitUsage;
 }
 
 /* Exit from a plan node */
@@ -110,6 +119,10 @@ InstrStopNode(Instrumentation *instr, double nTuples)
 		WalUsageAccumDiff(&instr->walusage,
 						  &pgWalUsage, &instr->walusage_start);
 
+	if (instr->need_waitusage)
+		WaitUsageAccumDiff(&instr->waitusage,
+						   &pgWaitUsage, &instr->waitusage_start);
+
 	/* Is this the first tuple of this cycle? */
 	if (!instr->running)
 	{
@@ -193,6 +206,9 @@ InstrAggNode(Instrumentation *dst, Instrumentation *add)
 
 	if (dst->need_walusage)
 		WalUsageAdd(&dst->walusage, &add->walusage);
+
+	if (dst->need_waitusage)
+		WaitUsageAdd(&dst->waitusage, &add->waitusage);
 }
 
 /* note current values during parallel executor startup */
@@ -283,3 +299,19 @@ WalUsageAccumDiff(WalUsage *dst, const WalUsage *add, const WalUsage *sub)
 	dst->wal_records += add->wal_records - sub->wal_records;
 	dst->wal_fpi += add->wal_fpi - sub->wal_fpi;
 }
+
+/* helper functions for wait usage accumulation */
+static void
+WaitUsageAdd(WaitUsage *dst, const WaitUsage *add)
+{
+	for (int i = 0; i < WAIT_USAGE_NUM_CLASSES; i++)
+		INSTR_TIME_ADD(dst->wait_time[i], add->wait_time[i]);
+}
+
+void
+WaitUsageAccumDiff(WaitUsage *dst, const WaitUsage *add, const WaitUsage *sub)
+{
+	for (int i = 0; i < WAIT_USAGE_NUM_CLASSES; i++)
+		INSTR_TIME_ACCUM_DIFF(dst->wait_time[i],
+							  add->wait_time[i], sub->wait_time[i]);
+}
@@ -192,7 +192,11 @@
  *	  set in the largest rollup that we're going to process, and use the
  *	  per-tuple memory context of those ExprContexts to store the aggregate
  *	  transition values.  hashcontext is the single context created to support
- *	  all hash tables.
+ *	  the transition values of all hash tables, and hash_tablecxt holds the
+ *	  entries of all hash tables: their group keys and per-group state arrays.
+ *	  Those are only ever freed all at once, so hash_tablecxt is a bump
+ *	  context, which saves the chunk header that each entry would otherwise
+ *	  need.
  *
  *	  Spilling To Disk
  *
@@ -226,6 +230,28 @@
  *	  imposing a limit on the number of groups separately from the amount of
  *	  memory consumed.
  *
+ *	  Parallel HashAgg
+ *
+ *	  A parallel-aware AGG_HASHED node computes complete groups below a
+ *	  Gather, without needing partial and finalize steps (and so also for
+ *	  aggregates that have no combine function).  This works in two phases,
+ *	  coordinated by a barrier in the DSM segment: first, each participant
+ *	  reads its share of the input and writes every tuple to one of a
+ *	  power-of-two number of shared partitions, chosen by the high bits of the
+ *	  tuple's hash value (see agg_partition_parallel_input()).  Once all
+ *	  participants are done writing, they claim the partitions one at a time,
+ *	  and each partition is aggregated by the participant that claimed it
+ *	  (see agg_refill_hash_table_parallel()).  Since all tuples of a group
+ *	  land in the same partition, each group is completed by exactly one
+ *	  participant.  A partition whose groups don't fit in hash_mem is spilled
+ *	  to local batches, using the hash bits below the ones already used for
+ *	  partition selection, and those are processed before claiming the next
+ *	  partition.
+ *
+ *	  No tuples are emitted before the input is partitioned, so a leader
+ *	  waiting for the workers to finish writing cannot block workers that
+ *	  wait for the leader to read their output.
+ *
  *    Transition / Combine function invocation:
  *
  *    For performance reasons transition functions, including combine
@@ -258,6 +284,7 @@
 #include "executor/execExpr.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
+#include "executor/tuplebatch.h"
 #include "lib/hyperloglog.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
@@ -265,6 +292,8 @@
 #include "optimizer/optimizer.h"
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
+#include "port/pg_bitutils.h"
+#include "storage/barrier.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
@@ -273,8 +302,10 @@
 #include "utils/logtape.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/sharedtuplestore.h"
 #include "utils/syscache.h"
 #include "utils/tuplesort.h"
+#include "utils/wait_event.h"
 
 /*
  * Control how many partitions are created when spilling HashAgg to
@@ -357,6 +388,47 @@ typedef struct HashAggBatch
 	double		input_card;		/* estimated group cardinality */
 } HashAggBatch;
 
+/*
+ * Key under which the shared state of a Parallel HashAgg is stored in the
+ * DSM segment's table of contents.  The plain plan node ID is already used
+ * for the shared instrumentation.
+ */
+#define PARALLEL_KEY_HASHAGG(plan_node_id) \
+	(UINT64CONST(0xD000000000000000) | (plan_node_id))
+
+/*
+ * A Parallel HashAgg creates at least this many shared partitions per
+ * participant, so that participants finishing early can pick up more work.
+ * Each participant needs a write buffer of HASHAGG_PARALLEL_BUFFER_SIZE
+ * (the chunk size of sharedtuplestore.c) for each partition.
+ */
+#define HASHAGG_PARALLEL_PARTITIONS_PER_PARTICIPANT 4
+#define HASHAGG_PARALLEL_BUFFER_SIZE (4 * BLCKSZ)
+
+/* Phases of a Parallel HashAgg's barrier */
+#define PHA_PARTITIONING	0
+#define PHA_AGGREGATING		1
+
+/*
+ * Shared state of a Parallel HashAgg, stored in the DSM segment.  It's
+ * followed by the partitions' SharedTuplestores, which store each input
+ * tuple together with its hash value.
+ */
+typedef struct ParallelHashAggState
+{
+	Barrier		barrier;		/* see PHA_* phases above */
+	pg_atomic_uint32 next_partition;	/* next partition to be claimed */
+	int			nparticipants;	/* maximum number of participants */
+	int			npartitions;	/* number of partitions, a power of 2 */
+	int			partition_bits; /* log2(npartitions) */
+	SharedFileSet fileset;		/* space for the partitions' files */
+} ParallelHashAggState;
+
+#define ParallelHashAggPartition(pstate, i) \
+	((SharedTuplestore *) \
+	 ((char *) (pstate) + MAXALIGN(sizeof(ParallelHashAggState)) + \
+	  (i) * MAXALIGN(sts_estimate((pstate)->nparticipants))))
+
 /* used to find referenced colnos */
 typedef struct FindColsContext
 {
@@ -419,6 +491,8 @@ static void lookup_hash_entries(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
 static bool agg_refill_hash_table(AggState *aggstate);
+static void agg_partition_parallel_input(AggState *aggstate);
+static bool agg_refill_hash_table_parallel(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table_in_memory(AggState *aggstate);
 static void hash_agg_check_limits(AggState *aggstate);
@@ -434,6 +508,8 @@ static MinimalTuple hashagg_batch_read(HashAggBatch *batch, uint32 *hashp);
 static void hashagg_spill_init(HashAggSpill *spill, LogicalTapeSet *tapeset,
 							   int used_bits, double input_groups,
 							   double hashentrysize);
+static TupleTableSlot *hashagg_spill_slot(AggState *aggstate,
+										  TupleTableSlot *inputslot);
 static Size hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
 								TupleTableSlot *inputslot, uint32 hash);
 static void hashagg_spill_finish(AggState *aggstate, HashAggSpill *spill,
@@ -558,6 +634,30 @@ fetch_input_tuple(AggState *aggstate)
 			return NULL;
 		slot = aggstate->sort_slot;
 	}
+	else if (aggstate->input_batch)
+	{
+		TupleBatch *batch = aggstate->input_batch;
+
+		/* Fetch the next batch from the outer plan, if needed */
+		if (aggstate->input_batch_next >= batch->nrows)
+		{
+			/*
+			 * A short batch means the outer plan has no more tuples; don't
+			 * ask it again, as it might restart from the beginning.
+			 */
+			if (aggstate->input_batch_done)
+				return NULL;
+			CHECK_FOR_INTERRUPTS();
+			if (ExecProcNodeBatch(outerPlanState(aggstate), batch) <
+				batch->maxrows)
+				aggstate->input_batch_done = true;
+			aggstate->input_batch_next = 0;
+			if (batch->nrows == 0)
+				return NULL;
+		}
+		slot = ExecStoreBatchRow(batch, aggstate->input_batch_next++,
+								 aggstate->input_batch_slot);
+	}
 	else
 		slot = ExecProcNode(outerPlanState(aggstate));
 
@@ -1453,9 +1553,10 @@ find_cols_walker(Node *node, FindColsContext *context)
  * We have a separate hashtable and associated perhash data structure for each
  * grouping set for which we're doing hashing.
  *
- * The contents of the hash tables always live in the hashcontext's per-tuple
- * memory context (there is only one of these for all tables together, since
- * they are all reset at the same time).
+ * The entries of the hash tables always live in hash_tablecxt, and their
+ * transition values in the hashcontext's per-tuple memory context (there is
+ * only one of each for all tables together, since they are all reset at the
+ * same time).
  */
 static void
 build_hash_tables(AggState *aggstate)
@@ -1497,7 +1598,7 @@ build_hash_table(AggState *aggstate, int setno, long nbuckets)
 {
 	AggStatePerHash perhash = &aggstate->perhash[setno];
 	MemoryContext metacxt = aggstate->hash_metacxt;
-	MemoryContext hashcxt = aggstate->hashcontext->ecxt_per_tuple_memory;
+	MemoryContext tablecxt = aggstate->hash_tablecxt;
 	MemoryContext tmpcxt = aggstate->tmpcontext->ecxt_per_tuple_memory;
 	Size		additionalsize;
 
@@ -1522,7 +1623,7 @@ build_hash_table(AggState *aggstate, int setno, long nbuckets)
 												nbuckets,
 												additionalsize,
 												metacxt,
-												hashcxt,
+												tablecxt,
 												tmpcxt,
 												DO_AGGSPLIT_SKIPFINAL(aggstate->aggsplit));
 }
@@ -1693,12 +1794,12 @@ hash_agg_entry_size(int numTrans, Size tupleWidth, Size transitionSpace)
 							 tupleWidth);
 	Size		pergroupSize = numTrans * sizeof(AggStatePerGroupData);
 
-	tupleChunkSize = CHUNKHDRSZ + tupleSize;
-
-	if (pergroupSize > 0)
-		pergroupChunkSize = CHUNKHDRSZ + pergroupSize;
-	else
-		pergroupChunkSize = 0;
+	/*
+	 * Entries use the bump allocator, so the chunk sizes are the same as the
+	 * requested sizes.
+	 */
+	tupleChunkSize = MAXALIGN(tupleSize);
+	pergroupChunkSize = pergroupSize;
 
 	if (transitionSpace > 0)
 		transitionChunkSize = CHUNKHDRSZ + transitionSpace;
@@ -1851,15 +1952,18 @@ hash_agg_check_limits(AggState *aggstate)
 	uint64		ngroups = aggstate->hash_ngroups_current;
 	Size		meta_mem = MemoryContextMemAllocated(aggstate->hash_metacxt,
 													 true);
-	Size		hashkey_mem = MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory,
-														true);
+	Size		entry_mem = MemoryContextMemAllocated(aggstate->hash_tablecxt,
+													  true);
+	Size		tval_mem = MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory,
+													 true);
+	Size		total_mem = meta_mem + entry_mem + tval_mem;
 
 	/*
 	 * Don't spill unless there's at least one group in the hash table so we
 	 * can be sure to make progress even in edge cases.
 	 */
 	if (aggstate->hash_ngroups_current > 0 &&
-		(meta_mem + hashkey_mem > aggstate->hash_mem_limit ||
+		(total_mem > aggstate->hash_mem_limit ||
 		 ngroups > aggstate->hash_ngroups_limit))
 	{
 		hash_agg_enter_spill_mode(aggstate);
@@ -1910,6 +2014,7 @@ static void
 hash_agg_update_metrics(AggState *aggstate, bool from_tape, int npartitions)
 {
 	Size		meta_mem;
+	Size		entry_mem;
 	Size		hashkey_mem;
 	Size		buffer_mem;
 	Size		total_mem;
@@ -1921,8 +2026,12 @@ hash_agg_update_metrics(AggState *aggstate, bool from_tape, int npartitions)
 	/* memory for the hash table itself */
 	meta_mem = MemoryContextMemAllocated(aggstate->hash_metacxt, true);
 
+	/* memory for hash entries */
+	entry_mem = MemoryContextMemAllocated(aggstate->hash_tablecxt, true);
+
 	/* memory for the group keys and transition states */
-	hashkey_mem = MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory, true);
+	hashkey_mem = entry_mem +
+		MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory, true);
 
 	/* memory for read/write tape buffers, if spilled */
 	buffer_mem = npartitions * HASHAGG_WRITE_BUFFER_SIZE;
@@ -2535,6 +2644,22 @@ agg_fill_hash_table(AggState *aggstate)
 	TupleTableSlot *outerslot;
 	ExprContext *tmpcontext = aggstate->tmpcontext;
 
+	/*
+	 * In a Parallel HashAgg, the input is only partitioned here.  The hash
+	 * table stays empty until agg_refill_hash_table_parallel() loads the
+	 * first partition this participant claims.
+	 */
+	if (aggstate->phash_state != NULL)
+	{
+		agg_partition_parallel_input(aggstate);
+
+		aggstate->table_filled = true;
+		select_current_set(aggstate, 0, true);
+		ResetTupleHashIterator(aggstate->perhash[0].hashtable,
+							   &aggstate->perhash[0].hashiter);
+		return;
+	}
+
 	/*
 	 * Process each outer-plan tuple, and then fetch the next one, until we
 	 * exhaust the outer plan.
@@ -2615,6 +2740,7 @@ agg_refill_hash_table(AggState *aggstate)
 
 	/* free memory and reset hash tables */
 	ReScanExprContext(aggstate->hashcontext);
+	MemoryContextReset(aggstate->hash_tablecxt);
 	for (int setno = 0; setno < aggstate->num_hashes; setno++)
 		ResetTupleHashTable(aggstate->perhash[setno].hashtable);
 
@@ -2728,11 +2854,191 @@ agg_refill_hash_table(AggState *aggstate)
 	return true;
 }
 
+/*
+ * agg_partition_parallel_input
+ *
+ * First phase of a Parallel HashAgg: write this participant's share of the
+ * input to the shared partitions, and wait for all other participants to do
+ * the same.
+ */
+static void
+agg_partition_parallel_input(AggState *aggstate)
+{
+	ParallelHashAggState *pstate = aggstate->phash_state;
+	AggStatePerHash perhash = &aggstate->perhash[0];
+	int			shift = 32 - pstate->partition_bits;
+
+	/*
+	 * If the other participants have already partitioned all of the input,
+	 * there's nothing left for us to read: like Parallel Hash Join, we rely
+	 * on our input being a partial plan whose shared scans are exhausted by
+	 * then.
+	 */
+	if (BarrierAttach(&pstate->barrier) == PHA_PARTITIONING)
+	{
+		for (;;)
+		{
+			TupleTableSlot *outerslot;
+			TupleTableSlot *spillslot;
+			MinimalTuple tuple;
+			bool		shouldFree;
+			uint32		hash;
+
+			outerslot = fetch_input_tuple(aggstate);
+			if (TupIsNull(outerslot))
+				break;
+
+			prepare_hash_slot(perhash, outerslot, perhash->hashslot);
+			hash = TupleHashTableHash(perhash->hashtable, perhash->hashslot);
+
+			spillslot = hashagg_spill_slot(aggstate, outerslot);
+			tuple = ExecFetchSlotMinimalTuple(spillslot, &shouldFree);
+			sts_puttuple(aggstate->phash_partitions[hash >> shift],
+						 &hash, tuple);
+			if (shouldFree)
+				pfree(tuple);
+
+			ResetExprContext(aggstate->tmpcontext);
+		}
+
+		for (int i = 0; i < pstate->npartitions; i++)
+			sts_end_write(aggstate->phash_partitions[i]);
+
+		BarrierArriveAndWait(&pstate->barrier,
+							 WAIT_EVENT_HASH_AGG_PARTITION);
+	}
+	BarrierDetach(&pstate->barrier);
+
+	/*
+	 * Groups of a partition that don't fit in memory are spilled to local
+	 * batches; set that up now, so that hash_agg_enter_spill_mode() doesn't
+	 * prepare spilling for the (already consumed) outer plan.
+	 */
+	Assert(aggstate->hash_tapeset == NULL);
+	aggstate->hash_tapeset = LogicalTapeSetCreate(true, NULL, -1);
+	aggstate->hash_ever_spilled = true;
+}
+
+/*
+ * agg_refill_hash_table_parallel
+ *
+ * Second phase of a Parallel HashAgg: claim the next shared partition that
+ * nobody has aggregated yet, and load it into the hash table.  This works
+ * like agg_refill_hash_table(), except that the tuples are read from the
+ * shared partition.  Any groups that don't fit are spilled to local
+ * batches, which are processed before the next partition is claimed.
+ *
+ * Return false when all partitions have been claimed; otherwise return true.
+ */
+static bool
+agg_refill_hash_table_parallel(AggState *aggstate)
+{
+	ParallelHashAggState *pstate = aggstate->phash_state;
+	AggStatePerHash perhash = &aggstate->perhash[0];
+	SharedTuplestoreAccessor *accessor;
+	HashAggSpill spill;
+	bool		spill_initialized = false;
+	double		input_groups;
+	uint32		partno;
+
+	Assert(aggstate->hash_batches == NIL);
+
+	partno = pg_atomic_fetch_add_u32(&pstate->next_partition, 1);
+	if (partno >= pstate->npartitions)
+		return false;
+	accessor = aggstate->phash_partitions[partno];
+
+	/* the planner's estimate of the number of groups is per participant */
+	input_groups = perhash->aggnode->numGroups *
+		(double) pstate->nparticipants / pstate->npartitions;
+	hash_agg_set_limits(aggstate->hashentrysize, input_groups,
+						pstate->partition_bits, &aggstate->hash_mem_limit,
+						&aggstate->hash_ngroups_limit, NULL);
+
+	/* free memory and reset hash table */
+	ReScanExprContext(aggstate->hashcontext);
+	MemoryContextReset(aggstate->hash_tablecxt);
+	ResetTupleHashTable(perhash->hashtable);
+	aggstate->hash_ngroups_current = 0;
+
+	select_current_set(aggstate, 0, true);
+
+	/* Partitioned tuples are read back as MinimalTuples, too */
+	hashagg_recompile_expressions(aggstate, true, true);
+
+	sts_begin_parallel_scan(accessor);
+	for (;;)
+	{
+		TupleTableSlot *spillslot = aggstate->hash_spill_rslot;
+		TupleTableSlot *hashslot = perhash->hashslot;
+		TupleHashEntry entry;
+		MinimalTuple tuple;
+		uint32		hash;
+		bool		isnew = false;
+		bool	   *p_isnew = aggstate->hash_spill_mode ? NULL : &isnew;
+
+		CHECK_FOR_INTERRUPTS();
+
+		tuple = sts_parallel_scan_next(accessor, &hash);
+		if (tuple == NULL)
+			break;
+
+		ExecStoreMinimalTuple(tuple, spillslot, false);
+		aggstate->tmpcontext->ecxt_outertuple = spillslot;
+
+		prepare_hash_slot(perhash, spillslot, hashslot);
+		entry = LookupTupleHashEntryHash(perhash->hashtable, hashslot,
+										 p_isnew, hash);
+
+		if (entry != NULL)
+		{
+			if (isnew)
+				initialize_hash_entry(aggstate, perhash->hashtable, entry);
+			aggstate->hash_pergroup[0] = entry->additional;
+			advance_aggregates(aggstate);
+		}
+		else
+		{
+			if (!spill_initialized)
+			{
+				spill_initialized = true;
+				hashagg_spill_init(&spill, aggstate->hash_tapeset,
+								   pstate->partition_bits, input_groups,
+								   aggstate->hashentrysize);
+			}
+			/* no memory for a new group, spill */
+			hashagg_spill_tuple(aggstate, &spill, spillslot, hash);
+
+			aggstate->hash_pergroup[0] = NULL;
+		}
+
+		ResetExprContext(aggstate->tmpcontext);
+	}
+	sts_end_parallel_scan(accessor);
+
+	if (spill_initialized)
+	{
+		hashagg_spill_finish(aggstate, &spill, 0);
+		hash_agg_update_metrics(aggstate, true, spill.npartitions);
+	}
+	else
+		hash_agg_update_metrics(aggstate, true, 0);
+
+	aggstate->hash_spill_mode = false;
+
+	/* prepare to walk the hash table */
+	select_current_set(aggstate, 0, true);
+	ResetTupleHashIterator(perhash->hashtable, &perhash->hashiter);
+
+	return true;
+}
+
 /*
  * ExecAgg for hashed case: retrieving groups from hash table
  *
  * After exhausting in-memory tuples, also try refilling the hash table using
- * previously-spilled tuples. Only returns NULL after all in-memory and
+ * previously-spilled tuples, and in a Parallel HashAgg, using the shared
+ * partitions of the input.  Only returns NULL after all in-memory and
  * spilled tuples are exhausted.
  */
 static TupleTableSlot *
@@ -2745,7 +3051,9 @@ agg_retrieve_hash_table(AggState *aggstate)
 		result = agg_retrieve_hash_table_in_memory(aggstate);
 		if (result == NULL)
 		{
-			if (!agg_refill_hash_table(aggstate))
+			if (!agg_refill_hash_table(aggstate) &&
+				(aggstate->phash_state == NULL ||
+				 !agg_refill_hash_table_parallel(aggstate)))
 			{
 				aggstate->agg_done = true;
 				break;
@@ -2908,6 +3216,36 @@ hashagg_spill_init(HashAggSpill *spill, LogicalTapeSet *tapeset, int used_bits,
 		initHyperLogLog(&spill->hll_card[i], HASHAGG_HLL_BIT_WIDTH);
 }
 
+/*
+ * hashagg_spill_slot
+ *
+ * Return a slot holding only the attributes of inputslot that we actually
+ * need, for writing to a spill file.  That may be inputslot itself.
+ */
+static TupleTableSlot *
+hashagg_spill_slot(AggState *aggstate, TupleTableSlot *inputslot)
+{
+	TupleTableSlot *spillslot;
+
+	if (aggstate->all_cols_needed)
+		return inputslot;
+
+	spillslot = aggstate->hash_spill_wslot;
+	slot_getsomeattrs(inputslot, aggstate->max_colno_needed);
+	ExecClearTuple(spillslot);
+	for (int i = 0; i < spillslot->tts_tupleDescriptor->natts; i++)
+	{
+		if (bms_is_member(i + 1, aggstate->colnos_needed))
+		{
+			spillslot->tts_values[i] = inputslot->tts_values[i];
+			spillslot->tts_isnull[i] = inputslot->tts_isnull[i];
+		}
+		else
+			spillslot->tts_isnull[i] = true;
+	}
+	return ExecStoreVirtualTuple(spillslot);
+}
+
 /*
  * hashagg_spill_tuple
  *
@@ -2928,25 +3266,7 @@ hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
 	Assert(spill->partitions != NULL);
 
 	/* spill only attributes that we actually need */
-	if (!aggstate->all_cols_needed)
-	{
-		spillslot = aggstate->hash_spill_wslot;
-		slot_getsomeattrs(inputslot, aggstate->max_colno_needed);
-		ExecClearTuple(spillslot);
-		for (int i = 0; i < spillslot->tts_tupleDescriptor->natts; i++)
-		{
-			if (bms_is_member(i + 1, aggstate->colnos_needed))
-			{
-				spillslot->tts_values[i] = inputslot->tts_values[i];
-				spillslot->tts_isnull[i] = inputslot->tts_isnull[i];
-			}
-			else
-				spillslot->tts_isnull[i] = true;
-		}
-		ExecStoreVirtualTuple(spillslot);
-	}
-	else
-		spillslot = inputslot;
+	spillslot = hashagg_spill_slot(aggstate, inputslot);
 
 	tuple = ExecFetchSlotMinimalTuple(spillslot, &shouldFree);
 
@@ -3297,12 +3617,31 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	outerPlan = outerPlan(node);
 	outerPlanState(aggstate) = ExecInitNode(outerPlan, estate, eflags);
 
+	/*
+	 * If the outer plan can return batches of tuples, fetch our input that
+	 * way, and pass the tuples on from the batch through a virtual slot.
+	 */
+	if (outerPlanState(aggstate)->ExecProcNodeBatch != NULL)
+	{
+		TupleDesc	outerDesc = ExecGetResultType(outerPlanState(aggstate));
+
+		aggstate->input_batch = MakeTupleBatch(outerDesc, TUPLE_BATCH_ROWS);
+		aggstate->input_batch_slot = ExecInitExtraTupleSlot(estate, outerDesc,
+															&TTSOpsVirtual);
+	}
+
 	/*
 	 * initialize source tuple type.
 	 */
-	aggstate->ss.ps.outerops =
-		ExecGetResultSlotOps(outerPlanState(&aggstate->ss),
-							 &aggstate->ss.ps.outeropsfixed);
+	if (aggstate->input_batch)
+	{
+		aggstate->ss.ps.outerops = &TTSOpsVirtual;
+		aggstate->ss.ps.outeropsfixed = true;
+	}
+	else
+		aggstate->ss.ps.outerops =
+			ExecGetResultSlotOps(outerPlanState(&aggstate->ss),
+								 &aggstate->ss.ps.outeropsfixed);
 	aggstate->ss.ps.outeropsset = true;
 
 	ExecCreateScanSlotFromOuterPlan(estate, &aggstate->ss,
@@ -3580,6 +3919,9 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		aggstate->hash_metacxt = AllocSetContextCreate(aggstate->ss.ps.state->es_query_cxt,
 													   "HashAgg meta context",
 													   ALLOCSET_DEFAULT_SIZES);
+		aggstate->hash_tablecxt = BumpContextCreate(aggstate->ss.ps.state->es_query_cxt,
+													"HashAgg table context",
+													ALLOCSET_DEFAULT_SIZES);
 		aggstate->hash_spill_rslot = ExecInitExtraTupleSlot(estate, scanDesc,
 															&TTSOpsMinimalTuple);
 		aggstate->hash_spill_wslot = ExecInitExtraTupleSlot(estate, scanDesc,
@@ -4331,6 +4673,11 @@ ExecEndAgg(AggState *node)
 		MemoryContextDelete(node->hash_metacxt);
 		node->hash_metacxt = NULL;
 	}
+	if (node->hash_tablecxt != NULL)
+	{
+		MemoryContextDelete(node->hash_tablecxt);
+		node->hash_tablecxt = NULL;
+	}
 
 	for (transno = 0; transno < node->numtrans; transno++)
 	{
@@ -4359,6 +4706,9 @@ ExecEndAgg(AggState *node)
 	/* clean up tuple table */
 	ExecClearTuple(node->ss.ss_ScanTupleSlot);
 
+	if (node->input_batch)
+		FreeTupleBatch(node->input_batch);
+
 	outerPlan = outerPlanState(node);
 	ExecEndNode(outerPlan);
 }
@@ -4403,6 +4753,14 @@ ExecReScanAgg(AggState *node)
 		}
 	}
 
+	/* Forget any remaining tuples of the current input batch */
+	if (node->input_batch)
+	{
+		TupleBatchReset(node->input_batch);
+		node->input_batch_next = 0;
+		node->input_batch_done = false;
+	}
+
 	/* Make sure we have closed any open tuplesorts */
 	for (transno = 0; transno < node->numtrans; transno++)
 	{
@@ -4457,6 +4815,7 @@ ExecReScanAgg(AggState *node)
 		node->hash_ngroups_current = 0;
 
 		ReScanExprContext(node->hashcontext);
+		MemoryContextReset(node->hash_tablecxt);
 		/* Rebuild an empty hash table */
 		build_hash_tables(node);
 		node->table_filled = false;
@@ -4676,10 +5035,89 @@ AggRegisterCallback(FunctionCallInfo fcinfo,
  * ----------------------------------------------------------------
  */
 
+/*
+ * Choose the number of shared partitions for a Parallel HashAgg: enough for
+ * the participants to balance their work, and for the groups of each
+ * partition to fit in hash_mem, as long as the write buffers don't take more
+ * than a quarter of hash_mem.
+ */
+static int
+hashagg_parallel_num_partitions(AggState *node, int nparticipants)
+{
+	Agg		   *aggnode = (Agg *) node->ss.ps.plan;
+	Size		hash_mem_limit = get_hash_memory_limit();
+	double		mem_wanted;
+	int			npartitions;
+	int			max_partitions;
+
+	npartitions = nparticipants * HASHAGG_PARALLEL_PARTITIONS_PER_PARTICIPANT;
+
+	/* the planner's estimate of the number of groups is per participant */
+	mem_wanted = HASHAGG_PARTITION_FACTOR * aggnode->numGroups *
+		nparticipants * node->hashentrysize;
+	if (mem_wanted / hash_mem_limit > npartitions)
+		npartitions = (int) Min(mem_wanted / hash_mem_limit,
+								HASHAGG_MAX_PARTITIONS);
+
+	max_partitions = hash_mem_limit / 4 / HASHAGG_PARALLEL_BUFFER_SIZE;
+	npartitions = Min(npartitions, Max(max_partitions, nparticipants));
+	npartitions = Min(npartitions, HASHAGG_MAX_PARTITIONS);
+
+	return pg_nextpower2_32(Max(npartitions, 2));
+}
+
+/*
+ * Size of the shared state of a Parallel HashAgg, including its partitions.
+ */
+static Size
+hashagg_parallel_state_size(int nparticipants, int npartitions)
+{
+	return add_size(MAXALIGN(sizeof(ParallelHashAggState)),
+					mul_size(npartitions,
+							 MAXALIGN(sts_estimate(nparticipants))));
+}
+
+/*
+ * Initialize the shared partitions of a Parallel HashAgg for writing, in
+ * the leader.
+ */
+static void
+hashagg_parallel_init_partitions(AggState *node)
+{
+	ParallelHashAggState *pstate = node->phash_state;
+
+	for (int i = 0; i < pstate->npartitions; i++)
+	{
+		char		name[MAXPGPATH];
+
+		snprintf(name, sizeof(name), "hashagg%d", i);
+		node->phash_partitions[i] =
+			sts_initialize(ParallelHashAggPartition(pstate, i),
+						   pstate->nparticipants,
+						   0,
+						   sizeof(uint32),
+						   SHARED_TUPLESTORE_SINGLE_PASS,
+						   &pstate->fileset,
+						   name);
+	}
+}
+
+/*
+ * Is this a Parallel HashAgg, as opposed to an Agg that is merely running
+ * in a parallel query?
+ */
+static bool
+hashagg_is_parallel_aware(AggState *node)
+{
+	return node->ss.ps.plan->parallel_aware &&
+		node->aggstrategy == AGG_HASHED;
+}
+
  /* ----------------------------------------------------------------
   *		ExecAggEstimate
   *
-  *		Estimate space required to propagate aggregate statistics.
+  *		Estimate space required to propagate aggregate statistics, and
+  *		for the shared state of a Parallel HashAgg.
   * ----------------------------------------------------------------
   */
 void
@@ -4687,6 +5125,17 @@ ExecAggEstimate(AggState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	if (hashagg_is_parallel_aware(node))
+	{
+		int			nparticipants = pcxt->nworkers + 1;
+
+		size = hashagg_parallel_state_size(nparticipants,
+										   hashagg_parallel_num_partitions(node,
+																		   nparticipants));
+		shm_toc_estimate_chunk(&pcxt->estimator, size);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -4700,7 +5149,8 @@ ExecAggEstimate(AggState *node, ParallelContext *pcxt)
 /* ----------------------------------------------------------------
  *		ExecAggInitializeDSM
  *
- *		Initialize DSM space for aggregate statistics.
+ *		Initialize DSM space for aggregate statistics, and for the
+ *		shared state of a Parallel HashAgg.
  * ----------------------------------------------------------------
  */
 void
@@ -4708,6 +5158,36 @@ ExecAggInitializeDSM(AggState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	/*
+	 * Without a real DSM segment no workers can be launched, and then the
+	 * leader can simply aggregate all of the input by itself, as usual.
+	 */
+	if (hashagg_is_parallel_aware(node) && pcxt->seg != NULL)
+	{
+		ParallelHashAggState *pstate;
+		int			nparticipants = pcxt->nworkers + 1;
+		int			npartitions;
+
+		npartitions = hashagg_parallel_num_partitions(node, nparticipants);
+		pstate = shm_toc_allocate(pcxt->toc,
+								  hashagg_parallel_state_size(nparticipants,
+															  npartitions));
+		BarrierInit(&pstate->barrier, 0);
+		pg_atomic_init_u32(&pstate->next_partition, 0);
+		pstate->nparticipants = nparticipants;
+		pstate->npartitions = npartitions;
+		pstate->partition_bits = pg_leftmost_one_pos32(npartitions);
+		SharedFileSetInit(&pstate->fileset, pcxt->seg);
+		shm_toc_insert(pcxt->toc,
+					   PARALLEL_KEY_HASHAGG(node->ss.ps.plan->plan_node_id),
+					   pstate);
+
+		node->phash_state = pstate;
+		node->phash_partitions = (SharedTuplestoreAccessor **)
+			palloc(npartitions * sizeof(SharedTuplestoreAccessor *));
+		hashagg_parallel_init_partitions(node);
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -4722,10 +5202,33 @@ ExecAggInitializeDSM(AggState *node, ParallelContext *pcxt)
 				   node->shared_info);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecAggReInitializeDSM
+ *
+ *		Reset the shared state of a Parallel HashAgg before beginning a
+ *		fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAggReInitializeDSM(AggState *node, ParallelContext *pcxt)
+{
+	ParallelHashAggState *pstate = node->phash_state;
+
+	if (pstate == NULL)
+		return;
+
+	/* Clear any partition files, and start over with empty partitions */
+	SharedFileSetDeleteAll(&pstate->fileset);
+	BarrierInit(&pstate->barrier, 0);
+	pg_atomic_write_u32(&pstate->next_partition, 0);
+	hashagg_parallel_init_partitions(node);
+}
+
 /* ----------------------------------------------------------------
  *		ExecAggInitializeWorker
  *
- *		Attach worker to DSM space for aggregate statistics.
+ *		Attach worker to DSM space for aggregate statistics, and to the
+ *		shared state of a Parallel HashAgg.
  * ----------------------------------------------------------------
  */
 void
@@ -4733,6 +5236,25 @@ ExecAggInitializeWorker(AggState *node, ParallelWorkerContext *pwcxt)
 {
 	node->shared_info =
 		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
+
+	if (hashagg_is_parallel_aware(node))
+	{
+		ParallelHashAggState *pstate;
+
+		pstate = shm_toc_lookup(pwcxt->toc,
+								PARALLEL_KEY_HASHAGG(node->ss.ps.plan->plan_node_id),
+								false);
+		SharedFileSetAttach(&pstate->fileset, pwcxt->seg);
+
+		node->phash_state = pstate;
+		node->phash_partitions = (SharedTuplestoreAccessor **)
+			palloc(pstate->npartitions * sizeof(SharedTuplestoreAccessor *));
+		for (int i = 0; i < pstate->npartitions; i++)
+			node->phash_partitions[i] =
+				sts_attach(ParallelHashAggPartition(pstate, i),
+						   ParallelWorkerNumber + 1,
+						   &pstate->fileset);
+	}
 }
 
 /* ----------------------------------------------------------------
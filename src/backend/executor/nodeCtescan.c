@@ -18,8 +18,26 @@
 #include "executor/execdebug.h"
 #include "executor/nodeCtescan.h"
 #include "miscadmin.h"
+#include "storage/sharedfileset.h"
+#include "utils/memutils.h"
+
+/*
+ * Shared state for a parallel-aware CteScan, found in the DSM under the
+ * node's plan_node_id.  The SharedTuplestore holding the CTE's rows follows
+ * the struct.
+ */
+typedef struct ParallelCteScanState
+{
+	SharedFileSet fileset;		/* space for the shared tuplestore's files */
+} ParallelCteScanState;
+
+#define ParallelCteScanStateGetSts(pstate) \
+	((SharedTuplestore *) ((char *) (pstate) + \
+						   MAXALIGN(sizeof(ParallelCteScanState))))
 
 static TupleTableSlot *CteScanNext(CteScanState *node);
+static TupleTableSlot *CteScanNextShared(CteScanState *node);
+static TupleTableSlot *ExecParallelCteScan(PlanState *pstate);
 
 /* ----------------------------------------------------------------
  *		CteScanNext
@@ -138,6 +156,34 @@ CteScanNext(CteScanState *node)
 	return ExecClearTuple(slot);
 }
 
+/* ----------------------------------------------------------------
+ *		CteScanNextShared
+ *
+ *		This is a workhorse for ExecParallelCteScan: fetch the next tuple
+ *		of the shared tuplestore not yet returned to any participant
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+CteScanNextShared(CteScanState *node)
+{
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	MinimalTuple tuple;
+
+	Assert(ScanDirectionIsForward(node->ss.ps.state->es_direction));
+
+	if (!node->sts_scan_started)
+	{
+		sts_begin_parallel_scan(node->sts_accessor);
+		node->sts_scan_started = true;
+	}
+
+	tuple = sts_parallel_scan_next(node->sts_accessor, NULL);
+	if (tuple == NULL)
+		return ExecClearTuple(slot);
+
+	return ExecStoreMinimalTuple(tuple, slot, false);
+}
+
 /*
  * CteScanRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
@@ -166,6 +212,23 @@ ExecCteScan(PlanState *pstate)
 					(ExecScanRecheckMtd) CteScanRecheck);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecParallelCteScan(node)
+ *
+ *		Like ExecCteScan, but for a parallel-aware scan reading its share
+ *		of the shared tuplestore.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecParallelCteScan(PlanState *pstate)
+{
+	CteScanState *node = castNode(CteScanState, pstate);
+
+	return ExecScan(&node->ss,
+					(ExecScanAccessMtd) CteScanNextShared,
+					(ExecScanRecheckMtd) CteScanRecheck);
+}
+
 
 /* ----------------------------------------------------------------
  *		ExecInitCteScan
@@ -208,9 +271,50 @@ ExecInitCteScan(CteScan *node, EState *estate, int eflags)
 	scanstate->ss.ps.state = estate;
 	scanstate->ss.ps.ExecProcNode = ExecCteScan;
 	scanstate->eflags = eflags;
+	scanstate->sts_accessor = NULL;
+	scanstate->sts_scan_started = false;
 	scanstate->cte_table = NULL;
 	scanstate->eof_cte = false;
 
+	/*
+	 * In a parallel worker, the CTE query isn't available, and we'll read the
+	 * rows the leader put into the shared tuplestore; see
+	 * ExecCteScanInitializeWorker().  The scan tuple type is the result
+	 * rowtype of the CTE query, as recorded in the plan.
+	 */
+	if (node->scan.plan.parallel_aware && IsParallelWorker())
+	{
+		TupleDesc	tupdesc;
+		ListCell   *lc1,
+				   *lc2,
+				   *lc3;
+		AttrNumber	attno = 0;
+
+		tupdesc = CreateTemplateTupleDesc(list_length(node->ctecoltypes));
+		forthree(lc1, node->ctecoltypes,
+				 lc2, node->ctecoltypmods,
+				 lc3, node->ctecolcollations)
+		{
+			attno++;
+			TupleDescInitEntry(tupdesc, attno, NULL,
+							   lfirst_oid(lc1), lfirst_int(lc2), 0);
+			TupleDescInitEntryCollation(tupdesc, attno, lfirst_oid(lc3));
+		}
+
+		scanstate->cteplanstate = NULL;
+		scanstate->leader = NULL;
+
+		ExecAssignExprContext(estate, &scanstate->ss.ps);
+		ExecInitScanTupleSlot(estate, &scanstate->ss, tupdesc,
+							  &TTSOpsMinimalTuple);
+		ExecInitResultTypeTL(&scanstate->ss.ps);
+		ExecAssignScanProjectionInfo(&scanstate->ss);
+		scanstate->ss.ps.qual =
+			ExecInitQual(node->scan.plan.qual, (PlanState *) scanstate);
+
+		return scanstate;
+	}
+
 	/*
 	 * Find the already-initialized plan for the CTE query.
 	 */
@@ -309,6 +413,23 @@ ExecEndCteScan(CteScanState *node)
 	}
 }
 
+/* ----------------------------------------------------------------
+ *		ExecShutdownCteScan
+ *
+ *		Close our file of the shared tuplestore, before the DSM segment
+ *		holding its file set goes away.
+ * ----------------------------------------------------------------
+ */
+void
+ExecShutdownCteScan(CteScanState *node)
+{
+	if (node->sts_accessor != NULL)
+	{
+		sts_end_parallel_scan(node->sts_accessor);
+		node->sts_accessor = NULL;
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecReScanCteScan
  *
@@ -318,13 +439,23 @@ ExecEndCteScan(CteScanState *node)
 void
 ExecReScanCteScan(CteScanState *node)
 {
-	Tuplestorestate *tuplestorestate = node->leader->cte_table;
+	Tuplestorestate *tuplestorestate;
 
 	if (node->ss.ps.ps_ResultTupleSlot)
 		ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
 
 	ExecScanReScan(&node->ss);
 
+	/*
+	 * A parallel-aware scan's shared tuplestore is reset by
+	 * ExecCteScanReInitializeDSM(), and there's nothing else to do in a
+	 * worker.
+	 */
+	if (node->leader == NULL)
+		return;
+
+	tuplestorestate = node->leader->cte_table;
+
 	/*
 	 * Clear the tuplestore if a new scan of the underlying CTE is required.
 	 * This implicitly resets all the tuplestore's read pointers.  Note that
@@ -349,3 +480,132 @@ ExecReScanCteScan(CteScanState *node)
 		tuplestore_rescan(tuplestorestate);
 	}
 }
+
+/* ----------------------------------------------------------------
+ *						Parallel Scan Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanEstimate
+ *
+ *		Compute the amount of space we'll need in the parallel
+ *		query DSM, and inform pcxt->estimator about our needs.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanEstimate(CteScanState *node, ParallelContext *pcxt)
+{
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   add_size(MAXALIGN(sizeof(ParallelCteScanState)),
+									sts_estimate(pcxt->nworkers + 1)));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanInitializeDSM
+ *
+ *		Set up the shared tuplestore, and fill it with all the rows of
+ *		the CTE, before any worker is launched.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanInitializeDSM(CteScanState *node, ParallelContext *pcxt)
+{
+	ParallelCteScanState *pstate;
+	SharedTuplestoreAccessor *accessor;
+	MemoryContext oldcontext;
+
+	/*
+	 * If we failed to create a real DSM segment, no workers will be launched,
+	 * and we just scan the CTE by ourselves as usual.
+	 */
+	if (pcxt->seg == NULL)
+	{
+		ExecSetExecProcNode(&node->ss.ps, ExecCteScan);
+		return;
+	}
+
+	pstate = shm_toc_allocate(pcxt->toc,
+							  add_size(MAXALIGN(sizeof(ParallelCteScanState)),
+									   sts_estimate(pcxt->nworkers + 1)));
+	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pstate);
+
+	SharedFileSetInit(&pstate->fileset, pcxt->seg);
+
+	oldcontext = MemoryContextSwitchTo(node->ss.ps.state->es_query_cxt);
+	accessor = sts_initialize(ParallelCteScanStateGetSts(pstate),
+							  pcxt->nworkers + 1, 0, 0, 0,
+							  &pstate->fileset, "ctescan");
+	MemoryContextSwitchTo(oldcontext);
+
+	/*
+	 * Read the whole CTE through our own read pointer of the local
+	 * tuplestore, so that the CTE query is still evaluated just once even if
+	 * it's also scanned outside of the parallel part of the plan.
+	 */
+	for (;;)
+	{
+		TupleTableSlot *slot;
+		MinimalTuple tuple;
+		bool		shouldFree;
+
+		slot = CteScanNext(node);
+		if (TupIsNull(slot))
+			break;
+
+		tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+		sts_puttuple(accessor, NULL, tuple);
+		if (shouldFree)
+			pfree(tuple);
+	}
+	sts_end_write(accessor);
+
+	node->sts_accessor = accessor;
+	node->sts_scan_started = false;
+	ExecSetExecProcNode(&node->ss.ps, ExecParallelCteScan);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanReInitializeDSM
+ *
+ *		Reset shared state before beginning a fresh scan.  The CTE's
+ *		rows don't change, so there's no need to read them again.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanReInitializeDSM(CteScanState *node, ParallelContext *pcxt)
+{
+	if (node->sts_accessor == NULL)
+		return;
+
+	sts_reinitialize(node->sts_accessor);
+	node->sts_scan_started = false;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanInitializeWorker
+ *
+ *		Attach to the shared tuplestore filled by the leader.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanInitializeWorker(CteScanState *node,
+							ParallelWorkerContext *pwcxt)
+{
+	ParallelCteScanState *pstate;
+	MemoryContext oldcontext;
+
+	pstate = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, false);
+
+	SharedFileSetAttach(&pstate->fileset, pwcxt->seg);
+
+	oldcontext = MemoryContextSwitchTo(node->ss.ps.state->es_query_cxt);
+	node->sts_accessor = sts_attach(ParallelCteScanStateGetSts(pstate),
+									ParallelWorkerNumber + 1,
+									&pstate->fileset);
+	MemoryContextSwitchTo(oldcontext);
+
+	node->sts_scan_started = false;
+	ExecSetExecProcNode(&node->ss.ps, ExecParallelCteScan);
+}
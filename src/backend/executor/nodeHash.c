@@ -30,6 +30,8 @@
 #include "access/parallel.h"
 #include "catalog/pg_statistic.h"
 #include "commands/tablespace.h"
+#include "common/hashfn.h"
+#include "executor/execRuntimeFilter.h"
 #include "executor/execdebug.h"
 #include "executor/hashjoin.h"
 #include "executor/nodeHash.h"
@@ -38,6 +40,7 @@
 #include "pgstat.h"
 #include "port/atomics.h"
 #include "port/pg_bitutils.h"
+#include "port/simd.h"
 #include "utils/dynahash.h"
 #include "utils/guc.h"
 #include "utils/lsyscache.h"
@@ -61,6 +64,9 @@ static HashJoinTuple ExecParallelHashTupleAlloc(HashJoinTable hashtable,
 												size_t size,
 												dsa_pointer *shared);
 static void MultiExecPrivateHash(HashState *node);
+static inline uint32 hash_probe_match(const uint8 *tags, uint8 tag);
+static bool ExecScanHashProbeIndex(HashJoinState *hjstate,
+								   ExprContext *econtext);
 static void MultiExecParallelHash(HashState *node);
 static inline HashJoinTuple ExecParallelHashFirstTuple(HashJoinTable hashtable,
 													   int bucketno);
@@ -157,6 +163,10 @@ MultiExecPrivateHash(HashState *node)
 	hashkeys = node->hashkeys;
 	econtext = node->ps.ps_ExprContext;
 
+	/* Build the runtime filter the join has pushed down, if any */
+	if (node->runtime_filter != NULL)
+		ExecRuntimeFilterBegin(node->runtime_filter, outerNode->plan->plan_rows);
+
 	/*
 	 * Get all tuples from the node below the Hash node and insert into the
 	 * hash table (or temp files).
@@ -174,6 +184,9 @@ MultiExecPrivateHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (node->runtime_filter != NULL)
+				ExecRuntimeFilterAdd(node->runtime_filter, hashvalue);
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -201,6 +214,11 @@ MultiExecPrivateHash(HashState *node)
 		hashtable->spacePeak = hashtable->spaceUsed;
 
 	hashtable->partialTuples = hashtable->totalTuples;
+
+	ExecHashBuildProbeIndex(hashtable);
+
+	if (node->runtime_filter != NULL)
+		ExecRuntimeFilterFinish(node->runtime_filter);
 }
 
 /* ----------------------------------------------------------------
@@ -497,6 +515,11 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->nbatch_original = nbatch;
 	hashtable->nbatch_outstart = nbatch;
 	hashtable->growEnabled = true;
+	hashtable->stripeEnabled = false;
+	hashtable->curbatchOverflow = false;
+	hashtable->curstripe = 0;
+	hashtable->stripeFileno = 0;
+	hashtable->stripeOffset = 0;
 	hashtable->totalTuples = 0;
 	hashtable->partialTuples = 0;
 	hashtable->skewTuples = 0;
@@ -509,6 +532,9 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->spaceAllowedSkew =
 		hashtable->spaceAllowed * SKEW_HASH_MEM_PERCENT / 100;
 	hashtable->chunks = NULL;
+	hashtable->probeNumGroups = 0;
+	hashtable->probeTags = NULL;
+	hashtable->probeTuples = NULL;
 	hashtable->current_chunk = NULL;
 	hashtable->parallel_state = state->parallel_state;
 	hashtable->area = state->ps.state->es_query_dsa;
@@ -873,13 +899,13 @@ ExecHashTableDestroy(HashJoinTable hashtable)
 	int			i;
 
 	/*
-	 * Make sure all the temp files are closed.  We skip batch 0, since it
-	 * can't have any temp files (and the arrays might not even exist if
+	 * Make sure all the temp files are closed.  Batch 0 only has temp files
+	 * if it needed several passes (and the arrays might not even exist if
 	 * nbatch is only 1).  Parallel hash joins don't use these files.
 	 */
 	if (hashtable->innerBatchFile != NULL)
 	{
-		for (i = 1; i < hashtable->nbatch; i++)
+		for (i = 0; i < hashtable->nbatch; i++)
 		{
 			if (hashtable->innerBatchFile[i])
 				BufFileClose(hashtable->innerBatchFile[i]);
@@ -1058,6 +1084,14 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 	}
 }
 
+/*
+ * If an exhausted batch received at least this fraction of its parent batch's
+ * tuples when the batches were split, we give up on growing nbatch: doubling
+ * again would rewrite the whole inner relation to shave off only a few
+ * tuples from the hot batch.
+ */
+#define PHJ_EXTREME_SKEW_FRACTION	0.9
+
 /*
  * ExecParallelHashIncreaseNumBatches
  *		Every participant attached to grow_batches_barrier must run this
@@ -1238,17 +1272,21 @@ ExecParallelHashIncreaseNumBatches(HashJoinTable hashtable)
 						batch->estimated_size > pstate->space_allowed)
 					{
 						int			parent;
+						size_t		parent_ntuples;
 
 						space_exhausted = true;
 
 						/*
-						 * Did this batch receive ALL of the tuples from its
-						 * parent batch?  That would indicate that further
-						 * repartitioning isn't going to help (the hash values
-						 * are probably all the same).
+						 * Did this batch receive ALL, or nearly all, of the
+						 * tuples from its parent batch?  That would indicate
+						 * that further repartitioning isn't going to help
+						 * (most of the hash values are probably the same).
 						 */
 						parent = i % pstate->old_nbatch;
-						if (batch->ntuples == hashtable->batches[parent].shared->old_ntuples)
+						parent_ntuples = hashtable->batches[parent].shared->old_ntuples;
+						if (batch->ntuples == parent_ntuples ||
+							(parent_ntuples > 0 &&
+							 batch->ntuples >= parent_ntuples * PHJ_EXTREME_SKEW_FRACTION))
 							extreme_skew_detected = true;
 					}
 				}
@@ -1608,13 +1646,34 @@ ExecHashTableInsert(HashJoinTable hashtable,
 	int			bucketno;
 	int			batchno;
 
+	/* the probe index is only built once the batch is complete */
+	Assert(hashtable->probeTags == NULL);
+
 	ExecHashGetBucketAndBatch(hashtable, hashvalue,
 							  &bucketno, &batchno);
 
 	/*
 	 * decide whether to put the tuple in the hash table or a temp file
 	 */
-	if (batchno == hashtable->curbatch)
+	if (batchno == hashtable->curbatch && hashtable->curbatch == 0 &&
+		hashtable->curstripe == 0 &&
+		ExecHashTableIsFull(hashtable, tuple->t_len))
+	{
+		/*
+		 * Batch zero can't be split any further, and it doesn't fit.  Keep
+		 * the tuple in batch zero's own file, for a later pass over it.
+		 */
+		if (!hashtable->curbatchOverflow)
+		{
+			hashtable->curbatchOverflow = true;
+			hashtable->stripeFileno = 0;
+			hashtable->stripeOffset = 0;
+		}
+		ExecHashJoinSaveTuple(tuple,
+							  hashvalue,
+							  &hashtable->innerBatchFile[0]);
+	}
+	else if (batchno == hashtable->curbatch)
 	{
 		/*
 		 * put the tuple in hash table
@@ -1683,6 +1742,31 @@ ExecHashTableInsert(HashJoinTable hashtable,
 		heap_free_minimal_tuple(tuple);
 }
 
+/*
+ * ExecHashTableIsFull
+ *		has the current batch used up its memory, once nbatch can no longer
+ *		be increased?
+ *
+ * Returns true if a tuple of the given size, belonging to the current batch,
+ * should be left for a later pass over the batch instead of being inserted.
+ * That is only ever the case when multi-pass batches are enabled.
+ */
+bool
+ExecHashTableIsFull(HashJoinTable hashtable, Size tupleSize)
+{
+	if (!hashtable->stripeEnabled || hashtable->growEnabled ||
+		hashtable->innerBatchFile == NULL)
+		return false;
+
+	/* always make progress, however large the tuple */
+	if (hashtable->spaceUsed == 0)
+		return false;
+
+	return hashtable->spaceUsed + HJTUPLE_OVERHEAD + tupleSize +
+		hashtable->nbuckets_optimal * sizeof(HashJoinTuple) >
+		hashtable->spaceAllowed;
+}
+
 /*
  * ExecParallelHashTableInsert
  *		insert a tuple into a shared hash table or shared batch tuplestore
@@ -1926,6 +2010,249 @@ ExecHashGetBucketAndBatch(HashJoinTable hashtable,
 	}
 }
 
+/*
+ * Parameters of the probe index.  HASH_PROBE_INDEX_MIN_TUPLES is meant to
+ * leave out hash tables that are small enough to stay in the CPU caches,
+ * where chasing the bucket lists is cheap.
+ */
+#define HASH_PROBE_GROUP_SIZE		16	/* slots whose tags are compared at once */
+#define HASH_PROBE_INDEX_MIN_TUPLES	65536
+#define HASH_PROBE_TAG_EMPTY		0
+
+/* tag of a slot, made of the bits of h not used to choose its group */
+#define HashProbeTag(h)		((uint8) (0x80 | ((h) >> 25)))
+
+/*
+ * ExecHashBuildProbeIndex
+ *		Build the probe index over the in-memory buckets, once the current
+ *		batch of the inner relation has been loaded into them.
+ *
+ * Scanning a bucket list costs a cache miss per tuple visited once the hash
+ * table is too large for the CPU caches, and most of those tuples don't even
+ * have the right hash value.  The probe index stores pointers to all tuples
+ * of the batch in an open-addressing table, whose slots are arranged in
+ * groups of HASH_PROBE_GROUP_SIZE.  Each slot has a one-byte tag derived
+ * from the tuple's hash value, and the tags of a group are contiguous, so
+ * that a probe usually looks at one group of tags, compared all at once
+ * with SIMD instructions, and only follows pointers to tuples whose tag
+ * matches.
+ *
+ * The index is built only if it fits into the memory left within
+ * spaceAllowed.  The bucket lists are kept for the code that scans the
+ * whole table, and for the skew buckets.
+ */
+void
+ExecHashBuildProbeIndex(HashJoinTable hashtable)
+{
+	HashMemoryChunk chunk;
+	size_t		ntuples = 0;
+	size_t		nslots;
+	size_t		size;
+	uint32		groupmask;
+
+	Assert(hashtable->parallel_state == NULL);
+	Assert(hashtable->probeTags == NULL);
+
+	for (chunk = hashtable->chunks; chunk != NULL; chunk = chunk->next.unshared)
+		ntuples += chunk->ntuples;
+
+	if (ntuples < HASH_PROBE_INDEX_MIN_TUPLES || ntuples > PG_INT32_MAX / 2)
+		return;
+
+	/* Keep the load factor below 7/8, so that probes end quickly */
+	nslots = pg_nextpower2_size_t(ntuples + ntuples / 7 + 1);
+	size = nslots * (sizeof(uint8) + sizeof(HashJoinTuple));
+	if (hashtable->spaceUsed + size > hashtable->spaceAllowed)
+		return;
+
+	hashtable->probeTags = (uint8 *)
+		MemoryContextAllocExtended(hashtable->batchCxt, nslots * sizeof(uint8),
+								   MCXT_ALLOC_HUGE | MCXT_ALLOC_ZERO);
+	hashtable->probeTuples = (HashJoinTuple *)
+		MemoryContextAllocExtended(hashtable->batchCxt,
+								   nslots * sizeof(HashJoinTuple),
+								   MCXT_ALLOC_HUGE);
+	hashtable->probeNumGroups = nslots / HASH_PROBE_GROUP_SIZE;
+	groupmask = hashtable->probeNumGroups - 1;
+
+	hashtable->spaceUsed += size;
+	if (hashtable->spaceUsed > hashtable->spacePeak)
+		hashtable->spacePeak = hashtable->spaceUsed;
+
+	/* Insert all tuples, scanning through the chunks directly */
+	for (chunk = hashtable->chunks; chunk != NULL; chunk = chunk->next.unshared)
+	{
+		size_t		idx = 0;
+
+		while (idx < chunk->used)
+		{
+			HashJoinTuple hashTuple = (HashJoinTuple) (HASH_CHUNK_DATA(chunk) + idx);
+			MinimalTuple tuple = HJTUPLE_MINTUPLE(hashTuple);
+			uint32		h = murmurhash32(hashTuple->hashvalue);
+			uint32		group = h & groupmask;
+
+			/* Use the first empty slot, starting at the tuple's own group */
+			for (;;)
+			{
+				uint8	   *tags;
+				uint32		empty;
+
+				tags = &hashtable->probeTags[(size_t) group * HASH_PROBE_GROUP_SIZE];
+				empty = hash_probe_match(tags, HASH_PROBE_TAG_EMPTY);
+				if (empty != 0)
+				{
+					int			i = pg_rightmost_one_pos32(empty);
+
+					tags[i] = HashProbeTag(h);
+					hashtable->probeTuples[(size_t) group * HASH_PROBE_GROUP_SIZE + i] =
+						hashTuple;
+					break;
+				}
+				group = (group + 1) & groupmask;
+			}
+
+			idx += MAXALIGN(HJTUPLE_OVERHEAD + tuple->t_len);
+		}
+	}
+}
+
+/*
+ * Return a bitmask of the slots of a probe index group that have the given
+ * tag, with the first slot in the least significant bit.
+ */
+static inline uint32
+hash_probe_match(const uint8 *tags, uint8 tag)
+{
+#ifndef USE_NO_SIMD
+	Vector8		v;
+
+	StaticAssertStmt(sizeof(Vector8) == HASH_PROBE_GROUP_SIZE,
+					 "probe index group size must match vector size");
+
+	vector8_load(&v, tags);
+	return vector8_highbit_mask(vector8_eq(v, vector8_broadcast(tag)));
+#else
+	uint32		result = 0;
+
+	for (int i = 0; i < HASH_PROBE_GROUP_SIZE; i++)
+	{
+		if (tags[i] == tag)
+			result |= (uint32) 1 << i;
+	}
+	return result;
+#endif
+}
+
+/*
+ * ExecHashPrefetchBucket
+ *		Start fetching the part of the hash table that a probe for the given
+ *		hash value will look at into the CPU cache.
+ *
+ * Callers that know the hash values of several outer tuples in advance can
+ * use this to overlap the cache misses of their probes.
+ */
+void
+ExecHashPrefetchBucket(HashJoinTable hashtable, uint32 hashvalue)
+{
+	int			bucketno;
+	int			batchno;
+
+	ExecHashGetBucketAndBatch(hashtable, hashvalue, &bucketno, &batchno);
+	if (batchno != hashtable->curbatch)
+		return;
+
+	if (hashtable->probeTags != NULL)
+	{
+		uint32		h = murmurhash32(hashvalue);
+		size_t		slot;
+
+		slot = (size_t) (h & (hashtable->probeNumGroups - 1)) * HASH_PROBE_GROUP_SIZE;
+		pg_prefetch_mem(&hashtable->probeTags[slot]);
+		pg_prefetch_mem(&hashtable->probeTuples[slot]);
+	}
+	else
+		pg_prefetch_mem(&hashtable->buckets.unshared[bucketno]);
+}
+
+/*
+ * ExecScanHashProbeIndex
+ *		ExecScanHashBucket() for a hash table with a probe index
+ *
+ * When resuming after a match, the scan continues after the slot of the
+ * tuple returned last time.  A group with an empty slot ends the scan, since
+ * ExecHashBuildProbeIndex() would not have moved on to the next group to
+ * store a tuple.
+ */
+static bool
+ExecScanHashProbeIndex(HashJoinState *hjstate, ExprContext *econtext)
+{
+	ExprState  *hjclauses = hjstate->hashclauses;
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	uint32		hashvalue = hjstate->hj_CurHashValue;
+	uint32		h = murmurhash32(hashvalue);
+	uint8		tag = HashProbeTag(h);
+	uint32		groupmask = hashtable->probeNumGroups - 1;
+	uint32		group;
+	int			start;
+
+	if (hjstate->hj_CurTuple != NULL)
+	{
+		group = hjstate->hj_CurProbeSlot / HASH_PROBE_GROUP_SIZE;
+		start = hjstate->hj_CurProbeSlot % HASH_PROBE_GROUP_SIZE + 1;
+	}
+	else
+	{
+		group = h & groupmask;
+		start = 0;
+	}
+
+	for (;;)
+	{
+		uint8	   *tags = &hashtable->probeTags[(size_t) group * HASH_PROBE_GROUP_SIZE];
+		uint32		matches;
+
+		matches = hash_probe_match(tags, tag) & ~(((uint32) 1 << start) - 1);
+
+		while (matches != 0)
+		{
+			int			slotno = group * HASH_PROBE_GROUP_SIZE +
+				pg_rightmost_one_pos32(matches);
+			HashJoinTuple hashTuple = hashtable->probeTuples[slotno];
+
+			matches &= matches - 1;
+
+			if (hashTuple->hashvalue == hashvalue)
+			{
+				TupleTableSlot *inntuple;
+
+				/* insert hashtable's tuple into exec slot so ExecQual sees it */
+				inntuple = ExecStoreMinimalTuple(HJTUPLE_MINTUPLE(hashTuple),
+												 hjstate->hj_HashTupleSlot,
+												 false);	/* do not pfree */
+				econtext->ecxt_innertuple = inntuple;
+
+				if (ExecQualAndReset(hjclauses, econtext))
+				{
+					hjstate->hj_CurTuple = hashTuple;
+					hjstate->hj_CurProbeSlot = slotno;
+					return true;
+				}
+			}
+		}
+
+		if (hash_probe_match(tags, HASH_PROBE_TAG_EMPTY) != 0)
+			break;
+
+		group = (group + 1) & groupmask;
+		start = 0;
+	}
+
+	/*
+	 * no match
+	 */
+	return false;
+}
+
 /*
  * ExecScanHashBucket
  *		scan a hash bucket for matches to the current outer tuple
@@ -1945,6 +2272,11 @@ ExecScanHashBucket(HashJoinState *hjstate,
 	HashJoinTuple hashTuple = hjstate->hj_CurTuple;
 	uint32		hashvalue = hjstate->hj_CurHashValue;
 
+	/* Use the probe index for the standard hashtable, if there is one */
+	if (hashtable->probeTags != NULL &&
+		hjstate->hj_CurSkewBucketNo == INVALID_SKEW_BUCKET_NO)
+		return ExecScanHashProbeIndex(hjstate, econtext);
+
 	/*
 	 * hj_CurTuple is the address of the tuple last returned from the current
 	 * bucket, or NULL if it's time to start scanning a new bucket.
@@ -2163,8 +2495,14 @@ ExecHashTableReset(HashJoinTable hashtable)
 
 	MemoryContextSwitchTo(oldcxt);
 
-	/* Forget the chunks (the memory was freed by the context reset above). */
+	/*
+	 * Forget the chunks and the probe index (the memory was freed by the
+	 * context reset above).
+	 */
 	hashtable->chunks = NULL;
+	hashtable->probeNumGroups = 0;
+	hashtable->probeTags = NULL;
+	hashtable->probeTuples = NULL;
 }
 
 /*
@@ -108,10 +108,12 @@
 
 #include "access/htup_details.h"
 #include "access/parallel.h"
+#include "executor/execRuntimeFilter.h"
 #include "executor/executor.h"
 #include "executor/hashjoin.h"
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
+#include "executor/tuplebatch.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "utils/memutils.h"
@@ -136,6 +138,9 @@
 static TupleTableSlot *ExecHashJoinOuterGetTuple(PlanState *outerNode,
 												 HashJoinState *hjstate,
 												 uint32 *hashvalue);
+static TupleTableSlot *ExecHashJoinOuterGetBatchTuple(PlanState *outerNode,
+													  HashJoinState *hjstate,
+													  uint32 *hashvalue);
 static TupleTableSlot *ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
 														 HashJoinState *hjstate,
 														 uint32 *hashvalue);
@@ -144,6 +149,8 @@ static TupleTableSlot *ExecHashJoinGetSavedTuple(HashJoinState *hjstate,
 												 uint32 *hashvalue,
 												 TupleTableSlot *tupleSlot);
 static bool ExecHashJoinNewBatch(HashJoinState *hjstate);
+static void ExecHashJoinLoadInnerBatch(HashJoinState *hjstate);
+static void ExecHashJoinNextStripe(HashJoinState *hjstate);
 static bool ExecParallelHashJoinNewBatch(HashJoinState *hjstate);
 static void ExecParallelHashJoinPartitionOuter(HashJoinState *hjstate);
 
@@ -257,7 +264,8 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				}
 				else if (HJ_FILL_OUTER(node) ||
 						 (outerNode->plan->startup_cost < hashNode->ps.plan->total_cost &&
-						  !node->hj_OuterNotEmpty))
+						  !node->hj_OuterNotEmpty &&
+						  hashNode->runtime_filter == NULL))
 				{
 					node->hj_FirstOuterTupleSlot = ExecProcNode(outerNode);
 					if (TupIsNull(node->hj_FirstOuterTupleSlot))
@@ -282,6 +290,18 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 												HJ_FILL_INNER(node));
 				node->hj_HashTable = hashtable;
 
+				/*
+				 * If a batch turns out not to fit into memory, even after
+				 * we've given up on increasing the number of batches, we can
+				 * join it in several passes over its outer tuples.  That
+				 * needs no more than the per-pass tracking of matched inner
+				 * tuples, so it's only done for inner and right joins.
+				 */
+				if (!parallel &&
+					(node->js.jointype == JOIN_INNER ||
+					 node->js.jointype == JOIN_RIGHT))
+					hashtable->stripeEnabled = true;
+
 				/*
 				 * Execute the Hash node, to build the hash table.  If using
 				 * Parallel Hash, then we'll try to help hashing unless we
@@ -390,26 +410,51 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				if (batchno != hashtable->curbatch &&
 					node->hj_CurSkewBucketNo == INVALID_SKEW_BUCKET_NO)
 				{
-					bool		shouldFree;
-					MinimalTuple mintuple = ExecFetchSlotMinimalTuple(outerTupleSlot,
-																	  &shouldFree);
-
 					/*
 					 * Need to postpone this outer tuple to a later batch.
-					 * Save it in the corresponding outer-batch file.
+					 * Save it in the corresponding outer-batch file, unless
+					 * we already did so in an earlier pass over this batch.
 					 */
 					Assert(parallel_state == NULL);
 					Assert(batchno > hashtable->curbatch);
-					ExecHashJoinSaveTuple(mintuple, hashvalue,
-										  &hashtable->outerBatchFile[batchno]);
+					if (hashtable->curstripe == 0)
+					{
+						bool		shouldFree;
+						MinimalTuple mintuple = ExecFetchSlotMinimalTuple(outerTupleSlot,
+																		  &shouldFree);
 
-					if (shouldFree)
-						heap_free_minimal_tuple(mintuple);
+						ExecHashJoinSaveTuple(mintuple, hashvalue,
+											  &hashtable->outerBatchFile[batchno]);
+
+						if (shouldFree)
+							heap_free_minimal_tuple(mintuple);
+					}
 
 					/* Loop around, staying in HJ_NEED_NEW_OUTER state */
 					continue;
 				}
 
+				/*
+				 * If some of the first batch's inner tuples didn't fit into
+				 * the hash table, its outer tuples are needed again in later
+				 * passes over the batch, so save them as well.
+				 */
+				if (hashtable->curbatchOverflow &&
+					hashtable->curbatch == 0 && hashtable->curstripe == 0 &&
+					node->hj_CurSkewBucketNo == INVALID_SKEW_BUCKET_NO)
+				{
+					bool		shouldFree;
+					MinimalTuple mintuple = ExecFetchSlotMinimalTuple(outerTupleSlot,
+																	  &shouldFree);
+
+					Assert(parallel_state == NULL);
+					ExecHashJoinSaveTuple(mintuple, hashvalue,
+										  &hashtable->outerBatchFile[0]);
+
+					if (shouldFree)
+						heap_free_minimal_tuple(mintuple);
+				}
+
 				/* OK, let's scan the bucket for matches */
 				node->hj_JoinState = HJ_SCAN_BUCKET;
 
@@ -676,6 +721,22 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_OuterTupleSlot = ExecInitExtraTupleSlot(estate, outerDesc,
 														ops);
 
+	/*
+	 * If the outer plan can return batches of tuples, fetch the outer tuples
+	 * of the first pass that way.  Knowing the hash values of a whole batch
+	 * in advance lets us prefetch the hash buckets they will probe, instead
+	 * of waiting for each bucket in turn.  Parallel Hash doesn't do this.
+	 */
+	if (outerPlanState(hjstate)->ExecProcNodeBatch != NULL &&
+		!node->join.plan.parallel_aware)
+	{
+		hjstate->hj_OuterBatch = MakeTupleBatch(outerDesc, TUPLE_BATCH_ROWS);
+		hjstate->hj_OuterBatchSlot = ExecInitExtraTupleSlot(estate, outerDesc,
+															&TTSOpsVirtual);
+		hjstate->hj_OuterBatchHashes = palloc_array(uint32, TUPLE_BATCH_ROWS);
+		hjstate->hj_OuterBatchValid = palloc_array(bool, TUPLE_BATCH_ROWS);
+	}
+
 	/*
 	 * detect whether we need only consider the first matching inner tuple
 	 */
@@ -748,6 +809,28 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_HashOperators = node->hashoperators;
 	hjstate->hj_Collations = node->hashcollations;
 
+	/*
+	 * If the join is expected to discard most outer tuples, and outer tuples
+	 * without a partner don't need to be returned, try to have the outer scan
+	 * discard them instead, using a Bloom filter built along with the hash
+	 * table.  Parallel Hash builds the hash table after the outer side has
+	 * started, so it's not supported.
+	 */
+	if (enable_runtime_filter && !node->join.plan.parallel_aware &&
+		(node->join.jointype == JOIN_INNER ||
+		 node->join.jointype == JOIN_SEMI ||
+		 node->join.jointype == JOIN_RIGHT) &&
+		node->join.plan.plan_rows < 0.5 * outerPlan(node)->plan_rows)
+	{
+		HashState  *hashstate = castNode(HashState, innerPlanState(hjstate));
+
+		hashstate->runtime_filter =
+			ExecPushDownRuntimeFilter(outerPlanState(hjstate),
+									  node->hashkeys,
+									  node->hashoperators,
+									  node->hashcollations);
+	}
+
 	hjstate->hj_JoinState = HJ_BUILD_HASHTABLE;
 	hjstate->hj_MatchedOuter = false;
 	hjstate->hj_OuterNotEmpty = false;
@@ -785,6 +868,9 @@ ExecEndHashJoin(HashJoinState *node)
 	ExecClearTuple(node->hj_OuterTupleSlot);
 	ExecClearTuple(node->hj_HashTupleSlot);
 
+	if (node->hj_OuterBatch)
+		FreeTupleBatch(node->hj_OuterBatch);
+
 	/*
 	 * clean up subtrees
 	 */
@@ -813,7 +899,7 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	int			curbatch = hashtable->curbatch;
 	TupleTableSlot *slot;
 
-	if (curbatch == 0)			/* if it is the first pass */
+	if (curbatch == 0 && hashtable->curstripe == 0) /* if it is the first pass */
 	{
 		/*
 		 * Check to see if first outer tuple was already fetched by
@@ -822,6 +908,9 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 		slot = hjstate->hj_FirstOuterTupleSlot;
 		if (!TupIsNull(slot))
 			hjstate->hj_FirstOuterTupleSlot = NULL;
+		else if (hjstate->hj_OuterBatch)
+			return ExecHashJoinOuterGetBatchTuple(outerNode, hjstate,
+												  hashvalue);
 		else
 			slot = ExecProcNode(outerNode);
 
@@ -849,6 +938,9 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 			 * That tuple couldn't match because of a NULL, so discard it and
 			 * continue with the next one.
 			 */
+			if (hjstate->hj_OuterBatch)
+				return ExecHashJoinOuterGetBatchTuple(outerNode, hjstate,
+													  hashvalue);
 			slot = ExecProcNode(outerNode);
 		}
 	}
@@ -875,6 +967,74 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	return NULL;
 }
 
+/*
+ * ExecHashJoinOuterGetBatchTuple
+ *
+ *		ExecHashJoinOuterGetTuple for the first pass, when the outer plan
+ *		returns batches.  Whenever we fetch a new batch, we compute the hash
+ *		values of all its tuples at once and prefetch the hash table buckets
+ *		they are going to probe, so that the cache misses of the probes
+ *		overlap.
+ */
+static TupleTableSlot *
+ExecHashJoinOuterGetBatchTuple(PlanState *outerNode,
+							   HashJoinState *hjstate,
+							   uint32 *hashvalue)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	TupleBatch *batch = hjstate->hj_OuterBatch;
+	ExprContext *econtext = hjstate->js.ps.ps_ExprContext;
+
+	for (;;)
+	{
+		int			row;
+
+		/* Fetch the next batch from the outer plan, if needed */
+		if (hjstate->hj_OuterBatchNext >= batch->nrows)
+		{
+			/*
+			 * A short batch means the outer plan has no more tuples; don't
+			 * ask it again, as it might restart from the beginning.
+			 */
+			if (hjstate->hj_OuterBatchDone)
+				return NULL;
+			CHECK_FOR_INTERRUPTS();
+			if (ExecProcNodeBatch(outerNode, batch) < batch->maxrows)
+				hjstate->hj_OuterBatchDone = true;
+			hjstate->hj_OuterBatchNext = 0;
+			if (batch->nrows == 0)
+				return NULL;
+
+			for (row = 0; row < batch->nrows; row++)
+			{
+				econtext->ecxt_outertuple =
+					ExecStoreBatchRow(batch, row, hjstate->hj_OuterBatchSlot);
+				hjstate->hj_OuterBatchValid[row] =
+					ExecHashGetHashValue(hashtable, econtext,
+										 hjstate->hj_OuterHashKeys,
+										 true,	/* outer tuple */
+										 HJ_FILL_OUTER(hjstate),
+										 &hjstate->hj_OuterBatchHashes[row]);
+				if (hjstate->hj_OuterBatchValid[row])
+					ExecHashPrefetchBucket(hashtable,
+										   hjstate->hj_OuterBatchHashes[row]);
+			}
+		}
+
+		row = hjstate->hj_OuterBatchNext++;
+
+		/* Skip tuples that couldn't match because of a NULL */
+		if (hjstate->hj_OuterBatchValid[row])
+		{
+			/* remember outer relation is not empty for possible rescan */
+			hjstate->hj_OuterNotEmpty = true;
+
+			*hashvalue = hjstate->hj_OuterBatchHashes[row];
+			return ExecStoreBatchRow(batch, row, hjstate->hj_OuterBatchSlot);
+		}
+	}
+}
+
 /*
  * ExecHashJoinOuterGetTuple variant for the parallel case.
  */
@@ -950,27 +1110,15 @@ ExecHashJoinNewBatch(HashJoinState *hjstate)
 	int			nbatch;
 	int			curbatch;
 	BufFile    *innerFile;
-	TupleTableSlot *slot;
-	uint32		hashvalue;
 
 	nbatch = hashtable->nbatch;
 	curbatch = hashtable->curbatch;
 
-	if (curbatch > 0)
-	{
-		/*
-		 * We no longer need the previous outer batch file; close it right
-		 * away to free disk space.
-		 */
-		if (hashtable->outerBatchFile[curbatch])
-			BufFileClose(hashtable->outerBatchFile[curbatch]);
-		hashtable->outerBatchFile[curbatch] = NULL;
-	}
-	else						/* we just finished the first batch */
+	if (curbatch == 0)			/* we just finished a pass over the first batch */
 	{
 		/*
 		 * Reset some of the skew optimization state variables, since we no
-		 * longer need to consider skew tuples after the first batch. The
+		 * longer need to consider skew tuples after the first pass. The
 		 * memory context reset we are about to do will release the skew
 		 * hashtable itself.
 		 */
@@ -981,6 +1129,39 @@ ExecHashJoinNewBatch(HashJoinState *hjstate)
 		hashtable->spaceUsedSkew = 0;
 	}
 
+	/*
+	 * If not all of the current batch's inner tuples fit into the hash table,
+	 * make another pass over the batch with the next part of them.  There's
+	 * no point in that if the batch has no outer tuples, unless we have to
+	 * emit the unmatched inner tuples.
+	 */
+	if (hashtable->curbatchOverflow)
+	{
+		if (hashtable->outerBatchFile[curbatch] != NULL ||
+			HJ_FILL_INNER(hjstate))
+		{
+			ExecHashJoinNextStripe(hjstate);
+			return true;
+		}
+
+		BufFileClose(hashtable->innerBatchFile[curbatch]);
+		hashtable->innerBatchFile[curbatch] = NULL;
+		hashtable->curbatchOverflow = false;
+	}
+
+	/*
+	 * We no longer need the previous outer batch file; close it right away
+	 * to free disk space.  (The first batch only has one if it needed
+	 * several passes.)
+	 */
+	if (hashtable->outerBatchFile != NULL)
+	{
+		if (hashtable->outerBatchFile[curbatch])
+			BufFileClose(hashtable->outerBatchFile[curbatch]);
+		hashtable->outerBatchFile[curbatch] = NULL;
+	}
+	hashtable->curstripe = 0;
+
 	/*
 	 * We can always skip over any batches that are completely empty on both
 	 * sides.  We can sometimes skip over batches that are empty on only one
@@ -1045,29 +1226,116 @@ ExecHashJoinNewBatch(HashJoinState *hjstate)
 					(errcode_for_file_access(),
 					 errmsg("could not rewind hash-join temporary file")));
 
-		while ((slot = ExecHashJoinGetSavedTuple(hjstate,
-												 innerFile,
-												 &hashvalue,
-												 hjstate->hj_HashTupleSlot)))
+		ExecHashJoinLoadInnerBatch(hjstate);
+	}
+
+	ExecHashBuildProbeIndex(hashtable);
+
+	/*
+	 * Rewind outer batch file (if present), so that we can start reading it.
+	 */
+	if (hashtable->outerBatchFile[curbatch] != NULL)
+	{
+		if (BufFileSeek(hashtable->outerBatchFile[curbatch], 0, 0L, SEEK_SET))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not rewind hash-join temporary file")));
+	}
+
+	return true;
+}
+
+/*
+ * ExecHashJoinLoadInnerBatch
+ *		load the current batch's inner tuples into the hash table
+ *
+ * Reads the inner batch file from its current position.  Once the hash table
+ * is full (see ExecHashTableIsFull), remember where we stopped, so that the
+ * next pass over the batch can continue from there; otherwise the file is
+ * closed at its end.
+ */
+static void
+ExecHashJoinLoadInnerBatch(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	int			curbatch = hashtable->curbatch;
+	BufFile    *innerFile = hashtable->innerBatchFile[curbatch];
+	TupleTableSlot *slot;
+	uint32		hashvalue;
+	int			fileno;
+	off_t		offset;
+
+	hashtable->curbatchOverflow = false;
+
+	BufFileTell(innerFile, &fileno, &offset);
+	while ((slot = ExecHashJoinGetSavedTuple(hjstate,
+											 innerFile,
+											 &hashvalue,
+											 hjstate->hj_HashTupleSlot)))
+	{
+		if (hashtable->stripeEnabled && !hashtable->growEnabled)
 		{
-			/*
-			 * NOTE: some tuples may be sent to future batches.  Also, it is
-			 * possible for hashtable->nbatch to be increased here!
-			 */
-			ExecHashTableInsert(hashtable, slot, hashvalue);
+			int			bucketno;
+			int			batchno;
+			bool		shouldFree;
+			MinimalTuple tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+
+			Assert(!shouldFree);
+			ExecHashGetBucketAndBatch(hashtable, hashvalue,
+									  &bucketno, &batchno);
+			if (batchno == curbatch &&
+				ExecHashTableIsFull(hashtable, tuple->t_len))
+			{
+				hashtable->curbatchOverflow = true;
+				hashtable->stripeFileno = fileno;
+				hashtable->stripeOffset = offset;
+				return;
+			}
 		}
 
 		/*
-		 * after we build the hash table, the inner batch file is no longer
-		 * needed
+		 * NOTE: some tuples may be sent to future batches.  Also, it is
+		 * possible for hashtable->nbatch to be increased here!
 		 */
-		BufFileClose(innerFile);
-		hashtable->innerBatchFile[curbatch] = NULL;
+		ExecHashTableInsert(hashtable, slot, hashvalue);
+		BufFileTell(innerFile, &fileno, &offset);
 	}
 
 	/*
-	 * Rewind outer batch file (if present), so that we can start reading it.
+	 * after we build the hash table, the inner batch file is no longer needed
 	 */
+	BufFileClose(innerFile);
+	hashtable->innerBatchFile[curbatch] = NULL;
+}
+
+/*
+ * ExecHashJoinNextStripe
+ *		start another pass over the current batch
+ *
+ * Replaces the contents of the hash table with the next part of the batch's
+ * inner tuples, and rewinds the batch's outer tuples to join them again.
+ */
+static void
+ExecHashJoinNextStripe(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	int			curbatch = hashtable->curbatch;
+
+	Assert(hashtable->curbatchOverflow);
+
+	hashtable->curstripe++;
+	ExecHashTableReset(hashtable);
+
+	if (BufFileSeek(hashtable->innerBatchFile[curbatch],
+					hashtable->stripeFileno, hashtable->stripeOffset,
+					SEEK_SET))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek in hash-join temporary file")));
+
+	ExecHashJoinLoadInnerBatch(hjstate);
+	ExecHashBuildProbeIndex(hashtable);
+
 	if (hashtable->outerBatchFile[curbatch] != NULL)
 	{
 		if (BufFileSeek(hashtable->outerBatchFile[curbatch], 0, 0L, SEEK_SET))
@@ -1075,8 +1343,6 @@ ExecHashJoinNewBatch(HashJoinState *hjstate)
 					(errcode_for_file_access(),
 					 errmsg("could not rewind hash-join temporary file")));
 	}
-
-	return true;
 }
 
 /*
@@ -1223,7 +1489,7 @@ ExecHashJoinSaveTuple(MinimalTuple tuple, uint32 hashvalue,
 	if (file == NULL)
 	{
 		/* First write to this batch file, so open it. */
-		file = BufFileCreateTemp(false);
+		file = BufFileCreateCompressTemp(false);
 		*fileptr = file;
 	}
 
@@ -1339,6 +1605,10 @@ ExecReScanHashJoin(HashJoinState *node)
 			node->hj_HashTable = NULL;
 			node->hj_JoinState = HJ_BUILD_HASHTABLE;
 
+			/* the outer scan mustn't use the old table's filter */
+			if (hashNode->runtime_filter != NULL)
+				ExecRuntimeFilterReset(hashNode->runtime_filter);
+
 			/*
 			 * if chgParam of subnode is not null then plan will be re-scanned
 			 * by first ExecProcNode.
@@ -1357,6 +1627,13 @@ ExecReScanHashJoin(HashJoinState *node)
 	node->hj_MatchedOuter = false;
 	node->hj_FirstOuterTupleSlot = NULL;
 
+	if (node->hj_OuterBatch)
+	{
+		TupleBatchReset(node->hj_OuterBatch);
+		node->hj_OuterBatchNext = 0;
+		node->hj_OuterBatchDone = false;
+	}
+
 	/*
 	 * if chgParam of subnode is not null then plan will be re-scanned by
 	 * first ExecProcNode.
@@ -19,6 +19,7 @@
  *		ExecInitIndexOnlyScan		creates and initializes state info.
  *		ExecReScanIndexOnlyScan		rescans the indexed relation.
  *		ExecEndIndexOnlyScan		releases all storage.
+ *		ExecIndexOnlyScanReleaseScan	ends the scan of a suspended query.
  *		ExecIndexOnlyMarkPos		marks scan position.
  *		ExecIndexOnlyRestrPos		restores scan position.
  *		ExecIndexOnlyScanEstimate	estimates DSM space needed for
@@ -43,6 +44,7 @@
 #include "storage/predicate.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/spccache.h"
 
 
 static TupleTableSlot *IndexOnlyNext(IndexOnlyScanState *node);
@@ -100,6 +102,7 @@ IndexOnlyNext(IndexOnlyScanState *node)
 		/* Set it up for index-only scan */
 		node->ioss_ScanDesc->xs_want_itup = true;
 		node->ioss_VMBuffer = InvalidBuffer;
+		index_enable_prefetch(scandesc, node->ioss_PrefetchTarget, true);
 
 		/*
 		 * If no run-time keys to calculate or they are ready, go ahead and
@@ -357,6 +360,32 @@ ExecReScanIndexOnlyScan(IndexOnlyScanState *node)
 }
 
 
+/* ----------------------------------------------------------------
+ *		ExecIndexOnlyScanReleaseScan
+ *
+ *		Ends the index scan, if any, and forgets the runtime keys, so
+ *		that the next run begins a new scan with freshly computed keys.
+ *		Used by ExecutorSuspend.
+ * ----------------------------------------------------------------
+ */
+void
+ExecIndexOnlyScanReleaseScan(IndexOnlyScanState *node)
+{
+	/* Release VM buffer pin, if any. */
+	if (node->ioss_VMBuffer != InvalidBuffer)
+	{
+		ReleaseBuffer(node->ioss_VMBuffer);
+		node->ioss_VMBuffer = InvalidBuffer;
+	}
+
+	if (node->ioss_ScanDesc)
+	{
+		index_endscan(node->ioss_ScanDesc);
+		node->ioss_ScanDesc = NULL;
+	}
+	node->ioss_RuntimeKeysReady = false;
+}
+
 /* ----------------------------------------------------------------
  *		ExecEndIndexOnlyScan
  * ----------------------------------------------------------------
@@ -566,6 +595,18 @@ ExecInitIndexOnlyScan(IndexOnlyScan *node, EState *estate, int eflags)
 	lockmode = exec_rt_fetch(node->scan.scanrelid, estate)->rellockmode;
 	indexstate->ioss_RelationDesc = index_open(node->indexid, lockmode);
 
+	/*
+	 * Prefetch the heap blocks that aren't all-visible ahead of the scan,
+	 * unless it may need to move backwards or be restored to a marked
+	 * position.
+	 */
+	if ((eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)) == 0 &&
+		node->indexorderby == NIL)
+		indexstate->ioss_PrefetchTarget =
+			get_tablespace_io_concurrency(currentRelation->rd_rel->reltablespace);
+	else
+		indexstate->ioss_PrefetchTarget = 0;
+
 	/*
 	 * Initialize index-specific scan state
 	 */
@@ -677,6 +718,8 @@ ExecIndexOnlyScanInitializeDSM(IndexOnlyScanState *node,
 								 piscan);
 	node->ioss_ScanDesc->xs_want_itup = true;
 	node->ioss_VMBuffer = InvalidBuffer;
+	index_enable_prefetch(node->ioss_ScanDesc, node->ioss_PrefetchTarget,
+						  true);
 
 	/*
 	 * If no run-time keys to calculate or they are ready, go ahead and pass
@@ -721,6 +764,8 @@ ExecIndexOnlyScanInitializeWorker(IndexOnlyScanState *node,
 								 node->ioss_NumOrderByKeys,
 								 piscan);
 	node->ioss_ScanDesc->xs_want_itup = true;
+	index_enable_prefetch(node->ioss_ScanDesc, node->ioss_PrefetchTarget,
+						  true);
 
 	/*
 	 * If no run-time keys to calculate or they are ready, go ahead and pass
@@ -20,6 +20,7 @@
  *		ExecInitIndexScan		creates and initializes state info.
  *		ExecReScanIndexScan		rescans the indexed relation.
  *		ExecEndIndexScan		releases all storage.
+ *		ExecIndexScanReleaseScan	ends the scan of a suspended query.
  *		ExecIndexMarkPos		marks scan position.
  *		ExecIndexRestrPos		restores scan position.
  *		ExecIndexScanEstimate	estimates DSM space needed for parallel index scan
@@ -43,6 +44,7 @@
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/spccache.h"
 
 /*
  * When an ordering operator is used, tuples fetched from the index that
@@ -114,6 +116,7 @@ IndexNext(IndexScanState *node)
 								   node->iss_NumOrderByKeys);
 
 		node->iss_ScanDesc = scandesc;
+		index_enable_prefetch(scandesc, node->iss_PrefetchTarget, false);
 
 		/*
 		 * If no run-time keys to calculate or they are ready, go ahead and
@@ -778,6 +781,26 @@ ExecIndexAdvanceArrayKeys(IndexArrayKeyInfo *arrayKeys, int numArrayKeys)
 }
 
 
+/* ----------------------------------------------------------------
+ *		ExecIndexScanReleaseScan
+ *
+ *		Ends the index scan, if any, and forgets the runtime keys, so
+ *		that the next run begins a new scan with freshly computed keys.
+ *		Used by ExecutorSuspend.
+ * ----------------------------------------------------------------
+ */
+void
+ExecIndexScanReleaseScan(IndexScanState *node)
+{
+	if (node->iss_ScanDesc)
+	{
+		index_endscan(node->iss_ScanDesc);
+		node->iss_ScanDesc = NULL;
+	}
+	node->iss_RuntimeKeysReady = false;
+	node->iss_ReachedEnd = false;
+}
+
 /* ----------------------------------------------------------------
  *		ExecEndIndexScan
  * ----------------------------------------------------------------
@@ -971,6 +994,19 @@ ExecInitIndexScan(IndexScan *node, EState *estate, int eflags)
 	lockmode = exec_rt_fetch(node->scan.scanrelid, estate)->rellockmode;
 	indexstate->iss_RelationDesc = index_open(node->indexid, lockmode);
 
+	/*
+	 * Prefetch heap blocks ahead of the scan, as bitmap heap scans do, unless
+	 * the scan may need to move backwards or be restored to a marked
+	 * position.  Ordered scans return their tuples through the reorder
+	 * queue, which doesn't support that either.
+	 */
+	if ((eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)) == 0 &&
+		node->indexorderby == NIL)
+		indexstate->iss_PrefetchTarget =
+			get_tablespace_io_concurrency(currentRelation->rd_rel->reltablespace);
+	else
+		indexstate->iss_PrefetchTarget = 0;
+
 	/*
 	 * Initialize index-specific scan state
 	 */
@@ -1691,6 +1727,8 @@ ExecIndexScanInitializeDSM(IndexScanState *node,
 								 node->iss_NumScanKeys,
 								 node->iss_NumOrderByKeys,
 								 piscan);
+	index_enable_prefetch(node->iss_ScanDesc, node->iss_PrefetchTarget,
+						  false);
 
 	/*
 	 * If no run-time keys to calculate or they are ready, go ahead and pass
@@ -1734,6 +1772,8 @@ ExecIndexScanInitializeWorker(IndexScanState *node,
 								 node->iss_NumScanKeys,
 								 node->iss_NumOrderByKeys,
 								 piscan);
+	index_enable_prefetch(node->iss_ScanDesc, node->iss_PrefetchTarget,
+						  false);
 
 	/*
 	 * If no run-time keys to calculate or they are ready, go ahead and pass
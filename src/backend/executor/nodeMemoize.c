@@ -50,6 +50,19 @@
  * demanding, then that may allow us to start putting useful entries back into
  * the cache again.
  *
+ * In a parallel query, each participant has its own cache, so a parameter
+ * value is normally looked up once per participant.  With
+ * enable_shared_memoize, the participants additionally share a second cache
+ * in the query's dynamic shared memory area.  Whenever a participant has
+ * read the tuples for a set of parameters to completion, it publishes a copy
+ * of them to the shared cache, and participants that miss their own cache
+ * look in the shared cache before scanning the outer node.  The shared
+ * cache is a dshash table keyed by the hash value of the parameters, with
+ * its own LRU list and the same memory limit as the local caches, all
+ * protected by a single LWLock.  Since keys are compared in their binary
+ * form there, parameters that are equal but not binary identical merely
+ * miss the shared cache.
+ *
  *
  * INTERFACE ROUTINES
  *		ExecMemoize			- lookup cache, exec subplan when not found
@@ -59,8 +72,10 @@
  *
  *		ExecMemoizeEstimate		estimates DSM space needed for parallel plan
  *		ExecMemoizeInitializeDSM initialize DSM for parallel plan
+ *		ExecMemoizeReInitializeDSM reinitialize DSM for fresh scan
  *		ExecMemoizeInitializeWorker attach to DSM info in parallel worker
  *		ExecMemoizeRetrieveInstrumentation get instrumentation from worker
+ *		ExecShutdownMemoize		detach from the shared cache
  *-------------------------------------------------------------------------
  */
 
@@ -69,11 +84,16 @@
 #include "common/hashfn.h"
 #include "executor/executor.h"
 #include "executor/nodeMemoize.h"
+#include "lib/dshash.h"
 #include "lib/ilist.h"
 #include "miscadmin.h"
+#include "storage/lwlock.h"
 #include "utils/datum.h"
 #include "utils/lsyscache.h"
 
+/* GUC parameter */
+bool		enable_shared_memoize = false;
+
 /* States of the ExecMemoize state machine */
 #define MEMO_CACHE_LOOKUP			1	/* Attempt to perform a cache lookup */
 #define MEMO_CACHE_FETCH_NEXT_TUPLE	2	/* Get another tuple from the cache */
@@ -90,6 +110,64 @@
 #define CACHE_TUPLE_BYTES(t)			(sizeof(MemoizeTuple) + \
 										 (t)->mintuple->t_len)
 
+/*
+ * Key under which the shared cache is stored in the DSM segment's table of
+ * contents.  The plain plan node ID is already used for the shared
+ * instrumentation.
+ */
+#define PARALLEL_KEY_MEMOIZE(plan_node_id) \
+	(UINT64CONST(0xE000000000000000) | (plan_node_id))
+
+/*
+ * SharedMemoizeCache
+ *		Control data of the cache shared by the participants of a parallel
+ *		query.  'lock' protects all of it, the hash table and the items; it
+ *		is always acquired before the hash table's partition locks.
+ */
+typedef struct SharedMemoizeCache
+{
+	LWLock		lock;
+	dshash_table_handle hash_handle;	/* the SharedMemoizeBucket table */
+	dsa_pointer lru_head;		/* least recently used item */
+	dsa_pointer lru_tail;		/* most recently used item */
+	uint64		mem_used;		/* bytes of memory used by items */
+	uint64		mem_limit;		/* memory limit in bytes for the items */
+} SharedMemoizeCache;
+
+/* Entry of the shared hash table: the items whose parameters hash to 'hash' */
+typedef struct SharedMemoizeBucket
+{
+	uint32		hash;			/* hash key, must be first */
+	dsa_pointer items;			/* first SharedMemoizeItem */
+} SharedMemoizeBucket;
+
+/*
+ * SharedMemoizeItem
+ *		The complete set of tuples for one set of parameters.  The key tuple
+ *		and then the 'ntuples' result tuples follow the header, each one
+ *		MAXALIGN'd.
+ */
+typedef struct SharedMemoizeItem
+{
+	dsa_pointer next;			/* next item in the same bucket */
+	dsa_pointer lru_prev;		/* previous item in the LRU list */
+	dsa_pointer lru_next;		/* next item in the LRU list */
+	uint32		hash;			/* hash value of the key */
+	int			ntuples;		/* number of result tuples */
+	Size		size;			/* total size of the item */
+} SharedMemoizeItem;
+
+#define SHARED_ITEM_DATA(item) \
+	((char *) (item) + MAXALIGN(sizeof(SharedMemoizeItem)))
+
+static const dshash_parameters shared_memoize_params = {
+	sizeof(uint32),
+	sizeof(SharedMemoizeBucket),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_SHARED_MEMOIZE
+};
+
  /* MemoizeTuple Stores an individually cached tuple */
 typedef struct MemoizeTuple
 {
@@ -664,6 +742,310 @@ cache_store_tuple(MemoizeState *mstate, TupleTableSlot *slot)
 	return true;
 }
 
+/*
+ * shared_cache_find
+ *		Find the shared cache item for 'key', whose hash value is 'hash'.
+ *		Returns InvalidDsaPointer if there is none.  The caller must hold the
+ *		shared cache's lock.
+ */
+static dsa_pointer
+shared_cache_find(MemoizeState *mstate, uint32 hash, MinimalTuple key)
+{
+	SharedMemoizeBucket *bucket;
+	dsa_pointer itemp = InvalidDsaPointer;
+
+	bucket = dshash_find(mstate->shared_hash, &hash, false);
+	if (bucket == NULL)
+		return InvalidDsaPointer;
+
+	for (itemp = bucket->items; DsaPointerIsValid(itemp);)
+	{
+		SharedMemoizeItem *item = dsa_get_address(mstate->shared_area, itemp);
+		MinimalTuple itemkey = (MinimalTuple) SHARED_ITEM_DATA(item);
+
+		if (itemkey->t_len == key->t_len &&
+			memcmp(itemkey, key, key->t_len) == 0)
+			break;
+		itemp = item->next;
+	}
+
+	dshash_release_lock(mstate->shared_hash, bucket);
+
+	return itemp;
+}
+
+/*
+ * shared_cache_lru_unlink
+ *		Remove 'item' from the shared cache's LRU list.
+ */
+static void
+shared_cache_lru_unlink(MemoizeState *mstate, SharedMemoizeItem *item)
+{
+	SharedMemoizeCache *sc = mstate->shared_cache;
+	SharedMemoizeItem *other;
+
+	if (DsaPointerIsValid(item->lru_prev))
+	{
+		other = dsa_get_address(mstate->shared_area, item->lru_prev);
+		other->lru_next = item->lru_next;
+	}
+	else
+		sc->lru_head = item->lru_next;
+
+	if (DsaPointerIsValid(item->lru_next))
+	{
+		other = dsa_get_address(mstate->shared_area, item->lru_next);
+		other->lru_prev = item->lru_prev;
+	}
+	else
+		sc->lru_tail = item->lru_prev;
+}
+
+/*
+ * shared_cache_lru_push
+ *		Add 'item', stored at 'itemp', to the tail of the shared cache's LRU
+ *		list.
+ */
+static void
+shared_cache_lru_push(MemoizeState *mstate, dsa_pointer itemp,
+					  SharedMemoizeItem *item)
+{
+	SharedMemoizeCache *sc = mstate->shared_cache;
+
+	item->lru_prev = sc->lru_tail;
+	item->lru_next = InvalidDsaPointer;
+
+	if (DsaPointerIsValid(sc->lru_tail))
+	{
+		SharedMemoizeItem *tail = dsa_get_address(mstate->shared_area,
+												  sc->lru_tail);
+
+		tail->lru_next = itemp;
+	}
+	else
+		sc->lru_head = itemp;
+
+	sc->lru_tail = itemp;
+}
+
+/*
+ * shared_cache_remove_item
+ *		Remove the item stored at 'itemp' from the shared cache and free it.
+ *		The caller must hold the shared cache's lock exclusively.
+ */
+static void
+shared_cache_remove_item(MemoizeState *mstate, dsa_pointer itemp)
+{
+	SharedMemoizeCache *sc = mstate->shared_cache;
+	SharedMemoizeItem *item = dsa_get_address(mstate->shared_area, itemp);
+	SharedMemoizeBucket *bucket;
+
+	bucket = dshash_find(mstate->shared_hash, &item->hash, true);
+	Assert(bucket != NULL);
+
+	if (bucket->items == itemp)
+		bucket->items = item->next;
+	else
+	{
+		SharedMemoizeItem *prev;
+
+		prev = dsa_get_address(mstate->shared_area, bucket->items);
+		while (prev->next != itemp)
+		{
+			Assert(DsaPointerIsValid(prev->next));
+			prev = dsa_get_address(mstate->shared_area, prev->next);
+		}
+		prev->next = item->next;
+	}
+
+	if (DsaPointerIsValid(bucket->items))
+		dshash_release_lock(mstate->shared_hash, bucket);
+	else
+		dshash_delete_entry(mstate->shared_hash, bucket);
+
+	shared_cache_lru_unlink(mstate, item);
+	sc->mem_used -= item->size;
+	dsa_free(mstate->shared_area, itemp);
+}
+
+/*
+ * shared_cache_purge_all
+ *		Remove all items from the shared cache.
+ */
+static void
+shared_cache_purge_all(MemoizeState *mstate)
+{
+	SharedMemoizeCache *sc = mstate->shared_cache;
+
+	LWLockAcquire(&sc->lock, LW_EXCLUSIVE);
+	while (DsaPointerIsValid(sc->lru_head))
+		shared_cache_remove_item(mstate, sc->lru_head);
+	Assert(sc->mem_used == 0);
+	LWLockRelease(&sc->lock);
+}
+
+/*
+ * shared_cache_fetch
+ *		Look for the tuples of the cache entry '*entryp' in the shared cache
+ *		and, if they are there, store them in the entry and mark it
+ *		complete.  '*entryp' must be empty or incomplete, and is updated if
+ *		the entry moves.  Returns false if the tuples were not found or could
+ *		not be stored; in the latter case '*entryp' is set to NULL, since the
+ *		entry has been evicted to make room.
+ */
+static bool
+shared_cache_fetch(MemoizeState *mstate, MemoizeEntry **entryp)
+{
+	SharedMemoizeCache *sc = mstate->shared_cache;
+	MemoizeEntry *entry = *entryp;
+	MinimalTuple key = entry->key->params;
+	TupleTableSlot *slot = mstate->ss.ps.ps_ResultTupleSlot;
+	dsa_pointer itemp;
+	char	   *copy = NULL;
+	char	   *data;
+	int			ntuples = 0;
+	bool		stored = true;
+
+	/*
+	 * Copy the item into local memory, so that we don't hold the lock while
+	 * adding its tuples to our own cache.
+	 */
+	LWLockAcquire(&sc->lock, LW_EXCLUSIVE);
+	itemp = shared_cache_find(mstate, entry->hash, key);
+	if (DsaPointerIsValid(itemp))
+	{
+		SharedMemoizeItem *item = dsa_get_address(mstate->shared_area, itemp);
+		Size		datasize = item->size - MAXALIGN(sizeof(SharedMemoizeItem));
+
+		/* Move the item to the tail of the LRU list */
+		shared_cache_lru_unlink(mstate, item);
+		shared_cache_lru_push(mstate, itemp, item);
+
+		ntuples = item->ntuples;
+		copy = palloc(datasize);
+		memcpy(copy, SHARED_ITEM_DATA(item), datasize);
+	}
+	LWLockRelease(&sc->lock);
+
+	if (copy == NULL)
+		return false;
+
+	/* Throw away the tuples of an earlier, incomplete scan */
+	entry_purge_tuples(mstate, entry);
+
+	mstate->entry = entry;
+	mstate->last_tuple = NULL;
+	data = copy + MAXALIGN(key->t_len);
+	for (int i = 0; i < ntuples; i++)
+	{
+		MinimalTuple tuple = (MinimalTuple) data;
+
+		ExecStoreMinimalTuple(tuple, slot, false);
+		if (!cache_store_tuple(mstate, slot))
+		{
+			stored = false;
+			break;
+		}
+		data += MAXALIGN(tuple->t_len);
+	}
+	ExecClearTuple(slot);
+	pfree(copy);
+
+	if (!stored)
+	{
+		mstate->entry = NULL;
+		mstate->last_tuple = NULL;
+		*entryp = NULL;
+		return false;
+	}
+
+	entry = *entryp = mstate->entry;
+	entry->complete = true;
+
+	return true;
+}
+
+/*
+ * shared_cache_publish
+ *		Add a copy of the complete cache entry 'entry' to the shared cache,
+ *		unless it is already there or too large.
+ */
+static void
+shared_cache_publish(MemoizeState *mstate, MemoizeEntry *entry)
+{
+	SharedMemoizeCache *sc = mstate->shared_cache;
+	MinimalTuple key = entry->key->params;
+	SharedMemoizeBucket *bucket;
+	SharedMemoizeItem *item;
+	MemoizeTuple *tuple;
+	dsa_pointer itemp;
+	Size		size;
+	int			ntuples = 0;
+	char	   *data;
+	bool		found;
+
+	Assert(entry->complete);
+
+	size = MAXALIGN(sizeof(SharedMemoizeItem)) + MAXALIGN(key->t_len);
+	for (tuple = entry->tuplehead; tuple != NULL; tuple = tuple->next)
+	{
+		size += MAXALIGN(tuple->mintuple->t_len);
+		ntuples++;
+	}
+
+	if (size > sc->mem_limit)
+		return;
+
+	LWLockAcquire(&sc->lock, LW_EXCLUSIVE);
+
+	/* Another participant may have published the same parameters already */
+	if (DsaPointerIsValid(shared_cache_find(mstate, entry->hash, key)))
+	{
+		LWLockRelease(&sc->lock);
+		return;
+	}
+
+	/* Evict the least recently used items until the new one fits */
+	while (sc->mem_used + size > sc->mem_limit)
+	{
+		Assert(DsaPointerIsValid(sc->lru_head));
+		shared_cache_remove_item(mstate, sc->lru_head);
+		mstate->stats.shared_evictions += 1;	/* stats update */
+	}
+
+	itemp = dsa_allocate_extended(mstate->shared_area, size,
+								  DSA_ALLOC_HUGE | DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(itemp))
+	{
+		LWLockRelease(&sc->lock);
+		return;
+	}
+
+	item = dsa_get_address(mstate->shared_area, itemp);
+	item->hash = entry->hash;
+	item->ntuples = ntuples;
+	item->size = size;
+
+	data = SHARED_ITEM_DATA(item);
+	memcpy(data, key, key->t_len);
+	data += MAXALIGN(key->t_len);
+	for (tuple = entry->tuplehead; tuple != NULL; tuple = tuple->next)
+	{
+		memcpy(data, tuple->mintuple, tuple->mintuple->t_len);
+		data += MAXALIGN(tuple->mintuple->t_len);
+	}
+
+	bucket = dshash_find_or_insert(mstate->shared_hash, &entry->hash, &found);
+	item->next = found ? bucket->items : InvalidDsaPointer;
+	bucket->items = itemp;
+	dshash_release_lock(mstate->shared_hash, bucket);
+
+	shared_cache_lru_push(mstate, itemp, item);
+	sc->mem_used += size;
+
+	LWLockRelease(&sc->lock);
+}
+
 static TupleTableSlot *
 ExecMemoize(PlanState *pstate)
 {
@@ -697,6 +1079,22 @@ ExecMemoize(PlanState *pstate)
 				/* see if we've got anything cached for the current parameters */
 				entry = cache_lookup(node, &found);
 
+				/*
+				 * If not, another participant of the parallel query may have
+				 * put them in the shared cache.
+				 */
+				if (node->use_shared_cache && entry != NULL &&
+					!(found && entry->complete))
+				{
+					if (shared_cache_fetch(node, &entry))
+					{
+						node->stats.shared_hits += 1;	/* stats update */
+						found = true;
+					}
+					else if (entry == NULL)
+						found = false;
+				}
+
 				if (found && entry->complete)
 				{
 					node->stats.cache_hits += 1;	/* stats update */
@@ -755,7 +1153,11 @@ ExecMemoize(PlanState *pstate)
 					 * scan.
 					 */
 					if (likely(entry))
+					{
 						entry->complete = true;
+						if (node->use_shared_cache)
+							shared_cache_publish(node, entry);
+					}
 
 					node->mstatus = MEMO_END_OF_SCAN;
 					return NULL;
@@ -787,8 +1189,12 @@ ExecMemoize(PlanState *pstate)
 					 * cache lookups to work even when the scan has not been
 					 * executed to completion.
 					 */
+					entry = node->entry;
 					entry->complete = node->singlerow;
 					node->mstatus = MEMO_FILLING_CACHE;
+
+					if (entry->complete && node->use_shared_cache)
+						shared_cache_publish(node, entry);
 				}
 
 				slot = node->ss.ps.ps_ResultTupleSlot;
@@ -839,6 +1245,9 @@ ExecMemoize(PlanState *pstate)
 					/* No more tuples.  Mark it as complete */
 					entry->complete = true;
 					node->mstatus = MEMO_END_OF_SCAN;
+
+					if (node->use_shared_cache)
+						shared_cache_publish(node, entry);
 					return NULL;
 				}
 
@@ -1081,6 +1490,8 @@ ExecEndMemoize(MemoizeState *node)
 		memcpy(si, &node->stats, sizeof(MemoizeInstrumentation));
 	}
 
+	ExecShutdownMemoize(node);
+
 	/* Remove the cache context */
 	MemoryContextDelete(node->tableContext);
 
@@ -1123,7 +1534,15 @@ ExecReScanMemoize(MemoizeState *node)
 	 * cache key.
 	 */
 	if (bms_nonempty_difference(outerPlan->chgParam, node->keyparamids))
+	{
 		cache_purge_all(node);
+
+		/*
+		 * The shared cache may hold tuples that other participants read with
+		 * the old values of such parameters, so stop using it.
+		 */
+		node->use_shared_cache = false;
+	}
 }
 
 /*
@@ -1154,52 +1573,120 @@ ExecMemoizeEstimate(MemoizeState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	/* don't need anything if there are no workers */
+	if (pcxt->nworkers == 0)
 		return;
 
-	size = mul_size(pcxt->nworkers, sizeof(MemoizeInstrumentation));
-	size = add_size(size, offsetof(SharedMemoizeInfo, sinstrument));
-	shm_toc_estimate_chunk(&pcxt->estimator, size);
-	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	if (node->ss.ps.instrument)
+	{
+		size = mul_size(pcxt->nworkers, sizeof(MemoizeInstrumentation));
+		size = add_size(size, offsetof(SharedMemoizeInfo, sinstrument));
+		shm_toc_estimate_chunk(&pcxt->estimator, size);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
+	if (enable_shared_memoize)
+	{
+		shm_toc_estimate_chunk(&pcxt->estimator, sizeof(SharedMemoizeCache));
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
 }
 
 /* ----------------------------------------------------------------
  *		ExecMemoizeInitializeDSM
  *
- *		Initialize DSM space for memoize statistics.
+ *		Initialize DSM space for memoize statistics and the shared cache.
  * ----------------------------------------------------------------
  */
 void
 ExecMemoizeInitializeDSM(MemoizeState *node, ParallelContext *pcxt)
 {
 	Size		size;
+	dsa_area   *area = node->ss.ps.state->es_query_dsa;
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	/* don't need anything if there are no workers */
+	if (pcxt->nworkers == 0)
 		return;
 
-	size = offsetof(SharedMemoizeInfo, sinstrument)
-		+ pcxt->nworkers * sizeof(MemoizeInstrumentation);
-	node->shared_info = shm_toc_allocate(pcxt->toc, size);
-	/* ensure any unfilled slots will contain zeroes */
-	memset(node->shared_info, 0, size);
-	node->shared_info->num_workers = pcxt->nworkers;
-	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id,
-				   node->shared_info);
+	if (node->ss.ps.instrument)
+	{
+		size = offsetof(SharedMemoizeInfo, sinstrument)
+			+ pcxt->nworkers * sizeof(MemoizeInstrumentation);
+		node->shared_info = shm_toc_allocate(pcxt->toc, size);
+		/* ensure any unfilled slots will contain zeroes */
+		memset(node->shared_info, 0, size);
+		node->shared_info->num_workers = pcxt->nworkers;
+		shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id,
+					   node->shared_info);
+	}
+
+	if (enable_shared_memoize && area != NULL)
+	{
+		SharedMemoizeCache *sc;
+
+		sc = shm_toc_allocate(pcxt->toc, sizeof(SharedMemoizeCache));
+		LWLockInitialize(&sc->lock, LWTRANCHE_SHARED_MEMOIZE);
+		sc->lru_head = InvalidDsaPointer;
+		sc->lru_tail = InvalidDsaPointer;
+		sc->mem_used = 0;
+		sc->mem_limit = node->mem_limit;
+
+		/*
+		 * The DSA area stays attached until the Gather node shuts down, which
+		 * happens after we have detached in ExecShutdownMemoize.
+		 */
+		node->shared_area = area;
+		node->shared_hash = dshash_create(area, &shared_memoize_params, NULL);
+		sc->hash_handle = dshash_get_hash_table_handle(node->shared_hash);
+		shm_toc_insert(pcxt->toc,
+					   PARALLEL_KEY_MEMOIZE(node->ss.ps.plan->plan_node_id),
+					   sc);
+		node->shared_cache = sc;
+		node->use_shared_cache = true;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecMemoizeReInitializeDSM
+ *
+ *		Empty the shared cache before the parallel query is rescanned,
+ *		since parameters that are not part of the cache key may change.
+ * ----------------------------------------------------------------
+ */
+void
+ExecMemoizeReInitializeDSM(MemoizeState *node, ParallelContext *pcxt)
+{
+	if (node->shared_cache != NULL)
+		shared_cache_purge_all(node);
 }
 
 /* ----------------------------------------------------------------
  *		ExecMemoizeInitializeWorker
  *
- *		Attach worker to DSM space for memoize statistics.
+ *		Attach worker to DSM space for memoize statistics and the shared
+ *		cache.
  * ----------------------------------------------------------------
  */
 void
 ExecMemoizeInitializeWorker(MemoizeState *node, ParallelWorkerContext *pwcxt)
 {
+	SharedMemoizeCache *sc;
+
 	node->shared_info =
 		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
+
+	sc = shm_toc_lookup(pwcxt->toc,
+						PARALLEL_KEY_MEMOIZE(node->ss.ps.plan->plan_node_id),
+						true);
+	if (sc != NULL)
+	{
+		node->shared_area = node->ss.ps.state->es_query_dsa;
+		node->shared_hash = dshash_attach(node->shared_area,
+										  &shared_memoize_params,
+										  sc->hash_handle, NULL);
+		node->shared_cache = sc;
+		node->use_shared_cache = true;
+	}
 }
 
 /* ----------------------------------------------------------------
@@ -1223,3 +1710,22 @@ ExecMemoizeRetrieveInstrumentation(MemoizeState *node)
 	memcpy(si, node->shared_info, size);
 	node->shared_info = si;
 }
+
+/* ----------------------------------------------------------------
+ *		ExecShutdownMemoize
+ *
+ *		Detach from the shared cache, before the DSA area goes away.
+ * ----------------------------------------------------------------
+ */
+void
+ExecShutdownMemoize(MemoizeState *node)
+{
+	if (node->shared_hash != NULL)
+	{
+		dshash_detach(node->shared_hash);
+		node->shared_hash = NULL;
+	}
+	node->shared_cache = NULL;
+	node->shared_area = NULL;
+	node->use_shared_cache = false;
+}
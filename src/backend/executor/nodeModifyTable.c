@@ -125,7 +125,7 @@ typedef struct ModifyTableContext
 typedef struct UpdateContext
 {
 	bool		updated;		/* did UPDATE actually occur? */
-	bool		updateIndexes;	/* index update required? */
+	TU_UpdateIndexes updateIndexes; /* Which index updates are required? */
 	bool		crossPartUpdate;	/* was it a cross-partition update? */
 
 	/*
@@ -257,6 +257,31 @@ ExecCheckPlanOutput(Relation resultRel, List *targetList)
 				 errdetail("Query has too few columns.")));
 }
 
+/*
+ * ExecInitReturningProjection
+ *		Do one-time initialization of the RETURNING projection of a result
+ *		relation.
+ *
+ * ExecInitModifyTable() leaves this until the relation is first modified,
+ * because with a generic plan for a partitioned table most of the result
+ * relations are usually never touched; see there.
+ */
+static void
+ExecInitReturningProjection(ModifyTableState *mtstate,
+							ResultRelInfo *resultRelInfo)
+{
+	Assert(resultRelInfo->ri_returningList != NIL);
+	Assert(mtstate->ps.ps_ResultTupleSlot != NULL);
+	Assert(mtstate->ps.ps_ExprContext != NULL);
+
+	resultRelInfo->ri_projectReturning =
+		ExecBuildProjectionInfo(resultRelInfo->ri_returningList,
+								mtstate->ps.ps_ExprContext,
+								mtstate->ps.ps_ResultTupleSlot,
+								&mtstate->ps,
+								RelationGetDescr(resultRelInfo->ri_RelationDesc));
+}
+
 /*
  * ExecProcessReturning --- evaluate a RETURNING list
  *
@@ -270,12 +295,18 @@ ExecCheckPlanOutput(Relation resultRel, List *targetList)
  * Returns a slot holding the result tuple
  */
 static TupleTableSlot *
-ExecProcessReturning(ResultRelInfo *resultRelInfo,
+ExecProcessReturning(ModifyTableState *mtstate,
+					 ResultRelInfo *resultRelInfo,
 					 TupleTableSlot *tupleSlot,
 					 TupleTableSlot *planSlot)
 {
-	ProjectionInfo *projectReturning = resultRelInfo->ri_projectReturning;
-	ExprContext *econtext = projectReturning->pi_exprContext;
+	ProjectionInfo *projectReturning;
+	ExprContext *econtext;
+
+	if (unlikely(resultRelInfo->ri_projectReturning == NULL))
+		ExecInitReturningProjection(mtstate, resultRelInfo);
+	projectReturning = resultRelInfo->ri_projectReturning;
+	econtext = projectReturning->pi_exprContext;
 
 	/* Make tuple and any needed join variables available to ExecProject */
 	if (tupleSlot)
@@ -1134,7 +1165,8 @@ ExecInsert(ModifyTableContext *context,
 			recheckIndexes = ExecInsertIndexTuples(resultRelInfo,
 												   slot, estate, false, true,
 												   &specConflict,
-												   arbiterIndexes);
+												   arbiterIndexes,
+												   false);
 
 			/* adjust the tuple's state accordingly */
 			table_tuple_complete_speculative(resultRelationDesc, slot,
@@ -1173,7 +1205,8 @@ ExecInsert(ModifyTableContext *context,
 			if (resultRelInfo->ri_NumIndices > 0)
 				recheckIndexes = ExecInsertIndexTuples(resultRelInfo,
 													   slot, estate, false,
-													   false, NULL, NIL);
+													   false, NULL, NIL,
+													   false);
 		}
 	}
 
@@ -1228,8 +1261,8 @@ ExecInsert(ModifyTableContext *context,
 		ExecWithCheckOptions(WCO_VIEW_CHECK, resultRelInfo, slot, estate);
 
 	/* Process RETURNING if present */
-	if (resultRelInfo->ri_projectReturning)
-		result = ExecProcessReturning(resultRelInfo, slot, planSlot);
+	if (resultRelInfo->ri_returningList != NIL)
+		result = ExecProcessReturning(mtstate, resultRelInfo, slot, planSlot);
 
 	if (inserted_tuple)
 		*inserted_tuple = slot;
@@ -1688,7 +1721,7 @@ ldelete:
 	ExecDeleteEpilogue(context, resultRelInfo, tupleid, oldtuple, changingPart);
 
 	/* Process RETURNING if present and if requested */
-	if (processReturning && resultRelInfo->ri_projectReturning)
+	if (processReturning && resultRelInfo->ri_returningList != NIL)
 	{
 		/*
 		 * We have to put the target tuple into a slot, which means first we
@@ -1716,7 +1749,8 @@ ldelete:
 			}
 		}
 
-		rslot = ExecProcessReturning(resultRelInfo, slot, context->planSlot);
+		rslot = ExecProcessReturning(context->mtstate, resultRelInfo, slot,
+									 context->planSlot);
 
 		/*
 		 * Before releasing the target tuple again, make sure rslot has a
@@ -2138,11 +2172,12 @@ ExecUpdateEpilogue(ModifyTableContext *context, UpdateContext *updateCxt,
 	ModifyTableState *mtstate = context->mtstate;
 
 	/* insert index entries for tuple if necessary */
-	if (resultRelInfo->ri_NumIndices > 0 && updateCxt->updateIndexes)
+	if (resultRelInfo->ri_NumIndices > 0 && (updateCxt->updateIndexes != TU_None))
 		recheckIndexes = ExecInsertIndexTuples(resultRelInfo,
 											   slot, context->estate,
 											   true, false,
-											   NULL, NIL);
+											   NULL, NIL,
+											   (updateCxt->updateIndexes == TU_Summarizing));
 
 	/* AFTER ROW UPDATE Triggers */
 	ExecARUpdateTriggers(context->estate, resultRelInfo,
@@ -2491,8 +2526,9 @@ redo_act:
 	list_free(recheckIndexes);
 
 	/* Process RETURNING if present */
-	if (resultRelInfo->ri_projectReturning)
-		return ExecProcessReturning(resultRelInfo, slot, context->planSlot);
+	if (resultRelInfo->ri_returningList != NIL)
+		return ExecProcessReturning(context->mtstate, resultRelInfo, slot,
+									context->planSlot);
 
 	return NULL;
 }
@@ -3729,7 +3765,8 @@ ExecModifyTable(PlanState *pstate)
 			 * ExecProcessReturning by IterateDirectModify, so no need to
 			 * provide it here.
 			 */
-			slot = ExecProcessReturning(resultRelInfo, NULL, context.planSlot);
+			slot = ExecProcessReturning(node, resultRelInfo, NULL,
+										context.planSlot);
 
 			return slot;
 		}
@@ -4226,9 +4263,6 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 	 */
 	if (node->returningLists)
 	{
-		TupleTableSlot *slot;
-		ExprContext *econtext;
-
 		/*
 		 * Initialize result tuple slot and assign its rowtype using the first
 		 * RETURNING list.  We assume the rest will look the same.
@@ -4237,15 +4271,18 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 
 		/* Set up a slot for the output of the RETURNING projection(s) */
 		ExecInitResultTupleSlotTL(&mtstate->ps, &TTSOpsVirtual);
-		slot = mtstate->ps.ps_ResultTupleSlot;
 
 		/* Need an econtext too */
 		if (mtstate->ps.ps_ExprContext == NULL)
 			ExecAssignExprContext(estate, &mtstate->ps);
-		econtext = mtstate->ps.ps_ExprContext;
 
 		/*
-		 * Build a projection for each result rel.
+		 * Each result rel needs its own projection.  With a generic plan for
+		 * a partitioned table, only a few of possibly thousands of result
+		 * rels are usually modified, so we build the projection when a rel
+		 * is first modified, see ExecProcessReturning().  FDWs may look at
+		 * ri_projectReturning to decide what to do, so foreign tables get
+		 * theirs now.
 		 */
 		resultRelInfo = mtstate->resultRelInfo;
 		foreach(l, node->returningLists)
@@ -4253,9 +4290,8 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 			List	   *rlist = (List *) lfirst(l);
 
 			resultRelInfo->ri_returningList = rlist;
-			resultRelInfo->ri_projectReturning =
-				ExecBuildProjectionInfo(rlist, econtext, slot, &mtstate->ps,
-										resultRelInfo->ri_RelationDesc->rd_att);
+			if (resultRelInfo->ri_FdwRoutine != NULL)
+				ExecInitReturningProjection(mtstate, resultRelInfo);
 			resultRelInfo++;
 		}
 	}
@@ -15,10 +15,13 @@
 /*
  * INTERFACE ROUTINES
  *		ExecSeqScan				sequentially scans a relation.
+ *		ExecSeqScanBatch		same, returning a batch of tuples.
+ *		ExecSeqScanFiltered		same as ExecSeqScan, applying runtime filters.
  *		ExecSeqNext				retrieve next tuple in sequential order.
  *		ExecInitSeqScan			creates and initializes a seqscan node.
  *		ExecEndSeqScan			releases any storage allocated.
  *		ExecReScanSeqScan		rescans the relation
+ *		ExecSeqScanAddRuntimeFilter	adds a runtime filter pushed down by a join
  *
  *		ExecSeqScanEstimate		estimates DSM space needed for parallel scan
  *		ExecSeqScanInitializeDSM initialize DSM for parallel scan
@@ -28,12 +31,18 @@
 #include "postgres.h"
 
 #include "access/relscan.h"
+#include "access/sysattr.h"
 #include "access/tableam.h"
+#include "executor/execRuntimeFilter.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSeqscan.h"
+#include "executor/tuplebatch.h"
+#include "miscadmin.h"
+#include "optimizer/optimizer.h"
 #include "utils/rel.h"
 
 static TupleTableSlot *SeqNext(SeqScanState *node);
+static void SeqScanSetProjection(SeqScanState *node);
 
 /* ----------------------------------------------------------------
  *						Scan Support
@@ -72,6 +81,7 @@ SeqNext(SeqScanState *node)
 								   estate->es_snapshot,
 								   0, NULL);
 		node->ss.ss_currentScanDesc = scandesc;
+		SeqScanSetProjection(node);
 	}
 
 	/*
@@ -82,6 +92,19 @@ SeqNext(SeqScanState *node)
 	return NULL;
 }
 
+/*
+ * SeqScanSetProjection -- tell the table AM which columns and quals the
+ * scan uses, if it cares
+ */
+static void
+SeqScanSetProjection(SeqScanState *node)
+{
+	if (node->project)
+		table_scan_set_projection(node->ss.ss_currentScanDesc,
+								  node->project_attrs,
+								  node->ss.ps.plan->qual);
+}
+
 /*
  * SeqRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
@@ -114,6 +137,99 @@ ExecSeqScan(PlanState *pstate)
 					(ExecScanRecheckMtd) SeqRecheck);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSeqScanFiltered(node)
+ *
+ *		Like ExecSeqScan, but also discards tuples rejected by the
+ *		runtime filters that joins have pushed down into the scan.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecSeqScanFiltered(PlanState *pstate)
+{
+	SeqScanState *node = castNode(SeqScanState, pstate);
+
+	for (;;)
+	{
+		TupleTableSlot *slot;
+
+		slot = ExecScan(&node->ss,
+						(ExecScanAccessMtd) SeqNext,
+						(ExecScanRecheckMtd) SeqRecheck);
+
+		/* EvalPlanQual rechecks must see the tuple the join saw */
+		if (TupIsNull(slot) || node->ss.ps.state->es_epq_active != NULL ||
+			ExecRuntimeFiltersPass(pstate, node->runtime_filters, slot))
+			return slot;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanBatch(node)
+ *
+ *		Fills the batch with the next qualifying tuples, for a parent
+ *		node that consumes batches.
+ * ----------------------------------------------------------------
+ */
+static int
+ExecSeqScanBatch(PlanState *pstate, TupleBatch *batch)
+{
+	SeqScanState *node = castNode(SeqScanState, pstate);
+
+	/*
+	 * With a vectorized qual, fetch the tuples into the batch first and then
+	 * filter them all at once.  EvalPlanQual rechecks still need ExecScan().
+	 */
+	if (node->batchqual != NULL && node->ss.ps.state->es_epq_active == NULL)
+	{
+		bool		done = false;
+
+		while (!done && !TupleBatchIsFull(batch))
+		{
+			int			start = batch->nrows;
+			int		   *sel;
+			int			nsel;
+
+			while (!TupleBatchIsFull(batch))
+			{
+				TupleTableSlot *slot;
+
+				CHECK_FOR_INTERRUPTS();
+
+				slot = SeqNext(node);
+				if (TupIsNull(slot))
+				{
+					done = true;
+					break;
+				}
+				if (node->runtime_filters != NIL &&
+					!ExecRuntimeFiltersPass(pstate, node->runtime_filters,
+											slot))
+					continue;
+				TupleBatchAddSlot(batch, slot);
+			}
+
+			nsel = ExecBatchQual(node->batchqual, batch, start, &sel);
+			InstrCountFiltered1(node, batch->nrows - start - nsel);
+			TupleBatchKeepRows(batch, start, sel, nsel);
+		}
+
+		return batch->nrows;
+	}
+
+	while (!TupleBatchIsFull(batch))
+	{
+		TupleTableSlot *slot;
+
+		slot = pstate->ExecProcNodeReal(pstate);
+		if (TupIsNull(slot))
+			break;
+		TupleBatchAddSlot(batch, slot);
+	}
+
+	return batch->nrows;
+}
+
 
 /* ----------------------------------------------------------------
  *		ExecInitSeqScan
@@ -138,6 +254,7 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	scanstate->ss.ps.plan = (Plan *) node;
 	scanstate->ss.ps.state = estate;
 	scanstate->ss.ps.ExecProcNode = ExecSeqScan;
+	scanstate->ss.ps.ExecProcNodeBatch = ExecSeqScanBatch;
 
 	/*
 	 * Miscellaneous initialization
@@ -171,6 +288,45 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	scanstate->ss.ps.qual =
 		ExecInitQual(node->scan.plan.qual, (PlanState *) scanstate);
 
+	/*
+	 * When returning batches without projection, try to evaluate the qual
+	 * vectorized.
+	 */
+	if (scanstate->ss.ps.ps_ProjInfo == NULL)
+		scanstate->batchqual =
+			ExecInitBatchQual(node->scan.plan.qual,
+							  RelationGetDescr(scanstate->ss.ss_currentRelation));
+
+	/*
+	 * If the table AM can skip the columns we don't need, collect the ones
+	 * we do need.  Give up on that if a whole-row Var needs all of them.
+	 */
+	if (scanstate->ss.ss_currentRelation->rd_tableam->scan_set_projection)
+	{
+		Bitmapset  *varattnos = NULL;
+		int			i = -1;
+
+		pull_varattnos((Node *) node->scan.plan.targetlist,
+					   node->scan.scanrelid, &varattnos);
+		pull_varattnos((Node *) node->scan.plan.qual,
+					   node->scan.scanrelid, &varattnos);
+
+		if (!bms_is_member(InvalidAttrNumber - FirstLowInvalidHeapAttributeNumber,
+						   varattnos))
+		{
+			scanstate->project = true;
+			while ((i = bms_next_member(varattnos, i)) >= 0)
+			{
+				AttrNumber	attno = i + FirstLowInvalidHeapAttributeNumber;
+
+				if (attno > 0)
+					scanstate->project_attrs =
+						bms_add_member(scanstate->project_attrs, attno);
+			}
+		}
+		bms_free(varattnos);
+	}
+
 	return scanstate;
 }
 
@@ -234,6 +390,20 @@ ExecReScanSeqScan(SeqScanState *node)
 	ExecScanReScan((ScanState *) node);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSeqScanAddRuntimeFilter
+ *
+ *		Make the scan apply a runtime filter that a join above it is
+ *		going to build.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSeqScanAddRuntimeFilter(SeqScanState *node, RuntimeFilter *rf)
+{
+	node->runtime_filters = lappend(node->runtime_filters, rf);
+	ExecSetExecProcNode(&node->ss.ps, ExecSeqScanFiltered);
+}
+
 /* ----------------------------------------------------------------
  *						Parallel Scan Support
  * ----------------------------------------------------------------
@@ -256,6 +426,8 @@ ExecSeqScanEstimate(SeqScanState *node,
 												  estate->es_snapshot);
 	shm_toc_estimate_chunk(&pcxt->estimator, node->pscan_len);
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	ExecRuntimeFiltersEstimate(node->runtime_filters, pcxt);
 }
 
 /* ----------------------------------------------------------------
@@ -278,6 +450,10 @@ ExecSeqScanInitializeDSM(SeqScanState *node,
 	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pscan);
 	node->ss.ss_currentScanDesc =
 		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	SeqScanSetProjection(node);
+
+	ExecRuntimeFiltersInitializeDSM(node->runtime_filters,
+									node->ss.ps.plan->plan_node_id, pcxt);
 }
 
 /* ----------------------------------------------------------------
@@ -294,6 +470,8 @@ ExecSeqScanReInitializeDSM(SeqScanState *node,
 
 	pscan = node->ss.ss_currentScanDesc->rs_parallel;
 	table_parallelscan_reinitialize(node->ss.ss_currentRelation, pscan);
+
+	ExecRuntimeFiltersReInitializeDSM(node->runtime_filters);
 }
 
 /* ----------------------------------------------------------------
@@ -311,4 +489,11 @@ ExecSeqScanInitializeWorker(SeqScanState *node,
 	pscan = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, false);
 	node->ss.ss_currentScanDesc =
 		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	SeqScanSetProjection(node);
+
+	node->runtime_filters =
+		ExecRuntimeFiltersInitializeWorker(&node->ss.ps, node->runtime_filters,
+										   pwcxt);
+	if (node->runtime_filters != NIL)
+		ExecSetExecProcNode(&node->ss.ps, ExecSeqScanFiltered);
 }
@@ -155,6 +155,21 @@ typedef struct WindowStatePerAggData
 
 	int64		transValueCount;	/* number of currently-aggregated rows */
 
+	/*
+	 * Partial states of the rows at the frame head, used when sliding the
+	 * frame with the combine function; see eval_windowaggregates().
+	 * frontValues[i] is the state of rows frontbase + i .. frontend - 1, and
+	 * transValue then holds only the rows from frontend on.
+	 */
+	bool		use_combine;	/* slide the frame using the combinefn? */
+	Oid			combinefn_oid;	/* valid only if use_combine */
+	FmgrInfo	combinefn;
+	MemoryContext frontcontext; /* holds frontValues and frontIsNull */
+	Datum	   *frontValues;
+	bool	   *frontIsNull;
+	int64		frontbase;		/* first row covered by frontValues */
+	int64		frontend;		/* first row not covered by frontValues */
+
 	/* Data local to eval_windowaggregates() */
 	bool		restart;		/* need to restart this agg in this cycle? */
 } WindowStatePerAggData;
@@ -172,6 +187,18 @@ static void finalize_windowaggregate(WindowAggState *winstate,
 									 WindowStatePerFunc perfuncstate,
 									 WindowStatePerAgg peraggstate,
 									 Datum *result, bool *isnull);
+static void combine_windowaggregate(WindowAggState *winstate,
+									WindowStatePerFunc perfuncstate,
+									WindowStatePerAgg peraggstate,
+									Datum value1, bool isnull1,
+									Datum value2, bool isnull2,
+									MemoryContext context,
+									Datum *result, bool *isnull);
+static void build_windowaggregate_front(WindowAggState *winstate,
+										WindowStatePerFunc perfuncstate,
+										WindowStatePerAgg peraggstate,
+										int64 startpos);
+static void reset_windowaggregate_transvalue(WindowStatePerAgg peraggstate);
 
 static void eval_windowaggregates(WindowAggState *winstate);
 static void eval_windowfunction(WindowAggState *winstate,
@@ -232,6 +259,16 @@ initialize_windowaggregate(WindowAggState *winstate,
 	peraggstate->transValueCount = 0;
 	peraggstate->resultValue = (Datum) 0;
 	peraggstate->resultValueIsNull = true;
+
+	/* The aggregation starts over at the frame head */
+	if (peraggstate->use_combine)
+	{
+		MemoryContextReset(peraggstate->frontcontext);
+		peraggstate->frontValues = NULL;
+		peraggstate->frontIsNull = NULL;
+		peraggstate->frontbase = winstate->aggregatedbase;
+		peraggstate->frontend = winstate->aggregatedbase;
+	}
 }
 
 /*
@@ -641,6 +678,187 @@ finalize_windowaggregate(WindowAggState *winstate,
 	MemoryContextSwitchTo(oldContext);
 }
 
+/*
+ * combine_windowaggregate
+ * Combine two transition values using the aggregate's combine function
+ *
+ * value1 must cover rows preceding those covered by value2.  The result is
+ * allocated in 'context'; the inputs are not modified.
+ */
+static void
+combine_windowaggregate(WindowAggState *winstate,
+						WindowStatePerFunc perfuncstate,
+						WindowStatePerAgg peraggstate,
+						Datum value1, bool isnull1,
+						Datum value2, bool isnull2,
+						MemoryContext context,
+						Datum *result, bool *isnull)
+{
+	Datum		newVal;
+	bool		newIsNull;
+	MemoryContext oldContext;
+
+	oldContext = MemoryContextSwitchTo(winstate->tmpcontext->ecxt_per_tuple_memory);
+
+	if (peraggstate->combinefn.fn_strict && (isnull1 || isnull2))
+	{
+		/*
+		 * A strict combine function treats a NULL state as empty, like
+		 * advance_combine_function() in nodeAgg.c.
+		 */
+		newVal = isnull1 ? value2 : value1;
+		newIsNull = isnull1 && isnull2;
+	}
+	else
+	{
+		LOCAL_FCINFO(fcinfo, 2);
+
+		/*
+		 * The combine function may update its first input in place if it's
+		 * called in aggregate context, so give it a copy.
+		 */
+		if (!isnull1)
+			value1 = datumCopy(value1,
+							   peraggstate->transtypeByVal,
+							   peraggstate->transtypeLen);
+
+		InitFunctionCallInfoData(*fcinfo, &(peraggstate->combinefn), 2,
+								 perfuncstate->winCollation,
+								 (void *) winstate, NULL);
+		fcinfo->args[0].value = value1;
+		fcinfo->args[0].isnull = isnull1;
+		fcinfo->args[1].value =
+			MakeExpandedObjectReadOnly(value2, isnull2,
+									   peraggstate->transtypeLen);
+		fcinfo->args[1].isnull = isnull2;
+		winstate->curaggcontext = CurrentMemoryContext;
+		newVal = FunctionCallInvoke(fcinfo);
+		winstate->curaggcontext = NULL;
+		newIsNull = fcinfo->isnull;
+	}
+
+	MemoryContextSwitchTo(context);
+	if (!newIsNull)
+		newVal = datumCopy(newVal,
+						   peraggstate->transtypeByVal,
+						   peraggstate->transtypeLen);
+	MemoryContextSwitchTo(oldContext);
+
+	*result = newVal;
+	*isnull = newIsNull;
+}
+
+/*
+ * reset_windowaggregate_transvalue
+ * Free the transition value and set it back to the initial value
+ */
+static void
+reset_windowaggregate_transvalue(WindowStatePerAgg peraggstate)
+{
+	if (!peraggstate->transtypeByVal && !peraggstate->transValueIsNull)
+	{
+		if (DatumIsReadWriteExpandedObject(peraggstate->transValue,
+										   false,
+										   peraggstate->transtypeLen))
+			DeleteExpandedObject(peraggstate->transValue);
+		else
+			pfree(DatumGetPointer(peraggstate->transValue));
+	}
+
+	if (peraggstate->initValueIsNull)
+		peraggstate->transValue = peraggstate->initValue;
+	else
+	{
+		MemoryContext oldContext;
+
+		oldContext = MemoryContextSwitchTo(peraggstate->aggcontext);
+		peraggstate->transValue = datumCopy(peraggstate->initValue,
+											peraggstate->transtypeByVal,
+											peraggstate->transtypeLen);
+		MemoryContextSwitchTo(oldContext);
+	}
+	peraggstate->transValueIsNull = peraggstate->initValueIsNull;
+	peraggstate->transValueCount = 0;
+}
+
+/*
+ * build_windowaggregate_front
+ * Move the rows from 'startpos' up to aggregatedupto into the front states
+ *
+ * The caller has found that no front states are left for the rows remaining
+ * in the frame.  We aggregate each such row on its own and combine it with
+ * the states of the rows after it, from the last row backwards, so that
+ * afterwards a front state exists for every suffix of the rows.  The
+ * transition value, which held those rows, is reset to empty.
+ *
+ * Clobbers winstate->temp_slot_2 and tmpcontext's outer tuple.
+ */
+static void
+build_windowaggregate_front(WindowAggState *winstate,
+							WindowStatePerFunc perfuncstate,
+							WindowStatePerAgg peraggstate,
+							int64 startpos)
+{
+	TupleTableSlot *slot = winstate->temp_slot_2;
+	int64		endpos = winstate->aggregatedupto;
+	int64		pos;
+	MemoryContext oldContext;
+
+	Assert(startpos <= endpos);
+
+	MemoryContextReset(peraggstate->frontcontext);
+	oldContext = MemoryContextSwitchTo(peraggstate->frontcontext);
+	peraggstate->frontValues = palloc(sizeof(Datum) * (endpos - startpos));
+	peraggstate->frontIsNull = palloc(sizeof(bool) * (endpos - startpos));
+	MemoryContextSwitchTo(oldContext);
+
+	for (pos = endpos - 1; pos >= startpos; pos--)
+	{
+		int64		i = pos - startpos;
+
+		if (!window_gettupleslot(winstate->agg_winobj, pos, slot))
+			elog(ERROR, "could not re-fetch previously fetched frame row");
+
+		/* Aggregate the row on its own */
+		reset_windowaggregate_transvalue(peraggstate);
+		winstate->tmpcontext->ecxt_outertuple = slot;
+		advance_windowaggregate(winstate, perfuncstate, peraggstate);
+
+		/* ... and combine it with the state of the rows after it */
+		if (pos == endpos - 1)
+		{
+			peraggstate->frontIsNull[i] = peraggstate->transValueIsNull;
+			if (peraggstate->transValueIsNull)
+				peraggstate->frontValues[i] = (Datum) 0;
+			else
+			{
+				oldContext = MemoryContextSwitchTo(peraggstate->frontcontext);
+				peraggstate->frontValues[i] =
+					datumCopy(peraggstate->transValue,
+							  peraggstate->transtypeByVal,
+							  peraggstate->transtypeLen);
+				MemoryContextSwitchTo(oldContext);
+			}
+		}
+		else
+			combine_windowaggregate(winstate, perfuncstate, peraggstate,
+									peraggstate->transValue,
+									peraggstate->transValueIsNull,
+									peraggstate->frontValues[i + 1],
+									peraggstate->frontIsNull[i + 1],
+									peraggstate->frontcontext,
+									&peraggstate->frontValues[i],
+									&peraggstate->frontIsNull[i]);
+
+		ResetExprContext(winstate->tmpcontext);
+	}
+	ExecClearTuple(slot);
+
+	reset_windowaggregate_transvalue(peraggstate);
+	peraggstate->frontbase = startpos;
+	peraggstate->frontend = endpos;
+}
+
 /*
  * eval_windowaggregates
  * evaluate plain aggregates being used as window functions
@@ -703,6 +921,19 @@ eval_windowaggregates(WindowAggState *winstate)
 	 * must perform the aggregation all over again for all tuples within the
 	 * new frame boundaries.
 	 *
+	 * Restarting for every row makes the cost quadratic in the frame size, so
+	 * aggregates without an inverse transition function but with a combine
+	 * function instead split their rows into two parts.  The transition value
+	 * holds the rows added at the frame tail as usual.  When a row must be
+	 * removed at the frame head and it isn't covered by a "front" state yet,
+	 * build_windowaggregate_front() moves the remaining rows of the
+	 * transition value into front states: one partial state for each row,
+	 * combining it with all the rows after it.  Removing a row then is just a
+	 * matter of moving on to the next front state, and the frame's value is
+	 * the combination of the current front state and the transition value.
+	 * Each row is thus aggregated at most twice and combined at most twice,
+	 * whatever the size of the frame.
+	 *
 	 * If there's any exclusion clause, then we may have to aggregate over a
 	 * non-contiguous set of rows, so we punt and recalculate for every row.
 	 * (For some frame end choices, it might be that the frame is always
@@ -779,7 +1010,8 @@ eval_windowaggregates(WindowAggState *winstate)
 		peraggstate = &winstate->peragg[i];
 		if (winstate->currentpos == 0 ||
 			(winstate->aggregatedbase != winstate->frameheadpos &&
-			 !OidIsValid(peraggstate->invtransfn_oid)) ||
+			 !OidIsValid(peraggstate->invtransfn_oid) &&
+			 !peraggstate->use_combine) ||
 			(winstate->frameOptions & FRAMEOPTION_EXCLUSION) ||
 			winstate->aggregatedupto <= winstate->frameheadpos)
 		{
@@ -795,7 +1027,8 @@ eval_windowaggregates(WindowAggState *winstate)
 	 * aggregatedbase to match the frame's head by removing input rows that
 	 * fell off the top of the frame from the aggregations.  This can fail,
 	 * i.e. advance_windowaggregate_base() can return false, in which case
-	 * we'll restart that aggregate below.
+	 * we'll restart that aggregate below.  Aggregates using the combine
+	 * function just need front states for the rows after the removed one.
 	 */
 	while (numaggs_restart < numaggs &&
 		   winstate->aggregatedbase < winstate->frameheadpos)
@@ -824,6 +1057,19 @@ eval_windowaggregates(WindowAggState *winstate)
 				continue;
 
 			wfuncno = peraggstate->wfuncno;
+			if (peraggstate->use_combine)
+			{
+				if (winstate->aggregatedbase >= peraggstate->frontend)
+				{
+					build_windowaggregate_front(winstate,
+												&winstate->perfunc[wfuncno],
+												peraggstate,
+												winstate->aggregatedbase + 1);
+					winstate->tmpcontext->ecxt_outertuple = temp_slot;
+				}
+				continue;
+			}
+
 			ok = advance_windowaggregate_base(winstate,
 											  &winstate->perfunc[wfuncno],
 											  peraggstate);
@@ -984,10 +1230,44 @@ next_tuple:
 		wfuncno = peraggstate->wfuncno;
 		result = &econtext->ecxt_aggvalues[wfuncno];
 		isnull = &econtext->ecxt_aggnulls[wfuncno];
-		finalize_windowaggregate(winstate,
-								 &winstate->perfunc[wfuncno],
-								 peraggstate,
-								 result, isnull);
+		if (peraggstate->use_combine &&
+			winstate->aggregatedbase < peraggstate->frontend)
+		{
+			/*
+			 * Finalize the front state of the frame head combined with the
+			 * transition value, which we replace temporarily.
+			 */
+			int64		frontpos = winstate->aggregatedbase - peraggstate->frontbase;
+			Datum		transValue = peraggstate->transValue;
+			bool		transValueIsNull = peraggstate->transValueIsNull;
+
+			if (peraggstate->transValueCount == 0)
+			{
+				peraggstate->transValue = peraggstate->frontValues[frontpos];
+				peraggstate->transValueIsNull = peraggstate->frontIsNull[frontpos];
+			}
+			else
+				combine_windowaggregate(winstate,
+										&winstate->perfunc[wfuncno],
+										peraggstate,
+										peraggstate->frontValues[frontpos],
+										peraggstate->frontIsNull[frontpos],
+										transValue, transValueIsNull,
+										econtext->ecxt_per_tuple_memory,
+										&peraggstate->transValue,
+										&peraggstate->transValueIsNull);
+			finalize_windowaggregate(winstate,
+									 &winstate->perfunc[wfuncno],
+									 peraggstate,
+									 result, isnull);
+			peraggstate->transValue = transValue;
+			peraggstate->transValueIsNull = transValueIsNull;
+		}
+		else
+			finalize_windowaggregate(winstate,
+									 &winstate->perfunc[wfuncno],
+									 peraggstate,
+									 result, isnull);
 
 		/*
 		 * save the result in case next row shares the same frame.
@@ -1350,6 +1630,8 @@ release_partition(WindowAggState *winstate)
 	{
 		if (winstate->peragg[i].aggcontext != winstate->aggcontext)
 			MemoryContextResetAndDeleteChildren(winstate->peragg[i].aggcontext);
+		if (winstate->peragg[i].use_combine)
+			MemoryContextReset(winstate->peragg[i].frontcontext);
 	}
 
 	if (winstate->buffer)
@@ -2700,6 +2982,8 @@ ExecEndWindowAgg(WindowAggState *node)
 	{
 		if (node->peragg[i].aggcontext != node->aggcontext)
 			MemoryContextDelete(node->peragg[i].aggcontext);
+		if (node->peragg[i].use_combine)
+			MemoryContextDelete(node->peragg[i].frontcontext);
 	}
 	MemoryContextDelete(node->partcontext);
 	MemoryContextDelete(node->aggcontext);
@@ -2769,12 +3053,14 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	bool		use_ma_code;
 	Oid			transfn_oid,
 				invtransfn_oid,
-				finalfn_oid;
+				finalfn_oid,
+				combinefn_oid;
 	bool		finalextra;
 	char		finalmodify;
 	Expr	   *transfnexpr,
 			   *invtransfnexpr,
-			   *finalfnexpr;
+			   *finalfnexpr,
+			   *combinefnexpr;
 	Datum		textInitVal;
 	int			i;
 	ListCell   *lc;
@@ -2845,6 +3131,31 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 		initvalAttNo = Anum_pg_aggregate_agginitval;
 	}
 
+	/*
+	 * Without an inverse transition function, a moving frame head would make
+	 * us restart the aggregation for each row.  If the aggregate has a
+	 * combine function, we can slide the frame with it instead; see
+	 * eval_windowaggregates().  That requires copying transition values, so
+	 * it's not done for INTERNAL states.  The same reasoning as above about
+	 * volatile functions and subplans applies.
+	 */
+	if (!use_ma_code &&
+		OidIsValid(aggform->aggcombinefn) &&
+		aggform->aggtranstype != INTERNALOID &&
+		!(winstate->frameOptions & (FRAMEOPTION_START_UNBOUNDED_PRECEDING |
+									FRAMEOPTION_EXCLUSION)) &&
+		!contain_volatile_functions((Node *) wfunc) &&
+		!contain_subplans((Node *) wfunc))
+	{
+		peraggstate->use_combine = true;
+		peraggstate->combinefn_oid = combinefn_oid = aggform->aggcombinefn;
+	}
+	else
+	{
+		peraggstate->use_combine = false;
+		peraggstate->combinefn_oid = combinefn_oid = InvalidOid;
+	}
+
 	/*
 	 * ExecInitWindowAgg already checked permission to call aggregate function
 	 * ... but we still need to check the component functions
@@ -2889,6 +3200,16 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 							   get_func_name(finalfn_oid));
 			InvokeFunctionExecuteHook(finalfn_oid);
 		}
+
+		if (OidIsValid(combinefn_oid))
+		{
+			aclresult = object_aclcheck(ProcedureRelationId, combinefn_oid, aggOwner,
+										 ACL_EXECUTE);
+			if (aclresult != ACLCHECK_OK)
+				aclcheck_error(aclresult, OBJECT_FUNCTION,
+							   get_func_name(combinefn_oid));
+			InvokeFunctionExecuteHook(combinefn_oid);
+		}
 	}
 
 	/*
@@ -2949,6 +3270,23 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 		fmgr_info_set_expr((Node *) finalfnexpr, &peraggstate->finalfn);
 	}
 
+	if (OidIsValid(combinefn_oid))
+	{
+		/* the combinefn takes two arguments of aggtranstype */
+		build_aggregate_transfn_expr(&aggtranstype,
+									 1,
+									 0,
+									 false,
+									 aggtranstype,
+									 wfunc->inputcollid,
+									 combinefn_oid,
+									 InvalidOid,
+									 &combinefnexpr,
+									 NULL);
+		fmgr_info(combinefn_oid, &peraggstate->combinefn);
+		fmgr_info_set_expr((Node *) combinefnexpr, &peraggstate->combinefn);
+	}
+
 	/* get info about relevant datatypes */
 	get_typlenbyval(wfunc->wintype,
 					&peraggstate->resulttypeLen,
@@ -3002,7 +3340,8 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 				 errmsg("strictness of aggregate's forward and inverse transition functions must match")));
 
 	/*
-	 * Moving aggregates use their own aggcontext.
+	 * Moving aggregates, and aggregates sliding the frame with the combine
+	 * function, use their own aggcontext.
 	 *
 	 * This is necessary because they might restart at different times, so we
 	 * might never be able to reset the shared context otherwise.  We can't
@@ -3015,7 +3354,7 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	 * they have historically been for plain aggregates, but that seems grotty
 	 * and likely to lead to memory leaks.
 	 */
-	if (OidIsValid(invtransfn_oid))
+	if (OidIsValid(invtransfn_oid) || peraggstate->use_combine)
 		peraggstate->aggcontext =
 			AllocSetContextCreate(CurrentMemoryContext,
 								  "WindowAgg Per Aggregate",
@@ -3023,6 +3362,12 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	else
 		peraggstate->aggcontext = winstate->aggcontext;
 
+	if (peraggstate->use_combine)
+		peraggstate->frontcontext =
+			AllocSetContextCreate(CurrentMemoryContext,
+								  "WindowAgg Front States",
+								  ALLOCSET_DEFAULT_SIZES);
+
 	ReleaseSysCache(aggTuple);
 
 	return peraggstate;
@@ -24,6 +24,7 @@
 #include "executor/executor.h"
 #include "executor/spi_priv.h"
 #include "miscadmin.h"
+#include "storage/proc.h"
 #include "tcop/pquery.h"
 #include "tcop/utility.h"
 #include "utils/builtins.h"
@@ -2551,9 +2552,33 @@ _SPI_execute_plan(SPIPlanPtr plan, const SPIExecuteOptions *options,
 		/*
 		 * Replan if needed, and increment plan refcount.  If it's a saved
 		 * plan, the refcount must be backed by the plan_owner.
+		 *
+		 * If we're re-executing the same generic plan in the subtransaction
+		 * where we last validated it, its locks are still held, and a much
+		 * cheaper recheck is enough.  This matters for PL/pgSQL loops that
+		 * run the same single-row query many times.
 		 */
-		cplan = GetCachedPlan(plansource, options->params,
-							  plan_owner, _SPI_current->queryEnv);
+		if (plan->locked_cplan != NULL &&
+			plan->locked_lxid == MyProc->lxid &&
+			plan->locked_subid == GetCurrentSubTransactionId() &&
+			CachedPlanIsStillValid(plansource, plan->locked_cplan,
+								   plan_owner))
+			cplan = plan->locked_cplan;
+		else
+		{
+			cplan = GetCachedPlan(plansource, options->params,
+								  plan_owner, _SPI_current->queryEnv);
+
+			if (plan->saved && list_length(plan->plancache_list) == 1 &&
+				cplan == plansource->gplan)
+			{
+				plan->locked_cplan = cplan;
+				plan->locked_lxid = MyProc->lxid;
+				plan->locked_subid = GetCurrentSubTransactionId();
+			}
+			else
+				plan->locked_cplan = NULL;
+		}
 
 		stmt_list = cplan->stmt_list;
 
@@ -54,16 +54,51 @@ static bool
 tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
 {
 	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
-	MinimalTuple tuple;
 	shm_mq_result result;
-	bool		should_free;
 
-	/* Send the tuple itself. */
-	tuple = ExecFetchSlotMinimalTuple(slot, &should_free);
-	result = shm_mq_send(tqueue->queue, tuple->t_len, tuple, false, false);
+	if (TTS_IS_HEAPTUPLE(slot) || TTS_IS_BUFFERTUPLE(slot))
+	{
+		/*
+		 * A minimal tuple is just a heap tuple with a shorter header, so
+		 * rather than building one in local memory, we send a fresh header
+		 * followed by the body of the heap tuple straight from the slot
+		 * (which, for a scan, is usually on a shared buffer page).  The
+		 * header covers t_len and the padding, so the remaining bytes start
+		 * at the same place in both formats.
+		 */
+		HeapTuple	htup = ExecFetchSlotHeapTuple(slot, false, NULL);
+		uint32		len = htup->t_len - MINIMAL_TUPLE_OFFSET;
+		union
+		{
+			uint32		t_len;
+			char		data[MAXIMUM_ALIGNOF];
+		}			header;
+		shm_mq_iovec iov[2];
+
+		StaticAssertStmt(MINIMAL_TUPLE_DATA_OFFSET >= MAXIMUM_ALIGNOF,
+						 "minimal tuple header must cover a MAXALIGN'd chunk");
+
+		memset(&header, 0, sizeof(header));
+		header.t_len = len;
+		iov[0].data = header.data;
+		iov[0].len = MAXIMUM_ALIGNOF;
+		iov[1].data = (char *) htup->t_data + MINIMAL_TUPLE_OFFSET + MAXIMUM_ALIGNOF;
+		iov[1].len = len - MAXIMUM_ALIGNOF;
+
+		result = shm_mq_sendv(tqueue->queue, iov, 2, false, false);
+	}
+	else
+	{
+		MinimalTuple tuple;
+		bool		should_free;
+
+		/* Send the tuple itself. */
+		tuple = ExecFetchSlotMinimalTuple(slot, &should_free);
+		result = shm_mq_send(tqueue->queue, tuple->t_len, tuple, false, false);
 
-	if (should_free)
-		pfree(tuple);
+		if (should_free)
+			pfree(tuple);
+	}
 
 	/* Check for failure. */
 	if (result == SHM_MQ_DETACHED)
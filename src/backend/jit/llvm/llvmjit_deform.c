@@ -22,9 +22,11 @@
 
 #include "access/htup_details.h"
 #include "access/tupdesc_details.h"
+#include "common/hashfn.h"
 #include "executor/tuptable.h"
 #include "jit/llvmjit.h"
 #include "jit/llvmjit_emit.h"
+#include "utils/memutils.h"
 
 
 /*
@@ -752,3 +754,195 @@ slot_compile_deform(LLVMJitContext *context, TupleDesc desc,
 
 	return v_deform_fn;
 }
+
+
+/*
+ * Cache of deform functions, kept across queries.
+ *
+ * The code generated by slot_compile_deform() depends only on the layout of
+ * the tuple descriptor, the type of slot and the number of columns to
+ * deform; unlike expression code it doesn't embed any pointers to
+ * per-query state.  That makes it possible to emit deform functions once per
+ * backend, into a long-lived context of their own, and to re-use them for
+ * every later query that deforms tuples of the same shape.  Repeated
+ * execution of the same statements therefore only pays for compiling the
+ * expressions themselves.
+ *
+ * The cache is looked up by a hash over everything slot_compile_deform()
+ * looks at, and entries are compared in full to guard against collisions.
+ * Its size is bounded; once full, new deform functions are compiled into
+ * the caller's context as if there were no cache.
+ */
+#define DEFORM_CACHE_MAX_ENTRIES	256
+
+typedef struct DeformCacheAttr
+{
+	int16		attlen;
+	char		attalign;
+	bool		attbyval;
+	bool		attnotnull;
+	bool		atthasmissing;
+	bool		attisdropped;
+} DeformCacheAttr;
+
+typedef struct DeformCacheEntry
+{
+	uint32		hash;			/* hash of all the fields below */
+	const TupleTableSlotOps *ops;
+	int			natts;			/* number of columns to deform */
+	int			optimize;		/* PGJIT_OPT3 or 0 */
+	int			desc_natts;		/* number of entries in attrs */
+	void	   *fn_addr;		/* address of emitted function */
+	DeformCacheAttr attrs[FLEXIBLE_ARRAY_MEMBER];
+} DeformCacheEntry;
+
+/* context that owns the cached functions, never released */
+static LLVMJitContext *deform_cache_context = NULL;
+static List *deform_cache = NIL;
+
+static DeformCacheEntry *
+deform_cache_make_key(TupleDesc desc, const TupleTableSlotOps *ops,
+					  int natts, int optimize)
+{
+	DeformCacheEntry *key;
+	Size		attrsize = desc->natts * sizeof(DeformCacheAttr);
+
+	/* zeroed, so that padding doesn't affect hashing */
+	key = palloc0(offsetof(DeformCacheEntry, attrs) + attrsize);
+	key->ops = ops;
+	key->natts = natts;
+	key->optimize = optimize;
+	key->desc_natts = desc->natts;
+
+	for (int attnum = 0; attnum < desc->natts; attnum++)
+	{
+		Form_pg_attribute att = TupleDescAttr(desc, attnum);
+		DeformCacheAttr *cattr = &key->attrs[attnum];
+
+		cattr->attlen = att->attlen;
+		cattr->attalign = att->attalign;
+		cattr->attbyval = att->attbyval;
+		cattr->attnotnull = att->attnotnull;
+		cattr->atthasmissing = att->atthasmissing;
+		cattr->attisdropped = att->attisdropped;
+	}
+
+	key->hash = hash_bytes((const unsigned char *) &key->ops,
+						   offsetof(DeformCacheEntry, fn_addr) -
+						   offsetof(DeformCacheEntry, ops));
+	key->hash ^= hash_bytes((const unsigned char *) key->attrs, attrsize);
+
+	return key;
+}
+
+static bool
+deform_cache_key_equal(DeformCacheEntry *a, DeformCacheEntry *b)
+{
+	return a->hash == b->hash &&
+		a->ops == b->ops &&
+		a->natts == b->natts &&
+		a->optimize == b->optimize &&
+		a->desc_natts == b->desc_natts &&
+		memcmp(a->attrs, b->attrs,
+			   a->desc_natts * sizeof(DeformCacheAttr)) == 0;
+}
+
+/*
+ * Return a function that deforms a tuple of type desc up to natts columns,
+ * for use by code generated in context.
+ *
+ * Like slot_compile_deform(), but the function is taken from, or added to,
+ * the backend's cache of deform functions.  Returns NULL if deforming can't
+ * be JITed for this type of slot.
+ */
+LLVMValueRef
+slot_compile_deform_cached(LLVMJitContext *context, TupleDesc desc,
+						   const TupleTableSlotOps *ops, int natts)
+{
+	DeformCacheEntry *key;
+	DeformCacheEntry *entry = NULL;
+	LLVMTypeRef param_types[1];
+	LLVMTypeRef deform_sig;
+	ListCell   *lc;
+	int			optimize = context->base.flags & PGJIT_OPT3;
+
+	/* same checks as in slot_compile_deform() */
+	if (ops == &TTSOpsVirtual)
+		return NULL;
+	if (ops != &TTSOpsHeapTuple && ops != &TTSOpsBufferHeapTuple &&
+		ops != &TTSOpsMinimalTuple)
+		return NULL;
+
+	key = deform_cache_make_key(desc, ops, natts, optimize);
+
+	foreach(lc, deform_cache)
+	{
+		DeformCacheEntry *cur = (DeformCacheEntry *) lfirst(lc);
+
+		if (deform_cache_key_equal(cur, key))
+		{
+			entry = cur;
+			break;
+		}
+	}
+
+	if (entry == NULL)
+	{
+		LLVMValueRef v_deform_fn;
+		char	   *funcname;
+		MemoryContext oldcontext;
+
+		if (list_length(deform_cache) >= DEFORM_CACHE_MAX_ENTRIES)
+		{
+			pfree(key);
+			return slot_compile_deform(context, desc, ops, natts);
+		}
+
+		if (deform_cache_context == NULL)
+			deform_cache_context =
+				MemoryContextAllocZero(TopMemoryContext, sizeof(LLVMJitContext));
+
+		/*
+		 * Throw away a module left behind by an error during an earlier
+		 * attempt, it'd contain a half-built function.
+		 */
+		if (deform_cache_context->module)
+		{
+			LLVMDisposeModule(deform_cache_context->module);
+			deform_cache_context->module = NULL;
+		}
+
+		deform_cache_context->base.flags = PGJIT_DEFORM | optimize;
+
+		v_deform_fn = slot_compile_deform(deform_cache_context, desc, ops, natts);
+		Assert(v_deform_fn != NULL);
+
+		/* has to be visible to be looked up */
+		LLVMSetLinkage(v_deform_fn, LLVMExternalLinkage);
+		funcname = pstrdup(LLVMGetValueName(v_deform_fn));
+
+		oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+		entry = palloc(offsetof(DeformCacheEntry, attrs) +
+					   key->desc_natts * sizeof(DeformCacheAttr));
+		memcpy(entry, key, offsetof(DeformCacheEntry, attrs) +
+			   key->desc_natts * sizeof(DeformCacheAttr));
+		entry->fn_addr = llvm_get_function(deform_cache_context, funcname);
+		deform_cache = lappend(deform_cache, entry);
+		MemoryContextSwitchTo(oldcontext);
+
+		/* account the work to the query that caused it */
+		InstrJitAgg(&context->base.instr, &deform_cache_context->base.instr);
+		memset(&deform_cache_context->base.instr, 0,
+			   sizeof(JitInstrumentation));
+
+		pfree(funcname);
+	}
+
+	pfree(key);
+
+	param_types[0] = l_ptr(StructTupleTableSlot);
+	deform_sig = LLVMFunctionType(LLVMVoidType(), param_types,
+								  lengthof(param_types), 0);
+
+	return l_ptr_const(entry->fn_addr, l_ptr(deform_sig));
+}
@@ -311,14 +311,15 @@ llvm_compile_expr(ExprState *state)
 					 * If the tupledesc of the to-be-deformed tuple is known,
 					 * and JITing of deforming is enabled, build deform
 					 * function specific to tupledesc and the exact number of
-					 * to-be-extracted attributes.
+					 * to-be-extracted attributes.  Such functions are cached
+					 * across queries, see slot_compile_deform_cached().
 					 */
 					if (tts_ops && desc && (context->base.flags & PGJIT_DEFORM))
 					{
 						l_jit_deform =
-							slot_compile_deform(context, desc,
-												tts_ops,
-												op->d.fetch.last_var);
+							slot_compile_deform_cached(context, desc,
+													   tts_ops,
+													   op->d.fetch.last_var);
 					}
 
 					if (l_jit_deform)
@@ -128,6 +128,15 @@ bloom_free(bloom_filter *filter)
 	pfree(filter);
 }
 
+/*
+ * Size of Bloom filter, for copying it to another place as a whole
+ */
+size_t
+bloom_size(bloom_filter *filter)
+{
+	return offsetof(bloom_filter, bitset) + filter->m / BITS_PER_BYTE;
+}
+
 /*
  * Add element to Bloom filter
  */
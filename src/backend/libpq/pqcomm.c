@@ -931,6 +931,17 @@ pq_recvbuf(void)
 	/* Ensure that we're in blocking mode */
 	socket_set_nonblocking(false);
 
+	/*
+	 * Send any output that has been held back, see ReadyForQuery().  The
+	 * client may well be waiting for it before sending anything more.
+	 */
+	if (PqSendStart < PqSendPointer && !PqCommBusy)
+	{
+		PqCommBusy = true;
+		(void) internal_flush();
+		PqCommBusy = false;
+	}
+
 	/* Can fill buffer from PqRecvLength and upwards */
 	for (;;)
 	{
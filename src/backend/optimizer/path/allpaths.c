@@ -63,6 +63,7 @@ typedef struct pushdown_safety_info
 /* These parameters are set by GUC */
 bool		enable_geqo = false;	/* just in case GUC doesn't set it */
 int			geqo_threshold;
+bool		enable_linear_join_search = false;
 int			min_parallel_table_scan_size;
 int			min_parallel_index_scan_size;
 
@@ -697,13 +698,19 @@ set_rel_consider_parallel(PlannerInfo *root, RelOptInfo *rel,
 		case RTE_CTE:
 
 			/*
-			 * CTE tuplestores aren't shared among parallel workers, so we
-			 * force all CTE scans to happen in the leader.  Also, populating
-			 * the CTE would require executing a subplan that's not available
-			 * in the worker, might be parallel-restricted, and must get
-			 * executed only once.
+			 * Populating the CTE requires executing a subplan that's not
+			 * available in the worker, might be parallel-restricted, and must
+			 * get executed only once.  So the leader reads the whole CTE into
+			 * a shared tuplestore before the workers start, which workers can
+			 * then scan cooperatively; see set_cte_pathlist().  That requires
+			 * the CTE's contents not to change during execution, which is
+			 * only guaranteed for CTEs of the top query level, since those
+			 * can't reference outer Params.
 			 */
-			return;
+			if (rte->self_reference ||
+				rte->ctelevelsup + 1 != root->query_level)
+				return;
+			break;
 
 		case RTE_NAMEDTUPLESTORE:
 
@@ -2871,7 +2878,28 @@ set_cte_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 	required_outer = rel->lateral_relids;
 
 	/* Generate appropriate path */
-	add_path(rel, create_ctescan_path(root, rel, required_outer));
+	add_path(rel, create_ctescan_path(root, rel, required_outer, 0));
+
+	/*
+	 * If possible, also generate a partial path, scanning the shared
+	 * tuplestore that the leader populates with the CTE's rows.  There's no
+	 * parallel-safe non-partial path, since a worker has no way to read all
+	 * of the CTE by itself.
+	 */
+	if (rel->consider_parallel && required_outer == NULL)
+	{
+		double		pages;
+		int			parallel_workers;
+
+		pages = ceil(rel->tuples * rel->reltarget->width / BLCKSZ);
+		parallel_workers = compute_parallel_worker(rel,
+												   (BlockNumber) Min(pages, MaxBlockNumber),
+												   -1,
+												   max_parallel_workers_per_gather);
+		if (parallel_workers > 0)
+			add_partial_path(rel, create_ctescan_path(root, rel, NULL,
+													  parallel_workers));
+	}
 }
 
 /*
@@ -3314,7 +3342,8 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 	{
 		/*
 		 * Consider the different orders in which we could join the rels,
-		 * using a plugin, GEQO, or the regular join search code.
+		 * using a plugin, linearized DP, GEQO, or the regular join search
+		 * code.
 		 *
 		 * We put the initial_rels list into a PlannerInfo field because
 		 * has_legal_joinclause() needs to look at it (ugly :-().
@@ -3323,7 +3352,18 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 
 		if (join_search_hook)
 			return (*join_search_hook) (root, levels_needed, initial_rels);
-		else if (enable_geqo && levels_needed >= geqo_threshold)
+
+		if (enable_linear_join_search && levels_needed >= geqo_threshold)
+		{
+			RelOptInfo *rel = linear_join_search(root, levels_needed,
+												 initial_rels);
+
+			if (rel != NULL)
+				return rel;
+			/* else fall back to the other methods */
+		}
+
+		if (enable_geqo && levels_needed >= geqo_threshold)
 			return geqo(root, levels_needed, initial_rels);
 		else
 			return standard_join_search(root, levels_needed, initial_rels);
@@ -125,6 +125,7 @@ double		cpu_operator_cost = DEFAULT_CPU_OPERATOR_COST;
 double		parallel_tuple_cost = DEFAULT_PARALLEL_TUPLE_COST;
 double		parallel_setup_cost = DEFAULT_PARALLEL_SETUP_COST;
 double		recursive_worktable_factor = DEFAULT_RECURSIVE_WORKTABLE_FACTOR;
+double		nestloop_min_outer_rows = 0.0;
 
 int			effective_cache_size = DEFAULT_EFFECTIVE_CACHE_SIZE;
 
@@ -148,11 +149,15 @@ bool		enable_hashjoin = true;
 bool		enable_gathermerge = true;
 bool		enable_partitionwise_join = false;
 bool		enable_partitionwise_aggregate = false;
+bool		enable_eager_aggregate = false;
+bool		enable_partitionwise_window = false;
 bool		enable_parallel_append = true;
 bool		enable_parallel_hash = true;
+bool		enable_parallel_hashagg = false;
 bool		enable_partition_pruning = true;
 bool		enable_presorted_aggregate = true;
 bool		enable_async_append = true;
+bool		enable_async_merge_append = true;
 
 typedef struct
 {
@@ -1694,6 +1699,24 @@ cost_ctescan(Path *path, PlannerInfo *root,
 	cpu_per_tuple += cpu_tuple_cost + qpqual_cost.per_tuple;
 	run_cost += cpu_per_tuple * baserel->tuples;
 
+	/* Adjust costing for parallelism, if used. */
+	if (path->parallel_workers > 0)
+	{
+		double		parallel_divisor = get_parallel_divisor(path);
+
+		/*
+		 * Before the workers start, the leader has to copy all the rows into
+		 * the shared tuplestore that is scanned cooperatively.
+		 */
+		startup_cost += cpu_tuple_cost * baserel->tuples;
+
+		/* The CPU cost is divided among all the participants */
+		run_cost /= parallel_divisor;
+
+		/* Estimated rows returned by each participant */
+		path->rows = clamp_row_est(path->rows / parallel_divisor);
+	}
+
 	/* tlist eval costs are paid per output row, not per tuple scanned */
 	startup_cost += path->pathtarget->cost.startup;
 	run_cost += path->pathtarget->cost.per_tuple * path->rows;
@@ -2806,6 +2829,33 @@ cost_agg(Path *path, PlannerInfo *root,
 	path->total_cost = total_cost;
 }
 
+/*
+ * cost_hashagg_repartition
+ *		Adds the cost of partitioning the input of a Parallel HashAgg among
+ *		the participants to 'path', which cost_agg() has already costed.
+ *
+ * Each participant writes every one of its input tuples to a shared
+ * partition, and the partitions are later read back once.  Unlike spilling,
+ * this always happens, and before any group can be returned: accrue writes
+ * to startup_cost and to total_cost, and reads only to total_cost.
+ */
+void
+cost_hashagg_repartition(Path *path, double input_tuples, int input_width)
+{
+	double		pages;
+	Cost		write_cost;
+
+	pages = relation_byte_size(input_tuples, input_width) / BLCKSZ;
+
+	write_cost = pages * seq_page_cost;
+	write_cost += input_tuples * cpu_tuple_cost;
+
+	path->startup_cost += write_cost;
+	path->total_cost += write_cost;
+	path->total_cost += pages * seq_page_cost;
+	path->total_cost += input_tuples * cpu_tuple_cost;
+}
+
 /*
  * cost_windowagg
  *		Determines and returns the cost of performing a WindowAgg plan node,
@@ -2971,6 +3021,13 @@ initial_cost_nestloop(PlannerInfo *root, JoinCostWorkspace *workspace,
 	Cost		inner_run_cost;
 	Cost		inner_rescan_run_cost;
 
+	/*
+	 * Cost the join as if the outer side produced at least
+	 * nestloop_min_outer_rows rows, so that a nested loop is only chosen if
+	 * it would not be disastrous should the estimate turn out too low.
+	 */
+	outer_path_rows = Max(outer_path_rows, nestloop_min_outer_rows);
+
 	/* estimate costs to rescan the inner relation */
 	cost_rescan(root, inner_path,
 				&inner_rescan_start_cost,
@@ -3052,6 +3109,8 @@ final_cost_nestloop(PlannerInfo *root, NestPath *path,
 		outer_path_rows = 1;
 	if (inner_path_rows <= 0)
 		inner_path_rows = 1;
+	/* See initial_cost_nestloop */
+	outer_path_rows = Max(outer_path_rows, nestloop_min_outer_rows);
 	/* Mark the path with the correct row estimate */
 	if (path->jpath.path.param_info)
 		path->jpath.path.rows = path->jpath.path.param_info->ppi_rows;
@@ -0,0 +1,297 @@
+/*-------------------------------------------------------------------------
+ *
+ * linearjoin.c
+ *	  Join order search by dynamic programming over a linear join order
+ *
+ * For queries with many jointree items, the exhaustive search done by
+ * standard_join_search() takes too long and too much memory.  Instead of
+ * considering every subset of the items, this module first puts the items
+ * into a single sequence, using a greedy heuristic that follows the join
+ * graph and prefers joins that keep intermediate results small.  It then
+ * runs dynamic programming over the contiguous subsequences of that
+ * sequence only: the join relation for items i..j is built from each pair of
+ * subsequences i..k and k+1..j.  That considers O(n^2) join relations and
+ * O(n^3) pairs of input relations, but still finds bushy join trees.
+ *
+ * This approach is known as "linearized DP"; see Neumann and Radke,
+ * "Adaptive Optimization of Very Large Join Queries", SIGMOD 2018.  Unlike
+ * GEQO, its result depends only on the query, not on a random seed.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/optimizer/path/linearjoin.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "optimizer/cost.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
+#include "utils/hsearch.h"
+
+
+static RelOptInfo **linearize_join_order(PlannerInfo *root, List *initial_rels,
+										 int nrels);
+static bool join_order_restricted(PlannerInfo *root, Relids joined_relids,
+								  RelOptInfo *rel);
+static Selectivity joined_rel_selectivity(PlannerInfo *root,
+										  Relids joined_relids,
+										  RelOptInfo *rel, bool *connected);
+
+
+/*
+ * linear_join_search
+ *	  Find joinpaths for a query by dynamic programming over a linear
+ *	  ordering of the jointree items.
+ *
+ * The arguments and result are as for standard_join_search(), except that
+ * NULL is returned if no valid join tree could be formed from the chosen
+ * ordering (because of outer join restrictions).  In that case, the state of
+ * root->join_rel_list and root->join_rel_hash is restored, so that the
+ * caller can fall back to another search method.
+ */
+RelOptInfo *
+linear_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
+{
+	RelOptInfo **order;
+	RelOptInfo **joinrels;
+	RelOptInfo *result;
+	int			savelength;
+	struct HTAB *savehash;
+	int			n = levels_needed;
+
+	Assert(root->join_rel_level == NULL);
+	Assert(list_length(initial_rels) == levels_needed);
+
+	/*
+	 * Remember the join_rel_list state, in case we fail; see geqo_eval().  A
+	 * join_rel_hash that's missing the join relations we make would be of no
+	 * use afterwards, so let find_join_rel() build a new one when needed.
+	 */
+	savelength = list_length(root->join_rel_list);
+	savehash = root->join_rel_hash;
+	root->join_rel_hash = NULL;
+
+	order = linearize_join_order(root, initial_rels, n);
+
+	/* joinrels[i * n + j] is the join relation of order[i] .. order[j] */
+	joinrels = (RelOptInfo **) palloc0(n * n * sizeof(RelOptInfo *));
+	for (int i = 0; i < n; i++)
+		joinrels[i * n + i] = order[i];
+
+	for (int len = 2; len <= n; len++)
+	{
+		for (int i = 0; i + len <= n; i++)
+		{
+			int			j = i + len - 1;
+			RelOptInfo *joinrel = NULL;
+
+			CHECK_FOR_INTERRUPTS();
+
+			for (int k = i; k < j; k++)
+			{
+				RelOptInfo *rel1 = joinrels[i * n + k];
+				RelOptInfo *rel2 = joinrels[(k + 1) * n + j];
+				RelOptInfo *rel;
+
+				if (rel1 == NULL || rel2 == NULL)
+					continue;
+
+				rel = make_join_rel(root, rel1, rel2);
+				if (rel != NULL)
+					joinrel = rel;
+			}
+
+			if (joinrel == NULL)
+				continue;
+
+			/*
+			 * All ways of building this joinrel have been considered, so
+			 * complete it as standard_join_search() does for each level.
+			 */
+			generate_partitionwise_join_paths(root, joinrel);
+			if (!bms_equal(joinrel->relids, root->all_query_rels))
+				generate_useful_gather_paths(root, joinrel, false);
+			set_cheapest(joinrel);
+
+			joinrels[i * n + j] = joinrel;
+		}
+	}
+
+	result = joinrels[n - 1];
+
+	pfree(joinrels);
+	pfree(order);
+
+	if (result == NULL)
+	{
+		/*
+		 * The join relations we made stay allocated, but must not be found
+		 * by another search.
+		 */
+		root->join_rel_list = list_truncate(root->join_rel_list, savelength);
+		root->join_rel_hash = savehash;
+	}
+
+	return result;
+}
+
+/*
+ * linearize_join_order
+ *	  Put the jointree items into the order that linear_join_search() uses.
+ *
+ * We start with the item with the fewest rows, and then repeatedly append
+ * the item that is estimated to make the smallest join with the items
+ * chosen so far.  Items that are connected to those by a join clause, and
+ * that are not kept away from them by an outer join, are preferred, so that
+ * the sequence follows the join graph and neighbouring items can be joined.
+ */
+static RelOptInfo **
+linearize_join_order(PlannerInfo *root, List *initial_rels, int nrels)
+{
+	RelOptInfo **rels;
+	RelOptInfo **order;
+	bool	   *used;
+	Relids		joined_relids = NULL;
+	double		joined_rows = 0;
+	int			first = 0;
+	int			i = 0;
+	ListCell   *lc;
+
+	rels = (RelOptInfo **) palloc(nrels * sizeof(RelOptInfo *));
+	order = (RelOptInfo **) palloc(nrels * sizeof(RelOptInfo *));
+	used = (bool *) palloc0(nrels * sizeof(bool));
+
+	foreach(lc, initial_rels)
+	{
+		rels[i] = (RelOptInfo *) lfirst(lc);
+		if (rels[i]->rows < rels[first]->rows)
+			first = i;
+		i++;
+	}
+
+	order[0] = rels[first];
+	used[first] = true;
+	joined_relids = bms_copy(rels[first]->relids);
+	joined_rows = rels[first]->rows;
+
+	for (int pos = 1; pos < nrels; pos++)
+	{
+		int			best = -1;
+		int			best_rank = 0;
+		double		best_rows = 0;
+
+		for (i = 0; i < nrels; i++)
+		{
+			bool		connected;
+			Selectivity sel;
+			double		rows;
+			int			rank;
+
+			if (used[i])
+				continue;
+
+			sel = joined_rel_selectivity(root, joined_relids, rels[i],
+										 &connected);
+			rows = clamp_row_est(joined_rows * rels[i]->rows * sel);
+
+			/* 2 = connected and legal, 1 = legal, 0 = neither */
+			rank = join_order_restricted(root, joined_relids, rels[i]) ?
+				0 : (connected ? 2 : 1);
+
+			if (best < 0 || rank > best_rank ||
+				(rank == best_rank && rows < best_rows))
+			{
+				best = i;
+				best_rank = rank;
+				best_rows = rows;
+			}
+		}
+
+		order[pos] = rels[best];
+		used[best] = true;
+		joined_relids = bms_add_members(joined_relids, rels[best]->relids);
+		joined_rows = best_rows;
+	}
+
+	pfree(rels);
+	pfree(used);
+	bms_free(joined_relids);
+
+	return order;
+}
+
+/*
+ * join_order_restricted
+ *	  Does an outer join keep 'rel' from being joined to 'joined_relids'?
+ *
+ * This is only a heuristic for linearize_join_order(); make_join_rel()
+ * decides what is actually legal.  We consider 'rel' held back if it is part
+ * of the nullable side of a special join whose other side hasn't been
+ * fully joined yet.
+ */
+static bool
+join_order_restricted(PlannerInfo *root, Relids joined_relids, RelOptInfo *rel)
+{
+	ListCell   *lc;
+
+	foreach(lc, root->join_info_list)
+	{
+		SpecialJoinInfo *sjinfo = (SpecialJoinInfo *) lfirst(lc);
+
+		if (!bms_overlap(rel->relids, sjinfo->min_righthand))
+			continue;
+		if (bms_is_subset(sjinfo->min_lefthand, rel->relids) ||
+			bms_is_subset(sjinfo->min_lefthand, joined_relids))
+			continue;
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * joined_rel_selectivity
+ *	  Estimate the selectivity of the join clauses between 'rel' and the
+ *	  relations in 'joined_relids'.
+ *
+ * *connected is set to whether there are any such clauses.
+ */
+static Selectivity
+joined_rel_selectivity(PlannerInfo *root, Relids joined_relids,
+					   RelOptInfo *rel, bool *connected)
+{
+	Relids		join_relids = bms_union(joined_relids, rel->relids);
+	List	   *clauses;
+	Selectivity sel = 1.0;
+	ListCell   *lc;
+
+	/* join clauses derived from equivalence classes ... */
+	clauses = generate_join_implied_equalities(root, join_relids,
+											   joined_relids, rel, 0);
+
+	/* ... and other join clauses that become evaluable at this join */
+	foreach(lc, rel->joininfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		if (bms_overlap(rinfo->required_relids, joined_relids) &&
+			bms_is_subset(rinfo->required_relids, join_relids))
+			clauses = lappend(clauses, rinfo);
+	}
+
+	*connected = (clauses != NIL);
+	if (clauses != NIL)
+		sel = clauselist_selectivity(root, clauses, 0, JOIN_INNER, NULL);
+
+	list_free(clauses);
+	bms_free(join_relids);
+
+	return sel;
+}
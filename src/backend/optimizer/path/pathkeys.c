@@ -22,12 +22,15 @@
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "nodes/plannodes.h"
+#include "optimizer/cost.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "partitioning/partbounds.h"
 #include "utils/lsyscache.h"
 
+/* GUC parameter */
+bool		enable_group_by_reordering = false;
 
 static bool pathkey_is_redundant(PathKey *new_pathkey, List *pathkeys);
 static bool matches_boolean_partition_clause(RestrictInfo *rinfo,
@@ -35,6 +38,10 @@ static bool matches_boolean_partition_clause(RestrictInfo *rinfo,
 											 int partkeycol);
 static Var *find_var_for_subquery_tle(RelOptInfo *rel, TargetEntry *tle);
 static bool right_merge_direction(PlannerInfo *root, PathKey *pathkey);
+static int	group_keys_reorder_by_pathkeys(List *pathkeys,
+										   List **group_pathkeys,
+										   List **group_clauses,
+										   int num_groupby_pathkeys);
 
 
 /****************************************************************************
@@ -404,6 +411,155 @@ pathkeys_count_contained_in(List *keys1, List *keys2, int *n_common)
 	return (key1 == NULL);
 }
 
+/*
+ * group_keys_reorder_by_pathkeys
+ *		Reorder GROUP BY pathkeys and clauses to match the input pathkeys.
+ *
+ * GROUP BY does not care about the order of its keys, so we can move to the
+ * front any keys that form a prefix of the given pathkeys.  The remaining
+ * keys keep their original relative order.  Only the first
+ * num_groupby_pathkeys entries of *group_pathkeys belong to the GROUP BY
+ * clause proper; any pathkeys beyond that were added for ordered aggregates
+ * and always stay at the end.  The first num_groupby_pathkeys entries of
+ * *group_pathkeys correspond one-to-one to the entries of *group_clauses.
+ *
+ * Returns the number of GROUP BY keys that now match a prefix of pathkeys,
+ * and replaces *group_pathkeys and *group_clauses with the reordered lists.
+ */
+static int
+group_keys_reorder_by_pathkeys(List *pathkeys, List **group_pathkeys,
+							   List **group_clauses,
+							   int num_groupby_pathkeys)
+{
+	List	   *new_group_pathkeys = NIL;
+	List	   *new_group_clauses = NIL;
+	ListCell   *lc;
+	int			n;
+
+	if (pathkeys == NIL || *group_pathkeys == NIL)
+		return 0;
+
+	foreach(lc, pathkeys)
+	{
+		PathKey    *pathkey = (PathKey *) lfirst(lc);
+		ListCell   *lc2;
+		int			pos = 0;
+
+		foreach(lc2, *group_pathkeys)
+		{
+			if (lfirst(lc2) == pathkey)
+				break;
+			pos++;
+		}
+
+		/* Stop at the first pathkey that isn't a GROUP BY key */
+		if (lc2 == NULL || pos >= num_groupby_pathkeys)
+			break;
+
+		new_group_pathkeys = lappend(new_group_pathkeys, pathkey);
+		new_group_clauses = lappend(new_group_clauses,
+									list_nth(*group_clauses, pos));
+	}
+
+	n = list_length(new_group_pathkeys);
+	if (n == 0)
+		return 0;
+
+	*group_pathkeys = list_concat_unique_ptr(new_group_pathkeys,
+											 *group_pathkeys);
+	*group_clauses = list_concat_unique_ptr(new_group_clauses,
+											*group_clauses);
+
+	return n;
+}
+
+/*
+ * get_useful_group_keys_orderings
+ *		Determine which orderings of GROUP BY keys are worth considering for
+ *		sorted grouping of the given input path.
+ *
+ * The first entry of the returned list is always the ordering the rest of
+ * the planner uses (root->group_pathkeys and root->processed_groupClause).
+ * If enable_group_by_reordering is on, we add:
+ *
+ * 1) an ordering matching the input path's pathkeys, so that an input
+ *	  sorted on (b, a) can be grouped by "a, b" without a Sort, or with an
+ *	  Incremental Sort if only a prefix matches;
+ *
+ * 2) orderings matching the pathkeys required later on by DISTINCT, the
+ *	  first window's PARTITION BY / ORDER BY, and ORDER BY, so that the sort
+ *	  done for grouping can be shared with those steps.
+ *
+ * Orderings identical to one already in the list are omitted.  With
+ * grouping sets, we don't reorder anything.
+ */
+List *
+get_useful_group_keys_orderings(PlannerInfo *root, Path *path)
+{
+	Query	   *parse = root->parse;
+	List	   *infos = NIL;
+	GroupByOrdering *info;
+	List	   *targets[4];
+	int			i;
+
+	/* Always return at least the original ordering */
+	info = palloc(sizeof(GroupByOrdering));
+	info->pathkeys = root->group_pathkeys;
+	info->clauses = root->processed_groupClause;
+	infos = lappend(infos, info);
+
+	if (!enable_group_by_reordering ||
+		parse->groupingSets ||
+		root->num_groupby_pathkeys < 2)
+		return infos;
+
+	targets[0] = path->pathkeys;
+	targets[1] = root->distinct_pathkeys;
+	targets[2] = root->window_pathkeys;
+	targets[3] = root->sort_pathkeys;
+
+	for (i = 0; i < lengthof(targets); i++)
+	{
+		List	   *pathkeys = root->group_pathkeys;
+		List	   *clauses = root->processed_groupClause;
+		ListCell   *lc;
+		int			n;
+
+		if (targets[i] == NIL)
+			continue;
+
+		n = group_keys_reorder_by_pathkeys(targets[i], &pathkeys, &clauses,
+										   root->num_groupby_pathkeys);
+
+		/*
+		 * For the input path's own order, a partial match is only useful if
+		 * we can finish the job with an Incremental Sort.
+		 */
+		if (n == 0 ||
+			(i == 0 && !enable_incremental_sort &&
+			 n < root->num_groupby_pathkeys))
+			continue;
+
+		/* Skip duplicates */
+		foreach(lc, infos)
+		{
+			GroupByOrdering *other = (GroupByOrdering *) lfirst(lc);
+
+			if (compare_pathkeys(pathkeys, other->pathkeys) == PATHKEYS_EQUAL)
+				break;
+		}
+		if (lc != NULL)
+			continue;
+
+		info = palloc(sizeof(GroupByOrdering));
+		info->pathkeys = pathkeys;
+		info->clauses = clauses;
+		infos = lappend(infos, info);
+	}
+
+	return infos;
+}
+
 /*
  * get_cheapest_path_for_pathkeys
  *	  Find the cheapest path (according to the specified criterion) that
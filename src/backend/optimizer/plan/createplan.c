@@ -891,6 +891,13 @@ use_physical_tlist(PlannerInfo *root, Path *path, int flags)
 		path->pathtarget->exprs == NIL)
 		return false;
 
+	/*
+	 * If the table AM can skip fetching the columns that a scan doesn't
+	 * need, a physical tlist would defeat that.
+	 */
+	if (rel->amflags & AMFLAG_HAS_PROJECTION)
+		return false;
+
 	/*
 	 * Can't do it if any system columns or whole-row Vars are requested.
 	 * (This could possibly be fixed but would take some fragile assumptions
@@ -1425,6 +1432,7 @@ create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path,
 	List	   *subplans = NIL;
 	ListCell   *subpaths;
 	RelOptInfo *rel = best_path->path.parent;
+	bool		consider_async;
 
 	/*
 	 * We don't have the actual creation of the MergeAppend node split out
@@ -1456,6 +1464,11 @@ create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path,
 									  &node->nullsFirst);
 	tlist_was_changed = (orig_tlist_length != list_length(plan->targetlist));
 
+	/* If appropriate, consider async merge append */
+	consider_async = (enable_async_merge_append &&
+					  !best_path->path.parallel_safe &&
+					  list_length(best_path->subpaths) > 1);
+
 	/*
 	 * Now prepare the child plans.  We must apply prepare_sort_from_pathkeys
 	 * even to subplans that don't need an explicit sort, to make sure they
@@ -1513,6 +1526,9 @@ create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path,
 			label_sort_with_costsize(root, sort, best_path->limit_tuples);
 			subplan = (Plan *) sort;
 		}
+		/* If needed, check to see if subplan can be executed asynchronously */
+		else if (consider_async)
+			(void) mark_async_capable_plan(subplan, subpath);
 
 		subplans = lappend(subplans, subplan);
 	}
@@ -3956,6 +3972,28 @@ create_ctescan_plan(PlannerInfo *root, Path *best_path,
 
 	copy_generic_path_info(&scan_plan->scan.plan, best_path);
 
+	/*
+	 * Parallel workers read the CTE's rows from a shared tuplestore, without
+	 * access to the CTE's plan, so tell them about its result rowtype.
+	 */
+	if (best_path->parallel_aware)
+	{
+		Plan	   *cteplan = (Plan *) list_nth(root->glob->subplans,
+												plan_id - 1);
+
+		foreach(lc, cteplan->targetlist)
+		{
+			TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+			scan_plan->ctecoltypes = lappend_oid(scan_plan->ctecoltypes,
+												 exprType((Node *) tle->expr));
+			scan_plan->ctecoltypmods = lappend_int(scan_plan->ctecoltypmods,
+												   exprTypmod((Node *) tle->expr));
+			scan_plan->ctecolcollations = lappend_oid(scan_plan->ctecolcollations,
+													  exprCollation((Node *) tle->expr));
+		}
+	}
+
 	return scan_plan;
 }
 
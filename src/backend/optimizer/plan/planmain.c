@@ -273,9 +273,22 @@ query_planner(PlannerInfo *root,
 	distribute_row_identity_vars(root);
 
 	/*
-	 * Ready to do the primary planning.
+	 * Ready to do the primary planning.  (make_one_rel() time is only
+	 * counted at the top query level, since it includes that of subqueries
+	 * in FROM.)
 	 */
-	final_rel = make_one_rel(root, joinlist);
+	if (root->query_level == 1)
+	{
+		instr_time	start,
+					end;
+
+		INSTR_TIME_SET_CURRENT(start);
+		final_rel = make_one_rel(root, joinlist);
+		INSTR_TIME_SET_CURRENT(end);
+		INSTR_TIME_ACCUM_DIFF(pgPlannerUsage.make_one_rel_time, end, start);
+	}
+	else
+		final_rel = make_one_rel(root, joinlist);
 
 	/* Check that we got at least one usable path */
 	if (!final_rel || !final_rel->cheapest_total_path ||
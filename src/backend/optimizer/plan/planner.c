@@ -20,15 +20,19 @@
 
 #include "access/genam.h"
 #include "access/htup_details.h"
+#include "access/nbtree.h"
 #include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "access/xact.h"
 #include "catalog/pg_aggregate.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_inherits.h"
+#include "catalog/pg_operator.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
+#include "commands/defrem.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
 #include "foreign/fdwapi.h"
@@ -54,10 +58,12 @@
 #include "optimizer/planmain.h"
 #include "optimizer/planner.h"
 #include "optimizer/prep.h"
+#include "optimizer/restrictinfo.h"
 #include "optimizer/subselect.h"
 #include "optimizer/tlist.h"
 #include "parser/analyze.h"
 #include "parser/parse_agg.h"
+#include "parser/parse_oper.h"
 #include "parser/parse_relation.h"
 #include "parser/parsetree.h"
 #include "partitioning/partdesc.h"
@@ -70,9 +76,12 @@
 
 /* GUC parameters */
 double		cursor_tuple_fraction = DEFAULT_CURSOR_TUPLE_FRACTION;
+bool		sort_modify_targets = false;
 int			debug_parallel_query = DEBUG_PARALLEL_OFF;
 bool		parallel_leader_participation = true;
 
+PlannerUsage pgPlannerUsage;
+
 /* Hook for plugins to get control in planner() */
 planner_hook_type planner_hook = NULL;
 
@@ -136,6 +145,8 @@ static grouping_sets_data *preprocess_grouping_sets(PlannerInfo *root);
 static List *remap_to_groupclause_idx(List *groupClause, List *gsets,
 									  int *tleref_to_colnum_map);
 static void preprocess_rowmarks(PlannerInfo *root);
+static Path *sort_by_target_ctid(PlannerInfo *root, RelOptInfo *rel,
+								 Path *path);
 static double preprocess_limit(PlannerInfo *root,
 							   double tuple_fraction,
 							   int64 *offset_est, int64 *count_est);
@@ -182,6 +193,13 @@ static RelOptInfo *create_window_paths(PlannerInfo *root,
 									   bool output_target_parallel_safe,
 									   WindowFuncLists *wflists,
 									   List *activeWindows);
+static void add_window_paths(PlannerInfo *root,
+							 RelOptInfo *window_rel,
+							 RelOptInfo *input_rel,
+							 PathTarget *input_target,
+							 PathTarget *output_target,
+							 WindowFuncLists *wflists,
+							 List *activeWindows);
 static void create_one_window_path(PlannerInfo *root,
 								   RelOptInfo *window_rel,
 								   Path *path,
@@ -189,6 +207,16 @@ static void create_one_window_path(PlannerInfo *root,
 								   PathTarget *output_target,
 								   WindowFuncLists *wflists,
 								   List *activeWindows);
+static bool windows_have_partkey(PlannerInfo *root,
+								 RelOptInfo *input_rel,
+								 List *activeWindows);
+static void create_partitionwise_window_paths(PlannerInfo *root,
+											  RelOptInfo *input_rel,
+											  RelOptInfo *window_rel,
+											  PathTarget *input_target,
+											  PathTarget *output_target,
+											  WindowFuncLists *wflists,
+											  List *activeWindows);
 static RelOptInfo *create_distinct_paths(PlannerInfo *root,
 										 RelOptInfo *input_rel);
 static void create_partial_distinct_paths(PlannerInfo *root,
@@ -228,6 +256,11 @@ static void add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 									  grouping_sets_data *gd,
 									  double dNumGroups,
 									  GroupPathExtraData *extra);
+static void add_parallel_hashagg_path(PlannerInfo *root,
+									  RelOptInfo *input_rel,
+									  RelOptInfo *grouped_rel,
+									  const AggClauseCosts *agg_costs,
+									  List *havingQual, double dNumGroups);
 static RelOptInfo *create_partial_grouping_paths(PlannerInfo *root,
 												 RelOptInfo *grouped_rel,
 												 RelOptInfo *input_rel,
@@ -236,6 +269,19 @@ static RelOptInfo *create_partial_grouping_paths(PlannerInfo *root,
 												 bool force_rel_creation);
 static void gather_grouping_paths(PlannerInfo *root, RelOptInfo *rel);
 static bool can_partial_agg(PlannerInfo *root);
+static Path *make_ordered_path(PlannerInfo *root, RelOptInfo *rel,
+							   Path *path, Path *cheapest_path,
+							   List *pathkeys);
+static Index eager_aggregation_relid(PlannerInfo *root,
+									 RelOptInfo *input_rel,
+									 RelOptInfo *grouped_rel,
+									 GroupPathExtraData *extra);
+static void add_eager_aggregation_path(PlannerInfo *root,
+									   RelOptInfo *input_rel,
+									   RelOptInfo *partially_grouped_rel,
+									   Index agg_relid,
+									   GroupPathExtraData *extra);
+static bool grouping_key_is_equalimage(Oid type, Oid collation);
 static void apply_scanjoin_target_to_paths(PlannerInfo *root,
 										   RelOptInfo *rel,
 										   List *scanjoin_targets,
@@ -282,6 +328,28 @@ planner(Query *parse, const char *query_string, int cursorOptions,
 	return result;
 }
 
+/*
+ * PlannerUsageAccumDiff
+ *		Add the difference between two PlannerUsage snapshots to dst.
+ */
+void
+PlannerUsageAccumDiff(PlannerUsage *dst, const PlannerUsage *add,
+					  const PlannerUsage *sub)
+{
+	dst->rels_built += add->rels_built - sub->rels_built;
+	dst->paths_added += add->paths_added - sub->paths_added;
+	dst->paths_discarded += add->paths_discarded - sub->paths_discarded;
+	INSTR_TIME_ACCUM_DIFF(dst->subquery_planner_time,
+						  add->subquery_planner_time,
+						  sub->subquery_planner_time);
+	INSTR_TIME_ACCUM_DIFF(dst->make_one_rel_time,
+						  add->make_one_rel_time, sub->make_one_rel_time);
+	INSTR_TIME_ACCUM_DIFF(dst->create_plan_time,
+						  add->create_plan_time, sub->create_plan_time);
+	INSTR_TIME_ACCUM_DIFF(dst->setrefs_time,
+						  add->setrefs_time, sub->setrefs_time);
+}
+
 PlannedStmt *
 standard_planner(Query *parse, const char *query_string, int cursorOptions,
 				 ParamListInfo boundParams)
@@ -295,6 +363,8 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	Plan	   *top_plan;
 	ListCell   *lp,
 			   *lr;
+	instr_time	phasestart,
+				phaseend;
 
 	/*
 	 * Set up global state for this planner invocation.  This data is needed
@@ -408,14 +478,22 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	}
 
 	/* primary planning entry point (may recurse for subqueries) */
+	INSTR_TIME_SET_CURRENT(phasestart);
 	root = subquery_planner(glob, parse, NULL,
 							false, tuple_fraction);
+	INSTR_TIME_SET_CURRENT(phaseend);
+	INSTR_TIME_ACCUM_DIFF(pgPlannerUsage.subquery_planner_time,
+						  phaseend, phasestart);
 
 	/* Select best Path and turn it into a Plan */
 	final_rel = fetch_upper_rel(root, UPPERREL_FINAL, NULL);
 	best_path = get_cheapest_fractional_path(final_rel, tuple_fraction);
 
+	phasestart = phaseend;
 	top_plan = create_plan(root, best_path);
+	INSTR_TIME_SET_CURRENT(phaseend);
+	INSTR_TIME_ACCUM_DIFF(pgPlannerUsage.create_plan_time,
+						  phaseend, phasestart);
 
 	/*
 	 * If creating a plan for a scrollable cursor, make sure it can run
@@ -501,6 +579,7 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	Assert(glob->finalrowmarks == NIL);
 	Assert(glob->resultRelations == NIL);
 	Assert(glob->appendRelations == NIL);
+	INSTR_TIME_SET_CURRENT(phasestart);
 	top_plan = set_plan_references(root, top_plan);
 	/* ... and the subplans (both regular subplans and initplans) */
 	Assert(list_length(glob->subplans) == list_length(glob->subroots));
@@ -511,6 +590,8 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 
 		lfirst(lp) = set_plan_references(subroot, subplan);
 	}
+	INSTR_TIME_SET_CURRENT(phaseend);
+	INSTR_TIME_ACCUM_DIFF(pgPlannerUsage.setrefs_time, phaseend, phasestart);
 
 	/* build the PlannedStmt result */
 	result = makeNode(PlannedStmt);
@@ -1935,6 +2016,9 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 			else
 				rowMarks = root->rowMarks;
 
+			if (sort_modify_targets)
+				path = sort_by_target_ctid(root, final_rel, path);
+
 			path = (Path *)
 				create_modifytable_path(root, final_rel,
 										path,
@@ -2328,6 +2412,66 @@ preprocess_rowmarks(PlannerInfo *root)
 	root->rowMarks = prowmarks;
 }
 
+/*
+ * sort_by_target_ctid
+ *		Sort the rows an UPDATE, DELETE or MERGE finds by the ctid of the
+ *		target row, if sort_modify_targets is set.
+ *
+ * The rows come in the order of the scan or join that finds them, which for
+ * a large UPDATE or MERGE joined to some other table means visiting the
+ * target table's pages at random, and often several times each.  Sorting
+ * them by ctid turns that into one pass over the table in physical order,
+ * with each page pinned and locked for all its rows in a row.  The order in
+ * which rows are modified is unspecified anyway, so triggers and RETURNING
+ * are not affected beyond seeing the rows in a different order.
+ *
+ * Only a plain table that is not inherited qualifies: other targets are not
+ * identified by ctid alone.
+ */
+static Path *
+sort_by_target_ctid(PlannerInfo *root, RelOptInfo *rel, Path *path)
+{
+	Query	   *parse = root->parse;
+	RangeTblEntry *rte;
+	Expr	   *ctid = NULL;
+	List	   *pathkeys;
+	ListCell   *lc;
+
+	if (parse->commandType != CMD_UPDATE &&
+		parse->commandType != CMD_DELETE &&
+		parse->commandType != CMD_MERGE)
+		return path;
+
+	rte = rt_fetch(parse->resultRelation, parse->rtable);
+	if (rte->inh || rte->relkind != RELKIND_RELATION)
+		return path;
+
+	/* find the row identity column in the path's output */
+	foreach(lc, path->pathtarget->exprs)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+
+		if (IsA(var, Var) &&
+			var->varno == parse->resultRelation &&
+			var->varattno == SelfItemPointerAttributeNumber &&
+			var->varlevelsup == 0)
+		{
+			ctid = (Expr *) var;
+			break;
+		}
+	}
+	if (ctid == NULL)
+		return path;
+
+	pathkeys = build_expression_pathkey(root, ctid, TIDLessOperator,
+										bms_make_singleton(parse->resultRelation),
+										true);
+	if (pathkeys == NIL || pathkeys_contained_in(pathkeys, path->pathkeys))
+		return path;
+
+	return (Path *) create_sort_path(root, rel, path, pathkeys, -1.0);
+}
+
 /*
  * Select RowMarkType to use for a given table
  */
@@ -4436,7 +4580,6 @@ create_window_paths(PlannerInfo *root,
 					List *activeWindows)
 {
 	RelOptInfo *window_rel;
-	ListCell   *lc;
 
 	/* For now, do all work in the (WINDOW, NULL) upperrel */
 	window_rel = fetch_upper_rel(root, UPPERREL_WINDOW, NULL);
@@ -4458,27 +4601,26 @@ create_window_paths(PlannerInfo *root,
 	window_rel->useridiscurrent = input_rel->useridiscurrent;
 	window_rel->fdwroutine = input_rel->fdwroutine;
 
+	add_window_paths(root, window_rel, input_rel, input_target, output_target,
+					 wflists, activeWindows);
+
 	/*
-	 * Consider computing window functions starting from the existing
-	 * cheapest-total path (which will likely require a sort) as well as any
-	 * existing paths that satisfy or partially satisfy root->window_pathkeys.
+	 * If the partition keys of the input relation are part of every window's
+	 * PARTITION BY clause, also consider computing the window functions for
+	 * each partition separately.  Parallel Append can then distribute whole
+	 * partitions among the workers, so gather its paths too.
 	 */
-	foreach(lc, input_rel->pathlist)
+	if (enable_partitionwise_window &&
+		IS_PARTITIONED_REL(input_rel) &&
+		!IS_UPPER_REL(input_rel) &&
+		windows_have_partkey(root, input_rel, activeWindows))
 	{
-		Path	   *path = (Path *) lfirst(lc);
-		int			presorted_keys;
-
-		if (path == input_rel->cheapest_total_path ||
-			pathkeys_count_contained_in(root->window_pathkeys, path->pathkeys,
-										&presorted_keys) ||
-			presorted_keys > 0)
-			create_one_window_path(root,
-								   window_rel,
-								   path,
-								   input_target,
-								   output_target,
-								   wflists,
-								   activeWindows);
+		window_rel->reltarget = output_target;
+		create_partitionwise_window_paths(root, input_rel, window_rel,
+										  input_target, output_target,
+										  wflists, activeWindows);
+		if (window_rel->partial_pathlist != NIL)
+			generate_useful_gather_paths(root, window_rel, false);
 	}
 
 	/*
@@ -4502,6 +4644,45 @@ create_window_paths(PlannerInfo *root,
 	return window_rel;
 }
 
+/*
+ * add_window_paths
+ *
+ * Add paths computing the window functions over input_rel to window_rel.
+ *
+ * We consider computing window functions starting from the existing
+ * cheapest-total path (which will likely require a sort) as well as any
+ * existing paths that satisfy or partially satisfy root->window_pathkeys.
+ */
+static void
+add_window_paths(PlannerInfo *root,
+				 RelOptInfo *window_rel,
+				 RelOptInfo *input_rel,
+				 PathTarget *input_target,
+				 PathTarget *output_target,
+				 WindowFuncLists *wflists,
+				 List *activeWindows)
+{
+	ListCell   *lc;
+
+	foreach(lc, input_rel->pathlist)
+	{
+		Path	   *path = (Path *) lfirst(lc);
+		int			presorted_keys;
+
+		if (path == input_rel->cheapest_total_path ||
+			pathkeys_count_contained_in(root->window_pathkeys, path->pathkeys,
+										&presorted_keys) ||
+			presorted_keys > 0)
+			create_one_window_path(root,
+								   window_rel,
+								   path,
+								   input_target,
+								   output_target,
+								   wflists,
+								   activeWindows);
+	}
+}
+
 /*
  * Stack window-function implementation steps atop the given Path, and
  * add the result to window_rel.
@@ -4633,6 +4814,157 @@ create_one_window_path(PlannerInfo *root,
 	add_path(window_rel, path);
 }
 
+/*
+ * windows_have_partkey
+ *
+ * Returns true if the partition keys of input_rel are part of the PARTITION
+ * BY clause of every window, so that no window partition spans more than one
+ * partition of the relation, and the windows can be sorted for each
+ * partition.
+ */
+static bool
+windows_have_partkey(PlannerInfo *root, RelOptInfo *input_rel,
+					 List *activeWindows)
+{
+	ListCell   *lc;
+
+	foreach(lc, activeWindows)
+	{
+		WindowClause *wc = lfirst_node(WindowClause, lc);
+		List	   *window_pathkeys;
+		ListCell   *lc2;
+
+		if (!group_by_has_partkey(input_rel, root->processed_tlist,
+								  wc->partitionClause))
+			return false;
+
+		/*
+		 * The children's sorts need equivalence class members for the sort
+		 * keys.  Those were only made for the classes that existed when the
+		 * children were set up, which include root->window_pathkeys, but not
+		 * the classes made later for the other windows' sort keys, nor any
+		 * volatile ones.
+		 */
+		window_pathkeys = make_pathkeys_for_window(root, wc,
+												   root->processed_tlist);
+		if (!pathkeys_contained_in(window_pathkeys, root->window_pathkeys))
+			return false;
+
+		foreach(lc2, window_pathkeys)
+		{
+			PathKey    *pathkey = lfirst_node(PathKey, lc2);
+
+			if (pathkey->pk_eclass->ec_has_volatile)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * create_partitionwise_window_paths
+ *
+ * If the partition keys of the input relation are part of the PARTITION BY
+ * clause of every window, all the rows of a window partition come from a
+ * single partition of the relation.  The window functions can then be
+ * computed for each partition separately, and the results appended.  Besides
+ * sorting smaller sets of rows, this allows a Parallel Append to run the
+ * window functions of different partitions in different workers.
+ */
+static void
+create_partitionwise_window_paths(PlannerInfo *root,
+								  RelOptInfo *input_rel,
+								  RelOptInfo *window_rel,
+								  PathTarget *input_target,
+								  PathTarget *output_target,
+								  WindowFuncLists *wflists,
+								  List *activeWindows)
+{
+	List	   *live_children = NIL;
+	int			i;
+
+	i = -1;
+	while ((i = bms_next_member(input_rel->live_parts, i)) >= 0)
+	{
+		RelOptInfo *child_input_rel = input_rel->part_rels[i];
+		RelOptInfo *child_window_rel;
+		PathTarget *child_input_target;
+		PathTarget *child_output_target;
+		WindowFuncLists child_wflists;
+		List	   *child_activeWindows = NIL;
+		AppendRelInfo **appinfos;
+		int			nappinfos;
+		Index		winref;
+		ListCell   *lc;
+
+		Assert(child_input_rel != NULL);
+
+		/* Dummy children can be ignored. */
+		if (IS_DUMMY_REL(child_input_rel))
+			continue;
+
+		appinfos = find_appinfos_by_relids(root, child_input_rel->relids,
+										   &nappinfos);
+
+		/* Translate the targets, window functions and run conditions. */
+		child_input_target = copy_pathtarget(input_target);
+		child_input_target->exprs = (List *)
+			adjust_appendrel_attrs(root,
+								   (Node *) input_target->exprs,
+								   nappinfos, appinfos);
+		child_output_target = copy_pathtarget(output_target);
+		child_output_target->exprs = (List *)
+			adjust_appendrel_attrs(root,
+								   (Node *) output_target->exprs,
+								   nappinfos, appinfos);
+
+		child_wflists.numWindowFuncs = wflists->numWindowFuncs;
+		child_wflists.maxWinRef = wflists->maxWinRef;
+		child_wflists.windowFuncs = (List **)
+			palloc((wflists->maxWinRef + 1) * sizeof(List *));
+		for (winref = 0; winref <= wflists->maxWinRef; winref++)
+			child_wflists.windowFuncs[winref] = (List *)
+				adjust_appendrel_attrs(root,
+									   (Node *) wflists->windowFuncs[winref],
+									   nappinfos, appinfos);
+
+		foreach(lc, activeWindows)
+		{
+			WindowClause *wc = lfirst_node(WindowClause, lc);
+			WindowClause *child_wc = makeNode(WindowClause);
+
+			memcpy(child_wc, wc, sizeof(WindowClause));
+			child_wc->runCondition = (List *)
+				adjust_appendrel_attrs(root,
+									   (Node *) wc->runCondition,
+									   nappinfos, appinfos);
+			child_activeWindows = lappend(child_activeWindows, child_wc);
+		}
+
+		/* Create the window relation of the child and its paths. */
+		child_window_rel = fetch_upper_rel(root, UPPERREL_WINDOW,
+										   child_input_rel->relids);
+		child_window_rel->reloptkind = RELOPT_OTHER_UPPER_REL;
+		child_window_rel->reltarget = child_output_target;
+		child_window_rel->consider_parallel =
+			window_rel->consider_parallel && child_input_rel->consider_parallel;
+
+		add_window_paths(root, child_window_rel, child_input_rel,
+						 child_input_target, child_output_target,
+						 &child_wflists, child_activeWindows);
+		set_cheapest(child_window_rel);
+
+		live_children = lappend(live_children, child_window_rel);
+
+		pfree(appinfos);
+	}
+
+	Assert(live_children != NIL);
+
+	add_paths_to_append_rel(root, window_rel, live_children);
+}
+
 /*
  * create_distinct_paths
  *
@@ -6620,7 +6952,9 @@ plan_cluster_use_sort(Oid tableOid, Oid indexOid)
  *		CREATE INDEX should request for use
  *
  * tableOid is the table on which the index is to be built.  indexOid is the
- * OID of an index to be created or reindexed (which must be a btree index).
+ * OID of an index to be created or reindexed (which must be an index with
+ * support for parallel builds - currently btree, GIN, GiST, hash or
+ * BRIN).
  *
  * Return value is the number of parallel worker processes to request.  It
  * may be unsafe to proceed if this is 0.  Note that this does not include the
@@ -6788,90 +7122,66 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 		 */
 		foreach(lc, input_rel->pathlist)
 		{
+			ListCell   *lc2;
 			Path	   *path = (Path *) lfirst(lc);
-			bool		is_sorted;
-			int			presorted_keys;
-
-			is_sorted = pathkeys_count_contained_in(root->group_pathkeys,
-													path->pathkeys,
-													&presorted_keys);
+			List	   *orderings = get_useful_group_keys_orderings(root, path);
 
-			if (!is_sorted)
+			/* Try each useful ordering of the GROUP BY keys */
+			foreach(lc2, orderings)
 			{
-				/*
-				 * Try at least sorting the cheapest path and also try
-				 * incrementally sorting any path which is partially sorted
-				 * already (no need to deal with paths which have presorted
-				 * keys when incremental sort is disabled unless it's the
-				 * cheapest input path).
-				 */
-				if (path != cheapest_path &&
-					(presorted_keys == 0 || !enable_incremental_sort))
+				GroupByOrdering *info = (GroupByOrdering *) lfirst(lc2);
+				Path	   *sorted_path;
+
+				sorted_path = make_ordered_path(root, grouped_rel, path,
+												cheapest_path,
+												info->pathkeys);
+				if (sorted_path == NULL)
 					continue;
 
-				/*
-				 * We've no need to consider both a sort and incremental sort.
-				 * We'll just do a sort if there are no presorted keys and an
-				 * incremental sort when there are presorted keys.
-				 */
-				if (presorted_keys == 0 || !enable_incremental_sort)
-					path = (Path *) create_sort_path(root,
-													 grouped_rel,
-													 path,
-													 root->group_pathkeys,
-													 -1.0);
+				/* Now decide what to stick atop it */
+				if (parse->groupingSets)
+				{
+					consider_groupingsets_paths(root, grouped_rel,
+												sorted_path, true, can_hash,
+												gd, agg_costs, dNumGroups);
+				}
+				else if (parse->hasAggs)
+				{
+					/*
+					 * We have aggregation, possibly with plain GROUP BY. Make
+					 * an AggPath.
+					 */
+					add_path(grouped_rel, (Path *)
+							 create_agg_path(root,
+											 grouped_rel,
+											 sorted_path,
+											 grouped_rel->reltarget,
+											 parse->groupClause ? AGG_SORTED : AGG_PLAIN,
+											 AGGSPLIT_SIMPLE,
+											 info->clauses,
+											 havingQual,
+											 agg_costs,
+											 dNumGroups));
+				}
+				else if (parse->groupClause)
+				{
+					/*
+					 * We have GROUP BY without aggregation or grouping sets.
+					 * Make a GroupPath.
+					 */
+					add_path(grouped_rel, (Path *)
+							 create_group_path(root,
+											   grouped_rel,
+											   sorted_path,
+											   info->clauses,
+											   havingQual,
+											   dNumGroups));
+				}
 				else
-					path = (Path *) create_incremental_sort_path(root,
-																 grouped_rel,
-																 path,
-																 root->group_pathkeys,
-																 presorted_keys,
-																 -1.0);
-			}
-
-			/* Now decide what to stick atop it */
-			if (parse->groupingSets)
-			{
-				consider_groupingsets_paths(root, grouped_rel,
-											path, true, can_hash,
-											gd, agg_costs, dNumGroups);
-			}
-			else if (parse->hasAggs)
-			{
-				/*
-				 * We have aggregation, possibly with plain GROUP BY. Make an
-				 * AggPath.
-				 */
-				add_path(grouped_rel, (Path *)
-						 create_agg_path(root,
-										 grouped_rel,
-										 path,
-										 grouped_rel->reltarget,
-										 parse->groupClause ? AGG_SORTED : AGG_PLAIN,
-										 AGGSPLIT_SIMPLE,
-										 root->processed_groupClause,
-										 havingQual,
-										 agg_costs,
-										 dNumGroups));
-			}
-			else if (parse->groupClause)
-			{
-				/*
-				 * We have GROUP BY without aggregation or grouping sets. Make
-				 * a GroupPath.
-				 */
-				add_path(grouped_rel, (Path *)
-						 create_group_path(root,
-										   grouped_rel,
-										   path,
-										   root->processed_groupClause,
-										   havingQual,
-										   dNumGroups));
-			}
-			else
-			{
-				/* Other cases should have been handled above */
-				Assert(false);
+				{
+					/* Other cases should have been handled above */
+					Assert(false);
+				}
 			}
 		}
 
@@ -6883,69 +7193,42 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 		{
 			foreach(lc, partially_grouped_rel->pathlist)
 			{
+				ListCell   *lc2;
 				Path	   *path = (Path *) lfirst(lc);
-				bool		is_sorted;
-				int			presorted_keys;
-
-				is_sorted = pathkeys_count_contained_in(root->group_pathkeys,
-														path->pathkeys,
-														&presorted_keys);
+				List	   *orderings = get_useful_group_keys_orderings(root, path);
 
-				if (!is_sorted)
+				foreach(lc2, orderings)
 				{
-					/*
-					 * Try at least sorting the cheapest path and also try
-					 * incrementally sorting any path which is partially
-					 * sorted already (no need to deal with paths which have
-					 * presorted keys when incremental sort is disabled unless
-					 * it's the cheapest input path).
-					 */
-					if (path != partially_grouped_rel->cheapest_total_path &&
-						(presorted_keys == 0 || !enable_incremental_sort))
+					GroupByOrdering *info = (GroupByOrdering *) lfirst(lc2);
+					Path	   *sorted_path;
+
+					sorted_path = make_ordered_path(root, grouped_rel, path,
+													partially_grouped_rel->cheapest_total_path,
+													info->pathkeys);
+					if (sorted_path == NULL)
 						continue;
 
-					/*
-					 * We've no need to consider both a sort and incremental
-					 * sort.  We'll just do a sort if there are no pre-sorted
-					 * keys and an incremental sort when there are presorted
-					 * keys.
-					 */
-					if (presorted_keys == 0 || !enable_incremental_sort)
-						path = (Path *) create_sort_path(root,
-														 grouped_rel,
-														 path,
-														 root->group_pathkeys,
-														 -1.0);
+					if (parse->hasAggs)
+						add_path(grouped_rel, (Path *)
+								 create_agg_path(root,
+												 grouped_rel,
+												 sorted_path,
+												 grouped_rel->reltarget,
+												 parse->groupClause ? AGG_SORTED : AGG_PLAIN,
+												 AGGSPLIT_FINAL_DESERIAL,
+												 info->clauses,
+												 havingQual,
+												 agg_final_costs,
+												 dNumGroups));
 					else
-						path = (Path *) create_incremental_sort_path(root,
-																	 grouped_rel,
-																	 path,
-																	 root->group_pathkeys,
-																	 presorted_keys,
-																	 -1.0);
+						add_path(grouped_rel, (Path *)
+								 create_group_path(root,
+												   grouped_rel,
+												   sorted_path,
+												   info->clauses,
+												   havingQual,
+												   dNumGroups));
 				}
-
-				if (parse->hasAggs)
-					add_path(grouped_rel, (Path *)
-							 create_agg_path(root,
-											 grouped_rel,
-											 path,
-											 grouped_rel->reltarget,
-											 parse->groupClause ? AGG_SORTED : AGG_PLAIN,
-											 AGGSPLIT_FINAL_DESERIAL,
-											 root->processed_groupClause,
-											 havingQual,
-											 agg_final_costs,
-											 dNumGroups));
-				else
-					add_path(grouped_rel, (Path *)
-							 create_group_path(root,
-											   grouped_rel,
-											   path,
-											   root->processed_groupClause,
-											   havingQual,
-											   dNumGroups));
-
 			}
 		}
 	}
@@ -6977,6 +7260,15 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 									 havingQual,
 									 agg_costs,
 									 dNumGroups));
+
+			/*
+			 * Also consider a Parallel HashAgg over the cheapest partial
+			 * input path.
+			 */
+			if (enable_parallel_hashagg && grouped_rel->consider_parallel &&
+				input_rel->partial_pathlist != NIL)
+				add_parallel_hashagg_path(root, input_rel, grouped_rel,
+										  agg_costs, havingQual, dNumGroups);
 		}
 
 		/*
@@ -7011,6 +7303,105 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 		gather_grouping_paths(root, grouped_rel);
 }
 
+/*
+ * add_parallel_hashagg_path
+ *
+ * Add a path that computes complete groups with a Parallel HashAgg over the
+ * cheapest partial path of input_rel, and gathers them.  The participants
+ * partition the input among themselves by hash value, so that each group is
+ * aggregated by just one of them; unlike partial aggregation, this doesn't
+ * need combine functions, and the leader doesn't have to finalize anything.
+ */
+static void
+add_parallel_hashagg_path(PlannerInfo *root, RelOptInfo *input_rel,
+						  RelOptInfo *grouped_rel,
+						  const AggClauseCosts *agg_costs,
+						  List *havingQual, double dNumGroups)
+{
+	Path	   *subpath = (Path *) linitial(input_rel->partial_pathlist);
+	AggPath    *agg_path;
+	double		dNumPartialGroups = dNumGroups;
+	double		total_groups;
+
+	/*
+	 * Assume the groups are spread over the participants like the input
+	 * rows.
+	 */
+	if (input_rel->rows > subpath->rows)
+		dNumPartialGroups = clamp_row_est(dNumGroups * subpath->rows /
+										  input_rel->rows);
+
+	agg_path = create_agg_path(root, grouped_rel,
+							   subpath,
+							   grouped_rel->reltarget,
+							   AGG_HASHED,
+							   AGGSPLIT_SIMPLE,
+							   root->processed_groupClause,
+							   havingQual,
+							   agg_costs,
+							   dNumPartialGroups);
+	if (!agg_path->path.parallel_safe)
+		return;
+
+	agg_path->path.parallel_aware = true;
+	cost_hashagg_repartition(&agg_path->path, subpath->rows,
+							 subpath->pathtarget->width);
+
+	total_groups = clamp_row_est(agg_path->path.rows * dNumGroups /
+								 dNumPartialGroups);
+	add_path(grouped_rel, (Path *)
+			 create_gather_path(root, grouped_rel, &agg_path->path,
+								grouped_rel->reltarget, NULL,
+								&total_groups));
+}
+
+/*
+ * make_ordered_path
+ *		Return a path ordered by 'pathkeys' based on the given 'path', or NULL
+ *		if it's not worth building one.
+ *
+ * We try at least sorting the cheapest path, and also incrementally sorting
+ * any path which is partially sorted already.  There's no need to deal with
+ * paths which have presorted keys when incremental sort is disabled, unless
+ * it's the cheapest input path.
+ */
+static Path *
+make_ordered_path(PlannerInfo *root, RelOptInfo *rel, Path *path,
+				  Path *cheapest_path, List *pathkeys)
+{
+	bool		is_sorted;
+	int			presorted_keys;
+
+	is_sorted = pathkeys_count_contained_in(pathkeys,
+											path->pathkeys,
+											&presorted_keys);
+	if (is_sorted)
+		return path;
+
+	if (path != cheapest_path &&
+		(presorted_keys == 0 || !enable_incremental_sort))
+		return NULL;
+
+	/*
+	 * We've no need to consider both a sort and incremental sort.  We'll just
+	 * do a sort if there are no presorted keys and an incremental sort when
+	 * there are presorted keys.
+	 */
+	if (presorted_keys == 0 || !enable_incremental_sort)
+		return (Path *) create_sort_path(root,
+										 rel,
+										 path,
+										 pathkeys,
+										 -1.0);
+
+	return (Path *) create_incremental_sort_path(root,
+												 rel,
+												 path,
+												 pathkeys,
+												 presorted_keys,
+												 -1.0);
+}
+
 /*
  * create_partial_grouping_paths
  *
@@ -7046,6 +7437,7 @@ create_partial_grouping_paths(PlannerInfo *root,
 	ListCell   *lc;
 	bool		can_hash = (extra->flags & GROUPING_CAN_USE_HASH) != 0;
 	bool		can_sort = (extra->flags & GROUPING_CAN_USE_SORT) != 0;
+	Index		eager_agg_relid;
 
 	/*
 	 * Consider whether we should generate partially aggregated non-partial
@@ -7066,6 +7458,13 @@ create_partial_grouping_paths(PlannerInfo *root,
 	if (grouped_rel->consider_parallel && input_rel->partial_pathlist != NIL)
 		cheapest_partial_path = linitial(input_rel->partial_pathlist);
 
+	/*
+	 * We might also be able to partially aggregate one of the joined
+	 * relations before the join.
+	 */
+	eager_agg_relid = eager_aggregation_relid(root, input_rel, grouped_rel,
+											  extra);
+
 	/*
 	 * If we can't partially aggregate partial paths, and we can't partially
 	 * aggregate non-partial paths, then don't bother creating the new
@@ -7073,6 +7472,7 @@ create_partial_grouping_paths(PlannerInfo *root,
 	 */
 	if (cheapest_total_path == NULL &&
 		cheapest_partial_path == NULL &&
+		eager_agg_relid == 0 &&
 		!force_rel_creation)
 		return NULL;
 
@@ -7148,66 +7548,42 @@ create_partial_grouping_paths(PlannerInfo *root,
 		 */
 		foreach(lc, input_rel->pathlist)
 		{
+			ListCell   *lc2;
 			Path	   *path = (Path *) lfirst(lc);
-			bool		is_sorted;
-			int			presorted_keys;
+			List	   *orderings = get_useful_group_keys_orderings(root, path);
 
-			is_sorted = pathkeys_count_contained_in(root->group_pathkeys,
-													path->pathkeys,
-													&presorted_keys);
-			if (!is_sorted)
+			foreach(lc2, orderings)
 			{
-				/*
-				 * Try at least sorting the cheapest path and also try
-				 * incrementally sorting any path which is partially sorted
-				 * already (no need to deal with paths which have presorted
-				 * keys when incremental sort is disabled unless it's the
-				 * cheapest input path).
-				 */
-				if (path != cheapest_total_path &&
-					(presorted_keys == 0 || !enable_incremental_sort))
+				GroupByOrdering *info = (GroupByOrdering *) lfirst(lc2);
+				Path	   *sorted_path;
+
+				sorted_path = make_ordered_path(root, partially_grouped_rel,
+												path, cheapest_total_path,
+												info->pathkeys);
+				if (sorted_path == NULL)
 					continue;
 
-				/*
-				 * We've no need to consider both a sort and incremental sort.
-				 * We'll just do a sort if there are no presorted keys and an
-				 * incremental sort when there are presorted keys.
-				 */
-				if (presorted_keys == 0 || !enable_incremental_sort)
-					path = (Path *) create_sort_path(root,
-													 partially_grouped_rel,
-													 path,
-													 root->group_pathkeys,
-													 -1.0);
+				if (parse->hasAggs)
+					add_path(partially_grouped_rel, (Path *)
+							 create_agg_path(root,
+											 partially_grouped_rel,
+											 sorted_path,
+											 partially_grouped_rel->reltarget,
+											 parse->groupClause ? AGG_SORTED : AGG_PLAIN,
+											 AGGSPLIT_INITIAL_SERIAL,
+											 info->clauses,
+											 NIL,
+											 agg_partial_costs,
+											 dNumPartialGroups));
 				else
-					path = (Path *) create_incremental_sort_path(root,
-																 partially_grouped_rel,
-																 path,
-																 root->group_pathkeys,
-																 presorted_keys,
-																 -1.0);
+					add_path(partially_grouped_rel, (Path *)
+							 create_group_path(root,
+											   partially_grouped_rel,
+											   sorted_path,
+											   info->clauses,
+											   NIL,
+											   dNumPartialGroups));
 			}
-
-			if (parse->hasAggs)
-				add_path(partially_grouped_rel, (Path *)
-						 create_agg_path(root,
-										 partially_grouped_rel,
-										 path,
-										 partially_grouped_rel->reltarget,
-										 parse->groupClause ? AGG_SORTED : AGG_PLAIN,
-										 AGGSPLIT_INITIAL_SERIAL,
-										 root->processed_groupClause,
-										 NIL,
-										 agg_partial_costs,
-										 dNumPartialGroups));
-			else
-				add_path(partially_grouped_rel, (Path *)
-						 create_group_path(root,
-										   partially_grouped_rel,
-										   path,
-										   root->processed_groupClause,
-										   NIL,
-										   dNumPartialGroups));
 		}
 	}
 
@@ -7216,67 +7592,42 @@ create_partial_grouping_paths(PlannerInfo *root,
 		/* Similar to above logic, but for partial paths. */
 		foreach(lc, input_rel->partial_pathlist)
 		{
+			ListCell   *lc2;
 			Path	   *path = (Path *) lfirst(lc);
-			bool		is_sorted;
-			int			presorted_keys;
+			List	   *orderings = get_useful_group_keys_orderings(root, path);
 
-			is_sorted = pathkeys_count_contained_in(root->group_pathkeys,
-													path->pathkeys,
-													&presorted_keys);
-
-			if (!is_sorted)
+			foreach(lc2, orderings)
 			{
-				/*
-				 * Try at least sorting the cheapest path and also try
-				 * incrementally sorting any path which is partially sorted
-				 * already (no need to deal with paths which have presorted
-				 * keys when incremental sort is disabled unless it's the
-				 * cheapest input path).
-				 */
-				if (path != cheapest_partial_path &&
-					(presorted_keys == 0 || !enable_incremental_sort))
+				GroupByOrdering *info = (GroupByOrdering *) lfirst(lc2);
+				Path	   *sorted_path;
+
+				sorted_path = make_ordered_path(root, partially_grouped_rel,
+												path, cheapest_partial_path,
+												info->pathkeys);
+				if (sorted_path == NULL)
 					continue;
 
-				/*
-				 * We've no need to consider both a sort and incremental sort.
-				 * We'll just do a sort if there are no presorted keys and an
-				 * incremental sort when there are presorted keys.
-				 */
-				if (presorted_keys == 0 || !enable_incremental_sort)
-					path = (Path *) create_sort_path(root,
+				if (parse->hasAggs)
+					add_partial_path(partially_grouped_rel, (Path *)
+									 create_agg_path(root,
 													 partially_grouped_rel,
-													 path,
-													 root->group_pathkeys,
-													 -1.0);
+													 sorted_path,
+													 partially_grouped_rel->reltarget,
+													 parse->groupClause ? AGG_SORTED : AGG_PLAIN,
+													 AGGSPLIT_INITIAL_SERIAL,
+													 info->clauses,
+													 NIL,
+													 agg_partial_costs,
+													 dNumPartialPartialGroups));
 				else
-					path = (Path *) create_incremental_sort_path(root,
-																 partially_grouped_rel,
-																 path,
-																 root->group_pathkeys,
-																 presorted_keys,
-																 -1.0);
+					add_partial_path(partially_grouped_rel, (Path *)
+									 create_group_path(root,
+													   partially_grouped_rel,
+													   sorted_path,
+													   info->clauses,
+													   NIL,
+													   dNumPartialPartialGroups));
 			}
-
-			if (parse->hasAggs)
-				add_partial_path(partially_grouped_rel, (Path *)
-								 create_agg_path(root,
-												 partially_grouped_rel,
-												 path,
-												 partially_grouped_rel->reltarget,
-												 parse->groupClause ? AGG_SORTED : AGG_PLAIN,
-												 AGGSPLIT_INITIAL_SERIAL,
-												 root->processed_groupClause,
-												 NIL,
-												 agg_partial_costs,
-												 dNumPartialPartialGroups));
-			else
-				add_partial_path(partially_grouped_rel, (Path *)
-								 create_group_path(root,
-												   partially_grouped_rel,
-												   path,
-												   root->processed_groupClause,
-												   NIL,
-												   dNumPartialPartialGroups));
 		}
 	}
 
@@ -7319,6 +7670,14 @@ create_partial_grouping_paths(PlannerInfo *root,
 										 dNumPartialPartialGroups));
 	}
 
+	/*
+	 * Consider partially aggregating one side of the join, and joining the
+	 * result to the other side.
+	 */
+	if (eager_agg_relid != 0)
+		add_eager_aggregation_path(root, input_rel, partially_grouped_rel,
+								   eager_agg_relid, extra);
+
 	/*
 	 * If there is an FDW that's responsible for all baserels of the query,
 	 * let it consider adding partially grouped ForeignPaths.
@@ -7466,6 +7825,335 @@ can_partial_agg(PlannerInfo *root)
 	return true;
 }
 
+/*
+ * eager_aggregation_relid
+ *
+ * Determines whether the rows of one of the relations joined in input_rel
+ * could be partially aggregated before the join, and if so, returns that
+ * relation's relid.  Returns 0 otherwise.
+ *
+ * We handle only the simplest case: an inner join of two base relations,
+ * where all the aggregates reference only one of them.  Partially
+ * aggregating that relation, grouped by all its columns that are needed
+ * by the join clauses or by the rest of the query, yields partial states
+ * that can be joined in place of the rows they summarize: all the rows in a
+ * group join to the same rows of the other relation, so combining the joined
+ * partial states gives the same result as aggregating the joined rows.  With
+ * outer joins, null-extended rows would break that equivalence.
+ *
+ * The caller has already checked that partial aggregation is possible.
+ */
+static Index
+eager_aggregation_relid(PlannerInfo *root, RelOptInfo *input_rel,
+						RelOptInfo *grouped_rel, GroupPathExtraData *extra)
+{
+	List	   *exprs;
+	Relids		agg_relids = NULL;
+	ListCell   *lc;
+	int			relid1;
+	int			relid2;
+	RelOptInfo *rel1;
+	RelOptInfo *rel2;
+
+	if (!enable_eager_aggregate || !root->parse->hasAggs)
+		return 0;
+
+	/* Only plain inner joins of two base relations, for now */
+	if (input_rel->reloptkind != RELOPT_JOINREL ||
+		bms_num_members(input_rel->relids) != 2 ||
+		root->join_info_list != NIL ||
+		root->placeholder_list != NIL ||
+		root->hasLateralRTEs)
+		return 0;
+
+	relid1 = bms_next_member(input_rel->relids, -1);
+	relid2 = bms_next_member(input_rel->relids, relid1);
+	rel1 = find_base_rel(root, relid1);
+	rel2 = find_base_rel(root, relid2);
+	if (rel1->reloptkind != RELOPT_BASEREL ||
+		rel2->reloptkind != RELOPT_BASEREL)
+		return 0;
+
+	/* All the aggregates must use the same relation, if any */
+	exprs = pull_var_clause((Node *) list_make2(grouped_rel->reltarget->exprs,
+												extra->havingQual),
+							PVC_INCLUDE_AGGREGATES |
+							PVC_RECURSE_WINDOWFUNCS |
+							PVC_INCLUDE_PLACEHOLDERS);
+	foreach(lc, exprs)
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+
+		if (IsA(expr, Aggref))
+			agg_relids = bms_add_members(agg_relids,
+										 pull_varnos(root, expr));
+	}
+
+	if (agg_relids == NULL)
+	{
+		/* Aggregates such as count(*) only; pick the bigger relation */
+		return rel1->rows >= rel2->rows ? relid1 : relid2;
+	}
+
+	if (bms_membership(agg_relids) != BMS_SINGLETON)
+		return 0;
+
+	return bms_singleton_member(agg_relids);
+}
+
+/*
+ * add_eager_aggregation_path
+ *
+ * Build a path that partially aggregates the relation agg_relid, then joins
+ * the result to the other relation of input_rel, and add it to
+ * partially_grouped_rel so that the final aggregation can be done on top of
+ * it like for any other partially grouped path.
+ *
+ * We consider only hashed partial aggregation and a hash join; the point is
+ * to join far fewer rows, and a hash join handles that well.
+ */
+static void
+add_eager_aggregation_path(PlannerInfo *root, RelOptInfo *input_rel,
+						   RelOptInfo *partially_grouped_rel,
+						   Index agg_relid, GroupPathExtraData *extra)
+{
+	RelOptInfo *agg_rel = find_base_rel(root, agg_relid);
+	RelOptInfo *other_rel;
+	RelOptInfo *agg_upper_rel;
+	RelOptInfo *join_upper_rel;
+	List	   *restrictlist;
+	List	   *hashclauses = NIL;
+	List	   *exprs;
+	List	   *group_exprs = NIL;
+	List	   *group_clauses = NIL;
+	PathTarget *input_target;
+	PathTarget *agg_target;
+	Path	   *agg_path;
+	HashPath   *join_path;
+	JoinCostWorkspace workspace;
+	JoinPathExtraData join_extra;
+	double		dNumGroups;
+	Index		sortgroupref = 0;
+	ListCell   *lc;
+
+	other_rel = find_base_rel(root,
+							  bms_singleton_member(bms_difference(input_rel->relids,
+																  agg_rel->relids)));
+
+	/* Collect the join clauses between the two relations */
+	restrictlist = generate_join_implied_equalities(root, input_rel->relids,
+													agg_rel->relids,
+													other_rel, 0);
+	foreach(lc, agg_rel->joininfo)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		if (bms_is_subset(rinfo->required_relids, input_rel->relids))
+			restrictlist = list_append_unique_ptr(restrictlist, rinfo);
+	}
+
+	/*
+	 * The relation must be grouped by all of its columns that are used above
+	 * it, except inside aggregates: those in the join clauses, and those in
+	 * the partially grouped target, which includes the grouping expressions.
+	 */
+	exprs = pull_var_clause((Node *) extract_actual_clauses(restrictlist, false),
+							PVC_RECURSE_PLACEHOLDERS);
+	exprs = list_concat(exprs,
+						pull_var_clause((Node *) partially_grouped_rel->reltarget->exprs,
+										PVC_INCLUDE_AGGREGATES |
+										PVC_RECURSE_WINDOWFUNCS |
+										PVC_RECURSE_PLACEHOLDERS));
+	foreach(lc, exprs)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+
+		if (!IsA(var, Var) || var->varno != agg_relid)
+			continue;
+		if (var->varattno == 0 || var->varlevelsup != 0)
+			return;
+		group_exprs = list_append_unique(group_exprs, var);
+	}
+
+	/*
+	 * Each grouping key needs a hashable equality operator, and values that
+	 * are equal must be indistinguishable, since the group's representative
+	 * value stands in for all of them above the aggregation.
+	 */
+	foreach(lc, group_exprs)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+		SortGroupClause *sgc;
+		Oid			eqop;
+		bool		hashable;
+
+		get_sort_group_operators(var->vartype,
+								 false, true, false,
+								 NULL, &eqop, NULL,
+								 &hashable);
+		if (!OidIsValid(eqop) || !hashable ||
+			!grouping_key_is_equalimage(var->vartype, var->varcollid))
+			return;
+
+		sgc = makeNode(SortGroupClause);
+		sgc->tleSortGroupRef = ++sortgroupref;
+		sgc->eqop = eqop;
+		sgc->sortop = InvalidOid;
+		sgc->nulls_first = false;
+		sgc->hashable = true;
+		group_clauses = lappend(group_clauses, sgc);
+	}
+
+	/* Only worth it if it at least halves the number of rows to join */
+	dNumGroups = estimate_num_groups(root, group_exprs, agg_rel->rows,
+									 NULL, NULL);
+	if (dNumGroups * 2 > agg_rel->rows)
+		return;
+
+	/* Find the hashable join clauses */
+	foreach(lc, restrictlist)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		if (!rinfo->can_join || !OidIsValid(rinfo->hashjoinoperator))
+			continue;
+
+		if (bms_is_subset(rinfo->left_relids, agg_rel->relids) &&
+			bms_is_subset(rinfo->right_relids, other_rel->relids))
+			rinfo->outer_is_left = true;
+		else if (bms_is_subset(rinfo->left_relids, other_rel->relids) &&
+				 bms_is_subset(rinfo->right_relids, agg_rel->relids))
+			rinfo->outer_is_left = false;
+		else
+			continue;
+
+		hashclauses = lappend(hashclauses, rinfo);
+	}
+	if (hashclauses == NIL)
+		return;
+
+	/*
+	 * The input of the partial aggregation must have the grouping keys
+	 * labeled, so project the relation's target with the labels added.
+	 */
+	input_target = copy_pathtarget(agg_rel->reltarget);
+	input_target->sortgrouprefs = (Index *)
+		palloc0(list_length(input_target->exprs) * sizeof(Index));
+	agg_target = create_empty_pathtarget();
+	sortgroupref = 0;
+	foreach(lc, group_exprs)
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+		ListCell   *lc2;
+		int			i = 0;
+
+		sortgroupref++;
+		foreach(lc2, input_target->exprs)
+		{
+			if (equal(lfirst(lc2), expr))
+				break;
+			i++;
+		}
+		if (lc2 == NULL)
+			return;				/* shouldn't happen */
+		input_target->sortgrouprefs[i] = sortgroupref;
+
+		add_column_to_pathtarget(agg_target, (Expr *) expr, sortgroupref);
+	}
+
+	/* The partial aggregates are the same as in partially_grouped_rel */
+	foreach(lc, partially_grouped_rel->reltarget->exprs)
+	{
+		Expr	   *expr = (Expr *) lfirst(lc);
+
+		if (IsA(expr, Aggref))
+			add_column_to_pathtarget(agg_target, expr, 0);
+	}
+	agg_target = set_pathtarget_cost_width(root, agg_target);
+
+	/*
+	 * Use separate upper rels for the grouped relation and for the join, so
+	 * that the paths get correct row estimates.  The join output is reduced
+	 * in proportion to the rows of agg_rel that were grouped together.
+	 */
+	agg_upper_rel = fetch_upper_rel(root, UPPERREL_PARTIAL_GROUP_AGG,
+									agg_rel->relids);
+	agg_upper_rel->reltarget = agg_target;
+	agg_upper_rel->rows = dNumGroups;
+
+	join_upper_rel = fetch_upper_rel(root, UPPERREL_PARTIAL_GROUP_AGG,
+									 input_rel->relids);
+	join_upper_rel->reltarget = partially_grouped_rel->reltarget;
+	join_upper_rel->rows = clamp_row_est(input_rel->rows * dNumGroups /
+										 clamp_row_est(agg_rel->rows));
+
+	agg_path = (Path *) create_projection_path(root, agg_upper_rel,
+											   agg_rel->cheapest_total_path,
+											   input_target);
+	agg_path = (Path *) create_agg_path(root,
+										agg_upper_rel,
+										agg_path,
+										agg_target,
+										AGG_HASHED,
+										AGGSPLIT_INITIAL_SERIAL,
+										group_clauses,
+										NIL,
+										&extra->agg_partial_costs,
+										dNumGroups);
+
+	MemSet(&join_extra, 0, sizeof(JoinPathExtraData));
+	join_extra.restrictlist = restrictlist;
+	join_extra.inner_unique = false;
+
+	initial_cost_hashjoin(root, &workspace, JOIN_INNER, hashclauses,
+						  agg_path, other_rel->cheapest_total_path,
+						  &join_extra, false);
+	join_path = create_hashjoin_path(root,
+									 join_upper_rel,
+									 JOIN_INNER,
+									 &workspace,
+									 &join_extra,
+									 agg_path,
+									 other_rel->cheapest_total_path,
+									 false,
+									 restrictlist,
+									 NULL,
+									 hashclauses);
+
+	add_path(partially_grouped_rel, (Path *) join_path);
+	set_cheapest(partially_grouped_rel);
+}
+
+/*
+ * grouping_key_is_equalimage
+ *
+ * Is equality of the given type, under the given collation, the same as
+ * the values being indistinguishable?  This uses the same test as
+ * deduplication in btree indexes.
+ */
+static bool
+grouping_key_is_equalimage(Oid type, Oid collation)
+{
+	Oid			opclass;
+	Oid			opfamily;
+	Oid			opcintype;
+	Oid			equalimageproc;
+
+	opclass = GetDefaultOpClass(type, BTREE_AM_OID);
+	if (!OidIsValid(opclass))
+		return false;
+
+	opfamily = get_opclass_family(opclass);
+	opcintype = get_opclass_input_type(opclass);
+	equalimageproc = get_opfamily_proc(opfamily, opcintype, opcintype,
+									   BTEQUALIMAGE_PROC);
+	if (!OidIsValid(equalimageproc))
+		return false;
+
+	return DatumGetBool(OidFunctionCall1Coll(equalimageproc, collation,
+											 ObjectIdGetDatum(opcintype)));
+}
+
 /*
  * apply_scanjoin_target_to_paths
  *
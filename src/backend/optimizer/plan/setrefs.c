@@ -2475,6 +2475,14 @@ set_param_references(PlannerInfo *root, Plan *plan)
 				SubPlan    *initsubplan = (SubPlan *) lfirst(l);
 				ListCell   *l2;
 
+				/*
+				 * A CTE's Param doesn't carry a value that could be passed
+				 * down; parallel CTE scans get their rows from a shared
+				 * tuplestore instead.
+				 */
+				if (initsubplan->subLinkType == CTE_SUBLINK)
+					continue;
+
 				foreach(l2, initsubplan->setParam)
 				{
 					initSetParam = bms_add_member(initSetParam, lfirst_int(l2));
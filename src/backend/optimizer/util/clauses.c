@@ -623,6 +623,25 @@ max_parallel_hazard(Query *parse)
 	return context.max_hazard;
 }
 
+/*
+ * max_parallel_hazard_expr
+ *		Find the worst parallel-hazard level in a standalone expression
+ *
+ * This is max_parallel_hazard() for expressions that are evaluated outside
+ * of any planned query, such as column default expressions or constraints.
+ */
+char
+max_parallel_hazard_expr(Node *node)
+{
+	max_parallel_hazard_context context;
+
+	context.max_hazard = PROPARALLEL_SAFE;
+	context.max_interesting = PROPARALLEL_UNSAFE;
+	context.safe_param_ids = NIL;
+	(void) max_parallel_hazard_walker(node, &context);
+	return context.max_hazard;
+}
+
 /*
  * is_parallel_safe
  *		Detect whether the given expr contains only parallel-safe functions
@@ -2147,6 +2166,25 @@ eval_const_expressions(PlannerInfo *root, Node *node)
 }
 
 #define MIN_ARRAY_SIZE_FOR_HASHED_SAOP 9
+
+/*
+ * saop_array_worth_hashing
+ *		Does the array argument of a ScalarArrayOpExpr look large enough to
+ *		be worth hashing?  Arrays supplied by Params are assumed to be.
+ */
+static bool
+saop_array_worth_hashing(Expr *arrayarg)
+{
+	ArrayType  *arr;
+
+	if (IsA(arrayarg, Param))
+		return true;
+
+	arr = DatumGetArrayTypeP(((Const *) arrayarg)->constvalue);
+	return ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr)) >=
+		MIN_ARRAY_SIZE_FOR_HASHED_SAOP;
+}
+
 /*--------------------
  * convert_saop_to_hashed_saop
  *
@@ -2155,13 +2193,19 @@ eval_const_expressions(PlannerInfo *root, Node *node)
  * evaluate using a hash table rather than a linear search.
  *
  * We'll use a hash table if all of the following conditions are met:
- * 1. The 2nd argument of the array contain only Consts.
+ * 1. The 2nd argument of the array is a non-null Const or a Param.
  * 2. useOr is true or there is a valid negator operator for the
  *	  ScalarArrayOpExpr's opno.
  * 3. There's valid hash function for both left and righthand operands and
  *	  these hash functions are the same.
  * 4. If the array contains enough elements for us to consider it to be
  *	  worthwhile using a hash table rather than a linear search.
+ *
+ * The size of an array supplied by a Param isn't known until execution.
+ * Such arrays are typically large lists of keys passed in by the
+ * application, and their value seldom changes between evaluations, so we
+ * optimistically hash them; the executor rebuilds the table whenever the
+ * Param's value changes.
  */
 void
 convert_saop_to_hashed_saop(Node *node)
@@ -2182,26 +2226,21 @@ convert_saop_to_hashed_saop_walker(Node *node, void *context)
 		Oid			lefthashfunc;
 		Oid			righthashfunc;
 
-		if (arrayarg && IsA(arrayarg, Const) &&
-			!((Const *) arrayarg)->constisnull)
+		if (arrayarg &&
+			(IsA(arrayarg, Param) ||
+			 (IsA(arrayarg, Const) && !((Const *) arrayarg)->constisnull)))
 		{
 			if (saop->useOr)
 			{
 				if (get_op_hash_functions(saop->opno, &lefthashfunc, &righthashfunc) &&
 					lefthashfunc == righthashfunc)
 				{
-					Datum		arrdatum = ((Const *) arrayarg)->constvalue;
-					ArrayType  *arr = (ArrayType *) DatumGetPointer(arrdatum);
-					int			nitems;
-
 					/*
 					 * Only fill in the hash functions if the array looks
 					 * large enough for it to be worth hashing instead of
 					 * doing a linear search.
 					 */
-					nitems = ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr));
-
-					if (nitems >= MIN_ARRAY_SIZE_FOR_HASHED_SAOP)
+					if (saop_array_worth_hashing(arrayarg))
 					{
 						/* Looks good. Fill in the hash functions */
 						saop->hashfuncid = lefthashfunc;
@@ -2222,18 +2261,12 @@ convert_saop_to_hashed_saop_walker(Node *node, void *context)
 					get_op_hash_functions(negator, &lefthashfunc, &righthashfunc) &&
 					lefthashfunc == righthashfunc)
 				{
-					Datum		arrdatum = ((Const *) arrayarg)->constvalue;
-					ArrayType  *arr = (ArrayType *) DatumGetPointer(arrdatum);
-					int			nitems;
-
 					/*
 					 * Only fill in the hash functions if the array looks
 					 * large enough for it to be worth hashing instead of
 					 * doing a linear search.
 					 */
-					nitems = ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr));
-
-					if (nitems >= MIN_ARRAY_SIZE_FOR_HASHED_SAOP)
+					if (saop_array_worth_hashing(arrayarg))
 					{
 						/* Looks good. Fill in the hash functions */
 						saop->hashfuncid = lefthashfunc;
@@ -432,6 +432,8 @@ add_path(RelOptInfo *parent_rel, Path *new_path)
 	 */
 	CHECK_FOR_INTERRUPTS();
 
+	pgPlannerUsage.paths_added++;
+
 	/* Pretend parameterized paths have no pathkeys, per comment above */
 	new_path_pathkeys = new_path->param_info ? NIL : new_path->pathkeys;
 
@@ -587,6 +589,8 @@ add_path(RelOptInfo *parent_rel, Path *new_path)
 			parent_rel->pathlist = foreach_delete_current(parent_rel->pathlist,
 														  p1);
 
+			pgPlannerUsage.paths_discarded++;
+
 			/*
 			 * Delete the data pointed-to by the deleted cell, if possible
 			 */
@@ -618,6 +622,7 @@ add_path(RelOptInfo *parent_rel, Path *new_path)
 	else
 	{
 		/* Reject and recycle the new path */
+		pgPlannerUsage.paths_discarded++;
 		if (!IsA(new_path, IndexPath))
 			pfree(new_path);
 	}
@@ -755,6 +760,8 @@ add_partial_path(RelOptInfo *parent_rel, Path *new_path)
 	/* Check for query cancel. */
 	CHECK_FOR_INTERRUPTS();
 
+	pgPlannerUsage.paths_added++;
+
 	/* Path to be added must be parallel safe. */
 	Assert(new_path->parallel_safe);
 
@@ -822,6 +829,7 @@ add_partial_path(RelOptInfo *parent_rel, Path *new_path)
 		{
 			parent_rel->partial_pathlist =
 				foreach_delete_current(parent_rel->partial_pathlist, p1);
+			pgPlannerUsage.paths_discarded++;
 			pfree(old_path);
 		}
 		else
@@ -849,6 +857,7 @@ add_partial_path(RelOptInfo *parent_rel, Path *new_path)
 	else
 	{
 		/* Reject and recycle the new path */
+		pgPlannerUsage.paths_discarded++;
 		pfree(new_path);
 	}
 }
@@ -2111,7 +2120,8 @@ create_valuesscan_path(PlannerInfo *root, RelOptInfo *rel,
  *	  returning the pathnode.
  */
 Path *
-create_ctescan_path(PlannerInfo *root, RelOptInfo *rel, Relids required_outer)
+create_ctescan_path(PlannerInfo *root, RelOptInfo *rel, Relids required_outer,
+					int parallel_workers)
 {
 	Path	   *pathnode = makeNode(Path);
 
@@ -2120,9 +2130,14 @@ create_ctescan_path(PlannerInfo *root, RelOptInfo *rel, Relids required_outer)
 	pathnode->pathtarget = rel->reltarget;
 	pathnode->param_info = get_baserel_parampathinfo(root, rel,
 													 required_outer);
-	pathnode->parallel_aware = false;
-	pathnode->parallel_safe = rel->consider_parallel;
-	pathnode->parallel_workers = 0;
+
+	/*
+	 * Only the parallel-aware variant, which scans the shared tuplestore
+	 * populated by the leader, can be executed in a worker.
+	 */
+	pathnode->parallel_aware = (parallel_workers > 0);
+	pathnode->parallel_safe = rel->consider_parallel && parallel_workers > 0;
+	pathnode->parallel_workers = parallel_workers;
 	pathnode->pathkeys = NIL;	/* XXX for now, result is always unordered */
 
 	cost_ctescan(pathnode, root, rel, pathnode->param_info);
@@ -517,6 +517,9 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 		relation->rd_tableam->scan_set_tidrange != NULL &&
 		relation->rd_tableam->scan_getnextslot_tidrange != NULL)
 		rel->amflags |= AMFLAG_HAS_TID_RANGE;
+	if (relation->rd_tableam &&
+		relation->rd_tableam->scan_set_projection != NULL)
+		rel->amflags |= AMFLAG_HAS_PROJECTION;
 
 	/*
 	 * Collect info about relation's partitioning scheme, if any. Only
@@ -15,6 +15,7 @@
 #include <unistd.h>
 #include <signal.h>
 
+#include "access/xlog.h"
 #include "libpq/pqsignal.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -117,6 +118,7 @@ AuxiliaryProcessMain(AuxProcType auxtype)
 	 * auxiliary process type.
 	 */
 	ProcSignalInit(MaxBackends + MyAuxProcType + 1);
+	InitLocalDataChecksumVersion();
 
 	/*
 	 * Auxiliary processes don't run transactions, but they may need a
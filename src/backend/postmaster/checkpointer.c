@@ -144,6 +144,7 @@ static CheckpointerShmemStruct *CheckpointerShmem;
 int			CheckPointTimeout = 300;
 int			CheckPointWarning = 30;
 double		CheckPointCompletionTarget = 0.9;
+bool		CheckPointSpreadSync = false;
 
 /*
  * Private state
@@ -591,6 +592,10 @@ HandleCheckpointerInterrupts(void)
 	/* Perform logging of memory contexts of this process */
 	if (LogMemoryContextPending)
 		ProcessLogMemoryContextInterrupt();
+
+	/* Publish the memory contexts of this process, if requested */
+	if (PublishMemoryContextPending)
+		ProcessGetMemoryContextInterrupt();
 }
 
 /*
@@ -728,15 +733,24 @@ CheckpointWriteDelay(int flags, double progress)
 		pgstat_report_checkpointer();
 
 		/*
-		 * This sleep used to be connected to bgwriter_delay, typically 200ms.
-		 * That resulted in more frequent wakeups if not much work to do.
-		 * Checkpointer and bgwriter are no longer related so take the Big
-		 * Sleep.
+		 * With checkpoint_spread_sync, spend the time we have in hand on
+		 * syncing files that we're done writing, rather than leaving all the
+		 * fsyncs for the end of the checkpoint.  Sleep only if there was
+		 * nothing to sync.
 		 */
-		WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH | WL_TIMEOUT,
-				  100,
-				  WAIT_EVENT_CHECKPOINT_WRITE_DELAY);
-		ResetLatch(MyLatch);
+		if (!CheckPointSpreadSync || !EarlySyncRequests(100))
+		{
+			/*
+			 * This sleep used to be connected to bgwriter_delay, typically
+			 * 200ms. That resulted in more frequent wakeups if not much work
+			 * to do. Checkpointer and bgwriter are no longer related so take
+			 * the Big Sleep.
+			 */
+			WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH | WL_TIMEOUT,
+					  100,
+					  WAIT_EVENT_CHECKPOINT_WRITE_DELAY);
+			ResetLatch(MyLatch);
+		}
 	}
 	else if (--absorb_counter <= 0)
 	{
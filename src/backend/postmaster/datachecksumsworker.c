@@ -0,0 +1,754 @@
+/*-------------------------------------------------------------------------
+ *
+ * datachecksumsworker.c
+ *	  Background workers enabling or disabling data checksums online
+ *
+ * Data checksums are enabled in a running cluster by calling
+ * pg_enable_data_checksums(), which starts a launcher background worker.
+ * The launcher first switches the cluster to the "inprogress" state, in
+ * which every process computes a checksum when it writes a page out, but
+ * nobody verifies checksums yet.  It then waits for the transactions that
+ * were running before the switch, since relations they created may have
+ * been written out without checksums, and starts a worker for each database
+ * in turn.  The worker reads every block of every relation with storage in
+ * its database, marks it dirty and WAL-logs it, so that it gets a checksum
+ * when it is written out again.  The first worker also processes the shared
+ * catalogs.  Once all the databases are done, the launcher switches
+ * checksums on.
+ *
+ * The temporary relations of other sessions can't be read, as their pages
+ * live in the local buffers of the session owning them.  A worker therefore
+ * waits until all the temporary relations that existed when it started are
+ * gone; those created later have checksums from the start.  Likewise, the
+ * databases created while the launcher runs are processed after the ones
+ * that existed when it started.
+ *
+ * pg_disable_data_checksums() also goes through the "inprogress" state, and
+ * is carried out by the same launcher, so that only one process at a time
+ * ever changes the state.  Calling it while checksums are being enabled
+ * stops the workers.
+ *
+ * The state is kept in the control file.  If the launcher is interrupted,
+ * for example by a restart of the server, the cluster stays in the
+ * "inprogress" state until one of the functions is called again.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/datachecksumsworker.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/table.h"
+#include "access/tableam.h"
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "access/xloginsert.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_database.h"
+#include "commands/vacuum.h"
+#include "common/relpath.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/datachecksumsworker.h"
+#include "storage/bufmgr.h"
+#include "storage/ipc.h"
+#include "storage/lmgr.h"
+#include "storage/procarray.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "tcop/tcopprot.h"
+#include "utils/fmgrprotos.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/syscache.h"
+
+/* how long to sleep between checks for remaining temporary relations */
+#define TEMP_RELATIONS_RECHECK_MS	5000L
+
+typedef enum
+{
+	DATACHECKSUMSWORKER_SUCCESSFUL,
+	DATACHECKSUMSWORKER_ABORTED,
+	DATACHECKSUMSWORKER_FAILED
+} DataChecksumsWorkerResult;
+
+typedef struct DataChecksumsWorkerShmemStruct
+{
+	/* is the launcher running, or about to be started? */
+	bool		launcher_running;
+
+	/* requested operation: true to enable checksums, false to disable them */
+	bool		enable_checksums;
+
+	/* cost-based delay settings of the database workers */
+	int			cost_delay;
+	int			cost_limit;
+
+	/* passed to, and returned by, the database worker currently running */
+	bool		process_shared_catalogs;
+	DataChecksumsWorkerResult worker_result;
+} DataChecksumsWorkerShmemStruct;
+
+static DataChecksumsWorkerShmemStruct *DataChecksumsWorkerShmem;
+
+static void launcher_exit(int code, Datum arg);
+static void EnableDataChecksums(void);
+static void DisableDataChecksums(void);
+static bool DataChecksumsDisableRequested(void);
+static void WaitForRunningTransactions(void);
+static bool ProcessAllDatabases(void);
+static DataChecksumsWorkerResult ProcessDatabase(Oid dboid,
+												 bool process_shared);
+static bool ProcessRelation(Oid reloid, BufferAccessStrategy strategy);
+static bool ProcessRelationFork(Relation rel, ForkNumber forknum,
+								BufferAccessStrategy strategy);
+static bool WaitForTempRelations(List *temprels);
+static List *GetDatabaseList(void);
+static List *GetRelationList(bool temp_only, bool include_shared);
+
+
+/*
+ * Report shared memory space needed by DataChecksumsWorkerShmemInit
+ */
+Size
+DataChecksumsWorkerShmemSize(void)
+{
+	return sizeof(DataChecksumsWorkerShmemStruct);
+}
+
+/*
+ * Allocate and initialize the shared state of the workers
+ */
+void
+DataChecksumsWorkerShmemInit(void)
+{
+	bool		found;
+
+	DataChecksumsWorkerShmem = (DataChecksumsWorkerShmemStruct *)
+		ShmemInitStruct("DataChecksumsWorker Data",
+						DataChecksumsWorkerShmemSize(),
+						&found);
+
+	if (!found)
+		MemSet(DataChecksumsWorkerShmem, 0, DataChecksumsWorkerShmemSize());
+}
+
+/*
+ * StartDataChecksumsLauncher
+ *		Request data checksums to be enabled or disabled.
+ *
+ * If the launcher is already running, it picks up the new request once it
+ * is done with the current one; otherwise it is started.  This returns
+ * without waiting for the operation to be completed.
+ */
+void
+StartDataChecksumsLauncher(bool enable, int cost_delay, int cost_limit)
+{
+	BackgroundWorker bgw;
+	uint32		version;
+
+	if (RecoveryInProgress())
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("recovery is in progress"),
+				 errhint("Data checksums cannot be enabled or disabled during recovery.")));
+
+	LWLockAcquire(DataChecksumsWorkerLock, LW_EXCLUSIVE);
+
+	DataChecksumsWorkerShmem->enable_checksums = enable;
+	if (enable)
+	{
+		DataChecksumsWorkerShmem->cost_delay = cost_delay;
+		DataChecksumsWorkerShmem->cost_limit = cost_limit;
+	}
+
+	if (DataChecksumsWorkerShmem->launcher_running)
+	{
+		LWLockRelease(DataChecksumsWorkerLock);
+		return;
+	}
+
+	version = GetDataChecksumVersion();
+	if (enable && version == PG_DATA_CHECKSUM_VERSION)
+	{
+		LWLockRelease(DataChecksumsWorkerLock);
+		ereport(NOTICE,
+				(errmsg("data checksums are already enabled")));
+		return;
+	}
+	if (!enable && version == 0)
+	{
+		LWLockRelease(DataChecksumsWorkerLock);
+		ereport(NOTICE,
+				(errmsg("data checksums are already disabled")));
+		return;
+	}
+
+	DataChecksumsWorkerShmem->launcher_running = true;
+	LWLockRelease(DataChecksumsWorkerLock);
+
+	memset(&bgw, 0, sizeof(bgw));
+	bgw.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+	bgw.bgw_start_time = BgWorkerStart_RecoveryFinished;
+	snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
+	snprintf(bgw.bgw_function_name, BGW_MAXLEN, "DataChecksumsWorkerLauncherMain");
+	snprintf(bgw.bgw_name, BGW_MAXLEN, "datachecksums launcher");
+	snprintf(bgw.bgw_type, BGW_MAXLEN, "datachecksums launcher");
+	bgw.bgw_restart_time = BGW_NEVER_RESTART;
+	bgw.bgw_notify_pid = 0;
+	bgw.bgw_main_arg = (Datum) 0;
+
+	if (!RegisterDynamicBackgroundWorker(&bgw, NULL))
+	{
+		LWLockAcquire(DataChecksumsWorkerLock, LW_EXCLUSIVE);
+		DataChecksumsWorkerShmem->launcher_running = false;
+		LWLockRelease(DataChecksumsWorkerLock);
+
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+				 errmsg("could not register background process"),
+				 errhint("You may need to increase max_worker_processes.")));
+	}
+}
+
+/*
+ * Main entry point of the launcher
+ */
+void
+DataChecksumsWorkerLauncherMain(Datum arg)
+{
+	bool		enable;
+
+	before_shmem_exit(launcher_exit, (Datum) 0);
+
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/* Connect to the shared catalogs only, we just need pg_database */
+	BackgroundWorkerInitializeConnection(NULL, NULL, 0);
+
+	LWLockAcquire(DataChecksumsWorkerLock, LW_SHARED);
+	enable = DataChecksumsWorkerShmem->enable_checksums;
+	LWLockRelease(DataChecksumsWorkerLock);
+
+	for (;;)
+	{
+		if (enable)
+			EnableDataChecksums();
+		else
+			DisableDataChecksums();
+
+		/* Exit, unless the other operation was requested in the meantime */
+		LWLockAcquire(DataChecksumsWorkerLock, LW_EXCLUSIVE);
+		if (DataChecksumsWorkerShmem->enable_checksums == enable)
+		{
+			DataChecksumsWorkerShmem->launcher_running = false;
+			LWLockRelease(DataChecksumsWorkerLock);
+			break;
+		}
+		enable = DataChecksumsWorkerShmem->enable_checksums;
+		LWLockRelease(DataChecksumsWorkerLock);
+	}
+}
+
+/*
+ * Allow a new launcher to be started if this one exits on an error.
+ */
+static void
+launcher_exit(int code, Datum arg)
+{
+	LWLockAcquire(DataChecksumsWorkerLock, LW_EXCLUSIVE);
+	DataChecksumsWorkerShmem->launcher_running = false;
+	LWLockRelease(DataChecksumsWorkerLock);
+}
+
+static void
+EnableDataChecksums(void)
+{
+	uint32		version = GetDataChecksumVersion();
+
+	if (version == PG_DATA_CHECKSUM_VERSION)
+		return;
+
+	if (version == 0)
+		SetDataChecksumVersion(PG_DATA_CHECKSUM_INPROGRESS_VERSION);
+
+	WaitForRunningTransactions();
+
+	if (!ProcessAllDatabases())
+		return;
+
+	SetDataChecksumVersion(PG_DATA_CHECKSUM_VERSION);
+
+	ereport(LOG,
+			(errmsg("data checksums are enabled")));
+}
+
+static void
+DisableDataChecksums(void)
+{
+	uint32		version = GetDataChecksumVersion();
+
+	if (version == 0)
+		return;
+
+	if (version == PG_DATA_CHECKSUM_VERSION)
+		SetDataChecksumVersion(PG_DATA_CHECKSUM_INPROGRESS_VERSION);
+	SetDataChecksumVersion(0);
+
+	ereport(LOG,
+			(errmsg("data checksums are disabled")));
+}
+
+/*
+ * Has disabling checksums been requested while we are enabling them?
+ */
+static bool
+DataChecksumsDisableRequested(void)
+{
+	bool		result;
+
+	LWLockAcquire(DataChecksumsWorkerLock, LW_SHARED);
+	result = !DataChecksumsWorkerShmem->enable_checksums;
+	LWLockRelease(DataChecksumsWorkerLock);
+
+	return result;
+}
+
+/*
+ * Wait for all the transactions currently running to end.
+ *
+ * A transaction that started before checksums were switched to
+ * "inprogress" may have written the pages of a relation it created
+ * without checksums, and the relation only becomes visible to the
+ * workers once the transaction commits.
+ */
+static void
+WaitForRunningTransactions(void)
+{
+	VirtualTransactionId *vxids;
+	int			nvxids;
+	int			i;
+
+	StartTransactionCommand();
+
+	vxids = GetCurrentVirtualXIDs(InvalidTransactionId, false, true, 0,
+								  &nvxids);
+
+	for (i = 0; i < nvxids; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+		(void) VirtualXactLock(vxids[i], true);
+	}
+
+	CommitTransactionCommand();
+}
+
+/*
+ * Process all the databases, including those created in the meantime.
+ *
+ * Returns false if disabling checksums was requested in the meantime.
+ */
+static bool
+ProcessAllDatabases(void)
+{
+	List	   *processed = NIL;
+	bool		shared_done = false;
+	bool		found;
+
+	do
+	{
+		List	   *databases = GetDatabaseList();
+		ListCell   *lc;
+
+		found = false;
+
+		foreach(lc, databases)
+		{
+			Oid			dboid = lfirst_oid(lc);
+			DataChecksumsWorkerResult result;
+
+			if (list_member_oid(processed, dboid))
+				continue;
+			found = true;
+
+			if (DataChecksumsDisableRequested())
+				return false;
+
+			result = ProcessDatabase(dboid, !shared_done);
+
+			if (result == DATACHECKSUMSWORKER_ABORTED)
+				return false;
+			if (result == DATACHECKSUMSWORKER_SUCCESSFUL)
+				shared_done = true;
+			else if (list_member_oid(GetDatabaseList(), dboid))
+				ereport(ERROR,
+						(errmsg("could not enable data checksums in database with OID %u",
+								dboid)));
+
+			/* else the database was dropped during processing */
+			processed = lappend_oid(processed, dboid);
+		}
+
+		list_free(databases);
+	} while (found);
+
+	return true;
+}
+
+/*
+ * Start a worker for the given database, and wait for it to finish.
+ */
+static DataChecksumsWorkerResult
+ProcessDatabase(Oid dboid, bool process_shared)
+{
+	BackgroundWorker bgw;
+	BackgroundWorkerHandle *bgw_handle;
+	BgwHandleStatus status;
+	pid_t		pid;
+	DataChecksumsWorkerResult result;
+
+	LWLockAcquire(DataChecksumsWorkerLock, LW_EXCLUSIVE);
+	DataChecksumsWorkerShmem->process_shared_catalogs = process_shared;
+	DataChecksumsWorkerShmem->worker_result = DATACHECKSUMSWORKER_FAILED;
+	LWLockRelease(DataChecksumsWorkerLock);
+
+	memset(&bgw, 0, sizeof(bgw));
+	bgw.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+	bgw.bgw_start_time = BgWorkerStart_RecoveryFinished;
+	snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
+	snprintf(bgw.bgw_function_name, BGW_MAXLEN, "DataChecksumsWorkerMain");
+	snprintf(bgw.bgw_name, BGW_MAXLEN, "datachecksums worker");
+	snprintf(bgw.bgw_type, BGW_MAXLEN, "datachecksums worker");
+	bgw.bgw_restart_time = BGW_NEVER_RESTART;
+	bgw.bgw_notify_pid = MyProcPid;
+	bgw.bgw_main_arg = ObjectIdGetDatum(dboid);
+
+	if (!RegisterDynamicBackgroundWorker(&bgw, &bgw_handle))
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+				 errmsg("could not register background process"),
+				 errhint("You may need to increase max_worker_processes.")));
+
+	status = WaitForBackgroundWorkerStartup(bgw_handle, &pid);
+	if (status == BGWH_STARTED)
+		status = WaitForBackgroundWorkerShutdown(bgw_handle);
+	if (status == BGWH_POSTMASTER_DIED)
+		proc_exit(1);
+
+	LWLockAcquire(DataChecksumsWorkerLock, LW_SHARED);
+	result = DataChecksumsWorkerShmem->worker_result;
+	LWLockRelease(DataChecksumsWorkerLock);
+
+	return result;
+}
+
+/*
+ * Main entry point of the worker processing one database
+ */
+void
+DataChecksumsWorkerMain(Datum arg)
+{
+	Oid			dboid = DatumGetObjectId(arg);
+	bool		process_shared;
+	BufferAccessStrategy strategy;
+	List	   *temprels;
+	List	   *rels;
+	ListCell   *lc;
+	DataChecksumsWorkerResult result = DATACHECKSUMSWORKER_SUCCESSFUL;
+
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	BackgroundWorkerInitializeConnectionByOid(dboid, InvalidOid,
+											  BGWORKER_BYPASS_ALLOWCONN);
+
+	LWLockAcquire(DataChecksumsWorkerLock, LW_SHARED);
+	process_shared = DataChecksumsWorkerShmem->process_shared_catalogs;
+	VacuumCostDelay = DataChecksumsWorkerShmem->cost_delay;
+	VacuumCostLimit = DataChecksumsWorkerShmem->cost_limit;
+	LWLockRelease(DataChecksumsWorkerLock);
+
+	VacuumCostActive = (VacuumCostDelay > 0);
+	VacuumCostBalance = 0;
+
+	strategy = GetAccessStrategy(BAS_VACUUM);
+
+	/*
+	 * Remember the temporary relations existing now, before looking for the
+	 * relations to process.
+	 */
+	temprels = GetRelationList(true, false);
+	rels = GetRelationList(false, process_shared);
+
+	foreach(lc, rels)
+	{
+		if (!ProcessRelation(lfirst_oid(lc), strategy))
+		{
+			result = DATACHECKSUMSWORKER_ABORTED;
+			break;
+		}
+	}
+
+	if (result == DATACHECKSUMSWORKER_SUCCESSFUL &&
+		!WaitForTempRelations(temprels))
+		result = DATACHECKSUMSWORKER_ABORTED;
+
+	LWLockAcquire(DataChecksumsWorkerLock, LW_EXCLUSIVE);
+	DataChecksumsWorkerShmem->worker_result = result;
+	LWLockRelease(DataChecksumsWorkerLock);
+
+	pgstat_report_activity(STATE_IDLE, NULL);
+}
+
+/*
+ * Process all the forks of a relation.
+ *
+ * Returns false if disabling checksums was requested in the meantime.
+ */
+static bool
+ProcessRelation(Oid reloid, BufferAccessStrategy strategy)
+{
+	Relation	rel;
+	ForkNumber	forknum;
+	bool		aborted = false;
+
+	StartTransactionCommand();
+
+	rel = try_relation_open(reloid, AccessShareLock);
+	if (rel == NULL)
+	{
+		/* dropped in the meantime */
+		CommitTransactionCommand();
+		return true;
+	}
+
+	for (forknum = 0; forknum <= MAX_FORKNUM && !aborted; forknum++)
+	{
+		if (smgrexists(RelationGetSmgr(rel), forknum))
+			aborted = !ProcessRelationFork(rel, forknum, strategy);
+	}
+
+	relation_close(rel, AccessShareLock);
+	CommitTransactionCommand();
+
+	return !aborted;
+}
+
+static bool
+ProcessRelationFork(Relation rel, ForkNumber forknum,
+					BufferAccessStrategy strategy)
+{
+	BlockNumber nblocks = RelationGetNumberOfBlocksInFork(rel, forknum);
+	BlockNumber blkno;
+	char		activity[NAMEDATALEN * 2 + 128];
+
+	snprintf(activity, sizeof(activity),
+			 "enabling data checksums: %s.%s, fork %s, %u blocks",
+			 get_namespace_name(RelationGetNamespace(rel)),
+			 RelationGetRelationName(rel), forkNames[forknum], nblocks);
+	pgstat_report_activity(STATE_RUNNING, activity);
+
+	for (blkno = 0; blkno < nblocks; blkno++)
+	{
+		Buffer		buf;
+
+		if (DataChecksumsDisableRequested())
+			return false;
+
+		buf = ReadBufferExtended(rel, forknum, blkno, RBM_NORMAL, strategy);
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+
+		/*
+		 * Dirty the buffer, so that it gets a checksum when written out, and
+		 * WAL-log a full image of it.  That makes standbys and crash
+		 * recovery follow, and the checksum survive a torn write.  Unlogged
+		 * relations are reset after a crash, only their init fork needs to
+		 * be logged.
+		 */
+		START_CRIT_SECTION();
+		MarkBufferDirty(buf);
+		if (RelationNeedsWAL(rel) || forknum == INIT_FORKNUM)
+			log_newpage_buffer(buf, false);
+		END_CRIT_SECTION();
+
+		UnlockReleaseBuffer(buf);
+
+		vacuum_delay_point();
+	}
+
+	return true;
+}
+
+/*
+ * Wait until the given temporary relations have all been dropped.
+ *
+ * Returns false if disabling checksums was requested in the meantime.
+ */
+static bool
+WaitForTempRelations(List *temprels)
+{
+	for (;;)
+	{
+		ListCell   *lc;
+		bool		remaining = false;
+
+		StartTransactionCommand();
+		foreach(lc, temprels)
+		{
+			if (SearchSysCacheExists1(RELOID, ObjectIdGetDatum(lfirst_oid(lc))))
+			{
+				remaining = true;
+				break;
+			}
+		}
+		CommitTransactionCommand();
+
+		if (!remaining)
+			return true;
+
+		if (DataChecksumsDisableRequested())
+			return false;
+
+		pgstat_report_activity(STATE_RUNNING,
+							   "enabling data checksums: waiting for temporary relations to be dropped");
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 TEMP_RELATIONS_RECHECK_MS,
+						 WAIT_EVENT_CHECKSUM_ENABLE_TEMPTABLE_WAIT);
+		ResetLatch(MyLatch);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * Return the OIDs of all databases.
+ */
+static List *
+GetDatabaseList(void)
+{
+	List	   *res = NIL;
+	Relation	rel;
+	TableScanDesc scan;
+	HeapTuple	tup;
+	MemoryContext resultcxt;
+
+	/* This is the context that we will allocate our output data in */
+	resultcxt = CurrentMemoryContext;
+
+	StartTransactionCommand();
+
+	rel = table_open(DatabaseRelationId, AccessShareLock);
+	scan = table_beginscan_catalog(rel, 0, NULL);
+
+	while (HeapTupleIsValid(tup = heap_getnext(scan, ForwardScanDirection)))
+	{
+		Form_pg_database pgdatabase = (Form_pg_database) GETSTRUCT(tup);
+		MemoryContext oldcxt;
+
+		oldcxt = MemoryContextSwitchTo(resultcxt);
+		res = lappend_oid(res, pgdatabase->oid);
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	table_endscan(scan);
+	table_close(rel, AccessShareLock);
+
+	CommitTransactionCommand();
+
+	return res;
+}
+
+/*
+ * Return the OIDs of the relations with storage in the current database.
+ *
+ * If temp_only is true, only temporary relations are returned, otherwise
+ * only the other ones, including the shared catalogs if include_shared is
+ * true.
+ */
+static List *
+GetRelationList(bool temp_only, bool include_shared)
+{
+	List	   *res = NIL;
+	Relation	rel;
+	TableScanDesc scan;
+	HeapTuple	tup;
+	MemoryContext resultcxt;
+
+	/* This is the context that we will allocate our output data in */
+	resultcxt = CurrentMemoryContext;
+
+	StartTransactionCommand();
+
+	rel = table_open(RelationRelationId, AccessShareLock);
+	scan = table_beginscan_catalog(rel, 0, NULL);
+
+	while (HeapTupleIsValid(tup = heap_getnext(scan, ForwardScanDirection)))
+	{
+		Form_pg_class pgc = (Form_pg_class) GETSTRUCT(tup);
+		MemoryContext oldcxt;
+
+		if (!RELKIND_HAS_STORAGE(pgc->relkind))
+			continue;
+		if ((pgc->relpersistence == RELPERSISTENCE_TEMP) != temp_only)
+			continue;
+		if (pgc->relisshared && !include_shared)
+			continue;
+
+		oldcxt = MemoryContextSwitchTo(resultcxt);
+		res = lappend_oid(res, pgc->oid);
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	table_endscan(scan);
+	table_close(rel, AccessShareLock);
+
+	CommitTransactionCommand();
+
+	return res;
+}
+
+/*
+ * pg_enable_data_checksums
+ *		Start enabling data checksums in the running cluster.
+ */
+Datum
+enable_data_checksums(PG_FUNCTION_ARGS)
+{
+	int			cost_delay = PG_GETARG_INT32(0);
+	int			cost_limit = PG_GETARG_INT32(1);
+
+	if (cost_delay < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("cost delay cannot be less than zero")));
+	if (cost_limit <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("cost limit must be greater than zero")));
+
+	StartDataChecksumsLauncher(true, cost_delay, cost_limit);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * pg_disable_data_checksums
+ *		Start disabling data checksums in the running cluster.
+ */
+Datum
+disable_data_checksums(PG_FUNCTION_ARGS)
+{
+	StartDataChecksumsLauncher(false, 0, 0);
+
+	PG_RETURN_VOID();
+}
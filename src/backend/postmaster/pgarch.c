@@ -73,7 +73,9 @@
 #define NUM_ORPHAN_CLEANUP_RETRIES 3
 
 /*
- * Maximum number of .ready files to gather per directory scan.
+ * Maximum number of .ready files to gather per directory scan.  This must be
+ * at least MAX_ARCHIVE_BATCH_SIZE, so that one directory scan can fill a
+ * batch.
  */
 #define NUM_FILES_PER_DIRECTORY_SCAN 64
 
@@ -91,6 +93,7 @@ typedef struct PgArchData
 } PgArchData;
 
 char	   *XLogArchiveLibrary = "";
+int			archive_batch_size = 1;
 
 
 /* ----------
@@ -140,7 +143,10 @@ static volatile sig_atomic_t ready_to_stop = false;
 static void pgarch_waken_stop(SIGNAL_ARGS);
 static void pgarch_MainLoop(void);
 static void pgarch_ArchiverCopyLoop(void);
+static bool pgarch_archiveXlogWithRetries(char *xlog);
 static bool pgarch_archiveXlog(char *xlog);
+static void pgarch_archiveXlogs(char xlogs[][MAX_XFN_CHARS + 1], int nfiles,
+								bool *archived);
 static bool pgarch_readyXlog(char *xlog);
 static void pgarch_archiveDone(char *xlog);
 static void pgarch_die(int code, Datum arg);
@@ -370,7 +376,8 @@ pgarch_MainLoop(void)
 static void
 pgarch_ArchiverCopyLoop(void)
 {
-	char		xlog[MAX_XFN_CHARS + 1];
+	char		xlogs[MAX_ARCHIVE_BATCH_SIZE][MAX_XFN_CHARS + 1];
+	bool		archived[MAX_ARCHIVE_BATCH_SIZE];
 
 	/* force directory scan in the first call to pgarch_readyXlog() */
 	arch_files->arch_files_size = 0;
@@ -381,34 +388,29 @@ pgarch_ArchiverCopyLoop(void)
 	 * some backend will add files onto the list of those that need archiving
 	 * while we are still copying earlier archives
 	 */
-	while (pgarch_readyXlog(xlog))
+	for (;;)
 	{
-		int			failures = 0;
-		int			failures_orphan = 0;
+		int			batch_size;
+		int			nfiles = 0;
 
-		for (;;)
+		/*
+		 * If the archive module can archive several files at once, hand it up
+		 * to archive_batch_size files, oldest first.
+		 */
+		batch_size = ArchiveCallbacks->archive_files_cb != NULL ?
+			archive_batch_size : 1;
+		while (nfiles < batch_size && pgarch_readyXlog(xlogs[nfiles]))
+			nfiles++;
+		if (nfiles == 0)
+			break;
+
+		memset(archived, 0, sizeof(archived));
+		if (nfiles > 1)
 		{
-			struct stat stat_buf;
-			char		pathname[MAXPGPATH];
-
-			/*
-			 * Do not initiate any more archive commands after receiving
-			 * SIGTERM, nor after the postmaster has died unexpectedly. The
-			 * first condition is to try to keep from having init SIGKILL the
-			 * command, and the second is to avoid conflicts with another
-			 * archiver spawned by a newer postmaster.
-			 */
+			/* see pgarch_archiveXlogWithRetries() */
 			if (ShutdownRequestPending || !PostmasterIsAlive())
 				return;
-
-			/*
-			 * Check for barrier events and config update.  This is so that
-			 * we'll adopt a new setting for archive_command as soon as
-			 * possible, even if there is a backlog of files to be archived.
-			 */
 			HandlePgArchInterrupts();
-
-			/* can't do anything if not configured ... */
 			if (ArchiveCallbacks->check_configured_cb != NULL &&
 				!ArchiveCallbacks->check_configured_cb(archive_module_state))
 			{
@@ -417,76 +419,134 @@ pgarch_ArchiverCopyLoop(void)
 				return;
 			}
 
-			/*
-			 * Since archive status files are not removed in a durable manner,
-			 * a system crash could leave behind .ready files for WAL segments
-			 * that have already been recycled or removed.  In this case,
-			 * simply remove the orphan status file and move on.  unlink() is
-			 * used here as even on subsequent crashes the same orphan files
-			 * would get removed, so there is no need to worry about
-			 * durability.
-			 */
-			snprintf(pathname, MAXPGPATH, XLOGDIR "/%s", xlog);
-			if (stat(pathname, &stat_buf) != 0 && errno == ENOENT)
+			pgarch_archiveXlogs(xlogs, nfiles, archived);
+		}
+
+		/*
+		 * Archive whatever wasn't archived as part of a batch one at a time.
+		 * This also takes care of orphan status files.
+		 */
+		for (int i = 0; i < nfiles; i++)
+		{
+			if (!archived[i] && !pgarch_archiveXlogWithRetries(xlogs[i]))
+				return;
+		}
+	}
+}
+
+/*
+ * pgarch_archiveXlogWithRetries
+ *
+ * Archives one xlog, retrying a few times if that fails
+ *
+ * Returns false if we should give up archiving for now
+ */
+static bool
+pgarch_archiveXlogWithRetries(char *xlog)
+{
+	int			failures = 0;
+	int			failures_orphan = 0;
+
+	for (;;)
+	{
+		struct stat stat_buf;
+		char		pathname[MAXPGPATH];
+
+		/*
+		 * Do not initiate any more archive commands after receiving
+		 * SIGTERM, nor after the postmaster has died unexpectedly. The
+		 * first condition is to try to keep from having init SIGKILL the
+		 * command, and the second is to avoid conflicts with another
+		 * archiver spawned by a newer postmaster.
+		 */
+		if (ShutdownRequestPending || !PostmasterIsAlive())
+			return false;
+
+		/*
+		 * Check for barrier events and config update.  This is so that
+		 * we'll adopt a new setting for archive_command as soon as
+		 * possible, even if there is a backlog of files to be archived.
+		 */
+		HandlePgArchInterrupts();
+
+		/* can't do anything if not configured ... */
+		if (ArchiveCallbacks->check_configured_cb != NULL &&
+			!ArchiveCallbacks->check_configured_cb(archive_module_state))
+		{
+			ereport(WARNING,
+					(errmsg("archive_mode enabled, yet archiving is not configured")));
+			return false;
+		}
+
+		/*
+		 * Since archive status files are not removed in a durable manner,
+		 * a system crash could leave behind .ready files for WAL segments
+		 * that have already been recycled or removed.  In this case,
+		 * simply remove the orphan status file and move on.  unlink() is
+		 * used here as even on subsequent crashes the same orphan files
+		 * would get removed, so there is no need to worry about
+		 * durability.
+		 */
+		snprintf(pathname, MAXPGPATH, XLOGDIR "/%s", xlog);
+		if (stat(pathname, &stat_buf) != 0 && errno == ENOENT)
+		{
+			char		xlogready[MAXPGPATH];
+
+			StatusFilePath(xlogready, xlog, ".ready");
+			if (unlink(xlogready) == 0)
 			{
-				char		xlogready[MAXPGPATH];
-
-				StatusFilePath(xlogready, xlog, ".ready");
-				if (unlink(xlogready) == 0)
-				{
-					ereport(WARNING,
-							(errmsg("removed orphan archive status file \"%s\"",
-									xlogready)));
-
-					/* leave loop and move to the next status file */
-					break;
-				}
-
-				if (++failures_orphan >= NUM_ORPHAN_CLEANUP_RETRIES)
-				{
-					ereport(WARNING,
-							(errmsg("removal of orphan archive status file \"%s\" failed too many times, will try again later",
-									xlogready)));
-
-					/* give up cleanup of orphan status files */
-					return;
-				}
-
-				/* wait a bit before retrying */
-				pg_usleep(1000000L);
-				continue;
+				ereport(WARNING,
+						(errmsg("removed orphan archive status file \"%s\"",
+								xlogready)));
+
+				/* move to the next status file */
+				return true;
 			}
 
-			if (pgarch_archiveXlog(xlog))
+			if (++failures_orphan >= NUM_ORPHAN_CLEANUP_RETRIES)
 			{
-				/* successful */
-				pgarch_archiveDone(xlog);
-
-				/*
-				 * Tell the cumulative stats system about the WAL file that we
-				 * successfully archived
-				 */
-				pgstat_report_archiver(xlog, false);
+				ereport(WARNING,
+						(errmsg("removal of orphan archive status file \"%s\" failed too many times, will try again later",
+								xlogready)));
 
-				break;			/* out of inner retry loop */
+				/* give up cleanup of orphan status files */
+				return false;
 			}
-			else
+
+			/* wait a bit before retrying */
+			pg_usleep(1000000L);
+			continue;
+		}
+
+		if (pgarch_archiveXlog(xlog))
+		{
+			/* successful */
+			pgarch_archiveDone(xlog);
+
+			/*
+			 * Tell the cumulative stats system about the WAL file that we
+			 * successfully archived
+			 */
+			pgstat_report_archiver(xlog, false);
+
+			return true;
+		}
+		else
+		{
+			/*
+			 * Tell the cumulative stats system about the WAL file that we
+			 * failed to archive
+			 */
+			pgstat_report_archiver(xlog, true);
+
+			if (++failures >= NUM_ARCHIVE_RETRIES)
 			{
-				/*
-				 * Tell the cumulative stats system about the WAL file that we
-				 * failed to archive
-				 */
-				pgstat_report_archiver(xlog, true);
-
-				if (++failures >= NUM_ARCHIVE_RETRIES)
-				{
-					ereport(WARNING,
-							(errmsg("archiving write-ahead log file \"%s\" failed too many times, will try again later",
-									xlog)));
-					return;		/* give up archiving for now */
-				}
-				pg_usleep(1000000L);	/* wait a bit before retrying */
+				ereport(WARNING,
+						(errmsg("archiving write-ahead log file \"%s\" failed too many times, will try again later",
+								xlog)));
+				return false;	/* give up archiving for now */
 			}
+			pg_usleep(1000000L);	/* wait a bit before retrying */
 		}
 	}
 }
@@ -521,6 +581,60 @@ pgarch_archiveXlog(char *xlog)
 	return ret;
 }
 
+/*
+ * pgarch_archiveXlogs
+ *
+ * Invokes archive_files_cb to copy several archive files at once
+ *
+ * Successfully archived files are marked done, and archived[] is set for
+ * them.  It's up to the caller to deal with the others.
+ */
+static void
+pgarch_archiveXlogs(char xlogs[][MAX_XFN_CHARS + 1], int nfiles,
+					bool *archived)
+{
+	char		pathnames[MAX_ARCHIVE_BATCH_SIZE][MAXPGPATH];
+	const char *files[MAX_ARCHIVE_BATCH_SIZE];
+	const char *paths[MAX_ARCHIVE_BATCH_SIZE];
+	char		activitymsg[MAXFNAMELEN + 32];
+	int			i;
+
+	for (i = 0; i < nfiles; i++)
+	{
+		snprintf(pathnames[i], MAXPGPATH, XLOGDIR "/%s", xlogs[i]);
+		files[i] = xlogs[i];
+		paths[i] = pathnames[i];
+	}
+
+	/* Report archive activity in PS display */
+	snprintf(activitymsg, sizeof(activitymsg), "archiving %s and %d more",
+			 xlogs[0], nfiles - 1);
+	set_ps_display(activitymsg);
+
+	ArchiveCallbacks->archive_files_cb(archive_module_state, nfiles,
+									   files, paths, archived);
+
+	snprintf(activitymsg, sizeof(activitymsg), "failed on %s", xlogs[0]);
+	for (i = 0; i < nfiles; i++)
+	{
+		/*
+		 * Tell the cumulative stats system about each WAL file, like
+		 * pgarch_archiveXlogWithRetries() does.  Failed files are retried
+		 * there.
+		 */
+		if (archived[i])
+		{
+			pgarch_archiveDone(xlogs[i]);
+			pgstat_report_archiver(xlogs[i], false);
+			snprintf(activitymsg, sizeof(activitymsg), "last was %s",
+					 xlogs[i]);
+		}
+		else
+			pgstat_report_archiver(xlogs[i], true);
+	}
+	set_ps_display(activitymsg);
+}
+
 /*
  * pgarch_readyXlog
  *
@@ -777,6 +891,10 @@ HandlePgArchInterrupts(void)
 	if (LogMemoryContextPending)
 		ProcessLogMemoryContextInterrupt();
 
+	/* Publish the memory contexts of this process, if requested */
+	if (PublishMemoryContextPending)
+		ProcessGetMemoryContextInterrupt();
+
 	if (ConfigReloadPending)
 	{
 		char	   *archiveLib = pstrdup(XLogArchiveLibrary);
@@ -238,6 +238,9 @@ bool		log_hostname;		/* for ps display and logging */
 bool		Log_connections = false;
 bool		Db_user_namespace = false;
 
+/* when the current connection's setup stages were reached */
+ConnectionTiming conn_timing = {0};
+
 bool		enable_bonjour = false;
 char	   *bonjour_name;
 bool		restart_after_crash = true;
@@ -496,6 +499,7 @@ typedef struct
 {
 	Port		port;
 	InheritableSocket portsocket;
+	ConnectionTiming conn_timing;
 	char		DataDir[MAXPGPATH];
 	pgsocket	ListenSocket[MAXLISTEN];
 	int32		MyCancelKey;
@@ -530,6 +534,7 @@ typedef struct
 	bool		query_id_enabled;
 	int			max_safe_fds;
 	int			MaxBackends;
+	int			FastPathLockGroupsPerBackend;
 #ifdef WIN32
 	HANDLE		PostmasterHandle;
 	HANDLE		initial_signal_pipe;
@@ -1020,9 +1025,10 @@ PostmasterMain(int argc, char *argv[])
 
 	/*
 	 * Now that loadable modules have had their chance to alter any GUCs,
-	 * calculate MaxBackends.
+	 * calculate MaxBackends and the number of fast-path lock slots.
 	 */
 	InitializeMaxBackends();
+	InitializeFastPathLocks();
 
 	/*
 	 * Give preloaded libraries a chance to request additional shared memory.
@@ -1776,6 +1782,7 @@ ServerLoop(void)
 				port = ConnCreate(events[i].fd);
 				if (port)
 				{
+					conn_timing.socket_create = GetCurrentTimestamp();
 					BackendStartup(port);
 
 					/*
@@ -4159,12 +4166,16 @@ BackendStartup(Port *port)
 	/* Hasn't asked to be notified about any bgworkers yet */
 	bn->bgworker_notify = false;
 
+	conn_timing.fork_start = GetCurrentTimestamp();
+
 #ifdef EXEC_BACKEND
 	pid = backend_forkexec(port);
 #else							/* !EXEC_BACKEND */
 	pid = fork_process();
 	if (pid == 0)				/* child */
 	{
+		conn_timing.fork_end = GetCurrentTimestamp();
+
 		free(bn);
 
 		/* Detangle from postmaster */
@@ -4850,6 +4861,7 @@ SubPostmasterMain(int argc, char *argv[])
 	/* Read in the variables file */
 	memset(&port, 0, sizeof(Port));
 	read_backend_variables(argv[2], &port);
+	conn_timing.fork_end = GetCurrentTimestamp();
 
 	/* Close the postmaster's sockets (as soon as we know them) */
 	ClosePostmasterPorts(strcmp(argv[1], "--forklog") == 0);
@@ -6069,6 +6081,7 @@ save_backend_variables(BackendParameters *param, Port *port,
 #endif
 {
 	memcpy(&param->port, port, sizeof(Port));
+	param->conn_timing = conn_timing;
 	if (!write_inheritable_socket(&param->portsocket, port->sock, childPid))
 		return false;
 
@@ -6112,6 +6125,7 @@ save_backend_variables(BackendParameters *param, Port *port,
 	param->max_safe_fds = max_safe_fds;
 
 	param->MaxBackends = MaxBackends;
+	param->FastPathLockGroupsPerBackend = FastPathLockGroupsPerBackend;
 
 #ifdef WIN32
 	param->PostmasterHandle = PostmasterHandle;
@@ -6303,6 +6317,7 @@ static void
 restore_backend_variables(BackendParameters *param, Port *port)
 {
 	memcpy(port, &param->port, sizeof(Port));
+	conn_timing = param->conn_timing;
 	read_inheritable_socket(&port->sock, &param->portsocket);
 
 	SetDataDir(param->DataDir);
@@ -6345,6 +6360,7 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	max_safe_fds = param->max_safe_fds;
 
 	MaxBackends = param->MaxBackends;
+	FastPathLockGroupsPerBackend = param->FastPathLockGroupsPerBackend;
 
 #ifdef WIN32
 	PostmasterHandle = param->PostmasterHandle;
@@ -446,9 +446,27 @@ libpqrcv_startstreaming(WalReceiverConn *conn,
 		appendStringInfoChar(&cmd, ')');
 	}
 	else
+	{
 		appendStringInfo(&cmd, " TIMELINE %u",
 						 options->proto.physical.startpointTLI);
 
+		if (options->proto.physical.compression)
+		{
+			if (PQserverVersion(conn->streamConn) < 160000)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("could not start WAL streaming: %s",
+								_("the primary server does not support WAL compression"))));
+
+			appendStringInfo(&cmd, " (compression '%s'",
+							 options->proto.physical.compression);
+			if (options->proto.physical.compression_detail)
+				appendStringInfo(&cmd, ", compression_detail '%s'",
+								 options->proto.physical.compression_detail);
+			appendStringInfoChar(&cmd, ')');
+		}
+	}
+
 	/* Start streaming. */
 	res = libpqrcv_PQexec(conn->streamConn, cmd.data);
 	pfree(cmd.data);
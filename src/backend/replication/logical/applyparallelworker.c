@@ -43,6 +43,19 @@
  * XXX This worker pool threshold is arbitrary and we can provide a GUC
  * variable for this in the future if required.
  *
+ * Transactions that are not streamed are always applied by the leader apply
+ * worker itself.  Handing them to parallel apply workers would only pay off
+ * if the leader didn't wait for each of them to finish before dispatching the
+ * next one, so the commit order would no longer be guaranteed by this module.
+ * That would require the leader to track which rows each transaction touches
+ * (for example by hashing the replica identity key of each change), and to
+ * make a parallel apply worker wait for the commit of any earlier transaction
+ * it conflicts with.  Even then, transactions that are independent on the
+ * publisher can depend on each other on the subscriber (see "Locking
+ * Considerations" below), and the replication origin's progress would have to
+ * be advanced in commit order rather than as each worker commits.  Until all
+ * of that exists, such transactions are applied serially.
+ *
  * The leader apply worker will create a separate dynamic shared memory segment
  * when each parallel apply worker starts. The reason for this design is that
  * we cannot predict how many workers will be needed. It may be possible to
@@ -33,7 +33,8 @@ static void logicalrep_write_attrs(StringInfo out, Relation rel,
 								   Bitmapset *columns);
 static void logicalrep_write_tuple(StringInfo out, Relation rel,
 								   TupleTableSlot *slot,
-								   bool binary, Bitmapset *columns);
+								   bool binary, Bitmapset *columns,
+								   LogicalRepOutputFunc *outfuncs);
 static void logicalrep_read_attrs(StringInfo in, LogicalRepRelation *rel);
 static void logicalrep_read_tuple(StringInfo in, LogicalRepTupleData *tuple);
 
@@ -412,7 +413,8 @@ logicalrep_read_origin(StringInfo in, XLogRecPtr *origin_lsn)
  */
 void
 logicalrep_write_insert(StringInfo out, TransactionId xid, Relation rel,
-						TupleTableSlot *newslot, bool binary, Bitmapset *columns)
+						TupleTableSlot *newslot, bool binary, Bitmapset *columns,
+						LogicalRepOutputFunc *outfuncs)
 {
 	pq_sendbyte(out, LOGICAL_REP_MSG_INSERT);
 
@@ -424,7 +426,7 @@ logicalrep_write_insert(StringInfo out, TransactionId xid, Relation rel,
 	pq_sendint32(out, RelationGetRelid(rel));
 
 	pq_sendbyte(out, 'N');		/* new tuple follows */
-	logicalrep_write_tuple(out, rel, newslot, binary, columns);
+	logicalrep_write_tuple(out, rel, newslot, binary, columns, outfuncs);
 }
 
 /*
@@ -457,7 +459,8 @@ logicalrep_read_insert(StringInfo in, LogicalRepTupleData *newtup)
 void
 logicalrep_write_update(StringInfo out, TransactionId xid, Relation rel,
 						TupleTableSlot *oldslot, TupleTableSlot *newslot,
-						bool binary, Bitmapset *columns)
+						bool binary, Bitmapset *columns,
+						LogicalRepOutputFunc *outfuncs)
 {
 	pq_sendbyte(out, LOGICAL_REP_MSG_UPDATE);
 
@@ -478,11 +481,11 @@ logicalrep_write_update(StringInfo out, TransactionId xid, Relation rel,
 			pq_sendbyte(out, 'O');	/* old tuple follows */
 		else
 			pq_sendbyte(out, 'K');	/* old key follows */
-		logicalrep_write_tuple(out, rel, oldslot, binary, columns);
+		logicalrep_write_tuple(out, rel, oldslot, binary, columns, outfuncs);
 	}
 
 	pq_sendbyte(out, 'N');		/* new tuple follows */
-	logicalrep_write_tuple(out, rel, newslot, binary, columns);
+	logicalrep_write_tuple(out, rel, newslot, binary, columns, outfuncs);
 }
 
 /*
@@ -532,7 +535,7 @@ logicalrep_read_update(StringInfo in, bool *has_oldtuple,
 void
 logicalrep_write_delete(StringInfo out, TransactionId xid, Relation rel,
 						TupleTableSlot *oldslot, bool binary,
-						Bitmapset *columns)
+						Bitmapset *columns, LogicalRepOutputFunc *outfuncs)
 {
 	Assert(rel->rd_rel->relreplident == REPLICA_IDENTITY_DEFAULT ||
 		   rel->rd_rel->relreplident == REPLICA_IDENTITY_FULL ||
@@ -552,7 +555,7 @@ logicalrep_write_delete(StringInfo out, TransactionId xid, Relation rel,
 	else
 		pq_sendbyte(out, 'K');	/* old key follows */
 
-	logicalrep_write_tuple(out, rel, oldslot, binary, columns);
+	logicalrep_write_tuple(out, rel, oldslot, binary, columns, outfuncs);
 }
 
 /*
@@ -762,12 +765,57 @@ logicalrep_read_typ(StringInfo in, LogicalRepTyp *ltyp)
 	ltyp->typname = pstrdup(pq_getmsgstring(in));
 }
 
+/*
+ * Look up the functions that logicalrep_write_tuple() uses to send the
+ * columns of 'rel', so that an output plugin can do that once per relation
+ * instead of once per row.  The result, and any state that the functions
+ * cache in their FmgrInfo, is allocated in 'mcxt'.
+ */
+LogicalRepOutputFunc *
+logicalrep_get_output_funcs(Relation rel, bool binary, MemoryContext mcxt)
+{
+	TupleDesc	desc = RelationGetDescr(rel);
+	LogicalRepOutputFunc *outfuncs;
+	int			i;
+
+	outfuncs = (LogicalRepOutputFunc *)
+		MemoryContextAllocZero(mcxt, desc->natts * sizeof(LogicalRepOutputFunc));
+
+	for (i = 0; i < desc->natts; i++)
+	{
+		HeapTuple	typtup;
+		Form_pg_type typclass;
+		Form_pg_attribute att = TupleDescAttr(desc, i);
+
+		if (att->attisdropped || att->attgenerated)
+			continue;
+
+		typtup = SearchSysCache1(TYPEOID, ObjectIdGetDatum(att->atttypid));
+		if (!HeapTupleIsValid(typtup))
+			elog(ERROR, "cache lookup failed for type %u", att->atttypid);
+		typclass = (Form_pg_type) GETSTRUCT(typtup);
+
+		outfuncs[i].binary = binary && OidIsValid(typclass->typsend);
+		fmgr_info_cxt(outfuncs[i].binary ? typclass->typsend : typclass->typoutput,
+					  &outfuncs[i].finfo, mcxt);
+
+		ReleaseSysCache(typtup);
+	}
+
+	return outfuncs;
+}
+
 /*
  * Write a tuple to the outputstream, in the most efficient format possible.
+ *
+ * If 'outfuncs' is given, it must have been built by
+ * logicalrep_get_output_funcs() for 'rel'; otherwise the type of each column
+ * is looked up here.
  */
 static void
 logicalrep_write_tuple(StringInfo out, Relation rel, TupleTableSlot *slot,
-					   bool binary, Bitmapset *columns)
+					   bool binary, Bitmapset *columns,
+					   LogicalRepOutputFunc *outfuncs)
 {
 	TupleDesc	desc;
 	Datum	   *values;
@@ -825,6 +873,32 @@ logicalrep_write_tuple(StringInfo out, Relation rel, TupleTableSlot *slot,
 			continue;
 		}
 
+		if (outfuncs)
+		{
+			if (outfuncs[i].binary)
+			{
+				bytea	   *outputbytes;
+				int			len;
+
+				pq_sendbyte(out, LOGICALREP_COLUMN_BINARY);
+				outputbytes = SendFunctionCall(&outfuncs[i].finfo, values[i]);
+				len = VARSIZE(outputbytes) - VARHDRSZ;
+				pq_sendint(out, len, 4);	/* length */
+				pq_sendbytes(out, VARDATA(outputbytes), len);	/* data */
+				pfree(outputbytes);
+			}
+			else
+			{
+				char	   *outputstr;
+
+				pq_sendbyte(out, LOGICALREP_COLUMN_TEXT);
+				outputstr = OutputFunctionCall(&outfuncs[i].finfo, values[i]);
+				pq_sendcountedtext(out, outputstr, strlen(outputstr), false);
+				pfree(outputstr);
+			}
+			continue;
+		}
+
 		typtup = SearchSysCache1(TYPEOID, ObjectIdGetDatum(att->atttypid));
 		if (!HeapTupleIsValid(typtup))
 			elog(ERROR, "cache lookup failed for type %u", att->atttypid);
@@ -83,6 +83,12 @@
 
 #include <unistd.h>
 #include <sys/stat.h>
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "access/detoast.h"
 #include "access/heapam.h"
@@ -91,6 +97,7 @@
 #include "access/xact.h"
 #include "access/xlog_internal.h"
 #include "catalog/catalog.h"
+#include "common/pg_lzcompress.h"
 #include "lib/binaryheap.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -173,11 +180,17 @@ typedef struct ReorderBufferToastEnt
 /* Disk serialization support datastructures */
 typedef struct ReorderBufferDiskChange
 {
-	Size		size;
+	Size		size;			/* on-disk size, including this header */
+	Size		rawsize;		/* size of data when decompressed, or 0 if
+								 * data isn't compressed */
+	int			method;			/* WalCompression method, if compressed */
 	ReorderBufferChange change;
 	/* data follows */
 } ReorderBufferDiskChange;
 
+/* changes with less data than this aren't worth compressing */
+#define SPILL_COMPRESS_MIN_SIZE		128
+
 #define IsSpecInsert(action) \
 ( \
 	((action) == REORDER_BUFFER_CHANGE_INTERNAL_SPEC_INSERT) \
@@ -207,6 +220,7 @@ typedef struct ReorderBufferDiskChange
  * like.
  */
 int			logical_decoding_work_mem;
+int			logical_decoding_spill_compression = WAL_COMPRESSION_NONE;
 static const Size max_changes_in_memory = 4096; /* XXX for restore only */
 
 /* GUC variable */
@@ -354,6 +368,8 @@ ReorderBufferAllocate(void)
 
 	buffer->outbuf = NULL;
 	buffer->outbufsize = 0;
+	buffer->compressbuf = NULL;
+	buffer->compressbufsize = 0;
 	buffer->size = 0;
 
 	buffer->spillTxns = 0;
@@ -3481,6 +3497,154 @@ ReorderBufferSerializeReserve(ReorderBuffer *rb, Size sz)
 	}
 }
 
+/*
+ * Ensure the compression buffer is >= sz.
+ */
+static void
+ReorderBufferCompressReserve(ReorderBuffer *rb, Size sz)
+{
+	if (!rb->compressbufsize)
+	{
+		rb->compressbuf = MemoryContextAlloc(rb->context, sz);
+		rb->compressbufsize = sz;
+	}
+	else if (rb->compressbufsize < sz)
+	{
+		rb->compressbuf = repalloc(rb->compressbuf, sz);
+		rb->compressbufsize = sz;
+	}
+}
+
+/*
+ * Compress the data of the serialized change in rb->outbuf in place, if
+ * logical_decoding_spill_compression is set and that makes it smaller.
+ */
+static void
+ReorderBufferCompressChange(ReorderBuffer *rb)
+{
+	ReorderBufferDiskChange *ondisk = (ReorderBufferDiskChange *) rb->outbuf;
+	char	   *data = rb->outbuf + sizeof(ReorderBufferDiskChange);
+	int32		rawsize = ondisk->size - sizeof(ReorderBufferDiskChange);
+	int32		bound = rawsize;
+	int32		len = -1;
+
+	ondisk->rawsize = 0;
+
+	if (logical_decoding_spill_compression == WAL_COMPRESSION_NONE ||
+		rawsize < SPILL_COMPRESS_MIN_SIZE)
+		return;
+
+	switch ((WalCompression) logical_decoding_spill_compression)
+	{
+		case WAL_COMPRESSION_PGLZ:
+			bound = PGLZ_MAX_OUTPUT(rawsize);
+			ReorderBufferCompressReserve(rb, bound);
+			len = pglz_compress(data, rawsize, rb->compressbuf,
+								PGLZ_strategy_default);
+			break;
+
+		case WAL_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			bound = LZ4_compressBound(rawsize);
+			ReorderBufferCompressReserve(rb, bound);
+			len = LZ4_compress_default(data, rb->compressbuf, rawsize, bound);
+			if (len <= 0)
+				len = -1;		/* failure */
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		case WAL_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			bound = ZSTD_compressBound(rawsize);
+			ReorderBufferCompressReserve(rb, bound);
+			len = ZSTD_compress(rb->compressbuf, bound, data, rawsize,
+								ZSTD_CLEVEL_DEFAULT);
+			if (ZSTD_isError(len))
+				len = -1;		/* failure */
+#else
+			elog(ERROR, "zstd is not supported by this build");
+#endif
+			break;
+
+		case WAL_COMPRESSION_NONE:
+			Assert(false);		/* cannot happen */
+			break;
+			/* no default case, so that compiler will warn */
+	}
+
+	if (len < 0 || len >= rawsize)
+		return;
+
+	memcpy(data, rb->compressbuf, len);
+	ondisk->size = sizeof(ReorderBufferDiskChange) + len;
+	ondisk->rawsize = rawsize;
+	ondisk->method = logical_decoding_spill_compression;
+}
+
+/*
+ * Decompress the data of the change read from disk into rb->outbuf, if it
+ * was compressed.
+ */
+static void
+ReorderBufferDecompressChange(ReorderBuffer *rb)
+{
+	ReorderBufferDiskChange *ondisk = (ReorderBufferDiskChange *) rb->outbuf;
+	int32		len = ondisk->size - sizeof(ReorderBufferDiskChange);
+	int32		rawsize = ondisk->rawsize;
+	bool		ok = false;
+
+	if (rawsize == 0)
+		return;
+
+	/* move the compressed data aside, and make room for the result */
+	ReorderBufferCompressReserve(rb, len);
+	memcpy(rb->compressbuf, rb->outbuf + sizeof(ReorderBufferDiskChange), len);
+	ReorderBufferSerializeReserve(rb, sizeof(ReorderBufferDiskChange) + rawsize);
+	ondisk = (ReorderBufferDiskChange *) rb->outbuf;
+
+	switch ((WalCompression) ondisk->method)
+	{
+		case WAL_COMPRESSION_PGLZ:
+			ok = pglz_decompress(rb->compressbuf, len,
+								 rb->outbuf + sizeof(ReorderBufferDiskChange),
+								 rawsize, true) == rawsize;
+			break;
+
+		case WAL_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			ok = LZ4_decompress_safe(rb->compressbuf,
+									 rb->outbuf + sizeof(ReorderBufferDiskChange),
+									 len, rawsize) == rawsize;
+#endif
+			break;
+
+		case WAL_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		decomp;
+
+				decomp = ZSTD_decompress(rb->outbuf + sizeof(ReorderBufferDiskChange),
+										 rawsize, rb->compressbuf, len);
+				ok = !ZSTD_isError(decomp) && decomp == rawsize;
+			}
+#endif
+			break;
+
+		case WAL_COMPRESSION_NONE:
+			break;
+	}
+
+	if (!ok)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("could not decompress change in reorderbuffer spill file")));
+
+	ondisk->size = sizeof(ReorderBufferDiskChange) + rawsize;
+	ondisk->rawsize = 0;
+}
+
 /*
  * Find the largest transaction (toplevel or subxact) to evict (spill to disk).
  *
@@ -3931,6 +4095,8 @@ ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 
 	ondisk->size = sz;
 
+	ReorderBufferCompressChange(rb);
+
 	errno = 0;
 	pgstat_report_wait_start(WAIT_EVENT_REORDER_BUFFER_WRITE);
 	if (write(fd, rb->outbuf, ondisk->size) != ondisk->size)
@@ -4324,6 +4490,8 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 
 		file->curOffset += readBytes;
 
+		ReorderBufferDecompressChange(rb);
+
 		/*
 		 * ok, read a full change from disk, now restore it into proper
 		 * in-memory format
@@ -94,9 +94,12 @@
 
 #include "postgres.h"
 
+#include "access/htup_details.h"
 #include "access/table.h"
 #include "access/xact.h"
+#include "catalog/index.h"
 #include "catalog/indexing.h"
+#include "catalog/pg_index.h"
 #include "catalog/pg_subscription_rel.h"
 #include "catalog/pg_type.h"
 #include "commands/copy.h"
@@ -109,11 +112,13 @@
 #include "replication/worker_internal.h"
 #include "replication/slot.h"
 #include "replication/origin.h"
+#include "storage/bufmgr.h"
 #include "storage/ipc.h"
 #include "storage/lmgr.h"
 #include "utils/acl.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/inval.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rls.h"
@@ -1074,6 +1079,79 @@ fetch_remote_table_info(char *nspname, char *relname,
 	pfree(cmd.data);
 }
 
+/*
+ * Stop maintaining the indexes of the table, so that the initial copy can
+ * skip them, and return the list of their OIDs.  rebuild_deferred_indexes()
+ * builds them from scratch afterwards, which is much cheaper than inserting
+ * each copied row into them.
+ *
+ * The indexes are marked invalid and not ready only in our own transaction,
+ * so other sessions go on maintaining them, and an aborted copy leaves them
+ * intact.  That's why we don't use index_set_state_flags(), which updates
+ * pg_index in place.
+ */
+static List *
+defer_index_maintenance(Relation rel)
+{
+	List	   *indexoids = NIL;
+	Relation	pg_index;
+	ListCell   *lc;
+
+	pg_index = table_open(IndexRelationId, RowExclusiveLock);
+
+	foreach(lc, RelationGetIndexList(rel))
+	{
+		Oid			indexoid = lfirst_oid(lc);
+		HeapTuple	indexTuple;
+		Form_pg_index indexForm;
+
+		indexTuple = SearchSysCacheCopy1(INDEXRELID,
+										 ObjectIdGetDatum(indexoid));
+		if (!HeapTupleIsValid(indexTuple))
+			elog(ERROR, "cache lookup failed for index %u", indexoid);
+		indexForm = (Form_pg_index) GETSTRUCT(indexTuple);
+
+		/* Leave alone leftovers of failed concurrent index builds */
+		if (indexForm->indisvalid && indexForm->indisready &&
+			indexForm->indislive)
+		{
+			indexForm->indisvalid = false;
+			indexForm->indisready = false;
+			CatalogTupleUpdate(pg_index, &indexTuple->t_self, indexTuple);
+			indexoids = lappend_oid(indexoids, indexoid);
+		}
+
+		heap_freetuple(indexTuple);
+	}
+
+	table_close(pg_index, RowExclusiveLock);
+
+	/* Make the copy see the new flags */
+	CacheInvalidateRelcache(rel);
+	CommandCounterIncrement();
+
+	return indexoids;
+}
+
+/*
+ * Build the indexes skipped during the initial copy, checking their unique
+ * and exclusion constraints.  reindex_index() marks them valid and ready
+ * again.
+ */
+static void
+rebuild_deferred_indexes(Relation rel, List *indexoids)
+{
+	ReindexParams params = {0};
+	ListCell   *lc;
+
+	foreach(lc, indexoids)
+	{
+		reindex_index(lfirst_oid(lc), false, rel->rd_rel->relpersistence,
+					  &params);
+		CommandCounterIncrement();
+	}
+}
+
 /*
  * Copy existing data of a table from publisher.
  *
@@ -1090,6 +1168,7 @@ copy_table(Relation rel)
 	CopyFromState cstate;
 	List	   *attnamelist;
 	ParseState *pstate;
+	List	   *deferred_indexes = NIL;
 
 	/* Get the publisher relation info. */
 	fetch_remote_table_info(get_namespace_name(RelationGetNamespace(rel)),
@@ -1183,12 +1262,23 @@ copy_table(Relation rel)
 	(void) addRangeTableEntryForRelation(pstate, rel, AccessShareLock,
 										 NULL, false, false);
 
+	/*
+	 * If the table is empty, build its indexes after the copy rather than
+	 * inserting every row into them.
+	 */
+	if (rel->rd_rel->relkind == RELKIND_RELATION &&
+		RelationGetNumberOfBlocks(rel) == 0)
+		deferred_indexes = defer_index_maintenance(rel);
+
 	attnamelist = make_copy_attnamelist(relmapentry);
 	cstate = BeginCopyFrom(pstate, rel, NULL, NULL, false, copy_read_data, attnamelist, NIL);
 
 	/* Do the copy */
 	(void) CopyFrom(cstate);
 
+	if (deferred_indexes != NIL)
+		rebuild_deferred_indexes(rel, deferred_indexes);
+
 	logicalrep_rel_close(relmapentry, NoLock);
 }
 
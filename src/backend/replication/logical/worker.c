@@ -231,6 +231,32 @@ typedef struct ApplyExecutionData
 	PartitionTupleRouting *proute;	/* partition routing info */
 } ApplyExecutionData;
 
+/*
+ * Consecutive INSERTs into the same table within a transaction are not
+ * applied one by one.  They are collected in the pending insert batch, and
+ * stored with a single table_multi_insert() call when a change of another
+ * kind or for another relation arrives, at the end of the transaction, or
+ * when the batch is full, like COPY FROM does.
+ *
+ * The batch's executor state must survive the resets of ApplyMessageContext,
+ * so it is allocated in InsertBatchContext instead, which is reset when the
+ * batch has been applied.
+ */
+#define MAX_INSERT_BATCH_TUPLES	1000
+#define MAX_INSERT_BATCH_BYTES	65535
+
+typedef struct ApplyInsertBatch
+{
+	ApplyExecutionData *edata;	/* NULL if there is no pending batch */
+	TupleTableSlot *remoteslot; /* for converting the remote tuples */
+	TupleTableSlot *slots[MAX_INSERT_BATCH_TUPLES];
+	int			nslots;			/* number of slots in use */
+	Size		nbytes;			/* size of the remote tuple data */
+} ApplyInsertBatch;
+
+static ApplyInsertBatch insert_batch;
+static MemoryContext InsertBatchContext = NULL;
+
 /* Struct for saving and restoring apply errcontext information */
 typedef struct ApplyErrorCallbackArg
 {
@@ -397,6 +423,11 @@ static void apply_handle_commit_internal(LogicalRepCommitData *commit_data);
 static void apply_handle_insert_internal(ApplyExecutionData *edata,
 										 ResultRelInfo *relinfo,
 										 TupleTableSlot *remoteslot);
+static bool insert_batch_allowed(LogicalRepRelMapEntry *rel);
+static void insert_batch_start(LogicalRepRelMapEntry *rel);
+static void insert_batch_add(LogicalRepTupleData *newtup);
+static void insert_batch_flush(void);
+static void apply_pending_inserts(void);
 static void apply_handle_update_internal(ApplyExecutionData *edata,
 										 ResultRelInfo *relinfo,
 										 TupleTableSlot *remoteslot,
@@ -2134,6 +2165,9 @@ apply_spooled_messages(FileSet *stream_fileset, TransactionId xid,
 				 nchanges, path);
 	}
 
+	/* The transaction's last changes might still be pending */
+	apply_pending_inserts();
+
 	if (stream_fd)
 		stream_close_file();
 
@@ -2426,6 +2460,23 @@ apply_handle_insert(StringInfo s)
 	begin_replication_step();
 
 	relid = logicalrep_read_insert(s, &newtup);
+
+	/*
+	 * Add the tuple to the pending insert batch if it's for the same
+	 * relation, otherwise apply the batch first.
+	 */
+	if (insert_batch.edata != NULL)
+	{
+		if (insert_batch.edata->targetRel->remoterel.remoteid == relid)
+		{
+			insert_batch_add(&newtup);
+			end_replication_step();
+			return;
+		}
+
+		insert_batch_flush();
+	}
+
 	rel = logicalrep_rel_open(relid, RowExclusiveLock);
 	if (!should_apply_changes_for_rel(rel))
 	{
@@ -2438,6 +2489,15 @@ apply_handle_insert(StringInfo s)
 		return;
 	}
 
+	/* Start a new batch, if the relation allows it */
+	if (insert_batch_allowed(rel))
+	{
+		insert_batch_start(rel);
+		insert_batch_add(&newtup);
+		end_replication_step();
+		return;
+	}
+
 	/* Set relation for error callback */
 	apply_error_callback_arg.rel = rel;
 
@@ -2495,6 +2555,186 @@ apply_handle_insert_internal(ApplyExecutionData *edata,
 	ExecCloseIndices(relinfo);
 }
 
+/*
+ * Can INSERTs into the relation be collected in the pending insert batch?
+ *
+ * Not in a parallel apply worker, which must apply the changes of each
+ * subtransaction before defining the savepoint of the next one.  Partitioned
+ * tables need tuple routing, and BEFORE ROW triggers and volatile default
+ * expressions might look at the table, which doesn't contain the earlier
+ * tuples of the batch yet.
+ */
+static bool
+insert_batch_allowed(LogicalRepRelMapEntry *rel)
+{
+	Relation	localrel = rel->localrel;
+	TupleDesc	desc = RelationGetDescr(localrel);
+
+	if (am_parallel_apply_worker())
+		return false;
+
+	if (localrel->rd_rel->relkind != RELKIND_RELATION)
+		return false;
+
+	if (localrel->trigdesc && localrel->trigdesc->trig_insert_before_row)
+		return false;
+
+	/* Check the defaults that slot_fill_defaults() would evaluate */
+	for (int attnum = 0; attnum < desc->natts; attnum++)
+	{
+		Expr	   *defexpr;
+
+		if (TupleDescAttr(desc, attnum)->attisdropped ||
+			TupleDescAttr(desc, attnum)->attgenerated)
+			continue;
+
+		if (rel->attrmap->attnums[attnum] >= 0)
+			continue;
+
+		defexpr = (Expr *) build_column_default(localrel, attnum + 1);
+		if (defexpr != NULL &&
+			contain_volatile_functions_not_nextval((Node *) defexpr))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Start a pending insert batch for the relation, which the caller has
+ * opened.  The relation is closed when the batch is applied.
+ */
+static void
+insert_batch_start(LogicalRepRelMapEntry *rel)
+{
+	ApplyExecutionData *edata;
+	MemoryContext oldctx;
+
+	Assert(insert_batch.edata == NULL);
+
+	if (InsertBatchContext == NULL)
+		InsertBatchContext = AllocSetContextCreate(ApplyContext,
+												   "ApplyInsertBatchContext",
+												   ALLOCSET_DEFAULT_SIZES);
+
+	oldctx = MemoryContextSwitchTo(InsertBatchContext);
+
+	edata = create_edata_for_relation(rel);
+	insert_batch.remoteslot = ExecInitExtraTupleSlot(edata->estate,
+													 RelationGetDescr(rel->localrel),
+													 &TTSOpsVirtual);
+	ExecOpenIndices(edata->targetRelInfo, false);
+
+	MemoryContextSwitchTo(oldctx);
+
+	TargetPrivilegesCheck(rel->localrel, ACL_INSERT);
+
+	insert_batch.edata = edata;
+}
+
+/*
+ * Add a remote tuple to the pending insert batch, and apply the batch if
+ * it's full.
+ */
+static void
+insert_batch_add(LogicalRepTupleData *newtup)
+{
+	ApplyExecutionData *edata = insert_batch.edata;
+	EState	   *estate = edata->estate;
+	LogicalRepRelMapEntry *rel = edata->targetRel;
+	TupleTableSlot *slot;
+	MemoryContext oldctx;
+
+	/* Set relation for error callback */
+	apply_error_callback_arg.rel = rel;
+
+	/* Process and store remote tuple in the slot */
+	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+	slot_store_data(insert_batch.remoteslot, rel, newtup);
+	slot_fill_defaults(rel, estate, insert_batch.remoteslot);
+	MemoryContextSwitchTo(oldctx);
+
+	/* Keep a copy of it in a slot of the table's own type */
+	slot = insert_batch.slots[insert_batch.nslots];
+	if (slot == NULL)
+	{
+		oldctx = MemoryContextSwitchTo(InsertBatchContext);
+		slot = table_slot_create(rel->localrel, &estate->es_tupleTable);
+		insert_batch.slots[insert_batch.nslots] = slot;
+		MemoryContextSwitchTo(oldctx);
+	}
+	ExecCopySlot(slot, insert_batch.remoteslot);
+	ResetPerTupleExprContext(estate);
+
+	insert_batch.nslots++;
+	for (int i = 0; i < newtup->ncols; i++)
+		insert_batch.nbytes += newtup->colvalues[i].len;
+
+	/* Reset relation for error callback */
+	apply_error_callback_arg.rel = NULL;
+
+	if (insert_batch.nslots == MAX_INSERT_BATCH_TUPLES ||
+		insert_batch.nbytes >= MAX_INSERT_BATCH_BYTES)
+		insert_batch_flush();
+}
+
+/*
+ * Insert the tuples of the pending insert batch, if any, and forget the
+ * batch.
+ *
+ * Caller must be in a replication step, see apply_pending_inserts().
+ */
+static void
+insert_batch_flush(void)
+{
+	ApplyExecutionData *edata = insert_batch.edata;
+	LogicalRepRelMapEntry *rel;
+	LogicalRepMsgType saved_command;
+
+	if (edata == NULL)
+		return;
+
+	rel = edata->targetRel;
+
+	/* Errors are reported as if they happened while applying an INSERT */
+	saved_command = apply_error_callback_arg.command;
+	apply_error_callback_arg.command = LOGICAL_REP_MSG_INSERT;
+	apply_error_callback_arg.rel = rel;
+
+	if (insert_batch.nslots > 0)
+		ExecSimpleRelationMultiInsert(edata->targetRelInfo, edata->estate,
+									  insert_batch.slots, insert_batch.nslots);
+
+	ExecCloseIndices(edata->targetRelInfo);
+	finish_edata(edata);
+
+	apply_error_callback_arg.command = saved_command;
+	apply_error_callback_arg.rel = NULL;
+
+	logicalrep_rel_close(rel, NoLock);
+
+	MemoryContextReset(InsertBatchContext);
+	MemSet(&insert_batch, 0, sizeof(insert_batch));
+}
+
+/*
+ * Apply the pending insert batch, if any.
+ *
+ * This must happen before any change other than an INSERT for the same
+ * relation is applied, since that change might depend on the batch's tuples,
+ * and before the end of the transaction.
+ */
+static void
+apply_pending_inserts(void)
+{
+	if (insert_batch.edata == NULL)
+		return;
+
+	begin_replication_step();
+	insert_batch_flush();
+	end_replication_step();
+}
+
 /*
  * Check if the logical replication relation is updatable and throw
  * appropriate error if it isn't.
@@ -3256,6 +3496,9 @@ apply_dispatch(StringInfo s)
 	saved_command = apply_error_callback_arg.command;
 	apply_error_callback_arg.command = action;
 
+	if (action != LOGICAL_REP_MSG_INSERT)
+		apply_pending_inserts();
+
 	switch (action)
 	{
 		case LOGICAL_REP_MSG_BEGIN:
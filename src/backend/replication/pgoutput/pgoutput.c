@@ -178,6 +178,14 @@ typedef struct RelationSyncEntry
 	 * row filter expressions, column list, etc.
 	 */
 	MemoryContext entry_cxt;
+
+	/*
+	 * Functions used to send the columns of the published relation, or NULL
+	 * if they have yet to be looked up.  They live in outfuncs_cxt, a child
+	 * of entry_cxt, which is reset whenever they are looked up again.
+	 */
+	LogicalRepOutputFunc *outfuncs;
+	MemoryContext outfuncs_cxt;
 } RelationSyncEntry;
 
 /*
@@ -219,12 +227,16 @@ static RelationSyncEntry *get_rel_sync_entry(PGOutputData *data,
 static void rel_sync_cache_relation_cb(Datum arg, Oid relid);
 static void rel_sync_cache_publication_cb(Datum arg, int cacheid,
 										  uint32 hashvalue);
+static void rel_sync_cache_type_cb(Datum arg, int cacheid, uint32 hashvalue);
 static void set_schema_sent_in_streamed_txn(RelationSyncEntry *entry,
 											TransactionId xid);
 static bool get_schema_sent_in_streamed_txn(RelationSyncEntry *entry,
 											TransactionId xid);
 static void init_tuple_slot(PGOutputData *data, Relation relation,
 							RelationSyncEntry *entry);
+static LogicalRepOutputFunc *get_output_funcs(PGOutputData *data,
+											  Relation relation,
+											  RelationSyncEntry *entry);
 
 /* row filter routines */
 static EState *create_estate_for_relation(Relation rel);
@@ -1166,6 +1178,37 @@ init_tuple_slot(PGOutputData *data, Relation relation,
 	}
 }
 
+/*
+ * Get the functions used to send the columns of 'relation', which is the
+ * relation that the changes of 'entry' are published as.
+ *
+ * Looking these up only once per relation, rather than for every column of
+ * every row sent, saves a type cache lookup and an fmgr_info() call per
+ * column, and lets output functions keep their own state across rows.
+ */
+static LogicalRepOutputFunc *
+get_output_funcs(PGOutputData *data, Relation relation,
+				 RelationSyncEntry *entry)
+{
+	if (entry->outfuncs)
+		return entry->outfuncs;
+
+	if (entry->outfuncs_cxt)
+		MemoryContextReset(entry->outfuncs_cxt);
+	else
+	{
+		pgoutput_ensure_entry_cxt(data, entry);
+		entry->outfuncs_cxt = AllocSetContextCreate(entry->entry_cxt,
+													"output functions",
+													ALLOCSET_SMALL_SIZES);
+	}
+
+	entry->outfuncs = logicalrep_get_output_funcs(relation, data->binary,
+												  entry->outfuncs_cxt);
+
+	return entry->outfuncs;
+}
+
 /*
  * Change is checked against the row filter if any.
  *
@@ -1496,7 +1539,8 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 
 			OutputPluginPrepareWrite(ctx, true);
 			logicalrep_write_insert(ctx->out, xid, targetrel, new_slot,
-									data->binary, relentry->columns);
+									data->binary, relentry->columns,
+									get_output_funcs(data, targetrel, relentry));
 			OutputPluginWrite(ctx, true);
 			break;
 		case REORDER_BUFFER_CHANGE_UPDATE:
@@ -1555,17 +1599,20 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 				case REORDER_BUFFER_CHANGE_INSERT:
 					logicalrep_write_insert(ctx->out, xid, targetrel,
 											new_slot, data->binary,
-											relentry->columns);
+											relentry->columns,
+											get_output_funcs(data, targetrel, relentry));
 					break;
 				case REORDER_BUFFER_CHANGE_UPDATE:
 					logicalrep_write_update(ctx->out, xid, targetrel,
 											old_slot, new_slot, data->binary,
-											relentry->columns);
+											relentry->columns,
+											get_output_funcs(data, targetrel, relentry));
 					break;
 				case REORDER_BUFFER_CHANGE_DELETE:
 					logicalrep_write_delete(ctx->out, xid, targetrel,
 											old_slot, data->binary,
-											relentry->columns);
+											relentry->columns,
+											get_output_funcs(data, targetrel, relentry));
 					break;
 				default:
 					Assert(false);
@@ -1612,7 +1659,8 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 				OutputPluginPrepareWrite(ctx, true);
 				logicalrep_write_delete(ctx->out, xid, targetrel,
 										old_slot, data->binary,
-										relentry->columns);
+										relentry->columns,
+										get_output_funcs(data, targetrel, relentry));
 				OutputPluginWrite(ctx, true);
 			}
 			else
@@ -1990,6 +2038,12 @@ init_rel_sync_cache(MemoryContext cachectx)
 								  rel_sync_cache_publication_cb,
 								  (Datum) 0);
 
+	/*
+	 * Look up the output functions again after a pg_type change, in case the
+	 * send or output function of a type was changed.
+	 */
+	CacheRegisterSyscacheCallback(TYPEOID, rel_sync_cache_type_cb, (Datum) 0);
+
 	relation_callbacks_registered = true;
 }
 
@@ -2058,6 +2112,8 @@ get_rel_sync_entry(PGOutputData *data, Relation relation)
 		entry->publish_as_relid = InvalidOid;
 		entry->columns = NULL;
 		entry->attrmap = NULL;
+		entry->outfuncs = NULL;
+		entry->outfuncs_cxt = NULL;
 	}
 
 	/* Validate the entry */
@@ -2133,6 +2189,8 @@ get_rel_sync_entry(PGOutputData *data, Relation relation)
 		entry->entry_cxt = NULL;
 		entry->estate = NULL;
 		memset(entry->exprstate, 0, sizeof(entry->exprstate));
+		entry->outfuncs = NULL;
+		entry->outfuncs_cxt = NULL;
 
 		/*
 		 * Build publication cache. We can't use one provided by relcache as
@@ -2408,6 +2466,29 @@ rel_sync_cache_publication_cb(Datum arg, int cacheid, uint32 hashvalue)
 	}
 }
 
+/*
+ * Type syscache invalidation callback
+ *
+ * Only the output functions depend on pg_type, so there's no need to rebuild
+ * the whole entry.  As in the other callbacks, the old functions must stay
+ * usable until the next lookup, which is when their memory is reset.
+ */
+static void
+rel_sync_cache_type_cb(Datum arg, int cacheid, uint32 hashvalue)
+{
+	HASH_SEQ_STATUS status;
+	RelationSyncEntry *entry;
+
+	if (RelationSyncCache == NULL)
+		return;
+
+	hash_seq_init(&status, RelationSyncCache);
+	while ((entry = (RelationSyncEntry *) hash_seq_search(&status)) != NULL)
+	{
+		entry->outfuncs = NULL;
+	}
+}
+
 /* Send Replication origin */
 static void
 send_repl_origin(LogicalDecodingContext *ctx, RepOriginId origin_id,
@@ -0,0 +1,187 @@
+/*-------------------------------------------------------------------------
+ *
+ * walcompress.c
+ *	  Compression of the WAL data sent by walsender to walreceiver
+ *
+ * When the standby asks for it in START_REPLICATION, walsender compresses
+ * the WAL data of each XLogData message separately, and sends it in a
+ * CompressedXLogData message instead, provided that it came out smaller.
+ * Each message is compressed independently, so that walreceiver doesn't need
+ * to keep any state between messages beyond the algorithm in use.
+ *
+ * Portions Copyright (c) 2010-2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/replication/walcompress.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+#ifdef USE_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "replication/walcompress.h"
+
+#ifdef USE_ZSTD
+static ZSTD_CCtx *zstd_cctx = NULL;
+static ZSTD_DCtx *zstd_dctx = NULL;
+#endif
+
+/*
+ * Return the size of the buffer that WalCompress() needs for compressing
+ * 'len' bytes with 'algorithm'.
+ */
+int
+WalCompressBound(pg_compress_algorithm algorithm, int len)
+{
+	switch (algorithm)
+	{
+		case PG_COMPRESSION_NONE:
+			break;
+		case PG_COMPRESSION_GZIP:
+#ifdef HAVE_LIBZ
+			return compressBound(len);
+#endif
+			break;
+		case PG_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			return LZ4_compressBound(len);
+#endif
+			break;
+		case PG_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			return ZSTD_compressBound(len);
+#endif
+			break;
+	}
+
+	return len;
+}
+
+/*
+ * Compress 'srclen' bytes at 'src' into 'dst', which must have room for
+ * WalCompressBound() bytes.
+ *
+ * Returns the compressed length, or -1 if the data couldn't be compressed, in
+ * which case the caller should just send it uncompressed.
+ */
+int
+WalCompress(const pg_compress_specification *spec,
+			const char *src, int srclen, char *dst, int dstlen)
+{
+	switch (spec->algorithm)
+	{
+		case PG_COMPRESSION_NONE:
+			break;
+		case PG_COMPRESSION_GZIP:
+#ifdef HAVE_LIBZ
+			{
+				uLongf		len = dstlen;
+
+				if (compress2((Bytef *) dst, &len, (const Bytef *) src, srclen,
+							  spec->level) != Z_OK)
+					return -1;
+				return (int) len;
+			}
+#endif
+			break;
+		case PG_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			{
+				int			len;
+
+				/* level 0 is the fast mode; higher levels use LZ4HC */
+				if (spec->level > 0)
+					len = LZ4_compress_HC(src, dst, srclen, dstlen, spec->level);
+				else
+					len = LZ4_compress_default(src, dst, srclen, dstlen);
+				return len > 0 ? len : -1;
+			}
+#endif
+			break;
+		case PG_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		len;
+
+				if (zstd_cctx == NULL)
+				{
+					zstd_cctx = ZSTD_createCCtx();
+					if (zstd_cctx == NULL)
+						return -1;
+				}
+				len = ZSTD_compressCCtx(zstd_cctx, dst, dstlen, src, srclen,
+										spec->level);
+				return ZSTD_isError(len) ? -1 : (int) len;
+			}
+#endif
+			break;
+	}
+
+	return -1;
+}
+
+/*
+ * Decompress 'srclen' bytes at 'src' into 'dst', which must be exactly
+ * 'dstlen' bytes long when decompressed.  Any failure is reported as a
+ * protocol violation, since the data came from the server.
+ */
+void
+WalDecompress(pg_compress_algorithm algorithm,
+			  const char *src, int srclen, char *dst, int dstlen)
+{
+	bool		ok = false;
+
+	switch (algorithm)
+	{
+		case PG_COMPRESSION_NONE:
+			break;
+		case PG_COMPRESSION_GZIP:
+#ifdef HAVE_LIBZ
+			{
+				uLongf		len = dstlen;
+
+				ok = uncompress((Bytef *) dst, &len, (const Bytef *) src,
+								srclen) == Z_OK && len == dstlen;
+			}
+#endif
+			break;
+		case PG_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			ok = LZ4_decompress_safe(src, dst, srclen, dstlen) == dstlen;
+#endif
+			break;
+		case PG_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		len;
+
+				if (zstd_dctx == NULL)
+				{
+					zstd_dctx = ZSTD_createDCtx();
+					if (zstd_dctx == NULL)
+						ereport(ERROR,
+								(errcode(ERRCODE_OUT_OF_MEMORY),
+								 errmsg("out of memory")));
+				}
+				len = ZSTD_decompressDCtx(zstd_dctx, dst, dstlen, src, srclen);
+				ok = !ZSTD_isError(len) && len == dstlen;
+			}
+#endif
+			break;
+	}
+
+	if (!ok)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("could not decompress WAL data received from primary")));
+}
@@ -59,6 +59,7 @@
 #include "access/xlogrecovery.h"
 #include "catalog/pg_authid.h"
 #include "catalog/pg_type.h"
+#include "common/compression.h"
 #include "common/ip.h"
 #include "funcapi.h"
 #include "libpq/pqformat.h"
@@ -66,6 +67,7 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/interrupt.h"
+#include "replication/walcompress.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
 #include "storage/ipc.h"
@@ -76,6 +78,7 @@
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/guc.h"
+#include "utils/guc_hooks.h"
 #include "utils/pg_lsn.h"
 #include "utils/ps_status.h"
 #include "utils/resowner.h"
@@ -90,9 +93,18 @@
 int			wal_receiver_status_interval;
 int			wal_receiver_timeout;
 bool		hot_standby_feedback;
+char	   *wal_receiver_compression;
 
 /* libpqwalreceiver connection */
 static WalReceiverConn *wrconn = NULL;
+
+/*
+ * Compression algorithm requested for the current stream, and a buffer for
+ * decompressing the WAL data it sends.
+ */
+static pg_compress_algorithm recvCompression = PG_COMPRESSION_NONE;
+static char *decompressBuf = NULL;
+static int	decompressBufSize = 0;
 WalReceiverFunctionsType *WalReceiverFunctions = NULL;
 
 /*
@@ -410,6 +422,21 @@ WalReceiverMain(void)
 		options.startpoint = startpoint;
 		options.slotname = slotname[0] != '\0' ? slotname : NULL;
 		options.proto.physical.startpointTLI = startpointTLI;
+
+		/*
+		 * Ask for compression as configured at this point.  The setting was
+		 * validated by its check hook, so the parsing can't fail here.
+		 */
+		parse_compress_options(wal_receiver_compression,
+							   &options.proto.physical.compression,
+							   &options.proto.physical.compression_detail);
+		if (!parse_compress_algorithm(options.proto.physical.compression,
+									  &recvCompression))
+			elog(ERROR, "unrecognized compression algorithm: \"%s\"",
+				 options.proto.physical.compression);
+		if (recvCompression == PG_COMPRESSION_NONE)
+			options.proto.physical.compression = NULL;
+
 		if (walrcv_startstreaming(wrconn, &options))
 		{
 			if (first_stream)
@@ -831,6 +858,41 @@ WalRcvDie(int code, Datum arg)
 	WakeupRecovery();
 }
 
+/*
+ * GUC check_hook for wal_receiver_compression
+ */
+bool
+check_wal_receiver_compression(char **newval, void **extra, GucSource source)
+{
+	char	   *algorithm_str;
+	char	   *detail_str;
+	pg_compress_algorithm algorithm;
+	pg_compress_specification spec;
+	char	   *error_detail;
+
+	parse_compress_options(*newval, &algorithm_str, &detail_str);
+	if (!parse_compress_algorithm(algorithm_str, &algorithm))
+	{
+		GUC_check_errdetail("Unrecognized compression algorithm: \"%s\".",
+							algorithm_str);
+		return false;
+	}
+
+	parse_compress_specification(algorithm, detail_str, &spec);
+	error_detail = validate_compress_specification(&spec);
+	if (error_detail == NULL &&
+		(spec.options & PG_COMPRESSION_OPTION_WORKERS) != 0)
+		error_detail = _("a worker count cannot be specified for WAL streaming");
+	if (error_detail != NULL)
+	{
+		GUC_check_errdetail("Invalid compression specification: %s",
+							error_detail);
+		return false;
+	}
+
+	return true;
+}
+
 /*
  * Accept the message from XLOG stream, and process it.
  */
@@ -868,6 +930,44 @@ XLogWalRcvProcessMsg(unsigned char type, char *buf, Size len, TimeLineID tli)
 				XLogWalRcvWrite(buf, len, dataStart, tli);
 				break;
 			}
+		case 'z':				/* compressed WAL records */
+			{
+				int			rawlen;
+
+				/* copy message to StringInfo */
+				hdrlen = sizeof(int64) + sizeof(int64) + sizeof(int64) +
+					sizeof(int32);
+				if (len < hdrlen || recvCompression == PG_COMPRESSION_NONE)
+					ereport(ERROR,
+							(errcode(ERRCODE_PROTOCOL_VIOLATION),
+							 errmsg_internal("invalid compressed WAL message received from primary")));
+				appendBinaryStringInfo(&incoming_message, buf, hdrlen);
+
+				/* read the fields */
+				dataStart = pq_getmsgint64(&incoming_message);
+				walEnd = pq_getmsgint64(&incoming_message);
+				sendTime = pq_getmsgint64(&incoming_message);
+				rawlen = pq_getmsgint(&incoming_message, 4);
+				if (rawlen <= 0 || !AllocSizeIsValid(rawlen))
+					ereport(ERROR,
+							(errcode(ERRCODE_PROTOCOL_VIOLATION),
+							 errmsg_internal("invalid compressed WAL message received from primary")));
+				ProcessWalSndrMessage(walEnd, sendTime);
+
+				if (rawlen > decompressBufSize)
+				{
+					if (decompressBuf)
+						pfree(decompressBuf);
+					decompressBuf = MemoryContextAlloc(TopMemoryContext, rawlen);
+					decompressBufSize = rawlen;
+				}
+
+				buf += hdrlen;
+				len -= hdrlen;
+				WalDecompress(recvCompression, buf, len, decompressBuf, rawlen);
+				XLogWalRcvWrite(decompressBuf, rawlen, dataStart, tli);
+				break;
+			}
 		case 'k':				/* Keepalive */
 			{
 				/* copy message to StringInfo */
@@ -74,6 +74,7 @@
 #include "replication/slot.h"
 #include "replication/snapbuild.h"
 #include "replication/syncrep.h"
+#include "replication/walcompress.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
 #include "replication/walsender_private.h"
@@ -159,6 +160,13 @@ static StringInfoData output_message;
 static StringInfoData reply_message;
 static StringInfoData tmpbuf;
 
+/*
+ * Compression of the WAL data sent by START_REPLICATION, as requested by the
+ * client, and the buffer for constructing compressed messages.
+ */
+static pg_compress_specification wal_stream_compression;
+static StringInfoData compressed_message;
+
 /* Timestamp of last ProcessRepliesIfAny(). */
 static TimestampTz last_processing = 0;
 
@@ -237,6 +245,7 @@ static void ReadReplicationSlot(ReadReplicationSlotCmd *cmd);
 static void CreateReplicationSlot(CreateReplicationSlotCmd *cmd);
 static void DropReplicationSlot(DropReplicationSlotCmd *cmd);
 static void StartReplication(StartReplicationCmd *cmd);
+static void parseStartReplicationOptions(StartReplicationCmd *cmd);
 static void StartLogicalReplication(StartReplicationCmd *cmd);
 static void ProcessStandbyMessage(void);
 static void ProcessStandbyReplyMessage(void);
@@ -673,6 +682,8 @@ StartReplication(StartReplicationCmd *cmd)
 	XLogRecPtr	FlushPtr;
 	TimeLineID	FlushTLI;
 
+	parseStartReplicationOptions(cmd);
+
 	/* create xlogreader for physical replication */
 	xlogreader =
 		XLogReaderAllocate(wal_segment_size, NULL,
@@ -932,6 +943,17 @@ logical_read_xlog_page(XLogReaderState *state, XLogRecPtr targetPagePtr, int req
 	else
 		count = flushptr - targetPagePtr;	/* part of the page available */
 
+	/*
+	 * Recently written WAL is likely to still be in the WAL buffers, so try
+	 * to copy it from there first, as XLogSendPhysical() does.  When several
+	 * slots decode the same WAL, that saves each of them from reading it
+	 * back from the file.
+	 */
+	if (!sendTimeLineIsHistoric &&
+		XLogReadFromBuffers(cur_page, targetPagePtr, count,
+							state->currTLI) == count)
+		return count;
+
 	/* now actually read the data, we know it's there */
 	if (!WALRead(state,
 				 cur_page,
@@ -1023,6 +1045,74 @@ parseCreateReplSlotOptions(CreateReplicationSlotCmd *cmd,
 	}
 }
 
+/*
+ * Process the options of a physical START_REPLICATION command.
+ */
+static void
+parseStartReplicationOptions(StartReplicationCmd *cmd)
+{
+	ListCell   *lc;
+	bool		compression_given = false;
+	char	   *compression_detail = NULL;
+	pg_compress_algorithm algorithm = PG_COMPRESSION_NONE;
+
+	foreach(lc, cmd->options)
+	{
+		DefElem    *defel = (DefElem *) lfirst(lc);
+
+		if (strcmp(defel->defname, "compression") == 0)
+		{
+			char	   *optval = defGetString(defel);
+
+			if (compression_given)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options")));
+			if (!parse_compress_algorithm(optval, &algorithm))
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("unrecognized compression algorithm: \"%s\"",
+								optval)));
+			compression_given = true;
+		}
+		else if (strcmp(defel->defname, "compression_detail") == 0)
+		{
+			if (compression_detail != NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options")));
+			compression_detail = defGetString(defel);
+		}
+		else
+			elog(ERROR, "unrecognized option: %s", defel->defname);
+	}
+
+	if (compression_detail != NULL && !compression_given)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("compression detail cannot be specified unless compression is enabled")));
+
+	parse_compress_specification(algorithm, compression_detail,
+								 &wal_stream_compression);
+	if (algorithm != PG_COMPRESSION_NONE)
+	{
+		char	   *error_detail;
+
+		error_detail = validate_compress_specification(&wal_stream_compression);
+		if (error_detail == NULL &&
+			(wal_stream_compression.options & PG_COMPRESSION_OPTION_WORKERS) != 0)
+			error_detail = psprintf(_("compression algorithm \"%s\" does not accept a worker count for WAL streaming"),
+									get_compress_algorithm_name(algorithm));
+		if (error_detail != NULL)
+			ereport(ERROR,
+					errcode(ERRCODE_SYNTAX_ERROR),
+					errmsg("invalid compression specification: %s",
+						   error_detail));
+
+		initStringInfo(&compressed_message);
+	}
+}
+
 /*
  * Create a new replication slot.
  */
@@ -2730,6 +2820,8 @@ XLogSendPhysical(void)
 	Size		nbytes;
 	XLogSegNo	segno;
 	WALReadError errinfo;
+	Size		rbytes;
+	StringInfo	msg;
 
 	/* If requested switch the WAL sender to the stopping state. */
 	if (got_STOPPING)
@@ -2944,11 +3036,24 @@ XLogSendPhysical(void)
 	 */
 	enlargeStringInfo(&output_message, nbytes);
 
+	/*
+	 * Recently written WAL is likely to still be in the WAL buffers, so try
+	 * to copy it from there first, to save reading it back from the file.
+	 * That's only possible for WAL on the timeline that's being inserted
+	 * into, which excludes cascading walsenders.
+	 */
+	if (!am_cascading_walsender && !sendTimeLineIsHistoric)
+		rbytes = XLogReadFromBuffers(&output_message.data[output_message.len],
+									 startptr, nbytes, sendTimeLine);
+	else
+		rbytes = 0;
+
 retry:
-	if (!WALRead(xlogreader,
-				 &output_message.data[output_message.len],
-				 startptr,
-				 nbytes,
+	if (rbytes < nbytes &&
+		!WALRead(xlogreader,
+				 &output_message.data[output_message.len + rbytes],
+				 startptr + rbytes,
+				 nbytes - rbytes,
 				 xlogreader->seg.ws_tli,	/* Pass the current TLI because
 											 * only WalSndSegmentOpen controls
 											 * whether new TLI is needed. */
@@ -2986,15 +3091,44 @@ retry:
 	output_message.len += nbytes;
 	output_message.data[output_message.len] = '\0';
 
+	/*
+	 * If the client asked for compression, send a CompressedXLogData message
+	 * with the same header fields instead, unless the data doesn't compress.
+	 */
+	msg = &output_message;
+	if (wal_stream_compression.algorithm != PG_COMPRESSION_NONE)
+	{
+		int			hdrlen = 1 + sizeof(int64) + sizeof(int64) + sizeof(int64);
+		int			bound = WalCompressBound(wal_stream_compression.algorithm, nbytes);
+		int			clen;
+
+		resetStringInfo(&compressed_message);
+		pq_sendbyte(&compressed_message, 'z');
+		appendBinaryStringInfo(&compressed_message, &output_message.data[1],
+							   hdrlen - 1);
+		pq_sendint32(&compressed_message, nbytes);	/* uncompressed length */
+		enlargeStringInfo(&compressed_message, bound);
+
+		clen = WalCompress(&wal_stream_compression, &output_message.data[hdrlen],
+						   nbytes,
+						   &compressed_message.data[compressed_message.len],
+						   bound);
+		if (clen > 0 && clen < nbytes)
+		{
+			compressed_message.len += clen;
+			msg = &compressed_message;
+		}
+	}
+
 	/*
 	 * Fill the send timestamp last, so that it is taken as late as possible.
 	 */
 	resetStringInfo(&tmpbuf);
 	pq_sendint64(&tmpbuf, GetCurrentTimestamp());
-	memcpy(&output_message.data[1 + sizeof(int64) + sizeof(int64)],
+	memcpy(&msg->data[1 + sizeof(int64) + sizeof(int64)],
 		   tmpbuf.data, sizeof(int64));
 
-	pq_putmessage_noblock('d', output_message.data, output_message.len);
+	pq_putmessage_noblock('d', msg->data, msg->len);
 
 	sentPtr = endptr;
 
@@ -14,8 +14,15 @@
  */
 #include "postgres.h"
 
+#include <unistd.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+#include "port/pg_numa.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "storage/pg_shmem.h"
 #include "storage/proc.h"
 
 BufferDescPadded *BufferDescriptors;
@@ -24,6 +31,11 @@ ConditionVariableMinimallyPadded *BufferIOCVArray;
 WritebackContext BackendWritebackContext;
 CkptSortItem *CkptBufferIds;
 
+/* GUC parameter */
+bool		numa_interleave = false;
+
+static void InterleaveBufferPool(void);
+
 
 /*
  * Data Structures:
@@ -78,9 +90,12 @@ InitBufferPool(void)
 						NBuffers * sizeof(BufferDescPadded),
 						&foundDescs);
 
+	/* Align buffer pool on IO page size boundary, for direct I/O. */
 	BufferBlocks = (char *)
-		ShmemInitStruct("Buffer Blocks",
-						NBuffers * (Size) BLCKSZ, &foundBufs);
+		TYPEALIGN(PG_IO_ALIGN_SIZE,
+				  ShmemInitStruct("Buffer Blocks",
+								  NBuffers * (Size) BLCKSZ + PG_IO_ALIGN_SIZE,
+								  &foundBufs));
 
 	/* Align condition variables to cacheline boundary. */
 	BufferIOCVArray = (ConditionVariableMinimallyPadded *)
@@ -109,6 +124,10 @@ InitBufferPool(void)
 	{
 		int			i;
 
+		/* This must be done before any of the memory is touched */
+		if (numa_interleave)
+			InterleaveBufferPool();
+
 		/*
 		 * Initialize all the buffer headers.
 		 */
@@ -147,6 +166,83 @@ InitBufferPool(void)
 						 &backend_flush_after);
 }
 
+/*
+ * Spread the buffer pool over all NUMA nodes.
+ *
+ * By default, each page of shared memory is placed on the NUMA node of the
+ * process that first touches it, which for the buffer descriptors is the
+ * postmaster, and for the buffers themselves whichever backend happens to
+ * read a block into them first.  On large multi-socket machines, that can
+ * leave much of the buffer pool on one node, whose memory bandwidth and
+ * interconnect then become the bottleneck.  Interleaving the pages evenly
+ * over all nodes avoids that.
+ */
+static void
+InterleaveBufferPool(void)
+{
+	Size		pagesize = 0;
+
+	if (pg_numa_init() != 0)
+	{
+		ereport(WARNING,
+				(errmsg("NUMA is not supported on this platform"),
+				 errdetail("\"numa_interleave\" is ignored.")));
+		return;
+	}
+
+	/* with huge pages, the range must be aligned to the huge page size */
+	if (huge_pages != HUGE_PAGES_OFF)
+		GetHugePageSize(&pagesize, NULL);
+
+	if (pg_numa_interleave_memory(BufferDescriptors,
+								  NBuffers * sizeof(BufferDescPadded),
+								  pagesize) != 0 ||
+		pg_numa_interleave_memory(BufferBlocks,
+								  NBuffers * (Size) BLCKSZ,
+								  pagesize) != 0)
+		ereport(WARNING,
+				(errmsg("could not interleave shared buffers over NUMA nodes: %m")));
+	else
+		elog(DEBUG1, "interleaved shared buffers over %d NUMA nodes",
+			 pg_numa_get_max_node() + 1);
+}
+
+/*
+ * Give the memory of buffers that are no longer in use back to the operating
+ * system.
+ *
+ * This is used after shared_buffers_limit has been lowered, once the buffers
+ * above the limit have been emptied; see ApplySharedBuffersLimit().  If they
+ * are used again later, their pages read as zeroes.  Only whole (huge) pages
+ * within the range can be released, and only on platforms that can punch
+ * holes into shared memory.
+ */
+void
+ReleaseBufferMemory(int first_buffer, int nbuffers)
+{
+#ifdef MADV_REMOVE
+	Size		pagesize = 0;
+	uintptr_t	start;
+	uintptr_t	end;
+
+	if (nbuffers <= 0)
+		return;
+
+	if (huge_pages != HUGE_PAGES_OFF)
+		GetHugePageSize(&pagesize, NULL);
+	if (pagesize == 0)
+		pagesize = sysconf(_SC_PAGESIZE);
+
+	start = TYPEALIGN(pagesize, BufferBlocks + first_buffer * (Size) BLCKSZ);
+	end = TYPEALIGN_DOWN(pagesize,
+						 BufferBlocks + (first_buffer + nbuffers) * (Size) BLCKSZ);
+
+	if (start < end &&
+		madvise((void *) start, end - start, MADV_REMOVE) != 0)
+		elog(DEBUG1, "could not release memory of unused shared buffers: %m");
+#endif
+}
+
 /*
  * BufferShmemSize
  *
@@ -163,7 +259,8 @@ BufferShmemSize(void)
 	/* to allow aligning buffer descriptors */
 	size = add_size(size, PG_CACHE_LINE_SIZE);
 
-	/* size of data pages */
+	/* size of data pages, plus alignment padding */
+	size = add_size(size, PG_IO_ALIGN_SIZE);
 	size = add_size(size, mul_size(NBuffers, BLCKSZ));
 
 	/* size of stuff controlled by freelist.c */
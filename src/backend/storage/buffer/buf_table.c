@@ -105,6 +105,35 @@ BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 	return result->id;
 }
 
+/*
+ * BufTableLookupUnlocked
+ *		Like BufTableLookup, but without holding the BufMappingLock
+ *
+ * Concurrent changes to the table can make this return a buffer ID that
+ * doesn't (or doesn't yet) hold the given tag, or -1 even though the tag is
+ * present.  Callers must pin the returned buffer and then verify its tag,
+ * and must fall back to BufTableLookup if that fails or -1 is returned.
+ */
+int
+BufTableLookupUnlocked(BufferTag *tagPtr, uint32 hashcode)
+{
+	BufferLookupEnt *result;
+	int			id;
+
+	result = (BufferLookupEnt *)
+		hash_search_unlocked(SharedBufHash, tagPtr, hashcode);
+
+	if (!result)
+		return -1;
+
+	/* the entry might be in the middle of being filled in */
+	id = ((volatile BufferLookupEnt *) result)->id;
+	if (id < 0 || id >= NBuffers)
+		return -1;
+
+	return id;
+}
+
 /*
  * BufTableInsert
  *		Insert a hashtable entry for given tag and buffer ID,
@@ -39,6 +39,7 @@
 #include "catalog/catalog.h"
 #include "catalog/storage.h"
 #include "catalog/storage_xlog.h"
+#include "common/hashfn.h"
 #include "executor/instrument.h"
 #include "lib/binaryheap.h"
 #include "miscadmin.h"
@@ -52,6 +53,7 @@
 #include "storage/smgr.h"
 #include "storage/standby.h"
 #include "utils/memdebug.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
@@ -89,6 +91,54 @@ typedef struct PrivateRefCountEntry
 /* 64 bytes, about the size of a cache line on common systems */
 #define REFCOUNT_ARRAY_ENTRIES 8
 
+/* Entry of the overflow hash table, see below */
+typedef struct PrivateRefCountHashEntry
+{
+	PrivateRefCountEntry data;
+	char		status;			/* for simplehash use */
+} PrivateRefCountHashEntry;
+
+/*
+ * The overflow hash table is a simplehash rather than a dynahash, since it is
+ * searched on every pin and unpin of a buffer that isn't in the array once
+ * a backend holds more than REFCOUNT_ARRAY_ENTRIES pins.  Note that inserting
+ * or deleting an entry may move other entries, so a pointer into the table
+ * is only valid until the next insertion or deletion.
+ */
+#define SH_PREFIX refcount
+#define SH_ELEMENT_TYPE PrivateRefCountHashEntry
+#define SH_KEY_TYPE Buffer
+#define SH_KEY data.buffer
+#define SH_HASH_KEY(tb, key) murmurhash32((uint32) (key))
+#define SH_EQUAL(tb, a, b) ((a) == (b))
+#define SH_SCOPE static inline
+#define SH_DEFINE
+#define SH_DECLARE
+#include "lib/simplehash.h"
+
+/*
+ * Maximum number of buffers holding consecutive blocks that the checkpointer
+ * and bgwriter combine into a single write.  Must not exceed PG_IOV_MAX.
+ */
+#define MAX_BUFFER_WRITE_COMBINE 16
+
+/*
+ * A run of shared buffers holding consecutive blocks of one relation fork,
+ * collected by SyncOneBuffer() to be written out with one smgrwritev() call
+ * by FlushBufferRun().  Every buffer in the run is pinned, share-locked and
+ * has BM_IO_IN_PROGRESS set by us until the run is flushed.
+ */
+typedef struct BufferWriteRun
+{
+	SMgrRelation reln;			/* smgr relation of the run's buffers */
+	BufferTag	tag;			/* tag of the first buffer in the run */
+	int			nbuffers;		/* # of buffers currently in the run */
+	bool		permanent;		/* any BM_PERMANENT buffers in the run? */
+	XLogRecPtr	lsn;			/* highest page LSN of permanent buffers */
+	BufferDesc *buffers[MAX_BUFFER_WRITE_COMBINE];
+	const void *pages[MAX_BUFFER_WRITE_COMBINE];	/* data to write */
+} BufferWriteRun;
+
 /*
  * Status of buffers to checkpoint for a particular tablespace, used
  * internally in BufferSync.
@@ -117,6 +167,24 @@ typedef struct CkptTsStatus
 	int			index;
 } CkptTsStatus;
 
+/*
+ * State of the background writer's LRU scan of one clock sweep partition,
+ * saved between calls of BgBufferSync.
+ */
+typedef struct BgWriterPartitionState
+{
+	int			nbuffers;		/* buffers in use when the state was saved */
+	bool		saved_info_valid;
+	int			prev_strategy_buf_id;
+	uint32		prev_strategy_passes;
+	int			next_to_clean;
+	uint32		next_passes;
+
+	/* Moving averages of allocation rate and clean-buffer density */
+	float		smoothed_alloc;
+	float		smoothed_density;
+} BgWriterPartitionState;
+
 /*
  * Type for array used to sort SMgrRelations
  *
@@ -132,9 +200,11 @@ typedef struct SMgrSortArray
 
 /* GUC variables */
 bool		zero_damaged_pages = false;
+bool		lockfree_buffer_lookup = true;
 int			bgwriter_lru_maxpages = 100;
 double		bgwriter_lru_multiplier = 2.0;
 bool		track_io_timing = false;
+int			shared_buffers_limit = 0;
 
 /*
  * How many buffers PrefetchBuffer callers should try to stay ahead of their
@@ -159,10 +229,19 @@ int			checkpoint_flush_after = DEFAULT_CHECKPOINT_FLUSH_AFTER;
 int			bgwriter_flush_after = DEFAULT_BGWRITER_FLUSH_AFTER;
 int			backend_flush_after = DEFAULT_BACKEND_FLUSH_AFTER;
 
-/* local state for StartBufferIO and related functions */
-static BufferDesc *InProgressBuf = NULL;
+/*
+ * local state for StartBufferIO and related functions
+ *
+ * Normally at most one I/O is in progress at a time, but a combined write
+ * (see BufferWriteRun) has output in progress on all buffers of the run.
+ */
+static BufferDesc *InProgressBufs[MAX_BUFFER_WRITE_COMBINE];
+static int	NumInProgressBufs = 0;
 static bool IsForInput;
 
+/* private copies of pages in a BufferWriteRun, for checksumming */
+static char *WriteRunPageCopies = NULL;
+
 /* local state for LockBufferForCleanup */
 static BufferDesc *PinCountWaitBuf = NULL;
 
@@ -197,7 +276,7 @@ static BufferDesc *PinCountWaitBuf = NULL;
  * because in some scenarios it's called with a spinlock held...
  */
 static struct PrivateRefCountEntry PrivateRefCountArray[REFCOUNT_ARRAY_ENTRIES];
-static HTAB *PrivateRefCountHash = NULL;
+static refcount_hash *PrivateRefCountHash = NULL;
 static int32 PrivateRefCountOverflowed = 0;
 static uint32 PrivateRefCountClock = 0;
 static PrivateRefCountEntry *ReservedRefCountEntry = NULL;
@@ -250,7 +329,7 @@ ReservePrivateRefCountEntry(void)
 		 * Move entry from the current clock position in the array into the
 		 * hashtable. Use that slot.
 		 */
-		PrivateRefCountEntry *hashent;
+		PrivateRefCountHashEntry *hashent;
 		bool		found;
 
 		/* select victim slot */
@@ -261,12 +340,11 @@ ReservePrivateRefCountEntry(void)
 		Assert(ReservedRefCountEntry->buffer != InvalidBuffer);
 
 		/* enter victim array entry into hashtable */
-		hashent = hash_search(PrivateRefCountHash,
-							  &(ReservedRefCountEntry->buffer),
-							  HASH_ENTER,
-							  &found);
+		hashent = refcount_insert(PrivateRefCountHash,
+								  ReservedRefCountEntry->buffer,
+								  &found);
 		Assert(!found);
-		hashent->refcount = ReservedRefCountEntry->refcount;
+		hashent->data.refcount = ReservedRefCountEntry->refcount;
 
 		/* clear the now free array slot */
 		ReservedRefCountEntry->buffer = InvalidBuffer;
@@ -309,6 +387,7 @@ static PrivateRefCountEntry *
 GetPrivateRefCountEntry(Buffer buffer, bool do_move)
 {
 	PrivateRefCountEntry *res;
+	PrivateRefCountHashEntry *hashent;
 	int			i;
 
 	Assert(BufferIsValid(buffer));
@@ -336,22 +415,26 @@ GetPrivateRefCountEntry(Buffer buffer, bool do_move)
 	if (PrivateRefCountOverflowed == 0)
 		return NULL;
 
-	res = hash_search(PrivateRefCountHash, &buffer, HASH_FIND, NULL);
+	hashent = refcount_lookup(PrivateRefCountHash, buffer);
 
-	if (res == NULL)
+	if (hashent == NULL)
 		return NULL;
 	else if (!do_move)
 	{
 		/* caller doesn't want us to move the hash entry into the array */
-		return res;
+		return &hashent->data;
 	}
 	else
 	{
 		/* move buffer from hashtable into the free array slot */
-		bool		found;
+		bool		found PG_USED_FOR_ASSERTS_ONLY;
+		int32		refcount = hashent->data.refcount;
 		PrivateRefCountEntry *free;
 
-		/* Ensure there's a free array slot */
+		/*
+		 * Ensure there's a free array slot.  That may move an array entry
+		 * into the hashtable, after which hashent is no longer valid.
+		 */
 		ReservePrivateRefCountEntry();
 
 		/* Use up the reserved slot */
@@ -362,10 +445,10 @@ GetPrivateRefCountEntry(Buffer buffer, bool do_move)
 
 		/* and fill it */
 		free->buffer = buffer;
-		free->refcount = res->refcount;
+		free->refcount = refcount;
 
 		/* delete from hashtable */
-		hash_search(PrivateRefCountHash, &buffer, HASH_REMOVE, &found);
+		found = refcount_delete(PrivateRefCountHash, buffer);
 		Assert(found);
 		Assert(PrivateRefCountOverflowed > 0);
 		PrivateRefCountOverflowed--;
@@ -421,10 +504,10 @@ ForgetPrivateRefCountEntry(PrivateRefCountEntry *ref)
 	}
 	else
 	{
-		bool		found;
+		bool		found PG_USED_FOR_ASSERTS_ONLY;
 		Buffer		buffer = ref->buffer;
 
-		hash_search(PrivateRefCountHash, &buffer, HASH_REMOVE, &found);
+		found = refcount_delete(PrivateRefCountHash, buffer);
 		Assert(found);
 		Assert(PrivateRefCountOverflowed > 0);
 		PrivateRefCountOverflowed--;
@@ -459,13 +542,20 @@ static void PinBuffer_Locked(BufferDesc *buf);
 static void UnpinBuffer(BufferDesc *buf);
 static void BufferSync(int flags);
 static uint32 WaitBufHdrUnlocked(BufferDesc *buf);
+static bool ApplySharedBuffersLimit(WritebackContext *wb_context);
+static bool EvictUnusedBuffer(int buf_id, WritebackContext *wb_context);
+static bool BgBufferSyncPartition(int partition, BgWriterPartitionState *state,
+								  int maxpages, WritebackContext *wb_context);
 static int	SyncOneBuffer(int buf_id, bool skip_recently_used,
-						  WritebackContext *wb_context);
+						  WritebackContext *wb_context, BufferWriteRun *run);
+static bool BufferWriteRunAdd(BufferWriteRun *run, BufferDesc *buf);
+static void FlushBufferRun(BufferWriteRun *run, WritebackContext *wb_context);
 static void WaitIO(BufferDesc *buf);
-static bool StartBufferIO(BufferDesc *buf, bool forInput);
+static bool StartBufferIO(BufferDesc *buf, bool forInput, bool nowait);
 static void TerminateBufferIO(BufferDesc *buf, bool clear_dirty,
 							  uint32 set_flag_bits);
 static void shared_buffer_write_error_callback(void *arg);
+static void buffer_write_run_error_callback(void *arg);
 static void local_buffer_write_error_callback(void *arg);
 static BufferDesc *BufferAlloc(SMgrRelation smgr,
 							   char relpersistence,
@@ -773,6 +863,14 @@ ReadBufferExtended(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
 							forkNum, blockNum, mode, strategy, &hit);
 	if (hit)
 		pgstat_count_buffer_hit(reln);
+
+	/*
+	 * In hot standby, replay may have pruned this relation while our snapshot
+	 * could still see the removed tuples, leaving it to us to notice.
+	 */
+	if (unlikely(DeferredSnapshotConflictsPending()))
+		CheckDeferredSnapshotConflicts(reln->rd_locator);
+
 	return buf;
 }
 
@@ -969,7 +1067,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				Assert(buf_state & BM_VALID);
 				buf_state &= ~BM_VALID;
 				UnlockBufHdr(bufHdr, buf_state);
-			} while (!StartBufferIO(bufHdr, true));
+			} while (!StartBufferIO(bufHdr, true, false));
 		}
 	}
 
@@ -1153,6 +1251,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	BufferDesc *buf;
 	bool		valid;
 	uint32		buf_state;
+	uint32		usage_count;
 
 	/* create a tag so we can lookup the buffer */
 	InitBufferTag(&newTag, &smgr->smgr_rlocator.locator, forkNum, blockNum);
@@ -1161,23 +1260,58 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
-	/* see if the block is in the buffer pool already */
-	LWLockAcquire(newPartitionLock, LW_SHARED);
-	buf_id = BufTableLookup(&newTag, newHash);
-	if (buf_id >= 0)
+	/*
+	 * See if the block is in the buffer pool already.  First try without
+	 * taking the mapping lock, as most lookups find the block present: pin
+	 * the buffer the unlocked lookup suggests, and keep it only if it turns
+	 * out to hold our block.  Once pinned, the buffer can't be given another
+	 * identity, so checking its tag under the header spinlock is conclusive.
+	 */
+	buf = NULL;
+	if (lockfree_buffer_lookup)
 	{
-		/*
-		 * Found it.  Now, pin the buffer so no one can steal it from the
-		 * buffer pool, and check to see if the correct data has been loaded
-		 * into the buffer.
-		 */
-		buf = GetBufferDescriptor(buf_id);
+		buf_id = BufTableLookupUnlocked(&newTag, newHash);
+		if (buf_id >= 0)
+		{
+			buf = GetBufferDescriptor(buf_id);
+
+			valid = PinBuffer(buf, strategy);
+
+			buf_state = LockBufHdr(buf);
+			if (!(buf_state & BM_TAG_VALID) ||
+				!BufferTagsEqual(&buf->tag, &newTag))
+			{
+				UnlockBufHdr(buf, buf_state);
+				UnpinBuffer(buf);
+				buf = NULL;
+			}
+			else
+				UnlockBufHdr(buf, buf_state);
+		}
+	}
 
-		valid = PinBuffer(buf, strategy);
+	if (buf == NULL)
+	{
+		LWLockAcquire(newPartitionLock, LW_SHARED);
+		buf_id = BufTableLookup(&newTag, newHash);
+		if (buf_id >= 0)
+		{
+			/*
+			 * Found it.  Now, pin the buffer so no one can steal it from the
+			 * buffer pool.
+			 */
+			buf = GetBufferDescriptor(buf_id);
+
+			valid = PinBuffer(buf, strategy);
+		}
 
 		/* Can release the mapping lock as soon as we've pinned it */
 		LWLockRelease(newPartitionLock);
+	}
 
+	if (buf != NULL)
+	{
+		/* check to see if the correct data has been loaded into the buffer */
 		*foundPtr = true;
 
 		if (!valid)
@@ -1189,7 +1323,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			 * own read attempt if the page is still not BM_VALID.
 			 * StartBufferIO does it all.
 			 */
-			if (StartBufferIO(buf, true))
+			if (StartBufferIO(buf, true, false))
 			{
 				/*
 				 * If we get here, previous attempts to read the buffer must
@@ -1207,11 +1341,10 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	/*
 	 * Didn't find it in the buffer pool.  We'll have to initialize a new
-	 * buffer.  Remember to unlock the mapping lock while doing the work.
+	 * buffer.
 	 */
-	LWLockRelease(newPartitionLock);
-
 	*io_context = IOContextForStrategy(strategy);
+	usage_count = StrategyInitialUsageCount(strategy, newHash);
 
 	/* Loop here in case we have to try another victim buffer */
 	for (;;)
@@ -1406,7 +1539,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				 * then set up our own read attempt if the page is still not
 				 * BM_VALID.  StartBufferIO does it all.
 				 */
-				if (StartBufferIO(buf, true))
+				if (StartBufferIO(buf, true, false))
 				{
 					/*
 					 * If we get here, previous attempts to read the buffer
@@ -1448,8 +1581,9 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	 *
 	 * Clearing BM_VALID here is necessary, clearing the dirtybits is just
 	 * paranoia.  We also reset the usage_count since any recency of use of
-	 * the old content is no longer relevant.  (The usage_count starts out at
-	 * 1 so that the buffer can survive one clock-sweep pass.)
+	 * the old content is no longer relevant.  (The usage_count normally
+	 * starts out at 1 so that the buffer can survive one clock-sweep pass;
+	 * see StrategyInitialUsageCount.)
 	 *
 	 * Make sure BM_PERMANENT is set for buffers that must be written at every
 	 * checkpoint.  Unlogged buffers only need to be written at shutdown
@@ -1461,9 +1595,10 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				   BM_CHECKPOINT_NEEDED | BM_IO_ERROR | BM_PERMANENT |
 				   BUF_USAGECOUNT_MASK);
 	if (relpersistence == RELPERSISTENCE_PERMANENT || forkNum == INIT_FORKNUM)
-		buf_state |= BM_TAG_VALID | BM_PERMANENT | BUF_USAGECOUNT_ONE;
+		buf_state |= BM_TAG_VALID | BM_PERMANENT;
 	else
-		buf_state |= BM_TAG_VALID | BUF_USAGECOUNT_ONE;
+		buf_state |= BM_TAG_VALID;
+	buf_state += usage_count * BUF_USAGECOUNT_ONE;
 
 	UnlockBufHdr(buf, buf_state);
 
@@ -1496,6 +1631,10 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		 */
 		pgstat_count_io_op(IOOBJECT_RELATION, *io_context,
 						   from_ring ? IOOP_REUSE : IOOP_EVICT);
+
+		/* Blocks cycling through a strategy ring are not worth recalling */
+		if (!from_ring)
+			StrategyRecordEviction(oldHash);
 	}
 
 	/*
@@ -1504,7 +1643,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	 * to read it before we did, so there's nothing left for BufferAlloc() to
 	 * do.
 	 */
-	if (StartBufferIO(buf, true))
+	if (StartBufferIO(buf, true, false))
 		*foundPtr = false;
 	else
 		*foundPtr = true;
@@ -2007,6 +2146,7 @@ BufferSync(int flags)
 	int			i;
 	int			mask = BM_DIRTY;
 	WritebackContext wb_context;
+	BufferWriteRun run;
 
 	/* Make sure we can handle the pin inside SyncOneBuffer */
 	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
@@ -2176,51 +2316,78 @@ BufferSync(int flags)
 	 * marked with BM_CHECKPOINT_NEEDED. The writes are balanced between
 	 * tablespaces; otherwise the sorting would lead to only one tablespace
 	 * receiving writes at a time, making inefficient use of the hardware.
+	 *
+	 * Buffers holding consecutive blocks of the same relation fork are
+	 * processed as one batch, so that SyncOneBuffer can combine them into a
+	 * single write.  The batch is flushed before we consider sleeping, so
+	 * that we never hold buffers locked while throttling.
 	 */
 	num_processed = 0;
 	num_written = 0;
+	run.nbuffers = 0;
 	while (!binaryheap_empty(ts_heap))
 	{
-		BufferDesc *bufHdr = NULL;
 		CkptTsStatus *ts_stat = (CkptTsStatus *)
 		DatumGetPointer(binaryheap_first(ts_heap));
+		int			nbatch = 1;
 
-		buf_id = CkptBufferIds[ts_stat->index].buf_id;
-		Assert(buf_id != -1);
-
-		bufHdr = GetBufferDescriptor(buf_id);
+		while (nbatch < MAX_BUFFER_WRITE_COMBINE &&
+			   ts_stat->num_scanned + nbatch < ts_stat->num_to_scan)
+		{
+			CkptSortItem *prev = &CkptBufferIds[ts_stat->index + nbatch - 1];
+			CkptSortItem *next = prev + 1;
 
-		num_processed++;
+			if (next->relNumber != prev->relNumber ||
+				next->forkNum != prev->forkNum ||
+				next->blockNum != prev->blockNum + 1)
+				break;
+			nbatch++;
+		}
 
-		/*
-		 * We don't need to acquire the lock here, because we're only looking
-		 * at a single bit. It's possible that someone else writes the buffer
-		 * and clears the flag right after we check, but that doesn't matter
-		 * since SyncOneBuffer will then do nothing.  However, there is a
-		 * further race condition: it's conceivable that between the time we
-		 * examine the bit here and the time SyncOneBuffer acquires the lock,
-		 * someone else not only wrote the buffer but replaced it with another
-		 * page and dirtied it.  In that improbable case, SyncOneBuffer will
-		 * write the buffer though we didn't need to.  It doesn't seem worth
-		 * guarding against this, though.
-		 */
-		if (pg_atomic_read_u32(&bufHdr->state) & BM_CHECKPOINT_NEEDED)
+		for (i = 0; i < nbatch; i++)
 		{
-			if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
+			BufferDesc *bufHdr;
+
+			buf_id = CkptBufferIds[ts_stat->index + i].buf_id;
+			Assert(buf_id != -1);
+
+			bufHdr = GetBufferDescriptor(buf_id);
+
+			/*
+			 * We don't need to acquire the lock here, because we're only
+			 * looking at a single bit. It's possible that someone else writes
+			 * the buffer and clears the flag right after we check, but that
+			 * doesn't matter since SyncOneBuffer will then do nothing.
+			 * However, there is a further race condition: it's conceivable
+			 * that between the time we examine the bit here and the time
+			 * SyncOneBuffer acquires the lock, someone else not only wrote
+			 * the buffer but replaced it with another page and dirtied it.
+			 * In that improbable case, SyncOneBuffer will write the buffer
+			 * though we didn't need to.  It doesn't seem worth guarding
+			 * against this, though.
+			 */
+			if (pg_atomic_read_u32(&bufHdr->state) & BM_CHECKPOINT_NEEDED)
 			{
-				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
-				PendingCheckpointerStats.buf_written_checkpoints++;
-				num_written++;
+				if (SyncOneBuffer(buf_id, false, &wb_context, &run) & BUF_WRITTEN)
+				{
+					TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
+					PendingCheckpointerStats.buf_written_checkpoints++;
+					num_written++;
+				}
 			}
 		}
 
+		FlushBufferRun(&run, &wb_context);
+
+		num_processed += nbatch;
+
 		/*
 		 * Measure progress independent of actually having to flush the buffer
 		 * - otherwise writing become unbalanced.
 		 */
-		ts_stat->progress += ts_stat->progress_slice;
-		ts_stat->num_scanned++;
-		ts_stat->index++;
+		ts_stat->progress += ts_stat->progress_slice * nbatch;
+		ts_stat->num_scanned += nbatch;
+		ts_stat->index += nbatch;
 
 		/* Have all the buffers from the tablespace been processed? */
 		if (ts_stat->num_scanned == ts_stat->num_to_scan)
@@ -2263,32 +2430,223 @@ BufferSync(int flags)
  * This is called periodically by the background writer process.
  *
  * Returns true if it's appropriate for the bgwriter process to go into
- * low-power hibernation mode.  (This happens if the strategy clock sweep
- * has been "lapped" and no buffer allocations have occurred recently,
- * or if the bgwriter has been effectively disabled by setting
+ * low-power hibernation mode.  (This happens if the clock sweep of every
+ * partition has been "lapped" and no buffer allocations have occurred
+ * recently, or if the bgwriter has been effectively disabled by setting
  * bgwriter_lru_maxpages to 0.)
+ *
+ * This is also where the bgwriter applies changes of shared_buffers_limit.
  */
 bool
 BgBufferSync(WritebackContext *wb_context)
+{
+	static BgWriterPartitionState *partition_state = NULL;
+	int			npartitions = StrategyNumPartitions();
+	int			maxpages;
+	bool		hibernate = true;
+
+	/* The number of partitions is fixed at server start */
+	if (partition_state == NULL)
+	{
+		partition_state = (BgWriterPartitionState *)
+			MemoryContextAllocZero(TopMemoryContext,
+								   npartitions * sizeof(BgWriterPartitionState));
+		for (int i = 0; i < npartitions; i++)
+			partition_state[i].smoothed_density = 10.0;
+	}
+
+	/* Make sure we can handle the pin inside SyncOneBuffer */
+	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
+	/* Don't hibernate while buffers remain to be emptied */
+	if (!ApplySharedBuffersLimit(wb_context))
+		hibernate = false;
+
+	/* Divide bgwriter_lru_maxpages evenly between the partitions */
+	maxpages = (bgwriter_lru_maxpages + npartitions - 1) / npartitions;
+
+	for (int i = 0; i < npartitions; i++)
+	{
+		if (!BgBufferSyncPartition(i, &partition_state[i], maxpages,
+								   wb_context))
+			hibernate = false;
+	}
+
+	return hibernate;
+}
+
+/*
+ * SharedBuffersLimit -- number of buffers that shared_buffers_limit allows
+ */
+int
+SharedBuffersLimit(void)
+{
+	if (shared_buffers_limit <= 0)
+		return NBuffers;
+
+	/* each clock sweep partition needs at least one buffer */
+	return Min(Max(shared_buffers_limit, StrategyNumPartitions()), NBuffers);
+}
+
+/*
+ * ApplySharedBuffersLimit -- grow or shrink the buffer pool
+ *
+ * shared_buffers sets the number of buffers allocated at server start, but
+ * only SharedBuffersLimit() of them are used.  When the limit is lowered,
+ * the buffers beyond it are no longer handed out by StrategyGetBuffer(), and
+ * we write out and empty them here, which may take several calls if some of
+ * them are pinned.  Once they are all empty, their memory is given back to
+ * the operating system.  When the limit is raised, the clock sweep just
+ * starts using more buffers.
+ *
+ * Returns false if there are buffers left to empty.
+ */
+static bool
+ApplySharedBuffersLimit(WritebackContext *wb_context)
+{
+	static bool drained = false;
+	int			nbuffers = SharedBuffersLimit();
+	int			npartitions = StrategyNumPartitions();
+
+	if (nbuffers != StrategyActiveBuffers())
+	{
+		elog(DEBUG1, "changing the number of shared buffers in use from %d to %d",
+			 StrategyActiveBuffers(), nbuffers);
+		StrategySetActiveBuffers(nbuffers);
+		drained = false;
+	}
+
+	if (drained)
+		return true;
+
+	drained = true;
+	for (int i = 0; i < npartitions; i++)
+	{
+		int			first_buffer;
+		int			num_buffers;
+		int			active_buffers;
+
+		StrategyPartitionBounds(i, &first_buffer, &num_buffers,
+								&active_buffers);
+		for (int buf_id = first_buffer + active_buffers;
+			 buf_id < first_buffer + num_buffers; buf_id++)
+		{
+			if (!EvictUnusedBuffer(buf_id, wb_context))
+				drained = false;
+		}
+	}
+
+	if (drained)
+	{
+		for (int i = 0; i < npartitions; i++)
+		{
+			int			first_buffer;
+			int			num_buffers;
+			int			active_buffers;
+
+			StrategyPartitionBounds(i, &first_buffer, &num_buffers,
+									&active_buffers);
+			ReleaseBufferMemory(first_buffer + active_buffers,
+								num_buffers - active_buffers);
+		}
+	}
+
+	return drained;
+}
+
+/*
+ * EvictUnusedBuffer -- empty a buffer that is no longer in use
+ *
+ * StrategyGetBuffer() won't reuse the buffer anymore, but it may still hold a
+ * page that can be found through the buffer mapping table.  Write it out if
+ * it's dirty, and remove it from the table unless somebody has pinned it.
+ *
+ * Returns true if the buffer is empty.
+ */
+static bool
+EvictUnusedBuffer(int buf_id, WritebackContext *wb_context)
+{
+	BufferDesc *buf = GetBufferDescriptor(buf_id);
+	BufferTag	tag;
+	uint32		hash;
+	LWLock	   *partitionLock;
+	uint32		buf_state;
+
+	/* Write it out first, if it's dirty */
+	(void) SyncOneBuffer(buf_id, false, wb_context, NULL);
+
+	buf_state = LockBufHdr(buf);
+	if (!(buf_state & BM_TAG_VALID))
+	{
+		UnlockBufHdr(buf, buf_state);
+		return true;
+	}
+	tag = buf->tag;
+	UnlockBufHdr(buf, buf_state);
+
+	hash = BufTableHashCode(&tag);
+	partitionLock = BufMappingPartitionLock(hash);
+
+	/*
+	 * Like InvalidateBuffer(), but give up rather than wait if somebody has
+	 * pinned or re-dirtied the buffer meanwhile; we'll try again later.
+	 */
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	buf_state = LockBufHdr(buf);
+	if (!(buf_state & BM_TAG_VALID) || !BufferTagsEqual(&buf->tag, &tag) ||
+		BUF_STATE_GET_REFCOUNT(buf_state) != 0 || (buf_state & BM_DIRTY))
+	{
+		UnlockBufHdr(buf, buf_state);
+		LWLockRelease(partitionLock);
+		return false;
+	}
+
+	ClearBufferTag(&buf->tag);
+	buf_state &= ~(BUF_FLAG_MASK | BUF_USAGECOUNT_MASK);
+	UnlockBufHdr(buf, buf_state);
+
+	BufTableDelete(&tag, hash);
+	LWLockRelease(partitionLock);
+
+	return true;
+}
+
+/*
+ * BgBufferSyncPartition -- BgBufferSync's work for one clock sweep partition
+ *
+ * The bgwriter cleans ahead of each partition's clock sweep separately, since
+ * they advance independently of each other.  'state' holds the information
+ * saved between calls for this partition, and at most 'maxpages' buffers are
+ * written.
+ *
+ * Returns true if the partition is idle enough to allow hibernation.
+ */
+static bool
+BgBufferSyncPartition(int partition, BgWriterPartitionState *state,
+					  int maxpages, WritebackContext *wb_context)
 {
 	/* info obtained from freelist.c */
+	int			first_buffer;
+	int			num_buffers;
+	int			nbuffers;		/* number of buffers in use */
 	int			strategy_buf_id;
 	uint32		strategy_passes;
 	uint32		recent_alloc;
 
 	/*
 	 * Information saved between calls so we can determine the strategy
-	 * point's advance rate and avoid scanning already-cleaned buffers.
+	 * point's advance rate and avoid scanning already-cleaned buffers.  The
+	 * buffer positions are relative to the start of the partition.
 	 */
-	static bool saved_info_valid = false;
-	static int	prev_strategy_buf_id;
-	static uint32 prev_strategy_passes;
-	static int	next_to_clean;
-	static uint32 next_passes;
+	bool		saved_info_valid = state->saved_info_valid;
+	int			prev_strategy_buf_id = state->prev_strategy_buf_id;
+	uint32		prev_strategy_passes = state->prev_strategy_passes;
+	int			next_to_clean = state->next_to_clean;
+	uint32		next_passes = state->next_passes;
 
 	/* Moving averages of allocation rate and clean-buffer density */
-	static float smoothed_alloc = 0;
-	static float smoothed_density = 10.0;
+	float		smoothed_alloc = state->smoothed_alloc;
+	float		smoothed_density = state->smoothed_density;
 
 	/* Potentially these could be tunables, but for now, not */
 	float		smoothing_samples = 16;
@@ -2307,16 +2665,23 @@ BgBufferSync(WritebackContext *wb_context)
 	int			num_to_scan;
 	int			num_written;
 	int			reusable_buffers;
+	BufferWriteRun run;
 
 	/* Variables for final smoothed_density update */
 	long		new_strategy_delta;
 	uint32		new_recent_alloc;
 
 	/*
-	 * Find out where the freelist clock sweep currently is, and how many
+	 * Find out where the partition's clock sweep currently is, and how many
 	 * buffer allocations have happened since our last call.
 	 */
-	strategy_buf_id = StrategySyncStart(&strategy_passes, &recent_alloc);
+	StrategyPartitionBounds(partition, &first_buffer, &num_buffers, &nbuffers);
+	strategy_buf_id = StrategySyncStart(partition, &strategy_passes,
+										&recent_alloc) - first_buffer;
+
+	/* Start over if the number of buffers in use has changed */
+	if (nbuffers != state->nbuffers)
+		saved_info_valid = false;
 
 	/* Report buffer alloc counts to pgstat */
 	PendingBgWriterStats.buf_alloc += recent_alloc;
@@ -2326,9 +2691,10 @@ BgBufferSync(WritebackContext *wb_context)
 	 * stuff.  We mark the saved state invalid so that we can recover sanely
 	 * if LRU scan is turned back on later.
 	 */
-	if (bgwriter_lru_maxpages <= 0)
+	if (maxpages <= 0)
 	{
-		saved_info_valid = false;
+		state->nbuffers = nbuffers;
+		state->saved_info_valid = false;
 		return true;
 	}
 
@@ -2345,7 +2711,7 @@ BgBufferSync(WritebackContext *wb_context)
 		int32		passes_delta = strategy_passes - prev_strategy_passes;
 
 		strategy_delta = strategy_buf_id - prev_strategy_buf_id;
-		strategy_delta += (long) passes_delta * NBuffers;
+		strategy_delta += (long) passes_delta * nbuffers;
 
 		Assert(strategy_delta >= 0);
 
@@ -2364,7 +2730,7 @@ BgBufferSync(WritebackContext *wb_context)
 				 next_to_clean >= strategy_buf_id)
 		{
 			/* on same pass, but ahead or at least not behind */
-			bufs_to_lap = NBuffers - (next_to_clean - strategy_buf_id);
+			bufs_to_lap = nbuffers - (next_to_clean - strategy_buf_id);
 #ifdef BGW_DEBUG
 			elog(DEBUG2, "bgwriter ahead: bgw %u-%u strategy %u-%u delta=%ld lap=%d",
 				 next_passes, next_to_clean,
@@ -2386,7 +2752,7 @@ BgBufferSync(WritebackContext *wb_context)
 #endif
 			next_to_clean = strategy_buf_id;
 			next_passes = strategy_passes;
-			bufs_to_lap = NBuffers;
+			bufs_to_lap = nbuffers;
 		}
 	}
 	else
@@ -2402,7 +2768,7 @@ BgBufferSync(WritebackContext *wb_context)
 		strategy_delta = 0;
 		next_to_clean = strategy_buf_id;
 		next_passes = strategy_passes;
-		bufs_to_lap = NBuffers;
+		bufs_to_lap = nbuffers;
 	}
 
 	/* Update saved info for next time */
@@ -2428,7 +2794,7 @@ BgBufferSync(WritebackContext *wb_context)
 	 * strategy point and where we've scanned ahead to, based on the smoothed
 	 * density estimate.
 	 */
-	bufs_ahead = NBuffers - bufs_to_lap;
+	bufs_ahead = nbuffers - bufs_to_lap;
 	reusable_buffers_est = (float) bufs_ahead / smoothed_density;
 
 	/*
@@ -2464,9 +2830,9 @@ BgBufferSync(WritebackContext *wb_context)
 	 *
 	 * (scan_whole_pool_milliseconds / BgWriterDelay) computes how many times
 	 * the BGW will be called during the scan_whole_pool time; slice the
-	 * buffer pool into that many sections.
+	 * partition into that many sections.
 	 */
-	min_scan_buffers = (int) (NBuffers / (scan_whole_pool_milliseconds / BgWriterDelay));
+	min_scan_buffers = (int) (nbuffers / (scan_whole_pool_milliseconds / BgWriterDelay));
 
 	if (upcoming_alloc_est < (min_scan_buffers + reusable_buffers_est))
 	{
@@ -2481,23 +2847,24 @@ BgBufferSync(WritebackContext *wb_context)
 	 * Now write out dirty reusable buffers, working forward from the
 	 * next_to_clean point, until we have lapped the strategy scan, or cleaned
 	 * enough buffers to match our estimate of the next cycle's allocation
-	 * requirements, or hit the bgwriter_lru_maxpages limit.
+	 * requirements, or hit our share of the bgwriter_lru_maxpages limit.
 	 */
-
-	/* Make sure we can handle the pin inside SyncOneBuffer */
-	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
-
 	num_to_scan = bufs_to_lap;
 	num_written = 0;
 	reusable_buffers = reusable_buffers_est;
 
-	/* Execute the LRU scan */
+	/*
+	 * Execute the LRU scan.  Buffers adjacent in the pool often hold
+	 * consecutive blocks, e.g. after a bulk load, so let SyncOneBuffer
+	 * combine their writes when possible.
+	 */
+	run.nbuffers = 0;
 	while (num_to_scan > 0 && reusable_buffers < upcoming_alloc_est)
 	{
-		int			sync_state = SyncOneBuffer(next_to_clean, true,
-											   wb_context);
+		int			sync_state = SyncOneBuffer(first_buffer + next_to_clean, true,
+											   wb_context, &run);
 
-		if (++next_to_clean >= NBuffers)
+		if (++next_to_clean >= nbuffers)
 		{
 			next_to_clean = 0;
 			next_passes++;
@@ -2507,7 +2874,7 @@ BgBufferSync(WritebackContext *wb_context)
 		if (sync_state & BUF_WRITTEN)
 		{
 			reusable_buffers++;
-			if (++num_written >= bgwriter_lru_maxpages)
+			if (++num_written >= maxpages)
 			{
 				PendingBgWriterStats.maxwritten_clean++;
 				break;
@@ -2517,11 +2884,13 @@ BgBufferSync(WritebackContext *wb_context)
 			reusable_buffers++;
 	}
 
+	FlushBufferRun(&run, wb_context);
+
 	PendingBgWriterStats.buf_written_clean += num_written;
 
 #ifdef BGW_DEBUG
-	elog(DEBUG1, "bgwriter: recent_alloc=%u smoothed=%.2f delta=%ld ahead=%d density=%.2f reusable_est=%d upcoming_est=%d scanned=%d wrote=%d reusable=%d",
-		 recent_alloc, smoothed_alloc, strategy_delta, bufs_ahead,
+	elog(DEBUG1, "bgwriter: partition=%d recent_alloc=%u smoothed=%.2f delta=%ld ahead=%d density=%.2f reusable_est=%d upcoming_est=%d scanned=%d wrote=%d reusable=%d",
+		 partition, recent_alloc, smoothed_alloc, strategy_delta, bufs_ahead,
 		 smoothed_density, reusable_buffers_est, upcoming_alloc_est,
 		 bufs_to_lap - num_to_scan,
 		 num_written,
@@ -2551,6 +2920,16 @@ BgBufferSync(WritebackContext *wb_context)
 #endif
 	}
 
+	/* Save information for next time */
+	state->nbuffers = nbuffers;
+	state->saved_info_valid = saved_info_valid;
+	state->prev_strategy_buf_id = prev_strategy_buf_id;
+	state->prev_strategy_passes = prev_strategy_passes;
+	state->next_to_clean = next_to_clean;
+	state->next_passes = next_passes;
+	state->smoothed_alloc = smoothed_alloc;
+	state->smoothed_density = smoothed_density;
+
 	/* Return true if OK to hibernate */
 	return (bufs_to_lap == 0 && recent_alloc == 0);
 }
@@ -2569,16 +2948,26 @@ BgBufferSync(WritebackContext *wb_context)
  * (BUF_WRITTEN could be set in error if FlushBuffer finds the buffer clean
  * after locking it, but we don't care all that much.)
  *
+ * If run is not NULL, the buffer is not written immediately but added to
+ * the run of buffers to be written with one combined write, after flushing
+ * any previous contents of the run that the buffer can't be appended to.
+ * The caller must eventually call FlushBufferRun() to complete the writes.
+ *
  * Note: caller must have done ResourceOwnerEnlargeBuffers.
  */
 static int
-SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
+SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context,
+			  BufferWriteRun *run)
 {
 	BufferDesc *bufHdr = GetBufferDescriptor(buf_id);
 	int			result = 0;
 	uint32		buf_state;
 	BufferTag	tag;
 
+	/* the pins of earlier buffers in the run are still held */
+	if (run != NULL && run->nbuffers > 0)
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
 	ReservePrivateRefCountEntry();
 
 	/*
@@ -2616,6 +3005,38 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	 * buffer is clean by the time we've locked it.)
 	 */
 	PinBuffer_Locked(bufHdr);
+
+	if (run != NULL)
+	{
+		/* the tag can't change while we hold a pin */
+		if (run->nbuffers > 0 &&
+			(run->nbuffers >= MAX_BUFFER_WRITE_COMBINE ||
+			 !BufTagMatchesRelFileLocator(&bufHdr->tag,
+										  &run->reln->smgr_rlocator.locator) ||
+			 BufTagGetForkNum(&bufHdr->tag) != BufTagGetForkNum(&run->tag) ||
+			 bufHdr->tag.blockNum != run->tag.blockNum + run->nbuffers))
+			FlushBufferRun(run, wb_context);
+
+		/*
+		 * Don't wait for the content lock while holding locks on other
+		 * buffers, since we don't know in which order others acquire them.
+		 */
+		if (run->nbuffers > 0 &&
+			!LWLockConditionalAcquire(BufferDescriptorGetContentLock(bufHdr),
+									  LW_SHARED))
+			FlushBufferRun(run, wb_context);
+		if (run->nbuffers == 0)
+			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
+
+		if (BufferWriteRunAdd(run, bufHdr))
+			return result | BUF_WRITTEN;
+
+		/* someone else wrote (or is writing) it, so nothing to do */
+		LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
+		UnpinBuffer(bufHdr);
+		return result;
+	}
+
 	LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
 
 	FlushBuffer(bufHdr, NULL, IOOBJECT_RELATION, IOCONTEXT_NORMAL);
@@ -2631,6 +3052,177 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	return result | BUF_WRITTEN;
 }
 
+/*
+ * BufferWriteRunAdd -- Append a buffer to a run of buffers to be written.
+ *
+ * The buffer must be pinned and share-locked, and must hold the block
+ * following the last one in the run, if the run isn't empty.  On success,
+ * the run takes over the pin and lock.  Returns false, leaving the pin and
+ * lock to the caller, if the buffer doesn't need to be written.
+ */
+static bool
+BufferWriteRunAdd(BufferWriteRun *run, BufferDesc *buf)
+{
+	uint32		buf_state;
+	XLogRecPtr	recptr;
+	Page		page;
+
+	Assert(run->nbuffers < MAX_BUFFER_WRITE_COMBINE);
+
+	/*
+	 * Try to start an I/O operation, see FlushBuffer.  We mustn't wait for
+	 * another backend's I/O while we have I/O in progress ourselves.
+	 */
+	if (!StartBufferIO(buf, false, run->nbuffers > 0))
+		return false;
+
+	if (run->nbuffers == 0)
+	{
+		run->reln = smgropen(BufTagGetRelFileLocator(&buf->tag),
+							 InvalidBackendId);
+		run->tag = buf->tag;
+		run->permanent = false;
+		run->lsn = InvalidXLogRecPtr;
+	}
+
+	buf_state = LockBufHdr(buf);
+
+	/*
+	 * Run PageGetLSN while holding header lock, since we don't have the
+	 * buffer locked exclusively in all cases.
+	 */
+	recptr = BufferGetLSN(buf);
+
+	/* To check if block content changes while flushing. - vadim 01/17/97 */
+	buf_state &= ~BM_JUST_DIRTIED;
+	UnlockBufHdr(buf, buf_state);
+
+	/* see FlushBuffer for why only permanent buffers force a WAL flush */
+	if (buf_state & BM_PERMANENT)
+	{
+		run->permanent = true;
+		if (recptr > run->lsn)
+			run->lsn = recptr;
+	}
+
+	/*
+	 * Since we have only shared lock on the buffer, other processes might be
+	 * updating hint bits in it, so we must copy the page to private storage
+	 * if we do checksumming.  PageSetChecksumCopy() has only a single copy
+	 * buffer, so keep our own set of copies for the whole run.
+	 */
+	page = (Page) BufHdrGetBlock(buf);
+	if (!PageIsNew(page) && DataChecksumsEnabled())
+	{
+		char	   *copy;
+
+		if (WriteRunPageCopies == NULL)
+			WriteRunPageCopies = MemoryContextAlloc(TopMemoryContext,
+													MAX_BUFFER_WRITE_COMBINE * BLCKSZ);
+		copy = WriteRunPageCopies + run->nbuffers * BLCKSZ;
+		memcpy(copy, page, BLCKSZ);
+		PageSetChecksumInplace((Page) copy, buf->tag.blockNum);
+		page = (Page) copy;
+	}
+
+	TRACE_POSTGRESQL_BUFFER_FLUSH_START(BufTagGetForkNum(&buf->tag),
+										buf->tag.blockNum,
+										run->reln->smgr_rlocator.locator.spcOid,
+										run->reln->smgr_rlocator.locator.dbOid,
+										run->reln->smgr_rlocator.locator.relNumber);
+
+	run->buffers[run->nbuffers] = buf;
+	run->pages[run->nbuffers] = page;
+	run->nbuffers++;
+
+	return true;
+}
+
+/*
+ * FlushBufferRun -- Physically write out a run of shared buffers.
+ *
+ * This is the multi-buffer equivalent of FlushBuffer(), writing all the
+ * buffers collected by BufferWriteRunAdd() with a single smgrwritev() call,
+ * after flushing WAL just once, up to the highest LSN of the run.  The pins
+ * and locks held by the run are released, and the buffers are scheduled for
+ * writeback.  The run is left empty.
+ */
+static void
+FlushBufferRun(BufferWriteRun *run, WritebackContext *wb_context)
+{
+	ErrorContextCallback errcallback;
+	instr_time	io_start,
+				io_time;
+
+	if (run->nbuffers == 0)
+		return;
+
+	/* Setup error traceback support for ereport() */
+	errcallback.callback = buffer_write_run_error_callback;
+	errcallback.arg = (void *) run;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	/* Force XLOG flush up to the run's highest LSN, see FlushBuffer */
+	if (run->permanent)
+		XLogFlush(run->lsn);
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+	else
+		INSTR_TIME_SET_ZERO(io_start);
+
+	smgrwritev(run->reln,
+			   BufTagGetForkNum(&run->tag),
+			   run->tag.blockNum,
+			   run->pages,
+			   run->nbuffers,
+			   false);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_write_time(INSTR_TIME_GET_MICROSEC(io_time));
+		INSTR_TIME_ADD(pgBufferUsage.blk_write_time, io_time);
+	}
+
+	pgBufferUsage.shared_blks_written += run->nbuffers;
+
+	for (int i = 0; i < run->nbuffers; i++)
+	{
+		BufferDesc *buf = run->buffers[i];
+		BufferTag	tag;
+
+		pgstat_count_io_op(IOOBJECT_RELATION, IOCONTEXT_NORMAL, IOOP_WRITE);
+
+		/*
+		 * Mark the buffer as clean (unless BM_JUST_DIRTIED has become set)
+		 * and end the BM_IO_IN_PROGRESS state.
+		 */
+		TerminateBufferIO(buf, true, 0);
+
+		TRACE_POSTGRESQL_BUFFER_FLUSH_DONE(BufTagGetForkNum(&buf->tag),
+										   buf->tag.blockNum,
+										   run->reln->smgr_rlocator.locator.spcOid,
+										   run->reln->smgr_rlocator.locator.dbOid,
+										   run->reln->smgr_rlocator.locator.relNumber);
+
+		LWLockRelease(BufferDescriptorGetContentLock(buf));
+
+		tag = buf->tag;
+
+		UnpinBuffer(buf);
+
+		ScheduleBufferTagForWriteback(wb_context, &tag);
+	}
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+
+	run->nbuffers = 0;
+}
+
 /*
  *		AtEOXact_Buffers - clean up at end of transaction.
  *
@@ -2658,15 +3250,9 @@ AtEOXact_Buffers(bool isCommit)
 void
 InitBufferPoolAccess(void)
 {
-	HASHCTL		hash_ctl;
-
 	memset(&PrivateRefCountArray, 0, sizeof(PrivateRefCountArray));
 
-	hash_ctl.keysize = sizeof(int32);
-	hash_ctl.entrysize = sizeof(PrivateRefCountEntry);
-
-	PrivateRefCountHash = hash_create("PrivateRefCount", 100, &hash_ctl,
-									  HASH_ELEM | HASH_BLOBS);
+	PrivateRefCountHash = refcount_create(TopMemoryContext, 100, NULL);
 
 	/*
 	 * AtProcExit_Buffers needs LWLock access, and thereby has to be called at
@@ -2722,12 +3308,13 @@ CheckForBufferLeaks(void)
 	/* if necessary search the hash */
 	if (PrivateRefCountOverflowed)
 	{
-		HASH_SEQ_STATUS hstat;
+		refcount_iterator iter;
+		PrivateRefCountHashEntry *hashent;
 
-		hash_seq_init(&hstat, PrivateRefCountHash);
-		while ((res = (PrivateRefCountEntry *) hash_seq_search(&hstat)) != NULL)
+		refcount_start_iterate(PrivateRefCountHash, &iter);
+		while ((hashent = refcount_iterate(PrivateRefCountHash, &iter)) != NULL)
 		{
-			PrintBufferLeakWarning(res->buffer);
+			PrintBufferLeakWarning(hashent->data.buffer);
 			RefCountErrors++;
 		}
 	}
@@ -2884,7 +3471,7 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln, IOObject io_object,
 	 * someone else flushed the buffer before we could, so we need not do
 	 * anything.
 	 */
-	if (!StartBufferIO(buf, false))
+	if (!StartBufferIO(buf, false, false))
 		return;
 
 	/* Setup error traceback support for ereport() */
@@ -3790,7 +4377,7 @@ RelationCopyStorageUsingBuffer(RelFileLocator srclocator,
 	bool		use_wal;
 	BlockNumber nblocks;
 	BlockNumber blkno;
-	PGAlignedBlock buf;
+	PGIOAlignedBlock buf;
 	BufferAccessStrategy bstrategy_src;
 	BufferAccessStrategy bstrategy_dst;
 
@@ -4612,21 +5199,29 @@ WaitIO(BufferDesc *buf)
  * In some scenarios there are race conditions in which multiple backends
  * could attempt the same I/O operation concurrently.  If someone else
  * has already started I/O on this buffer then we will block on the
- * I/O condition variable until he's done.
+ * I/O condition variable until he's done, unless nowait is true.
  *
  * Input operations are only attempted on buffers that are not BM_VALID,
  * and output operations only on buffers that are BM_VALID and BM_DIRTY,
  * so we can always tell if the work is already done.
  *
+ * Only output operations may be started while we already have I/O in
+ * progress on other buffers (see BufferWriteRun), and those must pass
+ * nowait = true, since waiting for someone else's I/O while holding ours
+ * could deadlock.
+ *
  * Returns true if we successfully marked the buffer as I/O busy,
- * false if someone else already did the work.
+ * false if someone else already did the work, or if nowait is true and
+ * someone else is doing it right now.
  */
 static bool
-StartBufferIO(BufferDesc *buf, bool forInput)
+StartBufferIO(BufferDesc *buf, bool forInput, bool nowait)
 {
 	uint32		buf_state;
 
-	Assert(!InProgressBuf);
+	Assert(NumInProgressBufs == 0 ||
+		   (!forInput && !IsForInput && nowait));
+	Assert(NumInProgressBufs < MAX_BUFFER_WRITE_COMBINE);
 
 	for (;;)
 	{
@@ -4635,6 +5230,8 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 		if (!(buf_state & BM_IO_IN_PROGRESS))
 			break;
 		UnlockBufHdr(buf, buf_state);
+		if (nowait)
+			return false;
 		WaitIO(buf);
 	}
 
@@ -4650,7 +5247,7 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 	buf_state |= BM_IO_IN_PROGRESS;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = buf;
+	InProgressBufs[NumInProgressBufs++] = buf;
 	IsForInput = forInput;
 
 	return true;
@@ -4676,8 +5273,14 @@ static void
 TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 {
 	uint32		buf_state;
+	int			i;
 
-	Assert(buf == InProgressBuf);
+	for (i = NumInProgressBufs - 1; i >= 0; i--)
+	{
+		if (InProgressBufs[i] == buf)
+			break;
+	}
+	Assert(i >= 0);
 
 	buf_state = LockBufHdr(buf);
 
@@ -4690,7 +5293,7 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 	buf_state |= set_flag_bits;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = NULL;
+	InProgressBufs[i] = InProgressBufs[--NumInProgressBufs];
 
 	ConditionVariableBroadcast(BufferDescriptorGetIOCV(buf));
 }
@@ -4699,7 +5302,7 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
  * AbortBufferIO: Clean up any active buffer I/O after an error.
  *
  *	All LWLocks we might have held have been released,
- *	but we haven't yet released buffer pins, so the buffer is still pinned.
+ *	but we haven't yet released buffer pins, so the buffers are still pinned.
  *
  *	If I/O was in progress, we always set BM_IO_ERROR, even though it's
  *	possible the error condition wasn't related to the I/O.
@@ -4707,10 +5310,9 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 void
 AbortBufferIO(void)
 {
-	BufferDesc *buf = InProgressBuf;
-
-	if (buf)
+	while (NumInProgressBufs > 0)
 	{
+		BufferDesc *buf = InProgressBufs[NumInProgressBufs - 1];
 		uint32		buf_state;
 
 		buf_state = LockBufHdr(buf);
@@ -4767,6 +5369,27 @@ shared_buffer_write_error_callback(void *arg)
 	}
 }
 
+/*
+ * Error context callback for errors occurring during combined shared buffer
+ * writes.
+ */
+static void
+buffer_write_run_error_callback(void *arg)
+{
+	BufferWriteRun *run = (BufferWriteRun *) arg;
+
+	if (run != NULL && run->nbuffers > 0)
+	{
+		char	   *path = relpathperm(BufTagGetRelFileLocator(&run->tag),
+									   BufTagGetForkNum(&run->tag));
+
+		errcontext("writing blocks %u..%u of relation %s",
+				   run->tag.blockNum,
+				   run->tag.blockNum + run->nbuffers - 1, path);
+		pfree(path);
+	}
+}
+
 /*
  * Error context callback for errors occurring during local buffer writes.
  */
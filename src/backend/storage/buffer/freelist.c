@@ -23,22 +23,64 @@
 
 #define INT_ACCESS_ONCE(var)	((int)(*((volatile int *)&(var))))
 
+/* GUC variables */
+int			clock_sweep_partitions = 1;
+int			buffer_replacement_policy = BUFFER_REPLACEMENT_CLOCK;
 
 /*
- * The shared freelist control information.
+ * The buffer pool is divided into clock_sweep_partitions contiguous ranges of
+ * buffers, each with its own clock hand, so that backends allocating buffers
+ * concurrently don't all contend on one atomic counter.  Each backend sweeps
+ * its "home" partition, chosen by its pgprocno, and only moves on to the
+ * other partitions if every buffer in it is pinned.
+ *
+ * When shared_buffers_limit restricts the buffer pool to fewer than NBuffers
+ * buffers, only the first activeBuffers buffers of each partition are used;
+ * the bgwriter empties the others, see ApplySharedBuffersLimit().
  */
 typedef struct
 {
-	/* Spinlock: protects the values below */
-	slock_t		buffer_strategy_lock;
+	/* Spinlock: protects completePasses against wraparound races */
+	slock_t		clock_sweep_lock;
+
+	int			firstBuffer;	/* first buffer in this partition */
+	int			numBuffers;		/* number of buffers in this partition */
+	pg_atomic_uint32 activeBuffers; /* number of them currently in use */
 
 	/*
-	 * Clock sweep hand: index of next buffer to consider grabbing. Note that
-	 * this isn't a concrete buffer - we only ever increase the value. So, to
-	 * get an actual buffer, it needs to be used modulo NBuffers.
+	 * Clock sweep hand: index of next buffer to consider grabbing, relative
+	 * to firstBuffer.  Note that this isn't a concrete buffer - we only ever
+	 * increase the value. So, to get an actual buffer, it needs to be used
+	 * modulo activeBuffers.
 	 */
 	pg_atomic_uint32 nextVictimBuffer;
 
+	/*
+	 * Statistics.  These counters should be wide enough that they can't
+	 * overflow during a single bgwriter cycle.
+	 */
+	uint32		completePasses; /* Complete cycles of the clock sweep */
+	pg_atomic_uint32 numBufferAllocs;	/* Buffers allocated since last reset */
+} ClockSweepPartition;
+
+/* Each partition gets its own cache line, to avoid false sharing */
+typedef union
+{
+	ClockSweepPartition part;
+	char		pad[PG_CACHE_LINE_SIZE];
+} ClockSweepPartitionPadded;
+
+StaticAssertDecl(sizeof(ClockSweepPartition) <= PG_CACHE_LINE_SIZE,
+				 "ClockSweepPartition must fit in a cache line");
+
+/*
+ * The shared freelist control information.
+ */
+typedef struct
+{
+	/* Spinlock: protects the values below */
+	slock_t		buffer_strategy_lock;
+
 	int			firstFreeBuffer;	/* Head of list of unused buffers */
 	int			lastFreeBuffer; /* Tail of list of unused buffers */
 
@@ -47,12 +89,11 @@ typedef struct
 	 * when the list is empty)
 	 */
 
-	/*
-	 * Statistics.  These counters should be wide enough that they can't
-	 * overflow during a single bgwriter cycle.
-	 */
-	uint32		completePasses; /* Complete cycles of the clock sweep */
-	pg_atomic_uint32 numBufferAllocs;	/* Buffers allocated since last reset */
+	/* Number of entries in StrategyPartitions */
+	int			numPartitions;
+
+	/* Total number of buffers in use, see StrategySetActiveBuffers */
+	int			activeBuffers;
 
 	/*
 	 * Bgworker process to be notified upon activity or -1 if none. See
@@ -61,8 +102,26 @@ typedef struct
 	int			bgwprocno;
 } BufferStrategyControl;
 
+/*
+ * With buffer_replacement_policy = 2q, a block read into a buffer is taken
+ * to be cold, unless it was evicted only recently, and starts out with a
+ * usage count of zero instead of one.  The clock sweep then evicts it on
+ * its next pass, unless it is used again in the meantime, so a large index
+ * or bitmap heap scan over cold data replaces its own blocks rather than
+ * wearing down the usage counts of frequently used ones.  To recognize a
+ * block that is worth keeping although it was evicted, the hash codes of
+ * the tags of recently evicted blocks are remembered in a "ghost" table with
+ * NBuffers entries, indexed by hash code; a block found there starts out
+ * with a usage count of two instead.  The table is lossy: an entry is
+ * overwritten by the next eviction that maps to it, and a false match only
+ * affects the initial usage count of a block.
+ */
+#define GHOST_USAGE_COUNT	2
+
 /* Pointers to shared state */
 static BufferStrategyControl *StrategyControl = NULL;
+static ClockSweepPartitionPadded *StrategyPartitions = NULL;
+static pg_atomic_uint32 *GhostTagHashes = NULL;
 
 /*
  * Private (non-shared) state for managing a ring of shared buffers to re-use.
@@ -97,16 +156,30 @@ static BufferDesc *GetBufferFromRing(BufferAccessStrategy strategy,
 									 uint32 *buf_state);
 static void AddBufferToRing(BufferAccessStrategy strategy,
 							BufferDesc *buf);
+static bool BufferIsActive(int buf_id);
+static void SetPartitionActiveBuffers(int nbuffers);
+
+/*
+ * NumClockSweepPartitions - number of clock sweep partitions to create
+ *
+ * Every partition needs at least one buffer.
+ */
+static int
+NumClockSweepPartitions(void)
+{
+	return Min(clock_sweep_partitions, NBuffers);
+}
 
 /*
  * ClockSweepTick - Helper routine for StrategyGetBuffer()
  *
- * Move the clock hand one buffer ahead of its current position and return the
- * id of the buffer now under the hand.
+ * Move the clock hand of the given partition one buffer ahead of its current
+ * position and return the id of the buffer now under the hand.
  */
 static inline uint32
-ClockSweepTick(void)
+ClockSweepTick(ClockSweepPartition *part)
 {
+	uint32		nbuffers = pg_atomic_read_u32(&part->activeBuffers);
 	uint32		victim;
 
 	/*
@@ -115,14 +188,14 @@ ClockSweepTick(void)
 	 * apparent order.
 	 */
 	victim =
-		pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, 1);
+		pg_atomic_fetch_add_u32(&part->nextVictimBuffer, 1);
 
-	if (victim >= NBuffers)
+	if (victim >= nbuffers)
 	{
 		uint32		originalVictim = victim;
 
 		/* always wrap what we look up in BufferDescriptors */
-		victim = victim % NBuffers;
+		victim = victim % nbuffers;
 
 		/*
 		 * If we're the one that just caused a wraparound, force
@@ -148,19 +221,19 @@ ClockSweepTick(void)
 				 * could lead to an overflow of nextVictimBuffers, but that's
 				 * highly unlikely and wouldn't be particularly harmful.
 				 */
-				SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+				SpinLockAcquire(&part->clock_sweep_lock);
 
-				wrapped = expected % NBuffers;
+				wrapped = expected % nbuffers;
 
-				success = pg_atomic_compare_exchange_u32(&StrategyControl->nextVictimBuffer,
+				success = pg_atomic_compare_exchange_u32(&part->nextVictimBuffer,
 														 &expected, wrapped);
 				if (success)
-					StrategyControl->completePasses++;
-				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+					part->completePasses++;
+				SpinLockRelease(&part->clock_sweep_lock);
 			}
 		}
 	}
-	return victim;
+	return part->firstBuffer + victim;
 }
 
 /*
@@ -198,6 +271,7 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state, bool *from_r
 	BufferDesc *buf;
 	int			bgwprocno;
 	int			trycounter;
+	int			home;
 	uint32		local_buf_state;	/* to avoid repeated (de-)referencing */
 
 	*from_ring = false;
@@ -245,9 +319,11 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state, bool *from_r
 	/*
 	 * We count buffer allocation requests so that the bgwriter can estimate
 	 * the rate of buffer consumption.  Note that buffers recycled by a
-	 * strategy object are intentionally not counted here.
+	 * strategy object are intentionally not counted here.  They are counted
+	 * against our home partition, which is where we expect to find a victim.
 	 */
-	pg_atomic_fetch_add_u32(&StrategyControl->numBufferAllocs, 1);
+	home = MyProc != NULL ? MyProc->pgprocno % StrategyControl->numPartitions : 0;
+	pg_atomic_fetch_add_u32(&StrategyPartitions[home].part.numBufferAllocs, 1);
 
 	/*
 	 * First check, without acquiring the lock, whether there's buffers in the
@@ -296,11 +372,14 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state, bool *from_r
 			 * use it; discard it and retry.  (This can only happen if VACUUM
 			 * put a valid buffer in the freelist and then someone else used
 			 * it before we got to it.  It's probably impossible altogether as
-			 * of 8.3, but we'd better check anyway.)
+			 * of 8.3, but we'd better check anyway.)  Likewise if the buffer
+			 * pool has been shrunk and the buffer is no longer in use; the
+			 * clock sweep will find it again if the pool grows back.
 			 */
 			local_buf_state = LockBufHdr(buf);
 			if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0
-				&& BUF_STATE_GET_USAGECOUNT(local_buf_state) == 0)
+				&& BUF_STATE_GET_USAGECOUNT(local_buf_state) == 0
+				&& BufferIsActive(buf->buf_id))
 			{
 				if (strategy != NULL)
 					AddBufferToRing(strategy, buf);
@@ -311,49 +390,79 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state, bool *from_r
 		}
 	}
 
-	/* Nothing on the freelist, so run the "clock sweep" algorithm */
-	trycounter = NBuffers;
-	for (;;)
+	/*
+	 * Nothing on the freelist, so run the "clock sweep" algorithm, starting
+	 * with our home partition.
+	 */
+	for (int i = 0; i < StrategyControl->numPartitions; i++)
 	{
-		buf = GetBufferDescriptor(ClockSweepTick());
-
-		/*
-		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
-		 * it; decrement the usage_count (unless pinned) and keep scanning.
-		 */
-		local_buf_state = LockBufHdr(buf);
+		ClockSweepPartition *part;
 
-		if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0)
+		part = &StrategyPartitions[(home + i) % StrategyControl->numPartitions].part;
+		trycounter = pg_atomic_read_u32(&part->activeBuffers);
+		for (;;)
 		{
-			if (BUF_STATE_GET_USAGECOUNT(local_buf_state) != 0)
+			buf = GetBufferDescriptor(ClockSweepTick(part));
+
+			/*
+			 * If the buffer is pinned or has a nonzero usage_count, we cannot
+			 * use it; decrement the usage_count (unless pinned) and keep
+			 * scanning.
+			 */
+			local_buf_state = LockBufHdr(buf);
+
+			/*
+			 * The buffer pool might have been shrunk since ClockSweepTick()
+			 * looked at activeBuffers.  Rechecking while holding the header
+			 * spinlock ensures that the bgwriter, which empties buffers that
+			 * are no longer in use under the same lock, doesn't miss our
+			 * taking it.
+			 */
+			if (buf->buf_id - part->firstBuffer >=
+				pg_atomic_read_u32(&part->activeBuffers))
 			{
-				local_buf_state -= BUF_USAGECOUNT_ONE;
+				UnlockBufHdr(buf, local_buf_state);
+				continue;
+			}
 
-				trycounter = NBuffers;
+			if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0)
+			{
+				if (BUF_STATE_GET_USAGECOUNT(local_buf_state) != 0)
+				{
+					local_buf_state -= BUF_USAGECOUNT_ONE;
+
+					trycounter = pg_atomic_read_u32(&part->activeBuffers);
+				}
+				else
+				{
+					/* Found a usable buffer */
+					if (strategy != NULL)
+						AddBufferToRing(strategy, buf);
+					*buf_state = local_buf_state;
+					return buf;
+				}
 			}
-			else
+			else if (--trycounter == 0)
 			{
-				/* Found a usable buffer */
-				if (strategy != NULL)
-					AddBufferToRing(strategy, buf);
-				*buf_state = local_buf_state;
-				return buf;
+				/*
+				 * We've scanned all the buffers of this partition without
+				 * making any state changes, so they are all pinned (or were
+				 * when we looked at them).  Try the next partition.
+				 */
+				UnlockBufHdr(buf, local_buf_state);
+				break;
 			}
-		}
-		else if (--trycounter == 0)
-		{
-			/*
-			 * We've scanned all the buffers without making any state changes,
-			 * so all the buffers are pinned (or were when we looked at them).
-			 * We could hope that someone will free one eventually, but it's
-			 * probably better to fail than to risk getting stuck in an
-			 * infinite loop.
-			 */
 			UnlockBufHdr(buf, local_buf_state);
-			elog(ERROR, "no unpinned buffers available");
 		}
-		UnlockBufHdr(buf, local_buf_state);
 	}
+
+	/*
+	 * All the buffers are pinned.  We could hope that someone will free one
+	 * eventually, but it's probably better to fail than to risk getting stuck
+	 * in an infinite loop.
+	 */
+	elog(ERROR, "no unpinned buffers available");
+	return NULL;				/* keep compiler quiet */
 }
 
 /*
@@ -380,42 +489,151 @@ StrategyFreeBuffer(BufferDesc *buf)
 }
 
 /*
- * StrategySyncStart -- tell BufferSync where to start syncing
+ * StrategyNumPartitions -- number of clock sweep partitions
+ */
+int
+StrategyNumPartitions(void)
+{
+	return StrategyControl->numPartitions;
+}
+
+/*
+ * StrategyPartitionBounds -- report the range of buffers in a partition
  *
- * The result is the buffer index of the best buffer to sync first.
- * BufferSync() will proceed circularly around the buffer array from there.
+ * The partition consists of buffers *first_buffer .. *first_buffer +
+ * *num_buffers - 1, of which the first *active_buffers are currently in use.
+ */
+void
+StrategyPartitionBounds(int partition, int *first_buffer, int *num_buffers,
+						int *active_buffers)
+{
+	ClockSweepPartition *part = &StrategyPartitions[partition].part;
+
+	*first_buffer = part->firstBuffer;
+	*num_buffers = part->numBuffers;
+	*active_buffers = pg_atomic_read_u32(&part->activeBuffers);
+}
+
+/*
+ * StrategyActiveBuffers -- number of buffers currently in use
+ */
+int
+StrategyActiveBuffers(void)
+{
+	int			result;
+
+	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+	result = StrategyControl->activeBuffers;
+	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+
+	return result;
+}
+
+/*
+ * StrategySetActiveBuffers -- change the number of buffers in use
+ *
+ * The buffers in use are spread evenly over the clock sweep partitions.  When
+ * the number shrinks, buffers that are no longer in use won't be handed out
+ * again, but the caller is responsible for emptying them.
+ */
+void
+StrategySetActiveBuffers(int nbuffers)
+{
+	Assert(nbuffers >= StrategyControl->numPartitions && nbuffers <= NBuffers);
+
+	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+	StrategyControl->activeBuffers = nbuffers;
+	SetPartitionActiveBuffers(nbuffers);
+	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+}
+
+/*
+ * SetPartitionActiveBuffers -- divide 'nbuffers' in use over the partitions
+ */
+static void
+SetPartitionActiveBuffers(int nbuffers)
+{
+	int			npartitions = StrategyControl->numPartitions;
+
+	for (int i = 0; i < npartitions; i++)
+	{
+		ClockSweepPartition *part = &StrategyPartitions[i].part;
+		int			nactive;
+
+		nactive = (int) ((int64) nbuffers * (i + 1) / npartitions) -
+			(int) ((int64) nbuffers * i / npartitions);
+		nactive = Max(Min(nactive, part->numBuffers), 1);
+
+		pg_atomic_write_u32(&part->activeBuffers, nactive);
+	}
+}
+
+/*
+ * BufferIsActive -- is the buffer currently in use?
+ */
+static bool
+BufferIsActive(int buf_id)
+{
+	int			npartitions = StrategyControl->numPartitions;
+	int			partition;
+	ClockSweepPartition *part;
+
+	/* find the partition, see StrategyInitialize() */
+	partition = (int) ((int64) buf_id * npartitions / NBuffers);
+	while (partition > 0 &&
+		   StrategyPartitions[partition].part.firstBuffer > buf_id)
+		partition--;
+	while (partition < npartitions - 1 &&
+		   StrategyPartitions[partition + 1].part.firstBuffer <= buf_id)
+		partition++;
+
+	part = &StrategyPartitions[partition].part;
+	return buf_id - part->firstBuffer <
+		pg_atomic_read_u32(&part->activeBuffers);
+}
+
+/*
+ * StrategySyncStart -- tell BgBufferSync where to start syncing
+ *
+ * The result is the buffer index of the best buffer of the given clock sweep
+ * partition to sync first.  BgBufferSync() will proceed circularly around the
+ * partition's buffers in use from there.
  *
- * In addition, we return the completed-pass count (which is effectively
- * the higher-order bits of nextVictimBuffer) and the count of recent buffer
- * allocs if non-NULL pointers are passed.  The alloc count is reset after
- * being read.
+ * In addition, we return the partition's completed-pass count (which is
+ * effectively the higher-order bits of nextVictimBuffer) and the count of
+ * recent buffer allocs if non-NULL pointers are passed.  The alloc count is
+ * reset after being read.
  */
 int
-StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc)
+StrategySyncStart(int partition, uint32 *complete_passes,
+				  uint32 *num_buf_alloc)
 {
+	ClockSweepPartition *part = &StrategyPartitions[partition].part;
+	uint32		nbuffers;
 	uint32		nextVictimBuffer;
 	int			result;
 
-	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
-	nextVictimBuffer = pg_atomic_read_u32(&StrategyControl->nextVictimBuffer);
-	result = nextVictimBuffer % NBuffers;
+	SpinLockAcquire(&part->clock_sweep_lock);
+	nbuffers = pg_atomic_read_u32(&part->activeBuffers);
+	nextVictimBuffer = pg_atomic_read_u32(&part->nextVictimBuffer);
+	result = part->firstBuffer + nextVictimBuffer % nbuffers;
 
 	if (complete_passes)
 	{
-		*complete_passes = StrategyControl->completePasses;
+		*complete_passes = part->completePasses;
 
 		/*
 		 * Additionally add the number of wraparounds that happened before
 		 * completePasses could be incremented. C.f. ClockSweepTick().
 		 */
-		*complete_passes += nextVictimBuffer / NBuffers;
+		*complete_passes += nextVictimBuffer / nbuffers;
 	}
 
 	if (num_buf_alloc)
 	{
-		*num_buf_alloc = pg_atomic_exchange_u32(&StrategyControl->numBufferAllocs, 0);
+		*num_buf_alloc = pg_atomic_exchange_u32(&part->numBufferAllocs, 0);
 	}
-	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+	SpinLockRelease(&part->clock_sweep_lock);
 	return result;
 }
 
@@ -441,6 +659,46 @@ StrategyNotifyBgWriter(int bgwprocno)
 }
 
 
+/*
+ * StrategyInitialUsageCount -- usage count of a block just read in
+ *
+ * hashcode is the buffer mapping hash code of the block's tag.  Blocks read
+ * with a BufferAccessStrategy are left to the strategy's ring.
+ */
+uint32
+StrategyInitialUsageCount(BufferAccessStrategy strategy, uint32 hashcode)
+{
+	pg_atomic_uint32 *ghost;
+
+	if (buffer_replacement_policy != BUFFER_REPLACEMENT_2Q || strategy != NULL)
+		return 1;
+
+	ghost = &GhostTagHashes[hashcode % (uint32) NBuffers];
+	if (pg_atomic_read_u32(ghost) == hashcode)
+	{
+		pg_atomic_write_u32(ghost, 0);
+		return GHOST_USAGE_COUNT;
+	}
+
+	return 0;
+}
+
+/*
+ * StrategyRecordEviction -- remember that a block was evicted
+ *
+ * hashcode is the buffer mapping hash code of the block's tag.
+ */
+void
+StrategyRecordEviction(uint32 hashcode)
+{
+	if (buffer_replacement_policy != BUFFER_REPLACEMENT_2Q)
+		return;
+
+	pg_atomic_write_u32(&GhostTagHashes[hashcode % (uint32) NBuffers],
+						hashcode);
+}
+
+
 /*
  * StrategyShmemSize
  *
@@ -460,6 +718,14 @@ StrategyShmemSize(void)
 	/* size of the shared replacement strategy control block */
 	size = add_size(size, MAXALIGN(sizeof(BufferStrategyControl)));
 
+	/* ... and of the clock sweep partitions */
+	size = add_size(size, mul_size(NumClockSweepPartitions(),
+								   sizeof(ClockSweepPartitionPadded)));
+
+	/* ... and of the ghost table, if used */
+	if (buffer_replacement_policy == BUFFER_REPLACEMENT_2Q)
+		size = add_size(size, mul_size(NBuffers, sizeof(pg_atomic_uint32)));
+
 	return size;
 }
 
@@ -494,9 +760,30 @@ StrategyInitialize(bool init)
 		ShmemInitStruct("Buffer Strategy Status",
 						sizeof(BufferStrategyControl),
 						&found);
+	StrategyPartitions = (ClockSweepPartitionPadded *)
+		ShmemInitStruct("Buffer Strategy Partitions",
+						NumClockSweepPartitions() * sizeof(ClockSweepPartitionPadded),
+						&found);
+
+	if (buffer_replacement_policy == BUFFER_REPLACEMENT_2Q)
+	{
+		bool		ghost_found;
+
+		GhostTagHashes = (pg_atomic_uint32 *)
+			ShmemInitStruct("Buffer Ghost Tags",
+							NBuffers * sizeof(pg_atomic_uint32),
+							&ghost_found);
+		if (!ghost_found)
+		{
+			for (int i = 0; i < NBuffers; i++)
+				pg_atomic_init_u32(&GhostTagHashes[i], 0);
+		}
+	}
 
 	if (!found)
 	{
+		int			npartitions = NumClockSweepPartitions();
+
 		/*
 		 * Only done once, usually in postmaster
 		 */
@@ -511,12 +798,28 @@ StrategyInitialize(bool init)
 		StrategyControl->firstFreeBuffer = 0;
 		StrategyControl->lastFreeBuffer = NBuffers - 1;
 
-		/* Initialize the clock sweep pointer */
-		pg_atomic_init_u32(&StrategyControl->nextVictimBuffer, 0);
+		/*
+		 * Divide the buffers evenly between the clock sweep partitions, and
+		 * initialize their clock sweep pointers and statistics.
+		 */
+		StrategyControl->numPartitions = npartitions;
+		for (int i = 0; i < npartitions; i++)
+		{
+			ClockSweepPartition *part = &StrategyPartitions[i].part;
+
+			SpinLockInit(&part->clock_sweep_lock);
+			part->firstBuffer = (int) ((int64) NBuffers * i / npartitions);
+			part->numBuffers = (int) ((int64) NBuffers * (i + 1) / npartitions) -
+				part->firstBuffer;
+			pg_atomic_init_u32(&part->activeBuffers, part->numBuffers);
+			pg_atomic_init_u32(&part->nextVictimBuffer, 0);
+			part->completePasses = 0;
+			pg_atomic_init_u32(&part->numBufferAllocs, 0);
+		}
 
-		/* Clear statistics */
-		StrategyControl->completePasses = 0;
-		pg_atomic_init_u32(&StrategyControl->numBufferAllocs, 0);
+		/* Start out using as many buffers as shared_buffers_limit allows */
+		StrategyControl->activeBuffers = SharedBuffersLimit();
+		SetPartitionActiveBuffers(StrategyControl->activeBuffers);
 
 		/* No pending notification */
 		StrategyControl->bgwprocno = -1;
@@ -628,7 +931,8 @@ GetBufferFromRing(BufferAccessStrategy strategy, uint32 *buf_state)
 		return NULL;
 
 	/*
-	 * If the buffer is pinned we cannot use it under any circumstances.
+	 * If the buffer is pinned, or is no longer in use after the buffer pool has
+ * been shrunk, we cannot use it under any circumstances.
 	 *
 	 * If usage_count is 0 or 1 then the buffer is fair game (we expect 1,
 	 * since our own previous usage of the ring element would have left it
@@ -639,7 +943,8 @@ GetBufferFromRing(BufferAccessStrategy strategy, uint32 *buf_state)
 	buf = GetBufferDescriptor(bufnum - 1);
 	local_buf_state = LockBufHdr(buf);
 	if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0
-		&& BUF_STATE_GET_USAGECOUNT(local_buf_state) <= 1)
+		&& BUF_STATE_GET_USAGECOUNT(local_buf_state) <= 1
+		&& BufferIsActive(buf->buf_id))
 	{
 		*buf_state = local_buf_state;
 		return buf;
@@ -17,6 +17,7 @@
 
 #include "access/parallel.h"
 #include "catalog/catalog.h"
+#include "common/hashfn.h"
 #include "executor/instrument.h"
 #include "pgstat.h"
 #include "storage/buf_internals.h"
@@ -33,8 +34,27 @@ typedef struct
 {
 	BufferTag	key;			/* Tag of a disk page */
 	int			id;				/* Associated local buffer's index */
+	char		status;			/* for simplehash use */
 } LocalBufferLookupEnt;
 
+/*
+ * The lookup table is a simplehash rather than a dynahash: it is consulted
+ * for every access to a temporary table's pages, and never needs to be
+ * shared, so the open-addressing table with inlined hash and comparison
+ * functions pays off.
+ */
+#define SH_PREFIX localbuf
+#define SH_ELEMENT_TYPE LocalBufferLookupEnt
+#define SH_KEY_TYPE BufferTag
+#define SH_KEY key
+#define SH_HASH_KEY(tb, key) \
+	hash_bytes((const unsigned char *) &(key), sizeof(BufferTag))
+#define SH_EQUAL(tb, a, b) BufferTagsEqual(&(a), &(b))
+#define SH_SCOPE static inline
+#define SH_DEFINE
+#define SH_DECLARE
+#include "lib/simplehash.h"
+
 /* Note: this macro only works on local buffers, not shared ones! */
 #define LocalBufHdrGetBlock(bufHdr) \
 	LocalBufferBlockPointers[-((bufHdr)->buf_id + 2)]
@@ -47,7 +67,7 @@ int32	   *LocalRefCount = NULL;
 
 static int	nextFreeLocalBuf = 0;
 
-static HTAB *LocalBufHash = NULL;
+static localbuf_hash *LocalBufHash = NULL;
 
 
 static void InitLocalBuffers(void);
@@ -76,8 +96,7 @@ PrefetchLocalBuffer(SMgrRelation smgr, ForkNumber forkNum,
 		InitLocalBuffers();
 
 	/* See if the desired buffer already exists */
-	hresult = (LocalBufferLookupEnt *)
-		hash_search(LocalBufHash, &newTag, HASH_FIND, NULL);
+	hresult = localbuf_lookup(LocalBufHash, newTag);
 
 	if (hresult)
 	{
@@ -125,8 +144,7 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 		InitLocalBuffers();
 
 	/* See if the desired buffer already exists */
-	hresult = (LocalBufferLookupEnt *)
-		hash_search(LocalBufHash, &newTag, HASH_FIND, NULL);
+	hresult = localbuf_lookup(LocalBufHash, newTag);
 
 	/*
 	 * IO Operations on local buffers are only done in IOCONTEXT_NORMAL. Set
@@ -257,9 +275,7 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 	 */
 	if (buf_state & BM_TAG_VALID)
 	{
-		hresult = (LocalBufferLookupEnt *)
-			hash_search(LocalBufHash, &bufHdr->tag, HASH_REMOVE, NULL);
-		if (!hresult)			/* shouldn't happen */
+		if (!localbuf_delete(LocalBufHash, bufHdr->tag))	/* shouldn't happen */
 			elog(ERROR, "local buffer hash table corrupted");
 		/* mark buffer invalid just in case hash insert fails */
 		ClearBufferTag(&bufHdr->tag);
@@ -268,8 +284,7 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 		pgstat_count_io_op(IOOBJECT_TEMP_RELATION, IOCONTEXT_NORMAL, IOOP_EVICT);
 	}
 
-	hresult = (LocalBufferLookupEnt *)
-		hash_search(LocalBufHash, &newTag, HASH_ENTER, &found);
+	hresult = localbuf_insert(LocalBufHash, newTag, &found);
 	if (found)					/* shouldn't happen */
 		elog(ERROR, "local buffer hash table corrupted");
 	hresult->id = b;
@@ -341,7 +356,6 @@ DropRelationLocalBuffers(RelFileLocator rlocator, ForkNumber forkNum,
 	for (i = 0; i < NLocBuffer; i++)
 	{
 		BufferDesc *bufHdr = GetLocalBufferDescriptor(i);
-		LocalBufferLookupEnt *hresult;
 		uint32		buf_state;
 
 		buf_state = pg_atomic_read_u32(&bufHdr->state);
@@ -360,9 +374,7 @@ DropRelationLocalBuffers(RelFileLocator rlocator, ForkNumber forkNum,
 					 LocalRefCount[i]);
 
 			/* Remove entry from hashtable */
-			hresult = (LocalBufferLookupEnt *)
-				hash_search(LocalBufHash, &bufHdr->tag, HASH_REMOVE, NULL);
-			if (!hresult)		/* shouldn't happen */
+			if (!localbuf_delete(LocalBufHash, bufHdr->tag))	/* shouldn't happen */
 				elog(ERROR, "local buffer hash table corrupted");
 			/* Mark buffer invalid */
 			ClearBufferTag(&bufHdr->tag);
@@ -388,7 +400,6 @@ DropRelationAllLocalBuffers(RelFileLocator rlocator)
 	for (i = 0; i < NLocBuffer; i++)
 	{
 		BufferDesc *bufHdr = GetLocalBufferDescriptor(i);
-		LocalBufferLookupEnt *hresult;
 		uint32		buf_state;
 
 		buf_state = pg_atomic_read_u32(&bufHdr->state);
@@ -404,9 +415,7 @@ DropRelationAllLocalBuffers(RelFileLocator rlocator)
 									BufTagGetForkNum(&bufHdr->tag)),
 					 LocalRefCount[i]);
 			/* Remove entry from hashtable */
-			hresult = (LocalBufferLookupEnt *)
-				hash_search(LocalBufHash, &bufHdr->tag, HASH_REMOVE, NULL);
-			if (!hresult)		/* shouldn't happen */
+			if (!localbuf_delete(LocalBufHash, bufHdr->tag))	/* shouldn't happen */
 				elog(ERROR, "local buffer hash table corrupted");
 			/* Mark buffer invalid */
 			ClearBufferTag(&bufHdr->tag);
@@ -427,7 +436,6 @@ static void
 InitLocalBuffers(void)
 {
 	int			nbufs = num_temp_buffers;
-	HASHCTL		info;
 	int			i;
 
 	/*
@@ -476,16 +484,7 @@ InitLocalBuffers(void)
 	}
 
 	/* Create the lookup hash table */
-	info.keysize = sizeof(BufferTag);
-	info.entrysize = sizeof(LocalBufferLookupEnt);
-
-	LocalBufHash = hash_create("Local Buffer Lookup Table",
-							   nbufs,
-							   &info,
-							   HASH_ELEM | HASH_BLOBS);
-
-	if (!LocalBufHash)
-		elog(ERROR, "could not initialize local buffer hash table");
+	LocalBufHash = localbuf_create(TopMemoryContext, nbufs, NULL);
 
 	/* Initialization done, mark buffers allocated */
 	NLocBuffer = nbufs;
@@ -554,8 +553,11 @@ GetLocalBufferStorage(void)
 		/* And don't overflow MaxAllocSize, either */
 		num_bufs = Min(num_bufs, MaxAllocSize / BLCKSZ);
 
-		cur_block = (char *) MemoryContextAlloc(LocalBufferContext,
-												num_bufs * BLCKSZ);
+		/* Align the buffers suitably for direct I/O */
+		cur_block = (char *) MemoryContextAllocAligned(LocalBufferContext,
+													   num_bufs * BLCKSZ,
+													   PG_IO_ALIGN_SIZE,
+													   0);
 		next_buf_in_block = 0;
 		num_bufs_in_block = num_bufs;
 	}
@@ -40,12 +40,33 @@
  * when the corresponding files need to be survived across the transaction and
  * need to be opened and closed multiple times.  Such files need to be created
  * as a member of a FileSet.
+ *
+ * Finally, private temporary files can be compressed, if temp_file_compression
+ * is set when they are created with BufFileCreateCompressTemp().  Each buffer
+ * is then written as a variable-length chunk: a BufFileChunkHeader followed
+ * by the compressed data, or by the raw data if it didn't compress.  For such
+ * files, (curFile, curOffset) is the physical position of the chunk that
+ * holds the buffer, and (nextFile, nextOffset) is where the next one starts.
+ * A position reported by BufFileTell() encodes the chunk's position and the
+ * offset within it, so it can only be passed back to BufFileSeek(); relative
+ * seeks and block-oriented seeks are not supported.  Compressed files can
+ * only be appended to: the last chunk may be rewritten, but writing after
+ * seeking back to an earlier one is an error.
  *-------------------------------------------------------------------------
  */
 
 #include "postgres.h"
 
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "access/xlog.h"
 #include "commands/tablespace.h"
+#include "common/pg_lzcompress.h"
 #include "executor/instrument.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -62,6 +83,28 @@
 #define MAX_PHYSICAL_FILESIZE	0x40000000
 #define BUFFILE_SEG_SIZE		(MAX_PHYSICAL_FILESIZE / BLCKSZ)
 
+/*
+ * Header of each chunk of a compressed BufFile.  If len == rawlen, the data
+ * is stored uncompressed.
+ */
+typedef struct BufFileChunkHeader
+{
+	int32		rawlen;			/* number of bytes of data in the chunk */
+	int32		len;			/* number of bytes stored on disk */
+} BufFileChunkHeader;
+
+/* Size of the buffer holding a compressed chunk, including its header */
+#define BUFFILE_CHUNK_SIZE \
+	(sizeof(BufFileChunkHeader) + PGLZ_MAX_OUTPUT(BLCKSZ))
+
+/*
+ * BufFileTell() positions of compressed files: offset within the buffer,
+ * plus physical offset of the chunk times this.
+ */
+#define BUFFILE_CHUNK_POS_FACTOR	((off_t) BLCKSZ + 1)
+
+int			temp_file_compression = WAL_COMPRESSION_NONE;
+
 /*
  * This data structure represents a buffered file that consists of one or
  * more physical files (each accessed through a virtual file descriptor
@@ -95,6 +138,17 @@ struct BufFile
 	off_t		curOffset;		/* offset part of current pos */
 	int			pos;			/* next read/write position in buffer */
 	int			nbytes;			/* total # of valid bytes in buffer */
+
+	/*
+	 * For compressed files only; see notes at the top of the file.
+	 */
+	int			compression;	/* a WalCompression value */
+	char	   *cbuffer;		/* palloc'd, BUFFILE_CHUNK_SIZE bytes */
+	int			nextFile;		/* position of the next chunk */
+	off_t		nextOffset;
+	int			endFile;		/* end of data written so far */
+	off_t		endOffset;
+
 	PGAlignedBlock buffer;
 };
 
@@ -104,6 +158,13 @@ static void extendBufFile(BufFile *file);
 static void BufFileLoadBuffer(BufFile *file);
 static void BufFileDumpBuffer(BufFile *file);
 static void BufFileFlush(BufFile *file);
+static void BufFileWriteRaw(BufFile *file, int *fileno, off_t *offset,
+							const char *data, int len);
+static int	BufFileReadRaw(BufFile *file, int *fileno, off_t *offset,
+						   char *data, int len);
+static void BufFileLoadChunk(BufFile *file);
+static void BufFileDumpChunk(BufFile *file);
+static int	BufFileSeekChunk(BufFile *file, int fileno, off_t offset);
 static File MakeNewFileSetSegment(BufFile *buffile, int segment);
 
 /*
@@ -122,6 +183,8 @@ makeBufFileCommon(int nfiles)
 	file->curOffset = 0L;
 	file->pos = 0;
 	file->nbytes = 0;
+	file->compression = WAL_COMPRESSION_NONE;
+	file->cbuffer = NULL;
 
 	return file;
 }
@@ -210,6 +273,29 @@ BufFileCreateTemp(bool interXact)
 	return file;
 }
 
+/*
+ * Create a BufFile for a new temporary file, like BufFileCreateTemp(), that
+ * is compressed as per temp_file_compression.
+ *
+ * The file can only be read sequentially, or from positions obtained with
+ * BufFileTell(), and it can only be appended to.
+ */
+BufFile *
+BufFileCreateCompressTemp(bool interXact)
+{
+	BufFile    *file = BufFileCreateTemp(interXact);
+
+	if (temp_file_compression != WAL_COMPRESSION_NONE)
+	{
+		file->compression = temp_file_compression;
+		file->cbuffer = palloc(BUFFILE_CHUNK_SIZE);
+		file->nextFile = file->endFile = 0;
+		file->nextOffset = file->endOffset = 0;
+	}
+
+	return file;
+}
+
 /*
  * Build the name for a given segment of a given BufFile.
  */
@@ -415,6 +501,8 @@ BufFileClose(BufFile *file)
 		FileClose(file->files[i]);
 	/* release the buffer space */
 	pfree(file->files);
+	if (file->cbuffer)
+		pfree(file->cbuffer);
 	pfree(file);
 }
 
@@ -432,6 +520,12 @@ BufFileLoadBuffer(BufFile *file)
 	instr_time	io_start;
 	instr_time	io_time;
 
+	if (file->compression != WAL_COMPRESSION_NONE)
+	{
+		BufFileLoadChunk(file);
+		return;
+	}
+
 	/*
 	 * Advance to next component file if necessary and possible.
 	 */
@@ -488,6 +582,46 @@ BufFileLoadBuffer(BufFile *file)
  */
 static void
 BufFileDumpBuffer(BufFile *file)
+{
+	if (file->compression != WAL_COMPRESSION_NONE)
+	{
+		BufFileDumpChunk(file);
+		return;
+	}
+
+	BufFileWriteRaw(file, &file->curFile, &file->curOffset,
+					file->buffer.data, file->nbytes);
+	file->dirty = false;
+
+	/*
+	 * At this point, curOffset has been advanced to the end of the buffer,
+	 * ie, its original value + nbytes.  We need to make it point to the
+	 * logical file position, ie, original value + pos, in case that is less
+	 * (as could happen due to a small backwards seek in a dirty buffer!)
+	 */
+	file->curOffset -= (file->nbytes - file->pos);
+	if (file->curOffset < 0)	/* handle possible segment crossing */
+	{
+		file->curFile--;
+		Assert(file->curFile >= 0);
+		file->curOffset += MAX_PHYSICAL_FILESIZE;
+	}
+
+	/*
+	 * Now we can set the buffer empty without changing the logical position
+	 */
+	file->pos = 0;
+	file->nbytes = 0;
+}
+
+/*
+ * BufFileWriteRaw
+ *
+ * Write data at the given physical position, which is advanced past it.
+ */
+static void
+BufFileWriteRaw(BufFile *file, int *fileno, off_t *offset,
+				const char *data, int len)
 {
 	int			wpos = 0;
 	int			bytestowrite;
@@ -497,7 +631,7 @@ BufFileDumpBuffer(BufFile *file)
 	 * Unlike BufFileLoadBuffer, we must dump the whole buffer even if it
 	 * crosses a component-file boundary; so we need a loop.
 	 */
-	while (wpos < file->nbytes)
+	while (wpos < len)
 	{
 		off_t		availbytes;
 		instr_time	io_start;
@@ -506,24 +640,24 @@ BufFileDumpBuffer(BufFile *file)
 		/*
 		 * Advance to next component file if necessary and possible.
 		 */
-		if (file->curOffset >= MAX_PHYSICAL_FILESIZE)
+		if (*offset >= MAX_PHYSICAL_FILESIZE)
 		{
-			while (file->curFile + 1 >= file->numFiles)
+			while (*fileno + 1 >= file->numFiles)
 				extendBufFile(file);
-			file->curFile++;
-			file->curOffset = 0L;
+			(*fileno)++;
+			*offset = 0L;
 		}
 
 		/*
 		 * Determine how much we need to write into this file.
 		 */
-		bytestowrite = file->nbytes - wpos;
-		availbytes = MAX_PHYSICAL_FILESIZE - file->curOffset;
+		bytestowrite = len - wpos;
+		availbytes = MAX_PHYSICAL_FILESIZE - *offset;
 
 		if ((off_t) bytestowrite > availbytes)
 			bytestowrite = (int) availbytes;
 
-		thisfile = file->files[file->curFile];
+		thisfile = file->files[*fileno];
 
 		if (track_io_timing)
 			INSTR_TIME_SET_CURRENT(io_start);
@@ -531,9 +665,9 @@ BufFileDumpBuffer(BufFile *file)
 			INSTR_TIME_SET_ZERO(io_start);
 
 		bytestowrite = FileWrite(thisfile,
-								 file->buffer.data + wpos,
+								 data + wpos,
 								 bytestowrite,
-								 file->curOffset,
+								 *offset,
 								 WAIT_EVENT_BUFFILE_WRITE);
 		if (bytestowrite <= 0)
 			ereport(ERROR,
@@ -548,32 +682,295 @@ BufFileDumpBuffer(BufFile *file)
 			INSTR_TIME_ADD(pgBufferUsage.temp_blk_write_time, io_time);
 		}
 
-		file->curOffset += bytestowrite;
+		*offset += bytestowrite;
 		wpos += bytestowrite;
 
 		pgBufferUsage.temp_blks_written++;
 	}
-	file->dirty = false;
+}
+
+/*
+ * BufFileReadRaw
+ *
+ * Read up to len bytes at the given physical position, which is advanced
+ * past them.  Returns the number of bytes read, which is less than len only
+ * at the end of the file.
+ */
+static int
+BufFileReadRaw(BufFile *file, int *fileno, off_t *offset, char *data,
+			   int len)
+{
+	int			rpos = 0;
+
+	while (rpos < len)
+	{
+		File		thisfile;
+		off_t		availbytes;
+		int			nread;
+		instr_time	io_start;
+		instr_time	io_time;
+
+		if (*offset >= MAX_PHYSICAL_FILESIZE)
+		{
+			if (*fileno + 1 >= file->numFiles)
+				break;
+			(*fileno)++;
+			*offset = 0L;
+		}
+
+		nread = len - rpos;
+		availbytes = MAX_PHYSICAL_FILESIZE - *offset;
+		if ((off_t) nread > availbytes)
+			nread = (int) availbytes;
+
+		thisfile = file->files[*fileno];
+
+		if (track_io_timing)
+			INSTR_TIME_SET_CURRENT(io_start);
+		else
+			INSTR_TIME_SET_ZERO(io_start);
+
+		nread = FileRead(thisfile, data + rpos, nread, *offset,
+						 WAIT_EVENT_BUFFILE_READ);
+		if (nread < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m",
+							FilePathName(thisfile))));
+
+		if (track_io_timing)
+		{
+			INSTR_TIME_SET_CURRENT(io_time);
+			INSTR_TIME_SUBTRACT(io_time, io_start);
+			INSTR_TIME_ADD(pgBufferUsage.temp_blk_read_time, io_time);
+		}
+
+		if (nread == 0)
+			break;
+		*offset += nread;
+		rpos += nread;
+	}
+
+	return rpos;
+}
+
+/*
+ * BufFileLoadChunk
+ *
+ * Load the chunk at (curFile, curOffset) of a compressed file into the
+ * buffer, and set (nextFile, nextOffset) to the position following it.
+ * At call, must have dirty = false, pos and nbytes = 0.  At the end of the
+ * file, nbytes is left at 0.
+ */
+static void
+BufFileLoadChunk(BufFile *file)
+{
+	BufFileChunkHeader hdr;
+	char	   *data = file->cbuffer + sizeof(BufFileChunkHeader);
+	int			fileno = file->curFile;
+	off_t		offset = file->curOffset;
+	int			nread;
+	int			rawlen;
+
+	nread = BufFileReadRaw(file, &fileno, &offset, (char *) &hdr, sizeof(hdr));
+	if (nread == 0)
+	{
+		file->nextFile = file->curFile;
+		file->nextOffset = file->curOffset;
+		return;
+	}
+	if (nread != sizeof(hdr) ||
+		hdr.rawlen <= 0 || hdr.rawlen > BLCKSZ ||
+		hdr.len <= 0 || hdr.len > hdr.rawlen)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("invalid chunk header in compressed temporary file")));
+
+	if (hdr.len == hdr.rawlen)
+		data = file->buffer.data;
+	if (BufFileReadRaw(file, &fileno, &offset, data, hdr.len) != hdr.len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from temporary file: unexpected end of file")));
+
+	if (hdr.len == hdr.rawlen)
+		rawlen = hdr.rawlen;
+	else
+	{
+		rawlen = -1;
+		switch ((WalCompression) file->compression)
+		{
+			case WAL_COMPRESSION_PGLZ:
+				rawlen = pglz_decompress(data, hdr.len, file->buffer.data,
+										 hdr.rawlen, true);
+				break;
+
+			case WAL_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+				rawlen = LZ4_decompress_safe(data, file->buffer.data,
+											 hdr.len, hdr.rawlen);
+#else
+				elog(ERROR, "LZ4 is not supported by this build");
+#endif
+				break;
+
+			case WAL_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+				{
+					size_t		zlen;
+
+					zlen = ZSTD_decompress(file->buffer.data, hdr.rawlen,
+										   data, hdr.len);
+					if (!ZSTD_isError(zlen))
+						rawlen = (int) zlen;
+				}
+#else
+				elog(ERROR, "zstd is not supported by this build");
+#endif
+				break;
+
+			case WAL_COMPRESSION_NONE:
+				Assert(false);	/* cannot happen */
+				break;
+				/* no default case, so that compiler will warn */
+		}
+		if (rawlen != hdr.rawlen)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg_internal("compressed data in temporary file is corrupted")));
+	}
+
+	file->nbytes = rawlen;
+	file->nextFile = fileno;
+	file->nextOffset = offset;
+	pgBufferUsage.temp_blks_read++;
+}
+
+/*
+ * BufFileDumpChunk
+ *
+ * Write the buffer of a compressed file as the chunk at (curFile,
+ * curOffset), which must be the last one.  At call, should have
+ * dirty = true, nbytes > 0.  On exit, dirty is cleared, but the buffer is
+ * kept, unlike in BufFileDumpBuffer(): the position is still within it.
+ */
+static void
+BufFileDumpChunk(BufFile *file)
+{
+	BufFileChunkHeader *hdr = (BufFileChunkHeader *) file->cbuffer;
+	char	   *data = file->cbuffer + sizeof(BufFileChunkHeader);
+	int			len;
+	int			fileno = file->curFile;
+	off_t		offset = file->curOffset;
+	off_t		oldlen;
+
+	/* length of this chunk if it has been written before, else 0 */
+	oldlen = (off_t) (file->endFile - file->curFile) * MAX_PHYSICAL_FILESIZE +
+		file->endOffset - file->curOffset;
 
 	/*
-	 * At this point, curOffset has been advanced to the end of the buffer,
-	 * ie, its original value + nbytes.  We need to make it point to the
-	 * logical file position, ie, original value + pos, in case that is less
-	 * (as could happen due to a small backwards seek in a dirty buffer!)
+	 * Don't let the compressed data be as long as the input, so that we can
+	 * tell them apart.
 	 */
-	file->curOffset -= (file->nbytes - file->pos);
-	if (file->curOffset < 0)	/* handle possible segment crossing */
+	len = -1;
+	switch ((WalCompression) file->compression)
 	{
-		file->curFile--;
-		Assert(file->curFile >= 0);
-		file->curOffset += MAX_PHYSICAL_FILESIZE;
+		case WAL_COMPRESSION_PGLZ:
+			len = pglz_compress(file->buffer.data, file->nbytes, data,
+								PGLZ_strategy_always);
+			break;
+
+		case WAL_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			len = LZ4_compress_default(file->buffer.data, data, file->nbytes,
+									   file->nbytes - 1);
+			if (len <= 0)
+				len = -1;		/* failure */
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		case WAL_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		zlen;
+
+				zlen = ZSTD_compress(data, file->nbytes - 1,
+									 file->buffer.data, file->nbytes,
+									 ZSTD_CLEVEL_DEFAULT);
+				if (!ZSTD_isError(zlen))
+					len = (int) zlen;
+			}
+#else
+			elog(ERROR, "zstd is not supported by this build");
+#endif
+			break;
+
+		case WAL_COMPRESSION_NONE:
+			Assert(false);		/* cannot happen */
+			break;
+			/* no default case, so that compiler will warn */
 	}
 
 	/*
-	 * Now we can set the buffer empty without changing the logical position
+	 * Store the data uncompressed if it didn't compress, or if the chunk
+	 * would become shorter than it was, which would leave garbage after the
+	 * end of the data.  The chunk holds at least as much data as before, so
+	 * it's long enough uncompressed.
 	 */
+	if (len < 0 || len >= file->nbytes ||
+		(off_t) (sizeof(BufFileChunkHeader) + len) < oldlen)
+	{
+		len = file->nbytes;
+		memcpy(data, file->buffer.data, len);
+	}
+	hdr->rawlen = file->nbytes;
+	hdr->len = len;
+
+	BufFileWriteRaw(file, &fileno, &offset, file->cbuffer,
+					sizeof(BufFileChunkHeader) + len);
+	file->dirty = false;
+
+	file->nextFile = file->endFile = fileno;
+	file->nextOffset = file->endOffset = offset;
+}
+
+/*
+ * BufFileSeekChunk
+ *
+ * Seek to a position of a compressed file obtained from BufFileTell().
+ *
+ * Result is 0 if OK, EOF if not.
+ */
+static int
+BufFileSeekChunk(BufFile *file, int fileno, off_t offset)
+{
+	off_t		chunkOffset = offset / BUFFILE_CHUNK_POS_FACTOR;
+	int			pos = (int) (offset % BUFFILE_CHUNK_POS_FACTOR);
+
+	if (fileno < 0 || fileno >= file->numFiles || offset < 0)
+		return EOF;
+
+	if (fileno == file->curFile && chunkOffset == file->curOffset &&
+		pos <= file->nbytes)
+	{
+		/* Seek is within the current chunk */
+		file->pos = pos;
+		return 0;
+	}
+
+	BufFileFlush(file);
+
+	file->curFile = fileno;
+	file->curOffset = chunkOffset;
 	file->pos = 0;
 	file->nbytes = 0;
+	BufFileLoadChunk(file);
+	if (pos > file->nbytes)
+		return EOF;
+	file->pos = pos;
+	return 0;
 }
 
 /*
@@ -600,7 +997,13 @@ BufFileReadCommon(BufFile *file, void *ptr, size_t size, bool exact, bool eofOK)
 		if (file->pos >= file->nbytes)
 		{
 			/* Try to load more data into buffer. */
-			file->curOffset += file->pos;
+			if (file->compression != WAL_COMPRESSION_NONE)
+			{
+				file->curFile = file->nextFile;
+				file->curOffset = file->nextOffset;
+			}
+			else
+				file->curOffset += file->pos;
 			file->pos = 0;
 			file->nbytes = 0;
 			BufFileLoadBuffer(file);
@@ -676,6 +1079,12 @@ BufFileWrite(BufFile *file, const void *ptr, size_t size)
 
 	Assert(!file->readOnly);
 
+	/* we can't rewrite chunks of compressed files in place */
+	if (file->compression != WAL_COMPRESSION_NONE &&
+		(file->nextFile != file->endFile ||
+		 file->nextOffset != file->endOffset))
+		elog(ERROR, "cannot overwrite data in compressed temporary file");
+
 	while (size > 0)
 	{
 		if (file->pos >= BLCKSZ)
@@ -683,7 +1092,15 @@ BufFileWrite(BufFile *file, const void *ptr, size_t size)
 			/* Buffer full, dump it out */
 			if (file->dirty)
 				BufFileDumpBuffer(file);
-			else
+			if (file->compression != WAL_COMPRESSION_NONE)
+			{
+				/* Start a new chunk */
+				file->curFile = file->nextFile;
+				file->curOffset = file->nextOffset;
+				file->pos = 0;
+				file->nbytes = 0;
+			}
+			else if (!file->dirty)
 			{
 				/* Hmm, went directly from reading to writing? */
 				file->curOffset += file->pos;
@@ -739,6 +1156,13 @@ BufFileSeek(BufFile *file, int fileno, off_t offset, int whence)
 	int			newFile;
 	off_t		newOffset;
 
+	if (file->compression != WAL_COMPRESSION_NONE)
+	{
+		if (whence != SEEK_SET)
+			elog(ERROR, "only absolute seeks are supported in compressed temporary files");
+		return BufFileSeekChunk(file, fileno, offset);
+	}
+
 	switch (whence)
 	{
 		case SEEK_SET:
@@ -830,7 +1254,10 @@ void
 BufFileTell(BufFile *file, int *fileno, off_t *offset)
 {
 	*fileno = file->curFile;
-	*offset = file->curOffset + file->pos;
+	if (file->compression != WAL_COMPRESSION_NONE)
+		*offset = file->curOffset * BUFFILE_CHUNK_POS_FACTOR + file->pos;
+	else
+		*offset = file->curOffset + file->pos;
 }
 
 /*
@@ -847,6 +1274,8 @@ BufFileTell(BufFile *file, int *fileno, off_t *offset)
 int
 BufFileSeekBlock(BufFile *file, long blknum)
 {
+	Assert(file->compression == WAL_COMPRESSION_NONE);
+
 	return BufFileSeek(file,
 					   (int) (blknum / BUFFILE_SEG_SIZE),
 					   (off_t) (blknum % BUFFILE_SEG_SIZE) * BLCKSZ,
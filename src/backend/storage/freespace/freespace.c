@@ -191,6 +191,50 @@ RecordPageWithFreeSpace(Relation rel, BlockNumber heapBlk, Size spaceAvail)
 	fsm_set_and_search(rel, addr, slot, new_cat, 0);
 }
 
+/*
+ * RecordPagesWithFreeSpace - like RecordPageWithFreeSpace, for a range of
+ *		heap blocks [startBlk, endBlk) that all have the same free space.
+ *
+ * Each FSM leaf page covering the range is locked and updated only once,
+ * which makes this much cheaper than individual calls when a relation has
+ * just been extended by many blocks.
+ */
+void
+RecordPagesWithFreeSpace(Relation rel, BlockNumber startBlk,
+						 BlockNumber endBlk, Size spaceAvail)
+{
+	int			new_cat = fsm_space_avail_to_cat(spaceAvail);
+	BlockNumber heapBlk = startBlk;
+
+	while (heapBlk < endBlk)
+	{
+		FSMAddress	addr;
+		uint16		slot;
+		Buffer		buf;
+		Page		page;
+		bool		changed = false;
+
+		addr = fsm_get_location(heapBlk, &slot);
+
+		buf = fsm_readbuf(rel, addr, true);
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buf);
+
+		/* consecutive heap blocks map to consecutive slots of a leaf page */
+		do
+		{
+			if (fsm_set_avail(page, slot, new_cat))
+				changed = true;
+			heapBlk++;
+			slot++;
+		} while (heapBlk < endBlk && slot < SlotsPerFSMPage);
+
+		if (changed)
+			MarkBufferDirtyHint(buf, false);
+		UnlockReleaseBuffer(buf);
+	}
+}
+
 /*
  * XLogRecordPageWithFreeSpace - like RecordPageWithFreeSpace, for use in
  *		WAL replay
@@ -608,7 +652,7 @@ static void
 fsm_extend(Relation rel, BlockNumber fsm_nblocks)
 {
 	BlockNumber fsm_nblocks_now;
-	PGAlignedBlock pg;
+	PGIOAlignedBlock pg;
 	SMgrRelation reln;
 
 	PageInit((Page) pg.data, BLCKSZ, 0);
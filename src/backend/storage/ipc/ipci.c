@@ -24,12 +24,16 @@
 #include "access/twophase.h"
 #include "access/xlogprefetcher.h"
 #include "access/xlogrecovery.h"
+#include "backup/basebackup_parallel.h"
 #include "commands/async.h"
+#include "commands/sequence.h"
+#include "executor/execSampling.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
+#include "postmaster/datachecksumsworker.h"
 #include "postmaster/postmaster.h"
 #include "replication/logicallauncher.h"
 #include "replication/origin.h"
@@ -46,8 +50,13 @@
 #include "storage/procarray.h"
 #include "storage/procsignal.h"
 #include "storage/sinvaladt.h"
+#include "storage/smgr.h"
 #include "storage/spin.h"
+#include "storage/standby.h"
 #include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 
 /* GUCs */
@@ -134,6 +143,7 @@ CalculateShmemSize(int *num_semaphores)
 	size = add_size(size, ReplicationSlotsShmemSize());
 	size = add_size(size, ReplicationOriginShmemSize());
 	size = add_size(size, WalSndShmemSize());
+	size = add_size(size, BaseBackupParallelShmemSize());
 	size = add_size(size, WalRcvShmemSize());
 	size = add_size(size, PgArchShmemSize());
 	size = add_size(size, ApplyLauncherShmemSize());
@@ -142,6 +152,15 @@ CalculateShmemSize(int *num_semaphores)
 	size = add_size(size, SyncScanShmemSize());
 	size = add_size(size, AsyncShmemSize());
 	size = add_size(size, StatsShmemSize());
+	size = add_size(size, SharedPlanCacheShmemSize());
+	size = add_size(size, SequenceShmemSize());
+	size = add_size(size, SharedCatCacheShmemSize());
+	size = add_size(size, MemoryAccountingShmemSize());
+	size = add_size(size, MemoryStatsShmemSize());
+	size = add_size(size, QuerySampleShmemSize());
+	size = add_size(size, DataChecksumsWorkerShmemSize());
+	size = add_size(size, SMgrShmemSize());
+	size = add_size(size, StandbyShmemSize());
 #ifdef EXEC_BACKEND
 	size = add_size(size, ShmemBackendArraySize());
 #endif
@@ -282,6 +301,7 @@ CreateSharedMemoryAndSemaphores(void)
 	ReplicationSlotsShmemInit();
 	ReplicationOriginShmemInit();
 	WalSndShmemInit();
+	BaseBackupParallelShmemInit();
 	WalRcvShmemInit();
 	PgArchShmemInit();
 	ApplyLauncherShmemInit();
@@ -294,6 +314,15 @@ CreateSharedMemoryAndSemaphores(void)
 	SyncScanShmemInit();
 	AsyncShmemInit();
 	StatsShmemInit();
+	SharedPlanCacheShmemInit();
+	SequenceShmemInit();
+	SharedCatCacheShmemInit();
+	MemoryAccountingShmemInit();
+	MemoryStatsShmemInit();
+	QuerySampleShmemInit();
+	DataChecksumsWorkerShmemInit();
+	SMgrShmemInit();
+	StandbyShmemInit();
 
 #ifdef EXEC_BACKEND
 
@@ -102,6 +102,24 @@ typedef struct ProcArrayStruct
 	int			pgprocnos[FLEXIBLE_ARRAY_MEMBER];
 } ProcArrayStruct;
 
+/*
+ * Snapshot contents shared between backends, if shared_snapshot_cache is
+ * enabled; see SharedSnapshotCacheLookup().  Protected by
+ * SharedSnapshotCacheLock.
+ */
+typedef struct SharedSnapshotCache
+{
+	uint64		xactCompletionCount;	/* contents are valid for this count,
+										 * or 0 if not valid */
+	TransactionId xmin;
+	int			xcnt;
+	int			subxcnt;
+	bool		suboverflowed;
+
+	/* xcnt running top-level XIDs, followed by subxcnt subtransaction XIDs */
+	TransactionId xids[FLEXIBLE_ARRAY_MEMBER];
+} SharedSnapshotCache;
+
 /*
  * State for the GlobalVisTest* family of functions. Those functions can
  * e.g. be used to decide if a deleted row can be removed without violating
@@ -271,6 +289,11 @@ typedef enum KAXCompressReason
 
 static ProcArrayStruct *procArray;
 
+static SharedSnapshotCache *snapshotCache = NULL;
+
+/* GUC parameter */
+bool		shared_snapshot_cache = false;
+
 static PGPROC *allProcs;
 
 /*
@@ -346,6 +369,16 @@ static void DisplayXidCache(void);
 #define xc_slow_answer_inc()		((void) 0)
 #endif							/* XIDCACHE_DEBUG */
 
+static Size SharedSnapshotCacheSize(void);
+static bool SharedSnapshotCacheLookup(Snapshot snapshot, TransactionId myxid,
+									  uint64 xactCompletionCount,
+									  TransactionId *xmin, int *count,
+									  int *subcount, bool *suboverflowed);
+static void SharedSnapshotCacheStore(Snapshot snapshot, TransactionId myxid,
+									 uint64 xactCompletionCount,
+									 TransactionId xmin, int count,
+									 int subcount, bool suboverflowed);
+
 /* Primitives for KnownAssignedXids array handling for standby */
 static void KnownAssignedXidsCompress(KAXCompressReason reason, bool haveLock);
 static void KnownAssignedXidsAdd(TransactionId from_xid, TransactionId to_xid,
@@ -411,6 +444,9 @@ ProcArrayShmemSize(void)
 						mul_size(sizeof(bool), TOTAL_MAX_CACHED_SUBXIDS));
 	}
 
+	if (shared_snapshot_cache)
+		size = add_size(size, SharedSnapshotCacheSize());
+
 	return size;
 }
 
@@ -463,6 +499,30 @@ CreateSharedProcArray(void)
 							mul_size(sizeof(bool), TOTAL_MAX_CACHED_SUBXIDS),
 							&found);
 	}
+
+	if (shared_snapshot_cache)
+	{
+		snapshotCache = (SharedSnapshotCache *)
+			ShmemInitStruct("Shared Snapshot Cache",
+							SharedSnapshotCacheSize(),
+							&found);
+		if (!found)
+			snapshotCache->xactCompletionCount = 0;
+	}
+}
+
+/*
+ * Size of the shared snapshot cache: room for the running top-level XIDs of
+ * every PGPROC, and for all their cached subtransaction XIDs.
+ */
+static Size
+SharedSnapshotCacheSize(void)
+{
+	return add_size(offsetof(SharedSnapshotCache, xids),
+					mul_size(sizeof(TransactionId),
+							 add_size(PROCARRAY_MAXPROCS,
+									  mul_size(PGPROC_MAX_CACHED_SUBXIDS,
+											   PROCARRAY_MAXPROCS))));
 }
 
 /*
@@ -2297,7 +2357,13 @@ GetSnapshotData(Snapshot snapshot)
 
 	snapshot->takenDuringRecovery = RecoveryInProgress();
 
-	if (!snapshot->takenDuringRecovery)
+	if (!snapshot->takenDuringRecovery &&
+		SharedSnapshotCacheLookup(snapshot, myxid, curXactCompletionCount,
+								  &xmin, &count, &subcount, &suboverflowed))
+	{
+		/* another backend has already collected the running XIDs for us */
+	}
+	else if (!snapshot->takenDuringRecovery)
 	{
 		int			numProcs = arrayP->numProcs;
 		TransactionId *xip = snapshot->xip;
@@ -2401,6 +2467,9 @@ GetSnapshotData(Snapshot snapshot)
 				}
 			}
 		}
+
+		SharedSnapshotCacheStore(snapshot, myxid, curXactCompletionCount,
+								 xmin, count, subcount, suboverflowed);
 	}
 	else
 	{
@@ -2563,6 +2632,96 @@ GetSnapshotData(Snapshot snapshot)
 	return snapshot;
 }
 
+/*
+ * SharedSnapshotCacheLookup -- get the running XIDs from the shared cache
+ *
+ * With many backends, most snapshots are taken while no transaction with an
+ * XID has finished since the last one, by any backend, was built.  Instead of
+ * walking the whole ProcArray again, a backend can then copy the result of
+ * that walk, if the backend that did it left it in the shared snapshot cache.
+ * As explained in GetSnapshotDataReuse(), the result cannot have changed as
+ * long as xactCompletionCount hasn't.
+ *
+ * The set of running XIDs in a snapshot doesn't include the taking backend's
+ * own XIDs, so only backends without an XID store their result in the cache
+ * or use it.  That is the usual case for the first snapshot of a transaction,
+ * and for read-only transactions.
+ *
+ * The caller must hold ProcArrayLock.  Returns true and fills in the xmin,
+ * count, subcount, suboverflowed and the XID arrays of 'snapshot' if there
+ * was a usable entry.
+ */
+static bool
+SharedSnapshotCacheLookup(Snapshot snapshot, TransactionId myxid,
+						  uint64 xactCompletionCount,
+						  TransactionId *xmin, int *count,
+						  int *subcount, bool *suboverflowed)
+{
+	bool		result = false;
+
+	Assert(LWLockHeldByMe(ProcArrayLock));
+
+	if (snapshotCache == NULL || TransactionIdIsValid(myxid))
+		return false;
+
+	/* unlocked check first, to avoid taking the lock for nothing */
+	if (snapshotCache->xactCompletionCount != xactCompletionCount)
+		return false;
+
+	LWLockAcquire(SharedSnapshotCacheLock, LW_SHARED);
+	if (snapshotCache->xactCompletionCount == xactCompletionCount)
+	{
+		*xmin = snapshotCache->xmin;
+		*count = snapshotCache->xcnt;
+		*subcount = snapshotCache->subxcnt;
+		*suboverflowed = snapshotCache->suboverflowed;
+		memcpy(snapshot->xip, snapshotCache->xids,
+			   *count * sizeof(TransactionId));
+		memcpy(snapshot->subxip, snapshotCache->xids + *count,
+			   *subcount * sizeof(TransactionId));
+		result = true;
+	}
+	LWLockRelease(SharedSnapshotCacheLock);
+
+	return result;
+}
+
+/*
+ * SharedSnapshotCacheStore -- put freshly collected running XIDs in the cache
+ *
+ * The caller must still hold the ProcArrayLock it held while collecting them.
+ * If another backend is busy with the cache, we don't wait for it.
+ */
+static void
+SharedSnapshotCacheStore(Snapshot snapshot, TransactionId myxid,
+						 uint64 xactCompletionCount,
+						 TransactionId xmin, int count,
+						 int subcount, bool suboverflowed)
+{
+	Assert(LWLockHeldByMe(ProcArrayLock));
+
+	if (snapshotCache == NULL || TransactionIdIsValid(myxid))
+		return;
+
+	if (snapshotCache->xactCompletionCount == xactCompletionCount)
+		return;
+
+	if (!LWLockConditionalAcquire(SharedSnapshotCacheLock, LW_EXCLUSIVE))
+		return;
+
+	snapshotCache->xmin = xmin;
+	snapshotCache->xcnt = count;
+	snapshotCache->subxcnt = subcount;
+	snapshotCache->suboverflowed = suboverflowed;
+	memcpy(snapshotCache->xids, snapshot->xip,
+		   count * sizeof(TransactionId));
+	memcpy(snapshotCache->xids + count, snapshot->subxip,
+		   subcount * sizeof(TransactionId));
+	snapshotCache->xactCompletionCount = xactCompletionCount;
+
+	LWLockRelease(SharedSnapshotCacheLock);
+}
+
 /*
  * ProcArrayInstallImportedXmin -- install imported xmin into MyProc->xmin
  *
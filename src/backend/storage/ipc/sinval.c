@@ -17,10 +17,12 @@
 #include "access/xact.h"
 #include "commands/async.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
 #include "storage/sinvaladt.h"
 #include "utils/inval.h"
+#include "utils/sharedcatcache.h"
 
 
 uint64		SharedInvalidMessageCounter;
@@ -40,6 +42,20 @@ uint64		SharedInvalidMessageCounter;
  */
 volatile sig_atomic_t catchupInterruptPending = false;
 
+/*
+ * Buffer of messages read from the queue, but not processed yet; see
+ * ReceiveSharedInvalidMessages.
+ */
+#define MAXINVALMSGS 32
+static SharedInvalidationMessage messages[MAXINVALMSGS];
+
+/*
+ * We use volatile here to prevent bugs if a compiler doesn't realize that
+ * recursion is a possibility ...
+ */
+static volatile int nextmsg = 0;
+static volatile int nummsgs = 0;
+
 
 /*
  * SendSharedInvalidMessages
@@ -48,7 +64,11 @@ volatile sig_atomic_t catchupInterruptPending = false;
 void
 SendSharedInvalidMessages(const SharedInvalidationMessage *msgs, int n)
 {
-	SIInsertDataEntries(msgs, n);
+	/* The shared catcache must be purged atomically with sending */
+	if (shared_catcache_size > 0)
+		SharedCatCacheSendInvalidMessages(msgs, n);
+	else
+		SIInsertDataEntries(msgs, n);
 }
 
 /*
@@ -71,16 +91,6 @@ void
 ReceiveSharedInvalidMessages(void (*invalFunction) (SharedInvalidationMessage *msg),
 							 void (*resetFunction) (void))
 {
-#define MAXINVALMSGS 32
-	static SharedInvalidationMessage messages[MAXINVALMSGS];
-
-	/*
-	 * We use volatile here to prevent bugs if a compiler doesn't realize that
-	 * recursion is a possibility ...
-	 */
-	static volatile int nextmsg = 0;
-	static volatile int nummsgs = 0;
-
 	/* Deal with any messages still pending from an outer recursion */
 	while (nextmsg < nummsgs)
 	{
@@ -104,6 +114,7 @@ ReceiveSharedInvalidMessages(void (*invalFunction) (SharedInvalidationMessage *m
 			/* got a reset message */
 			elog(DEBUG4, "cache state reset");
 			SharedInvalidMessageCounter++;
+			pgstat_count_cache_reset();
 			resetFunction();
 			break;				/* nothing more to do */
 		}
@@ -142,6 +153,23 @@ ReceiveSharedInvalidMessages(void (*invalFunction) (SharedInvalidationMessage *m
 	}
 }
 
+/*
+ * SharedInvalidationIsCaughtUp
+ *		Has this backend processed all messages queued so far?
+ *
+ * If so, the current end of the queue is returned in *msgnum.  Any later
+ * message will move the end of the queue.
+ */
+bool
+SharedInvalidationIsCaughtUp(int *msgnum)
+{
+	/* Messages already read from the queue might still be unprocessed */
+	if (nextmsg < nummsgs)
+		return false;
+
+	return SIIsCaughtUp(msgnum);
+}
+
 
 /*
  * HandleCatchupInterrupt
@@ -26,6 +26,7 @@
 #include "storage/shmem.h"
 #include "storage/sinvaladt.h"
 #include "storage/spin.h"
+#include "utils/guc_hooks.h"
 
 /*
  * Conceptually, the shared cache invalidation messages are stored in an
@@ -42,12 +43,12 @@
  * smallest nextMsgNum --- it may lag behind.  We only update it when
  * SICleanupQueue is called, and we try not to do that often.)
  *
- * In reality, the messages are stored in a circular buffer of MAXNUMMESSAGES
- * entries.  We translate MsgNum values into circular-buffer indexes by
- * computing MsgNum % MAXNUMMESSAGES (this should be fast as long as
- * MAXNUMMESSAGES is a constant and a power of 2).  As long as maxMsgNum
- * doesn't exceed minMsgNum by more than MAXNUMMESSAGES, we have enough space
- * in the buffer.  If the buffer does overflow, we recover by setting the
+ * In reality, the messages are stored in a circular buffer of
+ * sinval_queue_size entries.  We translate MsgNum values into circular-buffer
+ * indexes by computing MsgNum % sinval_queue_size (which is done with a mask,
+ * since sinval_queue_size must be a power of 2).  As long as maxMsgNum
+ * doesn't exceed minMsgNum by more than sinval_queue_size, we have enough
+ * space in the buffer.  If the buffer does overflow, we recover by setting the
  * "reset" flag for each backend that has fallen too far behind.  A backend
  * that is in "reset" state is ignored while determining minMsgNum.  When
  * it does finally attempt to receive inval messages, it must discard all
@@ -73,7 +74,7 @@
  * whenever minMsgNum exceeds MSGNUMWRAPAROUND, we subtract MSGNUMWRAPAROUND
  * from all the MsgNum variables simultaneously.  MSGNUMWRAPAROUND can be
  * large so that we don't need to do this often.  It must be a multiple of
- * MAXNUMMESSAGES so that the existing circular-buffer entries don't need
+ * sinval_queue_size so that the existing circular-buffer entries don't need
  * to be moved when we do it.
  *
  * Access to the shared sinval array is protected by two locks, SInvalReadLock
@@ -106,11 +107,12 @@
 /*
  * Configurable parameters.
  *
- * MAXNUMMESSAGES: max number of shared-inval messages we can buffer.
- * Must be a power of 2 for speed.
+ * sinval_queue_size (a GUC): max number of shared-inval messages we can
+ * buffer.  Must be a power of 2 for speed.
  *
  * MSGNUMWRAPAROUND: how often to reduce MsgNum variables to avoid overflow.
- * Must be a multiple of MAXNUMMESSAGES.  Should be large.
+ * Must be a multiple of sinval_queue_size, which is ensured by it being a
+ * power of 2 no larger than SINVAL_QUEUE_SIZE_MAX.  Should be large.
  *
  * CLEANUP_MIN: the minimum number of messages that must be in the buffer
  * before we bother to call SICleanupQueue.
@@ -127,13 +129,20 @@
  * per iteration.
  */
 
-#define MAXNUMMESSAGES 4096
-#define MSGNUMWRAPAROUND (MAXNUMMESSAGES * 262144)
-#define CLEANUP_MIN (MAXNUMMESSAGES / 2)
-#define CLEANUP_QUANTUM (MAXNUMMESSAGES / 16)
-#define SIG_THRESHOLD (MAXNUMMESSAGES / 2)
+int			sinval_queue_size = 4096;
+
+#define MSGNUMWRAPAROUND (1 << 30)
+#define CLEANUP_MIN (sinval_queue_size / 2)
+#define CLEANUP_QUANTUM (sinval_queue_size / 16)
+#define SIG_THRESHOLD (sinval_queue_size / 2)
 #define WRITE_QUANTUM 64
 
+StaticAssertDecl(MSGNUMWRAPAROUND % SINVAL_QUEUE_SIZE_MAX == 0,
+				 "MSGNUMWRAPAROUND must be a multiple of SINVAL_QUEUE_SIZE_MAX");
+
+/* circular-buffer index of a MsgNum */
+#define MSGNUM_INDEX(msgnum) ((msgnum) & (sinval_queue_size - 1))
+
 /* Per-backend state in shared invalidation structure */
 typedef struct ProcState
 {
@@ -177,11 +186,6 @@ typedef struct SISeg
 
 	slock_t		msgnumLock;		/* spinlock protecting maxMsgNum */
 
-	/*
-	 * Circular buffer holding shared-inval messages
-	 */
-	SharedInvalidationMessage buffer[MAXNUMMESSAGES];
-
 	/*
 	 * Per-backend invalidation state info (has MaxBackends entries).
 	 */
@@ -190,6 +194,9 @@ typedef struct SISeg
 
 static SISeg *shmInvalBuffer;	/* pointer to the shared inval buffer */
 
+/* circular buffer holding shared-inval messages, sinval_queue_size entries */
+static SharedInvalidationMessage *shmInvalMessages;
+
 
 static LocalTransactionId nextLocalTransactionId;
 
@@ -216,6 +223,9 @@ SInvalShmemSize(void)
 	 */
 	size = add_size(size, mul_size(sizeof(ProcState), MaxBackends));
 
+	size = add_size(size, mul_size(sizeof(SharedInvalidationMessage),
+								   sinval_queue_size));
+
 	return size;
 }
 
@@ -231,7 +241,15 @@ CreateSharedInvalidationState(void)
 
 	/* Allocate space in shared memory */
 	shmInvalBuffer = (SISeg *)
-		ShmemInitStruct("shmInvalBuffer", SInvalShmemSize(), &found);
+		ShmemInitStruct("shmInvalBuffer",
+						add_size(offsetof(SISeg, procState),
+								 mul_size(sizeof(ProcState), MaxBackends)),
+						&found);
+	shmInvalMessages = (SharedInvalidationMessage *)
+		ShmemInitStruct("shmInvalMessages",
+						mul_size(sizeof(SharedInvalidationMessage),
+								 sinval_queue_size),
+						&found);
 	if (found)
 		return;
 
@@ -243,7 +261,7 @@ CreateSharedInvalidationState(void)
 	shmInvalBuffer->maxBackends = MaxBackends;
 	SpinLockInit(&shmInvalBuffer->msgnumLock);
 
-	/* The buffer[] array is initially all unused, so we need not fill it */
+	/* The message buffer is initially all unused, so we need not fill it */
 
 	/* Mark all backends inactive, and initialize nextLXID */
 	for (i = 0; i < shmInvalBuffer->maxBackends; i++)
@@ -478,7 +496,7 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 		for (;;)
 		{
 			numMsgs = segP->maxMsgNum - segP->minMsgNum;
-			if (numMsgs + nthistime > MAXNUMMESSAGES ||
+			if (numMsgs + nthistime > sinval_queue_size ||
 				numMsgs >= segP->nextThreshold)
 				SICleanupQueue(true, nthistime);
 			else
@@ -491,7 +509,7 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 		max = segP->maxMsgNum;
 		while (nthistime-- > 0)
 		{
-			segP->buffer[max % MAXNUMMESSAGES] = *data++;
+			shmInvalMessages[MSGNUM_INDEX(max)] = *data++;
 			max++;
 		}
 
@@ -614,7 +632,7 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 	n = 0;
 	while (n < datasize && stateP->nextMsgNum < max)
 	{
-		data[n++] = segP->buffer[stateP->nextMsgNum % MAXNUMMESSAGES];
+		data[n++] = shmInvalMessages[MSGNUM_INDEX(stateP->nextMsgNum)];
 		stateP->nextMsgNum++;
 	}
 
@@ -634,6 +652,47 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 	return n;
 }
 
+/*
+ * SIIsCaughtUp
+ *		Has this backend read all messages in the queue?
+ *
+ * The current maxMsgNum is returned in *maxMsgNum either way.
+ */
+bool
+SIIsCaughtUp(int *maxMsgNum)
+{
+	SISeg	   *segP = shmInvalBuffer;
+	ProcState  *stateP = &segP->procState[MyBackendId - 1];
+	bool		result;
+
+	/* prevent SICleanupQueue from adjusting the message numbers under us */
+	LWLockAcquire(SInvalReadLock, LW_SHARED);
+
+	*maxMsgNum = SIGetMaxMsgNum();
+	result = !stateP->resetState && stateP->nextMsgNum == *maxMsgNum;
+
+	LWLockRelease(SInvalReadLock);
+
+	return result;
+}
+
+/*
+ * SIGetMaxMsgNum
+ *		Get the number of the next message to be added to the queue.
+ */
+int
+SIGetMaxMsgNum(void)
+{
+	SISeg	   *segP = shmInvalBuffer;
+	int			max;
+
+	SpinLockAcquire(&segP->msgnumLock);
+	max = segP->maxMsgNum;
+	SpinLockRelease(&segP->msgnumLock);
+
+	return max;
+}
+
 /*
  * SICleanupQueue
  *		Remove messages that have been consumed by all active backends
@@ -675,7 +734,7 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 	 */
 	min = segP->maxMsgNum;
 	minsig = min - SIG_THRESHOLD;
-	lowbound = min - MAXNUMMESSAGES + minFree;
+	lowbound = min - sinval_queue_size + minFree;
 
 	for (i = 0; i < segP->lastBackend; i++)
 	{
@@ -789,3 +848,17 @@ GetNextLocalTransactionId(void)
 
 	return result;
 }
+
+/*
+ * GUC check_hook for sinval_queue_size
+ */
+bool
+check_sinval_queue_size(int *newval, void **extra, GucSource source)
+{
+	if ((*newval & (*newval - 1)) != 0)
+	{
+		GUC_check_errdetail("\"sinval_queue_size\" must be a power of two.");
+		return false;
+	}
+	return true;
+}
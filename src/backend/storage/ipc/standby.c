@@ -28,7 +28,9 @@
 #include "storage/lmgr.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
+#include "storage/shmem.h"
 #include "storage/sinvaladt.h"
+#include "storage/spin.h"
 #include "storage/standby.h"
 #include "utils/hsearch.h"
 #include "utils/memutils.h"
@@ -40,6 +42,7 @@
 int			vacuum_defer_cleanup_age;
 int			max_standby_archive_delay = 30 * 1000;
 int			max_standby_streaming_delay = 30 * 1000;
+int			max_standby_deferred_conflicts = 0;
 bool		log_recovery_conflict_waits = false;
 
 /*
@@ -66,6 +69,45 @@ typedef struct RecoveryLockXidEntry
 static HTAB *RecoveryLockHash = NULL;
 static HTAB *RecoveryLockXidHash = NULL;
 
+/*
+ * Snapshot conflicts that replay has not waited for.  Rather than cancelling
+ * a query whose snapshot might still see tuples removed by pruning, replay
+ * can record the conflict in the query's backend and carry on.  The backend
+ * checks its pending conflicts whenever it reads a buffer, and errors out
+ * only if it goes back to a relation that was pruned underneath its snapshot;
+ * entries are discarded once the backend's xmin has moved past their horizon.
+ *
+ * There is one slot per backend, indexed by pgprocno, each holding up to
+ * max_standby_deferred_conflicts entries.  Entries are added by the startup
+ * process and removed by the owning backend, both while holding the slot's
+ * spinlock; nconflicts can be read without the lock to test for an empty
+ * slot.
+ */
+typedef struct DeferredSnapshotConflict
+{
+	RelFileLocator locator;		/* relation that was pruned */
+	TransactionId snapshotConflictHorizon;
+} DeferredSnapshotConflict;
+
+typedef struct DeferredConflictSlot
+{
+	slock_t		mutex;
+	pg_atomic_uint32 nconflicts;
+	DeferredSnapshotConflict conflicts[FLEXIBLE_ARRAY_MEMBER];
+} DeferredConflictSlot;
+
+static char *DeferredConflictSlots = NULL;
+static DeferredConflictSlot *MyDeferredConflictSlot = NULL;
+pg_atomic_uint32 *MyDeferredConflictCount = NULL;
+
+#define DeferredConflictSlotSize() \
+	MAXALIGN(offsetof(DeferredConflictSlot, conflicts) + \
+			 mul_size(max_standby_deferred_conflicts, \
+					  sizeof(DeferredSnapshotConflict)))
+#define GetDeferredConflictSlot(pgprocno) \
+	((DeferredConflictSlot *) (DeferredConflictSlots + \
+							   (pgprocno) * DeferredConflictSlotSize()))
+
 /* Flags set by timeout handlers */
 static volatile sig_atomic_t got_standby_deadlock_timeout = false;
 static volatile sig_atomic_t got_standby_delay_timeout = false;
@@ -76,6 +118,9 @@ static void ResolveRecoveryConflictWithVirtualXIDs(VirtualTransactionId *waitlis
 												   uint32 wait_event_info,
 												   bool report_waiting);
 static void SendRecoveryConflictWithBufferPin(ProcSignalReason reason);
+static bool DeferRecoveryConflictWithSnapshot(VirtualTransactionId vxid,
+											  TransactionId snapshotConflictHorizon,
+											  RelFileLocator locator);
 static XLogRecPtr LogCurrentRunningXacts(RunningTransactions CurrRunningXacts);
 static void LogAccessExclusiveLocks(int nlocks, xl_standby_lock *locks);
 static const char *get_recovery_conflict_desc(ProcSignalReason reason);
@@ -521,6 +566,228 @@ ResolveRecoveryConflictWithSnapshotFullXid(FullTransactionId snapshotConflictHor
 	}
 }
 
+/*
+ * Like ResolveRecoveryConflictWithSnapshot, but conflicting queries are not
+ * cancelled up front if max_standby_deferred_conflicts allows the conflict to
+ * be recorded in their backends instead; those backends will cancel their
+ * own queries if they read the relation again while their snapshot is still
+ * too old.  See CheckDeferredSnapshotConflicts.
+ *
+ * This is only safe for records whose redo takes a cleanup lock on every page
+ * it removes tuples from: a backend that already has such a page pinned holds
+ * up replay as usual, and any other backend has to go through ReadBuffer to
+ * look at the page, and will notice the conflict there.
+ */
+void
+ResolveRecoveryConflictWithSnapshotDeferred(TransactionId snapshotConflictHorizon,
+											RelFileLocator locator)
+{
+	VirtualTransactionId *backends;
+	int			nbackends = 0;
+	int			i;
+
+	if (max_standby_deferred_conflicts == 0)
+	{
+		ResolveRecoveryConflictWithSnapshot(snapshotConflictHorizon, locator);
+		return;
+	}
+
+	/* See ResolveRecoveryConflictWithSnapshot */
+	if (!TransactionIdIsValid(snapshotConflictHorizon))
+		return;
+
+	Assert(TransactionIdIsNormal(snapshotConflictHorizon));
+	backends = GetConflictingVirtualXIDs(snapshotConflictHorizon,
+										 locator.dbOid);
+
+	/* Keep only the backends we could not defer the conflict for */
+	for (i = 0; VirtualTransactionIdIsValid(backends[i]); i++)
+	{
+		if (!DeferRecoveryConflictWithSnapshot(backends[i],
+											   snapshotConflictHorizon,
+											   locator))
+			backends[nbackends++] = backends[i];
+	}
+	backends[nbackends].backendId = InvalidBackendId;
+	backends[nbackends].localTransactionId = InvalidLocalTransactionId;
+
+	ResolveRecoveryConflictWithVirtualXIDs(backends,
+										   PROCSIG_RECOVERY_CONFLICT_SNAPSHOT,
+										   WAIT_EVENT_RECOVERY_CONFLICT_SNAPSHOT,
+										   true);
+}
+
+/*
+ * Record a snapshot conflict in the slot of the backend running vxid.
+ * Returns false if the backend has no room for another one.
+ */
+static bool
+DeferRecoveryConflictWithSnapshot(VirtualTransactionId vxid,
+								  TransactionId snapshotConflictHorizon,
+								  RelFileLocator locator)
+{
+	PGPROC	   *proc;
+	DeferredConflictSlot *slot;
+	uint32		n;
+	uint32		i;
+	bool		deferred = false;
+
+	proc = BackendIdGetProc(vxid.backendId);
+	if (proc == NULL || proc->pgprocno >= MaxBackends)
+		return false;
+
+	/*
+	 * The backend might have moved on to another transaction by now, in
+	 * which case we may cancel its query needlessly later, but never miss
+	 * one that needs cancelling.
+	 */
+	slot = GetDeferredConflictSlot(proc->pgprocno);
+	SpinLockAcquire(&slot->mutex);
+	n = pg_atomic_read_u32(&slot->nconflicts);
+	for (i = 0; i < n; i++)
+	{
+		DeferredSnapshotConflict *conflict = &slot->conflicts[i];
+
+		if (RelFileLocatorEquals(conflict->locator, locator))
+		{
+			if (TransactionIdFollows(snapshotConflictHorizon,
+									 conflict->snapshotConflictHorizon))
+				conflict->snapshotConflictHorizon = snapshotConflictHorizon;
+			deferred = true;
+			break;
+		}
+	}
+	if (!deferred && n < max_standby_deferred_conflicts)
+	{
+		slot->conflicts[n].locator = locator;
+		slot->conflicts[n].snapshotConflictHorizon = snapshotConflictHorizon;
+		pg_atomic_write_u32(&slot->nconflicts, n + 1);
+		deferred = true;
+	}
+	SpinLockRelease(&slot->mutex);
+
+	return deferred;
+}
+
+/*
+ * Check this backend's deferred snapshot conflicts, after pinning a buffer of
+ * the given relation.  Conflicts that our snapshots no longer care about are
+ * discarded; if one is left for this relation, cancel the query.
+ *
+ * Callers test MyDeferredConflictCount first, without any lock.  Replay posts
+ * the conflict before trying to get its cleanup lock, and we pinned the
+ * buffer before reading the count, so either replay waits for our pin to go
+ * away or we see the conflict.  Both sides pass through atomic operations
+ * between the two steps, which act as full memory barriers.
+ */
+void
+CheckDeferredSnapshotConflicts(RelFileLocator locator)
+{
+	DeferredConflictSlot *slot = MyDeferredConflictSlot;
+	TransactionId xmin = MyProc->xmin;
+	bool		conflict = false;
+	int			nresolved = 0;
+	uint32		n;
+	uint32		i;
+	uint32		j = 0;
+
+	SpinLockAcquire(&slot->mutex);
+	n = pg_atomic_read_u32(&slot->nconflicts);
+	for (i = 0; i < n; i++)
+	{
+		DeferredSnapshotConflict *entry = &slot->conflicts[i];
+
+		/* Same test as GetConflictingVirtualXIDs uses */
+		if (!TransactionIdIsValid(xmin) ||
+			TransactionIdFollows(xmin, entry->snapshotConflictHorizon))
+		{
+			nresolved++;
+			continue;
+		}
+
+		/*
+		 * Keep even the conflicting entry, so that we keep failing if the
+		 * error is caught by a subtransaction that goes on using the same
+		 * snapshot.
+		 */
+		if (RelFileLocatorEquals(entry->locator, locator))
+			conflict = true;
+		slot->conflicts[j++] = *entry;
+	}
+	pg_atomic_write_u32(&slot->nconflicts, j);
+	SpinLockRelease(&slot->mutex);
+
+	if (nresolved > 0)
+		pgstat_report_recovery_conflict_deferred(nresolved);
+
+	if (conflict)
+	{
+		pgstat_report_recovery_conflict(PROCSIG_RECOVERY_CONFLICT_SNAPSHOT);
+		ereport(ERROR,
+				(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+				 errmsg("canceling statement due to conflict with recovery"),
+				 errdetail("User query might have needed to see row versions that have been removed.")));
+	}
+}
+
+/*
+ * Set up this backend's deferred conflict slot.  Called from InitProcess.
+ */
+void
+InitDeferredSnapshotConflicts(void)
+{
+	DeferredConflictSlot *slot;
+
+	if (max_standby_deferred_conflicts == 0 || MyProc->pgprocno >= MaxBackends)
+		return;
+
+	slot = GetDeferredConflictSlot(MyProc->pgprocno);
+	SpinLockAcquire(&slot->mutex);
+	pg_atomic_write_u32(&slot->nconflicts, 0);
+	SpinLockRelease(&slot->mutex);
+
+	MyDeferredConflictSlot = slot;
+	MyDeferredConflictCount = &slot->nconflicts;
+}
+
+/*
+ * Report shared-memory space needed by StandbyShmemInit
+ */
+Size
+StandbyShmemSize(void)
+{
+	if (max_standby_deferred_conflicts == 0)
+		return 0;
+
+	return mul_size(MaxBackends, DeferredConflictSlotSize());
+}
+
+/*
+ * Allocate and initialize the deferred snapshot conflict slots
+ */
+void
+StandbyShmemInit(void)
+{
+	bool		found;
+	int			i;
+
+	if (max_standby_deferred_conflicts == 0)
+		return;
+
+	DeferredConflictSlots = ShmemInitStruct("Deferred Snapshot Conflicts",
+											StandbyShmemSize(), &found);
+	if (!found)
+	{
+		for (i = 0; i < MaxBackends; i++)
+		{
+			DeferredConflictSlot *slot = GetDeferredConflictSlot(i);
+
+			SpinLockInit(&slot->mutex);
+			pg_atomic_init_u32(&slot->nconflicts, 0);
+		}
+	}
+}
+
 void
 ResolveRecoveryConflictWithTablespace(Oid tsid)
 {
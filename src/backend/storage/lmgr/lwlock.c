@@ -190,6 +190,18 @@ static const char *const BuiltinTrancheNames[] = {
 	"LogicalRepLauncherDSA",
 	/* LWTRANCHE_LAUNCHER_HASH: */
 	"LogicalRepLauncherHash",
+	/* LWTRANCHE_SHARED_PLAN_CACHE_DSA: */
+	"SharedPlanCacheDSA",
+	/* LWTRANCHE_SHARED_CATCACHE_DSA: */
+	"SharedCatCacheDSA",
+	/* LWTRANCHE_PARALLEL_VACUUM_DSA: */
+	"ParallelVacuumDSA",
+	/* LWTRANCHE_MEMORY_STATS: */
+	"MemoryStats",
+	/* LWTRANCHE_MEMORY_STATS_DSA: */
+	"MemoryStatsDSA",
+	/* LWTRANCHE_SHARED_MEMOIZE: */
+	"SharedMemoize",
 };
 
 StaticAssertDecl(lengthof(BuiltinTrancheNames) ==
@@ -251,8 +263,9 @@ int			NamedLWLockTrancheRequests = 0;
 NamedLWLockTranche *NamedLWLockTrancheArray = NULL;
 
 static void InitializeLWLocks(void);
-static inline void LWLockReportWaitStart(LWLock *lock);
-static inline void LWLockReportWaitEnd(void);
+static inline void LWLockReportWaitStart(LWLock *lock, instr_time *wait_start);
+static inline void LWLockReportWaitEnd(LWLock *lock, instr_time *wait_start);
+static bool LWLockSpin(LWLock *lock, LWLockMode mode);
 static const char *GetLWTrancheName(uint16 trancheId);
 
 #define T_NAME(lock) \
@@ -742,20 +755,29 @@ LWLockInitialize(LWLock *lock, int tranche_id)
  *
  * This function will be used by all the light-weight lock calls which
  * needs to wait to acquire the lock.  This function distinguishes wait
- * event based on tranche and lock id.
+ * event based on tranche and lock id.  The start time of the wait is stored
+ * in *wait_start, for LWLockReportWaitEnd.
  */
 static inline void
-LWLockReportWaitStart(LWLock *lock)
+LWLockReportWaitStart(LWLock *lock, instr_time *wait_start)
 {
 	pgstat_report_wait_start(PG_WAIT_LWLOCK | lock->tranche);
+	INSTR_TIME_SET_CURRENT(*wait_start);
 }
 
 /*
- * Report end of wait event for light-weight locks.
+ * Report end of wait event for light-weight locks, and count the wait in
+ * the cumulative statistics.
  */
 static inline void
-LWLockReportWaitEnd(void)
+LWLockReportWaitEnd(LWLock *lock, instr_time *wait_start)
 {
+	instr_time	wait_time;
+
+	INSTR_TIME_SET_CURRENT(wait_time);
+	INSTR_TIME_SUBTRACT(wait_time, *wait_start);
+	pgstat_count_lwlock_wait(lock->tranche, wait_time);
+
 	pgstat_report_wait_end();
 }
 
@@ -870,6 +892,60 @@ LWLockAttemptLock(LWLock *lock, LWLockMode mode)
 	pg_unreachable();
 }
 
+/*
+ * LWLockSpin - spin for a while, waiting for a contended lock to be released
+ *
+ * Most LWLocks are held for only a few instructions at a time, so a process
+ * finding one taken is often better off waiting a little for its release
+ * than queueing and sleeping on its semaphore, which costs a pair of context
+ * switches.  How long is worthwhile depends on how long the lock tends to be
+ * held, so each process tracks the number of spins separately for each
+ * tranche, adapting it like s_lock.c adapts spins_per_delay: it's increased
+ * rapidly when spinning got us the lock, and decreased when it didn't.  On a
+ * single-CPU machine, spinning never helps, so it quickly drops to the
+ * minimum.
+ *
+ * Returns true if we acquired the lock.
+ */
+#define MIN_LWLOCK_SPINS		10
+#define MAX_LWLOCK_SPINS		1000
+#define DEFAULT_LWLOCK_SPINS	100
+
+static uint16 lwlock_spins[LWTRANCHE_FIRST_USER_DEFINED + 1];
+
+static bool
+LWLockSpin(LWLock *lock, LWLockMode mode)
+{
+	int			idx = Min(lock->tranche, LWTRANCHE_FIRST_USER_DEFINED);
+	int			spins = lwlock_spins[idx];
+	uint32		mask;
+
+	if (spins == 0)
+		spins = DEFAULT_LWLOCK_SPINS;
+
+	/* the lock bits that keep us from acquiring it in this mode */
+	mask = (mode == LW_EXCLUSIVE) ? LW_LOCK_MASK : LW_VAL_EXCLUSIVE;
+
+	for (int i = 0; i < spins; i++)
+	{
+		pg_spin_delay();
+
+		/*
+		 * Only try to grab the lock once it looks free, so that we don't
+		 * keep stealing the cache line from the current holder.
+		 */
+		if ((pg_atomic_read_u32(&lock->state) & mask) == 0 &&
+			!LWLockAttemptLock(lock, mode))
+		{
+			lwlock_spins[idx] = Min(spins + 100, MAX_LWLOCK_SPINS);
+			return true;
+		}
+	}
+
+	lwlock_spins[idx] = Max(spins - Max(spins / 8, 1), MIN_LWLOCK_SPINS);
+	return false;
+}
+
 /*
  * Lock the LWLock's wait list against concurrent activity.
  *
@@ -1196,7 +1272,9 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 {
 	PGPROC	   *proc = MyProc;
 	bool		result = true;
+	bool		contended = false;
 	int			extraWaits = 0;
+	instr_time	wait_start;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
 
@@ -1265,6 +1343,19 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 			break;				/* got the lock */
 		}
 
+		contended = true;
+
+		/*
+		 * The lock is often released again very soon, so spin for a while
+		 * before resorting to the much more expensive queueing and sleeping.
+		 */
+		if (LWLockSpin(lock, mode))
+		{
+			LOG_LWDEBUG("LWLockAcquire", lock, "acquired after spinning");
+			pgstat_count_lwlock_spin_acquire(lock->tranche);
+			break;
+		}
+
 		/*
 		 * Ok, at this point we couldn't grab the lock on the first try. We
 		 * cannot simply queue ourselves to the end of the list and wait to be
@@ -1305,7 +1396,7 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 		lwstats->block_count++;
 #endif
 
-		LWLockReportWaitStart(lock);
+		LWLockReportWaitStart(lock, &wait_start);
 		if (TRACE_POSTGRESQL_LWLOCK_WAIT_START_ENABLED())
 			TRACE_POSTGRESQL_LWLOCK_WAIT_START(T_NAME(lock), mode);
 
@@ -1331,7 +1422,7 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 
 		if (TRACE_POSTGRESQL_LWLOCK_WAIT_DONE_ENABLED())
 			TRACE_POSTGRESQL_LWLOCK_WAIT_DONE(T_NAME(lock), mode);
-		LWLockReportWaitEnd();
+		LWLockReportWaitEnd(lock, &wait_start);
 
 		LOG_LWDEBUG("LWLockAcquire", lock, "awakened");
 
@@ -1342,6 +1433,8 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 	if (TRACE_POSTGRESQL_LWLOCK_ACQUIRE_ENABLED())
 		TRACE_POSTGRESQL_LWLOCK_ACQUIRE(T_NAME(lock), mode);
 
+	pgstat_count_lwlock_acquire(lock->tranche, contended);
+
 	/* Add lock to list of locks held by this backend */
 	held_lwlocks[num_held_lwlocks].lock = lock;
 	held_lwlocks[num_held_lwlocks++].mode = mode;
@@ -1399,6 +1492,7 @@ LWLockConditionalAcquire(LWLock *lock, LWLockMode mode)
 		/* Add lock to list of locks held by this backend */
 		held_lwlocks[num_held_lwlocks].lock = lock;
 		held_lwlocks[num_held_lwlocks++].mode = mode;
+		pgstat_count_lwlock_acquire(lock->tranche, false);
 		if (TRACE_POSTGRESQL_LWLOCK_CONDACQUIRE_ENABLED())
 			TRACE_POSTGRESQL_LWLOCK_CONDACQUIRE(T_NAME(lock), mode);
 	}
@@ -1424,7 +1518,9 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 {
 	PGPROC	   *proc = MyProc;
 	bool		mustwait;
+	bool		contended;
 	int			extraWaits = 0;
+	instr_time	wait_start;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
 
@@ -1451,6 +1547,7 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 	 * protocol as LWLockAcquire(). Check its comments for details.
 	 */
 	mustwait = LWLockAttemptLock(lock, mode);
+	contended = mustwait;
 
 	if (mustwait)
 	{
@@ -1470,7 +1567,7 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 			lwstats->block_count++;
 #endif
 
-			LWLockReportWaitStart(lock);
+			LWLockReportWaitStart(lock, &wait_start);
 			if (TRACE_POSTGRESQL_LWLOCK_WAIT_START_ENABLED())
 				TRACE_POSTGRESQL_LWLOCK_WAIT_START(T_NAME(lock), mode);
 
@@ -1492,7 +1589,7 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 #endif
 			if (TRACE_POSTGRESQL_LWLOCK_WAIT_DONE_ENABLED())
 				TRACE_POSTGRESQL_LWLOCK_WAIT_DONE(T_NAME(lock), mode);
-			LWLockReportWaitEnd();
+			LWLockReportWaitEnd(lock, &wait_start);
 
 			LOG_LWDEBUG("LWLockAcquireOrWait", lock, "awakened");
 		}
@@ -1530,6 +1627,7 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 		/* Add lock to list of locks held by this backend */
 		held_lwlocks[num_held_lwlocks].lock = lock;
 		held_lwlocks[num_held_lwlocks++].mode = mode;
+		pgstat_count_lwlock_acquire(lock->tranche, contended);
 		if (TRACE_POSTGRESQL_LWLOCK_ACQUIRE_OR_WAIT_ENABLED())
 			TRACE_POSTGRESQL_LWLOCK_ACQUIRE_OR_WAIT(T_NAME(lock), mode);
 	}
@@ -1611,6 +1709,7 @@ LWLockWaitForVar(LWLock *lock, uint64 *valptr, uint64 oldval, uint64 *newval)
 {
 	PGPROC	   *proc = MyProc;
 	int			extraWaits = 0;
+	instr_time	wait_start;
 	bool		result = false;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
@@ -1686,7 +1785,7 @@ LWLockWaitForVar(LWLock *lock, uint64 *valptr, uint64 oldval, uint64 *newval)
 		lwstats->block_count++;
 #endif
 
-		LWLockReportWaitStart(lock);
+		LWLockReportWaitStart(lock, &wait_start);
 		if (TRACE_POSTGRESQL_LWLOCK_WAIT_START_ENABLED())
 			TRACE_POSTGRESQL_LWLOCK_WAIT_START(T_NAME(lock), LW_EXCLUSIVE);
 
@@ -1709,7 +1808,7 @@ LWLockWaitForVar(LWLock *lock, uint64 *valptr, uint64 oldval, uint64 *newval)
 
 		if (TRACE_POSTGRESQL_LWLOCK_WAIT_DONE_ENABLED())
 			TRACE_POSTGRESQL_LWLOCK_WAIT_DONE(T_NAME(lock), LW_EXCLUSIVE);
-		LWLockReportWaitEnd();
+		LWLockReportWaitEnd(lock, &wait_start);
 
 		LOG_LWDEBUG("LWLockWaitForVar", lock, "awakened");
 
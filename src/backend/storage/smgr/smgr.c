@@ -17,11 +17,14 @@
  */
 #include "postgres.h"
 
+#include "access/xlog.h"
 #include "access/xlogutils.h"
 #include "lib/ilist.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
+#include "storage/lwlock.h"
 #include "storage/md.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
 #include "utils/hsearch.h"
 #include "utils/inval.h"
@@ -50,12 +53,17 @@ typedef struct f_smgr
 								bool isRedo);
 	void		(*smgr_extend) (SMgrRelation reln, ForkNumber forknum,
 								BlockNumber blocknum, const void *buffer, bool skipFsync);
+	void		(*smgr_zeroextend) (SMgrRelation reln, ForkNumber forknum,
+									BlockNumber blocknum, int nblocks, bool skipFsync);
 	bool		(*smgr_prefetch) (SMgrRelation reln, ForkNumber forknum,
 								  BlockNumber blocknum);
 	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
 							  BlockNumber blocknum, void *buffer);
 	void		(*smgr_write) (SMgrRelation reln, ForkNumber forknum,
 							   BlockNumber blocknum, const void *buffer, bool skipFsync);
+	void		(*smgr_writev) (SMgrRelation reln, ForkNumber forknum,
+								BlockNumber blocknum, const void **buffers,
+								BlockNumber nblocks, bool skipFsync);
 	void		(*smgr_writeback) (SMgrRelation reln, ForkNumber forknum,
 								   BlockNumber blocknum, BlockNumber nblocks);
 	BlockNumber (*smgr_nblocks) (SMgrRelation reln, ForkNumber forknum);
@@ -75,9 +83,11 @@ static const f_smgr smgrsw[] = {
 		.smgr_exists = mdexists,
 		.smgr_unlink = mdunlink,
 		.smgr_extend = mdextend,
+		.smgr_zeroextend = mdzeroextend,
 		.smgr_prefetch = mdprefetch,
 		.smgr_read = mdread,
 		.smgr_write = mdwrite,
+		.smgr_writev = mdwritev,
 		.smgr_writeback = mdwriteback,
 		.smgr_nblocks = mdnblocks,
 		.smgr_truncate = mdtruncate,
@@ -95,8 +105,60 @@ static HTAB *SMgrRelationHash = NULL;
 
 static dlist_head unowned_relns;
 
+/*
+ * Shared relation size cache.
+ *
+ * Outside recovery, the local smgr_cached_nblocks values can't be trusted,
+ * since other backends may extend the relation at any time.  Instead, we
+ * keep the sizes of recently used relations in a shared hash table, which is
+ * updated whenever a fork is extended, truncated or dropped, so that
+ * smgrnblocks() usually doesn't need to ask the kernel.
+ *
+ * Extension of a fork is serialized by the relation extension lock or by
+ * the extending backend having exclusive use of the relation, and truncation
+ * requires AccessExclusiveLock, so only the cache needs protecting against
+ * concurrent readers.  Each change bumps the entry's generation, and marks
+ * the fork's size unknown until the change is complete.  A backend that
+ * misses in the cache asks the kernel without holding the lock, and only
+ * stores the answer if the generation hasn't moved in the meantime; that
+ * way a size that was out of date by the time we got it is never stored.
+ *
+ * The cache is not used during recovery, nor for temporary relations.
+ * When it's full, relations that aren't in it are simply not cached.
+ */
+typedef struct SMgrSharedRelation
+{
+	RelFileLocator rlocator;	/* hash key */
+	uint64		generation;		/* changes whenever a size changes */
+	BlockNumber nblocks[MAX_FORKNUM + 1];	/* sizes, or InvalidBlockNumber */
+} SMgrSharedRelation;
+
+typedef struct SMgrSharedRelationControl
+{
+	uint64		next_generation;	/* first generation of next entry */
+} SMgrSharedRelationControl;
+
+/* GUC variable */
+int			smgr_shared_relations = 4096;
+
+static HTAB *SMgrSharedRelationHash = NULL;
+static SMgrSharedRelationControl *SMgrSharedRelationCtl = NULL;
+
 /* local function prototypes */
 static void smgrshutdown(int code, Datum arg);
+static bool smgr_use_shared_size(SMgrRelation reln);
+static BlockNumber smgr_shared_size_lookup(SMgrRelation reln,
+										   ForkNumber forknum,
+										   uint64 *generation);
+static void smgr_shared_size_store(SMgrRelation reln, ForkNumber forknum,
+								   uint64 generation, BlockNumber nblocks);
+static BlockNumber smgr_shared_size_begin_change(SMgrRelation reln,
+												 ForkNumber forknum);
+static void smgr_shared_size_end_change(SMgrRelation reln, ForkNumber forknum,
+										BlockNumber oldnblocks,
+										BlockNumber newnblocks,
+										bool extension);
+static void smgr_shared_size_forget(RelFileLocator rlocator);
 
 
 /*
@@ -122,6 +184,53 @@ smgrinit(void)
 	on_proc_exit(smgrshutdown, 0);
 }
 
+/*
+ * Report shared-memory space needed by SMgrShmemInit
+ */
+Size
+SMgrShmemSize(void)
+{
+	Size		size = 0;
+
+	if (smgr_shared_relations <= 0)
+		return 0;
+
+	size = add_size(size, MAXALIGN(sizeof(SMgrSharedRelationControl)));
+	size = add_size(size, hash_estimate_size(smgr_shared_relations,
+											 sizeof(SMgrSharedRelation)));
+
+	return size;
+}
+
+/*
+ * Initialize the shared relation size cache during startup
+ */
+void
+SMgrShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+
+	if (smgr_shared_relations <= 0)
+		return;
+
+	SMgrSharedRelationCtl = (SMgrSharedRelationControl *)
+		ShmemInitStruct("Shared Relation Size Control",
+						sizeof(SMgrSharedRelationControl),
+						&found);
+	/* generation 0 is reserved to mean "no entry" */
+	if (!found)
+		SMgrSharedRelationCtl->next_generation = 1;
+
+	info.keysize = sizeof(RelFileLocator);
+	info.entrysize = sizeof(SMgrSharedRelation);
+	SMgrSharedRelationHash = ShmemInitHash("Shared Relation Size Hash",
+										   smgr_shared_relations,
+										   smgr_shared_relations,
+										   &info,
+										   HASH_ELEM | HASH_BLOBS);
+}
+
 /*
  * on_proc_exit hook for smgr cleanup during backend shutdown
  */
@@ -474,6 +583,13 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 
 		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
 			smgrsw[which].smgr_unlink(rlocators[i], forknum, isRedo);
+
+		/*
+		 * Only now forget the cached sizes, so that nobody can have put them
+		 * back while the files still existed.
+		 */
+		if (smgr_use_shared_size(rels[i]))
+			smgr_shared_size_forget(rlocators[i].locator);
 	}
 
 	pfree(rlocators);
@@ -493,9 +609,19 @@ void
 smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		   const void *buffer, bool skipFsync)
 {
+	bool		use_shared = smgr_use_shared_size(reln);
+	BlockNumber oldnblocks = InvalidBlockNumber;
+
+	if (use_shared)
+		oldnblocks = smgr_shared_size_begin_change(reln, forknum);
+
 	smgrsw[reln->smgr_which].smgr_extend(reln, forknum, blocknum,
 										 buffer, skipFsync);
 
+	if (use_shared)
+		smgr_shared_size_end_change(reln, forknum, oldnblocks,
+									blocknum + 1, true);
+
 	/*
 	 * Normally we expect this to increase nblocks by one, but if the cached
 	 * value isn't as expected, just invalidate it so the next call asks the
@@ -507,6 +633,38 @@ smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
 }
 
+/*
+ *	smgrzeroextend() -- Add new zeroed out blocks to a file.
+ *
+ *		Similar to smgrextend(), except the relation can be extended by
+ *		multiple blocks at once and the added blocks will be filled with
+ *		zeroes.  The new blocks are not in shared buffers; readers will see
+ *		them as new, empty pages.
+ */
+void
+smgrzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			   int nblocks, bool skipFsync)
+{
+	bool		use_shared = smgr_use_shared_size(reln);
+	BlockNumber oldnblocks = InvalidBlockNumber;
+
+	if (use_shared)
+		oldnblocks = smgr_shared_size_begin_change(reln, forknum);
+
+	smgrsw[reln->smgr_which].smgr_zeroextend(reln, forknum, blocknum,
+											 nblocks, skipFsync);
+
+	if (use_shared)
+		smgr_shared_size_end_change(reln, forknum, oldnblocks,
+									blocknum + nblocks, true);
+
+	/* As in smgrextend(), keep the cached size only if it was accurate */
+	if (reln->smgr_cached_nblocks[forknum] == blocknum)
+		reln->smgr_cached_nblocks[forknum] = blocknum + nblocks;
+	else
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+}
+
 /*
  *	smgrprefetch() -- Initiate asynchronous read of the specified block of a relation.
  *
@@ -558,6 +716,21 @@ smgrwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 										buffer, skipFsync);
 }
 
+/*
+ *	smgrwritev() -- Write out several consecutive blocks.
+ *
+ *		Equivalent to calling smgrwrite() for each of blocknum ..
+ *		blocknum + nblocks - 1 with the corresponding entry of buffers[],
+ *		but lets the storage manager combine them into fewer I/O requests.
+ */
+void
+smgrwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		   const void **buffers, BlockNumber nblocks, bool skipFsync)
+{
+	smgrsw[reln->smgr_which].smgr_writev(reln, forknum, blocknum,
+										 buffers, nblocks, skipFsync);
+}
+
 
 /*
  *	smgrwriteback() -- Trigger kernel writeback for the supplied range of
@@ -579,16 +752,29 @@ BlockNumber
 smgrnblocks(SMgrRelation reln, ForkNumber forknum)
 {
 	BlockNumber result;
+	bool		use_shared = smgr_use_shared_size(reln);
+	uint64		generation = 0;
 
 	/* Check and return if we get the cached value for the number of blocks. */
 	result = smgrnblocks_cached(reln, forknum);
 	if (result != InvalidBlockNumber)
 		return result;
 
+	/* Outside recovery, try the shared cache */
+	if (use_shared)
+	{
+		result = smgr_shared_size_lookup(reln, forknum, &generation);
+		if (result != InvalidBlockNumber)
+			return result;
+	}
+
 	result = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
 
 	reln->smgr_cached_nblocks[forknum] = result;
 
+	if (use_shared && generation != 0)
+		smgr_shared_size_store(reln, forknum, generation, result);
+
 	return result;
 }
 
@@ -612,6 +798,182 @@ smgrnblocks_cached(SMgrRelation reln, ForkNumber forknum)
 	return InvalidBlockNumber;
 }
 
+/*
+ * Can the shared relation size cache be used for this relation?
+ */
+static bool
+smgr_use_shared_size(SMgrRelation reln)
+{
+	return SMgrSharedRelationHash != NULL &&
+		!SmgrIsTemp(reln) &&
+		!RecoveryInProgress();
+}
+
+/*
+ * Look up the size of a fork in the shared cache.
+ *
+ * If it's not known, returns InvalidBlockNumber and sets *generation to the
+ * entry's current generation, creating the entry if needed, so that the
+ * caller can store the size once it has asked the kernel.  *generation is
+ * set to 0 if there's no room for a new entry.
+ */
+static BlockNumber
+smgr_shared_size_lookup(SMgrRelation reln, ForkNumber forknum,
+						uint64 *generation)
+{
+	RelFileLocator *rlocator = &reln->smgr_rlocator.locator;
+	SMgrSharedRelation *entry;
+	BlockNumber result = InvalidBlockNumber;
+	bool		found;
+
+	*generation = 0;
+
+	LWLockAcquire(RelationSizeCacheLock, LW_SHARED);
+	entry = hash_search(SMgrSharedRelationHash, rlocator, HASH_FIND, NULL);
+	if (entry)
+	{
+		result = entry->nblocks[forknum];
+		*generation = entry->generation;
+	}
+	LWLockRelease(RelationSizeCacheLock);
+
+	if (entry)
+		return result;
+
+	LWLockAcquire(RelationSizeCacheLock, LW_EXCLUSIVE);
+	entry = hash_search(SMgrSharedRelationHash, rlocator, HASH_ENTER_NULL,
+						&found);
+	if (entry)
+	{
+		if (!found)
+		{
+			ForkNumber	fork;
+
+			entry->generation = SMgrSharedRelationCtl->next_generation++;
+			for (fork = 0; fork <= MAX_FORKNUM; fork++)
+				entry->nblocks[fork] = InvalidBlockNumber;
+		}
+		result = entry->nblocks[forknum];
+		*generation = entry->generation;
+	}
+	LWLockRelease(RelationSizeCacheLock);
+
+	return result;
+}
+
+/*
+ * Store the size of a fork obtained from the kernel, unless its entry has
+ * changed since smgr_shared_size_lookup returned "generation".
+ */
+static void
+smgr_shared_size_store(SMgrRelation reln, ForkNumber forknum,
+					   uint64 generation, BlockNumber nblocks)
+{
+	SMgrSharedRelation *entry;
+
+	LWLockAcquire(RelationSizeCacheLock, LW_EXCLUSIVE);
+	entry = hash_search(SMgrSharedRelationHash,
+						&reln->smgr_rlocator.locator, HASH_FIND, NULL);
+	if (entry && entry->generation == generation)
+		entry->nblocks[forknum] = nblocks;
+	LWLockRelease(RelationSizeCacheLock);
+}
+
+/*
+ * Mark the cached size of a fork unknown, before changing the fork's size.
+ * Returns the previously cached size.
+ */
+static BlockNumber
+smgr_shared_size_begin_change(SMgrRelation reln, ForkNumber forknum)
+{
+	SMgrSharedRelation *entry;
+	BlockNumber result = InvalidBlockNumber;
+
+	LWLockAcquire(RelationSizeCacheLock, LW_EXCLUSIVE);
+	entry = hash_search(SMgrSharedRelationHash,
+						&reln->smgr_rlocator.locator, HASH_FIND, NULL);
+	if (entry)
+	{
+		result = entry->nblocks[forknum];
+		entry->nblocks[forknum] = InvalidBlockNumber;
+		entry->generation++;
+	}
+	LWLockRelease(RelationSizeCacheLock);
+
+	return result;
+}
+
+/*
+ * Record the new size of a fork after a successful change.
+ *
+ * After a truncation, the new size is exactly newnblocks.  After writing
+ * blocks up to newnblocks, the fork is at least that long; its size is known
+ * only if it was known before (oldnblocks), or if another backend has
+ * looked it up from the kernel since smgr_shared_size_begin_change.
+ */
+static void
+smgr_shared_size_end_change(SMgrRelation reln, ForkNumber forknum,
+							BlockNumber oldnblocks, BlockNumber newnblocks,
+							bool extension)
+{
+	SMgrSharedRelation *entry;
+
+	LWLockAcquire(RelationSizeCacheLock, LW_EXCLUSIVE);
+	entry = hash_search(SMgrSharedRelationHash,
+						&reln->smgr_rlocator.locator, HASH_FIND, NULL);
+	if (entry)
+	{
+		BlockNumber cur = entry->nblocks[forknum];
+
+		if (!extension)
+			entry->nblocks[forknum] = newnblocks;
+		else if (cur != InvalidBlockNumber)
+			entry->nblocks[forknum] = Max(cur, newnblocks);
+		else if (oldnblocks != InvalidBlockNumber)
+			entry->nblocks[forknum] = Max(oldnblocks, newnblocks);
+		entry->generation++;
+	}
+	LWLockRelease(RelationSizeCacheLock);
+}
+
+/*
+ * Forget all cached sizes for a relation that has been dropped.
+ */
+static void
+smgr_shared_size_forget(RelFileLocator rlocator)
+{
+	LWLockAcquire(RelationSizeCacheLock, LW_EXCLUSIVE);
+	hash_search(SMgrSharedRelationHash, &rlocator, HASH_REMOVE, NULL);
+	LWLockRelease(RelationSizeCacheLock);
+}
+
+/*
+ *	smgrforgetdatabase() -- Forget the cached sizes of all relations in
+ *							a database whose files have been removed.
+ *
+ *		Used by DROP DATABASE and ALTER DATABASE SET TABLESPACE, which remove
+ *		files without going through smgrdounlinkall().
+ */
+void
+smgrforgetdatabase(Oid dbid)
+{
+	HASH_SEQ_STATUS status;
+	SMgrSharedRelation *entry;
+
+	if (SMgrSharedRelationHash == NULL)
+		return;
+
+	LWLockAcquire(RelationSizeCacheLock, LW_EXCLUSIVE);
+	hash_seq_init(&status, SMgrSharedRelationHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->rlocator.dbOid == dbid)
+			hash_search(SMgrSharedRelationHash, &entry->rlocator,
+						HASH_REMOVE, NULL);
+	}
+	LWLockRelease(RelationSizeCacheLock);
+}
+
 /*
  *	smgrtruncate() -- Truncate the given forks of supplied relation to
  *					  each specified numbers of blocks
@@ -648,11 +1010,19 @@ smgrtruncate(SMgrRelation reln, ForkNumber *forknum, int nforks, BlockNumber *nb
 	/* Do the truncation */
 	for (i = 0; i < nforks; i++)
 	{
+		bool		use_shared = smgr_use_shared_size(reln);
+
 		/* Make the cached size is invalid if we encounter an error. */
 		reln->smgr_cached_nblocks[forknum[i]] = InvalidBlockNumber;
+		if (use_shared)
+			(void) smgr_shared_size_begin_change(reln, forknum[i]);
 
 		smgrsw[reln->smgr_which].smgr_truncate(reln, forknum[i], nblocks[i]);
 
+		if (use_shared)
+			smgr_shared_size_end_change(reln, forknum[i], InvalidBlockNumber,
+										nblocks[i], false);
+
 		/*
 		 * We might as well update the local smgr_cached_nblocks values. The
 		 * smgr cache inval message that this function sent will cause other
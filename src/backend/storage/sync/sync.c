@@ -65,6 +65,9 @@ typedef struct
 	FileTag		tag;			/* identifies handler and file */
 	CycleCtr	cycle_ctr;		/* sync_cycle_ctr of oldest request */
 	bool		canceled;		/* canceled is true if we canceled "recently" */
+	bool		synced_early;	/* fsync'd by EarlySyncRequests, and not
+								 * requested again since */
+	uint64		early_sync_round;	/* early_sync_round of newest request */
 } PendingFsyncEntry;
 
 typedef struct
@@ -81,6 +84,9 @@ static MemoryContext pendingOpsCxt; /* context for the above  */
 static CycleCtr sync_cycle_ctr = 0;
 static CycleCtr checkpoint_cycle_ctr = 0;
 
+/* Number of EarlySyncRequests() calls so far */
+static uint64 early_sync_round = 0;
+
 /* Intervals for calling AbsorbSyncRequests */
 #define FSYNCS_PER_ABSORB		10
 #define UNLINKS_PER_ABSORB		10
@@ -386,9 +392,10 @@ ProcessSyncRequests(void)
 		/*
 		 * If fsync is off then we don't have to bother opening the file at
 		 * all.  (We delay checking until this point so that changing fsync on
-		 * the fly behaves sensibly.)
+		 * the fly behaves sensibly.)  Nor do we if the file was already
+		 * synced by EarlySyncRequests() and nobody has written to it since.
 		 */
-		if (enableFsync)
+		if (enableFsync && !entry->synced_early)
 		{
 			/*
 			 * If in checkpointer, we want to absorb pending requests every so
@@ -481,6 +488,89 @@ ProcessSyncRequests(void)
 	sync_in_progress = false;
 }
 
+/*
+ *	EarlySyncRequests() -- fsync files that seem to be completely written.
+ *
+ * This is called by the checkpointer during the write phase of a checkpoint,
+ * in time that it would otherwise spend sleeping.  BufferSync() writes each
+ * file's buffers together, so a file that hasn't been written to since the
+ * previous call has most likely received all of this checkpoint's writes.
+ * Syncing such files now spreads the fsyncs over the checkpoint, instead of
+ * issuing them all back-to-back in ProcessSyncRequests().
+ *
+ * The entries stay in the table.  If a file is written again, the new sync
+ * request clears synced_early and the file is synced once more at the end;
+ * otherwise ProcessSyncRequests() just removes the entry.
+ *
+ * Gives up after about max_msec milliseconds.  Returns true if any file was
+ * synced.
+ */
+bool
+EarlySyncRequests(int max_msec)
+{
+	HASH_SEQ_STATUS hstat;
+	PendingFsyncEntry *entry;
+	instr_time	start,
+				sync_start,
+				sync_end;
+	bool		synced = false;
+
+	if (!pendingOps || !enableFsync)
+		return false;
+
+	early_sync_round++;
+
+	INSTR_TIME_SET_CURRENT(start);
+	hash_seq_init(&hstat, pendingOps);
+	while ((entry = (PendingFsyncEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		char		path[MAXPGPATH];
+
+		/* Skip entries that are done, or were written since the last call */
+		if (entry->canceled || entry->synced_early ||
+			entry->early_sync_round + 1 >= early_sync_round)
+			continue;
+
+		INSTR_TIME_SET_CURRENT(sync_start);
+		if (syncsw[entry->tag.handler].sync_syncfiletag(&entry->tag,
+														path) == 0)
+		{
+			entry->synced_early = true;
+			synced = true;
+
+			INSTR_TIME_SET_CURRENT(sync_end);
+			INSTR_TIME_SUBTRACT(sync_end, sync_start);
+			CheckpointStats.ckpt_early_sync_rels++;
+			CheckpointStats.ckpt_agg_early_sync_time +=
+				INSTR_TIME_GET_MICROSEC(sync_end);
+
+			if (log_checkpoints)
+				elog(DEBUG1, "checkpoint early sync: file=%s time=%.3f ms",
+					 path,
+					 INSTR_TIME_GET_MILLISEC(sync_end));
+		}
+		else if (!FILE_POSSIBLY_DELETED(errno))
+			ereport(data_sync_elevel(ERROR),
+					(errcode_for_file_access(),
+					 errmsg("could not fsync file \"%s\": %m", path)));
+
+		/*
+		 * A file that has been deleted is left for ProcessSyncRequests(),
+		 * which knows how to check whether the request was canceled.
+		 */
+
+		INSTR_TIME_SET_CURRENT(sync_end);
+		INSTR_TIME_SUBTRACT(sync_end, start);
+		if (INSTR_TIME_GET_MILLISEC(sync_end) >= max_msec)
+		{
+			hash_seq_term(&hstat);
+			break;
+		}
+	}
+
+	return synced;
+}
+
 /*
  * RememberSyncRequest() -- callback from checkpointer side of sync request
  *
@@ -567,6 +657,10 @@ RememberSyncRequest(const FileTag *ftag, SyncRequestType type)
 			entry->canceled = false;
 		}
 
+		/* the file has been written again, so an early sync won't do */
+		entry->synced_early = false;
+		entry->early_sync_round = early_sync_round;
+
 		/*
 		 * NB: it's intentional that we don't change cycle_ctr if the entry
 		 * already exists.  The cycle_ctr must represent the oldest fsync
@@ -262,8 +262,16 @@ ReadyForQuery(CommandDest dest)
 				pq_sendbyte(&buf, TransactionBlockStatusCode());
 				pq_endmessage(&buf);
 			}
-			/* Flush output at end of cycle in any case. */
-			pq_flush();
+
+			/*
+			 * Flush output at end of cycle, unless the client has already
+			 * sent us more messages, as it does in pipeline mode.  The
+			 * output is then sent together with the results of those, at the
+			 * latest when pq_recvbuf() has to wait for more input.  This
+			 * saves a send() call per Sync message in a pipelined burst.
+			 */
+			if (!pq_buffer_has_data())
+				pq_flush();
 			break;
 
 		case DestNone:
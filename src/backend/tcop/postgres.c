@@ -187,6 +187,7 @@ static bool IsTransactionExitStmtList(List *pstmts);
 static bool IsTransactionStmtList(List *pstmts);
 static void drop_unnamed_stmt(void);
 static void log_disconnections(int code, Datum arg);
+static void log_connection_setup(void);
 static void enable_statement_timeout(void);
 static void disable_statement_timeout(void);
 
@@ -3398,6 +3399,9 @@ ProcessInterrupts(void)
 	if (LogMemoryContextPending)
 		ProcessLogMemoryContextInterrupt();
 
+	if (PublishMemoryContextPending)
+		ProcessGetMemoryContextInterrupt();
+
 	if (ParallelApplyMessagePending)
 		HandleParallelApplyMessages();
 }
@@ -4007,8 +4011,9 @@ PostgresSingleUserMain(int argc, char *argv[],
 	 */
 	process_shared_preload_libraries();
 
-	/* Initialize MaxBackends */
+	/* Initialize MaxBackends and the number of fast-path lock slots */
 	InitializeMaxBackends();
+	InitializeFastPathLocks();
 
 	/*
 	 * Give preloaded libraries a chance to request additional shared memory.
@@ -4486,6 +4491,11 @@ PostgresMain(const char *dbname, const char *username)
 			/* Report any recently-changed GUC options */
 			ReportChangedGUCOptions();
 
+			/* The first time, log how long the connection took to set up */
+			if (Log_connections && conn_timing.ready_for_use == 0 &&
+				conn_timing.socket_create != 0)
+				log_connection_setup();
+
 			ReadyForQuery(whereToSendOutput);
 			send_ready_for_query = false;
 		}
@@ -5011,6 +5021,25 @@ log_disconnections(int code, Datum arg)
 					port->remote_port[0] ? " port=" : "", port->remote_port)));
 }
 
+/*
+ * Log how long the stages of setting up the connection took, when we are
+ * first ready for a query
+ */
+static void
+log_connection_setup(void)
+{
+	conn_timing.ready_for_use = GetCurrentTimestamp();
+
+	ereport(LOG,
+			(errmsg("connection ready: setup total=%.3f ms, fork=%.3f ms, authentication=%.3f ms",
+					(double) (conn_timing.ready_for_use -
+							  conn_timing.socket_create) / 1000.0,
+					(double) (conn_timing.fork_end -
+							  conn_timing.fork_start) / 1000.0,
+					(double) (conn_timing.auth_end -
+							  conn_timing.auth_start) / 1000.0)));
+}
+
 /*
  * Start statement timeout timer, if enabled.
  *
@@ -34,6 +34,38 @@
  */
 Portal		ActivePortal = NULL;
 
+/*
+ * Queries kept for reuse by later executions of the same prepared statement
+ * in the current transaction.
+ *
+ * For a prepared statement that looks up a row by key, setting up the
+ * executor in ExecutorStart and shutting it down in ExecutorEnd costs as much
+ * as the index lookup itself.  So when the unnamed portal runs the generic
+ * plan of a prepared statement, and the plan is simple enough (see
+ * ExecPlanIsReusable), we don't shut the executor down when the portal is
+ * dropped, but suspend it and keep it here, and the next portal that runs the
+ * same plan resumes it with its own parameters and snapshot.  Only a few
+ * queries are kept, and all of them are shut down at the end of the
+ * transaction, as we hold their relations open across commands: that's safe
+ * while the transaction holds the locks taken by GetCachedPlan.
+ *
+ * The relations are opened under TopTransactionResourceOwner, and the buffer
+ * pins and snapshots of each run under the resource owner of its portal.
+ */
+typedef struct ReusableQuery
+{
+	CachedPlan *cplan;			/* plan the query runs; we hold a refcount */
+	PlannedStmt *stmt;			/* statement of cplan the query runs */
+	QueryDesc  *queryDesc;		/* the query, allocated in
+								 * TopTransactionContext */
+	bool		in_use;			/* is a portal running it? */
+} ReusableQuery;
+
+#define MAX_REUSABLE_QUERIES	16
+
+static ReusableQuery ReusableQueries[MAX_REUSABLE_QUERIES];
+static int	NumReusableQueries = 0;
+
 
 static void ProcessQuery(PlannedStmt *plan,
 						 const char *sourceText,
@@ -58,6 +90,8 @@ static uint64 DoPortalRunFetch(Portal portal,
 							   long count,
 							   DestReceiver *dest);
 static void DoPortalRewind(Portal portal);
+static QueryDesc *StartReusableQuery(Portal portal, ParamListInfo params,
+									 int eflags);
 
 
 /*
@@ -406,6 +440,172 @@ FetchStatementTargetList(Node *stmt)
 	return NIL;
 }
 
+/*
+ * StartReusableQuery
+ *		Get a started query for a PORTAL_ONE_SELECT portal, if it can be
+ *		reused by later executions of the same plan.
+ *
+ * Returns NULL if the portal doesn't qualify, or if its plan is already being
+ * run by another portal; the caller then starts a query of its own.  The
+ * active snapshot must have been set.
+ */
+static QueryDesc *
+StartReusableQuery(Portal portal, ParamListInfo params, int eflags)
+{
+	PlannedStmt *stmt = linitial_node(PlannedStmt, portal->stmts);
+	CachedPlan *cplan = portal->cplan;
+	ReusableQuery *rq = NULL;
+	ResourceOwner saveResourceOwner;
+	MemoryContext oldcontext;
+	QueryDesc  *queryDesc;
+
+	/*
+	 * Only the unnamed portal is dropped promptly enough: the next command
+	 * replaces it, so it can't stay open while a subtransaction starts or
+	 * ends.  A cached plan that has more than our portal's reference is the
+	 * generic plan of its CachedPlanSource; a custom plan is not reused.
+	 */
+	if (portal->name[0] != '\0' ||
+		cplan == NULL || !cplan->is_saved || cplan->refcount < 2)
+		return NULL;
+	if (eflags != 0 ||
+		(portal->cursorOptions & (CURSOR_OPT_SCROLL | CURSOR_OPT_HOLD)) ||
+		portal->queryEnv != NULL ||
+		IsSubTransaction())
+		return NULL;
+	/* parameters must be looked up at run time, not compiled in */
+	if (params && (params->paramFetch || params->paramCompile))
+		return NULL;
+
+	for (int i = 0; i < NumReusableQueries; i++)
+	{
+		if (ReusableQueries[i].cplan == cplan &&
+			ReusableQueries[i].stmt == stmt)
+		{
+			rq = &ReusableQueries[i];
+			break;
+		}
+	}
+
+	if (rq == NULL)
+	{
+		if (NumReusableQueries >= MAX_REUSABLE_QUERIES ||
+			!ExecPlanIsReusable(stmt))
+			return NULL;
+
+		/*
+		 * Start the query under the transaction's resource owner, and then
+		 * suspend it at once, so that it only keeps its relations open
+		 * there.
+		 */
+		saveResourceOwner = CurrentResourceOwner;
+		CurrentResourceOwner = TopTransactionResourceOwner;
+		oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+
+		queryDesc = CreateQueryDesc(stmt,
+									pstrdup(portal->sourceText),
+									GetActiveSnapshot(),
+									InvalidSnapshot,
+									None_Receiver,
+									params,
+									NULL,
+									0);
+		ExecutorStart(queryDesc, 0);
+		ExecutorSuspend(queryDesc);
+
+		MemoryContextSwitchTo(oldcontext);
+		CurrentResourceOwner = saveResourceOwner;
+
+		rq = &ReusableQueries[NumReusableQueries++];
+		rq->cplan = cplan;
+		cplan->refcount++;
+		rq->stmt = stmt;
+		rq->queryDesc = queryDesc;
+		rq->in_use = false;
+	}
+	else if (rq->in_use)
+		return NULL;
+
+	ExecutorResume(rq->queryDesc, params, GetActiveSnapshot());
+	rq->in_use = true;
+
+	return rq->queryDesc;
+}
+
+/*
+ * SuspendReusableQuery
+ *		Suspend a query kept for reuse, when its portal is done with it.
+ *
+ * Returns false if the query is not one of ours; the caller must then shut it
+ * down as usual.  The portal's resource owner must be current.
+ */
+bool
+SuspendReusableQuery(QueryDesc *queryDesc)
+{
+	for (int i = 0; i < NumReusableQueries; i++)
+	{
+		ReusableQuery *rq = &ReusableQueries[i];
+
+		if (rq->queryDesc == queryDesc)
+		{
+			Assert(rq->in_use);
+			ExecutorSuspend(queryDesc);
+			rq->in_use = false;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * DropReusableQueries
+ *		Shut down the queries kept for reuse that no portal is running.
+ *
+ * This is done at commit, and before DDL that requires that no query of this
+ * session has the relation open.
+ */
+void
+DropReusableQueries(void)
+{
+	ResourceOwner saveResourceOwner = CurrentResourceOwner;
+	int			nkept = 0;
+
+	CurrentResourceOwner = TopTransactionResourceOwner;
+	for (int i = 0; i < NumReusableQueries; i++)
+	{
+		ReusableQuery *rq = &ReusableQueries[i];
+
+		if (rq->in_use)
+		{
+			ReusableQueries[nkept++] = *rq;
+			continue;
+		}
+
+		ExecutorFinish(rq->queryDesc);
+		ExecutorEnd(rq->queryDesc);
+		FreeQueryDesc(rq->queryDesc);
+		ReleaseCachedPlan(rq->cplan, NULL);
+	}
+	NumReusableQueries = nkept;
+	CurrentResourceOwner = saveResourceOwner;
+}
+
+/*
+ * AtAbort_ReusableQueries
+ *		Forget the queries kept for reuse, at transaction abort.
+ *
+ * The resource owners release what they held, and their memory goes away
+ * with TopTransactionContext; we only need to drop our plan references.
+ */
+void
+AtAbort_ReusableQueries(void)
+{
+	for (int i = 0; i < NumReusableQueries; i++)
+		ReleaseCachedPlan(ReusableQueries[i].cplan, NULL);
+	NumReusableQueries = 0;
+}
+
 /*
  * PortalStart
  *		Prepare a portal for execution.
@@ -489,32 +689,40 @@ PortalStart(Portal portal, ParamListInfo params,
 				 */
 
 				/*
-				 * Create QueryDesc in portal's context; for the moment, set
-				 * the destination to DestNone.
+				 * If this is another execution of a prepared statement whose
+				 * executor state we kept, just resume that.
 				 */
-				queryDesc = CreateQueryDesc(linitial_node(PlannedStmt, portal->stmts),
-											portal->sourceText,
-											GetActiveSnapshot(),
-											InvalidSnapshot,
-											None_Receiver,
-											params,
-											portal->queryEnv,
-											0);
-
-				/*
-				 * If it's a scrollable cursor, executor needs to support
-				 * REWIND and backwards scan, as well as whatever the caller
-				 * might've asked for.
-				 */
-				if (portal->cursorOptions & CURSOR_OPT_SCROLL)
-					myeflags = eflags | EXEC_FLAG_REWIND | EXEC_FLAG_BACKWARD;
-				else
-					myeflags = eflags;
+				queryDesc = StartReusableQuery(portal, params, eflags);
+				if (queryDesc == NULL)
+				{
+					/*
+					 * Create QueryDesc in portal's context; for the moment, set
+					 * the destination to DestNone.
+					 */
+					queryDesc = CreateQueryDesc(linitial_node(PlannedStmt, portal->stmts),
+												portal->sourceText,
+												GetActiveSnapshot(),
+												InvalidSnapshot,
+												None_Receiver,
+												params,
+												portal->queryEnv,
+												0);
+
+					/*
+					 * If it's a scrollable cursor, executor needs to support
+					 * REWIND and backwards scan, as well as whatever the caller
+					 * might've asked for.
+					 */
+					if (portal->cursorOptions & CURSOR_OPT_SCROLL)
+						myeflags = eflags | EXEC_FLAG_REWIND | EXEC_FLAG_BACKWARD;
+					else
+						myeflags = eflags;
 
-				/*
-				 * Call ExecutorStart to prepare the plan for execution
-				 */
-				ExecutorStart(queryDesc, myeflags);
+					/*
+					 * Call ExecutorStart to prepare the plan for execution
+					 */
+					ExecutorStart(queryDesc, myeflags);
+				}
 
 				/*
 				 * This tells PortalCleanup to shut down the executor
@@ -16,10 +16,34 @@
 
 #include "tsearch/ts_cache.h"
 #include "tsearch/ts_utils.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
 #include "varatt.h"
 
 #define IGNORE_LONGLEXEME	1
 
+/*
+ * Per-dictionary cache of lexize results.  Only tokens up to
+ * LEXEME_CACHE_KEYLEN bytes are cached; when a dictionary's cache reaches
+ * LEXEME_CACHE_SIZE entries it is simply emptied and refilled, which keeps
+ * memory bounded while retaining the frequent words of typical documents.
+ */
+#define LEXEME_CACHE_KEYLEN		32
+#define LEXEME_CACHE_SIZE		4096
+
+typedef struct
+{
+	int32		len;
+	char		word[LEXEME_CACHE_KEYLEN];
+} LexemeCacheKey;
+
+typedef struct
+{
+	LexemeCacheKey key;			/* hash key, must be first */
+	TSLexeme   *res;			/* NULL if dictionary didn't know the word */
+	int			nres;
+} LexemeCacheEntry;
+
 /*
  * Lexize subsystem
  */
@@ -169,6 +193,109 @@ setNewTmpRes(LexizeData *ld, ParsedLex *lex, TSLexeme *res)
 	ld->lastRes = lex;
 }
 
+/*
+ * Copy a lexize result array, including the lexeme strings, into the
+ * current memory context.
+ */
+static TSLexeme *
+copyLexemes(TSLexeme *src, int n)
+{
+	TSLexeme   *dst = palloc(sizeof(TSLexeme) * (n + 1));
+	int			i;
+
+	for (i = 0; i < n; i++)
+	{
+		dst[i] = src[i];
+		dst[i].lexeme = pstrdup(src[i].lexeme);
+	}
+	memset(&dst[n], 0, sizeof(TSLexeme));
+
+	return dst;
+}
+
+/*
+ * Call the dictionary's lexize method for a token in usual (single-word)
+ * mode, consulting and filling the dictionary's result cache if it has one.
+ * The returned array is always freshly allocated, as with a direct call.
+ */
+static TSLexeme *
+callLexize(TSDictionaryCacheEntry *dict, DictSubState *dictState,
+		   char *lemm, int lenlemm)
+{
+	LexemeCacheKey key;
+	LexemeCacheEntry *entry;
+	TSLexeme   *res;
+	TSLexeme   *saved;
+	MemoryContext oldcontext;
+	bool		found;
+	int			n;
+
+	dictState->isend = dictState->getnext = false;
+	dictState->private_state = NULL;
+
+	if (!dict->lexizeCacheable || lenlemm > LEXEME_CACHE_KEYLEN)
+		return (TSLexeme *) DatumGetPointer(FunctionCall4(&(dict->lexize),
+														  PointerGetDatum(dict->dictData),
+														  PointerGetDatum(lemm),
+														  Int32GetDatum(lenlemm),
+														  PointerGetDatum(dictState)));
+
+	if (dict->lexemeCache == NULL ||
+		hash_get_num_entries(dict->lexemeCache) >= LEXEME_CACHE_SIZE)
+	{
+		HASHCTL		ctl;
+
+		if (dict->lexemeCacheCtx == NULL)
+			dict->lexemeCacheCtx = AllocSetContextCreate(dict->dictCtx,
+														 "TS lexeme cache",
+														 ALLOCSET_DEFAULT_SIZES);
+		else
+			MemoryContextReset(dict->lexemeCacheCtx);
+
+		ctl.keysize = sizeof(LexemeCacheKey);
+		ctl.entrysize = sizeof(LexemeCacheEntry);
+		ctl.hcxt = dict->lexemeCacheCtx;
+		dict->lexemeCache = hash_create("TS lexeme cache", 256, &ctl,
+										HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	memset(&key, 0, sizeof(key));
+	key.len = lenlemm;
+	memcpy(key.word, lemm, lenlemm);
+
+	entry = (LexemeCacheEntry *) hash_search(dict->lexemeCache, &key,
+											 HASH_FIND, NULL);
+	if (entry)
+		return entry->res ? copyLexemes(entry->res, entry->nres) : NULL;
+
+	res = (TSLexeme *) DatumGetPointer(FunctionCall4(&(dict->lexize),
+													 PointerGetDatum(dict->dictData),
+													 PointerGetDatum(lemm),
+													 Int32GetDatum(lenlemm),
+													 PointerGetDatum(dictState)));
+
+	/* a cacheable dictionary should never ask for more words, but be sure */
+	if (dictState->getnext)
+		return res;
+
+	n = 0;
+	if (res)
+		while (res[n].lexeme)
+			n++;
+
+	/* copy before entering, so an error can't leave a half-built entry */
+	oldcontext = MemoryContextSwitchTo(dict->lexemeCacheCtx);
+	saved = res ? copyLexemes(res, n) : NULL;
+	MemoryContextSwitchTo(oldcontext);
+
+	entry = (LexemeCacheEntry *) hash_search(dict->lexemeCache, &key,
+											 HASH_ENTER, &found);
+	entry->res = saved;
+	entry->nres = n;
+
+	return res;
+}
+
 static TSLexeme *
 LexizeExec(LexizeData *ld, ParsedLex **correspondLexem)
 {
@@ -203,13 +330,8 @@ LexizeExec(LexizeData *ld, ParsedLex **correspondLexem)
 			{
 				dict = lookup_ts_dictionary_cache(map->dictIds[i]);
 
-				ld->dictState.isend = ld->dictState.getnext = false;
-				ld->dictState.private_state = NULL;
-				res = (TSLexeme *) DatumGetPointer(FunctionCall4(&(dict->lexize),
-																 PointerGetDatum(dict->dictData),
-																 PointerGetDatum(curValLemm),
-																 Int32GetDatum(curValLenLemm),
-																 PointerGetDatum(&ld->dictState)));
+				res = callLexize(dict, &ld->dictState,
+								 curValLemm, curValLenLemm);
 
 				if (ld->dictState.getnext)
 				{
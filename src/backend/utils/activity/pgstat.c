@@ -75,6 +75,7 @@
  * - pgstat_io.c
  * - pgstat_relation.c
  * - pgstat_replslot.c
+ * - pgstat_lwlock.c
  * - pgstat_slru.c
  * - pgstat_subscription.c
  * - pgstat_wal.c
@@ -282,6 +283,9 @@ static const PgStat_KindInfo pgstat_kind_infos[PGSTAT_NUM_KINDS] = {
 
 		.flush_pending_cb = pgstat_relation_flush_cb,
 		.delete_pending_cb = pgstat_relation_delete_pending_cb,
+		.reset_timestamp_cb = pgstat_relation_reset_timestamp_cb,
+		.init_shmem_cb = pgstat_relation_init_shmem_cb,
+		.fold_cb = pgstat_relation_fold_cb,
 	},
 
 	[PGSTAT_KIND_FUNCTION] = {
@@ -369,6 +373,15 @@ static const PgStat_KindInfo pgstat_kind_infos[PGSTAT_NUM_KINDS] = {
 		.snapshot_cb = pgstat_io_snapshot_cb,
 	},
 
+	[PGSTAT_KIND_LWLOCK] = {
+		.name = "lwlock",
+
+		.fixed_amount = true,
+
+		.reset_all_cb = pgstat_lwlock_reset_all_cb,
+		.snapshot_cb = pgstat_lwlock_snapshot_cb,
+	},
+
 	[PGSTAT_KIND_SLRU] = {
 		.name = "slru",
 
@@ -593,6 +606,7 @@ pgstat_report_stat(bool force)
 	/* Don't expend a clock check if nothing to do */
 	if (dlist_is_empty(&pgStatPending) &&
 		!have_iostats &&
+		!have_lwlockstats &&
 		!have_slrustats &&
 		!pgstat_have_pending_wal())
 	{
@@ -645,6 +659,9 @@ pgstat_report_stat(bool force)
 	/* flush wal stats */
 	partial_flush |= pgstat_flush_wal(nowait);
 
+	/* flush LWLock stats */
+	partial_flush |= pgstat_lwlock_flush(nowait);
+
 	/* flush SLRU stats */
 	partial_flush |= pgstat_slru_flush(nowait);
 
@@ -859,7 +876,13 @@ pgstat_fetch_entry(PgStat_Kind kind, Oid dboid, Oid objoid)
 		stats_data = MemoryContextAlloc(pgStatLocal.snapshot.context,
 										kind_info->shared_data_len);
 
-	pgstat_lock_entry_shared(entry_ref, false);
+	if (kind_info->fold_cb)
+	{
+		pgstat_lock_entry(entry_ref, false);
+		kind_info->fold_cb(entry_ref->shared_stats);
+	}
+	else
+		pgstat_lock_entry_shared(entry_ref, false);
 	memcpy(stats_data,
 		   pgstat_get_entry_data(kind, entry_ref->shared_stats),
 		   kind_info->shared_data_len);
@@ -1005,7 +1028,13 @@ pgstat_build_snapshot(void)
 		 * Acquire the LWLock directly instead of using
 		 * pg_stat_lock_entry_shared() which requires a reference.
 		 */
-		LWLockAcquire(&stats_data->lock, LW_SHARED);
+		if (kind_info->fold_cb)
+		{
+			LWLockAcquire(&stats_data->lock, LW_EXCLUSIVE);
+			kind_info->fold_cb(stats_data);
+		}
+		else
+			LWLockAcquire(&stats_data->lock, LW_SHARED);
 		memcpy(entry->data,
 			   pgstat_get_entry_data(kind, stats_data),
 			   kind_info->shared_size);
@@ -1342,6 +1371,12 @@ pgstat_write_statsfile(void)
 	pgstat_build_snapshot_fixed(PGSTAT_KIND_IO);
 	write_chunk_s(fpout, &pgStatLocal.snapshot.io);
 
+	/*
+	 * Write LWLock stats struct
+	 */
+	pgstat_build_snapshot_fixed(PGSTAT_KIND_LWLOCK);
+	write_chunk_s(fpout, &pgStatLocal.snapshot.lwlock);
+
 	/*
 	 * Write SLRU stats struct
 	 */
@@ -1395,6 +1430,13 @@ pgstat_write_statsfile(void)
 			write_chunk_s(fpout, &name);
 		}
 
+		/*
+		 * No other process is updating the stats anymore, so fold in the
+		 * counters kept outside the stats data without taking the lock.
+		 */
+		if (kind_info->fold_cb)
+			kind_info->fold_cb(shstats);
+
 		/* Write except the header part of the entry */
 		write_chunk(fpout,
 					pgstat_get_entry_data(ps->key.kind, shstats),
@@ -1459,6 +1501,7 @@ pgstat_read_statsfile(void)
 	bool		found;
 	const char *statfile = PGSTAT_STAT_PERMANENT_FILENAME;
 	PgStat_ShmemControl *shmem = pgStatLocal.shmem;
+	PgStat_IO	iostats;
 
 	/* shouldn't be called from postmaster */
 	Assert(IsUnderPostmaster || !IsPostmasterEnvironment);
@@ -1517,9 +1560,17 @@ pgstat_read_statsfile(void)
 		goto error;
 
 	/*
-	 * Read IO stats struct
+	 * Read IO stats struct.  The shared counters are atomics, so they can't
+	 * be read into directly.
+	 */
+	if (!read_chunk_s(fpin, &iostats))
+		goto error;
+	pgstat_io_restore(&iostats);
+
+	/*
+	 * Read LWLock stats struct
 	 */
-	if (!read_chunk_s(fpin, &shmem->io.stats))
+	if (!read_chunk_s(fpin, &shmem->lwlock.stats))
 		goto error;
 
 	/*
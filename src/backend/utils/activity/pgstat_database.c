@@ -29,6 +29,7 @@ PgStat_Counter pgStatBlockReadTime = 0;
 PgStat_Counter pgStatBlockWriteTime = 0;
 PgStat_Counter pgStatActiveTime = 0;
 PgStat_Counter pgStatTransactionIdleTime = 0;
+PgStat_Counter pgStatCacheResets = 0;
 SessionEndType pgStatSessionEndCause = DISCONNECT_NORMAL;
 
 
@@ -115,6 +116,23 @@ pgstat_report_recovery_conflict(int reason)
 	}
 }
 
+/*
+ * Report snapshot conflicts that replay deferred to this backend, and that
+ * went away without our query having to be cancelled.
+ */
+void
+pgstat_report_recovery_conflict_deferred(int count)
+{
+	PgStat_StatDBEntry *dbentry;
+
+	Assert(IsUnderPostmaster);
+	if (!pgstat_track_counts)
+		return;
+
+	dbentry = pgstat_prep_database_pending(MyDatabaseId);
+	dbentry->conflict_snapshot_deferred += count;
+}
+
 /*
  * Report a detected deadlock.
  */
@@ -278,6 +296,7 @@ pgstat_update_dbstats(TimestampTz ts)
 	dbentry->xact_rollback += pgStatXactRollback;
 	dbentry->blk_read_time += pgStatBlockReadTime;
 	dbentry->blk_write_time += pgStatBlockWriteTime;
+	dbentry->cache_resets += pgStatCacheResets;
 
 	if (pgstat_should_report_connstat())
 	{
@@ -301,6 +320,7 @@ pgstat_update_dbstats(TimestampTz ts)
 	pgStatBlockWriteTime = 0;
 	pgStatActiveTime = 0;
 	pgStatTransactionIdleTime = 0;
+	pgStatCacheResets = 0;
 }
 
 /*
@@ -389,6 +409,7 @@ pgstat_database_flush_cb(PgStat_EntryRef *entry_ref, bool nowait)
 	PGSTAT_ACCUM_DBCOUNT(conflict_snapshot);
 	PGSTAT_ACCUM_DBCOUNT(conflict_bufferpin);
 	PGSTAT_ACCUM_DBCOUNT(conflict_startup_deadlock);
+	PGSTAT_ACCUM_DBCOUNT(conflict_snapshot_deferred);
 
 	PGSTAT_ACCUM_DBCOUNT(temp_bytes);
 	PGSTAT_ACCUM_DBCOUNT(temp_files);
@@ -408,6 +429,8 @@ pgstat_database_flush_cb(PgStat_EntryRef *entry_ref, bool nowait)
 	PGSTAT_ACCUM_DBCOUNT(sessions_abandoned);
 	PGSTAT_ACCUM_DBCOUNT(sessions_fatal);
 	PGSTAT_ACCUM_DBCOUNT(sessions_killed);
+
+	PGSTAT_ACCUM_DBCOUNT(cache_resets);
 #undef PGSTAT_ACCUM_DBCOUNT
 
 	pgstat_unlock_entry(entry_ref);
@@ -86,43 +86,32 @@ pgstat_fetch_stat_io(void)
 /*
  * Flush out locally pending IO statistics
  *
- * If no stats have been recorded, this function returns false.
- *
- * If nowait is true, this function returns true if the lock could not be
- * acquired. Otherwise, return false.
+ * The shared counters are atomics, so this never has to wait, and always
+ * returns false.  nowait is accepted for symmetry with the other flush
+ * functions.
  */
 bool
 pgstat_flush_io(bool nowait)
 {
-	LWLock	   *bktype_lock;
-	PgStat_BktypeIO *bktype_shstats;
-
 	if (!have_iostats)
 		return false;
 
-	bktype_lock = &pgStatLocal.shmem->io.locks[MyBackendType];
-	bktype_shstats =
-		&pgStatLocal.shmem->io.stats.stats[MyBackendType];
-
-	if (!nowait)
-		LWLockAcquire(bktype_lock, LW_EXCLUSIVE);
-	else if (!LWLockConditionalAcquire(bktype_lock, LW_EXCLUSIVE))
-		return true;
-
 	for (int io_object = 0; io_object < IOOBJECT_NUM_TYPES; io_object++)
 	{
 		for (int io_context = 0; io_context < IOCONTEXT_NUM_TYPES; io_context++)
 		{
 			for (int io_op = 0; io_op < IOOP_NUM_TYPES; io_op++)
-				bktype_shstats->data[io_object][io_context][io_op] +=
+			{
+				PgStat_Counter pending =
 					PendingIOStats.data[io_object][io_context][io_op];
+
+				if (pending != 0)
+					pg_atomic_fetch_add_u64(&pgStatLocal.shmem->io.data[MyBackendType][io_object][io_context][io_op],
+											pending);
+			}
 		}
 	}
 
-	Assert(pgstat_bktype_io_stats_valid(bktype_shstats, MyBackendType));
-
-	LWLockRelease(bktype_lock);
-
 	memset(&PendingIOStats, 0, sizeof(PendingIOStats));
 
 	have_iostats = false;
@@ -164,51 +153,74 @@ pgstat_get_io_object_name(IOObject io_object)
 	pg_unreachable();
 }
 
+/*
+ * Counts flushed concurrently with a reset may survive it, as if they had
+ * been flushed just after it.
+ */
 void
 pgstat_io_reset_all_cb(TimestampTz ts)
 {
-	for (int i = 0; i < BACKEND_NUM_TYPES; i++)
-	{
-		LWLock	   *bktype_lock = &pgStatLocal.shmem->io.locks[i];
-		PgStat_BktypeIO *bktype_shstats = &pgStatLocal.shmem->io.stats.stats[i];
+	PgStatShared_IO *stats_shmem = &pgStatLocal.shmem->io;
 
-		LWLockAcquire(bktype_lock, LW_EXCLUSIVE);
+	LWLockAcquire(&stats_shmem->lock, LW_EXCLUSIVE);
 
-		/*
-		 * Use the lock in the first BackendType's PgStat_BktypeIO to protect
-		 * the reset timestamp as well.
-		 */
-		if (i == 0)
-			pgStatLocal.shmem->io.stats.stat_reset_timestamp = ts;
+	stats_shmem->stat_reset_timestamp = ts;
 
-		memset(bktype_shstats, 0, sizeof(*bktype_shstats));
-		LWLockRelease(bktype_lock);
-	}
+	for (int i = 0; i < BACKEND_NUM_TYPES; i++)
+		for (int io_object = 0; io_object < IOOBJECT_NUM_TYPES; io_object++)
+			for (int io_context = 0; io_context < IOCONTEXT_NUM_TYPES; io_context++)
+				for (int io_op = 0; io_op < IOOP_NUM_TYPES; io_op++)
+					pg_atomic_write_u64(&stats_shmem->data[i][io_object][io_context][io_op], 0);
+
+	LWLockRelease(&stats_shmem->lock);
 }
 
+/*
+ * The counters are read one by one, so the snapshot may include only some of
+ * the counts of a concurrent flush.
+ */
 void
 pgstat_io_snapshot_cb(void)
 {
+	PgStatShared_IO *stats_shmem = &pgStatLocal.shmem->io;
+
+	LWLockAcquire(&stats_shmem->lock, LW_SHARED);
+
+	pgStatLocal.snapshot.io.stat_reset_timestamp =
+		stats_shmem->stat_reset_timestamp;
+
 	for (int i = 0; i < BACKEND_NUM_TYPES; i++)
 	{
-		LWLock	   *bktype_lock = &pgStatLocal.shmem->io.locks[i];
-		PgStat_BktypeIO *bktype_shstats = &pgStatLocal.shmem->io.stats.stats[i];
 		PgStat_BktypeIO *bktype_snap = &pgStatLocal.snapshot.io.stats[i];
 
-		LWLockAcquire(bktype_lock, LW_SHARED);
-
-		/*
-		 * Use the lock in the first BackendType's PgStat_BktypeIO to protect
-		 * the reset timestamp as well.
-		 */
-		if (i == 0)
-			pgStatLocal.snapshot.io.stat_reset_timestamp =
-				pgStatLocal.shmem->io.stats.stat_reset_timestamp;
+		for (int io_object = 0; io_object < IOOBJECT_NUM_TYPES; io_object++)
+			for (int io_context = 0; io_context < IOCONTEXT_NUM_TYPES; io_context++)
+				for (int io_op = 0; io_op < IOOP_NUM_TYPES; io_op++)
+					bktype_snap->data[io_object][io_context][io_op] =
+						pg_atomic_read_u64(&stats_shmem->data[i][io_object][io_context][io_op]);
 
-		/* using struct assignment due to better type safety */
-		*bktype_snap = *bktype_shstats;
-		LWLockRelease(bktype_lock);
+		Assert(pgstat_bktype_io_stats_valid(bktype_snap, i));
 	}
+
+	LWLockRelease(&stats_shmem->lock);
+}
+
+/*
+ * Store IO stats read from the stats file into shared memory.
+ */
+void
+pgstat_io_restore(const PgStat_IO *stats)
+{
+	PgStatShared_IO *stats_shmem = &pgStatLocal.shmem->io;
+
+	stats_shmem->stat_reset_timestamp = stats->stat_reset_timestamp;
+
+	for (int i = 0; i < BACKEND_NUM_TYPES; i++)
+		for (int io_object = 0; io_object < IOOBJECT_NUM_TYPES; io_object++)
+			for (int io_context = 0; io_context < IOCONTEXT_NUM_TYPES; io_context++)
+				for (int io_op = 0; io_op < IOOP_NUM_TYPES; io_op++)
+					pg_atomic_write_u64(&stats_shmem->data[i][io_object][io_context][io_op],
+										stats->stats[i].data[io_object][io_context][io_op]);
 }
 
 /*
@@ -0,0 +1,225 @@
+/* -------------------------------------------------------------------------
+ *
+ * pgstat_lwlock.c
+ *	  Implementation of LWLock statistics.
+ *
+ * This file contains the implementation of LWLock statistics. It is kept
+ * separate from pgstat.c to enforce the line between the statistics access /
+ * storage implementation and the details about individual types of
+ * statistics.
+ *
+ * Statistics are kept per LWLock tranche, with one entry for every
+ * individual LWLock and built-in tranche, and one shared by all tranches
+ * registered by extensions.
+ *
+ * Every acquisition is counted, so the counting must be cheap: it's just an
+ * increment of a backend-local counter.  Acquisitions alone don't make
+ * pgstat_report_stat() consider LWLock stats pending, as the flush of the
+ * statistics acquires LWLocks itself, and a backend would otherwise never be
+ * done reporting.  They're flushed along with any other pending stats.
+ *
+ * Copyright (c) 2001-2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/activity/pgstat_lwlock.c
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "utils/pgstat_internal.h"
+#include "utils/timestamp.h"
+
+
+static inline PgStat_LWLockStats *get_lwlock_entry(uint16 tranche);
+
+
+/*
+ * LWLock statistics counts waiting to be flushed out.  We assume this
+ * variable inits to zeroes.  The counters are updated while LWLocks are
+ * being acquired, so we use static memory in order to avoid memory
+ * allocation.
+ */
+static PgStat_LWLockStats pending_LWLockStats[LWLOCK_STATS_NUM_ELEMENTS];
+bool		have_lwlockstats = false;
+static bool have_lwlock_acquires = false;
+
+
+/*
+ * LWLock statistics count accumulation functions --- called from lwlock.c
+ */
+
+void
+pgstat_count_lwlock_acquire(uint16 tranche, bool contended)
+{
+	PgStat_LWLockStats *entry;
+
+	/* see get_lwlock_entry() */
+	if (!IsUnderPostmaster && IsPostmasterEnvironment)
+		return;
+
+	if (tranche >= LWTRANCHE_FIRST_USER_DEFINED)
+		entry = &pending_LWLockStats[LWLOCK_STATS_NUM_ELEMENTS - 1];
+	else
+		entry = &pending_LWLockStats[tranche];
+
+	entry->acquires += 1;
+	if (contended)
+		entry->contended += 1;
+
+	have_lwlock_acquires = true;
+}
+
+void
+pgstat_count_lwlock_spin_acquire(uint16 tranche)
+{
+	PgStat_LWLockStats *entry = get_lwlock_entry(tranche);
+
+	if (entry)
+		entry->spin_acquires += 1;
+}
+
+void
+pgstat_count_lwlock_wait(uint16 tranche, instr_time wait_time)
+{
+	PgStat_LWLockStats *entry = get_lwlock_entry(tranche);
+
+	if (entry)
+	{
+		PgStat_Counter us = INSTR_TIME_GET_MICROSEC(wait_time);
+
+		entry->waits += 1;
+		entry->wait_time += us;
+		entry->max_wait_time = Max(entry->max_wait_time, us);
+	}
+}
+
+/*
+ * Support function for the SQL-callable pgstat* functions. Returns
+ * a pointer to the LWLock statistics struct.
+ */
+PgStat_LWLockStats *
+pgstat_fetch_lwlock(void)
+{
+	pgstat_snapshot_fixed(PGSTAT_KIND_LWLOCK);
+
+	return pgStatLocal.snapshot.lwlock;
+}
+
+/*
+ * Returns the tranche name for an index. The index may be above
+ * LWLOCK_STATS_NUM_ELEMENTS, in which case this returns NULL. This allows
+ * writing code that does not know the number of entries in advance.
+ */
+const char *
+pgstat_get_lwlock_name(int idx)
+{
+	if (idx < 0 || idx >= LWLOCK_STATS_NUM_ELEMENTS)
+		return NULL;
+
+	/* the last entry is shared by all extension tranches */
+	if (idx == LWLOCK_STATS_NUM_ELEMENTS - 1)
+		return "extension";
+
+	return GetLWLockIdentifier(PG_WAIT_LWLOCK, idx);
+}
+
+/*
+ * Flush out locally pending LWLock stats entries
+ *
+ * If nowait is true, this function returns true if the lock could not be
+ * acquired. Otherwise return false.
+ */
+bool
+pgstat_lwlock_flush(bool nowait)
+{
+	PgStatShared_LWLock *stats_shmem = &pgStatLocal.shmem->lwlock;
+	int			i;
+
+	if (!have_lwlockstats && !have_lwlock_acquires)
+		return false;
+
+	if (!nowait)
+		LWLockAcquire(&stats_shmem->lock, LW_EXCLUSIVE);
+	else if (!LWLockConditionalAcquire(&stats_shmem->lock, LW_EXCLUSIVE))
+		return true;
+
+	for (i = 0; i < LWLOCK_STATS_NUM_ELEMENTS; i++)
+	{
+		PgStat_LWLockStats *sharedent = &stats_shmem->stats[i];
+		PgStat_LWLockStats *pendingent = &pending_LWLockStats[i];
+
+#define LWLOCK_ACC(fld) sharedent->fld += pendingent->fld
+		LWLOCK_ACC(acquires);
+		LWLOCK_ACC(contended);
+		LWLOCK_ACC(spin_acquires);
+		LWLOCK_ACC(waits);
+		LWLOCK_ACC(wait_time);
+#undef LWLOCK_ACC
+		sharedent->max_wait_time = Max(sharedent->max_wait_time,
+									   pendingent->max_wait_time);
+	}
+
+	/* done, clear the pending entry */
+	MemSet(pending_LWLockStats, 0, sizeof(pending_LWLockStats));
+
+	LWLockRelease(&stats_shmem->lock);
+
+	have_lwlockstats = false;
+	have_lwlock_acquires = false;
+
+	return false;
+}
+
+void
+pgstat_lwlock_reset_all_cb(TimestampTz ts)
+{
+	PgStatShared_LWLock *stats_shmem = &pgStatLocal.shmem->lwlock;
+
+	LWLockAcquire(&stats_shmem->lock, LW_EXCLUSIVE);
+
+	for (int i = 0; i < LWLOCK_STATS_NUM_ELEMENTS; i++)
+	{
+		memset(&stats_shmem->stats[i], 0, sizeof(PgStat_LWLockStats));
+		stats_shmem->stats[i].stat_reset_timestamp = ts;
+	}
+
+	LWLockRelease(&stats_shmem->lock);
+}
+
+void
+pgstat_lwlock_snapshot_cb(void)
+{
+	PgStatShared_LWLock *stats_shmem = &pgStatLocal.shmem->lwlock;
+
+	LWLockAcquire(&stats_shmem->lock, LW_SHARED);
+
+	memcpy(pgStatLocal.snapshot.lwlock, &stats_shmem->stats,
+		   sizeof(stats_shmem->stats));
+
+	LWLockRelease(&stats_shmem->lock);
+}
+
+/*
+ * Returns pointer to entry with counters for given tranche, or NULL if the
+ * current process shouldn't count anything.
+ */
+static inline PgStat_LWLockStats *
+get_lwlock_entry(uint16 tranche)
+{
+	/*
+	 * Unlike other kinds of statistics, these are counted by every process
+	 * that acquires LWLocks, including the postmaster while it initializes
+	 * shared memory.  Its counts would be duplicated into child processes via
+	 * fork(), so don't count anything there.
+	 */
+	if (!IsUnderPostmaster && IsPostmasterEnvironment)
+		return NULL;
+
+	have_lwlockstats = true;
+
+	if (tranche >= LWTRANCHE_FIRST_USER_DEFINED)
+		return &pending_LWLockStats[LWLOCK_STATS_NUM_ELEMENTS - 1];
+
+	return &pending_LWLockStats[tranche];
+}
@@ -48,6 +48,9 @@ static PgStat_TableStatus *pgstat_prep_relation_pending(Oid rel_id, bool isshare
 static void add_tabstat_xact_level(PgStat_TableStatus *pgstat_info, int nest_level);
 static void ensure_tabstat_xact_level(PgStat_TableStatus *pgstat_info);
 static void save_truncdrop_counters(PgStat_TableXactStatus *trans, bool is_drop);
+static void pgstat_relation_mark_changed(PgStatShared_Relation *shtabentry);
+static bool pgstat_relation_fold_counter(pg_atomic_uint64 *counter,
+										 PgStat_Counter *dst);
 static void restore_truncdrop_counters(PgStat_TableXactStatus *trans);
 
 
@@ -74,6 +77,7 @@ pgstat_copy_relation_stats(Relation dst, Relation src)
 
 	dstshstats = (PgStatShared_Relation *) dst_ref->shared_stats;
 	dstshstats->stats = *srcstats;
+	pgstat_relation_mark_changed(dstshstats);
 
 	pgstat_unlock_entry(dst_ref);
 }
@@ -257,6 +261,8 @@ pgstat_report_vacuum(Oid tableoid, bool shared,
 		tabentry->vacuum_count++;
 	}
 
+	pgstat_relation_mark_changed(shtabentry);
+
 	pgstat_unlock_entry(entry_ref);
 
 	/*
@@ -348,6 +354,8 @@ pgstat_report_analyze(Relation rel,
 		tabentry->analyze_count++;
 	}
 
+	pgstat_relation_mark_changed(shtabentry);
+
 	pgstat_unlock_entry(entry_ref);
 
 	/* see pgstat_report_vacuum() */
@@ -751,6 +759,71 @@ pgstat_twophase_postabort(TransactionId xid, uint16 info,
 		rec->tuples_inserted + rec->tuples_updated;
 }
 
+/*
+ * Return the current relation stats generation, which callers of
+ * pgstat_scan_relation_stats() can remember to later only look at the
+ * relations whose stats changed since.
+ */
+uint64
+pgstat_get_relation_stats_generation(void)
+{
+	return pg_atomic_read_u64(&pgStatLocal.shmem->relstats_generation);
+}
+
+/*
+ * Call callback for the stats of every relation in the current database and
+ * every shared relation, in one pass over the shared stats hash table.
+ *
+ * If since_generation is not 0, only relations whose stats changed after
+ * that generation are visited.  The generation counter restarts at 0 when
+ * the server does, so a caller that finds the current generation to be
+ * lower than the one it remembered should rescan everything.
+ *
+ * Unlike pgstat_fetch_stat_tabentry(), this always reads the current shared
+ * values, regardless of stats_fetch_consistency, and does not populate the
+ * local snapshot.  This avoids a hash lookup and a copy per relation when
+ * a caller wants the stats of many relations at once.  The callback is
+ * invoked while a partition lock of the shared hash table is held, so it
+ * must not access the stats system itself.
+ */
+void
+pgstat_scan_relation_stats(uint64 since_generation,
+						   PgStat_RelationStatsCallback callback, void *arg)
+{
+	dshash_seq_status hstat;
+	PgStatShared_HashEntry *p;
+
+	dshash_seq_init(&hstat, pgStatLocal.shared_hash, false);
+	while ((p = dshash_seq_next(&hstat)) != NULL)
+	{
+		PgStatShared_Relation *shtabentry;
+		PgStat_StatTabEntry tabentry;
+		uint64		generation;
+
+		if (p->key.kind != PGSTAT_KIND_RELATION)
+			continue;
+		if (p->key.dboid != MyDatabaseId && p->key.dboid != InvalidOid)
+			continue;
+		if (p->dropped)
+			continue;
+
+		shtabentry = (PgStatShared_Relation *)
+			dsa_get_address(pgStatLocal.dsa, p->body);
+
+		LWLockAcquire(&shtabentry->header.lock, LW_EXCLUSIVE);
+		pgstat_relation_fold_cb(&shtabentry->header);
+		generation = shtabentry->generation;
+		tabentry = shtabentry->stats;
+		LWLockRelease(&shtabentry->header.lock);
+
+		if (since_generation != 0 && generation <= since_generation)
+			continue;
+
+		callback(p->key.objoid, generation, &tabentry, arg);
+	}
+	dshash_seq_term(&hstat);
+}
+
 /*
  * Flush out pending stats for the entry
  *
@@ -784,6 +857,52 @@ pgstat_relation_flush_cb(PgStat_EntryRef *entry_ref, bool nowait)
 		return true;
 	}
 
+	/*
+	 * If the relation was only read, add the counts to the entry's lock-free
+	 * counters.  Many backends reading the same few hot tables would
+	 * otherwise contend for the entry's lock.
+	 */
+	if (lstats->t_counts.t_tuples_inserted == 0 &&
+		lstats->t_counts.t_tuples_updated == 0 &&
+		lstats->t_counts.t_tuples_deleted == 0 &&
+		lstats->t_counts.t_tuples_hot_updated == 0 &&
+		!lstats->t_counts.t_truncdropped &&
+		lstats->t_counts.t_delta_live_tuples == 0 &&
+		lstats->t_counts.t_delta_dead_tuples == 0 &&
+		lstats->t_counts.t_changed_tuples == 0)
+	{
+		if (lstats->t_counts.t_numscans)
+		{
+			uint64		t = GetCurrentTransactionStopTimestamp();
+			uint64		lastscan = pg_atomic_read_u64(&shtabstats->lastscan);
+
+			pg_atomic_fetch_add_u64(&shtabstats->numscans,
+									lstats->t_counts.t_numscans);
+
+			/* advance lastscan, unless somebody advanced it further */
+			while (lastscan < t)
+			{
+				if (pg_atomic_compare_exchange_u64(&shtabstats->lastscan,
+												   &lastscan, t))
+					break;
+			}
+		}
+		if (lstats->t_counts.t_tuples_returned)
+			pg_atomic_fetch_add_u64(&shtabstats->tuples_returned,
+									lstats->t_counts.t_tuples_returned);
+		if (lstats->t_counts.t_tuples_fetched)
+			pg_atomic_fetch_add_u64(&shtabstats->tuples_fetched,
+									lstats->t_counts.t_tuples_fetched);
+		if (lstats->t_counts.t_blocks_fetched)
+			pg_atomic_fetch_add_u64(&shtabstats->blocks_fetched,
+									lstats->t_counts.t_blocks_fetched);
+		if (lstats->t_counts.t_blocks_hit)
+			pg_atomic_fetch_add_u64(&shtabstats->blocks_hit,
+									lstats->t_counts.t_blocks_hit);
+
+		goto add_to_database;
+	}
+
 	if (!pgstat_lock_entry(entry_ref, nowait))
 		return false;
 
@@ -827,8 +946,11 @@ pgstat_relation_flush_cb(PgStat_EntryRef *entry_ref, bool nowait)
 	/* Likewise for dead_tuples */
 	tabentry->dead_tuples = Max(tabentry->dead_tuples, 0);
 
+	pgstat_relation_mark_changed(shtabstats);
+
 	pgstat_unlock_entry(entry_ref);
 
+add_to_database:
 	/* The entry was successfully flushed, add the same to database stats */
 	dbentry = pgstat_prep_database_pending(dboid);
 	dbentry->tuples_returned += lstats->t_counts.t_tuples_returned;
@@ -842,6 +964,63 @@ pgstat_relation_flush_cb(PgStat_EntryRef *entry_ref, bool nowait)
 	return true;
 }
 
+void
+pgstat_relation_reset_timestamp_cb(PgStatShared_Common *header, TimestampTz ts)
+{
+	/* relations don't track a reset time, but resetting is a change */
+	pgstat_relation_mark_changed((PgStatShared_Relation *) header);
+}
+
+void
+pgstat_relation_init_shmem_cb(PgStatShared_Common *header)
+{
+	PgStatShared_Relation *shtabentry = (PgStatShared_Relation *) header;
+
+	pg_atomic_init_u64(&shtabentry->numscans, 0);
+	pg_atomic_init_u64(&shtabentry->lastscan, 0);
+	pg_atomic_init_u64(&shtabentry->tuples_returned, 0);
+	pg_atomic_init_u64(&shtabentry->tuples_fetched, 0);
+	pg_atomic_init_u64(&shtabentry->blocks_fetched, 0);
+	pg_atomic_init_u64(&shtabentry->blocks_hit, 0);
+}
+
+/*
+ * Move the counts that pgstat_relation_flush_cb() added to the lock-free
+ * counters into the stats proper.  The caller must hold the entry's lock
+ * exclusively.
+ */
+void
+pgstat_relation_fold_cb(PgStatShared_Common *header)
+{
+	PgStatShared_Relation *shtabentry = (PgStatShared_Relation *) header;
+	PgStat_StatTabEntry *tabentry = &shtabentry->stats;
+	bool		changed = false;
+
+	if (pg_atomic_read_u64(&shtabentry->lastscan) != 0)
+	{
+		TimestampTz t;
+
+		t = (TimestampTz) pg_atomic_exchange_u64(&shtabentry->lastscan, 0);
+		if (t > tabentry->lastscan)
+			tabentry->lastscan = t;
+		changed = true;
+	}
+
+	changed |= pgstat_relation_fold_counter(&shtabentry->numscans,
+											&tabentry->numscans);
+	changed |= pgstat_relation_fold_counter(&shtabentry->tuples_returned,
+											&tabentry->tuples_returned);
+	changed |= pgstat_relation_fold_counter(&shtabentry->tuples_fetched,
+											&tabentry->tuples_fetched);
+	changed |= pgstat_relation_fold_counter(&shtabentry->blocks_fetched,
+											&tabentry->blocks_fetched);
+	changed |= pgstat_relation_fold_counter(&shtabentry->blocks_hit,
+											&tabentry->blocks_hit);
+
+	if (changed)
+		pgstat_relation_mark_changed(shtabentry);
+}
+
 void
 pgstat_relation_delete_pending_cb(PgStat_EntryRef *entry_ref)
 {
@@ -945,3 +1124,33 @@ restore_truncdrop_counters(PgStat_TableXactStatus *trans)
 		trans->tuples_deleted = trans->deleted_pre_truncdrop;
 	}
 }
+
+/*
+ * Add a lock-free counter to the corresponding counter of the stats proper,
+ * and zero it.  Returns whether there was anything to add.
+ */
+static bool
+pgstat_relation_fold_counter(pg_atomic_uint64 *counter, PgStat_Counter *dst)
+{
+	uint64		val;
+
+	/* don't dirty the cache line needlessly */
+	if (pg_atomic_read_u64(counter) == 0)
+		return false;
+
+	val = pg_atomic_exchange_u64(counter, 0);
+	*dst += (PgStat_Counter) val;
+
+	return val != 0;
+}
+
+/*
+ * Record that the stats of a relation changed.  The caller must hold the
+ * entry's lock exclusively.
+ */
+static void
+pgstat_relation_mark_changed(PgStatShared_Relation *shtabentry)
+{
+	shtabentry->generation =
+		pg_atomic_add_fetch_u64(&pgStatLocal.shmem->relstats_generation, 1);
+}
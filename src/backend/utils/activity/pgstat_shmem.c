@@ -194,18 +194,23 @@ StatsShmemInit(void)
 		dsa_detach(dsa);
 
 		pg_atomic_init_u64(&ctl->gc_request_count, 1);
+		pg_atomic_init_u64(&ctl->relstats_generation, 0);
 
 
 		/* initialize fixed-numbered stats */
 		LWLockInitialize(&ctl->archiver.lock, LWTRANCHE_PGSTATS_DATA);
 		LWLockInitialize(&ctl->bgwriter.lock, LWTRANCHE_PGSTATS_DATA);
 		LWLockInitialize(&ctl->checkpointer.lock, LWTRANCHE_PGSTATS_DATA);
+		LWLockInitialize(&ctl->lwlock.lock, LWTRANCHE_PGSTATS_DATA);
 		LWLockInitialize(&ctl->slru.lock, LWTRANCHE_PGSTATS_DATA);
 		LWLockInitialize(&ctl->wal.lock, LWTRANCHE_PGSTATS_DATA);
 
+		LWLockInitialize(&ctl->io.lock, LWTRANCHE_PGSTATS_DATA);
 		for (int i = 0; i < BACKEND_NUM_TYPES; i++)
-			LWLockInitialize(&ctl->io.locks[i],
-							 LWTRANCHE_PGSTATS_DATA);
+			for (int io_object = 0; io_object < IOOBJECT_NUM_TYPES; io_object++)
+				for (int io_context = 0; io_context < IOCONTEXT_NUM_TYPES; io_context++)
+					for (int io_op = 0; io_op < IOOP_NUM_TYPES; io_op++)
+						pg_atomic_init_u64(&ctl->io.data[i][io_object][io_context][io_op], 0);
 	}
 	else
 	{
@@ -259,6 +264,7 @@ pgstat_init_entry(PgStat_Kind kind,
 				  PgStatShared_HashEntry *shhashent)
 {
 	/* Create new stats entry. */
+	const PgStat_KindInfo *kind_info = pgstat_get_kind_info(kind);
 	dsa_pointer chunk;
 	PgStatShared_Common *shheader;
 
@@ -271,7 +277,7 @@ pgstat_init_entry(PgStat_Kind kind,
 	pg_atomic_init_u32(&shhashent->refcount, 1);
 	shhashent->dropped = false;
 
-	chunk = dsa_allocate0(pgStatLocal.dsa, pgstat_get_kind_info(kind)->shared_size);
+	chunk = dsa_allocate0(pgStatLocal.dsa, kind_info->shared_size);
 	shheader = dsa_get_address(pgStatLocal.dsa, chunk);
 	shheader->magic = 0xdeadbeef;
 
@@ -280,12 +286,16 @@ pgstat_init_entry(PgStat_Kind kind,
 
 	LWLockInitialize(&shheader->lock, LWTRANCHE_PGSTATS_DATA);
 
+	if (kind_info->init_shmem_cb)
+		kind_info->init_shmem_cb(shheader);
+
 	return shheader;
 }
 
 static PgStatShared_Common *
 pgstat_reinit_entry(PgStat_Kind kind, PgStatShared_HashEntry *shhashent)
 {
+	const PgStat_KindInfo *kind_info = pgstat_get_kind_info(kind);
 	PgStatShared_Common *shheader;
 
 	shheader = dsa_get_address(pgStatLocal.dsa, shhashent->body);
@@ -296,6 +306,13 @@ pgstat_reinit_entry(PgStat_Kind kind, PgStatShared_HashEntry *shhashent)
 
 	/* reinitialize content */
 	Assert(shheader->magic == 0xdeadbeef);
+	if (kind_info->fold_cb)
+	{
+		/* zero the counters outside the stats data too */
+		LWLockAcquire(&shheader->lock, LW_EXCLUSIVE);
+		kind_info->fold_cb(shheader);
+		LWLockRelease(&shheader->lock);
+	}
 	memset(pgstat_get_entry_data(kind, shheader), 0,
 		   pgstat_get_entry_len(kind));
 
@@ -919,6 +936,10 @@ shared_stat_reset_contents(PgStat_Kind kind, PgStatShared_Common *header,
 {
 	const PgStat_KindInfo *kind_info = pgstat_get_kind_info(kind);
 
+	/* zero the counters outside the stats data too */
+	if (kind_info->fold_cb)
+		kind_info->fold_cb(header);
+
 	memset(pgstat_get_entry_data(kind, header), 0,
 		   pgstat_get_entry_len(kind));
 
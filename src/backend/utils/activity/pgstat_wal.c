@@ -105,6 +105,7 @@ pgstat_flush_wal(bool nowait)
 	WALSTAT_ACC(wal_buffers_full);
 	WALSTAT_ACC(wal_write);
 	WALSTAT_ACC(wal_sync);
+	WALSTAT_ACC(wal_sync_grouped);
 	WALSTAT_ACC(wal_write_time);
 	WALSTAT_ACC(wal_sync_time);
 #undef WALSTAT_ACC
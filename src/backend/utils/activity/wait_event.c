@@ -22,6 +22,7 @@
  */
 #include "postgres.h"
 
+#include "executor/instrument.h"
 #include "storage/lmgr.h"		/* for GetLockNameFromTagType */
 #include "storage/lwlock.h"		/* for GetLWLockIdentifier */
 #include "utils/wait_event.h"
@@ -37,6 +38,12 @@ static const char *pgstat_get_wait_io(WaitEventIO w);
 static uint32 local_my_wait_event_info;
 uint32	   *my_wait_event_info = &local_my_wait_event_info;
 
+/* GUC parameter */
+bool		track_wait_timing = false;
+
+/* start time of the current wait, if track_wait_timing is on */
+static instr_time wait_start_time;
+
 
 /*
  * Configure wait event reporting to report wait events to *wait_event_info.
@@ -64,6 +71,42 @@ pgstat_reset_wait_event_storage(void)
 	my_wait_event_info = &local_my_wait_event_info;
 }
 
+/*
+ * Note the start of a wait, for pgstat_wait_timing_end().
+ *
+ * Called by pgstat_report_wait_start() if track_wait_timing is on.
+ */
+void
+pgstat_wait_timing_start(void)
+{
+	INSTR_TIME_SET_CURRENT(wait_start_time);
+}
+
+/*
+ * Add the duration of the wait that is ending to pgWaitUsage, as time spent
+ * waiting in the class of wait_event_info.
+ *
+ * Called by pgstat_report_wait_end() if track_wait_timing is on.  If it was
+ * turned on during the wait, the wait is not counted.
+ */
+void
+pgstat_wait_timing_end(uint32 wait_event_info)
+{
+	uint32		classId = wait_event_info >> 24;
+	instr_time	now;
+
+	if (INSTR_TIME_IS_ZERO(wait_start_time))
+		return;
+
+	if (classId > 0 && classId < WAIT_USAGE_NUM_CLASSES)
+	{
+		INSTR_TIME_SET_CURRENT(now);
+		INSTR_TIME_ACCUM_DIFF(pgWaitUsage.wait_time[classId],
+							  now, wait_start_time);
+	}
+	INSTR_TIME_SET_ZERO(wait_start_time);
+}
+
 /* ----------
  * pgstat_get_wait_event_type() -
  *
@@ -322,6 +365,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_BACKEND_TERMINATION:
 			event_name = "BackendTermination";
 			break;
+		case WAIT_EVENT_BACKUP_WAIT_PARTS:
+			event_name = "BackupWaitParts";
+			break;
 		case WAIT_EVENT_BACKUP_WAIT_WAL_ARCHIVE:
 			event_name = "BackupWaitWalArchive";
 			break;
@@ -346,6 +392,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_EXECUTE_GATHER:
 			event_name = "ExecuteGather";
 			break;
+		case WAIT_EVENT_HASH_AGG_PARTITION:
+			event_name = "HashAggPartition";
+			break;
 		case WAIT_EVENT_HASH_BATCH_ALLOCATE:
 			event_name = "HashBatchAllocate";
 			break;
@@ -403,6 +452,12 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_LOGICAL_SYNC_STATE_CHANGE:
 			event_name = "LogicalSyncStateChange";
 			break;
+		case WAIT_EVENT_MEMORY_CONTEXT_STATS:
+			event_name = "MemoryContextStats";
+			break;
+		case WAIT_EVENT_MERGE_APPEND_READY:
+			event_name = "MergeAppendReady";
+			break;
 		case WAIT_EVENT_MQ_INTERNAL:
 			event_name = "MessageQueueInternal";
 			break;
@@ -424,6 +479,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_PARALLEL_FINISH:
 			event_name = "ParallelFinish";
 			break;
+		case WAIT_EVENT_PARALLEL_SORT_PARTITION:
+			event_name = "ParallelSortPartition";
+			break;
 		case WAIT_EVENT_PROCARRAY_GROUP_UPDATE:
 			event_name = "ProcArrayGroupUpdate";
 			break;
@@ -494,6 +552,9 @@ pgstat_get_wait_timeout(WaitEventTimeout w)
 		case WAIT_EVENT_CHECKPOINT_WRITE_DELAY:
 			event_name = "CheckpointWriteDelay";
 			break;
+		case WAIT_EVENT_CHECKSUM_ENABLE_TEMPTABLE_WAIT:
+			event_name = "ChecksumEnableTemptableWait";
+			break;
 		case WAIT_EVENT_PG_SLEEP:
 			event_name = "PgSleep";
 			break;
@@ -509,6 +570,9 @@ pgstat_get_wait_timeout(WaitEventTimeout w)
 		case WAIT_EVENT_SPIN_DELAY:
 			event_name = "SpinDelay";
 			break;
+		case WAIT_EVENT_SYNC_SCAN_GROUP:
+			event_name = "SyncScanGroup";
+			break;
 		case WAIT_EVENT_VACUUM_DELAY:
 			event_name = "VacuumDelay";
 			break;
@@ -21,6 +21,7 @@
 #include "catalog/pg_type.h"
 #include "funcapi.h"
 #include "libpq/pqformat.h"
+#include "nodes/miscnodes.h"
 #include "nodes/nodeFuncs.h"
 #include "nodes/supportnodes.h"
 #include "optimizer/optimizer.h"
@@ -29,6 +30,7 @@
 #include "utils/arrayaccess.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
+#include "utils/float.h"
 #include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
@@ -99,6 +101,9 @@ static bool ReadArrayStr(char *arrayStr, const char *origStr,
 						 int typlen, bool typbyval, char typalign,
 						 Datum *values, bool *nulls,
 						 bool *hasnulls, int32 *nbytes, Node *escontext);
+static bool ReadArrayElement(FmgrInfo *inputproc, char *str,
+							 Oid typioparam, int32 typmod,
+							 Node *escontext, Datum *result);
 static void ReadArrayBinary(StringInfo buf, int nitems,
 							FmgrInfo *receiveproc, Oid typioparam, int32 typmod,
 							int typlen, bool typbyval, char typalign,
@@ -927,10 +932,10 @@ ReadArrayStr(char *arrayStr,
 		}
 		else
 		{
-			if (!InputFunctionCallSafe(inputproc, itemstart,
-									   typioparam, typmod,
-									   escontext,
-									   &values[i]))
+			if (!ReadArrayElement(inputproc, itemstart,
+								  typioparam, typmod,
+								  escontext,
+								  &values[i]))
 				return false;
 			nulls[i] = false;
 		}
@@ -1031,6 +1036,45 @@ CopyArrayEls(ArrayType *array,
 		*bitmap = bitval;
 }
 
+/*
+ * ReadArrayElement
+ *	 Convert the text form of a non-null array element, like
+ *	 InputFunctionCallSafe.
+ *
+ * Large arrays of integers and floats are common enough that their elements
+ * are worth parsing without going through the function manager.
+ */
+static bool
+ReadArrayElement(FmgrInfo *inputproc, char *str,
+				 Oid typioparam, int32 typmod,
+				 Node *escontext, Datum *result)
+{
+	switch (inputproc->fn_oid)
+	{
+		case F_INT4IN:
+			*result = Int32GetDatum(pg_strtoint32_safe(str, escontext));
+			break;
+		case F_INT8IN:
+			*result = Int64GetDatum(pg_strtoint64_safe(str, escontext));
+			break;
+		case F_FLOAT4IN:
+			*result = Float4GetDatum(float4in_internal(str, NULL, "real", str,
+													   escontext));
+			break;
+		case F_FLOAT8IN:
+			*result = Float8GetDatum(float8in_internal(str, NULL,
+													   "double precision",
+													   str, escontext));
+			break;
+		default:
+			return InputFunctionCallSafe(inputproc, str,
+										 typioparam, typmod,
+										 escontext, result);
+	}
+
+	return !SOFT_ERROR_OCCURRED(escontext);
+}
+
 /*
  * array_out :
  *		   takes the internal representation of an array and returns a string
@@ -1058,6 +1102,7 @@ array_out(PG_FUNCTION_ARGS)
 	 */
 	bool	   *needquotes,
 				needdims = false;
+	char	   *intbuf = NULL;
 	size_t		overall_length;
 	int			nitems,
 				i,
@@ -1135,6 +1180,13 @@ array_out(PG_FUNCTION_ARGS)
 	needquotes = (bool *) palloc(nitems * sizeof(bool));
 	overall_length = 0;
 
+	/*
+	 * Integers are formatted without the function manager, into a single
+	 * buffer for all the items.  They never need quoting.
+	 */
+	if (my_extra->typiofunc == F_INT4OUT || my_extra->typiofunc == F_INT8OUT)
+		intbuf = palloc(nitems * (MAXINT8LEN + 1));
+
 	array_iter_setup(&iter, v);
 
 	for (i = 0; i < nitems; i++)
@@ -1149,10 +1201,22 @@ array_out(PG_FUNCTION_ARGS)
 
 		if (isnull)
 		{
-			values[i] = pstrdup("NULL");
+			if (intbuf)
+				values[i] = strcpy(intbuf + i * (MAXINT8LEN + 1), "NULL");
+			else
+				values[i] = pstrdup("NULL");
 			overall_length += 4;
 			needquote = false;
 		}
+		else if (intbuf)
+		{
+			values[i] = intbuf + i * (MAXINT8LEN + 1);
+			if (my_extra->typiofunc == F_INT4OUT)
+				overall_length += pg_ltoa(DatumGetInt32(itemvalue), values[i]);
+			else
+				overall_length += pg_lltoa(DatumGetInt64(itemvalue), values[i]);
+			needquote = false;
+		}
 		else
 		{
 			values[i] = OutputFunctionCall(&my_extra->proc, itemvalue);
@@ -1253,7 +1317,9 @@ array_out(PG_FUNCTION_ARGS)
 		}
 		else
 			APPENDSTR(values[k]);
-		pfree(values[k++]);
+		if (intbuf == NULL)
+			pfree(values[k]);
+		k++;
 
 		for (i = ndim - 1; i >= 0; i--)
 		{
@@ -1279,6 +1345,8 @@ array_out(PG_FUNCTION_ARGS)
 
 	pfree(values);
 	pfree(needquotes);
+	if (intbuf)
+		pfree(intbuf);
 
 	PG_RETURN_CSTRING(retval);
 }
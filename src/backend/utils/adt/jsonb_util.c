@@ -13,6 +13,7 @@
  */
 #include "postgres.h"
 
+#include "access/detoast.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
 #include "common/hashfn.h"
@@ -41,6 +42,16 @@
 static void fillJsonbValue(JsonbContainer *container, int index,
 						   char *base_addr, uint32 offset,
 						   JsonbValue *result);
+static void fillJsonbValueWithLength(JsonbContainer *container, int index,
+									 char *base_addr, uint32 offset,
+									 int32 len, JsonbValue *result);
+static int	findKeyInObject(JsonbContainer *container,
+							const char *keyVal, int keyLen);
+static int	findKeyInKeyIndex(JsonbContainer *container,
+							  const char *keyVal, int keyLen,
+							  const uint32 **offsets);
+static void appendKeyIndex(StringInfo buffer, JsonbValue *object,
+						   const uint32 *offsets);
 static bool equalsJsonbScalarValue(JsonbValue *a, JsonbValue *b);
 static int	compareJsonbScalarValue(JsonbValue *a, JsonbValue *b);
 static Jsonb *convertToJsonb(JsonbValue *val);
@@ -399,11 +410,8 @@ JsonbValue *
 getKeyJsonValueFromContainer(JsonbContainer *container,
 							 const char *keyVal, int keyLen, JsonbValue *res)
 {
-	JEntry	   *children = container->children;
 	int			count = JsonContainerSize(container);
-	char	   *baseAddr;
-	uint32		stopLow,
-				stopHigh;
+	int			index;
 
 	Assert(JsonContainerIsObject(container));
 
@@ -411,11 +419,121 @@ getKeyJsonValueFromContainer(JsonbContainer *container,
 	if (count <= 0)
 		return NULL;
 
+	if (JsonContainerHasKeyIndex(container))
+	{
+		const uint32 *offsets;
+
+		index = findKeyInKeyIndex(container, keyVal, keyLen, &offsets);
+		if (index < 0)
+			return NULL;
+
+		/* Found our key; the index gives us the value's offset and length */
+		index += count;
+
+		if (!res)
+			res = palloc(sizeof(JsonbValue));
+
+		fillJsonbValueWithLength(container, index,
+								 (char *) (container->children + count * 2),
+								 offsets[index],
+								 offsets[index + 1] - offsets[index],
+								 res);
+
+		return res;
+	}
+
+	index = findKeyInObject(container, keyVal, keyLen);
+	if (index < 0)
+		return NULL;
+
+	/* Found our key, return corresponding value */
+	index += count;
+
+	if (!res)
+		res = palloc(sizeof(JsonbValue));
+
+	fillJsonbValue(container, index, (char *) (container->children + count * 2),
+				   getJsonbOffset(container, index),
+				   res);
+
+	return res;
+}
+
+/*
+ * Like getKeyJsonValueFromContainer() on the root container of a jsonb
+ * datum, but the datum may still be toasted, and only as much of it is
+ * detoasted as is needed to find the key and its value.  That saves a lot
+ * of work when the value of a key is extracted from a big object, as
+ * only the keys come before the values in the object.
+ *
+ * Returns NULL if the datum isn't an object, or the key isn't found.
+ */
+JsonbValue *
+getKeyJsonValueFromToastedJsonb(struct varlena *attr,
+								const char *keyVal, int keyLen,
+								JsonbValue *res)
+{
+	DetoastIterator iter;
+	JsonbContainer *container;
+	int			count;
+	int			index;
+	Size		dataoff;
+	uint32		offset;
+
+	detoast_iterate_init(&iter, attr);
+
+	container = (JsonbContainer *) detoast_iterate(&iter, sizeof(uint32));
+	if (!JsonContainerIsObject(container))
+		return NULL;
+
+	count = JsonContainerSize(container);
+	if (count <= 0)
+		return NULL;
+
+	/* the JEntrys of the keys and the values, then the keys themselves */
+	dataoff = offsetof(JsonbContainer, children) + count * 2 * sizeof(JEntry);
+	container = (JsonbContainer *) detoast_iterate(&iter, dataoff);
+	container = (JsonbContainer *)
+		detoast_iterate(&iter, dataoff + getJsonbOffset(container, count));
+
+	index = findKeyInObject(container, keyVal, keyLen);
+	if (index < 0)
+		return NULL;
+
+	/* and finally the value */
+	index += count;
+	offset = getJsonbOffset(container, index);
+	container = (JsonbContainer *)
+		detoast_iterate(&iter, dataoff + offset +
+						getJsonbLength(container, index));
+
+	if (!res)
+		res = palloc(sizeof(JsonbValue));
+
+	fillJsonbValue(container, index, (char *) container + dataoff, offset,
+				   res);
+
+	return res;
+}
+
+/*
+ * Binary search the keys of a non-empty Jsonb object for a key.
+ *
+ * Returns the index of the key, or -1 if it's not found.  Only the JEntrys
+ * and the keys of the object are looked at.
+ */
+static int
+findKeyInObject(JsonbContainer *container, const char *keyVal, int keyLen)
+{
+	int			count = JsonContainerSize(container);
+	char	   *baseAddr;
+	uint32		stopLow,
+				stopHigh;
+
 	/*
-	 * Binary search the container. Since we know this is an object, account
-	 * for *Pairs* of Jentrys
+	 * Since we know this is an object, account for *Pairs* of Jentrys
 	 */
-	baseAddr = (char *) (children + count * 2);
+	baseAddr = (char *) (container->children + count * 2);
 	stopLow = 0;
 	stopHigh = count;
 	while (stopLow < stopHigh)
@@ -434,19 +552,7 @@ getKeyJsonValueFromContainer(JsonbContainer *container,
 											  keyVal, keyLen);
 
 		if (difference == 0)
-		{
-			/* Found our key, return corresponding value */
-			int			index = stopMiddle + count;
-
-			if (!res)
-				res = palloc(sizeof(JsonbValue));
-
-			fillJsonbValue(container, index, baseAddr,
-						   getJsonbOffset(container, index),
-						   res);
-
-			return res;
-		}
+			return stopMiddle;
 		else
 		{
 			if (difference < 0)
@@ -457,7 +563,60 @@ getKeyJsonValueFromContainer(JsonbContainer *container,
 	}
 
 	/* Not found */
-	return NULL;
+	return -1;
+}
+
+/*
+ * Look up a key in the key index of a non-empty Jsonb object.
+ *
+ * Returns the index of the key, or -1 if it's not found.  *offsets is set to
+ * point to the index's offset array, so that the caller can find the value
+ * without walking the JEntrys.
+ */
+static int
+findKeyInKeyIndex(JsonbContainer *container, const char *keyVal, int keyLen,
+				  const uint32 **offsets)
+{
+	int			count = JsonContainerSize(container);
+	char	   *baseAddr;
+	JEntry		last;
+	const uint32 *keyindex;
+	const uint32 *slots;
+	uint32		mask;
+	uint32		pos;
+
+	Assert(JsonContainerIsObject(container));
+	Assert(count >= JB_KEYINDEX_MIN_PAIRS);
+
+	/* The last value's JEntry holds the end offset of the object's data */
+	baseAddr = (char *) (container->children + count * 2);
+	last = container->children[count * 2 - 1];
+	Assert(JBE_HAS_OFF(last));
+	keyindex = (const uint32 *) (baseAddr + INTALIGN(JBE_OFFLENFLD(last)));
+
+	mask = keyindex[0] - 1;
+	*offsets = &keyindex[1];
+	slots = &keyindex[1 + count * 2 + 1];
+
+	pos = hash_bytes((const unsigned char *) keyVal, keyLen) & mask;
+	for (;;)
+	{
+		uint32		slot = slots[pos];
+		int			i;
+
+		if (slot == 0)
+			break;
+
+		i = slot - 1;
+		if ((*offsets)[i + 1] - (*offsets)[i] == (uint32) keyLen &&
+			memcmp(baseAddr + (*offsets)[i], keyVal, keyLen) == 0)
+			return i;
+
+		pos = (pos + 1) & mask;
+	}
+
+	/* Not found */
+	return -1;
 }
 
 /*
@@ -506,9 +665,24 @@ static void
 fillJsonbValue(JsonbContainer *container, int index,
 			   char *base_addr, uint32 offset,
 			   JsonbValue *result)
+{
+	fillJsonbValueWithLength(container, index, base_addr, offset, -1, result);
+}
+
+/*
+ * Like fillJsonbValue(), but if 'len' isn't -1, it's the known length of the
+ * node's variable-length data, saving a walk over the JEntry array.
+ */
+static void
+fillJsonbValueWithLength(JsonbContainer *container, int index,
+						 char *base_addr, uint32 offset,
+						 int32 len, JsonbValue *result)
 {
 	JEntry		entry = container->children[index];
 
+	if (len < 0 && (JBE_ISSTRING(entry) || JBE_ISCONTAINER(entry)))
+		len = getJsonbLength(container, index);
+
 	if (JBE_ISNULL(entry))
 	{
 		result->type = jbvNull;
@@ -517,7 +691,7 @@ fillJsonbValue(JsonbContainer *container, int index,
 	{
 		result->type = jbvString;
 		result->val.string.val = base_addr + offset;
-		result->val.string.len = getJsonbLength(container, index);
+		result->val.string.len = len;
 		Assert(result->val.string.len >= 0);
 	}
 	else if (JBE_ISNUMERIC(entry))
@@ -541,8 +715,7 @@ fillJsonbValue(JsonbContainer *container, int index,
 		result->type = jbvBinary;
 		/* Remove alignment padding from data pointer and length */
 		result->val.binary.data = (JsonbContainer *) (base_addr + INTALIGN(offset));
-		result->val.binary.len = getJsonbLength(container, index) -
-			(INTALIGN(offset) - offset);
+		result->val.binary.len = len - (INTALIGN(offset) - offset);
 	}
 }
 
@@ -1700,6 +1873,7 @@ convertJsonbObject(StringInfo buffer, JEntry *header, JsonbValue *val, int level
 	int			totallen;
 	uint32		containerheader;
 	int			nPairs = val->val.object.nPairs;
+	uint32	   *offsets = NULL;
 
 	/* Remember where in the buffer this object starts. */
 	base_offset = buffer->len;
@@ -1709,9 +1883,15 @@ convertJsonbObject(StringInfo buffer, JEntry *header, JsonbValue *val, int level
 
 	/*
 	 * Construct the header Jentry and store it in the beginning of the
-	 * variable-length payload.
+	 * variable-length payload.  Large objects get a key index, for which we
+	 * collect the offsets of all keys and values as we go.
 	 */
 	containerheader = nPairs | JB_FOBJECT;
+	if (nPairs >= JB_KEYINDEX_MIN_PAIRS)
+	{
+		containerheader |= JB_FKEYINDEX;
+		offsets = palloc((nPairs * 2 + 1) * sizeof(uint32));
+	}
 	appendToBuffer(buffer, (char *) &containerheader, sizeof(uint32));
 
 	/* Reserve space for the JEntries of the keys and values. */
@@ -1728,6 +1908,9 @@ convertJsonbObject(StringInfo buffer, JEntry *header, JsonbValue *val, int level
 		int			len;
 		JEntry		meta;
 
+		if (offsets)
+			offsets[i] = totallen;
+
 		/*
 		 * Convert key, producing a JEntry and appending its variable-length
 		 * data to buffer
@@ -1763,6 +1946,9 @@ convertJsonbObject(StringInfo buffer, JEntry *header, JsonbValue *val, int level
 		int			len;
 		JEntry		meta;
 
+		if (offsets)
+			offsets[nPairs + i] = totallen;
+
 		/*
 		 * Convert value, producing a JEntry and appending its variable-length
 		 * data to buffer
@@ -1784,15 +1970,25 @@ convertJsonbObject(StringInfo buffer, JEntry *header, JsonbValue *val, int level
 							JENTRY_OFFLENMASK)));
 
 		/*
-		 * Convert each JB_OFFSET_STRIDE'th length to an offset.
+		 * Convert each JB_OFFSET_STRIDE'th length to an offset.  If there's a
+		 * key index, the last value also gets an offset, so that readers can
+		 * find the index directly.
 		 */
-		if (((i + nPairs) % JB_OFFSET_STRIDE) == 0)
+		if (((i + nPairs) % JB_OFFSET_STRIDE) == 0 ||
+			(offsets && i == nPairs - 1))
 			meta = (meta & JENTRY_TYPEMASK) | totallen | JENTRY_HAS_OFF;
 
 		copyToBuffer(buffer, jentry_offset, (char *) &meta, sizeof(JEntry));
 		jentry_offset += sizeof(JEntry);
 	}
 
+	if (offsets)
+	{
+		offsets[nPairs * 2] = totallen;
+		appendKeyIndex(buffer, val, offsets);
+		pfree(offsets);
+	}
+
 	/* Total data size is everything we've appended to buffer */
 	totallen = buffer->len - base_offset;
 
@@ -1807,6 +2003,47 @@ convertJsonbObject(StringInfo buffer, JEntry *header, JsonbValue *val, int level
 	*header = JENTRY_ISCONTAINER | totallen;
 }
 
+/*
+ * Append the key index of a large object to buffer.  'offsets' holds the
+ * start offsets of the object's keys and values, and the end of its data.
+ *
+ * See the comments for JB_KEYINDEX_MIN_PAIRS for the layout.
+ */
+static void
+appendKeyIndex(StringInfo buffer, JsonbValue *object, const uint32 *offsets)
+{
+	int			nPairs = object->val.object.nPairs;
+	uint32		nslots;
+	uint32		mask;
+	uint32	   *slots;
+	int			i;
+
+	/* Keep the load factor at 3/4 or below */
+	nslots = pg_nextpower2_32(nPairs + nPairs / 3 + 1);
+	mask = nslots - 1;
+	slots = palloc0(nslots * sizeof(uint32));
+
+	for (i = 0; i < nPairs; i++)
+	{
+		JsonbValue *key = &object->val.object.pairs[i].key;
+		uint32		pos;
+
+		pos = hash_bytes((const unsigned char *) key->val.string.val,
+						 key->val.string.len) & mask;
+		while (slots[pos] != 0)
+			pos = (pos + 1) & mask;
+		slots[pos] = i + 1;
+	}
+
+	padBufferToInt(buffer);
+	appendToBuffer(buffer, (char *) &nslots, sizeof(uint32));
+	appendToBuffer(buffer, (const char *) offsets,
+				   (nPairs * 2 + 1) * sizeof(uint32));
+	appendToBuffer(buffer, (char *) slots, nslots * sizeof(uint32));
+
+	pfree(slots);
+}
+
 static void
 convertJsonbScalar(StringInfo buffer, JEntry *header, JsonbValue *scalarVal)
 {
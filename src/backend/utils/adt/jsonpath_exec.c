@@ -177,6 +177,8 @@ typedef Numeric (*BinaryArithmFunc) (Numeric num1, Numeric num2, bool *error);
 static JsonPathExecResult executeJsonPath(JsonPath *path, Jsonb *vars,
 										  Jsonb *json, bool throwErrors,
 										  JsonValueList *result, bool useTz);
+static bool executeKeyChain(JsonPathItem *jsp, JsonbValue *jb, bool laxMode,
+							JsonValueList *result, JsonPathExecResult *res);
 static JsonPathExecResult executeItem(JsonPathExecContext *cxt,
 									  JsonPathItem *jsp, JsonbValue *jb, JsonValueList *found);
 static JsonPathExecResult executeItemOptUnwrapTarget(JsonPathExecContext *cxt,
@@ -558,6 +560,11 @@ executeJsonPath(JsonPath *path, Jsonb *vars, Jsonb *json, bool throwErrors,
 				 errdetail("Jsonpath parameters should be encoded as key-value pairs of \"vars\" object.")));
 	}
 
+	/* Simple key chains like '$.a.b' don't need the general executor */
+	if (executeKeyChain(&jsp, &jbv, (path->header & JSONPATH_LAX) != 0,
+						result, &res))
+		return res;
+
 	cxt.vars = vars;
 	cxt.laxMode = (path->header & JSONPATH_LAX) != 0;
 	cxt.ignoreStructuralErrors = cxt.laxMode;
@@ -593,6 +600,83 @@ executeJsonPath(JsonPath *path, Jsonb *vars, Jsonb *json, bool throwErrors,
 	return res;
 }
 
+/*
+ * Fast path for jsonpaths that consist of '$' followed only by member
+ * accessors, like '$.a.b.c', executed on an object.
+ *
+ * The keys are looked up directly with getKeyJsonValueFromContainer(),
+ * without recursion, base object tracking or intermediate value lists.
+ * Returns false if the path or the document needs anything more than that,
+ * such as unwrapping an array in lax mode or reporting a missing key in
+ * strict mode; the caller then runs the general executor.  Otherwise the
+ * result is stored in *res, and the value found, if any, is appended to
+ * 'result'.
+ */
+static bool
+executeKeyChain(JsonPathItem *jsp, JsonbValue *jb, bool laxMode,
+				JsonValueList *result, JsonPathExecResult *res)
+{
+	JsonPathItem item;
+	JsonPathItem next;
+	JsonbContainer *jbc;
+	JsonbValue	buf;
+	JsonbValue *v = NULL;
+
+	if (jsp->type != jpiRoot || !jspGetNext(jsp, &item))
+		return false;
+
+	/* Check that the path is a plain chain of keys before doing anything */
+	next = item;
+	for (;;)
+	{
+		if (next.type != jpiKey)
+			return false;
+		if (!jspGetNext(&next, &next))
+			break;
+	}
+
+	if (JsonbType(jb) != jbvObject)
+		return false;
+	jbc = jb->val.binary.data;
+
+	for (;;)
+	{
+		const char *key;
+		int			keylen;
+		bool		hasNext;
+
+		key = jspGetString(&item, &keylen);
+		hasNext = jspGetNext(&item, &item);
+
+		/* Intermediate values go to a local buffer, the final one is kept */
+		v = getKeyJsonValueFromContainer(jbc, key, keylen,
+										 hasNext ? &buf : NULL);
+		if (v == NULL)
+		{
+			/* strict mode reports a missing key, let the executor do that */
+			if (!laxMode)
+				return false;
+			*res = jperNotFound;
+			return true;
+		}
+
+		if (!hasNext)
+			break;
+
+		if (v->type != jbvBinary || !JsonContainerIsObject(v->val.binary.data))
+			return false;
+		jbc = v->val.binary.data;
+	}
+
+	if (result)
+		JsonValueListAppend(result, v);
+	else
+		pfree(v);
+
+	*res = jperOk;
+	return true;
+}
+
 /*
  * Execute jsonpath with automatic unwrapping of current item in lax mode.
  */
@@ -31,6 +31,37 @@
 #define LIKE_FALSE						0
 #define LIKE_ABORT						(-1)
 
+/*
+ * Shapes of patterns that can be matched without the general matcher.
+ * These are patterns without '_' or escapes, whose only '%' wildcards are at
+ * the start or at the end, leaving a single literal string in between.
+ */
+typedef enum LikePatternKind
+{
+	LIKE_PAT_GENERIC,			/* use MatchText */
+	LIKE_PAT_EXACT,				/* 'lit' */
+	LIKE_PAT_PREFIX,			/* 'lit%' */
+	LIKE_PAT_SUFFIX,			/* '%lit' */
+	LIKE_PAT_SUBSTRING,			/* '%lit%' */
+} LikePatternKind;
+
+/*
+ * Analysis of a LIKE or ILIKE pattern, cached in fn_extra so that it's only
+ * done once per query if the pattern is a constant.
+ */
+typedef struct LikePatternCache
+{
+	char	   *pattern;		/* pattern this analysis is for */
+	int			patlen;
+	LikePatternKind kind;
+	char	   *literal;		/* the literal, lowercased for ILIKE */
+	int			literal_len;
+	/* ILIKE only: */
+	bool		ascii_checked;	/* have we set ascii_folding yet? */
+	bool		ascii_folding;	/* does the collation fold ASCII like C? */
+	bool		locale_is_c;	/* if so, is it the C locale? */
+} LikePatternCache;
+
 
 static int	SB_MatchText(const char *t, int tlen, const char *p, int plen,
 						 pg_locale_t locale, bool locale_is_c);
@@ -48,6 +79,14 @@ static int	SB_IMatchText(const char *t, int tlen, const char *p, int plen,
 
 static int	GenericMatchText(const char *s, int slen, const char *p, int plen, Oid collation);
 static int	Generic_Text_IC_like(text *str, text *pat, Oid collation);
+static LikePatternCache *like_analyze_pattern(FunctionCallInfo fcinfo,
+											  text *pat, bool icase);
+static bool like_ascii_folding(Oid collation, bool *locale_is_c);
+static bool like_is_ascii(const char *s, int len);
+static int	like_literal_match(LikePatternCache *cache, const char *s, int slen,
+							   bool icase);
+static int	Text_like(FunctionCallInfo fcinfo, text *str, text *pat);
+static int	Text_IC_like(FunctionCallInfo fcinfo, text *str, text *pat);
 
 /*--------------------
  * Support routine for MatchText. Compares given multibyte streams
@@ -234,6 +273,284 @@ Generic_Text_IC_like(text *str, text *pat, Oid collation)
 	}
 }
 
+/*
+ * Analyze a LIKE or ILIKE pattern, reusing the cached analysis in fn_extra
+ * if the pattern hasn't changed since the last call.  Returns NULL if we
+ * have nowhere to cache it, as in a DirectFunctionCall.
+ *
+ * The shortcut kinds are only used where matching bytes is exactly what the
+ * general code would do: in UTF8 and single-byte encodings, where a byte
+ * string can't match in the middle of a character, and with deterministic
+ * collations, since the general code rejects the others.  For ILIKE, the
+ * collation must also fold ASCII letters the way the C locale does; see
+ * like_ascii_folding().
+ */
+static LikePatternCache *
+like_analyze_pattern(FunctionCallInfo fcinfo, text *pat, bool icase)
+{
+	LikePatternCache *cache;
+	Oid			collation = PG_GET_COLLATION();
+	char	   *p = VARDATA_ANY(pat);
+	int			plen = VARSIZE_ANY_EXHDR(pat);
+	int			start;
+	int			end;
+	int			i;
+
+	if (fcinfo->flinfo == NULL)
+		return NULL;
+
+	cache = (LikePatternCache *) fcinfo->flinfo->fn_extra;
+	if (cache == NULL)
+	{
+		cache = MemoryContextAllocZero(fcinfo->flinfo->fn_mcxt,
+									   sizeof(LikePatternCache));
+		fcinfo->flinfo->fn_extra = cache;
+	}
+	else if (cache->pattern && cache->patlen == plen &&
+			 memcmp(cache->pattern, p, plen) == 0)
+		return cache;
+
+	if (cache->pattern)
+		pfree(cache->pattern);
+	if (icase && cache->literal)
+		pfree(cache->literal);
+	cache->pattern = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt, Max(plen, 1));
+	memcpy(cache->pattern, p, plen);
+	cache->patlen = plen;
+	cache->kind = LIKE_PAT_GENERIC;
+	cache->literal = NULL;
+	cache->literal_len = 0;
+
+	if (pg_database_encoding_max_length() > 1 &&
+		GetDatabaseEncoding() != PG_UTF8)
+		return cache;
+
+	if (icase)
+	{
+		/* let the general code complain about a missing collation */
+		if (!OidIsValid(collation))
+			return cache;
+		if (!cache->ascii_checked)
+		{
+			cache->ascii_folding = like_ascii_folding(collation,
+													  &cache->locale_is_c);
+			cache->ascii_checked = true;
+		}
+		if (!cache->ascii_folding)
+			return cache;
+	}
+	else if (collation && !lc_ctype_is_c(collation) &&
+			 !pg_locale_deterministic(pg_newlocale_from_collation(collation)))
+		return cache;
+
+	/* Strip leading and trailing '%', and check what's in between */
+	for (start = 0; start < plen && p[start] == '%'; start++)
+		 /* skip */ ;
+	for (end = plen; end > start && p[end - 1] == '%'; end--)
+		 /* skip */ ;
+	for (i = start; i < end; i++)
+	{
+		if (p[i] == '%' || p[i] == '_' || p[i] == '\\')
+			return cache;
+		/* ILIKE folds the pattern too, so it must be ASCII */
+		if (icase && IS_HIGHBIT_SET(p[i]))
+			return cache;
+	}
+
+	cache->literal_len = end - start;
+	if (icase)
+	{
+		/* keep a separate lowercased copy, the pattern is our cache key */
+		cache->literal = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt,
+											Max(cache->literal_len, 1));
+		for (i = 0; i < cache->literal_len; i++)
+			cache->literal[i] = pg_ascii_tolower((unsigned char) p[start + i]);
+	}
+	else
+		cache->literal = cache->pattern + start;
+
+	if (start > 0 && end < plen)
+		cache->kind = LIKE_PAT_SUBSTRING;
+	else if (start > 0)
+		cache->kind = LIKE_PAT_SUFFIX;
+	else if (end < plen)
+		cache->kind = LIKE_PAT_PREFIX;
+	else
+		cache->kind = LIKE_PAT_EXACT;
+
+	return cache;
+}
+
+/*
+ * Does the collation lowercase ASCII letters exactly like the C locale does?
+ *
+ * That's what lets ILIKE compare ASCII input with pg_ascii_tolower().  It's
+ * not true in some locales, for example Turkish ones fold 'I' to a dotless
+ * 'i'.  *locale_is_c is set if the collation is C, in which case non-ASCII
+ * characters aren't folded at all, so the input needn't be ASCII either.
+ */
+static bool
+like_ascii_folding(Oid collation, bool *locale_is_c)
+{
+	static const char letters[] =
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+	pg_locale_t locale;
+	text	   *lowered;
+	int			i;
+
+	*locale_is_c = lc_ctype_is_c(collation);
+	if (*locale_is_c)
+		return true;
+
+	locale = pg_newlocale_from_collation(collation);
+	if (!pg_locale_deterministic(locale))
+		return false;
+
+	lowered = DatumGetTextPP(DirectFunctionCall1Coll(lower, collation,
+													 PointerGetDatum(cstring_to_text(letters))));
+	if (VARSIZE_ANY_EXHDR(lowered) != sizeof(letters) - 1)
+		return false;
+	for (i = 0; i < sizeof(letters) - 1; i++)
+	{
+		if (VARDATA_ANY(lowered)[i] != pg_ascii_tolower((unsigned char) letters[i]))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Is the string entirely ASCII?
+ */
+static bool
+like_is_ascii(const char *s, int len)
+{
+	int			chunklen = len - len % sizeof(Vector8);
+	int			i;
+
+	if (!is_valid_ascii((const unsigned char *) s, chunklen))
+		return false;
+	for (i = chunklen; i < len; i++)
+	{
+		if (IS_HIGHBIT_SET(s[i]))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Match a string against an analyzed pattern that isn't LIKE_PAT_GENERIC.
+ *
+ * For ILIKE, the caller must have checked that the string is ASCII, unless
+ * the collation is C.
+ */
+static int
+like_literal_match(LikePatternCache *cache, const char *s, int slen,
+				   bool icase)
+{
+	const char *lit = cache->literal;
+	int			litlen = cache->literal_len;
+	const char *p;
+	const char *last;
+	int			i;
+
+	if (slen < litlen ||
+		(cache->kind == LIKE_PAT_EXACT && slen != litlen))
+		return LIKE_FALSE;
+
+	switch (cache->kind)
+	{
+		case LIKE_PAT_EXACT:
+		case LIKE_PAT_PREFIX:
+			p = s;
+			break;
+		case LIKE_PAT_SUFFIX:
+			p = s + slen - litlen;
+			break;
+		case LIKE_PAT_SUBSTRING:
+			if (litlen == 0)
+				return LIKE_TRUE;
+			last = s + slen - litlen;
+
+			/*
+			 * Let memchr(), which is usually vectorized, find the candidate
+			 * positions, unless the first character is a letter that could
+			 * appear in either case.
+			 */
+			if (!icase || !isalpha((unsigned char) lit[0]))
+			{
+				for (p = s; p <= last; p++)
+				{
+					p = memchr(p, lit[0], last - p + 1);
+					if (p == NULL)
+						return LIKE_FALSE;
+					for (i = 1; i < litlen; i++)
+					{
+						if ((icase ? pg_ascii_tolower((unsigned char) p[i]) : p[i]) != lit[i])
+							break;
+					}
+					if (i == litlen)
+						return LIKE_TRUE;
+				}
+				return LIKE_FALSE;
+			}
+
+			for (p = s; p <= last; p++)
+			{
+				for (i = 0; i < litlen; i++)
+				{
+					if (pg_ascii_tolower((unsigned char) p[i]) != lit[i])
+						break;
+				}
+				if (i == litlen)
+					return LIKE_TRUE;
+			}
+			return LIKE_FALSE;
+		default:
+			elog(ERROR, "unexpected LIKE pattern kind: %d", (int) cache->kind);
+			return LIKE_ABORT;	/* keep compiler quiet */
+	}
+
+	for (i = 0; i < litlen; i++)
+	{
+		if ((icase ? pg_ascii_tolower((unsigned char) p[i]) : p[i]) != lit[i])
+			return LIKE_FALSE;
+	}
+	return LIKE_TRUE;
+}
+
+/*
+ * LIKE and ILIKE on text, with the pattern analysis cached in fn_extra
+ */
+static int
+Text_like(FunctionCallInfo fcinfo, text *str, text *pat)
+{
+	LikePatternCache *cache = like_analyze_pattern(fcinfo, pat, false);
+	char	   *s = VARDATA_ANY(str);
+	int			slen = VARSIZE_ANY_EXHDR(str);
+
+	if (cache && cache->kind != LIKE_PAT_GENERIC)
+		return like_literal_match(cache, s, slen, false);
+
+	return GenericMatchText(s, slen, VARDATA_ANY(pat),
+							VARSIZE_ANY_EXHDR(pat), PG_GET_COLLATION());
+}
+
+static int
+Text_IC_like(FunctionCallInfo fcinfo, text *str, text *pat)
+{
+	LikePatternCache *cache = like_analyze_pattern(fcinfo, pat, true);
+	char	   *s = VARDATA_ANY(str);
+	int			slen = VARSIZE_ANY_EXHDR(str);
+
+	if (cache && cache->kind != LIKE_PAT_GENERIC &&
+		(cache->locale_is_c || like_is_ascii(s, slen)))
+		return like_literal_match(cache, s, slen, true);
+
+	return Generic_Text_IC_like(str, pat, PG_GET_COLLATION());
+}
+
 /*
  *	interface routines called by the function manager
  */
@@ -286,17 +603,8 @@ textlike(PG_FUNCTION_ARGS)
 	text	   *str = PG_GETARG_TEXT_PP(0);
 	text	   *pat = PG_GETARG_TEXT_PP(1);
 	bool		result;
-	char	   *s,
-			   *p;
-	int			slen,
-				plen;
 
-	s = VARDATA_ANY(str);
-	slen = VARSIZE_ANY_EXHDR(str);
-	p = VARDATA_ANY(pat);
-	plen = VARSIZE_ANY_EXHDR(pat);
-
-	result = (GenericMatchText(s, slen, p, plen, PG_GET_COLLATION()) == LIKE_TRUE);
+	result = (Text_like(fcinfo, str, pat) == LIKE_TRUE);
 
 	PG_RETURN_BOOL(result);
 }
@@ -307,17 +615,8 @@ textnlike(PG_FUNCTION_ARGS)
 	text	   *str = PG_GETARG_TEXT_PP(0);
 	text	   *pat = PG_GETARG_TEXT_PP(1);
 	bool		result;
-	char	   *s,
-			   *p;
-	int			slen,
-				plen;
 
-	s = VARDATA_ANY(str);
-	slen = VARSIZE_ANY_EXHDR(str);
-	p = VARDATA_ANY(pat);
-	plen = VARSIZE_ANY_EXHDR(pat);
-
-	result = (GenericMatchText(s, slen, p, plen, PG_GET_COLLATION()) != LIKE_TRUE);
+	result = (Text_like(fcinfo, str, pat) != LIKE_TRUE);
 
 	PG_RETURN_BOOL(result);
 }
@@ -405,7 +704,7 @@ texticlike(PG_FUNCTION_ARGS)
 	text	   *pat = PG_GETARG_TEXT_PP(1);
 	bool		result;
 
-	result = (Generic_Text_IC_like(str, pat, PG_GET_COLLATION()) == LIKE_TRUE);
+	result = (Text_IC_like(fcinfo, str, pat) == LIKE_TRUE);
 
 	PG_RETURN_BOOL(result);
 }
@@ -417,7 +716,7 @@ texticnlike(PG_FUNCTION_ARGS)
 	text	   *pat = PG_GETARG_TEXT_PP(1);
 	bool		result;
 
-	result = (Generic_Text_IC_like(str, pat, PG_GET_COLLATION()) != LIKE_TRUE);
+	result = (Text_IC_like(fcinfo, str, pat) != LIKE_TRUE);
 
 	PG_RETURN_BOOL(result);
 }
@@ -193,3 +193,104 @@ pg_log_backend_memory_contexts(PG_FUNCTION_ARGS)
 
 	PG_RETURN_BOOL(true);
 }
+
+/*
+ * memory_context_type_name
+ *		Name of a memory context type, as shown by
+ *		pg_get_process_memory_contexts.
+ */
+static const char *
+memory_context_type_name(NodeTag type)
+{
+	switch (type)
+	{
+		case T_AllocSetContext:
+			return "AllocSet";
+		case T_GenerationContext:
+			return "Generation";
+		case T_SlabContext:
+			return "Slab";
+		case T_BumpContext:
+			return "Bump";
+		default:
+			return "???";
+	}
+}
+
+/*
+ * pg_get_process_memory_contexts
+ *		SQL SRF showing the memory contexts of another process.
+ *
+ * The target process is signaled to publish its statistics, and we wait for
+ * them for up to the given timeout in seconds.
+ */
+Datum
+pg_get_process_memory_contexts(PG_FUNCTION_ARGS)
+{
+#define PG_GET_PROCESS_MEMORY_CONTEXTS_COLS	10
+	int			pid = PG_GETARG_INT32(0);
+	double		timeout = PG_GETARG_FLOAT8(1);
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	MemoryContextStatsEntry *entries;
+	int			nentries;
+	int			i;
+
+	if (timeout < 0 || timeout > INT_MAX / 1000)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("\"timeout\" must be between 0 and %d seconds",
+						INT_MAX / 1000)));
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	entries = MemoryContextStatsRequest(pid, (long) (timeout * 1000),
+										&nentries);
+
+	for (i = 0; i < nentries; i++)
+	{
+		MemoryContextStatsEntry *entry = &entries[i];
+		Datum		values[PG_GET_PROCESS_MEMORY_CONTEXTS_COLS];
+		bool		nulls[PG_GET_PROCESS_MEMORY_CONTEXTS_COLS];
+
+		memset(values, 0, sizeof(values));
+		memset(nulls, 0, sizeof(nulls));
+
+		if (entry->name[0] != '\0')
+			values[0] = CStringGetTextDatum(entry->name);
+		else
+			nulls[0] = true;
+
+		if (entry->ident[0] != '\0')
+			values[1] = CStringGetTextDatum(entry->ident);
+		else
+			nulls[1] = true;
+
+		if (entry->parent >= 0 && entries[entry->parent].name[0] != '\0')
+			values[2] = CStringGetTextDatum(entries[entry->parent].name);
+		else
+			nulls[2] = true;
+
+		values[3] = Int32GetDatum(entry->level);
+		values[4] = CStringGetTextDatum(memory_context_type_name(entry->type));
+		values[5] = Int64GetDatum(entry->counters.totalspace);
+		values[6] = Int64GetDatum(entry->counters.nblocks);
+		values[7] = Int64GetDatum(entry->counters.freespace);
+		values[8] = Int64GetDatum(entry->counters.freechunks);
+		values[9] = Int64GetDatum(entry->counters.totalspace -
+								  entry->counters.freespace);
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+
+	return (Datum) 0;
+}
+
+/*
+ * pg_total_backend_memory_allocated
+ *		Return the memory allocated by the memory contexts of all processes.
+ */
+Datum
+pg_total_backend_memory_allocated(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_INT64((int64) MemoryAccountingGetTotal());
+}
@@ -102,6 +102,13 @@ typedef signed char NumericDigit;
 typedef int16 NumericDigit;
 #endif
 
+/*
+ * mul_var() switches to Karatsuba multiplication when the shorter input has
+ * at least this many NBASE digits and the full product is required.  Below
+ * this, the auto-vectorized schoolbook loop is faster.
+ */
+#define MUL_KARATSUBA_THRESHOLD	64
+
 /*
  * The Numeric type as stored on disk.
  *
@@ -552,6 +559,10 @@ static void sub_var(const NumericVar *var1, const NumericVar *var2,
 static void mul_var(const NumericVar *var1, const NumericVar *var2,
 					NumericVar *result,
 					int rscale);
+static void karatsuba_conv(const int64 *a, const int64 *b, int n, int64 *r);
+static void mul_var_karatsuba(const NumericDigit *var1digits, int var1ndigits,
+							  const NumericDigit *var2digits, int var2ndigits,
+							  NumericVar *result);
 static void div_var(const NumericVar *var1, const NumericVar *var2,
 					NumericVar *result,
 					int rscale, bool round);
@@ -4715,6 +4726,20 @@ typedef struct NumericAggState
 	int64		NaNcount;		/* count of NaN values */
 	int64		pInfcount;		/* count of +Inf values */
 	int64		nInfcount;		/* count of -Inf values */
+#ifdef HAVE_INT128
+
+	/*
+	 * Aggregates that don't need sumX2 add values that fit in an int64 once
+	 * scaled by NBASE^isumScale to isumX, rather than to sumX, which is much
+	 * cheaper.  The sum of the inputs is sumX + isumX / NBASE^isumScale.
+	 * isumX cannot overflow, since each of the fewer than 2^63 values added
+	 * to it is less than 2^63 in absolute value.
+	 */
+	bool		isumUsed;		/* has any value been added to isumX? */
+	int			isumScale;		/* isumX is scaled by NBASE^isumScale */
+	int			isumDscale;		/* maximum dscale of values in isumX */
+	int128		isumX;			/* fixed-width part of the sum */
+#endif
 } NumericAggState;
 
 #define NA_TOTAL_COUNT(na) \
@@ -4761,6 +4786,122 @@ makeNumericAggStateCurrentContext(bool calcSumX2)
 	return state;
 }
 
+#ifdef HAVE_INT128
+/*
+ * Convert the fixed-width part of a NumericAggState's sum to a NumericVar.
+ */
+static void
+numeric_agg_isum_to_var(NumericAggState *state, NumericVar *var)
+{
+	int128_to_numericvar(state->isumX, var);
+	if (var->ndigits > 0)
+		var->weight -= state->isumScale;
+	var->dscale = state->isumDscale;
+}
+
+/*
+ * Move the fixed-width part of a NumericAggState's sum into sumX, so that
+ * the whole sum is in sumX.
+ */
+static void
+numeric_agg_isum_flush(NumericAggState *state)
+{
+	NumericVar	tmp_var;
+	MemoryContext old_context;
+
+	if (!state->isumUsed)
+		return;
+
+	init_var(&tmp_var);
+	numeric_agg_isum_to_var(state, &tmp_var);
+
+	old_context = MemoryContextSwitchTo(state->agg_context);
+	accum_sum_add(&state->sumX, &tmp_var);
+	MemoryContextSwitchTo(old_context);
+
+	free_var(&tmp_var);
+
+	state->isumUsed = false;
+	state->isumScale = 0;
+	state->isumDscale = 0;
+	state->isumX = 0;
+}
+
+/*
+ * Try to add a value to the fixed-width part of a NumericAggState's sum.
+ *
+ * The value must fit in an int64 once scaled to isumScale.  A value needing
+ * more fractional digits than isumScale provides moves what we have to sumX,
+ * and starts a new fixed-width sum at its scale.  Returns false, leaving the
+ * value for the caller to add to sumX, if it does not fit.
+ */
+static bool
+numeric_agg_isum_accum(NumericAggState *state, const NumericVar *var)
+{
+	int			scale = (var->dscale + DEC_DIGITS - 1) / DEC_DIGITS;
+	int			shift;
+	int64		val = 0;
+	int			i;
+
+	if (state->isumUsed && scale > state->isumScale)
+		numeric_agg_isum_flush(state);
+	if (!state->isumUsed)
+		state->isumScale = scale;
+
+	/* number of NBASE digits to append to those of the value */
+	shift = var->weight - (var->ndigits - 1) + state->isumScale;
+	if (var->ndigits > 0 && shift < 0)
+		return false;
+
+	for (i = 0; i < var->ndigits; i++)
+	{
+		if (unlikely(pg_mul_s64_overflow(val, NBASE, &val)) ||
+			unlikely(pg_add_s64_overflow(val, var->digits[i], &val)))
+			return false;
+	}
+	if (val != 0)
+	{
+		while (shift-- > 0)
+		{
+			if (unlikely(pg_mul_s64_overflow(val, NBASE, &val)))
+				return false;
+		}
+	}
+
+	if (var->sign == NUMERIC_NEG)
+		val = -val;
+
+	state->isumX += val;
+	state->isumUsed = true;
+	if (var->dscale > state->isumDscale)
+		state->isumDscale = var->dscale;
+
+	return true;
+}
+#endif
+
+/*
+ * Compute the sum of the values accumulated by a NumericAggState, without
+ * modifying it.
+ */
+static void
+numeric_agg_sum_final(NumericAggState *state, NumericVar *result)
+{
+	accum_sum_final(&state->sumX, result);
+
+#ifdef HAVE_INT128
+	if (state->isumUsed)
+	{
+		NumericVar	tmp_var;
+
+		init_var(&tmp_var);
+		numeric_agg_isum_to_var(state, &tmp_var);
+		add_var(result, &tmp_var, result);
+		free_var(&tmp_var);
+	}
+#endif
+}
+
 /*
  * Accumulate a new input value for numeric aggregate functions.
  */
@@ -4798,6 +4939,15 @@ do_numeric_accum(NumericAggState *state, Numeric newval)
 	else if (X.dscale == state->maxScale)
 		state->maxScaleCount++;
 
+#ifdef HAVE_INT128
+	/* if we don't need X^2, try the fixed-width fast path */
+	if (!state->calcSumX2 && numeric_agg_isum_accum(state, &X))
+	{
+		state->N++;
+		return;
+	}
+#endif
+
 	/* if we need X^2, calculate that in short-lived context */
 	if (state->calcSumX2)
 	{
@@ -4853,6 +5003,11 @@ do_numeric_discard(NumericAggState *state, Numeric newval)
 		return true;
 	}
 
+#ifdef HAVE_INT128
+	/* the value is subtracted from sumX, so the whole sum must be there */
+	numeric_agg_isum_flush(state);
+#endif
+
 	/* load processed number in short-lived context */
 	init_var_from_num(newval, &X);
 
@@ -5070,6 +5225,12 @@ numeric_avg_combine(PG_FUNCTION_ARGS)
 		state1->maxScaleCount = state2->maxScaleCount;
 
 		accum_sum_copy(&state1->sumX, &state2->sumX);
+#ifdef HAVE_INT128
+		state1->isumUsed = state2->isumUsed;
+		state1->isumScale = state2->isumScale;
+		state1->isumDscale = state2->isumDscale;
+		state1->isumX = state2->isumX;
+#endif
 
 		MemoryContextSwitchTo(old_context);
 
@@ -5102,6 +5263,22 @@ numeric_avg_combine(PG_FUNCTION_ARGS)
 		accum_sum_combine(&state1->sumX, &state2->sumX);
 
 		MemoryContextSwitchTo(old_context);
+
+#ifdef HAVE_INT128
+		if (state2->isumUsed)
+		{
+			if (state1->isumUsed && state1->isumScale != state2->isumScale)
+				numeric_agg_isum_flush(state1);
+
+			if (!state1->isumUsed)
+			{
+				state1->isumUsed = true;
+				state1->isumScale = state2->isumScale;
+			}
+			state1->isumX += state2->isumX;
+			state1->isumDscale = Max(state1->isumDscale, state2->isumDscale);
+		}
+#endif
 	}
 	PG_RETURN_POINTER(state1);
 }
@@ -5136,6 +5313,18 @@ numeric_avg_serialize(PG_FUNCTION_ARGS)
 	accum_sum_final(&state->sumX, &tmp_var);
 	numericvar_serialize(&buf, &tmp_var);
 
+	/*
+	 * Fixed-width part of sumX.  It's sent as a numeric, which is cheap to
+	 * produce from an int128, so that the format doesn't depend on whether
+	 * the platform has int128.
+	 */
+#ifdef HAVE_INT128
+	numeric_agg_isum_to_var(state, &tmp_var);
+#else
+	zero_var(&tmp_var);
+#endif
+	numericvar_serialize(&buf, &tmp_var);
+
 	/* maxScale */
 	pq_sendint32(&buf, state->maxScale);
 
@@ -5195,6 +5384,24 @@ numeric_avg_deserialize(PG_FUNCTION_ARGS)
 	numericvar_deserialize(&buf, &tmp_var);
 	accum_sum_add(&(result->sumX), &tmp_var);
 
+	/* fixed-width part of sumX */
+	numericvar_deserialize(&buf, &tmp_var);
+#ifdef HAVE_INT128
+	if (tmp_var.ndigits > 0 || tmp_var.dscale > 0)
+	{
+		result->isumUsed = true;
+		result->isumScale = (tmp_var.dscale + DEC_DIGITS - 1) / DEC_DIGITS;
+		result->isumDscale = tmp_var.dscale;
+		if (tmp_var.ndigits > 0)
+			tmp_var.weight += result->isumScale;
+		tmp_var.dscale = 0;
+		if (!numericvar_to_int128(&tmp_var, &result->isumX))
+			elog(ERROR, "invalid fixed-width sum in serialized numeric aggregate state");
+	}
+#else
+	accum_sum_add(&(result->sumX), &tmp_var);
+#endif
+
 	/* maxScale */
 	result->maxScale = pq_getmsgint(&buf, 4);
 
@@ -6071,7 +6278,7 @@ numeric_avg(PG_FUNCTION_ARGS)
 	N_datum = NumericGetDatum(int64_to_numeric(state->N));
 
 	init_var(&sumX_var);
-	accum_sum_final(&state->sumX, &sumX_var);
+	numeric_agg_sum_final(state, &sumX_var);
 	sumX_datum = NumericGetDatum(make_result(&sumX_var));
 	free_var(&sumX_var);
 
@@ -6103,7 +6310,7 @@ numeric_sum(PG_FUNCTION_ARGS)
 		PG_RETURN_NUMERIC(make_result(&const_ninf));
 
 	init_var(&sumX_var);
-	accum_sum_final(&state->sumX, &sumX_var);
+	numeric_agg_sum_final(state, &sumX_var);
 	result = make_result(&sumX_var);
 	free_var(&sumX_var);
 
@@ -8666,6 +8873,25 @@ mul_var(const NumericVar *var1, const NumericVar *var2, NumericVar *result,
 		return;
 	}
 
+	/*
+	 * If both inputs are long and the full product is needed anyway, use
+	 * Karatsuba multiplication, which computes exactly the same digits as
+	 * the schoolbook method below in O(n^1.585) rather than O(n^2) time.
+	 * When the result is truncated, the schoolbook method already skips
+	 * most of the work, so we leave that case alone.
+	 */
+	if (var1ndigits >= MUL_KARATSUBA_THRESHOLD &&
+		res_ndigits == var1ndigits + var2ndigits + 1)
+	{
+		mul_var_karatsuba(var1digits, var1ndigits, var2digits, var2ndigits,
+						  result);
+		result->weight = res_weight;
+		result->sign = res_sign;
+		round_var(result, rscale);
+		strip_var(result);
+		return;
+	}
+
 	/*
 	 * We do the arithmetic in an array "dig[]" of signed int's.  Since
 	 * INT_MAX is noticeably larger than NBASE*NBASE, this gives us headroom
@@ -8784,6 +9010,171 @@ mul_var(const NumericVar *var1, const NumericVar *var2, NumericVar *result,
 }
 
 
+/*
+ * karatsuba_conv() -
+ *
+ *	Compute the convolution r[k] = sum(a[i] * b[j], i + j = k) of two digit
+ *	arrays of equal length n, without propagating carries.  r must have room
+ *	for 2 * n - 1 entries.
+ *
+ *	The coefficients stay non-negative throughout.  Each level of recursion
+ *	at most doubles the input digits it adds together, so they are bounded
+ *	by roughly n^2 * (NBASE - 1)^2 / MUL_KARATSUBA_THRESHOLD, which is well
+ *	within int64 range for any numeric value.
+ */
+static void
+karatsuba_conv(const int64 *a, const int64 *b, int n, int64 *r)
+{
+	int			h;
+	int			k;
+	int64	   *sa;
+	int64	   *sb;
+	int64	   *z0;
+	int64	   *z1;
+	int64	   *z2;
+	int			i;
+	int			j;
+
+	if (n < MUL_KARATSUBA_THRESHOLD)
+	{
+		memset(r, 0, (2 * n - 1) * sizeof(int64));
+		for (i = 0; i < n; i++)
+		{
+			int64		ai = a[i];
+			int64	   *r_i = &r[i];
+
+			if (ai == 0)
+				continue;
+			for (j = 0; j < n; j++)
+				r_i[j] += ai * b[j];
+		}
+		return;
+	}
+
+	/*
+	 * Split each input into a low part of h digits and a high part of
+	 * k >= h digits, so that a = a0 + x^h * a1, and use
+	 *
+	 *	a * b = z0 + x^h * (z1 - z0 - z2) + x^(2h) * z2
+	 *
+	 * where z0 = a0 * b0, z2 = a1 * b1 and z1 = (a0 + a1) * (b0 + b1).
+	 */
+	h = n / 2;
+	k = n - h;
+
+	sa = (int64 *) palloc(2 * k * sizeof(int64));
+	sb = sa + k;
+	z0 = (int64 *) palloc((2 * h - 1 + 2 * (2 * k - 1)) * sizeof(int64));
+	z2 = z0 + 2 * h - 1;
+	z1 = z2 + 2 * k - 1;
+
+	for (i = 0; i < h; i++)
+	{
+		sa[i] = a[i] + a[h + i];
+		sb[i] = b[i] + b[h + i];
+	}
+	if (k > h)
+	{
+		sa[h] = a[n - 1];
+		sb[h] = b[n - 1];
+	}
+
+	karatsuba_conv(a, b, h, z0);
+	karatsuba_conv(a + h, b + h, k, z2);
+	karatsuba_conv(sa, sb, k, z1);
+
+	for (i = 0; i < 2 * h - 1; i++)
+		z1[i] -= z0[i];
+	for (i = 0; i < 2 * k - 1; i++)
+		z1[i] -= z2[i];
+
+	memcpy(r, z0, (2 * h - 1) * sizeof(int64));
+	r[2 * h - 1] = 0;
+	memcpy(r + 2 * h, z2, (2 * k - 1) * sizeof(int64));
+	for (i = 0; i < 2 * k - 1; i++)
+		r[h + i] += z1[i];
+
+	pfree(sa);
+	pfree(z0);
+}
+
+/*
+ * mul_var_karatsuba() -
+ *
+ *	Compute the exact product of two digit arrays using Karatsuba
+ *	multiplication, storing var1ndigits + var2ndigits + 1 digits in result,
+ *	with the same layout as mul_var's accumulator.  var1 must be the shorter
+ *	input; var2 is processed in chunks of var1ndigits digits so that each
+ *	recursive multiplication is balanced.
+ *
+ *	Only result's digits are set; the caller must fill in weight and sign.
+ */
+static void
+mul_var_karatsuba(const NumericDigit *var1digits, int var1ndigits,
+				  const NumericDigit *var2digits, int var2ndigits,
+				  NumericVar *result)
+{
+	int			res_ndigits = var1ndigits + var2ndigits + 1;
+	int			convlen = var1ndigits + var2ndigits - 1;
+	int64	   *a;
+	int64	   *b;
+	int64	   *chunk;
+	int64	   *conv;
+	int64		carry;
+	NumericDigit *res_digits;
+	int			off;
+	int			i;
+
+	a = (int64 *) palloc(2 * var1ndigits * sizeof(int64));
+	b = a + var1ndigits;
+	chunk = (int64 *) palloc((2 * var1ndigits - 1) * sizeof(int64));
+	conv = (int64 *) palloc0(convlen * sizeof(int64));
+
+	for (i = 0; i < var1ndigits; i++)
+		a[i] = var1digits[i];
+
+	for (off = 0; off < var2ndigits; off += var1ndigits)
+	{
+		int			len = Min(var1ndigits, var2ndigits - off);
+		int			nterms = len + var1ndigits - 1;
+
+		for (i = 0; i < len; i++)
+			b[i] = var2digits[off + i];
+		for (; i < var1ndigits; i++)
+			b[i] = 0;
+
+		karatsuba_conv(a, b, var1ndigits, chunk);
+
+		/* terms beyond nterms come from the zero padding */
+		for (i = 0; i < nterms; i++)
+			conv[off + i] += chunk[i];
+	}
+
+	/*
+	 * Propagate carries.  As in mul_var, digit i of the convolution lands in
+	 * digit i + 2 of the result, leaving two leading digits for carries.  The
+	 * result may alias an input, so do this only after we're done reading.
+	 */
+	alloc_var(result, res_ndigits);
+	res_digits = result->digits;
+	carry = 0;
+	for (i = convlen - 1; i >= 0; i--)
+	{
+		int64		newdig = conv[i] + carry;
+
+		carry = newdig / NBASE;
+		res_digits[i + 2] = (NumericDigit) (newdig - carry * NBASE);
+	}
+	res_digits[1] = (NumericDigit) (carry % NBASE);
+	res_digits[0] = (NumericDigit) (carry / NBASE);
+	Assert(carry < NBASE * NBASE);
+
+	pfree(a);
+	pfree(chunk);
+	pfree(conv);
+}
+
+
 /*
  * div_var() -
  *
@@ -138,6 +138,90 @@ PG_STAT_GET_RELENTRY_TIMESTAMPTZ(last_vacuum_time)
 /* pg_stat_get_lastscan */
 PG_STAT_GET_RELENTRY_TIMESTAMPTZ(lastscan)
 
+Datum
+pg_stat_get_relation_stats_generation(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_INT64((int64) pgstat_get_relation_stats_generation());
+}
+
+#define PG_STAT_GET_ALL_RELATION_STATS_COLS	24
+
+/* Emit a relation's stats as a row of pg_stat_get_all_relation_stats() */
+static void
+pg_stat_all_relation_stats_row(Oid relid, uint64 generation,
+							   const PgStat_StatTabEntry *tabentry, void *arg)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) arg;
+	Datum		values[PG_STAT_GET_ALL_RELATION_STATS_COLS] = {0};
+	bool		nulls[PG_STAT_GET_ALL_RELATION_STATS_COLS] = {0};
+	int			i = 0;
+
+#define PG_STAT_ALL_RELATION_STATS_TIMESTAMPTZ(ts) \
+	do { \
+		if ((ts) == 0) \
+			nulls[i++] = true; \
+		else \
+			values[i++] = TimestampTzGetDatum(ts); \
+	} while (0)
+
+	values[i++] = ObjectIdGetDatum(relid);
+	values[i++] = Int64GetDatum((int64) generation);
+	values[i++] = Int64GetDatum(tabentry->numscans);
+	PG_STAT_ALL_RELATION_STATS_TIMESTAMPTZ(tabentry->lastscan);
+	values[i++] = Int64GetDatum(tabentry->tuples_returned);
+	values[i++] = Int64GetDatum(tabentry->tuples_fetched);
+	values[i++] = Int64GetDatum(tabentry->tuples_inserted);
+	values[i++] = Int64GetDatum(tabentry->tuples_updated);
+	values[i++] = Int64GetDatum(tabentry->tuples_deleted);
+	values[i++] = Int64GetDatum(tabentry->tuples_hot_updated);
+	values[i++] = Int64GetDatum(tabentry->live_tuples);
+	values[i++] = Int64GetDatum(tabentry->dead_tuples);
+	values[i++] = Int64GetDatum(tabentry->mod_since_analyze);
+	values[i++] = Int64GetDatum(tabentry->ins_since_vacuum);
+	values[i++] = Int64GetDatum(tabentry->blocks_fetched);
+	values[i++] = Int64GetDatum(tabentry->blocks_hit);
+	PG_STAT_ALL_RELATION_STATS_TIMESTAMPTZ(tabentry->last_vacuum_time);
+	values[i++] = Int64GetDatum(tabentry->vacuum_count);
+	PG_STAT_ALL_RELATION_STATS_TIMESTAMPTZ(tabentry->last_autovacuum_time);
+	values[i++] = Int64GetDatum(tabentry->autovacuum_count);
+	PG_STAT_ALL_RELATION_STATS_TIMESTAMPTZ(tabentry->last_analyze_time);
+	values[i++] = Int64GetDatum(tabentry->analyze_count);
+	PG_STAT_ALL_RELATION_STATS_TIMESTAMPTZ(tabentry->last_autoanalyze_time);
+	values[i++] = Int64GetDatum(tabentry->autoanalyze_count);
+
+#undef PG_STAT_ALL_RELATION_STATS_TIMESTAMPTZ
+
+	Assert(i == PG_STAT_GET_ALL_RELATION_STATS_COLS);
+
+	tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+}
+
+/*
+ * Returns the stats of all relations of the current database and all shared
+ * relations in one pass over the shared stats, optionally only those changed
+ * after the given generation (see pg_stat_get_relation_stats_generation()).
+ */
+Datum
+pg_stat_get_all_relation_stats(PG_FUNCTION_ARGS)
+{
+	int64		since_generation = PG_GETARG_INT64(0);
+	ReturnSetInfo *rsinfo;
+
+	if (since_generation < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("generation must not be negative")));
+
+	InitMaterializedSRF(fcinfo, 0);
+	rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+
+	pgstat_scan_relation_stats((uint64) since_generation,
+							   pg_stat_all_relation_stats_row,
+							   (void *) rsinfo);
+
+	return (Datum) 0;
+}
+
 Datum
 pg_stat_get_function_calls(PG_FUNCTION_ARGS)
 {
@@ -1009,6 +1093,9 @@ PG_STAT_GET_DBENTRY_INT64(blocks_fetched)
 /* pg_stat_get_db_blocks_hit */
 PG_STAT_GET_DBENTRY_INT64(blocks_hit)
 
+/* pg_stat_get_db_cache_resets */
+PG_STAT_GET_DBENTRY_INT64(cache_resets)
+
 /* pg_stat_get_db_conflict_bufferpin */
 PG_STAT_GET_DBENTRY_INT64(conflict_bufferpin)
 
@@ -1018,6 +1105,9 @@ PG_STAT_GET_DBENTRY_INT64(conflict_lock)
 /* pg_stat_get_db_conflict_snapshot */
 PG_STAT_GET_DBENTRY_INT64(conflict_snapshot)
 
+/* pg_stat_get_db_conflict_snapshot_deferred */
+PG_STAT_GET_DBENTRY_INT64(conflict_snapshot_deferred)
+
 /* pg_stat_get_db_conflict_startup_deadlock */
 PG_STAT_GET_DBENTRY_INT64(conflict_startup_deadlock)
 
@@ -1390,7 +1480,7 @@ pg_stat_get_io(PG_FUNCTION_ARGS)
 Datum
 pg_stat_get_wal(PG_FUNCTION_ARGS)
 {
-#define PG_STAT_GET_WAL_COLS	9
+#define PG_STAT_GET_WAL_COLS	10
 	TupleDesc	tupdesc;
 	Datum		values[PG_STAT_GET_WAL_COLS] = {0};
 	bool		nulls[PG_STAT_GET_WAL_COLS] = {0};
@@ -1411,11 +1501,13 @@ pg_stat_get_wal(PG_FUNCTION_ARGS)
 					   INT8OID, -1, 0);
 	TupleDescInitEntry(tupdesc, (AttrNumber) 6, "wal_sync",
 					   INT8OID, -1, 0);
-	TupleDescInitEntry(tupdesc, (AttrNumber) 7, "wal_write_time",
+	TupleDescInitEntry(tupdesc, (AttrNumber) 7, "wal_sync_grouped",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 8, "wal_write_time",
 					   FLOAT8OID, -1, 0);
-	TupleDescInitEntry(tupdesc, (AttrNumber) 8, "wal_sync_time",
+	TupleDescInitEntry(tupdesc, (AttrNumber) 9, "wal_sync_time",
 					   FLOAT8OID, -1, 0);
-	TupleDescInitEntry(tupdesc, (AttrNumber) 9, "stats_reset",
+	TupleDescInitEntry(tupdesc, (AttrNumber) 10, "stats_reset",
 					   TIMESTAMPTZOID, -1, 0);
 
 	BlessTupleDesc(tupdesc);
@@ -1437,12 +1529,13 @@ pg_stat_get_wal(PG_FUNCTION_ARGS)
 	values[3] = Int64GetDatum(wal_stats->wal_buffers_full);
 	values[4] = Int64GetDatum(wal_stats->wal_write);
 	values[5] = Int64GetDatum(wal_stats->wal_sync);
+	values[6] = Int64GetDatum(wal_stats->wal_sync_grouped);
 
 	/* Convert counters from microsec to millisec for display */
-	values[6] = Float8GetDatum(((double) wal_stats->wal_write_time) / 1000.0);
-	values[7] = Float8GetDatum(((double) wal_stats->wal_sync_time) / 1000.0);
+	values[7] = Float8GetDatum(((double) wal_stats->wal_write_time) / 1000.0);
+	values[8] = Float8GetDatum(((double) wal_stats->wal_sync_time) / 1000.0);
 
-	values[8] = TimestampTzGetDatum(wal_stats->stat_reset_timestamp);
+	values[9] = TimestampTzGetDatum(wal_stats->stat_reset_timestamp);
 
 	/* Returns the record as Datum */
 	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
@@ -1495,6 +1588,56 @@ pg_stat_get_slru(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+/*
+ * Returns statistics of LWLock tranches.
+ */
+Datum
+pg_stat_get_lwlock(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_LWLOCK_COLS	8
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	int			i;
+	PgStat_LWLockStats *stats;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	/* request LWLock stats from the cumulative stats system */
+	stats = pgstat_fetch_lwlock();
+
+	for (i = 0;; i++)
+	{
+		/* for each row */
+		Datum		values[PG_STAT_GET_LWLOCK_COLS] = {0};
+		bool		nulls[PG_STAT_GET_LWLOCK_COLS] = {0};
+		PgStat_LWLockStats stat;
+		const char *name;
+
+		name = pgstat_get_lwlock_name(i);
+
+		if (!name)
+			break;
+
+		/* skip the gaps left by individual LWLocks that were removed */
+		if (strncmp(name, "<unassigned:", 12) == 0)
+			continue;
+
+		stat = stats[i];
+
+		values[0] = PointerGetDatum(cstring_to_text(name));
+		values[1] = Int64GetDatum(stat.acquires);
+		values[2] = Int64GetDatum(stat.contended);
+		values[3] = Int64GetDatum(stat.spin_acquires);
+		values[4] = Int64GetDatum(stat.waits);
+		values[5] = Float8GetDatum(((double) stat.wait_time) / 1000.0);
+		values[6] = Float8GetDatum(((double) stat.max_wait_time) / 1000.0);
+		values[7] = TimestampTzGetDatum(stat.stat_reset_timestamp);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	return (Datum) 0;
+}
+
 Datum
 pg_stat_get_xact_numscans(PG_FUNCTION_ARGS)
 {
@@ -1750,6 +1893,8 @@ pg_stat_reset_shared(PG_FUNCTION_ARGS)
 	}
 	else if (strcmp(target, "io") == 0)
 		pgstat_reset_of_kind(PGSTAT_KIND_IO);
+	else if (strcmp(target, "lwlock") == 0)
+		pgstat_reset_of_kind(PGSTAT_KIND_LWLOCK);
 	else if (strcmp(target, "recovery_prefetch") == 0)
 		XLogPrefetchResetStats();
 	else if (strcmp(target, "wal") == 0)
@@ -1758,7 +1903,7 @@ pg_stat_reset_shared(PG_FUNCTION_ARGS)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("unrecognized reset target: \"%s\"", target),
-				 errhint("Target must be \"archiver\", \"bgwriter\", \"io\", \"recovery_prefetch\", or \"wal\".")));
+				 errhint("Target must be \"archiver\", \"bgwriter\", \"io\", \"lwlock\", \"recovery_prefetch\", or \"wal\".")));
 
 	PG_RETURN_VOID();
 }
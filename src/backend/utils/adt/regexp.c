@@ -104,13 +104,24 @@ typedef struct cached_re_str
 	int			cre_flags;		/* compile flags: extended,icase etc */
 	Oid			cre_collation;	/* collation to use */
 	regex_t		cre_re;			/* the compiled regular expression */
+	char	   *cre_literal;	/* literal every match contains, or NULL */
+	int			cre_literal_len;	/* length of cre_literal, in bytes */
 } cached_re_str;
 
+/* required literals shorter than this aren't worth a prefilter pass */
+#define RE_MIN_LITERAL_LEN	2
+
 static int	num_res = 0;		/* # of cached re's */
 static cached_re_str re_array[MAX_CACHED_RES];	/* cached re's */
 
 
 /* Local functions */
+static cached_re_str *RE_compile_and_cache_entry(text *text_re, int cflags,
+												 Oid collation);
+static char *RE_extract_literal(const char *pat, int pat_len, int cflags,
+								int *literal_len);
+static bool RE_literal_present(const char *dat, int dat_len,
+							   const char *literal, int literal_len);
 static regexp_matches_ctx *setup_regexp_matches(text *orig_str, text *pattern,
 												pg_re_flags *re_flags,
 												int start_search,
@@ -136,6 +147,17 @@ static Datum build_regexp_split_result(regexp_matches_ctx *splitctx);
  */
 regex_t *
 RE_compile_and_cache(text *text_re, int cflags, Oid collation)
+{
+	return &RE_compile_and_cache_entry(text_re, cflags, collation)->cre_re;
+}
+
+/*
+ * RE_compile_and_cache_entry - workhorse for RE_compile_and_cache
+ *
+ * Returns the cache entry, which is valid until the next call.
+ */
+static cached_re_str *
+RE_compile_and_cache_entry(text *text_re, int cflags, Oid collation)
 {
 	int			text_re_len = VARSIZE_ANY_EXHDR(text_re);
 	char	   *text_re_val = VARDATA_ANY(text_re);
@@ -168,7 +190,7 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 				re_array[0] = re_temp;
 			}
 
-			return &re_array[0].cre_re;
+			return &re_array[0];
 		}
 	}
 
@@ -227,6 +249,8 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 	re_temp.cre_pat_len = text_re_len;
 	re_temp.cre_flags = cflags;
 	re_temp.cre_collation = collation;
+	re_temp.cre_literal = RE_extract_literal(text_re_val, text_re_len, cflags,
+											 &re_temp.cre_literal_len);
 
 	/*
 	 * Okay, we have a valid new item in re_temp; insert it into the storage
@@ -238,6 +262,8 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 		Assert(num_res < MAX_CACHED_RES);
 		pg_regfree(&re_array[num_res].cre_re);
 		free(re_array[num_res].cre_pat);
+		if (re_array[num_res].cre_literal)
+			free(re_array[num_res].cre_literal);
 	}
 
 	if (num_res > 0)
@@ -246,7 +272,197 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 	re_array[0] = re_temp;
 	num_res++;
 
-	return &re_array[0].cre_re;
+	return &re_array[0];
+}
+
+/*
+ * RE_extract_literal - find a literal string that every match must contain
+ *
+ * Returns a malloc'd copy of the longest run of ordinary characters at the
+ * top level of the pattern, or NULL if there's none of at least
+ * RE_MIN_LITERAL_LEN bytes, or if the pattern uses features that we don't
+ * analyze.  This is deliberately conservative: every character we report
+ * must be matched literally by any match, so anything we aren't sure about
+ * just ends the current run.  Out-of-memory is treated as "no literal".
+ *
+ * The pattern is known to compile, so we needn't worry about syntax errors.
+ */
+static char *
+RE_extract_literal(const char *pat, int pat_len, int cflags, int *literal_len)
+{
+	const char *best = NULL;
+	int			best_len = 0;
+	const char *run = NULL;
+	const char *lastchar = NULL;
+	int			depth = 0;
+	int			i = 0;
+	char	   *result;
+
+	/* case-insensitive and expanded syntax are too hard, BREs too rare */
+	if (cflags & (REG_ICASE | REG_EXPANDED))
+		return NULL;
+
+	if (cflags & REG_QUOTE)
+	{
+		best = pat;
+		best_len = pat_len;
+	}
+	else if (!(cflags & (REG_ADVANCED | REG_EXTENDED)))
+		return NULL;
+	else
+	{
+		bool		are = (cflags & REG_ADVANCED) != 0;
+
+		/* ARE directors and embedded options can change everything */
+		if (are && pat_len >= 2 &&
+			((pat[0] == '*' && pat[1] == '*') ||
+			 (pat[0] == '(' && pat[1] == '?')))
+			return NULL;
+
+#define END_RUN() \
+		do { \
+			if (run && depth == 0 && i - (run - pat) > best_len) \
+			{ \
+				best = run; \
+				best_len = i - (run - pat); \
+			} \
+			run = NULL; \
+		} while (0)
+
+		while (i < pat_len)
+		{
+			char		c = pat[i];
+
+			switch (c)
+			{
+				case '|':
+					/* alternation at the top level: nothing is required */
+					if (depth == 0)
+						return NULL;
+					i++;
+					break;
+				case '*':
+				case '+':
+				case '?':
+				case '{':
+					/* the preceding literal character is optional */
+					if (run)
+					{
+						int			qpos = i;
+
+						Assert(lastchar != NULL);
+						i = lastchar - pat;
+						END_RUN();
+						i = qpos;
+					}
+					run = NULL;
+					if (c == '{')
+					{
+						while (i < pat_len && pat[i] != '}')
+							i++;
+					}
+					i++;
+					break;
+				case '(':
+					END_RUN();
+					depth++;
+					i++;
+					break;
+				case ')':
+					END_RUN();
+					depth--;
+					i++;
+					break;
+				case '\\':
+					END_RUN();
+					i++;
+					if (i < pat_len)
+						i += pg_mblen(pat + i);
+					break;
+				case '[':
+					END_RUN();
+					i++;
+					if (i < pat_len && pat[i] == '^')
+						i++;
+					if (i < pat_len && pat[i] == ']')
+						i++;
+					while (i < pat_len && pat[i] != ']')
+					{
+						if (pat[i] == '[' && i + 1 < pat_len &&
+							(pat[i + 1] == ':' || pat[i + 1] == '.' ||
+							 pat[i + 1] == '='))
+						{
+							char		delim = pat[i + 1];
+
+							/* skip [:class:], [.coll.] or [=equiv=] */
+							i += 2;
+							while (i + 1 < pat_len &&
+								   !(pat[i] == delim && pat[i + 1] == ']'))
+								i++;
+							i += 2;
+						}
+						else if (are && pat[i] == '\\' && i + 1 < pat_len)
+							i += 1 + pg_mblen(pat + i + 1);
+						else
+							i += pg_mblen(pat + i);
+					}
+					i++;
+					break;
+				case '^':
+				case '$':
+				case '.':
+				case '}':
+					END_RUN();
+					i++;
+					break;
+				default:
+					if (run == NULL)
+						run = pat + i;
+					lastchar = pat + i;
+					i += pg_mblen(pat + i);
+					break;
+			}
+		}
+		END_RUN();
+
+#undef END_RUN
+	}
+
+	if (best_len < RE_MIN_LITERAL_LEN)
+		return NULL;
+
+	result = malloc(best_len);
+	if (result == NULL)
+		return NULL;
+	memcpy(result, best, best_len);
+	*literal_len = best_len;
+	return result;
+}
+
+/*
+ * RE_literal_present - does the data contain the given literal?
+ *
+ * memchr() is usually vectorized by the C library, so let it find the
+ * candidate positions.
+ */
+static bool
+RE_literal_present(const char *dat, int dat_len,
+				   const char *literal, int literal_len)
+{
+	const char *p = dat;
+	const char *last = dat + dat_len - literal_len;
+
+	while (p <= last)
+	{
+		p = memchr(p, literal[0], last - p + 1);
+		if (p == NULL)
+			return false;
+		if (memcmp(p + 1, literal + 1, literal_len - 1) == 0)
+			return true;
+		p++;
+	}
+
+	return false;
 }
 
 /*
@@ -345,16 +561,25 @@ RE_compile_and_execute(text *text_re, char *dat, int dat_len,
 					   int cflags, Oid collation,
 					   int nmatch, regmatch_t *pmatch)
 {
-	regex_t    *re;
+	cached_re_str *cre;
 
 	/* Use REG_NOSUB if caller does not want sub-match details */
 	if (nmatch < 2)
 		cflags |= REG_NOSUB;
 
 	/* Compile RE */
-	re = RE_compile_and_cache(text_re, cflags, collation);
+	cre = RE_compile_and_cache_entry(text_re, cflags, collation);
+
+	/*
+	 * If every match must contain some literal string, and the data doesn't,
+	 * we needn't convert the data and run the regex engine at all.
+	 */
+	if (cre->cre_literal &&
+		!RE_literal_present(dat, dat_len,
+							cre->cre_literal, cre->cre_literal_len))
+		return false;
 
-	return RE_execute(re, dat, dat_len, nmatch, pmatch);
+	return RE_execute(&cre->cre_re, dat, dat_len, nmatch, pmatch);
 }
 
 
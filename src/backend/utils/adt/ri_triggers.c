@@ -23,11 +23,13 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
 #include "access/htup_details.h"
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "access/tableam.h"
 #include "access/xact.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_operator.h"
@@ -111,6 +113,7 @@ typedef struct RI_ConstraintInfo
 	NameData	conname;		/* name of the FK constraint */
 	Oid			pk_relid;		/* referenced relation */
 	Oid			fk_relid;		/* referencing relation */
+	Oid			conindid;		/* unique index on referenced columns */
 	char		confupdtype;	/* foreign key's ON UPDATE action */
 	char		confdeltype;	/* foreign key's ON DELETE action */
 	int			ndelsetcols;	/* number of columns referenced in ON DELETE
@@ -219,6 +222,12 @@ static const RI_ConstraintInfo *ri_LoadConstraintInfo(Oid constraintOid);
 static Oid	get_ri_constraint_root(Oid constrOid);
 static SPIPlanPtr ri_PlanCheck(const char *querystr, int nargs, Oid *argtypes,
 							   RI_QueryKey *qkey, Relation fk_rel, Relation pk_rel);
+static bool ri_FastPathCheck(const RI_ConstraintInfo *riinfo,
+							 Relation fk_rel, Relation pk_rel,
+							 TupleTableSlot *newslot);
+static bool ri_FastPathLockPK(const RI_ConstraintInfo *riinfo,
+							  Relation pk_rel, TupleTableSlot *slot,
+							  Snapshot snapshot, const Datum *vals);
 static bool ri_PerformCheck(const RI_ConstraintInfo *riinfo,
 							RI_QueryKey *qkey, SPIPlanPtr qplan,
 							Relation fk_rel, Relation pk_rel,
@@ -343,6 +352,16 @@ RI_FKey_check(TriggerData *trigdata)
 			break;
 	}
 
+	/*
+	 * In the common case of a plain table referenced through a btree index,
+	 * probe the index directly rather than going through SPI.
+	 */
+	if (ri_FastPathCheck(riinfo, fk_rel, pk_rel, newslot))
+	{
+		table_close(pk_rel, RowShareLock);
+		return PointerGetDatum(NULL);
+	}
+
 	if (SPI_connect() != SPI_OK_CONNECT)
 		elog(ERROR, "SPI_connect failed");
 
@@ -2162,6 +2181,7 @@ ri_LoadConstraintInfo(Oid constraintOid)
 	memcpy(&riinfo->conname, &conForm->conname, sizeof(NameData));
 	riinfo->pk_relid = conForm->confrelid;
 	riinfo->fk_relid = conForm->conrelid;
+	riinfo->conindid = conForm->conindid;
 	riinfo->confupdtype = conForm->confupdtype;
 	riinfo->confdeltype = conForm->confdeltype;
 	riinfo->confmatchtype = conForm->confmatchtype;
@@ -2445,6 +2465,229 @@ ri_PerformCheck(const RI_ConstraintInfo *riinfo,
 	return SPI_processed != 0;
 }
 
+/*
+ * ri_FastPathCheck -
+ *
+ * Do the work of RI_FKey_check's SELECT ... FOR KEY SHARE query by scanning
+ * the PK table's unique index and locking the row found, without SPI and
+ * executor startup for every checked row.  This has to give exactly the
+ * query's results, so it is only used when the index scan is known to be
+ * equivalent to the query's quals: a plain (not partitioned) PK table
+ * without row-level security, a btree index whose operators and collations
+ * are those of the constraint, and FK column types that need no coercion.
+ *
+ * Returns false if the check has to be made with the query instead.
+ * Otherwise the check has been made, and any violation reported.
+ */
+static bool
+ri_FastPathCheck(const RI_ConstraintInfo *riinfo,
+				 Relation fk_rel, Relation pk_rel,
+				 TupleTableSlot *newslot)
+{
+	Relation	idxrel;
+	Oid			owner = RelationGetForm(pk_rel)->relowner;
+	ScanKeyData skey[RI_MAX_NUMKEYS];
+	Datum		vals[RI_MAX_NUMKEYS];
+	char		nulls[RI_MAX_NUMKEYS];
+	IndexScanDesc scan;
+	TupleTableSlot *slot;
+	Snapshot	snapshot;
+	Oid			save_userid;
+	int			save_sec_context;
+	bool		found = false;
+
+	if (pk_rel->rd_rel->relkind != RELKIND_RELATION ||
+		pk_rel->rd_rel->relrowsecurity ||
+		!OidIsValid(riinfo->conindid))
+		return false;
+
+	/* The query is run as the PK table's owner, and needs these rights */
+	if (pg_class_aclcheck(RelationGetRelid(pk_rel), owner,
+						  ACL_SELECT) != ACLCHECK_OK ||
+		pg_class_aclcheck(RelationGetRelid(pk_rel), owner,
+						  ACL_UPDATE) != ACLCHECK_OK)
+		return false;
+
+	idxrel = index_open(riinfo->conindid, AccessShareLock);
+
+	if (idxrel->rd_rel->relam != BTREE_AM_OID ||
+		idxrel->rd_index->indrelid != RelationGetRelid(pk_rel) ||
+		IndexRelationGetNumberOfKeyAttributes(idxrel) != riinfo->nkeys)
+	{
+		index_close(idxrel, AccessShareLock);
+		return false;
+	}
+
+	ri_ExtractValues(fk_rel, newslot, riinfo, false, vals, nulls);
+
+	/* Build scan keys in index column order, as btree wants them */
+	for (int j = 0; j < riinfo->nkeys; j++)
+	{
+		AttrNumber	pkattno = idxrel->rd_index->indkey.values[j];
+		int			i;
+		Oid			eq_opr;
+		int			strategy;
+		Oid			lefttype;
+		Oid			righttype;
+
+		for (i = 0; i < riinfo->nkeys; i++)
+		{
+			if (riinfo->pk_attnums[i] == pkattno)
+				break;
+		}
+		if (i >= riinfo->nkeys)
+		{
+			index_close(idxrel, AccessShareLock);
+			return false;
+		}
+
+		eq_opr = riinfo->pf_eq_oprs[i];
+		if (!op_in_opfamily(eq_opr, idxrel->rd_opfamily[j]))
+		{
+			index_close(idxrel, AccessShareLock);
+			return false;
+		}
+		get_op_opfamily_properties(eq_opr, idxrel->rd_opfamily[j], false,
+								   &strategy, &lefttype, &righttype);
+		if (strategy != BTEqualStrategyNumber ||
+			lefttype != idxrel->rd_opcintype[j] ||
+			righttype != RIAttType(fk_rel, riinfo->fk_attnums[i]) ||
+			idxrel->rd_indcollation[j] != RIAttCollation(pk_rel, pkattno))
+		{
+			index_close(idxrel, AccessShareLock);
+			return false;
+		}
+
+		ScanKeyEntryInitialize(&skey[j], 0, j + 1, BTEqualStrategyNumber,
+							   righttype, idxrel->rd_indcollation[j],
+							   get_opcode(eq_opr), vals[i]);
+	}
+
+	/* Run as the PK table's owner, as the query would */
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(owner,
+						   save_sec_context | SECURITY_LOCAL_USERID_CHANGE |
+						   SECURITY_NOFORCE_RLS);
+
+	/*
+	 * Take the same snapshot SPI would for a non-read-only query: a fresh
+	 * one in READ COMMITTED mode, the transaction snapshot otherwise, with
+	 * our own work so far visible.
+	 */
+	PushActiveSnapshot(GetTransactionSnapshot());
+	CommandCounterIncrement();
+	UpdateActiveSnapshotCommandId();
+	snapshot = GetActiveSnapshot();
+
+	slot = table_slot_create(pk_rel, NULL);
+	scan = index_beginscan(pk_rel, idxrel, snapshot, riinfo->nkeys, 0);
+	index_rescan(scan, skey, riinfo->nkeys, NULL, 0);
+
+	while (index_getnext_slot(scan, ForwardScanDirection, slot))
+	{
+		if (ri_FastPathLockPK(riinfo, pk_rel, slot, snapshot, vals))
+		{
+			found = true;
+			break;
+		}
+	}
+
+	index_endscan(scan);
+	ExecDropSingleTupleTableSlot(slot);
+	PopActiveSnapshot();
+
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+
+	index_close(idxrel, NoLock);
+
+	if (!found)
+		ri_ReportViolation(riinfo, pk_rel, fk_rel, newslot, NULL,
+						   RI_PLAN_CHECK_LOOKUPPK, false);
+
+	return true;
+}
+
+/*
+ * ri_FastPathLockPK -
+ *
+ * Lock the PK row in *slot FOR KEY SHARE, handling concurrent updates the way
+ * the executor's LockRows node does.  Returns true if the row was locked and
+ * (if a newer version had to be locked) still has the referenced key.
+ */
+static bool
+ri_FastPathLockPK(const RI_ConstraintInfo *riinfo, Relation pk_rel,
+				  TupleTableSlot *slot, Snapshot snapshot, const Datum *vals)
+{
+	ItemPointerData tid = slot->tts_tid;
+	TM_FailureData tmfd;
+	TM_Result	test;
+	int			lockflags;
+
+	lockflags = TUPLE_LOCK_FLAG_LOCK_UPDATE_IN_PROGRESS;
+	if (!IsolationUsesXactSnapshot())
+		lockflags |= TUPLE_LOCK_FLAG_FIND_LAST_VERSION;
+
+	test = table_tuple_lock(pk_rel, &tid, snapshot, slot,
+							GetCurrentCommandId(false),
+							LockTupleKeyShare, LockWaitBlock,
+							lockflags, &tmfd);
+
+	switch (test)
+	{
+		case TM_SelfModified:
+			/* updated or deleted later in our own transaction; ignore it */
+			return false;
+
+		case TM_Ok:
+			break;
+
+		case TM_Updated:
+			if (IsolationUsesXactSnapshot())
+				ereport(ERROR,
+						(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+						 errmsg("could not serialize access due to concurrent update")));
+			elog(ERROR, "unexpected table_tuple_lock status: %u", test);
+			break;
+
+		case TM_Deleted:
+			if (IsolationUsesXactSnapshot())
+				ereport(ERROR,
+						(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+						 errmsg("could not serialize access due to concurrent update")));
+			return false;
+
+		case TM_Invisible:
+			elog(ERROR, "attempted to lock invisible tuple");
+			break;
+
+		default:
+			elog(ERROR, "unrecognized table_tuple_lock status: %u", test);
+	}
+
+	/*
+	 * If we had to follow the update chain to lock the latest version of the
+	 * row, make sure that version still has the key we're looking for; this
+	 * is what EvalPlanQual rechecking does for the query.
+	 */
+	if (tmfd.traversed)
+	{
+		for (int i = 0; i < riinfo->nkeys; i++)
+		{
+			Datum		pkval;
+			bool		isnull;
+
+			pkval = slot_getattr(slot, riinfo->pk_attnums[i], &isnull);
+			if (isnull ||
+				!DatumGetBool(OidFunctionCall2Coll(get_opcode(riinfo->pf_eq_oprs[i]),
+												   RIAttCollation(pk_rel, riinfo->pk_attnums[i]),
+												   pkval, vals[i])))
+				return false;
+		}
+	}
+
+	return true;
+}
+
 /*
  * Extract fields from a tuple into Datum/nulls arrays
  */
@@ -6666,6 +6666,115 @@ add_predicate_to_index_quals(IndexOptInfo *index, List *indexQuals)
 }
 
 
+/*
+ * btcostestimate_skipscan
+ *		Estimate the cost of a btree skip scan, and use it if it's cheaper
+ *
+ * A skip scan is used when there are quals on the second index column but
+ * not on the first.  It performs one primitive index scan for each distinct
+ * value of the first column, in which the second column's quals act as
+ * boundary quals.  Each of those costs two descents of the tree, and visits
+ * at least one leaf page.
+ *
+ * The executor makes the same decision about which scans qualify; it also
+ * gives up on skipping at runtime when the groups turn out to be too small,
+ * which is why we can simply charge the cheaper of the two estimates.
+ */
+static void
+btcostestimate_skipscan(PlannerInfo *root, IndexPath *path, double loop_count,
+						GenericCosts *costs)
+{
+	IndexOptInfo *index = path->indexinfo;
+	GenericCosts skipcosts = {0};
+	VariableStatData vardata;
+	List	   *skipQuals = NIL;
+	Node	   *leadingCol;
+	double		ndistinct;
+	bool		isdefault;
+	double		numIndexTuples;
+	Cost		descentCost;
+	ListCell   *lc;
+
+	if (index->nkeycolumns < 2 || path->indexclauses == NIL ||
+		linitial_node(IndexClause, path->indexclauses)->indexcol != 1)
+		return;
+
+	/* Parallel scans, array keys and row comparisons never skip */
+	if (path->path.parallel_aware)
+		return;
+
+	foreach(lc, path->indexclauses)
+	{
+		IndexClause *iclause = lfirst_node(IndexClause, lc);
+		ListCell   *lc2;
+
+		foreach(lc2, iclause->indexquals)
+		{
+			RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc2);
+
+			if (IsA(rinfo->clause, ScalarArrayOpExpr) ||
+				IsA(rinfo->clause, RowCompareExpr))
+				return;
+			if (iclause->indexcol == 1)
+				skipQuals = lappend(skipQuals, rinfo);
+		}
+	}
+
+	/* Estimate the number of distinct values of the first column */
+	if (index->indexkeys[0] != 0)
+	{
+		RangeTblEntry *rte = planner_rt_fetch(index->rel->relid, root);
+		Oid			typid;
+		int32		typmod;
+		Oid			collid;
+
+		get_atttypetypmodcoll(rte->relid, index->indexkeys[0],
+							  &typid, &typmod, &collid);
+		leadingCol = (Node *) makeVar(index->rel->relid, index->indexkeys[0],
+									  typid, typmod, collid, 0);
+	}
+	else
+		leadingCol = (Node *) linitial(index->indexprs);
+
+	examine_variable(root, leadingCol, index->rel->relid, &vardata);
+	ndistinct = get_variable_numdistinct(&vardata, &isdefault);
+	ReleaseVariableStats(vardata);
+
+	/* Without statistics, don't bet on the column having few values */
+	if (isdefault)
+		return;
+
+	/*
+	 * The second column's quals bound the part of each primitive scan that
+	 * is read, but every primitive scan reads at least one leaf page.
+	 */
+	numIndexTuples = clauselist_selectivity(root,
+											add_predicate_to_index_quals(index, skipQuals),
+											index->rel->relid,
+											JOIN_INNER,
+											NULL) * index->rel->tuples;
+	if (index->pages > 1 && index->tuples > 1)
+		numIndexTuples += ndistinct * index->tuples / index->pages;
+	skipcosts.numIndexTuples = rint(Min(numIndexTuples, index->tuples));
+
+	genericcostestimate(root, path, loop_count, &skipcosts);
+
+	/* Charge two descents per primitive scan, as btcostestimate() does one */
+	descentCost = (index->tree_height + 1) * DEFAULT_PAGE_CPU_MULTIPLIER * cpu_operator_cost;
+	if (index->tuples > 1)
+		descentCost += ceil(log(index->tuples) / log(2.0)) * cpu_operator_cost;
+	skipcosts.indexStartupCost += 2 * descentCost;
+	skipcosts.indexTotalCost += 2 * ndistinct * descentCost;
+
+	if (skipcosts.indexTotalCost < costs->indexTotalCost)
+	{
+		costs->indexStartupCost = skipcosts.indexStartupCost;
+		costs->indexTotalCost = skipcosts.indexTotalCost;
+		costs->numIndexPages = skipcosts.numIndexPages;
+		costs->numIndexTuples = skipcosts.numIndexTuples;
+	}
+}
+
 void
 btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 			   Cost *indexStartupCost, Cost *indexTotalCost,
@@ -6864,6 +6973,15 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	costs.indexStartupCost += descentCost;
 	costs.indexTotalCost += costs.num_sa_scans * descentCost;
 
+	/*
+	 * If there are no quals on the first index column, the scan might be able
+	 * to skip over the first column's distinct values rather than read the
+	 * whole index; see _bt_preprocess_skip_scan().  Use that estimate if it
+	 * is cheaper.
+	 */
+	if (indexBoundQuals == NIL)
+		btcostestimate_skipscan(root, path, loop_count, &costs);
+
 	/*
 	 * If we can get an estimate of the first column's ordering correlation C
 	 * from pg_statistic, estimate the index correlation as C for a
@@ -63,6 +63,23 @@ typedef struct
 	int			step_sign;
 } generate_series_timestamp_fctx;
 
+/*
+ * timestamp2tm() remembers the stretch of time, between two transitions of
+ * a time zone, in which the last timestamp it rotated lies.  Further
+ * timestamps in the same stretch, as are typical when outputting a column of
+ * timestamps, are then rotated by simply adding the known UTC offset instead
+ * of calling pg_localtime().
+ */
+static struct
+{
+	pg_tz	   *tz;				/* zone, or NULL if nothing cached */
+	pg_time_t	start;			/* offset is valid from here ... */
+	pg_time_t	end;			/* ... up to but not including here */
+	long int	gmtoff;
+	int			isdst;
+	const char *zone;
+} tzOffsetCache;
+
 typedef struct
 {
 	TimestampTz current;
@@ -1826,6 +1843,48 @@ dt2time(Timestamp jd, int *hour, int *min, int *sec, fsec_t *fsec)
 }								/* dt2time() */
 
 
+/*
+ * Remember the UTC offset prevailing at utime in zone tz, as just returned
+ * by pg_localtime() in *tm, together with the range of times it applies to.
+ */
+static void
+cache_tz_offset(pg_tz *tz, pg_time_t utime, const struct pg_tm *tm)
+{
+	long int	before_gmtoff,
+				after_gmtoff;
+	int			before_isdst,
+				after_isdst;
+	pg_time_t	boundary;
+	pg_time_t	local;
+	int			res;
+
+	tzOffsetCache.tz = NULL;
+
+	/*
+	 * Shifting by the offset only reproduces pg_localtime() if the zone
+	 * doesn't account for leap seconds; check that it did so here.
+	 */
+	local = (utime + tm->tm_gmtoff) % SECS_PER_DAY;
+	if (local < 0)
+		local += SECS_PER_DAY;
+	if (local != (tm->tm_hour * MINS_PER_HOUR + tm->tm_min) * SECS_PER_MINUTE +
+		tm->tm_sec)
+		return;
+
+	res = pg_next_dst_boundary(&utime, &before_gmtoff, &before_isdst,
+							   &boundary, &after_gmtoff, &after_isdst, tz);
+	if (res < 0 || before_gmtoff != tm->tm_gmtoff ||
+		before_isdst != tm->tm_isdst)
+		return;
+
+	tzOffsetCache.tz = tz;
+	tzOffsetCache.start = utime;
+	tzOffsetCache.end = (res == 1) ? boundary : PG_INT64_MAX;
+	tzOffsetCache.gmtoff = tm->tm_gmtoff;
+	tzOffsetCache.isdst = tm->tm_isdst;
+	tzOffsetCache.zone = tm->tm_zone;
+}
+
 /*
  * timestamp2tm() - Convert timestamp data type to POSIX time structure.
  *
@@ -1842,6 +1901,7 @@ timestamp2tm(Timestamp dt, int *tzp, struct pg_tm *tm, fsec_t *fsec, const char
 {
 	Timestamp	date;
 	Timestamp	time;
+	Timestamp	secs;
 	pg_time_t	utime;
 
 	/* Use session timezone if caller asks for default */
@@ -1888,22 +1948,44 @@ timestamp2tm(Timestamp dt, int *tzp, struct pg_tm *tm, fsec_t *fsec, const char
 	 * coding avoids hardwiring any assumptions about the width of pg_time_t,
 	 * so it should behave sanely on machines without int64.
 	 */
-	dt = (dt - *fsec) / USECS_PER_SEC +
+	secs = (dt - *fsec) / USECS_PER_SEC +
 		(POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * SECS_PER_DAY;
-	utime = (pg_time_t) dt;
-	if ((Timestamp) utime == dt)
+	utime = (pg_time_t) secs;
+	if ((Timestamp) utime == secs)
 	{
-		struct pg_tm *tx = pg_localtime(&utime, attimezone);
-
-		tm->tm_year = tx->tm_year + 1900;
-		tm->tm_mon = tx->tm_mon + 1;
-		tm->tm_mday = tx->tm_mday;
-		tm->tm_hour = tx->tm_hour;
-		tm->tm_min = tx->tm_min;
-		tm->tm_sec = tx->tm_sec;
-		tm->tm_isdst = tx->tm_isdst;
-		tm->tm_gmtoff = tx->tm_gmtoff;
-		tm->tm_zone = tx->tm_zone;
+		if (tzOffsetCache.tz == attimezone &&
+			utime >= tzOffsetCache.start && utime < tzOffsetCache.end)
+		{
+			/* Same offset as last time, so just shift the UTC time */
+			time = dt + tzOffsetCache.gmtoff * USECS_PER_SEC;
+			TMODULO(time, date, USECS_PER_DAY);
+			if (time < INT64CONST(0))
+			{
+				time += USECS_PER_DAY;
+				date -= 1;
+			}
+			j2date((int) (date + POSTGRES_EPOCH_JDATE),
+				   &tm->tm_year, &tm->tm_mon, &tm->tm_mday);
+			dt2time(time, &tm->tm_hour, &tm->tm_min, &tm->tm_sec, fsec);
+			tm->tm_isdst = tzOffsetCache.isdst;
+			tm->tm_gmtoff = tzOffsetCache.gmtoff;
+			tm->tm_zone = tzOffsetCache.zone;
+		}
+		else
+		{
+			struct pg_tm *tx = pg_localtime(&utime, attimezone);
+
+			tm->tm_year = tx->tm_year + 1900;
+			tm->tm_mon = tx->tm_mon + 1;
+			tm->tm_mday = tx->tm_mday;
+			tm->tm_hour = tx->tm_hour;
+			tm->tm_min = tx->tm_min;
+			tm->tm_sec = tx->tm_sec;
+			tm->tm_isdst = tx->tm_isdst;
+			tm->tm_gmtoff = tx->tm_gmtoff;
+			tm->tm_zone = tx->tm_zone;
+			cache_tz_offset(attimezone, utime, tm);
+		}
 		*tzp = -tm->tm_gmtoff;
 		if (tzn != NULL)
 			*tzn = tm->tm_zone;
@@ -2499,6 +2581,64 @@ interval_cmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(interval_cmp_internal(interval1, interval2));
 }
 
+static int
+interval_fastcmp(Datum x, Datum y, SortSupport ssup)
+{
+	Interval   *a = DatumGetIntervalP(x);
+	Interval   *b = DatumGetIntervalP(y);
+
+	return interval_cmp_internal(a, b);
+}
+
+#if SIZEOF_DATUM >= 8
+/*
+ * Abbreviated key conversion for intervals: the linear representation used
+ * by interval_cmp_internal, clamped to the range of int64.  This orders all
+ * intervals correctly, and distinguishes all but those spanning more than
+ * about 292 thousand years.
+ */
+static Datum
+interval_abbrev_convert(Datum original, SortSupport ssup)
+{
+	INT128		span = interval_cmp_value(DatumGetIntervalP(original));
+
+	if (int128_compare(span, int64_to_int128(PG_INT64_MAX)) > 0)
+		return Int64GetDatum(PG_INT64_MAX);
+	if (int128_compare(span, int64_to_int128(PG_INT64_MIN)) < 0)
+		return Int64GetDatum(PG_INT64_MIN);
+	return Int64GetDatum(int128_to_int64(span));
+}
+
+/*
+ * Conversion is cheap, and hardly ever loses information, so never abort.
+ */
+static bool
+interval_abbrev_abort(int memtupcount, SortSupport ssup)
+{
+	return false;
+}
+#endif
+
+Datum
+interval_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+	ssup->comparator = interval_fastcmp;
+
+#if SIZEOF_DATUM >= 8
+	if (ssup->abbreviate)
+	{
+		ssup->abbrev_full_comparator = ssup->comparator;
+		ssup->comparator = ssup_datum_signed_cmp;
+		ssup->abbrev_converter = interval_abbrev_convert;
+		ssup->abbrev_abort = interval_abbrev_abort;
+	}
+#endif
+
+	PG_RETURN_VOID();
+}
+
 /*
  * Hashing for intervals
  *
@@ -34,8 +34,25 @@ static const float weights[] = {0.1f, 0.2f, 0.4f, 1.0f};
 #define RANK_NORM_RDIVRPLUS1	0x20
 #define DEF_NORM_METHOD			RANK_NO_NORM
 
-static float calc_rank_or(const float *w, TSVector t, TSQuery q);
-static float calc_rank_and(const float *w, TSVector t, TSQuery q);
+/*
+ * ts_rank keeps the sorted, de-duplicated operand list of the last query it
+ * saw in fn_extra, since the query is normally the same for every row ranked.
+ * Operands are remembered by their position in the query, so the list is
+ * valid for any copy of an identical query.
+ */
+typedef struct
+{
+	TSQuery		query;			/* copy of the query the list belongs to */
+	int			nops;			/* number of entries in opidx */
+	int		   *opidx;			/* indexes into GETQUERY(query) */
+} RankOperandCache;
+
+#define RANKOPERAND(q, i)	(&GETQUERY(q)[(i)].qoperand)
+
+static float calc_rank_or(const float *w, TSVector t, TSQuery q,
+						  const int *opidx, int nops);
+static float calc_rank_and(const float *w, TSVector t, TSQuery q,
+						   const int *opidx, int nops);
 
 /*
  * Returns a weight of a word collocation
@@ -196,8 +213,70 @@ SortAndUniqItems(TSQuery q, int *size)
 	return res;
 }
 
+/*
+ * Like SortAndUniqItems, but returns the operands as indexes into the
+ * query's item array.
+ */
+static int *
+SortAndUniqOperands(TSQuery q, int *size)
+{
+	QueryOperand **items;
+	int		   *res;
+	int			i;
+
+	*size = q->size;
+	items = SortAndUniqItems(q, size);
+	res = (int *) palloc(sizeof(int) * Max(*size, 1));
+	for (i = 0; i < *size; i++)
+		res[i] = (QueryItem *) items[i] - GETQUERY(q);
+	pfree(items);
+
+	return res;
+}
+
+/*
+ * Return the sorted operand indexes of 'q', reusing the list built for the
+ * previous call when the query hasn't changed.
+ */
+static const int *
+getRankOperands(FunctionCallInfo fcinfo, TSQuery q, int *nops)
+{
+	RankOperandCache *cache;
+	MemoryContext oldcontext;
+
+	if (fcinfo->flinfo == NULL)
+		return SortAndUniqOperands(q, nops);
+
+	cache = (RankOperandCache *) fcinfo->flinfo->fn_extra;
+	if (cache != NULL &&
+		VARSIZE(cache->query) == VARSIZE(q) &&
+		memcmp(cache->query, q, VARSIZE(q)) == 0)
+	{
+		*nops = cache->nops;
+		return cache->opidx;
+	}
+
+	oldcontext = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+	if (cache == NULL)
+		cache = (RankOperandCache *) palloc(sizeof(RankOperandCache));
+	else
+	{
+		pfree(cache->query);
+		pfree(cache->opidx);
+	}
+	cache->query = (TSQuery) palloc(VARSIZE(q));
+	memcpy(cache->query, q, VARSIZE(q));
+	cache->opidx = SortAndUniqOperands(q, &cache->nops);
+	fcinfo->flinfo->fn_extra = cache;
+	MemoryContextSwitchTo(oldcontext);
+
+	*nops = cache->nops;
+	return cache->opidx;
+}
+
 static float
-calc_rank_and(const float *w, TSVector t, TSQuery q)
+calc_rank_and(const float *w, TSVector t, TSQuery q,
+			  const int *opidx, int nops)
 {
 	WordEntryPosVector **pos;
 	WordEntryPosVector1 posnull;
@@ -215,15 +294,9 @@ calc_rank_and(const float *w, TSVector t, TSQuery q)
 				dist,
 				nitem;
 	float		res = -1.0;
-	QueryOperand **item;
-	int			size = q->size;
 
-	item = SortAndUniqItems(q, &size);
-	if (size < 2)
-	{
-		pfree(item);
-		return calc_rank_or(w, t, q);
-	}
+	if (nops < 2)
+		return calc_rank_or(w, t, q, opidx, nops);
 	pos = (WordEntryPosVector **) palloc0(sizeof(WordEntryPosVector *) * q->size);
 
 	/* A dummy WordEntryPos array to use when haspos is false */
@@ -232,9 +305,10 @@ calc_rank_and(const float *w, TSVector t, TSQuery q)
 	WEP_SETPOS(posnull.pos[0], MAXENTRYPOS - 1);
 	POSNULL = (WordEntryPosVector *) &posnull;
 
-	for (i = 0; i < size; i++)
+	for (i = 0; i < nops; i++)
 	{
-		firstentry = entry = find_wordentry(t, q, item[i], &nitem);
+		firstentry = entry = find_wordentry(t, q, RANKOPERAND(q, opidx[i]),
+											&nitem);
 		if (!entry)
 			continue;
 
@@ -275,12 +349,12 @@ calc_rank_and(const float *w, TSVector t, TSQuery q)
 		}
 	}
 	pfree(pos);
-	pfree(item);
 	return res;
 }
 
 static float
-calc_rank_or(const float *w, TSVector t, TSQuery q)
+calc_rank_or(const float *w, TSVector t, TSQuery q,
+			 const int *opidx, int nops)
 {
 	WordEntry  *entry,
 			   *firstentry;
@@ -291,22 +365,19 @@ calc_rank_or(const float *w, TSVector t, TSQuery q)
 				i,
 				nitem;
 	float		res = 0.0;
-	QueryOperand **item;
-	int			size = q->size;
 
 	/* A dummy WordEntryPos array to use when haspos is false */
 	posnull.npos = 1;
 	posnull.pos[0] = 0;
 
-	item = SortAndUniqItems(q, &size);
-
-	for (i = 0; i < size; i++)
+	for (i = 0; i < nops; i++)
 	{
 		float		resj,
 					wjm;
 		int32		jm;
 
-		firstentry = entry = find_wordentry(t, q, item[i], &nitem);
+		firstentry = entry = find_wordentry(t, q, RANKOPERAND(q, opidx[i]),
+											&nitem);
 		if (!entry)
 			continue;
 
@@ -347,27 +418,31 @@ calc_rank_or(const float *w, TSVector t, TSQuery q)
 			entry++;
 		}
 	}
-	if (size > 0)
-		res = res / size;
-	pfree(item);
+	if (nops > 0)
+		res = res / nops;
 	return res;
 }
 
 static float
-calc_rank(const float *w, TSVector t, TSQuery q, int32 method)
+calc_rank(FunctionCallInfo fcinfo, const float *w, TSVector t, TSQuery q,
+		  int32 method)
 {
 	QueryItem  *item = GETQUERY(q);
 	float		res = 0.0;
 	int			len;
+	const int  *opidx;
+	int			nops;
 
 	if (!t->size || !q->size)
 		return 0.0;
 
+	opidx = getRankOperands(fcinfo, q, &nops);
+
 	/* XXX: What about NOT? */
 	res = (item->type == QI_OPR && (item->qoperator.oper == OP_AND ||
 									item->qoperator.oper == OP_PHRASE)) ?
-		calc_rank_and(w, t, q) :
-		calc_rank_or(w, t, q);
+		calc_rank_and(w, t, q, opidx, nops) :
+		calc_rank_or(w, t, q, opidx, nops);
 
 	if (res < 0)
 		res = 1e-20f;
@@ -443,7 +518,7 @@ ts_rank_wttf(PG_FUNCTION_ARGS)
 	int			method = PG_GETARG_INT32(3);
 	float		res;
 
-	res = calc_rank(getWeights(win), txt, query, method);
+	res = calc_rank(fcinfo, getWeights(win), txt, query, method);
 
 	PG_FREE_IF_COPY(win, 0);
 	PG_FREE_IF_COPY(txt, 1);
@@ -459,7 +534,7 @@ ts_rank_wtt(PG_FUNCTION_ARGS)
 	TSQuery		query = PG_GETARG_TSQUERY(2);
 	float		res;
 
-	res = calc_rank(getWeights(win), txt, query, DEF_NORM_METHOD);
+	res = calc_rank(fcinfo, getWeights(win), txt, query, DEF_NORM_METHOD);
 
 	PG_FREE_IF_COPY(win, 0);
 	PG_FREE_IF_COPY(txt, 1);
@@ -475,7 +550,7 @@ ts_rank_ttf(PG_FUNCTION_ARGS)
 	int			method = PG_GETARG_INT32(2);
 	float		res;
 
-	res = calc_rank(getWeights(NULL), txt, query, method);
+	res = calc_rank(fcinfo, getWeights(NULL), txt, query, method);
 
 	PG_FREE_IF_COPY(txt, 0);
 	PG_FREE_IF_COPY(query, 1);
@@ -489,7 +564,7 @@ ts_rank_tt(PG_FUNCTION_ARGS)
 	TSQuery		query = PG_GETARG_TSQUERY(1);
 	float		res;
 
-	res = calc_rank(getWeights(NULL), txt, query, DEF_NORM_METHOD);
+	res = calc_rank(fcinfo, getWeights(NULL), txt, query, DEF_NORM_METHOD);
 
 	PG_FREE_IF_COPY(txt, 0);
 	PG_FREE_IF_COPY(query, 1);
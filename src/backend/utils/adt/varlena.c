@@ -30,6 +30,7 @@
 #include "miscadmin.h"
 #include "nodes/execnodes.h"
 #include "parser/scansup.h"
+#include "port/pg_bitutils.h"
 #include "port/pg_bswap.h"
 #include "regex/regex.h"
 #include "utils/builtins.h"
@@ -45,6 +46,9 @@
 /* GUC variable */
 int			bytea_output = BYTEA_OUTPUT_HEX;
 
+/* GUC variable */
+bool		full_sort_keys = false;
+
 typedef struct varlena VarString;
 
 /*
@@ -91,6 +95,8 @@ typedef struct
 	hyperLogLogState abbr_card; /* Abbreviated key cardinality state */
 	hyperLogLogState full_card; /* Full key cardinality state */
 	double		prop_card;		/* Required cardinality proportion */
+	double		input_bytes;	/* Total size of strings given full keys */
+	double		key_bytes;		/* Total size of their full keys */
 	pg_locale_t locale;
 } VarStringSortSupport;
 
@@ -122,6 +128,9 @@ static int	namefastcmp_locale(Datum x, Datum y, SortSupport ssup);
 static int	varstrfastcmp_locale(char *a1p, int len1, char *a2p, int len2, SortSupport ssup);
 static Datum varstr_abbrev_convert(Datum original, SortSupport ssup);
 static bool varstr_abbrev_abort(int memtupcount, SortSupport ssup);
+static int	varstrcmp_fullkey(Datum x, Datum y, SortSupport ssup);
+static Datum varstr_fullkey_convert(Datum original, SortSupport ssup);
+static bool varstr_fullkey_abort(int memtupcount, SortSupport ssup);
 static int32 text_length(Datum str);
 static text *text_catenate(text *t1, text *t2);
 static text *text_substring(Datum str,
@@ -1988,8 +1997,26 @@ varstr_sortsupport(SortSupport ssup, Oid typid, Oid collid)
 		 * If possible, plan to use the abbreviated keys optimization.  The
 		 * core code may switch back to authoritative comparator should
 		 * abbreviation be aborted.
+		 *
+		 * If full_sort_keys is set, the "abbreviated" key of a string in a
+		 * non-C collation is instead its complete strxfrm() blob, so that
+		 * all comparisons other than those between equal keys become a
+		 * memcmp().  That costs memory for the keys, but spares us the
+		 * strcoll() calls that would otherwise follow every tie between
+		 * abbreviated keys, which can be the bulk of the work when strings
+		 * share long prefixes.
 		 */
-		if (abbreviate)
+		if (abbreviate && !collate_c && full_sort_keys)
+		{
+			sss->input_bytes = 0;
+			sss->key_bytes = 0;
+			ssup->abbrev_full_comparator = ssup->comparator;
+			ssup->comparator = varstrcmp_fullkey;
+			ssup->abbrev_converter = varstr_fullkey_convert;
+			ssup->abbrev_abort = varstr_fullkey_abort;
+			ssup->abbrev_by_ref = true;
+		}
+		else if (abbreviate)
 		{
 			sss->prop_card = 0.20;
 			initHyperLogLog(&sss->abbr_card, 10);
@@ -2425,6 +2452,134 @@ done:
 	return res;
 }
 
+/*
+ * Abbreviated key comparator for full keys.  Full keys that are not equal
+ * compare the same way as the strings they were made from; equal full keys
+ * still need an authoritative tie-breaker.
+ */
+static int
+varstrcmp_fullkey(Datum x, Datum y, SortSupport ssup)
+{
+	bytea	   *key1 = (bytea *) DatumGetPointer(x);
+	bytea	   *key2 = (bytea *) DatumGetPointer(y);
+	int			len1 = VARSIZE(key1) - VARHDRSZ;
+	int			len2 = VARSIZE(key2) - VARHDRSZ;
+	int			result;
+
+	result = memcmp(VARDATA(key1), VARDATA(key2), Min(len1, len2));
+	if ((result == 0) && (len1 != len2))
+		result = (len1 < len2) ? -1 : 1;
+
+	return result;
+}
+
+/*
+ * Conversion routine for sortsupport, when full keys are in use.  Returns a
+ * pointer to a bytea holding the complete strxfrm() blob of the original.
+ *
+ * The key is allocated in the caller's memory context, which keeps it with
+ * the tuple it belongs to.  All other work is done in ssup_cxt, since the
+ * caller's context might not support pfree().
+ */
+static Datum
+varstr_fullkey_convert(Datum original, SortSupport ssup)
+{
+	VarStringSortSupport *sss = (VarStringSortSupport *) ssup->ssup_extra;
+	MemoryContext keycontext;
+	VarString  *authoritative;
+	char	   *authoritative_data;
+	int			len;
+	Size		bsize;
+	bytea	   *res;
+
+	keycontext = MemoryContextSwitchTo(ssup->ssup_cxt);
+
+	authoritative = DatumGetVarStringPP(original);
+	authoritative_data = VARDATA_ANY(authoritative);
+	len = VARSIZE_ANY_EXHDR(authoritative);
+
+	/* Get number of bytes, ignoring trailing spaces */
+	if (sss->typid == BPCHAROID)
+		len = bpchartruelen(authoritative_data, len);
+
+	/* By convention, we use buffer 1 to store and NUL-terminate */
+	if (len >= sss->buflen1)
+	{
+		sss->buflen1 = Max(len + 1, Min(sss->buflen1 * 2, MaxAllocSize));
+		sss->buf1 = repalloc(sss->buf1, sss->buflen1);
+	}
+	memcpy(sss->buf1, authoritative_data, len);
+	sss->buf1[len] = '\0';
+	sss->last_len1 = len;
+
+	/* Call pg_strxfrm(), enlarging the buffer until the blob fits */
+	for (;;)
+	{
+		bsize = pg_strxfrm(sss->buf2, sss->buf1, sss->buflen2, sss->locale);
+
+		sss->last_len2 = bsize;
+		if (bsize < sss->buflen2)
+			break;
+
+		sss->buflen2 = Max(bsize + 1, Min(sss->buflen2 * 2, MaxAllocSize));
+		sss->buf2 = repalloc(sss->buf2, sss->buflen2);
+	}
+
+	/* Buffers now hold a blob, not a pair of strings to compare */
+	sss->cache_blob = true;
+
+	sss->input_bytes += len;
+	sss->key_bytes += bsize;
+
+	/* Don't leak memory here */
+	if (PointerGetDatum(authoritative) != original)
+		pfree(authoritative);
+
+	MemoryContextSwitchTo(keycontext);
+
+	res = (bytea *) palloc(VARHDRSZ + bsize);
+	SET_VARSIZE(res, VARHDRSZ + bsize);
+	memcpy(VARDATA(res), sss->buf2, bsize);
+
+	return PointerGetDatum(res);
+}
+
+/*
+ * Callback for deciding whether full keys are still worth their memory.
+ *
+ * Once a key has been made, every comparison involving its tuple is a cheap
+ * memcmp() rather than a strcoll() call, and each tuple takes part in about
+ * log2(memtupcount) comparisons; making a key costs no more than a couple of
+ * strcoll() calls, so that's quickly repaid.  What can make full keys a loss
+ * is their size: memory spent on keys is not available for tuples, and a
+ * sort that spills to disk because of them loses far more than it gains.
+ * So give up once the keys outweigh the strings by more than the number of
+ * comparisons they save can justify.
+ */
+static bool
+varstr_fullkey_abort(int memtupcount, SortSupport ssup)
+{
+	VarStringSortSupport *sss = (VarStringSortSupport *) ssup->ssup_extra;
+	double		max_ratio;
+
+	Assert(ssup->abbreviate);
+
+	/* Have a little patience */
+	if (memtupcount < 100)
+		return false;
+
+	max_ratio = pg_leftmost_one_pos32((uint32) memtupcount) / 2.0;
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG, "varstr_fullkey: key bytes after %d: %.0f "
+			 "(input bytes: %.0f, max ratio: %f)",
+			 memtupcount, sss->key_bytes, sss->input_bytes, max_ratio);
+#endif
+
+	return sss->key_bytes > Max(sss->input_bytes, 1.0) * max_ratio;
+}
+
 /*
  * Callback for estimating effectiveness of abbreviated key optimization, using
  * heuristic rules.  Returns value indicating if the abbreviation optimization
@@ -5063,6 +5218,9 @@ pg_column_compression(PG_FUNCTION_ARGS)
 		case TOAST_LZ4_COMPRESSION_ID:
 			result = "lz4";
 			break;
+		case TOAST_ZSTD_COMPRESSION_ID:
+			result = "zstd";
+			break;
 		default:
 			elog(ERROR, "invalid compression method id %d", cmid);
 	}
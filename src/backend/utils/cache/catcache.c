@@ -37,6 +37,7 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
+#include "utils/sharedcatcache.h"
 #include "utils/syscache.h"
 
 
@@ -1317,6 +1318,8 @@ SearchCatCacheMiss(CatCache *cache,
 	HeapTuple	ntp;
 	CatCTup    *ct;
 	Datum		arguments[CATCACHE_MAXKEYS];
+	bool		share;
+	int			msgnum;
 
 	/* Initialize local parameter array */
 	arguments[0] = v1;
@@ -1324,6 +1327,46 @@ SearchCatCacheMiss(CatCache *cache,
 	arguments[2] = v3;
 	arguments[3] = v4;
 
+	/*
+	 * Another backend may have read the tuple already.  Different keys can
+	 * have the same hash value, so check that we got the right one.
+	 */
+	ntp = SharedCatCacheLookup(cache, hashValue);
+	if (ntp != NULL)
+	{
+		Datum		keys[CATCACHE_MAXKEYS];
+
+		for (int i = 0; i < nkeys; i++)
+		{
+			bool		isnull;
+
+			keys[i] = heap_getattr(ntp, cache->cc_keyno[i],
+								   cache->cc_tupdesc, &isnull);
+			Assert(!isnull);
+		}
+
+		if (CatalogCacheCompareTuple(cache, nkeys, keys, arguments))
+		{
+			ct = CatalogCacheCreateEntry(cache, ntp, arguments,
+										 hashValue, hashIndex,
+										 false);
+			heap_freetuple(ntp);
+
+			/* immediately set the refcount to 1 */
+			ResourceOwnerEnlargeCatCacheRefs(CurrentResourceOwner);
+			ct->refcount++;
+			ResourceOwnerRememberCatCacheRef(CurrentResourceOwner, &ct->tuple);
+
+#ifdef CATCACHE_STATS
+			cache->cc_newloads++;
+#endif
+
+			return &ct->tuple;
+		}
+
+		heap_freetuple(ntp);
+	}
+
 	/*
 	 * Ok, need to make a lookup in the relation, copy the scankey and fill
 	 * out any per-call fields.
@@ -1351,6 +1394,9 @@ SearchCatCacheMiss(CatCache *cache,
 	 */
 	relation = table_open(cache->cc_reloid, AccessShareLock);
 
+	/* find out whether other backends may use what we read */
+	share = SharedCatCacheBeginLoad(&msgnum);
+
 	scandesc = systable_beginscan(relation,
 								  cache->cc_indexoid,
 								  IndexScanOK(cache, cur_skey),
@@ -1365,6 +1411,9 @@ SearchCatCacheMiss(CatCache *cache,
 		ct = CatalogCacheCreateEntry(cache, ntp, arguments,
 									 hashValue, hashIndex,
 									 false);
+		/* offer the flattened copy to other backends */
+		if (share)
+			SharedCatCacheStore(cache, hashValue, &ct->tuple, msgnum);
 		/* immediately set the refcount to 1 */
 		ResourceOwnerEnlargeCatCacheRefs(CurrentResourceOwner);
 		ct->refcount++;
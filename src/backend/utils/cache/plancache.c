@@ -38,6 +38,9 @@
  * catalogs to be infrequent enough that more-detailed tracking is not worth
  * the effort.
  *
+ * Generic plans of saved plans can also be shared with other backends; see
+ * sharedplancache.c.
+ *
  * In addition to full-fledged query plans, we provide a facility for
  * detecting invalidations of simple scalar expressions.  This is fairly
  * bare-bones; it's the caller's responsibility to build a new expression
@@ -71,6 +74,7 @@
 #include "utils/memutils.h"
 #include "utils/resowner_private.h"
 #include "utils/rls.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -102,6 +106,10 @@ static List *RevalidateCachedQuery(CachedPlanSource *plansource,
 static bool CheckCachedPlan(CachedPlanSource *plansource);
 static CachedPlan *BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 								   ParamListInfo boundParams, QueryEnvironment *queryEnv);
+static CachedPlan *MakeCachedPlan(CachedPlanSource *plansource, List *plist,
+								  MemoryContext plan_context);
+static CachedPlan *GetSharedGenericPlan(CachedPlanSource *plansource,
+										QueryEnvironment *queryEnv);
 static bool choose_custom_plan(CachedPlanSource *plansource,
 							   ParamListInfo boundParams);
 static double cached_plan_cost(CachedPlan *plan, bool include_planner);
@@ -882,10 +890,8 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	CachedPlan *plan;
 	List	   *plist;
 	bool		snapshot_set;
-	bool		is_transient;
 	MemoryContext plan_context;
 	MemoryContext oldcxt = CurrentMemoryContext;
-	ListCell   *lc;
 
 	/*
 	 * Normally the querytree should be valid already, but if it's not,
@@ -962,6 +968,30 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	else
 		plan_context = CurrentMemoryContext;
 
+	plan = MakeCachedPlan(plansource, plist, plan_context);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return plan;
+}
+
+/*
+ * MakeCachedPlan: create the CachedPlan struct for a finished plan.
+ *
+ * plist is the list of PlannedStmts, which, like the CachedPlan struct
+ * created here, must be in plan_context.  The caller must have made that
+ * the current memory context.
+ */
+static CachedPlan *
+MakeCachedPlan(CachedPlanSource *plansource, List *plist,
+			   MemoryContext plan_context)
+{
+	CachedPlan *plan;
+	bool		is_transient;
+	ListCell   *lc;
+
+	Assert(CurrentMemoryContext == plan_context);
+
 	/*
 	 * Create and fill the CachedPlan struct within the new context.
 	 */
@@ -1005,8 +1035,66 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	/* assign generation number to new plan */
 	plan->generation = ++(plansource->generation);
 
+	return plan;
+}
+
+/*
+ * GetSharedGenericPlan: try to use a generic plan from the shared plan cache.
+ *
+ * If another backend has stored a generic plan for the same statement, load
+ * it, make it plansource's generic plan, and validate it the same way as a
+ * generic plan of our own making.  Returns NULL if there's no usable plan.
+ */
+static CachedPlan *
+GetSharedGenericPlan(CachedPlanSource *plansource, QueryEnvironment *queryEnv)
+{
+	CachedPlan *plan;
+	List	   *plist;
+	MemoryContext plan_context;
+	MemoryContext oldcxt;
+
+	if (shared_plan_cache_size <= 0)
+		return NULL;
+
+	plan_context = AllocSetContextCreate(CurrentMemoryContext,
+										 "CachedPlan",
+										 ALLOCSET_START_SMALL_SIZES);
+	MemoryContextCopyAndSetIdentifier(plan_context, plansource->query_string);
+	oldcxt = MemoryContextSwitchTo(plan_context);
+
+	plist = SharedPlanCacheLookup(plansource, queryEnv);
+	if (plist == NIL)
+	{
+		MemoryContextSwitchTo(oldcxt);
+		MemoryContextDelete(plan_context);
+		return NULL;
+	}
+
+	plan = MakeCachedPlan(plansource, plist, plan_context);
+
 	MemoryContextSwitchTo(oldcxt);
 
+	/* Link it into the plansource, as GetCachedPlan would for a new plan */
+	ReleaseGenericPlan(plansource);
+	plansource->gplan = plan;
+	plan->refcount++;
+	if (plansource->is_saved)
+	{
+		MemoryContextSetParent(plan->context, CacheMemoryContext);
+		plan->is_saved = true;
+	}
+	else
+		MemoryContextSetParent(plan->context,
+							   MemoryContextGetParent(plansource->context));
+
+	/*
+	 * The plan could have been made obsolete by an invalidation we haven't
+	 * processed yet, so check it, like any other generic plan.  This also
+	 * acquires the locks it needs.
+	 */
+	if (!CheckCachedPlan(plansource))
+		return NULL;
+
 	return plan;
 }
 
@@ -1166,6 +1254,14 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 			plan = plansource->gplan;
 			Assert(plan->magic == CACHEDPLAN_MAGIC);
 		}
+		else if ((plan = GetSharedGenericPlan(plansource, queryEnv)) != NULL)
+		{
+			/* Another backend already built a generic plan we can use */
+			plansource->generic_cost = cached_plan_cost(plan, false);
+
+			/* Same as below, but qlist hasn't been scribbled on */
+			customplan = choose_custom_plan(plansource, boundParams);
+		}
 		else
 		{
 			/* Build a new generic plan */
@@ -1188,6 +1284,8 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 				MemoryContextSetParent(plan->context,
 									   MemoryContextGetParent(plansource->context));
 			}
+			/* Offer it to other backends */
+			SharedPlanCacheStore(plansource, plan->stmt_list, queryEnv);
 			/* Update generic_cost whenever we make a new generic plan */
 			plansource->generic_cost = cached_plan_cost(plan, false);
 
@@ -1459,6 +1557,61 @@ CachedPlanIsSimplyValid(CachedPlanSource *plansource, CachedPlan *plan,
 	return true;
 }
 
+/*
+ * CachedPlanIsStillValid: quick recheck of a generic plan that is still locked
+ *
+ * This is a cheaper substitute for GetCachedPlan, for callers that execute
+ * the same generic plan many times within one subtransaction.  The caller
+ * must have obtained "plan" from GetCachedPlan earlier in the current
+ * subtransaction, so that the locks GetCachedPlan took on the relations
+ * used by the plan are still held.  Re-acquiring those locks would not make
+ * us process any invalidation messages, so all that's left to do is to see
+ * whether an invalidation processed for some other reason has marked the
+ * plan invalid, and to redo the checks that don't depend on locking.
+ *
+ * If the plan is valid, and "owner" is not NULL, record a refcount on
+ * the plan in that resowner before returning.  As in CachedPlanIsSimplyValid,
+ * "plan" need not be pinned by the caller; we don't dereference it until
+ * we've verified that it is still the plansource's generic plan.
+ */
+bool
+CachedPlanIsStillValid(CachedPlanSource *plansource, CachedPlan *plan,
+					   ResourceOwner owner)
+{
+	Assert(plansource->magic == CACHEDPLANSOURCE_MAGIC);
+
+	if (!plansource->is_valid || plan != plansource->gplan || !plan->is_valid)
+		return false;
+
+	Assert(plan->magic == CACHEDPLAN_MAGIC);
+
+	/* Same environment checks as RevalidateCachedQuery and CheckCachedPlan */
+	Assert(plansource->search_path != NULL);
+	if (!OverrideSearchPathMatchesCurrent(plansource->search_path))
+		return false;
+	if (plansource->dependsOnRLS &&
+		(plansource->rewriteRoleId != GetUserId() ||
+		 plansource->rewriteRowSecurity != row_security))
+		return false;
+	if (plan->dependsOnRole && plan->planRoleId != GetUserId())
+		return false;
+	if (TransactionIdIsValid(plan->saved_xmin) &&
+		!TransactionIdEquals(plan->saved_xmin, TransactionXmin))
+		return false;
+
+	plansource->num_generic_plans++;
+
+	/* It's still good.  Bump refcount if requested. */
+	if (owner)
+	{
+		ResourceOwnerEnlargePlanCacheRefs(owner);
+		plan->refcount++;
+		ResourceOwnerRememberPlanCacheRef(owner, plan);
+	}
+
+	return true;
+}
+
 /*
  * CachedPlanSetParentContext: move a CachedPlanSource to a new memory context
  *
@@ -2019,6 +2172,9 @@ PlanCacheRelCallback(Datum arg, Oid relid)
 			cexpr->is_valid = false;
 		}
 	}
+
+	/* And plans shared with other backends */
+	SharedPlanCacheInvalidateRel(relid);
 }
 
 /*
@@ -2129,6 +2285,9 @@ PlanCacheObjectCallback(Datum arg, int cacheid, uint32 hashvalue)
 			}
 		}
 	}
+
+	/* And plans shared with other backends */
+	SharedPlanCacheInvalidateObject(cacheid, hashvalue);
 }
 
 /*
@@ -2141,6 +2300,7 @@ static void
 PlanCacheSysCallback(Datum arg, int cacheid, uint32 hashvalue)
 {
 	ResetPlanCache();
+	SharedPlanCacheReset();
 }
 
 /*
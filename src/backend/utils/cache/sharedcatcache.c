@@ -0,0 +1,441 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.c
+ *	  Catalog cache tuples shared between backends.
+ *
+ * Each backend's catcache starts out empty, so a new connection has to read
+ * every catalog tuple it needs from the catalogs, which can take a long time
+ * in databases with very many objects.  If shared_catcache_size is set, the
+ * tuples read by catcache misses are additionally stored in shared memory,
+ * and a catcache miss in any backend first looks there before scanning the
+ * catalog.  Only positive entries are shared; negative entries and catcache
+ * lists remain backend-local.
+ *
+ * The tricky part is to never hand out a stale tuple to a backend that has
+ * already processed the invalidation making it stale, since no further
+ * invalidation would come to flush it out of that backend's catcache.  Two
+ * rules ensure that:
+ *
+ * 1. Sending invalidation messages and removing the entries they affect from
+ *	  the shared cache happen atomically, under SharedCatCacheLock.  So once
+ *	  a message can be read by anyone, no entry it invalidates is left in the
+ *	  shared cache.
+ *
+ * 2. A tuple read from the catalog is only stored if the reading backend had
+ *	  processed all messages queued before the read (so that its catalog
+ *	  snapshot reflects all transactions whose invalidations it might have
+ *	  seen), and no further message has been queued until the tuple is
+ *	  stored.  Otherwise, the tuple might already have been invalidated by a
+ *	  message that's been purged per rule 1, and storing it would undo that.
+ *	  Tuples inserted or updated by the current transaction aren't stored
+ *	  either, nor are tuples read with a historic snapshot.
+ *
+ * Tuples are stored in a DSA area that lives in the main shared memory
+ * segment, and are found through a shared hash table keyed by database
+ * (InvalidOid for shared catalogs), cache ID and hash value.  The caller
+ * must check that the keys of a tuple found actually match, as different
+ * keys can have the same hash value.  When the cache is full, new tuples are
+ * simply not stored.
+ *
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedcatcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/xact.h"
+#include "miscadmin.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/sinvaladt.h"
+#include "utils/dsa.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/sharedcatcache.h"
+#include "utils/snapmgr.h"
+
+
+/* GUC variable: size of the shared catcache in kB, 0 disables it */
+int			shared_catcache_size = 0;
+
+/*
+ * Expected average amount of memory used by one entry; determines the size
+ * of the hash table.
+ */
+#define SHARED_CATCACHE_AVG_BYTES	256
+
+/* hash table key */
+typedef struct SharedCatCacheKey
+{
+	Oid			dbid;			/* database, or InvalidOid if shared */
+	int			cacheid;		/* syscache ID */
+	uint32		hashvalue;		/* hash value of the tuple's keys */
+} SharedCatCacheKey;
+
+/* hash table entry */
+typedef struct SharedCatCacheEntry
+{
+	SharedCatCacheKey key;		/* hash key; must be first */
+	Oid			reloid;			/* catalog the tuple is from */
+	dsa_pointer tuple;			/* SharedCatCacheTuple */
+} SharedCatCacheEntry;
+
+/* stored tuple; its data follows the header at a MAXALIGN'd offset */
+typedef struct SharedCatCacheTuple
+{
+	uint32		t_len;
+	ItemPointerData t_self;
+	Oid			t_tableOid;
+} SharedCatCacheTuple;
+
+#define SharedCatCacheTupleData(t) \
+	((HeapTupleHeader) ((char *) (t) + MAXALIGN(sizeof(SharedCatCacheTuple))))
+
+/* shared memory state */
+typedef struct SharedCatCacheCtl
+{
+	void	   *raw_dsa_area;	/* in-place DSA area for the tuples */
+} SharedCatCacheCtl;
+
+static SharedCatCacheCtl *SharedCatCache = NULL;
+static HTAB *SharedCatCacheHash = NULL;
+
+/* this backend's attachment to the DSA area */
+static dsa_area *SharedCatCacheArea = NULL;
+
+
+static Size
+shared_catcache_dsa_size(void)
+{
+	return MAXALIGN(Max((Size) shared_catcache_size * 1024,
+						dsa_minimum_size()));
+}
+
+static long
+shared_catcache_max_entries(void)
+{
+	return Max(shared_catcache_dsa_size() / SHARED_CATCACHE_AVG_BYTES, 1024);
+}
+
+/*
+ * Compute shared memory space needed for the shared catcache
+ */
+Size
+SharedCatCacheShmemSize(void)
+{
+	Size		size;
+
+	if (shared_catcache_size <= 0)
+		return 0;
+
+	size = MAXALIGN(sizeof(SharedCatCacheCtl));
+	size = add_size(size, shared_catcache_dsa_size());
+	size = add_size(size, hash_estimate_size(shared_catcache_max_entries(),
+											 sizeof(SharedCatCacheEntry)));
+
+	return size;
+}
+
+/*
+ * Initialize the shared catcache during startup
+ */
+void
+SharedCatCacheShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+
+	if (shared_catcache_size <= 0)
+		return;
+
+	SharedCatCache = (SharedCatCacheCtl *)
+		ShmemInitStruct("Shared Catalog Cache",
+						MAXALIGN(sizeof(SharedCatCacheCtl)) +
+						shared_catcache_dsa_size(),
+						&found);
+
+	if (!IsUnderPostmaster)
+	{
+		dsa_area   *dsa;
+
+		Assert(!found);
+
+		/*
+		 * Create the DSA area within plain shared memory, and don't let it
+		 * grow beyond that; the cache's size is fixed by the GUC.
+		 */
+		SharedCatCache->raw_dsa_area =
+			(char *) SharedCatCache + MAXALIGN(sizeof(SharedCatCacheCtl));
+		dsa = dsa_create_in_place(SharedCatCache->raw_dsa_area,
+								  shared_catcache_dsa_size(),
+								  LWTRANCHE_SHARED_CATCACHE_DSA, 0);
+		dsa_pin(dsa);
+		dsa_set_size_limit(dsa, shared_catcache_dsa_size());
+
+		/* postmaster will never access the area itself */
+		dsa_detach(dsa);
+	}
+	else
+		Assert(found);
+
+	info.keysize = sizeof(SharedCatCacheKey);
+	info.entrysize = sizeof(SharedCatCacheEntry);
+	SharedCatCacheHash = ShmemInitHash("Shared Catalog Cache Hash",
+									   shared_catcache_max_entries(),
+									   shared_catcache_max_entries(),
+									   &info,
+									   HASH_ELEM | HASH_BLOBS | HASH_FIXED_SIZE);
+}
+
+/*
+ * Attach to the DSA area, if not done yet.  The mapping is kept for the
+ * lifetime of the backend.
+ */
+static void
+shared_catcache_attach(void)
+{
+	MemoryContext oldcontext;
+
+	if (SharedCatCacheArea != NULL)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	SharedCatCacheArea = dsa_attach_in_place(SharedCatCache->raw_dsa_area,
+											 NULL);
+	dsa_pin_mapping(SharedCatCacheArea);
+	MemoryContextSwitchTo(oldcontext);
+}
+
+static bool
+shared_catcache_usable(void)
+{
+	return shared_catcache_size > 0 && IsUnderPostmaster &&
+		!IsBootstrapProcessingMode();
+}
+
+static void
+shared_catcache_make_key(CatCache *cache, uint32 hashValue,
+						 SharedCatCacheKey *key)
+{
+	/* zero padding, the key is hashed as a blob */
+	memset(key, 0, sizeof(SharedCatCacheKey));
+	key->dbid = cache->cc_relisshared ? InvalidOid : MyDatabaseId;
+	key->cacheid = cache->id;
+	key->hashvalue = hashValue;
+}
+
+/*
+ * SharedCatCacheLookup
+ *		Look for a tuple with the given hash value in the shared catcache.
+ *
+ * Returns a palloc'd copy of the tuple, or NULL if there's none.  The
+ * caller has to check whether its keys match.
+ */
+HeapTuple
+SharedCatCacheLookup(CatCache *cache, uint32 hashValue)
+{
+	SharedCatCacheKey key;
+	SharedCatCacheEntry *entry;
+	HeapTuple	tuple = NULL;
+
+	if (!shared_catcache_usable())
+		return NULL;
+
+	shared_catcache_attach();
+	shared_catcache_make_key(cache, hashValue, &key);
+
+	LWLockAcquire(SharedCatCacheLock, LW_SHARED);
+
+	entry = (SharedCatCacheEntry *) hash_search(SharedCatCacheHash, &key,
+												HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		SharedCatCacheTuple *stup = dsa_get_address(SharedCatCacheArea,
+													entry->tuple);
+
+		tuple = (HeapTuple) palloc(HEAPTUPLESIZE + stup->t_len);
+		tuple->t_len = stup->t_len;
+		tuple->t_self = stup->t_self;
+		tuple->t_tableOid = stup->t_tableOid;
+		tuple->t_data = (HeapTupleHeader) ((char *) tuple + HEAPTUPLESIZE);
+		memcpy(tuple->t_data, SharedCatCacheTupleData(stup), stup->t_len);
+	}
+
+	LWLockRelease(SharedCatCacheLock);
+
+	return tuple;
+}
+
+/*
+ * SharedCatCacheBeginLoad
+ *		Prepare to read a tuple from a catalog for the catcache.
+ *
+ * Returns true if the tuple read may be stored in the shared catcache, in
+ * which case *msgnum is set to the value to be passed to
+ * SharedCatCacheStore().  Must be called before starting the catalog scan.
+ */
+bool
+SharedCatCacheBeginLoad(int *msgnum)
+{
+	if (!shared_catcache_usable() || HistoricSnapshotActive())
+		return false;
+
+	return SharedInvalidationIsCaughtUp(msgnum);
+}
+
+/*
+ * SharedCatCacheStore
+ *		Offer a tuple read from a catalog to other backends.
+ *
+ * The tuple must not contain any out-of-line values.  msgnum must be the
+ * value set by the SharedCatCacheBeginLoad() call that preceded the scan.
+ */
+void
+SharedCatCacheStore(CatCache *cache, uint32 hashValue, HeapTuple tuple,
+					int msgnum)
+{
+	SharedCatCacheKey key;
+	SharedCatCacheEntry *entry;
+	SharedCatCacheTuple *stup;
+	dsa_pointer dp;
+	bool		found;
+
+	Assert(!HeapTupleHasExternal(tuple));
+
+	/* our own changes aren't visible to others yet */
+	if (TransactionIdIsCurrentTransactionId(HeapTupleHeaderGetXmin(tuple->t_data)))
+		return;
+
+	shared_catcache_attach();
+	shared_catcache_make_key(cache, hashValue, &key);
+
+	LWLockAcquire(SharedCatCacheLock, LW_EXCLUSIVE);
+
+	/* Has any invalidation been sent since the scan began? */
+	if (SIGetMaxMsgNum() != msgnum)
+	{
+		LWLockRelease(SharedCatCacheLock);
+		return;
+	}
+
+	entry = (SharedCatCacheEntry *) hash_search(SharedCatCacheHash, &key,
+												HASH_ENTER_NULL, &found);
+	if (entry == NULL || found)
+	{
+		/* no space, or somebody beat us to it */
+		LWLockRelease(SharedCatCacheLock);
+		return;
+	}
+
+	dp = dsa_allocate_extended(SharedCatCacheArea,
+							   MAXALIGN(sizeof(SharedCatCacheTuple)) +
+							   tuple->t_len,
+							   DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(dp))
+	{
+		hash_search(SharedCatCacheHash, &key, HASH_REMOVE, NULL);
+		LWLockRelease(SharedCatCacheLock);
+		return;
+	}
+
+	stup = dsa_get_address(SharedCatCacheArea, dp);
+	stup->t_len = tuple->t_len;
+	stup->t_self = tuple->t_self;
+	stup->t_tableOid = tuple->t_tableOid;
+	memcpy(SharedCatCacheTupleData(stup), tuple->t_data, tuple->t_len);
+
+	entry->reloid = cache->cc_reloid;
+	entry->tuple = dp;
+
+	LWLockRelease(SharedCatCacheLock);
+}
+
+/*
+ * Remove one entry, if present.  Caller must hold SharedCatCacheLock
+ * exclusively.
+ */
+static void
+shared_catcache_remove(SharedCatCacheKey *key)
+{
+	SharedCatCacheEntry *entry;
+
+	entry = (SharedCatCacheEntry *) hash_search(SharedCatCacheHash, key,
+												HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		dsa_free(SharedCatCacheArea, entry->tuple);
+		hash_search(SharedCatCacheHash, key, HASH_REMOVE, NULL);
+	}
+}
+
+/*
+ * Remove all entries from the given catalog.  Caller must hold
+ * SharedCatCacheLock exclusively.
+ */
+static void
+shared_catcache_remove_catalog(Oid dbid, Oid reloid)
+{
+	HASH_SEQ_STATUS status;
+	SharedCatCacheEntry *entry;
+
+	hash_seq_init(&status, SharedCatCacheHash);
+	while ((entry = (SharedCatCacheEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry->key.dbid == dbid && entry->reloid == reloid)
+		{
+			dsa_free(SharedCatCacheArea, entry->tuple);
+			hash_search(SharedCatCacheHash, &entry->key, HASH_REMOVE, NULL);
+		}
+	}
+}
+
+/*
+ * SharedCatCacheSendInvalidMessages
+ *		Add invalidation messages to the queue, and remove the entries they
+ *		invalidate from the shared catcache.
+ *
+ * This is used instead of SIInsertDataEntries() while the shared catcache
+ * is enabled.
+ */
+void
+SharedCatCacheSendInvalidMessages(const SharedInvalidationMessage *msgs,
+								  int n)
+{
+	if (!shared_catcache_usable())
+	{
+		SIInsertDataEntries(msgs, n);
+		return;
+	}
+
+	shared_catcache_attach();
+
+	LWLockAcquire(SharedCatCacheLock, LW_EXCLUSIVE);
+
+	SIInsertDataEntries(msgs, n);
+
+	for (int i = 0; i < n; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+
+		if (msg->id >= 0)
+		{
+			SharedCatCacheKey key;
+
+			memset(&key, 0, sizeof(key));
+			key.dbid = msg->cc.dbId;
+			key.cacheid = msg->id;
+			key.hashvalue = msg->cc.hashValue;
+			shared_catcache_remove(&key);
+		}
+		else if (msg->id == SHAREDINVALCATALOG_ID)
+			shared_catcache_remove_catalog(msg->cat.dbId, msg->cat.catId);
+	}
+
+	LWLockRelease(SharedCatCacheLock);
+}
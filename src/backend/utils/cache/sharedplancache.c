@@ -0,0 +1,649 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.c
+ *	  Cache of generic plans shared between backends.
+ *
+ * Every backend keeps its own plan cache (see plancache.c), so when many
+ * sessions prepare the same statements, each of them plans each statement
+ * on its own.  If shared_plan_cache_size is set, generic plans built by one
+ * backend are additionally stored in shared memory, and other backends that
+ * need a generic plan for the same statement load it from there instead of
+ * invoking the planner.
+ *
+ * Plan trees are full of pointers, so they can't be used in place.  They
+ * are stored in their nodeToString() representation, the same way parallel
+ * query ships plans to its workers, in a DSA area that lives in the main
+ * shared memory segment.  A backend using a shared plan rebuilds its own
+ * private copy with stringToNode().
+ *
+ * Entries are looked up by database, user, row_security setting and a hash
+ * of the query text, parameter types, cursor options and the active
+ * search_path; the hashed values are stored along with the plan and
+ * compared in full, so that hash collisions are harmless.  Only plans that
+ * would be reusable by plancache.c anyway are stored: no one-shot plans or
+ * transient plans, no plans whose parameters are resolved by parser hooks,
+ * and no plans on temporary relations.
+ *
+ * Invalidation works the same way as for backend-local plans: the relation
+ * OIDs and PlanInvalItems a plan depends on are stored with it, and the
+ * plan cache's sinval callbacks remove matching entries.  Since every
+ * backend receives every invalidation, stale entries are also removed by
+ * the backend that stored them, even if it built the plan while the
+ * invalidating transaction committed.  A plan obtained from the shared
+ * cache becomes the backend's generic plan and is revalidated by
+ * CheckCachedPlan() before use, which accepts pending invalidations while
+ * acquiring its locks, so a stale plan is never executed.
+ *
+ * When the cache is full, new plans are simply not stored.  Entries are
+ * only ever removed by invalidations.
+ *
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedplancache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/namespace.h"
+#include "catalog/pg_class.h"
+#include "common/hashfn.h"
+#include "miscadmin.h"
+#include "nodes/plannodes.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/dsa.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/sharedplancache.h"
+
+
+/* GUC variable: size of the shared plan cache in kB, 0 disables it */
+int			shared_plan_cache_size = 0;
+
+/*
+ * Expected average amount of memory used by one entry; determines the size
+ * of the hash table.
+ */
+#define SHARED_PLAN_AVG_KB		4
+
+/* hash table key */
+typedef struct SharedPlanKey
+{
+	Oid			dbid;			/* database the plan is for */
+	Oid			userid;			/* user the query was rewritten for */
+	uint32		hash;			/* hash of query text, search_path, etc */
+	bool		row_security;	/* row_security used during rewrite */
+} SharedPlanKey;
+
+/* hash table entry */
+typedef struct SharedPlanEntry
+{
+	SharedPlanKey key;			/* hash key; must be first */
+	dsa_pointer data;			/* SharedPlanData with the plan */
+} SharedPlanEntry;
+
+/*
+ * Plan and everything needed to verify that it matches a lookup, and to
+ * invalidate it.  The header is followed by these arrays, in this order:
+ *
+ *	Oid			param_types[nparams]
+ *	Oid			search_path[nsearch]
+ *	Oid			rels[nrels]
+ *	SharedPlanInvalItem inval_items[ninval]
+ *	char		query_string[querylen + 1]
+ *	char		plan_string[planlen + 1]
+ */
+typedef struct SharedPlanInvalItem
+{
+	int			cacheId;
+	uint32		hashValue;
+} SharedPlanInvalItem;
+
+typedef struct SharedPlanData
+{
+	int			cursor_options;
+	int			nparams;
+	int			nsearch;
+	int			nrels;
+	int			ninval;
+	int			querylen;
+	int			planlen;
+} SharedPlanData;
+
+#define SharedPlanParamTypes(d) \
+	((Oid *) ((char *) (d) + MAXALIGN(sizeof(SharedPlanData))))
+#define SharedPlanSearchPath(d) \
+	(SharedPlanParamTypes(d) + (d)->nparams)
+#define SharedPlanRels(d) \
+	(SharedPlanSearchPath(d) + (d)->nsearch)
+#define SharedPlanInvalItems(d) \
+	((SharedPlanInvalItem *) (SharedPlanRels(d) + (d)->nrels))
+#define SharedPlanQueryString(d) \
+	((char *) (SharedPlanInvalItems(d) + (d)->ninval))
+#define SharedPlanPlanString(d) \
+	(SharedPlanQueryString(d) + (d)->querylen + 1)
+
+/* shared memory state */
+typedef struct SharedPlanCacheCtl
+{
+	void	   *raw_dsa_area;	/* in-place DSA area for the plans */
+} SharedPlanCacheCtl;
+
+static SharedPlanCacheCtl *SharedPlanCache = NULL;
+static HTAB *SharedPlanHash = NULL;
+
+/* this backend's attachment to the DSA area */
+static dsa_area *SharedPlanArea = NULL;
+
+
+static Size
+shared_plan_cache_dsa_size(void)
+{
+	return MAXALIGN(Max((Size) shared_plan_cache_size * 1024,
+						dsa_minimum_size()));
+}
+
+static long
+shared_plan_cache_max_entries(void)
+{
+	return Max(shared_plan_cache_size / SHARED_PLAN_AVG_KB, 64);
+}
+
+/*
+ * Compute shared memory space needed for the shared plan cache
+ */
+Size
+SharedPlanCacheShmemSize(void)
+{
+	Size		size;
+
+	if (shared_plan_cache_size <= 0)
+		return 0;
+
+	size = MAXALIGN(sizeof(SharedPlanCacheCtl));
+	size = add_size(size, shared_plan_cache_dsa_size());
+	size = add_size(size, hash_estimate_size(shared_plan_cache_max_entries(),
+											 sizeof(SharedPlanEntry)));
+
+	return size;
+}
+
+/*
+ * Initialize the shared plan cache during startup
+ */
+void
+SharedPlanCacheShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+
+	if (shared_plan_cache_size <= 0)
+		return;
+
+	SharedPlanCache = (SharedPlanCacheCtl *)
+		ShmemInitStruct("Shared Plan Cache",
+						MAXALIGN(sizeof(SharedPlanCacheCtl)) +
+						shared_plan_cache_dsa_size(),
+						&found);
+
+	if (!IsUnderPostmaster)
+	{
+		dsa_area   *dsa;
+
+		Assert(!found);
+
+		/*
+		 * Create the DSA area within plain shared memory, and don't let it
+		 * grow beyond that; the cache's size is fixed by the GUC.
+		 */
+		SharedPlanCache->raw_dsa_area =
+			(char *) SharedPlanCache + MAXALIGN(sizeof(SharedPlanCacheCtl));
+		dsa = dsa_create_in_place(SharedPlanCache->raw_dsa_area,
+								  shared_plan_cache_dsa_size(),
+								  LWTRANCHE_SHARED_PLAN_CACHE_DSA, 0);
+		dsa_pin(dsa);
+		dsa_set_size_limit(dsa, shared_plan_cache_dsa_size());
+
+		/* postmaster will never access the area itself */
+		dsa_detach(dsa);
+	}
+	else
+		Assert(found);
+
+	info.keysize = sizeof(SharedPlanKey);
+	info.entrysize = sizeof(SharedPlanEntry);
+	SharedPlanHash = ShmemInitHash("Shared Plan Cache Hash",
+								   shared_plan_cache_max_entries(),
+								   shared_plan_cache_max_entries(),
+								   &info,
+								   HASH_ELEM | HASH_BLOBS | HASH_FIXED_SIZE);
+}
+
+/*
+ * Attach to the DSA area, if not done yet.  The mapping is kept for the
+ * lifetime of the backend.
+ */
+static void
+shared_plan_cache_attach(void)
+{
+	MemoryContext oldcontext;
+
+	if (SharedPlanArea != NULL)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	SharedPlanArea = dsa_attach_in_place(SharedPlanCache->raw_dsa_area, NULL);
+	dsa_pin_mapping(SharedPlanArea);
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Can plans for the given plansource be shared?
+ */
+static bool
+plansource_is_shareable(CachedPlanSource *plansource,
+						QueryEnvironment *queryEnv)
+{
+	ListCell   *lc;
+
+	if (shared_plan_cache_size <= 0)
+		return false;
+
+	/* only long-lived, fully specified statements */
+	if (!plansource->is_saved || plansource->is_oneshot ||
+		plansource->raw_parse_tree == NULL ||
+		plansource->parserSetup != NULL || queryEnv != NULL)
+		return false;
+
+	foreach(lc, plansource->query_list)
+	{
+		Query	   *query = lfirst_node(Query, lc);
+
+		if (query->commandType == CMD_UTILITY)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Build the lookup key for plansource in *key.  The search path is returned
+ * in *search_path.
+ */
+static void
+shared_plan_make_key(CachedPlanSource *plansource, SharedPlanKey *key,
+					 List **search_path)
+{
+	List	   *path = fetch_search_path(true);
+	uint32		hash;
+	ListCell   *lc;
+
+	/* zero padding, the key is hashed as a blob */
+	memset(key, 0, sizeof(SharedPlanKey));
+	key->dbid = MyDatabaseId;
+	key->userid = plansource->rewriteRoleId;
+	key->row_security = plansource->rewriteRowSecurity;
+
+	hash = hash_bytes((const unsigned char *) plansource->query_string,
+					  strlen(plansource->query_string));
+	hash = hash_combine(hash, hash_bytes_uint32(plansource->cursor_options));
+	for (int i = 0; i < plansource->num_params; i++)
+		hash = hash_combine(hash,
+							hash_bytes_uint32(plansource->param_types[i]));
+	foreach(lc, path)
+		hash = hash_combine(hash, hash_bytes_uint32(lfirst_oid(lc)));
+	key->hash = hash;
+
+	*search_path = path;
+}
+
+/*
+ * Does the stored plan data belong to plansource?
+ */
+static bool
+shared_plan_matches(SharedPlanData *data, CachedPlanSource *plansource,
+					List *search_path)
+{
+	Oid		   *path;
+	ListCell   *lc;
+	int			i;
+
+	if (data->cursor_options != plansource->cursor_options ||
+		data->nparams != plansource->num_params ||
+		data->nsearch != list_length(search_path))
+		return false;
+
+	if (data->nparams > 0 &&
+		memcmp(SharedPlanParamTypes(data), plansource->param_types,
+			   data->nparams * sizeof(Oid)) != 0)
+		return false;
+
+	path = SharedPlanSearchPath(data);
+	i = 0;
+	foreach(lc, search_path)
+	{
+		if (path[i++] != lfirst_oid(lc))
+			return false;
+	}
+
+	return strcmp(SharedPlanQueryString(data), plansource->query_string) == 0;
+}
+
+/*
+ * SharedPlanCacheLookup
+ *		Look for a generic plan for plansource built by any backend.
+ *
+ * Returns the plan's statement list, allocated in the current memory
+ * context, or NIL if there is none.  The caller must verify that the plan
+ * is still valid before using it.
+ */
+List *
+SharedPlanCacheLookup(CachedPlanSource *plansource, QueryEnvironment *queryEnv)
+{
+	SharedPlanKey key;
+	SharedPlanEntry *entry;
+	List	   *search_path;
+	char	   *planstr = NULL;
+
+	if (!plansource_is_shareable(plansource, queryEnv))
+		return NIL;
+
+	shared_plan_cache_attach();
+	shared_plan_make_key(plansource, &key, &search_path);
+
+	LWLockAcquire(SharedPlanCacheLock, LW_SHARED);
+
+	entry = (SharedPlanEntry *) hash_search(SharedPlanHash, &key,
+											HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		SharedPlanData *data = dsa_get_address(SharedPlanArea, entry->data);
+
+		if (shared_plan_matches(data, plansource, search_path))
+		{
+			planstr = palloc(data->planlen + 1);
+			memcpy(planstr, SharedPlanPlanString(data), data->planlen + 1);
+		}
+	}
+
+	LWLockRelease(SharedPlanCacheLock);
+
+	list_free(search_path);
+
+	if (planstr == NULL)
+		return NIL;
+
+	return (List *) stringToNode(planstr);
+}
+
+/*
+ * SharedPlanCacheStore
+ *		Offer the generic plan stmt_list of plansource to other backends.
+ *
+ * Does nothing if the plan isn't suitable for sharing, if an entry for the
+ * statement already exists, or if there's no space left.
+ */
+void
+SharedPlanCacheStore(CachedPlanSource *plansource, List *stmt_list,
+					 QueryEnvironment *queryEnv)
+{
+	SharedPlanKey key;
+	SharedPlanEntry *entry;
+	List	   *search_path;
+	List	   *rels;
+	List	   *invalitems;
+	char	   *planstr;
+	int			querylen;
+	int			planlen;
+	Size		size;
+	dsa_pointer dp;
+	SharedPlanData *data;
+	ListCell   *lc;
+	bool		found;
+	int			i;
+
+	if (!plansource_is_shareable(plansource, queryEnv))
+		return;
+
+	/* collect the dependencies of both the query and the plan */
+	rels = list_copy(plansource->relationOids);
+	invalitems = list_copy(plansource->invalItems);
+	foreach(lc, stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+
+		if (plannedstmt->commandType == CMD_UTILITY ||
+			plannedstmt->transientPlan)
+			return;
+		rels = list_concat_unique_oid(rels, plannedstmt->relationOids);
+		invalitems = list_concat(invalitems, plannedstmt->invalItems);
+	}
+
+	/* temporary relations are private to this backend */
+	foreach(lc, rels)
+	{
+		if (get_rel_persistence(lfirst_oid(lc)) == RELPERSISTENCE_TEMP)
+			return;
+	}
+
+	shared_plan_cache_attach();
+	shared_plan_make_key(plansource, &key, &search_path);
+
+	planstr = nodeToString(stmt_list);
+	querylen = strlen(plansource->query_string);
+	planlen = strlen(planstr);
+
+	size = MAXALIGN(sizeof(SharedPlanData));
+	size += (plansource->num_params + list_length(search_path) +
+			 list_length(rels)) * sizeof(Oid);
+	size += list_length(invalitems) * sizeof(SharedPlanInvalItem);
+	size += querylen + 1 + planlen + 1;
+
+	LWLockAcquire(SharedPlanCacheLock, LW_EXCLUSIVE);
+
+	entry = (SharedPlanEntry *) hash_search(SharedPlanHash, &key,
+											HASH_ENTER_NULL, &found);
+	if (entry == NULL || found)
+	{
+		/* no space, or somebody beat us to it */
+		LWLockRelease(SharedPlanCacheLock);
+		return;
+	}
+
+	dp = dsa_allocate_extended(SharedPlanArea, size, DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(dp))
+	{
+		hash_search(SharedPlanHash, &key, HASH_REMOVE, NULL);
+		LWLockRelease(SharedPlanCacheLock);
+		return;
+	}
+
+	data = dsa_get_address(SharedPlanArea, dp);
+	data->cursor_options = plansource->cursor_options;
+	data->nparams = plansource->num_params;
+	data->nsearch = list_length(search_path);
+	data->nrels = list_length(rels);
+	data->ninval = list_length(invalitems);
+	data->querylen = querylen;
+	data->planlen = planlen;
+
+	if (data->nparams > 0)
+		memcpy(SharedPlanParamTypes(data), plansource->param_types,
+			   data->nparams * sizeof(Oid));
+	i = 0;
+	foreach(lc, search_path)
+		SharedPlanSearchPath(data)[i++] = lfirst_oid(lc);
+	i = 0;
+	foreach(lc, rels)
+		SharedPlanRels(data)[i++] = lfirst_oid(lc);
+	i = 0;
+	foreach(lc, invalitems)
+	{
+		PlanInvalItem *item = (PlanInvalItem *) lfirst(lc);
+
+		SharedPlanInvalItems(data)[i].cacheId = item->cacheId;
+		SharedPlanInvalItems(data)[i].hashValue = item->hashValue;
+		i++;
+	}
+	memcpy(SharedPlanQueryString(data), plansource->query_string,
+		   querylen + 1);
+	memcpy(SharedPlanPlanString(data), planstr, planlen + 1);
+
+	entry->data = dp;
+
+	LWLockRelease(SharedPlanCacheLock);
+
+	pfree(planstr);
+	list_free(search_path);
+	list_free(rels);
+	list_free(invalitems);
+}
+
+/*
+ * Does the stored plan depend on the given relation, or on any relation if
+ * relid is InvalidOid?
+ */
+static bool
+shared_plan_depends_on_rel(SharedPlanData *data, Oid relid)
+{
+	Oid		   *rels = SharedPlanRels(data);
+
+	if (!OidIsValid(relid))
+		return data->nrels > 0;
+
+	for (int i = 0; i < data->nrels; i++)
+	{
+		if (rels[i] == relid)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Does the stored plan depend on the given syscache entry, or on any entry
+ * of the cache if hashvalue is zero?
+ */
+static bool
+shared_plan_depends_on_object(SharedPlanData *data, int cacheid,
+							  uint32 hashvalue)
+{
+	SharedPlanInvalItem *items = SharedPlanInvalItems(data);
+
+	for (int i = 0; i < data->ninval; i++)
+	{
+		if (items[i].cacheId == cacheid &&
+			(hashvalue == 0 || items[i].hashValue == hashvalue))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Remove all entries for which the callback returns true; or all entries,
+ * if it's NULL.
+ *
+ * Invalidations are frequent and usually don't affect any entry, so first
+ * check with only a shared lock whether there's anything to do.
+ */
+static void
+shared_plan_cache_remove(bool (*depends) (SharedPlanData *data, Oid relid,
+										  int cacheid, uint32 hashvalue),
+						 Oid relid, int cacheid, uint32 hashvalue)
+{
+	HASH_SEQ_STATUS status;
+	SharedPlanEntry *entry;
+	bool		any = false;
+
+	if (shared_plan_cache_size <= 0)
+		return;
+
+	shared_plan_cache_attach();
+
+	if (depends != NULL)
+	{
+		LWLockAcquire(SharedPlanCacheLock, LW_SHARED);
+		hash_seq_init(&status, SharedPlanHash);
+		while ((entry = (SharedPlanEntry *) hash_seq_search(&status)) != NULL)
+		{
+			SharedPlanData *data = dsa_get_address(SharedPlanArea,
+												   entry->data);
+
+			if (depends(data, relid, cacheid, hashvalue))
+			{
+				any = true;
+				hash_seq_term(&status);
+				break;
+			}
+		}
+		LWLockRelease(SharedPlanCacheLock);
+
+		if (!any)
+			return;
+	}
+
+	LWLockAcquire(SharedPlanCacheLock, LW_EXCLUSIVE);
+	hash_seq_init(&status, SharedPlanHash);
+	while ((entry = (SharedPlanEntry *) hash_seq_search(&status)) != NULL)
+	{
+		SharedPlanData *data = dsa_get_address(SharedPlanArea, entry->data);
+
+		if (depends == NULL || depends(data, relid, cacheid, hashvalue))
+		{
+			dsa_free(SharedPlanArea, entry->data);
+			hash_search(SharedPlanHash, &entry->key, HASH_REMOVE, NULL);
+		}
+	}
+	LWLockRelease(SharedPlanCacheLock);
+}
+
+static bool
+shared_plan_rel_callback(SharedPlanData *data, Oid relid,
+						 int cacheid, uint32 hashvalue)
+{
+	return shared_plan_depends_on_rel(data, relid);
+}
+
+static bool
+shared_plan_object_callback(SharedPlanData *data, Oid relid,
+							int cacheid, uint32 hashvalue)
+{
+	return shared_plan_depends_on_object(data, cacheid, hashvalue);
+}
+
+/*
+ * SharedPlanCacheInvalidateRel
+ *		Remove all shared plans mentioning the given relation, or all plans
+ *		mentioning any relation if relid is InvalidOid.
+ */
+void
+SharedPlanCacheInvalidateRel(Oid relid)
+{
+	shared_plan_cache_remove(shared_plan_rel_callback, relid, 0, 0);
+}
+
+/*
+ * SharedPlanCacheInvalidateObject
+ *		Remove all shared plans depending on the given syscache entry, or
+ *		on any entry of that cache if hashvalue is zero.
+ */
+void
+SharedPlanCacheInvalidateObject(int cacheid, uint32 hashvalue)
+{
+	shared_plan_cache_remove(shared_plan_object_callback,
+							 InvalidOid, cacheid, hashvalue);
+}
+
+/*
+ * SharedPlanCacheReset
+ *		Remove all shared plans.
+ */
+void
+SharedPlanCacheReset(void)
+{
+	shared_plan_cache_remove(NULL, InvalidOid, 0, 0);
+}
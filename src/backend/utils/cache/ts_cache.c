@@ -31,6 +31,7 @@
 #include "access/table.h"
 #include "access/xact.h"
 #include "catalog/namespace.h"
+#include "catalog/pg_namespace.h"
 #include "catalog/pg_ts_config.h"
 #include "catalog/pg_ts_config_map.h"
 #include "catalog/pg_ts_dict.h"
@@ -312,6 +313,19 @@ lookup_ts_dictionary_cache(Oid dictId)
 
 		entry->lexizeOid = template->tmpllexize;
 
+		/*
+		 * The built-in stateless templates return the same lexemes for the
+		 * same token every time, so their results may be remembered.
+		 * Thesaurus and third-party templates may keep state across calls,
+		 * so they are always called.
+		 */
+		entry->lexizeCacheable =
+			entry->lexizeOid == F_DSIMPLE_LEXIZE ||
+			entry->lexizeOid == F_DSYNONYM_LEXIZE ||
+			entry->lexizeOid == F_DISPELL_LEXIZE ||
+			(template->tmplnamespace == PG_CATALOG_NAMESPACE &&
+			 strcmp(NameStr(template->tmplname), "snowball") == 0);
+
 		if (OidIsValid(template->tmplinit))
 		{
 			List	   *dictoptions;
@@ -127,6 +127,9 @@
 /* Number of freelists to be used for a partitioned hash table. */
 #define NUM_FREELISTS			32
 
+/* Maximum chain length hash_search_unlocked() follows before giving up. */
+#define UNLOCKED_SEARCH_MAX_STEPS	32
+
 /* A hash bucket is a linked list of HASHELEMENTs */
 typedef HASHELEMENT *HASHBUCKET;
 
@@ -1134,6 +1137,47 @@ hash_search_with_hash_value(HTAB *hashp,
 	return NULL;				/* keep compiler quiet */
 }
 
+/*
+ * hash_search_unlocked -- look up a key in a partitioned shared hash table
+ * without holding any lock
+ *
+ * Since the caller holds no lock, concurrent insertions and deletions can
+ * make us find an entry that is being removed or just being filled in, miss
+ * an entry that exists, or even get diverted into another bucket's chain or
+ * a freelist.  None of that can lead to wild memory accesses, because the
+ * directory of a partitioned table never changes and its elements are never
+ * released, so every link we follow points to some element of the table;
+ * and we give up after a bounded number of steps, in case concurrent changes
+ * make us go around in circles.  The result is therefore only a hint: the
+ * caller must verify a returned entry by other means, and must not conclude
+ * from a NULL result that the key is absent.
+ */
+void *
+hash_search_unlocked(HTAB *hashp, const void *keyPtr, uint32 hashvalue)
+{
+	HASHHDR    *hctl = hashp->hctl;
+	uint32		bucket;
+	HASHSEGMENT segp;
+	HASHBUCKET	currBucket;
+	int			nsteps = 0;
+
+	Assert(IS_PARTITIONED(hctl));
+
+	bucket = calc_bucket(hctl, hashvalue);
+	segp = hashp->dir[bucket >> hashp->sshift];
+	currBucket = ((volatile HASHBUCKET *) segp)[MOD(bucket, hashp->ssize)];
+
+	while (currBucket != NULL && nsteps++ < UNLOCKED_SEARCH_MAX_STEPS)
+	{
+		if (currBucket->hashvalue == hashvalue &&
+			hashp->match(ELEMENTKEY(currBucket), keyPtr, hashp->keysize) == 0)
+			return (void *) ELEMENTKEY(currBucket);
+		currBucket = ((volatile HASHELEMENT *) currBucket)->link;
+	}
+
+	return NULL;
+}
+
 /*
  * hash_update_hash_key -- change the hash key of an existing table entry
  *
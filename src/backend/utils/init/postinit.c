@@ -35,6 +35,7 @@
 #include "catalog/pg_database.h"
 #include "catalog/pg_db_role_setting.h"
 #include "catalog/pg_tablespace.h"
+#include "executor/execSampling.h"
 #include "libpq/auth.h"
 #include "libpq/libpq-be.h"
 #include "mb/pg_wchar.h"
@@ -243,7 +244,9 @@ PerformAuthentication(Port *port)
 	 * Now perform authentication exchange.
 	 */
 	set_ps_display("authentication");
+	conn_timing.auth_start = GetCurrentTimestamp();
 	ClientAuthentication(port); /* might not return, if failure */
+	conn_timing.auth_end = GetCurrentTimestamp();
 
 	/*
 	 * Done with authentication.  Disable the timeout, and log if needed.
@@ -563,6 +566,39 @@ InitializeMaxBackends(void)
 		elog(ERROR, "too many backends configured");
 }
 
+/*
+ * Initialize the number of fast-path lock groups from max_locks_per_xact.
+ *
+ * We use the smallest power of two number of groups that gives at least
+ * max_locks_per_transaction fast-path slots per backend, up to
+ * FP_LOCK_GROUPS_PER_BACKEND_MAX.  A backend that locks many relations, such
+ * as a query on a partitioned table with many partitions, can then keep all
+ * those locks off the shared lock table, whose size is based on the same
+ * setting.
+ *
+ * The same rules as for InitializeMaxBackends() apply to when this must be
+ * called.
+ */
+void
+InitializeFastPathLocks(void)
+{
+	Assert(FastPathLockGroupsPerBackend == 0);
+
+	/* we need at least one group */
+	FastPathLockGroupsPerBackend = 1;
+
+	while (FastPathLockGroupsPerBackend < FP_LOCK_GROUPS_PER_BACKEND_MAX)
+	{
+		/* stop once we have enough slots for max_locks_per_xact */
+		if (FastPathLockSlotsPerBackend() >= max_locks_per_xact)
+			break;
+
+		FastPathLockGroupsPerBackend *= 2;
+	}
+
+	Assert(FastPathLockGroupsPerBackend <= FP_LOCK_GROUPS_PER_BACKEND_MAX);
+}
+
 /*
  * GUC check_hook for max_connections
  */
@@ -665,6 +701,9 @@ BaseInit(void)
 	 * drop ephemeral slots, which in turn triggers stats reporting.
 	 */
 	ReplicationSlotInitialize();
+
+	/* Start counting our memory in the total of all backends */
+	MemoryAccountingAttach();
 }
 
 
@@ -746,6 +785,9 @@ InitPostgres(const char *in_dbname, Oid dboid,
 	/* Now that we have a BackendId, we can participate in ProcSignal */
 	ProcSignalInit(MyBackendId);
 
+	/* ... and follow changes of the data checksum version */
+	InitLocalDataChecksumVersion();
+
 	/*
 	 * Also set up timeout handlers needed for backend operation.  We need
 	 * these in every case except bootstrap.
@@ -761,6 +803,7 @@ InitPostgres(const char *in_dbname, Oid dboid,
 		RegisterTimeout(CLIENT_CONNECTION_CHECK_TIMEOUT, ClientCheckTimeoutHandler);
 		RegisterTimeout(IDLE_STATS_UPDATE_TIMEOUT,
 						IdleStatsUpdateTimeoutHandler);
+		RegisterTimeout(QUERY_SAMPLE_TIMEOUT, QuerySampleTimeoutHandler);
 	}
 
 	/*
@@ -528,6 +528,20 @@ UtfToLocal(const unsigned char *utf, int len,
 		unsigned char b3 = 0;
 		unsigned char b4 = 0;
 
+		/*
+		 * Copy runs of ASCII a chunk at a time.  is_valid_ascii() also
+		 * rejects zero bytes, which are left for the per-character path.
+		 */
+		if (!IS_HIGHBIT_SET(*utf) && len >= sizeof(Vector8) &&
+			is_valid_ascii(utf, sizeof(Vector8)))
+		{
+			memcpy(iso, utf, sizeof(Vector8));
+			iso += sizeof(Vector8);
+			utf += sizeof(Vector8);
+			l = sizeof(Vector8);
+			continue;
+		}
+
 		/* "break" cases all represent errors */
 		if (*utf == '\0')
 			break;
@@ -745,6 +759,16 @@ LocalToUtf(const unsigned char *iso, int len,
 
 		if (!IS_HIGHBIT_SET(*iso))
 		{
+			/* copy runs of ASCII a chunk at a time, as in UtfToLocal */
+			if (len >= sizeof(Vector8) && is_valid_ascii(iso, sizeof(Vector8)))
+			{
+				memcpy(utf, iso, sizeof(Vector8));
+				utf += sizeof(Vector8);
+				iso += sizeof(Vector8);
+				l = sizeof(Vector8);
+				continue;
+			}
+
 			/* ASCII case is easy, assume it's one-to-one conversion */
 			*utf++ = *iso++;
 			l = 1;
@@ -49,6 +49,18 @@ iso8859_1_to_utf8(PG_FUNCTION_ARGS)
 	while (len > 0)
 	{
 		c = *src;
+
+		/* copy runs of ASCII a chunk at a time; this also rejects zeros */
+		if (!IS_HIGHBIT_SET(c) && len >= sizeof(Vector8) &&
+			is_valid_ascii(src, sizeof(Vector8)))
+		{
+			memcpy(dest, src, sizeof(Vector8));
+			dest += sizeof(Vector8);
+			src += sizeof(Vector8);
+			len -= sizeof(Vector8);
+			continue;
+		}
+
 		if (c == 0)
 		{
 			if (noError)
@@ -95,6 +107,15 @@ utf8_to_iso8859_1(PG_FUNCTION_ARGS)
 		/* fast path for ASCII-subset characters */
 		if (!IS_HIGHBIT_SET(c))
 		{
+			/* copy runs of ASCII a chunk at a time */
+			if (len >= sizeof(Vector8) && is_valid_ascii(src, sizeof(Vector8)))
+			{
+				memcpy(dest, src, sizeof(Vector8));
+				dest += sizeof(Vector8);
+				src += sizeof(Vector8);
+				len -= sizeof(Vector8);
+				continue;
+			}
 			*dest++ = c;
 			src++;
 			len--;
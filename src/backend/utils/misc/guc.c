@@ -30,9 +30,12 @@
 
 #include "access/xact.h"
 #include "access/xlog.h"
+#include "catalog/namespace.h"
 #include "catalog/objectaccess.h"
 #include "catalog/pg_authid.h"
 #include "catalog/pg_parameter_acl.h"
+#include "commands/async.h"
+#include "commands/prepare.h"
 #include "guc_internal.h"
 #include "libpq/pqformat.h"
 #include "parser/scansup.h"
@@ -48,6 +51,7 @@
 #include "utils/float.h"
 #include "utils/guc_tables.h"
 #include "utils/memutils.h"
+#include "utils/portal.h"
 #include "utils/timestamp.h"
 
 
@@ -75,8 +79,9 @@ char	   *GUC_check_errmsg_string;
 char	   *GUC_check_errdetail_string;
 char	   *GUC_check_errhint_string;
 
-/* Kluge: for speed, we examine this GUC variable's value directly */
+/* Kluge: for speed, we examine these GUC variables' values directly */
 extern bool in_hot_standby_guc;
+extern bool session_pinned_guc;
 
 
 /*
@@ -2564,6 +2569,11 @@ ReportChangedGUCOptions(void)
 		SetConfigOption("in_hot_standby", "false",
 						PGC_INTERNAL, PGC_S_OVERRIDE);
 
+	/* Likewise for session_pinned, which can change both ways */
+	if (SessionStateIsPinned() != session_pinned_guc)
+		SetConfigOption("session_pinned", session_pinned_guc ? "false" : "true",
+						PGC_INTERNAL, PGC_S_OVERRIDE);
+
 	/* Transmit new values of interesting variables */
 	slist_foreach_modify(iter, &guc_report_list)
 	{
@@ -2577,6 +2587,42 @@ ReportChangedGUCOptions(void)
 	}
 }
 
+/*
+ * SessionStateIsPinned: does the session hold state that would be lost if
+ * a connection pooler handed its client over to another backend?
+ *
+ * This is what session_pinned reports.  We consider temporary tables,
+ * named prepared statements, holdable cursors, LISTEN and parameters set
+ * with SET (not SET LOCAL).  Once a session has created its temporary
+ * namespace, it stays pinned even if all its temporary tables are dropped.
+ */
+bool
+SessionStateIsPinned(void)
+{
+	Oid			tempNamespaceId;
+	Oid			tempToastNamespaceId;
+	dlist_iter	iter;
+
+	GetTempNamespaceState(&tempNamespaceId, &tempToastNamespaceId);
+	if (OidIsValid(tempNamespaceId))
+		return true;
+
+	if (HavePreparedStatements() || HaveListenChannels() ||
+		ThereAreHoldablePortals())
+		return true;
+
+	dlist_foreach(iter, &guc_nondef_list)
+	{
+		struct config_generic *conf = dlist_container(struct config_generic,
+													  nondef_link, iter.cur);
+
+		if (conf->source == PGC_S_SESSION)
+			return true;
+	}
+
+	return false;
+}
+
 /*
  * ReportGUCOption: if appropriate, transmit option value to frontend
  *
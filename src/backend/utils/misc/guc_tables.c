@@ -28,6 +28,8 @@
 
 #include "access/commit_ts.h"
 #include "access/gin.h"
+#include "access/slru.h"
+#include "access/syncscan.h"
 #include "access/toast_compression.h"
 #include "access/twophase.h"
 #include "access/xlog_internal.h"
@@ -37,10 +39,14 @@
 #include "catalog/namespace.h"
 #include "catalog/storage.h"
 #include "commands/async.h"
+#include "commands/sequence.h"
 #include "commands/tablespace.h"
 #include "commands/trigger.h"
 #include "commands/user.h"
 #include "commands/vacuum.h"
+#include "executor/execRuntimeFilter.h"
+#include "executor/execSampling.h"
+#include "executor/nodeMemoize.h"
 #include "jit/jit.h"
 #include "libpq/auth.h"
 #include "libpq/libpq.h"
@@ -64,9 +70,13 @@
 #include "replication/slot.h"
 #include "replication/syncrep.h"
 #include "storage/bufmgr.h"
+#include "storage/buffile.h"
 #include "storage/large_object.h"
 #include "storage/pg_shmem.h"
 #include "storage/predicate.h"
+#include "storage/sinvaladt.h"
+#include "storage/smgr.h"
+#include "storage/procarray.h"
 #include "storage/standby.h"
 #include "tcop/tcopprot.h"
 #include "tsearch/ts_cache.h"
@@ -79,7 +89,11 @@
 #include "utils/pg_locale.h"
 #include "utils/portal.h"
 #include "utils/ps_status.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
 #include "utils/inval.h"
+#include "utils/tuplesort.h"
+#include "utils/varlena.h"
 #include "utils/xml.h"
 
 /* This value is normally passed in from the Makefile */
@@ -96,6 +110,7 @@ extern char *temp_tablespaces;
 extern bool ignore_checksum_failure;
 extern bool ignore_invalid_pages;
 extern bool synchronize_seqscans;
+extern int	seqscan_prefetch_depth;
 
 #ifdef TRACE_SYNCSCAN
 extern bool trace_syncscan;
@@ -430,10 +445,19 @@ static const struct config_enum_entry default_toast_compression_options[] = {
 	{"pglz", TOAST_PGLZ_COMPRESSION, false},
 #ifdef  USE_LZ4
 	{"lz4", TOAST_LZ4_COMPRESSION, false},
+#endif
+#ifdef  USE_ZSTD
+	{"zstd", TOAST_ZSTD_COMPRESSION, false},
 #endif
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry buffer_replacement_policy_options[] = {
+	{"clock", BUFFER_REPLACEMENT_CLOCK, false},
+	{"2q", BUFFER_REPLACEMENT_2Q, false},
+	{NULL, 0, false}
+};
+
 static const struct config_enum_entry wal_compression_options[] = {
 	{"pglz", WAL_COMPRESSION_PGLZ, false},
 #ifdef USE_LZ4
@@ -563,6 +587,7 @@ static char *log_timezone_string;
 static char *timezone_abbreviations_string;
 static char *data_directory;
 static char *session_authorization_string;
+static char *io_direct_string;
 static int	max_function_args;
 static int	max_index_keys;
 static int	max_identifier_length;
@@ -590,8 +615,9 @@ static char *recovery_target_lsn_string;
 /* should be static, but commands/variable.c needs to get at this */
 char	   *role_string;
 
-/* should be static, but guc.c needs to get at this */
+/* should be static, but guc.c needs to get at these */
 bool		in_hot_standby_guc;
+bool		session_pinned_guc;
 
 
 /*
@@ -946,6 +972,26 @@ struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_eager_aggregate", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables partial aggregation of a relation before it is joined."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_eager_aggregate,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_partitionwise_window", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables partitionwise computation of window functions."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_partitionwise_window,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_parallel_append", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of parallel append plans."),
@@ -966,6 +1012,16 @@ struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_parallel_hashagg", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel hashed aggregation plans."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_parallel_hashagg,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_partition_pruning", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables plan-time and execution-time partition pruning."),
@@ -993,6 +1049,46 @@ struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_group_by_reordering", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables reordering of GROUP BY keys."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_group_by_reordering,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_runtime_filter", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables hash joins to push Bloom filters down into scans."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_runtime_filter,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_shared_memoize", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables memoize nodes in parallel queries to share their cache."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_shared_memoize,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_linear_join_search", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of linearized dynamic programming for join search."),
+			gettext_noop("It replaces genetic query optimization for queries with at least geqo_threshold FROM items."),
+			GUC_EXPLAIN
+		},
+		&enable_linear_join_search,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_async_append", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of async append plans."),
@@ -1003,6 +1099,16 @@ struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_async_merge_append", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of async merge append plans."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_async_merge_append,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"geqo", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Enables genetic query optimization."),
@@ -1111,6 +1217,17 @@ struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"lockfree_buffer_lookup", PGC_SUSET, DEVELOPER_OPTIONS,
+			gettext_noop("Looks up shared buffers without taking the buffer mapping lock."),
+			gettext_noop("The result of the unlocked lookup is verified, and the "
+						 "lock is only taken if it fails."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&lockfree_buffer_lookup,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"ignore_invalid_pages", PGC_POSTMASTER, DEVELOPER_OPTIONS,
 			gettext_noop("Continues recovery after an invalid pages failure."),
@@ -1154,6 +1271,16 @@ struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"checkpoint_spread_sync", PGC_SIGHUP, WAL_CHECKPOINTS,
+			gettext_noop("Syncs files during the write phase of checkpoints, once they have been written."),
+			NULL
+		},
+		&CheckPointSpreadSync,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_init_zero", PGC_SUSET, WAL_SETTINGS,
 			gettext_noop("Writes zeroes to new WAL files before first use."),
@@ -1393,6 +1520,15 @@ struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"track_wait_timing", PGC_SUSET, STATS_CUMULATIVE,
+			gettext_noop("Collects timing statistics for wait events."),
+			NULL
+		},
+		&track_wait_timing,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"track_wal_io_timing", PGC_SUSET, STATS_CUMULATIVE,
 			gettext_noop("Collects timing statistics for WAL I/O activity."),
@@ -1613,6 +1749,24 @@ struct config_bool ConfigureNamesBool[] =
 		false,
 		check_default_with_oids, NULL, NULL
 	},
+	{
+		{"numa_interleave", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Spreads shared buffers evenly over all NUMA nodes."),
+			NULL
+		},
+		&numa_interleave,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"shared_snapshot_cache", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Lets sessions share the list of running transactions when taking snapshots."),
+			NULL
+		},
+		&shared_snapshot_cache,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"logging_collector", PGC_POSTMASTER, LOGGING_WHERE,
 			gettext_noop("Start a subprocess to capture stderr output and/or csvlogs into log files."),
@@ -1645,6 +1799,17 @@ struct config_bool ConfigureNamesBool[] =
 	},
 #endif
 
+	{
+		{"optimize_radix_sort", PGC_USERSET, DEVELOPER_OPTIONS,
+			gettext_noop("Enables radix sorting of large in-memory sorts."),
+			NULL,
+			GUC_NOT_IN_SAMPLE
+		},
+		&optimize_radix_sort,
+		true,
+		NULL, NULL, NULL
+	},
+
 #ifdef TRACE_SYNCSCAN
 	/* this is undocumented because not exposed in a standard build */
 	{
@@ -1780,6 +1945,17 @@ struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, show_in_hot_standby
 	},
 
+	{
+		{"session_pinned", PGC_INTERNAL, PRESET_OPTIONS,
+			gettext_noop("Shows whether the session holds state that ties it to its backend."),
+			NULL,
+			GUC_REPORT | GUC_NOT_IN_SAMPLE | GUC_DISALLOW_IN_FILE
+		},
+		&session_pinned_guc,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"allow_system_table_mods", PGC_SUSET, DEVELOPER_OPTIONS,
 			gettext_noop("Allows modifications of the structure of system tables."),
@@ -1843,7 +2019,7 @@ struct config_bool ConfigureNamesBool[] =
 		},
 		&data_checksums,
 		false,
-		NULL, NULL, NULL
+		NULL, NULL, show_data_checksums
 	},
 
 	{
@@ -1877,6 +2053,16 @@ struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"parallel_sort_partitioned_merge", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Divides the final merge of parallel sorts among all participants."),
+			NULL
+		},
+		&parallel_sort_partitioned_merge,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"jit", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("Allow JIT compilation."),
@@ -1888,6 +2074,30 @@ struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"full_sort_keys", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sorts strings in non-C collations using their full sort keys."),
+			gettext_noop("The sort key of each string is computed once and kept in memory, "
+						 "so that most comparisons don't need the collation library."),
+			GUC_EXPLAIN
+		},
+		&full_sort_keys,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"sort_modify_targets", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sorts the rows to update, delete or merge into by their location in the table."),
+			gettext_noop("The target table's pages are then visited in physical order, "
+						 "instead of the order in which the rows are found."),
+			GUC_EXPLAIN
+		},
+		&sort_modify_targets,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"jit_debugging_support", PGC_SU_BACKEND, DEVELOPER_OPTIONS,
 			gettext_noop("Register JIT-compiled functions with debugger."),
@@ -1993,6 +2203,16 @@ struct config_int ConfigureNamesInt[] =
 		0, 0, INT_MAX / 2,
 		NULL, NULL, NULL
 	},
+	{
+		{"archive_batch_size", PGC_SIGHUP, WAL_ARCHIVING,
+			gettext_noop("Sets the maximum number of WAL files archived at once."),
+			gettext_noop("With archive_command, the commands for the files "
+						 "of a batch run concurrently.")
+		},
+		&archive_batch_size,
+		1, 1, MAX_ARCHIVE_BATCH_SIZE,
+		NULL, NULL, NULL
+	},
 	{
 		{"post_auth_delay", PGC_BACKEND, DEVELOPER_OPTIONS,
 			gettext_noop("Sets the amount of time to wait after "
@@ -2115,6 +2335,16 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"max_standby_deferred_conflicts", PGC_POSTMASTER, REPLICATION_STANDBY,
+			gettext_noop("Sets the maximum number of snapshot conflicts a hot standby query can have replay defer to it."),
+			gettext_noop("Zero makes replay resolve all snapshot conflicts by waiting for or canceling queries.")
+		},
+		&max_standby_deferred_conflicts,
+		0, 0, 1000,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"recovery_min_apply_delay", PGC_SIGHUP, REPLICATION_STANDBY,
 			gettext_noop("Sets the minimum delay for applying changes during recovery."),
@@ -2191,6 +2421,48 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"shared_catcache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of shared memory used to share catalog cache entries between sessions."),
+			gettext_noop("0 disables the shared catalog cache."),
+			GUC_UNIT_KB
+		},
+		&shared_catcache_size,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_plan_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of shared memory used to share generic plans between sessions."),
+			gettext_noop("0 disables the shared plan cache."),
+			GUC_UNIT_KB
+		},
+		&shared_plan_cache_size,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_sequence_cache_entries", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of sequences whose cached values can be shared between sessions."),
+			gettext_noop("0 disables the shared sequence cache.")
+		},
+		&shared_sequence_cache_entries,
+		0, 0, 1048576,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"smgr_shared_relations", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of relations whose sizes are cached in shared memory."),
+			gettext_noop("0 disables the shared relation size cache.")
+		},
+		&smgr_shared_relations,
+		4096, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
 	/*
 	 * We sometimes multiply the number of shared buffers by two without
 	 * checking for overflow, so we mustn't allow more than INT_MAX / 2.
@@ -2206,6 +2478,114 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"shared_buffers_limit", PGC_SIGHUP, RESOURCES_MEM,
+			gettext_noop("Sets the number of shared memory buffers in use."),
+			gettext_noop("Zero means all of shared_buffers is used."),
+			GUC_UNIT_BLOCKS
+		},
+		&shared_buffers_limit,
+		0, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+	{
+		{"clock_sweep_partitions", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of independent clock sweeps used to choose buffers to replace."),
+			NULL
+		},
+		&clock_sweep_partitions,
+		1, 1, 1024,
+		NULL, NULL, NULL
+	},
+
+
+	{
+		{"commit_timestamp_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the commit timestamp cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&commit_timestamp_buffers,
+		0, 0, SLRU_MAX_ALLOWED_BUFFERS,
+		check_commit_ts_buffers, NULL, NULL
+	},
+
+	{
+		{"multixact_member_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the MultiXact member cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&multixact_member_buffers,
+		32, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_multixact_member_buffers, NULL, NULL
+	},
+
+	{
+		{"multixact_offset_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the MultiXact offset cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&multixact_offset_buffers,
+		16, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_multixact_offset_buffers, NULL, NULL
+	},
+
+	{
+		{"notify_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the LISTEN/NOTIFY message cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&notify_buffers,
+		16, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_notify_buffers, NULL, NULL
+	},
+
+	{
+		{"serializable_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the serializable transaction cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&serializable_buffers,
+		32, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_serial_buffers, NULL, NULL
+	},
+
+	{
+		{"subtransaction_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the subtransaction cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&subtransaction_buffers,
+		0, 0, SLRU_MAX_ALLOWED_BUFFERS,
+		check_subtrans_buffers, NULL, NULL
+	},
+
+	{
+		{"transaction_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the transaction status cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&transaction_buffers,
+		0, 0, SLRU_MAX_ALLOWED_BUFFERS,
+		check_transaction_buffers, NULL, NULL
+	},
+
+	{
+		{"sinval_queue_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of cache invalidation messages that can be queued for sessions to process."),
+			NULL
+		},
+		&sinval_queue_size,
+		4096, 4096, SINVAL_QUEUE_SIZE_MAX,
+		check_sinval_queue_size, NULL, NULL
+	},
+
 	{
 		{"shared_memory_size", PGC_INTERNAL, PRESET_OPTIONS,
 			gettext_noop("Shows the size of the server's main shared memory area (rounded up to the nearest MB)."),
@@ -2334,6 +2714,18 @@ struct config_int ConfigureNamesInt[] =
 	 * default for max_stack_depth.  InitializeGUCOptions will increase it if
 	 * possible, depending on the actual platform-specific stack limit.
 	 */
+	{
+		{"max_total_backend_memory", PGC_SIGHUP, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be allocated by all backends together."),
+			gettext_noop("Allocations that would exceed it fail with an out-of-memory error. "
+						 "0 disables the limit."),
+			GUC_UNIT_MB
+		},
+		&max_total_backend_memory,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"max_stack_depth", PGC_SUSET, RESOURCES_MEM,
 			gettext_noop("Sets the maximum stack depth, in kilobytes."),
@@ -2731,6 +3123,16 @@ struct config_int ConfigureNamesInt[] =
 		check_wal_buffers, NULL, NULL
 	},
 
+	{
+		{"wal_insert_locks", PGC_POSTMASTER, WAL_SETTINGS,
+			gettext_noop("Sets the number of locks used for concurrent WAL insertion."),
+			NULL
+		},
+		&NumXLogInsertLocks,
+		8, 1, 128,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_writer_delay", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Time between WAL flushes performed in the WAL writer."),
@@ -2967,6 +3369,19 @@ struct config_int ConfigureNamesInt[] =
 		NULL
 	},
 
+	{
+		{"seqscan_prefetch_depth",
+			PGC_USERSET,
+			RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Number of blocks a sequential scan prefetches ahead of the block being read."),
+			gettext_noop("0 disables sequential scan prefetching."),
+			GUC_EXPLAIN
+		},
+		&seqscan_prefetch_depth,
+		0, 0, MAX_IO_CONCURRENCY,
+		check_seqscan_prefetch_depth, NULL, NULL
+	},
+
 	{
 		{"backend_flush_after", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
 			gettext_noop("Number of pages after which previously performed writes are flushed to disk."),
@@ -3333,6 +3748,17 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"synchronize_seqscans_window", PGC_USERSET, COMPAT_OPTIONS_PREVIOUS,
+			gettext_noop("Sets how far a synchronized sequential scan may get ahead of other scans of the same table."),
+			gettext_noop("A scan further ahead waits for the others to catch up. Zero disables waiting."),
+			GUC_UNIT_BLOCKS
+		},
+		&synchronize_seqscans_window,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"min_parallel_table_scan_size", PGC_USERSET, QUERY_TUNING_COST,
 			gettext_noop("Sets the minimum amount of table data for a parallel scan."),
@@ -3389,6 +3815,17 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"query_sample_interval", PGC_SUSET, STATS_MONITORING,
+			gettext_noop("Sets the interval at which the plan nodes executed by queries are sampled."),
+			gettext_noop("A value of 0 turns off sampling."),
+			GUC_UNIT_MS
+		},
+		&query_sample_interval,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gin_pending_list_limit", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Sets the maximum size of the pending list for GIN index."),
@@ -3612,6 +4049,18 @@ struct config_real ConfigureNamesReal[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"nestloop_min_outer_rows", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the minimum number of outer rows the planner "
+						 "assumes when costing a nested loop join."),
+			gettext_noop("0 uses the estimated number of rows."),
+			GUC_EXPLAIN
+		},
+		&nestloop_min_outer_rows,
+		0.0, 0.0, DBL_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"geqo_selection_bias", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("GEQO: selective pressure within the population."),
@@ -3885,6 +4334,16 @@ struct config_string ConfigureNamesString[] =
 		check_primary_slot_name, NULL, NULL
 	},
 
+	{
+		{"wal_receiver_compression", PGC_SIGHUP, REPLICATION_STANDBY,
+			gettext_noop("Sets the compression to request for WAL streamed from the sending server."),
+			NULL
+		},
+		&wal_receiver_compression,
+		"none",
+		check_wal_receiver_compression, NULL, NULL
+	},
+
 	{
 		{"client_encoding", PGC_USERSET, CLIENT_CONN_LOCALE,
 			gettext_noop("Sets the client's character set encoding."),
@@ -3961,6 +4420,18 @@ struct config_string ConfigureNamesString[] =
 		check_temp_tablespaces, assign_temp_tablespaces, NULL
 	},
 
+	{
+		{"io_direct", PGC_POSTMASTER, RESOURCES_DISK,
+			gettext_noop("Sets which kinds of files are read and written with direct I/O."),
+			gettext_noop("Valid values are combinations of \"data\", \"wal\" "
+						 "and \"wal_init\"."),
+			GUC_LIST_INPUT
+		},
+		&io_direct_string,
+		"",
+		check_io_direct, assign_io_direct, NULL
+	},
+
 	{
 		{"createrole_self_grant", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Sets whether a CREATEROLE user automatically grants "
@@ -4771,6 +5242,26 @@ struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"logical_decoding_spill_compression", PGC_USERSET, RESOURCES_DISK,
+			gettext_noop("Compresses changes spilled to disk by logical decoding with specified method."),
+			NULL
+		},
+		&logical_decoding_spill_compression,
+		WAL_COMPRESSION_NONE, wal_compression_options,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"temp_file_compression", PGC_USERSET, RESOURCES_DISK,
+			gettext_noop("Compresses temporary files of hash joins with specified method."),
+			NULL
+		},
+		&temp_file_compression,
+		WAL_COMPRESSION_NONE, wal_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_level", PGC_POSTMASTER, WAL_SETTINGS,
 			gettext_noop("Sets the level of information written to the WAL."),
@@ -4832,6 +5323,16 @@ struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"buffer_replacement_policy", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the policy used to choose buffers to replace."),
+			NULL
+		},
+		&buffer_replacement_policy,
+		BUFFER_REPLACEMENT_CLOCK, buffer_replacement_policy_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"huge_pages", PGC_POSTMASTER, RESOURCES_MEM,
 			gettext_noop("Use of huge pages on Linux or Windows."),
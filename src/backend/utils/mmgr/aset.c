@@ -444,6 +444,11 @@ AllocSetContextCreateInternal(MemoryContext parent,
 	 * the context header and its block header follows that.
 	 */
 	set = (AllocSet) malloc(firstBlockSize);
+	if (set != NULL && !MemoryAccountingAllocate(firstBlockSize))
+	{
+		free(set);
+		set = NULL;
+	}
 	if (set == NULL)
 	{
 		if (TopMemoryContext)
@@ -452,7 +457,8 @@ AllocSetContextCreateInternal(MemoryContext parent,
 				(errcode(ERRCODE_OUT_OF_MEMORY),
 				 errmsg("out of memory"),
 				 errdetail("Failed while creating memory context \"%s\".",
-						   name)));
+						   name),
+				 errhint_memory_limit()));
 	}
 
 	/*
@@ -585,6 +591,7 @@ AllocSetReset(MemoryContext context)
 		{
 			/* Normal case, release the block */
 			context->mem_allocated -= block->endptr - ((char *) block);
+			MemoryAccountingFree(block->endptr - ((char *) block));
 
 #ifdef CLOBBER_FREED_MEMORY
 			wipe_mem(block, block->freeptr - ((char *) block));
@@ -653,6 +660,7 @@ AllocSetDelete(MemoryContext context)
 				freelist->num_free--;
 
 				/* All that remains is to free the header/initial block */
+				MemoryAccountingFree(oldset->keeper->endptr - ((char *) oldset));
 				free(oldset);
 			}
 			Assert(freelist->num_free == 0);
@@ -672,7 +680,10 @@ AllocSetDelete(MemoryContext context)
 		AllocBlock	next = block->next;
 
 		if (block != set->keeper)
+		{
 			context->mem_allocated -= block->endptr - ((char *) block);
+			MemoryAccountingFree(block->endptr - ((char *) block));
+		}
 
 #ifdef CLOBBER_FREED_MEMORY
 		wipe_mem(block, block->freeptr - ((char *) block));
@@ -687,6 +698,7 @@ AllocSetDelete(MemoryContext context)
 	Assert(context->mem_allocated == keepersize);
 
 	/* Finally, free the context header, including the keeper block */
+	MemoryAccountingFree(keepersize);
 	free(set);
 }
 
@@ -732,6 +744,11 @@ AllocSetAlloc(MemoryContext context, Size size)
 		block = (AllocBlock) malloc(blksize);
 		if (block == NULL)
 			return NULL;
+		if (!MemoryAccountingAllocate(blksize))
+		{
+			free(block);
+			return NULL;
+		}
 
 		context->mem_allocated += blksize;
 
@@ -942,6 +959,11 @@ AllocSetAlloc(MemoryContext context, Size size)
 
 		if (block == NULL)
 			return NULL;
+		if (!MemoryAccountingAllocate(blksize))
+		{
+			free(block);
+			return NULL;
+		}
 
 		context->mem_allocated += blksize;
 
@@ -1041,6 +1063,7 @@ AllocSetFree(void *pointer)
 			block->next->prev = block->prev;
 
 		set->header.mem_allocated -= block->endptr - ((char *) block);
+		MemoryAccountingFree(block->endptr - ((char *) block));
 
 #ifdef CLOBBER_FREED_MEMORY
 		wipe_mem(block, block->freeptr - ((char *) block));
@@ -1161,14 +1184,27 @@ AllocSetRealloc(void *pointer, Size size)
 		blksize = chksize + ALLOC_BLOCKHDRSZ + ALLOC_CHUNKHDRSZ;
 		oldblksize = block->endptr - ((char *) block);
 
+		/* Account for the growth first, so that we can refuse it */
+		if (blksize > oldblksize &&
+			!MemoryAccountingAllocate(blksize - oldblksize))
+		{
+			VALGRIND_MAKE_MEM_NOACCESS(chunk, ALLOCCHUNK_PRIVATE_LEN);
+			return NULL;
+		}
+
 		block = (AllocBlock) realloc(block, blksize);
 		if (block == NULL)
 		{
+			if (blksize > oldblksize)
+				MemoryAccountingFree(blksize - oldblksize);
 			/* Disallow external access to private part of chunk header. */
 			VALGRIND_MAKE_MEM_NOACCESS(chunk, ALLOCCHUNK_PRIVATE_LEN);
 			return NULL;
 		}
 
+		if (blksize < oldblksize)
+			MemoryAccountingFree(oldblksize - blksize);
+
 		/* updated separately, not to underflow when (oldblksize > blksize) */
 		set->header.mem_allocated -= oldblksize;
 		set->header.mem_allocated += blksize;
@@ -205,6 +205,11 @@ GenerationContextCreate(MemoryContext parent,
 	 * starts with the context header and its block header follows that.
 	 */
 	set = (GenerationContext *) malloc(allocSize);
+	if (set != NULL && !MemoryAccountingAllocate(allocSize))
+	{
+		free(set);
+		set = NULL;
+	}
 	if (set == NULL)
 	{
 		MemoryContextStats(TopMemoryContext);
@@ -212,7 +217,8 @@ GenerationContextCreate(MemoryContext parent,
 				(errcode(ERRCODE_OUT_OF_MEMORY),
 				 errmsg("out of memory"),
 				 errdetail("Failed while creating memory context \"%s\".",
-						   name)));
+						   name),
+				 errhint_memory_limit()));
 	}
 
 	/*
@@ -329,6 +335,8 @@ GenerationDelete(MemoryContext context)
 	/* Reset to release all releasable GenerationBlocks */
 	GenerationReset(context);
 	/* And free the context header and keeper block */
+	MemoryAccountingFree(MAXALIGN(sizeof(GenerationContext)) +
+						 ((GenerationContext *) context)->keeper->blksize);
 	free(context);
 }
 
@@ -372,6 +380,11 @@ GenerationAlloc(MemoryContext context, Size size)
 		block = (GenerationBlock *) malloc(blksize);
 		if (block == NULL)
 			return NULL;
+		if (!MemoryAccountingAllocate(blksize))
+		{
+			free(block);
+			return NULL;
+		}
 
 		context->mem_allocated += blksize;
 
@@ -475,6 +488,11 @@ GenerationAlloc(MemoryContext context, Size size)
 
 			if (block == NULL)
 				return NULL;
+			if (!MemoryAccountingAllocate(blksize))
+			{
+				free(block);
+				return NULL;
+			}
 
 			context->mem_allocated += blksize;
 
@@ -610,6 +628,7 @@ GenerationBlockFree(GenerationContext *set, GenerationBlock *block)
 	dlist_delete(&block->node);
 
 	((MemoryContext) set)->mem_allocated -= block->blksize;
+	MemoryAccountingFree(block->blksize);
 
 #ifdef CLOBBER_FREED_MEMORY
 	wipe_mem(block, block->blksize);
@@ -729,6 +748,7 @@ GenerationFree(void *pointer)
 	dlist_delete(&block->node);
 
 	set->header.mem_allocated -= block->blksize;
+	MemoryAccountingFree(block->blksize);
 	free(block);
 }
 
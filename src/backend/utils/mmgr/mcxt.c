@@ -99,6 +99,20 @@ static const MemoryContextMethods mcxt_methods[] = {
 	[MCTX_ALIGNED_REDIRECT_ID].check = NULL,	/* not required */
 #endif
 
+	/* bump.c */
+	[MCTX_BUMP_ID].alloc = BumpAlloc,
+	[MCTX_BUMP_ID].free_p = BumpFree,
+	[MCTX_BUMP_ID].realloc = BumpRealloc,
+	[MCTX_BUMP_ID].reset = BumpReset,
+	[MCTX_BUMP_ID].delete_context = BumpDelete,
+	[MCTX_BUMP_ID].get_chunk_context = BumpGetChunkContext,
+	[MCTX_BUMP_ID].get_chunk_space = BumpGetChunkSpace,
+	[MCTX_BUMP_ID].is_empty = BumpIsEmpty,
+	[MCTX_BUMP_ID].stats = BumpStats,
+#ifdef MEMORY_CONTEXT_CHECKING
+	[MCTX_BUMP_ID].check = BumpCheck,
+#endif
+
 
 	/*
 	 * Unused (as yet) IDs should have dummy entries here.  This allows us to
@@ -126,6 +140,41 @@ static const MemoryContextMethods mcxt_methods[] = {
 	[MCTX_UNUSED4_ID].realloc = BogusRealloc,
 	[MCTX_UNUSED4_ID].get_chunk_context = BogusGetChunkContext,
 	[MCTX_UNUSED4_ID].get_chunk_space = BogusGetChunkSpace,
+
+	[MCTX_UNUSED5_ID].free_p = BogusFree,
+	[MCTX_UNUSED5_ID].realloc = BogusRealloc,
+	[MCTX_UNUSED5_ID].get_chunk_context = BogusGetChunkContext,
+	[MCTX_UNUSED5_ID].get_chunk_space = BogusGetChunkSpace,
+
+	[MCTX_UNUSED6_ID].free_p = BogusFree,
+	[MCTX_UNUSED6_ID].realloc = BogusRealloc,
+	[MCTX_UNUSED6_ID].get_chunk_context = BogusGetChunkContext,
+	[MCTX_UNUSED6_ID].get_chunk_space = BogusGetChunkSpace,
+
+	[MCTX_UNUSED7_ID].free_p = BogusFree,
+	[MCTX_UNUSED7_ID].realloc = BogusRealloc,
+	[MCTX_UNUSED7_ID].get_chunk_context = BogusGetChunkContext,
+	[MCTX_UNUSED7_ID].get_chunk_space = BogusGetChunkSpace,
+
+	[MCTX_UNUSED8_ID].free_p = BogusFree,
+	[MCTX_UNUSED8_ID].realloc = BogusRealloc,
+	[MCTX_UNUSED8_ID].get_chunk_context = BogusGetChunkContext,
+	[MCTX_UNUSED8_ID].get_chunk_space = BogusGetChunkSpace,
+
+	[MCTX_UNUSED9_ID].free_p = BogusFree,
+	[MCTX_UNUSED9_ID].realloc = BogusRealloc,
+	[MCTX_UNUSED9_ID].get_chunk_context = BogusGetChunkContext,
+	[MCTX_UNUSED9_ID].get_chunk_space = BogusGetChunkSpace,
+
+	[MCTX_UNUSED10_ID].free_p = BogusFree,
+	[MCTX_UNUSED10_ID].realloc = BogusRealloc,
+	[MCTX_UNUSED10_ID].get_chunk_context = BogusGetChunkContext,
+	[MCTX_UNUSED10_ID].get_chunk_space = BogusGetChunkSpace,
+
+	[MCTX_UNUSED11_ID].free_p = BogusFree,
+	[MCTX_UNUSED11_ID].realloc = BogusRealloc,
+	[MCTX_UNUSED11_ID].get_chunk_context = BogusGetChunkContext,
+	[MCTX_UNUSED11_ID].get_chunk_space = BogusGetChunkSpace,
 };
 
 /*
@@ -671,6 +720,30 @@ MemoryContextMemAllocated(MemoryContext context, bool recurse)
 	return total;
 }
 
+/*
+ * MemoryContextMemConsumed
+ *		Add up the memory statistics of this memory context and all its
+ *		descendants into *consumed.
+ *
+ * Unlike MemoryContextStats(), this prints nothing.  The caller must zero
+ * *consumed first.
+ */
+void
+MemoryContextMemConsumed(MemoryContext context,
+						 MemoryContextCounters *consumed)
+{
+	MemoryContext child;
+
+	Assert(MemoryContextIsValid(context));
+
+	context->methods->stats(context, NULL, NULL, consumed, false);
+
+	for (child = context->firstchild;
+		 child != NULL;
+		 child = child->nextchild)
+		MemoryContextMemConsumed(child, consumed);
+}
+
 /*
  * MemoryContextStats
  *		Print statistics about the named context and all its descendants.
@@ -1029,7 +1102,8 @@ MemoryContextAlloc(MemoryContext context, Size size)
 				(errcode(ERRCODE_OUT_OF_MEMORY),
 				 errmsg("out of memory"),
 				 errdetail("Failed on request of size %zu in memory context \"%s\".",
-						   size, context->name)));
+						   size, context->name),
+				 errhint_memory_limit()));
 	}
 
 	VALGRIND_MEMPOOL_ALLOC(context, ret, size);
@@ -1065,7 +1139,8 @@ MemoryContextAllocZero(MemoryContext context, Size size)
 				(errcode(ERRCODE_OUT_OF_MEMORY),
 				 errmsg("out of memory"),
 				 errdetail("Failed on request of size %zu in memory context \"%s\".",
-						   size, context->name)));
+						   size, context->name),
+				 errhint_memory_limit()));
 	}
 
 	VALGRIND_MEMPOOL_ALLOC(context, ret, size);
@@ -1103,7 +1178,8 @@ MemoryContextAllocZeroAligned(MemoryContext context, Size size)
 				(errcode(ERRCODE_OUT_OF_MEMORY),
 				 errmsg("out of memory"),
 				 errdetail("Failed on request of size %zu in memory context \"%s\".",
-						   size, context->name)));
+						   size, context->name),
+				 errhint_memory_limit()));
 	}
 
 	VALGRIND_MEMPOOL_ALLOC(context, ret, size);
@@ -1141,7 +1217,8 @@ MemoryContextAllocExtended(MemoryContext context, Size size, int flags)
 					(errcode(ERRCODE_OUT_OF_MEMORY),
 					 errmsg("out of memory"),
 					 errdetail("Failed on request of size %zu in memory context \"%s\".",
-							   size, context->name)));
+							   size, context->name),
+					 errhint_memory_limit()));
 		}
 		return NULL;
 	}
@@ -1229,7 +1306,8 @@ palloc(Size size)
 				(errcode(ERRCODE_OUT_OF_MEMORY),
 				 errmsg("out of memory"),
 				 errdetail("Failed on request of size %zu in memory context \"%s\".",
-						   size, context->name)));
+						   size, context->name),
+				 errhint_memory_limit()));
 	}
 
 	VALGRIND_MEMPOOL_ALLOC(context, ret, size);
@@ -1260,7 +1338,8 @@ palloc0(Size size)
 				(errcode(ERRCODE_OUT_OF_MEMORY),
 				 errmsg("out of memory"),
 				 errdetail("Failed on request of size %zu in memory context \"%s\".",
-						   size, context->name)));
+						   size, context->name),
+				 errhint_memory_limit()));
 	}
 
 	VALGRIND_MEMPOOL_ALLOC(context, ret, size);
@@ -1296,7 +1375,8 @@ palloc_extended(Size size, int flags)
 					(errcode(ERRCODE_OUT_OF_MEMORY),
 					 errmsg("out of memory"),
 					 errdetail("Failed on request of size %zu in memory context \"%s\".",
-							   size, context->name)));
+							   size, context->name),
+					 errhint_memory_limit()));
 		}
 		return NULL;
 	}
@@ -1481,7 +1561,8 @@ repalloc(void *pointer, Size size)
 				(errcode(ERRCODE_OUT_OF_MEMORY),
 				 errmsg("out of memory"),
 				 errdetail("Failed on request of size %zu in memory context \"%s\".",
-						   size, cxt->name)));
+						   size, cxt->name),
+				 errhint_memory_limit()));
 	}
 
 #ifdef USE_VALGRIND
@@ -1526,7 +1607,8 @@ repalloc_extended(void *pointer, Size size, int flags)
 					(errcode(ERRCODE_OUT_OF_MEMORY),
 					 errmsg("out of memory"),
 					 errdetail("Failed on request of size %zu in memory context \"%s\".",
-							   size, cxt->name)));
+							   size, cxt->name),
+					 errhint_memory_limit()));
 		}
 		return NULL;
 	}
@@ -1583,7 +1665,8 @@ MemoryContextAllocHuge(MemoryContext context, Size size)
 				(errcode(ERRCODE_OUT_OF_MEMORY),
 				 errmsg("out of memory"),
 				 errdetail("Failed on request of size %zu in memory context \"%s\".",
-						   size, context->name)));
+						   size, context->name),
+				 errhint_memory_limit()));
 	}
 
 	VALGRIND_MEMPOOL_ALLOC(context, ret, size);
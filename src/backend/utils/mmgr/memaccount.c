@@ -0,0 +1,198 @@
+/*-------------------------------------------------------------------------
+ *
+ * memaccount.c
+ *	  Accounting of the memory allocated by backends.
+ *
+ * The memory context implementations report every block they obtain from
+ * or give back to malloc(), so that we always know how much memory the
+ * contexts of this process hold, without having to walk the context tree
+ * like MemoryContextMemAllocated() does.  Once attached to shared memory,
+ * each process also adds its total to a counter shared by all processes,
+ * which lets max_total_backend_memory limit the memory used by all
+ * backends together.
+ *
+ * To keep the shared counter from becoming a point of contention, each
+ * process only updates it after its own total has changed by
+ * MEMORY_ACCOUNTING_BATCH_SIZE since the last update, and the limit is
+ * checked only then.  The limit can therefore be exceeded by up to that
+ * much per process.
+ *
+ * Memory not allocated through memory contexts, such as shared memory or
+ * memory malloc'd directly by libraries, is not counted.
+ *
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/mmgr/memaccount.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/ipc.h"
+#include "storage/shmem.h"
+#include "utils/memutils_internal.h"
+
+
+/* GUC variable: limit on the memory of all backends in MB, 0 disables it */
+int			max_total_backend_memory = 0;
+
+/* bytes currently allocated from malloc by this process's contexts */
+uint64		backend_allocated_bytes = 0;
+
+/* change of backend_allocated_bytes not yet added to the shared counter */
+int64		backend_unreported_bytes = 0;
+
+/* bytes this process has added to the shared counter */
+static int64 backend_reported_bytes = 0;
+
+/* set when an allocation failed because of max_total_backend_memory */
+static bool limit_exceeded = false;
+
+typedef struct MemoryAccountingShared
+{
+	pg_atomic_uint64 total_bytes;	/* sum over all attached processes */
+} MemoryAccountingShared;
+
+static MemoryAccountingShared *MemoryAccounting = NULL;
+static bool attached = false;
+
+static void MemoryAccountingDetach(int code, Datum arg);
+
+
+/*
+ * Report shared memory space needed by MemoryAccountingShmemInit
+ */
+Size
+MemoryAccountingShmemSize(void)
+{
+	return sizeof(MemoryAccountingShared);
+}
+
+/*
+ * Allocate and initialize the shared counter
+ */
+void
+MemoryAccountingShmemInit(void)
+{
+	bool		found;
+
+	MemoryAccounting = (MemoryAccountingShared *)
+		ShmemInitStruct("Memory Accounting", MemoryAccountingShmemSize(),
+						&found);
+
+	if (!found)
+		pg_atomic_init_u64(&MemoryAccounting->total_bytes, 0);
+}
+
+/*
+ * Start adding this process's memory to the shared counter.
+ *
+ * Called from BaseInit().  The memory allocated so far, including what was
+ * inherited from the postmaster, is included.
+ */
+void
+MemoryAccountingAttach(void)
+{
+	Assert(!attached);
+
+	if (MemoryAccounting == NULL)
+		return;
+
+	attached = true;
+	backend_unreported_bytes = (int64) backend_allocated_bytes;
+	(void) MemoryAccountingReport(0);
+
+	on_shmem_exit(MemoryAccountingDetach, 0);
+}
+
+/*
+ * Remove this process's memory from the shared counter at exit.
+ */
+static void
+MemoryAccountingDetach(int code, Datum arg)
+{
+	pg_atomic_sub_fetch_u64(&MemoryAccounting->total_bytes,
+							backend_reported_bytes);
+	backend_reported_bytes = 0;
+	attached = false;
+}
+
+/*
+ * Add the changes accumulated in backend_unreported_bytes to the shared
+ * counter.
+ *
+ * 'size' is the size of the allocation that has caused the report, or 0 if
+ * it is caused by freeing memory.  If the allocation would bring the total
+ * over max_total_backend_memory, it is taken back out of the accounting and
+ * false is returned; the caller must then fail the allocation.
+ *
+ * The limit is only enforced for regular backends and background workers,
+ * and only while running a transaction outside of critical sections, so
+ * that it never causes a PANIC or makes a process fail outside of the
+ * error recovery a transaction abort provides.
+ */
+bool
+MemoryAccountingReport(Size size)
+{
+	uint64		total;
+
+	if (!attached)
+		return true;
+
+	total = pg_atomic_add_fetch_u64(&MemoryAccounting->total_bytes,
+									backend_unreported_bytes);
+	backend_reported_bytes += backend_unreported_bytes;
+	backend_unreported_bytes = 0;
+
+	if (size > 0 &&
+		max_total_backend_memory > 0 &&
+		total > (uint64) max_total_backend_memory * 1024 * 1024 &&
+		CritSectionCount == 0 &&
+		(MyBackendType == B_BACKEND || MyBackendType == B_BG_WORKER) &&
+		IsTransactionState())
+	{
+		pg_atomic_sub_fetch_u64(&MemoryAccounting->total_bytes, size);
+		backend_reported_bytes -= size;
+		backend_allocated_bytes -= size;
+		limit_exceeded = true;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Return the memory allocated by all processes attached to the shared
+ * counter, in bytes.
+ */
+uint64
+MemoryAccountingGetTotal(void)
+{
+	if (MemoryAccounting == NULL)
+		return backend_allocated_bytes;
+
+	return pg_atomic_read_u64(&MemoryAccounting->total_bytes);
+}
+
+/*
+ * errhint_memory_limit --- add an errhint to an out-of-memory error if the
+ * allocation failed because of max_total_backend_memory
+ */
+int
+errhint_memory_limit(void)
+{
+	if (limit_exceeded)
+	{
+		limit_exceeded = false;
+		errhint("The memory allocated by all backends exceeds \"max_total_backend_memory\" (%dMB).",
+				max_total_backend_memory);
+	}
+
+	return 0;					/* return value does not matter */
+}
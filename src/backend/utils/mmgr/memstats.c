@@ -0,0 +1,411 @@
+/*-------------------------------------------------------------------------
+ *
+ * memstats.c
+ *	  Publishing the memory context statistics of a process to others.
+ *
+ * pg_get_process_memory_contexts() shows the memory contexts of another
+ * server process.  The requesting backend bumps the request counter in the
+ * target's slot and signals it with PROCSIG_GET_MEMORY_CONTEXT.  At its
+ * next CHECK_FOR_INTERRUPTS(), the target walks its context tree, stores a
+ * MemoryContextStatsEntry for each context in a DSA area shared by all
+ * processes, and wakes up the requester through the slot's condition
+ * variable.  The requester copies the entries to local memory.
+ *
+ * The published statistics stay in the DSA area until the process publishes
+ * again, so each slot holds on to at most one set of them.  Several
+ * requesters can wait for the same process; all of them are served by the
+ * first publication that happens after their request.
+ *
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/mmgr/memstats.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "mb/pg_wchar.h"
+#include "miscadmin.h"
+#include "storage/condition_variable.h"
+#include "storage/lwlock.h"
+#include "storage/proc.h"
+#include "storage/procarray.h"
+#include "storage/procsignal.h"
+#include "storage/shmem.h"
+#include "utils/dsa.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+#include "utils/wait_event.h"
+
+/* Initial size of the DSA area; it grows as needed */
+#define MEMORY_STATS_DSA_SIZE	(256 * 1024)
+
+/* Per-process slot */
+typedef struct MemoryStatsSlot
+{
+	LWLock		lock;			/* protects the fields below */
+	ConditionVariable cv;		/* signaled when statistics are published */
+	uint32		request_gen;	/* bumped by each request */
+	uint32		published_gen;	/* request_gen as of the last publication */
+	int			pid;			/* process that published the statistics */
+	int			nentries;
+	dsa_pointer entries;		/* array of MemoryContextStatsEntry */
+} MemoryStatsSlot;
+
+typedef struct MemoryStatsCtl
+{
+	void	   *raw_dsa_area;	/* in-place DSA area for the statistics */
+	MemoryStatsSlot slots[FLEXIBLE_ARRAY_MEMBER];	/* indexed by pgprocno */
+} MemoryStatsCtl;
+
+static MemoryStatsCtl *MemoryStats = NULL;
+static dsa_area *MemoryStatsArea = NULL;
+
+static int	memory_stats_nslots(void);
+static void memory_stats_attach(void);
+static int	count_memory_contexts(MemoryContext context);
+static void fill_memory_stats(MemoryContext context, int parent, int level,
+							  MemoryContextStatsEntry *entries, int *n,
+							  int max);
+
+
+static int
+memory_stats_nslots(void)
+{
+	return MaxBackends + NUM_AUXILIARY_PROCS;
+}
+
+static Size
+memory_stats_ctl_size(void)
+{
+	return MAXALIGN(add_size(offsetof(MemoryStatsCtl, slots),
+							 mul_size(memory_stats_nslots(),
+									  sizeof(MemoryStatsSlot))));
+}
+
+/*
+ * Report shared memory space needed by MemoryStatsShmemInit
+ */
+Size
+MemoryStatsShmemSize(void)
+{
+	return add_size(memory_stats_ctl_size(), MEMORY_STATS_DSA_SIZE);
+}
+
+/*
+ * Allocate and initialize the slots and the DSA area
+ */
+void
+MemoryStatsShmemInit(void)
+{
+	bool		found;
+
+	MemoryStats = (MemoryStatsCtl *)
+		ShmemInitStruct("Memory Context Statistics", MemoryStatsShmemSize(),
+						&found);
+
+	if (!IsUnderPostmaster)
+	{
+		dsa_area   *dsa;
+		int			i;
+
+		Assert(!found);
+
+		for (i = 0; i < memory_stats_nslots(); i++)
+		{
+			MemoryStatsSlot *slot = &MemoryStats->slots[i];
+
+			LWLockInitialize(&slot->lock, LWTRANCHE_MEMORY_STATS);
+			ConditionVariableInit(&slot->cv);
+			slot->request_gen = 0;
+			slot->published_gen = 0;
+			slot->pid = 0;
+			slot->nentries = 0;
+			slot->entries = InvalidDsaPointer;
+		}
+
+		MemoryStats->raw_dsa_area =
+			(char *) MemoryStats + memory_stats_ctl_size();
+		dsa = dsa_create_in_place(MemoryStats->raw_dsa_area,
+								  MEMORY_STATS_DSA_SIZE,
+								  LWTRANCHE_MEMORY_STATS_DSA, 0);
+		dsa_pin(dsa);
+
+		/* postmaster will never access the area itself */
+		dsa_detach(dsa);
+	}
+	else
+		Assert(found);
+}
+
+/*
+ * Attach to the DSA area, if not done yet.  The mapping is kept for the
+ * lifetime of the process.
+ */
+static void
+memory_stats_attach(void)
+{
+	MemoryContext oldcontext;
+
+	if (MemoryStatsArea != NULL)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	MemoryStatsArea = dsa_attach_in_place(MemoryStats->raw_dsa_area, NULL);
+	dsa_pin_mapping(MemoryStatsArea);
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * HandleGetMemoryContextInterrupt
+ *		Handle receipt of an interrupt requesting the publication of memory
+ *		context statistics.
+ *
+ * All the actual work is deferred to ProcessGetMemoryContextInterrupt().
+ */
+void
+HandleGetMemoryContextInterrupt(void)
+{
+	InterruptPending = true;
+	PublishMemoryContextPending = true;
+	/* latch will be set by procsignal_sigusr1_handler */
+}
+
+/*
+ * ProcessGetMemoryContextInterrupt
+ *		Publish the statistics of all memory contexts of this process.
+ *
+ * Any process that participates in ProcSignal signaling must arrange to
+ * call this function if it sees PublishMemoryContextPending set.
+ */
+void
+ProcessGetMemoryContextInterrupt(void)
+{
+	MemoryStatsSlot *slot;
+	int			ncontexts;
+	dsa_pointer dp;
+	int			n = 0;
+
+	PublishMemoryContextPending = false;
+
+	Assert(MyProc != NULL && MyProc->pgprocno < memory_stats_nslots());
+	slot = &MemoryStats->slots[MyProc->pgprocno];
+
+	memory_stats_attach();
+
+	ncontexts = count_memory_contexts(TopMemoryContext);
+
+	LWLockAcquire(&slot->lock, LW_EXCLUSIVE);
+
+	/* Nothing to do if all requests have been served already */
+	if (slot->pid == MyProcPid && slot->published_gen == slot->request_gen)
+	{
+		LWLockRelease(&slot->lock);
+		return;
+	}
+
+	/* Replace the previous statistics */
+	if (DsaPointerIsValid(slot->entries))
+		dsa_free(MemoryStatsArea, slot->entries);
+	slot->entries = InvalidDsaPointer;
+	slot->nentries = 0;
+
+	/*
+	 * If there isn't enough memory, publish no statistics at all rather than
+	 * failing; we might be at any CHECK_FOR_INTERRUPTS().
+	 */
+	dp = dsa_allocate_extended(MemoryStatsArea,
+							   mul_size(ncontexts,
+										sizeof(MemoryContextStatsEntry)),
+							   DSA_ALLOC_HUGE | DSA_ALLOC_NO_OOM);
+	if (DsaPointerIsValid(dp))
+	{
+		MemoryContextStatsEntry *entries = dsa_get_address(MemoryStatsArea, dp);
+
+		fill_memory_stats(TopMemoryContext, -1, 0, entries, &n, ncontexts);
+
+		slot->entries = dp;
+		slot->nentries = n;
+	}
+
+	slot->pid = MyProcPid;
+	slot->published_gen = slot->request_gen;
+
+	LWLockRelease(&slot->lock);
+
+	ConditionVariableBroadcast(&slot->cv);
+}
+
+static int
+count_memory_contexts(MemoryContext context)
+{
+	MemoryContext child;
+	int			n = 1;
+
+	for (child = context->firstchild; child != NULL; child = child->nextchild)
+		n += count_memory_contexts(child);
+
+	return n;
+}
+
+/* copy a name or identifier, clipped to the space available */
+static void
+copy_context_name(char *dest, const char *src)
+{
+	int			len;
+
+	if (src == NULL)
+	{
+		dest[0] = '\0';
+		return;
+	}
+
+	len = strlen(src);
+	if (len >= MEMORY_CONTEXT_STATS_NAME_LEN)
+		len = pg_mbcliplen(src, len, MEMORY_CONTEXT_STATS_NAME_LEN - 1);
+	memcpy(dest, src, len);
+	dest[len] = '\0';
+}
+
+/*
+ * Fill in the entries for a context and its descendants, in depth-first
+ * order.  Contexts beyond 'max' entries are left out, just in case some
+ * were created since we counted them.
+ */
+static void
+fill_memory_stats(MemoryContext context, int parent, int level,
+				  MemoryContextStatsEntry *entries, int *n, int max)
+{
+	MemoryContextStatsEntry *entry;
+	int			self;
+	const char *name = context->name;
+	const char *ident = context->ident;
+	MemoryContext child;
+
+	if (*n >= max)
+		return;
+	self = (*n)++;
+	entry = &entries[self];
+
+	/* label dynahash contexts with just the hash table name, as elsewhere */
+	if (ident && strcmp(name, "dynahash") == 0)
+	{
+		name = ident;
+		ident = NULL;
+	}
+
+	copy_context_name(entry->name, name);
+	copy_context_name(entry->ident, ident);
+	entry->parent = parent;
+	entry->level = level;
+	entry->type = nodeTag(context);
+	memset(&entry->counters, 0, sizeof(entry->counters));
+	context->methods->stats(context, NULL, NULL, &entry->counters, true);
+
+	for (child = context->firstchild; child != NULL; child = child->nextchild)
+		fill_memory_stats(child, self, level + 1, entries, n, max);
+}
+
+/*
+ * Ask the process with the given PID to publish its memory context
+ * statistics, and wait up to timeout_ms milliseconds for them.
+ *
+ * Returns a palloc'd array of the entries and sets *nentries, or returns
+ * NULL after emitting a WARNING if the statistics could not be obtained.
+ */
+MemoryContextStatsEntry *
+MemoryContextStatsRequest(int pid, long timeout_ms, int *nentries)
+{
+	PGPROC	   *proc;
+	BackendId	backendId = InvalidBackendId;
+	MemoryStatsSlot *slot;
+	uint32		gen;
+	TimestampTz start;
+	MemoryContextStatsEntry *result = NULL;
+
+	*nentries = 0;
+
+	/* See pg_log_backend_memory_contexts() */
+	proc = BackendPidGetProc(pid);
+	if (proc != NULL)
+		backendId = proc->backendId;
+	else
+		proc = AuxiliaryPidGetProc(pid);
+
+	if (proc == NULL)
+	{
+		ereport(WARNING,
+				(errmsg("PID %d is not a PostgreSQL server process", pid)));
+		return NULL;
+	}
+
+	Assert(proc->pgprocno < memory_stats_nslots());
+	slot = &MemoryStats->slots[proc->pgprocno];
+
+	memory_stats_attach();
+
+	LWLockAcquire(&slot->lock, LW_EXCLUSIVE);
+	gen = ++slot->request_gen;
+	LWLockRelease(&slot->lock);
+
+	if (pid == MyProcPid)
+		ProcessGetMemoryContextInterrupt();
+	else if (SendProcSignal(pid, PROCSIG_GET_MEMORY_CONTEXT, backendId) < 0)
+	{
+		ereport(WARNING,
+				(errmsg("could not send signal to process %d: %m", pid)));
+		return NULL;
+	}
+
+	start = GetCurrentTimestamp();
+	ConditionVariablePrepareToSleep(&slot->cv);
+
+	for (;;)
+	{
+		long		remaining;
+
+		LWLockAcquire(&slot->lock, LW_SHARED);
+		if (slot->pid == pid && (int32) (slot->published_gen - gen) >= 0)
+		{
+			if (slot->nentries > 0)
+			{
+				Size		size = mul_size(slot->nentries,
+											sizeof(MemoryContextStatsEntry));
+
+				result = palloc_extended(size, MCXT_ALLOC_HUGE);
+				memcpy(result,
+					   dsa_get_address(MemoryStatsArea, slot->entries),
+					   size);
+				*nentries = slot->nentries;
+			}
+			LWLockRelease(&slot->lock);
+
+			if (result == NULL)
+				ereport(WARNING,
+						(errmsg("process %d could not publish its memory context statistics",
+								pid)));
+			break;
+		}
+		LWLockRelease(&slot->lock);
+
+		remaining = timeout_ms -
+			TimestampDifferenceMilliseconds(start, GetCurrentTimestamp());
+		if (remaining <= 0)
+		{
+			ereport(WARNING,
+					(errmsg("timed out waiting for memory context statistics of process %d",
+							pid)));
+			break;
+		}
+
+		(void) ConditionVariableTimedSleep(&slot->cv, remaining,
+										   WAIT_EVENT_MEMORY_CONTEXT_STATS);
+	}
+
+	ConditionVariableCancelSleep();
+
+	return result;
+}
@@ -1184,6 +1184,31 @@ ThereAreNoReadyPortals(void)
 	return true;
 }
 
+/*
+ * Are there any portals for holdable cursors?
+ */
+bool
+ThereAreHoldablePortals(void)
+{
+	HASH_SEQ_STATUS status;
+	PortalHashEnt *hentry;
+
+	hash_seq_init(&status, PortalHashTable);
+
+	while ((hentry = (PortalHashEnt *) hash_seq_search(&status)) != NULL)
+	{
+		Portal		portal = hentry->portal;
+
+		if (portal->cursorOptions & CURSOR_OPT_HOLD)
+		{
+			hash_seq_term(&status);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /*
  * Hold all pinned portals.
  *
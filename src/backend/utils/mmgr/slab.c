@@ -358,6 +358,12 @@ SlabContextCreate(MemoryContext parent,
 
 
 	slab = (SlabContext *) malloc(Slab_CONTEXT_HDRSZ(chunksPerBlock));
+	if (slab != NULL &&
+		!MemoryAccountingAllocate(Slab_CONTEXT_HDRSZ(chunksPerBlock)))
+	{
+		free(slab);
+		slab = NULL;
+	}
 	if (slab == NULL)
 	{
 		MemoryContextStats(TopMemoryContext);
@@ -365,7 +371,8 @@ SlabContextCreate(MemoryContext parent,
 				(errcode(ERRCODE_OUT_OF_MEMORY),
 				 errmsg("out of memory"),
 				 errdetail("Failed while creating memory context \"%s\".",
-						   name)));
+						   name),
+				 errhint_memory_limit()));
 	}
 
 	/*
@@ -449,6 +456,7 @@ SlabReset(MemoryContext context)
 #endif
 		free(block);
 		context->mem_allocated -= slab->blockSize;
+		MemoryAccountingFree(slab->blockSize);
 	}
 
 	/* walk over blocklist and free the blocks */
@@ -465,6 +473,7 @@ SlabReset(MemoryContext context)
 #endif
 			free(block);
 			context->mem_allocated -= slab->blockSize;
+			MemoryAccountingFree(slab->blockSize);
 		}
 	}
 
@@ -483,6 +492,7 @@ SlabDelete(MemoryContext context)
 	/* Reset to release all the SlabBlocks */
 	SlabReset(context);
 	/* And free the context header */
+	MemoryAccountingFree(Slab_CONTEXT_HDRSZ(((SlabContext *) context)->chunksPerBlock));
 	free(context);
 }
 
@@ -543,6 +553,11 @@ SlabAlloc(MemoryContext context, Size size)
 
 			if (unlikely(block == NULL))
 				return NULL;
+			if (unlikely(!MemoryAccountingAllocate(slab->blockSize)))
+			{
+				free(block);
+				return NULL;
+			}
 
 			block->slab = slab;
 			context->mem_allocated += slab->blockSize;
@@ -732,6 +747,7 @@ SlabFree(void *pointer)
 #endif
 			free(block);
 			slab->header.mem_allocated -= slab->blockSize;
+			MemoryAccountingFree(slab->blockSize);
 		}
 
 		/*
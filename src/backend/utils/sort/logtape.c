@@ -1152,6 +1152,51 @@ LogicalTapeSeek(LogicalTape *lt, long blocknum, int offset)
 	lt->pos = offset;
 }
 
+/*
+ * Position an imported tape for reading at an arbitrary position.
+ *
+ * blocknum/offset must be a position returned by LogicalTapeTell() in the
+ * worker that wrote the tape, or the tape's first block number and zero to
+ * read it from the start.  Unlike LogicalTapeSeek(), this works on a tape
+ * that was imported with LogicalTapeImport() and not rewound, and can be
+ * called any number of times to reposition the tape.  Blocks are never
+ * recycled after being read, since the tape belongs to another process.
+ */
+void
+LogicalTapeSeekImported(LogicalTape *lt, size_t buffer_size,
+						long blocknum, int offset)
+{
+	Assert(!lt->dirty);
+	Assert(offset >= 0 && offset <= TapeBlockPayloadSize);
+
+	/* Round and cap buffer_size, like LogicalTapeRewindForRead() */
+	if (buffer_size < BLCKSZ)
+		buffer_size = BLCKSZ;
+	if (buffer_size > lt->max_size)
+		buffer_size = lt->max_size;
+	buffer_size -= buffer_size % BLCKSZ;
+
+	/* Treat the tape as frozen, so that blocks are not released */
+	lt->writing = false;
+	lt->frozen = true;
+
+	if (lt->buffer == NULL || lt->buffer_size != buffer_size)
+	{
+		if (lt->buffer)
+			pfree(lt->buffer);
+		lt->buffer = palloc(buffer_size);
+		lt->buffer_size = buffer_size;
+	}
+
+	/* Fill the buffer starting at the target block */
+	lt->nextBlockNumber = blocknum;
+	ltsReadFillBuffer(lt);
+
+	if (offset > lt->nbytes)
+		elog(ERROR, "invalid tape seek position");
+	lt->pos = offset;
+}
+
 /*
  * Obtain current position in a form suitable for a later LogicalTapeSeek.
  *
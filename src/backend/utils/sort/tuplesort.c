@@ -87,6 +87,15 @@
  * worker process.  This is then merged.  Worker processes are guaranteed to
  * produce exactly one output run from their partial input.
  *
+ * Optionally, the final merge can itself be divided among the participants
+ * (a "partitioned merge").  While writing its output run, each worker
+ * remembers the position of every Nth tuple ("fences").  Once all workers
+ * are done, each participant reads the tuples at all the fences, chooses the
+ * same set of splitter tuples from them, and merges the key range between
+ * its two splitters from all worker runs into a run of its own.  As the
+ * resulting runs cover disjoint, ascending key ranges, the leader finally
+ * just needs to read them one after another, rather than merging them.
+ *
  *
  * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -106,11 +115,13 @@
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
+#include "storage/condition_variable.h"
 #include "storage/shmem.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
 #include "utils/rel.h"
 #include "utils/tuplesort.h"
+#include "utils/wait_event.h"
 
 /*
  * Initial size of memtuples array.  We're trying to select this size so that
@@ -131,6 +142,9 @@ bool		trace_sort = false;
 bool		optimize_bounded_sort = true;
 #endif
 
+bool		parallel_sort_partitioned_merge = false;
+bool		optimize_radix_sort = true;
+
 
 /*
  * During merge, we use a pre-allocated set of fixed-size slots to hold
@@ -182,6 +196,51 @@ typedef enum
 #define TAPE_BUFFER_OVERHEAD		BLCKSZ
 #define MERGE_BUFFER_SIZE			(BLCKSZ * 32)
 
+/*
+ * In-memory sorts of at least RADIX_SORT_MIN_TUPLES tuples whose leading
+ * datum1 uses one of the specialized comparators are radix sorted.  Buckets
+ * of fewer than RADIX_SORT_MIN_BUCKET tuples are finished off with the
+ * corresponding specialized quicksort instead.
+ */
+#define RADIX_SORT_MIN_TUPLES		1024
+#define RADIX_SORT_MIN_BUCKET		64
+
+/*
+ * Maximum number of fences remembered for each worker's output run in a
+ * partitioned merge.  Every participant reads the tuples at all the fences
+ * of all workers, so this should not be too large.
+ */
+#define SORT_PARTITION_FENCES		32
+
+
+/*
+ * Position of a tuple in a worker's output run, as returned by
+ * LogicalTapeTell()
+ */
+typedef struct SortFence
+{
+	long		blocknum;
+	int			offset;
+} SortFence;
+
+/*
+ * Per-participant state of a partitioned merge.
+ *
+ * Fence i is the position of the tuple with zero-based index
+ * (i + 1) * stride in the participant's output run.  Whenever the array of
+ * fences fills up, every other fence is discarded and the stride doubles, so
+ * that the fences stay evenly spread over the run.
+ */
+typedef struct SortPartition
+{
+	int64		ntuples;		/* number of tuples in the output run */
+	int64		stride;			/* number of tuples between fences */
+	int			nfences;		/* number of valid fences */
+	SortFence	fences[SORT_PARTITION_FENCES];
+
+	/* The run holding the participant's key range, once merged */
+	TapeShare	tape;
+} SortPartition;
 
 /*
  * Private state of a Tuplesort operation.
@@ -196,6 +255,9 @@ struct Tuplesortstate
 	int			bound;			/* if bounded, the maximum number of tuples */
 	int64		availMem;		/* remaining memory available, in bytes */
 	int64		allowedMem;		/* total memory allowed, in bytes */
+	int64		tupleMem;		/* memory consumed by the tuples currently in
+								 * memtuples, which dumptuples releases all
+								 * at once */
 	int			maxTapes;		/* max number of input tapes to merge in each
 								 * pass */
 	int64		maxSpace;		/* maximum amount of space occupied among sort
@@ -320,6 +382,17 @@ struct Tuplesortstate
 	Sharedsort *shared;
 	int			nParticipants;
 
+	/*
+	 * In a worker taking part in a partitioned merge, fences tracks the
+	 * positions of tuples in the run being written, which are published
+	 * along with the final output run.  In the leader, partitionedRuns is
+	 * set if the runs to merge hold disjoint, ascending key ranges, and
+	 * nextPartition is the next input tape to read from in that case.
+	 */
+	SortPartition *fences;
+	bool		partitionedRuns;
+	int			nextPartition;
+
 	/*
 	 * Additional state for managing "abbreviated key" sortsupport routines
 	 * (which currently may be used by all cases except the hash index case).
@@ -357,6 +430,18 @@ struct Sharedsort
 	int			currentWorker;
 	int			workersFinished;
 
+	/*
+	 * partitioned is set by the leader before launching workers, if the
+	 * final merge is to be divided among the participants.  In that case,
+	 * the leader also publishes nParticipants once it is known, and workers
+	 * increment partitionsFinished after merging their key range.  Workers
+	 * wait on cv for all other workers to finish their output run.
+	 */
+	bool		partitioned;
+	int			nParticipants;
+	int			partitionsFinished;
+	ConditionVariable cv;
+
 	/* Temporary file space */
 	SharedFileSet fileset;
 
@@ -365,11 +450,26 @@ struct Sharedsort
 
 	/*
 	 * Tapes array used by workers to report back information needed by the
-	 * leader to concatenate all worker tapes into one for merging
+	 * leader to concatenate all worker tapes into one for merging.  In a
+	 * partitioned merge, it is followed by an array of nTapes SortPartition
+	 * structs; see SharedsortPartitions().
 	 */
 	TapeShare	tapes[FLEXIBLE_ARRAY_MEMBER];
 };
 
+#define SharedsortPartitionsOffset(nTapes) \
+	MAXALIGN(add_size(offsetof(Sharedsort, tapes), \
+					  mul_size(sizeof(TapeShare), (nTapes))))
+#define SharedsortPartitions(shared) \
+	((SortPartition *) ((char *) (shared) + \
+						SharedsortPartitionsOffset((shared)->nTapes)))
+
+/*
+ * Files holding the runs of a partitioned merge are numbered after the
+ * files holding the workers' output runs.
+ */
+#define SharedsortPartitionFile(shared, i)	((shared)->nTapes + (i))
+
 /*
  * Is the given tuple allocated from the slab memory arena?
  */
@@ -461,11 +561,13 @@ static void init_slab_allocator(Tuplesortstate *state, int numSlots);
 static void mergeruns(Tuplesortstate *state);
 static void mergeonerun(Tuplesortstate *state);
 static void beginmerge(Tuplesortstate *state);
+static bool beginnextpartition(Tuplesortstate *state);
 static bool mergereadnext(Tuplesortstate *state, LogicalTape *srcTape, SortTuple *stup);
 static void dumptuples(Tuplesortstate *state, bool alltuples);
 static void make_bounded_heap(Tuplesortstate *state);
 static void sort_bounded_heap(Tuplesortstate *state);
 static void tuplesort_sort_memtuples(Tuplesortstate *state);
+static bool radix_sort_memtuples(Tuplesortstate *state);
 static void tuplesort_heap_insert(Tuplesortstate *state, SortTuple *tuple);
 static void tuplesort_heap_replace_top(Tuplesortstate *state, SortTuple *tuple);
 static void tuplesort_heap_delete_top(Tuplesortstate *state);
@@ -475,6 +577,9 @@ static void markrunend(LogicalTape *tape);
 static int	worker_get_identifier(Tuplesortstate *state);
 static void worker_freeze_result_tape(Tuplesortstate *state);
 static void worker_nomergeruns(Tuplesortstate *state);
+static void worker_reset_fences(Tuplesortstate *state);
+static void worker_note_fence(Tuplesortstate *state, LogicalTape *tape);
+static void worker_merge_partition(Tuplesortstate *state);
 static void leader_takeover_tapes(Tuplesortstate *state);
 static void free_sort_tuple(Tuplesortstate *state, SortTuple *stup);
 static void tuplesort_free(Tuplesortstate *state);
@@ -732,6 +837,12 @@ tuplesort_begin_common(int workMem, SortCoordinate coordinate, int sortopt)
 		state->shared = coordinate->sharedsort;
 		state->worker = worker_get_identifier(state);
 		state->nParticipants = -1;
+
+		/* Track fences in output runs, if we take part in merging them */
+		if (state->shared->partitioned)
+			state->fences = (SortPartition *)
+				MemoryContextAllocZero(state->base.maincontext,
+									   sizeof(SortPartition));
 	}
 	else
 	{
@@ -770,18 +881,21 @@ tuplesort_begin_batch(Tuplesortstate *state)
 	 * in the parent context, not this context, because there is no need to
 	 * free memtuples early.  For bounded sorts, tuples may be pfreed in any
 	 * order, so we use a regular aset.c context so that it can make use of
-	 * free'd memory.  When the sort is not bounded, we make use of a
-	 * generation.c context as this keeps allocations more compact with less
-	 * wastage.  Allocations are also slightly more CPU efficient.
+	 * free'd memory.  When the sort is not bounded, we make use of a bump.c
+	 * context as this keeps allocations more compact with less wastage,
+	 * since its chunks have no header.  Allocations are also slightly more
+	 * CPU efficient.  Tuples in a bump context can't be pfree'd, nor can
+	 * GetMemoryChunkSpace() be used on them, so callers pass the tuple's
+	 * size to tuplesort_puttuple_common() instead.
 	 */
-	if (state->base.sortopt & TUPLESORT_ALLOWBOUNDED)
+	if (TupleSortUseBumpTupleCxt(state->base.sortopt))
+		state->base.tuplecontext = BumpContextCreate(state->base.sortcontext,
+													 "Caller tuples",
+													 ALLOCSET_DEFAULT_SIZES);
+	else
 		state->base.tuplecontext = AllocSetContextCreate(state->base.sortcontext,
 														 "Caller tuples",
 														 ALLOCSET_DEFAULT_SIZES);
-	else
-		state->base.tuplecontext = GenerationContextCreate(state->base.sortcontext,
-														   "Caller tuples",
-														   ALLOCSET_DEFAULT_SIZES);
 
 
 	state->status = TSS_INITIAL;
@@ -789,6 +903,7 @@ tuplesort_begin_batch(Tuplesortstate *state)
 	state->boundUsed = false;
 
 	state->availMem = state->allowedMem;
+	state->tupleMem = 0;
 
 	state->tapeset = NULL;
 
@@ -1185,9 +1300,12 @@ noalloc:
 
 /*
  * Shared code for tuple and datum cases.
+ *
+ * tuplen is the memory consumed by the out-of-line data, if any.
  */
 void
-tuplesort_puttuple_common(Tuplesortstate *state, SortTuple *tuple, bool useAbbrev)
+tuplesort_puttuple_common(Tuplesortstate *state, SortTuple *tuple,
+						  bool useAbbrev, Size tuplen)
 {
 	MemoryContext oldcontext = MemoryContextSwitchTo(state->base.sortcontext);
 
@@ -1195,7 +1313,10 @@ tuplesort_puttuple_common(Tuplesortstate *state, SortTuple *tuple, bool useAbbre
 
 	/* Count the size of the out-of-line data */
 	if (tuple->tuple != NULL)
-		USEMEM(state, GetMemoryChunkSpace(tuple->tuple));
+	{
+		USEMEM(state, tuplen);
+		state->tupleMem += tuplen;
+	}
 
 	if (!useAbbrev)
 	{
@@ -1210,9 +1331,27 @@ tuplesort_puttuple_common(Tuplesortstate *state, SortTuple *tuple, bool useAbbre
 	}
 	else if (!consider_abort_common(state))
 	{
+		SortSupport sortKey = state->base.sortKeys;
+
 		/* Store abbreviated key representation */
-		tuple->datum1 = state->base.sortKeys->abbrev_converter(tuple->datum1,
-															   state->base.sortKeys);
+		if (!sortKey->abbrev_by_ref)
+			tuple->datum1 = sortKey->abbrev_converter(tuple->datum1, sortKey);
+		else
+		{
+			Size		keylen;
+
+			/* Allocate the key alongside the tuple, and count it likewise */
+			MemoryContextSwitchTo(state->base.tuplecontext);
+			tuple->datum1 = sortKey->abbrev_converter(tuple->datum1, sortKey);
+			MemoryContextSwitchTo(state->base.sortcontext);
+
+			if (TupleSortUseBumpTupleCxt(state->base.sortopt))
+				keylen = MAXALIGN(VARSIZE(DatumGetPointer(tuple->datum1)));
+			else
+				keylen = GetMemoryChunkSpace(DatumGetPointer(tuple->datum1));
+			USEMEM(state, keylen);
+			state->tupleMem += keylen;
+		}
 	}
 	else
 	{
@@ -1469,6 +1608,13 @@ tuplesort_performsort(Tuplesortstate *state)
 			break;
 	}
 
+	/*
+	 * In a partitioned merge, a worker goes on to merge its share of the key
+	 * space from the output runs of all workers.
+	 */
+	if (WORKER(state) && state->fences != NULL)
+		worker_merge_partition(state);
+
 #ifdef TRACE_SORT
 	if (trace_sort)
 	{
@@ -1712,6 +1858,10 @@ tuplesort_gettuple_common(Tuplesortstate *state, bool forward,
 					 * anyway, but better to release the memory early.
 					 */
 					LogicalTapeClose(srcTape);
+
+					/* With partitioned runs, move on to the next run */
+					if (state->partitionedRuns)
+						(void) beginnextpartition(state);
 					return true;
 				}
 				newtup.srctape = srcTapeIndex;
@@ -2242,6 +2392,8 @@ mergeonerun(Tuplesortstate *state)
 
 	Assert(state->slabAllocatorUsed);
 
+	worker_reset_fences(state);
+
 	/*
 	 * Execute merge by repeatedly extracting lowest tuple in heap, writing it
 	 * out, and replacing it with next tuple from same tape (if there is
@@ -2254,6 +2406,8 @@ mergeonerun(Tuplesortstate *state)
 		/* write the tuple to destTape */
 		srcTapeIndex = state->memtuples[0].srctape;
 		srcTape = state->inputTapes[srcTapeIndex];
+		if (state->fences)
+			worker_note_fence(state, state->destTape);
 		WRITETUP(state, state->destTape, &state->memtuples[0]);
 
 		/* recycle the slot of the tuple we just wrote out, for the next read */
@@ -2297,6 +2451,14 @@ beginmerge(Tuplesortstate *state)
 	/* Heap should be empty here */
 	Assert(state->memtupcount == 0);
 
+	/* With partitioned runs, the heap only ever holds one tuple */
+	if (state->partitionedRuns)
+	{
+		state->nextPartition = 0;
+		(void) beginnextpartition(state);
+		return;
+	}
+
 	activeTapes = Min(state->nInputTapes, state->nInputRuns);
 
 	for (srcTapeIndex = 0; srcTapeIndex < activeTapes; srcTapeIndex++)
@@ -2311,6 +2473,39 @@ beginmerge(Tuplesortstate *state)
 	}
 }
 
+/*
+ * beginnextpartition - load the first tuple of the next partitioned run
+ *
+ * The runs hold disjoint key ranges in ascending order, so instead of
+ * merging them we read them one after another.  Loads the first tuple of
+ * the next non-empty run into the (empty) heap, and returns false if there
+ * are no more tuples.
+ */
+static bool
+beginnextpartition(Tuplesortstate *state)
+{
+	Assert(state->memtupcount == 0);
+
+	while (state->nextPartition < state->nInputTapes)
+	{
+		int			srcTapeIndex = state->nextPartition++;
+		SortTuple	tup;
+
+		if (mergereadnext(state, state->inputTapes[srcTapeIndex], &tup))
+		{
+			tup.srctape = srcTapeIndex;
+			tuplesort_heap_insert(state, &tup);
+			return true;
+		}
+
+		/* Empty run */
+		state->nInputRuns--;
+		LogicalTapeClose(state->inputTapes[srcTapeIndex]);
+	}
+
+	return false;
+}
+
 /*
  * mergereadnext - read next tuple from one merge input tape
  *
@@ -2397,19 +2592,16 @@ dumptuples(Tuplesortstate *state, bool alltuples)
 			 pg_rusage_show(&state->ru_start));
 #endif
 
+	worker_reset_fences(state);
+
 	memtupwrite = state->memtupcount;
 	for (i = 0; i < memtupwrite; i++)
 	{
 		SortTuple  *stup = &state->memtuples[i];
 
+		if (state->fences)
+			worker_note_fence(state, state->destTape);
 		WRITETUP(state, state->destTape, stup);
-
-		/*
-		 * Account for freeing the tuple, but no need to do the actual pfree
-		 * since the tuplecontext is being reset after the loop.
-		 */
-		if (stup->tuple != NULL)
-			FREEMEM(state, GetMemoryChunkSpace(stup->tuple));
 	}
 
 	state->memtupcount = 0;
@@ -2423,6 +2615,13 @@ dumptuples(Tuplesortstate *state, bool alltuples)
 	 */
 	MemoryContextReset(state->base.tuplecontext);
 
+	/*
+	 * Now account for freeing the tuples.  We can't do that per tuple, since
+	 * GetMemoryChunkSpace() doesn't work on a bump context.
+	 */
+	FREEMEM(state, state->tupleMem);
+	state->tupleMem = 0;
+
 	markrunend(state->destTape);
 
 #ifdef TRACE_SORT
@@ -2723,6 +2922,12 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 		 */
 		if (state->base.haveDatum1 && state->base.sortKeys)
 		{
+			/* For large inputs, radix sort on datum1 if possible */
+			if (optimize_radix_sort &&
+				state->memtupcount >= RADIX_SORT_MIN_TUPLES &&
+				radix_sort_memtuples(state))
+				return;
+
 			if (state->base.sortKeys[0].comparator == ssup_datum_unsigned_cmp)
 			{
 				qsort_tuple_unsigned(state->memtuples,
@@ -2764,6 +2969,239 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 	}
 }
 
+/*
+ * Kinds of leading datum1 keys that radix sorting supports, one for each
+ * specialized comparator.
+ */
+typedef enum RadixKeyKind
+{
+	RADIX_KEY_UNSIGNED,			/* ssup_datum_unsigned_cmp */
+	RADIX_KEY_SIGNED,			/* ssup_datum_signed_cmp */
+	RADIX_KEY_INT32				/* ssup_datum_int32_cmp */
+} RadixKeyKind;
+
+/*
+ * Transform a non-null datum1 into an unsigned integer whose natural order
+ * is the sort order of the leading key.
+ */
+static pg_attribute_always_inline uint64
+radix_key(Datum datum, RadixKeyKind kind, bool reverse)
+{
+	uint64		key;
+
+	switch (kind)
+	{
+		case RADIX_KEY_UNSIGNED:
+			key = (uint64) datum;
+			break;
+		case RADIX_KEY_SIGNED:
+			/* flip the sign bit, so that negative values sort first */
+			key = ((uint64) DatumGetInt64(datum)) ^ (UINT64CONST(1) << 63);
+			break;
+		case RADIX_KEY_INT32:
+			key = ((uint32) DatumGetInt32(datum)) ^ (UINT64CONST(1) << 31);
+			break;
+		default:
+			pg_unreachable();
+	}
+
+	return reverse ? ~key : key;
+}
+
+/*
+ * Sort tuples with equal leading keys by the remaining keys, if any.  With
+ * abbreviated keys, this also resolves the order of tuples whose
+ * abbreviations are equal.
+ */
+static void
+radix_sort_ties(Tuplesortstate *state, SortTuple *data, size_t n)
+{
+	if (n > 1 && state->base.onlyKey == NULL)
+		qsort_tuple(data, n, state->base.comparetup, state);
+}
+
+/*
+ * Finish off a small bucket with the specialized quicksort for the key kind.
+ */
+static void
+radix_sort_small(Tuplesortstate *state, SortTuple *data, size_t n,
+				 RadixKeyKind kind)
+{
+	switch (kind)
+	{
+		case RADIX_KEY_UNSIGNED:
+			qsort_tuple_unsigned(data, n, state);
+			break;
+#if SIZEOF_DATUM >= 8
+		case RADIX_KEY_SIGNED:
+			qsort_tuple_signed(data, n, state);
+			break;
+#endif
+		case RADIX_KEY_INT32:
+			qsort_tuple_int32(data, n, state);
+			break;
+		default:
+			pg_unreachable();
+	}
+}
+
+/*
+ * MSD radix sort of non-null tuples on one byte of their normalized keys,
+ * recursing into each bucket for the next less significant byte.
+ *
+ * Tuples are distributed into their buckets in place, by following the
+ * cycles of the permutation ("American flag sort").
+ */
+static void
+radix_sort_tuple(Tuplesortstate *state, SortTuple *data, size_t n,
+				 RadixKeyKind kind, bool reverse, int level)
+{
+	size_t		counts[256];
+	size_t		next[256];
+	size_t		ends[256];
+	size_t		offset;
+	int			shift = level * BITS_PER_BYTE;
+	int			b;
+
+	CHECK_FOR_INTERRUPTS();
+
+	memset(counts, 0, sizeof(counts));
+	for (size_t i = 0; i < n; i++)
+		counts[(radix_key(data[i].datum1, kind, reverse) >> shift) & 0xFF]++;
+
+	/* If all tuples share this byte, there's nothing to move */
+	b = (radix_key(data[0].datum1, kind, reverse) >> shift) & 0xFF;
+	if (counts[b] == n)
+	{
+		if (level == 0)
+			radix_sort_ties(state, data, n);
+		else
+			radix_sort_tuple(state, data, n, kind, reverse, level - 1);
+		return;
+	}
+
+	offset = 0;
+	for (b = 0; b < 256; b++)
+	{
+		next[b] = offset;
+		offset += counts[b];
+		ends[b] = offset;
+	}
+
+	for (b = 0; b < 256; b++)
+	{
+		while (next[b] < ends[b])
+		{
+			SortTuple	tup = data[next[b]];
+			int			tb = (radix_key(tup.datum1, kind, reverse) >> shift) & 0xFF;
+
+			while (tb != b)
+			{
+				SortTuple	tmp = data[next[tb]];
+
+				data[next[tb]++] = tup;
+				tup = tmp;
+				tb = (radix_key(tup.datum1, kind, reverse) >> shift) & 0xFF;
+			}
+			data[next[b]++] = tup;
+		}
+	}
+
+	/* Sort each bucket on the remaining bytes */
+	offset = 0;
+	for (b = 0; b < 256; b++)
+	{
+		size_t		count = counts[b];
+
+		if (count > 1)
+		{
+			if (level == 0)
+				radix_sort_ties(state, data + offset, count);
+			else if (count < RADIX_SORT_MIN_BUCKET)
+				radix_sort_small(state, data + offset, count, kind);
+			else
+				radix_sort_tuple(state, data + offset, count, kind, reverse,
+								 level - 1);
+		}
+		offset += count;
+	}
+}
+
+/*
+ * Radix sort memtuples on the leading datum1, if its comparator is one we
+ * know how to emulate.  Returns false, leaving memtuples untouched, if not.
+ *
+ * NULLs are moved to the front or back first, and sorted among themselves
+ * by the remaining keys.
+ */
+static bool
+radix_sort_memtuples(Tuplesortstate *state)
+{
+	SortSupport ssup = &state->base.sortKeys[0];
+	SortTuple  *memtuples = state->memtuples;
+	size_t		n = state->memtupcount;
+	RadixKeyKind kind;
+	int			nbytes;
+	size_t		nnulls;
+	SortTuple  *notnull;
+	SortTuple  *nulls;
+
+	if (ssup->comparator == ssup_datum_unsigned_cmp)
+	{
+		kind = RADIX_KEY_UNSIGNED;
+		nbytes = sizeof(Datum);
+	}
+#if SIZEOF_DATUM >= 8
+	else if (ssup->comparator == ssup_datum_signed_cmp)
+	{
+		kind = RADIX_KEY_SIGNED;
+		nbytes = sizeof(Datum);
+	}
+#endif
+	else if (ssup->comparator == ssup_datum_int32_cmp)
+	{
+		kind = RADIX_KEY_INT32;
+		nbytes = sizeof(int32);
+	}
+	else
+		return false;
+
+	/* Partition NULLs to the side they sort on */
+	nnulls = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		bool		isnull = memtuples[i].isnull1;
+
+		if (ssup->ssup_nulls_first ? isnull : !isnull)
+		{
+			SortTuple	tmp = memtuples[nnulls];
+
+			memtuples[nnulls] = memtuples[i];
+			memtuples[i] = tmp;
+			nnulls++;
+		}
+	}
+	if (ssup->ssup_nulls_first)
+	{
+		nulls = memtuples;
+		notnull = memtuples + nnulls;
+	}
+	else
+	{
+		/* the loop above counted the non-NULLs */
+		notnull = memtuples;
+		nulls = memtuples + nnulls;
+		nnulls = n - nnulls;
+	}
+
+	radix_sort_ties(state, nulls, nnulls);
+	if (n - nnulls > 1)
+		radix_sort_tuple(state, notnull, n - nnulls, kind, ssup->ssup_reverse,
+						 nbytes - 1);
+
+	return true;
+}
+
 /*
  * Insert a new tuple into an empty or existing heap, maintaining the
  * heap invariant.  Caller is responsible for ensuring there's room.
@@ -2959,10 +3397,10 @@ tuplesort_estimate_shared(int nWorkers)
 	Assert(nWorkers > 0);
 
 	/* Make sure that BufFile shared state is MAXALIGN'd */
-	tapesSize = mul_size(sizeof(TapeShare), nWorkers);
-	tapesSize = MAXALIGN(add_size(tapesSize, offsetof(Sharedsort, tapes)));
+	tapesSize = SharedsortPartitionsOffset(nWorkers);
 
-	return tapesSize;
+	/* Add space for a partitioned merge */
+	return add_size(tapesSize, mul_size(sizeof(SortPartition), nWorkers));
 }
 
 /*
@@ -2982,12 +3420,55 @@ tuplesort_initialize_shared(Sharedsort *shared, int nWorkers, dsm_segment *seg)
 	SpinLockInit(&shared->mutex);
 	shared->currentWorker = 0;
 	shared->workersFinished = 0;
+	shared->partitioned = false;
+	shared->nParticipants = 0;
+	shared->partitionsFinished = 0;
+	ConditionVariableInit(&shared->cv);
 	SharedFileSetInit(&shared->fileset, seg);
 	shared->nTapes = nWorkers;
 	for (i = 0; i < nWorkers; i++)
 	{
 		shared->tapes[i].firstblocknumber = 0L;
 	}
+	memset(SharedsortPartitions(shared), 0, sizeof(SortPartition) * nWorkers);
+}
+
+/*
+ * tuplesort_use_partitioned_merge - divide final merge among participants
+ *
+ * May be called from leader process after tuplesort_initialize_shared(), and
+ * before workers are launched, to have all participants merge disjoint key
+ * ranges of the worker runs in parallel, rather than leaving the whole merge
+ * to the leader.  This has no effect unless parallel_sort_partitioned_merge
+ * is enabled.
+ *
+ * Workers wait for each other before they merge, so a caller that uses this
+ * must call tuplesort_set_participants() as soon as all launched workers
+ * have attached, and before the leader itself participates as a worker.
+ */
+void
+tuplesort_use_partitioned_merge(Sharedsort *shared)
+{
+	shared->partitioned = parallel_sort_partitioned_merge;
+}
+
+/*
+ * tuplesort_set_participants - tell workers the number of participants
+ *
+ * nParticipants must match the nParticipants field of the leader's
+ * coordinate argument.  This is a no-op unless the partitioned merge is
+ * used.
+ */
+void
+tuplesort_set_participants(Sharedsort *shared, int nParticipants)
+{
+	Assert(nParticipants >= 1);
+
+	SpinLockAcquire(&shared->mutex);
+	shared->nParticipants = nParticipants;
+	SpinLockRelease(&shared->mutex);
+
+	ConditionVariableBroadcast(&shared->cv);
 }
 
 /*
@@ -3068,11 +3549,18 @@ worker_freeze_result_tape(Tuplesortstate *state)
 	 */
 	LogicalTapeFreeze(state->result_tape, &output);
 
+	/* Publish the fences of the output run, for a partitioned merge */
+	if (state->fences)
+		SharedsortPartitions(shared)[state->worker] = *state->fences;
+
 	/* Store properties of output tape, and update finished worker count */
 	SpinLockAcquire(&shared->mutex);
 	shared->tapes[state->worker] = output;
 	shared->workersFinished++;
 	SpinLockRelease(&shared->mutex);
+
+	if (state->fences)
+		ConditionVariableBroadcast(&shared->cv);
 }
 
 /*
@@ -3092,6 +3580,368 @@ worker_nomergeruns(Tuplesortstate *state)
 	worker_freeze_result_tape(state);
 }
 
+/*
+ * worker_reset_fences - start tracking fences for a new output run
+ */
+static void
+worker_reset_fences(Tuplesortstate *state)
+{
+	if (state->fences == NULL)
+		return;
+
+	state->fences->ntuples = 0;
+	state->fences->stride = 1;
+	state->fences->nfences = 0;
+}
+
+/*
+ * worker_note_fence - account for the next tuple to be written to tape
+ *
+ * Called just before each tuple of an output run is written, while fences
+ * are being tracked.  If the tuple is due to become a fence, remember its
+ * position.
+ */
+static void
+worker_note_fence(Tuplesortstate *state, LogicalTape *tape)
+{
+	SortPartition *fences = state->fences;
+
+	if (fences->ntuples > 0 && fences->ntuples % fences->stride == 0)
+	{
+		if (fences->nfences == SORT_PARTITION_FENCES)
+		{
+			int			i;
+
+			/* Out of space; keep every other fence */
+			for (i = 0; i < SORT_PARTITION_FENCES / 2; i++)
+				fences->fences[i] = fences->fences[2 * i + 1];
+			fences->nfences = SORT_PARTITION_FENCES / 2;
+			fences->stride *= 2;
+		}
+
+		if (fences->ntuples % fences->stride == 0)
+		{
+			SortFence  *fence = &fences->fences[fences->nfences++];
+
+			LogicalTapeTell(tape, &fence->blocknum, &fence->offset);
+		}
+	}
+
+	fences->ntuples++;
+}
+
+/*
+ * worker_tuple_follows - does a run's tuple sort at or after a splitter?
+ *
+ * tup is the tuple with zero-based index pos in worker w's output run.  The
+ * splitter is itself stored in one of the runs; we recognize it by its
+ * position rather than comparing it with itself, since comparators that
+ * enforce uniqueness would take it for a duplicate.
+ */
+static bool
+worker_tuple_follows(Tuplesortstate *state, SortTuple *samples, int split,
+					 int w, int64 pos, SortTuple *tup)
+{
+	SortPartition *partitions = SharedsortPartitions(state->shared);
+	int			splitw = samples[split].srctape / SORT_PARTITION_FENCES;
+	int			splitf = samples[split].srctape % SORT_PARTITION_FENCES;
+
+	if (w == splitw && pos == (splitf + 1) * partitions[splitw].stride)
+		return true;
+
+	return COMPARETUP(state, tup, &samples[split]) >= 0;
+}
+
+/*
+ * worker_merge_partition - merge our key range in a partitioned merge
+ *
+ * Called by workers after their output run has been frozen.  Waits for all
+ * other workers to finish their output runs, then reads the tuples at the
+ * fences of all runs and sorts them.  Every participant sees the same
+ * fences, so all choose the same splitters among them: participant i merges
+ * the tuples from splitter i (inclusive) to splitter i + 1 (exclusive) out
+ * of every run, where splitter 0 is minus infinity and splitter
+ * nParticipants is plus infinity.  The result is written to a file of its
+ * own, for the leader to read.
+ */
+static void
+worker_merge_partition(Tuplesortstate *state)
+{
+	Sharedsort *shared = state->shared;
+	SortPartition *partitions = SharedsortPartitions(shared);
+	int			nParticipants;
+	int			workersFinished;
+	LogicalTapeSet *inputset;
+	LogicalTapeSet *outputset;
+	LogicalTape **inputs;
+	LogicalTape *output;
+	int64	   *positions;
+	SortTuple  *samples;
+	int			nsamples;
+	int64		totalweight;
+	int64		rank;
+	int			lower;
+	int			upper;
+	bool		empty;
+	int			split;
+	int			i;
+	int			w;
+
+	Assert(WORKER(state));
+	Assert(state->status == TSS_SORTEDONTAPE);
+	Assert(state->memtuples == NULL);
+
+	/* Wait for the leader's count of participants, and for all their runs */
+	for (;;)
+	{
+		SpinLockAcquire(&shared->mutex);
+		nParticipants = shared->nParticipants;
+		workersFinished = shared->workersFinished;
+		SpinLockRelease(&shared->mutex);
+
+		if (nParticipants > 0 && workersFinished >= nParticipants)
+			break;
+
+		ConditionVariableSleep(&shared->cv, WAIT_EVENT_PARALLEL_SORT_PARTITION);
+	}
+	ConditionVariableCancelSleep();
+
+	/* The leader merges by itself if there's nobody to share the work with */
+	if (nParticipants <= 1)
+		return;
+	Assert(state->worker < nParticipants);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG, "worker %d starting partitioned merge of %d runs: %s",
+			 state->worker, nParticipants, pg_rusage_show(&state->ru_start));
+#endif
+
+	/*
+	 * As in mergeruns(), abbreviated keys are not stored on tape, so disable
+	 * abbreviation before reading tuples back.
+	 */
+	if (state->base.sortKeys != NULL && state->base.sortKeys->abbrev_converter != NULL)
+	{
+		state->base.sortKeys->abbrev_converter = NULL;
+		state->base.sortKeys->comparator = state->base.sortKeys->abbrev_full_comparator;
+		state->base.sortKeys->abbrev_abort = NULL;
+		state->base.sortKeys->abbrev_full_comparator = NULL;
+	}
+
+	/*
+	 * We keep all the fence tuples in memory, plus one tuple per run in the
+	 * merge heap.  Set up a slab allocator with a slot for each of them.
+	 */
+	nsamples = 0;
+	for (w = 0; w < nParticipants; w++)
+		nsamples += partitions[w].nfences;
+
+	if (state->slabMemoryBegin)
+		pfree(state->slabMemoryBegin);
+	if (state->base.tuples)
+		init_slab_allocator(state, nsamples + nParticipants + 1);
+	else
+		init_slab_allocator(state, 0);
+
+	state->memtuples = (SortTuple *) palloc(nParticipants * sizeof(SortTuple));
+	state->memtupsize = nParticipants;
+	state->memtupcount = 0;
+
+	/* Open all worker runs */
+	inputset = LogicalTapeSetCreate(false, &shared->fileset, -1);
+	inputs = (LogicalTape **) palloc(nParticipants * sizeof(LogicalTape *));
+	positions = (int64 *) palloc(nParticipants * sizeof(int64));
+	for (w = 0; w < nParticipants; w++)
+		inputs[w] = LogicalTapeImport(inputset, w, &shared->tapes[w]);
+	LogicalTapeSetForgetFreeSpace(inputset);
+
+	/*
+	 * Read and sort the fence tuples.  srctape records where each came from,
+	 * as worker * SORT_PARTITION_FENCES + fence.
+	 */
+	samples = (SortTuple *) palloc(Max(nsamples, 1) * sizeof(SortTuple));
+	nsamples = 0;
+	for (w = 0; w < nParticipants; w++)
+	{
+		for (i = 0; i < partitions[w].nfences; i++)
+		{
+			SortFence  *fence = &partitions[w].fences[i];
+
+			LogicalTapeSeekImported(inputs[w], BLCKSZ,
+									fence->blocknum, fence->offset);
+			if (!mergereadnext(state, inputs[w], &samples[nsamples]))
+				elog(ERROR, "unexpected end of run in partitioned merge");
+			samples[nsamples].srctape = w * SORT_PARTITION_FENCES + i;
+			nsamples++;
+		}
+	}
+	qsort_tuple(samples, nsamples, state->base.comparetup, state);
+
+	/*
+	 * Choose splitter j as the first fence tuple whose estimated rank reaches
+	 * j / nParticipants of all tuples.  Each fence tuple stands for the
+	 * stride tuples that follow it in its run.  We only need to know our own
+	 * two splitters; -1 means that a splitter is plus infinity (or minus
+	 * infinity, for splitter 0).
+	 */
+	totalweight = 0;
+	for (w = 0; w < nParticipants; w++)
+		totalweight += partitions[w].nfences * partitions[w].stride;
+
+	lower = -1;
+	upper = -1;
+	empty = (state->worker > 0);
+	rank = 0;
+	split = 1;
+	for (i = 0; i < nsamples && split < nParticipants; i++)
+	{
+		while (split < nParticipants &&
+			   rank >= split * totalweight / nParticipants)
+		{
+			if (split == state->worker)
+			{
+				lower = i;
+				empty = false;
+			}
+			if (split == state->worker + 1)
+				upper = i;
+			split++;
+		}
+		rank += partitions[samples[i].srctape / SORT_PARTITION_FENCES].stride;
+	}
+
+	/*
+	 * Position each run at the first tuple of our key range, and load that
+	 * into the merge heap.  In each run, start reading from the last fence
+	 * that sorts before our lower splitter.
+	 */
+	for (w = 0; w < nParticipants && !empty; w++)
+	{
+		SortTuple	tup;
+		int			start = -1;
+		bool		found = false;
+
+		if (lower >= 0)
+		{
+			for (i = lower - 1; i >= 0; i--)
+			{
+				if (samples[i].srctape / SORT_PARTITION_FENCES == w &&
+					COMPARETUP(state, &samples[i], &samples[lower]) < 0)
+				{
+					start = samples[i].srctape % SORT_PARTITION_FENCES;
+					break;
+				}
+			}
+		}
+
+		if (start >= 0)
+		{
+			LogicalTapeSeekImported(inputs[w], MERGE_BUFFER_SIZE,
+									partitions[w].fences[start].blocknum,
+									partitions[w].fences[start].offset);
+			positions[w] = (start + 1) * partitions[w].stride;
+		}
+		else
+		{
+			LogicalTapeSeekImported(inputs[w], MERGE_BUFFER_SIZE,
+									shared->tapes[w].firstblocknumber, 0);
+			positions[w] = 0;
+		}
+
+		while (mergereadnext(state, inputs[w], &tup))
+		{
+			if (lower < 0 ||
+				worker_tuple_follows(state, samples, lower, w, positions[w], &tup))
+			{
+				found = true;
+				break;
+			}
+			if (tup.tuple)
+				RELEASE_SLAB_SLOT(state, tup.tuple);
+			positions[w]++;
+		}
+
+		if (!found)
+			continue;
+		if (upper >= 0 &&
+			worker_tuple_follows(state, samples, upper, w, positions[w], &tup))
+		{
+			/* Nothing in our key range in this run */
+			if (tup.tuple)
+				RELEASE_SLAB_SLOT(state, tup.tuple);
+			continue;
+		}
+
+		tup.srctape = w;
+		tuplesort_heap_insert(state, &tup);
+	}
+
+	/* Merge our key range of all the runs, like mergeonerun() */
+	outputset = LogicalTapeSetCreate(false, &shared->fileset,
+									 SharedsortPartitionFile(shared, state->worker));
+	output = LogicalTapeCreate(outputset);
+
+	while (state->memtupcount > 0)
+	{
+		SortTuple	stup;
+
+		w = state->memtuples[0].srctape;
+		WRITETUP(state, output, &state->memtuples[0]);
+		if (state->memtuples[0].tuple)
+			RELEASE_SLAB_SLOT(state, state->memtuples[0].tuple);
+		positions[w]++;
+
+		if (!mergereadnext(state, inputs[w], &stup))
+			tuplesort_heap_delete_top(state);
+		else if (upper >= 0 &&
+				 worker_tuple_follows(state, samples, upper, w, positions[w], &stup))
+		{
+			/* Reached the end of our key range in this run */
+			if (stup.tuple)
+				RELEASE_SLAB_SLOT(state, stup.tuple);
+			tuplesort_heap_delete_top(state);
+		}
+		else
+		{
+			stup.srctape = w;
+			tuplesort_heap_replace_top(state, &stup);
+		}
+	}
+	markrunend(output);
+
+	/* Publish our run for the leader */
+	LogicalTapeFreeze(output, &partitions[state->worker].tape);
+	LogicalTapeClose(output);
+	LogicalTapeSetClose(outputset);
+
+	SpinLockAcquire(&shared->mutex);
+	shared->partitionsFinished++;
+	SpinLockRelease(&shared->mutex);
+
+	/* Clean up */
+	for (w = 0; w < nParticipants; w++)
+		LogicalTapeClose(inputs[w]);
+	LogicalTapeSetClose(inputset);
+	for (i = 0; i < nsamples; i++)
+	{
+		if (samples[i].tuple)
+			RELEASE_SLAB_SLOT(state, samples[i].tuple);
+	}
+	pfree(samples);
+	pfree(positions);
+	pfree(inputs);
+	pfree(state->memtuples);
+	state->memtuples = NULL;
+	state->memtupsize = 0;
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG, "worker %d finished partitioned merge: %s",
+			 state->worker, pg_rusage_show(&state->ru_start));
+#endif
+}
+
 /*
  * leader_takeover_tapes - create tapeset for leader from worker tapes
  *
@@ -3109,6 +3959,8 @@ leader_takeover_tapes(Tuplesortstate *state)
 	Sharedsort *shared = state->shared;
 	int			nParticipants = state->nParticipants;
 	int			workersFinished;
+	int			partitionsFinished;
+	bool		partitioned;
 	int			j;
 
 	Assert(LEADER(state));
@@ -3116,10 +3968,14 @@ leader_takeover_tapes(Tuplesortstate *state)
 
 	SpinLockAcquire(&shared->mutex);
 	workersFinished = shared->workersFinished;
+	partitionsFinished = shared->partitionsFinished;
+	partitioned = shared->partitioned && shared->nParticipants > 1;
 	SpinLockRelease(&shared->mutex);
 
 	if (nParticipants != workersFinished)
 		elog(ERROR, "cannot take over tapes before all workers finish");
+	if (partitioned && nParticipants != partitionsFinished)
+		elog(ERROR, "cannot take over tapes before all partitions are merged");
 
 	/*
 	 * Create the tapeset from worker tapes, including a leader-owned tape at
@@ -3151,10 +4007,24 @@ leader_takeover_tapes(Tuplesortstate *state)
 	state->nOutputTapes = nParticipants;
 	state->nOutputRuns = nParticipants;
 
+	/*
+	 * After a partitioned merge, take over the participants' merged runs
+	 * instead of the worker runs.  Those hold disjoint key ranges in
+	 * ascending order, so they can simply be read one after another, unless
+	 * a materialized result is required.
+	 */
 	for (j = 0; j < nParticipants; j++)
 	{
-		state->outputTapes[j] = LogicalTapeImport(state->tapeset, j, &shared->tapes[j]);
+		if (partitioned)
+			state->outputTapes[j] =
+				LogicalTapeImport(state->tapeset,
+								  SharedsortPartitionFile(shared, j),
+								  &SharedsortPartitions(shared)[j].tape);
+		else
+			state->outputTapes[j] = LogicalTapeImport(state->tapeset, j, &shared->tapes[j]);
 	}
+	state->partitionedRuns = partitioned &&
+		(state->base.sortopt & TUPLESORT_RANDOMACCESS) == 0;
 
 	state->status = TSS_BUILDRUNS;
 }
@@ -3167,10 +4037,29 @@ free_sort_tuple(Tuplesortstate *state, SortTuple *stup)
 {
 	if (stup->tuple)
 	{
-		FREEMEM(state, GetMemoryChunkSpace(stup->tuple));
+		Size		tuplen = GetMemoryChunkSpace(stup->tuple);
+
+		/* only bounded sorts free tuples, and they don't use a bump context */
+		Assert(!TupleSortUseBumpTupleCxt(state->base.sortopt));
+
+		FREEMEM(state, tuplen);
+		state->tupleMem -= tuplen;
 		pfree(stup->tuple);
 		stup->tuple = NULL;
 	}
+
+	/* Free out-of-line abbreviated key, if any */
+	if (state->base.sortKeys != NULL &&
+		state->base.sortKeys->abbrev_converter != NULL &&
+		state->base.sortKeys->abbrev_by_ref && !stup->isnull1)
+	{
+		Size		keylen = GetMemoryChunkSpace(DatumGetPointer(stup->datum1));
+
+		FREEMEM(state, keylen);
+		state->tupleMem -= keylen;
+		pfree(DatumGetPointer(stup->datum1));
+		stup->datum1 = (Datum) 0;
+	}
 }
 
 int
@@ -32,6 +32,7 @@ typedef struct bbstreamer_extractor
 	char	   *basepath;
 	const char *(*link_map) (const char *);
 	void		(*report_output_file) (const char *);
+	bool		directories_may_exist;
 	char		filename[MAXPGPATH];
 	FILE	   *file;
 } bbstreamer_extractor;
@@ -55,7 +56,8 @@ static void bbstreamer_extractor_content(bbstreamer *streamer,
 										 bbstreamer_archive_context context);
 static void bbstreamer_extractor_finalize(bbstreamer *streamer);
 static void bbstreamer_extractor_free(bbstreamer *streamer);
-static void extract_directory(const char *filename, mode_t mode);
+static void extract_directory(const char *filename, mode_t mode,
+							  bool may_exist);
 static void extract_link(const char *filename, const char *linktarget);
 static FILE *create_file_for_extract(const char *filename, mode_t mode);
 
@@ -178,11 +180,17 @@ bbstreamer_plain_writer_free(bbstreamer *streamer)
  * 'report_output_file' is a function that will be called each time we open a
  * new output file. The pathname to that file is passed as an argument. If
  * NULL, the call is skipped.
+ *
+ * If 'directories_may_exist' is true, directories of the archive which
+ * already exist are not an error.  This is the case when the members of
+ * several archives, like those of the streams of a parallel backup, are
+ * extracted to the same place.
  */
 bbstreamer *
 bbstreamer_extractor_new(const char *basepath,
 						 const char *(*link_map) (const char *),
-						 void (*report_output_file) (const char *))
+						 void (*report_output_file) (const char *),
+						 bool directories_may_exist)
 {
 	bbstreamer_extractor *streamer;
 
@@ -192,6 +200,7 @@ bbstreamer_extractor_new(const char *basepath,
 	streamer->basepath = pstrdup(basepath);
 	streamer->link_map = link_map;
 	streamer->report_output_file = report_output_file;
+	streamer->directories_may_exist = directories_may_exist;
 
 	return &streamer->base;
 }
@@ -226,7 +235,8 @@ bbstreamer_extractor_content(bbstreamer *streamer, bbstreamer_member *member,
 
 			/* Dispatch based on file type. */
 			if (member->is_directory)
-				extract_directory(mystreamer->filename, member->mode);
+				extract_directory(mystreamer->filename, member->mode,
+								  mystreamer->directories_may_exist);
 			else if (member->is_link)
 			{
 				const char *linktarget = member->linktarget;
@@ -280,7 +290,7 @@ bbstreamer_extractor_content(bbstreamer *streamer, bbstreamer_member *member,
  * Create a directory.
  */
 static void
-extract_directory(const char *filename, mode_t mode)
+extract_directory(const char *filename, mode_t mode, bool may_exist)
 {
 	if (mkdir(filename, pg_dir_create_mode) != 0)
 	{
@@ -289,9 +299,11 @@ extract_directory(const char *filename, mode_t mode)
 		 * have been created by the wal receiver process. Also, when the WAL
 		 * directory location was specified, pg_wal (or pg_xlog) has already
 		 * been created as a symbolic link before starting the actual backup.
-		 * So just ignore creation failures on related directories.
+		 * So just ignore creation failures on related directories, and on any
+		 * directory if the caller told us it might exist.
 		 */
-		if (!((pg_str_endswith(filename, "/pg_wal") ||
+		if (!((may_exist ||
+			   pg_str_endswith(filename, "/pg_wal") ||
 			   pg_str_endswith(filename, "/pg_xlog") ||
 			   pg_str_endswith(filename, "/archive_status")) &&
 			  errno == EEXIST))
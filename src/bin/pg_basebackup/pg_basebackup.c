@@ -62,6 +62,8 @@ typedef struct ArchiveStreamState
 	PQExpBuffer manifest_buffer;
 	char		manifest_filename[MAXPGPATH];
 	FILE	   *manifest_file;
+	bool		is_parallel_part;
+	uint64		bytes_done;
 } ArchiveStreamState;
 
 typedef struct WriteTarState
@@ -148,6 +150,10 @@ static bool verify_checksums = true;
 static bool manifest = true;
 static bool manifest_force_encode = false;
 static char *manifest_checksums = NULL;
+static char *incremental_dir = NULL;
+static XLogRecPtr incremental_lsn = InvalidXLogRecPtr;
+static TimeLineID incremental_tli = 0;
+static int	num_jobs = 1;
 
 static bool success = false;
 static bool made_new_pgdata = false;
@@ -193,10 +199,15 @@ static void verify_dir_is_empty_or_create(char *dirname, bool *created, bool *fo
 static void progress_update_filename(const char *filename);
 static void progress_report(int tablespacenum, bool force, bool finished);
 
+static PGconn **StartParallelParts(const char *options);
+static void ReceiveParallelArchiveStreams(PGconn **conns,
+										  pg_compress_specification *compress);
+static void EndArchiveStream(ArchiveStreamState *state);
 static bbstreamer *CreateBackupStreamer(char *archive_name, char *spclocation,
 										bbstreamer **manifest_inject_streamer_p,
 										bool is_recovery_guc_supported,
 										bool expect_unterminated_tarfile,
+										bool is_parallel_part,
 										pg_compress_specification *compress);
 static void ReceiveArchiveStreamChunk(size_t r, char *copybuf,
 									  void *callback_data);
@@ -223,6 +234,7 @@ static bool reached_end_position(XLogRecPtr segendpos, uint32 timeline,
 
 static const char *get_tablespace_mapping(const char *dir);
 static void tablespace_list_append(const char *arg);
+static void read_incremental_source(const char *dir);
 
 
 static void
@@ -379,6 +391,47 @@ tablespace_list_append(const char *arg)
 }
 
 
+/*
+ * Read the start WAL location and timeline of the earlier backup that an
+ * incremental backup is taken relative to, from its backup_label file.
+ */
+static void
+read_incremental_source(const char *dir)
+{
+	char		path[MAXPGPATH];
+	char		line[MAXPGPATH + 64];
+	FILE	   *fp;
+	uint32		hi,
+				lo;
+	TimeLineID	tli;
+
+	snprintf(path, sizeof(path), "%s/backup_label", dir);
+	fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		/* a tar-format backup has its backup_label in base.tar */
+		if (errno == ENOENT)
+			pg_log_error_hint("The earlier backup must be in plain format.");
+		pg_fatal("could not open file \"%s\": %m", path);
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if (sscanf(line, "START WAL LOCATION: %X/%X", &hi, &lo) == 2)
+			incremental_lsn = ((uint64) hi) << 32 | lo;
+		if (sscanf(line, "START TIMELINE: %u", &tli) == 1)
+			incremental_tli = tli;
+	}
+
+	if (ferror(fp))
+		pg_fatal("could not read file \"%s\": %m", path);
+	fclose(fp);
+
+	if (XLogRecPtrIsInvalid(incremental_lsn) || incremental_tli == 0)
+		pg_fatal("could not find the start of the backup in file \"%s\"",
+				 path);
+}
+
 static void
 usage(void)
 {
@@ -389,6 +442,9 @@ usage(void)
 	printf(_("\nOptions controlling the output:\n"));
 	printf(_("  -D, --pgdata=DIRECTORY receive base backup into directory\n"));
 	printf(_("  -F, --format=p|t       output format (plain (default), tar)\n"));
+	printf(_("  -i, --incremental=DIRECTORY\n"
+			 "                         take incremental backup relative to the backup in\n"
+			 "                         DIRECTORY\n"));
 	printf(_("  -r, --max-rate=RATE    maximum transfer rate to transfer data directory\n"
 			 "                         (in kB/s, or use suffix \"k\" or \"M\")\n"));
 	printf(_("  -R, --write-recovery-conf\n"
@@ -408,6 +464,8 @@ usage(void)
 	printf(_("  -c, --checkpoint=fast|spread\n"
 			 "                         set fast or spread checkpointing\n"));
 	printf(_("  -C, --create-slot      create replication slot\n"));
+	printf(_("  -j, --jobs=NUM         use this many parallel connections to take the\n"
+			 "                         backup\n"));
 	printf(_("  -l, --label=LABEL      set backup label\n"));
 	printf(_("  -n, --no-clean         do not clean up after errors\n"));
 	printf(_("  -N, --no-sync          do not wait for changes to be written safely to disk\n"));
@@ -1035,6 +1093,7 @@ CreateBackupStreamer(char *archive_name, char *spclocation,
 					 bbstreamer **manifest_inject_streamer_p,
 					 bool is_recovery_guc_supported,
 					 bool expect_unterminated_tarfile,
+					 bool is_parallel_part,
 					 pg_compress_specification *compress)
 {
 	bbstreamer *streamer = NULL;
@@ -1046,6 +1105,7 @@ CreateBackupStreamer(char *archive_name, char *spclocation,
 				is_tar_zstd,
 				is_compressed_tar;
 	bool		must_parse_archive;
+	bool		inject_recovery_conf;
 	int			archive_name_len = strlen(archive_name);
 
 	/*
@@ -1090,13 +1150,20 @@ CreateBackupStreamer(char *archive_name, char *spclocation,
 		exit(1);
 	}
 
+	/*
+	 * The recovery configuration goes into the main tablespace, and in a
+	 * parallel backup only into the archive sent by the leader.
+	 */
+	inject_recovery_conf = (spclocation == NULL && writerecoveryconf &&
+							!is_parallel_part);
+
 	/*
 	 * We have to parse the archive if (1) we're suppose to extract it, or if
 	 * (2) we need to inject backup_manifest or recovery configuration into
 	 * it. However, we only know how to parse tar archives.
 	 */
 	must_parse_archive = (format == 'p' || inject_manifest ||
-						  (spclocation == NULL && writerecoveryconf));
+						  inject_recovery_conf);
 
 	/* At present, we only know how to parse tar archives. */
 	if (must_parse_archive && !is_tar && !is_compressed_tar)
@@ -1127,7 +1194,8 @@ CreateBackupStreamer(char *archive_name, char *spclocation,
 			: get_tablespace_mapping(spclocation);
 		streamer = bbstreamer_extractor_new(directory,
 											get_tablespace_mapping,
-											progress_update_filename);
+											progress_update_filename,
+											num_jobs > 1);
 	}
 	else
 	{
@@ -1203,7 +1271,7 @@ CreateBackupStreamer(char *archive_name, char *spclocation,
 	 * If this is the main tablespace and we're supposed to write recovery
 	 * information, arrange to do that.
 	 */
-	if (spclocation == NULL && writerecoveryconf)
+	if (inject_recovery_conf)
 	{
 		Assert(must_parse_archive);
 		streamer = bbstreamer_recovery_injector_new(streamer,
@@ -1258,34 +1326,243 @@ ReceiveArchiveStream(PGconn *conn, pg_compress_specification *compress)
 	/* All the real work happens in ReceiveArchiveStreamChunk. */
 	ReceiveCopyData(conn, ReceiveArchiveStreamChunk, &state);
 
+	EndArchiveStream(&state);
+}
+
+/*
+ * Start the other streams of a parallel backup, once the leader has started
+ * the backup on the main connection.  Each of them gets a connection of its
+ * own, on which it runs BASE_BACKUP with the given options as a part of the
+ * leader's backup.  The size of each part is added to the size of the
+ * backup for progress reporting.
+ *
+ * Returns an array of num_jobs connections, the first being the leader's.
+ */
+static PGconn **
+StartParallelParts(const char *options)
+{
+	PGconn	  **conns;
+	int			i;
+
+	conns = pg_malloc0(sizeof(PGconn *) * num_jobs);
+	conns[0] = conn;
+
+	for (i = 1; i < num_jobs; i++)
+	{
+		PQExpBufferData buf;
+		PGresult   *res;
+		char	   *basebkp;
+		int			j;
+
+		conns[i] = GetConnection();
+		if (!conns[i])
+		{
+			/* Error message already written in GetConnection() */
+			exit(1);
+		}
+
+		initPQExpBuffer(&buf);
+		appendPQExpBufferStr(&buf, options);
+		AppendIntegerCommandOption(&buf, true, "PARALLEL", num_jobs);
+		AppendIntegerCommandOption(&buf, true, "PARALLEL_PART", i);
+		AppendIntegerCommandOption(&buf, true, "PARALLEL_LEADER",
+								   PQbackendPID(conn));
+		basebkp = psprintf("BASE_BACKUP (%s)", buf.data);
+
+		if (PQsendQuery(conns[i], basebkp) == 0)
+			pg_fatal("could not send replication command \"%s\": %s",
+					 "BASE_BACKUP", PQerrorMessage(conns[i]));
+
+		/* The starting WAL location is the one of the leader. */
+		res = PQgetResult(conns[i]);
+		if (PQresultStatus(res) != PGRES_TUPLES_OK)
+			pg_fatal("could not initiate base backup: %s",
+					 PQerrorMessage(conns[i]));
+		PQclear(res);
+
+		/* Get the header, with this stream's share of the backup size. */
+		res = PQgetResult(conns[i]);
+		if (PQresultStatus(res) != PGRES_TUPLES_OK)
+			pg_fatal("could not get backup header: %s",
+					 PQerrorMessage(conns[i]));
+		for (j = 0; j < PQntuples(res); j++)
+			totalsize_kb += atol(PQgetvalue(res, j, 2));
+		PQclear(res);
+
+		free(basebkp);
+		termPQExpBuffer(&buf);
+	}
+
+	return conns;
+}
+
+/*
+ * Receive the archives of all the streams of a parallel backup at the same
+ * time.  conns[0] is the connection of the leader, which is also the only
+ * one that can send a backup manifest, and the others are the connections
+ * returned by StartParallelParts().
+ *
+ * The COPY streams are read in non-blocking mode, and we wait on all the
+ * sockets when none of them has data to process.
+ */
+static void
+ReceiveParallelArchiveStreams(PGconn **conns,
+							  pg_compress_specification *compress)
+{
+	ArchiveStreamState *states;
+	bool	   *done;
+	int			nactive = num_jobs;
+	int			i;
+
+	states = pg_malloc0(sizeof(ArchiveStreamState) * num_jobs);
+	done = pg_malloc0(sizeof(bool) * num_jobs);
+
+	for (i = 0; i < num_jobs; i++)
+	{
+		PGresult   *res;
+
+		states[i].tablespacenum = -1;
+		states[i].compress = compress;
+		states[i].is_parallel_part = (i > 0);
+
+		/* Get the COPY data stream. */
+		res = PQgetResult(conns[i]);
+		if (PQresultStatus(res) != PGRES_COPY_OUT)
+			pg_fatal("could not get COPY data stream: %s",
+					 PQerrorMessage(conns[i]));
+		PQclear(res);
+	}
+
+	while (nactive > 0)
+	{
+		bool		processed = false;
+		fd_set		input_mask;
+		int			maxfd = -1;
+
+		if (bgchild_exited)
+			pg_fatal("background process terminated unexpectedly");
+
+		/* Process whatever data has already been received. */
+		for (i = 0; i < num_jobs; i++)
+		{
+			while (!done[i])
+			{
+				int			r;
+				char	   *copybuf;
+
+				r = PQgetCopyData(conns[i], &copybuf, 1);
+				if (r == 0)
+					break;
+				else if (r == -1)
+				{
+					/* End of this stream. */
+					done[i] = true;
+					nactive--;
+					break;
+				}
+				else if (r == -2)
+					pg_fatal("could not read COPY data: %s",
+							 PQerrorMessage(conns[i]));
+
+				ReceiveArchiveStreamChunk(r, copybuf, &states[i]);
+				PQfreemem(copybuf);
+				processed = true;
+			}
+		}
+
+		if (processed || nactive == 0)
+			continue;
+
+		/* Nothing to do, so wait for more data on any of the streams. */
+		FD_ZERO(&input_mask);
+		for (i = 0; i < num_jobs; i++)
+		{
+			int			sock;
+
+			if (done[i])
+				continue;
+			sock = PQsocket(conns[i]);
+			if (sock < 0)
+				pg_fatal("invalid socket: %s", PQerrorMessage(conns[i]));
+			FD_SET(sock, &input_mask);
+			if (sock > maxfd)
+				maxfd = sock;
+		}
+
+		if (select(maxfd + 1, &input_mask, NULL, NULL, NULL) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			pg_fatal("%s() failed: %m", "select");
+		}
+
+		for (i = 0; i < num_jobs; i++)
+		{
+			if (!done[i] && FD_ISSET(PQsocket(conns[i]), &input_mask) &&
+				PQconsumeInput(conns[i]) == 0)
+				pg_fatal("could not read COPY data: %s",
+						 PQerrorMessage(conns[i]));
+		}
+	}
+
+	for (i = 0; i < num_jobs; i++)
+		EndArchiveStream(&states[i]);
+
+	/*
+	 * The other streams are done.  The leader's connection is left for the
+	 * caller to read the end of the backup from.
+	 */
+	for (i = 1; i < num_jobs; i++)
+	{
+		PGresult   *res;
+
+		while ((res = PQgetResult(conns[i])) != NULL)
+		{
+			if (PQresultStatus(res) == PGRES_FATAL_ERROR)
+				pg_fatal("backup failed: %s", PQerrorMessage(conns[i]));
+			PQclear(res);
+		}
+		PQfinish(conns[i]);
+	}
+
+	pg_free(states);
+	pg_free(done);
+}
+
+/*
+ * Finish processing of the archives received as a single COPY stream.
+ */
+static void
+EndArchiveStream(ArchiveStreamState *state)
+{
 	/* If we wrote the backup manifest to a file, close the file. */
-	if (state.manifest_file !=NULL)
+	if (state->manifest_file !=NULL)
 	{
-		fclose(state.manifest_file);
-		state.manifest_file = NULL;
+		fclose(state->manifest_file);
+		state->manifest_file = NULL;
 	}
 
 	/*
 	 * If we buffered the backup manifest in order to inject it into the
 	 * output tarfile, do that now.
 	 */
-	if (state.manifest_inject_streamer != NULL &&
-		state.manifest_buffer != NULL)
+	if (state->manifest_inject_streamer != NULL &&
+		state->manifest_buffer != NULL)
 	{
-		bbstreamer_inject_file(state.manifest_inject_streamer,
+		bbstreamer_inject_file(state->manifest_inject_streamer,
 							   "backup_manifest",
-							   state.manifest_buffer->data,
-							   state.manifest_buffer->len);
-		destroyPQExpBuffer(state.manifest_buffer);
-		state.manifest_buffer = NULL;
+							   state->manifest_buffer->data,
+							   state->manifest_buffer->len);
+		destroyPQExpBuffer(state->manifest_buffer);
+		state->manifest_buffer = NULL;
 	}
 
 	/* If there's still an archive in progress, end processing. */
-	if (state.streamer != NULL)
+	if (state->streamer != NULL)
 	{
-		bbstreamer_finalize(state.streamer);
-		bbstreamer_free(state.streamer);
-		state.streamer = NULL;
+		bbstreamer_finalize(state->streamer);
+		bbstreamer_free(state->streamer);
+		state->streamer = NULL;
 	}
 }
 
@@ -1369,6 +1646,7 @@ ReceiveArchiveStreamChunk(size_t r, char *copybuf, void *callback_data)
 											 spclocation,
 											 &state->manifest_inject_streamer,
 											 true, false,
+											 state->is_parallel_part,
 											 state->compress);
 				}
 				break;
@@ -1416,10 +1694,16 @@ ReceiveArchiveStreamChunk(size_t r, char *copybuf, void *callback_data)
 				 * Progress report.
 				 *
 				 * The remainder of the message is expected to be an 8-byte
-				 * count of bytes completed.
+				 * count of bytes completed.  In a parallel backup, this is
+				 * the count of this stream; the progress of the backup is
+				 * the sum over all the streams.
 				 */
-				totaldone = GetCopyDataUInt64(r, copybuf, &cursor);
+				uint64		bytes_done;
+
+				bytes_done = GetCopyDataUInt64(r, copybuf, &cursor);
 				GetCopyDataEnd(r, copybuf, cursor);
+				totaldone += bytes_done - state->bytes_done;
+				state->bytes_done = bytes_done;
 
 				/*
 				 * The server shouldn't send progress report messages too
@@ -1579,6 +1863,7 @@ ReceiveTarFile(PGconn *conn, char *archive_name, char *spclocation,
 										  &manifest_inject_streamer,
 										  is_recovery_guc_supported,
 										  expect_unterminated_tarfile,
+										  false,
 										  compress);
 	state.tablespacenum = tablespacenum;
 	ReceiveCopyData(conn, ReceiveTarCopyChunk, &state);
@@ -1733,6 +2018,7 @@ BaseBackup(char *compression_algorithm, char *compression_detail,
 	int			writing_to_stdout;
 	bool		use_new_option_syntax = false;
 	PQExpBufferData buf;
+	char	   *part_options = NULL;
 
 	Assert(conn != NULL);
 	initPQExpBuffer(&buf);
@@ -1787,8 +2073,6 @@ BaseBackup(char *compression_algorithm, char *compression_detail,
 	AppendStringCommandOption(&buf, use_new_option_syntax, "LABEL", label);
 	if (estimatesize)
 		AppendPlainCommandOption(&buf, use_new_option_syntax, "PROGRESS");
-	if (includewal == FETCH_WAL)
-		AppendPlainCommandOption(&buf, use_new_option_syntax, "WAL");
 	if (fastcheckpoint)
 	{
 		if (use_new_option_syntax)
@@ -1828,6 +2112,21 @@ BaseBackup(char *compression_algorithm, char *compression_detail,
 									  "MANIFEST_CHECKSUMS", manifest_checksums);
 	}
 
+	if (incremental_dir != NULL)
+	{
+		char		lsnstr[MAXFNAMELEN];
+
+		if (serverMajor < 1600)
+			pg_fatal("incremental backups are not supported by this server version");
+
+		snprintf(lsnstr, sizeof(lsnstr), "%X/%X",
+				 LSN_FORMAT_ARGS(incremental_lsn));
+		AppendStringCommandOption(&buf, use_new_option_syntax,
+								  "INCREMENTAL", lsnstr);
+		AppendIntegerCommandOption(&buf, use_new_option_syntax,
+								   "INCREMENTAL_TLI", incremental_tli);
+	}
+
 	if (backup_target != NULL)
 	{
 		char	   *colon;
@@ -1872,6 +2171,23 @@ BaseBackup(char *compression_algorithm, char *compression_detail,
 									  compression_detail);
 	}
 
+	/*
+	 * The other streams of a parallel backup get the same options, except
+	 * that only the leader includes WAL.
+	 */
+	if (num_jobs > 1)
+	{
+		if (serverMajor < 1600)
+			pg_fatal("parallel base backups are not supported by this server version");
+
+		part_options = pg_strdup(buf.data);
+		AppendIntegerCommandOption(&buf, use_new_option_syntax,
+								   "PARALLEL", num_jobs);
+	}
+
+	if (includewal == FETCH_WAL)
+		AppendPlainCommandOption(&buf, use_new_option_syntax, "WAL");
+
 	if (verbose)
 		pg_log_info("initiating base backup, waiting for checkpoint to complete");
 
@@ -1998,7 +2314,16 @@ BaseBackup(char *compression_algorithm, char *compression_detail,
 						 wal_compress_level);
 	}
 
-	if (serverMajor >= 1500)
+	if (num_jobs > 1)
+	{
+		PGconn	  **conns;
+
+		/* Start the other streams, and receive all of them together. */
+		conns = StartParallelParts(part_options);
+		ReceiveParallelArchiveStreams(conns, client_compress);
+		pg_free(conns);
+	}
+	else if (serverMajor >= 1500)
 	{
 		/* Receive a single tar stream with everything. */
 		ReceiveArchiveStream(conn, client_compress);
@@ -2236,6 +2561,8 @@ main(int argc, char **argv)
 		{"version", no_argument, NULL, 'V'},
 		{"pgdata", required_argument, NULL, 'D'},
 		{"format", required_argument, NULL, 'F'},
+		{"incremental", required_argument, NULL, 'i'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"checkpoint", required_argument, NULL, 'c'},
 		{"create-slot", no_argument, NULL, 'C'},
 		{"max-rate", required_argument, NULL, 'r'},
@@ -2296,7 +2623,7 @@ main(int argc, char **argv)
 
 	atexit(cleanup_directories_atexit);
 
-	while ((c = getopt_long(argc, argv, "c:Cd:D:F:h:l:nNp:Pr:Rs:S:t:T:U:vwWX:zZ:",
+	while ((c = getopt_long(argc, argv, "c:Cd:D:F:h:i:j:l:nNp:Pr:Rs:S:t:T:U:vwWX:zZ:",
 							long_options, &option_index)) != -1)
 	{
 		switch (c)
@@ -2328,6 +2655,14 @@ main(int argc, char **argv)
 					pg_fatal("invalid output format \"%s\", must be \"plain\" or \"tar\"",
 							 optarg);
 				break;
+			case 'i':
+				incremental_dir = pg_strdup(optarg);
+				break;
+			case 'j':
+				if (!option_parse_int(optarg, "-j/--jobs", 1, 64,
+									  &num_jobs))
+					exit(1);
+				break;
 			case 'h':
 				dbhost = pg_strdup(optarg);
 				break;
@@ -2671,6 +3006,35 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	/*
+	 * Sanity checks for parallel backups.  The streams are extracted to the
+	 * same directories, so plain format is required, and the server doesn't
+	 * build a backup manifest for them.
+	 */
+	if (num_jobs > 1)
+	{
+		if (backup_target != NULL || format != 'p')
+		{
+			pg_log_error("parallel backups are only supported in plain format");
+			pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+			exit(1);
+		}
+		if (manifest_checksums != NULL || manifest_force_encode)
+		{
+			pg_log_error("backup manifests are not supported with %s",
+						 "--jobs");
+			pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+			exit(1);
+		}
+		manifest = false;
+	}
+
+	/*
+	 * Find where the earlier backup of an incremental backup started.
+	 */
+	if (incremental_dir != NULL)
+		read_incremental_source(incremental_dir);
+
 	/* connection in replication mode to server */
 	conn = GetConnection();
 	if (!conn)
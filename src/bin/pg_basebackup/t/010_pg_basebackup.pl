@@ -282,6 +282,26 @@ $node->command_ok([ @pg_basebackup_defs, '-D', "$tempdir/tarbackup", '-Ft' ],
 ok(-f "$tempdir/tarbackup/base.tar", 'backup tar was created');
 rmtree("$tempdir/tarbackup");
 
+$node->command_ok(
+	[ @pg_basebackup_defs, '-D', "$tempdir/parallelbackup", '-j', '3' ],
+	'parallel backup');
+ok(-f "$tempdir/parallelbackup/PG_VERSION",  'backup was created');
+ok(-f "$tempdir/parallelbackup/backup_label", 'backup label was sent');
+ok(-f "$tempdir/parallelbackup/global/pg_control",
+	'control file was sent');
+ok(!-f "$tempdir/parallelbackup/backup_manifest",
+	'no manifest for parallel backup');
+is_deeply(
+	[ sort(slurp_dir("$tempdir/parallelbackup/base/1")) ],
+	[ sort grep { $_ ne 'pg_internal.init' } slurp_dir("$pgdata/base/1") ],
+	'all files of a database directory were sent');
+rmtree("$tempdir/parallelbackup");
+
+$node->command_fails_like(
+	[ @pg_basebackup_defs, '-D', "$tempdir/parallelbackup", '-Ft', '-j', '2' ],
+	qr/parallel backups are only supported in plain format/,
+	'parallel backup in tar format fails');
+
 $node->command_fails(
 	[ @pg_basebackup_defs, '-D', "$tempdir/backup_foo", '-Fp', "-T=/foo" ],
 	'-T with empty old directory fails');
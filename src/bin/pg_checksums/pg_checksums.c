@@ -32,18 +32,79 @@
 #include "storage/checksum.h"
 #include "storage/checksum_impl.h"
 
+#ifdef WIN32
+/* Use Windows threads */
+#include <windows.h>
+#define GETERRNO() (_dosmaperr(GetLastError()), errno)
+#define THREAD_T HANDLE
+#define THREAD_FUNC_RETURN_TYPE unsigned
+#define THREAD_FUNC_RETURN return 0
+#define THREAD_FUNC_CC __stdcall
+#define THREAD_CREATE(handle, function, arg) \
+	((*(handle) = (HANDLE) _beginthreadex(NULL, 0, (function), (arg), 0, NULL)) == 0 ? errno : 0)
+#define THREAD_JOIN(handle) \
+	(WaitForSingleObject(handle, INFINITE) != WAIT_OBJECT_0 ? \
+	GETERRNO() : CloseHandle(handle) ? 0 : GETERRNO())
+#else
+/* Use POSIX threads */
+#include "port/pg_pthread.h"
+#define THREAD_T pthread_t
+#define THREAD_FUNC_RETURN_TYPE void *
+#define THREAD_FUNC_RETURN return NULL
+#define THREAD_FUNC_CC
+#define THREAD_CREATE(handle, function, arg) \
+	pthread_create((handle), NULL, (function), (arg))
+#define THREAD_JOIN(handle) \
+	pthread_join((handle), NULL)
+#endif
+
+/*
+ * Counters of the work done.  With --jobs, each worker thread has its own
+ * set, which are added up at the end.
+ */
+typedef struct ScanCounters
+{
+	int64		files_scanned;
+	int64		files_written;
+	int64		blocks_scanned;
+	int64		blocks_written;
+	int64		badblocks;
+	int64		current_size;	/* for progress reporting */
+} ScanCounters;
+
+/*
+ * With --jobs, the files to scan are collected first, and assigned to the
+ * worker threads so that each gets about the same amount of data.
+ */
+typedef struct ScanFile
+{
+	char	   *path;
+	int			segmentno;
+	int64		size;
+	int			worker;			/* index of the worker scanning the file */
+} ScanFile;
+
+typedef struct ScanWorker
+{
+	THREAD_T	thread;
+	ScanCounters counters;
+	int64		assigned_size;
+	volatile bool done;
+} ScanWorker;
 
-static int64 files_scanned = 0;
-static int64 files_written = 0;
-static int64 blocks_scanned = 0;
-static int64 blocks_written = 0;
-static int64 badblocks = 0;
+static ScanCounters counters;
 static ControlFileData *ControlFile;
 
 static char *only_filenode = NULL;
 static bool do_sync = true;
 static bool verbose = false;
 static bool showprogress = false;
+static int	num_jobs = 1;
+
+static ScanFile *scan_files = NULL;
+static int	num_scan_files = 0;
+static int	max_scan_files = 0;
+static ScanWorker *workers = NULL;
 
 typedef enum
 {
@@ -85,6 +146,7 @@ usage(void)
 	printf(_("  -d, --disable            disable data checksums\n"));
 	printf(_("  -e, --enable             enable data checksums\n"));
 	printf(_("  -f, --filenode=FILENODE  check only relation with specified filenode\n"));
+	printf(_("  -j, --jobs=NUM           use this many parallel jobs to scan files\n"));
 	printf(_("  -N, --no-sync            do not wait for changes to be written safely to disk\n"));
 	printf(_("  -P, --progress           show progress information\n"));
 	printf(_("  -v, --verbose            output verbose messages\n"));
@@ -143,6 +205,18 @@ progress_report(bool finished)
 	/* Save current time */
 	last_progress_report = now;
 
+	/* Add up the progress of all workers */
+	if (workers != NULL)
+	{
+		int			i;
+
+		current_size = 0;
+		for (i = 0; i < num_jobs; i++)
+			current_size += workers[i].counters.current_size;
+	}
+	else
+		current_size = counters.current_size;
+
 	/* Adjust total size if current_size is larger */
 	if (current_size > total_size)
 		total_size = current_size;
@@ -181,7 +255,7 @@ skipfile(const char *fn)
 }
 
 static void
-scan_file(const char *fn, int segmentno)
+scan_file(const char *fn, int segmentno, ScanCounters *counts)
 {
 	PGAlignedBlock buf;
 	PageHeader	header = (PageHeader) buf.data;
@@ -199,7 +273,7 @@ scan_file(const char *fn, int segmentno)
 	if (f < 0)
 		pg_fatal("could not open file \"%s\": %m", fn);
 
-	files_scanned++;
+	counts->files_scanned++;
 
 	for (blockno = 0;; blockno++)
 	{
@@ -217,7 +291,7 @@ scan_file(const char *fn, int segmentno)
 				pg_fatal("could not read block %u in file \"%s\": read %d of %d",
 						 blockno, fn, r, BLCKSZ);
 		}
-		blocks_scanned++;
+		counts->blocks_scanned++;
 
 		/*
 		 * Since the file size is counted as total_size for progress status
@@ -225,7 +299,7 @@ scan_file(const char *fn, int segmentno)
 		 * should be counted as current_size. Otherwise the progress reporting
 		 * calculated using those counters may not reach 100%.
 		 */
-		current_size += r;
+		counts->current_size += r;
 
 		/* New pages have no checksum yet */
 		if (PageIsNew(buf.data))
@@ -239,7 +313,7 @@ scan_file(const char *fn, int segmentno)
 				if (ControlFile->data_checksum_version == PG_DATA_CHECKSUM_VERSION)
 					pg_log_error("checksum verification failed in file \"%s\", block %u: calculated checksum %X but block contains %X",
 								 fn, blockno, csum, header->pd_checksum);
-				badblocks++;
+				counts->badblocks++;
 			}
 		}
 		else if (mode == PG_MODE_ENABLE)
@@ -275,7 +349,8 @@ scan_file(const char *fn, int segmentno)
 			}
 		}
 
-		if (showprogress)
+		/* With --jobs, the main thread reports progress instead */
+		if (showprogress && workers == NULL)
 			progress_report(false);
 	}
 
@@ -290,19 +365,145 @@ scan_file(const char *fn, int segmentno)
 	/* Update write counters if any write activity has happened */
 	if (blocks_written_in_file > 0)
 	{
-		files_written++;
-		blocks_written += blocks_written_in_file;
+		counts->files_written++;
+		counts->blocks_written += blocks_written_in_file;
 	}
 
 	close(f);
 }
 
+/*
+ * Remember a file to be scanned by a worker thread.
+ */
+static void
+add_scan_file(const char *fn, int segmentno, int64 size)
+{
+	ScanFile   *file;
+
+	if (num_scan_files == max_scan_files)
+	{
+		max_scan_files = Max(max_scan_files * 2, 1024);
+		scan_files = pg_realloc(scan_files, max_scan_files * sizeof(ScanFile));
+	}
+
+	file = &scan_files[num_scan_files++];
+	file->path = pg_strdup(fn);
+	file->segmentno = segmentno;
+	file->size = size;
+	file->worker = 0;
+}
+
+/* qsort comparator for ScanFile, largest first */
+static int
+scan_file_cmp(const void *a, const void *b)
+{
+	const ScanFile *fa = (const ScanFile *) a;
+	const ScanFile *fb = (const ScanFile *) b;
+
+	if (fa->size > fb->size)
+		return -1;
+	if (fa->size < fb->size)
+		return 1;
+	return 0;
+}
+
+static THREAD_FUNC_RETURN_TYPE THREAD_FUNC_CC
+scan_worker(void *arg)
+{
+	ScanWorker *worker = (ScanWorker *) arg;
+	int			workerno = worker - workers;
+	int			i;
+
+	for (i = 0; i < num_scan_files; i++)
+	{
+		if (scan_files[i].worker == workerno)
+			scan_file(scan_files[i].path, scan_files[i].segmentno,
+					  &worker->counters);
+	}
+
+	worker->done = true;
+
+	THREAD_FUNC_RETURN;
+}
+
+/*
+ * Scan the files collected by scan_directory() using num_jobs threads.
+ *
+ * Each file goes to the worker with the least data assigned so far, taking
+ * the largest files first, so that the workers finish at about the same
+ * time.
+ */
+static void
+scan_files_parallel(void)
+{
+	int			i;
+
+	qsort(scan_files, num_scan_files, sizeof(ScanFile), scan_file_cmp);
+
+	workers = pg_malloc0(num_jobs * sizeof(ScanWorker));
+	for (i = 0; i < num_scan_files; i++)
+	{
+		int			best = 0;
+		int			j;
+
+		for (j = 1; j < num_jobs; j++)
+		{
+			if (workers[j].assigned_size < workers[best].assigned_size)
+				best = j;
+		}
+		scan_files[i].worker = best;
+		workers[best].assigned_size += scan_files[i].size;
+		total_size += scan_files[i].size;
+	}
+
+	for (i = 0; i < num_jobs; i++)
+	{
+		errno = THREAD_CREATE(&workers[i].thread, scan_worker, &workers[i]);
+		if (errno != 0)
+			pg_fatal("could not create thread: %m");
+	}
+
+	if (showprogress)
+	{
+		for (;;)
+		{
+			bool		all_done = true;
+
+			for (i = 0; i < num_jobs; i++)
+			{
+				if (!workers[i].done)
+					all_done = false;
+			}
+			if (all_done)
+				break;
+
+			progress_report(false);
+			pg_usleep(100000L);
+		}
+	}
+
+	for (i = 0; i < num_jobs; i++)
+	{
+		errno = THREAD_JOIN(workers[i].thread);
+		if (errno != 0)
+			pg_fatal("could not join thread: %m");
+
+		counters.files_scanned += workers[i].counters.files_scanned;
+		counters.files_written += workers[i].counters.files_written;
+		counters.blocks_scanned += workers[i].counters.blocks_scanned;
+		counters.blocks_written += workers[i].counters.blocks_written;
+		counters.badblocks += workers[i].counters.badblocks;
+		counters.current_size += workers[i].counters.current_size;
+	}
+}
+
 /*
  * Scan the given directory for items which can be checksummed and
  * operate on each one of them.  If "sizeonly" is true, the size of
  * all the items which have checksums is computed and returned back
  * to the caller without operating on the files.  This is used to compile
- * the total size of the data directory for progress reports.
+ * the total size of the data directory for progress reports.  With
+ * --jobs, the files are only collected, see scan_files_parallel().
  */
 static int64
 scan_directory(const char *basedir, const char *subdir, bool sizeonly)
@@ -382,7 +583,12 @@ scan_directory(const char *basedir, const char *subdir, bool sizeonly)
 			 * the items in the data folder.
 			 */
 			if (!sizeonly)
-				scan_file(fn, segmentno);
+			{
+				if (num_jobs > 1)
+					add_scan_file(fn, segmentno, st.st_size);
+				else
+					scan_file(fn, segmentno, &counters);
+			}
 		}
 		else if (S_ISDIR(st.st_mode) || S_ISLNK(st.st_mode))
 		{
@@ -442,6 +648,7 @@ main(int argc, char *argv[])
 		{"disable", no_argument, NULL, 'd'},
 		{"enable", no_argument, NULL, 'e'},
 		{"filenode", required_argument, NULL, 'f'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"no-sync", no_argument, NULL, 'N'},
 		{"progress", no_argument, NULL, 'P'},
 		{"verbose", no_argument, NULL, 'v'},
@@ -471,7 +678,7 @@ main(int argc, char *argv[])
 		}
 	}
 
-	while ((c = getopt_long(argc, argv, "cdD:ef:NPv", long_options, &option_index)) != -1)
+	while ((c = getopt_long(argc, argv, "cdD:ef:j:NPv", long_options, &option_index)) != -1)
 	{
 		switch (c)
 		{
@@ -494,6 +701,11 @@ main(int argc, char *argv[])
 					exit(1);
 				only_filenode = pstrdup(optarg);
 				break;
+			case 'j':
+				if (!option_parse_int(optarg, "-j/--jobs", 1, INT_MAX,
+									  &num_jobs))
+					exit(1);
+				break;
 			case 'N':
 				do_sync = false;
 				break;
@@ -572,11 +784,19 @@ main(int argc, char *argv[])
 		mode == PG_MODE_CHECK)
 		pg_fatal("data checksums are not enabled in cluster");
 
+	if (ControlFile->data_checksum_version == PG_DATA_CHECKSUM_INPROGRESS_VERSION &&
+		mode == PG_MODE_CHECK)
+	{
+		pg_log_error("data checksums are being enabled or disabled in cluster");
+		pg_log_error_hint("Use --enable or --disable to complete the operation.");
+		exit(1);
+	}
+
 	if (ControlFile->data_checksum_version == 0 &&
 		mode == PG_MODE_DISABLE)
 		pg_fatal("data checksums are already disabled in cluster");
 
-	if (ControlFile->data_checksum_version > 0 &&
+	if (ControlFile->data_checksum_version == PG_DATA_CHECKSUM_VERSION &&
 		mode == PG_MODE_ENABLE)
 		pg_fatal("data checksums are already enabled in cluster");
 
@@ -586,9 +806,10 @@ main(int argc, char *argv[])
 		/*
 		 * If progress status information is requested, we need to scan the
 		 * directory tree twice: once to know how much total data needs to be
-		 * processed and once to do the real work.
+		 * processed and once to do the real work.  With --jobs, the total is
+		 * known once the files have been collected.
 		 */
-		if (showprogress)
+		if (showprogress && num_jobs == 1)
 		{
 			total_size = scan_directory(DataDir, "global", true);
 			total_size += scan_directory(DataDir, "base", true);
@@ -599,24 +820,27 @@ main(int argc, char *argv[])
 		(void) scan_directory(DataDir, "base", false);
 		(void) scan_directory(DataDir, "pg_tblspc", false);
 
+		if (num_jobs > 1)
+			scan_files_parallel();
+
 		if (showprogress)
 			progress_report(true);
 
 		printf(_("Checksum operation completed\n"));
-		printf(_("Files scanned:   %lld\n"), (long long) files_scanned);
-		printf(_("Blocks scanned:  %lld\n"), (long long) blocks_scanned);
+		printf(_("Files scanned:   %lld\n"), (long long) counters.files_scanned);
+		printf(_("Blocks scanned:  %lld\n"), (long long) counters.blocks_scanned);
 		if (mode == PG_MODE_CHECK)
 		{
-			printf(_("Bad checksums:  %lld\n"), (long long) badblocks);
+			printf(_("Bad checksums:  %lld\n"), (long long) counters.badblocks);
 			printf(_("Data checksum version: %u\n"), ControlFile->data_checksum_version);
 
-			if (badblocks > 0)
+			if (counters.badblocks > 0)
 				exit(1);
 		}
 		else if (mode == PG_MODE_ENABLE)
 		{
-			printf(_("Files written:  %lld\n"), (long long) files_written);
-			printf(_("Blocks written: %lld\n"), (long long) blocks_written);
+			printf(_("Files written:  %lld\n"), (long long) counters.files_written);
+			printf(_("Blocks written: %lld\n"), (long long) counters.blocks_written);
 		}
 	}
 
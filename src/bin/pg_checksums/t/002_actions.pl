@@ -163,6 +163,10 @@ command_ok(
 	[ 'pg_checksums', '-D', $pgdata ],
 	"verifies checksums as default action");
 
+# Checksums can be verified with several threads
+command_ok([ 'pg_checksums', '--check', '--jobs', '3', '-D', $pgdata ],
+	"succeeds with several jobs");
+
 # Specific relation files cannot be requested when action is --disable
 # or --enable.
 command_fails(
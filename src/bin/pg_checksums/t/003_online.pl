@@ -0,0 +1,70 @@
+
+# Copyright (c) 2021-2023, PostgreSQL Global Development Group
+
+# Test enabling and disabling data checksums in a running cluster with
+# pg_enable_data_checksums() and pg_disable_data_checksums().
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init(allows_streaming => 1);
+$node->start;
+my $pgdata = $node->data_dir;
+
+$node->safe_psql(
+	'postgres',
+	"CREATE TABLE t AS SELECT a FROM generate_series(1,10000) AS a;
+	CREATE INDEX t_a ON t (a);
+	CREATE UNLOGGED TABLE u AS SELECT a FROM generate_series(1,1000) AS a;");
+$node->safe_psql('template1',
+	"CREATE TABLE t AS SELECT a FROM generate_series(1,1000) AS a;");
+
+my $standby = PostgreSQL::Test::Cluster->new('standby');
+$node->backup('backup');
+$standby->init_from_backup($node, 'backup', has_streaming => 1);
+$standby->start;
+
+is($node->safe_psql('postgres', 'SHOW data_checksums'),
+	'off', 'data checksums are off');
+
+$node->safe_psql('postgres', 'SELECT pg_enable_data_checksums()');
+$node->poll_query_until('postgres', 'SHOW data_checksums', 'on')
+  or die "timed out waiting for data checksums to be enabled";
+
+# The change is replicated
+$node->wait_for_catchup($standby);
+is($standby->safe_psql('postgres', 'SHOW data_checksums'),
+	'on', 'data checksums are on in standby');
+
+is($node->safe_psql('postgres', 'SELECT count(*) FROM t'),
+	'10000', 'table can be read with checksums enabled');
+
+# Every page of the cluster has a valid checksum
+$node->stop;
+command_ok([ 'pg_checksums', '--check', '--jobs', '2', '-D', $pgdata ],
+	'checksums are valid after enabling them online');
+$node->start;
+
+$node->safe_psql('postgres', 'SELECT pg_disable_data_checksums()');
+$node->poll_query_until('postgres', 'SHOW data_checksums', 'off')
+  or die "timed out waiting for data checksums to be disabled";
+
+$node->wait_for_catchup($standby);
+is($standby->safe_psql('postgres', 'SHOW data_checksums'),
+	'off', 'data checksums are off in standby');
+
+# The functions cannot be used in a standby
+my ($ret, $stdout, $stderr) =
+  $standby->psql('postgres', 'SELECT pg_enable_data_checksums()');
+like($stderr, qr/recovery is in progress/,
+	'data checksums cannot be enabled in standby');
+
+$standby->stop;
+$node->stop;
+
+done_testing();
@@ -0,0 +1,702 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_combinebackup.c
+ *	  Reconstruct a full backup from a chain of incremental backups
+ *
+ * The first backup of the chain must be a full backup, and each of the
+ * following ones an incremental backup taken relative to the one before it
+ * with pg_basebackup --incremental.  All of them must be in plain format.
+ *
+ * The output directory gets the files of the last backup.  A file that the
+ * last backup contains as an incremental file (see basebackup_incremental.h)
+ * is reconstructed by taking each of its blocks from the latest backup that
+ * has it, going back through the chain until a backup has the whole file.
+ *
+ * Copyright (c) 2010-2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/bin/pg_combinebackup/pg_combinebackup.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres_fe.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "access/xlogdefs.h"
+#include "backup/basebackup_incremental.h"
+#include "common/controldata_utils.h"
+#include "common/file_perm.h"
+#include "common/file_utils.h"
+#include "common/logging.h"
+#include "getopt_long.h"
+#include "storage/block.h"
+
+/* What we need to know about each backup of the chain */
+typedef struct BackupInfo
+{
+	char	   *path;
+	XLogRecPtr	start_lsn;		/* START WAL LOCATION */
+	TimeLineID	start_tli;		/* START TIMELINE */
+	XLogRecPtr	incremental_lsn;	/* INCREMENTAL FROM LSN, if incremental */
+	TimeLineID	incremental_tli;	/* INCREMENTAL FROM TLI */
+	uint64		system_identifier;
+} BackupInfo;
+
+/* An incremental file, opened for reading */
+typedef struct IncrementalFile
+{
+	char		path[MAXPGPATH];
+	int			fd;
+	IncrementalFileHeader header;
+	BlockNumber *blocks;
+} IncrementalFile;
+
+static const char *progname;
+
+static BackupInfo *backups;
+static int	nbackups;
+static char *output_dir = NULL;
+static bool do_sync = true;
+static bool verbose = false;
+
+static bool success = false;
+static bool made_output_dir = false;
+static bool found_output_dir = false;
+
+static int64 files_copied = 0;
+static int64 files_reconstructed = 0;
+
+static void usage(void);
+static void cleanup_output_atexit(void);
+static void read_backup_info(BackupInfo *backup);
+static void check_backup_chain(void);
+static void combine_directory(const char *relpath);
+static void copy_file(const char *src, const char *dst);
+static void write_backup_label(const char *src, const char *dst);
+static void reconstruct_file(const char *relpath, const char *name);
+static bool open_incremental_file(const char *path, IncrementalFile *file);
+static void read_exactly(int fd, char *buf, size_t nbytes, off_t offset,
+						 const char *path);
+static void write_exactly(int fd, const char *buf, size_t nbytes,
+						  const char *path);
+
+
+static void
+usage(void)
+{
+	printf(_("%s reconstructs a full backup from incremental backups.\n\n"), progname);
+	printf(_("Usage:\n"));
+	printf(_("  %s [OPTION]... DIRECTORY...\n"), progname);
+	printf(_("\nOptions:\n"));
+	printf(_("  -N, --no-sync            do not wait for changes to be written safely to disk\n"));
+	printf(_("  -o, --output=DIRECTORY   output directory\n"));
+	printf(_("  -v, --verbose            output verbose messages\n"));
+	printf(_("  -V, --version            output version information, then exit\n"));
+	printf(_("  -?, --help               show this help, then exit\n"));
+	printf(_("\nThe first DIRECTORY must contain a full backup, and each of the following\n"
+			 "ones an incremental backup taken relative to the one before it.\n\n"));
+	printf(_("Report bugs to <%s>.\n"), PACKAGE_BUGREPORT);
+	printf(_("%s home page: <%s>\n"), PACKAGE_NAME, PACKAGE_URL);
+}
+
+/*
+ * Remove the output directory if we fail to fill it.
+ */
+static void
+cleanup_output_atexit(void)
+{
+	if (success)
+		return;
+
+	if (made_output_dir)
+	{
+		pg_log_info("removing output directory \"%s\"", output_dir);
+		if (!rmtree(output_dir, true))
+			pg_log_error("failed to remove output directory");
+	}
+	else if (found_output_dir)
+	{
+		pg_log_info("removing contents of output directory \"%s\"",
+					output_dir);
+		if (!rmtree(output_dir, false))
+			pg_log_error("failed to remove contents of output directory");
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	static struct option long_options[] = {
+		{"no-sync", no_argument, NULL, 'N'},
+		{"output", required_argument, NULL, 'o'},
+		{"verbose", no_argument, NULL, 'v'},
+		{NULL, 0, NULL, 0}
+	};
+
+	int			c;
+	int			option_index;
+	int			i;
+
+	pg_logging_init(argv[0]);
+	set_pglocale_pgservice(argv[0], PG_TEXTDOMAIN("pg_combinebackup"));
+	progname = get_progname(argv[0]);
+
+	if (argc > 1)
+	{
+		if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-?") == 0)
+		{
+			usage();
+			exit(0);
+		}
+		if (strcmp(argv[1], "--version") == 0 || strcmp(argv[1], "-V") == 0)
+		{
+			puts("pg_combinebackup (PostgreSQL) " PG_VERSION);
+			exit(0);
+		}
+	}
+
+	while ((c = getopt_long(argc, argv, "No:v", long_options, &option_index)) != -1)
+	{
+		switch (c)
+		{
+			case 'N':
+				do_sync = false;
+				break;
+			case 'o':
+				output_dir = pg_strdup(optarg);
+				break;
+			case 'v':
+				verbose = true;
+				break;
+			default:
+				/* getopt_long already emitted a complaint */
+				pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+				exit(1);
+		}
+	}
+
+	if (optind >= argc)
+	{
+		pg_log_error("no input directories specified");
+		pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+		exit(1);
+	}
+
+	if (output_dir == NULL)
+	{
+		pg_log_error("no output directory specified");
+		pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+		exit(1);
+	}
+	canonicalize_path(output_dir);
+
+	/* Learn about the backups, and check that they form a chain. */
+	nbackups = argc - optind;
+	backups = pg_malloc0(sizeof(BackupInfo) * nbackups);
+	for (i = 0; i < nbackups; i++)
+	{
+		backups[i].path = pg_strdup(argv[optind + i]);
+		canonicalize_path(backups[i].path);
+		read_backup_info(&backups[i]);
+	}
+	check_backup_chain();
+
+	/* Give the output the permissions of the last backup. */
+	if (!GetDataDirectoryCreatePerm(backups[nbackups - 1].path))
+		pg_fatal("could not read permissions of directory \"%s\": %m",
+				 backups[nbackups - 1].path);
+	umask(pg_mode_mask);
+
+	atexit(cleanup_output_atexit);
+
+	switch (pg_check_dir(output_dir))
+	{
+		case 0:
+			if (pg_mkdir_p(output_dir, pg_dir_create_mode) != 0)
+				pg_fatal("could not create directory \"%s\": %m", output_dir);
+			made_output_dir = true;
+			break;
+		case 1:
+			found_output_dir = true;
+			break;
+		case 2:
+		case 3:
+		case 4:
+			pg_fatal("directory \"%s\" exists but is not empty", output_dir);
+			break;
+		default:
+			pg_fatal("could not access directory \"%s\": %m", output_dir);
+	}
+
+	combine_directory("");
+
+	if (do_sync)
+	{
+		pg_log_info("syncing output directory");
+		fsync_pgdata(output_dir, PG_VERSION_NUM);
+	}
+
+	if (verbose)
+		pg_log_info("copied %lld files, reconstructed %lld files",
+					(long long) files_copied, (long long) files_reconstructed);
+
+	success = true;
+	return 0;
+}
+
+/*
+ * Read the backup_label and pg_control files of a backup.
+ */
+static void
+read_backup_info(BackupInfo *backup)
+{
+	char		path[MAXPGPATH];
+	char		line[MAXPGPATH + 64];
+	FILE	   *fp;
+	uint32		hi,
+				lo;
+	TimeLineID	tli;
+	ControlFileData *control_file;
+	bool		crc_ok;
+
+	snprintf(path, sizeof(path), "%s/backup_label", backup->path);
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		pg_fatal("could not open file \"%s\": %m", path);
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if (sscanf(line, "START WAL LOCATION: %X/%X", &hi, &lo) == 2)
+			backup->start_lsn = ((uint64) hi) << 32 | lo;
+		else if (sscanf(line, "START TIMELINE: %u", &tli) == 1)
+			backup->start_tli = tli;
+		else if (sscanf(line, "INCREMENTAL FROM LSN: %X/%X", &hi, &lo) == 2)
+			backup->incremental_lsn = ((uint64) hi) << 32 | lo;
+		else if (sscanf(line, "INCREMENTAL FROM TLI: %u", &tli) == 1)
+			backup->incremental_tli = tli;
+	}
+
+	if (ferror(fp))
+		pg_fatal("could not read file \"%s\": %m", path);
+	fclose(fp);
+
+	if (XLogRecPtrIsInvalid(backup->start_lsn) || backup->start_tli == 0)
+		pg_fatal("could not find the start of the backup in file \"%s\"",
+				 path);
+
+	control_file = get_controlfile(backup->path, &crc_ok);
+	if (!crc_ok)
+		pg_fatal("pg_control CRC value is incorrect in backup \"%s\"",
+				 backup->path);
+	if (control_file->blcksz != BLCKSZ)
+	{
+		pg_log_error("backup \"%s\" is not compatible", backup->path);
+		pg_log_error_detail("The backup was taken with block size %u, but pg_combinebackup was compiled with block size %u.",
+							control_file->blcksz, BLCKSZ);
+		exit(1);
+	}
+	backup->system_identifier = control_file->system_identifier;
+	pg_free(control_file);
+}
+
+/*
+ * Check that each backup is incremental to the one before it.
+ */
+static void
+check_backup_chain(void)
+{
+	int			i;
+
+	if (!XLogRecPtrIsInvalid(backups[0].incremental_lsn))
+	{
+		pg_log_error("backup \"%s\" is an incremental backup",
+					 backups[0].path);
+		pg_log_error_hint("The first backup must be a full backup.");
+		exit(1);
+	}
+
+	for (i = 1; i < nbackups; i++)
+	{
+		BackupInfo *prev = &backups[i - 1];
+		BackupInfo *cur = &backups[i];
+
+		if (cur->system_identifier != prev->system_identifier)
+			pg_fatal("backup \"%s\" is from a different database system than backup \"%s\"",
+					 cur->path, prev->path);
+
+		if (XLogRecPtrIsInvalid(cur->incremental_lsn))
+			pg_fatal("backup \"%s\" is not an incremental backup", cur->path);
+
+		if (cur->incremental_lsn != prev->start_lsn ||
+			cur->incremental_tli != prev->start_tli)
+		{
+			pg_log_error("backup \"%s\" is not incremental to backup \"%s\"",
+						 cur->path, prev->path);
+			pg_log_error_detail("It is incremental to a backup that started at WAL location %X/%X on timeline %u, but \"%s\" started at %X/%X on timeline %u.",
+								LSN_FORMAT_ARGS(cur->incremental_lsn),
+								cur->incremental_tli, prev->path,
+								LSN_FORMAT_ARGS(prev->start_lsn),
+								prev->start_tli);
+			exit(1);
+		}
+	}
+}
+
+/*
+ * Combine the contents of a directory of the last backup into the output
+ * directory.  relpath is the directory's path relative to the top of the
+ * backup, "" for the top itself.
+ *
+ * Symbolic links, such as those of tablespaces in pg_tblspc, are followed,
+ * so their targets' contents are copied into the output directory.
+ */
+static void
+combine_directory(const char *relpath)
+{
+	const char *last = backups[nbackups - 1].path;
+	char		srcdir[MAXPGPATH];
+	DIR		   *dir;
+	struct dirent *de;
+
+	snprintf(srcdir, sizeof(srcdir), "%s%s%s", last,
+			 relpath[0] ? "/" : "", relpath);
+
+	dir = opendir(srcdir);
+	if (dir == NULL)
+		pg_fatal("could not open directory \"%s\": %m", srcdir);
+
+	while ((de = readdir(dir)) != NULL)
+	{
+		char		relname[MAXPGPATH];
+		char		src[MAXPGPATH];
+		char		dst[MAXPGPATH];
+		struct stat st;
+
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+
+		snprintf(relname, sizeof(relname), "%s%s%s", relpath,
+				 relpath[0] ? "/" : "", de->d_name);
+		snprintf(src, sizeof(src), "%s/%s", last, relname);
+		snprintf(dst, sizeof(dst), "%s/%s", output_dir, relname);
+
+		if (stat(src, &st) != 0)
+			pg_fatal("could not stat file \"%s\": %m", src);
+
+		if (S_ISDIR(st.st_mode))
+		{
+			if (mkdir(dst, pg_dir_create_mode) != 0)
+				pg_fatal("could not create directory \"%s\": %m", dst);
+			combine_directory(relname);
+		}
+		else if (!S_ISREG(st.st_mode))
+			pg_log_warning("skipping special file \"%s\"", src);
+		else if (relpath[0] == '\0' &&
+				 strcmp(de->d_name, "backup_manifest") == 0)
+		{
+			/* the manifest describes the last backup, not the output */
+			continue;
+		}
+		else if (relpath[0] == '\0' &&
+				 strcmp(de->d_name, "backup_label") == 0)
+			write_backup_label(src, dst);
+		else if (strncmp(de->d_name, INCREMENTAL_PREFIX,
+						 INCREMENTAL_PREFIX_LENGTH) == 0)
+			reconstruct_file(relpath, de->d_name + INCREMENTAL_PREFIX_LENGTH);
+		else
+			copy_file(src, dst);
+	}
+
+	if (closedir(dir))
+		pg_fatal("could not close directory \"%s\": %m", srcdir);
+}
+
+/*
+ * Copy a file from the last backup to the output directory.
+ */
+static void
+copy_file(const char *src, const char *dst)
+{
+	char		buf[65536];
+	int			src_fd;
+	int			dst_fd;
+	ssize_t		nread;
+
+	src_fd = open(src, O_RDONLY | PG_BINARY, 0);
+	if (src_fd < 0)
+		pg_fatal("could not open file \"%s\": %m", src);
+	dst_fd = open(dst, O_WRONLY | O_CREAT | O_EXCL | PG_BINARY,
+				  pg_file_create_mode);
+	if (dst_fd < 0)
+		pg_fatal("could not create file \"%s\": %m", dst);
+
+	while ((nread = read(src_fd, buf, sizeof(buf))) > 0)
+		write_exactly(dst_fd, buf, nread, dst);
+	if (nread < 0)
+		pg_fatal("could not read file \"%s\": %m", src);
+
+	if (close(dst_fd) != 0)
+		pg_fatal("could not close file \"%s\": %m", dst);
+	close(src_fd);
+
+	files_copied++;
+}
+
+/*
+ * Copy the backup_label file of the last backup, leaving out the lines that
+ * make it an incremental backup.
+ */
+static void
+write_backup_label(const char *src, const char *dst)
+{
+	char		line[MAXPGPATH + 64];
+	FILE	   *in;
+	FILE	   *out;
+
+	in = fopen(src, "r");
+	if (in == NULL)
+		pg_fatal("could not open file \"%s\": %m", src);
+	out = fopen(dst, "w");
+	if (out == NULL)
+		pg_fatal("could not create file \"%s\": %m", dst);
+
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		if (strncmp(line, "INCREMENTAL FROM ", 17) == 0)
+			continue;
+		if (fputs(line, out) == EOF)
+			pg_fatal("could not write file \"%s\": %m", dst);
+	}
+
+	if (ferror(in))
+		pg_fatal("could not read file \"%s\": %m", src);
+	fclose(in);
+	if (fclose(out) != 0)
+		pg_fatal("could not write file \"%s\": %m", dst);
+}
+
+/*
+ * Reconstruct the file "name" in directory relpath, of which the last backup
+ * has an incremental file.
+ */
+static void
+reconstruct_file(const char *relpath, const char *name)
+{
+	IncrementalFile *files;
+	int		   *source_backup;
+	off_t	   *source_offset;
+	BlockNumber nblocks;
+	BlockNumber remaining;
+	BlockNumber blkno;
+	char		path[MAXPGPATH];
+	char		buf[BLCKSZ];
+	int			dst_fd;
+	int			i;
+
+	files = pg_malloc(sizeof(IncrementalFile) * nbackups);
+	for (i = 0; i < nbackups; i++)
+	{
+		files[i].fd = -1;
+		files[i].blocks = NULL;
+	}
+
+	snprintf(path, sizeof(path), "%s/%s/%s%s", backups[nbackups - 1].path,
+			 relpath, INCREMENTAL_PREFIX, name);
+	if (!open_incremental_file(path, &files[nbackups - 1]))
+		pg_fatal("could not open file \"%s\": %m", path);
+
+	/* Find the backup and offset to take each block of the output from. */
+	nblocks = files[nbackups - 1].header.truncation_block_length;
+	source_backup = pg_malloc(sizeof(int) * nblocks);
+	source_offset = pg_malloc(sizeof(off_t) * nblocks);
+	for (blkno = 0; blkno < nblocks; blkno++)
+		source_backup[blkno] = -1;
+	remaining = nblocks;
+
+	for (i = nbackups - 1; i >= 0 && remaining > 0; i--)
+	{
+		IncrementalFile *file = &files[i];
+		off_t		offset;
+		int			fd;
+		struct stat st;
+		BlockNumber k;
+
+		if (i < nbackups - 1)
+		{
+			snprintf(path, sizeof(path), "%s/%s/%s%s", backups[i].path,
+					 relpath, INCREMENTAL_PREFIX, name);
+			if (!open_incremental_file(path, file))
+			{
+				/* No incremental file, so this backup has the whole file. */
+				snprintf(path, sizeof(path), "%s/%s/%s", backups[i].path,
+						 relpath, name);
+				fd = open(path, O_RDONLY | PG_BINARY, 0);
+				if (fd < 0)
+				{
+					if (errno != ENOENT)
+						pg_fatal("could not open file \"%s\": %m", path);
+					pg_fatal("could not reconstruct file \"%s/%s\": backup \"%s\" does not contain it",
+							 relpath, name, backups[i].path);
+				}
+				if (fstat(fd, &st) != 0)
+					pg_fatal("could not stat file \"%s\": %m", path);
+				strlcpy(file->path, path, MAXPGPATH);
+				file->fd = fd;
+
+				for (blkno = 0; blkno < nblocks &&
+					 (off_t) (blkno + 1) * BLCKSZ <= st.st_size; blkno++)
+				{
+					if (source_backup[blkno] == -1)
+					{
+						source_backup[blkno] = i;
+						source_offset[blkno] = (off_t) blkno * BLCKSZ;
+						remaining--;
+					}
+				}
+
+				/*
+				 * Any blocks still missing are beyond the end of the file in
+				 * this backup.  They're left as zeroes, which WAL replay will
+				 * overwrite.
+				 */
+				break;
+			}
+		}
+
+		offset = sizeof(IncrementalFileHeader) +
+			sizeof(BlockNumber) * file->header.num_blocks;
+		for (k = 0; k < file->header.num_blocks; k++)
+		{
+			blkno = file->blocks[k];
+			if (blkno < nblocks && source_backup[blkno] == -1)
+			{
+				source_backup[blkno] = i;
+				source_offset[blkno] = offset;
+				remaining--;
+			}
+			offset += BLCKSZ;
+		}
+	}
+
+	/* Write out the file. */
+	snprintf(path, sizeof(path), "%s/%s/%s", output_dir, relpath, name);
+	dst_fd = open(path, O_WRONLY | O_CREAT | O_EXCL | PG_BINARY,
+				  pg_file_create_mode);
+	if (dst_fd < 0)
+		pg_fatal("could not create file \"%s\": %m", path);
+
+	for (blkno = 0; blkno < nblocks; blkno++)
+	{
+		i = source_backup[blkno];
+		if (i == -1)
+			memset(buf, 0, BLCKSZ);
+		else
+			read_exactly(files[i].fd, buf, BLCKSZ, source_offset[blkno],
+						 files[i].path);
+		write_exactly(dst_fd, buf, BLCKSZ, path);
+	}
+
+	if (close(dst_fd) != 0)
+		pg_fatal("could not close file \"%s\": %m", path);
+
+	for (i = 0; i < nbackups; i++)
+	{
+		if (files[i].fd >= 0)
+			close(files[i].fd);
+		if (files[i].blocks != NULL)
+			pg_free(files[i].blocks);
+	}
+	pg_free(files);
+	pg_free(source_backup);
+	pg_free(source_offset);
+
+	files_reconstructed++;
+}
+
+/*
+ * Open an incremental file and read its header.  Returns false if the file
+ * does not exist.
+ */
+static bool
+open_incremental_file(const char *path, IncrementalFile *file)
+{
+	struct stat st;
+	BlockNumber k;
+
+	strlcpy(file->path, path, MAXPGPATH);
+	file->fd = open(path, O_RDONLY | PG_BINARY, 0);
+	if (file->fd < 0)
+	{
+		if (errno == ENOENT)
+			return false;
+		pg_fatal("could not open file \"%s\": %m", path);
+	}
+
+	read_exactly(file->fd, (char *) &file->header,
+				 sizeof(IncrementalFileHeader), 0, path);
+	if (file->header.magic != INCREMENTAL_MAGIC)
+		pg_fatal("file \"%s\" has bad incremental magic number (0x%x, expected 0x%x)",
+				 path, file->header.magic, INCREMENTAL_MAGIC);
+	if (file->header.truncation_block_length > RELSEG_SIZE ||
+		file->header.num_blocks > file->header.truncation_block_length)
+		pg_fatal("file \"%s\" has a corrupt header", path);
+
+	if (fstat(file->fd, &st) != 0)
+		pg_fatal("could not stat file \"%s\": %m", path);
+	if (st.st_size != sizeof(IncrementalFileHeader) +
+		(off_t) file->header.num_blocks * (sizeof(BlockNumber) + BLCKSZ))
+		pg_fatal("file \"%s\" has size %lld, but its header describes %u blocks",
+				 path, (long long) st.st_size, file->header.num_blocks);
+
+	file->blocks = pg_malloc(sizeof(BlockNumber) *
+							 Max(file->header.num_blocks, 1));
+	read_exactly(file->fd, (char *) file->blocks,
+				 sizeof(BlockNumber) * file->header.num_blocks,
+				 sizeof(IncrementalFileHeader), path);
+
+	for (k = 0; k < file->header.num_blocks; k++)
+	{
+		if (file->blocks[k] >= file->header.truncation_block_length ||
+			(k > 0 && file->blocks[k] <= file->blocks[k - 1]))
+			pg_fatal("file \"%s\" has a corrupt block list", path);
+	}
+
+	return true;
+}
+
+/*
+ * Read exactly nbytes at offset, or fail.
+ */
+static void
+read_exactly(int fd, char *buf, size_t nbytes, off_t offset, const char *path)
+{
+	ssize_t		rc;
+
+	rc = pg_pread(fd, buf, nbytes, offset);
+	if (rc < 0)
+		pg_fatal("could not read file \"%s\": %m", path);
+	if (rc != nbytes)
+		pg_fatal("could not read file \"%s\": read %zd of %zu",
+				 path, rc, nbytes);
+}
+
+/*
+ * Write exactly nbytes, or fail.
+ */
+static void
+write_exactly(int fd, const char *buf, size_t nbytes, const char *path)
+{
+	errno = 0;
+	if (write(fd, buf, nbytes) != nbytes)
+	{
+		/* if write didn't set errno, assume problem is no disk space */
+		if (errno == 0)
+			errno = ENOSPC;
+		pg_fatal("could not write file \"%s\": %m", path);
+	}
+}
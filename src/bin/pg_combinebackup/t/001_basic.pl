@@ -0,0 +1,22 @@
+# Copyright (c) 2021-2023, PostgreSQL Global Development Group
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+program_help_ok('pg_combinebackup');
+program_version_ok('pg_combinebackup');
+program_options_handling_ok('pg_combinebackup');
+
+command_fails_like(
+	[ 'pg_combinebackup', '-o', 'out' ],
+	qr/no input directories specified/,
+	'input directories are required');
+
+command_fails_like(
+	[ 'pg_combinebackup', 'in' ],
+	qr/no output directory specified/,
+	'output directory is required');
+
+done_testing();
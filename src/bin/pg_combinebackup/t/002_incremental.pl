@@ -0,0 +1,78 @@
+# Copyright (c) 2021-2023, PostgreSQL Global Development Group
+
+# Take a full backup and two incremental backups, combine them, and check
+# that a server started from the result sees the latest data.
+
+use strict;
+use warnings;
+use File::Find;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $primary = PostgreSQL::Test::Cluster->new('primary');
+$primary->init(allows_streaming => 1);
+$primary->start;
+my $backup_dir = $primary->backup_dir;
+
+$primary->safe_psql('postgres',
+	"CREATE TABLE t1 AS SELECT g AS a, repeat('x', 100) AS b FROM generate_series(1, 10000) g"
+);
+$primary->command_ok(
+	[ 'pg_basebackup', '-D', "$backup_dir/full", '-c', 'fast', '--no-sync' ],
+	'full backup');
+
+$primary->safe_psql('postgres',
+	"UPDATE t1 SET b = 'changed' WHERE a % 1000 = 0;
+	 CREATE TABLE t2 AS SELECT g AS a FROM generate_series(1, 1000) g;");
+$primary->command_ok(
+	[
+		'pg_basebackup', '-D', "$backup_dir/incr1", '-c', 'fast', '--no-sync',
+		'--incremental', "$backup_dir/full"
+	],
+	'first incremental backup');
+
+$primary->safe_psql('postgres',
+	"DELETE FROM t1 WHERE a > 9000;
+	 INSERT INTO t2 SELECT g FROM generate_series(1001, 2000) g;");
+$primary->command_ok(
+	[
+		'pg_basebackup', '-D', "$backup_dir/incr2", '-c', 'fast', '--no-sync',
+		'--incremental', "$backup_dir/incr1"
+	],
+	'second incremental backup');
+
+# Most of t1 is unchanged, so it must have been sent incrementally.
+my $nincremental = 0;
+find(sub { $nincremental++ if /^INCREMENTAL\./ }, "$backup_dir/incr2");
+ok($nincremental > 0, 'incremental backup contains incremental files');
+
+command_fails_like(
+	[
+		'pg_combinebackup', '-o', "$backup_dir/bad",
+		"$backup_dir/full", "$backup_dir/incr2"
+	],
+	qr/is not incremental to backup/,
+	'backups must form a chain');
+
+command_ok(
+	[
+		'pg_combinebackup', '-N', '-o', "$backup_dir/combined",
+		"$backup_dir/full", "$backup_dir/incr1", "$backup_dir/incr2"
+	],
+	'combine backups');
+
+my $expected = $primary->safe_psql('postgres',
+	"SELECT count(*), sum(length(b)) FROM t1; SELECT count(*), sum(a) FROM t2;");
+
+my $restored = PostgreSQL::Test::Cluster->new('restored');
+$restored->init_from_backup($primary, 'combined');
+$restored->start;
+is( $restored->safe_psql(
+		'postgres',
+		"SELECT count(*), sum(length(b)) FROM t1; SELECT count(*), sum(a) FROM t2;"
+	),
+	$expected,
+	'combined backup has the latest data');
+
+done_testing();
@@ -0,0 +1,536 @@
+/*-------------------------------------------------------------------------
+ *
+ * compress_zstd.c
+ *	 Routines for archivers to write a Zstandard compressed data stream.
+ *
+ * The "workers" option of the compression specification makes libzstd
+ * compress in that many background threads, so that compression does not
+ * have to keep pace with the data stream on a single CPU.  The "long"
+ * option enables long-distance matching.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	   src/bin/pg_dump/compress_zstd.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres_fe.h"
+#include "pg_backup_utils.h"
+
+#include "compress_zstd.h"
+
+#ifdef USE_ZSTD
+#include <zstd.h>
+
+/*
+ * State of a Zstandard compression or decompression stream, used by both
+ * APIs.
+ */
+typedef struct ZstdCompressorState
+{
+	/* the file read or written via the CompressFileHandle API */
+	FILE	   *fp;
+
+	ZSTD_CStream *cstream;
+	ZSTD_DStream *dstream;
+	ZSTD_outBuffer output;
+	ZSTD_inBuffer input;
+
+	/* static string describing the last error, for Zstd_get_error() */
+	const char *zstderror;
+} ZstdCompressorState;
+
+/*
+ * Set a parameter of a compression stream, or die trying.
+ */
+static void
+ZstdSetParameter(ZSTD_CStream *cstream, ZSTD_cParameter param, int value,
+				 const char *paramname)
+{
+	size_t		res;
+
+	res = ZSTD_CCtx_setParameter(cstream, param, value);
+	if (ZSTD_isError(res))
+		pg_fatal("could not set compression parameter \"%s\": %s",
+				 paramname, ZSTD_getErrorName(res));
+}
+
+/*
+ * Create a compression stream with the parameters of the given compression
+ * specification.
+ */
+static ZSTD_CStream *
+ZstdCreateCStream(const pg_compress_specification compression_spec)
+{
+	ZSTD_CStream *cstream;
+
+	cstream = ZSTD_createCStream();
+	if (cstream == NULL)
+		pg_fatal("could not initialize compression library");
+
+	ZstdSetParameter(cstream, ZSTD_c_compressionLevel,
+					 compression_spec.level, "level");
+
+	/*
+	 * On older versions of libzstd, and on newer ones compiled without
+	 * threading support, setting the number of workers fails.
+	 */
+	if ((compression_spec.options & PG_COMPRESSION_OPTION_WORKERS) != 0)
+		ZstdSetParameter(cstream, ZSTD_c_nbWorkers,
+						 compression_spec.workers, "workers");
+
+	if ((compression_spec.options & PG_COMPRESSION_OPTION_LONG_DISTANCE) != 0)
+		ZstdSetParameter(cstream, ZSTD_c_enableLongDistanceMatching,
+						 compression_spec.long_distance, "long");
+
+	return cstream;
+}
+
+/*----------------------
+ * Compressor API
+ *----------------------
+ */
+
+/* Private routines that support Zstandard compressed data I/O */
+static void ReadDataFromArchiveZstd(ArchiveHandle *AH, CompressorState *cs);
+static void WriteDataToArchiveZstd(ArchiveHandle *AH, CompressorState *cs,
+								   const void *data, size_t dLen);
+static void EndCompressorZstd(ArchiveHandle *AH, CompressorState *cs);
+
+/*
+ * Compress the pending input of the compressor and write it out, and with
+ * 'flush', also end the frame and write out everything still buffered.
+ */
+static void
+ZstdWriteCommon(ArchiveHandle *AH, CompressorState *cs, bool flush)
+{
+	ZstdCompressorState *zstdcs = (ZstdCompressorState *) cs->private_data;
+	ZSTD_inBuffer *input = &zstdcs->input;
+	ZSTD_outBuffer *output = &zstdcs->output;
+
+	while (input->pos < input->size || flush)
+	{
+		size_t		res;
+
+		output->pos = 0;
+		res = ZSTD_compressStream2(zstdcs->cstream, output, input,
+								   flush ? ZSTD_e_end : ZSTD_e_continue);
+		if (ZSTD_isError(res))
+			pg_fatal("could not compress data: %s", ZSTD_getErrorName(res));
+
+		/*
+		 * A zero-length chunk would mark the end of the data in the custom
+		 * format, so don't write out empty output.
+		 */
+		if (output->pos > 0)
+			cs->writeF(AH, output->dst, output->pos);
+
+		/* when flushing, zero means that the frame is complete */
+		if (flush && res == 0)
+			break;
+	}
+}
+
+static void
+ReadDataFromArchiveZstd(ArchiveHandle *AH, CompressorState *cs)
+{
+	ZstdCompressorState *zstdcs = (ZstdCompressorState *) cs->private_data;
+	ZSTD_outBuffer *output = &zstdcs->output;
+	char	   *buf;
+	size_t		buflen;
+	size_t		cnt;
+
+	buflen = ZSTD_DStreamInSize();
+	buf = pg_malloc(buflen);
+
+	while ((cnt = cs->readF(AH, &buf, &buflen)))
+	{
+		ZSTD_inBuffer input = {buf, cnt, 0};
+
+		/*
+		 * Decompress until all the input is consumed and the decompressor
+		 * has no more output buffered, which is known when it doesn't fill
+		 * the output buffer.
+		 */
+		do
+		{
+			size_t		res;
+
+			output->pos = 0;
+			res = ZSTD_decompressStream(zstdcs->dstream, output, &input);
+			if (ZSTD_isError(res))
+				pg_fatal("could not decompress data: %s",
+						 ZSTD_getErrorName(res));
+
+			ahwrite(output->dst, 1, output->pos, AH);
+		} while (input.pos < input.size || output->pos == output->size);
+	}
+
+	pg_free(buf);
+}
+
+static void
+WriteDataToArchiveZstd(ArchiveHandle *AH, CompressorState *cs,
+					   const void *data, size_t dLen)
+{
+	ZstdCompressorState *zstdcs = (ZstdCompressorState *) cs->private_data;
+
+	zstdcs->input.src = data;
+	zstdcs->input.size = dLen;
+	zstdcs->input.pos = 0;
+
+	ZstdWriteCommon(AH, cs, false);
+}
+
+static void
+EndCompressorZstd(ArchiveHandle *AH, CompressorState *cs)
+{
+	ZstdCompressorState *zstdcs = (ZstdCompressorState *) cs->private_data;
+
+	if (zstdcs == NULL)
+		return;
+
+	if (zstdcs->cstream)
+	{
+		ZstdWriteCommon(AH, cs, true);
+		ZSTD_freeCStream(zstdcs->cstream);
+	}
+	if (zstdcs->dstream)
+		ZSTD_freeDStream(zstdcs->dstream);
+
+	pg_free(zstdcs->output.dst);
+	pg_free(zstdcs);
+	cs->private_data = NULL;
+}
+
+/*
+ * Public routines that support Zstandard compressed data I/O
+ */
+void
+InitCompressorZstd(CompressorState *cs,
+				   const pg_compress_specification compression_spec)
+{
+	ZstdCompressorState *zstdcs;
+
+	cs->readData = ReadDataFromArchiveZstd;
+	cs->writeData = WriteDataToArchiveZstd;
+	cs->end = EndCompressorZstd;
+
+	cs->compression_spec = compression_spec;
+
+	zstdcs = (ZstdCompressorState *) pg_malloc0(sizeof(ZstdCompressorState));
+	cs->private_data = zstdcs;
+
+	/* We are either reading or writing, never both */
+	Assert((cs->readF == NULL) != (cs->writeF == NULL));
+
+	if (cs->readF != NULL)
+	{
+		zstdcs->dstream = ZSTD_createDStream();
+		if (zstdcs->dstream == NULL)
+			pg_fatal("could not initialize compression library");
+
+		zstdcs->output.size = ZSTD_DStreamOutSize();
+	}
+	else
+	{
+		zstdcs->cstream = ZstdCreateCStream(compression_spec);
+		zstdcs->output.size = ZSTD_CStreamOutSize();
+	}
+
+	zstdcs->output.dst = pg_malloc(zstdcs->output.size);
+}
+
+/*----------------------
+ * Compress File API
+ *----------------------
+ */
+
+/*
+ * fread() equivalent implementation for Zstandard compressed files.
+ */
+static size_t
+Zstd_read(void *ptr, size_t size, CompressFileHandle *CFH)
+{
+	ZstdCompressorState *zstdcs = (ZstdCompressorState *) CFH->private_data;
+	ZSTD_inBuffer *input = &zstdcs->input;
+	ZSTD_outBuffer output = {ptr, size, 0};
+	size_t		input_allocated_size = ZSTD_DStreamInSize();
+
+	while (output.pos < output.size)
+	{
+		size_t		res;
+
+		/* Read more compressed data once the buffered input is consumed */
+		if (input->pos == input->size)
+		{
+			size_t		cnt;
+
+			cnt = fread(unconstify(void *, input->src), 1,
+						input_allocated_size, zstdcs->fp);
+			if (cnt == 0 && ferror(zstdcs->fp))
+				pg_fatal("could not read from input file: %m");
+
+			input->size = cnt;
+			input->pos = 0;
+		}
+
+		res = ZSTD_decompressStream(zstdcs->dstream, &output, input);
+		if (ZSTD_isError(res))
+			pg_fatal("could not decompress data: %s", ZSTD_getErrorName(res));
+
+		/*
+		 * Stop at the end of the file, unless the decompressor might still
+		 * have buffered output, which is the case if it just filled the
+		 * output buffer.
+		 */
+		if (input->pos == input->size && feof(zstdcs->fp) &&
+			output.pos < output.size)
+			break;
+	}
+
+	return output.pos;
+}
+
+/*
+ * Compress size bytes from ptr and write them to the stream.
+ */
+static size_t
+Zstd_write(const void *ptr, size_t size, CompressFileHandle *CFH)
+{
+	ZstdCompressorState *zstdcs = (ZstdCompressorState *) CFH->private_data;
+	ZSTD_inBuffer input = {ptr, size, 0};
+	ZSTD_outBuffer *output = &zstdcs->output;
+
+	while (input.pos < input.size)
+	{
+		size_t		res;
+
+		output->pos = 0;
+		res = ZSTD_compressStream2(zstdcs->cstream, output, &input,
+								   ZSTD_e_continue);
+		if (ZSTD_isError(res))
+		{
+			zstdcs->zstderror = ZSTD_getErrorName(res);
+			return 0;
+		}
+
+		if (fwrite(output->dst, 1, output->pos, zstdcs->fp) != output->pos)
+		{
+			errno = (errno) ? errno : ENOSPC;
+			zstdcs->zstderror = NULL;
+			return 0;
+		}
+	}
+
+	return size;
+}
+
+/*
+ * fgetc() equivalent implementation for Zstandard compressed files.
+ */
+static int
+Zstd_getc(CompressFileHandle *CFH)
+{
+	unsigned char c;
+
+	if (Zstd_read(&c, 1, CFH) != 1)
+		pg_fatal("could not read from input file: end of file");
+
+	return c;
+}
+
+/*
+ * fgets() equivalent implementation for Zstandard compressed files.
+ *
+ * This reads a byte at a time, which is fine since it's only used to read
+ * the small table of contents of large objects, and the input is buffered
+ * anyway.
+ */
+static char *
+Zstd_gets(char *ptr, int size, CompressFileHandle *CFH)
+{
+	int			i;
+
+	Assert(size > 0);
+
+	for (i = 0; i < size - 1; i++)
+	{
+		if (Zstd_read(&ptr[i], 1, CFH) != 1)
+			break;
+		if (ptr[i] == '\n')
+		{
+			i++;
+			break;
+		}
+	}
+	ptr[i] = '\0';
+
+	return i > 0 ? ptr : NULL;
+}
+
+/*
+ * Finalize (de)compression of a stream.  When compressing, end the frame,
+ * writing out everything still buffered.
+ */
+static int
+Zstd_close(CompressFileHandle *CFH)
+{
+	ZstdCompressorState *zstdcs = (ZstdCompressorState *) CFH->private_data;
+	int			ret;
+
+	if (zstdcs->cstream)
+	{
+		ZSTD_inBuffer input = {NULL, 0, 0};
+		ZSTD_outBuffer *output = &zstdcs->output;
+		size_t		res;
+
+		do
+		{
+			output->pos = 0;
+			res = ZSTD_compressStream2(zstdcs->cstream, output, &input,
+									   ZSTD_e_end);
+			if (ZSTD_isError(res))
+				pg_fatal("failed to end compression: %s",
+						 ZSTD_getErrorName(res));
+
+			if (fwrite(output->dst, 1, output->pos, zstdcs->fp) != output->pos)
+			{
+				errno = (errno) ? errno : ENOSPC;
+				WRITE_ERROR_EXIT;
+			}
+		} while (res != 0);
+
+		ZSTD_freeCStream(zstdcs->cstream);
+		pg_free(zstdcs->output.dst);
+	}
+
+	if (zstdcs->dstream)
+	{
+		ZSTD_freeDStream(zstdcs->dstream);
+		pg_free(unconstify(void *, zstdcs->input.src));
+	}
+
+	ret = fclose(zstdcs->fp);
+
+	pg_free(zstdcs);
+	CFH->private_data = NULL;
+
+	return ret;
+}
+
+/*
+ * Zstandard equivalent to feof(): true if all the buffered input has been
+ * consumed and the end of the backing file is reached.
+ */
+static int
+Zstd_eof(CompressFileHandle *CFH)
+{
+	ZstdCompressorState *zstdcs = (ZstdCompressorState *) CFH->private_data;
+
+	return zstdcs->input.pos == zstdcs->input.size && feof(zstdcs->fp);
+}
+
+static const char *
+Zstd_get_error(CompressFileHandle *CFH)
+{
+	ZstdCompressorState *zstdcs = (ZstdCompressorState *) CFH->private_data;
+
+	if (zstdcs->zstderror != NULL)
+		return zstdcs->zstderror;
+
+	return strerror(errno);
+}
+
+static int
+Zstd_open(const char *path, int fd, const char *mode,
+		  CompressFileHandle *CFH)
+{
+	FILE	   *fp;
+	ZstdCompressorState *zstdcs;
+
+	if (fd >= 0)
+		fp = fdopen(fd, mode);
+	else
+		fp = fopen(path, mode);
+	if (fp == NULL)
+		return 1;
+
+	zstdcs = (ZstdCompressorState *) pg_malloc0(sizeof(ZstdCompressorState));
+	zstdcs->fp = fp;
+
+	if (mode[0] == 'r')
+	{
+		zstdcs->dstream = ZSTD_createDStream();
+		if (zstdcs->dstream == NULL)
+			pg_fatal("could not initialize compression library");
+
+		zstdcs->input.src = pg_malloc(ZSTD_DStreamInSize());
+	}
+	else
+	{
+		zstdcs->cstream = ZstdCreateCStream(CFH->compression_spec);
+		zstdcs->output.size = ZSTD_CStreamOutSize();
+		zstdcs->output.dst = pg_malloc(zstdcs->output.size);
+	}
+
+	CFH->private_data = zstdcs;
+
+	return 0;
+}
+
+static int
+Zstd_open_write(const char *path, const char *mode, CompressFileHandle *CFH)
+{
+	char	   *fname;
+	int			ret;
+	int			save_errno;
+
+	fname = psprintf("%s.zst", path);
+	ret = CFH->open_func(fname, -1, mode, CFH);
+
+	save_errno = errno;
+	pg_free(fname);
+	errno = save_errno;
+
+	return ret;
+}
+
+/*
+ * Public routines
+ */
+void
+InitCompressFileHandleZstd(CompressFileHandle *CFH,
+						   const pg_compress_specification compression_spec)
+{
+	CFH->open_func = Zstd_open;
+	CFH->open_write_func = Zstd_open_write;
+	CFH->read_func = Zstd_read;
+	CFH->write_func = Zstd_write;
+	CFH->gets_func = Zstd_gets;
+	CFH->getc_func = Zstd_getc;
+	CFH->eof_func = Zstd_eof;
+	CFH->close_func = Zstd_close;
+	CFH->get_error_func = Zstd_get_error;
+
+	CFH->compression_spec = compression_spec;
+
+	CFH->private_data = NULL;
+}
+#else							/* USE_ZSTD */
+void
+InitCompressorZstd(CompressorState *cs,
+				   const pg_compress_specification compression_spec)
+{
+	pg_fatal("this build does not support compression with %s", "ZSTD");
+}
+
+void
+InitCompressFileHandleZstd(CompressFileHandle *CFH,
+						   const pg_compress_specification compression_spec)
+{
+	pg_fatal("this build does not support compression with %s", "ZSTD");
+}
+#endif							/* USE_ZSTD */
@@ -200,6 +200,8 @@ typedef struct _dumpOptions
 
 	int			sequence_data;	/* dump sequence data even in schema-only mode */
 	int			do_nothing;
+	int			table_chunk_size;	/* split table data in chunks of this
+									 * many MB, 0 = don't */
 } DumpOptions;
 
 /*
@@ -1817,6 +1817,10 @@ buildTocEntryArrays(ArchiveHandle *AH)
 		 * TOC entry that has a DATA item.  We compute this by reversing the
 		 * TABLE DATA item's dependency, knowing that a TABLE DATA item has
 		 * just one dependency and it is the TABLE item.
+		 *
+		 * The data of a large table may have been dumped in several chunks,
+		 * each in its own TABLE DATA item.  tableDataId then provides the
+		 * first chunk, and the others are linked from it via nextChunk.
 		 */
 		if (strcmp(te->desc, "TABLE DATA") == 0 && te->nDeps > 0)
 		{
@@ -1830,7 +1834,16 @@ buildTocEntryArrays(ArchiveHandle *AH)
 			if (tableId <= 0 || tableId > maxDumpId)
 				pg_fatal("bad table dumpId for TABLE DATA item");
 
-			AH->tableDataId[tableId] = te->dumpId;
+			if (AH->tableDataId[tableId] == 0)
+				AH->tableDataId[tableId] = te->dumpId;
+			else
+			{
+				TocEntry   *chunk = AH->tocsByDumpId[AH->tableDataId[tableId]];
+
+				while (chunk->nextChunk != NULL)
+					chunk = chunk->nextChunk;
+				chunk->nextChunk = te;
+			}
 		}
 	}
 }
@@ -2075,7 +2088,7 @@ _discoverArchiveFormat(ArchiveHandle *AH)
 
 		/*
 		 * Check if the specified archive is a directory. If so, check if
-		 * there's a "toc.dat" (or "toc.dat.{gz,lz4}") file in it.
+		 * there's a "toc.dat" (or "toc.dat.{gz,lz4,zst}") file in it.
 		 */
 		if (stat(AH->fSpec, &st) == 0 && S_ISDIR(st.st_mode))
 		{
@@ -2089,6 +2102,10 @@ _discoverArchiveFormat(ArchiveHandle *AH)
 #ifdef USE_LZ4
 			if (_fileExistsInDirectory(AH->fSpec, "toc.dat.lz4"))
 				return AH->format;
+#endif
+#ifdef USE_ZSTD
+			if (_fileExistsInDirectory(AH->fSpec, "toc.dat.zst"))
+				return AH->format;
 #endif
 			pg_fatal("directory \"%s\" does not appear to be a valid archive (\"toc.dat\" does not exist)",
 					 AH->fSpec);
@@ -2466,6 +2483,14 @@ WriteToc(ArchiveHandle *AH)
 		}
 		WriteStr(AH, NULL);		/* Terminate List */
 
+		/*
+		 * Size of the item's data, as measured by pg_dump: the number of
+		 * table pages for TABLE DATA items, zero for most others.
+		 */
+		snprintf(workbuf, sizeof(workbuf), INT64_FORMAT,
+				 (int64) te->dataLength);
+		WriteStr(AH, workbuf);
+
 		if (AH->WriteExtraTocPtr)
 			AH->WriteExtraTocPtr(AH, te);
 	}
@@ -2616,7 +2641,33 @@ ReadToc(ArchiveHandle *AH)
 			te->dependencies = NULL;
 			te->nDeps = 0;
 		}
+
+		/*
+		 * Read the size of the data, if recorded.  Convert table pages to
+		 * approximately the bytes they hold, so that the recorded sizes can
+		 * be compared with the estimates in bytes that the format modules
+		 * make for the items lacking one.  We don't know the block size of
+		 * the dumped server, but ours is close enough to order restore jobs.
+		 */
 		te->dataLength = 0;
+		if (AH->version >= K_VERS_1_16)
+		{
+			int64		pages;
+
+			tmp = ReadStr(AH);
+			pages = strtoi64(tmp, NULL, 10);
+			free(tmp);
+
+			if (pages > 0)
+			{
+				te->dataLength = (pgoff_t) pages * BLCKSZ;
+
+				/* Clamp if pgoff_t is only 32 bits wide, as in pg_dump */
+				if (sizeof(te->dataLength) == 4 &&
+					te->dataLength / BLCKSZ != pages)
+					te->dataLength = INT_MAX;
+			}
+		}
 
 		if (AH->ReadExtraTocPtr)
 			AH->ReadExtraTocPtr(AH, te);
@@ -4571,11 +4622,29 @@ repoint_table_dependencies(ArchiveHandle *AH)
 			{
 				DumpId		tabledataid = AH->tableDataId[olddep];
 				TocEntry   *tabledatate = AH->tocsByDumpId[tabledataid];
+				TocEntry   *chunk;
 
 				te->dependencies[i] = tabledataid;
 				te->dataLength = Max(te->dataLength, tabledatate->dataLength);
 				pg_log_debug("transferring dependency %d -> %d to %d",
 							 te->dumpId, olddep, tabledataid);
+
+				/*
+				 * If the data was dumped in chunks, depend on all of them.
+				 * The added dependencies are on TABLE DATA items, so the
+				 * loop won't try to re-point them.
+				 */
+				for (chunk = tabledatate->nextChunk; chunk != NULL;
+					 chunk = chunk->nextChunk)
+				{
+					te->dependencies = pg_realloc_array(te->dependencies,
+														DumpId, te->nDeps + 1);
+					te->dependencies[te->nDeps++] = chunk->dumpId;
+					te->depCount++;
+					te->dataLength = Max(te->dataLength, chunk->dataLength);
+					pg_log_debug("transferring dependency %d -> %d to %d",
+								 te->dumpId, olddep, chunk->dumpId);
+				}
 			}
 		}
 	}
@@ -4697,7 +4766,12 @@ mark_create_done(ArchiveHandle *AH, TocEntry *te)
 	{
 		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
 
-		ted->created = true;
+		/*
+		 * Don't set the flag if the data was dumped in chunks, because the
+		 * TRUNCATE it causes would remove the rows loaded by other chunks.
+		 */
+		if (ted->nextChunk == NULL)
+			ted->created = true;
 	}
 }
 
@@ -4713,9 +4787,11 @@ inhibit_data_for_failed_table(ArchiveHandle *AH, TocEntry *te)
 
 	if (AH->tableDataId[te->dumpId] != 0)
 	{
-		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
+		TocEntry   *ted;
 
-		ted->reqs = 0;
+		for (ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
+			 ted != NULL; ted = ted->nextChunk)
+			ted->reqs = 0;
 	}
 }
 
@@ -824,8 +824,8 @@ _ReopenArchive(ArchiveHandle *AH)
  *
  * The main thing that needs to happen here is to fill in TABLE DATA and BLOBS
  * TOC entries' dataLength fields with appropriate values to guide the
- * ordering of restore jobs.  The source of said data is format-dependent,
- * as is the exact meaning of the values.
+ * ordering of restore jobs, unless the archive recorded them.  The source of
+ * said data is format-dependent, as is the exact meaning of the values.
  *
  * A format module might also choose to do other setup here.
  */
@@ -854,8 +854,8 @@ _PrepParallelRestore(ArchiveHandle *AH)
 		if (tctx->dataState != K_OFFSET_POS_SET)
 			continue;
 
-		/* Compute previous data item's length */
-		if (prev_te)
+		/* Compute previous data item's length, if not recorded */
+		if (prev_te && prev_te->dataLength == 0)
 		{
 			if (tctx->dataPos > prev_tctx->dataPos)
 				prev_te->dataLength = tctx->dataPos - prev_tctx->dataPos;
@@ -866,7 +866,7 @@ _PrepParallelRestore(ArchiveHandle *AH)
 	}
 
 	/* If OK to seek, we can determine the length of the last item */
-	if (prev_te && ctx->hasSeek)
+	if (prev_te && prev_te->dataLength == 0 && ctx->hasSeek)
 	{
 		pgoff_t		endpos;
 
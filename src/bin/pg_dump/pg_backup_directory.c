@@ -742,8 +742,8 @@ setFilePath(ArchiveHandle *AH, char *buf, const char *relativeFilename)
  *
  * The main thing that needs to happen here is to fill in TABLE DATA and BLOBS
  * TOC entries' dataLength fields with appropriate values to guide the
- * ordering of restore jobs.  The source of said data is format-dependent,
- * as is the exact meaning of the values.
+ * ordering of restore jobs, unless the archive recorded them.  The source of
+ * said data is format-dependent, as is the exact meaning of the values.
  *
  * A format module might also choose to do other setup here.
  */
@@ -769,6 +769,10 @@ _PrepParallelRestore(ArchiveHandle *AH)
 		if ((te->reqs & REQ_DATA) == 0)
 			continue;
 
+		/* The size pg_dump recorded is a better guide than the file's */
+		if (te->dataLength != 0)
+			continue;
+
 		/*
 		 * Stat the file and, if successful, put its size in dataLength.  When
 		 * using compression, the physical file size might not be a very good
@@ -785,6 +789,8 @@ _PrepParallelRestore(ArchiveHandle *AH)
 				strlcat(fname, ".gz", sizeof(fname));
 			else if (AH->compression_spec.algorithm == PG_COMPRESSION_LZ4)
 				strlcat(fname, ".lz4", sizeof(fname));
+			else if (AH->compression_spec.algorithm == PG_COMPRESSION_ZSTD)
+				strlcat(fname, ".zst", sizeof(fname));
 
 			if (stat(fname, &st) == 0)
 				te->dataLength = st.st_size;
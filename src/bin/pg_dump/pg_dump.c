@@ -273,6 +273,7 @@ static void addConstrChildIdxDeps(DumpableObject *dobj, const IndxInfo *refidx);
 static void getDomainConstraints(Archive *fout, TypeInfo *tyinfo);
 static void getTableData(DumpOptions *dopt, TableInfo *tblinfo, int numTables, char relkind);
 static void makeTableDataInfo(DumpOptions *dopt, TableInfo *tbinfo);
+static void makeTableDataChunks(DumpOptions *dopt, TableInfo *tbinfo);
 static void buildMatViewRefreshDependencies(Archive *fout);
 static void getTableDataFKConstraints(void);
 static char *format_function_arguments(const FuncInfo *finfo, const char *funcargs,
@@ -421,6 +422,7 @@ main(int argc, char **argv)
 		{"on-conflict-do-nothing", no_argument, &dopt.do_nothing, 1},
 		{"rows-per-insert", required_argument, NULL, 10},
 		{"include-foreign-data", required_argument, NULL, 11},
+		{"table-chunk-size", required_argument, NULL, 12},
 
 		{NULL, 0, NULL, 0}
 	};
@@ -631,6 +633,12 @@ main(int argc, char **argv)
 										  optarg);
 				break;
 
+			case 12:			/* table chunk size */
+				if (!option_parse_int(optarg, "--table-chunk-size", 1, INT_MAX,
+									  &dopt.table_chunk_size))
+					exit_nicely(1);
+				break;
+
 			default:
 				/* getopt_long already emitted a complaint */
 				pg_log_error_hint("Try \"%s --help\" for more information.", progname);
@@ -717,9 +725,8 @@ main(int argc, char **argv)
 		case PG_COMPRESSION_GZIP:
 			/* fallthrough */
 		case PG_COMPRESSION_LZ4:
-			break;
+			/* fallthrough */
 		case PG_COMPRESSION_ZSTD:
-			pg_fatal("compression with %s is not yet supported", "ZSTD");
 			break;
 	}
 
@@ -786,6 +793,16 @@ main(int argc, char **argv)
 	if (fout->isStandby)
 		dopt.no_unlogged_table_data = true;
 
+	/*
+	 * Dumping a chunk of a table relies on TID range scans, without which
+	 * each chunk would scan the whole table.
+	 */
+	if (dopt.table_chunk_size > 0 && fout->remoteVersion < 140000)
+	{
+		pg_log_warning("option --table-chunk-size is ignored for servers older than version 14");
+		dopt.table_chunk_size = 0;
+	}
+
 	/*
 	 * Find the last built-in OID, if needed (prior to 8.1)
 	 *
@@ -1084,6 +1101,8 @@ help(const char *progname)
 	printf(_("  --snapshot=SNAPSHOT          use given snapshot for the dump\n"));
 	printf(_("  --strict-names               require table and/or schema include patterns to\n"
 			 "                               match at least one entity each\n"));
+	printf(_("  --table-chunk-size=SIZE      dump the data of tables larger than SIZE MB\n"
+			 "                               in chunks of that size\n"));
 	printf(_("  --use-set-session-authorization\n"
 			 "                               use SET SESSION AUTHORIZATION commands instead of\n"
 			 "                               ALTER OWNER commands to set ownership\n"));
@@ -2025,8 +2044,10 @@ dumpTableData_copy(Archive *fout, const void *dcontext)
 
 	/*
 	 * Use COPY (SELECT ...) TO when dumping a foreign table's data, and when
-	 * a filter condition was specified.  For other cases a simple COPY
-	 * suffices.
+	 * a filter condition was specified, including the range of blocks of a
+	 * chunk.  For other cases a simple COPY suffices.  Like COPY, the SELECT
+	 * must not include the rows of child tables, which are dumped with those
+	 * tables.
 	 */
 	if (tdinfo->filtercond || tbinfo->relkind == RELKIND_FOREIGN_TABLE)
 	{
@@ -2040,7 +2061,7 @@ dumpTableData_copy(Archive *fout, const void *dcontext)
 		else
 			appendPQExpBufferStr(q, "* ");
 
-		appendPQExpBuffer(q, "FROM %s %s) TO stdout;",
+		appendPQExpBuffer(q, "FROM ONLY %s %s) TO stdout;",
 						  fmtQualifiedDumpable(tbinfo),
 						  tdinfo->filtercond ? tdinfo->filtercond : "");
 	}
@@ -2518,6 +2539,16 @@ dumpTableData(Archive *fout, const TableDataInfo *tdinfo)
 		te->dataLength = (BlockNumber) tbinfo->relpages;
 		te->dataLength += (BlockNumber) tbinfo->toastpages;
 
+		/*
+		 * A chunk gets its own pages and a proportional share of the TOAST
+		 * pages.
+		 */
+		if (tdinfo->chunkpages != 0)
+			te->dataLength = (BlockNumber) tdinfo->chunkpages +
+				(pgoff_t) ((double) (BlockNumber) tbinfo->toastpages *
+						   (BlockNumber) tdinfo->chunkpages /
+						   (BlockNumber) tbinfo->relpages);
+
 		/*
 		 * If pgoff_t is only 32 bits wide, the above refinement is useless,
 		 * and instead we'd better worry about integer overflow.  Clamp to
@@ -2584,7 +2615,11 @@ getTableData(DumpOptions *dopt, TableInfo *tblinfo, int numTables, char relkind)
 	{
 		if (tblinfo[i].dobj.dump & DUMP_COMPONENT_DATA &&
 			(!relkind || tblinfo[i].relkind == relkind))
+		{
 			makeTableDataInfo(dopt, &(tblinfo[i]));
+			if (dopt->table_chunk_size > 0)
+				makeTableDataChunks(dopt, &(tblinfo[i]));
+		}
 	}
 }
 
@@ -2650,6 +2685,8 @@ makeTableDataInfo(DumpOptions *dopt, TableInfo *tbinfo)
 	tdinfo->dobj.namespace = tbinfo->dobj.namespace;
 	tdinfo->tdtable = tbinfo;
 	tdinfo->filtercond = NULL;	/* might get set later */
+	tdinfo->chunkpages = 0;
+	tdinfo->nextChunk = NULL;
 	addObjectDependency(&tdinfo->dobj, tbinfo->dobj.dumpId);
 
 	/* A TableDataInfo contains data, of course */
@@ -2661,6 +2698,81 @@ makeTableDataInfo(DumpOptions *dopt, TableInfo *tbinfo)
 	tbinfo->interesting = true;
 }
 
+/*
+ * Split the data of a large table into chunks, per --table-chunk-size
+ *
+ * The table's TableDataInfo becomes the first chunk, and one more
+ * TableDataInfo is made for each of the following chunks.  Each chunk dumps
+ * the rows in a range of the table's blocks, which the server reads with a
+ * TID range scan, so that a parallel dump can dump the chunks of a table in
+ * separate workers, all using the same snapshot.  A parallel restore loads
+ * them in parallel as well.  The first and last chunks are not bounded
+ * below and above respectively, so that no rows are missed if relpages is
+ * out of date.
+ *
+ * The chunk size is converted to blocks using our own BLCKSZ, which is good
+ * enough even if the server's block size differs.
+ */
+static void
+makeTableDataChunks(DumpOptions *dopt, TableInfo *tbinfo)
+{
+	TableDataInfo *tdinfo = tbinfo->dataObj;
+	TableDataInfo *prev;
+	uint64		relpages = (BlockNumber) tbinfo->relpages;
+	uint64		chunkpages;
+	uint64		start;
+
+	/* Only plain tables, whose rows are not already filtered */
+	if (tdinfo == NULL ||
+		tdinfo->dobj.objType != DO_TABLE_DATA ||
+		tbinfo->relkind != RELKIND_RELATION ||
+		tdinfo->filtercond != NULL)
+		return;
+
+	chunkpages = (uint64) dopt->table_chunk_size * 1024 * 1024 / BLCKSZ;
+	chunkpages = Max(chunkpages, 1);
+	if (relpages <= chunkpages)
+		return;
+
+	tdinfo->filtercond = psprintf("WHERE ctid < '(%u,0)'",
+								  (BlockNumber) chunkpages);
+	tdinfo->chunkpages = (int) chunkpages;
+
+	prev = tdinfo;
+	for (start = chunkpages; start < relpages; start += chunkpages)
+	{
+		TableDataInfo *chunk;
+
+		chunk = (TableDataInfo *) pg_malloc(sizeof(TableDataInfo));
+		chunk->dobj.objType = DO_TABLE_DATA;
+		chunk->dobj.catId = tdinfo->dobj.catId;
+		AssignDumpId(&chunk->dobj);
+		chunk->dobj.name = tdinfo->dobj.name;
+		chunk->dobj.namespace = tdinfo->dobj.namespace;
+		chunk->dobj.dump = tdinfo->dobj.dump;
+		chunk->tdtable = tbinfo;
+		if (start + chunkpages < relpages)
+		{
+			chunk->filtercond = psprintf("WHERE ctid >= '(%u,0)' AND ctid < '(%u,0)'",
+										 (BlockNumber) start,
+										 (BlockNumber) (start + chunkpages));
+			chunk->chunkpages = (int) chunkpages;
+		}
+		else
+		{
+			chunk->filtercond = psprintf("WHERE ctid >= '(%u,0)'",
+										 (BlockNumber) start);
+			chunk->chunkpages = (int) (relpages - start);
+		}
+		chunk->nextChunk = NULL;
+		addObjectDependency(&chunk->dobj, tbinfo->dobj.dumpId);
+		chunk->dobj.components |= DUMP_COMPONENT_DATA;
+
+		prev->nextChunk = chunk;
+		prev = chunk;
+	}
+}
+
 /*
  * The refresh for a materialized view must be dependent on the refresh for
  * any materialized view that this one is dependent on.
@@ -2810,10 +2922,16 @@ getTableDataFKConstraints(void)
 
 			/*
 			 * Okay, make referencing table's TABLE_DATA object depend on the
-			 * referenced table's TABLE_DATA object.
+			 * referenced table's TABLE_DATA object, for all their chunks.
 			 */
-			addObjectDependency(&cinfo->contable->dataObj->dobj,
-								ftable->dataObj->dobj.dumpId);
+			for (TableDataInfo *tdinfo = cinfo->contable->dataObj;
+				 tdinfo != NULL; tdinfo = tdinfo->nextChunk)
+			{
+				for (TableDataInfo *reftdinfo = ftable->dataObj;
+					 reftdinfo != NULL; reftdinfo = reftdinfo->nextChunk)
+					addObjectDependency(&tdinfo->dobj,
+										reftdinfo->dobj.dumpId);
+			}
 		}
 	}
 	free(dobjs);
@@ -15817,6 +15935,9 @@ dumpTableSchema(Archive *fout, const TableInfo *tbinfo)
 					case 'l':
 						cmname = "lz4";
 						break;
+					case 'z':
+						cmname = "zstd";
+						break;
 					default:
 						cmname = NULL;
 						break;
@@ -380,6 +380,8 @@ typedef struct _tableDataInfo
 	DumpableObject dobj;
 	TableInfo  *tdtable;		/* link to table to dump */
 	char	   *filtercond;		/* WHERE condition to limit rows dumped */
+	int			chunkpages;		/* chunk's size in pages, 0 if not chunked */
+	struct _tableDataInfo *nextChunk;	/* next chunk of the table's data */
 } TableDataInfo;
 
 typedef struct _indxInfo
@@ -131,6 +131,12 @@ command_fails_like(
 	'pg_dump: invalid compression specification: compression algorithm "none" does not accept a compression level'
 );
 
+command_fails_like(
+	[ 'pg_dump', '--compress', 'lz4:long' ],
+	qr/\Qpg_dump: error: invalid compression specification: compression algorithm "lz4" does not support long-distance mode\E/,
+	'pg_dump: invalid compression specification: long-distance mode only for zstd'
+);
+
 
 if (check_pg_config("#define HAVE_LIBZ 1"))
 {
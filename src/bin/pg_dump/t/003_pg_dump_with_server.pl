@@ -37,4 +37,37 @@ command_ok(
 	[ "pg_dump", '-p', $port, '-a', '--include-foreign-data=s2', 'postgres' ],
 	"dump foreign server with no tables");
 
+#########################################
+# Verify that a table split in chunks is dumped and restored completely
+
+$node->safe_psql('postgres',
+	"CREATE TABLE chunked AS SELECT g AS a, repeat('x', 200) AS b FROM generate_series(1, 20000) g"
+);
+$node->safe_psql('postgres', "CREATE INDEX chunked_a ON chunked (a)");
+$node->safe_psql('postgres', "VACUUM ANALYZE chunked");
+
+command_ok(
+	[
+		'pg_dump', '-p', $port, '--format=directory', '--jobs=2',
+		'--table-chunk-size=1', '--table=chunked',
+		"--file=$tempdir/chunked", 'postgres'
+	],
+	"parallel dump of a table in chunks");
+
+($stdout, $stderr) =
+  run_command([ 'pg_restore', '-l', "$tempdir/chunked" ]);
+my $nchunks = () = $stdout =~ /TABLE DATA public chunked /g;
+cmp_ok($nchunks, '>', 1, "table data is dumped in several chunks");
+
+$node->safe_psql('postgres', "CREATE DATABASE chunked_restore");
+command_ok(
+	[
+		'pg_restore', '-p', $port, '--jobs=2', '--dbname=chunked_restore',
+		"$tempdir/chunked"
+	],
+	"parallel restore of a table in chunks");
+$result = $node->safe_psql('chunked_restore',
+	"SELECT count(*), count(DISTINCT a) FROM chunked");
+is($result, '20000|20000', "all chunks are restored");
+
 done_testing();
@@ -125,6 +125,73 @@ write_target_range(char *buf, off_t begin, size_t size)
 	/* keep the file open, in case we need to copy more blocks in it */
 }
 
+/*
+ * Copy 'size' bytes at offset 'begin' of an open source file to the same
+ * offset of the currently open target file.
+ *
+ * Where copy_file_range() is available, the kernel copies the data without
+ * passing it through user space, and file systems supporting it can even
+ * share the blocks between both files instead of copying them.
+ */
+void
+copy_target_range(int srcfd, const char *srcpath, off_t begin, size_t size)
+{
+	PGAlignedBlock buf;
+
+#ifdef HAVE_COPY_FILE_RANGE
+	if (!dry_run)
+	{
+		off_t		srcoff = begin;
+		off_t		dstoff = begin;
+
+		while (size > 0)
+		{
+			ssize_t		copylen;
+
+			copylen = copy_file_range(srcfd, &srcoff, dstfd, &dstoff, size, 0);
+			if (copylen < 0)
+			{
+				/*
+				 * Not supported between these files, for example because
+				 * they are on different file systems with an older kernel.
+				 * Copy the rest by reading and writing it.
+				 */
+				if (errno == EXDEV || errno == EINVAL || errno == ENOSYS ||
+					errno == EOPNOTSUPP)
+					break;
+				pg_fatal("could not copy file \"%s\" to \"%s\": %m",
+						 srcpath, dstpath);
+			}
+			else if (copylen == 0)
+				pg_fatal("unexpected EOF while reading file \"%s\"", srcpath);
+
+			size -= copylen;
+
+			/* update progress report */
+			fetch_done += copylen;
+			progress_report(false);
+		}
+
+		begin = srcoff;
+	}
+#endif
+
+	while (size > 0)
+	{
+		ssize_t		readlen;
+
+		readlen = pg_pread(srcfd, buf.data, Min(size, sizeof(buf)), begin);
+		if (readlen < 0)
+			pg_fatal("could not read file \"%s\": %m", srcpath);
+		else if (readlen == 0)
+			pg_fatal("unexpected EOF while reading file \"%s\"", srcpath);
+
+		write_target_range(buf.data, begin, readlen);
+		begin += readlen;
+		size -= readlen;
+	}
+}
+
 
 void
 remove_target(file_entry_t *entry)
@@ -14,6 +14,8 @@
 
 extern void open_target_file(const char *path, bool trunc);
 extern void write_target_range(char *buf, off_t begin, size_t size);
+extern void copy_target_range(int srcfd, const char *srcpath, off_t begin,
+							  size_t size);
 extern void close_target_file(void);
 extern void remove_target_file(const char *path, bool missing_ok);
 extern void truncate_target_file(const char *path, off_t newsize);
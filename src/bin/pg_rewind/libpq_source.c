@@ -34,20 +34,40 @@ typedef struct
 	size_t		length;
 } fetch_range_request;
 
+/*
+ * A connection used to fetch chunks.  With several of them, the queries
+ * fetching the chunks are sent to the connections in turn, and run
+ * concurrently in the source server.  Their results are still processed in
+ * the order the queries were sent, so the target is written to in the same
+ * order as with a single connection.
+ */
 typedef struct
 {
-	rewind_source common;		/* common interface functions */
-
 	PGconn	   *conn;
 
 	/*
 	 * Queue of chunks that have been requested with the queue_fetch_range()
-	 * function, but have not been fetched from the remote server yet.
+	 * function, but have not been fetched from the remote server yet.  If
+	 * in_progress is true, the query fetching them has been sent, and its
+	 * results have not been processed yet.
 	 */
 	int			num_requests;
+	bool		in_progress;
 	fetch_range_request request_queue[MAX_CHUNKS_PER_QUERY];
+} fetch_conn;
+
+typedef struct
+{
+	rewind_source common;		/* common interface functions */
+
+	PGconn	   *conn;
+
+	/* connections to fetch chunks with; the first one is 'conn' */
+	int			nconns;
+	fetch_conn *conns;
+	int			current;		/* connection whose queue is being filled */
 
-	/* temporary space for process_queued_fetch_requests() */
+	/* temporary space for send_queued_fetch_requests() */
 	StringInfoData paths;
 	StringInfoData offsets;
 	StringInfoData lengths;
@@ -58,7 +78,8 @@ static char *run_simple_query(PGconn *conn, const char *sql);
 static void run_simple_command(PGconn *conn, const char *sql);
 static void appendArrayEscapedString(StringInfo buf, const char *str);
 
-static void process_queued_fetch_requests(libpq_source *src);
+static void send_queued_fetch_requests(libpq_source *src);
+static void process_fetch_results(fetch_conn *fc);
 
 /* public interface functions */
 static void libpq_traverse_files(rewind_source *source,
@@ -76,10 +97,12 @@ static void libpq_destroy(rewind_source *source);
  * Create a new libpq source.
  *
  * The caller has already established the connection, but should not try
- * to use it while the source is active.
+ * to use it while the source is active.  If nconns is more than one, the
+ * other connections used to fetch file contents are opened here with
+ * connstr.
  */
 rewind_source *
-init_libpq_source(PGconn *conn)
+init_libpq_source(PGconn *conn, const char *connstr, int nconns)
 {
 	libpq_source *src;
 
@@ -97,6 +120,21 @@ init_libpq_source(PGconn *conn)
 
 	src->conn = conn;
 
+	src->nconns = nconns;
+	src->conns = pg_malloc0(sizeof(fetch_conn) * nconns);
+	src->conns[0].conn = conn;
+	for (int i = 1; i < nconns; i++)
+	{
+		PGconn	   *fetchconn = PQconnectdb(connstr);
+
+		if (PQstatus(fetchconn) == CONNECTION_BAD)
+			pg_fatal("%s", PQerrorMessage(fetchconn));
+
+		init_libpq_conn(fetchconn);
+		src->conns[i].conn = fetchconn;
+	}
+	src->current = 0;
+
 	initStringInfo(&src->paths);
 	initStringInfo(&src->offsets);
 	initStringInfo(&src->lengths);
@@ -347,6 +385,7 @@ libpq_queue_fetch_range(rewind_source *source, const char *path, off_t off,
 						size_t len)
 {
 	libpq_source *src = (libpq_source *) source;
+	fetch_conn *fc = &src->conns[src->current];
 
 	/*
 	 * Does this request happen to be a continuation of the previous chunk? If
@@ -357,9 +396,9 @@ libpq_queue_fetch_range(rewind_source *source, const char *path, off_t off,
 	 * same filename. If it didn't, we would fail to merge requests, but it
 	 * wouldn't affect correctness.
 	 */
-	if (src->num_requests > 0)
+	if (fc->num_requests > 0)
 	{
-		fetch_range_request *prev = &src->request_queue[src->num_requests - 1];
+		fetch_range_request *prev = &fc->request_queue[fc->num_requests - 1];
 
 		if (prev->offset + prev->length == off &&
 			prev->length < MAX_CHUNK_SIZE &&
@@ -389,15 +428,18 @@ libpq_queue_fetch_range(rewind_source *source, const char *path, off_t off,
 	{
 		int32		thislen;
 
-		/* if the queue is full, perform all the work queued up so far */
-		if (src->num_requests == MAX_CHUNKS_PER_QUERY)
-			process_queued_fetch_requests(src);
+		/* if the queue is full, send the work queued up so far */
+		if (fc->num_requests == MAX_CHUNKS_PER_QUERY)
+		{
+			send_queued_fetch_requests(src);
+			fc = &src->conns[src->current];
+		}
 
 		thislen = Min(len, MAX_CHUNK_SIZE);
-		src->request_queue[src->num_requests].path = path;
-		src->request_queue[src->num_requests].offset = off;
-		src->request_queue[src->num_requests].length = thislen;
-		src->num_requests++;
+		fc->request_queue[fc->num_requests].path = path;
+		fc->request_queue[fc->num_requests].offset = off;
+		fc->request_queue[fc->num_requests].length = thislen;
+		fc->num_requests++;
 
 		off += thislen;
 		len -= thislen;
@@ -410,20 +452,35 @@ libpq_queue_fetch_range(rewind_source *source, const char *path, off_t off,
 static void
 libpq_finish_fetch(rewind_source *source)
 {
-	process_queued_fetch_requests((libpq_source *) source);
+	libpq_source *src = (libpq_source *) source;
+
+	send_queued_fetch_requests(src);
+
+	/* Process the results of all the queries sent, oldest first */
+	for (int i = 0; i < src->nconns; i++)
+	{
+		fetch_conn *fc = &src->conns[(src->current + i) % src->nconns];
+
+		if (fc->in_progress)
+			process_fetch_results(fc);
+	}
 }
 
+/*
+ * Send the query fetching the chunks queued on the current connection, and
+ * move on to the next connection.  If a query is still in progress on that
+ * one, it's the oldest one sent, so process its results first.
+ */
 static void
-process_queued_fetch_requests(libpq_source *src)
+send_queued_fetch_requests(libpq_source *src)
 {
+	fetch_conn *fc = &src->conns[src->current];
 	const char *params[3];
-	PGresult   *res;
-	int			chunkno;
 
-	if (src->num_requests == 0)
+	if (fc->num_requests == 0)
 		return;
 
-	pg_log_debug("getting %d file chunks", src->num_requests);
+	pg_log_debug("getting %d file chunks", fc->num_requests);
 
 	/*
 	 * The prepared statement, 'fetch_chunks_stmt', takes three arrays with
@@ -437,9 +494,9 @@ process_queued_fetch_requests(libpq_source *src)
 	appendStringInfoChar(&src->paths, '{');
 	appendStringInfoChar(&src->offsets, '{');
 	appendStringInfoChar(&src->lengths, '{');
-	for (int i = 0; i < src->num_requests; i++)
+	for (int i = 0; i < fc->num_requests; i++)
 	{
-		fetch_range_request *rq = &src->request_queue[i];
+		fetch_range_request *rq = &fc->request_queue[i];
 
 		if (i > 0)
 		{
@@ -463,12 +520,30 @@ process_queued_fetch_requests(libpq_source *src)
 	params[1] = src->offsets.data;
 	params[2] = src->lengths.data;
 
-	if (PQsendQueryPrepared(src->conn, "fetch_chunks_stmt", 3, params, NULL, NULL, 1) != 1)
-		pg_fatal("could not send query: %s", PQerrorMessage(src->conn));
+	if (PQsendQueryPrepared(fc->conn, "fetch_chunks_stmt", 3, params, NULL, NULL, 1) != 1)
+		pg_fatal("could not send query: %s", PQerrorMessage(fc->conn));
 
-	if (PQsetSingleRowMode(src->conn) != 1)
+	if (PQsetSingleRowMode(fc->conn) != 1)
 		pg_fatal("could not set libpq connection to single row mode");
 
+	fc->in_progress = true;
+
+	src->current = (src->current + 1) % src->nconns;
+	fc = &src->conns[src->current];
+	if (fc->in_progress)
+		process_fetch_results(fc);
+}
+
+/*
+ * Process the results of the query fetching the chunks queued on a
+ * connection, writing them to the target data directory.
+ */
+static void
+process_fetch_results(fetch_conn *fc)
+{
+	PGresult   *res;
+	int			chunkno;
+
 	/*----
 	 * The result set is of format:
 	 *
@@ -478,9 +553,9 @@ process_queued_fetch_requests(libpq_source *src)
 	 *----
 	 */
 	chunkno = 0;
-	while ((res = PQgetResult(src->conn)) != NULL)
+	while ((res = PQgetResult(fc->conn)) != NULL)
 	{
-		fetch_range_request *rq = &src->request_queue[chunkno];
+		fetch_range_request *rq = &fc->request_queue[chunkno];
 		char	   *filename;
 		int			filenamelen;
 		int64		chunkoff;
@@ -501,7 +576,7 @@ process_queued_fetch_requests(libpq_source *src)
 						 PQresultErrorMessage(res));
 		}
 
-		if (chunkno > src->num_requests)
+		if (chunkno > fc->num_requests)
 			pg_fatal("received more data chunks than requested");
 
 		/* sanity check the result set */
@@ -591,10 +666,11 @@ process_queued_fetch_requests(libpq_source *src)
 		PQclear(res);
 		chunkno++;
 	}
-	if (chunkno != src->num_requests)
+	if (chunkno != fc->num_requests)
 		pg_fatal("unexpected number of data chunks received");
 
-	src->num_requests = 0;
+	fc->num_requests = 0;
+	fc->in_progress = false;
 }
 
 /*
@@ -669,7 +745,13 @@ libpq_destroy(rewind_source *source)
 	pfree(src->paths.data);
 	pfree(src->offsets.data);
 	pfree(src->lengths.data);
-	pfree(src);
 
-	/* NOTE: we don't close the connection here, as it was not opened by us. */
+	/*
+	 * NOTE: we don't close the first connection here, as it was not opened
+	 * by us, but the others were.
+	 */
+	for (int i = 1; i < src->nconns; i++)
+		PQfinish(src->conns[i].conn);
+	pfree(src->conns);
+	pfree(src);
 }
@@ -9,6 +9,7 @@
  */
 #include "postgres_fe.h"
 
+#include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 
@@ -23,6 +24,21 @@ typedef struct
 	rewind_source common;		/* common interface functions */
 
 	const char *datadir;		/* path to the source data directory */
+
+	/*
+	 * Range requested with local_queue_fetch_range() but not copied yet.
+	 * Requests for adjacent ranges of the same file, like the consecutive
+	 * blocks of a relation, are merged into it, so that they are copied
+	 * with as few system calls as possible.  pending_len is 0 if there is
+	 * no such range.
+	 */
+	const char *pending_path;
+	off_t		pending_off;
+	size_t		pending_len;
+
+	/* source file currently open, kept open for the next range */
+	int			srcfd;
+	char		srcpath[MAXPGPATH];
 } local_source;
 
 static void local_traverse_files(rewind_source *source,
@@ -35,6 +51,8 @@ static void local_queue_fetch_range(rewind_source *source, const char *path,
 									off_t off, size_t len);
 static void local_finish_fetch(rewind_source *source);
 static void local_destroy(rewind_source *source);
+static void local_copy_pending_range(local_source *src);
+static void local_close_source_file(local_source *src);
 
 rewind_source *
 init_local_source(const char *datadir)
@@ -52,6 +70,7 @@ init_local_source(const char *datadir)
 	src->common.destroy = local_destroy;
 
 	src->datadir = datadir;
+	src->srcfd = -1;
 
 	return &src->common;
 }
@@ -76,108 +95,118 @@ local_fetch_file(rewind_source *source, const char *path, size_t *filesize)
 static void
 local_queue_fetch_file(rewind_source *source, const char *path, size_t len)
 {
-	const char *datadir = ((local_source *) source)->datadir;
-	PGAlignedBlock buf;
-	char		srcpath[MAXPGPATH];
-	int			srcfd;
-	size_t		written_len;
+	local_source *src = (local_source *) source;
+	struct stat st;
+
+	local_copy_pending_range(src);
+	local_close_source_file(src);
 
-	snprintf(srcpath, sizeof(srcpath), "%s/%s", datadir, path);
+	snprintf(src->srcpath, sizeof(src->srcpath), "%s/%s", src->datadir, path);
 
 	/* Open source file for reading */
-	srcfd = open(srcpath, O_RDONLY | PG_BINARY, 0);
-	if (srcfd < 0)
+	src->srcfd = open(src->srcpath, O_RDONLY | PG_BINARY, 0);
+	if (src->srcfd < 0)
 		pg_fatal("could not open source file \"%s\": %m",
-				 srcpath);
-
-	/* Truncate and open the target file for writing */
-	open_target_file(path, true);
-
-	written_len = 0;
-	for (;;)
-	{
-		ssize_t		read_len;
-
-		read_len = read(srcfd, buf.data, sizeof(buf));
-
-		if (read_len < 0)
-			pg_fatal("could not read file \"%s\": %m", srcpath);
-		else if (read_len == 0)
-			break;				/* EOF reached */
-
-		write_target_range(buf.data, written_len, read_len);
-		written_len += read_len;
-	}
+				 src->srcpath);
 
 	/*
 	 * A local source is not expected to change while we're rewinding, so
 	 * check that the size of the file matches our earlier expectation.
 	 */
-	if (written_len != len)
-		pg_fatal("size of source file \"%s\" changed concurrently: %d bytes expected, %d copied",
-				 srcpath, (int) len, (int) written_len);
+	if (fstat(src->srcfd, &st) != 0)
+		pg_fatal("could not stat file \"%s\": %m", src->srcpath);
+	if (st.st_size != len)
+		pg_fatal("size of source file \"%s\" changed concurrently: %d bytes expected, %d found",
+				 src->srcpath, (int) len, (int) st.st_size);
 
-	if (close(srcfd) != 0)
-		pg_fatal("could not close file \"%s\": %m", srcpath);
+	/* Truncate and open the target file for writing */
+	open_target_file(path, true);
+
+	copy_target_range(src->srcfd, src->srcpath, 0, len);
+
+	local_close_source_file(src);
 }
 
 /*
  * Copy a file from source to target, starting at 'off', for 'len' bytes.
+ *
+ * The range is only remembered here, and copied when a request that
+ * doesn't continue it comes in, or in local_finish_fetch().
  */
 static void
 local_queue_fetch_range(rewind_source *source, const char *path, off_t off,
 						size_t len)
 {
-	const char *datadir = ((local_source *) source)->datadir;
-	PGAlignedBlock buf;
-	char		srcpath[MAXPGPATH];
-	int			srcfd;
-	off_t		begin = off;
-	off_t		end = off + len;
+	local_source *src = (local_source *) source;
+
+	/* Does this request continue the pending one?  If so, merge them. */
+	if (src->pending_len > 0 &&
+		src->pending_path == path &&
+		src->pending_off + src->pending_len == off)
+	{
+		src->pending_len += len;
+		return;
+	}
 
-	snprintf(srcpath, sizeof(srcpath), "%s/%s", datadir, path);
+	local_copy_pending_range(src);
 
-	srcfd = open(srcpath, O_RDONLY | PG_BINARY, 0);
-	if (srcfd < 0)
-		pg_fatal("could not open source file \"%s\": %m",
-				 srcpath);
+	src->pending_path = path;
+	src->pending_off = off;
+	src->pending_len = len;
+}
+
+/*
+ * Copy the range remembered by local_queue_fetch_range(), if any.
+ */
+static void
+local_copy_pending_range(local_source *src)
+{
+	char		srcpath[MAXPGPATH];
 
-	if (lseek(srcfd, begin, SEEK_SET) == -1)
-		pg_fatal("could not seek in source file: %m");
+	if (src->pending_len == 0)
+		return;
 
-	open_target_file(path, false);
+	snprintf(srcpath, sizeof(srcpath), "%s/%s", src->datadir,
+			 src->pending_path);
 
-	while (end - begin > 0)
+	/* The source file is often still open from the previous range */
+	if (src->srcfd < 0 || strcmp(srcpath, src->srcpath) != 0)
 	{
-		ssize_t		readlen;
-		size_t		thislen;
+		local_close_source_file(src);
 
-		if (end - begin > sizeof(buf))
-			thislen = sizeof(buf);
-		else
-			thislen = end - begin;
+		strlcpy(src->srcpath, srcpath, sizeof(src->srcpath));
+		src->srcfd = open(src->srcpath, O_RDONLY | PG_BINARY, 0);
+		if (src->srcfd < 0)
+			pg_fatal("could not open source file \"%s\": %m",
+					 src->srcpath);
+	}
 
-		readlen = read(srcfd, buf.data, thislen);
+	open_target_file(src->pending_path, false);
 
-		if (readlen < 0)
-			pg_fatal("could not read file \"%s\": %m", srcpath);
-		else if (readlen == 0)
-			pg_fatal("unexpected EOF while reading file \"%s\"", srcpath);
+	copy_target_range(src->srcfd, src->srcpath, src->pending_off,
+					  src->pending_len);
 
-		write_target_range(buf.data, begin, readlen);
-		begin += readlen;
-	}
+	src->pending_len = 0;
+}
 
-	if (close(srcfd) != 0)
-		pg_fatal("could not close file \"%s\": %m", srcpath);
+static void
+local_close_source_file(local_source *src)
+{
+	if (src->srcfd < 0)
+		return;
+
+	if (close(src->srcfd) != 0)
+		pg_fatal("could not close file \"%s\": %m", src->srcpath);
+	src->srcfd = -1;
 }
 
 static void
 local_finish_fetch(rewind_source *source)
 {
-	/*
-	 * Nothing to do, local_queue_fetch_range() copies the ranges immediately.
-	 */
+	local_source *src = (local_source *) source;
+
+	local_copy_pending_range(src);
+	local_close_source_file(src);
 }
 
 static void
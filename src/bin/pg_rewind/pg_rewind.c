@@ -22,6 +22,7 @@
 #include "common/file_perm.h"
 #include "common/restricted_token.h"
 #include "common/string.h"
+#include "fe_utils/option_utils.h"
 #include "fe_utils/recovery_gen.h"
 #include "fe_utils/string_utils.h"
 #include "file_ops.h"
@@ -70,6 +71,7 @@ char	   *restore_command = NULL;
 char	   *config_file = NULL;
 
 static bool debug = false;
+static int	num_jobs = 1;
 bool		showprogress = false;
 bool		dry_run = false;
 bool		do_sync = true;
@@ -95,6 +97,8 @@ usage(const char *progname)
 	printf(_("  -c, --restore-target-wal       use restore_command in target configuration to\n"
 			 "                                 retrieve WAL files from archives\n"));
 	printf(_("  -D, --target-pgdata=DIRECTORY  existing data directory to modify\n"));
+	printf(_("  -j, --jobs=NUM                 use this many connections to fetch data\n"
+			 "                                 from the source server\n"));
 	printf(_("      --source-pgdata=DIRECTORY  source data directory to synchronize with\n"));
 	printf(_("      --source-server=CONNSTR    source server to synchronize with\n"));
 	printf(_("  -n, --dry-run                  stop before modifying anything\n"));
@@ -120,6 +124,7 @@ main(int argc, char **argv)
 	static struct option long_options[] = {
 		{"help", no_argument, NULL, '?'},
 		{"target-pgdata", required_argument, NULL, 'D'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"write-recovery-conf", no_argument, NULL, 'R'},
 		{"source-pgdata", required_argument, NULL, 1},
 		{"source-server", required_argument, NULL, 2},
@@ -169,7 +174,7 @@ main(int argc, char **argv)
 		}
 	}
 
-	while ((c = getopt_long(argc, argv, "cD:nNPR", long_options, &option_index)) != -1)
+	while ((c = getopt_long(argc, argv, "cD:j:nNPR", long_options, &option_index)) != -1)
 	{
 		switch (c)
 		{
@@ -202,6 +207,12 @@ main(int argc, char **argv)
 				datadir_target = pg_strdup(optarg);
 				break;
 
+			case 'j':
+				if (!option_parse_int(optarg, "-j/--jobs", 1, 64,
+									  &num_jobs))
+					exit(1);
+				break;
+
 			case 1:				/* --source-pgdata */
 				datadir_source = pg_strdup(optarg);
 				break;
@@ -253,6 +264,13 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (num_jobs > 1 && connstr_source == NULL)
+	{
+		pg_log_error("no source server information (--source-server) specified for --jobs");
+		pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+		exit(1);
+	}
+
 	if (optind < argc)
 	{
 		pg_log_error("too many command-line arguments (first is \"%s\")",
@@ -304,7 +322,7 @@ main(int argc, char **argv)
 		if (showprogress)
 			pg_log_info("connected to server");
 
-		source = init_libpq_source(conn);
+		source = init_libpq_source(conn, connstr_source, num_jobs);
 	}
 	else
 		source = init_local_source(datadir_source);
@@ -78,7 +78,8 @@ typedef struct rewind_source
 } rewind_source;
 
 /* in libpq_source.c */
-extern rewind_source *init_libpq_source(PGconn *conn);
+extern rewind_source *init_libpq_source(PGconn *conn, const char *connstr,
+										int nconns);
 
 /* in local_source.c */
 extern rewind_source *init_local_source(const char *datadir);
@@ -266,13 +266,15 @@ sub run_pg_rewind
 	elsif ($test_mode eq "remote")
 	{
 		# Do rewind using a remote connection as source, generating
-		# recovery configuration automatically.
+		# recovery configuration automatically.  Use several connections
+		# to fetch the data.
 		command_ok(
 			[
 				'pg_rewind',                       "--debug",
 				"--source-server",                 $standby_connstr,
 				"--target-pgdata=$primary_pgdata", "--no-sync",
-				"--write-recovery-conf",           "--config-file",
+				"--write-recovery-conf",           "--jobs=2",
+				"--config-file",
 				"$tmp_folder/primary-postgresql.conf.tmp"
 			],
 			'pg_rewind remote');
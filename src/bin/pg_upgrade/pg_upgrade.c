@@ -422,6 +422,7 @@ static void
 create_new_objects(void)
 {
 	int			dbnum;
+	int			restore_jobs;
 
 	prep_status_progress("Restoring database schemas in the new cluster");
 
@@ -467,6 +468,16 @@ create_new_objects(void)
 		break;					/* done once we've processed template1 */
 	}
 
+	/*
+	 * The remaining databases are restored concurrently.  If there are more
+	 * jobs than databases, let each pg_restore use the spare ones, so that
+	 * the indexes and constraints of a single large database are created in
+	 * parallel too.
+	 */
+	restore_jobs = 1;
+	if (user_opts.jobs > 1 && old_cluster.dbarr.ndbs > 1)
+		restore_jobs = Max(1, user_opts.jobs / (old_cluster.dbarr.ndbs - 1));
+
 	for (dbnum = 0; dbnum < old_cluster.dbarr.ndbs; dbnum++)
 	{
 		char		sql_file_name[MAXPGPATH],
@@ -495,10 +506,11 @@ create_new_objects(void)
 		parallel_exec_prog(log_file_name,
 						   NULL,
 						   "\"%s/pg_restore\" %s %s --exit-on-error --verbose "
-						   "--dbname template1 \"%s/%s\"",
+						   "--jobs=%d --dbname template1 \"%s/%s\"",
 						   new_cluster.bindir,
 						   cluster_conn_opts(&new_cluster),
 						   create_opts,
+						   restore_jobs,
 						   log_opts.dumpdir,
 						   sql_file_name);
 	}
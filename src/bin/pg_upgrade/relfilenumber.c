@@ -15,7 +15,8 @@
 #include "catalog/pg_class_d.h"
 #include "pg_upgrade.h"
 
-static void transfer_single_new_db(FileNameMap *maps, int size, char *old_tablespace);
+static void transfer_single_new_db(FileNameMap *maps, int size, char *old_tablespace,
+								   int part, int nparts);
 static void transfer_relfile(FileNameMap *map, const char *type_suffix, bool vm_must_add_frozenbit);
 
 
@@ -47,25 +48,32 @@ transfer_all_new_tablespaces(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
 	 * can use multiple tablespaces.  For non-parallel mode, we just pass a
 	 * NULL tablespace path, which matches all tablespaces.  In parallel mode,
 	 * we pass the default tablespace and all user-created tablespaces and let
-	 * those operations happen in parallel.
+	 * those operations happen in parallel.  The files of each tablespace are
+	 * further split into as many parts as there are jobs, so that a cluster
+	 * with a single tablespace is transferred in parallel too.
 	 */
 	if (user_opts.jobs <= 1)
 		parallel_transfer_all_new_dbs(old_db_arr, new_db_arr, old_pgdata,
-									  new_pgdata, NULL);
+									  new_pgdata, NULL, 0, 1);
 	else
 	{
 		int			tblnum;
+		int			part;
 
 		/* transfer default tablespace */
-		parallel_transfer_all_new_dbs(old_db_arr, new_db_arr, old_pgdata,
-									  new_pgdata, old_pgdata);
+		for (part = 0; part < user_opts.jobs; part++)
+			parallel_transfer_all_new_dbs(old_db_arr, new_db_arr, old_pgdata,
+										  new_pgdata, old_pgdata,
+										  part, user_opts.jobs);
 
 		for (tblnum = 0; tblnum < os_info.num_old_tablespaces; tblnum++)
-			parallel_transfer_all_new_dbs(old_db_arr,
-										  new_db_arr,
-										  old_pgdata,
-										  new_pgdata,
-										  os_info.old_tablespaces[tblnum]);
+			for (part = 0; part < user_opts.jobs; part++)
+				parallel_transfer_all_new_dbs(old_db_arr,
+											  new_db_arr,
+											  old_pgdata,
+											  new_pgdata,
+											  os_info.old_tablespaces[tblnum],
+											  part, user_opts.jobs);
 		/* reap all children */
 		while (reap_child(true) == true)
 			;
@@ -81,10 +89,14 @@ transfer_all_new_tablespaces(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
  *
  * Responsible for upgrading all database. invokes routines to generate mappings and then
  * physically link the databases.
+ *
+ * Only the relations whose relfilenumber modulo nparts is part are
+ * transferred, so that several calls can share the work.
  */
 void
 transfer_all_new_dbs(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
-					 char *old_pgdata, char *new_pgdata, char *old_tablespace)
+					 char *old_pgdata, char *new_pgdata, char *old_tablespace,
+					 int part, int nparts)
 {
 	int			old_dbnum,
 				new_dbnum;
@@ -119,7 +131,8 @@ transfer_all_new_dbs(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
 									new_pgdata);
 		if (n_maps)
 		{
-			transfer_single_new_db(mappings, n_maps, old_tablespace);
+			transfer_single_new_db(mappings, n_maps, old_tablespace,
+								   part, nparts);
 		}
 		/* We allocate something even for n_maps == 0 */
 		pg_free(mappings);
@@ -132,7 +145,8 @@ transfer_all_new_dbs(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
  * create links for mappings stored in "maps" array.
  */
 static void
-transfer_single_new_db(FileNameMap *maps, int size, char *old_tablespace)
+transfer_single_new_db(FileNameMap *maps, int size, char *old_tablespace,
+					   int part, int nparts)
 {
 	int			mapnum;
 	bool		vm_must_add_frozenbit = false;
@@ -146,6 +160,9 @@ transfer_single_new_db(FileNameMap *maps, int size, char *old_tablespace)
 
 	for (mapnum = 0; mapnum < size; mapnum++)
 	{
+		if (maps[mapnum].relfilenumber % nparts != part)
+			continue;
+
 		if (old_tablespace == NULL ||
 			strcmp(maps[mapnum].old_tablespace, old_tablespace) == 0)
 		{
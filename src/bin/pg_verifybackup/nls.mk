@@ -3,6 +3,10 @@ CATALOG_NAME     = pg_verifybackup
 GETTEXT_FILES    = $(FRONTEND_COMMON_GETTEXT_FILES) \
                    parse_manifest.c \
                    pg_verifybackup.c \
+                   ../pg_basebackup/bbstreamer_gzip.c \
+                   ../pg_basebackup/bbstreamer_lz4.c \
+                   ../pg_basebackup/bbstreamer_tar.c \
+                   ../pg_basebackup/bbstreamer_zstd.c \
                    ../../common/fe_memutils.c \
                    ../../common/jsonapi.c
 GETTEXT_TRIGGERS = $(FRONTEND_COMMON_GETTEXT_TRIGGERS) \
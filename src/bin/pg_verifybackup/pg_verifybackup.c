@@ -15,16 +15,45 @@
 
 #include <dirent.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <sys/stat.h>
 #include <time.h>
 
+#include "bbstreamer.h"
 #include "common/hashfn.h"
 #include "common/logging.h"
+#include "fe_utils/option_utils.h"
 #include "fe_utils/simple_list.h"
 #include "getopt_long.h"
 #include "parse_manifest.h"
 #include "pgtime.h"
 
+#ifdef WIN32
+/* Use Windows threads */
+#include <windows.h>
+#define GETERRNO() (_dosmaperr(GetLastError()), errno)
+#define THREAD_T HANDLE
+#define THREAD_FUNC_RETURN_TYPE unsigned
+#define THREAD_FUNC_RETURN return 0
+#define THREAD_FUNC_CC __stdcall
+#define THREAD_CREATE(handle, function, arg) \
+	((*(handle) = (HANDLE) _beginthreadex(NULL, 0, (function), (arg), 0, NULL)) == 0 ? errno : 0)
+#define THREAD_JOIN(handle) \
+	(WaitForSingleObject(handle, INFINITE) != WAIT_OBJECT_0 ? \
+	GETERRNO() : CloseHandle(handle) ? 0 : GETERRNO())
+#else
+/* Use POSIX threads */
+#include "port/pg_pthread.h"
+#define THREAD_T pthread_t
+#define THREAD_FUNC_RETURN_TYPE void *
+#define THREAD_FUNC_RETURN return NULL
+#define THREAD_FUNC_CC
+#define THREAD_CREATE(handle, function, arg) \
+	pthread_create((handle), NULL, (function), (arg))
+#define THREAD_JOIN(handle) \
+	pthread_join((handle), NULL)
+#endif
+
 /*
  * For efficiency, we'd like our hash table containing information about the
  * manifest to start out with approximately the correct number of entries.
@@ -115,6 +144,59 @@ typedef struct verifier_context
 	bool		saw_any_error;
 } verifier_context;
 
+/*
+ * Format of the backup being verified: a directory with the files of the
+ * data directory, or a directory with a tar archive for the data directory
+ * and one for each tablespace, as written by pg_basebackup -Ft.
+ */
+typedef enum backup_format
+{
+	BACKUP_FORMAT_UNKNOWN,
+	BACKUP_FORMAT_PLAIN,
+	BACKUP_FORMAT_TAR
+} backup_format;
+
+/*
+ * The expensive part of the verification is divided into tasks, which are
+ * run by one or more worker threads.  For a plain-format backup, each task
+ * is to verify the checksum of one file.  For a tar-format backup, each task
+ * is to read one archive, and check the size and checksum of each file in it.
+ */
+typedef struct verify_task
+{
+	manifest_file *m;			/* file to checksum, or NULL for an archive */
+	char	   *archive_name;	/* file name of the archive */
+	char	   *archive_prefix; /* prefix of the paths of its members */
+	pg_compress_algorithm compress_algo;	/* compression of the archive */
+	uint64		size;			/* number of bytes to read */
+	int			worker;			/* index of the worker running the task */
+} verify_task;
+
+typedef struct verify_worker
+{
+	THREAD_T	thread;
+	verifier_context *context;
+	uint64		assigned_size;
+	uint64		done_size;		/* for progress reporting */
+	volatile bool done;
+} verify_worker;
+
+/*
+ * A bbstreamer that checks the members of a tar archive against the
+ * manifest.  It receives the archive parsed by a tar parser.
+ */
+typedef struct verify_streamer
+{
+	bbstreamer	base;
+	verifier_context *context;
+	char	   *archive_name;
+	char	   *archive_prefix;
+	char	   *relpath;		/* path of the current member, if checked */
+	manifest_file *m;			/* manifest entry of the current member */
+	bool		verify_checksum;
+	pg_checksum_context checksum_ctx;
+} verify_streamer;
+
 static void parse_manifest_file(char *manifest_path,
 								manifest_files_hash **ht_p,
 								manifest_wal_range **first_wal_range_p);
@@ -136,10 +218,29 @@ static void verify_backup_directory(verifier_context *context,
 									char *relpath, char *fullpath);
 static void verify_backup_file(verifier_context *context,
 							   char *relpath, char *fullpath);
+static void verify_tar_backup(verifier_context *context);
 static void report_extra_backup_files(verifier_context *context);
 static void verify_backup_checksums(verifier_context *context);
 static void verify_file_checksum(verifier_context *context,
-								 manifest_file *m, char *fullpath);
+								 manifest_file *m, char *fullpath,
+								 verify_worker *worker);
+static void verify_checksum_final(verifier_context *context, manifest_file *m,
+								  pg_checksum_context *checksum_ctx);
+static void verify_tar_archive(verifier_context *context, verify_task *task,
+							   verify_worker *worker);
+static bbstreamer *verify_streamer_new(verifier_context *context,
+									   char *archive_name,
+									   char *archive_prefix);
+static void verify_streamer_content(bbstreamer *streamer,
+									bbstreamer_member *member,
+									const char *data, int len,
+									bbstreamer_archive_context context);
+static void verify_streamer_finalize(bbstreamer *streamer);
+static void verify_streamer_free(bbstreamer *streamer);
+static void add_verify_task(manifest_file *m, char *archive_name,
+							char *archive_prefix,
+							pg_compress_algorithm compress_algo, uint64 size);
+static void run_verify_tasks(verifier_context *context);
 static void parse_required_wal(verifier_context *context,
 							   char *pg_waldump_path,
 							   char *wal_directory,
@@ -160,10 +261,22 @@ static const char *progname;
 /* options */
 static bool show_progress = false;
 static bool skip_checksums = false;
+static int	num_jobs = 1;
 
 /* Progress indicators */
 static uint64 total_size = 0;
-static uint64 done_size = 0;
+
+/* Tasks and the workers running them, see run_verify_tasks() */
+static verify_task *tasks = NULL;
+static int	num_tasks = 0;
+static int	max_tasks = 0;
+static verify_worker *workers = NULL;
+
+static const bbstreamer_ops verify_streamer_ops = {
+	.content = verify_streamer_content,
+	.finalize = verify_streamer_finalize,
+	.free = verify_streamer_free
+};
 
 /*
  * Main entry point.
@@ -173,7 +286,9 @@ main(int argc, char **argv)
 {
 	static struct option long_options[] = {
 		{"exit-on-error", no_argument, NULL, 'e'},
+		{"format", required_argument, NULL, 'F'},
 		{"ignore", required_argument, NULL, 'i'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"manifest-path", required_argument, NULL, 'm'},
 		{"no-parse-wal", no_argument, NULL, 'n'},
 		{"progress", no_argument, NULL, 'P'},
@@ -187,6 +302,7 @@ main(int argc, char **argv)
 	verifier_context context;
 	manifest_wal_range *first_wal_range;
 	char	   *manifest_path = NULL;
+	backup_format format = BACKUP_FORMAT_UNKNOWN;
 	bool		no_parse_wal = false;
 	bool		quiet = false;
 	char	   *wal_directory = NULL;
@@ -233,13 +349,22 @@ main(int argc, char **argv)
 	simple_string_list_append(&context.ignore_list, "recovery.signal");
 	simple_string_list_append(&context.ignore_list, "standby.signal");
 
-	while ((c = getopt_long(argc, argv, "ei:m:nPqsw:", long_options, NULL)) != -1)
+	while ((c = getopt_long(argc, argv, "eF:i:j:m:nPqsw:", long_options, NULL)) != -1)
 	{
 		switch (c)
 		{
 			case 'e':
 				context.exit_on_error = true;
 				break;
+			case 'F':
+				if (strcmp(optarg, "p") == 0 || strcmp(optarg, "plain") == 0)
+					format = BACKUP_FORMAT_PLAIN;
+				else if (strcmp(optarg, "t") == 0 || strcmp(optarg, "tar") == 0)
+					format = BACKUP_FORMAT_TAR;
+				else
+					pg_fatal("invalid backup format \"%s\", must be \"plain\" or \"tar\"",
+							 optarg);
+				break;
 			case 'i':
 				{
 					char	   *arg = pstrdup(optarg);
@@ -248,6 +373,11 @@ main(int argc, char **argv)
 					simple_string_list_append(&context.ignore_list, arg);
 					break;
 				}
+			case 'j':
+				if (!option_parse_int(optarg, "-j/--jobs", 1, INT_MAX,
+									  &num_jobs))
+					exit(1);
+				break;
 			case 'm':
 				manifest_path = pstrdup(optarg);
 				canonicalize_path(manifest_path);
@@ -299,6 +429,36 @@ main(int argc, char **argv)
 		pg_fatal("cannot specify both %s and %s",
 				 "-P/--progress", "-q/--quiet");
 
+	/*
+	 * Unless told otherwise, assume that the backup is in plain format if it
+	 * has the PG_VERSION file of the data directory, and in tar format if
+	 * not.
+	 */
+	if (format == BACKUP_FORMAT_UNKNOWN)
+	{
+		char	   *path = psprintf("%s/PG_VERSION", context.backup_directory);
+		struct stat sb;
+
+		if (stat(path, &sb) == 0)
+			format = BACKUP_FORMAT_PLAIN;
+		else if (errno == ENOENT)
+			format = BACKUP_FORMAT_TAR;
+		else
+			pg_fatal("could not stat file \"%s\": %m", path);
+		pfree(path);
+	}
+
+	/*
+	 * pg_waldump cannot read WAL from a tar archive, so the WAL of a
+	 * tar-format backup can only be parsed if it has been extracted.
+	 */
+	if (format == BACKUP_FORMAT_TAR && !no_parse_wal && wal_directory == NULL)
+	{
+		pg_log_error("pg_waldump cannot read tar files");
+		pg_log_error_hint("You must use -n/--no-parse-wal, or -w/--wal-directory to specify the extracted WAL files, when verifying a tar-format backup.");
+		exit(1);
+	}
+
 	/* Unless --no-parse-wal was specified, we will need pg_waldump. */
 	if (!no_parse_wal)
 	{
@@ -340,27 +500,40 @@ main(int argc, char **argv)
 	 */
 	parse_manifest_file(manifest_path, &context.ht, &first_wal_range);
 
-	/*
-	 * Now scan the files in the backup directory. At this stage, we verify
-	 * that every file on disk is present in the manifest and that the sizes
-	 * match. We also set the "matched" flag on every manifest entry that
-	 * corresponds to a file on disk.
-	 */
-	verify_backup_directory(&context, NULL, context.backup_directory);
+	if (format == BACKUP_FORMAT_PLAIN)
+	{
+		/*
+		 * Now scan the files in the backup directory. At this stage, we
+		 * verify that every file on disk is present in the manifest and that
+		 * the sizes match. We also set the "matched" flag on every manifest
+		 * entry that corresponds to a file on disk.
+		 */
+		verify_backup_directory(&context, NULL, context.backup_directory);
 
-	/*
-	 * The "matched" flag should now be set on every entry in the hash table.
-	 * Any entries for which the bit is not set are files mentioned in the
-	 * manifest that don't exist on disk.
-	 */
-	report_extra_backup_files(&context);
+		/*
+		 * The "matched" flag should now be set on every entry in the hash
+		 * table. Any entries for which the bit is not set are files mentioned
+		 * in the manifest that don't exist on disk.
+		 */
+		report_extra_backup_files(&context);
 
-	/*
-	 * Now do the expensive work of verifying file checksums, unless we were
-	 * told to skip it.
-	 */
-	if (!skip_checksums)
-		verify_backup_checksums(&context);
+		/*
+		 * Now do the expensive work of verifying file checksums, unless we
+		 * were told to skip it.
+		 */
+		if (!skip_checksums)
+			verify_backup_checksums(&context);
+	}
+	else
+	{
+		/*
+		 * The archives have to be read in full to find out which files they
+		 * contain, so check the sizes and checksums of the files in the same
+		 * pass.  Only then can we tell which files are missing.
+		 */
+		verify_tar_backup(&context);
+		report_extra_backup_files(&context);
+	}
 
 	/*
 	 * Try to parse the required ranges of WAL records, unless we were told
@@ -660,10 +833,6 @@ verify_backup_file(verifier_context *context, char *relpath, char *fullpath)
 		m->bad = true;
 	}
 
-	/* Update statistics for progress report, if necessary */
-	if (show_progress && !skip_checksums && should_verify_checksum(m))
-		total_size += m->size;
-
 	/*
 	 * We don't verify checksums at this stage. We first finish verifying that
 	 * we have the expected set of files with the expected sizes, and only
@@ -701,26 +870,257 @@ verify_backup_checksums(verifier_context *context)
 	manifest_files_iterator it;
 	manifest_file *m;
 
-	progress_report(false);
-
 	manifest_files_start_iterate(context->ht, &it);
 	while ((m = manifest_files_iterate(context->ht, &it)) != NULL)
 	{
 		if (should_verify_checksum(m) &&
 			!should_ignore_relpath(context, m->pathname))
+			add_verify_task(m, NULL, NULL, PG_COMPRESSION_NONE, m->size);
+	}
+
+	run_verify_tasks(context);
+}
+
+/*
+ * Verify a tar-format backup.  Each file in the backup directory should be
+ * the manifest, or a tar archive, possibly compressed.  base.tar contains the
+ * data directory, and <oid>.tar the tablespace with that OID.  pg_wal.tar
+ * contains WAL, which is not listed in the manifest, so it's skipped.
+ */
+static void
+verify_tar_backup(verifier_context *context)
+{
+	char	   *fullpath = context->backup_directory;
+	DIR		   *dir;
+	struct dirent *dirent;
+
+	dir = opendir(fullpath);
+	if (dir == NULL)
+		report_fatal_error("could not open directory \"%s\": %m", fullpath);
+
+	while (errno = 0, (dirent = readdir(dir)) != NULL)
+	{
+		char	   *filename = dirent->d_name;
+		char	   *newfullpath;
+		char	   *suffix;
+		int			namelen;
+		char	   *prefix = NULL;
+		pg_compress_algorithm compress_algo = PG_COMPRESSION_NONE;
+		struct stat sb;
+
+		/* Skip "." and "..", and the manifest */
+		if (strcmp(filename, ".") == 0 || strcmp(filename, "..") == 0 ||
+			strcmp(filename, "backup_manifest") == 0)
+			continue;
+
+		/* Find out the compression of the archive from its file name */
+		suffix = strstr(filename, ".tar");
+		if (suffix != NULL)
+		{
+			if (strcmp(suffix, ".tar.gz") == 0)
+				compress_algo = PG_COMPRESSION_GZIP;
+			else if (strcmp(suffix, ".tar.lz4") == 0)
+				compress_algo = PG_COMPRESSION_LZ4;
+			else if (strcmp(suffix, ".tar.zst") == 0)
+				compress_algo = PG_COMPRESSION_ZSTD;
+			else if (strcmp(suffix, ".tar") != 0)
+				suffix = NULL;
+		}
+
+		/* The rest of the name tells what the archive contains */
+		if (suffix != NULL)
+		{
+			namelen = suffix - filename;
+			if (namelen == strlen("pg_wal") &&
+				strncmp(filename, "pg_wal", namelen) == 0)
+				continue;
+			else if (namelen == strlen("base") &&
+					 strncmp(filename, "base", namelen) == 0)
+				prefix = pstrdup("");
+			else if (namelen > 0 &&
+					 strspn(filename, "0123456789") == namelen)
+				prefix = psprintf("pg_tblspc/%.*s/", namelen, filename);
+		}
+
+		if (prefix == NULL)
+		{
+			report_backup_error(context,
+								"\"%s\" is not a valid file name for an archive of a tar-format backup",
+								filename);
+			continue;
+		}
+
+		newfullpath = psprintf("%s/%s", fullpath, filename);
+		if (stat(newfullpath, &sb) != 0)
+			report_backup_error(context,
+								"could not stat file \"%s\": %m", filename);
+		else if (!S_ISREG(sb.st_mode))
+			report_backup_error(context,
+								"\"%s\" is not a plain file", filename);
+		else
+			add_verify_task(NULL, pstrdup(filename), prefix, compress_algo,
+							sb.st_size);
+		pfree(newfullpath);
+	}
+
+	if (closedir(dir))
+		report_backup_error(context,
+							"could not close directory \"%s\": %m", fullpath);
+
+	run_verify_tasks(context);
+}
+
+/*
+ * Remember a task, to be run by run_verify_tasks().
+ */
+static void
+add_verify_task(manifest_file *m, char *archive_name, char *archive_prefix,
+				pg_compress_algorithm compress_algo, uint64 size)
+{
+	verify_task *task;
+
+	if (num_tasks == max_tasks)
+	{
+		max_tasks = Max(max_tasks * 2, 1024);
+		tasks = pg_realloc(tasks, max_tasks * sizeof(verify_task));
+	}
+
+	task = &tasks[num_tasks++];
+	task->m = m;
+	task->archive_name = archive_name;
+	task->archive_prefix = archive_prefix;
+	task->compress_algo = compress_algo;
+	task->size = size;
+	task->worker = 0;
+}
+
+/* qsort comparator for verify_task, largest first */
+static int
+verify_task_cmp(const void *a, const void *b)
+{
+	const verify_task *ta = (const verify_task *) a;
+	const verify_task *tb = (const verify_task *) b;
+
+	if (ta->size > tb->size)
+		return -1;
+	if (ta->size < tb->size)
+		return 1;
+	return 0;
+}
+
+static THREAD_FUNC_RETURN_TYPE THREAD_FUNC_CC
+verify_worker_main(void *arg)
+{
+	verify_worker *worker = (verify_worker *) arg;
+	verifier_context *context = worker->context;
+	int			workerno = worker - workers;
+	int			i;
+
+	for (i = 0; i < num_tasks; i++)
+	{
+		verify_task *task = &tasks[i];
+
+		if (task->worker != workerno)
+			continue;
+
+		if (task->m != NULL)
 		{
 			char	   *fullpath;
 
 			/* Compute the full pathname to the target file. */
 			fullpath = psprintf("%s/%s", context->backup_directory,
-								m->pathname);
+								task->m->pathname);
 
 			/* Do the actual checksum verification. */
-			verify_file_checksum(context, m, fullpath);
+			verify_file_checksum(context, task->m, fullpath, worker);
 
 			/* Avoid leaking memory. */
 			pfree(fullpath);
 		}
+		else
+			verify_tar_archive(context, task, worker);
+	}
+
+	worker->done = true;
+
+	THREAD_FUNC_RETURN;
+}
+
+/*
+ * Run the tasks collected by add_verify_task() using num_jobs threads, or in
+ * this thread if there is only one job.
+ *
+ * Each task goes to the worker with the least data assigned so far, taking
+ * the largest tasks first, so that the workers finish at about the same
+ * time.
+ */
+static void
+run_verify_tasks(verifier_context *context)
+{
+	int			i;
+
+	qsort(tasks, num_tasks, sizeof(verify_task), verify_task_cmp);
+
+	workers = pg_malloc0(num_jobs * sizeof(verify_worker));
+	for (i = 0; i < num_jobs; i++)
+		workers[i].context = context;
+
+	for (i = 0; i < num_tasks; i++)
+	{
+		int			best = 0;
+		int			j;
+
+		for (j = 1; j < num_jobs; j++)
+		{
+			if (workers[j].assigned_size < workers[best].assigned_size)
+				best = j;
+		}
+		tasks[i].worker = best;
+		workers[best].assigned_size += tasks[i].size;
+		total_size += tasks[i].size;
+	}
+
+	progress_report(false);
+
+	if (num_jobs == 1)
+	{
+		(void) verify_worker_main(&workers[0]);
+		progress_report(true);
+		return;
+	}
+
+	for (i = 0; i < num_jobs; i++)
+	{
+		errno = THREAD_CREATE(&workers[i].thread, verify_worker_main,
+							  &workers[i]);
+		if (errno != 0)
+			pg_fatal("could not create thread: %m");
+	}
+
+	if (show_progress)
+	{
+		for (;;)
+		{
+			bool		all_done = true;
+
+			for (i = 0; i < num_jobs; i++)
+			{
+				if (!workers[i].done)
+					all_done = false;
+			}
+			if (all_done)
+				break;
+
+			progress_report(false);
+			pg_usleep(100000L);
+		}
+	}
+
+	for (i = 0; i < num_jobs; i++)
+	{
+		errno = THREAD_JOIN(workers[i].thread);
+		if (errno != 0)
+			pg_fatal("could not join thread: %m");
 	}
 
 	progress_report(true);
@@ -731,7 +1131,7 @@ verify_backup_checksums(verifier_context *context)
  */
 static void
 verify_file_checksum(verifier_context *context, manifest_file *m,
-					 char *fullpath)
+					 char *fullpath, verify_worker *worker)
 {
 	pg_checksum_context checksum_ctx;
 	char	   *relpath = m->pathname;
@@ -739,8 +1139,6 @@ verify_file_checksum(verifier_context *context, manifest_file *m,
 	int			rc;
 	size_t		bytes_read = 0;
 	uint8		buffer[READ_CHUNK_SIZE];
-	uint8		checksumbuf[PG_CHECKSUM_MAX_LENGTH];
-	int			checksumlen;
 
 	/* Open the target file. */
 	if ((fd = open(fullpath, O_RDONLY | PG_BINARY, 0)) < 0)
@@ -771,9 +1169,10 @@ verify_file_checksum(verifier_context *context, manifest_file *m,
 			return;
 		}
 
-		/* Report progress */
-		done_size += rc;
-		progress_report(false);
+		/* Report progress, unless the main thread does it */
+		worker->done_size += rc;
+		if (num_jobs == 1)
+			progress_report(false);
 	}
 	if (rc < 0)
 		report_backup_error(context, "could not read file \"%s\": %m",
@@ -806,8 +1205,23 @@ verify_file_checksum(verifier_context *context, manifest_file *m,
 		return;
 	}
 
+	verify_checksum_final(context, m, &checksum_ctx);
+}
+
+/*
+ * Finish computing the checksum of a file, and check it against the
+ * manifest.
+ */
+static void
+verify_checksum_final(verifier_context *context, manifest_file *m,
+					  pg_checksum_context *checksum_ctx)
+{
+	char	   *relpath = m->pathname;
+	uint8		checksumbuf[PG_CHECKSUM_MAX_LENGTH];
+	int			checksumlen;
+
 	/* Get the final checksum. */
-	checksumlen = pg_checksum_final(&checksum_ctx, checksumbuf);
+	checksumlen = pg_checksum_final(checksum_ctx, checksumbuf);
 	if (checksumlen < 0)
 	{
 		report_backup_error(context,
@@ -827,6 +1241,217 @@ verify_file_checksum(verifier_context *context, manifest_file *m,
 							relpath);
 }
 
+/*
+ * Verify the files in one archive of a tar-format backup.
+ *
+ * The archive is decompressed and parsed as it's read, and the files in it
+ * are checked by a verify_streamer, so nothing is written to disk.
+ */
+static void
+verify_tar_archive(verifier_context *context, verify_task *task,
+				   verify_worker *worker)
+{
+	char	   *fullpath;
+	bbstreamer *streamer;
+	int			fd;
+	int			rc;
+	char		buffer[READ_CHUNK_SIZE];
+
+	fullpath = psprintf("%s/%s", context->backup_directory,
+						task->archive_name);
+	if ((fd = open(fullpath, O_RDONLY | PG_BINARY, 0)) < 0)
+	{
+		report_backup_error(context, "could not open file \"%s\": %m",
+							task->archive_name);
+		pfree(fullpath);
+		return;
+	}
+
+	streamer = verify_streamer_new(context, task->archive_name,
+								   task->archive_prefix);
+	streamer = bbstreamer_tar_parser_new(streamer);
+	if (task->compress_algo == PG_COMPRESSION_GZIP)
+		streamer = bbstreamer_gzip_decompressor_new(streamer);
+	else if (task->compress_algo == PG_COMPRESSION_LZ4)
+		streamer = bbstreamer_lz4_decompressor_new(streamer);
+	else if (task->compress_algo == PG_COMPRESSION_ZSTD)
+		streamer = bbstreamer_zstd_decompressor_new(streamer);
+
+	while ((rc = read(fd, buffer, READ_CHUNK_SIZE)) > 0)
+	{
+		bbstreamer_content(streamer, NULL, buffer, rc, BBSTREAMER_UNKNOWN);
+
+		/* Report progress, unless the main thread does it */
+		worker->done_size += rc;
+		if (num_jobs == 1)
+			progress_report(false);
+	}
+	if (rc < 0)
+		report_backup_error(context, "could not read file \"%s\": %m",
+							task->archive_name);
+	else
+		bbstreamer_finalize(streamer);
+
+	bbstreamer_free(streamer);
+
+	if (close(fd) != 0)
+		report_backup_error(context, "could not close file \"%s\": %m",
+							task->archive_name);
+	pfree(fullpath);
+}
+
+/*
+ * Create a bbstreamer that checks the members of a tar archive, named
+ * 'archive_name', against the manifest.  The path of each member in the
+ * manifest is its path in the archive, prefixed by 'archive_prefix'.
+ */
+static bbstreamer *
+verify_streamer_new(verifier_context *context, char *archive_name,
+					char *archive_prefix)
+{
+	verify_streamer *streamer;
+
+	streamer = palloc0(sizeof(verify_streamer));
+	*((const bbstreamer_ops **) &streamer->base.bbs_ops) =
+		&verify_streamer_ops;
+	streamer->context = context;
+	streamer->archive_name = archive_name;
+	streamer->archive_prefix = archive_prefix;
+
+	return &streamer->base;
+}
+
+/*
+ * Check one chunk of a parsed tar archive.
+ *
+ * The header of each member tells its path and size, which are checked like
+ * verify_backup_file() does for a file on disk.  Then, the checksum is
+ * computed over the contents, and checked at the member's trailer.
+ */
+static void
+verify_streamer_content(bbstreamer *streamer, bbstreamer_member *member,
+						const char *data, int len,
+						bbstreamer_archive_context context)
+{
+	verify_streamer *mystreamer = (verify_streamer *) streamer;
+	verifier_context *vcontext = mystreamer->context;
+	manifest_file *m;
+
+	switch (context)
+	{
+		case BBSTREAMER_MEMBER_HEADER:
+			if (mystreamer->relpath != NULL)
+			{
+				pfree(mystreamer->relpath);
+				mystreamer->relpath = NULL;
+			}
+			mystreamer->m = NULL;
+			mystreamer->verify_checksum = false;
+
+			/*
+			 * Directories and symbolic links aren't listed in the manifest.
+			 * Tablespaces are symbolic links in base.tar, and their files are
+			 * in archives of their own.
+			 */
+			if (member->is_directory || member->is_link)
+				return;
+
+			mystreamer->relpath = psprintf("%s%s", mystreamer->archive_prefix,
+										   member->pathname);
+			if (should_ignore_relpath(vcontext, mystreamer->relpath))
+				return;
+
+			m = manifest_files_lookup(vcontext->ht, mystreamer->relpath);
+			if (m == NULL)
+			{
+				report_backup_error(vcontext,
+									"\"%s\" is present in \"%s\" but not in the manifest",
+									mystreamer->relpath,
+									mystreamer->archive_name);
+				return;
+			}
+			m->matched = true;
+			mystreamer->m = m;
+
+			if (m->size != member->size)
+			{
+				report_backup_error(vcontext,
+									"\"%s\" has size %lld in \"%s\" but size %zu in the manifest",
+									mystreamer->relpath,
+									(long long int) member->size,
+									mystreamer->archive_name, m->size);
+				m->bad = true;
+				return;
+			}
+
+			if (skip_checksums || !should_verify_checksum(m))
+				return;
+
+			if (pg_checksum_init(&mystreamer->checksum_ctx,
+								 m->checksum_type) < 0)
+			{
+				report_backup_error(vcontext,
+									"could not initialize checksum of file \"%s\"",
+									mystreamer->relpath);
+				return;
+			}
+			mystreamer->verify_checksum = true;
+			break;
+
+		case BBSTREAMER_MEMBER_CONTENTS:
+			if (!mystreamer->verify_checksum)
+				return;
+
+			if (pg_checksum_update(&mystreamer->checksum_ctx,
+								   (const uint8 *) data, len) < 0)
+			{
+				report_backup_error(vcontext,
+									"could not update checksum of file \"%s\"",
+									mystreamer->relpath);
+				mystreamer->verify_checksum = false;
+			}
+			break;
+
+		case BBSTREAMER_MEMBER_TRAILER:
+			if (mystreamer->verify_checksum)
+			{
+				verify_checksum_final(vcontext, mystreamer->m,
+									  &mystreamer->checksum_ctx);
+				mystreamer->verify_checksum = false;
+			}
+			break;
+
+		case BBSTREAMER_ARCHIVE_TRAILER:
+			break;
+
+		default:
+			/* Shouldn't happen. */
+			pg_fatal("unexpected state while parsing tar archive");
+	}
+}
+
+/*
+ * End-of-archive processing for a verify_streamer: nothing to do, since all
+ * the members have been checked at their trailers.
+ */
+static void
+verify_streamer_finalize(bbstreamer *streamer)
+{
+}
+
+/*
+ * Free memory associated with a verify_streamer.
+ */
+static void
+verify_streamer_free(bbstreamer *streamer)
+{
+	verify_streamer *mystreamer = (verify_streamer *) streamer;
+
+	if (mystreamer->relpath != NULL)
+		pfree(mystreamer->relpath);
+	pfree(mystreamer);
+}
+
 /*
  * Attempt to parse the WAL files required to restore from backup using
  * pg_waldump.
@@ -942,6 +1567,7 @@ progress_report(bool finished)
 {
 	static pg_time_t last_progress_report = 0;
 	pg_time_t	now;
+	uint64		done_size = 0;
 	int			percent_size = 0;
 	char		totalsize_str[32];
 	char		donesize_str[32];
@@ -954,6 +1580,15 @@ progress_report(bool finished)
 		return;					/* Max once per second */
 
 	last_progress_report = now;
+
+	/* Add up the progress of all workers */
+	if (workers != NULL)
+	{
+		int			i;
+
+		for (i = 0; i < num_jobs; i++)
+			done_size += workers[i].done_size;
+	}
 	percent_size = total_size ? (int) ((done_size * 100 / total_size)) : 0;
 
 	snprintf(totalsize_str, sizeof(totalsize_str), UINT64_FORMAT,
@@ -983,7 +1618,9 @@ usage(void)
 	printf(_("Usage:\n  %s [OPTION]... BACKUPDIR\n\n"), progname);
 	printf(_("Options:\n"));
 	printf(_("  -e, --exit-on-error         exit immediately on error\n"));
+	printf(_("  -F, --format=p|t            backup format (plain, tar)\n"));
 	printf(_("  -i, --ignore=RELATIVE_PATH  ignore indicated path\n"));
+	printf(_("  -j, --jobs=NUM              use this many parallel jobs to verify\n"));
 	printf(_("  -m, --manifest-path=PATH    use specified path for manifest\n"));
 	printf(_("  -n, --no-parse-wal          do not try to parse WAL files\n"));
 	printf(_("  -P, --progress              show progress information\n"));
@@ -0,0 +1,122 @@
+# Copyright (c) 2023, PostgreSQL Global Development Group
+
+# Verify tar-format backups without extracting them, and verification with
+# several jobs.
+
+use strict;
+use warnings;
+use File::Copy;
+use File::Path qw(rmtree);
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $primary = PostgreSQL::Test::Cluster->new('primary');
+$primary->init(allows_streaming => 1);
+$primary->start;
+
+# A plain-format backup can be verified with several jobs.
+my $plain_path = $primary->backup_dir . '/plain';
+$primary->command_ok(
+	[ 'pg_basebackup', '-D', $plain_path, '--no-sync', '-cfast' ],
+	"plain backup");
+$primary->command_ok([ 'pg_verifybackup', '-j', '3', $plain_path ],
+	"verify plain backup with several jobs");
+rmtree($plain_path);
+
+my $backup_path = $primary->backup_dir . '/tar';
+
+my @test_configuration = (
+	{
+		'compression_method' => 'none',
+		'backup_flags'       => [],
+		'backup_archive'     => 'base.tar',
+		'enabled'            => 1
+	},
+	{
+		'compression_method' => 'gzip',
+		'backup_flags'       => [ '--compress', 'client-gzip:5' ],
+		'backup_archive'     => 'base.tar.gz',
+		'enabled'            => check_pg_config("#define HAVE_LIBZ 1")
+	},
+	{
+		'compression_method' => 'lz4',
+		'backup_flags'       => [ '--compress', 'client-lz4:5' ],
+		'backup_archive'     => 'base.tar.lz4',
+		'enabled'            => check_pg_config("#define USE_LZ4 1")
+	},
+	{
+		'compression_method' => 'zstd',
+		'backup_flags'       => [ '--compress', 'client-zstd:5' ],
+		'backup_archive'     => 'base.tar.zst',
+		'enabled'            => check_pg_config("#define USE_ZSTD 1")
+	});
+
+for my $tc (@test_configuration)
+{
+	my $method = $tc->{'compression_method'};
+
+  SKIP:
+	{
+		skip "$method compression not supported by this build", 3
+		  if !$tc->{'enabled'};
+
+		my @backup = (
+			'pg_basebackup', '-D', $backup_path,
+			'-Xfetch', '--no-sync', '-cfast', '-Ft');
+		push @backup, @{ $tc->{'backup_flags'} };
+		$primary->command_ok(\@backup, "tar backup, compression $method");
+
+		$primary->command_ok([ 'pg_verifybackup', '-n', $backup_path ],
+			"verify tar backup, compression $method");
+		$primary->command_ok(
+			[ 'pg_verifybackup', '-n', '-F', 'tar', '-j', '2', $backup_path ],
+			"verify tar backup with several jobs, compression $method");
+
+		rmtree($backup_path);
+	}
+}
+
+# Take an uncompressed tar-format backup to check failures.
+$primary->command_ok(
+	[
+		'pg_basebackup', '-D', $backup_path, '-Xfetch', '--no-sync',
+		'-cfast', '-Ft'
+	],
+	"tar backup");
+
+command_fails_like(
+	[ 'pg_verifybackup', $backup_path ],
+	qr/pg_waldump cannot read tar files/,
+	'WAL cannot be parsed in tar-format backup');
+
+# A file that isn't an archive of the backup is reported.
+open(my $fh, '>', "$backup_path/extra.txt")
+  || die "open $backup_path/extra.txt: $!";
+close($fh);
+command_fails_like(
+	[ 'pg_verifybackup', '-n', $backup_path ],
+	qr/"extra.txt" is not a valid file name for an archive of a tar-format backup/,
+	'extra file in tar-format backup');
+unlink("$backup_path/extra.txt");
+
+# Without the archive, all the files in it are missing.
+move("$backup_path/base.tar", "$backup_path/base.tar.bak")
+  || die "move $backup_path/base.tar: $!";
+command_fails_like(
+	[ 'pg_verifybackup', '-n', '-F', 'tar', $backup_path ],
+	qr/"PG_VERSION" is present in the manifest but not on disk/,
+	'missing archive in tar-format backup');
+move("$backup_path/base.tar.bak", "$backup_path/base.tar")
+  || die "move $backup_path/base.tar.bak: $!";
+
+# Corrupt the archive by truncating it in the middle of a file's contents.
+my $size = -s "$backup_path/base.tar";
+truncate("$backup_path/base.tar", $size / 2)
+  || die "truncate $backup_path/base.tar: $!";
+command_fails([ 'pg_verifybackup', '-n', $backup_path ],
+	'truncated archive in tar-format backup');
+
+rmtree($backup_path);
+
+done_testing();
@@ -25,12 +25,39 @@
 #include "common/fe_memutils.h"
 #include "common/file_perm.h"
 #include "common/file_utils.h"
+#include "common/hashfn.h"
 #include "common/logging.h"
 #include "common/relpath.h"
 #include "getopt_long.h"
 #include "rmgrdesc.h"
 #include "storage/bufpage.h"
 
+#ifdef WIN32
+/* Use Windows threads */
+#include <windows.h>
+#define GETERRNO() (_dosmaperr(GetLastError()), errno)
+#define THREAD_T HANDLE
+#define THREAD_FUNC_RETURN_TYPE unsigned
+#define THREAD_FUNC_RETURN return 0
+#define THREAD_FUNC_CC __stdcall
+#define THREAD_CREATE(handle, function, arg) \
+	((*(handle) = (HANDLE) _beginthreadex(NULL, 0, (function), (arg), 0, NULL)) == 0 ? errno : 0)
+#define THREAD_JOIN(handle) \
+	(WaitForSingleObject(handle, INFINITE) != WAIT_OBJECT_0 ? \
+	GETERRNO() : CloseHandle(handle) ? 0 : GETERRNO())
+#else
+/* Use POSIX threads */
+#include "port/pg_pthread.h"
+#define THREAD_T pthread_t
+#define THREAD_FUNC_RETURN_TYPE void *
+#define THREAD_FUNC_RETURN return NULL
+#define THREAD_FUNC_CC
+#define THREAD_CREATE(handle, function, arg) \
+	pthread_create((handle), NULL, (function), (arg))
+#define THREAD_JOIN(handle) \
+	pthread_join((handle), NULL)
+#endif
+
 /*
  * NOTE: For any code change or issue fix here, it is highly recommended to
  * give a thought about doing the same in pg_walinspect contrib module as well.
@@ -51,6 +78,32 @@ typedef struct XLogDumpPrivate
 	bool		endptr_reached;
 } XLogDumpPrivate;
 
+/*
+ * Statistics of one relation, for --stats=relation.  Records without any
+ * block reference are counted under emptyRelFileLocator.
+ */
+typedef struct XLogDumpRelStats
+{
+	RelFileLocator rlocator;	/* hash key */
+	char		status;			/* hash status */
+	XLogRecStats stats;
+} XLogDumpRelStats;
+
+#define SH_PREFIX		relstats
+#define SH_ELEMENT_TYPE	XLogDumpRelStats
+#define SH_KEY_TYPE		RelFileLocator
+#define	SH_KEY			rlocator
+#define SH_HASH_KEY(tb, key) \
+	hash_bytes((const unsigned char *) &(key), sizeof(RelFileLocator))
+#define SH_EQUAL(tb, a, b)		RelFileLocatorEquals(a, b)
+#define	SH_SCOPE		static inline
+#define SH_RAW_ALLOCATOR	pg_malloc0
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+#define RELSTATS_INITIAL_SIZE	256
+
 typedef struct XLogDumpConfig
 {
 	/* display options */
@@ -61,6 +114,8 @@ typedef struct XLogDumpConfig
 	bool		follow;
 	bool		stats;
 	bool		stats_per_record;
+	bool		stats_per_relation;
+	int			jobs;
 
 	/* filter options */
 	bool		filter_by_rmgr[RM_MAX_ID + 1];
@@ -79,6 +134,26 @@ typedef struct XLogDumpConfig
 	char	   *save_fullpage_path;
 } XLogDumpConfig;
 
+/*
+ * With --jobs, the range of WAL to read is split at segment boundaries among
+ * worker threads, each with its own reader and its own statistics, which are
+ * added up at the end.  A worker counts the records that start in its range,
+ * including the last one even if it ends in the next range; the next worker
+ * skips over the end of that record when looking for its first record.
+ */
+typedef struct XLogDumpStatsWorker
+{
+	THREAD_T	thread;
+	XLogDumpConfig *config;
+	char	   *waldir;
+	XLogDumpPrivate private;
+	XLogRecPtr	stopptr;		/* start of the next worker's range */
+	XLogStats	stats;
+	relstats_hash *relstats;
+	XLogRecPtr	errptr;			/* location of a record that failed */
+	char	   *errormsg;
+} XLogDumpStatsWorker;
+
 
 /*
  * When sigint is called, just tell the system to exit at the next possible
@@ -477,6 +552,39 @@ XLogRecordHasFPW(XLogReaderState *record)
 	return false;
 }
 
+/*
+ * Boolean to return whether the given WAL record passes all the filters
+ * specified.
+ */
+static bool
+XLogRecordMatchesFilters(XLogDumpConfig *config, XLogReaderState *record)
+{
+	if (config->filter_by_rmgr_enabled &&
+		!config->filter_by_rmgr[XLogRecGetRmid(record)])
+		return false;
+
+	if (config->filter_by_xid_enabled &&
+		config->filter_by_xid != XLogRecGetXid(record))
+		return false;
+
+	/* check for extended filtering */
+	if (config->filter_by_extended &&
+		!XLogRecordMatchesRelationBlock(record,
+										config->filter_by_relation_enabled ?
+										config->filter_by_relation :
+										emptyRelFileLocator,
+										config->filter_by_relation_block_enabled ?
+										config->filter_by_relation_block :
+										InvalidBlockNumber,
+										config->filter_by_relation_forknum))
+		return false;
+
+	if (config->filter_by_fpw && !XLogRecordHasFPW(record))
+		return false;
+
+	return true;
+}
+
 /*
  * Function to externally save all FPWs stored in the given WAL record.
  * Decompression is applied to all the blocks saved, if necessary.
@@ -572,6 +680,98 @@ XLogDumpDisplayRecord(XLogDumpConfig *config, XLogReaderState *record)
 	pfree(s.data);
 }
 
+/*
+ * Store per-relation statistics for a given record.
+ *
+ * The full-page images are counted against the relation of their block.
+ * The record itself, and the rest of its size, is counted against the
+ * relation of its first block reference, so that the sizes of all the
+ * relations add up to the total size of the records.
+ */
+static void
+XLogDumpStoreRelStats(relstats_hash *relstats, XLogReaderState *record)
+{
+	XLogDumpRelStats *entry = NULL;
+	uint32		rec_len;
+	uint32		fpi_len;
+	bool		found;
+	int			block_id;
+
+	XLogRecGetLen(record, &rec_len, &fpi_len);
+
+	for (block_id = 0; block_id <= XLogRecMaxBlockId(record); block_id++)
+	{
+		XLogDumpRelStats *blkentry;
+		RelFileLocator rlocator;
+
+		if (!XLogRecGetBlockTagExtended(record, block_id,
+										&rlocator, NULL, NULL, NULL))
+			continue;
+
+		blkentry = relstats_insert(relstats, rlocator, &found);
+		if (!found)
+			memset(&blkentry->stats, 0, sizeof(XLogRecStats));
+
+		if (XLogRecHasBlockImage(record, block_id))
+			blkentry->stats.fpi_len += XLogRecGetBlock(record, block_id)->bimg_len;
+
+		if (entry == NULL)
+			entry = blkentry;
+	}
+
+	if (entry == NULL)
+	{
+		entry = relstats_insert(relstats, emptyRelFileLocator, &found);
+		if (!found)
+			memset(&entry->stats, 0, sizeof(XLogRecStats));
+	}
+
+	entry->stats.count++;
+	entry->stats.rec_len += rec_len;
+}
+
+/*
+ * Add the per-relation statistics of src to dst.
+ */
+static void
+XLogDumpMergeRelStats(relstats_hash *dst, relstats_hash *src)
+{
+	relstats_iterator it;
+	XLogDumpRelStats *srcentry;
+
+	relstats_start_iterate(src, &it);
+	while ((srcentry = relstats_iterate(src, &it)) != NULL)
+	{
+		XLogDumpRelStats *entry;
+		bool		found;
+
+		entry = relstats_insert(dst, srcentry->rlocator, &found);
+		if (!found)
+			memset(&entry->stats, 0, sizeof(XLogRecStats));
+		entry->stats.count += srcentry->stats.count;
+		entry->stats.rec_len += srcentry->stats.rec_len;
+		entry->stats.fpi_len += srcentry->stats.fpi_len;
+	}
+}
+
+/*
+ * qsort comparator sorting relations by decreasing combined size.
+ */
+static int
+relstats_cmp(const void *a, const void *b)
+{
+	const XLogDumpRelStats *ra = *(XLogDumpRelStats *const *) a;
+	const XLogDumpRelStats *rb = *(XLogDumpRelStats *const *) b;
+	uint64		lena = ra->stats.rec_len + ra->stats.fpi_len;
+	uint64		lenb = rb->stats.rec_len + rb->stats.fpi_len;
+
+	if (lena > lenb)
+		return -1;
+	if (lena < lenb)
+		return 1;
+	return 0;
+}
+
 /*
  * Display a single row of record counts and sizes for an rmgr or record.
  */
@@ -617,7 +817,8 @@ XLogDumpStatsRow(const char *name,
  * Display summary statistics about the records seen so far.
  */
 static void
-XLogDumpDisplayStats(XLogDumpConfig *config, XLogStats *stats)
+XLogDumpDisplayStats(XLogDumpConfig *config, XLogStats *stats,
+					 relstats_hash *relstats)
 {
 	int			ri,
 				rj;
@@ -660,10 +861,48 @@ XLogDumpDisplayStats(XLogDumpConfig *config, XLogStats *stats)
 
 	printf("%-27s %20s %8s %20s %8s %20s %8s %20s %8s\n"
 		   "%-27s %20s %8s %20s %8s %20s %8s %20s %8s\n",
-		   "Type", "N", "(%)", "Record size", "(%)", "FPI size", "(%)", "Combined size", "(%)",
-		   "----", "-", "---", "-----------", "---", "--------", "---", "-------------", "---");
+		   config->stats_per_relation ? "Relation" : "Type",
+		   "N", "(%)", "Record size", "(%)", "FPI size", "(%)", "Combined size", "(%)",
+		   config->stats_per_relation ? "--------" : "----",
+		   "-", "---", "-----------", "---", "--------", "---", "-------------", "---");
 
-	for (ri = 0; ri <= RM_MAX_ID; ri++)
+	if (config->stats_per_relation)
+	{
+		relstats_iterator it;
+		XLogDumpRelStats *entry;
+		XLogDumpRelStats **entries;
+		int			nentries = 0;
+		int			i;
+
+		entries = pg_malloc(relstats->members * sizeof(XLogDumpRelStats *));
+		relstats_start_iterate(relstats, &it);
+		while ((entry = relstats_iterate(relstats, &it)) != NULL)
+			entries[nentries++] = entry;
+		qsort(entries, nentries, sizeof(XLogDumpRelStats *), relstats_cmp);
+
+		for (i = 0; i < nentries; i++)
+		{
+			XLogRecStats *relstat = &entries[i]->stats;
+			const char *name;
+
+			if (RelFileLocatorEquals(entries[i]->rlocator, emptyRelFileLocator))
+				name = "(no relation)";
+			else
+				name = psprintf("%u/%u/%u",
+								entries[i]->rlocator.spcOid,
+								entries[i]->rlocator.dbOid,
+								entries[i]->rlocator.relNumber);
+
+			XLogDumpStatsRow(name,
+							 relstat->count, total_count,
+							 relstat->rec_len, total_rec_len,
+							 relstat->fpi_len, total_fpi_len,
+							 relstat->rec_len + relstat->fpi_len, total_len);
+		}
+		pg_free(entries);
+	}
+
+	for (ri = 0; ri <= RM_MAX_ID && !config->stats_per_relation; ri++)
 	{
 		uint64		count,
 					rec_len,
@@ -746,6 +985,161 @@ XLogDumpDisplayStats(XLogDumpConfig *config, XLogStats *stats)
 		   total_len, "[100%]");
 }
 
+/*
+ * Compute statistics for the records starting in the range of one worker.
+ */
+static THREAD_FUNC_RETURN_TYPE THREAD_FUNC_CC
+XLogDumpStatsWorkerMain(void *arg)
+{
+	XLogDumpStatsWorker *worker = (XLogDumpStatsWorker *) arg;
+	XLogDumpConfig *config = worker->config;
+	XLogReaderState *xlogreader_state;
+	XLogRecPtr	first_record;
+	XLogRecord *record;
+	char	   *errormsg;
+
+	xlogreader_state =
+		XLogReaderAllocate(WalSegSz, worker->waldir,
+						   XL_ROUTINE(.page_read = WALDumpReadPage,
+									  .segment_open = WALDumpOpenSegment,
+									  .segment_close = WALDumpCloseSegment),
+						   &worker->private);
+	if (!xlogreader_state)
+		pg_fatal("out of memory while allocating a WAL reading processor");
+
+	/*
+	 * If no record starts in the range, because a record from an earlier
+	 * range covers all of it, there is nothing to do.
+	 */
+	first_record = XLogFindNextRecord(xlogreader_state,
+									  worker->private.startptr);
+	if (first_record == InvalidXLogRecPtr || first_record >= worker->stopptr)
+	{
+		XLogReaderFree(xlogreader_state);
+		THREAD_FUNC_RETURN;
+	}
+
+	while (!time_to_stop)
+	{
+		record = XLogReadRecord(xlogreader_state, &errormsg);
+		if (!record)
+		{
+			if (errormsg && !worker->private.endptr_reached)
+			{
+				worker->errptr = xlogreader_state->ReadRecPtr;
+				worker->errormsg = pg_strdup(errormsg);
+			}
+			break;
+		}
+
+		/* the next record belongs to the next worker */
+		if (xlogreader_state->ReadRecPtr >= worker->stopptr)
+			break;
+
+		if (!XLogRecordMatchesFilters(config, xlogreader_state))
+			continue;
+
+		XLogRecStoreStats(&worker->stats, xlogreader_state);
+		if (config->stats_per_relation)
+			XLogDumpStoreRelStats(worker->relstats, xlogreader_state);
+		worker->stats.endptr = xlogreader_state->EndRecPtr;
+
+		if (config->save_fullpage_path != NULL)
+			XLogRecordSaveFPWs(xlogreader_state, config->save_fullpage_path);
+	}
+
+	XLogReaderFree(xlogreader_state);
+
+	THREAD_FUNC_RETURN;
+}
+
+/*
+ * Compute the statistics of the records between first_record and
+ * private->endptr using config->jobs threads, and add them to stats and
+ * relstats.
+ *
+ * If a worker fails to read a record, the statistics of the later workers
+ * are ignored, so that the result is the same as reading the WAL serially:
+ * the statistics up to the failure are displayed, then the error is
+ * reported.
+ */
+static void
+XLogDumpStatsParallel(XLogDumpConfig *config, XLogDumpPrivate *private,
+					  char *waldir, XLogRecPtr first_record,
+					  XLogStats *stats, relstats_hash *relstats)
+{
+	XLogDumpStatsWorker *workers;
+	XLogSegNo	startsegno;
+	XLogSegNo	endsegno;
+	uint64		nsegs;
+	int			nworkers;
+	int			i;
+	int			failed = -1;
+
+	XLByteToSeg(first_record, startsegno, WalSegSz);
+	XLByteToPrevSeg(private->endptr, endsegno, WalSegSz);
+	nsegs = endsegno - startsegno + 1;
+	nworkers = (int) Min((uint64) config->jobs, nsegs);
+
+	workers = pg_malloc0(nworkers * sizeof(XLogDumpStatsWorker));
+	for (i = 0; i < nworkers; i++)
+	{
+		XLogDumpStatsWorker *worker = &workers[i];
+		XLogSegNo	segno = startsegno + (nsegs * i) / nworkers;
+		XLogSegNo	nextsegno = startsegno + (nsegs * (i + 1)) / nworkers;
+
+		worker->config = config;
+		worker->waldir = waldir;
+		worker->private = *private;
+		if (i == 0)
+			worker->private.startptr = first_record;
+		else
+			XLogSegNoOffsetToRecPtr(segno, 0, WalSegSz,
+									worker->private.startptr);
+		if (i == nworkers - 1)
+			worker->stopptr = private->endptr;
+		else
+			XLogSegNoOffsetToRecPtr(nextsegno, 0, WalSegSz, worker->stopptr);
+		worker->stats.startptr = InvalidXLogRecPtr;
+		worker->stats.endptr = InvalidXLogRecPtr;
+		if (config->stats_per_relation)
+			worker->relstats = relstats_create(RELSTATS_INITIAL_SIZE, NULL);
+
+		errno = THREAD_CREATE(&worker->thread, XLogDumpStatsWorkerMain, worker);
+		if (errno != 0)
+			pg_fatal("could not create thread: %m");
+	}
+
+	for (i = 0; i < nworkers; i++)
+	{
+		XLogDumpStatsWorker *worker = &workers[i];
+
+		errno = THREAD_JOIN(worker->thread);
+		if (errno != 0)
+			pg_fatal("could not join thread: %m");
+
+		if (failed >= 0)
+			continue;
+
+		XLogStatsMerge(stats, &worker->stats);
+		if (!XLogRecPtrIsInvalid(worker->stats.endptr))
+			stats->endptr = worker->stats.endptr;
+		if (config->stats_per_relation)
+			XLogDumpMergeRelStats(relstats, worker->relstats);
+
+		if (worker->errormsg)
+			failed = i;
+	}
+
+	if (failed >= 0)
+	{
+		XLogDumpDisplayStats(config, stats, relstats);
+		pg_fatal("error in WAL record at %X/%X: %s",
+				 LSN_FORMAT_ARGS(workers[failed].errptr),
+				 workers[failed].errormsg);
+	}
+}
+
 static void
 usage(void)
 {
@@ -760,6 +1154,7 @@ usage(void)
 	printf(_("  -f, --follow           keep retrying after reaching end of WAL\n"));
 	printf(_("  -F, --fork=FORK        only show records that modify blocks in fork FORK;\n"
 			 "                         valid names are main, fsm, vm, init\n"));
+	printf(_("  -j, --jobs=NUM         use this many threads to compute statistics\n"));
 	printf(_("  -n, --limit=N          number of records to display\n"));
 	printf(_("  -p, --path=PATH        directory in which to find WAL segment files or a\n"
 			 "                         directory with a ./pg_wal that contains such files\n"
@@ -776,8 +1171,9 @@ usage(void)
 	printf(_("      --save-fullpage=PATH\n"
 			 "                         save full page images\n"));
 	printf(_("  -x, --xid=XID          only show records with transaction ID XID\n"));
-	printf(_("  -z, --stats[=record]   show statistics instead of records\n"
-			 "                         (optionally, show per-record statistics)\n"));
+	printf(_("  -z, --stats[=record|relation]\n"
+			 "                         show statistics instead of records\n"
+			 "                         (optionally, show per-record or per-relation statistics)\n"));
 	printf(_("  -?, --help             show this help, then exit\n"));
 	printf(_("\nReport bugs to <%s>.\n"), PACKAGE_BUGREPORT);
 	printf(_("%s home page: <%s>\n"), PACKAGE_NAME, PACKAGE_URL);
@@ -792,6 +1188,7 @@ main(int argc, char **argv)
 	XLogDumpPrivate private;
 	XLogDumpConfig config;
 	XLogStats	stats;
+	relstats_hash *relstats = NULL;
 	XLogRecord *record;
 	XLogRecPtr	first_record;
 	char	   *waldir = NULL;
@@ -805,6 +1202,7 @@ main(int argc, char **argv)
 		{"fork", required_argument, NULL, 'F'},
 		{"fullpage", no_argument, NULL, 'w'},
 		{"help", no_argument, NULL, '?'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"limit", required_argument, NULL, 'n'},
 		{"path", required_argument, NULL, 'p'},
 		{"quiet", no_argument, NULL, 'q'},
@@ -870,6 +1268,8 @@ main(int argc, char **argv)
 	config.save_fullpage_path = NULL;
 	config.stats = false;
 	config.stats_per_record = false;
+	config.stats_per_relation = false;
+	config.jobs = 1;
 
 	stats.startptr = InvalidXLogRecPtr;
 	stats.endptr = InvalidXLogRecPtr;
@@ -880,7 +1280,7 @@ main(int argc, char **argv)
 		goto bad_argument;
 	}
 
-	while ((option = getopt_long(argc, argv, "bB:e:fF:n:p:qr:R:s:t:wx:z",
+	while ((option = getopt_long(argc, argv, "bB:e:fF:j:n:p:qr:R:s:t:wx:z",
 								 long_options, &optindex)) != -1)
 	{
 		switch (option)
@@ -919,6 +1319,14 @@ main(int argc, char **argv)
 				}
 				config.filter_by_extended = true;
 				break;
+			case 'j':
+				if (sscanf(optarg, "%d", &config.jobs) != 1 ||
+					config.jobs < 1)
+				{
+					pg_log_error("invalid value \"%s\" for option %s", optarg, "-j/--jobs");
+					goto bad_argument;
+				}
+				break;
 			case 'n':
 				if (sscanf(optarg, "%d", &config.stop_after_records) != 1)
 				{
@@ -1028,10 +1436,13 @@ main(int argc, char **argv)
 			case 'z':
 				config.stats = true;
 				config.stats_per_record = false;
+				config.stats_per_relation = false;
 				if (optarg)
 				{
 					if (strcmp(optarg, "record") == 0)
 						config.stats_per_record = true;
+					else if (strcmp(optarg, "relation") == 0)
+						config.stats_per_relation = true;
 					else if (strcmp(optarg, "rmgr") != 0)
 					{
 						pg_log_error("unrecognized value for option %s: %s",
@@ -1056,6 +1467,28 @@ main(int argc, char **argv)
 		goto bad_argument;
 	}
 
+	if (config.jobs > 1)
+	{
+		if (!config.stats)
+		{
+			pg_log_error("option %s requires option %s to be specified",
+						 "-j/--jobs", "-z/--stats");
+			goto bad_argument;
+		}
+		if (config.follow)
+		{
+			pg_log_error("options %s and %s cannot be used together",
+						 "-j/--jobs", "-f/--follow");
+			goto bad_argument;
+		}
+		if (config.stop_after_records > 0)
+		{
+			pg_log_error("options %s and %s cannot be used together",
+						 "-j/--jobs", "-n/--limit");
+			goto bad_argument;
+		}
+	}
+
 	if ((optind + 2) < argc)
 	{
 		pg_log_error("too many command-line arguments (first is \"%s\")",
@@ -1165,6 +1598,17 @@ main(int argc, char **argv)
 		goto bad_argument;
 	}
 
+	/* the range must be known to split it among the workers */
+	if (config.jobs > 1 && XLogRecPtrIsInvalid(private.endptr))
+	{
+		pg_log_error("option %s requires an end WAL location or segment",
+					 "-j/--jobs");
+		goto bad_argument;
+	}
+
+	if (config.stats_per_relation)
+		relstats = relstats_create(RELSTATS_INITIAL_SIZE, NULL);
+
 	/* done with argument parsing, do the actual work */
 
 	/* we have everything we need, start reading */
@@ -1201,6 +1645,20 @@ main(int argc, char **argv)
 	if (config.stats == true && !config.quiet)
 		stats.startptr = first_record;
 
+	if (config.stats == true && !config.quiet && config.jobs > 1)
+	{
+		XLogDumpStatsParallel(&config, &private, waldir, first_record,
+							  &stats, relstats);
+		XLogDumpDisplayStats(&config, &stats, relstats);
+
+		if (time_to_stop)
+			exit(0);
+
+		XLogReaderFree(xlogreader_state);
+
+		return EXIT_SUCCESS;
+	}
+
 	for (;;)
 	{
 		if (time_to_stop)
@@ -1223,27 +1681,7 @@ main(int argc, char **argv)
 		}
 
 		/* apply all specified filters */
-		if (config.filter_by_rmgr_enabled &&
-			!config.filter_by_rmgr[record->xl_rmid])
-			continue;
-
-		if (config.filter_by_xid_enabled &&
-			config.filter_by_xid != record->xl_xid)
-			continue;
-
-		/* check for extended filtering */
-		if (config.filter_by_extended &&
-			!XLogRecordMatchesRelationBlock(xlogreader_state,
-											config.filter_by_relation_enabled ?
-											config.filter_by_relation :
-											emptyRelFileLocator,
-											config.filter_by_relation_block_enabled ?
-											config.filter_by_relation_block :
-											InvalidBlockNumber,
-											config.filter_by_relation_forknum))
-			continue;
-
-		if (config.filter_by_fpw && !XLogRecordHasFPW(xlogreader_state))
+		if (!XLogRecordMatchesFilters(&config, xlogreader_state))
 			continue;
 
 		/* perform any per-record work */
@@ -1252,6 +1690,8 @@ main(int argc, char **argv)
 			if (config.stats == true)
 			{
 				XLogRecStoreStats(&stats, xlogreader_state);
+				if (config.stats_per_relation)
+					XLogDumpStoreRelStats(relstats, xlogreader_state);
 				stats.endptr = xlogreader_state->EndRecPtr;
 			}
 			else
@@ -1270,7 +1710,7 @@ main(int argc, char **argv)
 	}
 
 	if (config.stats == true && !config.quiet)
-		XLogDumpDisplayStats(&config, &stats);
+		XLogDumpDisplayStats(&config, &stats, relstats);
 
 	if (time_to_stop)
 		exit(0);
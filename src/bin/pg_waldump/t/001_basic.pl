@@ -10,4 +10,9 @@ program_help_ok('pg_waldump');
 program_version_ok('pg_waldump');
 program_options_handling_ok('pg_waldump');
 
+command_fails_like(
+	[ 'pg_waldump', '--jobs', '2', '--start', '0/01000000' ],
+	qr/\Qoption -j\/--jobs requires option -z\/--stats to be specified\E/,
+	'--jobs requires --stats');
+
 done_testing();
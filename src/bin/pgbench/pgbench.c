@@ -307,6 +307,12 @@ const char *pgport = NULL;
 const char *username = NULL;
 const char *dbName = NULL;
 char	   *logfile_prefix = NULL;
+char	   *latency_hist_prefix = NULL;
+char	   *result_file = NULL;
+bool		collect_latency_hist = false;	/* maintain latency histograms? */
+bool		merge_results = false;	/* merge result files and exit */
+int64		start_at = 0;		/* Unix epoch time in us to start the
+								 * benchmark at, 0 to start at once */
 const char *progname;
 
 #define WSEP '@'				/* weight separator */
@@ -379,6 +385,20 @@ typedef struct SimpleStats
  */
 typedef int64 pg_time_usec_t;
 
+/*
+ * Latency histogram, in microseconds, in the manner of HdrHistogram: values
+ * below LATENCY_HIST_SUB_BUCKETS get a bucket each, and each following power
+ * of two range is divided into LATENCY_HIST_SUB_BUCKETS buckets of equal
+ * width, so that a value is known within about 3%.  Values above
+ * 2^LATENCY_HIST_MAX_BIT us (about 38 hours) are counted in the last bucket.
+ */
+#define LATENCY_HIST_SUB_BITS	5
+#define LATENCY_HIST_SUB_BUCKETS	(1 << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_MAX_BIT	37
+#define LATENCY_HIST_BUCKETS \
+	(LATENCY_HIST_SUB_BUCKETS * \
+	 (LATENCY_HIST_MAX_BIT - LATENCY_HIST_SUB_BITS + 2))
+
 /*
  * Data structure to hold various statistics: per-thread and per-script stats
  * are maintained and merged together.
@@ -450,6 +470,12 @@ typedef struct StatsData
 									 * error */
 	SimpleStats latency;
 	SimpleStats lag;
+
+	/*
+	 * latency histogram, only maintained under --latency-histogram and
+	 * --result-file
+	 */
+	int64		latency_hist[LATENCY_HIST_BUCKETS];
 } StatsData;
 
 /*
@@ -920,13 +946,20 @@ usage(void)
 		   "  -v, --vacuum-all         vacuum all four standard tables before tests\n"
 		   "  --aggregate-interval=NUM aggregate data over NUM seconds\n"
 		   "  --failures-detailed      report the failures grouped by basic types\n"
+		   "  --latency-histogram=PREFIX\n"
+		   "                           report latency percentiles, and write latency\n"
+		   "                           histograms to files with this prefix\n"
 		   "  --log-prefix=PREFIX      prefix for transaction time log file\n"
 		   "                           (default: \"pgbench_log\")\n"
 		   "  --max-tries=NUM          max number of tries to run transaction (default: 1)\n"
+		   "  --merge-results          merge the result files given as arguments\n"
+		   "                           into one report, then exit\n"
 		   "  --progress-timestamp     use Unix epoch timestamps for progress\n"
 		   "  --random-seed=SEED       set random seed (\"time\", \"rand\", integer)\n"
+		   "  --result-file=FILE       write results to FILE, for --merge-results\n"
 		   "  --sampling-rate=NUM      fraction of transactions to log (e.g., 0.01 for 1%%)\n"
 		   "  --show-script=NAME       show builtin script code, then exit\n"
+		   "  --start-time=TIME        start the benchmark at Unix epoch time TIME\n"
 		   "  --verbose-errors         print messages of all errors\n"
 		   "\nCommon options:\n"
 		   "  -d, --debug              print debugging output\n"
@@ -1421,6 +1454,74 @@ mergeSimpleStats(SimpleStats *acc, SimpleStats *ss)
 	acc->sum2 += ss->sum2;
 }
 
+/*
+ * Return the latency histogram bucket of a value in microseconds.
+ */
+static int
+latencyHistBucket(double val)
+{
+	uint64		v = (val > 0) ? (uint64) val : 0;
+	int			bit;
+
+	if (v < LATENCY_HIST_SUB_BUCKETS)
+		return (int) v;
+
+	bit = pg_leftmost_one_pos64(v);
+	if (bit > LATENCY_HIST_MAX_BIT)
+		return LATENCY_HIST_BUCKETS - 1;
+
+	/* keep the LATENCY_HIST_SUB_BITS bits below the leftmost one */
+	return LATENCY_HIST_SUB_BUCKETS * (bit - LATENCY_HIST_SUB_BITS + 1) +
+		(int) ((v >> (bit - LATENCY_HIST_SUB_BITS)) - LATENCY_HIST_SUB_BUCKETS);
+}
+
+/*
+ * Return the highest value, in microseconds, counted in a latency histogram
+ * bucket.
+ */
+static double
+latencyHistValue(int bucket)
+{
+	int			shift;
+	uint64		low;
+
+	if (bucket < LATENCY_HIST_SUB_BUCKETS)
+		return bucket;
+
+	shift = bucket / LATENCY_HIST_SUB_BUCKETS - 1;
+	low = ((uint64) (LATENCY_HIST_SUB_BUCKETS + bucket % LATENCY_HIST_SUB_BUCKETS)) << shift;
+
+	return (double) (low + (UINT64CONST(1) << shift) - 1);
+}
+
+/*
+ * Return the given percentile of the values counted in a latency histogram
+ * of 'count' values, whose largest value is 'max'.
+ */
+static double
+latencyHistPercentile(const int64 *hist, int64 count, double max,
+					  double percentile)
+{
+	int64		target;
+	int64		seen = 0;
+
+	if (count <= 0)
+		return 0.0;
+
+	target = (int64) ceil(percentile / 100.0 * count);
+	if (target < 1)
+		target = 1;
+
+	for (int i = 0; i < LATENCY_HIST_BUCKETS; i++)
+	{
+		seen += hist[i];
+		if (seen >= target)
+			return Min(latencyHistValue(i), max);
+	}
+
+	return max;
+}
+
 /*
  * Initialize a StatsData struct to mostly zeroes, with its start time set to
  * the given value.
@@ -1437,6 +1538,17 @@ initStats(StatsData *sd, pg_time_usec_t start)
 	sd->deadlock_failures = 0;
 	initSimpleStats(&sd->latency);
 	initSimpleStats(&sd->lag);
+	memset(sd->latency_hist, 0, sizeof(sd->latency_hist));
+}
+
+/*
+ * Merge the latency histogram of a StatsData object into another one.
+ */
+static void
+mergeLatencyHist(StatsData *acc, StatsData *sd)
+{
+	for (int i = 0; i < LATENCY_HIST_BUCKETS; i++)
+		acc->latency_hist[i] += sd->latency_hist[i];
 }
 
 /*
@@ -1471,6 +1583,8 @@ accumStats(StatsData *stats, bool skipped, double lat, double lag,
 			stats->cnt++;
 
 			addToSimpleStats(&stats->latency, lat);
+			if (collect_latency_hist)
+				stats->latency_hist[latencyHistBucket(lat)]++;
 
 			/* and possibly the same for schedule lag */
 			if (throttle_delay)
@@ -4621,7 +4735,7 @@ processXactStats(TState *thread, CState *st, pg_time_usec_t *now,
 	double		latency = 0.0,
 				lag = 0.0;
 	bool		detailed = progress || throttle_delay || latency_limit ||
-	use_log || per_script_stats;
+	use_log || per_script_stats || collect_latency_hist;
 
 	if (detailed && !skipped && st->estatus == ESTATUS_NO_ERROR)
 	{
@@ -6165,6 +6279,8 @@ printProgressReport(TState *threads, int64 test_start, pg_time_usec_t now,
 	{
 		mergeSimpleStats(&cur.latency, &threads[i].stats.latency);
 		mergeSimpleStats(&cur.lag, &threads[i].stats.lag);
+		if (collect_latency_hist)
+			mergeLatencyHist(&cur, &threads[i].stats);
 		cur.cnt += threads[i].stats.cnt;
 		cur.skipped += threads[i].stats.skipped;
 		cur.retries += threads[i].stats.retries;
@@ -6220,6 +6336,20 @@ printProgressReport(TState *threads, int64 test_start, pg_time_usec_t now,
 		fprintf(stderr,
 				", " INT64_FORMAT " retried, " INT64_FORMAT " retries",
 				retried, cur.retries - last->retries);
+
+	/* percentiles of the latencies of this interval */
+	if (latency_hist_prefix)
+	{
+		int64		hist[LATENCY_HIST_BUCKETS];
+
+		for (int i = 0; i < LATENCY_HIST_BUCKETS; i++)
+			hist[i] = cur.latency_hist[i] - last->latency_hist[i];
+
+		fprintf(stderr, ", lat p50 %.3f p99 %.3f p99.9 %.3f ms",
+				0.001 * latencyHistPercentile(hist, cnt, cur.latency.max, 50.0),
+				0.001 * latencyHistPercentile(hist, cnt, cur.latency.max, 99.0),
+				0.001 * latencyHistPercentile(hist, cnt, cur.latency.max, 99.9));
+	}
 	fprintf(stderr, "\n");
 
 	*last = cur;
@@ -6239,6 +6369,293 @@ printSimpleStats(const char *prefix, SimpleStats *ss)
 	}
 }
 
+/*
+ * Print the latency percentiles of a StatsData object.
+ */
+static void
+printLatencyPercentiles(const char *prefix, StatsData *sd)
+{
+	static const double percentiles[] = {50.0, 90.0, 99.0, 99.9, 99.99};
+
+	if (sd->latency.count <= 0)
+		return;
+
+	printf("%s percentiles:", prefix);
+	for (int i = 0; i < lengthof(percentiles); i++)
+		printf("%s %g%% = %.3f ms", i > 0 ? "," : "", percentiles[i],
+			   0.001 * latencyHistPercentile(sd->latency_hist,
+											 sd->latency.count,
+											 sd->latency.max,
+											 percentiles[i]));
+	printf(", max = %.3f ms\n", 0.001 * sd->latency.max);
+}
+
+/*
+ * Write the latency histogram of a StatsData object to a file, as a
+ * percentile distribution in the format of HdrHistogram, with values in
+ * milliseconds.  Each line shows the largest latency of a bucket, the
+ * fraction of the transactions whose latency is at most that, their number,
+ * and 1/(1-fraction).
+ */
+static void
+writeLatencyHist(const char *path, StatsData *sd)
+{
+	FILE	   *f;
+	int64		count = sd->latency.count;
+	int64		seen = 0;
+
+	f = fopen(path, "w");
+	if (f == NULL)
+		pg_fatal("could not open latency histogram file \"%s\": %m", path);
+
+	fprintf(f, "%12s %14s %10s %14s\n\n",
+			"Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+
+	for (int i = 0; i < LATENCY_HIST_BUCKETS; i++)
+	{
+		double		fraction;
+
+		if (sd->latency_hist[i] == 0)
+			continue;
+
+		seen += sd->latency_hist[i];
+		fraction = (double) seen / count;
+
+		if (seen < count)
+			fprintf(f, "%12.3f %14.12f %10" INT64_MODIFIER "d %14.2f\n",
+					0.001 * Min(latencyHistValue(i), sd->latency.max),
+					fraction, seen, 1.0 / (1.0 - fraction));
+		else
+			fprintf(f, "%12.3f %14.12f %10" INT64_MODIFIER "d\n",
+					0.001 * sd->latency.max, fraction, seen);
+	}
+
+	if (count > 0)
+	{
+		double		mean = sd->latency.sum / count;
+		double		stddev = sqrt(sd->latency.sum2 / count - mean * mean);
+
+		fprintf(f, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n",
+				0.001 * mean, 0.001 * stddev);
+		fprintf(f, "#[Max     = %12.3f, Total count    = %12" INT64_MODIFIER "d]\n",
+				0.001 * sd->latency.max, count);
+	}
+
+	if (fclose(f) != 0)
+		pg_fatal("could not write latency histogram file \"%s\": %m", path);
+}
+
+/* first line of the files written by --result-file */
+#define RESULT_FILE_HEADER "pgbench results 1"
+
+/*
+ * Write the results of the run to a file for --merge-results.  The file has
+ * one "name value" line per counter, and a "hist bucket count" line per
+ * bucket of the latency histogram that is not empty.
+ */
+static void
+writeResultFile(const char *path, StatsData *total,
+				pg_time_usec_t total_duration)
+{
+	FILE	   *f;
+
+	f = fopen(path, "w");
+	if (f == NULL)
+		pg_fatal("could not open result file \"%s\": %m", path);
+
+	fprintf(f, "%s\n", RESULT_FILE_HEADER);
+	fprintf(f, "duration " INT64_FORMAT "\n", total_duration);
+	fprintf(f, "clients %d\n", nclients);
+	fprintf(f, "cnt " INT64_FORMAT "\n", total->cnt);
+	fprintf(f, "skipped " INT64_FORMAT "\n", total->skipped);
+	fprintf(f, "retries " INT64_FORMAT "\n", total->retries);
+	fprintf(f, "retried " INT64_FORMAT "\n", total->retried);
+	fprintf(f, "serialization_failures " INT64_FORMAT "\n",
+			total->serialization_failures);
+	fprintf(f, "deadlock_failures " INT64_FORMAT "\n",
+			total->deadlock_failures);
+	fprintf(f, "latency " INT64_FORMAT " %.17g %.17g %.17g %.17g\n",
+			total->latency.count, total->latency.min, total->latency.max,
+			total->latency.sum, total->latency.sum2);
+	fprintf(f, "lag " INT64_FORMAT " %.17g %.17g %.17g %.17g\n",
+			total->lag.count, total->lag.min, total->lag.max,
+			total->lag.sum, total->lag.sum2);
+	for (int i = 0; i < LATENCY_HIST_BUCKETS; i++)
+		if (total->latency_hist[i] != 0)
+			fprintf(f, "hist %d " INT64_FORMAT "\n", i, total->latency_hist[i]);
+
+	if (fclose(f) != 0)
+		pg_fatal("could not write result file \"%s\": %m", path);
+}
+
+/*
+ * Read a file written by writeResultFile(), and add its results to *total.
+ * The transactions per second of the run are added to *tps, and its number
+ * of clients to *clients.
+ */
+static void
+readResultFile(const char *path, StatsData *total, double *tps, int *clients)
+{
+	FILE	   *f;
+	char		line[256];
+	int			lineno = 0;
+	int64		duration = 0;
+	StatsData	sd;
+
+	f = fopen(path, "r");
+	if (f == NULL)
+		pg_fatal("could not open result file \"%s\": %m", path);
+
+	initStats(&sd, 0);
+
+	while (fgets(line, sizeof(line), f) != NULL)
+	{
+		char	   *name;
+		char	   *ptr;
+		char	   *end;
+		int64		value;
+		SimpleStats *ss = NULL;
+		bool		ok;
+
+		lineno++;
+		if (lineno == 1)
+		{
+			if (strcmp(line, RESULT_FILE_HEADER "\n") != 0)
+				pg_fatal("file \"%s\" is not a pgbench result file", path);
+			continue;
+		}
+
+		/* split off the name, and parse the first number after it */
+		name = line;
+		ptr = strchr(line, ' ');
+		if (ptr == NULL)
+			pg_fatal("invalid line %d in result file \"%s\"", lineno, path);
+		*ptr++ = '\0';
+		errno = 0;
+		value = strtoi64(ptr, &end, 10);
+		ok = (end != ptr && errno == 0);
+		ptr = end;
+
+		if (strcmp(name, "latency") == 0)
+			ss = &sd.latency;
+		else if (strcmp(name, "lag") == 0)
+			ss = &sd.lag;
+
+		if (ss != NULL)
+		{
+			double	   *fields[] = {&ss->min, &ss->max, &ss->sum, &ss->sum2};
+
+			ss->count = value;
+			for (int i = 0; ok && i < lengthof(fields); i++)
+			{
+				*fields[i] = strtod(ptr, &end);
+				ok = (end != ptr);
+				ptr = end;
+			}
+		}
+		else if (strcmp(name, "hist") == 0)
+		{
+			int64		count;
+
+			ok = ok && value >= 0 && value < LATENCY_HIST_BUCKETS;
+			count = strtoi64(ptr, &end, 10);
+			ok = ok && end != ptr;
+			if (ok)
+				sd.latency_hist[value] = count;
+		}
+		else if (strcmp(name, "clients") == 0)
+			*clients += (int) value;
+		else
+		{
+			if (strcmp(name, "duration") == 0)
+				duration = value;
+			else if (strcmp(name, "cnt") == 0)
+				sd.cnt = value;
+			else if (strcmp(name, "skipped") == 0)
+				sd.skipped = value;
+			else if (strcmp(name, "retries") == 0)
+				sd.retries = value;
+			else if (strcmp(name, "retried") == 0)
+				sd.retried = value;
+			else if (strcmp(name, "serialization_failures") == 0)
+				sd.serialization_failures = value;
+			else if (strcmp(name, "deadlock_failures") == 0)
+				sd.deadlock_failures = value;
+			else
+				ok = false;
+		}
+
+		if (!ok)
+			pg_fatal("invalid line %d in result file \"%s\"", lineno, path);
+	}
+
+	if (ferror(f))
+		pg_fatal("could not read result file \"%s\": %m", path);
+	fclose(f);
+
+	if (lineno == 0)
+		pg_fatal("file \"%s\" is not a pgbench result file", path);
+
+	mergeSimpleStats(&total->latency, &sd.latency);
+	mergeSimpleStats(&total->lag, &sd.lag);
+	mergeLatencyHist(total, &sd);
+	total->cnt += sd.cnt;
+	total->skipped += sd.skipped;
+	total->retries += sd.retries;
+	total->retried += sd.retried;
+	total->serialization_failures += sd.serialization_failures;
+	total->deadlock_failures += sd.deadlock_failures;
+
+	if (duration > 0)
+		*tps += sd.cnt / PG_TIME_GET_DOUBLE(duration);
+}
+
+/*
+ * Merge the result files of several runs, typically of pgbench processes
+ * started at the same time with --start-time on several hosts, and print
+ * the combined results.
+ */
+static void
+mergeResultFiles(int nfiles, char **files)
+{
+	StatsData	total;
+	double		tps = 0.0;
+	int			clients = 0;
+	int64		failures;
+	int64		total_cnt;
+
+	initStats(&total, 0);
+	for (int i = 0; i < nfiles; i++)
+		readResultFile(files[i], &total, &tps, &clients);
+
+	failures = getFailures(&total);
+	total_cnt = total.cnt + total.skipped + failures;
+
+	printf("number of result files: %d\n", nfiles);
+	printf("number of clients: %d\n", clients);
+	printf("number of transactions actually processed: " INT64_FORMAT "\n",
+		   total.cnt);
+	if (total_cnt > 0)
+		printf("number of failed transactions: " INT64_FORMAT " (%.3f%%)\n",
+			   failures, 100.0 * failures / total_cnt);
+	if (total.retried > 0)
+	{
+		printf("number of transactions retried: " INT64_FORMAT " (%.3f%%)\n",
+			   total.retried, 100.0 * total.retried / total_cnt);
+		printf("total number of retries: " INT64_FORMAT "\n", total.retries);
+	}
+	if (total.skipped > 0)
+		printf("number of transactions skipped: " INT64_FORMAT " (%.3f%%)\n",
+			   total.skipped, 100.0 * total.skipped / total_cnt);
+
+	printSimpleStats("latency", &total.latency);
+	printLatencyPercentiles("latency", &total);
+	if (total.lag.count > 0)
+		printf("rate limit schedule lag: avg %.3f (max %.3f) ms\n",
+			   0.001 * total.lag.sum / total.lag.count, 0.001 * total.lag.max);
+	printf("tps = %f (sum over all result files)\n", tps);
+}
+
 /* print version banner */
 static void
 printVersion(PGconn *con)
@@ -6346,8 +6763,12 @@ printResults(StatsData *total,
 			   latency_limit / 1000.0, latency_late, total->cnt,
 			   (total->cnt > 0) ? 100.0 * latency_late / total->cnt : 0.0);
 
-	if (throttle_delay || progress || latency_limit)
+	if (throttle_delay || progress || latency_limit || latency_hist_prefix)
+	{
 		printSimpleStats("latency", &total->latency);
+		if (latency_hist_prefix)
+			printLatencyPercentiles("latency", total);
+	}
 	else
 	{
 		/* no measurement, show average latency computed from run time */
@@ -6444,6 +6865,8 @@ printResults(StatsData *total,
 						   100.0 * sstats->skipped / script_total_cnt);
 
 				printSimpleStats(" - latency", &sstats->latency);
+				if (latency_hist_prefix)
+					printLatencyPercentiles(" - latency", sstats);
 			}
 
 			/*
@@ -6583,6 +7006,10 @@ main(int argc, char **argv)
 		{"failures-detailed", no_argument, NULL, 13},
 		{"max-tries", required_argument, NULL, 14},
 		{"verbose-errors", no_argument, NULL, 15},
+		{"latency-histogram", required_argument, NULL, 16},
+		{"result-file", required_argument, NULL, 17},
+		{"start-time", required_argument, NULL, 18},
+		{"merge-results", no_argument, NULL, 19},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -6605,6 +7032,7 @@ main(int argc, char **argv)
 	pg_time_usec_t
 				start_time,		/* start up time */
 				bench_start = 0,	/* first recorded benchmarking time */
+				bench_duration,
 				conn_total_duration;	/* cumulated connection time in
 										 * threads */
 	int64		latency_late = 0;
@@ -6920,6 +7348,31 @@ main(int argc, char **argv)
 				benchmarking_option_set = true;
 				verbose_errors = true;
 				break;
+			case 16:			/* latency-histogram */
+				benchmarking_option_set = true;
+				latency_hist_prefix = pg_strdup(optarg);
+				break;
+			case 17:			/* result-file */
+				benchmarking_option_set = true;
+				result_file = pg_strdup(optarg);
+				break;
+			case 18:			/* start-time */
+				{
+					double		start_time_secs;
+					char	   *endptr;
+
+					benchmarking_option_set = true;
+					errno = 0;
+					start_time_secs = strtod(optarg, &endptr);
+					if (endptr == optarg || *endptr != '\0' || errno != 0 ||
+						start_time_secs <= 0 || start_time_secs > 1e11)
+						pg_fatal("invalid start time: \"%s\"", optarg);
+					start_at = (pg_time_usec_t) (start_time_secs * 1000000);
+				}
+				break;
+			case 19:			/* merge-results */
+				merge_results = true;
+				break;
 			default:
 				/* getopt_long already emitted a complaint */
 				pg_log_error_hint("Try \"%s --help\" for more information.", progname);
@@ -6927,6 +7380,18 @@ main(int argc, char **argv)
 		}
 	}
 
+	if (merge_results)
+	{
+		if (is_init_mode || benchmarking_option_set)
+			pg_fatal("--merge-results cannot be used with other benchmarking or initialization options");
+		if (optind >= argc)
+			pg_fatal("no result files specified for --merge-results");
+		mergeResultFiles(argc - optind, argv + optind);
+		exit(0);
+	}
+
+	collect_latency_hist = (latency_hist_prefix != NULL || result_file != NULL);
+
 	/* set default script if none */
 	if (num_scripts == 0 && !is_init_mode)
 	{
@@ -7247,7 +7712,8 @@ main(int argc, char **argv)
 	/* compute when to stop */
 	threads[0].create_time = pg_time_now();
 	if (duration > 0)
-		end_time = threads[0].create_time + (int64) 1000000 * duration;
+		end_time = Max(threads[0].create_time, start_at - epoch_shift) +
+			(int64) 1000000 * duration;
 
 	/* run thread 0 directly */
 	(void) threadRun(&threads[0]);
@@ -7272,6 +7738,8 @@ main(int argc, char **argv)
 		/* aggregate thread level stats */
 		mergeSimpleStats(&stats.latency, &thread->stats.latency);
 		mergeSimpleStats(&stats.lag, &thread->stats.lag);
+		if (collect_latency_hist)
+			mergeLatencyHist(&stats, &thread->stats);
 		stats.cnt += thread->stats.cnt;
 		stats.skipped += thread->stats.skipped;
 		stats.retries += thread->stats.retries;
@@ -7300,9 +7768,32 @@ main(int argc, char **argv)
 	 * here encompasses all transactions so that tps shown is somehow slightly
 	 * underestimated.
 	 */
-	printResults(&stats, pg_time_now() - bench_start, conn_total_duration,
+	bench_duration = pg_time_now() - bench_start;
+	printResults(&stats, bench_duration, conn_total_duration,
 				 bench_start - start_time, latency_late);
 
+	if (result_file)
+		writeResultFile(result_file, &stats, bench_duration);
+
+	/* write latency histograms, for all transactions and for each script */
+	if (latency_hist_prefix)
+	{
+		char		path[MAXPGPATH];
+
+		snprintf(path, sizeof(path), "%s.hgrm", latency_hist_prefix);
+		writeLatencyHist(path, &stats);
+
+		if (per_script_stats)
+		{
+			for (i = 0; i < num_scripts; i++)
+			{
+				snprintf(path, sizeof(path), "%s.%d.hgrm",
+						 latency_hist_prefix, i + 1);
+				writeLatencyHist(path, &sql_script[i].stats);
+			}
+		}
+	}
+
 	THREAD_BARRIER_DESTROY(&barrier);
 
 	if (exit_code != 0)
@@ -7371,6 +7862,15 @@ threadRun(void *arg)
 		}
 	}
 
+	/* under --start-time, thread 0 holds the others back until it's time */
+	if (thread->tid == 0 && start_at > 0)
+	{
+		pg_time_usec_t now;
+
+		while ((now = pg_time_now()) < start_at - epoch_shift)
+			pg_usleep(Min(start_at - epoch_shift - now, 100000));
+	}
+
 	/* GO */
 	THREAD_BARRIER_WAIT(&barrier);
 
@@ -1220,6 +1220,44 @@ $node->pgbench(
 check_pgbench_logs($bdir, '001_pgbench_log_3', 1, 10, 10,
 	qr{^0 \d{1,2} \d+ \d \d+ \d+$});
 
+# Latency percentiles and histogram
+$node->pgbench(
+	"-n -S -t 10 --latency-histogram=$bdir/001_pgbench_hist",
+	0,
+	[
+		qr{processed: 10/10},
+		qr{latency percentiles: 50% = \d+\.\d+ ms, 90% = \d+\.\d+ ms, 99% = }
+	],
+	[qr{^$}],
+	'pgbench latency histogram');
+my $hist =
+  PostgreSQL::Test::Utils::slurp_file("$bdir/001_pgbench_hist.hgrm");
+like($hist, qr{^\s+Value\s+Percentile\s+TotalCount},
+	'latency histogram header');
+like($hist, qr{ 1\.000000000000 +10$}m,
+	'latency histogram counts all transactions');
+
+# result files, merged by another run
+$node->pgbench(
+	"-n -S -t 10 --result-file=$bdir/001_pgbench_result",
+	0,
+	[qr{processed: 10/10}],
+	[qr{^$}],
+	'pgbench result file');
+command_checks_all(
+	[
+		'pgbench', '--merge-results',
+		"$bdir/001_pgbench_result", "$bdir/001_pgbench_result"
+	],
+	0,
+	[
+		qr{number of result files: 2},
+		qr{number of transactions actually processed: 20},
+		qr{latency percentiles: 50% = }
+	],
+	[qr{^$}],
+	'pgbench merge result files');
+
 # abortion of the client if the script contains an incomplete transaction block
 $node->pgbench(
 	'--no-vacuum',
@@ -19,6 +19,7 @@
 
 #include "common/jsonapi.h"
 #include "mb/pg_wchar.h"
+#include "port/pg_bitutils.h"
 #include "port/pg_lfind.h"
 
 #ifndef FRONTEND
@@ -545,6 +546,35 @@ parse_array(JsonLexContext *lex, JsonSemAction *sem)
 	return JSON_SUCCESS;
 }
 
+/*
+ * Skip a run of spaces, such as the indentation of pretty-printed JSON, a
+ * vector at a time.  Returns a pointer to the first byte that is not a
+ * space, or to somewhere in the last vector's worth of input; the caller's
+ * byte-at-a-time loop takes it from there.
+ */
+static inline char *
+json_skip_spaces(char *s, char *const end)
+{
+#ifndef USE_NO_SIMD
+	const Vector8 spaces = vector8_broadcast(' ');
+
+	while (end - s >= (ptrdiff_t) sizeof(Vector8))
+	{
+		Vector8		chunk;
+		uint32		mask;
+
+		vector8_load(&chunk, (const uint8 *) s);
+		mask = ~vector8_highbit_mask(vector8_eq(chunk, spaces)) &
+			((1U << sizeof(Vector8)) - 1);
+		if (mask != 0)
+			return s + pg_rightmost_one_pos32(mask);
+		s += sizeof(Vector8);
+	}
+#endif
+
+	return s;
+}
+
 /*
  * Lex one token from the input stream.
  */
@@ -563,6 +593,7 @@ json_lex(JsonLexContext *lex)
 		{
 			++lex->line_number;
 			lex->line_start = s;
+			s = json_skip_spaces(s, end);
 		}
 	}
 	lex->token_start = s;
@@ -883,11 +914,46 @@ json_lex_string(JsonLexContext *lex)
 			 * Skip to the first byte that requires special handling, so we
 			 * can batch calls to appendBinaryStringInfo.
 			 */
+#ifndef USE_NO_SIMD
+			{
+				const Vector8 backslash = vector8_broadcast('\\');
+				const Vector8 quote = vector8_broadcast('"');
+				const Vector8 ctrl = vector8_broadcast(31);
+				const Vector8 zero = vector8_broadcast(0);
+
+				/*
+				 * Classify each vector with a single load, and jump straight
+				 * to the first special byte, if any.  A byte is a control
+				 * character if subtracting 31 with saturation yields zero.
+				 */
+				while (p < end - sizeof(Vector8))
+				{
+					Vector8		chunk;
+					Vector8		special;
+					uint32		mask;
+
+					vector8_load(&chunk, (const uint8 *) p);
+					special = vector8_or(vector8_eq(chunk, backslash),
+										 vector8_eq(chunk, quote));
+					special = vector8_or(special,
+										 vector8_eq(vector8_ssub(chunk, ctrl),
+													zero));
+					mask = vector8_highbit_mask(special);
+					if (mask != 0)
+					{
+						p += pg_rightmost_one_pos32(mask);
+						break;
+					}
+					p += sizeof(Vector8);
+				}
+			}
+#else
 			while (p < end - sizeof(Vector8) &&
 				   !pg_lfind8('\\', (uint8 *) p, sizeof(Vector8)) &&
 				   !pg_lfind8('"', (uint8 *) p, sizeof(Vector8)) &&
 				   !pg_lfind8_le(31, (uint8 *) p, sizeof(Vector8)))
 				p += sizeof(Vector8);
+#endif
 
 			for (; p < end; p++)
 			{
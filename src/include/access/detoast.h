@@ -33,6 +33,19 @@ do { \
 /* Size of an EXTERNAL datum that contains an indirection pointer */
 #define INDIRECT_POINTER_SIZE (VARHDRSZ_EXTERNAL + sizeof(varatt_indirect))
 
+/*
+ * State of incremental detoasting of a value from the front, see
+ * detoast_iterate_init().
+ */
+typedef struct DetoastIterator
+{
+	struct varlena *attr;		/* value to detoast, possibly still toasted */
+	struct varlena *buf;		/* detoasted prefix, or NULL */
+	int32		rawsize;		/* size of the whole detoasted data */
+	bool		append;			/* can we fetch just the missing part? */
+	bool		done;			/* does buf contain the whole value? */
+} DetoastIterator;
+
 /* ----------
  * detoast_external_attr() -
  *
@@ -63,6 +76,17 @@ extern struct varlena *detoast_attr_slice(struct varlena *attr,
 										  int32 sliceoffset,
 										  int32 slicelength);
 
+/* ----------
+ * detoast_iterate_init() -
+ * detoast_iterate() -
+ *
+ *		Detoast an attribute incrementally, from the front, as far as
+ *		the caller needs it.
+ * ----------
+ */
+extern void detoast_iterate_init(DetoastIterator *iter, struct varlena *attr);
+extern char *detoast_iterate(DetoastIterator *iter, Size length);
+
 /* ----------
  * toast_raw_datum_size -
  *
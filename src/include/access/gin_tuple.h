@@ -0,0 +1,47 @@
+/*--------------------------------------------------------------------------
+ * gin_tuple.h
+ *	  Definitions for the tuples passed around during a parallel GIN build.
+ *
+ *	Copyright (c) 2006-2023, PostgreSQL Global Development Group
+ *
+ *	src/include/access/gin_tuple.h
+ *--------------------------------------------------------------------------
+ */
+#ifndef GIN_TUPLE_H
+#define GIN_TUPLE_H
+
+#include "access/ginblock.h"
+#include "storage/itemptr.h"
+#include "utils/sortsupport.h"
+
+/*
+ * Data for one key in a parallel GIN build: the key itself, followed by the
+ * array of heap TIDs for it, in ascending order.  Participants pass these to
+ * the leader through a tuplesort.
+ *
+ * The key datum (for a normal key) starts at a MAXALIGN'd offset, so that
+ * the leader can use it in place; the TIDs follow at a SHORTALIGN'd offset.
+ */
+typedef struct GinTuple
+{
+	int			tuplen;			/* length of the whole tuple */
+	OffsetNumber attrnum;		/* attnum of index key */
+	int16		typlen;			/* typlen for key */
+	bool		typbyval;		/* typbyval for key */
+	signed char category;		/* category: normal or NULL? */
+	int			keylen;			/* bytes in data for key value */
+	int			nitems;			/* number of TIDs in the data */
+} GinTuple;
+
+#define GinTupleKeyOffset	MAXALIGN(sizeof(GinTuple))
+
+#define GinTupleGetKeyPtr(tup) \
+	((char *) (tup) + GinTupleKeyOffset)
+
+#define GinTupleGetItems(tup) \
+	((ItemPointer) ((char *) (tup) + GinTupleKeyOffset + \
+					SHORTALIGN((tup)->keylen)))
+
+extern int	_gin_compare_tuples(GinTuple *a, GinTuple *b, SortSupport ssup);
+
+#endif							/* GIN_TUPLE_H */
@@ -24,7 +24,9 @@
 #include "common/hashfn.h"
 #include "lib/stringinfo.h"
 #include "storage/bufmgr.h"
+#include "storage/dsm.h"
 #include "storage/lockdefs.h"
+#include "storage/shm_toc.h"
 #include "utils/hsearch.h"
 #include "utils/relcache.h"
 
@@ -392,6 +394,8 @@ extern void hashadjustmembers(Oid opfamilyoid,
 /* hashinsert.c */
 extern void _hash_doinsert(Relation rel, IndexTuple itup, Relation heapRel,
 						   bool sorted);
+extern void _hash_doinsert_multi(Relation rel, IndexTuple *itups, int nitups,
+								 Relation heapRel, bool sorted);
 extern OffsetNumber _hash_pgaddtup(Relation rel, Buffer buf,
 								   Size itemsize, IndexTuple itup,
 								   bool appendtup);
@@ -453,6 +457,10 @@ extern void _h_spooldestroy(HSpool *hspool);
 extern void _h_spool(HSpool *hspool, ItemPointer self,
 					 Datum *values, bool *isnull);
 extern void _h_indexbuild(HSpool *hspool, Relation heapRel);
+extern bool _h_build_parallel(Relation heap, Relation index,
+							  struct IndexInfo *indexInfo, uint32 num_buckets,
+							  double *reltuples, double *indtuples);
+extern void _hash_parallel_build_main(dsm_segment *seg, shm_toc *toc);
 
 /* hashutil.c */
 extern bool _hash_checkqual(IndexScanDesc scan, IndexTuple itup);
@@ -84,6 +84,10 @@
 #define XLH_UPDATE_CONTAINS_NEW_TUPLE			(1<<4)
 #define XLH_UPDATE_PREFIX_FROM_OLD				(1<<5)
 #define XLH_UPDATE_SUFFIX_FROM_OLD				(1<<6)
+#define XLH_UPDATE_DELTA_FROM_OLD				(1<<7)
+
+/* maximum number of changed byte ranges logged with XLH_UPDATE_DELTA_FROM_OLD */
+#define XLH_UPDATE_MAX_DELTAS					4
 
 /* convenience macro for checking whether any form of old tuple was logged */
 #define XLH_UPDATE_CONTAINS_OLD						\
@@ -204,6 +208,14 @@ typedef struct xl_multi_insert_tuple
  * data doesn't include the prefix and suffix, which are copied from the
  * old tuple on replay.
  *
+ * If XLH_UPDATE_DELTA_FROM_OLD is set instead, the new tuple's data has the
+ * same length as the old tuple's and differs from it only in a few byte
+ * ranges.  A uint16 count of ranges comes first, followed by an (offset,
+ * length) pair of uint16s for each range, counted from the start of the
+ * tuple data.  Then come xl_heap_header, the null bitmap [+ padding] [+ oid]
+ * and the bytes of each range, concatenated.  On replay, the new tuple data
+ * is the old tuple data with the ranges overwritten.
+ *
  * If XLH_UPDATE_CONTAINS_NEW_TUPLE flag is given, the tuple data is
  * included even if a full-page image was taken.
  *
@@ -1051,6 +1051,23 @@ typedef struct BTScanOpaqueData
 	BTArrayKeyInfo *arrayKeys;	/* info about each equality-type array key */
 	MemoryContext arrayContext; /* scan-lifespan context for array data */
 
+	/* workspace for skip scans (skipKeyData is NULL if not skipping) */
+	ScanKey		skipKeyData;	/* prefix key, then copy of scan->keyData */
+	FmgrInfo   *skipProcs;		/* "=", ">=" and "<=" procs for first column */
+	bool		skipHavePrefix; /* is skipPrefix valid? */
+	ScanDirection skipRangeDir; /* direction of a scan over all values from
+								 * skipPrefix on, or NoMovementScanDirection
+								 * while skipping */
+	bool		skipPrefixIsNull;
+	Datum		skipPrefix;		/* current value of first index column */
+	BlockNumber skipPrefixBlock;	/* leaf page skipPrefix was found on */
+	int			skipUseful;		/* # of skips that moved to another page */
+	int			skipUseless;	/* # of skips that stayed on the same page */
+	ScanKeyData markSkipKey;	/* prefix key at the marked position */
+	bool		markSkipHavePrefix;
+	ScanDirection markSkipRangeDir;
+	MemoryContext skipContext;	/* scan-lifespan context for skip data */
+
 	/* info about killed items if any (killedItems is NULL if never used) */
 	int		   *killedItems;	/* currPos.items indexes of killed items */
 	int			numKilled;		/* number of currently stored items */
@@ -1079,6 +1096,13 @@ typedef struct BTScanOpaqueData
 
 typedef BTScanOpaqueData *BTScanOpaque;
 
+/*
+ * A skip scan gives up skipping once it has found at least this many prefixes
+ * on the same leaf page as the previous prefix, and more of those than
+ * prefixes on other pages.  See _bt_advance_skip_scan().
+ */
+#define BT_SKIP_MIN_USELESS		8
+
 /*
  * We use some private sk_flags bits in preprocessed scan keys.  We're allowed
  * to use bits 16-31 (see skey.h).  The uppermost bits are copied from the
@@ -1131,6 +1155,9 @@ extern bool btinsert(Relation rel, Datum *values, bool *isnull,
 					 IndexUniqueCheck checkUnique,
 					 bool indexUnchanged,
 					 struct IndexInfo *indexInfo);
+extern void btinsertbatch(Relation rel, Datum *values, bool *isnull,
+						  ItemPointer ht_ctids, int ntuples, Relation heapRel,
+						  struct IndexInfo *indexInfo);
 extern IndexScanDesc btbeginscan(Relation rel, int nkeys, int norderbys);
 extern Size btestimateparallelscan(void);
 extern void btinitparallelscan(void *target);
@@ -1182,6 +1209,8 @@ extern IndexTuple _bt_swap_posting(IndexTuple newitem, IndexTuple oposting,
 extern bool _bt_doinsert(Relation rel, IndexTuple itup,
 						 IndexUniqueCheck checkUnique, bool indexUnchanged,
 						 Relation heapRel);
+extern void _bt_doinsert_batch(Relation rel, IndexTuple *itups, int ntuples,
+							   Relation heapRel);
 extern void _bt_finish_split(Relation rel, Buffer lbuf, BTStack stack);
 extern Buffer _bt_getstackbuf(Relation rel, BTStack stack, BlockNumber child);
 
@@ -1239,6 +1268,9 @@ extern bool _bt_first(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_next(IndexScanDesc scan, ScanDirection dir);
 extern Buffer _bt_get_endpoint(Relation rel, uint32 level, bool rightmost,
 							   Snapshot snapshot);
+extern bool _bt_skip_find_prefix(IndexScanDesc scan, ScanDirection dir,
+								 Datum *prefix, bool *isnull,
+								 BlockNumber *blkno);
 
 /*
  * prototypes for functions in nbtutils.c
@@ -1250,6 +1282,11 @@ extern void _bt_start_array_keys(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_advance_array_keys(IndexScanDesc scan, ScanDirection dir);
 extern void _bt_mark_array_keys(IndexScanDesc scan);
 extern void _bt_restore_array_keys(IndexScanDesc scan);
+extern void _bt_preprocess_skip_scan(IndexScanDesc scan);
+extern bool _bt_start_skip_scan(IndexScanDesc scan, ScanDirection dir);
+extern bool _bt_advance_skip_scan(IndexScanDesc scan, ScanDirection dir);
+extern void _bt_mark_skip_scan(IndexScanDesc scan);
+extern void _bt_restore_skip_scan(IndexScanDesc scan);
 extern void _bt_preprocess_keys(IndexScanDesc scan);
 extern bool _bt_checkkeys(IndexScanDesc scan, IndexTuple tuple,
 						  int tupnatts, ScanDirection dir, bool *continuescan);
@@ -42,6 +42,8 @@
 										 * FSM */
 #define XLOG_BTREE_META_CLEANUP	0xE0	/* update cleanup-related data in the
 										 * metapage */
+#define XLOG_BTREE_INSERT_MULTI	0xF0	/* add several index tuples to a leaf
+										 * page without split */
 
 /*
  * All that we need to regenerate the meta-data page
@@ -86,6 +88,27 @@ typedef struct xl_btree_insert
 
 #define SizeOfBtreeInsert	(offsetof(xl_btree_insert, offnum) + sizeof(OffsetNumber))
 
+/*
+ * This is what we need to know about a batch insert into a leaf page, with
+ * neither a page split nor a posting list split.
+ *
+ * The offset numbers follow in the main data, in the order the tuples were
+ * added to the page; each is the offset of its tuple once the tuples before
+ * it have been added.
+ *
+ * Backup Blk 0: leaf page
+ *
+ * The new tuples follow in the block data, in the same order.
+ */
+typedef struct xl_btree_insert_multi
+{
+	uint16		ntuples;
+
+	/* OFFSET NUMBERS FOLLOW */
+} xl_btree_insert_multi;
+
+#define SizeOfBtreeInsertMulti	(offsetof(xl_btree_insert_multi, ntuples) + sizeof(uint16))
+
 /*
  * On insert with split, we save all the items going into the right sibling
  * so that we can restore it completely from the log record.  This way takes
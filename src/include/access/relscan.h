@@ -164,6 +164,9 @@ typedef struct IndexScanDescData
 
 	/* parallel index scan information, in shared memory */
 	struct ParallelIndexScanDescData *parallel_scan;
+
+	/* heap prefetching state, or NULL; see index_enable_prefetch() */
+	struct IndexPrefetchData *xs_prefetch;
 }			IndexScanDescData;
 
 /* Generic structure for parallel scans */
@@ -33,6 +33,15 @@
  */
 #define SLRU_PAGES_PER_SEGMENT	32
 
+/*
+ * The buffers of an SLRU are divided into banks of this many slots, see
+ * slru.c.  The configured number of buffers must be a multiple of it.
+ */
+#define SLRU_BANK_SIZE			16
+
+/* Upper limit for the number of buffers of an SLRU (1GB of buffers) */
+#define SLRU_MAX_ALLOWED_BUFFERS	((1024 * 1024 * 1024) / BLCKSZ)
+
 /*
  * Page status codes.  Note that these do not include the "dirty" bit.
  * page_dirty can be true only in the VALID or WRITE_IN_PROGRESS states;
@@ -57,6 +66,9 @@ typedef struct SlruSharedData
 	/* Number of buffers managed by this SLRU structure */
 	int			num_slots;
 
+	/* Number of banks the buffers are divided into */
+	int			num_banks;
+
 	/*
 	 * Arrays holding info for each buffer slot.  Page number is undefined
 	 * when status is EMPTY, as is page_lru_count.
@@ -140,6 +152,8 @@ typedef SlruCtlData *SlruCtl;
 
 
 extern Size SimpleLruShmemSize(int nslots, int nlsns);
+extern bool check_slru_buffers(const char *name, int *newval);
+extern int	SimpleLruAutotuneBuffers(int divisor, int max);
 extern void SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 						  LWLock *ctllock, const char *subdir, int tranche_id,
 						  SyncRequestHandler sync_handler);
@@ -17,8 +17,13 @@
 #include "storage/block.h"
 #include "utils/relcache.h"
 
+extern PGDLLIMPORT int synchronize_seqscans_window;
+
 extern void ss_report_location(Relation rel, BlockNumber location);
 extern BlockNumber ss_get_location(Relation rel, BlockNumber relnblocks);
+extern void ss_join_group(Relation rel, BlockNumber relnblocks,
+						  BlockNumber startloc);
+extern void ss_leave_group(Relation rel);
 extern void SyncScanShmemInit(void);
 extern Size SyncScanShmemSize(void);
 
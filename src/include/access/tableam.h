@@ -30,6 +30,7 @@
 /* GUCs */
 extern PGDLLIMPORT char *default_table_access_method;
 extern PGDLLIMPORT bool synchronize_seqscans;
+extern PGDLLIMPORT int seqscan_prefetch_depth;
 
 
 struct BulkInsertStateData;
@@ -102,6 +103,22 @@ typedef enum TM_Result
 	TM_WouldBlock
 } TM_Result;
 
+/*
+ * Result codes for table_update(..., update_indexes*..).
+ * Used to determine which indexes to update.
+ */
+typedef enum TU_UpdateIndexes
+{
+	/* No indexed columns were updated (incl. TID addressing of tuple) */
+	TU_None,
+
+	/* A non-summarizing indexed column was updated, or the TID has changed */
+	TU_All,
+
+	/* Only summarized columns were updated, TID is unchanged */
+	TU_Summarizing
+} TU_UpdateIndexes;
+
 /*
  * When table_tuple_update, table_tuple_delete, or table_tuple_lock fail
  * because the target tuple is already outdated, they fill in this struct to
@@ -236,6 +253,8 @@ typedef struct TM_IndexDeleteOp
 #define TABLE_INSERT_SKIP_FSM		0x0002
 #define TABLE_INSERT_FROZEN			0x0004
 #define TABLE_INSERT_NO_LOGICAL		0x0008
+/* 0x0010 is reserved for heapam's HEAP_INSERT_SPECULATIVE */
+#define TABLE_INSERT_PARALLEL		0x0020	/* caller is a parallel worker */
 
 /* flag bits for table_tuple_lock */
 /* Follow tuples whose update is in progress if lock modes don't conflict  */
@@ -357,6 +376,23 @@ typedef struct TableAmRoutine
 											  ScanDirection direction,
 											  TupleTableSlot *slot);
 
+	/*
+	 * Optional function to tell a scan started with scan_begin which columns
+	 * of its tuples are going to be used, and which quals are going to be
+	 * checked on them.  Both are only hints that allow an AM that stores
+	 * columns separately to skip work: the AM may leave the columns that are
+	 * not in `attrs` (a set of attribute numbers) NULL in the tuples it
+	 * returns, and may skip tuples that it can prove not to satisfy `quals`
+	 * (an implicitly-ANDed list of expressions), but the caller still checks
+	 * the quals itself.  The hints stay in effect across scan_rescan.
+	 *
+	 * The planner avoids physical tlists for scans of relations whose AM
+	 * provides this function, so that the executor knows the columns needed.
+	 */
+	void		(*scan_set_projection) (TableScanDesc scan,
+										Bitmapset *attrs,
+										List *quals);
+
 	/* ------------------------------------------------------------------------
 	 * Parallel table scan related functions.
 	 * ------------------------------------------------------------------------
@@ -526,7 +562,7 @@ typedef struct TableAmRoutine
 								 bool wait,
 								 TM_FailureData *tmfd,
 								 LockTupleMode *lockmode,
-								 bool *update_indexes);
+								 TU_UpdateIndexes *update_indexes);
 
 	/* see table_tuple_lock() for reference about parameters */
 	TM_Result	(*tuple_lock) (Relation rel,
@@ -1050,6 +1086,17 @@ table_scan_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableS
 	return sscan->rs_rd->rd_tableam->scan_getnextslot(sscan, direction, slot);
 }
 
+/*
+ * Tell `sscan` which columns and quals are going to be used, if the AM cares;
+ * see scan_set_projection.
+ */
+static inline void
+table_scan_set_projection(TableScanDesc sscan, Bitmapset *attrs, List *quals)
+{
+	if (sscan->rs_rd->rd_tableam->scan_set_projection != NULL)
+		sscan->rs_rd->rd_tableam->scan_set_projection(sscan, attrs, quals);
+}
+
 /* ----------------------------------------------------------------------------
  * TID Range scanning related functions.
  * ----------------------------------------------------------------------------
@@ -1493,8 +1540,10 @@ table_tuple_delete(Relation rel, ItemPointer tid, CommandId cid,
  * Output parameters:
  *	tmfd - filled in failure cases (see below)
  *	lockmode - filled with lock mode acquired on tuple
- *  update_indexes - in success cases this is set to true if new index entries
- *		are required for this tuple
+ *  update_indexes - in success cases this is set to TU_All if new entries
+ *		are required in all of the table's indexes, to TU_Summarizing if only
+ *		summarizing indexes need to be told about the new tuple, and to
+ *		TU_None if no index entries are required
  *
  * Normal, successful return value is TM_Ok, which means we did actually
  * update it.  Failure return codes are TM_SelfModified, TM_Updated, and
@@ -1514,7 +1563,7 @@ static inline TM_Result
 table_tuple_update(Relation rel, ItemPointer otid, TupleTableSlot *slot,
 				   CommandId cid, Snapshot snapshot, Snapshot crosscheck,
 				   bool wait, TM_FailureData *tmfd, LockTupleMode *lockmode,
-				   bool *update_indexes)
+				   TU_UpdateIndexes *update_indexes)
 {
 	return rel->rd_tableam->tuple_update(rel, otid, slot,
 										 cid, snapshot, crosscheck,
@@ -2038,7 +2087,7 @@ extern void simple_table_tuple_delete(Relation rel, ItemPointer tid,
 									  Snapshot snapshot);
 extern void simple_table_tuple_update(Relation rel, ItemPointer otid,
 									  TupleTableSlot *slot, Snapshot snapshot,
-									  bool *update_indexes);
+									  TU_UpdateIndexes *update_indexes);
 
 
 /* ----------------------------------------------------------------------------
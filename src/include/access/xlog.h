@@ -37,6 +37,7 @@ extern PGDLLIMPORT int max_wal_size_mb;
 extern PGDLLIMPORT int wal_keep_size_mb;
 extern PGDLLIMPORT int max_slot_wal_keep_size_mb;
 extern PGDLLIMPORT int XLOGbuffers;
+extern PGDLLIMPORT int NumXLogInsertLocks;
 extern PGDLLIMPORT int XLogArchiveTimeout;
 extern PGDLLIMPORT int wal_retrieve_retry_interval;
 extern PGDLLIMPORT char *XLogArchiveCommand;
@@ -173,6 +174,9 @@ typedef struct CheckpointStatsData
 									 * times, which is not necessarily the
 									 * same as the total elapsed time for the
 									 * entire sync phase. */
+	int			ckpt_early_sync_rels;	/* # of relations synced during the
+										 * write phase */
+	uint64		ckpt_agg_early_sync_time;	/* The sum of their sync times */
 } CheckpointStatsData;
 
 extern PGDLLIMPORT CheckpointStatsData CheckpointStats;
@@ -191,6 +195,7 @@ typedef enum WALAvailability
 } WALAvailability;
 
 struct XLogRecData;
+struct XLogRecord;
 struct XLogReaderState;
 
 extern XLogRecPtr XLogInsertRecord(struct XLogRecData *rdata,
@@ -198,9 +203,14 @@ extern XLogRecPtr XLogInsertRecord(struct XLogRecData *rdata,
 								   uint8 flags,
 								   int num_fpi,
 								   bool topxid_included);
+extern void XLogInsertRecordBatch(int nrecords, struct XLogRecord **records,
+								  const uint8 *flags, int num_fpi,
+								  bool topxid_included, XLogRecPtr *EndPtrs);
 extern void XLogFlush(XLogRecPtr record);
 extern bool XLogBackgroundFlush(void);
 extern bool XLogNeedsFlush(XLogRecPtr record);
+extern Size XLogReadFromBuffers(char *buf, XLogRecPtr startptr, Size count,
+								TimeLineID tli);
 extern int	XLogFileInit(XLogSegNo logsegno, TimeLineID logtli);
 extern int	XLogFileOpen(XLogSegNo segno, TimeLineID tli);
 
@@ -224,6 +234,11 @@ extern XLogRecPtr GetXLogWriteRecPtr(void);
 extern uint64 GetSystemIdentifier(void);
 extern char *GetMockAuthenticationNonce(void);
 extern bool DataChecksumsEnabled(void);
+extern bool DataChecksumsNeedVerify(void);
+extern uint32 GetDataChecksumVersion(void);
+extern void InitLocalDataChecksumVersion(void);
+extern bool ProcessBarrierChecksumState(void);
+extern void SetDataChecksumVersion(uint32 version);
 extern XLogRecPtr GetFakeLSNForUnloggedRel(void);
 extern Size XLOGShmemSize(void);
 extern void XLOGShmemInit(void);
@@ -278,6 +293,8 @@ typedef enum SessionBackupState
 	SESSION_BACKUP_RUNNING,
 } SessionBackupState;
 
+extern void get_backup_tablespaces(List **tablespaces,
+								   StringInfo tblspcmapfile);
 extern void do_pg_backup_start(const char *backupidstr, bool fast,
 							   List **tablespaces, BackupState *state,
 							   StringInfo tblspcmapfile);
@@ -31,7 +31,7 @@
 /*
  * Each page of XLOG file has a header like this:
  */
-#define XLOG_PAGE_MAGIC 0xD112	/* can be used as WAL version indicator */
+#define XLOG_PAGE_MAGIC 0xD114	/* can be used as WAL version indicator */
 
 typedef struct XLogPageHeaderData
 {
@@ -282,6 +282,12 @@ typedef struct xl_parameter_change
 	bool		track_commit_timestamp;
 } xl_parameter_change;
 
+/* logs a change of the data checksum version, see SetDataChecksumVersion() */
+typedef struct xl_checksum_state
+{
+	uint32		new_checksumtype;
+} xl_checksum_state;
+
 /* logs restore point */
 typedef struct xl_restore_point
 {
@@ -28,6 +28,9 @@ typedef struct BackupState
 	XLogRecPtr	checkpointloc;	/* last checkpoint location */
 	pg_time_t	starttime;		/* backup start time */
 	bool		started_in_recovery;	/* backup started in recovery? */
+	XLogRecPtr	incremental_lsn;	/* start WAL location of the backup this
+									 * one is incremental to, if any */
+	TimeLineID	incremental_tli;	/* start TLI of that backup */
 
 	/* Fields saved at the end of backup */
 	XLogRecPtr	stoppoint;		/* backup stop WAL location */
@@ -27,6 +27,9 @@
 #define XLR_NORMAL_MAX_BLOCK_ID		4
 #define XLR_NORMAL_RDATAS			20
 
+/* maximum number of records in a batch, see XLogBeginBatch() */
+#define XLR_MAX_BATCH_RECORDS		16
+
 /* flags for XLogRegisterBuffer */
 #define REGBUF_FORCE_IMAGE	0x01	/* force a full-page image */
 #define REGBUF_NO_IMAGE		0x02	/* don't take a full-page image */
@@ -51,6 +54,9 @@ extern void XLogRegisterBlock(uint8 block_id, RelFileLocator *rlocator,
 extern void XLogRegisterBufData(uint8 block_id, char *data, uint32 len);
 extern void XLogResetInsertion(void);
 extern bool XLogCheckBufferNeedsBackup(Buffer buffer);
+extern void XLogBeginBatch(void);
+extern void XLogBatchAdd(RmgrId rmid, uint8 info);
+extern XLogRecPtr XLogEndBatch(XLogRecPtr *endptrs);
 
 extern XLogRecPtr log_newpage(RelFileLocator *rlocator, ForkNumber forknum,
 							  BlockNumber blkno, char *page, bool page_std);
@@ -17,6 +17,13 @@
  */
 extern PGDLLIMPORT char *XLogArchiveLibrary;
 
+/*
+ * The value of the archive_batch_size GUC, and its upper limit.
+ */
+extern PGDLLIMPORT int archive_batch_size;
+
+#define MAX_ARCHIVE_BATCH_SIZE	64
+
 typedef struct ArchiveModuleState
 {
 	/*
@@ -32,13 +39,18 @@ typedef struct ArchiveModuleState
  *
  * These callback functions should be defined by archive libraries and returned
  * via _PG_archive_module_init().  ArchiveFileCB is the only required callback.
- * For more information about the purpose of each callback, refer to the
- * archive modules documentation.
+ * ArchiveFilesCB is used instead of it to archive several files at once if
+ * archive_batch_size is set; it must set archived[i] for each file that was
+ * successfully archived.  For more information about the purpose of each
+ * callback, refer to the archive modules documentation.
  */
 typedef void (*ArchiveStartupCB) (ArchiveModuleState *state);
 typedef bool (*ArchiveCheckConfiguredCB) (ArchiveModuleState *state);
 typedef bool (*ArchiveFileCB) (ArchiveModuleState *state, const char *file, const char *path);
 typedef void (*ArchiveShutdownCB) (ArchiveModuleState *state);
+typedef void (*ArchiveFilesCB) (ArchiveModuleState *state, int nfiles,
+								const char *const *files,
+								const char *const *paths, bool *archived);
 
 typedef struct ArchiveModuleCallbacks
 {
@@ -46,6 +58,7 @@ typedef struct ArchiveModuleCallbacks
 	ArchiveCheckConfiguredCB check_configured_cb;
 	ArchiveFileCB archive_file_cb;
 	ArchiveShutdownCB shutdown_cb;
+	ArchiveFilesCB archive_files_cb;
 } ArchiveModuleCallbacks;
 
 /*
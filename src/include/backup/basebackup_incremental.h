@@ -0,0 +1,43 @@
+/*-------------------------------------------------------------------------
+ *
+ * basebackup_incremental.h
+ *	  Format of the files sent by an incremental base backup.
+ *
+ * When a base backup is taken with the INCREMENTAL option, a relation file
+ * of which only some blocks were modified since the earlier backup is sent
+ * as a file named INCREMENTAL.<name> in the same directory, containing a
+ * header followed by the modified blocks.  The header is:
+ *
+ * uint32	magic number, INCREMENTAL_MAGIC
+ * uint32	number of blocks included in the file
+ * uint32	length of the relation file, in blocks
+ * uint32[]	block numbers of the included blocks, in increasing order
+ *
+ * and is followed by the contents of the included blocks, BLCKSZ bytes each,
+ * in the same order.  All values are in the byte order of the server.
+ *
+ * This header is also used by pg_combinebackup, so it must not depend on
+ * anything that is only available to the backend.
+ *
+ * Portions Copyright (c) 2010-2023, PostgreSQL Global Development Group
+ *
+ * src/include/backup/basebackup_incremental.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef BASEBACKUP_INCREMENTAL_H
+#define BASEBACKUP_INCREMENTAL_H
+
+#define INCREMENTAL_MAGIC			0xd3ae1f0d
+#define INCREMENTAL_PREFIX			"INCREMENTAL."
+#define INCREMENTAL_PREFIX_LENGTH	(sizeof(INCREMENTAL_PREFIX) - 1)
+
+/* Fixed-size part of the header of an incremental file */
+typedef struct IncrementalFileHeader
+{
+	uint32		magic;
+	uint32		num_blocks;
+	uint32		truncation_block_length;
+} IncrementalFileHeader;
+
+#endif							/* BASEBACKUP_INCREMENTAL_H */
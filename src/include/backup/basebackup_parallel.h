@@ -0,0 +1,31 @@
+/*-------------------------------------------------------------------------
+ *
+ * basebackup_parallel.h
+ *	  Coordination of the streams of a parallel base backup.
+ *
+ * Portions Copyright (c) 2010-2023, PostgreSQL Global Development Group
+ *
+ * src/include/backup/basebackup_parallel.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef BASEBACKUP_PARALLEL_H
+#define BASEBACKUP_PARALLEL_H
+
+#include "access/xlogdefs.h"
+
+extern Size BaseBackupParallelShmemSize(void);
+extern void BaseBackupParallelShmemInit(void);
+
+extern void ParallelBackupBegin(int nparts, XLogRecPtr startptr,
+								TimeLineID starttli);
+extern void ParallelBackupWaitForParts(void);
+extern void ParallelBackupEnd(void);
+
+extern void ParallelBackupAttach(int leader_pid, int part, int nparts,
+								 XLogRecPtr *startptr, TimeLineID *starttli);
+extern void ParallelBackupPartDone(void);
+
+extern void ParallelBackupAbort(void);
+
+#endif							/* BASEBACKUP_PARALLEL_H */
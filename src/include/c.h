@@ -295,6 +295,17 @@
 #define unlikely(x) ((x) != 0)
 #endif
 
+/*
+ * Hint to the CPU that the memory at the given address is going to be read
+ * soon, so that fetching it into the cache can overlap with other work.
+ * Like the above, this is for very hot code paths only.
+ */
+#ifdef __GNUC__
+#define pg_prefetch_mem(a) __builtin_prefetch(a)
+#else
+#define pg_prefetch_mem(a) ((void) (a))
+#endif
+
 /*
  * CppAsString
  *		Convert the argument to a string, using the C preprocessor.
@@ -1135,9 +1146,30 @@ typedef union PGAlignedBlock
 	int64		force_align_i64;
 } PGAlignedBlock;
 
+/*
+ * Use this to declare a field or local variable holding a page buffer that
+ * might be read or written with direct I/O (see io_direct).  Where the
+ * compiler can't promise the stricter alignment, fall back to the MAXALIGN'd
+ * variant, which is good enough when direct I/O isn't available anyway.
+ */
+#ifdef pg_attribute_aligned
+typedef union PGIOAlignedBlock
+{
+	pg_attribute_aligned(PG_IO_ALIGN_SIZE)
+	char		data[BLCKSZ];
+	double		force_align_d;
+	int64		force_align_i64;
+} PGIOAlignedBlock;
+#else
+typedef PGAlignedBlock PGIOAlignedBlock;
+#endif
+
 /* Same, but for an XLOG_BLCKSZ-sized buffer */
 typedef union PGAlignedXLogBlock
 {
+#ifdef pg_attribute_aligned
+	pg_attribute_aligned(PG_IO_ALIGN_SIZE)
+#endif
 	char		data[XLOG_BLCKSZ];
 	double		force_align_d;
 	int64		force_align_i64;
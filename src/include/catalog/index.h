@@ -14,6 +14,7 @@
 #ifndef INDEX_H
 #define INDEX_H
 
+#include "access/xlogdefs.h"
 #include "catalog/objectaddress.h"
 #include "nodes/execnodes.h"
 
@@ -47,6 +48,8 @@ typedef struct ReindexParams
 typedef struct ValidateIndexState
 {
 	Tuplesortstate *tuplesort;	/* for sorting the index TIDs */
+	XLogRecPtr	startlsn;		/* heap pages with an older LSN need not be
+								 * examined, or Invalid to examine all */
 	/* statistics (for debug purposes only): */
 	double		htups,
 				itups,
@@ -142,7 +145,8 @@ extern void index_build(Relation heapRelation,
 						bool isreindex,
 						bool parallel);
 
-extern void validate_index(Oid heapId, Oid indexId, Snapshot snapshot);
+extern void validate_index(Oid heapId, Oid indexId, Snapshot snapshot,
+						   XLogRecPtr startlsn);
 
 extern void index_set_state_flags(Oid indexId, IndexStateFlagsAction action);
 
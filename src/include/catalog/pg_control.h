@@ -78,6 +78,7 @@ typedef struct CheckPoint
 #define XLOG_FPI						0xB0
 /* 0xC0 is used in Postgres 9.5-11 */
 #define XLOG_OVERWRITE_CONTRECORD		0xD0
+#define XLOG_CHECKSUMS					0xE0
 
 
 /*
@@ -216,7 +217,11 @@ typedef struct ControlFileData
 
 	bool		float8ByVal;	/* float8, int8, etc pass-by-value? */
 
-	/* Are data pages protected by checksums? Zero if no checksum version */
+	/*
+	 * Are data pages protected by checksums? Zero if no checksum version.
+	 * PG_DATA_CHECKSUM_INPROGRESS_VERSION while checksums are being enabled
+	 * or disabled in a running cluster.
+	 */
 	uint32		data_checksum_version;
 
 	/*
@@ -14,6 +14,7 @@
 #ifndef COPY_H
 #define COPY_H
 
+#include "access/parallel.h"
 #include "nodes/execnodes.h"
 #include "nodes/parsenodes.h"
 #include "parser/parse_node.h"
@@ -32,8 +33,9 @@ typedef enum CopyHeaderChoice
 
 /*
  * A struct to hold COPY options, in a parsed form. All of these are related
- * to formatting, except for 'freeze', which doesn't really belong here, but
- * it's expedient to parse it along with all the other options.
+ * to formatting, except for 'freeze' and 'parallel_workers', which don't
+ * really belong here, but it's expedient to parse them along with all the
+ * other options.
  */
 typedef struct CopyFormatOptions
 {
@@ -42,6 +44,7 @@ typedef struct CopyFormatOptions
 								 * -1 if not specified */
 	bool		binary;			/* binary format? */
 	bool		freeze;			/* freeze rows on loading? */
+	int			parallel_workers;	/* # of parallel workers, or 0 */
 	bool		csv_mode;		/* Comma Separated Value format? */
 	CopyHeaderChoice header_line;	/* header line? */
 	char	   *null_print;		/* NULL marker string (server encoding!) */
@@ -84,6 +87,7 @@ extern bool NextCopyFromRawFields(CopyFromState cstate,
 extern void CopyFromErrorCallback(void *arg);
 
 extern uint64 CopyFrom(CopyFromState cstate);
+extern void ParallelCopyMain(dsm_segment *seg, shm_toc *toc);
 
 extern DestReceiver *CreateCopyDestReceiver(void);
 
@@ -95,6 +99,7 @@ extern CopyToState BeginCopyTo(ParseState *pstate, Relation rel, RawStmt *raw_qu
 							   copy_data_dest_cb data_dest_cb, List *attnamelist, List *options);
 extern void EndCopyTo(CopyToState cstate);
 extern uint64 DoCopyTo(CopyToState cstate);
+extern void ParallelCopyToMain(dsm_segment *seg, shm_toc *toc);
 extern List *CopyGetAttnums(TupleDesc tupDesc, Relation rel,
 							List *attnamelist);
 
@@ -16,6 +16,7 @@
 
 #include "commands/copy.h"
 #include "commands/trigger.h"
+#include "storage/shm_mq.h"
 
 /*
  * Represents the different source cases we need to worry about at
@@ -78,6 +79,8 @@ typedef struct CopyFromStateData
 	CopyFormatOptions opts;
 	bool	   *convert_select_flags;	/* per-column CSV/TEXT CS flags */
 	Node	   *whereClause;	/* WHERE condition (or NULL) */
+	List	   *attnamelist;	/* column names as given, or NIL */
+	List	   *options;		/* List of DefElem nodes as given */
 
 	/* these are just for error messages, see CopyFromErrorCallback */
 	const char *cur_relname;	/* table name for error messages */
@@ -169,9 +172,24 @@ typedef struct CopyFromStateData
 #define RAW_BUF_BYTES(cstate) ((cstate)->raw_buf_len - (cstate)->raw_buf_index)
 
 	uint64		bytes_processed;	/* number of bytes processed so far */
+
+	/*
+	 * In a parallel COPY worker, input lines are received from the leader
+	 * through pcopy_mqh instead of being read from copy_src.  pcopy_chunk
+	 * points to the not yet processed part of the last message received.
+	 */
+	shm_mq_handle *pcopy_mqh;
+	char	   *pcopy_chunk;
+	Size		pcopy_chunk_len;
 } CopyFromStateData;
 
 extern void ReceiveCopyBegin(CopyFromState cstate);
 extern void ReceiveCopyBinaryHeader(CopyFromState cstate);
+extern bool NextCopyFromLine(CopyFromState cstate);
+
+/* in copyfromparallel.c */
+extern bool ParallelCopyFromIsSafe(CopyFromState cstate);
+extern uint64 ParallelCopyFrom(CopyFromState cstate);
+extern bool ParallelCopyReadLine(CopyFromState cstate);
 
 #endif							/* COPYFROM_INTERNAL_H */
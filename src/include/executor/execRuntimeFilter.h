@@ -0,0 +1,78 @@
+/*-------------------------------------------------------------------------
+ *
+ * execRuntimeFilter.h
+ *	  Support for Bloom filters that hash joins push down into scans.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/execRuntimeFilter.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXECRUNTIMEFILTER_H
+#define EXECRUNTIMEFILTER_H
+
+#include "access/parallel.h"
+#include "lib/bloomfilter.h"
+#include "nodes/execnodes.h"
+
+extern PGDLLIMPORT bool enable_runtime_filter;
+
+/*
+ * A RuntimeFilter lets a scan below the outer side of a hash join discard
+ * tuples that cannot have a join partner, before they travel up through the
+ * rest of the plan.  The Hash node adds the hash value of every inner tuple
+ * to the Bloom filter while it builds the hash table; the scan computes the
+ * hash value the join would compute for each of its tuples, and drops those
+ * that the filter lacks.
+ */
+typedef struct RuntimeFilter
+{
+	PlanState  *scanstate;		/* scan that applies the filter */
+	bool		from_leader;	/* built above a Gather, in the leader? */
+
+	/* the join keys, as expressions over the scan's result tuple */
+	int			nkeys;
+	List	   *keyexprs;		/* list of Expr */
+	List	   *keystates;		/* list of ExprState */
+	Oid		   *hashoperators;	/* join operators */
+	Oid		   *collations;
+	FmgrInfo   *hashfunctions;	/* outer-side hash functions */
+	bool	   *hashStrict;		/* is each join operator strict? */
+	ExprContext *econtext;		/* for evaluating the keys */
+
+	/* the filter itself, complete once the hash table has been built */
+	bloom_filter *bloom;
+	bool		ready;			/* is bloom complete? */
+	bool		bloom_shared;	/* does bloom point into the DSM segment? */
+
+	/* statistics for deciding whether the filter is worth checking */
+	uint64		nchecked;
+	uint64		nremoved;
+	bool		disabled;
+
+	/* set by ExecRuntimeFiltersInitializeDSM(), in the leader */
+	struct SharedRuntimeFilter *shared;
+} RuntimeFilter;
+
+extern RuntimeFilter *ExecPushDownRuntimeFilter(PlanState *outerstate,
+												List *hashkeys,
+												List *hashoperators,
+												List *hashcollations);
+extern void ExecRuntimeFilterBegin(RuntimeFilter *rf, double ntuples);
+extern void ExecRuntimeFilterAdd(RuntimeFilter *rf, uint32 hashvalue);
+extern void ExecRuntimeFilterFinish(RuntimeFilter *rf);
+extern void ExecRuntimeFilterReset(RuntimeFilter *rf);
+extern bool ExecRuntimeFiltersPass(PlanState *scanstate, List *filters,
+								   TupleTableSlot *slot);
+
+extern void ExecRuntimeFiltersEstimate(List *filters, ParallelContext *pcxt);
+extern void ExecRuntimeFiltersInitializeDSM(List *filters, int plan_node_id,
+											ParallelContext *pcxt);
+extern void ExecRuntimeFiltersReInitializeDSM(List *filters);
+extern List *ExecRuntimeFiltersInitializeWorker(PlanState *scanstate,
+												List *filters,
+												ParallelWorkerContext *pwcxt);
+
+#endif							/* EXECRUNTIMEFILTER_H */
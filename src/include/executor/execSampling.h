@@ -0,0 +1,41 @@
+/*-------------------------------------------------------------------------
+ * execSampling.h
+ *		Sampling of the plan nodes executed by running queries
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/include/executor/execSampling.h
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef EXECSAMPLING_H
+#define EXECSAMPLING_H
+
+#include "nodes/execnodes.h"
+
+/*
+ * The plan node that is currently being executed, as seen by the sampling
+ * timer.  queryId is zero when no sampled plan node is running.
+ */
+typedef struct ExecSampleNode
+{
+	uint64		queryId;		/* query identifier of the executing plan */
+	int			plan_node_id;	/* plan_node_id of the node */
+	NodeTag		node_tag;		/* type of the Plan node */
+} ExecSampleNode;
+
+/* GUC variable: sampling interval in milliseconds, 0 disables sampling */
+extern PGDLLIMPORT int query_sample_interval;
+
+extern PGDLLIMPORT ExecSampleNode CurrentSampleNode;
+
+extern void ExecSampleStart(EState *estate);
+extern void ExecSampleEnd(EState *estate);
+extern void QuerySampleTimeoutHandler(void);
+
+extern Size QuerySampleShmemSize(void);
+extern void QuerySampleShmemInit(void);
+
+#endif							/* EXECSAMPLING_H */
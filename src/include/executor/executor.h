@@ -198,6 +198,10 @@ extern void standard_ExecutorFinish(QueryDesc *queryDesc);
 extern void ExecutorEnd(QueryDesc *queryDesc);
 extern void standard_ExecutorEnd(QueryDesc *queryDesc);
 extern void ExecutorRewind(QueryDesc *queryDesc);
+extern bool ExecPlanIsReusable(PlannedStmt *plannedstmt);
+extern void ExecutorSuspend(QueryDesc *queryDesc);
+extern void ExecutorResume(QueryDesc *queryDesc, ParamListInfo params,
+						   Snapshot snapshot);
 extern bool ExecCheckPermissions(List *rangeTable,
 								 List *rteperminfos, bool ereport_on_violation);
 extern void CheckValidResultRel(ResultRelInfo *resultRelInfo, CmdType operation);
@@ -245,6 +249,11 @@ extern void ExecEndNode(PlanState *node);
 extern void ExecShutdownNode(PlanState *node);
 extern void ExecSetTupleBound(int64 tuples_needed, PlanState *child_node);
 
+/*
+ * functions in execBatch.c
+ */
+extern int	ExecProcNodeBatch(PlanState *node, struct TupleBatch *batch);
+
 
 /* ----------------------------------------------------------------
  *		ExecProcNode
@@ -620,7 +629,15 @@ extern List *ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 								   TupleTableSlot *slot, EState *estate,
 								   bool update,
 								   bool noDupErr,
-								   bool *specConflict, List *arbiterIndexes);
+								   bool *specConflict, List *arbiterIndexes,
+								   bool onlySummarizing);
+extern bool *ExecInsertIndexTuplesBatch(ResultRelInfo *resultRelInfo,
+										TupleTableSlot **slots, int nslots,
+										EState *estate);
+extern List *ExecInsertUnbatchedIndexTuples(ResultRelInfo *resultRelInfo,
+											TupleTableSlot *slot,
+											EState *estate,
+											bool *batchedIndexes);
 extern bool ExecCheckIndexConstraints(ResultRelInfo *resultRelInfo,
 									  TupleTableSlot *slot,
 									  EState *estate, ItemPointer conflictTid,
@@ -643,6 +660,9 @@ extern bool RelationFindReplTupleSeq(Relation rel, LockTupleMode lockmode,
 
 extern void ExecSimpleRelationInsert(ResultRelInfo *resultRelInfo,
 									 EState *estate, TupleTableSlot *slot);
+extern void ExecSimpleRelationMultiInsert(ResultRelInfo *resultRelInfo,
+										  EState *estate,
+										  TupleTableSlot **slots, int nslots);
 extern void ExecSimpleRelationUpdate(ResultRelInfo *resultRelInfo,
 									 EState *estate, EPQState *epqstate,
 									 TupleTableSlot *searchslot, TupleTableSlot *slot);
@@ -315,6 +315,18 @@ typedef struct HashJoinTableData
 
 	bool		growEnabled;	/* flag to shut off nbatch increases */
 
+	/*
+	 * Once growEnabled is off, a batch whose inner tuples don't fit into
+	 * spaceAllowed may be joined in several passes ("stripes"), if the join
+	 * type allows that.  Each pass loads as many of the batch's inner tuples
+	 * as fit, and then joins all of the batch's outer tuples with them.
+	 */
+	bool		stripeEnabled;	/* may a batch take several passes? */
+	bool		curbatchOverflow;	/* inner tuples of curbatch left over? */
+	int			curstripe;		/* current pass over curbatch; 0 in 1st */
+	int			stripeFileno;	/* where the next pass resumes reading */
+	off_t		stripeOffset;	/* ... curbatch's inner batch file */
+
 	double		totalTuples;	/* # tuples obtained from inner plan */
 	double		partialTuples;	/* # tuples obtained from inner plan by me */
 	double		skewTuples;		/* # tuples inserted into skew tuples */
@@ -323,8 +335,8 @@ typedef struct HashJoinTableData
 	 * These arrays are allocated for the life of the hash join, but only if
 	 * nbatch > 1.  A file is opened only when we first write a tuple into it
 	 * (otherwise its pointer remains NULL).  Note that the zero'th array
-	 * elements never get used, since we will process rather than dump out any
-	 * tuples of batch zero.
+	 * elements are only used when batch zero needs several passes; otherwise
+	 * we process rather than dump out any tuples of batch zero.
 	 */
 	BufFile   **innerBatchFile; /* buffered virtual temp file per batch */
 	BufFile   **outerBatchFile; /* buffered virtual temp file per batch */
@@ -351,6 +363,15 @@ typedef struct HashJoinTableData
 	/* used for dense allocation of tuples (into linked chunks) */
 	HashMemoryChunk chunks;		/* one list for the whole batch */
 
+	/*
+	 * Probe index over the tuples of the in-memory buckets, or NULL.  It's
+	 * an open-addressing table of slots, arranged in groups whose one-byte
+	 * tags are compared all at once; see ExecHashBuildProbeIndex().
+	 */
+	int			probeNumGroups; /* # groups (a power of 2) */
+	uint8	   *probeTags;		/* tag of each slot, 0 if empty */
+	HashJoinTuple *probeTuples; /* tuple in each slot */
+
 	/* Shared and private state for Parallel Hash. */
 	HashMemoryChunk current_chunk;	/* this backend's current chunk */
 	dsa_area   *area;			/* DSA area to allocate memory from */
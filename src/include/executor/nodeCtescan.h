@@ -14,10 +14,19 @@
 #ifndef NODECTESCAN_H
 #define NODECTESCAN_H
 
+#include "access/parallel.h"
 #include "nodes/execnodes.h"
 
 extern CteScanState *ExecInitCteScan(CteScan *node, EState *estate, int eflags);
 extern void ExecEndCteScan(CteScanState *node);
 extern void ExecReScanCteScan(CteScanState *node);
+extern void ExecShutdownCteScan(CteScanState *node);
+
+/* parallel scan support */
+extern void ExecCteScanEstimate(CteScanState *node, ParallelContext *pcxt);
+extern void ExecCteScanInitializeDSM(CteScanState *node, ParallelContext *pcxt);
+extern void ExecCteScanReInitializeDSM(CteScanState *node, ParallelContext *pcxt);
+extern void ExecCteScanInitializeWorker(CteScanState *node,
+										ParallelWorkerContext *pwcxt);
 
 #endif							/* NODECTESCAN_H */
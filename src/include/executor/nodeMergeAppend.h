@@ -20,4 +20,6 @@ extern MergeAppendState *ExecInitMergeAppend(MergeAppend *node, EState *estate,
 extern void ExecEndMergeAppend(MergeAppendState *node);
 extern void ExecReScanMergeAppend(MergeAppendState *node);
 
+extern void ExecAsyncMergeAppendResponse(AsyncRequest *areq);
+
 #endif							/* NODEMERGEAPPEND_H */
@@ -100,6 +100,16 @@ typedef struct _SPI_plan
 	Oid		   *argtypes;		/* Argument types (NULL if nargs is 0) */
 	ParserSetupHook parserSetup;	/* alternative parameter spec method */
 	void	   *parserSetupArg;
+
+	/*
+	 * For a saved plan with a single CachedPlanSource, the generic plan last
+	 * obtained from GetCachedPlan, and the (sub)transaction we obtained it
+	 * in.  While we're still in that subtransaction, the plan's locks are
+	 * held and CachedPlanIsStillValid can be used instead of GetCachedPlan.
+	 */
+	CachedPlan *locked_cplan;
+	LocalTransactionId locked_lxid;
+	SubTransactionId locked_subid;
 } _SPI_plan;
 
 #endif							/* SPI_PRIV_H */
@@ -0,0 +1,69 @@
+/*-------------------------------------------------------------------------
+ *
+ * tuplebatch.h
+ *	  columnar batches of tuples, exchanged between executor nodes
+ *
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/tuplebatch.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef TUPLEBATCH_H
+#define TUPLEBATCH_H
+
+#include "executor/tuptable.h"
+#include "nodes/pg_list.h"
+
+/*
+ * Default number of rows in a batch.  Large enough to amortize the
+ * per-call overhead of the executor, small enough for the column arrays of
+ * a typical batch to stay in the CPU caches.
+ */
+#define TUPLE_BATCH_ROWS	64
+
+/*----------
+ * A TupleBatch holds up to maxrows tuples of a given descriptor, stored
+ * column-wise: values[attno][row] and isnull[attno][row] (with zero-based
+ * attno) describe one column of one row.  Columns of all rows are always
+ * fully deformed.
+ *
+ * Pass-by-reference values are copied into the batch's own memory context
+ * when a row is added, so that they stay valid after the slot they came
+ * from has moved on.  They remain valid until the batch is reset, which
+ * happens at the start of every ExecProcNodeBatch() call.
+ *----------
+ */
+typedef struct TupleBatch
+{
+	TupleDesc	tupdesc;		/* descriptor of the stored tuples */
+	int			natts;			/* number of columns in each row */
+	int			maxrows;		/* capacity of the column arrays */
+	int			nrows;			/* number of valid rows */
+	Datum	  **values;			/* per-column arrays of values */
+	bool	  **isnull;			/* per-column arrays of null flags */
+	MemoryContext batch_cxt;	/* memory for pass-by-reference values */
+} TupleBatch;
+
+#define TupleBatchIsFull(batch) ((batch)->nrows >= (batch)->maxrows)
+
+/* in executor/execBatch.c */
+extern TupleBatch *MakeTupleBatch(TupleDesc tupdesc, int maxrows);
+extern void TupleBatchReset(TupleBatch *batch);
+extern void TupleBatchAddSlot(TupleBatch *batch, TupleTableSlot *slot);
+extern TupleTableSlot *ExecStoreBatchRow(TupleBatch *batch, int row,
+										 TupleTableSlot *slot);
+extern void TupleBatchKeepRows(TupleBatch *batch, int start,
+							   const int *sel, int nsel);
+extern void FreeTupleBatch(TupleBatch *batch);
+
+/* in executor/execBatchExpr.c */
+typedef struct BatchQualState BatchQualState;
+
+extern BatchQualState *ExecInitBatchQual(List *qual, TupleDesc desc);
+extern int	ExecBatchQual(BatchQualState *state, TupleBatch *batch, int start,
+						  int **selp);
+
+#endif							/* TUPLEBATCH_H */
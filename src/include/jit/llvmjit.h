@@ -113,6 +113,10 @@ extern bool llvm_compile_expr(struct ExprState *state);
 struct TupleTableSlotOps;
 extern LLVMValueRef slot_compile_deform(struct LLVMJitContext *context, TupleDesc desc,
 										const struct TupleTableSlotOps *ops, int natts);
+extern LLVMValueRef slot_compile_deform_cached(struct LLVMJitContext *context,
+											   TupleDesc desc,
+											   const struct TupleTableSlotOps *ops,
+											   int natts);
 
 /*
  ****************************************************************************
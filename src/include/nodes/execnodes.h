@@ -57,6 +57,7 @@ struct RangeTblEntry;			/* avoid including parsenodes.h here */
 struct ExprEvalStep;			/* avoid including execExpr.h everywhere */
 struct CopyMultiInsertBuffer;
 struct LogicalTapeSet;
+struct TupleBatch;
 
 
 /* ----------------
@@ -704,6 +705,14 @@ typedef struct EState
 	struct JitContext *es_jit;
 	struct JitInstrumentation *es_jit_worker_instr;
 
+	/*
+	 * es_sampling is set when the plan nodes are to be executed through a
+	 * wrapper that lets the sampling timer see them; es_sample_timer is set
+	 * if this query armed the timer.  See execSampling.c.
+	 */
+	bool		es_sampling;
+	bool		es_sample_timer;
+
 	/*
 	 * Lists of ResultRelInfos for foreign tables on which batch-inserts are
 	 * to be executed and owning ModifyTableStates, stored in the same order.
@@ -788,6 +797,7 @@ typedef struct TupleHashEntryData
 {
 	MinimalTuple firstTuple;	/* copy of first tuple in this group */
 	void	   *additional;		/* user data */
+	Datum		key;			/* grouping key, if the table has inline_key */
 	uint32		status;			/* hash status */
 	uint32		hash;			/* hash value (cached) */
 } TupleHashEntryData;
@@ -812,10 +822,14 @@ typedef struct TupleHashTableData
 	MemoryContext tempcxt;		/* context for function evaluations */
 	Size		entrysize;		/* actual size to make each hash entry */
 	TupleTableSlot *tableslot;	/* slot for referencing table entries */
+	bool		inline_key;		/* entries keep their (single) key inline? */
+	uint32		null_key_hash;	/* hash value of a null key */
 	/* The following fields are set transiently for each table search: */
 	TupleTableSlot *inputslot;	/* current input tuple's slot */
 	FmgrInfo   *in_hash_funcs;	/* hash functions for input datatype(s) */
 	ExprState  *cur_eq_func;	/* comparator for input vs. table */
+	bool		cur_inline_key; /* compare inline keys? */
+	Datum		in_key;			/* current input tuple's key, if so */
 	uint32		hash_iv;		/* hash-function IV */
 	ExprContext *exprcontext;	/* expression context */
 }			TupleHashTableData;
@@ -1017,6 +1031,18 @@ typedef struct DomainConstraintState
  */
 typedef TupleTableSlot *(*ExecProcNodeMtd) (struct PlanState *pstate);
 
+/* ----------------
+ *	 ExecProcNodeBatchMtd
+ *
+ * This is the optional method called by ExecProcNodeBatch to fill a
+ * TupleBatch, already reset by the caller, with the next tuples from an
+ * executor node.  Leaving the batch empty means no more tuples are
+ * available.  The number of tuples stored is returned.
+ * ----------------
+ */
+typedef int (*ExecProcNodeBatchMtd) (struct PlanState *pstate,
+									 struct TupleBatch *batch);
+
 /* ----------------
  *		PlanState node
  *
@@ -1039,6 +1065,8 @@ typedef struct PlanState
 	ExecProcNodeMtd ExecProcNode;	/* function to return next tuple */
 	ExecProcNodeMtd ExecProcNodeReal;	/* actual function, if above is a
 										 * wrapper */
+	ExecProcNodeBatchMtd ExecProcNodeBatch; /* function to return next
+											 * batch of tuples, or NULL */
 
 	Instrumentation *instrument;	/* Optional runtime stats for this node */
 	WorkerInstrumentation *worker_instrument;	/* per-worker instrumentation */
@@ -1385,6 +1413,13 @@ typedef struct MergeAppendState
 	bool		ms_initialized; /* are subplans started? */
 	struct PartitionPruneState *ms_prune_state;
 	Bitmapset  *ms_valid_subplans;
+	Bitmapset  *ms_asyncplans;	/* asynchronous plans indexes */
+	int			ms_nasyncplans; /* # of asynchronous plans */
+	AsyncRequest **ms_asyncrequests;	/* array of AsyncRequests */
+	Bitmapset  *ms_has_asyncresults;	/* asynchronous plans whose requests
+										 * have completed */
+	struct WaitEventSet *ms_eventset;	/* WaitEventSet used to configure file
+										 * descriptor wait events */
 } MergeAppendState;
 
 /* ----------------
@@ -1470,6 +1505,10 @@ typedef struct SeqScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	Size		pscan_len;		/* size of parallel heap scan descriptor */
+	struct BatchQualState *batchqual;	/* vectorized qual, or NULL */
+	List	   *runtime_filters;	/* RuntimeFilters pushed down by joins */
+	bool		project;		/* pass projection hints to the table AM? */
+	Bitmapset  *project_attrs;	/* columns the scan needs, if so */
 } SeqScanState;
 
 /* ----------------
@@ -1530,6 +1569,7 @@ typedef struct
  *		RuntimeContext	   expr context for evaling runtime Skeys
  *		RelationDesc	   index relation descriptor
  *		ScanDesc		   index scan descriptor
+ *		PrefetchTarget	   heap prefetch distance, or 0 to not prefetch
  *
  *		ReorderQueue	   tuples that need reordering due to re-check
  *		ReachedEnd		   have we fetched all tuples from index already?
@@ -1556,6 +1596,7 @@ typedef struct IndexScanState
 	ExprContext *iss_RuntimeContext;
 	Relation	iss_RelationDesc;
 	struct IndexScanDescData *iss_ScanDesc;
+	int			iss_PrefetchTarget;
 
 	/* These are needed for re-checking ORDER BY expr ordering */
 	pairingheap *iss_ReorderQueue;
@@ -1584,6 +1625,7 @@ typedef struct IndexScanState
  *		ScanDesc		   index scan descriptor
  *		TableSlot		   slot for holding tuples fetched from the table
  *		VMBuffer		   buffer in use for visibility map testing, if any
+ *		PrefetchTarget	   heap prefetch distance, or 0 to not prefetch
  *		PscanLen		   size of parallel index-only scan descriptor
  * ----------------
  */
@@ -1603,6 +1645,7 @@ typedef struct IndexOnlyScanState
 	struct IndexScanDescData *ioss_ScanDesc;
 	TupleTableSlot *ioss_TableSlot;
 	Buffer		ioss_VMBuffer;
+	int			ioss_PrefetchTarget;
 	Size		ioss_PscanLen;
 } IndexOnlyScanState;
 
@@ -1881,6 +1924,10 @@ typedef struct TableFuncScanState
  * Multiple CteScan nodes can read out from the same CTE query.  We use
  * a tuplestore to hold rows that have been read from the CTE query but
  * not yet consumed by all readers.
+ *
+ * A parallel-aware CteScan instead reads from a shared tuplestore, which
+ * the leader fills with all the rows of the CTE before workers start.  In
+ * parallel workers, only the fields for that are valid.
  * ----------------
  */
 typedef struct CteScanState
@@ -1891,6 +1938,9 @@ typedef struct CteScanState
 	PlanState  *cteplanstate;	/* PlanState for the CTE query itself */
 	/* Link to the "leader" CteScanState (possibly this same node) */
 	struct CteScanState *leader;
+	/* Shared tuplestore of a parallel-aware scan, or NULL */
+	SharedTuplestoreAccessor *sts_accessor;
+	bool		sts_scan_started;	/* began scanning the shared tuplestore? */
 	/* The remaining fields are only valid in the "leader" CteScanState */
 	Tuplestorestate *cte_table; /* rows already read from the CTE query */
 	bool		eof_cte;		/* reached end of CTE query? */
@@ -2067,6 +2117,7 @@ typedef struct MergeJoinState
  *		hj_CurSkewBucketNo		skew bucket# for current outer tuple
  *		hj_CurTuple				last inner tuple matched to current outer
  *								tuple, or NULL if starting search
+ *		hj_CurProbeSlot			hj_CurTuple's slot in the probe index
  *								(hj_CurXXX variables are undefined if
  *								OuterTupleSlot is empty!)
  *		hj_OuterTupleSlot		tuple slot for outer tuples
@@ -2077,6 +2128,13 @@ typedef struct MergeJoinState
  *		hj_JoinState			current state of ExecHashJoin state machine
  *		hj_MatchedOuter			true if found a join match for current outer
  *		hj_OuterNotEmpty		true if outer relation known not empty
+ *		hj_OuterBatch			batch of outer tuples being joined, if the
+ *								outer plan returns batches
+ *		hj_OuterBatchSlot		virtual slot for rows of hj_OuterBatch
+ *		hj_OuterBatchHashes		hash value of each row of hj_OuterBatch
+ *		hj_OuterBatchValid		false for rows that cannot match
+ *		hj_OuterBatchNext		next row of hj_OuterBatch to join
+ *		hj_OuterBatchDone		true if the outer plan has no more batches
  * ----------------
  */
 
@@ -2096,6 +2154,7 @@ typedef struct HashJoinState
 	int			hj_CurBucketNo;
 	int			hj_CurSkewBucketNo;
 	HashJoinTuple hj_CurTuple;
+	int			hj_CurProbeSlot;
 	TupleTableSlot *hj_OuterTupleSlot;
 	TupleTableSlot *hj_HashTupleSlot;
 	TupleTableSlot *hj_NullOuterTupleSlot;
@@ -2104,6 +2163,12 @@ typedef struct HashJoinState
 	int			hj_JoinState;
 	bool		hj_MatchedOuter;
 	bool		hj_OuterNotEmpty;
+	struct TupleBatch *hj_OuterBatch;
+	TupleTableSlot *hj_OuterBatchSlot;
+	uint32	   *hj_OuterBatchHashes;
+	bool	   *hj_OuterBatchValid;
+	int			hj_OuterBatchNext;
+	bool		hj_OuterBatchDone;
 } HashJoinState;
 
 
@@ -2146,6 +2211,10 @@ typedef struct MemoizeInstrumentation
 									 * able to free enough space to store the
 									 * current scan's tuples. */
 	uint64		mem_peak;		/* peak memory usage in bytes */
+	uint64		shared_hits;	/* number of cache misses that we found in
+								 * the shared cache of a parallel query */
+	uint64		shared_evictions;	/* number of shared cache entries we
+										 * removed to make room for new ones */
 } MemoizeInstrumentation;
 
 /* ----------------
@@ -2197,6 +2266,12 @@ typedef struct MemoizeState
 	SharedMemoizeInfo *shared_info; /* statistics for parallel workers */
 	Bitmapset  *keyparamids;	/* Param->paramids of expressions belonging to
 								 * param_exprs */
+	struct SharedMemoizeCache *shared_cache;	/* cache shared by the
+												 * participants of a parallel
+												 * query, or NULL */
+	struct dshash_table *shared_hash;	/* hash table of shared_cache */
+	struct dsa_area *shared_area;	/* area holding shared_cache's entries */
+	bool		use_shared_cache;	/* true if shared_cache can be used */
 } MemoizeState;
 
 /* ----------------
@@ -2402,7 +2477,8 @@ typedef struct AggState
 	/* these fields are used in AGG_HASHED and AGG_MIXED modes: */
 	bool		table_filled;	/* hash table filled yet? */
 	int			num_hashes;
-	MemoryContext hash_metacxt; /* memory for hash table itself */
+	MemoryContext hash_metacxt; /* memory for hash table bucket array */
+	MemoryContext hash_tablecxt;	/* memory for hash table entries */
 	struct LogicalTapeSet *hash_tapeset;	/* tape set for hash spill tapes */
 	struct HashAggSpill *hash_spills;	/* HashAggSpill for each grouping set,
 										 * exists only during first pass */
@@ -2433,6 +2509,16 @@ typedef struct AggState
 										 * ->hash_pergroup */
 	ProjectionInfo *combinedproj;	/* projection machinery */
 	SharedAggInfo *shared_info; /* one entry per worker */
+
+	/* these fields are used by a Parallel HashAgg: */
+	struct ParallelHashAggState *phash_state;	/* shared state, or NULL */
+	struct SharedTuplestoreAccessor **phash_partitions; /* shared partitions */
+
+	/* these fields are used if the outer plan returns batches of tuples: */
+	struct TupleBatch *input_batch; /* current batch of input tuples */
+	TupleTableSlot *input_batch_slot;	/* slot for rows of input_batch */
+	int			input_batch_next;	/* next row of input_batch to return */
+	bool		input_batch_done;	/* outer plan returned its last batch? */
 } AggState;
 
 /* ----------------
@@ -2663,6 +2749,9 @@ typedef struct HashState
 
 	/* Parallel hash state. */
 	struct ParallelHashJoinState *parallel_state;
+
+	/* Bloom filter for the outer side's scan to build, or NULL */
+	struct RuntimeFilter *runtime_filter;
 } HashState;
 
 /* ----------------
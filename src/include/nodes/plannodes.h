@@ -643,6 +643,15 @@ typedef struct CteScan
 	Scan		scan;
 	int			ctePlanId;		/* ID of init SubPlan for CTE */
 	int			cteParam;		/* ID of Param representing CTE output */
+
+	/*
+	 * Result rowtype of the CTE query, only set if parallel_aware.  Parallel
+	 * workers need it to read the shared tuplestore, since they don't have
+	 * the CTE's plan.
+	 */
+	List	   *ctecoltypes;	/* OID list of column type OIDs */
+	List	   *ctecoltypmods;	/* integer list of column typmods */
+	List	   *ctecolcollations;	/* OID list of column collation OIDs */
 } CteScan;
 
 /* ----------------
@@ -797,8 +797,9 @@ typedef OpExpr NullIfExpr;
  * the result type (or the collation) because it must be boolean.
  *
  * A ScalarArrayOpExpr with a valid hashfuncid is evaluated during execution
- * by building a hash table containing the Const values from the RHS arg.
- * This table is probed during expression evaluation.  The planner will set
+ * by building a hash table containing the values from the RHS arg, which is
+ * either a Const or a Param.  This table is probed during expression
+ * evaluation, and rebuilt if the value of a Param RHS changes.  The planner will set
  * hashfuncid to the hash function which must be used to build and probe the
  * hash table.  The executor determines if it should use hash-based checks or
  * the more traditional means based on if the hashfuncid is set or not.
@@ -23,6 +23,7 @@
 #define OPTIMIZER_H
 
 #include "nodes/parsenodes.h"
+#include "portability/instr_time.h"
 
 /*
  * We don't want to include nodes/pathnodes.h here, because non-planner
@@ -87,6 +88,7 @@ extern PGDLLIMPORT double cpu_operator_cost;
 extern PGDLLIMPORT double parallel_tuple_cost;
 extern PGDLLIMPORT double parallel_setup_cost;
 extern PGDLLIMPORT double recursive_worktable_factor;
+extern PGDLLIMPORT double nestloop_min_outer_rows;
 extern PGDLLIMPORT int effective_cache_size;
 
 extern double clamp_row_est(double nrows);
@@ -111,6 +113,28 @@ typedef enum
 extern PGDLLIMPORT int debug_parallel_query;
 extern PGDLLIMPORT bool parallel_leader_participation;
 
+/*
+ * Counters of the planner's work.  Like pgBufferUsage, they accumulate over
+ * the life of the backend; EXPLAIN (PLANNING) reports how much they grew
+ * while planning one query.  The phase times only cover the top query level
+ * (subqueries are included in their parent's times).
+ */
+typedef struct PlannerUsage
+{
+	int64		rels_built;		/* # of RelOptInfos made */
+	int64		paths_added;	/* # of paths offered to add_[partial_]path */
+	int64		paths_discarded;	/* # of those rejected or removed later */
+	instr_time	subquery_planner_time;	/* time in subquery_planner() */
+	instr_time	make_one_rel_time;	/* time in make_one_rel() */
+	instr_time	create_plan_time;	/* time in create_plan() */
+	instr_time	setrefs_time;	/* time in set_plan_references() */
+} PlannerUsage;
+
+extern PGDLLIMPORT PlannerUsage pgPlannerUsage;
+
+extern void PlannerUsageAccumDiff(PlannerUsage *dst, const PlannerUsage *add,
+								  const PlannerUsage *sub);
+
 extern struct PlannedStmt *planner(Query *parse, const char *query_string,
 								   int cursorOptions,
 								   struct ParamListInfoData *boundParams);
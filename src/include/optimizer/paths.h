@@ -22,6 +22,8 @@
  */
 extern PGDLLIMPORT bool enable_geqo;
 extern PGDLLIMPORT int geqo_threshold;
+extern PGDLLIMPORT bool enable_linear_join_search;
+extern PGDLLIMPORT bool enable_group_by_reordering;
 extern PGDLLIMPORT int min_parallel_table_scan_size;
 extern PGDLLIMPORT int min_parallel_index_scan_size;
 
@@ -52,6 +54,13 @@ extern RelOptInfo *make_one_rel(PlannerInfo *root, List *joinlist);
 extern RelOptInfo *standard_join_search(PlannerInfo *root, int levels_needed,
 										List *initial_rels);
 
+/*
+ * linearjoin.c
+ *	  routines for join search over a linear ordering of the relations
+ */
+extern RelOptInfo *linear_join_search(PlannerInfo *root, int levels_needed,
+									  List *initial_rels);
+
 extern void generate_gather_paths(PlannerInfo *root, RelOptInfo *rel,
 								  bool override_rows);
 extern void generate_useful_gather_paths(PlannerInfo *root, RelOptInfo *rel,
@@ -199,9 +208,20 @@ typedef enum
 	PATHKEYS_DIFFERENT			/* neither pathkey includes the other */
 } PathKeysComparison;
 
+/*
+ * An ordering of the GROUP BY keys: the pathkeys to sort the input by, and
+ * the grouping clauses in the matching order.
+ */
+typedef struct GroupByOrdering
+{
+	List	   *pathkeys;
+	List	   *clauses;
+} GroupByOrdering;
+
 extern PathKeysComparison compare_pathkeys(List *keys1, List *keys2);
 extern bool pathkeys_contained_in(List *keys1, List *keys2);
 extern bool pathkeys_count_contained_in(List *keys1, List *keys2, int *n_common);
+extern List *get_useful_group_keys_orderings(PlannerInfo *root, Path *path);
 extern Path *get_cheapest_path_for_pathkeys(List *paths, List *pathkeys,
 											Relids required_outer,
 											CostSelector cost_criterion,
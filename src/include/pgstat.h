@@ -49,6 +49,7 @@ typedef enum PgStat_Kind
 	PGSTAT_KIND_BGWRITER,
 	PGSTAT_KIND_CHECKPOINTER,
 	PGSTAT_KIND_IO,
+	PGSTAT_KIND_LWLOCK,
 	PGSTAT_KIND_SLRU,
 	PGSTAT_KIND_WAL,
 } PgStat_Kind;
@@ -243,7 +244,7 @@ typedef struct PgStat_TableXactStatus
  * ------------------------------------------------------------
  */
 
-#define PGSTAT_FILE_FORMAT_ID	0x01A5BCAA
+#define PGSTAT_FILE_FORMAT_ID	0x01A5BCAF
 
 typedef struct PgStat_ArchiverStats
 {
@@ -340,6 +341,7 @@ typedef struct PgStat_StatDBEntry
 	PgStat_Counter conflict_snapshot;
 	PgStat_Counter conflict_bufferpin;
 	PgStat_Counter conflict_startup_deadlock;
+	PgStat_Counter conflict_snapshot_deferred;
 	PgStat_Counter temp_files;
 	PgStat_Counter temp_bytes;
 	PgStat_Counter deadlocks;
@@ -354,6 +356,7 @@ typedef struct PgStat_StatDBEntry
 	PgStat_Counter sessions_abandoned;
 	PgStat_Counter sessions_fatal;
 	PgStat_Counter sessions_killed;
+	PgStat_Counter cache_resets;
 
 	TimestampTz stat_reset_timestamp;
 } PgStat_StatDBEntry;
@@ -379,6 +382,17 @@ typedef struct PgStat_StatReplSlotEntry
 	TimestampTz stat_reset_timestamp;
 } PgStat_StatReplSlotEntry;
 
+typedef struct PgStat_LWLockStats
+{
+	PgStat_Counter acquires;
+	PgStat_Counter contended;
+	PgStat_Counter spin_acquires;
+	PgStat_Counter waits;
+	PgStat_Counter wait_time;	/* times in microseconds */
+	PgStat_Counter max_wait_time;
+	TimestampTz stat_reset_timestamp;
+} PgStat_LWLockStats;
+
 typedef struct PgStat_SLRUStats
 {
 	PgStat_Counter blocks_zeroed;
@@ -437,6 +451,7 @@ typedef struct PgStat_WalStats
 	PgStat_Counter wal_buffers_full;
 	PgStat_Counter wal_write;
 	PgStat_Counter wal_sync;
+	PgStat_Counter wal_sync_grouped;
 	PgStat_Counter wal_write_time;
 	PgStat_Counter wal_sync_time;
 	TimestampTz stat_reset_timestamp;
@@ -518,6 +533,17 @@ extern bool pgstat_tracks_io_op(BackendType bktype, IOObject io_object,
 								IOContext io_context, IOOp io_op);
 
 
+/*
+ * Functions in pgstat_lwlock.c
+ */
+
+extern void pgstat_count_lwlock_acquire(uint16 tranche, bool contended);
+extern void pgstat_count_lwlock_spin_acquire(uint16 tranche);
+extern void pgstat_count_lwlock_wait(uint16 tranche, instr_time wait_time);
+extern const char *pgstat_get_lwlock_name(int idx);
+extern PgStat_LWLockStats *pgstat_fetch_lwlock(void);
+
+
 /*
  * Functions in pgstat_database.c
  */
@@ -525,6 +551,7 @@ extern bool pgstat_tracks_io_op(BackendType bktype, IOObject io_object,
 extern void pgstat_drop_database(Oid databaseid);
 extern void pgstat_report_autovac(Oid dboid);
 extern void pgstat_report_recovery_conflict(int reason);
+extern void pgstat_report_recovery_conflict_deferred(int count);
 extern void pgstat_report_deadlock(void);
 extern void pgstat_report_checksum_failures_in_db(Oid dboid, int failurecount);
 extern void pgstat_report_checksum_failure(void);
@@ -538,6 +565,8 @@ extern void pgstat_report_connect(Oid dboid);
 	(pgStatActiveTime += (n))
 #define pgstat_count_conn_txn_idle_time(n)							\
 	(pgStatTransactionIdleTime += (n))
+#define pgstat_count_cache_reset()									\
+	(pgStatCacheResets++)
 
 extern PgStat_StatDBEntry *pgstat_fetch_stat_dbentry(Oid dboid);
 
@@ -567,6 +596,14 @@ extern void pgstat_create_relation(Relation rel);
 extern void pgstat_drop_relation(Relation rel);
 extern void pgstat_copy_relation_stats(Relation dst, Relation src);
 
+typedef void (*PgStat_RelationStatsCallback) (Oid relid, uint64 generation,
+											  const PgStat_StatTabEntry *tabentry,
+											  void *arg);
+extern uint64 pgstat_get_relation_stats_generation(void);
+extern void pgstat_scan_relation_stats(uint64 since_generation,
+									   PgStat_RelationStatsCallback callback,
+									   void *arg);
+
 extern void pgstat_init_relation(Relation rel);
 extern void pgstat_assoc_relation(Relation rel);
 extern void pgstat_unlink_relation(Relation rel);
@@ -746,6 +783,9 @@ extern PGDLLIMPORT PgStat_Counter pgStatBlockWriteTime;
 extern PGDLLIMPORT PgStat_Counter pgStatActiveTime;
 extern PGDLLIMPORT PgStat_Counter pgStatTransactionIdleTime;
 
+/* Updated by pgstat_count_cache_reset(), called by sinval.c */
+extern PGDLLIMPORT PgStat_Counter pgStatCacheResets;
+
 /* updated by the traffic cop and in errfinish() */
 extern PGDLLIMPORT SessionEndType pgStatSessionEndCause;
 
@@ -0,0 +1,23 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_numa.h
+ *	  Basic NUMA portability routines
+ *
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/include/port/pg_numa.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PG_NUMA_H
+#define PG_NUMA_H
+
+extern int	pg_numa_init(void);
+extern int	pg_numa_get_max_node(void);
+extern int	pg_numa_interleave_memory(void *ptr, size_t size, size_t pagesize);
+extern int	pg_numa_query_pages(int pid, unsigned long count, void **pages,
+								int *status);
+
+#endif							/* PG_NUMA_H */
@@ -117,6 +117,9 @@ extern void RegisterBackgroundWorker(BackgroundWorker *worker);
 /* Register a new bgworker from a regular backend */
 extern bool RegisterDynamicBackgroundWorker(BackgroundWorker *worker,
 											BackgroundWorkerHandle **handle);
+extern int	RegisterDynamicBackgroundWorkers(BackgroundWorker *workers,
+											 int nworkers,
+											 BackgroundWorkerHandle **handles);
 
 /* Query the status of a bgworker */
 extern BgwHandleStatus GetBackgroundWorkerPid(BackgroundWorkerHandle *handle,
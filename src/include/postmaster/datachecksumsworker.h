@@ -0,0 +1,25 @@
+/*-------------------------------------------------------------------------
+ *
+ * datachecksumsworker.h
+ *	  Exports from postmaster/datachecksumsworker.c.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ *
+ * src/include/postmaster/datachecksumsworker.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef DATACHECKSUMSWORKER_H
+#define DATACHECKSUMSWORKER_H
+
+extern Size DataChecksumsWorkerShmemSize(void);
+extern void DataChecksumsWorkerShmemInit(void);
+
+extern void StartDataChecksumsLauncher(bool enable, int cost_delay,
+									   int cost_limit);
+
+/* Entry points of the background workers */
+extern void DataChecksumsWorkerLauncherMain(Datum arg);
+extern void DataChecksumsWorkerMain(Datum arg);
+
+#endif							/* DATACHECKSUMSWORKER_H */
@@ -13,6 +13,8 @@
 #ifndef _POSTMASTER_H
 #define _POSTMASTER_H
 
+#include "datatype/timestamp.h"
+
 /* GUC options */
 extern PGDLLIMPORT bool EnableSSL;
 extern PGDLLIMPORT int SuperuserReservedConnections;
@@ -50,6 +52,22 @@ extern PGDLLIMPORT int postmaster_alive_fds[2];
 
 extern PGDLLIMPORT const char *progname;
 
+/*
+ * When the stages of setting up a client connection were reached, for
+ * log_connections.  Zero if not reached (yet).
+ */
+typedef struct ConnectionTiming
+{
+	TimestampTz socket_create;	/* postmaster accepted the connection */
+	TimestampTz fork_start;		/* postmaster is about to fork */
+	TimestampTz fork_end;		/* child process is running */
+	TimestampTz auth_start;
+	TimestampTz auth_end;
+	TimestampTz ready_for_use;	/* first ReadyForQuery */
+} ConnectionTiming;
+
+extern PGDLLIMPORT ConnectionTiming conn_timing;
+
 extern void PostmasterMain(int argc, char *argv[]) pg_attribute_noreturn();
 extern void ClosePostmasterPorts(bool am_syslogger);
 extern void InitProcessGlobals(void);
@@ -91,6 +91,16 @@ typedef struct LogicalRepTupleData
 	int			ncols;
 } LogicalRepTupleData;
 
+/*
+ * Function used to send a column, as looked up by
+ * logicalrep_get_output_funcs().
+ */
+typedef struct LogicalRepOutputFunc
+{
+	bool		binary;			/* true for typsend, false for typoutput */
+	FmgrInfo	finfo;
+} LogicalRepOutputFunc;
+
 /* Possible values for LogicalRepTupleData.colstatus[colnum] */
 /* These values are also used in the on-the-wire protocol */
 #define LOGICALREP_COLUMN_NULL		'n'
@@ -222,21 +232,27 @@ extern void logicalrep_read_stream_prepare(StringInfo in,
 extern void logicalrep_write_origin(StringInfo out, const char *origin,
 									XLogRecPtr origin_lsn);
 extern char *logicalrep_read_origin(StringInfo in, XLogRecPtr *origin_lsn);
+extern LogicalRepOutputFunc *logicalrep_get_output_funcs(Relation rel,
+														 bool binary,
+														 MemoryContext mcxt);
 extern void logicalrep_write_insert(StringInfo out, TransactionId xid,
 									Relation rel,
 									TupleTableSlot *newslot,
-									bool binary, Bitmapset *columns);
+									bool binary, Bitmapset *columns,
+									LogicalRepOutputFunc *outfuncs);
 extern LogicalRepRelId logicalrep_read_insert(StringInfo in, LogicalRepTupleData *newtup);
 extern void logicalrep_write_update(StringInfo out, TransactionId xid,
 									Relation rel,
 									TupleTableSlot *oldslot,
-									TupleTableSlot *newslot, bool binary, Bitmapset *columns);
+									TupleTableSlot *newslot, bool binary, Bitmapset *columns,
+									LogicalRepOutputFunc *outfuncs);
 extern LogicalRepRelId logicalrep_read_update(StringInfo in,
 											  bool *has_oldtuple, LogicalRepTupleData *oldtup,
 											  LogicalRepTupleData *newtup);
 extern void logicalrep_write_delete(StringInfo out, TransactionId xid,
 									Relation rel, TupleTableSlot *oldslot,
-									bool binary, Bitmapset *columns);
+									bool binary, Bitmapset *columns,
+									LogicalRepOutputFunc *outfuncs);
 extern LogicalRepRelId logicalrep_read_delete(StringInfo in,
 											  LogicalRepTupleData *oldtup);
 extern void logicalrep_write_truncate(StringInfo out, TransactionId xid,
@@ -19,6 +19,7 @@
 
 /* GUC variables */
 extern PGDLLIMPORT int logical_decoding_work_mem;
+extern PGDLLIMPORT int logical_decoding_spill_compression;
 extern PGDLLIMPORT int logical_replication_mode;
 
 /* possible values for logical_replication_mode */
@@ -629,6 +630,10 @@ struct ReorderBuffer
 	char	   *outbuf;
 	Size		outbufsize;
 
+	/* buffer for compressing and decompressing spilled changes */
+	char	   *compressbuf;
+	Size		compressbufsize;
+
 	/* memory accounting */
 	Size		size;
 
@@ -0,0 +1,23 @@
+/*-------------------------------------------------------------------------
+ *
+ * walcompress.h
+ *	  Compression of the WAL data sent by walsender to walreceiver
+ *
+ * Portions Copyright (c) 2010-2023, PostgreSQL Global Development Group
+ *
+ * src/include/replication/walcompress.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _WALCOMPRESS_H
+#define _WALCOMPRESS_H
+
+#include "common/compression.h"
+
+extern int	WalCompressBound(pg_compress_algorithm algorithm, int len);
+extern int	WalCompress(const pg_compress_specification *spec,
+						const char *src, int srclen, char *dst, int dstlen);
+extern void WalDecompress(pg_compress_algorithm algorithm,
+						  const char *src, int srclen, char *dst, int dstlen);
+
+#endif							/* _WALCOMPRESS_H */
@@ -30,6 +30,7 @@
 extern PGDLLIMPORT int wal_receiver_status_interval;
 extern PGDLLIMPORT int wal_receiver_timeout;
 extern PGDLLIMPORT bool hot_standby_feedback;
+extern PGDLLIMPORT char *wal_receiver_compression;
 
 /*
  * MAXCONNINFO: maximum size of a connection string.
@@ -176,6 +177,8 @@ typedef struct
 		struct
 		{
 			TimeLineID	startpointTLI;	/* Starting timeline */
+			char	   *compression;	/* Compression algorithm, or NULL */
+			char	   *compression_detail; /* Compression detail, or NULL */
 		}			physical;
 		struct
 		{
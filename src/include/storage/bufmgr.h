@@ -69,11 +69,27 @@ struct SMgrRelationData;
 /* in globals.c ... this duplicates miscadmin.h */
 extern PGDLLIMPORT int NBuffers;
 
+/* in buf_init.c */
+extern PGDLLIMPORT bool numa_interleave;
+
+/* possible values for buffer_replacement_policy */
+typedef enum BufferReplacementPolicy
+{
+	BUFFER_REPLACEMENT_CLOCK,
+	BUFFER_REPLACEMENT_2Q
+} BufferReplacementPolicy;
+
+/* in freelist.c */
+extern PGDLLIMPORT int clock_sweep_partitions;
+extern PGDLLIMPORT int buffer_replacement_policy;
+
 /* in bufmgr.c */
 extern PGDLLIMPORT bool zero_damaged_pages;
+extern PGDLLIMPORT bool lockfree_buffer_lookup;
 extern PGDLLIMPORT int bgwriter_lru_maxpages;
 extern PGDLLIMPORT double bgwriter_lru_multiplier;
 extern PGDLLIMPORT bool track_io_timing;
+extern PGDLLIMPORT int shared_buffers_limit;
 
 /* only applicable when prefetching is available */
 #ifdef USE_PREFETCH
@@ -203,6 +203,13 @@ typedef PageHeaderData *PageHeader;
 #define PG_PAGE_LAYOUT_VERSION		4
 #define PG_DATA_CHECKSUM_VERSION	1
 
+/*
+ * Value of the data checksum version while checksums are being enabled or
+ * disabled online: checksums are computed when pages are written, but not
+ * verified when they are read.
+ */
+#define PG_DATA_CHECKSUM_INPROGRESS_VERSION	2
+
 /* ----------------------------------------------------------------
  *						page support functions
  * ----------------------------------------------------------------
@@ -206,6 +206,12 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_PGSTATS_DATA,
 	LWTRANCHE_LAUNCHER_DSA,
 	LWTRANCHE_LAUNCHER_HASH,
+	LWTRANCHE_SHARED_PLAN_CACHE_DSA,
+	LWTRANCHE_SHARED_CATCACHE_DSA,
+	LWTRANCHE_PARALLEL_VACUUM_DSA,
+	LWTRANCHE_MEMORY_STATS,
+	LWTRANCHE_MEMORY_STATS_DSA,
+	LWTRANCHE_SHARED_MEMOIZE,
 	LWTRANCHE_FIRST_USER_DEFINED
 }			BuiltinTrancheIds;
 
@@ -20,6 +20,8 @@
 #include "utils/snapshot.h"
 
 
+extern PGDLLIMPORT bool shared_snapshot_cache;
+
 extern Size ProcArrayShmemSize(void);
 extern void CreateSharedProcArray(void);
 extern void ProcArrayAdd(PGPROC *proc);
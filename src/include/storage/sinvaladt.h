@@ -25,6 +25,11 @@
 #include "storage/lock.h"
 #include "storage/sinval.h"
 
+/* upper limit for sinval_queue_size */
+#define SINVAL_QUEUE_SIZE_MAX	(1 << 20)
+
+extern PGDLLIMPORT int sinval_queue_size;
+
 /*
  * prototypes for functions in sinvaladt.c
  */
@@ -38,6 +43,8 @@ extern void BackendIdGetTransactionIds(int backendID, TransactionId *xid,
 
 extern void SIInsertDataEntries(const SharedInvalidationMessage *data, int n);
 extern int	SIGetDataEntries(SharedInvalidationMessage *data, int datasize);
+extern bool SIIsCaughtUp(int *maxMsgNum);
+extern int	SIGetMaxMsgNum(void);
 extern void SICleanupQueue(bool callerHasWriteLock, int minFree);
 
 extern LocalTransactionId GetNextLocalTransactionId(void);
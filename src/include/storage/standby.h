@@ -15,6 +15,7 @@
 #define STANDBY_H
 
 #include "datatype/timestamp.h"
+#include "port/atomics.h"
 #include "storage/lock.h"
 #include "storage/procsignal.h"
 #include "storage/relfilelocator.h"
@@ -24,8 +25,20 @@
 extern PGDLLIMPORT int vacuum_defer_cleanup_age;
 extern PGDLLIMPORT int max_standby_archive_delay;
 extern PGDLLIMPORT int max_standby_streaming_delay;
+extern PGDLLIMPORT int max_standby_deferred_conflicts;
 extern PGDLLIMPORT bool log_recovery_conflict_waits;
 
+/* number of snapshot conflicts deferred to this backend, or NULL */
+extern PGDLLIMPORT pg_atomic_uint32 *MyDeferredConflictCount;
+
+#define DeferredSnapshotConflictsPending() \
+	(MyDeferredConflictCount != NULL && \
+	 pg_atomic_read_u32(MyDeferredConflictCount) != 0)
+
+extern Size StandbyShmemSize(void);
+extern void StandbyShmemInit(void);
+extern void InitDeferredSnapshotConflicts(void);
+
 extern void InitRecoveryTransactionEnvironment(void);
 extern void ShutdownRecoveryTransactionEnvironment(void);
 
@@ -33,6 +46,9 @@ extern void ResolveRecoveryConflictWithSnapshot(TransactionId snapshotConflictHo
 												RelFileLocator locator);
 extern void ResolveRecoveryConflictWithSnapshotFullXid(FullTransactionId snapshotConflictHorizon,
 													   RelFileLocator locator);
+extern void ResolveRecoveryConflictWithSnapshotDeferred(TransactionId snapshotConflictHorizon,
+														RelFileLocator locator);
+extern void CheckDeferredSnapshotConflicts(RelFileLocator locator);
 extern void ResolveRecoveryConflictWithTablespace(Oid tsid);
 extern void ResolveRecoveryConflictWithDatabase(Oid dbid);
 
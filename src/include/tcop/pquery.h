@@ -48,4 +48,10 @@ extern bool PlannedStmtRequiresSnapshot(struct PlannedStmt *pstmt);
 
 extern void EnsurePortalSnapshotExists(void);
 
+extern bool SuspendReusableQuery(QueryDesc *queryDesc);
+
+extern void DropReusableQueries(void);
+
+extern void AtAbort_ReusableQueries(void);
+
 #endif							/* PQUERY_H */
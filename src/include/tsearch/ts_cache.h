@@ -60,6 +60,15 @@ typedef struct TSDictionaryCacheEntry
 
 	MemoryContext dictCtx;		/* memory context to store private data */
 	void	   *dictData;
+
+	/*
+	 * Cache of lexize results, used only for dictionaries whose output
+	 * depends on nothing but the input token.  Lives in a child of dictCtx,
+	 * so it goes away whenever the entry is invalidated.
+	 */
+	bool		lexizeCacheable;
+	MemoryContext lexemeCacheCtx;
+	struct HTAB *lexemeCache;
 } TSDictionaryCacheEntry;
 
 typedef struct
@@ -201,12 +201,36 @@ typedef struct JsonbContainer
 #define JB_FSCALAR				0x10000000	/* flag bits */
 #define JB_FOBJECT				0x20000000
 #define JB_FARRAY				0x40000000
+#define JB_FKEYINDEX			0x80000000	/* object has a key index */
 
 /* convenience macros for accessing a JsonbContainer struct */
 #define JsonContainerSize(jc)		((jc)->header & JB_CMASK)
 #define JsonContainerIsScalar(jc)	(((jc)->header & JB_FSCALAR) != 0)
 #define JsonContainerIsObject(jc)	(((jc)->header & JB_FOBJECT) != 0)
 #define JsonContainerIsArray(jc)	(((jc)->header & JB_FARRAY) != 0)
+#define JsonContainerHasKeyIndex(jc)	(((jc)->header & JB_FKEYINDEX) != 0)
+
+/*
+ * Key index of a large object.
+ *
+ * An object with at least JB_KEYINDEX_MIN_PAIRS key/value pairs is written
+ * with the JB_FKEYINDEX flag set, and with a key index appended to its
+ * variable-length data, after int-alignment padding.  The index consists of
+ * a uint32 holding the number of hash slots (a power of 2), then 2 * nPairs
+ * + 1 uint32 offsets, giving the start offset of every key and value and
+ * finally the end of the data, and then the hash slots.  Each slot holds
+ * 1 + the index of a key, hashed with hash_bytes(), or 0 if empty; collisions
+ * are resolved by linear probing.  The JEntry of the last value always
+ * stores an end offset, so the index can be found without walking the
+ * JEntry array.
+ *
+ * This turns a key lookup, which otherwise needs a binary search over the
+ * keys and O(JB_OFFSET_STRIDE) JEntry walks for every probe, into a hash
+ * probe with direct offsets.  Code that doesn't know about the index, such
+ * as the iterators, simply ignores the extra data at the end of the
+ * container.
+ */
+#define JB_KEYINDEX_MIN_PAIRS	128
 
 /* The top-level on-disk format for a jsonb datum. */
 typedef struct
@@ -400,6 +424,10 @@ extern JsonbValue *findJsonbValueFromContainer(JsonbContainer *container,
 extern JsonbValue *getKeyJsonValueFromContainer(JsonbContainer *container,
 												const char *keyVal, int keyLen,
 												JsonbValue *res);
+extern JsonbValue *getKeyJsonValueFromToastedJsonb(struct varlena *attr,
+												   const char *keyVal,
+												   int keyLen,
+												   JsonbValue *res);
 extern JsonbValue *getIthJsonbValueFromContainer(JsonbContainer *container,
 												 uint32 i);
 extern JsonbValue *pushJsonbValue(JsonbParseState **pstate,
@@ -87,6 +87,8 @@ extern Size GetMemoryChunkSpace(void *pointer);
 extern MemoryContext MemoryContextGetParent(MemoryContext context);
 extern bool MemoryContextIsEmpty(MemoryContext context);
 extern Size MemoryContextMemAllocated(MemoryContext context, bool recurse);
+extern void MemoryContextMemConsumed(MemoryContext context,
+									 MemoryContextCounters *consumed);
 extern void MemoryContextStats(MemoryContext context);
 extern void MemoryContextStatsDetail(MemoryContext context, int max_children,
 									 bool print_to_stderr);
@@ -104,6 +106,40 @@ extern void MemoryContextCheck(MemoryContext context);
 extern void HandleLogMemoryContextInterrupt(void);
 extern void ProcessLogMemoryContextInterrupt(void);
 
+/*
+ * Statistics of one memory context, as published by another process for
+ * pg_get_process_memory_contexts().  The name and ident are truncated, and
+ * empty if the context has none.
+ */
+#define MEMORY_CONTEXT_STATS_NAME_LEN	128
+
+typedef struct MemoryContextStatsEntry
+{
+	char		name[MEMORY_CONTEXT_STATS_NAME_LEN];
+	char		ident[MEMORY_CONTEXT_STATS_NAME_LEN];
+	int			parent;			/* index of the parent's entry, or -1 */
+	int			level;
+	NodeTag		type;			/* context type */
+	MemoryContextCounters counters;
+} MemoryContextStatsEntry;
+
+/* memstats.c */
+extern Size MemoryStatsShmemSize(void);
+extern void MemoryStatsShmemInit(void);
+extern void HandleGetMemoryContextInterrupt(void);
+extern void ProcessGetMemoryContextInterrupt(void);
+extern MemoryContextStatsEntry *MemoryContextStatsRequest(int pid,
+														  long timeout_ms,
+														  int *nentries);
+
+/* memaccount.c */
+extern PGDLLIMPORT int max_total_backend_memory;
+
+extern Size MemoryAccountingShmemSize(void);
+extern void MemoryAccountingShmemInit(void);
+extern void MemoryAccountingAttach(void);
+extern uint64 MemoryAccountingGetTotal(void);
+
 /*
  * Memory-context-type-specific functions
  */
@@ -143,6 +179,13 @@ extern MemoryContext GenerationContextCreate(MemoryContext parent,
 											 Size initBlockSize,
 											 Size maxBlockSize);
 
+/* bump.c */
+extern MemoryContext BumpContextCreate(MemoryContext parent,
+									   const char *name,
+									   Size minContextSize,
+									   Size initBlockSize,
+									   Size maxBlockSize);
+
 /*
  * Recommended default alloc parameters, suitable for "ordinary" contexts
  * that might hold quite a lot of data.
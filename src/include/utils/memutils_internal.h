@@ -70,6 +70,23 @@ extern void SlabStats(MemoryContext context,
 extern void SlabCheck(MemoryContext context);
 #endif
 
+/* These functions implement the MemoryContext API for Bump context. */
+extern void *BumpAlloc(MemoryContext context, Size size);
+extern void BumpFree(void *pointer);
+extern void *BumpRealloc(void *pointer, Size size);
+extern void BumpReset(MemoryContext context);
+extern void BumpDelete(MemoryContext context);
+extern MemoryContext BumpGetChunkContext(void *pointer);
+extern Size BumpGetChunkSpace(void *pointer);
+extern bool BumpIsEmpty(MemoryContext context);
+extern void BumpStats(MemoryContext context,
+					  MemoryStatsPrintFunc printfunc, void *passthru,
+					  MemoryContextCounters *totals,
+					  bool print_to_stderr);
+#ifdef MEMORY_CONTEXT_CHECKING
+extern void BumpCheck(MemoryContext context);
+#endif
+
 /*
  * These functions support the implementation of palloc_aligned() and are not
  * part of a fully-fledged MemoryContext type.
@@ -104,24 +121,74 @@ extern Size AlignedAllocGetChunkSpace(void *pointer);
  */
 typedef enum MemoryContextMethodID
 {
-	MCTX_UNUSED1_ID,			/* 000 occurs in never-used memory */
-	MCTX_UNUSED2_ID,			/* glibc malloc'd chunks usually match 001 */
-	MCTX_UNUSED3_ID,			/* glibc malloc'd chunks > 128kB match 010 */
+	MCTX_UNUSED1_ID,			/* 0000 occurs in never-used memory */
+	MCTX_UNUSED2_ID,			/* glibc malloc'd chunks usually match 0001 */
+	MCTX_UNUSED3_ID,			/* glibc malloc'd chunks > 128kB match 0010 */
 	MCTX_ASET_ID,
 	MCTX_GENERATION_ID,
 	MCTX_SLAB_ID,
 	MCTX_ALIGNED_REDIRECT_ID,
-	MCTX_UNUSED4_ID				/* 111 occurs in wipe_mem'd memory */
+	MCTX_BUMP_ID,
+	MCTX_UNUSED4_ID,
+	MCTX_UNUSED5_ID,
+	MCTX_UNUSED6_ID,
+	MCTX_UNUSED7_ID,
+	MCTX_UNUSED8_ID,
+	MCTX_UNUSED9_ID,
+	MCTX_UNUSED10_ID,
+	MCTX_UNUSED11_ID			/* 1111 occurs in wipe_mem'd memory */
 } MemoryContextMethodID;
 
 /*
  * The number of bits that 8-byte memory chunk headers can use to encode the
  * MemoryContextMethodID.
  */
-#define MEMORY_CONTEXT_METHODID_BITS 3
+#define MEMORY_CONTEXT_METHODID_BITS 4
 #define MEMORY_CONTEXT_METHODID_MASK \
 	((((uint64) 1) << MEMORY_CONTEXT_METHODID_BITS) - 1)
 
+/*
+ * Accounting of the memory obtained from malloc() by the context types.
+ *
+ * Each allocation or free of a block must be reported with
+ * MemoryAccountingAllocate() or MemoryAccountingFree().  Changes are
+ * accumulated locally and only added to the counter in shared memory, and
+ * checked against max_total_backend_memory, once they amount to
+ * MEMORY_ACCOUNTING_BATCH_SIZE, to keep the common path cheap.  If
+ * MemoryAccountingAllocate() returns false, the block must be given back to
+ * malloc without reporting it, and the allocation be failed.
+ */
+#define MEMORY_ACCOUNTING_BATCH_SIZE	(1024 * 1024)
+
+extern PGDLLIMPORT uint64 backend_allocated_bytes;
+extern PGDLLIMPORT int64 backend_unreported_bytes;
+
+extern bool MemoryAccountingReport(Size size);
+extern int	errhint_memory_limit(void);
+
+static inline bool
+MemoryAccountingAllocate(Size size)
+{
+	backend_allocated_bytes += size;
+	backend_unreported_bytes += size;
+
+	if (unlikely(backend_unreported_bytes >= MEMORY_ACCOUNTING_BATCH_SIZE))
+		return MemoryAccountingReport(size);
+	return true;
+}
+
+static inline void
+MemoryAccountingFree(Size size)
+{
+	Assert(backend_allocated_bytes >= size);
+
+	backend_allocated_bytes -= size;
+	backend_unreported_bytes -= size;
+
+	if (unlikely(backend_unreported_bytes <= -MEMORY_ACCOUNTING_BATCH_SIZE))
+		(void) MemoryAccountingReport(0);
+}
+
 /*
  * This routine handles the context-type-independent part of memory
  * context creation.  It's intended to be called from context-type-
@@ -238,6 +238,20 @@ typedef struct PgStat_KindInfo
 	 */
 	void		(*reset_timestamp_cb) (PgStatShared_Common *header, TimestampTz ts);
 
+	/*
+	 * For variable-numbered stats that keep counters outside of the stats
+	 * data, which are updated without the entry's lock: initialize those
+	 * counters in a new entry. Optional.
+	 */
+	void		(*init_shmem_cb) (PgStatShared_Common *header);
+
+	/*
+	 * For the same kind of stats: add those counters to the stats data, and
+	 * zero them. Called with the entry's lock held exclusively before the
+	 * stats data is read, reset or written out. Optional.
+	 */
+	void		(*fold_cb) (PgStatShared_Common *header);
+
 	/*
 	 * For variable-numbered stats with named_on_disk. Optional.
 	 */
@@ -281,6 +295,12 @@ static const char *const slru_names[] = {
 
 #define SLRU_NUM_ELEMENTS	lengthof(slru_names)
 
+/*
+ * LWLock statistics are kept for each individual LWLock and built-in tranche,
+ * plus one entry for all tranches registered by extensions.
+ */
+#define LWLOCK_STATS_NUM_ELEMENTS	(LWTRANCHE_FIRST_USER_DEFINED + 1)
+
 
 /* ----------
  * Types and definitions for different kinds of fixed-amount stats.
@@ -329,17 +349,25 @@ typedef struct PgStatShared_Checkpointer
 	PgStat_CheckpointerStats reset_offset;
 } PgStatShared_Checkpointer;
 
-/* Shared-memory ready PgStat_IO */
+/*
+ * Shared-memory ready PgStat_IO.  All backends of a type add to the same
+ * counters, so they are atomics that can be added to without any lock.
+ */
 typedef struct PgStatShared_IO
 {
-	/*
-	 * locks[i] protects stats.stats[i]. locks[0] also protects
-	 * stats.stat_reset_timestamp.
-	 */
-	LWLock		locks[BACKEND_NUM_TYPES];
-	PgStat_IO	stats;
+	/* lock protects stat_reset_timestamp, and serializes resets */
+	LWLock		lock;
+	TimestampTz stat_reset_timestamp;
+	pg_atomic_uint64 data[BACKEND_NUM_TYPES][IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES][IOOP_NUM_TYPES];
 } PgStatShared_IO;
 
+typedef struct PgStatShared_LWLock
+{
+	/* lock protects ->stats */
+	LWLock		lock;
+	PgStat_LWLockStats stats[LWLOCK_STATS_NUM_ELEMENTS];
+} PgStatShared_LWLock;
+
 typedef struct PgStatShared_SLRU
 {
 	/* lock protects ->stats */
@@ -373,6 +401,28 @@ typedef struct PgStatShared_Database
 typedef struct PgStatShared_Relation
 {
 	PgStatShared_Common header;
+
+	/*
+	 * Value of PgStat_ShmemControl.relstats_generation when the stats were
+	 * last changed, see pgstat_scan_relation_stats().  Protected by the
+	 * entry's lock, and not written out to disk.
+	 */
+	uint64		generation;
+
+	/*
+	 * Counters that backends which only read the relation add to without
+	 * taking the entry's lock, see pgstat_relation_flush_cb().  They are
+	 * moved into stats by pgstat_relation_fold_cb() before the latter is
+	 * read.  lastscan holds a TimestampTz, and is advanced rather than added
+	 * to.
+	 */
+	pg_atomic_uint64 numscans;
+	pg_atomic_uint64 lastscan;
+	pg_atomic_uint64 tuples_returned;
+	pg_atomic_uint64 tuples_fetched;
+	pg_atomic_uint64 blocks_fetched;
+	pg_atomic_uint64 blocks_hit;
+
 	PgStat_StatTabEntry stats;
 } PgStatShared_Relation;
 
@@ -424,6 +474,13 @@ typedef struct PgStat_ShmemControl
 	 */
 	pg_atomic_uint64 gc_request_count;
 
+	/*
+	 * Incremented whenever the stats of a relation change, which allows
+	 * callers of pgstat_scan_relation_stats() to only look at relations
+	 * whose stats changed since their previous scan.
+	 */
+	pg_atomic_uint64 relstats_generation;
+
 	/*
 	 * Stats data for fixed-numbered objects.
 	 */
@@ -431,6 +488,7 @@ typedef struct PgStat_ShmemControl
 	PgStatShared_BgWriter bgwriter;
 	PgStatShared_Checkpointer checkpointer;
 	PgStatShared_IO io;
+	PgStatShared_LWLock lwlock;
 	PgStatShared_SLRU slru;
 	PgStatShared_Wal wal;
 } PgStat_ShmemControl;
@@ -456,6 +514,8 @@ typedef struct PgStat_Snapshot
 
 	PgStat_IO	io;
 
+	PgStat_LWLockStats lwlock[LWLOCK_STATS_NUM_ELEMENTS];
+
 	PgStat_SLRUStats slru[SLRU_NUM_ELEMENTS];
 
 	PgStat_WalStats wal;
@@ -570,6 +630,16 @@ extern bool pgstat_function_flush_cb(PgStat_EntryRef *entry_ref, bool nowait);
 extern bool pgstat_flush_io(bool nowait);
 extern void pgstat_io_reset_all_cb(TimestampTz ts);
 extern void pgstat_io_snapshot_cb(void);
+extern void pgstat_io_restore(const PgStat_IO *stats);
+
+
+/*
+ * Functions in pgstat_lwlock.c
+ */
+
+extern bool pgstat_lwlock_flush(bool nowait);
+extern void pgstat_lwlock_reset_all_cb(TimestampTz ts);
+extern void pgstat_lwlock_snapshot_cb(void);
 
 
 /*
@@ -583,6 +653,9 @@ extern void PostPrepare_PgStat_Relations(PgStat_SubXactStatus *xact_state);
 
 extern bool pgstat_relation_flush_cb(PgStat_EntryRef *entry_ref, bool nowait);
 extern void pgstat_relation_delete_pending_cb(PgStat_EntryRef *entry_ref);
+extern void pgstat_relation_reset_timestamp_cb(PgStatShared_Common *header, TimestampTz ts);
+extern void pgstat_relation_init_shmem_cb(PgStatShared_Common *header);
+extern void pgstat_relation_fold_cb(PgStatShared_Common *header);
 
 
 /*
@@ -673,6 +746,13 @@ extern PGDLLIMPORT PgStat_LocalState pgStatLocal;
 extern PGDLLIMPORT bool have_iostats;
 
 
+/*
+ * Variables in pgstat_lwlock.c
+ */
+
+extern PGDLLIMPORT bool have_lwlockstats;
+
+
 /*
  * Variables in pgstat_slru.c
  */
@@ -229,6 +229,9 @@ extern bool CachedPlanAllowsSimpleValidityCheck(CachedPlanSource *plansource,
 extern bool CachedPlanIsSimplyValid(CachedPlanSource *plansource,
 									CachedPlan *plan,
 									ResourceOwner owner);
+extern bool CachedPlanIsStillValid(CachedPlanSource *plansource,
+								   CachedPlan *plan,
+								   ResourceOwner owner);
 
 extern CachedExpression *GetCachedExpression(Node *expr);
 extern void FreeCachedExpression(CachedExpression *cexpr);
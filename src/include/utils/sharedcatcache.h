@@ -0,0 +1,32 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.h
+ *	  Catalog cache tuples shared between backends.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedcatcache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDCATCACHE_H
+#define SHAREDCATCACHE_H
+
+#include "storage/sinval.h"
+#include "utils/catcache.h"
+
+/* GUC parameter */
+extern PGDLLIMPORT int shared_catcache_size;
+
+extern Size SharedCatCacheShmemSize(void);
+extern void SharedCatCacheShmemInit(void);
+
+extern HeapTuple SharedCatCacheLookup(CatCache *cache, uint32 hashValue);
+extern bool SharedCatCacheBeginLoad(int *msgnum);
+extern void SharedCatCacheStore(CatCache *cache, uint32 hashValue,
+								HeapTuple tuple, int msgnum);
+extern void SharedCatCacheSendInvalidMessages(const SharedInvalidationMessage *msgs,
+											  int n);
+
+#endif							/* SHAREDCATCACHE_H */
@@ -0,0 +1,33 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.h
+ *	  Cache of generic plans shared between backends.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedplancache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDPLANCACHE_H
+#define SHAREDPLANCACHE_H
+
+#include "utils/plancache.h"
+
+/* GUC parameter */
+extern PGDLLIMPORT int shared_plan_cache_size;
+
+extern Size SharedPlanCacheShmemSize(void);
+extern void SharedPlanCacheShmemInit(void);
+
+extern List *SharedPlanCacheLookup(CachedPlanSource *plansource,
+								   QueryEnvironment *queryEnv);
+extern void SharedPlanCacheStore(CachedPlanSource *plansource,
+								 List *stmt_list,
+								 QueryEnvironment *queryEnv);
+extern void SharedPlanCacheInvalidateRel(Oid relid);
+extern void SharedPlanCacheInvalidateObject(int cacheid, uint32 hashvalue);
+extern void SharedPlanCacheReset(void);
+
+#endif							/* SHAREDPLANCACHE_H */
@@ -171,6 +171,17 @@ typedef struct SortSupportData
 	 */
 	Datum		(*abbrev_converter) (Datum original, SortSupport ssup);
 
+	/*
+	 * Opclasses may set abbrev_by_ref to indicate that, contrary to the
+	 * above, their abbreviated keys are pointers to varlena values that
+	 * abbrev_converter pallocs in CurrentMemoryContext.  Core code then
+	 * calls the converter in the memory context holding the tuple the key
+	 * belongs to, counts the key's size as part of the tuple's, and frees
+	 * both together.  The converter must do any other allocations elsewhere
+	 * (e.g., in ssup_cxt), because that context need not support pfree().
+	 */
+	bool		abbrev_by_ref;
+
 	/*
 	 * abbrev_abort callback allows clients to verify that the current
 	 * strategy is working out, using a sortsupport routine defined ad-hoc
@@ -16,6 +16,9 @@
 #include "nodes/pg_list.h"
 #include "utils/sortsupport.h"
 
+/* GUC variable */
+extern PGDLLIMPORT bool full_sort_keys;
+
 extern int	varstr_cmp(const char *arg1, int len1, const char *arg2, int len2, Oid collid);
 extern void varstr_sortsupport(SortSupport ssup, Oid typid, Oid collid);
 extern int	varstr_levenshtein(const char *source, int slen,
@@ -80,3 +80,43 @@ create or replace function simplesql() returns int language sql
 as $$select 2 + 2$$;
 
 select simplecaller();
+
+
+-- Check that repeatedly executed queries notice plan invalidations
+
+create table simpletab (k int primary key, v int);
+insert into simpletab select g, g * 10 from generate_series(1, 20) g;
+create table simple1.simpletab (k int primary key, v int);
+insert into simple1.simpletab select g, g from generate_series(1, 20) g;
+
+create or replace function simplecaller() returns int language plpgsql
+as $$
+declare x int; sum int := 0;
+begin
+  for n in 1..20 loop
+    select v into x from simpletab where k = n;
+    sum := sum + x;
+    if n = 10 then
+      alter table simpletab alter column v type bigint using -v;
+    end if;
+  end loop;
+  return sum;
+end$$;
+
+select simplecaller();
+
+create or replace function simplecaller() returns int language plpgsql
+as $$
+declare x int; sum int := 0;
+begin
+  for n in 1..20 loop
+    select v into x from simpletab where k = n;
+    sum := sum + x;
+    if n = 10 then
+      set local search_path = 'simple1';
+    end if;
+  end loop;
+  return sum;
+end$$;
+
+select simplecaller();
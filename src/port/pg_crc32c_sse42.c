@@ -18,6 +18,33 @@
 
 #include "port/pg_crc32c.h"
 
+#ifdef __x86_64__
+
+/*
+ * The CRC32 instruction has a latency of several cycles but can start a new
+ * computation every cycle, so a single dependency chain leaves most of its
+ * throughput unused.  For large inputs we therefore compute the CRCs of three
+ * adjacent streams of CRC32C_STREAM_LEN bytes in parallel, and combine them:
+ * feeding N zero bytes to a CRC register is a linear function of the register
+ * contents, which pg_crc32c_shift_table precomputes for N = CRC32C_STREAM_LEN
+ * one register byte at a time.
+ */
+#define CRC32C_STREAM_LEN	512
+
+static const uint32 pg_crc32c_shift_table[4][256];
+
+/* Advance a CRC register over CRC32C_STREAM_LEN zero bytes */
+static inline pg_crc32c
+crc32c_shift(pg_crc32c crc)
+{
+	return pg_crc32c_shift_table[0][crc & 0xFF] ^
+		pg_crc32c_shift_table[1][(crc >> 8) & 0xFF] ^
+		pg_crc32c_shift_table[2][(crc >> 16) & 0xFF] ^
+		pg_crc32c_shift_table[3][crc >> 24];
+}
+
+#endif							/* __x86_64__ */
+
 pg_attribute_no_sanitize_alignment()
 pg_crc32c
 pg_comp_crc32c_sse42(pg_crc32c crc, const void *data, size_t len)
@@ -25,6 +52,26 @@ pg_comp_crc32c_sse42(pg_crc32c crc, const void *data, size_t len)
 	const unsigned char *p = data;
 	const unsigned char *pend = p + len;
 
+#ifdef __x86_64__
+	while (pend - p >= 3 * CRC32C_STREAM_LEN)
+	{
+		uint64		crc0 = crc;
+		uint64		crc1 = 0;
+		uint64		crc2 = 0;
+
+		for (int i = 0; i < CRC32C_STREAM_LEN; i += 8)
+		{
+			crc0 = _mm_crc32_u64(crc0, *((const uint64 *) (p + i)));
+			crc1 = _mm_crc32_u64(crc1, *((const uint64 *) (p + CRC32C_STREAM_LEN + i)));
+			crc2 = _mm_crc32_u64(crc2, *((const uint64 *) (p + 2 * CRC32C_STREAM_LEN + i)));
+		}
+
+		crc = crc32c_shift(crc32c_shift((pg_crc32c) crc0) ^ (pg_crc32c) crc1) ^
+			(pg_crc32c) crc2;
+		p += 3 * CRC32C_STREAM_LEN;
+	}
+#endif
+
 	/*
 	 * Process eight bytes of data at a time.
 	 *
@@ -67,3 +114,278 @@ pg_comp_crc32c_sse42(pg_crc32c crc, const void *data, size_t len)
 
 	return crc;
 }
+
+#ifdef __x86_64__
+
+/*
+ * pg_crc32c_shift_table[k][b] is the CRC register obtained by feeding
+ * CRC32C_STREAM_LEN zero bytes to a register holding b << (8 * k).
+ */
+static const uint32 pg_crc32c_shift_table[4][256] = {
+	{
+		0x00000000, 0xBD6F81F8, 0x7F337501, 0xC25CF4F9,
+		0xFE66EA02, 0x43096BFA, 0x81559F03, 0x3C3A1EFB,
+		0xF921A2F5, 0x444E230D, 0x8612D7F4, 0x3B7D560C,
+		0x074748F7, 0xBA28C90F, 0x78743DF6, 0xC51BBC0E,
+		0xF7AF331B, 0x4AC0B2E3, 0x889C461A, 0x35F3C7E2,
+		0x09C9D919, 0xB4A658E1, 0x76FAAC18, 0xCB952DE0,
+		0x0E8E91EE, 0xB3E11016, 0x71BDE4EF, 0xCCD26517,
+		0xF0E87BEC, 0x4D87FA14, 0x8FDB0EED, 0x32B48F15,
+		0xEAB210C7, 0x57DD913F, 0x958165C6, 0x28EEE43E,
+		0x14D4FAC5, 0xA9BB7B3D, 0x6BE78FC4, 0xD6880E3C,
+		0x1393B232, 0xAEFC33CA, 0x6CA0C733, 0xD1CF46CB,
+		0xEDF55830, 0x509AD9C8, 0x92C62D31, 0x2FA9ACC9,
+		0x1D1D23DC, 0xA072A224, 0x622E56DD, 0xDF41D725,
+		0xE37BC9DE, 0x5E144826, 0x9C48BCDF, 0x21273D27,
+		0xE43C8129, 0x595300D1, 0x9B0FF428, 0x266075D0,
+		0x1A5A6B2B, 0xA735EAD3, 0x65691E2A, 0xD8069FD2,
+		0xD088577F, 0x6DE7D687, 0xAFBB227E, 0x12D4A386,
+		0x2EEEBD7D, 0x93813C85, 0x51DDC87C, 0xECB24984,
+		0x29A9F58A, 0x94C67472, 0x569A808B, 0xEBF50173,
+		0xD7CF1F88, 0x6AA09E70, 0xA8FC6A89, 0x1593EB71,
+		0x27276464, 0x9A48E59C, 0x58141165, 0xE57B909D,
+		0xD9418E66, 0x642E0F9E, 0xA672FB67, 0x1B1D7A9F,
+		0xDE06C691, 0x63694769, 0xA135B390, 0x1C5A3268,
+		0x20602C93, 0x9D0FAD6B, 0x5F535992, 0xE23CD86A,
+		0x3A3A47B8, 0x8755C640, 0x450932B9, 0xF866B341,
+		0xC45CADBA, 0x79332C42, 0xBB6FD8BB, 0x06005943,
+		0xC31BE54D, 0x7E7464B5, 0xBC28904C, 0x014711B4,
+		0x3D7D0F4F, 0x80128EB7, 0x424E7A4E, 0xFF21FBB6,
+		0xCD9574A3, 0x70FAF55B, 0xB2A601A2, 0x0FC9805A,
+		0x33F39EA1, 0x8E9C1F59, 0x4CC0EBA0, 0xF1AF6A58,
+		0x34B4D656, 0x89DB57AE, 0x4B87A357, 0xF6E822AF,
+		0xCAD23C54, 0x77BDBDAC, 0xB5E14955, 0x088EC8AD,
+		0xA4FCD80F, 0x199359F7, 0xDBCFAD0E, 0x66A02CF6,
+		0x5A9A320D, 0xE7F5B3F5, 0x25A9470C, 0x98C6C6F4,
+		0x5DDD7AFA, 0xE0B2FB02, 0x22EE0FFB, 0x9F818E03,
+		0xA3BB90F8, 0x1ED41100, 0xDC88E5F9, 0x61E76401,
+		0x5353EB14, 0xEE3C6AEC, 0x2C609E15, 0x910F1FED,
+		0xAD350116, 0x105A80EE, 0xD2067417, 0x6F69F5EF,
+		0xAA7249E1, 0x171DC819, 0xD5413CE0, 0x682EBD18,
+		0x5414A3E3, 0xE97B221B, 0x2B27D6E2, 0x9648571A,
+		0x4E4EC8C8, 0xF3214930, 0x317DBDC9, 0x8C123C31,
+		0xB02822CA, 0x0D47A332, 0xCF1B57CB, 0x7274D633,
+		0xB76F6A3D, 0x0A00EBC5, 0xC85C1F3C, 0x75339EC4,
+		0x4909803F, 0xF46601C7, 0x363AF53E, 0x8B5574C6,
+		0xB9E1FBD3, 0x048E7A2B, 0xC6D28ED2, 0x7BBD0F2A,
+		0x478711D1, 0xFAE89029, 0x38B464D0, 0x85DBE528,
+		0x40C05926, 0xFDAFD8DE, 0x3FF32C27, 0x829CADDF,
+		0xBEA6B324, 0x03C932DC, 0xC195C625, 0x7CFA47DD,
+		0x74748F70, 0xC91B0E88, 0x0B47FA71, 0xB6287B89,
+		0x8A126572, 0x377DE48A, 0xF5211073, 0x484E918B,
+		0x8D552D85, 0x303AAC7D, 0xF2665884, 0x4F09D97C,
+		0x7333C787, 0xCE5C467F, 0x0C00B286, 0xB16F337E,
+		0x83DBBC6B, 0x3EB43D93, 0xFCE8C96A, 0x41874892,
+		0x7DBD5669, 0xC0D2D791, 0x028E2368, 0xBFE1A290,
+		0x7AFA1E9E, 0xC7959F66, 0x05C96B9F, 0xB8A6EA67,
+		0x849CF49C, 0x39F37564, 0xFBAF819D, 0x46C00065,
+		0x9EC69FB7, 0x23A91E4F, 0xE1F5EAB6, 0x5C9A6B4E,
+		0x60A075B5, 0xDDCFF44D, 0x1F9300B4, 0xA2FC814C,
+		0x67E73D42, 0xDA88BCBA, 0x18D44843, 0xA5BBC9BB,
+		0x9981D740, 0x24EE56B8, 0xE6B2A241, 0x5BDD23B9,
+		0x6969ACAC, 0xD4062D54, 0x165AD9AD, 0xAB355855,
+		0x970F46AE, 0x2A60C756, 0xE83C33AF, 0x5553B257,
+		0x90480E59, 0x2D278FA1, 0xEF7B7B58, 0x5214FAA0,
+		0x6E2EE45B, 0xD34165A3, 0x111D915A, 0xAC7210A2
+	},
+	{
+		0x00000000, 0x4C15C6EF, 0x982B8DDE, 0xD43E4B31,
+		0x35BB6D4D, 0x79AEABA2, 0xAD90E093, 0xE185267C,
+		0x6B76DA9A, 0x27631C75, 0xF35D5744, 0xBF4891AB,
+		0x5ECDB7D7, 0x12D87138, 0xC6E63A09, 0x8AF3FCE6,
+		0xD6EDB534, 0x9AF873DB, 0x4EC638EA, 0x02D3FE05,
+		0xE356D879, 0xAF431E96, 0x7B7D55A7, 0x37689348,
+		0xBD9B6FAE, 0xF18EA941, 0x25B0E270, 0x69A5249F,
+		0x882002E3, 0xC435C40C, 0x100B8F3D, 0x5C1E49D2,
+		0xA8371C99, 0xE422DA76, 0x301C9147, 0x7C0957A8,
+		0x9D8C71D4, 0xD199B73B, 0x05A7FC0A, 0x49B23AE5,
+		0xC341C603, 0x8F5400EC, 0x5B6A4BDD, 0x177F8D32,
+		0xF6FAAB4E, 0xBAEF6DA1, 0x6ED12690, 0x22C4E07F,
+		0x7EDAA9AD, 0x32CF6F42, 0xE6F12473, 0xAAE4E29C,
+		0x4B61C4E0, 0x0774020F, 0xD34A493E, 0x9F5F8FD1,
+		0x15AC7337, 0x59B9B5D8, 0x8D87FEE9, 0xC1923806,
+		0x20171E7A, 0x6C02D895, 0xB83C93A4, 0xF429554B,
+		0x55824FC3, 0x1997892C, 0xCDA9C21D, 0x81BC04F2,
+		0x6039228E, 0x2C2CE461, 0xF812AF50, 0xB40769BF,
+		0x3EF49559, 0x72E153B6, 0xA6DF1887, 0xEACADE68,
+		0x0B4FF814, 0x475A3EFB, 0x936475CA, 0xDF71B325,
+		0x836FFAF7, 0xCF7A3C18, 0x1B447729, 0x5751B1C6,
+		0xB6D497BA, 0xFAC15155, 0x2EFF1A64, 0x62EADC8B,
+		0xE819206D, 0xA40CE682, 0x7032ADB3, 0x3C276B5C,
+		0xDDA24D20, 0x91B78BCF, 0x4589C0FE, 0x099C0611,
+		0xFDB5535A, 0xB1A095B5, 0x659EDE84, 0x298B186B,
+		0xC80E3E17, 0x841BF8F8, 0x5025B3C9, 0x1C307526,
+		0x96C389C0, 0xDAD64F2F, 0x0EE8041E, 0x42FDC2F1,
+		0xA378E48D, 0xEF6D2262, 0x3B536953, 0x7746AFBC,
+		0x2B58E66E, 0x674D2081, 0xB3736BB0, 0xFF66AD5F,
+		0x1EE38B23, 0x52F64DCC, 0x86C806FD, 0xCADDC012,
+		0x402E3CF4, 0x0C3BFA1B, 0xD805B12A, 0x941077C5,
+		0x759551B9, 0x39809756, 0xEDBEDC67, 0xA1AB1A88,
+		0xAB049F86, 0xE7115969, 0x332F1258, 0x7F3AD4B7,
+		0x9EBFF2CB, 0xD2AA3424, 0x06947F15, 0x4A81B9FA,
+		0xC072451C, 0x8C6783F3, 0x5859C8C2, 0x144C0E2D,
+		0xF5C92851, 0xB9DCEEBE, 0x6DE2A58F, 0x21F76360,
+		0x7DE92AB2, 0x31FCEC5D, 0xE5C2A76C, 0xA9D76183,
+		0x485247FF, 0x04478110, 0xD079CA21, 0x9C6C0CCE,
+		0x169FF028, 0x5A8A36C7, 0x8EB47DF6, 0xC2A1BB19,
+		0x23249D65, 0x6F315B8A, 0xBB0F10BB, 0xF71AD654,
+		0x0333831F, 0x4F2645F0, 0x9B180EC1, 0xD70DC82E,
+		0x3688EE52, 0x7A9D28BD, 0xAEA3638C, 0xE2B6A563,
+		0x68455985, 0x24509F6A, 0xF06ED45B, 0xBC7B12B4,
+		0x5DFE34C8, 0x11EBF227, 0xC5D5B916, 0x89C07FF9,
+		0xD5DE362B, 0x99CBF0C4, 0x4DF5BBF5, 0x01E07D1A,
+		0xE0655B66, 0xAC709D89, 0x784ED6B8, 0x345B1057,
+		0xBEA8ECB1, 0xF2BD2A5E, 0x2683616F, 0x6A96A780,
+		0x8B1381FC, 0xC7064713, 0x13380C22, 0x5F2DCACD,
+		0xFE86D045, 0xB29316AA, 0x66AD5D9B, 0x2AB89B74,
+		0xCB3DBD08, 0x87287BE7, 0x531630D6, 0x1F03F639,
+		0x95F00ADF, 0xD9E5CC30, 0x0DDB8701, 0x41CE41EE,
+		0xA04B6792, 0xEC5EA17D, 0x3860EA4C, 0x74752CA3,
+		0x286B6571, 0x647EA39E, 0xB040E8AF, 0xFC552E40,
+		0x1DD0083C, 0x51C5CED3, 0x85FB85E2, 0xC9EE430D,
+		0x431DBFEB, 0x0F087904, 0xDB363235, 0x9723F4DA,
+		0x76A6D2A6, 0x3AB31449, 0xEE8D5F78, 0xA2989997,
+		0x56B1CCDC, 0x1AA40A33, 0xCE9A4102, 0x828F87ED,
+		0x630AA191, 0x2F1F677E, 0xFB212C4F, 0xB734EAA0,
+		0x3DC71646, 0x71D2D0A9, 0xA5EC9B98, 0xE9F95D77,
+		0x087C7B0B, 0x4469BDE4, 0x9057F6D5, 0xDC42303A,
+		0x805C79E8, 0xCC49BF07, 0x1877F436, 0x546232D9,
+		0xB5E714A5, 0xF9F2D24A, 0x2DCC997B, 0x61D95F94,
+		0xEB2AA372, 0xA73F659D, 0x73012EAC, 0x3F14E843,
+		0xDE91CE3F, 0x928408D0, 0x46BA43E1, 0x0AAF850E
+	},
+	{
+		0x00000000, 0x53E549FD, 0xA7CA93FA, 0xF42FDA07,
+		0x4A795105, 0x199C18F8, 0xEDB3C2FF, 0xBE568B02,
+		0x94F2A20A, 0xC717EBF7, 0x333831F0, 0x60DD780D,
+		0xDE8BF30F, 0x8D6EBAF2, 0x794160F5, 0x2AA42908,
+		0x2C0932E5, 0x7FEC7B18, 0x8BC3A11F, 0xD826E8E2,
+		0x667063E0, 0x35952A1D, 0xC1BAF01A, 0x925FB9E7,
+		0xB8FB90EF, 0xEB1ED912, 0x1F310315, 0x4CD44AE8,
+		0xF282C1EA, 0xA1678817, 0x55485210, 0x06AD1BED,
+		0x581265CA, 0x0BF72C37, 0xFFD8F630, 0xAC3DBFCD,
+		0x126B34CF, 0x418E7D32, 0xB5A1A735, 0xE644EEC8,
+		0xCCE0C7C0, 0x9F058E3D, 0x6B2A543A, 0x38CF1DC7,
+		0x869996C5, 0xD57CDF38, 0x2153053F, 0x72B64CC2,
+		0x741B572F, 0x27FE1ED2, 0xD3D1C4D5, 0x80348D28,
+		0x3E62062A, 0x6D874FD7, 0x99A895D0, 0xCA4DDC2D,
+		0xE0E9F525, 0xB30CBCD8, 0x472366DF, 0x14C62F22,
+		0xAA90A420, 0xF975EDDD, 0x0D5A37DA, 0x5EBF7E27,
+		0xB024CB94, 0xE3C18269, 0x17EE586E, 0x440B1193,
+		0xFA5D9A91, 0xA9B8D36C, 0x5D97096B, 0x0E724096,
+		0x24D6699E, 0x77332063, 0x831CFA64, 0xD0F9B399,
+		0x6EAF389B, 0x3D4A7166, 0xC965AB61, 0x9A80E29C,
+		0x9C2DF971, 0xCFC8B08C, 0x3BE76A8B, 0x68022376,
+		0xD654A874, 0x85B1E189, 0x719E3B8E, 0x227B7273,
+		0x08DF5B7B, 0x5B3A1286, 0xAF15C881, 0xFCF0817C,
+		0x42A60A7E, 0x11434383, 0xE56C9984, 0xB689D079,
+		0xE836AE5E, 0xBBD3E7A3, 0x4FFC3DA4, 0x1C197459,
+		0xA24FFF5B, 0xF1AAB6A6, 0x05856CA1, 0x5660255C,
+		0x7CC40C54, 0x2F2145A9, 0xDB0E9FAE, 0x88EBD653,
+		0x36BD5D51, 0x655814AC, 0x9177CEAB, 0xC2928756,
+		0xC43F9CBB, 0x97DAD546, 0x63F50F41, 0x301046BC,
+		0x8E46CDBE, 0xDDA38443, 0x298C5E44, 0x7A6917B9,
+		0x50CD3EB1, 0x0328774C, 0xF707AD4B, 0xA4E2E4B6,
+		0x1AB46FB4, 0x49512649, 0xBD7EFC4E, 0xEE9BB5B3,
+		0x65A5E1D9, 0x3640A824, 0xC26F7223, 0x918A3BDE,
+		0x2FDCB0DC, 0x7C39F921, 0x88162326, 0xDBF36ADB,
+		0xF15743D3, 0xA2B20A2E, 0x569DD029, 0x057899D4,
+		0xBB2E12D6, 0xE8CB5B2B, 0x1CE4812C, 0x4F01C8D1,
+		0x49ACD33C, 0x1A499AC1, 0xEE6640C6, 0xBD83093B,
+		0x03D58239, 0x5030CBC4, 0xA41F11C3, 0xF7FA583E,
+		0xDD5E7136, 0x8EBB38CB, 0x7A94E2CC, 0x2971AB31,
+		0x97272033, 0xC4C269CE, 0x30EDB3C9, 0x6308FA34,
+		0x3DB78413, 0x6E52CDEE, 0x9A7D17E9, 0xC9985E14,
+		0x77CED516, 0x242B9CEB, 0xD00446EC, 0x83E10F11,
+		0xA9452619, 0xFAA06FE4, 0x0E8FB5E3, 0x5D6AFC1E,
+		0xE33C771C, 0xB0D93EE1, 0x44F6E4E6, 0x1713AD1B,
+		0x11BEB6F6, 0x425BFF0B, 0xB674250C, 0xE5916CF1,
+		0x5BC7E7F3, 0x0822AE0E, 0xFC0D7409, 0xAFE83DF4,
+		0x854C14FC, 0xD6A95D01, 0x22868706, 0x7163CEFB,
+		0xCF3545F9, 0x9CD00C04, 0x68FFD603, 0x3B1A9FFE,
+		0xD5812A4D, 0x866463B0, 0x724BB9B7, 0x21AEF04A,
+		0x9FF87B48, 0xCC1D32B5, 0x3832E8B2, 0x6BD7A14F,
+		0x41738847, 0x1296C1BA, 0xE6B91BBD, 0xB55C5240,
+		0x0B0AD942, 0x58EF90BF, 0xACC04AB8, 0xFF250345,
+		0xF98818A8, 0xAA6D5155, 0x5E428B52, 0x0DA7C2AF,
+		0xB3F149AD, 0xE0140050, 0x143BDA57, 0x47DE93AA,
+		0x6D7ABAA2, 0x3E9FF35F, 0xCAB02958, 0x995560A5,
+		0x2703EBA7, 0x74E6A25A, 0x80C9785D, 0xD32C31A0,
+		0x8D934F87, 0xDE76067A, 0x2A59DC7D, 0x79BC9580,
+		0xC7EA1E82, 0x940F577F, 0x60208D78, 0x33C5C485,
+		0x1961ED8D, 0x4A84A470, 0xBEAB7E77, 0xED4E378A,
+		0x5318BC88, 0x00FDF575, 0xF4D22F72, 0xA737668F,
+		0xA19A7D62, 0xF27F349F, 0x0650EE98, 0x55B5A765,
+		0xEBE32C67, 0xB806659A, 0x4C29BF9D, 0x1FCCF660,
+		0x3568DF68, 0x668D9695, 0x92A24C92, 0xC147056F,
+		0x7F118E6D, 0x2CF4C790, 0xD8DB1D97, 0x8B3E546A
+	},
+	{
+		0x00000000, 0xCB4BC3B2, 0x937BF195, 0x58303227,
+		0x231B95DB, 0xE8505669, 0xB060644E, 0x7B2BA7FC,
+		0x46372BB6, 0x8D7CE804, 0xD54CDA23, 0x1E071991,
+		0x652CBE6D, 0xAE677DDF, 0xF6574FF8, 0x3D1C8C4A,
+		0x8C6E576C, 0x472594DE, 0x1F15A6F9, 0xD45E654B,
+		0xAF75C2B7, 0x643E0105, 0x3C0E3322, 0xF745F090,
+		0xCA597CDA, 0x0112BF68, 0x59228D4F, 0x92694EFD,
+		0xE942E901, 0x22092AB3, 0x7A391894, 0xB172DB26,
+		0x1D30D829, 0xD67B1B9B, 0x8E4B29BC, 0x4500EA0E,
+		0x3E2B4DF2, 0xF5608E40, 0xAD50BC67, 0x661B7FD5,
+		0x5B07F39F, 0x904C302D, 0xC87C020A, 0x0337C1B8,
+		0x781C6644, 0xB357A5F6, 0xEB6797D1, 0x202C5463,
+		0x915E8F45, 0x5A154CF7, 0x02257ED0, 0xC96EBD62,
+		0xB2451A9E, 0x790ED92C, 0x213EEB0B, 0xEA7528B9,
+		0xD769A4F3, 0x1C226741, 0x44125566, 0x8F5996D4,
+		0xF4723128, 0x3F39F29A, 0x6709C0BD, 0xAC42030F,
+		0x3A61B052, 0xF12A73E0, 0xA91A41C7, 0x62518275,
+		0x197A2589, 0xD231E63B, 0x8A01D41C, 0x414A17AE,
+		0x7C569BE4, 0xB71D5856, 0xEF2D6A71, 0x2466A9C3,
+		0x5F4D0E3F, 0x9406CD8D, 0xCC36FFAA, 0x077D3C18,
+		0xB60FE73E, 0x7D44248C, 0x257416AB, 0xEE3FD519,
+		0x951472E5, 0x5E5FB157, 0x066F8370, 0xCD2440C2,
+		0xF038CC88, 0x3B730F3A, 0x63433D1D, 0xA808FEAF,
+		0xD3235953, 0x18689AE1, 0x4058A8C6, 0x8B136B74,
+		0x2751687B, 0xEC1AABC9, 0xB42A99EE, 0x7F615A5C,
+		0x044AFDA0, 0xCF013E12, 0x97310C35, 0x5C7ACF87,
+		0x616643CD, 0xAA2D807F, 0xF21DB258, 0x395671EA,
+		0x427DD616, 0x893615A4, 0xD1062783, 0x1A4DE431,
+		0xAB3F3F17, 0x6074FCA5, 0x3844CE82, 0xF30F0D30,
+		0x8824AACC, 0x436F697E, 0x1B5F5B59, 0xD01498EB,
+		0xED0814A1, 0x2643D713, 0x7E73E534, 0xB5382686,
+		0xCE13817A, 0x055842C8, 0x5D6870EF, 0x9623B35D,
+		0x74C360A4, 0xBF88A316, 0xE7B89131, 0x2CF35283,
+		0x57D8F57F, 0x9C9336CD, 0xC4A304EA, 0x0FE8C758,
+		0x32F44B12, 0xF9BF88A0, 0xA18FBA87, 0x6AC47935,
+		0x11EFDEC9, 0xDAA41D7B, 0x82942F5C, 0x49DFECEE,
+		0xF8AD37C8, 0x33E6F47A, 0x6BD6C65D, 0xA09D05EF,
+		0xDBB6A213, 0x10FD61A1, 0x48CD5386, 0x83869034,
+		0xBE9A1C7E, 0x75D1DFCC, 0x2DE1EDEB, 0xE6AA2E59,
+		0x9D8189A5, 0x56CA4A17, 0x0EFA7830, 0xC5B1BB82,
+		0x69F3B88D, 0xA2B87B3F, 0xFA884918, 0x31C38AAA,
+		0x4AE82D56, 0x81A3EEE4, 0xD993DCC3, 0x12D81F71,
+		0x2FC4933B, 0xE48F5089, 0xBCBF62AE, 0x77F4A11C,
+		0x0CDF06E0, 0xC794C552, 0x9FA4F775, 0x54EF34C7,
+		0xE59DEFE1, 0x2ED62C53, 0x76E61E74, 0xBDADDDC6,
+		0xC6867A3A, 0x0DCDB988, 0x55FD8BAF, 0x9EB6481D,
+		0xA3AAC457, 0x68E107E5, 0x30D135C2, 0xFB9AF670,
+		0x80B1518C, 0x4BFA923E, 0x13CAA019, 0xD88163AB,
+		0x4EA2D0F6, 0x85E91344, 0xDDD92163, 0x1692E2D1,
+		0x6DB9452D, 0xA6F2869F, 0xFEC2B4B8, 0x3589770A,
+		0x0895FB40, 0xC3DE38F2, 0x9BEE0AD5, 0x50A5C967,
+		0x2B8E6E9B, 0xE0C5AD29, 0xB8F59F0E, 0x73BE5CBC,
+		0xC2CC879A, 0x09874428, 0x51B7760F, 0x9AFCB5BD,
+		0xE1D71241, 0x2A9CD1F3, 0x72ACE3D4, 0xB9E72066,
+		0x84FBAC2C, 0x4FB06F9E, 0x17805DB9, 0xDCCB9E0B,
+		0xA7E039F7, 0x6CABFA45, 0x349BC862, 0xFFD00BD0,
+		0x539208DF, 0x98D9CB6D, 0xC0E9F94A, 0x0BA23AF8,
+		0x70899D04, 0xBBC25EB6, 0xE3F26C91, 0x28B9AF23,
+		0x15A52369, 0xDEEEE0DB, 0x86DED2FC, 0x4D95114E,
+		0x36BEB6B2, 0xFDF57500, 0xA5C54727, 0x6E8E8495,
+		0xDFFC5FB3, 0x14B79C01, 0x4C87AE26, 0x87CC6D94,
+		0xFCE7CA68, 0x37AC09DA, 0x6F9C3BFD, 0xA4D7F84F,
+		0x99CB7405, 0x5280B7B7, 0x0AB08590, 0xC1FB4622,
+		0xBAD0E1DE, 0x719B226C, 0x29AB104B, 0xE2E0D3F9
+	}
+};
+
+#endif							/* __x86_64__ */
@@ -0,0 +1,186 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_numa.c
+ *	  Basic NUMA portability routines
+ *
+ * On Linux, these are thin wrappers around the mbind(2) and move_pages(2)
+ * system calls, which we call directly so as not to need libnuma.  On other
+ * platforms, NUMA is reported as not supported.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/port/pg_numa.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "c.h"
+
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "port/pg_numa.h"
+
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_move_pages)
+
+/* from <linux/mempolicy.h> */
+#define PG_MPOL_INTERLEAVE	3
+
+/* we don't support more nodes than this */
+#define PG_NUMA_MAX_NODES	1024
+
+/*
+ * Highest NUMA node number, or -1 if not known yet.  The value can't change
+ * while we're running.
+ */
+static int	numa_max_node = -1;
+
+/*
+ * Find the highest online node from /sys.  The file contains a list of node
+ * ranges like "0-3" or "0,2-3"; the last number is the one we want.
+ */
+static int
+read_max_node(void)
+{
+	FILE	   *f;
+	int			c;
+	int			num = -1;
+	int			last = -1;
+
+	f = fopen("/sys/devices/system/node/online", "r");
+	if (f == NULL)
+		return -1;
+
+	while ((c = fgetc(f)) != EOF)
+	{
+		if (c >= '0' && c <= '9')
+			num = (num < 0 ? 0 : num * 10) + (c - '0');
+		else
+		{
+			if (num >= 0)
+				last = num;
+			num = -1;
+		}
+	}
+	if (num >= 0)
+		last = num;
+
+	fclose(f);
+
+	if (last >= PG_NUMA_MAX_NODES)
+		return -1;
+	return last;
+}
+
+/*
+ * Returns 0 if NUMA is supported on this system, or -1 if not.
+ */
+int
+pg_numa_init(void)
+{
+	if (numa_max_node < 0)
+		numa_max_node = read_max_node();
+
+	return numa_max_node < 0 ? -1 : 0;
+}
+
+/*
+ * Returns the highest NUMA node number.  pg_numa_init() must have succeeded.
+ */
+int
+pg_numa_get_max_node(void)
+{
+	Assert(numa_max_node >= 0);
+	return numa_max_node;
+}
+
+/*
+ * Ask the kernel to spread the pages of the given memory range over all
+ * NUMA nodes, in round-robin fashion, as they are first touched.  Only the
+ * whole pages (of 'pagesize' bytes, or the system's page size if 0) within
+ * the range are affected.
+ *
+ * Returns 0 on success, or -1 with errno set.
+ */
+int
+pg_numa_interleave_memory(void *ptr, size_t size, size_t pagesize)
+{
+	unsigned long nodemask[PG_NUMA_MAX_NODES / (8 * sizeof(unsigned long))];
+	uintptr_t	start;
+	uintptr_t	end;
+
+	if (pg_numa_init() != 0)
+	{
+		errno = ENOSYS;
+		return -1;
+	}
+
+	if (pagesize == 0)
+		pagesize = sysconf(_SC_PAGESIZE);
+	start = TYPEALIGN(pagesize, (uintptr_t) ptr);
+	end = TYPEALIGN_DOWN(pagesize, (uintptr_t) ptr + size);
+	if (end <= start)
+		return 0;
+
+	memset(nodemask, 0, sizeof(nodemask));
+	for (int node = 0; node <= numa_max_node; node++)
+		nodemask[node / (8 * sizeof(unsigned long))] |=
+			1UL << (node % (8 * sizeof(unsigned long)));
+
+	/* the kernel wants the number of bits in the mask, plus one */
+	if (syscall(SYS_mbind, (void *) start, (unsigned long) (end - start),
+				PG_MPOL_INTERLEAVE, nodemask,
+				(unsigned long) (numa_max_node + 2), 0) != 0)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * Look up the NUMA node of each of the 'count' pages at 'pages' in the
+ * address space of process 'pid' (0 for our own).  The node, or a negative
+ * errno value if the page isn't resident, is stored in 'status'.
+ *
+ * Returns 0 on success, or -1 with errno set.
+ */
+int
+pg_numa_query_pages(int pid, unsigned long count, void **pages, int *status)
+{
+	return syscall(SYS_move_pages, pid, count, pages, NULL, status, 0) == 0 ?
+		0 : -1;
+}
+
+#else
+
+/* NUMA is not supported on this platform */
+
+int
+pg_numa_init(void)
+{
+	return -1;
+}
+
+int
+pg_numa_get_max_node(void)
+{
+	return 0;
+}
+
+int
+pg_numa_interleave_memory(void *ptr, size_t size, size_t pagesize)
+{
+	errno = ENOSYS;
+	return -1;
+}
+
+int
+pg_numa_query_pages(int pid, unsigned long count, void **pages, int *status)
+{
+	errno = ENOSYS;
+	return -1;
+}
+
+#endif
@@ -0,0 +1,5 @@
+-- pgbench script running bench_buffer_pin() on the table bench_buffers,
+-- which must be created first, see README
+\set iterations 10000
+\set npins 16
+SELECT bench_buffer_pin('bench_buffers', :iterations, :npins);
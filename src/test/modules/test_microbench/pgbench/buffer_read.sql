@@ -0,0 +1,4 @@
+-- pgbench script running bench_buffer_read() on the table bench_buffers,
+-- which must be created first, see README
+\set iterations 10000
+SELECT bench_buffer_read('bench_buffers', :iterations, true);
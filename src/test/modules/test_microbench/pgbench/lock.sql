@@ -0,0 +1,4 @@
+-- pgbench script running bench_lock_acquire(), see README for nlocks
+\set iterations 10000
+\set nlocks 32
+SELECT bench_lock_acquire(:iterations, :nlocks);
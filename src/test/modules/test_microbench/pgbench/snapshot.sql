@@ -0,0 +1,3 @@
+-- pgbench script running bench_get_snapshot()
+\set iterations 100000
+SELECT bench_get_snapshot(:iterations);
@@ -0,0 +1,4 @@
+-- pgbench script running bench_xlog_insert(), see README for record_size
+\set iterations 10000
+\set record_size 64
+SELECT bench_xlog_insert(:iterations, :record_size);
@@ -0,0 +1,25 @@
+CREATE EXTENSION test_microbench;
+
+-- The rates vary, only check that the benchmarks run
+SELECT bench_get_snapshot(1000) > 0 AS ok;
+SELECT bench_lock_acquire(100) > 0 AS ok;
+SELECT bench_lock_acquire(100, 50) > 0 AS ok;
+SELECT bench_xlog_insert(100) > 0 AS ok;
+SELECT bench_xlog_insert(100, 8192) > 0 AS ok;
+
+CREATE TABLE bench_tab AS SELECT g FROM generate_series(1, 10000) g;
+SELECT bench_buffer_read('bench_tab', 1000) > 0 AS ok;
+SELECT bench_buffer_read('bench_tab', 1000, false) > 0 AS ok;
+SELECT bench_buffer_pin('bench_tab', 100) > 0 AS ok;
+SELECT bench_buffer_pin('bench_tab', 100, 4) > 0 AS ok;
+
+-- errors
+SELECT bench_get_snapshot(0);
+SELECT bench_lock_acquire(10, 0);
+SELECT bench_xlog_insert(10, -1);
+CREATE TABLE bench_empty (a int);
+SELECT bench_buffer_read('bench_empty', 10);
+SELECT bench_buffer_pin('bench_tab', 10, 0);
+SELECT bench_buffer_pin('bench_tab', 10, 1000);
+
+DROP TABLE bench_tab, bench_empty;
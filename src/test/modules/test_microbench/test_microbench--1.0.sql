@@ -0,0 +1,30 @@
+/* src/test/modules/test_microbench/test_microbench--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_microbench" to load this file. \quit
+
+CREATE FUNCTION bench_get_snapshot(iterations bigint)
+RETURNS pg_catalog.float8 STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_lock_acquire(iterations bigint,
+    nlocks integer DEFAULT 1)
+RETURNS pg_catalog.float8 STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_xlog_insert(iterations bigint,
+    record_size integer DEFAULT 64)
+RETURNS pg_catalog.float8 STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_buffer_read(rel regclass,
+    iterations bigint,
+    use_ring boolean DEFAULT true)
+RETURNS pg_catalog.float8 STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_buffer_pin(rel regclass,
+    iterations bigint,
+    npins integer DEFAULT 16)
+RETURNS pg_catalog.float8 STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
@@ -0,0 +1,318 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_microbench.c
+ *		Micro-benchmarks of hot paths of the backend.
+ *
+ * Each function performs one operation a given number of times in a tight
+ * loop, and returns the number of operations per second it achieved.  Run
+ * from several sessions at once, for example with the pgbench scripts in
+ * the pgbench subdirectory, they show how the operation scales with the
+ * number of concurrent processes.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_microbench/test_microbench.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/relation.h"
+#include "access/xlog.h"
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "portability/instr_time.h"
+#include "replication/message.h"
+#include "storage/bufmgr.h"
+#include "storage/lmgr.h"
+#include "storage/procarray.h"
+#include "utils/acl.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+PG_MODULE_MAGIC;
+
+/* maximum number of locks bench_lock_acquire() holds at once */
+#define MAX_BENCH_LOCKS			1000
+
+/* relation OIDs locked by bench_lock_acquire(), unlikely to exist */
+#define BENCH_LOCK_FIRST_RELID	((Oid) 4000000000U)
+
+/* maximum size of the WAL records written by bench_xlog_insert() */
+#define MAX_BENCH_RECORD_SIZE	(1024 * 1024)
+
+/* maximum number of buffers bench_buffer_pin() keeps pinned */
+#define MAX_BENCH_PINS			1000
+
+PG_FUNCTION_INFO_V1(bench_get_snapshot);
+PG_FUNCTION_INFO_V1(bench_lock_acquire);
+PG_FUNCTION_INFO_V1(bench_xlog_insert);
+PG_FUNCTION_INFO_V1(bench_buffer_read);
+PG_FUNCTION_INFO_V1(bench_buffer_pin);
+
+/*
+ * Return the rate of 'nops' operations performed since 'start'.
+ */
+static double
+ops_per_second(instr_time start, int64 nops)
+{
+	instr_time	duration;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+
+	return nops / INSTR_TIME_GET_DOUBLE(duration);
+}
+
+static void
+check_iterations(int64 iterations)
+{
+	if (iterations <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of iterations must be greater than zero")));
+}
+
+/*
+ * Take snapshots with GetSnapshotData().  When no transaction has ended
+ * since the previous call, the snapshot is reused rather than rebuilt from
+ * the proc array, so the result depends a lot on the concurrent write
+ * activity.
+ */
+Datum
+bench_get_snapshot(PG_FUNCTION_ARGS)
+{
+	int64		iterations = PG_GETARG_INT64(0);
+	static SnapshotData snapshot = {SNAPSHOT_MVCC};
+	instr_time	start;
+
+	check_iterations(iterations);
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	for (int64 i = 0; i < iterations; i++)
+	{
+		if ((i & 1023) == 0)
+			CHECK_FOR_INTERRUPTS();
+
+		GetSnapshotData(&snapshot);
+	}
+
+	PG_RETURN_FLOAT8(ops_per_second(start, iterations));
+}
+
+/*
+ * Acquire AccessShareLock on 'nlocks' relations, then release them again,
+ * 'iterations' times.  The first FP_LOCK_SLOTS_PER_BACKEND locks use the
+ * fast-path slots of the process, the others go to the partitions of the
+ * shared lock table.  Each acquisition and release counts as one operation.
+ */
+Datum
+bench_lock_acquire(PG_FUNCTION_ARGS)
+{
+	int64		iterations = PG_GETARG_INT64(0);
+	int32		nlocks = PG_GETARG_INT32(1);
+	LOCKTAG    *tags;
+	instr_time	start;
+
+	check_iterations(iterations);
+	if (nlocks < 1 || nlocks > MAX_BENCH_LOCKS)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of locks must be between 1 and %d",
+						MAX_BENCH_LOCKS)));
+
+	tags = palloc(sizeof(LOCKTAG) * nlocks);
+	for (int j = 0; j < nlocks; j++)
+		SET_LOCKTAG_RELATION(tags[j], MyDatabaseId, BENCH_LOCK_FIRST_RELID + j);
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	for (int64 i = 0; i < iterations; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		for (int j = 0; j < nlocks; j++)
+			(void) LockAcquire(&tags[j], AccessShareLock, false, false);
+		for (int j = 0; j < nlocks; j++)
+			LockRelease(&tags[j], AccessShareLock, false);
+	}
+
+	PG_RETURN_FLOAT8(ops_per_second(start, iterations * nlocks * 2));
+}
+
+/*
+ * Insert 'iterations' WAL records carrying 'record_size' bytes of data.
+ * Non-transactional logical decoding messages are used, since they can be
+ * written without side effects.  The records are not flushed.
+ */
+Datum
+bench_xlog_insert(PG_FUNCTION_ARGS)
+{
+	int64		iterations = PG_GETARG_INT64(0);
+	int32		record_size = PG_GETARG_INT32(1);
+	char	   *data;
+	instr_time	start;
+
+	check_iterations(iterations);
+	if (record_size < 0 || record_size > MAX_BENCH_RECORD_SIZE)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("record size must be between 0 and %d",
+						MAX_BENCH_RECORD_SIZE)));
+
+	if (RecoveryInProgress())
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("recovery is in progress"),
+				 errhint("WAL cannot be written during recovery.")));
+
+	data = palloc0(record_size);
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	for (int64 i = 0; i < iterations; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		(void) LogLogicalMessage("test_microbench", data, record_size, false);
+	}
+
+	PG_RETURN_FLOAT8(ops_per_second(start, iterations));
+}
+
+/*
+ * Open a relation to read its blocks, after checking that the user may read
+ * it and that it has any.  The number of blocks is returned in *nblocks.
+ */
+static Relation
+open_bench_relation(Oid relid, BlockNumber *nblocks)
+{
+	Relation	rel;
+	AclResult	aclresult;
+
+	rel = relation_open(relid, AccessShareLock);
+
+	aclresult = pg_class_aclcheck(relid, GetUserId(), ACL_SELECT);
+	if (aclresult != ACLCHECK_OK)
+		aclcheck_error(aclresult, get_relkind_objtype(rel->rd_rel->relkind),
+					   RelationGetRelationName(rel));
+
+	if (!RELKIND_HAS_STORAGE(rel->rd_rel->relkind))
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("relation \"%s\" does not have storage",
+						RelationGetRelationName(rel))));
+
+	*nblocks = RelationGetNumberOfBlocks(rel);
+	if (*nblocks == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("relation \"%s\" is empty",
+						RelationGetRelationName(rel))));
+
+	return rel;
+}
+
+/*
+ * Read the blocks of a relation in turn, 'iterations' times in all.  With
+ * 'use_ring', the reads go through a bulk-read buffer ring, so that once the
+ * ring is full nearly every read of a block that is not in shared buffers
+ * has to evict one in BufferAlloc().  Otherwise, the reads hit shared
+ * buffers if the relation fits in them.
+ */
+Datum
+bench_buffer_read(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	int64		iterations = PG_GETARG_INT64(1);
+	bool		use_ring = PG_GETARG_BOOL(2);
+	Relation	rel;
+	BlockNumber nblocks;
+	BufferAccessStrategy strategy = NULL;
+	instr_time	start;
+
+	check_iterations(iterations);
+
+	rel = open_bench_relation(relid, &nblocks);
+
+	if (use_ring)
+		strategy = GetAccessStrategy(BAS_BULKREAD);
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	for (int64 i = 0; i < iterations; i++)
+	{
+		Buffer		buf;
+
+		CHECK_FOR_INTERRUPTS();
+
+		buf = ReadBufferExtended(rel, MAIN_FORKNUM, (BlockNumber) (i % nblocks),
+								 RBM_NORMAL, strategy);
+		ReleaseBuffer(buf);
+	}
+
+	relation_close(rel, AccessShareLock);
+
+	PG_RETURN_FLOAT8(ops_per_second(start, iterations));
+}
+
+/*
+ * Pin the first 'npins' blocks of a relation, then pin each of them once more
+ * and release the extra pin, 'iterations' times.  The pins are counted in the
+ * private refcount array of the process, and once it holds more than fit
+ * there (REFCOUNT_ARRAY_ENTRIES, 8) in the overflow hash table of bufmgr.c,
+ * so this measures the cost of looking up the pin count of a buffer.  Each
+ * pin and release counts as one operation.
+ */
+Datum
+bench_buffer_pin(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	int64		iterations = PG_GETARG_INT64(1);
+	int32		npins = PG_GETARG_INT32(2);
+	Relation	rel;
+	BlockNumber nblocks;
+	Buffer	   *buffers;
+	instr_time	start;
+
+	check_iterations(iterations);
+	if (npins < 1 || npins > MAX_BENCH_PINS)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of pins must be between 1 and %d",
+						MAX_BENCH_PINS)));
+
+	rel = open_bench_relation(relid, &nblocks);
+
+	if (nblocks < npins)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("relation \"%s\" has fewer than %d blocks",
+						RelationGetRelationName(rel), npins)));
+
+	buffers = palloc(sizeof(Buffer) * npins);
+	for (int j = 0; j < npins; j++)
+		buffers[j] = ReadBuffer(rel, (BlockNumber) j);
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	for (int64 i = 0; i < iterations; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		for (int j = 0; j < npins; j++)
+		{
+			IncrBufferRefCount(buffers[j]);
+			ReleaseBuffer(buffers[j]);
+		}
+	}
+
+	for (int j = 0; j < npins; j++)
+		ReleaseBuffer(buffers[j]);
+
+	relation_close(rel, AccessShareLock);
+
+	PG_RETURN_FLOAT8(ops_per_second(start, iterations * npins * 2));
+}
@@ -0,0 +1,76 @@
+# Very simple exercise of direct I/O GUC.
+
+use strict;
+use warnings;
+use Fcntl;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+# Systems that we know to have direct I/O support, and whose typical local
+# filesystems support it or at least won't fail with an error.  (illumos and
+# Solaris have O_DIRECT, but its behavior isn't clear on all filesystems.)
+if (!($^O eq 'linux' || $^O =~ /^(darwin|freebsd|netbsd|openbsd|MSWin32)$/))
+{
+	plan skip_all => "no direct I/O support on this platform";
+}
+
+# The tmpfs filesystem used for /tmp on some systems rejects O_DIRECT, so
+# check that the test directory accepts it before running.
+if ($^O eq 'linux')
+{
+	my $probe = "${PostgreSQL::Test::Utils::tmp_check}/test_o_direct_file";
+	if (sysopen(my $fh, $probe, O_RDWR | O_CREAT | O_DIRECT))
+	{
+		close($fh);
+		unlink($probe);
+	}
+	else
+	{
+		plan skip_all => "pre-flight test if we can open a file with O_DIRECT failed: $!";
+	}
+}
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+io_direct = 'data,wal,wal_init'
+shared_buffers = '256kB' # tiny to force I/O
+wal_level = replica # minimal runs out of shared_buffers when set so tiny
+});
+$node->start;
+
+# Do some work that is bound to generate shared and local writes and reads as a
+# simple exercise.
+$node->safe_psql('postgres',
+	'create table t1 as select 1 as i from generate_series(1, 10000)');
+$node->safe_psql('postgres', 'create table t2count (i int)');
+$node->safe_psql(
+	'postgres', qq{
+begin;
+create temporary table t2 as select 1 as i from generate_series(1, 10000);
+update t2 set i = i;
+insert into t2count select count(*) from t2;
+commit;
+});
+$node->safe_psql('postgres', 'update t1 set i = i');
+is( '10000',
+	$node->safe_psql('postgres', 'select count(*) from t1'),
+	"read back from shared");
+is( '10000',
+	$node->safe_psql('postgres', 'select * from t2count'),
+	"read back from local");
+$node->stop('immediate');
+
+$node->start;
+is( '10000',
+	$node->safe_psql('postgres', 'select count(*) from t1'),
+	"read back from shared after crash recovery");
+$node->stop;
+
+# Unknown values are rejected.
+$node->append_conf('postgresql.conf', "io_direct = 'data,bogus'");
+ok(!$node->start(fail_ok => 1), 'invalid io_direct value prevents startup');
+
+done_testing();
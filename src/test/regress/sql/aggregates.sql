@@ -118,6 +118,13 @@ FROM (VALUES (100000003), (100000004), (100000006), (100000007)) v(x);
 SELECT avg(x::float8), var_pop(x::float8)
 FROM (VALUES (7000000000005), (7000000000007)) v(x);
 
+-- test numeric sums mixing scales, and values too large for the
+-- fixed-width fast path
+SELECT sum(x), avg(x) = 1.946912
+FROM (VALUES (1.5), (1.23456), (1e30), (-1e30), (7)) v(x);
+SELECT i, sum(x) OVER (ORDER BY i ROWS BETWEEN 1 PRECEDING AND CURRENT ROW)
+FROM (VALUES (1, 1.5), (2, 2.25), (3, 3)) v(i, x);
+
 -- SQL2003 binary aggregates
 SELECT regr_count(b, a) FROM aggtest;
 SELECT regr_sxx(b, a) FROM aggtest;
@@ -1274,6 +1281,12 @@ explain (costs off)
    where (hundred, thousand) in (select twothousand, twothousand from onek);
 reset enable_memoize;
 
+-- hash aggregation on a single by-value key, with nulls
+set enable_sort=false;
+select x, count(*) from (values (1::int8), (null), (0), (null), (1), (1)) v(x)
+  group by x order by x;
+reset enable_sort;
+
 --
 -- Hash Aggregation Spill tests
 --
@@ -1404,3 +1417,33 @@ drop table agg_hash_1;
 drop table agg_hash_2;
 drop table agg_hash_3;
 drop table agg_hash_4;
+
+-- Eager aggregation: partially aggregating one side of a join must give
+-- the same results
+create temp table eager_agg_t1 (a int, b int);
+create temp table eager_agg_t2 (x int, y int);
+insert into eager_agg_t1 select i % 10, i from generate_series(1, 1000) i;
+insert into eager_agg_t2 select i, i * 10 from generate_series(0, 4) i;
+analyze eager_agg_t1;
+analyze eager_agg_t2;
+set enable_eager_aggregate = on;
+select t2.y, count(*), sum(t1.b)
+  from eager_agg_t1 t1 join eager_agg_t2 t2 on t1.a = t2.x
+  group by t2.y order by t2.y;
+reset enable_eager_aggregate;
+drop table eager_agg_t1;
+drop table eager_agg_t2;
+
+-- GROUP BY key reordering to match the input ordering
+create temp table group_reorder (a int, b int);
+insert into group_reorder select i % 3, i % 2 from generate_series(1, 12) i;
+create index group_reorder_b_a_idx on group_reorder (b, a);
+analyze group_reorder;
+set enable_group_by_reordering = on;
+set enable_hashagg = off;
+set enable_seqscan = off;
+select a, b, count(*) from group_reorder group by a, b order by b, a;
+reset enable_seqscan;
+reset enable_hashagg;
+reset enable_group_by_reordering;
+drop table group_reorder;
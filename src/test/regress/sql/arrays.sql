@@ -118,6 +118,12 @@ SELECT pg_input_is_valid('{1,2,3}', 'integer[]');
 SELECT pg_input_is_valid('{1,2', 'integer[]');
 SELECT pg_input_is_valid('{1,zed}', 'integer[]');
 SELECT * FROM pg_input_error_info('{1,zed}', 'integer[]');
+SELECT pg_input_is_valid('{1,9223372036854775808}', 'bigint[]');
+SELECT pg_input_is_valid('{1.5,x}', 'float8[]');
+SELECT '{-2147483648,NULL,2147483647}'::int4[];
+SELECT '{-9223372036854775808,NULL,0}'::int8[];
+SELECT '{1.5,NaN,-Infinity,NULL}'::float8[];
+SELECT '{0.25," 3 "}'::float4[];
 
 -- test mixed slice/scalar subscripting
 select '{{1,2,3},{4,5,6},{7,8,9}}'::int[];
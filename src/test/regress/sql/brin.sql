@@ -515,3 +515,30 @@ CREATE UNLOGGED TABLE brintest_unlogged (n numrange);
 CREATE INDEX brinidx_unlogged ON brintest_unlogged USING brin (n);
 INSERT INTO brintest_unlogged VALUES (numrange(0, 2^1000::numeric));
 DROP TABLE brintest_unlogged;
+
+-- test parallel build
+CREATE TABLE brintest_parallel (a int) WITH (fillfactor = 10);
+INSERT INTO brintest_parallel SELECT i FROM generate_series(1, 10000) s(i);
+ALTER TABLE brintest_parallel SET (parallel_workers = 2);
+SET max_parallel_maintenance_workers = 2;
+CREATE INDEX brinidx_parallel ON brintest_parallel USING brin (a)
+  WITH (pages_per_range = 2);
+RESET max_parallel_maintenance_workers;
+SET enable_seqscan = off;
+SELECT count(*) FROM brintest_parallel WHERE a BETWEEN 1000 AND 1999;
+RESET enable_seqscan;
+DROP TABLE brintest_parallel;
+
+-- updates changing only BRIN-indexed columns can be HOT, but must still
+-- update the BRIN summary
+CREATE TABLE brin_hot (id int PRIMARY KEY, val int) WITH (fillfactor = 50);
+CREATE INDEX brin_hot_val_idx ON brin_hot USING brin (val);
+INSERT INTO brin_hot SELECT i, i FROM generate_series(1, 100) s(i);
+BEGIN;
+UPDATE brin_hot SET val = -val WHERE id = 1;
+SELECT pg_stat_get_xact_tuples_hot_updated('brin_hot'::regclass);
+COMMIT;
+SET enable_seqscan = off;
+SELECT id, val FROM brin_hot WHERE val < 0;
+RESET enable_seqscan;
+DROP TABLE brin_hot;
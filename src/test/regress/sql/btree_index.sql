@@ -242,3 +242,50 @@ CREATE TABLE btree_part (id int4) PARTITION BY RANGE (id);
 CREATE INDEX btree_part_idx ON btree_part(id);
 ALTER INDEX btree_part_idx ALTER COLUMN id SET (n_distinct=100);
 DROP TABLE btree_part;
+
+--
+-- Test skip scans, which have no quals on the first index column
+--
+CREATE TABLE btree_skip (a int, b int);
+INSERT INTO btree_skip SELECT i % 5, i FROM generate_series(1, 1000) i;
+INSERT INTO btree_skip VALUES (NULL, 10), (NULL, 11);
+CREATE INDEX btree_skip_a_b ON btree_skip (a, b);
+VACUUM ANALYZE btree_skip;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT a, b FROM btree_skip WHERE b BETWEEN 8 AND 12 ORDER BY a, b;
+SELECT a, b FROM btree_skip WHERE b BETWEEN 8 AND 12 ORDER BY a DESC, b DESC;
+-- Groups too small to be worth skipping
+TRUNCATE btree_skip;
+INSERT INTO btree_skip SELECT i / 2, i % 10 FROM generate_series(1, 20000) i;
+VACUUM ANALYZE btree_skip;
+SELECT count(*) FROM btree_skip WHERE b = 3;
+SET enable_indexscan = off;
+SET enable_bitmapscan = on;
+SELECT count(*) FROM btree_skip WHERE b = 3;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+RESET enable_indexscan;
+DROP TABLE btree_skip;
+
+--
+-- Test batched insertion of index tuples, as done by COPY
+--
+CREATE TEMP TABLE btree_copy (LIKE tenk1);
+CREATE INDEX btree_copy_unique1 ON btree_copy (unique1);
+CREATE UNIQUE INDEX btree_copy_unique2 ON btree_copy (unique2);
+CREATE INDEX btree_copy_hundred ON btree_copy (hundred DESC, stringu1);
+CREATE INDEX btree_copy_partial ON btree_copy (stringu2) WHERE ten = 1;
+CREATE INDEX btree_copy_expr ON btree_copy ((thousand % 7));
+\set filename :abs_srcdir '/data/tenk.data'
+COPY btree_copy FROM :'filename';
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*) FROM btree_copy WHERE unique1 >= 0;
+SELECT count(*) FROM btree_copy WHERE unique2 >= 0;
+SELECT count(*) FROM btree_copy WHERE hundred BETWEEN 10 AND 19;
+SELECT count(*) FROM btree_copy WHERE stringu2 < 'ZZZZ' AND ten = 1;
+SELECT count(*) FROM btree_copy WHERE thousand % 7 = 3;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE btree_copy;
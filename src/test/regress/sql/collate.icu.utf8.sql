@@ -750,6 +750,22 @@ INSERT INTO test33 VALUES (2, 'DEF');
 SELECT (SELECT count(*) FROM test33_0) <> (SELECT count(*) FROM test33_1);
 
 
+-- full sort keys must give the same order as comparing the strings
+CREATE TABLE test34 (x text COLLATE "en-x-icu");
+INSERT INTO test34
+  SELECT repeat('abc', 20) || (g % 97)::text || chr(65 + g % 26 + (g % 2) * 32)
+  FROM generate_series(1, 1000) g;
+CREATE TABLE test34_sorted AS
+  SELECT array_agg(x ORDER BY x) AS a,
+         array(SELECT x FROM test34 ORDER BY x DESC LIMIT 10) AS l
+  FROM test34;
+SET full_sort_keys = on;
+SELECT a = (SELECT array_agg(x ORDER BY x) FROM test34) AS "true",
+       l = array(SELECT x FROM test34 ORDER BY x DESC LIMIT 10) AS "true"
+  FROM test34_sorted;
+RESET full_sort_keys;
+
+
 -- cleanup
 RESET search_path;
 SET client_min_messages TO warning;
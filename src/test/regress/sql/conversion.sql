@@ -322,6 +322,32 @@ select description, inbytes, (test_conv(inbytes, 'iso8859-5', 'utf8')).* from is
 select description, inbytes, (test_conv(inbytes, 'iso8859-5', 'koi8r')).* from iso8859_5_inputs;
 select description, inbytes, (test_conv(inbytes, 'iso8859_5', 'mule_internal')).* from iso8859_5_inputs;
 
+-- Test conversions with ASCII padding prepended, to provide coverage for
+-- the paths that copy runs of ASCII several bytes at a time.  The result
+-- should only differ from the unpadded conversion by the padding.
+with test_inputs as (
+  select inbytes, description, 'utf8' as src, 'latin1' as dst from utf8_inputs
+  union all
+  select inbytes, description, 'utf8', 'latin2' from utf8_inputs
+  union all
+  select inbytes, description, 'latin1', 'utf8' from iso8859_5_inputs
+  union all
+  select inbytes, description, 'iso8859-5', 'utf8' from iso8859_5_inputs
+), test_results as (
+  select
+    description,
+    src,
+    dst,
+    test_conv(inbytes, src, dst) as orig,
+    test_conv(repeat('.', 64)::bytea || inbytes, src, dst) as padded
+  from test_inputs
+)
+select description, src, dst
+from test_results
+where (padded).result is distinct from repeat('.', 64)::bytea || (orig).result
+   or (padded).errorat is distinct from (orig).errorat
+   or (padded).error is distinct from (orig).error;
+
 --
 -- Big5
 --
@@ -66,6 +66,7 @@ COPY x from stdin (force_not_null (a), force_not_null (b));
 COPY x from stdin (force_null (a), force_null (b));
 COPY x from stdin (convert_selectively (a), convert_selectively (b));
 COPY x from stdin (encoding 'sql_ascii', encoding 'sql_ascii');
+COPY x from stdin (parallel 1, parallel 2);
 
 -- incorrect options
 COPY x to stdin (format BINARY, delimiter ',');
@@ -76,6 +77,8 @@ COPY x to stdout (format TEXT, force_not_null(a));
 COPY x to stdin (format CSV, force_not_null(a));
 COPY x to stdout (format TEXT, force_null(a));
 COPY x to stdin (format CSV, force_null(a));
+COPY x from stdin (format BINARY, parallel 2);
+COPY x from stdin (parallel -1);
 
 -- too many columns in column list: should fail
 COPY x (a, b, c, d, e, d, c) from stdin;
@@ -464,6 +467,30 @@ test1
 SELECT * FROM instead_of_insert_tbl;
 COMMIT;
 
+-- parallel COPY FROM
+CREATE TABLE parallel_copy (a int PRIMARY KEY, b text, c int DEFAULT 42);
+COPY parallel_copy (a, b) FROM stdin (parallel 2);
+1	one
+2	two
+3	three
+4	four
+5	five
+\.
+COPY parallel_copy FROM stdin (format csv, header, parallel 2) WHERE a > 7;
+a,b,c
+6,six,6
+7,seven,7
+8,eight,8
+9,nine,9
+\.
+SELECT * FROM parallel_copy ORDER BY a;
+
+-- parallel COPY TO
+CREATE TABLE parallel_copy_to (a int, b text);
+INSERT INTO parallel_copy_to VALUES (1, 'one'), (2, NULL), (3, 'three, "quoted"');
+COPY parallel_copy_to TO stdout (parallel 2);
+COPY parallel_copy_to (b, a) TO stdout (format csv, header, force_quote (b), parallel 2);
+
 -- clean up
 DROP TABLE forcetest;
 DROP TABLE vistest;
@@ -478,3 +505,5 @@ DROP TABLE instead_of_insert_tbl;
 DROP VIEW instead_of_insert_tbl_view;
 DROP VIEW instead_of_insert_tbl_view_2;
 DROP FUNCTION fun_instead_of_insert_tbl();
+DROP TABLE parallel_copy;
+DROP TABLE parallel_copy_to;
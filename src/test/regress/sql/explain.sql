@@ -68,6 +68,7 @@ select explain_filter('explain (analyze, buffers, format text) select * from int
 select explain_filter('explain (analyze, buffers, format xml) select * from int8_tbl i8');
 select explain_filter('explain (analyze, buffers, format yaml) select * from int8_tbl i8');
 select explain_filter('explain (buffers, format text) select * from int8_tbl i8');
+select explain_filter('explain (planning, format text) select * from int8_tbl i8');
 select explain_filter('explain (buffers, format json) select * from int8_tbl i8');
 
 -- Check output including I/O timings.  These fields are conditional
@@ -76,6 +77,12 @@ set track_io_timing = on;
 select explain_filter('explain (analyze, buffers, format json) select * from int8_tbl i8');
 set track_io_timing = off;
 
+-- Check output of wait times.  These are omitted in text format when zero,
+-- so check them in YAML format.
+set track_wait_timing = on;
+select explain_filter('explain (analyze, waits, costs off, format yaml) select * from int8_tbl i8');
+set track_wait_timing = off;
+
 -- SETTINGS option
 -- We have to ignore other settings that might be imposed by the environment,
 -- so printing the whole Settings field unfortunately won't do.
@@ -134,6 +134,28 @@ select return_text_input('a') not in ('a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i
 
 rollback;
 
+-- Arrays supplied by Params are hashed too, so check NULL arrays and
+-- arrays whose value changes between evaluations
+set plan_cache_mode = force_generic_plan;
+prepare saop_param(int, int[]) as select $1 = any($2), $1 <> all($2);
+execute saop_param(1, '{3,2,1}');
+execute saop_param(4, '{3,2,1}');
+execute saop_param(4, '{3,2,null}');
+execute saop_param(4, null);
+deallocate saop_param;
+reset plan_cache_mode;
+
+do $$
+declare
+	arr int[] := '{}';
+begin
+	for i in 1..4 loop
+		arr := arr || i;
+		raise notice '%: %, %', i, 3 = any(arr), 3 <> all(arr);
+	end loop;
+end;
+$$;
+
 -- Test with non-strict equality function.
 -- We need to create our own type for this.
 
@@ -2068,3 +2068,17 @@ UPDATE fkpart11.pk SET a = 3 WHERE a = 4;
 UPDATE fkpart11.pk SET a = 1 WHERE a = 2;
 
 DROP SCHEMA fkpart11 CASCADE;
+
+-- foreign key checks that probe the referenced table's index directly,
+-- with index columns in a different order and a cross-type key
+CREATE TABLE fkfast_pk (a int8, b text, UNIQUE (b, a));
+CREATE TABLE fkfast_fk (x int4, y text, FOREIGN KEY (x, y) REFERENCES fkfast_pk (a, b));
+INSERT INTO fkfast_pk VALUES (1, 'one'), (2, 'two');
+INSERT INTO fkfast_fk VALUES (1, 'one'), (2, 'two'), (2, NULL);
+INSERT INTO fkfast_fk VALUES (2, 'one');  -- fail
+BEGIN;
+INSERT INTO fkfast_pk VALUES (3, 'three');
+INSERT INTO fkfast_fk VALUES (3, 'three');
+COMMIT;
+SELECT * FROM fkfast_fk ORDER BY x, y;
+DROP TABLE fkfast_fk, fkfast_pk;
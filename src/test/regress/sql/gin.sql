@@ -181,3 +181,16 @@ values
   ('{}',    null),
   ('{1}',   '{2,3}');
 drop table t_gin_test_tbl;
+
+-- test parallel build
+create table t_gin_parallel (a int4[]) with (fillfactor = 10);
+insert into t_gin_parallel
+  select array[i % 100, i] from generate_series(1, 10000) i;
+alter table t_gin_parallel set (parallel_workers = 2);
+set max_parallel_maintenance_workers = 2;
+create index t_gin_parallel_idx on t_gin_parallel using gin (a);
+reset max_parallel_maintenance_workers;
+set enable_seqscan = off;
+select count(*) from t_gin_parallel where a @> '{42}';
+reset enable_seqscan;
+drop table t_gin_parallel;
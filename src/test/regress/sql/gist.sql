@@ -186,3 +186,18 @@ create index gist_tbl_box_index on gist_tbl using gist (b);
 insert into gist_tbl
   select box(point(0.05*i, 0.05*i)) from generate_series(0,10) as i;
 drop table gist_tbl;
+
+-- Test parallel sorted build
+create table gist_parallel_tbl (p point);
+insert into gist_parallel_tbl
+  select point(i % 100, i / 100) from generate_series(1, 20000) as i;
+alter table gist_parallel_tbl set (parallel_workers = 2);
+set max_parallel_maintenance_workers = 2;
+create index gist_parallel_idx on gist_parallel_tbl using gist (p);
+reset max_parallel_maintenance_workers;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+select count(*) from gist_parallel_tbl where p <@ box(point(10, 10), point(19, 19));
+reset enable_seqscan;
+reset enable_bitmapscan;
+drop table gist_parallel_tbl;
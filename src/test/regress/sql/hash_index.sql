@@ -264,3 +264,17 @@ CREATE INDEX hash_f8_index2 ON hash_f8_heap USING hash (random float8_ops)
 	WITH (fillfactor=9);
 CREATE INDEX hash_f8_index2 ON hash_f8_heap USING hash (random float8_ops)
 	WITH (fillfactor=101);
+
+-- Test parallel build
+CREATE TABLE hash_parallel_heap (keycol int) WITH (fillfactor = 10);
+INSERT INTO hash_parallel_heap SELECT i % 1000 FROM generate_series(1, 20000) i;
+ALTER TABLE hash_parallel_heap SET (parallel_workers = 2);
+SET max_parallel_maintenance_workers = 2;
+CREATE INDEX hash_parallel_index ON hash_parallel_heap USING hash (keycol);
+RESET max_parallel_maintenance_workers;
+SET enable_seqscan = OFF;
+SET enable_bitmapscan = OFF;
+SELECT count(*) FROM hash_parallel_heap WHERE keycol = 42;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE hash_parallel_heap;
@@ -582,3 +582,9 @@ SELECT f1,
 
 -- internal overflow test case
 SELECT extract(epoch from interval '1000000000 days');
+
+-- sorting, including values whose abbreviated keys are clamped
+SELECT array_agg(n ORDER BY f1, n)
+  FROM (VALUES (1, interval '178000000 years 1 day'), (2, '-177000000 years'),
+               (3, '1 day'), (4, '178000000 years'), (5, '-178000000 years'),
+               (6, '30 days'), (7, '1 mon'), (8, '-1 sec')) v(n, f1);
@@ -386,6 +386,21 @@ select count(*) from tenk1 x where
   x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
 rollback;
 
+-- and with linearized DP
+begin;
+set enable_linear_join_search = on;
+set geqo_threshold = 2;
+select count(*) from tenk1 x where
+  x.unique1 in (select a.f1 from int4_tbl a,float8_tbl b where a.f1=b.f1) and
+  x.unique1 = 0 and
+  x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
+select count(*) from onek a
+  join onek b on a.unique1 = b.unique2
+  join onek c on b.unique1 = c.unique2
+  left join onek d on c.unique1 = d.unique2
+  join int4_tbl e on e.f1 = 0 and a.unique1 >= e.f1;
+rollback;
+
 --
 -- regression test: be sure we cope with proven-dummy append rels
 --
@@ -157,6 +157,21 @@ $$
 $$);
 rollback to settings;
 
+-- non-parallel, with compressed batch files
+savepoint settings;
+set local max_parallel_workers_per_gather = 0;
+set local work_mem = '128kB';
+set local hash_mem_multiplier = 1.0;
+set local temp_file_compression = pglz;
+select count(*), sum(length(r."?column?" || s."?column?"))
+  from simple r join simple s using (id);
+select original > 1 as initially_multibatch, final > original as increased_batches
+  from hash_join_batches(
+$$
+  select count(*) from simple r join simple s using (id);
+$$);
+rollback to settings;
+
 -- parallel with parallel-oblivious hash join
 savepoint settings;
 set local max_parallel_workers_per_gather = 2;
@@ -556,3 +571,9 @@ WHERE
     AND hjtest_1.a <> hjtest_2.b;
 
 ROLLBACK;
+
+-- A runtime filter must not change the result of the join
+BEGIN;
+SET LOCAL enable_runtime_filter = on;
+SELECT count(*) FROM tenk1 a JOIN onek b ON a.unique1 = b.unique1 WHERE b.ten = 0;
+ROLLBACK;
@@ -1516,3 +1516,39 @@ select '12345.0000000000000000000000000000000000000000000005'::jsonb::float8;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int2;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int4;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int8;
+
+-- key lookups in toasted documents, which are only detoasted partly
+CREATE TABLE test_jsonb_toast (id int, doc jsonb);
+INSERT INTO test_jsonb_toast
+  SELECT 1, jsonb_build_object('id', 1, 'pad', repeat('x', 100000), 'z', 'last');
+ALTER TABLE test_jsonb_toast ALTER COLUMN doc SET STORAGE external;
+INSERT INTO test_jsonb_toast
+  SELECT 2, jsonb_build_object('id', 2, 'pad', repeat('x', 100000), 'z', 'last');
+ALTER TABLE test_jsonb_toast ALTER COLUMN doc SET STORAGE extended;
+INSERT INTO test_jsonb_toast
+  SELECT 3, jsonb_build_object('id', 3, 'pad', string_agg(md5(i::text), ''), 'z', 'last')
+  FROM generate_series(1, 3000) i;
+SELECT id, doc->'id' AS key_id, doc->>'z' AS z, length(doc->>'pad') AS pad,
+       doc->'missing' AS missing
+  FROM test_jsonb_toast ORDER BY id;
+DROP TABLE test_jsonb_toast;
+
+-- key lookups in large objects, which are stored with a key index
+CREATE TABLE test_jsonb_keyindex AS
+  SELECT jsonb_object_agg('k' || i,
+                          CASE i % 3 WHEN 0 THEN to_jsonb(i)
+                                     WHEN 1 THEN to_jsonb('v' || i)
+                                     ELSE jsonb_build_object('n', i) END) AS doc
+  FROM generate_series(1, 300) i;
+SELECT doc->'k1' AS k1, doc->'k3' AS k3, doc->'k299' AS k299,
+       doc->'k299'->>'n' AS n, doc->'k301' AS k301
+  FROM test_jsonb_keyindex;
+SELECT count(*) FROM test_jsonb_keyindex, generate_series(1, 300) i
+  WHERE doc ? ('k' || i);
+SELECT doc @> '{"k150": 150, "k200": {"n": 200}}' AS contains,
+       doc ? 'k0' AS k0,
+       doc::text::jsonb = doc AS roundtrip,
+       jsonb_build_object('outer', doc)->'outer'->'k42' AS nested,
+       (doc - 'k5') ? 'k5' AS deleted
+  FROM test_jsonb_keyindex;
+DROP TABLE test_jsonb_keyindex;
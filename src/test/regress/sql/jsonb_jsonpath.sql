@@ -593,3 +593,12 @@ SELECT
 	jsonb_path_query_first(s1.j, '$.s > $s', vars => s2.j) gt
 FROM str s1, str s2
 ORDER BY s1.num, s2.num;
+
+-- simple key chains
+select jsonb_path_query('{"a": {"b": {"c": [1, 2]}}}', '$.a.b.c');
+select jsonb_path_query('{"a": {"b": 1}}', '$.a.x');
+select jsonb_path_query('{"a": {"b": 1}}', 'strict $.a.x');
+select jsonb_path_query('{"a": {"b": 1}}', 'strict $.a.x', silent => true);
+select jsonb_path_query('{"a": [{"b": 1}, {"b": 2}]}', 'lax $.a.b');
+select jsonb_path_query('{"a": 1}', 'lax $.a.b');
+select jsonb_path_exists('{"a": {"b": null}}', 'strict $.a.b');
@@ -102,6 +102,24 @@ REVOKE EXECUTE ON FUNCTION pg_log_backend_memory_contexts(integer)
 
 DROP ROLE regress_log_memory;
 
+--
+-- pg_get_process_memory_contexts()
+--
+-- The contents vary, but every process has a TopMemoryContext at level 0.
+--
+
+SELECT name, parent, level, type, total_bytes >= used_bytes AS ok
+  FROM pg_get_process_memory_contexts(pg_backend_pid())
+  WHERE level = 0;
+
+SELECT count(*) > 0 AS ok
+  FROM pg_stat_activity, pg_get_process_memory_contexts(pid, 60)
+  WHERE backend_type = 'checkpointer' AND name = 'TopMemoryContext';
+
+SELECT has_function_privilege('pg_read_all_stats',
+  'pg_get_process_memory_contexts(integer, float8)', 'EXECUTE'); -- yes
+
+
 --
 -- Test some built-in SRFs
 --
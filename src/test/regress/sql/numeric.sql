@@ -1458,6 +1458,18 @@ FROM (VALUES (0::numeric, 0::numeric),
 
 SELECT lcm(9999 * (10::numeric)^131068 + (10::numeric^131068 - 1), 2); -- overflow
 
+--
+-- Tests for multiplication of long inputs (Karatsuba)
+--
+WITH v(a, b) AS (
+  SELECT repeat('1234567', 400)::numeric, repeat('7654321', 300)::numeric
+)
+SELECT a * b % b = 0 AS mod_ok,
+       (a * b) / b = a AS div_ok
+FROM v;
+SELECT repeat('9', 1000)::numeric * repeat('9', 1000)::numeric
+       = 10::numeric ^ 2000 - 2 * 10::numeric ^ 1000 + 1 AS nines_ok;
+
 --
 -- Tests for factorial
 --
@@ -334,3 +334,13 @@ RESET parallel_setup_cost;
 EXPLAIN (COSTS OFF)
 SELECT x, sum(y), avg(y), count(*) FROM pagg_tab_para GROUP BY x HAVING avg(y) < 7 ORDER BY 1, 2, 3;
 SELECT x, sum(y), avg(y), count(*) FROM pagg_tab_para GROUP BY x HAVING avg(y) < 7 ORDER BY 1, 2, 3;
+
+-- Partitionwise window functions, when the partition key is part of every
+-- window's PARTITION BY clause
+SET enable_partitionwise_window TO true;
+SELECT c, count(*), max(r) AS r, max(s) AS s
+  FROM (SELECT c, row_number() OVER (PARTITION BY c ORDER BY a, b) AS r,
+               sum(a) OVER (PARTITION BY c) AS s
+          FROM pagg_tab) w
+  GROUP BY c ORDER BY c;
+RESET enable_partitionwise_window;
@@ -152,6 +152,14 @@ select regexp_match('fooba', '(?:..)*');
 select regexp_match('xyz', repeat('.', 260));
 select regexp_match('foo', '(?:.|){99}');
 
+-- Patterns with a required literal, which is looked for first
+select 'error 42 in foo' ~ 'error [0-9]+ in foo' as t;
+select 'error 42 in fob' ~ 'error [0-9]+ in foo' as f;
+select 'xyacz' ~ 'xyab*cz' as t;
+select 'abxd' ~ 'ab(cd)?xd' as t;
+select 'foo' ~ 'bar|foo' as t;
+select 'hello' ~ '(?i)HELLO' as t;
+
 -- Error conditions
 select 'xyz' ~ 'x(\w)(?=\1)';  -- no backrefs in LACONs
 select 'xyz' ~ 'x(\w)(?=(\1))';
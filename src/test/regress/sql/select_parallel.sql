@@ -62,6 +62,13 @@ explain (costs off)
 	from part_pa_test pa2;
 drop table part_pa_test;
 
+-- Parallel CTE Scan, reading a CTE materialized by the leader
+explain (costs off)
+  with w as materialized (select i, i % 10 as ten from generate_series(1, 10000) i)
+  select count(*), sum(i) from w where ten < 5;
+with w as materialized (select i, i % 10 as ten from generate_series(1, 10000) i)
+select count(*), sum(i) from w where ten < 5;
+
 -- test with leader participation disabled
 set parallel_leader_participation = off;
 explain (costs off)
@@ -92,6 +99,11 @@ select length(stringu1) from tenk1 group by length(stringu1);
 explain (costs off)
 	select stringu1, count(*) from tenk1 group by stringu1 order by stringu1;
 
+-- test Parallel HashAggregate, which partitions the groups among participants
+set enable_parallel_hashagg = on;
+select ten, count(*), sum(unique1) from tenk1 group by ten order by ten;
+reset enable_parallel_hashagg;
+
 -- test that parallel plan for aggregates is not selected when
 -- target list contains parallel restricted clause.
 explain (costs off)
@@ -446,6 +446,11 @@ SELECT pg_stat_reset_shared('wal');
 SELECT stats_reset > :'wal_reset_ts'::timestamptz FROM pg_stat_wal;
 SELECT stats_reset AS wal_reset_ts FROM pg_stat_wal \gset
 
+-- Test that reset_shared with lwlock specified as the stats type works
+SELECT stats_reset AS lwlock_reset_ts FROM pg_stat_lwlock WHERE name = 'ProcArray' \gset
+SELECT pg_stat_reset_shared('lwlock');
+SELECT stats_reset > :'lwlock_reset_ts'::timestamptz FROM pg_stat_lwlock WHERE name = 'ProcArray';
+
 -- Test that reset_shared with no specified stats type doesn't reset anything
 SELECT pg_stat_reset_shared(NULL);
 SELECT stats_reset = :'archiver_reset_ts'::timestamptz FROM pg_stat_archiver;
@@ -682,4 +687,22 @@ SELECT sum(evictions) + sum(reuses) + sum(extends) + sum(fsyncs) + sum(reads) +
   FROM pg_stat_io \gset
 SELECT :io_stats_post_reset < :io_stats_pre_reset;
 
+-- Test bulk and incremental fetching of relation stats
+CREATE TABLE test_stats_generation (a int);
+SELECT pg_stat_get_relation_stats_generation() AS stats_generation_before \gset
+INSERT INTO test_stats_generation VALUES (1), (2);
+SELECT pg_stat_force_next_flush();
+SELECT pg_stat_get_relation_stats_generation() > :stats_generation_before;
+SELECT tuples_inserted, generation > :stats_generation_before
+  FROM pg_stat_get_all_relation_stats(0)
+  WHERE relid = 'test_stats_generation'::regclass;
+SELECT relid::regclass, tuples_inserted
+  FROM pg_stat_get_all_relation_stats(:stats_generation_before)
+  WHERE relid = 'test_stats_generation'::regclass;
+SELECT pg_stat_get_relation_stats_generation() AS stats_generation_after \gset
+SELECT count(*) FROM pg_stat_get_all_relation_stats(:stats_generation_after)
+  WHERE relid = 'test_stats_generation'::regclass;
+SELECT pg_stat_get_all_relation_stats(-1);
+DROP TABLE test_stats_generation;
+
 -- End of Stats Test
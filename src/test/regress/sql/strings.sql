@@ -491,6 +491,15 @@ SELECT 'foo' LIKE '%__' as t, 'foo' LIKE '%___' as t, 'foo' LIKE '%____' as f;
 
 SELECT 'jack' LIKE '%____%' AS t;
 
+--
+-- test patterns that are a single literal between '%' wildcards, which are
+-- matched without the general matcher; the pattern varies from row to row
+--
+SELECT s, p, s LIKE p AS "like", s ILIKE p AS "ilike"
+FROM (VALUES ('hawkeye', 'hawk%'), ('hawkeye', '%EYE'), ('hawkeye', '%wke%'),
+             ('Hawkeye', 'hawkeye'), ('hawkeye', '%%'), ('hawk', '%hawkeye%'),
+             ('hawkeye', '%KEy%'), ('hawkeye', '%x%'), ('', '%'), ('', '')) AS v(s, p);
+
 
 --
 -- basic tests of LIKE with indexes
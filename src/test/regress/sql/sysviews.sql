@@ -45,6 +45,19 @@ select count(*) >= 0 as ok from pg_prepared_xacts;
 -- There will surely be at least one SLRU cache
 select count(*) > 0 as ok from pg_stat_slru;
 
+-- There are always built-in LWLock tranches
+select count(*) > 0 as ok from pg_stat_lwlock;
+
+-- Sample a query that keeps sleeping
+set compute_query_id = on;
+set query_sample_interval = 10;
+select pg_stat_reset_query_samples();
+select count(pg_sleep(0.01)) from generate_series(1, 10);
+reset query_sample_interval;
+reset compute_query_id;
+select count(*) > 0 as ok from pg_stat_query_samples
+  where node_type = 'Aggregate' and wait_event = 'PgSleep';
+
 -- There must be only one record
 select count(*) = 1 as ok from pg_stat_wal;
 
@@ -459,6 +459,16 @@ select * from generate_series('2020-01-01 00:00'::timestamptz,
                               '2020-01-02 03:00'::timestamptz,
                               '0 hour'::interval);
 
+-- consecutive values on both sides of a DST transition
+SET TimeZone to 'America/New_York';
+select * from generate_series('2023-03-12 05:00+00'::timestamptz,
+                              '2023-03-12 08:00+00'::timestamptz,
+                              '30 min'::interval);
+select * from generate_series('2023-11-05 07:00+00'::timestamptz,
+                              '2023-11-05 04:00+00'::timestamptz,
+                              '-30 min'::interval);
+RESET TimeZone;
+
 --
 -- Test behavior with a dynamic (time-varying) timezone abbreviation.
 -- These tests rely on the knowledge that MSK (Europe/Moscow standard time)
@@ -199,6 +199,9 @@ SELECT ts_rank(' a:1 s:2C d g'::tsvector, 'a & s');
 SELECT ts_rank(' a:1 s:2B d g'::tsvector, 'a & s');
 SELECT ts_rank(' a:1 s:2 d g'::tsvector, 'a & s');
 
+SELECT q, ts_rank(' a:1 s:2C d g'::tsvector, q::tsquery)
+FROM (VALUES ('a | s'), ('a & s'), ('a | s'), ('s & a')) v(q);
+
 SELECT ts_rank_cd(' a:1 s:2C d g'::tsvector, 'a | s');
 SELECT ts_rank_cd(' a:1 sa:2C d g'::tsvector, 'a | s');
 SELECT ts_rank_cd(' a:1 sa:2C d g'::tsvector, 'a | s:*');
@@ -296,3 +296,50 @@ EXPLAIN (COSTS OFF) :qry;
 :qry;
 
 COMMIT;
+
+----
+-- Check that radix sorting of in-memory sorts matches comparison sorting
+----
+
+CREATE TEMP TABLE radix_sort_data AS
+  SELECT g AS id,
+         CASE WHEN g % 97 = 0 THEN NULL ELSE (g * 7919) % 2001 - 1000 END AS i4,
+         ((g * 104729) % 3001 - 1500)::int8 * 3000000000 AS i8,
+         md5(g::text) AS t
+  FROM generate_series(1, 5000) g;
+
+SET optimize_radix_sort = off;
+SELECT string_agg(coalesce(i4::text, 'null'), ',' ORDER BY i4 DESC NULLS FIRST) AS i4_desc,
+       string_agg(id::text, ',' ORDER BY i8, id) AS i8_asc,
+       string_agg(id::text, ',' ORDER BY t COLLATE "C" DESC, id) AS t_desc
+  FROM radix_sort_data \gset
+SET optimize_radix_sort = on;
+SELECT string_agg(coalesce(i4::text, 'null'), ',' ORDER BY i4 DESC NULLS FIRST) = :'i4_desc' AS i4_desc,
+       string_agg(id::text, ',' ORDER BY i8, id) = :'i8_asc' AS i8_asc,
+       string_agg(id::text, ',' ORDER BY t COLLATE "C" DESC, id) = :'t_desc' AS t_desc
+  FROM radix_sort_data;
+RESET optimize_radix_sort;
+
+----
+-- Check that sorts on two int4 keys, which are packed into one abbreviated
+-- key, match sorts on the same keys as int8
+----
+
+CREATE TEMP TABLE packed_keys_data AS
+  SELECT g AS id,
+         CASE WHEN g % 89 = 0 THEN NULL ELSE (g * 7919) % 41 - 20 END AS a,
+         CASE WHEN g % 53 = 0 THEN NULL
+              WHEN g % 61 = 0 THEN 2147483647
+              WHEN g % 67 = 0 THEN -2147483648
+              ELSE (g * 104729) % 301 - 150 END AS b
+  FROM generate_series(1, 5000) g;
+
+SELECT string_agg(id::text, ',' ORDER BY a, b, id) =
+       string_agg(id::text, ',' ORDER BY a::int8, b::int8, id) AS asc_asc,
+       string_agg(id::text, ',' ORDER BY a DESC, b, id) =
+       string_agg(id::text, ',' ORDER BY a::int8 DESC, b::int8, id) AS desc_asc,
+       string_agg(id::text, ',' ORDER BY a, b DESC NULLS LAST, id) =
+       string_agg(id::text, ',' ORDER BY a::int8, b::int8 DESC NULLS LAST, id) AS asc_desc,
+       string_agg(id::text, ',' ORDER BY a DESC NULLS LAST, b DESC NULLS FIRST, id) =
+       string_agg(id::text, ',' ORDER BY a::int8 DESC NULLS LAST, b::int8 DESC NULLS FIRST, id) AS desc_desc
+  FROM packed_keys_data;
@@ -667,3 +667,18 @@ update hash_parted set b = b + 8 where b = 1;
 drop table hash_parted;
 drop operator class custom_opclass using hash;
 drop function dummy_hashint4(a int4, seed int8);
+
+-- sort_modify_targets sorts the rows to modify by ctid
+create table sort_modify_tab (a int, b int);
+insert into sort_modify_tab values (1, 1), (2, 2), (3, 3);
+set sort_modify_targets = on;
+explain (costs off)
+update sort_modify_tab set b = b + 1 where a > 1;
+update sort_modify_tab set b = b + 1 where a > 1 returning a, b;
+merge into sort_modify_tab t
+  using (values (3, 30), (1, 10), (4, 40)) s(a, b) on t.a = s.a
+  when matched then update set b = s.b
+  when not matched then insert values (s.a, s.b);
+select * from sort_modify_tab order by a;
+reset sort_modify_targets;
+drop table sort_modify_tab;
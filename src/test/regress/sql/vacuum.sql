@@ -222,6 +222,11 @@ VACUUM (SKIP_LOCKED, FULL) vactst;
 ANALYZE (SKIP_LOCKED) vactst;
 RESET client_min_messages;
 
+-- SKIP_UNCHANGED option
+ANALYZE (SKIP_UNCHANGED) vactst;
+ANALYZE (SKIP_UNCHANGED) vactst (i);
+VACUUM (SKIP_UNCHANGED) vactst;
+
 -- ensure VACUUM and ANALYZE don't have a problem with serializable
 SET default_transaction_isolation = serializable;
 VACUUM vactst;
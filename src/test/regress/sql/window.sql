@@ -1707,6 +1707,13 @@ SELECT i, b, bool_and(b) OVER w, bool_or(b) OVER w
   FROM (VALUES (1,true), (2,true), (3,false), (4,false), (5,true)) v(i,b)
   WINDOW w AS (ORDER BY i ROWS BETWEEN CURRENT ROW AND 1 FOLLOWING);
 
+-- test that aggregates with a combine function but no inverse transition
+-- function slide the frame correctly
+SELECT i, v, min(v) OVER w, max(v) OVER w,
+       max(v) OVER (ORDER BY i ROWS BETWEEN 1 FOLLOWING AND 2 FOLLOWING)
+  FROM (VALUES (1,3), (2,NULL), (3,1), (4,5), (5,2), (6,4)) t(i,v)
+  WINDOW w AS (ORDER BY i ROWS BETWEEN 2 PRECEDING AND CURRENT ROW);
+
 -- Tests for problems with failure to walk or mutate expressions
 -- within window frame clauses.
 
@@ -108,8 +108,11 @@ $result =
   $node_subscriber->safe_psql('postgres', "SELECT count(*) FROM tab_rep");
 is($result, qq(20), 'initial data synced for fourth sub');
 
-# add new table on subscriber
-$node_subscriber->safe_psql('postgres', "CREATE TABLE tab_rep_next (a int)");
+# add new table on subscriber, with an index that the initial copy of the
+# empty table builds after loading the data
+$node_subscriber->safe_psql('postgres',
+	"CREATE TABLE tab_rep_next (a int); CREATE INDEX tab_rep_next_a_idx ON tab_rep_next (a)"
+);
 
 # setup structure with existing data on publisher
 $node_publisher->safe_psql('postgres',
@@ -133,6 +136,11 @@ $result = $node_subscriber->safe_psql('postgres',
 is($result, qq(10),
 	'data for table added after subscription initialized are now synced');
 
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT indisvalid, indisready FROM pg_index WHERE indexrelid = 'tab_rep_next_a_idx'::regclass"
+);
+is($result, qq(t|t), 'index is valid after initial data sync');
+
 # Add some data
 $node_publisher->safe_psql('postgres',
 	"INSERT INTO tab_rep_next SELECT generate_series(1,10)");
@@ -144,6 +152,14 @@ $result = $node_subscriber->safe_psql('postgres',
 is($result, qq(20),
 	'changes for table added after subscription initialized replicated');
 
+$result = $node_subscriber->safe_psql(
+	'postgres', qq(
+	SET enable_seqscan = off;
+	SET enable_bitmapscan = off;
+	SELECT count(*) FROM tab_rep_next WHERE a > 0;
+));
+is($result, qq(20), 'index contains synced and replicated rows');
+
 # clean up
 $node_publisher->safe_psql('postgres', "DROP TABLE tab_rep_next");
 $node_subscriber->safe_psql('postgres', "DROP TABLE tab_rep_next");
@@ -0,0 +1,151 @@
+
+# Copyright (c) 2023, PostgreSQL Global Development Group
+
+# Tests for applying consecutive INSERTs in batches
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+# Create publisher node. Set a low value of logical_decoding_work_mem to test
+# streaming cases.
+my $node_publisher = PostgreSQL::Test::Cluster->new('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->append_conf('postgresql.conf',
+	'logical_decoding_work_mem = 64kB');
+$node_publisher->start;
+
+# Create subscriber node
+my $node_subscriber = PostgreSQL::Test::Cluster->new('subscriber');
+$node_subscriber->init;
+$node_subscriber->start;
+
+my $ddl = qq(
+	CREATE TABLE tab_parent (a int PRIMARY KEY, b text);
+	CREATE TABLE tab_child (a int REFERENCES tab_parent, c int);
+	CREATE INDEX ON tab_child (c);
+	CREATE TABLE tab_self (a int PRIMARY KEY, parent int REFERENCES tab_self);
+	CREATE TABLE tab_trig (a int);
+	CREATE TABLE tab_unique (a int UNIQUE););
+$node_publisher->safe_psql('postgres', $ddl);
+$node_subscriber->safe_psql('postgres', $ddl);
+
+# The subscriber side has extra columns, one filled in by a default
+$node_subscriber->safe_psql(
+	'postgres', qq(
+	ALTER TABLE tab_child ADD COLUMN d int DEFAULT 42;
+	ALTER TABLE tab_trig ADD COLUMN cnt bigint;
+));
+
+# A BEFORE ROW trigger that looks at the earlier rows of the transaction
+$node_subscriber->safe_psql(
+	'postgres', qq(
+	CREATE FUNCTION tab_trig_count() RETURNS trigger AS \$\$
+	BEGIN
+		NEW.cnt := (SELECT count(*) FROM tab_trig);
+		RETURN NEW;
+	END
+	\$\$ LANGUAGE plpgsql;
+	CREATE TRIGGER tab_trig_count BEFORE INSERT ON tab_trig
+	  FOR EACH ROW EXECUTE FUNCTION tab_trig_count();
+	ALTER TABLE tab_trig ENABLE REPLICA TRIGGER tab_trig_count;
+));
+
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR ALL TABLES");
+
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr' PUBLICATION tap_pub"
+);
+
+$node_subscriber->wait_for_subscription_sync($node_publisher, 'tap_sub');
+
+# Interleaved and consecutive inserts into several tables, with foreign keys
+# between and within the batches, and changes to the rows of a batch.
+$node_publisher->safe_psql(
+	'postgres', qq(
+	BEGIN;
+	INSERT INTO tab_parent SELECT i, 'p' || i FROM generate_series(1, 2500) i;
+	INSERT INTO tab_child SELECT i, i FROM generate_series(1, 2500) i;
+	INSERT INTO tab_parent VALUES (2501, 'x');
+	INSERT INTO tab_child VALUES (2501, -1);
+	UPDATE tab_parent SET b = 'updated' WHERE a = 2501;
+	INSERT INTO tab_self VALUES (1, NULL);
+	INSERT INTO tab_self SELECT i, i - 1 FROM generate_series(2, 1500) i;
+	DELETE FROM tab_self WHERE a > 1000;
+	INSERT INTO tab_trig SELECT generate_series(1, 10);
+	COMMIT;
+));
+
+$node_publisher->wait_for_catchup('tap_sub');
+
+my $result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), count(DISTINCT b), min(a), max(a) FROM tab_parent");
+is($result, qq(2501|2501|1|2501), 'consecutive inserts are applied');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), sum(c), count(*) FILTER (WHERE d = 42) FROM tab_child");
+is($result, qq(2501|3126249|2501),
+	'inserts are applied with default values');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT b FROM tab_parent WHERE a = 2501");
+is($result, qq(updated), 'update sees the rows inserted before it');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), max(a) FROM tab_self");
+is($result, qq(1000|1000), 'delete sees the rows inserted before it');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT string_agg(cnt::text, ',' ORDER BY a) FROM tab_trig");
+is($result, qq(0,1,2,3,4,5,6,7,8,9),
+	'tables with BEFORE ROW triggers are applied row by row');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*) FROM tab_child WHERE c = 2500");
+is($result, qq(1), 'index is maintained for batched inserts');
+
+# Now do the same with a streamed transaction
+$node_subscriber->safe_psql('postgres',
+	"ALTER SUBSCRIPTION tap_sub SET (streaming = on)");
+$node_publisher->safe_psql(
+	'postgres', qq(
+	BEGIN;
+	INSERT INTO tab_parent SELECT i, 'p' || i FROM generate_series(3001, 6000) i;
+	INSERT INTO tab_child SELECT i, i FROM generate_series(3001, 6000) i;
+	COMMIT;
+));
+
+$node_publisher->wait_for_catchup('tap_sub');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), max(a) FROM tab_parent");
+is($result, qq(5501|6000), 'streamed inserts are applied');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), max(a) FROM tab_child");
+is($result, qq(5501|6000), 'last batch of streamed transaction is applied');
+
+# A conflict in a batch is reported for the INSERT into the table
+$node_subscriber->safe_psql('postgres',
+	"INSERT INTO tab_unique VALUES (5)");
+my $offset = -s $node_subscriber->logfile;
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO tab_unique SELECT generate_series(1, 10)");
+$node_subscriber->wait_for_log(
+	qr/CONTEXT:  processing remote data for replication origin "pg_\d+" during message type "INSERT" for replication target relation "public.tab_unique"/,
+	$offset);
+
+$node_subscriber->safe_psql('postgres', "DELETE FROM tab_unique");
+$node_publisher->wait_for_catchup('tap_sub');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*) FROM tab_unique");
+is($result, qq(10), 'inserts are applied after the conflict is resolved');
+
+$node_subscriber->stop('fast');
+$node_publisher->stop('fast');
+
+done_testing();
@@ -83,8 +83,8 @@ my $frontend_extrasource = {
 	  [ 'src/bin/pgbench/exprscan.l', 'src/bin/pgbench/exprparse.y' ]
 };
 my @frontend_excludes = (
-	'pgevent',    'pg_basebackup', 'pg_rewind', 'pg_dump',
-	'pg_waldump', 'scripts');
+	'pgevent',         'pg_basebackup', 'pg_rewind', 'pg_dump',
+	'pg_verifybackup', 'pg_waldump',    'scripts');
 
 sub mkvcbuild
 {
@@ -104,7 +104,7 @@ sub mkvcbuild
 	  inet_net_ntop.c kill.c open.c
 	  snprintf.c strlcat.c strlcpy.c dirmod.c noblock.c path.c
 	  dirent.c getopt.c getopt_long.c
-	  preadv.c pwritev.c pg_bitutils.c
+	  preadv.c pwritev.c pg_bitutils.c pg_numa.c
 	  pg_strong_random.c pgcheckdir.c pgmkdirp.c pgsleep.c pgstrcasecmp.c
 	  pqsignal.c mkdtemp.c qsort.c qsort_arg.c bsearch_arg.c quotes.c system.c
 	  strerror.c tar.c
@@ -418,6 +418,15 @@ sub mkvcbuild
 	$pgrecvlogical->AddFile('src/bin/pg_basebackup/pg_recvlogical.c');
 	$pgrecvlogical->AddLibrary('ws2_32.lib');
 
+	# pg_verifybackup reads tar-format backups with pg_basebackup's
+	# bbstreamers
+	my $pgverifybackup = AddSimpleFrontend('pg_verifybackup', 1);
+	$pgverifybackup->AddIncludeDir('src/bin/pg_basebackup');
+	$pgverifybackup->AddFile('src/bin/pg_basebackup/bbstreamer_gzip.c');
+	$pgverifybackup->AddFile('src/bin/pg_basebackup/bbstreamer_lz4.c');
+	$pgverifybackup->AddFile('src/bin/pg_basebackup/bbstreamer_tar.c');
+	$pgverifybackup->AddFile('src/bin/pg_basebackup/bbstreamer_zstd.c');
+
 	my $pgrewind = AddSimpleFrontend('pg_rewind', 1);
 	$pgrewind->{name} = 'pg_rewind';
 	$pgrewind->AddFile('src/backend/access/transam/xlogreader.c');